@@ -0,0 +1,111 @@
+#version 400 core
+
+uniform vec4 		objectColour;
+uniform sampler2DArray 	mainTex;
+uniform sampler2DShadow shadowTex;
+
+uniform vec3	lightPos;
+uniform float	lightRadius;
+uniform vec4	lightColour;
+
+uniform vec3	cameraPos;
+
+//HAS_TEXTURE is defined for the variant drawing textured objects, see OGLShader::Feature
+
+//The renderer's light grid - see LightGrid.h, whose sizes these have to match
+const int clusterTilesX = 16;
+const int clusterTilesY = 9;
+const int clusterSliceCount = 24;
+
+uniform samplerBuffer	lightData;		//position and radius, then colour, for each light
+uniform usamplerBuffer	lightClusters;	//first index and count, for each cluster
+uniform usamplerBuffer	lightIndices;
+uniform int		lightCount = 0;
+uniform vec2	clusterTileSize;		//in pixels
+uniform vec2	clusterSlices;			//log(depth) * x + y is the slice
+uniform vec2	clusterDepth;			//near and far planes
+
+in Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+	vec4 shadowProj;
+	vec3 normal;
+	vec3 worldPos;
+} IN;
+
+flat in int textureLayer;
+uniform int submeshLayer = 0; //for material arrays, which have a layer per submesh
+
+out vec4 fragColor;
+
+//Every dynamic light in this pixel's cluster, none of which cast shadows
+vec3 ClusteredLights(vec3 albedo, vec3 viewDir)
+{
+	float ndcZ		= gl_FragCoord.z * 2.0 - 1.0;
+	float depth		= 2.0 * clusterDepth.x * clusterDepth.y / (clusterDepth.y + clusterDepth.x - ndcZ * (clusterDepth.y - clusterDepth.x));
+	ivec3 cluster	= ivec3(gl_FragCoord.xy / clusterTileSize, log(depth) * clusterSlices.x + clusterSlices.y);
+	cluster			= clamp(cluster, ivec3(0), ivec3(clusterTilesX - 1, clusterTilesY - 1, clusterSliceCount - 1));
+
+	uvec2 range = texelFetch(lightClusters, (cluster.z * clusterTilesY + cluster.y) * clusterTilesX + cluster.x).xy;
+
+	vec3 total = vec3(0.0);
+	for(uint i = 0u; i < range.y; ++i) {
+		int light		= int(texelFetch(lightIndices, int(range.x + i)).x);
+		vec4 posRadius	= texelFetch(lightData, light * 2);
+		vec3 colour		= texelFetch(lightData, light * 2 + 1).rgb;
+
+		vec3  toLight	= posRadius.xyz - IN.worldPos;
+		float dist		= length(toLight);
+		float falloff	= clamp(1.0 - dist / posRadius.w, 0.0, 1.0);
+		falloff			*= falloff;
+
+		vec3  incident	= toLight / max(dist, 0.0001);
+		float lambert	= max(0.0, dot(incident, IN.normal));
+		float sFactor	= pow(max(0.0, dot(normalize(incident + viewDir), IN.normal)), 80.0);
+
+		total += (albedo * lambert + sFactor) * colour * falloff;
+	}
+	return total;
+}
+
+//The same lighting as GameTechFrag, but reading one layer of an array texture
+void main(void)
+{
+	float shadow = 1.0;
+
+	if(IN.shadowProj.w > 0.0) {
+		shadow = textureProj(shadowTex, IN.shadowProj) * 0.5f;
+	}
+
+	vec3  incident	= normalize(lightPos - IN.worldPos);
+	float lambert	= max(0.0, dot(incident, IN.normal)) * 0.9;
+
+	vec3 viewDir	= normalize(cameraPos - IN.worldPos);
+	vec3 halfDir	= normalize(incident + viewDir);
+
+	float rFactor	= max(0.0, dot(halfDir, IN.normal));
+	float sFactor	= pow(rFactor, 80.0);
+
+	vec4 albedo = IN.colour;
+
+#ifdef HAS_TEXTURE
+	albedo *= texture(mainTex, vec3(IN.texCoord, float(textureLayer + submeshLayer)));
+#endif
+
+	albedo.rgb = pow(albedo.rgb, vec3(2.2));
+
+	fragColor.rgb = albedo.rgb * 0.05f; //ambient
+
+	fragColor.rgb += albedo.rgb * lightColour.rgb * lambert * shadow; //diffuse light
+
+	fragColor.rgb += lightColour.rgb * sFactor * shadow; //specular light
+
+	if(lightCount > 0) {
+		fragColor.rgb += ClusteredLights(albedo.rgb, viewDir);
+	}
+
+	fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / 2.2f));
+
+	fragColor.a = albedo.a;
+}
@@ -0,0 +1,19 @@
+#version 430 core
+
+uniform mat4 mvpMatrix; //just the light's view and projection, the model matrix is per object
+
+struct ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	vec4 bounds;
+};
+
+layout(std430, binding = 7) readonly buffer Objects { ObjectData objects[]; };
+
+layout(location = 0) in vec3 position;
+layout(location = 8) in uint objectIndex;
+
+void main(void)
+{
+	gl_Position = mvpMatrix * objects[objectIndex].modelMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,53 @@
+#version 430 core
+
+layout(std140) uniform FrameData {
+	mat4 projMatrix;
+	mat4 viewMatrix;
+	mat4 shadowMatrix; //without the model matrix, that's per object
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColour;
+	float lightRadius;
+	float time;
+	mat4 viewProjMatrix;
+	mat4 invViewProjMatrix;
+} frame;
+
+struct ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	vec4 bounds;
+};
+
+layout(std430, binding = 7) readonly buffer Objects { ObjectData objects[]; };
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in vec3 normal;
+
+layout(location = 8) in uint objectIndex; //the draw's base instance
+
+out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+	vec4 shadowProj;
+	vec3 normal;
+	vec3 worldPos;
+} OUT;
+
+void main(void)
+{
+	ObjectData object	= objects[objectIndex];
+	mat4 mvp			= (frame.viewProjMatrix * object.modelMatrix);
+	mat3 normalMatrix	= transpose(inverse(mat3(object.modelMatrix)));
+
+	OUT.shadowProj	= frame.shadowMatrix * object.modelMatrix * vec4(position, 1);
+	OUT.worldPos	= (object.modelMatrix * vec4(position, 1)).xyz;
+	OUT.normal		= normalize(normalMatrix * normalize(normal));
+
+	OUT.texCoord	= texCoord;
+	OUT.colour		= object.colour;
+
+	gl_Position		= mvp * vec4(position, 1.0);
+}
@@ -0,0 +1,60 @@
+#version 400 core
+
+layout(std140) uniform FrameData {
+	mat4 projMatrix;
+	mat4 viewMatrix;
+	mat4 shadowMatrix; //without the model matrix, that's per instance
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColour;
+	float lightRadius;
+	float time;
+	mat4 viewProjMatrix;
+	mat4 invViewProjMatrix;
+} frame;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 colour;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in vec3 normal;
+
+layout(location = 8) in mat4 instanceModel; //takes up 8 to 11
+layout(location = 12) in vec4 instanceColour;
+layout(location = 13) in float instanceLayer;
+layout(location = 14) in vec4 instanceFadeFrom;
+layout(location = 15) in vec2 instanceFade; //when it started, and how long it takes
+
+//VERTEX_COLOURS is defined for the variant drawing meshes that have them, see OGLShader::Feature
+
+out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+	vec4 shadowProj;
+	vec3 normal;
+	vec3 worldPos;
+} OUT;
+
+flat out int textureLayer; //only read by the array fragment shader
+
+void main(void)
+{
+	mat4 mvp			= (frame.viewProjMatrix * instanceModel);
+	mat3 normalMatrix	= transpose(inverse(mat3(instanceModel)));
+
+	OUT.shadowProj	= frame.shadowMatrix * instanceModel * vec4(position, 1);
+	OUT.worldPos	= (instanceModel * vec4(position, 1)).xyz;
+	OUT.normal		= normalize(normalMatrix * normalize(normal));
+
+	OUT.texCoord	= texCoord;
+	float fade		= instanceFade.y > 0.0 ? clamp((frame.time - instanceFade.x) / instanceFade.y, 0.0, 1.0) : 1.0;
+	vec4 objColour	= mix(instanceFadeFrom, instanceColour, fade);
+
+	OUT.colour		= objColour;
+	textureLayer	= int(instanceLayer);
+
+#ifdef VERTEX_COLOURS
+	OUT.colour = objColour * colour;
+#endif
+	gl_Position		= mvp * vec4(position, 1.0);
+}
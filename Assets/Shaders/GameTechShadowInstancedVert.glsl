@@ -0,0 +1,9 @@
+#version 400 core
+
+layout(location = 0) in vec3 position;
+layout(location = 8) in mat4 instanceMVP; //the light's view and projection, with each caster's model matrix
+
+void main(void)
+{
+	gl_Position = instanceMVP * vec4(position, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 430 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D depthTex;		//the depth copy, for the first level
+uniform bool	fromDepth	= false;
+uniform ivec2	sourceSize;		//of whichever one's being read
+
+layout(r32f, binding = 0) writeonly uniform image2D destination;
+layout(r32f, binding = 1) readonly uniform image2D source; //the level before, after the first
+
+void main(void)
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, imageSize(destination)))) {
+		return;
+	}
+	//The furthest of the 3x3 under it, so odd sized levels never lose an edge
+	float furthest = 0.0;
+	for (int y = 0; y < 3; ++y) {
+		for (int x = 0; x < 3; ++x) {
+			ivec2 s = min(texel * 2 + ivec2(x, y), sourceSize - 1);
+			float depth = fromDepth ? texelFetch(depthTex, s, 0).r : imageLoad(source, s).r;
+			furthest = max(furthest, depth);
+		}
+	}
+	imageStore(destination, texel, vec4(furthest));
+}
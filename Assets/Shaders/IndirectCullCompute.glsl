@@ -0,0 +1,95 @@
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+struct ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	vec4 bounds; //centre, then radius
+};
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int  baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 7) readonly buffer Objects			{ ObjectData objects[]; };
+layout(std430, binding = 8) readonly buffer SourceCommands	{ DrawCommand sourceCommands[]; };
+layout(std430, binding = 9) writeonly buffer CulledCommands	{ DrawCommand culledCommands[]; };
+layout(std430, binding = 10) readonly buffer CommandLODs	{ vec2 commandLODs[]; }; //the screen sizes each is drawn between
+
+uniform vec4	frustumPlanes[6]; //facing inwards, normalised
+uniform int		commandCount = 0;
+
+uniform vec3	cameraPos;
+uniform float	lodScale; //how much of the screen's height a unit sphere covers a unit away
+
+//Last frame's depth pyramid, each texel the furthest of the ones below it
+uniform sampler2D	hiZ;
+uniform bool		useHiZ = false;
+uniform mat4		hiZViewProj;	//what that depth was drawn with
+uniform ivec2		hiZSize;		//of its first level
+uniform int			hiZLevels;
+
+/*
+Projects the sphere's box with last frame's matrix, and picks the level
+where that covers no more than 2x2 texels. If its nearest point is behind
+the furthest depth in all four, it was hidden. Anything that was partly
+behind the camera or off screen back then is kept.
+*/
+bool IsOccluded(vec4 bounds) {
+	vec3 minNDC = vec3(1e30);
+	vec3 maxNDC = vec3(-1e30);
+	for (int i = 0; i < 8; ++i) {
+		vec3 corner = bounds.xyz + vec3((i & 1) != 0 ? bounds.w : -bounds.w, (i & 2) != 0 ? bounds.w : -bounds.w, (i & 4) != 0 ? bounds.w : -bounds.w);
+		vec4 clip = hiZViewProj * vec4(corner, 1.0);
+		if (clip.w <= 0.0001) {
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		minNDC = min(minNDC, ndc);
+		maxNDC = max(maxNDC, ndc);
+	}
+	if (any(lessThan(maxNDC.xy, vec2(-1.0))) || any(greaterThan(minNDC.xy, vec2(1.0))) || minNDC.z < -1.0) {
+		return false;
+	}
+	vec2 uvMin = clamp(minNDC.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(maxNDC.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 extent = (uvMax - uvMin) * vec2(hiZSize);
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hiZLevels - 1);
+
+	ivec2 levelSize = max(hiZSize >> level, ivec2(1));
+	ivec2 t0 = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+	ivec2 t1 = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+	float furthest = max(max(texelFetch(hiZ, t0, level).r, texelFetch(hiZ, ivec2(t1.x, t0.y), level).r),
+						 max(texelFetch(hiZ, ivec2(t0.x, t1.y), level).r, texelFetch(hiZ, t1, level).r));
+	return minNDC.z * 0.5 + 0.5 > furthest;
+}
+
+void main(void)
+{
+	uint c = gl_GlobalInvocationID.x;
+	if (c >= uint(commandCount)) {
+		return;
+	}
+	DrawCommand command = sourceCommands[c];
+	vec4 bounds = objects[command.baseInstance].bounds;
+
+	//Only one of an object's LODs is ever in range
+	vec2 lodRange		= commandLODs[c];
+	float screenSize	= bounds.w * lodScale / max(distance(cameraPos, bounds.xyz), 0.0001);
+	bool visible		= screenSize >= lodRange.x && screenSize < lodRange.y;
+	for (int p = 0; p < 6; ++p) {
+		if (dot(frustumPlanes[p].xyz, bounds.xyz) + frustumPlanes[p].w < -bounds.w) {
+			visible = false;
+		}
+	}
+	if (visible && useHiZ && IsOccluded(bounds)) {
+		visible = false;
+	}
+	command.instanceCount = visible ? 1u : 0u;
+	culledCommands[c] = command;
+}
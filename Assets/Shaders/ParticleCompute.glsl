@@ -0,0 +1,129 @@
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+struct Particle {
+	vec4 position;	//w is how long it has left
+	vec4 velocity;	//w is its size
+	vec4 colour;
+	vec4 life;		//how long it lived for to start with, then how much gravity pulls it
+};
+
+struct Burst {
+	vec4 position;	//w is the first of the frame's new particles that's from it
+	vec4 direction;	//w is how far they spread from it
+	vec4 colour;
+	vec4 motion;	//speed, size, lifetime, then how many
+};
+
+layout(std430, binding = 11) readonly buffer Source		{ Particle sourceParticles[]; };
+layout(std430, binding = 12) buffer State {
+	uint counts[2];
+	uint dispatch[3];
+	uint drawCount;
+	uint drawInstances;
+	uint drawFirst;
+	uint drawBaseInstance;
+};
+layout(std430, binding = 13) writeonly buffer Dest		{ Particle destParticles[]; };
+layout(std430, binding = 14) readonly buffer Bursts		{ Burst bursts[]; };
+
+const uint	Capacity	= 65536;
+const float	Gravity		= 9.8;
+const float	Drag		= 0.6; //of its speed lost every second
+
+uniform int		stage		= 0;	//update, emit, then finish
+uniform float	dt			= 0.0;
+uniform int		source		= 0;	//which of the counts is for the source buffer
+uniform int		emitCount	= 0;
+uniform int		burstCount	= 0;
+uniform uint	seed		= 0u;
+
+float Random(inout uint state) {
+	state = state * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return float((word >> 22u) ^ word) / 4294967295.0;
+}
+
+vec3 RandomDirection(inout uint state) {
+	float z = Random(state) * 2.0 - 1.0;
+	float a = Random(state) * 6.2831853;
+	float r = sqrt(max(1.0 - z * z, 0.0));
+	return vec3(r * cos(a), r * sin(a), z);
+}
+
+void Append(Particle p) {
+	uint index = atomicAdd(counts[1 - source], 1u);
+	if (index < Capacity) {
+		destParticles[index] = p;
+	}
+}
+
+//Moves it, and copies it over if it's still alive, so the living stay together
+void UpdateParticle(uint i) {
+	if (i >= min(counts[source], Capacity)) {
+		return;
+	}
+	Particle p = sourceParticles[i];
+	p.position.w -= dt;
+	if (p.position.w <= 0.0) {
+		return;
+	}
+	p.velocity.y	-= Gravity * p.life.y * dt;
+	p.velocity.xyz	*= max(1.0 - Drag * dt, 0.0);
+	p.position.xyz	+= p.velocity.xyz * dt;
+	Append(p);
+}
+
+void EmitParticle(uint i) {
+	if (i >= uint(emitCount)) {
+		return;
+	}
+	//There are only ever a few bursts a frame, so looking through them is cheap
+	int b = 0;
+	while (b + 1 < burstCount && float(i) >= bursts[b + 1].position.w) {
+		b++;
+	}
+	Burst burst = bursts[b];
+	uint state	= i * 9781u + seed * 6271u;
+
+	vec3 dir = burst.direction.xyz;
+	dir = length(dir) > 0.0001 ? normalize(dir) : vec3(0, 1, 0);
+	dir = normalize(mix(dir, RandomDirection(state), burst.direction.w));
+
+	Particle p;
+	float lifetime	= burst.motion.z * (0.5 + 0.5 * Random(state));
+	p.position		= vec4(burst.position.xyz, lifetime);
+	p.velocity		= vec4(dir * burst.motion.x * (0.5 + 0.5 * Random(state)), burst.motion.y * (0.5 + Random(state)));
+	p.colour		= burst.colour;
+	p.life			= vec4(lifetime, 0.5 + Random(state), 0, 0);
+	Append(p);
+}
+
+//Left in the state for the next update's dispatch and this frame's draw
+void Finish() {
+	uint alive			= min(counts[1 - source], Capacity);
+	counts[1 - source]	= alive;
+	counts[source]		= 0u;
+	dispatch[0]			= (alive + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+	dispatch[1]			= 1u;
+	dispatch[2]			= 1u;
+	drawCount			= 4u;
+	drawInstances		= alive;
+	drawFirst			= 0u;
+	drawBaseInstance	= 0u;
+}
+
+void main(void)
+{
+	uint i = gl_GlobalInvocationID.x;
+	if (stage == 0) {
+		UpdateParticle(i);
+	}
+	else if (stage == 1) {
+		EmitParticle(i);
+	}
+	else if (i == 0u) {
+		Finish();
+	}
+}
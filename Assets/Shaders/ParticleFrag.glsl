@@ -0,0 +1,18 @@
+#version 430 core
+
+in Vertex
+{
+	vec4 colour;
+	vec2 corner;
+} IN;
+
+out vec4 fragColor;
+
+void main(void)
+{
+	float d = dot(IN.corner, IN.corner);
+	if (d > 1.0) {
+		discard;
+	}
+	fragColor = vec4(IN.colour.rgb, IN.colour.a * (1.0 - d * d));
+}
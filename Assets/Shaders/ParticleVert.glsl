@@ -0,0 +1,44 @@
+#version 430 core
+
+layout(std140) uniform FrameData {
+	mat4 projMatrix;
+	mat4 viewMatrix;
+	mat4 shadowMatrix;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColour;
+	float lightRadius;
+} frame;
+
+struct Particle {
+	vec4 position;	//w is how long it has left
+	vec4 velocity;	//w is its size
+	vec4 colour;
+	vec4 life;		//how long it lived for to start with, then how much gravity pulls it
+};
+
+layout(std430, binding = 11) readonly buffer Particles { Particle particles[]; };
+
+out Vertex
+{
+	vec4 colour;
+	vec2 corner;
+} OUT;
+
+//One instance per particle, with the 4 corners of its quad made from the vertex ID
+void main(void)
+{
+	Particle p	= particles[gl_InstanceID];
+	vec2 corner	= vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+
+	//Grows in over the first bit of its life, and shrinks away at the end
+	float age	= 1.0 - p.position.w / max(p.life.x, 0.0001);
+	float scale	= min(age * 8.0, 1.0) * (1.0 - age * age);
+
+	vec4 viewPos	= frame.viewMatrix * vec4(p.position.xyz, 1.0);
+	viewPos.xy		+= corner * p.velocity.w * scale;
+	gl_Position		= frame.projMatrix * viewPos;
+
+	OUT.colour	= p.colour;
+	OUT.corner	= corner;
+}
@@ -0,0 +1,45 @@
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+//Positions and normals are tightly packed vec3s, which std430 can't do, so they're read as floats
+layout(std430, binding = 0) readonly buffer Positions	{ float positions[]; };
+layout(std430, binding = 1) readonly buffer Normals		{ float normals[]; };
+layout(std430, binding = 2) readonly buffer Weights		{ vec4 weights[]; };
+layout(std430, binding = 3) readonly buffer Indices		{ vec4 indices[]; };
+layout(std430, binding = 4) readonly buffer Palette		{ mat4 joints[]; };
+
+layout(std430, binding = 5) writeonly buffer SkinnedPositions	{ float skinnedPositions[]; };
+layout(std430, binding = 6) writeonly buffer SkinnedNormals		{ float skinnedNormals[]; };
+
+uniform int		vertexCount	= 0;
+uniform int		jointOffset	= 0;	//where this mesh's joints start in the palette
+uniform bool	hasNormals	= false;
+
+void main(void)
+{
+	uint v = gl_GlobalInvocationID.x;
+	if (v >= uint(vertexCount)) {
+		return;
+	}
+	vec4	weight	= weights[v];
+	ivec4	index	= ivec4(indices[v]) + jointOffset;
+
+	mat4 skin	= joints[index.x] * weight.x
+				+ joints[index.y] * weight.y
+				+ joints[index.z] * weight.z
+				+ joints[index.w] * weight.w;
+
+	uint i = v * 3;
+	vec3 position = (skin * vec4(positions[i], positions[i + 1], positions[i + 2], 1.0)).xyz;
+	skinnedPositions[i]		= position.x;
+	skinnedPositions[i + 1]	= position.y;
+	skinnedPositions[i + 2]	= position.z;
+
+	if (hasNormals) {
+		vec3 normal = normalize(mat3(skin) * vec3(normals[i], normals[i + 1], normals[i + 2]));
+		skinnedNormals[i]		= normal.x;
+		skinnedNormals[i + 1]	= normal.y;
+		skinnedNormals[i + 2]	= normal.z;
+	}
+}
@@ -0,0 +1,58 @@
+#version 450
+//Compiled to GameTechVK.frag.spv with glslangValidator -V
+
+layout(set = 0, binding = 0) uniform FrameData {
+	mat4 viewProjMatrix;
+	vec4 cameraPos;
+	vec4 lightPos; //radius in w
+	vec4 lightColour;
+} frame;
+
+layout(push_constant) uniform ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	int  hasTexture;
+} object;
+
+layout(set = 1, binding = 0) uniform sampler2D mainTex;
+
+layout(location = 0) in Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+	vec3 normal;
+	vec3 worldPos;
+} IN;
+
+layout(location = 0) out vec4 fragColor;
+
+//GameTechFrag's lighting, without the shadow map
+void main(void)
+{
+	vec3  incident	= normalize(frame.lightPos.xyz - IN.worldPos);
+	float lambert	= max(0.0, dot(incident, IN.normal)) * 0.9;
+
+	vec3 viewDir	= normalize(frame.cameraPos.xyz - IN.worldPos);
+	vec3 halfDir	= normalize(incident + viewDir);
+
+	float rFactor	= max(0.0, dot(halfDir, IN.normal));
+	float sFactor	= pow(rFactor, 80.0);
+
+	vec4 albedo = IN.colour;
+
+	if(object.hasTexture != 0) {
+		albedo *= texture(mainTex, IN.texCoord);
+	}
+
+	albedo.rgb = pow(albedo.rgb, vec3(2.2));
+
+	fragColor.rgb = albedo.rgb * 0.05; //ambient
+
+	fragColor.rgb += albedo.rgb * frame.lightColour.rgb * lambert; //diffuse light
+
+	fragColor.rgb += frame.lightColour.rgb * sFactor; //specular light
+
+	fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / 2.2));
+
+	fragColor.a = albedo.a;
+}
@@ -0,0 +1,41 @@
+#version 450
+//Compiled to GameTechVK.vert.spv with glslangValidator -V
+
+layout(set = 0, binding = 0) uniform FrameData {
+	mat4 viewProjMatrix;
+	vec4 cameraPos;
+	vec4 lightPos; //radius in w
+	vec4 lightColour;
+} frame;
+
+layout(push_constant) uniform ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	int  hasTexture;
+} object;
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in vec3 normal;
+
+layout(location = 0) out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+	vec3 normal;
+	vec3 worldPos;
+} OUT;
+
+void main(void)
+{
+	mat3 normalMatrix	= transpose(inverse(mat3(object.modelMatrix)));
+	vec4 worldPos		= object.modelMatrix * vec4(position, 1.0);
+
+	OUT.worldPos	= worldPos.xyz;
+	OUT.normal		= normalize(normalMatrix * normalize(normal));
+	OUT.texCoord	= texCoord;
+	OUT.colour		= object.colour;
+
+	gl_Position		= frame.viewProjMatrix * worldPos;
+	gl_Position.z	= (gl_Position.z + gl_Position.w) * 0.5; //the camera's matrices are built for GL's -1 to 1 depth
+}
@@ -0,0 +1,29 @@
+#version 400 core
+
+uniform sampler2D mainTex;
+uniform int useTexture;
+uniform float edgeValue = 0.5;
+
+in Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+} IN;
+
+out vec4 fragColor;
+
+//The texture's a distance from each glyph's edge, smoothed over about a pixel whatever size it's drawn at
+void main(void)
+{
+	if(useTexture == 0) {
+		fragColor = IN.colour;
+		return;
+	}
+	float distance	= texture(mainTex, IN.texCoord).r;
+	float width		= fwidth(distance) * 0.75;
+	float alpha		= smoothstep(edgeValue - width, edgeValue + width, distance);
+	if(alpha < 0.00001) {
+		discard;
+	}
+	fragColor = IN.colour * vec4(1, 1, 1, alpha);
+}
@@ -0,0 +1,22 @@
+#version 430 core
+
+uniform mat4 viewProjMatrix = mat4(1);
+uniform float currentTime = 0.0;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 colour;
+layout(location = 8) in float expiresAt;
+
+out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+} OUT;
+
+void main(void)
+{
+	//Expired lines are moved past the far plane, where they're clipped away
+	gl_Position		= expiresAt < currentTime ? vec4(0, 0, 2, 1) : viewProjMatrix * vec4(position, 1.0);
+	OUT.colour		= colour;
+	OUT.texCoord	= vec2(0, 0);
+}
@@ -0,0 +1,21 @@
+#version 430 core
+
+uniform mat4 viewProjMatrix = mat4(1);
+
+layout(location = 0) in vec3 position;
+
+layout(location = 8) in mat4 instanceModel; //takes up 8 to 11
+layout(location = 12) in vec4 instanceColour;
+
+out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+} OUT;
+
+void main(void)
+{
+	gl_Position		= viewProjMatrix * instanceModel * vec4(position, 1.0);
+	OUT.colour		= instanceColour;
+	OUT.texCoord	= vec2(0, 0);
+}
@@ -0,0 +1,20 @@
+#version 400 core
+
+uniform mat4 projMatrix = mat4(1);
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 colour;
+layout(location = 2) in vec2 texCoord;
+
+out Vertex
+{
+	vec4 colour;
+	vec2 texCoord;
+} OUT;
+
+void main(void)
+{
+	gl_Position		= projMatrix * vec4(position, 0.0, 1.0);
+	OUT.colour		= colour;
+	OUT.texCoord	= texCoord;
+}
@@ -0,0 +1,9 @@
+#include "AllocationCounter.h"
+#include "../../Common/MemoryTracker.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+unsigned int AllocationCounter::GetCount() {
+	return MemoryTracker::GetThreadAllocationCount();
+}
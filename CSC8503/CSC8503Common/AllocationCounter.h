@@ -0,0 +1,15 @@
+#pragma once
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		How many times the calling thread has allocated, for the benchmarks,
+		as counted by the MemoryTracker's operator new. Take the count either
+		side of whatever's being measured.
+		*/
+		class AllocationCounter {
+		public:
+			static unsigned int GetCount();
+		};
+	}
+}
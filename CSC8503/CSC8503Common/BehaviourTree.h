@@ -0,0 +1,180 @@
+#pragma once
+#include "BehaviourNode.h"
+#include "JobSystem.h"
+#include <vector>
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		//What each agent running a BehaviourTree needs of its own
+		struct BehaviourTreeState {
+			std::vector<unsigned char>	nodeStates;		//a BehaviourState for every node
+			int							runningNode = -1; //the action that was last Ongoing
+		};
+
+		/*
+		The same sequences, selectors and actions as the BehaviourNode classes,
+		but as one tree shared by every agent of type T that runs it, with
+		each agent only having a BehaviourTreeState of its own. Once Build has
+		been called, the nodes are all in one array, each followed by its
+		children and then the rest of its parent's, so running the tree is a
+		walk forwards through it rather than a chase through pointers to
+		nodes all over the heap. Names are only kept once, for debugging.
+
+		Actions are given the agent, so they're the agent's blackboard, and
+		are plain functions, which a lambda that doesn't capture anything can
+		be. TickAll runs the tree for a whole set of agents at once, spread
+		across the job system if asked to, in which case actions mustn't touch
+		anything but their own agent.
+		*/
+		template<class T>
+		class BehaviourTree {
+		public:
+			typedef BehaviourState (*ActionFunction)(T& agent, float dt, BehaviourState state);
+
+			//Nodes are added under a parent, other than the first, which is the
+			//root, and return an index for their children to be added under
+			int AddSequence(const std::string& name, int parent = -1) {
+				return AddNode(name, NodeType::Sequence, nullptr, parent);
+			}
+			int AddSelector(const std::string& name, int parent = -1) {
+				return AddNode(name, NodeType::Selector, nullptr, parent);
+			}
+			int AddAction(const std::string& name, ActionFunction func, int parent = -1) {
+				return AddNode(name, NodeType::Action, func, parent);
+			}
+
+			//Lays the nodes out in the order they run in - nothing can be added after this
+			void Build() {
+				nodes.clear();
+				names.clear();
+				if (!building.empty()) {
+					Flatten(0);
+				}
+				building.clear();
+			}
+
+			void Reset(BehaviourTreeState& s) const {
+				s.nodeStates.assign(nodes.size(), (unsigned char)Initialise);
+				s.runningNode = -1;
+			}
+
+			BehaviourState Tick(T& agent, BehaviourTreeState& s, float dt) const {
+				if (nodes.empty()) {
+					return Failure;
+				}
+				if (s.nodeStates.size() != nodes.size()) {
+					Reset(s);
+				}
+				s.runningNode = -1;
+				return Execute(0, agent, s, dt);
+			}
+
+			//agents[i] runs with states[i]
+			void TickAll(T** agents, BehaviourTreeState* states, int count, float dt, bool parallel = true) const {
+				JobSystem* jobs = parallel ? JobSystem::GetJobSystem() : nullptr;
+				if (!jobs || count < 2) {
+					for (int i = 0; i < count; ++i) {
+						Tick(*agents[i], states[i], dt);
+					}
+					return;
+				}
+				jobs->ParallelFor(count, 1,
+					[&](int first, int last, int workerIndex) {
+						for (int i = first; i < last; ++i) {
+							Tick(*agents[i], states[i], dt);
+						}
+					}
+				);
+			}
+
+			int GetNodeCount() const {
+				return (int)nodes.size();
+			}
+			const std::string& GetNodeName(int node) const {
+				return names[node];
+			}
+
+		protected:
+			enum class NodeType : unsigned char {
+				Sequence,
+				Selector,
+				Action
+			};
+
+			struct Node {
+				NodeType		type;
+				int				end;	//one past the last node under this one
+				ActionFunction	func;
+			};
+
+			struct BuildNode {
+				std::string			name;
+				NodeType			type;
+				ActionFunction		func;
+				std::vector<int>	children;
+			};
+
+			int AddNode(const std::string& name, NodeType type, ActionFunction func, int parent) {
+				BuildNode n;
+				n.name				= name;
+				n.type				= type;
+				n.func				= func;
+				int index			= (int)building.size();
+				building.emplace_back(n);
+				if (parent >= 0) {
+					building[parent].children.emplace_back(index);
+				}
+				return index;
+			}
+
+			void Flatten(int buildIndex) {
+				const BuildNode& b = building[buildIndex];
+				int index = (int)nodes.size();
+				nodes.push_back({ b.type, 0, b.func });
+				names.emplace_back(b.name);
+				for (int child : b.children) {
+					Flatten(child);
+				}
+				nodes[index].end = (int)nodes.size();
+			}
+
+			BehaviourState Execute(int index, T& agent, BehaviourTreeState& s, float dt) const {
+				const Node& n = nodes[index];
+				BehaviourState state = Failure;
+				switch (n.type) {
+					case NodeType::Action: {
+						state = n.func(agent, dt, (BehaviourState)s.nodeStates[index]);
+						if (state == Ongoing) {
+							s.runningNode = index;
+						}
+					}break;
+					case NodeType::Sequence: {
+						state = Success;
+						for (int child = index + 1; child < n.end; child = nodes[child].end) {
+							state = Execute(child, agent, s, dt);
+							if (state != Success) {
+								break;
+							}
+						}
+					}break;
+					case NodeType::Selector: {
+						state = Failure;
+						for (int child = index + 1; child < n.end; child = nodes[child].end) {
+							state = Execute(child, agent, s, dt);
+							if (state != Failure) {
+								break;
+							}
+						}
+					}break;
+				}
+				s.nodeStates[index] = (unsigned char)state;
+				return state;
+			}
+
+			std::vector<Node>			nodes;
+			std::vector<std::string>	names;
+			std::vector<BuildNode>		building;
+		};
+	}
+}
@@ -0,0 +1,96 @@
+#include "BitStream.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+BitWriter::BitWriter(uint8_t* buffer, int capacityBytes) {
+	this->buffer	= buffer;
+	capacityBits	= capacityBytes * 8;
+	bitCount		= 0;
+	overflowed		= false;
+}
+
+void BitWriter::WriteBits(uint32_t value, int bits) {
+	if (bitCount + bits > capacityBits) {
+		overflowed = true;
+		return;
+	}
+	//Fills up the current byte, then carries on into the next one
+	while (bits > 0) {
+		int byte	= bitCount >> 3;
+		int offset	= bitCount & 7;
+		int count	= 8 - offset < bits ? 8 - offset : bits;
+
+		uint8_t chunk = (uint8_t)((value & ((1u << count) - 1)) << offset);
+		buffer[byte] = offset == 0 ? chunk : (uint8_t)(buffer[byte] | chunk);
+
+		value >>= count;
+		bits		-= count;
+		bitCount	+= count;
+	}
+}
+
+void BitWriter::WriteVarInt(uint32_t value) {
+	do {
+		uint32_t group = value & 0x7F;
+		value >>= 7;
+		WriteBits(group | (value ? 0x80 : 0), 8);
+	} while (value && !overflowed);
+}
+
+//Zigzag encoded, so that small negative numbers stay small
+void BitWriter::WriteSignedVarInt(int32_t value) {
+	WriteVarInt(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+BitReader::BitReader(const uint8_t* buffer, int sizeBytes) {
+	this->buffer	= buffer;
+	sizeBits		= sizeBytes * 8;
+	bitCount		= 0;
+	overflowed		= false;
+}
+
+uint32_t BitReader::ReadBits(int bits) {
+	if (bitCount + bits > sizeBits) {
+		overflowed = true;
+		return 0;
+	}
+	uint32_t value	= 0;
+	int shift		= 0;
+	while (bits > 0) {
+		int byte	= bitCount >> 3;
+		int offset	= bitCount & 7;
+		int count	= 8 - offset < bits ? 8 - offset : bits;
+
+		uint32_t chunk = (buffer[byte] >> offset) & ((1u << count) - 1);
+		value |= chunk << shift;
+
+		shift		+= count;
+		bits		-= count;
+		bitCount	+= count;
+	}
+	return value;
+}
+
+uint32_t BitReader::ReadVarInt() {
+	uint32_t value	= 0;
+	int shift		= 0;
+	while (shift < 35) {
+		uint32_t group = ReadBits(8);
+		if (overflowed) {
+			return 0;
+		}
+		value |= (group & 0x7F) << shift;
+		if (!(group & 0x80)) {
+			return value;
+		}
+		shift += 7;
+	}
+	overflowed = true; //too many groups to be a valid 32 bit value
+	return 0;
+}
+
+int32_t BitReader::ReadSignedVarInt() {
+	uint32_t value = ReadVarInt();
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
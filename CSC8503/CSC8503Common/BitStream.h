@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Writes values into a byte buffer using only as many bits as each one
+		needs, least significant bit first. Running out of room sets a flag
+		rather than writing past the end, so a whole packet can be written
+		and then checked once at the end.
+		*/
+		class BitWriter {
+		public:
+			BitWriter(uint8_t* buffer, int capacityBytes);
+
+			void WriteBits(uint32_t value, int bits);
+
+			void WriteBool(bool value) {
+				WriteBits(value ? 1 : 0, 1);
+			}
+
+			//7 bits at a time, with a bit to say if there's more to come,
+			//so small values (like most IDs) only take a byte
+			void WriteVarInt(uint32_t value);
+			void WriteSignedVarInt(int32_t value);
+
+			int GetByteCount() const {
+				return (bitCount + 7) / 8;
+			}
+
+			bool HasOverflowed() const {
+				return overflowed;
+			}
+
+		protected:
+			uint8_t*	buffer;
+			int			capacityBits;
+			int			bitCount;
+			bool		overflowed;
+		};
+
+		class BitReader {
+		public:
+			BitReader(const uint8_t* buffer, int sizeBytes);
+
+			uint32_t ReadBits(int bits);
+
+			bool ReadBool() {
+				return ReadBits(1) != 0;
+			}
+
+			uint32_t ReadVarInt();
+			int32_t ReadSignedVarInt();
+
+			//Set if anything tried to read past the end, in which case
+			//whatever was read should be thrown away
+			bool HasOverflowed() const {
+				return overflowed;
+			}
+
+		protected:
+			const uint8_t*	buffer;
+			int				sizeBits;
+			int				bitCount;
+			bool			overflowed;
+		};
+	}
+}
@@ -0,0 +1,168 @@
+#include "CharacterController.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "CollisionDetection.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+CharacterController::CharacterController(GameWorld& world) : world(world) {
+	stepHeight		= 0.6f;
+	snapDistance	= 0.3f;
+	minGroundNormal = 0.7f;
+	skinWidth		= 0.01f;
+	maxIterations	= 4;
+}
+
+/*
+The normal move is always tried first. Only if it was stopped by a wall
+while on the ground is the stepped version tried as well - up by the step
+height, across, and back down again - and that's only kept if it got
+further, and ended up on something to stand on.
+*/
+void CharacterController::Move(GameObject& body, Vector3& velocity, float dt) {
+	PhysicsObject* physics = body.GetPhysicsObject();
+	Transform& transform = body.GetTransform();
+
+	Vector3 halfSizes;
+	if (!body.GetBroadphaseAABB(halfSizes)) {
+		transform.SetPosition(transform.GetPosition() + velocity * dt);
+		return;
+	}
+	float stepLength	= (halfSizes.x < halfSizes.z ? halfSizes.x : halfSizes.z);
+	stepLength			= stepLength > 0.05f ? stepLength : 0.05f;
+
+	bool	wasGrounded = physics->IsGrounded();
+	Vector3 start		= transform.GetPosition();
+	Vector3 motion		= velocity * dt;
+
+	MoveResult result;
+	Vector3 slideVelocity = velocity;
+	SlideMove(body, motion, slideVelocity, stepLength, result);
+
+	Vector3 horizontal(motion.x, 0, motion.z);
+	if (wasGrounded && result.hitWall && stepHeight > 0.0f && horizontal.LengthSquared() > 0.0f) {
+		Vector3 slideEnd = transform.GetPosition();
+		transform.SetPosition(start);
+
+		MoveResult stepped;
+		Vector3 stepVelocity = velocity;
+		SlideMove(body, Vector3(0, stepHeight, 0), stepVelocity, stepLength, stepped);
+		stepped = MoveResult();
+		SlideMove(body, horizontal, stepVelocity, stepLength, stepped);
+		float climbed = transform.GetPosition().y - start.y;
+		SlideMove(body, Vector3(0, -(climbed + snapDistance), 0), stepVelocity, stepLength, stepped);
+
+		Vector3 slid	= slideEnd - start;
+		Vector3 step	= transform.GetPosition() - start;
+		float slidSq	= slid.x * slid.x + slid.z * slid.z;
+		float stepSq	= step.x * step.x + step.z * step.z;
+		if (stepped.grounded && stepSq > slidSq) {
+			result			= stepped;
+			slideVelocity	= stepVelocity;
+		}
+		else {
+			transform.SetPosition(slideEnd);
+		}
+	}
+
+	if (wasGrounded && !result.grounded && velocity.y <= 0.0f && snapDistance > 0.0f) {
+		Vector3 beforeSnap = transform.GetPosition();
+		MoveResult snapped;
+		Vector3 snapVelocity = slideVelocity;
+		SlideMove(body, Vector3(0, -snapDistance, 0), snapVelocity, stepLength, snapped);
+		if (snapped.grounded) {
+			result.grounded = true;
+		}
+		else {
+			transform.SetPosition(beforeSnap);
+		}
+	}
+
+	if (result.grounded && slideVelocity.y < 0.0f) {
+		slideVelocity.y = 0.0f;
+	}
+	velocity = slideVelocity;
+	physics->SetGrounded(result.grounded);
+}
+
+void CharacterController::SlideMove(GameObject& body, const Vector3& motion, Vector3& velocity, float stepLength, MoveResult& result) {
+	Transform& transform = body.GetTransform();
+
+	float length	= motion.Length();
+	int steps		= (int)ceilf(length / stepLength);
+	steps			= steps > 1 ? steps : 1;
+
+	Vector3 remaining = motion;
+	for (int i = 0; i < steps; ++i) {
+		Vector3 step = remaining / (float)(steps - i);
+		transform.SetPosition(transform.GetPosition() + step);
+		remaining = remaining - step;
+
+		Depenetrate(body, velocity, remaining, result);
+	}
+}
+
+/*
+Each pass pushes the body straight back out of everything it overlaps, by
+all but the skin width. The tests are the same ones the narrowphase uses,
+so the two agree on what's touching. The direction out of each surface
+decides whether it's ground to stand on, or a wall to slide along.
+*/
+void CharacterController::Depenetrate(GameObject& body, Vector3& velocity, Vector3& remaining, MoveResult& result) {
+	Transform& transform = body.GetTransform();
+	Octree<GameObject*>* staticTree = world.GetStaticTree();
+	if (!staticTree) {
+		return;
+	}
+	Vector3 halfSizes;
+	body.GetBroadphaseAABB(halfSizes);
+	Vector3 margin(skinWidth * 2.0f, skinWidth * 2.0f, skinWidth * 2.0f);
+
+	for (int pass = 0; pass < maxIterations; ++pass) {
+		Vector3 centre = GJKShape::FromVolume(*body.GetBoundingVolume(), transform).centre;
+		nearby.clear();
+		staticTree->GetCollidingObjects(centre, halfSizes + margin, nearby);
+
+		bool moved = false;
+		for (GameObject* other : nearby) {
+			if (other == &body || other->IsTrigger() || !other->IsActive() || !world.CollisionAllowed(body.GetLayer(), other->GetLayer())) {
+				continue;
+			}
+			CollisionDetection::CollisionInfo info;
+			if (!CollisionDetection::ObjectIntersection(&body, other, info)) {
+				continue;
+			}
+			//The normal points from a to b, and the test may have swapped them round
+			Vector3 out = info.a == &body ? -info.point.normal : info.point.normal;
+
+			if (out.y >= minGroundNormal) {
+				result.grounded = true;
+			}
+			else if (out.y > -minGroundNormal) {
+				result.hitWall = true;
+			}
+			float depth = info.point.penetration - skinWidth;
+			if (depth <= 0.0f) {
+				continue;
+			}
+			transform.SetPosition(transform.GetPosition() + out * depth);
+			moved = true;
+
+			//Neither the body nor the rest of its move should go back into the surface
+			float into = Vector3::Dot(velocity, out);
+			if (into < 0.0f) {
+				velocity = velocity - out * into;
+			}
+			into = Vector3::Dot(remaining, out);
+			if (into < 0.0f) {
+				remaining = remaining - out * into;
+			}
+		}
+		if (!moved) {
+			break;
+		}
+	}
+}
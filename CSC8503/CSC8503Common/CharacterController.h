@@ -0,0 +1,66 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameWorld;
+		class GameObject;
+
+		/*
+		Moves kinematic bodies (the player and agent capsules) through the
+		static world, instead of leaving them to the contact solver. The move
+		is split into steps no longer than half the body's width, so it can't
+		pass through anything, and after each step the body is pushed back
+		out of any static geometry it ends up in, with its velocity into that
+		surface taken away, so it slides along walls and stands on floors.
+
+		A body that was on the ground and walks into something low enough is
+		lifted up onto it, rather than stopped, and one walking down a slope
+		or off a small ledge is snapped back down, rather than being left to
+		bounce down it. Everything here is plain arithmetic on the body's own
+		state, so the same inputs always give the same move.
+		*/
+		class CharacterController {
+		public:
+			CharacterController(GameWorld& world);
+			~CharacterController() {}
+
+			//velocity is updated to match whatever the body ran into
+			void Move(GameObject& body, Vector3& velocity, float dt);
+
+			void SetStepHeight(float h) {
+				stepHeight = h;
+			}
+
+			void SetSnapDistance(float d) {
+				snapDistance = d;
+			}
+
+			//Surfaces facing further up than this count as ground (0 to 1, as a cosine)
+			void SetMinGroundNormal(float y) {
+				minGroundNormal = y;
+			}
+
+		protected:
+			struct MoveResult {
+				bool grounded	= false;
+				bool hitWall	= false;
+			};
+
+			void SlideMove(GameObject& body, const Vector3& motion, Vector3& velocity, float stepLength, MoveResult& result);
+			void Depenetrate(GameObject& body, Vector3& velocity, Vector3& remaining, MoveResult& result);
+
+			GameWorld& world;
+
+			float stepHeight;
+			float snapDistance;
+			float minGroundNormal;
+			float skinWidth;		//left overlapping the ground, so it still counts as a contact
+			int   maxIterations;	//depenetration passes per step
+
+			std::vector<GameObject*> nearby; //reused by every static tree query
+		};
+	}
+}
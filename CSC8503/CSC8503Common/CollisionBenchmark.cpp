@@ -0,0 +1,456 @@
+#include "CollisionBenchmark.h"
+#include "../../Common/Matrix3.h"
+#include "../../Common/Maths.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float CollisionBenchmark::Tolerance = 0.001f;
+
+//Penetrations come from GJK and EPA for some pairs, which only get so close
+static const float DepthTolerance = 0.01f;
+
+/*
+The references. Each is the simplest way of getting the answer that can be
+seen to be right, with no concern for speed - distances to boxes are found
+in the box's own space, and distances along segments, which are always
+convex, by ternary search rather than any closed form.
+*/
+namespace {
+	typedef CollisionBenchmark::Case		Case;
+	typedef CollisionBenchmark::Answer		Answer;
+	typedef CollisionBenchmark::Reference	Reference;
+
+	Vector3 ToLocal(const Transform& t, const Vector3& p) {
+		return Matrix3(t.GetOrientation().Conjugate()) * (p - t.GetPosition());
+	}
+
+	float PointBoxDistance(const Vector3& local, const Vector3& half) {
+		return (local - Maths::Clamp(local, -half, half)).Length();
+	}
+
+	bool PointInBox(const Vector3& local, const Vector3& half) {
+		return fabs(local.x) <= half.x && fabs(local.y) <= half.y && fabs(local.z) <= half.z;
+	}
+
+	float PointSegmentDistance(const Vector3& p, const Vector3& a, const Vector3& b) {
+		Vector3 ab		= b - a;
+		float lengthSq	= Vector3::Dot(ab, ab);
+		float t			= lengthSq > 0.0f ? Vector3::Dot(p - a, ab) / lengthSq : 0.0f;
+		t				= t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		return (p - (a + ab * t)).Length();
+	}
+
+	template<class F>
+	float ConvexMinimum(F f, float lo, float hi, float* at = nullptr) {
+		for (int i = 0; i < 100; ++i) {
+			float m1 = lo + (hi - lo) / 3.0f;
+			float m2 = hi - (hi - lo) / 3.0f;
+			if (f(m1) < f(m2)) {
+				hi = m2;
+			}
+			else {
+				lo = m1;
+			}
+		}
+		if (at) {
+			*at = (lo + hi) * 0.5f;
+		}
+		return f((lo + hi) * 0.5f);
+	}
+
+	void CapsuleSegment(const CapsuleVolume& c, const Transform& t, Vector3& bottom, Vector3& top) {
+		Vector3 extent	= t.GetOrientation() * Vector3(0, 1, 0) * (c.GetHalfHeight() - c.GetRadius());
+		top				= t.GetPosition() + extent;
+		bottom			= t.GetPosition() - extent;
+	}
+
+	float SegmentBoxDistance(const Vector3& a, const Vector3& b, const Vector3& half) {
+		return ConvexMinimum([&](float t) { return PointBoxDistance(a + (b - a) * t, half); }, 0.0f, 1.0f);
+	}
+
+	float SegmentSegmentDistance(const Vector3& a0, const Vector3& a1, const Vector3& b0, const Vector3& b1) {
+		return ConvexMinimum([&](float s) { return PointSegmentDistance(a0 + (a1 - a0) * s, b0, b1); }, 0.0f, 1.0f);
+	}
+
+	Reference Separation(float separation, float depth = -1.0f) {
+		return Reference{ separation, false, false, depth };
+	}
+
+	//Every face normal and every pair of edges, each either separating the
+	//boxes or not, with the furthest apart taken
+	float OBBSeparation(const Transform& ta, const Vector3& halfA, const Transform& tb, const Vector3& halfB) {
+		Vector3 axesA[3];
+		Vector3 axesB[3];
+		for (int i = 0; i < 3; ++i) {
+			Vector3 unit;
+			unit[i]		= 1.0f;
+			axesA[i]	= ta.GetOrientation() * unit;
+			axesB[i]	= tb.GetOrientation() * unit;
+		}
+		std::vector<Vector3> axes(axesA, axesA + 3);
+		axes.insert(axes.end(), axesB, axesB + 3);
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				axes.emplace_back(Vector3::Cross(axesA[i], axesB[j]));
+			}
+		}
+		Vector3 delta		= tb.GetPosition() - ta.GetPosition();
+		float separation	= -FLT_MAX;
+		for (Vector3 axis : axes) {
+			if (axis.Length() < 0.0001f) {
+				continue; //parallel edges, already covered by the faces
+			}
+			axis.Normalise();
+			float ra = 0.0f;
+			float rb = 0.0f;
+			for (int i = 0; i < 3; ++i) {
+				ra += fabs(halfA[i] * Vector3::Dot(axesA[i], axis));
+				rb += fabs(halfB[i] * Vector3::Dot(axesB[i], axis));
+			}
+			float s		= fabs(Vector3::Dot(delta, axis)) - ra - rb;
+			separation	= s > separation ? s : separation;
+		}
+		return separation;
+	}
+
+	Reference AABBReference(const Case& c) {
+		Vector3 delta	= c.b.GetPosition() - c.a.GetPosition();
+		Vector3 halfA	= c.aabbA.GetHalfDimensions();
+		Vector3 halfB	= c.aabbB.GetHalfDimensions();
+		float separation = -FLT_MAX;
+		for (int i = 0; i < 3; ++i) {
+			float s		= fabs(delta[i]) - halfA[i] - halfB[i];
+			separation	= s > separation ? s : separation;
+		}
+		return Separation(separation, -separation);
+	}
+
+	Reference SphereReference(const Case& c) {
+		float distance = (c.b.GetPosition() - c.a.GetPosition()).Length();
+		float separation = distance - c.sphereA.GetRadius() - c.sphereB.GetRadius();
+		return Separation(separation, -separation);
+	}
+
+	Reference SphereBoxReference(const Vector3& local, const Vector3& half, float radius) {
+		if (PointInBox(local, half)) {
+			return Separation(-radius);
+		}
+		float separation = PointBoxDistance(local, half) - radius;
+		return Separation(separation, -separation);
+	}
+
+	Reference AABBSphereReference(const Case& c) {
+		return SphereBoxReference(c.b.GetPosition() - c.a.GetPosition(), c.aabbA.GetHalfDimensions(), c.sphereB.GetRadius());
+	}
+
+	Reference SphereOBBReference(const Case& c) {
+		return SphereBoxReference(ToLocal(c.b, c.a.GetPosition()), c.obbB.GetHalfDimensions(), c.sphereA.GetRadius());
+	}
+
+	Reference OBBReference(const Case& c) {
+		float separation = OBBSeparation(c.a, c.obbA.GetHalfDimensions(), c.b, c.obbB.GetHalfDimensions());
+		return Separation(separation, -separation);
+	}
+
+	Reference CapsuleReference(const Case& c) {
+		Vector3 a0, a1, b0, b1;
+		CapsuleSegment(c.capsuleA, c.a, a0, a1);
+		CapsuleSegment(c.capsuleB, c.b, b0, b1);
+		float separation = SegmentSegmentDistance(a0, a1, b0, b1) - c.capsuleA.GetRadius() - c.capsuleB.GetRadius();
+		return Separation(separation, -separation);
+	}
+
+	Reference SphereCapsuleReference(const Case& c) {
+		Vector3 a0, a1;
+		CapsuleSegment(c.capsuleA, c.a, a0, a1);
+		float separation = PointSegmentDistance(c.b.GetPosition(), a0, a1) - c.capsuleA.GetRadius() - c.sphereB.GetRadius();
+		return Separation(separation, -separation);
+	}
+
+	//Only the depth of shallow contacts is known, where the segment's outside the box
+	Reference CapsuleBoxReference(const Vector3& a0, const Vector3& a1, const Vector3& half, float radius) {
+		float distance = SegmentBoxDistance(a0, a1, half);
+		if (distance <= 0.0f) {
+			return Separation(-radius);
+		}
+		return Separation(distance - radius, radius - distance);
+	}
+
+	Reference CapsuleOBBReference(const Case& c) {
+		Vector3 a0, a1;
+		CapsuleSegment(c.capsuleA, c.a, a0, a1);
+		return CapsuleBoxReference(ToLocal(c.b, a0), ToLocal(c.b, a1), c.obbB.GetHalfDimensions(), c.capsuleA.GetRadius());
+	}
+
+	Reference AABBCapsuleReference(const Case& c) {
+		Vector3 a0, a1;
+		CapsuleSegment(c.capsuleA, c.a, a0, a1);
+		return CapsuleBoxReference(a0 - c.b.GetPosition(), a1 - c.b.GetPosition(), c.aabbB.GetHalfDimensions(), c.capsuleA.GetRadius());
+	}
+
+	//Rays all start outside what they're tested against, so the first hit is where they enter it
+	bool RaySlab(const Vector3& origin, const Vector3& dir, const Vector3& half, float& entry) {
+		float tNear	= -FLT_MAX;
+		float tFar	= FLT_MAX;
+		for (int i = 0; i < 3; ++i) {
+			if (dir[i] == 0.0f) {
+				if (fabs(origin[i]) > half[i]) {
+					return false;
+				}
+				continue;
+			}
+			float t1 = (-half[i] - origin[i]) / dir[i];
+			float t2 = (half[i] - origin[i]) / dir[i];
+			float lo = t1 < t2 ? t1 : t2;
+			float hi = t1 < t2 ? t2 : t1;
+			tNear	= lo > tNear ? lo : tNear;
+			tFar	= hi < tFar ? hi : tFar;
+		}
+		entry = tNear;
+		return tNear <= tFar && tFar >= 0.0f;
+	}
+
+	Reference RayBoxReference(const Vector3& origin, const Vector3& dir, const Vector3& half) {
+		Reference r = { 0.0f, false, false, -1.0f };
+		Vector3 grow(CollisionBenchmark::Tolerance, CollisionBenchmark::Tolerance, CollisionBenchmark::Tolerance);
+		float entry = 0.0f;
+		r.hitGrown	= RaySlab(origin, dir, half + grow, entry);
+		r.hitShrunk	= RaySlab(origin, dir, half - grow, entry);
+		if (RaySlab(origin, dir, half, entry)) {
+			r.depth = entry;
+		}
+		return r;
+	}
+
+	Reference RayAABBReference(const Case& c) {
+		return RayBoxReference(c.ray.GetPosition() - c.a.GetPosition(), c.ray.GetDirection(), c.aabbA.GetHalfDimensions());
+	}
+
+	Reference RayOBBReference(const Case& c) {
+		Matrix3 inv = Matrix3(c.a.GetOrientation().Conjugate());
+		return RayBoxReference(ToLocal(c.a, c.ray.GetPosition()), inv * c.ray.GetDirection(), c.obbA.GetHalfDimensions());
+	}
+
+	bool RaySphere(const Vector3& origin, const Vector3& dir, const Vector3& centre, float radius, float& entry) {
+		Vector3 oc	= origin - centre;
+		float b		= Vector3::Dot(oc, dir);
+		float disc	= b * b - (Vector3::Dot(oc, oc) - radius * radius);
+		if (disc < 0.0f) {
+			return false;
+		}
+		entry = -b - sqrt(disc);
+		return -b + sqrt(disc) >= 0.0f;
+	}
+
+	Reference RaySphereReference(const Case& c) {
+		Reference r = { 0.0f, false, false, -1.0f };
+		float entry		= 0.0f;
+		float radius	= c.sphereA.GetRadius();
+		r.hitGrown	= RaySphere(c.ray.GetPosition(), c.ray.GetDirection(), c.a.GetPosition(), radius + CollisionBenchmark::Tolerance, entry);
+		r.hitShrunk	= RaySphere(c.ray.GetPosition(), c.ray.GetDirection(), c.a.GetPosition(), radius - CollisionBenchmark::Tolerance, entry);
+		if (RaySphere(c.ray.GetPosition(), c.ray.GetDirection(), c.a.GetPosition(), radius, entry)) {
+			r.depth = entry;
+		}
+		return r;
+	}
+
+	//The distance to the capsule's segment only falls and then rises along
+	//the ray, so the way in is found by halving the part before the closest
+	Reference RayCapsuleReference(const Case& c) {
+		Vector3 a0, a1;
+		CapsuleSegment(c.capsuleA, c.a, a0, a1);
+		Vector3 origin	= c.ray.GetPosition();
+		Vector3 dir		= c.ray.GetDirection();
+		auto distance	= [&](float t) { return PointSegmentDistance(origin + dir * t, a0, a1); };
+
+		float closestAt	= 0.0f;
+		float closest	= ConvexMinimum(distance, 0.0f, 100.0f, &closestAt);
+		float radius	= c.capsuleA.GetRadius();
+
+		Reference r = { 0.0f, closest <= radius + CollisionBenchmark::Tolerance, closest <= radius - CollisionBenchmark::Tolerance, -1.0f };
+		if (closest <= radius) {
+			float lo = 0.0f;
+			float hi = closestAt;
+			for (int i = 0; i < 60; ++i) {
+				float mid = (lo + hi) * 0.5f;
+				(distance(mid) > radius ? lo : hi) = mid;
+			}
+			r.depth = hi;
+		}
+		return r;
+	}
+
+	//The routines themselves, as they'd be called by the physics
+	template<class F>
+	Answer Collide(F f) {
+		CollisionDetection::CollisionInfo info;
+		info.separatingAxis = Vector3();
+		bool hit = f(info);
+		return Answer{ hit, hit ? info.point.penetration : 0.0f };
+	}
+
+	Answer RayAnswer(bool hit, const RayCollision& collision) {
+		return Answer{ hit, hit ? collision.rayDistance : 0.0f };
+	}
+}
+
+CollisionBenchmark::CollisionBenchmark(int cases, unsigned int seed) : random(seed) {
+	caseCount = cases;
+}
+
+Vector3 CollisionBenchmark::RandomVector(float range) {
+	std::uniform_real_distribution<float> d(-range, range);
+	return Vector3(d(random), d(random), d(random));
+}
+
+Quaternion CollisionBenchmark::RandomOrientation() {
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	Vector3 axis = RandomVector(1.0f);
+	if (axis.Length() < 0.001f) {
+		return Quaternion();
+	}
+	return Quaternion::AxisAngleToQuaterion(axis.Normalised(), angle(random));
+}
+
+/*
+Sized and spread so that about half the pairs touch. Rays start far enough
+away to be outside anything they're aimed at, and are aimed near it.
+*/
+void CollisionBenchmark::BuildCases() {
+	std::uniform_real_distribution<float> size(0.2f, 1.5f);
+	std::uniform_real_distribution<float> radius(0.2f, 1.2f);
+
+	cases.clear();
+	cases.resize(caseCount);
+	for (Case& c : cases) {
+		c.a.SetPosition(RandomVector(0.5f)).SetOrientation(RandomOrientation());
+		c.b.SetPosition(RandomVector(2.5f)).SetOrientation(RandomOrientation());
+		c.aabbA		= AABBVolume(Vector3(size(random), size(random), size(random)));
+		c.aabbB		= AABBVolume(Vector3(size(random), size(random), size(random)));
+		c.obbA		= OBBVolume(Vector3(size(random), size(random), size(random)));
+		c.obbB		= OBBVolume(Vector3(size(random), size(random), size(random)));
+		c.sphereA	= SphereVolume(radius(random));
+		c.sphereB	= SphereVolume(radius(random));
+		float ra	= radius(random);
+		float rb	= radius(random);
+		c.capsuleA	= CapsuleVolume(ra + size(random), ra);
+		c.capsuleB	= CapsuleVolume(rb + size(random), rb);
+
+		Vector3 from	= RandomVector(1.0f);
+		from			= from.Length() < 0.001f ? Vector3(1, 0, 0) : from.Normalised();
+		Vector3 origin	= c.a.GetPosition() + from * 6.0f;
+		Vector3 target	= c.a.GetPosition() + RandomVector(2.0f);
+		c.ray			= Ray(origin, (target - origin).Normalised());
+	}
+}
+
+CollisionBenchmark::Result CollisionBenchmark::Test(const std::string& name, RoutineFunc routine, ReferenceFunc reference, bool isRay) {
+	typedef std::chrono::steady_clock Clock;
+	Result r;
+	r.name = name;
+
+	std::vector<Answer> answers(cases.size());
+	auto start = Clock::now();
+	for (size_t i = 0; i < cases.size(); ++i) {
+		answers[i] = routine(cases[i]);
+	}
+	r.routineTime = std::chrono::duration<float, std::nano>(Clock::now() - start).count() / (float)cases.size();
+
+	std::vector<Reference> references(cases.size());
+	start = Clock::now();
+	for (size_t i = 0; i < cases.size(); ++i) {
+		references[i] = reference(cases[i]);
+	}
+	r.referenceTime = std::chrono::duration<float, std::nano>(Clock::now() - start).count() / (float)cases.size();
+
+	for (size_t i = 0; i < cases.size(); ++i) {
+		const Reference& ref = references[i];
+		bool ambiguous	= isRay ? ref.hitGrown != ref.hitShrunk : fabs(ref.separation) < Tolerance;
+		if (ambiguous) {
+			r.skipped++;
+			continue;
+		}
+		r.tested++;
+		bool expected = isRay ? ref.hitShrunk : ref.separation < 0.0f;
+		if (answers[i].hit != expected) {
+			r.mismatches++;
+		}
+		else if (expected && ref.depth >= 0.0f && fabs(answers[i].depth - ref.depth) > DepthTolerance * (1.0f + ref.depth)) {
+			r.depthMismatches++;
+		}
+	}
+	return r;
+}
+
+int CollisionBenchmark::RunAll(const std::string& csvFile) {
+	BuildCases();
+	results.clear();
+
+	typedef CollisionDetection CD;
+	results.emplace_back(Test("AABBIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::AABBIntersection(c.aabbA, c.a, c.aabbB, c.b, i); });
+	}, AABBReference, false));
+	results.emplace_back(Test("SphereIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::SphereIntersection(c.sphereA, c.a, c.sphereB, c.b, i); });
+	}, SphereReference, false));
+	results.emplace_back(Test("AABBSphereIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::AABBSphereIntersection(c.aabbA, c.a, c.sphereB, c.b, i); });
+	}, AABBSphereReference, false));
+	results.emplace_back(Test("SphereOBBIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::SphereOBBIntersection(c.sphereA, c.a, c.obbB, c.b, i); });
+	}, SphereOBBReference, false));
+	results.emplace_back(Test("OBBIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::OBBIntersection(c.obbA, c.a, c.obbB, c.b, i); });
+	}, OBBReference, false));
+	results.emplace_back(Test("CapsuleIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::CapsuleIntersection(c.capsuleA, c.a, c.capsuleB, c.b, i); });
+	}, CapsuleReference, false));
+	results.emplace_back(Test("SphereCapsuleIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::SphereCapsuleIntersection(c.capsuleA, c.a, c.sphereB, c.b, i); });
+	}, SphereCapsuleReference, false));
+	results.emplace_back(Test("CapsuleOBBIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::CapsuleOBBIntersection(c.capsuleA, c.a, c.obbB, c.b, i); });
+	}, CapsuleOBBReference, false));
+	results.emplace_back(Test("AABBCapsuleIntersection", [](const Case& c) {
+		return Collide([&](CD::CollisionInfo& i) { return CD::AABBCapsuleIntersection(c.capsuleA, c.a, c.aabbB, c.b, i); });
+	}, AABBCapsuleReference, false));
+	results.emplace_back(Test("RayAABBIntersection", [](const Case& c) {
+		RayCollision collision;
+		return RayAnswer(CD::RayAABBIntersection(c.ray, c.a, c.aabbA, collision), collision);
+	}, RayAABBReference, true));
+	results.emplace_back(Test("RayOBBIntersection", [](const Case& c) {
+		RayCollision collision;
+		return RayAnswer(CD::RayOBBIntersection(c.ray, c.a, c.obbA, collision), collision);
+	}, RayOBBReference, true));
+	results.emplace_back(Test("RaySphereIntersection", [](const Case& c) {
+		RayCollision collision;
+		return RayAnswer(CD::RaySphereIntersection(c.ray, c.a, c.sphereA, collision), collision);
+	}, RaySphereReference, true));
+	results.emplace_back(Test("RayCapsuleIntersection", [](const Case& c) {
+		RayCollision collision;
+		return RayAnswer(CD::RayCapsuleIntersection(c.ray, c.a, c.capsuleA, collision), collision);
+	}, RayCapsuleReference, true));
+
+	std::ofstream csv(csvFile);
+	csv << "routine,tested,skipped,mismatches,depth_mismatches,routine_ns,reference_ns\n";
+	int failing = 0;
+	for (const Result& r : results) {
+		std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(28) << r.name << std::right
+			<< std::setw(8) << r.routineTime << "ns (reference " << r.referenceTime << "ns), "
+			<< r.mismatches << " wrong, " << r.depthMismatches << " wrong depth, of " << r.tested
+			<< " (" << r.skipped << " too close to call)" << std::endl;
+		if (csv) {
+			csv << r.name << "," << r.tested << "," << r.skipped << "," << r.mismatches << "," << r.depthMismatches
+				<< "," << r.routineTime << "," << r.referenceTime << "\n";
+		}
+		failing += (r.mismatches || r.depthMismatches) ? 1 : 0;
+	}
+	return failing;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <string>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Times every CollisionDetection routine on the same random pairs of
+		shapes, and checks each answer against a reference written to be
+		obviously right rather than fast, so a rewrite (SIMD, a new
+		narrowphase) can be shown to give the same results before it's
+		used. References measure how far apart the shapes are, or for rays
+		whether a slightly bigger and a slightly smaller shape would both be
+		hit, and anything too close to call is skipped rather than counted
+		against the routine. Where the reference knows the penetration, or
+		the ray's distance, that's checked too.
+		*/
+		class CollisionBenchmark {
+		public:
+			struct Result {
+				std::string	name;
+				int			tested			= 0;
+				int			skipped			= 0;	//too close to the boundary to say
+				int			mismatches		= 0;	//said they touched when they don't, or the other way
+				int			depthMismatches	= 0;	//right answer, wrong penetration or ray distance
+				float		routineTime		= 0.0f;	//ns per test
+				float		referenceTime	= 0.0f;
+			};
+
+			CollisionBenchmark(int cases = 100000, unsigned int seed = 1);
+
+			//Every routine, printed as they finish, and written out as CSV.
+			//Returns how many of them disagreed with their reference
+			int RunAll(const std::string& csvFile = "CollisionBenchmark.csv");
+
+			const std::vector<Result>& GetResults() const {
+				return results;
+			}
+
+			static const float Tolerance;
+
+			//Two shapes of each kind on the same pair of transforms, or one
+			//shape and a ray from outside it
+			struct Case {
+				Transform		a;
+				Transform		b;
+				AABBVolume		aabbA		= AABBVolume(Vector3(1, 1, 1));
+				AABBVolume		aabbB		= AABBVolume(Vector3(1, 1, 1));
+				OBBVolume		obbA		= OBBVolume(Vector3(1, 1, 1));
+				OBBVolume		obbB		= OBBVolume(Vector3(1, 1, 1));
+				SphereVolume	sphereA;
+				SphereVolume	sphereB;
+				CapsuleVolume	capsuleA	= CapsuleVolume(1, 0.5f);
+				CapsuleVolume	capsuleB	= CapsuleVolume(1, 0.5f);
+				Ray				ray			= Ray(Vector3(), Vector3(0, 0, 1));
+			};
+
+			//What the routine said
+			struct Answer {
+				bool	hit;
+				float	depth; //penetration, or ray distance
+			};
+
+			//What the reference says: separation is positive if they're apart, and
+			//for rays, whether they're hit with the shape grown or shrunk by Tolerance
+			struct Reference {
+				float	separation;
+				bool	hitGrown;
+				bool	hitShrunk;
+				float	depth;		//negative if it doesn't know
+			};
+
+			typedef Answer		(*RoutineFunc)(const Case& c);
+			typedef Reference	(*ReferenceFunc)(const Case& c);
+
+		protected:
+			void BuildCases();
+			Result Test(const std::string& name, RoutineFunc routine, ReferenceFunc reference, bool isRay);
+			Vector3 RandomVector(float range);
+			Quaternion RandomOrientation();
+
+			int				caseCount;
+			std::mt19937	random;
+			std::vector<Case> cases;
+			std::vector<Result> results;
+		};
+	}
+}
@@ -8,8 +8,15 @@
 #include "../../Common/Maths.h"
 #include "Debug.h"
 #include "GameObject.h"
+#include "GJKAlgorithm.h"
 
 #include <list>
+#include <utility>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define COLLISION_USE_SSE
+#endif
 
 using namespace NCL;
 
@@ -51,6 +58,28 @@ bool CollisionDetection::RayIntersection(const Ray& r,GameObject& object, RayCol
 	return hasCollided;
 }
 
+bool CollisionDetection::RaySlabTest(const Vector3& rayPos, const Vector3& invDir, const Vector3& boxMin, const Vector3& boxMax, float maxDistance, float& entryDistance) {
+	float tEnter = 0.0f;
+	float tExit = maxDistance;
+
+	for (int i = 0; i < 3; ++i) {
+		float t0 = (boxMin[i] - rayPos[i]) * invDir[i];
+		float t1 = (boxMax[i] - rayPos[i]) * invDir[i];
+		if (t0 > t1) {
+			float temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+		tEnter = t0 > tEnter ? t0 : tEnter;
+		tExit = t1 < tExit ? t1 : tExit;
+		if (tEnter > tExit) {
+			return false;
+		}
+	}
+	entryDistance = tEnter;
+	return true;
+}
+
 bool CollisionDetection::RayBoxIntersection(const Ray&r, const Vector3& boxPos, const Vector3& boxSize, RayCollision& collision) {
 	Vector3 boxMin = boxPos - boxSize;
 	Vector3 boxMax = boxPos + boxSize;
@@ -243,6 +272,22 @@ Ray CollisionDetection::BuildRayFromMouse(const Camera& cam) {
 	return Ray(cam.GetPosition(), c);
 }
 
+Ray CollisionDetection::BuildRayFromMouse(const ViewData& view) {
+	Vector2 screenMouse = Window::GetMouse()->GetAbsolutePosition();
+	Vector2 screenSize	= Window::GetWindow()->GetScreenSize();
+
+	float x = (screenMouse.x / screenSize.x) * 2.0f - 1.0f;
+	float y = ((screenSize.y - screenMouse.y) / screenSize.y) * 2.0f - 1.0f;
+
+	Vector3 a = view.Unproject(Vector3(x, y, -0.99999f));
+	Vector3 b = view.Unproject(Vector3(x, y, 0.99999f));
+	Vector3 c = b - a;
+
+	c.Normalise();
+
+	return Ray(view.position, c);
+}
+
 //http://bookofhook.com/mousepick.pdf
 Matrix4 CollisionDetection::GenerateInverseProjection(float aspect, float fov, float nearPlane, float farPlane) {
 	Matrix4 m;
@@ -287,22 +332,15 @@ Matrix4::Rotation(pitch, Vector3(1, 0, 0));
 return iview;
 }
 
-Vector3 NCL::CollisionDetection::OBBSupport(const Transform& worldTransform, Vector3 worldDir)
+Vector3 NCL::CollisionDetection::SpherePosFromCapsule(const CapsuleVolume& capsule, const Transform& capTransform, const Vector3& otherObjPos)
 {
-	Vector3 localDir = worldTransform.GetOrientation().Conjugate() * worldDir;
-	Vector3 vertex;
-	vertex.x = localDir.x < 0 ? -0.5f : 0.5f;
-	vertex.y = localDir.y < 0 ? -0.5f : 0.5f;
-	vertex.z = localDir.z < 0 ? -0.5f : 0.5f;
-
-	return worldTransform.GetMatrix() * vertex;
+	return SpherePosFromCapsule(GJKShape::FromCapsule(capsule, capTransform), otherObjPos);
 }
 
-Vector3 NCL::CollisionDetection::SpherePosFromCapsule(const CapsuleVolume& capsule, const Transform& capTransform, const Vector3& otherObjPos)
+Vector3 NCL::CollisionDetection::SpherePosFromCapsule(const GJKShape& capsule, const Vector3& otherObjPos)
 {
-	Vector3 extentPosition = capTransform.GetOrientation() * Vector3(0, 1, 0) * (capsule.GetHalfHeight() - capsule.GetRadius());
-	Vector3 capTop(capTransform.GetPosition() + capsule.GetOffset() + extentPosition);
-	Vector3 capBottom(capTransform.GetPosition() + capsule.GetOffset() - extentPosition);
+	Vector3 capTop(capsule.centre + capsule.segmentHalf);
+	Vector3 capBottom(capsule.centre - capsule.segmentHalf);
 
 	Vector3 capsuleDir = capTop - capBottom;
 	float capLineLength = capsuleDir.Length();
@@ -366,88 +404,177 @@ Vector3	CollisionDetection::UnprojectScreenPosition(Vector3 position, float aspe
 	return Vector3(transformed.x / transformed.w, transformed.y / transformed.w, transformed.z / transformed.w);
 }
 
-bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo) {
-	const CollisionVolume* volA = a->GetBoundingVolume();
-	const CollisionVolume* volB = b->GetBoundingVolume();
-
-	if (!volA || !volB) {
-		return false;
-	}
-
-	collisionInfo.a = a;
-	collisionInfo.b = b;
+namespace {
+	typedef CollisionDetection::CollisionInfo CollisionInfo;
 
-	Transform& transformA = a->GetTransform();
-	Transform& transformB = b->GetTransform();
+	template<class VolumeA, class VolumeB>
+	using ShapeTest = bool (*)(const VolumeA&, const Transform&, const GJKShape&, const VolumeB&, const Transform&, const GJKShape&, CollisionInfo&);
 
-	VolumeType pairType = (VolumeType)((int)volA->type | (int)volB->type);
+	template<class VolumeA, class VolumeB>
+	using VolumeTest = bool (*)(const VolumeA&, const Transform&, const VolumeB&, const Transform&, CollisionInfo&);
 
-	if (pairType == VolumeType::AABB) {
-		return AABBIntersection((AABBVolume&)*volA, transformA, (AABBVolume&)*volB, transformB, collisionInfo);
+	//The volumes are known to be the right types by the time these are called,
+	//so they're just casts around the test itself, and inline straight into the table
+	template<class VolumeA, class VolumeB, ShapeTest<VolumeA, VolumeB> Test>
+	bool PairTest(const CollisionVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+		const CollisionVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
+		return Test((const VolumeA&)volumeA, worldTransformA, shapeA, (const VolumeB&)volumeB, worldTransformB, shapeB, collisionInfo);
 	}
 
-	if (pairType == VolumeType::Sphere) {
-		return SphereIntersection((SphereVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
+	template<class VolumeA, class VolumeB, ShapeTest<VolumeA, VolumeB> Test>
+	bool SwappedPairTest(const CollisionVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB,
+		const CollisionVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA, CollisionInfo& collisionInfo) {
+		std::swap(collisionInfo.a, collisionInfo.b);
+		return Test((const VolumeA&)volumeA, worldTransformA, shapeA, (const VolumeB&)volumeB, worldTransformB, shapeB, collisionInfo);
 	}
 
-	if (pairType == VolumeType::OBB) {
-		return OBBIntersection((OBBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
+	//For the tests that only need positions and sizes, which the volumes already give them
+	template<class VolumeA, class VolumeB, VolumeTest<VolumeA, VolumeB> Test>
+	bool WithoutShapes(const VolumeA& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+		const VolumeB& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
+		return Test(volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
 	}
 
-	if (pairType == VolumeType::Capsule) {
-		return CapsuleIntersection((CapsuleVolume&)*volA, transformA, (CapsuleVolume&)*volB, transformB, collisionInfo);
+	bool AABBSphereTest(const AABBVolume& volumeA, const Transform& worldTransformA,
+		const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+		return CollisionDetection::AABBSphereIntersection(volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
 	}
+}
 
-	if (volA->type == VolumeType::AABB && volB->type == VolumeType::Sphere) {
-		return AABBSphereIntersection((AABBVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
-	}
-	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::AABB) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return AABBSphereIntersection((AABBVolume&)*volB, transformB, (SphereVolume&)*volA, transformA, collisionInfo);
-	}
+//Rows are the first object's type, columns the second's, in GetVolumeSlot order
+const CollisionDetection::PairTestFunc CollisionDetection::pairTests[VolumeSlots][VolumeSlots] = {
+	{ //AABB
+		PairTest<AABBVolume, AABBVolume, &WithoutShapes<AABBVolume, AABBVolume, &CollisionDetection::AABBIntersection>>,
+		&CollisionDetection::ConvexIntersection,
+		PairTest<AABBVolume, SphereVolume, &WithoutShapes<AABBVolume, SphereVolume, &AABBSphereTest>>,
+		nullptr,
+		SwappedPairTest<CapsuleVolume, AABBVolume, &CollisionDetection::AABBCapsuleIntersection>,
+		nullptr
+	},
+	{ //OBB
+		&CollisionDetection::ConvexIntersection,
+		&CollisionDetection::ConvexIntersection,
+		SwappedPairTest<SphereVolume, OBBVolume, &CollisionDetection::SphereOBBIntersection>,
+		nullptr,
+		&CollisionDetection::ConvexIntersection,
+		nullptr
+	},
+	{ //Sphere
+		SwappedPairTest<AABBVolume, SphereVolume, &WithoutShapes<AABBVolume, SphereVolume, &AABBSphereTest>>,
+		PairTest<SphereVolume, OBBVolume, &CollisionDetection::SphereOBBIntersection>,
+		PairTest<SphereVolume, SphereVolume, &WithoutShapes<SphereVolume, SphereVolume, &CollisionDetection::SphereIntersection>>,
+		nullptr,
+		SwappedPairTest<CapsuleVolume, SphereVolume, &CollisionDetection::SphereCapsuleIntersection>,
+		nullptr
+	},
+	{ nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, //Mesh
+	{ //Capsule
+		PairTest<CapsuleVolume, AABBVolume, &CollisionDetection::AABBCapsuleIntersection>,
+		&CollisionDetection::ConvexIntersection,
+		PairTest<CapsuleVolume, SphereVolume, &CollisionDetection::SphereCapsuleIntersection>,
+		nullptr,
+		PairTest<CapsuleVolume, CapsuleVolume, &CollisionDetection::CapsuleIntersection>,
+		nullptr
+	},
+	{ nullptr, nullptr, nullptr, nullptr, nullptr, nullptr } //Compound
+};
 
-	if (volA->type == VolumeType::Capsule && volB->type == VolumeType::Sphere) {
-		return SphereCapsuleIntersection((CapsuleVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
-	}
-	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::Capsule) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return SphereCapsuleIntersection((CapsuleVolume&)*volB, transformB, (SphereVolume&)*volA, transformA, collisionInfo);
+bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo) {
+	PairTestFunc test = GetPairTest(a->GetBoundingVolume(), b->GetBoundingVolume());
+	if (!test) {
+		return false;
 	}
+	GJKShape shapeA = GJKShape::FromVolume(*a->GetBoundingVolume(), a->GetTransform());
+	GJKShape shapeB = GJKShape::FromVolume(*b->GetBoundingVolume(), b->GetTransform());
+	return ObjectIntersection(test, a, shapeA, b, shapeB, collisionInfo);
+}
 
-	if (volA->type == VolumeType::Capsule && volB->type == VolumeType::AABB) {
-		return AABBCapsuleIntersection((CapsuleVolume&)* volA, transformA, (AABBVolume&)* volB, transformB, collisionInfo);
-	}
-	if (volA->type == VolumeType::AABB && volB->type == VolumeType::Capsule) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return AABBCapsuleIntersection((CapsuleVolume&)* volB, transformB, (AABBVolume&)* volA, transformA, collisionInfo);
-	}
+bool CollisionDetection::ObjectIntersection(PairTestFunc test, GameObject* a, const GJKShape& shapeA,
+	GameObject* b, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
+	collisionInfo.a = a;
+	collisionInfo.b = b;
+	return test(*a->GetBoundingVolume(), a->GetTransform(), shapeA, *b->GetBoundingVolume(), b->GetTransform(), shapeB, collisionInfo);
+}
 
-	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::OBB) {
-		return SphereOBBIntersection((SphereVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
+namespace {
+	bool HasBox(const GJKShape& s) {
+		return s.halfSize.x > 0.0f || s.halfSize.y > 0.0f || s.halfSize.z > 0.0f;
+	}
+
+	//Only for spheres - a capsule's nearest point to a box depends on the box too
+	bool BoxSphereOverlap(const GJKShape& box, const GJKShape& sphere) {
+		Vector3 offset	= sphere.centre - box.centre;
+		Vector3 delta	= Vector3(Vector3::Dot(offset, box.axes[0]), Vector3::Dot(offset, box.axes[1]), Vector3::Dot(offset, box.axes[2]));
+		Vector3 outside	= delta - Maths::Clamp(delta, -box.halfSize, box.halfSize);
+		return Vector3::Dot(outside, outside) < sphere.radius * sphere.radius;
+	}
+
+	/*
+	The closest points between the two segments, the long way round, as
+	CapsuleIntersection's shortcut can miss the pair by a little at some
+	angles. Either segment can be a point, for spheres.
+	*/
+	bool RoundOverlap(const GJKShape& a, const GJKShape& b) {
+		Vector3 d1 = a.segmentHalf * 2.0f;
+		Vector3 d2 = b.segmentHalf * 2.0f;
+		Vector3 r  = (a.centre - a.segmentHalf) - (b.centre - b.segmentHalf);
+		float lengthA	= Vector3::Dot(d1, d1);
+		float lengthB	= Vector3::Dot(d2, d2);
+		float f			= Vector3::Dot(d2, r);
+
+		float s = 0.0f;
+		float t = 0.0f;
+		if (lengthA < 1e-8f) {
+			t = lengthB < 1e-8f ? 0.0f : Maths::Clamp(f / lengthB, 0.0f, 1.0f);
+		}
+		else {
+			float c = Vector3::Dot(d1, r);
+			if (lengthB < 1e-8f) {
+				s = Maths::Clamp(-c / lengthA, 0.0f, 1.0f);
+			}
+			else {
+				float b12	= Vector3::Dot(d1, d2);
+				float denom	= lengthA * lengthB - b12 * b12;
+				s = denom > 1e-8f ? Maths::Clamp((b12 * f - c * lengthB) / denom, 0.0f, 1.0f) : 0.0f;
+				t = (b12 * s + f) / lengthB;
+				if (t < 0.0f) {
+					t = 0.0f;
+					s = Maths::Clamp(-c / lengthA, 0.0f, 1.0f);
+				}
+				else if (t > 1.0f) {
+					t = 1.0f;
+					s = Maths::Clamp((b12 - c) / lengthA, 0.0f, 1.0f);
+				}
+			}
+		}
+		Vector3 delta = ((a.centre - a.segmentHalf) + d1 * s) - ((b.centre - b.segmentHalf) + d2 * t);
+		float radii = a.radius + b.radius;
+		return Vector3::Dot(delta, delta) < radii * radii;
 	}
-	if (volA->type == VolumeType::OBB && volB->type == VolumeType::Sphere) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return SphereOBBIntersection((SphereVolume&)*volB, transformB, (OBBVolume&)*volA, transformA, collisionInfo);
+
+	bool IsSphere(const GJKShape& s) {
+		return Vector3::Dot(s.segmentHalf, s.segmentHalf) < 1e-8f;
 	}
+}
 
-	if (volA->type == VolumeType::Capsule && volB->type == VolumeType::OBB) {
-		return CapsuleOBBIntersection((CapsuleVolume&)* volA, transformA, (OBBVolume&)* volB, transformB, collisionInfo);
+/*
+Spheres and capsules against each other, and spheres against boxes, come
+down to a distance check between a couple of points. Anything else goes
+through GJK, but only the simplex walk, as there's no contact to expand.
+*/
+bool CollisionDetection::ShapesOverlap(const GJKShape& shapeA, const GJKShape& shapeB, Vector3& searchDir) {
+	bool boxA = HasBox(shapeA);
+	bool boxB = HasBox(shapeB);
+	if (!boxA && !boxB) {
+		return RoundOverlap(shapeA, shapeB);
 	}
-	if (volA->type == VolumeType::OBB && volB->type == VolumeType::Capsule) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return CapsuleOBBIntersection((CapsuleVolume&)* volB, transformB, (OBBVolume&)* volA, transformA, collisionInfo);
+	if (boxA && !boxB && IsSphere(shapeB)) {
+		return BoxSphereOverlap(shapeA, shapeB);
 	}
-
-	if ((volA->type == VolumeType::AABB && volB->type == VolumeType::OBB) || (volA->type == VolumeType::OBB && volB->type == VolumeType::AABB)) {
-		return OBBIntersection((OBBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
+	if (boxB && !boxA && IsSphere(shapeA)) {
+		return BoxSphereOverlap(shapeB, shapeA);
 	}
-
-	return false;
+	return GJKAlgorithm::Overlaps(shapeA, shapeB, searchDir);
 }
 
 bool CollisionDetection::AABBTest(const Vector3& posA, const Vector3& posB, const Vector3& halfSizeA, const Vector3& halfSizeB) {
@@ -463,6 +590,38 @@ bool CollisionDetection::AABBTest(const Vector3& posA, const Vector3& posB, cons
 	return false;
 }
 
+/*
+The same test as AABBTest, but on four boxes at a time. Each axis is
+loaded as a register of four floats, the absolute distance is found by
+masking off the sign bits, and the three axis results are ANDed into a
+single 4 bit mask.
+*/
+int CollisionDetection::AABBTest4(const Vector3& pos, const Vector3& halfSize, const AABBArray& boxes, int first) {
+#ifdef COLLISION_USE_SSE
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	__m128 dx = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.posX[first]), _mm_set1_ps(pos.x)), absMask);
+	__m128 dy = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.posY[first]), _mm_set1_ps(pos.y)), absMask);
+	__m128 dz = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.posZ[first]), _mm_set1_ps(pos.z)), absMask);
+
+	__m128 sx = _mm_add_ps(_mm_loadu_ps(&boxes.halfX[first]), _mm_set1_ps(halfSize.x));
+	__m128 sy = _mm_add_ps(_mm_loadu_ps(&boxes.halfY[first]), _mm_set1_ps(halfSize.y));
+	__m128 sz = _mm_add_ps(_mm_loadu_ps(&boxes.halfZ[first]), _mm_set1_ps(halfSize.z));
+
+	__m128 overlap = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(dx, sx), _mm_cmplt_ps(dy, sy)), _mm_cmplt_ps(dz, sz));
+	return _mm_movemask_ps(overlap);
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; ++i) {
+		int b = first + i;
+		if (AABBTest(pos, Vector3(boxes.posX[b], boxes.posY[b], boxes.posZ[b]), halfSize, Vector3(boxes.halfX[b], boxes.halfY[b], boxes.halfZ[b]))) {
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
+
 //AABB/AABB Collisions
 bool CollisionDetection::AABBIntersection(const AABBVolume& volumeA, const Transform& worldTransformA,
 	const AABBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
@@ -513,16 +672,20 @@ bool CollisionDetection::AABBIntersection(const AABBVolume& volumeA, const Trans
 
 bool NCL::CollisionDetection::CapsuleIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA, 
 	const CapsuleVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	return CapsuleIntersection(volumeA, worldTransformA, GJKShape::FromCapsule(volumeA, worldTransformA),
+		volumeB, worldTransformB, GJKShape::FromCapsule(volumeB, worldTransformB), collisionInfo);
+}
+
+bool NCL::CollisionDetection::CapsuleIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+	const CapsuleVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
 
 	// Code adjusted from: https://wickedengine.net/2020/04/26/capsule-collision-detection/
 
-	Vector3 capExtPositionA = worldTransformA.GetOrientation() * Vector3(0, 1, 0) * (volumeA.GetHalfHeight() - volumeA.GetRadius());
-	Vector3 capTopA(worldTransformA.GetPosition() + volumeA.GetOffset() + capExtPositionA);
-	Vector3 capBottomA(worldTransformA.GetPosition() + volumeA.GetOffset() - capExtPositionA);
+	Vector3 capTopA(shapeA.centre + shapeA.segmentHalf);
+	Vector3 capBottomA(shapeA.centre - shapeA.segmentHalf);
 
-	Vector3 capExtPositionB = worldTransformB.GetOrientation() * Vector3(0, 1, 0) * (volumeB.GetHalfHeight() - volumeB.GetRadius());
-	Vector3 capTopB(worldTransformB.GetPosition() + volumeB.GetOffset() + capExtPositionB);
-	Vector3 capBottomB(worldTransformB.GetPosition() + volumeB.GetOffset() - capExtPositionB);
+	Vector3 capTopB(shapeB.centre + shapeB.segmentHalf);
+	Vector3 capBottomB(shapeB.centre - shapeB.segmentHalf);
 
 	Vector3 v0 = capBottomB - capBottomA;
 	Vector3 v1 = capTopB - capBottomA;
@@ -585,48 +748,42 @@ bool CollisionDetection::SphereIntersection(const SphereVolume& volumeA, const T
 //Sphere / OBB Collision
 bool NCL::CollisionDetection::SphereOBBIntersection(const SphereVolume& volumeA, const Transform& worldTransformA,
 	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-	
-	Quaternion orientation = worldTransformB.GetOrientation();
+	return SphereOBBIntersection(volumeA, worldTransformA, GJKShape::FromSphere(volumeA, worldTransformA),
+		volumeB, worldTransformB, GJKShape::FromOBB(volumeB, worldTransformB), collisionInfo);
+}
 
-	Matrix3 transform = Matrix3(orientation);
-	Matrix3 invTransform = Matrix3(orientation.Conjugate());
+//The box's axes are the columns of its rotation, so they take the place of the matrices
+bool NCL::CollisionDetection::SphereOBBIntersection(const SphereVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+	const OBBVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
+
+	auto toBox = [&](const Vector3& v) {
+		return Vector3(Vector3::Dot(v, shapeB.axes[0]), Vector3::Dot(v, shapeB.axes[1]), Vector3::Dot(v, shapeB.axes[2]));
+	};
+	auto fromBox = [&](const Vector3& v) {
+		return shapeB.axes[0] * v.x + shapeB.axes[1] * v.y + shapeB.axes[2] * v.z;
+	};
 
 	SphereVolume sphere(volumeA.GetRadius());
 	Transform sphereTransform;
-	sphereTransform.SetPosition(invTransform * worldTransformA.GetPosition() + volumeA.GetOffset());
+	sphereTransform.SetPosition(toBox(worldTransformA.GetPosition()) + volumeA.GetOffset());
 	sphereTransform.SetScale(Vector3(1, 1, 1) * volumeA.GetRadius());
 
 	AABBVolume aabb(volumeB.GetHalfDimensions());
 	Transform aabbTransform;
-	aabbTransform.SetPosition(invTransform * worldTransformB.GetPosition() + volumeB.GetOffset());
+	aabbTransform.SetPosition(toBox(worldTransformB.GetPosition()) + volumeB.GetOffset());
 	aabbTransform.SetScale(volumeB.GetHalfDimensions());
 
 	bool collided = AABBSphereIntersection(aabb, aabbTransform, sphere, sphereTransform, collisionInfo, true);
-	collisionInfo.point.localA = transform * collisionInfo.point.localA;
-	collisionInfo.point.localB = transform * collisionInfo.point.localB;
-	collisionInfo.point.normal = transform * -collisionInfo.point.normal;
+	collisionInfo.point.localA = fromBox(collisionInfo.point.localA);
+	collisionInfo.point.localB = fromBox(collisionInfo.point.localB);
+	collisionInfo.point.normal = fromBox(-collisionInfo.point.normal);
 	return collided;
 }
 
 //Capsule / OBB Collision
 bool NCL::CollisionDetection::CapsuleOBBIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA, 
 	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-
-	Matrix3 invTransform = Matrix3(worldTransformB.GetOrientation().Conjugate());
-	Vector3 point = worldTransformB.GetOrientation() * Maths::Clamp(
-		invTransform * worldTransformA.GetPosition() + volumeA.GetOffset(),
-		worldTransformB.GetPosition() + volumeB.GetOffset() - volumeB.GetHalfDimensions(),
-		worldTransformB.GetPosition() + volumeB.GetOffset() + volumeB.GetHalfDimensions()
-	);
-	
-	SphereVolume sphere(volumeA.GetRadius());
-	Transform sphereTransform;
-	sphereTransform.SetPosition(SpherePosFromCapsule(volumeA, worldTransformA, point));
-	sphereTransform.SetScale(Vector3(1, 1, 1) * volumeA.GetRadius());
-
-	bool collision = SphereOBBIntersection(sphere, sphereTransform, volumeB, worldTransformB, collisionInfo);
-	collisionInfo.point.localA = collisionInfo.point.localA + (sphereTransform.GetPosition() - worldTransformA.GetPosition() + volumeA.GetOffset());
-	return collision;
+	return ConvexIntersection(volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
 }
 
 //AABB / Sphere Collision
@@ -657,120 +814,42 @@ bool CollisionDetection::AABBSphereIntersection(const AABBVolume& volumeA, const
 bool CollisionDetection::OBBIntersection(
 	const OBBVolume& volumeA, const Transform& worldTransformA,
 	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	return ConvexIntersection(volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
+}
 
-	Vector3 directions[15]{
-
-		// A XYZ
-		worldTransformA.GetOrientation() * Vector3(1, 0, 0),
-		worldTransformA.GetOrientation() * Vector3(0, 1, 0),
-		worldTransformA.GetOrientation() * Vector3(0, 0, 1),
-
-		// B XYZ
-		worldTransformB.GetOrientation() * Vector3(1, 0, 0),
-		worldTransformB.GetOrientation() * Vector3(0, 1, 0),
-		worldTransformB.GetOrientation() * Vector3(0, 0, 1),
-
-		// Ax cross B XYZ
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(1, 0, 0), worldTransformB.GetOrientation() * Vector3(1, 0, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(1, 0, 0), worldTransformB.GetOrientation() * Vector3(0, 1, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(1, 0, 0), worldTransformB.GetOrientation() * Vector3(0, 0, 1)),
-
-		// Ay cross B XYZ
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 1, 0), worldTransformB.GetOrientation() * Vector3(1, 0, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 1, 0), worldTransformB.GetOrientation() * Vector3(0, 1, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 1, 0), worldTransformB.GetOrientation() * Vector3(0, 0, 1)),
-
-		// Az cross B XYZ
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 0, 1), worldTransformB.GetOrientation() * Vector3(1, 0, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 0, 1), worldTransformB.GetOrientation() * Vector3(0, 1, 0)),
-		Vector3::Cross(worldTransformA.GetOrientation() * Vector3(0, 0, 1), worldTransformB.GetOrientation() * Vector3(0, 0, 1)),
-	};
-
-	float leastPenetration = FLT_MAX;
-	int penIndex = -1;
-
-	for (int i = 0; i < 15; ++i) {
-		if (Vector3::Dot(directions[i], directions[i]) < 0.99f)
-			continue;
-
-		// Get min and max extents for both shapes along an axis
-		Vector3 maxA = OBBSupport(worldTransformA, directions[i]);
-		Vector3 minA = OBBSupport(worldTransformA, -directions[i]);
-
-		Vector3 maxB = OBBSupport(worldTransformB, directions[i]);
-		Vector3 minB = OBBSupport(worldTransformB, -directions[i]);
-
-		// Project those points on to the line
-		float denom = Vector3::Dot(directions[i], directions[i]);
-
-		Vector3 minExtentA = directions[i] * (Vector3::Dot(minA, directions[i]) / denom);
-		Vector3 maxExtentA = directions[i] * (Vector3::Dot(maxA, directions[i]) / denom);
-		Vector3 minExtentB = directions[i] * (Vector3::Dot(minB, directions[i]) / denom);
-		Vector3 maxExtentB = directions[i] * (Vector3::Dot(maxB, directions[i]) / denom);
-
-		float distance = FLT_MAX;
-		float length = FLT_MAX;
-		float penDist = FLT_MAX;
-
-		float left = Vector3::Dot(maxExtentA - minExtentA, minExtentB - minExtentA);
-		float right = Vector3::Dot(minExtentA - maxExtentA, maxExtentB - maxExtentA);
-
-		if (right > 0.0f) {
-			// Object B to the left
-			distance = (maxExtentB - maxExtentA).Length();
-			length = (maxExtentA - minExtentA).Length();
-			if (distance <= length) {
-				penDist = length - distance;
-				if (penDist < leastPenetration) {
-					leastPenetration = penDist;
-					collisionInfo.point.localA = minA;
-					collisionInfo.point.localB = maxB;
-					collisionInfo.point.normal = -directions[i];
-					penIndex = i;
-				}
-				continue;
-			}
-		}
-
-		if (left > 0.0f) {
-			// Object A to the left
-			distance = (minExtentB - minExtentA).Length();
-			length = (maxExtentA - minExtentA).Length();
-			if (distance <= length) {
-				penDist = length - distance;
-				if (penDist < leastPenetration) {
-					leastPenetration = penDist;
-					collisionInfo.point.localA = maxA;
-					collisionInfo.point.localB = minB;
-					collisionInfo.point.normal = directions[i];
-					penIndex = i;
-				}
-				continue;
-			}
-		}
-
-		if (left < 0.0f && right < 0.0f) {
-			penIndex = i;
-			continue;
-		}
-
-		return false;
-	}
+/*
+Pairs involving a rotated box go through GJK, with EPA for the contact.
+The pair's separating axis from last time is used as GJK's first guess,
+and the final one stored back for next time.
+*/
+bool CollisionDetection::ConvexIntersection(
+	const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	return ConvexIntersection(volumeA, worldTransformA, GJKShape::FromVolume(volumeA, worldTransformA),
+		volumeB, worldTransformB, GJKShape::FromVolume(volumeB, worldTransformB), collisionInfo);
+}
 
-	collisionInfo.point.penetration = leastPenetration;
-	collisionInfo.point.localA -= worldTransformA.GetPosition() + volumeA.GetOffset();
-	collisionInfo.point.localB -= worldTransformB.GetPosition() + volumeB.GetOffset();
-	return true;
+bool CollisionDetection::ConvexIntersection(
+	const CollisionVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
+	return GJKAlgorithm::Intersection(shapeA, worldTransformA, shapeB, worldTransformB, collisionInfo.separatingAxis, collisionInfo);
 }
 
 // Sphere / Capsule Collision
 bool CollisionDetection::SphereCapsuleIntersection(
 	const CapsuleVolume& volumeA, const Transform& worldTransformA,
 	const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	return SphereCapsuleIntersection(volumeA, worldTransformA, GJKShape::FromCapsule(volumeA, worldTransformA),
+		volumeB, worldTransformB, GJKShape::FromSphere(volumeB, worldTransformB), collisionInfo);
+}
+
+bool CollisionDetection::SphereCapsuleIntersection(
+	const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+	const SphereVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
 
 	SphereVolume sphere(volumeA.GetRadius());
 	Transform sphereTransform;
-	sphereTransform.SetPosition(SpherePosFromCapsule(volumeA, worldTransformA, worldTransformB.GetPosition() + volumeB.GetOffset()));
+	sphereTransform.SetPosition(SpherePosFromCapsule(shapeA, shapeB.centre));
 	sphereTransform.SetScale(Vector3(1, 1, 1) * volumeA.GetRadius());
 
 	bool collision = SphereIntersection(sphere, sphereTransform, volumeB, worldTransformB, collisionInfo);
@@ -782,12 +861,19 @@ bool CollisionDetection::SphereCapsuleIntersection(
 bool CollisionDetection::AABBCapsuleIntersection(
 	const CapsuleVolume& volumeA, const Transform& worldTransformA,
 	const AABBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	return AABBCapsuleIntersection(volumeA, worldTransformA, GJKShape::FromCapsule(volumeA, worldTransformA),
+		volumeB, worldTransformB, GJKShape::FromAABB(volumeB, worldTransformB), collisionInfo);
+}
+
+bool CollisionDetection::AABBCapsuleIntersection(
+	const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+	const AABBVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo) {
 
-	Vector3 point = Maths::Clamp(worldTransformA.GetPosition() + volumeA.GetOffset(), worldTransformB.GetPosition() + volumeB.GetOffset() - volumeB.GetHalfDimensions(), worldTransformB.GetPosition() + volumeB.GetOffset() + volumeB.GetHalfDimensions());
+	Vector3 point = Maths::Clamp(shapeA.centre, shapeB.centre - shapeB.halfSize, shapeB.centre + shapeB.halfSize);
 
 	SphereVolume sphere(volumeA.GetRadius());
 	Transform sphereTransform;
-	sphereTransform.SetPosition(SpherePosFromCapsule(volumeA, worldTransformA, point));
+	sphereTransform.SetPosition(SpherePosFromCapsule(shapeA, point));
 	sphereTransform.SetScale(Vector3(1, 1, 1) * volumeA.GetRadius());
 
 	bool collision = AABBSphereIntersection(volumeB, worldTransformB, sphere, sphereTransform, collisionInfo);
@@ -9,7 +9,10 @@
 #include "OBBVolume.h"
 #include "SphereVolume.h"
 #include "CapsuleVolume.h"
+#include "GJKShape.h"
 #include "Ray.h"
+#include "ViewData.h"
+#include <vector>
 
 using NCL::Camera;
 using namespace NCL::Maths;
@@ -33,6 +36,7 @@ namespace NCL {
 			mutable int		framesLeft;
 
 			ContactPoint point;
+			Vector3		 separatingAxis; //GJK's last search direction for this pair
 
 			void AddContactPoint(const Vector3& localA, const Vector3& localB, const Vector3& normal, float p) {
 				point.localA		= localA;
@@ -55,7 +59,13 @@ namespace NCL {
 		//TODO ADD THIS PROPERLY
 		static bool RayBoxIntersection(const Ray&r, const Vector3& boxPos, const Vector3& boxSize, RayCollision& collision);
 
+		//A slab test against a min / max box, for culling tree nodes. Unlike
+		//RayBoxIntersection, rays starting inside the box count as hitting it at 0
+		static bool RaySlabTest(const Vector3& rayPos, const Vector3& invDir, const Vector3& boxMin, const Vector3& boxMax, float maxDistance, float& entryDistance);
+
 		static Ray BuildRayFromMouse(const Camera& c);
+		//Uses the view's inverse as it is, so picks whatever was on screen under the mouse
+		static Ray BuildRayFromMouse(const ViewData& view);
 
 		static bool RayIntersection(const Ray&r, GameObject& object, RayCollision &collisions);
 
@@ -70,9 +80,80 @@ namespace NCL {
 
 		static bool	AABBTest(const Vector3& posA, const Vector3& posB, const Vector3& halfSizeA, const Vector3& halfSizeB);
 
+		//Box centres and half sizes stored a component at a time, so that
+		//AABBTest4 can load four boxes' worth straight into a register
+		struct AABBArray {
+			std::vector<float> posX, posY, posZ;
+			std::vector<float> halfX, halfY, halfZ;
+
+			void Clear() {
+				posX.clear(); posY.clear(); posZ.clear();
+				halfX.clear(); halfY.clear(); halfZ.clear();
+			}
+
+			void Add(const Vector3& pos, const Vector3& halfSize) {
+				posX.emplace_back(pos.x); posY.emplace_back(pos.y); posZ.emplace_back(pos.z);
+				halfX.emplace_back(halfSize.x); halfY.emplace_back(halfSize.y); halfZ.emplace_back(halfSize.z);
+			}
+
+			int Size() const {
+				return (int)posX.size();
+			}
+		};
+
+		//Tests one box against boxes[first] to boxes[first + 3] in one go, and
+		//returns a mask with bit i set if boxes[first + i] overlaps it. Matches
+		//AABBTest exactly, so the two can be mixed
+		static int	AABBTest4(const Vector3& pos, const Vector3& halfSize, const AABBArray& boxes, int first);
+
 
 		static bool ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo);
 
+		/*
+		Every pair of volume types has its own test in a table, so there's no
+		chain of type checks per pair. Tests that are only written one way
+		round (sphere against box, say) get a second entry that swaps the pair
+		over before calling them. Each object's world space shape is passed in
+		alongside its volume, so tests needing its axes or capsule segment
+		don't have to work them out from the orientation for every pair.
+		*/
+		typedef bool (*PairTestFunc)(const CollisionVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+									const CollisionVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static const int VolumeSlots = 6; //one for each VolumeType up to Compound
+
+		//-1 for types that don't have a slot
+		static int GetVolumeSlot(VolumeType type) {
+			switch (type) {
+				case VolumeType::AABB:		return 0;
+				case VolumeType::OBB:		return 1;
+				case VolumeType::Sphere:	return 2;
+				case VolumeType::Mesh:		return 3;
+				case VolumeType::Capsule:	return 4;
+				case VolumeType::Compound:	return 5;
+				default:					return -1;
+			}
+		}
+
+		//nullptr if nothing can test the two against each other
+		static PairTestFunc GetPairTest(const CollisionVolume* volA, const CollisionVolume* volB) {
+			if (!volA || !volB) {
+				return nullptr;
+			}
+			int slotA = GetVolumeSlot(volA->type);
+			int slotB = GetVolumeSlot(volB->type);
+			return (slotA < 0 || slotB < 0) ? nullptr : pairTests[slotA][slotB];
+		}
+
+		//As above, but with the test already looked up by GetPairTest, and the
+		//objects' shapes already worked out, for the physics system's narrowphase
+		static bool ObjectIntersection(PairTestFunc test, GameObject* a, const GJKShape& shapeA,
+										GameObject* b, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		//Whether two shapes overlap at all, without working out a contact, for
+		//triggers. searchDir is GJK's, as in CollisionInfo::separatingAxis
+		static bool ShapesOverlap(const GJKShape& shapeA, const GJKShape& shapeB, Vector3& searchDir);
+
 
 		static bool AABBIntersection(	const AABBVolume& volumeA, const Transform& worldTransformA,
 										const AABBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
@@ -108,8 +189,30 @@ namespace NCL {
 		static Matrix4		GenerateInverseView(const Camera &c);
 
 	protected:
-		static Vector3 OBBSupport(const Transform& worldTransform, Vector3 worldDir);
+		static bool ConvexIntersection(	const CollisionVolume& volumeA, const Transform& worldTransformA,
+										const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
+		//The tests that need world space axes or segments, taking them from shapes
+		//already worked out. The public versions above build the shapes and call these
+		static bool ConvexIntersection(	const CollisionVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+										const CollisionVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static bool CapsuleIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+										const CapsuleVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static bool SphereOBBIntersection(	const SphereVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+											const OBBVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static bool SphereCapsuleIntersection(	const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+												const SphereVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static bool AABBCapsuleIntersection(	const CapsuleVolume& volumeA, const Transform& worldTransformA, const GJKShape& shapeA,
+												const AABBVolume& volumeB, const Transform& worldTransformB, const GJKShape& shapeB, CollisionInfo& collisionInfo);
+
+		static const PairTestFunc pairTests[VolumeSlots][VolumeSlots];
+
 		static Vector3 SpherePosFromCapsule(const CapsuleVolume& capsule, const Transform& capsulePos, const Vector3& otherObjPos);
+		static Vector3 SpherePosFromCapsule(const GJKShape& capsule, const Vector3& otherObjPos);
 		static Vector3 ClosestPointOnLineSegment(Vector3 a, Vector3 b, Vector3 point);
 	
 	private:
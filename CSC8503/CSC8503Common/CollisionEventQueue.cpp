@@ -0,0 +1,32 @@
+#include "CollisionEventQueue.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+int CollisionEventQueue::AddListener(const Listener& listener) {
+	int id = nextListenerID++;
+	listeners.push_back({ id, listener });
+	return id;
+}
+
+void CollisionEventQueue::RemoveListener(int listenerID) {
+	for (auto i = listeners.begin(); i != listeners.end(); ++i) {
+		if (i->id == listenerID) {
+			listeners.erase(i);
+			return;
+		}
+	}
+}
+
+/*
+Each listener sees the whole batch before the next one starts, so a
+listener can rely on all of this update's events having been through
+the ones registered before it.
+*/
+void CollisionEventQueue::Dispatch() const {
+	for (const ListenerEntry& l : listeners) {
+		for (const CollisionEvent& e : events) {
+			l.func(e);
+		}
+	}
+}
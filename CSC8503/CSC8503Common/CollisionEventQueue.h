@@ -0,0 +1,66 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		struct CollisionEvent {
+			enum EventType {
+				Begin,	//first frame the pair touched
+				Stay,	//still touching since the last update
+				End		//stopped touching
+			};
+
+			EventType						type;
+			GameObject*						a;
+			GameObject*						b;
+			CollisionDetection::ContactPoint point; //the most recent contact for the pair
+		};
+
+		/*
+		Collision events are collected here while the physics system walks
+		its collision list, rather than being handed to the objects there and
+		then. Once the list is up to date, the whole batch is dispatched to
+		every listener in turn, and stays readable until the next update so
+		that any other system can go through it afterwards too.
+		*/
+		class CollisionEventQueue {
+		public:
+			typedef std::function<void(const CollisionEvent&)> Listener;
+
+			CollisionEventQueue() : nextListenerID(0) {}
+			~CollisionEventQueue() {}
+
+			void Push(CollisionEvent::EventType type, GameObject* a, GameObject* b, const CollisionDetection::ContactPoint& point) {
+				events.push_back({ type, a, b, point });
+			}
+
+			void Clear() {
+				events.clear();
+			}
+
+			const std::vector<CollisionEvent>& GetEvents() const {
+				return events;
+			}
+
+			//Returns an ID that can be passed to RemoveListener
+			int AddListener(const Listener& listener);
+			void RemoveListener(int listenerID);
+
+			void Dispatch() const;
+
+		protected:
+			struct ListenerEntry {
+				int			id;
+				Listener	func;
+			};
+
+			std::vector<CollisionEvent> events;
+			std::vector<ListenerEntry>	listeners;
+			int							nextListenerID;
+		};
+	}
+}
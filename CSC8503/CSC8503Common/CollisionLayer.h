@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace NCL {
 	namespace CSC8503 {
@@ -12,7 +13,57 @@ namespace NCL {
 			PLAYER,
 			ENEMY,
 			INTERACTABLE,
-			FLOOR
+			FLOOR,
+			PROJECTILE,
+			LAYER_COUNT //Keep this last!
+		};
+
+		inline uint32_t LayerBit(CollisionLayer l) {
+			return 1u << (uint32_t)l;
+		}
+
+		/*
+		Which layers can collide with which, stored as one bitmask per layer,
+		so checking a pair is just an array lookup and an AND. Everything
+		collides with everything until told otherwise.
+		*/
+		class CollisionLayerMatrix {
+		public:
+			static const int LayerCount = (int)CollisionLayer::LAYER_COUNT;
+			static_assert(LayerCount <= 32, "Collision layers must fit in a 32 bit mask");
+
+			CollisionLayerMatrix() {
+				Reset();
+			}
+
+			void Reset() {
+				for (int i = 0; i < LayerCount; ++i) {
+					masks[i] = ~0u;
+				}
+			}
+
+			void SetCollides(CollisionLayer a, CollisionLayer b, bool collides) {
+				if (collides) {
+					masks[(int)a] |= LayerBit(b);
+					masks[(int)b] |= LayerBit(a);
+				}
+				else {
+					masks[(int)a] &= ~LayerBit(b);
+					masks[(int)b] &= ~LayerBit(a);
+				}
+			}
+
+			bool Collides(CollisionLayer a, CollisionLayer b) const {
+				return (masks[(int)a] & LayerBit(b)) != 0;
+			}
+
+			//Every layer that the given layer can collide with
+			uint32_t GetMask(CollisionLayer l) const {
+				return masks[(int)l];
+			}
+
+		protected:
+			uint32_t masks[LayerCount];
 		};
 	}
-}
\ No newline at end of file
+}
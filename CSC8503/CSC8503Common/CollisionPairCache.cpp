@@ -0,0 +1,159 @@
+#include "CollisionPairCache.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+CollisionPairCache::CollisionPairCache(size_t initialCapacity) {
+	size_t capacity = 16;
+	while (capacity < initialCapacity * 2) {
+		capacity *= 2;
+	}
+	slots.resize(capacity, { 0, -1, 0 });
+	mask	= capacity - 1;
+	stamp	= 1;
+
+	pairs.reserve(initialCapacity);
+	pairKeys.reserve(initialCapacity);
+}
+
+/*
+The key doesn't care which way round the objects are - some of the
+intersection tests swap a and b so the contact normal points the right
+way, but it's still the same pair.
+*/
+uint64_t CollisionPairCache::PairKey(const GameObject* a, const GameObject* b) {
+	uint32_t idA = (uint32_t)a->GetWorldID();
+	uint32_t idB = (uint32_t)b->GetWorldID();
+	if (idA > idB) {
+		uint32_t temp = idA;
+		idA = idB;
+		idB = temp;
+	}
+	return ((uint64_t)idA << 32) | (uint64_t)idB;
+}
+
+//Returns the slot holding the key, or the empty slot it would be placed in
+size_t CollisionPairCache::FindSlot(uint64_t key) const {
+	size_t slot = Hash(key) & mask;
+	while (IsUsed(slot) && slots[slot].key != key) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+bool CollisionPairCache::Insert(const CollisionDetection::CollisionInfo& info) {
+	if ((pairs.size() + 1) * 2 > slots.size()) {
+		Grow();
+	}
+	uint64_t key = PairKey(info.a, info.b);
+	size_t slot = FindSlot(key);
+	if (IsUsed(slot)) {
+		return false;
+	}
+	slots[slot].key		= key;
+	slots[slot].index	= (int)pairs.size();
+	slots[slot].stamp	= stamp;
+
+	pairs.emplace_back(info);
+	pairKeys.emplace_back(key);
+	return true;
+}
+
+bool CollisionPairCache::Contains(const GameObject* a, const GameObject* b) const {
+	return IsUsed(FindSlot(PairKey(a, b)));
+}
+
+const CollisionDetection::CollisionInfo* CollisionPairCache::Find(const GameObject* a, const GameObject* b) const {
+	size_t slot = FindSlot(PairKey(a, b));
+	if (!IsUsed(slot)) {
+		return nullptr;
+	}
+	return &pairs[slots[slot].index];
+}
+
+void CollisionPairCache::Swap(CollisionPairCache& other) {
+	pairs.swap(other.pairs);
+	pairKeys.swap(other.pairKeys);
+	slots.swap(other.slots);
+
+	size_t tempMask = mask;
+	mask		= other.mask;
+	other.mask	= tempMask;
+
+	uint32_t tempStamp = stamp;
+	stamp		= other.stamp;
+	other.stamp = tempStamp;
+}
+
+void CollisionPairCache::CopyFrom(const CollisionPairCache& other) {
+	if (pairs.capacity() < other.pairs.size()) {
+		pairs.reserve(other.pairs.size() * 2);
+		pairKeys.reserve(other.pairs.size() * 2);
+	}
+	if (slots.capacity() < other.slots.size()) {
+		slots.reserve(other.slots.size() * 2); //it only ever doubles
+	}
+	pairs		= other.pairs;
+	pairKeys	= other.pairKeys;
+	slots		= other.slots;
+	mask		= other.mask;
+	stamp		= other.stamp;
+}
+
+void CollisionPairCache::Clear() {
+	pairs.clear();
+	pairKeys.clear();
+	stamp++;
+	if (stamp == 0) { //wrapped around, so old stamps could look valid again
+		for (Slot& s : slots) {
+			s.stamp = 0;
+		}
+		stamp = 1;
+	}
+}
+
+/*
+Removal swaps the last pair into the gap to keep the pair array dense,
+then backward-shifts any following entries in the probe chain, so the
+table never needs tombstones.
+*/
+void CollisionPairCache::RemoveAt(size_t pairIndex) {
+	size_t hole = FindSlot(pairKeys[pairIndex]);
+
+	size_t last = pairs.size() - 1;
+	if (pairIndex != last) {
+		pairs[pairIndex]	= pairs[last];
+		pairKeys[pairIndex]	= pairKeys[last];
+		slots[FindSlot(pairKeys[pairIndex])].index = (int)pairIndex;
+	}
+	pairs.pop_back();
+	pairKeys.pop_back();
+
+	size_t next = (hole + 1) & mask;
+	while (IsUsed(next)) {
+		size_t home = Hash(slots[next].key) & mask;
+		//Only move the entry back if its home slot isn't between the hole and it
+		bool canMove = (next > hole) ? (home <= hole || home > next) : (home <= hole && home > next);
+		if (canMove) {
+			slots[hole] = slots[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	slots[hole].stamp = stamp - 1;
+}
+
+void CollisionPairCache::Grow() {
+	size_t capacity = slots.size() * 2;
+	slots.assign(capacity, { 0, -1, 0 });
+	mask	= capacity - 1;
+	stamp	= 1;
+
+	for (size_t i = 0; i < pairKeys.size(); ++i) {
+		size_t slot = FindSlot(pairKeys[i]);
+		slots[slot].key		= pairKeys[i];
+		slots[slot].index	= (int)i;
+		slots[slot].stamp	= stamp;
+	}
+}
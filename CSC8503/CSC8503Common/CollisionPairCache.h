@@ -0,0 +1,97 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A flat, open addressing set of collision pairs, keyed by the world IDs
+		of the two objects involved. Pairs are stored densely so that iterating
+		over them is a linear walk, and the hash table just holds indices into
+		that array.
+
+		Slots are stamped with a generation counter, so Clear() is O(1) and
+		never frees memory - once the cache has grown to fit the busiest frame,
+		inserting and clearing pairs costs no allocations at all.
+		*/
+		class CollisionPairCache {
+		public:
+			typedef std::vector<CollisionDetection::CollisionInfo>::iterator		iterator;
+			typedef std::vector<CollisionDetection::CollisionInfo>::const_iterator	const_iterator;
+
+			CollisionPairCache(size_t initialCapacity = 256);
+			~CollisionPairCache() {}
+
+			//Returns false if the pair was already in the cache, in which
+			//case the stored entry is left untouched
+			bool Insert(const CollisionDetection::CollisionInfo& info);
+
+			bool Contains(const GameObject* a, const GameObject* b) const;
+
+			//The stored entry for the pair, or nullptr if it isn't in the cache
+			const CollisionDetection::CollisionInfo* Find(const GameObject* a, const GameObject* b) const;
+
+			void Clear();
+
+			//Exchanges contents with another cache, without copying any pairs
+			void Swap(CollisionPairCache& other);
+
+			//Copies another cache's pairs, growing with room to spare if it has
+			//to, so copying from one that keeps growing a little doesn't allocate every time
+			void CopyFrom(const CollisionPairCache& other);
+
+			//Removes every pair the predicate returns true for
+			template<class F>
+			void RemoveIf(F pred) {
+				for (size_t i = 0; i < pairs.size(); ) {
+					if (pred(pairs[i])) {
+						RemoveAt(i);
+					}
+					else {
+						++i;
+					}
+				}
+			}
+
+			size_t Size() const		{ return pairs.size(); }
+			bool IsEmpty() const	{ return pairs.empty(); }
+
+			iterator begin()				{ return pairs.begin(); }
+			iterator end()					{ return pairs.end(); }
+			const_iterator begin() const	{ return pairs.begin(); }
+			const_iterator end() const		{ return pairs.end(); }
+
+		protected:
+			struct Slot {
+				uint64_t key;
+				int		 index;
+				uint32_t stamp;
+			};
+
+			static uint64_t PairKey(const GameObject* a, const GameObject* b);
+
+			static size_t Hash(uint64_t key) {
+				key ^= key >> 33;
+				key *= 0xff51afd7ed558ccdULL;
+				key ^= key >> 33;
+				return (size_t)key;
+			}
+
+			bool IsUsed(size_t slot) const {
+				return slots[slot].stamp == stamp;
+			}
+
+			size_t FindSlot(uint64_t key) const;
+			void RemoveAt(size_t pairIndex);
+			void Grow();
+
+			std::vector<CollisionDetection::CollisionInfo>	pairs;
+			std::vector<uint64_t>							pairKeys;
+			std::vector<Slot>								slots;
+
+			size_t		mask;
+			uint32_t	stamp;
+		};
+	}
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include "../../Common/MemoryPool.h"
+
 namespace NCL {
 	enum class VolumeType {
 		AABB	= 1,
@@ -10,7 +12,7 @@ namespace NCL {
 		Invalid = 256
 	};
 
-	class CollisionVolume {
+	class CollisionVolume : public PooledObject {
 	public:
 		CollisionVolume(Vector3 offset = Vector3(0, 0, 0)) {
 			type = VolumeType::Invalid;
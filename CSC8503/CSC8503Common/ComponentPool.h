@@ -0,0 +1,162 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <new>
+#include "../../Common/MemoryTracker.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Every component of one type, side by side in chunks of ChunkSlots,
+		so a system can walk through all of them in memory order with
+		ForEach, rather than chasing pointers through each GameObject.
+		Freed slots are reused before the pool grows, and Reset rewinds it
+		once it's empty, so a new level's components start packed together
+		at the front again.
+
+		Only exactly a T fits in a slot - anything derived from one that's
+		bigger goes to the heap instead, and isn't seen by ForEach.
+
+		Chunks are counted by the MemoryTracker under the pool's own tag as
+		they're allocated, whatever the thread that needed them was doing.
+		*/
+		template<class T>
+		class ComponentPool {
+		public:
+			static ComponentPool& Get() {
+				//Never destroyed, as components might still be deleted while statics are being torn down
+				static ComponentPool* pool = new ComponentPool();
+				return *pool;
+			}
+
+			void SetMemoryTag(MemoryTag t) {
+				tag = t;
+			}
+
+			void* Allocate(size_t size) {
+				MemoryTagScope scope(tag);
+				if (size != sizeof(T)) {
+					return ::operator new(size);
+				}
+				std::lock_guard<std::mutex> lock(poolMutex);
+				int slot;
+				if (!freeSlots.empty()) {
+					slot = freeSlots.back();
+					freeSlots.pop_back();
+				}
+				else {
+					slot = highWater++;
+					if (slot / ChunkSlots == (int)chunks.size()) {
+						chunks.emplace_back(new Chunk());
+					}
+				}
+				Chunk* c = chunks[slot / ChunkSlots];
+				c->live[slot % ChunkSlots] = true;
+				liveCount++;
+				return c->slots[slot % ChunkSlots];
+			}
+
+			void Free(void* p) {
+				if (!p) {
+					return;
+				}
+				std::lock_guard<std::mutex> lock(poolMutex);
+				int slot = FindSlot(p);
+				if (slot < 0) {
+					::operator delete(p);
+					return;
+				}
+				chunks[slot / ChunkSlots]->live[slot % ChunkSlots] = false;
+				freeSlots.emplace_back(slot);
+				liveCount--;
+			}
+
+			//Does nothing, and returns false, if anything's still using the pool
+			bool Reset() {
+				std::lock_guard<std::mutex> lock(poolMutex);
+				if (liveCount > 0) {
+					return false;
+				}
+				freeSlots.clear();
+				highWater = 0;
+				return true;
+			}
+
+			//Not locked, so only for the thread that creates and deletes components
+			template<class F>
+			void ForEach(F func) {
+				for (int i = 0; i < highWater; ++i) {
+					Chunk* c = chunks[i / ChunkSlots];
+					if (c->live[i % ChunkSlots]) {
+						func(*(T*)c->slots[i % ChunkSlots]);
+					}
+				}
+			}
+
+			//The same, over slots first to last, so a ParallelFor can split the
+			//pool up between workers - so long as nothing allocates or frees meanwhile
+			template<class F>
+			void ForEachInRange(int first, int last, F func) {
+				last = last < highWater ? last : highWater;
+				for (int i = first; i < last; ++i) {
+					Chunk* c = chunks[i / ChunkSlots];
+					if (c->live[i % ChunkSlots]) {
+						func(*(T*)c->slots[i % ChunkSlots]);
+					}
+				}
+			}
+
+			//One past the last slot that's ever been used since the last Reset
+			int GetSlotCount() const {
+				return highWater;
+			}
+
+			int GetLiveCount() const {
+				return liveCount;
+			}
+
+			static const int ChunkSlots = 256;
+
+		protected:
+			ComponentPool() {
+				highWater = 0;
+				liveCount = 0;
+			}
+
+			struct Chunk {
+				alignas(T) unsigned char	slots[ChunkSlots][sizeof(T)];
+				bool						live[ChunkSlots] = { false };
+			};
+
+			int FindSlot(void* p) const {
+				unsigned char* c = (unsigned char*)p;
+				for (int i = 0; i < (int)chunks.size(); ++i) {
+					unsigned char* start = chunks[i]->slots[0];
+					if (c >= start && c < start + sizeof(chunks[i]->slots)) {
+						return i * ChunkSlots + (int)((c - start) / sizeof(T));
+					}
+				}
+				return -1;
+			}
+
+			std::vector<Chunk*>	chunks;
+			std::vector<int>	freeSlots;
+			int					highWater;	//no slot past this has been used since the last Reset
+			int					liveCount;
+			MemoryTag			tag = MemoryTag::General;
+			std::mutex			poolMutex;
+		};
+
+		//Anything deriving from this gets its new and delete from its own ComponentPool
+		template<class T>
+		class PooledComponent {
+		public:
+			static void* operator new(size_t size) {
+				return ComponentPool<T>::Get().Allocate(size);
+			}
+			static void operator delete(void* p) {
+				ComponentPool<T>::Get().Free(p);
+			}
+		};
+	}
+}
@@ -0,0 +1,132 @@
+#include "ConstraintSolver.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PositionConstraint.h"
+#include "JobSystem.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+ConstraintSolver::ConstraintSolver() {
+	builtVersion			= 0;
+	built					= false;
+	parallelMinConstraints	= 64;
+	batchSize				= 32;
+}
+
+void ConstraintSolver::Clear() {
+	constraints.clear();
+	colourStarts.clear();
+	otherConstraints.clear();
+	uncoloured.clear();
+	built = false;
+}
+
+void ConstraintSolver::Update(GameWorld& world) {
+	if (!built || builtVersion != world.GetConstraintVersion()) {
+		Rebuild(world);
+	}
+}
+
+/*
+A simple greedy colouring - each constraint takes the lowest colour that
+neither of its objects is already using. Ropes and chains only ever need
+two or three colours this way.
+*/
+void ConstraintSolver::Rebuild(GameWorld& world) {
+	Clear();
+	usedColours.clear();
+	for (auto& bucket : colourBuckets) {
+		bucket.clear();
+	}
+
+	std::vector<Constraint*>::const_iterator first;
+	std::vector<Constraint*>::const_iterator last;
+	world.GetConstraintIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		PositionConstraint* c = dynamic_cast<PositionConstraint*>(*i);
+		if (!c) {
+			otherConstraints.emplace_back(*i);
+			continue;
+		}
+		GameObject* a = c->GetObjectA();
+		GameObject* b = c->GetObjectB();
+
+		PositionConstraintData data;
+		data.physA		= a->GetPhysicsObject();
+		data.physB		= b->GetPhysicsObject();
+		data.transformA	= &a->GetTransform();
+		data.transformB	= &b->GetTransform();
+		data.distance	= c->GetDistance();
+
+		uint64_t& coloursA = usedColours[a];
+		uint64_t& coloursB = usedColours[b];
+		uint64_t taken = coloursA | coloursB;
+
+		int colour = 0;
+		while (colour < MaxColours && (taken & ((uint64_t)1 << colour))) {
+			colour++;
+		}
+		if (colour == MaxColours) {
+			uncoloured.emplace_back(data);
+			continue;
+		}
+		coloursA |= (uint64_t)1 << colour;
+		coloursB |= (uint64_t)1 << colour;
+
+		if ((int)colourBuckets.size() <= colour) {
+			colourBuckets.resize(colour + 1);
+		}
+		colourBuckets[colour].emplace_back(data);
+	}
+
+	colourStarts.emplace_back(0);
+	for (auto& bucket : colourBuckets) {
+		if (bucket.empty()) {
+			continue;
+		}
+		constraints.insert(constraints.end(), bucket.begin(), bucket.end());
+		colourStarts.emplace_back((int)constraints.size());
+	}
+
+	builtVersion	= world.GetConstraintVersion();
+	built			= true;
+}
+
+void ConstraintSolver::SolveRange(int first, int last, float dt) {
+	for (int i = first; i < last; ++i) {
+		const PositionConstraintData& c = constraints[i];
+		PositionConstraint::Solve(c.physA, c.physB,
+			c.transformA->GetPosition(), c.transformB->GetPosition(), c.distance, dt);
+	}
+}
+
+void ConstraintSolver::Solve(float dt) {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+
+	for (int colour = 0; colour + 1 < (int)colourStarts.size(); ++colour) {
+		int first	= colourStarts[colour];
+		int last	= colourStarts[colour + 1];
+
+		if (jobs && last - first >= parallelMinConstraints) {
+			jobs->ParallelFor(last - first, batchSize,
+				[&](int start, int end, int worker) {
+					SolveRange(first + start, first + end, dt);
+				}
+			);
+		}
+		else {
+			SolveRange(first, last, dt);
+		}
+	}
+
+	for (const PositionConstraintData& c : uncoloured) {
+		PositionConstraint::Solve(c.physA, c.physB,
+			c.transformA->GetPosition(), c.transformB->GetPosition(), c.distance, dt);
+	}
+
+	for (Constraint* c : otherConstraints) {
+		c->UpdateConstraint(dt);
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameWorld;
+		class GameObject;
+		class PhysicsObject;
+		class Transform;
+		class Constraint;
+
+		/*
+		Solves the world's PositionConstraints in batches. The constraints are
+		copied into a flat array and coloured, so that no two constraints of
+		the same colour share an object - each colour can then be solved across
+		the job system with no locking, one after the other. Any other kind of
+		constraint is still updated one at a time through its virtual function.
+
+		The batches are only rebuilt when the world's constraint list changes.
+		*/
+		class ConstraintSolver {
+		public:
+			ConstraintSolver();
+			~ConstraintSolver() {}
+
+			void Clear();
+
+			void Update(GameWorld& world);
+			void Solve(float dt);
+
+			int GetColourCount() const {
+				return (int)colourStarts.size() - 1;
+			}
+
+		protected:
+			struct PositionConstraintData {
+				PhysicsObject*	physA;
+				PhysicsObject*	physB;
+				Transform*		transformA;
+				Transform*		transformB;
+				float			distance;
+			};
+
+			void Rebuild(GameWorld& world);
+			void SolveRange(int first, int last, float dt);
+
+			//Constraints on the same object can't be coloured more than this many
+			//ways, anything past this goes into a final batch that is solved serially
+			static const int MaxColours = 64;
+
+			std::vector<PositionConstraintData>	constraints;
+			std::vector<int>					colourStarts;
+			std::vector<Constraint*>			otherConstraints;
+
+			std::vector<PositionConstraintData>			uncoloured;
+			std::vector<std::vector<PositionConstraintData>> colourBuckets;
+			std::unordered_map<GameObject*, uint64_t>	usedColours;
+
+			int		builtVersion;
+			bool	built;
+			int		parallelMinConstraints;
+			int		batchSize;
+		};
+	}
+}
@@ -0,0 +1,316 @@
+#include "ContactSolver.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+ContactSolver::ContactSolver() {
+	stepCount		= 0;
+	iterationCount	= 8;
+
+	baumgarte				= 0.2f;
+	penetrationSlop			= 0.01f;
+	restitutionThreshold	= 1.0f;
+	matchDistance			= 0.1f;
+	breakDistance			= 0.1f;
+}
+
+void ContactSolver::Clear() {
+	manifolds.clear();
+	manifoldLookup.clear();
+}
+
+void ContactSolver::BeginStep() {
+	stepCount++;
+}
+
+uint64_t ContactSolver::PairKey(const GameObject* a, const GameObject* b) {
+	uint32_t idA = (uint32_t)a->GetWorldID();
+	uint32_t idB = (uint32_t)b->GetWorldID();
+	if (idA > idB) {
+		uint32_t temp = idA;
+		idA = idB;
+		idB = temp;
+	}
+	return ((uint64_t)idA << 32) | (uint64_t)idB;
+}
+
+void ContactSolver::AddContact(const CollisionDetection::CollisionInfo& info) {
+	PhysicsObject* physA = info.a->GetPhysicsObject();
+	PhysicsObject* physB = info.b->GetPhysicsObject();
+	if (physA->GetInverseMass() + physB->GetInverseMass() == 0.0f) {
+		return;
+	}
+
+	uint64_t key = PairKey(info.a, info.b);
+	auto found = manifoldLookup.find(key);
+	if (found == manifoldLookup.end()) {
+		ContactManifold m;
+		m.a			= info.a;
+		m.b			= info.b;
+		m.key		= key;
+		m.normal	= info.point.normal;
+		m.numPoints = 0;
+
+		m.friction			= physA->GetFriction() * physB->GetFriction();
+		m.restitution		= (physA->GetElasticity() + physB->GetElasticity()) / 2;
+		m.linearFriction	= physA->ApplyLinearFriction() && physB->ApplyLinearFriction();
+		m.angularFriction	= physA->ApplyAngularFriction() && physB->ApplyAngularFriction();
+
+		manifoldLookup[key] = manifolds.size();
+		manifolds.emplace_back(m);
+		found = manifoldLookup.find(key);
+	}
+	ContactManifold& m = manifolds[found->second];
+	m.lastStep = stepCount;
+
+	//Some of the intersection tests swap the objects around, so make sure
+	//the contact is from the manifold's point of view
+	if (info.a == m.a) {
+		AddPoint(m, info);
+	}
+	else {
+		CollisionDetection::CollisionInfo flipped = info;
+		flipped.a = info.b;
+		flipped.b = info.a;
+		flipped.point.localA = info.point.localB;
+		flipped.point.localB = info.point.localA;
+		flipped.point.normal = -info.point.normal;
+		AddPoint(m, flipped);
+	}
+}
+
+/*
+A new contact that lands close to one we already know about is treated as
+the same point, so it keeps its accumulated impulse. Otherwise it's added,
+and once the manifold is full it replaces whichever point is nearest to it,
+other than the deepest one, which keeps the points spread out.
+*/
+void ContactSolver::AddPoint(ContactManifold& m, const CollisionDetection::CollisionInfo& info) {
+	if (Vector3::Dot(m.normal, info.point.normal) < 0.9f) {
+		m.numPoints = 0; //the objects have rotated too far for the old points to be useful
+	}
+	m.normal = info.point.normal;
+
+	Transform& transformA = m.a->GetTransform();
+	Transform& transformB = m.b->GetTransform();
+	Quaternion orientationA = transformA.GetOrientation();
+	Quaternion orientationB = transformB.GetOrientation();
+
+	Vector3 worldA = transformA.GetPosition() + info.point.localA;
+	Vector3 worldB = transformB.GetPosition() + info.point.localB;
+
+	ManifoldPoint fresh;
+	fresh.anchorA			= orientationA.Conjugate() * info.point.localA;
+	fresh.anchorB			= orientationB.Conjugate() * info.point.localB;
+	fresh.startDelta		= worldA - worldB;
+	fresh.startPenetration	= info.point.penetration;
+	fresh.penetration		= info.point.penetration;
+	fresh.normalImpulse		= 0.0f;
+	fresh.tangentImpulse[0] = 0.0f;
+	fresh.tangentImpulse[1] = 0.0f;
+
+	float matchSq	= matchDistance * matchDistance;
+	int closest		= -1;
+	float closestSq = 0.0f;
+	int deepest		= 0;
+	for (int i = 0; i < m.numPoints; ++i) {
+		ManifoldPoint& p = m.points[i];
+		Vector3 pointA = transformA.GetPosition() + (orientationA * p.anchorA);
+		float distSq = (pointA - worldA).LengthSquared();
+		if (distSq < matchSq) {
+			fresh.normalImpulse		= p.normalImpulse;
+			fresh.tangentImpulse[0] = p.tangentImpulse[0];
+			fresh.tangentImpulse[1] = p.tangentImpulse[1];
+			p = fresh;
+			return;
+		}
+		if (p.penetration > m.points[deepest].penetration) {
+			deepest = i;
+		}
+		if (closest < 0 || distSq < closestSq) {
+			closest		= i;
+			closestSq	= distSq;
+		}
+	}
+
+	if (m.numPoints < MaxManifoldPoints) {
+		m.points[m.numPoints++] = fresh;
+		return;
+	}
+	if (closest == deepest) {
+		closestSq = 0.0f;
+		closest = -1;
+		for (int i = 0; i < m.numPoints; ++i) {
+			if (i == deepest) {
+				continue;
+			}
+			Vector3 pointA = transformA.GetPosition() + (orientationA * m.points[i].anchorA);
+			float distSq = (pointA - worldA).LengthSquared();
+			if (closest < 0 || distSq < closestSq) {
+				closest		= i;
+				closestSq	= distSq;
+			}
+		}
+	}
+	m.points[closest] = fresh;
+}
+
+/*
+The penetration of an old point is estimated from how far its two anchors
+have moved relative to each other since it was found. Points that have
+separated, or slid too far, are no longer touching and get dropped.
+*/
+bool ContactSolver::RefreshPoint(const ContactManifold& m, ManifoldPoint& p) const {
+	Transform& transformA = m.a->GetTransform();
+	Transform& transformB = m.b->GetTransform();
+
+	p.relativeA = transformA.GetOrientation() * p.anchorA;
+	p.relativeB = transformB.GetOrientation() * p.anchorB;
+
+	Vector3 delta	= (transformA.GetPosition() + p.relativeA) - (transformB.GetPosition() + p.relativeB);
+	Vector3 change	= delta - p.startDelta;
+
+	float normalChange	= Vector3::Dot(change, m.normal);
+	Vector3 drift		= change - (m.normal * normalChange);
+
+	p.penetration = p.startPenetration + normalChange;
+
+	return p.penetration > -breakDistance && drift.LengthSquared() < breakDistance * breakDistance;
+}
+
+void ContactSolver::RemoveManifold(size_t index) {
+	manifoldLookup.erase(manifolds[index].key);
+	size_t last = manifolds.size() - 1;
+	if (index != last) {
+		manifolds[index] = manifolds[last];
+		manifoldLookup[manifolds[index].key] = index;
+	}
+	manifolds.pop_back();
+}
+
+//Kinematic bodies act as if they had infinite mass - they push, but aren't pushed
+void ContactSolver::ApplyImpulse(PhysicsObject* object, const Vector3& relativePos, const Vector3& impulse, bool linear, bool angular) {
+	if (object->IsKinematic()) {
+		return;
+	}
+	if (linear) {
+		object->ApplyLinearImpulse(impulse);
+	}
+	if (angular) {
+		object->ApplyAngularImpulse(Vector3::Cross(relativePos, impulse));
+	}
+}
+
+float ContactSolver::EffectiveMass(PhysicsObject* a, PhysicsObject* b, const Vector3& relativeA, const Vector3& relativeB, const Vector3& dir) {
+	Vector3 inertiaA = a->IsKinematic() ? Vector3() : Vector3::Cross(a->GetInertiaTensor() * Vector3::Cross(relativeA, dir), relativeA);
+	Vector3 inertiaB = b->IsKinematic() ? Vector3() : Vector3::Cross(b->GetInertiaTensor() * Vector3::Cross(relativeB, dir), relativeB);
+
+	float invMassA = a->IsKinematic() ? 0.0f : a->GetInverseMass();
+	float invMassB = b->IsKinematic() ? 0.0f : b->GetInverseMass();
+
+	float k = invMassA + invMassB + Vector3::Dot(inertiaA + inertiaB, dir);
+	return k > 0.0f ? 1.0f / k : 0.0f;
+}
+
+void ContactSolver::PreStep(float dt) {
+	for (size_t i = manifolds.size(); i-- > 0; ) {
+		if (manifolds[i].lastStep != stepCount) {
+			RemoveManifold(i);
+		}
+	}
+
+	for (ContactManifold& m : manifolds) {
+		PhysicsObject* physA = m.a->GetPhysicsObject();
+		PhysicsObject* physB = m.b->GetPhysicsObject();
+
+		//Any two directions perpendicular to the normal will do for friction
+		Vector3 axis = fabs(m.normal.x) < 0.57f ? Vector3(1, 0, 0) : Vector3(0, 1, 0);
+		m.tangents[0] = Vector3::Cross(m.normal, axis).Normalised();
+		m.tangents[1] = Vector3::Cross(m.normal, m.tangents[0]);
+
+		int kept = 0;
+		for (int i = 0; i < m.numPoints; ++i) {
+			if (RefreshPoint(m, m.points[i])) {
+				m.points[kept++] = m.points[i];
+			}
+		}
+		m.numPoints = kept;
+
+		for (int i = 0; i < m.numPoints; ++i) {
+			ManifoldPoint& p = m.points[i];
+
+			p.normalMass		= EffectiveMass(physA, physB, p.relativeA, p.relativeB, m.normal);
+			p.tangentMass[0]	= EffectiveMass(physA, physB, p.relativeA, p.relativeB, m.tangents[0]);
+			p.tangentMass[1]	= EffectiveMass(physA, physB, p.relativeA, p.relativeB, m.tangents[1]);
+
+			Vector3 velocityA		= physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.relativeA);
+			Vector3 velocityB		= physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.relativeB);
+			float normalVelocity	= Vector3::Dot(velocityB - velocityA, m.normal);
+
+			float depth = p.penetration - penetrationSlop;
+			p.bias = depth > 0.0f ? (baumgarte / dt) * depth : 0.0f;
+			if (normalVelocity < -restitutionThreshold) {
+				p.bias -= m.restitution * normalVelocity;
+			}
+
+			//Warm start from whatever held this point in place last step
+			Vector3 normalImpulse = m.normal * p.normalImpulse;
+			ApplyImpulse(physA, p.relativeA, -normalImpulse, true, true);
+			ApplyImpulse(physB, p.relativeB, normalImpulse, true, true);
+
+			Vector3 frictionImpulse = m.tangents[0] * p.tangentImpulse[0] + m.tangents[1] * p.tangentImpulse[1];
+			ApplyImpulse(physA, p.relativeA, -frictionImpulse, m.linearFriction, m.angularFriction);
+			ApplyImpulse(physB, p.relativeB, frictionImpulse, m.linearFriction, m.angularFriction);
+		}
+	}
+}
+
+void ContactSolver::SolveVelocities() {
+	for (ContactManifold& m : manifolds) {
+		PhysicsObject* physA = m.a->GetPhysicsObject();
+		PhysicsObject* physB = m.b->GetPhysicsObject();
+
+		for (int i = 0; i < m.numPoints; ++i) {
+			ManifoldPoint& p = m.points[i];
+
+			if (m.linearFriction || m.angularFriction) {
+				for (int t = 0; t < 2; ++t) {
+					Vector3 velocityA = physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.relativeA);
+					Vector3 velocityB = physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.relativeB);
+
+					float tangentVelocity	= Vector3::Dot(velocityB - velocityA, m.tangents[t]);
+					float lambda			= -tangentVelocity * p.tangentMass[t];
+
+					//Friction can't push harder than the contact is being held together
+					float maxFriction	= m.friction * p.normalImpulse;
+					float oldImpulse	= p.tangentImpulse[t];
+					float newImpulse	= oldImpulse + lambda;
+					newImpulse			= newImpulse > maxFriction ? maxFriction : (newImpulse < -maxFriction ? -maxFriction : newImpulse);
+					p.tangentImpulse[t] = newImpulse;
+
+					Vector3 impulse = m.tangents[t] * (newImpulse - oldImpulse);
+					ApplyImpulse(physA, p.relativeA, -impulse, m.linearFriction, m.angularFriction);
+					ApplyImpulse(physB, p.relativeB, impulse, m.linearFriction, m.angularFriction);
+				}
+			}
+
+			Vector3 velocityA = physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.relativeA);
+			Vector3 velocityB = physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.relativeB);
+
+			float normalVelocity	= Vector3::Dot(velocityB - velocityA, m.normal);
+			float lambda			= p.normalMass * (-normalVelocity + p.bias);
+
+			//The total impulse can only ever push the objects apart
+			float oldImpulse	= p.normalImpulse;
+			float newImpulse	= oldImpulse + lambda;
+			p.normalImpulse		= newImpulse > 0.0f ? newImpulse : 0.0f;
+
+			Vector3 impulse = m.normal * (p.normalImpulse - oldImpulse);
+			ApplyImpulse(physA, p.relativeA, -impulse, true, true);
+			ApplyImpulse(physB, p.relativeB, impulse, true, true);
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class PhysicsObject;
+
+		/*
+		A sequential impulse contact solver. Rather than pushing objects apart
+		as soon as the narrowphase finds them overlapping, contacts are gathered
+		into a manifold per pair of objects, which keeps up to four points alive
+		across substeps. Each point remembers the impulse that was needed to
+		hold it last step, and starts from that next time (warm starting), so a
+		stack of boxes settles within a few iterations instead of a few seconds.
+
+		Penetration is fixed up by adding a small bias to the contact velocity,
+		rather than by moving the objects directly.
+		*/
+		class ContactSolver {
+		public:
+			ContactSolver();
+			~ContactSolver() {}
+
+			void Clear();
+
+			//Call before the narrowphase adds this substep's contacts
+			void BeginStep();
+
+			void AddContact(const CollisionDetection::CollisionInfo& info);
+
+			//Drops manifolds that weren't touched this step, refreshes the rest,
+			//and applies last step's impulses
+			void PreStep(float dt);
+			void SolveVelocities();
+
+			void SetIterationCount(int count) {
+				iterationCount = count;
+			}
+
+			int GetIterationCount() const {
+				return iterationCount;
+			}
+
+			int GetManifoldCount() const {
+				return (int)manifolds.size();
+			}
+
+		protected:
+			static const int MaxManifoldPoints = 4;
+
+			struct ManifoldPoint {
+				Vector3 anchorA; //in each object's local space
+				Vector3 anchorB;
+				Vector3 startDelta;
+				float	startPenetration;
+
+				Vector3 relativeA; //world space offsets, worked out each step
+				Vector3 relativeB;
+				float	penetration;
+
+				float	normalImpulse;
+				float	tangentImpulse[2];
+
+				float	normalMass;
+				float	tangentMass[2];
+				float	bias;
+			};
+
+			struct ContactManifold {
+				GameObject* a;
+				GameObject* b;
+				uint64_t	key;
+				int			lastStep;
+
+				Vector3		normal;
+				Vector3		tangents[2];
+				float		friction;
+				float		restitution;
+				bool		linearFriction;
+				bool		angularFriction;
+
+				ManifoldPoint points[MaxManifoldPoints];
+				int			numPoints;
+			};
+
+			static uint64_t PairKey(const GameObject* a, const GameObject* b);
+
+			void AddPoint(ContactManifold& m, const CollisionDetection::CollisionInfo& info);
+			bool RefreshPoint(const ContactManifold& m, ManifoldPoint& p) const;
+			void RemoveManifold(size_t index);
+
+			static void ApplyImpulse(PhysicsObject* object, const Vector3& relativePos, const Vector3& impulse, bool linear, bool angular);
+			static float EffectiveMass(PhysicsObject* a, PhysicsObject* b, const Vector3& relativeA, const Vector3& relativeB, const Vector3& dir);
+
+			std::vector<ContactManifold>			manifolds;
+			std::unordered_map<uint64_t, size_t>	manifoldLookup;
+
+			int		stepCount;
+			int		iterationCount;
+
+			float	baumgarte;
+			float	penetrationSlop;
+			float	restitutionThreshold;
+			float	matchDistance;
+			float	breakDistance;
+		};
+	}
+}
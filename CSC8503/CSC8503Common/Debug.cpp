@@ -1,5 +1,7 @@
 #include "Debug.h"
 #include "../../Common/Matrix4.h"
+#include "../../Common/Maths.h"
+#include "JobSystem.h"
 
 #include <iomanip>
 #include <windows.h>
@@ -13,6 +15,9 @@ Debug* Debug::instance = nullptr;
 
 std::vector<Debug::DebugStringEntry>	Debug::stringEntries;
 std::vector<Debug::DebugLineEntry>		Debug::lineEntries;
+std::vector<Debug::DebugWireEntry>		Debug::wireEntries;
+std::mutex								Debug::lineMutex;
+float									Debug::debugTime = 0.0f;
 
 const Vector4 Debug::RED	= Vector4(1, 0, 0, 1);
 const Vector4 Debug::GREEN	= Vector4(0, 1, 0, 1);
@@ -37,6 +42,27 @@ void Debug::Print(const std::string& text, const Vector2&pos, const Vector4& col
 }
 
 void Debug::DrawLine(const Vector3& startpoint, const Vector3& endpoint, const Vector4& colour, float time) {
+	//Physics can be running on a worker while the last frame's being drawn, so its lines always queue up
+	bool onWorker = CSC8503::JobSystem::GetWorkerIndex() != 0;
+	if (time <= 0.0f && onWorker) {
+		if (!instance || !instance->isActive || !instance->showCollisionVolumes) {
+			return;
+		}
+	}
+	else if (time <= 0.0f) {
+		//Lines that only last a frame go straight to the renderer, rather than queuing up for FlushRenderables
+		if (renderer && instance && instance->isActive && instance->showCollisionVolumes) {
+			renderer->DrawLine(startpoint, endpoint, colour);
+		}
+		return;
+	}
+	else if (!onWorker) {
+		//Lines with a time are only sent the once, and the renderer keeps them until they run out
+		if (renderer) {
+			renderer->DrawTimedLine(startpoint, endpoint, colour, debugTime + time);
+		}
+		return;
+	}
 	DebugLineEntry newEntry;
 
 	newEntry.start	= startpoint;
@@ -44,6 +70,7 @@ void Debug::DrawLine(const Vector3& startpoint, const Vector3& endpoint, const V
 	newEntry.colour = colour;
 	newEntry.time	= time;
 
+	std::lock_guard<std::mutex> lock(lineMutex);
 	lineEntries.emplace_back(newEntry);
 }
 
@@ -82,238 +109,43 @@ void NCL::Debug::DrawCollider(GameObject* g, const Vector4& colour) {
 	}
 }
 
+//Only drawn straight away from the main thread, like DrawLine's lines
+void Debug::DrawWireShape(OGLRenderer::WireShape shape, const Matrix4& transform, const Vector4& colour) {
+	if (!renderer || !instance || !instance->isActive) {
+		return;
+	}
+	if (CSC8503::JobSystem::GetWorkerIndex() == 0) {
+		renderer->DrawWireShape(shape, transform, colour);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(lineMutex);
+	wireEntries.push_back({ transform, colour, shape });
+}
+
 void NCL::Debug::DrawAABBCollider(const Transform& worldTransform, const AABBVolume& volume, const Vector4& colour) {
 	Vector3 center = worldTransform.GetPosition() + volume.GetOffset();
-	Vector3 corners[8] = {
-		center + volume.GetHalfDimensions() * Vector3(1, 1, 1),
-		center + volume.GetHalfDimensions() * Vector3(1, -1, 1),
-		center + volume.GetHalfDimensions() * Vector3(1, -1, -1),
-		center + volume.GetHalfDimensions() * Vector3(1, 1, -1),
-		center + volume.GetHalfDimensions() * Vector3(-1, 1, 1),
-		center + volume.GetHalfDimensions() * Vector3(-1, -1, 1),
-		center + volume.GetHalfDimensions() * Vector3(-1, -1, -1),
-		center + volume.GetHalfDimensions() * Vector3(-1, 1, -1),
-	};
-
-	DrawLine(corners[0], corners[1], colour);
-	DrawLine(corners[1], corners[2], colour);
-	DrawLine(corners[2], corners[3], colour);
-	DrawLine(corners[3], corners[0], colour);
-	DrawLine(corners[0], corners[4], colour);
-	DrawLine(corners[4], corners[7], colour);
-	DrawLine(corners[7], corners[3], colour);
-	DrawLine(corners[7], corners[3], colour);
-	DrawLine(corners[7], corners[6], colour);
-	DrawLine(corners[6], corners[2], colour);
-	DrawLine(corners[1], corners[5], colour);
-	DrawLine(corners[4], corners[5], colour);
-	DrawLine(corners[6], corners[5], colour);
+	DrawWireShape(OGLRenderer::WireShape::Box, Matrix4::Translation(center) * Matrix4::Scale(volume.GetHalfDimensions()), colour);
 }
 
 void NCL::Debug::DrawOBBCollider(const Transform& worldTransform, const OBBVolume& volume, const Vector4& colour) {
 	Vector3 center = worldTransform.GetPosition() + volume.GetOffset();
-	Vector3 corners[8] = {
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(1, 1, 1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(1, -1, 1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(1, -1, -1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(1, 1, -1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(-1, 1, 1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(-1, -1, 1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(-1, -1, -1)),
-		center + volume.GetHalfDimensions() * (worldTransform.GetOrientation() * Vector3(-1, 1, -1)),
-	};
-
-	DrawLine(corners[0], corners[1], colour);
-	DrawLine(corners[1], corners[2], colour);
-	DrawLine(corners[2], corners[3], colour);
-	DrawLine(corners[3], corners[0], colour);
-	DrawLine(corners[0], corners[4], colour);
-	DrawLine(corners[4], corners[7], colour);
-	DrawLine(corners[7], corners[3], colour);
-	DrawLine(corners[7], corners[3], colour);
-	DrawLine(corners[7], corners[6], colour);
-	DrawLine(corners[6], corners[2], colour);
-	DrawLine(corners[1], corners[5], colour);
-	DrawLine(corners[4], corners[5], colour);
-	DrawLine(corners[6], corners[5], colour);
+	DrawWireShape(OGLRenderer::WireShape::Box, Matrix4::Translation(center) * Matrix4(worldTransform.GetOrientation()) * Matrix4::Scale(volume.GetHalfDimensions()), colour);
 }
 
 void NCL::Debug::DrawSphereCollider(const Transform& worldTransform, const SphereVolume& volume, const Vector4& colour) {
-	Vector3 center = worldTransform.GetPosition() + volume.GetOffset();
-
-	Vector3 points[30] = {
-		center + Vector3(0, 1, 0) * volume.GetRadius(),
-
-		center + Vector3(0.25, 0.75, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(0.5, 0.5, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(0.75, 0.25, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(1, 0, 0) * volume.GetRadius(),
-
-		center + Vector3(-0.25, 0.75, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(-0.5, 0.5, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(-0.75, 0.25, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(-1, 0, 0) * volume.GetRadius(),
-
-		center + Vector3(0, 0.75, 0.25).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0.5, 0.5).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0.25, 0.75).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0, 1) * volume.GetRadius(),
-
-		center + Vector3(0, 0.75, -0.25).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0.5, -0.5).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0.25, -0.75).Normalised() * volume.GetRadius(),
-		center + Vector3(0, 0, -1) * volume.GetRadius(),
-
-		center + Vector3(0, -1, 0) * volume.GetRadius(),
-
-		center + Vector3(0.25, -0.75, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(0.5, -0.5, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(0.75, -0.25, 0).Normalised() * volume.GetRadius(),
-
-		center + Vector3(-0.25, -0.75, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(-0.5, -0.5, 0).Normalised() * volume.GetRadius(),
-		center + Vector3(-0.75, -0.25, 0).Normalised() * volume.GetRadius(),
-
-		center + Vector3(0, -0.75, 0.25).Normalised() * volume.GetRadius(),
-		center + Vector3(0, -0.5, 0.5).Normalised() * volume.GetRadius(),
-		center + Vector3(0, -0.25, 0.75).Normalised() * volume.GetRadius(),
-
-		center + Vector3(0, -0.75, -0.25).Normalised() * volume.GetRadius(),
-		center + Vector3(0, -0.5, -0.5).Normalised() * volume.GetRadius(),
-		center + Vector3(0, -0.25, -0.75).Normalised() * volume.GetRadius(),
-
-	};
-
-	DrawLine(points[0], points[1], colour);
-	DrawLine(points[1], points[2], colour);
-	DrawLine(points[2], points[3], colour);
-	DrawLine(points[3], points[4], colour);
-
-	DrawLine(points[0], points[5], colour);
-	DrawLine(points[5], points[6], colour);
-	DrawLine(points[6], points[7], colour);
-	DrawLine(points[7], points[8], colour);
-
-	DrawLine(points[0], points[9], colour);
-	DrawLine(points[9], points[10], colour);
-	DrawLine(points[10], points[11], colour);
-	DrawLine(points[11], points[12], colour);
-
-	DrawLine(points[0], points[13], colour);
-	DrawLine(points[13], points[14], colour);
-	DrawLine(points[14], points[15], colour);
-	DrawLine(points[15], points[16], colour);
-
-	DrawLine(points[17], points[18], colour);
-	DrawLine(points[18], points[19], colour);
-	DrawLine(points[19], points[20], colour);
-	DrawLine(points[20], points[4], colour);
-
-	DrawLine(points[17], points[21], colour);
-	DrawLine(points[21], points[22], colour);
-	DrawLine(points[22], points[23], colour);
-	DrawLine(points[23], points[8], colour);
-
-	DrawLine(points[17], points[24], colour);
-	DrawLine(points[24], points[25], colour);
-	DrawLine(points[25], points[26], colour);
-	DrawLine(points[26], points[12], colour);
-
-	DrawLine(points[17], points[27], colour);
-	DrawLine(points[27], points[28], colour);
-	DrawLine(points[28], points[29], colour);
-	DrawLine(points[29], points[16], colour);
-
+	Vector3 center	= worldTransform.GetPosition() + volume.GetOffset();
+	float radius	= volume.GetRadius();
+	DrawWireShape(OGLRenderer::WireShape::Hemisphere, Matrix4::Translation(center) * Matrix4::Scale(Vector3(radius, radius, radius)), colour);
+	DrawWireShape(OGLRenderer::WireShape::Hemisphere, Matrix4::Translation(center) * Matrix4::Scale(Vector3(radius, -radius, radius)), colour);
 }
 
 void NCL::Debug::DrawCapsuleCollider(const Transform& worldTransform, const CapsuleVolume& volume, const Vector4& colour) {
-	Vector3 center = worldTransform.GetPosition() + volume.GetOffset();
-	Vector3 top = center + Vector3(0, volume.GetHalfHeight() - volume.GetRadius(), 0);
-	Vector3 bottom = center - Vector3(0, volume.GetHalfHeight() - volume.GetRadius(), 0);
-
-	Vector3 points[30] = {
-		top + Vector3(0, 1, 0) * volume.GetRadius(),
-
-		top + Vector3(0.25, 0.75, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(0.5, 0.5, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(0.75, 0.25, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(1, 0, 0) * volume.GetRadius(),
-
-		top + Vector3(-0.25, 0.75, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(-0.5, 0.5, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(-0.75, 0.25, 0).Normalised() * volume.GetRadius(),
-		top + Vector3(-1, 0, 0) * volume.GetRadius(),
-
-		top + Vector3(0, 0.75, 0.25).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0.5, 0.5).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0.25, 0.75).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0, 1) * volume.GetRadius(),
-
-		top + Vector3(0, 0.75, -0.25).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0.5, -0.5).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0.25, -0.75).Normalised() * volume.GetRadius(),
-		top + Vector3(0, 0, -1) * volume.GetRadius(),
-
-		bottom + Vector3(0, -1, 0) * volume.GetRadius(),
-
-		bottom + Vector3(0.25, -0.75, 0).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0.5, -0.5, 0).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0.75, -0.25, 0).Normalised() * volume.GetRadius(),
-
-		bottom + Vector3(-0.25, -0.75, 0).Normalised() * volume.GetRadius(),
-		bottom + Vector3(-0.5, -0.5, 0).Normalised() * volume.GetRadius(),
-		bottom + Vector3(-0.75, -0.25, 0).Normalised() * volume.GetRadius(),
-
-		bottom + Vector3(0, -0.75, 0.25).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0, -0.5, 0.5).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0, -0.25, 0.75).Normalised() * volume.GetRadius(),
-
-		bottom + Vector3(0, -0.75, -0.25).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0, -0.5, -0.5).Normalised() * volume.GetRadius(),
-		bottom + Vector3(0, -0.25, -0.75).Normalised() * volume.GetRadius(),
-
-	};
-
-	DrawLine(points[0], points[1], colour);
-	DrawLine(points[1], points[2], colour);
-	DrawLine(points[2], points[3], colour);
-	DrawLine(points[3], points[4], colour);
-
-	DrawLine(points[0], points[5], colour);
-	DrawLine(points[5], points[6], colour);
-	DrawLine(points[6], points[7], colour);
-	DrawLine(points[7], points[8], colour);
-
-	DrawLine(points[0], points[9], colour);
-	DrawLine(points[9], points[10], colour);
-	DrawLine(points[10], points[11], colour);
-	DrawLine(points[11], points[12], colour);
-
-	DrawLine(points[0], points[13], colour);
-	DrawLine(points[13], points[14], colour);
-	DrawLine(points[14], points[15], colour);
-	DrawLine(points[15], points[16], colour);
-
-	DrawLine(points[17], points[18], colour);
-	DrawLine(points[18], points[19], colour);
-	DrawLine(points[19], points[20], colour);
-	DrawLine(points[20], points[4], colour);
-
-	DrawLine(points[17], points[21], colour);
-	DrawLine(points[21], points[22], colour);
-	DrawLine(points[22], points[23], colour);
-	DrawLine(points[23], points[8], colour);
-
-	DrawLine(points[17], points[24], colour);
-	DrawLine(points[24], points[25], colour);
-	DrawLine(points[25], points[26], colour);
-	DrawLine(points[26], points[12], colour);
-
-	DrawLine(points[17], points[27], colour);
-	DrawLine(points[27], points[28], colour);
-	DrawLine(points[28], points[29], colour);
-	DrawLine(points[29], points[16], colour);
-
+	Vector3 center	= worldTransform.GetPosition() + volume.GetOffset();
+	float radius	= volume.GetRadius();
+	float sides		= volume.GetHalfHeight() - radius;
+	DrawWireShape(OGLRenderer::WireShape::Hemisphere, Matrix4::Translation(center + Vector3(0, sides, 0)) * Matrix4::Scale(Vector3(radius, radius, radius)), colour);
+	DrawWireShape(OGLRenderer::WireShape::Hemisphere, Matrix4::Translation(center - Vector3(0, sides, 0)) * Matrix4::Scale(Vector3(radius, -radius, radius)), colour);
+	DrawWireShape(OGLRenderer::WireShape::CapsuleSides, Matrix4::Translation(center) * Matrix4::Scale(Vector3(radius, sides, radius)), colour);
 }
 
 void NCL::Debug::UpdateInfo(float dt) {
@@ -323,6 +155,7 @@ void NCL::Debug::UpdateInfo(float dt) {
 }
 
 void Debug::FlushRenderables(float dt) {
+	debugTime += dt;
 	if (!renderer || !instance || !instance->isActive) {
 		return;
 	}
@@ -332,26 +165,25 @@ void Debug::FlushRenderables(float dt) {
 	if (instance->selectedObject) {
 		DrawCollider(instance->selectedObject, Debug::RED);
 	}
-	if (!instance->showCollisionVolumes) {
-		return;
+	std::lock_guard<std::mutex> lock(lineMutex);
+	for (const DebugWireEntry& w : wireEntries) {
+		renderer->DrawWireShape(w.shape, w.transform, w.colour);
 	}
-	int trim = 0;
-	for (int i = 0; i < lineEntries.size(); ) {
-		DebugLineEntry* e = &lineEntries[i]; 
-		renderer->DrawLine(e->start, e->end, e->colour);
-		e->time -= dt;
-		if (e->time < 0) {			
-			trim++;				
-			lineEntries[i] = lineEntries[lineEntries.size() - trim];
+	wireEntries.clear();
+	//Timed ones go in the renderer's ring now, so nothing here lasts past this frame
+	for (const DebugLineEntry& e : lineEntries) {
+		if (e.time > 0.0f) {
+			renderer->DrawTimedLine(e.start, e.end, e.colour, debugTime + e.time);
 		}
-		else {
-			++i;
-		}		
-		if (i + trim >= lineEntries.size()) {
-			break;
+		else if (instance->showCollisionVolumes) {
+			renderer->DrawLine(e.start, e.end, e.colour);
 		}
 	}
-	lineEntries.resize(lineEntries.size() - trim);
+	lineEntries.clear();
+	if (!instance->showCollisionVolumes) {
+		return;
+	}
+	renderer->SetTimedLineTime(debugTime);
 
 	stringEntries.clear();
 }
@@ -3,8 +3,13 @@
 #include "GameObject.h"
 #include <vector>
 #include <string>
+#include <mutex>
 
 namespace NCL {
+	namespace CSC8503 {
+		class NetworkStatistics;
+	}
+
 	class Debug
 	{
 	public:
@@ -42,6 +47,7 @@ namespace NCL {
 
 		static void DrawAxisLines(const Matrix4 &modelMatrix, float scaleBoost = 1.0f, float time = 0.0f);
 
+		//Collider outlines are drawn instanced by the renderer, from unit wireframes of each shape
 		static void DrawCollider(GameObject* g, const Vector4& colour = Vector4(0, 1, 0, 1));
 		static void DrawAABBCollider(const Transform& worldTransform, const AABBVolume& volume, const Vector4& colour = Vector4(0, 1, 0, 1));
 		static void DrawOBBCollider(const Transform& worldTransform, const OBBVolume& volume, const Vector4& colour = Vector4(0, 1, 0, 1));
@@ -77,6 +83,16 @@ namespace NCL {
 
 		static bool GetShowCollisionMeshes() { return instance ? instance->showCollisionMeshes: true; }
 
+		//-1 draws every level of the static tree, anything else only that depth
+		static void SetShowStaticTree(bool s, int depth = -1) {
+			if (instance) {
+				instance->showStaticTree	= s;
+				instance->staticTreeDepth	= depth;
+			}
+		}
+		static bool GetShowStaticTree() { return instance ? instance->showStaticTree : false; }
+		static int GetStaticTreeDepth() { return instance ? instance->staticTreeDepth : -1; }
+
 		static void SetFullScreen(bool f) { if (instance) instance->fullScreen = f; }
 		static bool GetFullScreen() { return instance ? instance->fullScreen : true; }
 
@@ -92,6 +108,10 @@ namespace NCL {
 		static int GetNumBroadphaseCollisions() { return instance ? instance->numBroadphaseCollisions : 0; }
 		static int GetNumNarrowphaseCollisions() { return instance ? instance->numNarrowphaseCollisions : 0; }
 
+		//Whichever of the server or client is running, or null when offline
+		static void SetNetworkStatistics(CSC8503::NetworkStatistics* s) { if (instance) instance->networkStatistics = s; }
+		static CSC8503::NetworkStatistics* GetNetworkStatistics() { return instance ? instance->networkStatistics : nullptr; }
+
 		void UpdateInfo(float dt);
 
 		static void SetRenderer(OGLRenderer* r) {
@@ -100,6 +120,9 @@ namespace NCL {
 
 		static void FlushRenderables(float dt);
 
+		//Adds up every FlushRenderables' dt, and is what lines with a time are timed against
+		static float GetTime() { return debugTime; }
+
 		static const Vector4 RED;
 		static const Vector4 GREEN;
 		static const Vector4 BLUE;
@@ -118,6 +141,7 @@ namespace NCL {
 			Vector4 colour;
 		};
 
+		//Lines from a worker, which wait for FlushRenderables to go to the renderer
 		struct DebugLineEntry {
 			Vector3 start;
 			Vector3 end;
@@ -125,6 +149,15 @@ namespace NCL {
 			Vector4 colour;
 		};
 
+		//Colliders outlined from a worker, which wait for FlushRenderables
+		struct DebugWireEntry {
+			Matrix4 transform;
+			Vector4 colour;
+			OGLRenderer::WireShape shape;
+		};
+
+		static void DrawWireShape(OGLRenderer::WireShape shape, const Matrix4& transform, const Vector4& colour);
+
 		Debug() {}
 		~Debug() {}
 
@@ -133,6 +166,9 @@ namespace NCL {
 
 		static std::vector<DebugStringEntry>	stringEntries;
 		static std::vector<DebugLineEntry>		lineEntries;
+		static std::vector<DebugWireEntry>		wireEntries;
+		static std::mutex						lineMutex;
+		static float							debugTime;
 
 		static OGLRenderer* renderer;
 
@@ -145,6 +181,8 @@ namespace NCL {
 		bool aiActive = true;
 		bool showCollisionVolumes = true;
 		bool showCollisionMeshes = false;
+		bool showStaticTree = false;
+		int staticTreeDepth = -1;
 		bool applyGravity = true;
 		bool freeCam = false;
 		bool fullScreen = true;
@@ -159,6 +197,8 @@ namespace NCL {
 		int numBroadphaseCollisions = 0;
 		int numNarrowphaseCollisions = 0;
 
+		CSC8503::NetworkStatistics* networkStatistics = nullptr;
+
 	};
 }
 
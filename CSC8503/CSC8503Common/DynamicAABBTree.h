@@ -0,0 +1,436 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "CollisionDetection.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		/*
+		A persistent bounding volume hierarchy for moving objects. Unlike the
+		Octree, which is cheap to build once for static geometry, this tree
+		lives across frames - objects are inserted once, and only re-inserted
+		when they move outside of their 'fat' AABB, so a typical physics
+		substep touches very few nodes.
+
+		Nodes are kept in a flat array with a free list, so proxies are just
+		indices, and no allocations happen once the tree has warmed up.
+		*/
+		template<class T>
+		class DynamicAABBTree {
+		public:
+			DynamicAABBTree(float aabbMargin = 1.0f) {
+				margin		= aabbMargin;
+				root		= NullNode;
+				freeList	= NullNode;
+				proxyCount	= 0;
+			}
+			~DynamicAABBTree() {}
+
+			void Clear() {
+				nodes.clear();
+				root		= NullNode;
+				freeList	= NullNode;
+				proxyCount	= 0;
+			}
+
+			int Insert(T object, const Vector3& pos, const Vector3& halfSize) {
+				int proxy = AllocateNode();
+				Vector3 fatSize = halfSize + Vector3(margin, margin, margin);
+				nodes[proxy].min	= pos - fatSize;
+				nodes[proxy].max	= pos + fatSize;
+				nodes[proxy].object = object;
+				nodes[proxy].height = 0;
+
+				InsertLeaf(proxy);
+				proxyCount++;
+				return proxy;
+			}
+
+			void Remove(int proxy) {
+				RemoveLeaf(proxy);
+				FreeNode(proxy);
+				proxyCount--;
+			}
+
+			//Returns true if the proxy had left its fat AABB and was reinserted
+			bool Move(int proxy, const Vector3& pos, const Vector3& halfSize) {
+				Vector3 tightMin = pos - halfSize;
+				Vector3 tightMax = pos + halfSize;
+
+				if (Contains(nodes[proxy].min, nodes[proxy].max, tightMin, tightMax)) {
+					return false;
+				}
+				RemoveLeaf(proxy);
+
+				Vector3 fat(margin, margin, margin);
+				nodes[proxy].min = tightMin - fat;
+				nodes[proxy].max = tightMax + fat;
+
+				InsertLeaf(proxy);
+				return true;
+			}
+
+			//Calls func for every proxy whose fat AABB overlaps the given box
+			template<class F>
+			void Query(const Vector3& pos, const Vector3& halfSize, F&& func) const {
+				if (root == NullNode) {
+					return;
+				}
+				Vector3 queryMin = pos - halfSize;
+				Vector3 queryMax = pos + halfSize;
+
+				queryStack.clear();
+				queryStack.push_back(root);
+				while (!queryStack.empty()) {
+					int index = queryStack.back();
+					queryStack.pop_back();
+
+					const Node& n = nodes[index];
+					if (!Overlaps(n.min, n.max, queryMin, queryMax)) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						func(n.object);
+					}
+					else {
+						queryStack.push_back(n.child1);
+						queryStack.push_back(n.child2);
+					}
+				}
+			}
+
+			/*
+			Calls func(object, maxDistance) for every proxy whose fat AABB the ray
+			passes through, roughly nearest first. As with the Octree, the callback
+			can shorten maxDistance, which culls every node beyond it.
+			*/
+			template<class F>
+			void RayCast(const Ray& r, float maxDistance, F&& func) const {
+				if (root == NullNode) {
+					return;
+				}
+				Vector3 dir = r.GetDirection();
+				Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+				Vector3 rayPos = r.GetPosition();
+
+				float entry;
+				if (!CollisionDetection::RaySlabTest(rayPos, invDir, nodes[root].min, nodes[root].max, maxDistance, entry)) {
+					return;
+				}
+				//Each thread gets its own stack, so rays can be cast in parallel
+				static thread_local std::vector<RayEntry> rayStack;
+				rayStack.clear();
+				rayStack.push_back({ root, entry });
+				while (!rayStack.empty()) {
+					RayEntry top = rayStack.back();
+					rayStack.pop_back();
+					if (top.entry > maxDistance) {
+						continue;
+					}
+					const Node& n = nodes[top.index];
+					if (n.IsLeaf()) {
+						func(n.object, maxDistance);
+						continue;
+					}
+					float entry1, entry2;
+					bool hit1 = CollisionDetection::RaySlabTest(rayPos, invDir, nodes[n.child1].min, nodes[n.child1].max, maxDistance, entry1);
+					bool hit2 = CollisionDetection::RaySlabTest(rayPos, invDir, nodes[n.child2].min, nodes[n.child2].max, maxDistance, entry2);
+					//The nearer child goes on last, so that it is popped first
+					if (hit1 && hit2 && entry1 < entry2) {
+						rayStack.push_back({ n.child2, entry2 });
+						rayStack.push_back({ n.child1, entry1 });
+					}
+					else {
+						if (hit1) {
+							rayStack.push_back({ n.child1, entry1 });
+						}
+						if (hit2) {
+							rayStack.push_back({ n.child2, entry2 });
+						}
+					}
+				}
+			}
+
+			const T& GetObject(int proxy) const {
+				return nodes[proxy].object;
+			}
+
+			void GetFatAABB(int proxy, Vector3& outMin, Vector3& outMax) const {
+				outMin = nodes[proxy].min;
+				outMax = nodes[proxy].max;
+			}
+
+			int GetProxyCount() const {
+				return proxyCount;
+			}
+
+			int GetHeight() const {
+				return root == NullNode ? 0 : nodes[root].height;
+			}
+
+		protected:
+			static const int NullNode = -1;
+
+			struct Node {
+				Vector3 min;
+				Vector3 max;
+				T		object;
+
+				int parent; //doubles as the next pointer while in the free list
+				int child1;
+				int child2;
+				int height; //0 for leaves, -1 for free nodes
+
+				bool IsLeaf() const {
+					return child1 == NullNode;
+				}
+			};
+
+			static bool Overlaps(const Vector3& minA, const Vector3& maxA, const Vector3& minB, const Vector3& maxB) {
+				return	minA.x <= maxB.x && maxA.x >= minB.x &&
+						minA.y <= maxB.y && maxA.y >= minB.y &&
+						minA.z <= maxB.z && maxA.z >= minB.z;
+			}
+
+			static bool Contains(const Vector3& outerMin, const Vector3& outerMax, const Vector3& innerMin, const Vector3& innerMax) {
+				return	outerMin.x <= innerMin.x && outerMin.y <= innerMin.y && outerMin.z <= innerMin.z &&
+						innerMax.x <= outerMax.x && innerMax.y <= outerMax.y && innerMax.z <= outerMax.z;
+			}
+
+			static float SurfaceArea(const Vector3& min, const Vector3& max) {
+				Vector3 d = max - min;
+				return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+			}
+
+			static Vector3 Min(const Vector3& a, const Vector3& b) {
+				return Vector3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z);
+			}
+
+			static Vector3 Max(const Vector3& a, const Vector3& b) {
+				return Vector3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z);
+			}
+
+			static int MaxHeight(int a, int b) {
+				return a > b ? a : b;
+			}
+
+			void Combine(int target, int a, int b) {
+				nodes[target].min = Min(nodes[a].min, nodes[b].min);
+				nodes[target].max = Max(nodes[a].max, nodes[b].max);
+			}
+
+			int AllocateNode() {
+				if (freeList == NullNode) {
+					nodes.emplace_back();
+					freeList = (int)nodes.size() - 1;
+					nodes[freeList].parent = NullNode;
+				}
+				int index	= freeList;
+				freeList	= nodes[index].parent;
+
+				nodes[index].parent = NullNode;
+				nodes[index].child1 = NullNode;
+				nodes[index].child2 = NullNode;
+				nodes[index].height = 0;
+				nodes[index].object = T();
+				return index;
+			}
+
+			void FreeNode(int index) {
+				nodes[index].parent = freeList;
+				nodes[index].height = -1;
+				freeList = index;
+			}
+
+			void InsertLeaf(int leaf) {
+				if (root == NullNode) {
+					root = leaf;
+					nodes[root].parent = NullNode;
+					return;
+				}
+
+				//Walk down the tree, picking whichever child is cheapest to
+				//expand, using the surface area heuristic
+				Vector3 leafMin = nodes[leaf].min;
+				Vector3 leafMax = nodes[leaf].max;
+
+				int index = root;
+				while (!nodes[index].IsLeaf()) {
+					int child1 = nodes[index].child1;
+					int child2 = nodes[index].child2;
+
+					float area			= SurfaceArea(nodes[index].min, nodes[index].max);
+					float combinedArea	= SurfaceArea(Min(nodes[index].min, leafMin), Max(nodes[index].max, leafMax));
+
+					float cost				= 2.0f * combinedArea;
+					float inheritanceCost	= 2.0f * (combinedArea - area);
+
+					float cost1 = ChildCost(child1, leafMin, leafMax) + inheritanceCost;
+					float cost2 = ChildCost(child2, leafMin, leafMax) + inheritanceCost;
+
+					if (cost < cost1 && cost < cost2) {
+						break;
+					}
+					index = cost1 < cost2 ? child1 : child2;
+				}
+
+				int sibling		= index;
+				int oldParent	= nodes[sibling].parent;
+				int newParent	= AllocateNode();
+
+				nodes[newParent].parent = oldParent;
+				nodes[newParent].height = nodes[sibling].height + 1;
+				nodes[newParent].child1 = sibling;
+				nodes[newParent].child2 = leaf;
+				Combine(newParent, sibling, leaf);
+
+				if (oldParent != NullNode) {
+					if (nodes[oldParent].child1 == sibling) {
+						nodes[oldParent].child1 = newParent;
+					}
+					else {
+						nodes[oldParent].child2 = newParent;
+					}
+				}
+				else {
+					root = newParent;
+				}
+				nodes[sibling].parent	= newParent;
+				nodes[leaf].parent		= newParent;
+
+				Refit(nodes[leaf].parent);
+			}
+
+			void RemoveLeaf(int leaf) {
+				if (leaf == root) {
+					root = NullNode;
+					return;
+				}
+
+				int parent		= nodes[leaf].parent;
+				int grandParent = nodes[parent].parent;
+				int sibling		= nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+				if (grandParent != NullNode) {
+					if (nodes[grandParent].child1 == parent) {
+						nodes[grandParent].child1 = sibling;
+					}
+					else {
+						nodes[grandParent].child2 = sibling;
+					}
+					nodes[sibling].parent = grandParent;
+					FreeNode(parent);
+
+					Refit(grandParent);
+				}
+				else {
+					root = sibling;
+					nodes[sibling].parent = NullNode;
+					FreeNode(parent);
+				}
+			}
+
+			float ChildCost(int child, const Vector3& leafMin, const Vector3& leafMax) const {
+				float combinedArea = SurfaceArea(Min(nodes[child].min, leafMin), Max(nodes[child].max, leafMax));
+				if (nodes[child].IsLeaf()) {
+					return combinedArea;
+				}
+				return combinedArea - SurfaceArea(nodes[child].min, nodes[child].max);
+			}
+
+			//Walks back up to the root, rebalancing and recalculating bounds
+			void Refit(int index) {
+				while (index != NullNode) {
+					index = Balance(index);
+
+					int child1 = nodes[index].child1;
+					int child2 = nodes[index].child2;
+
+					nodes[index].height = 1 + MaxHeight(nodes[child1].height, nodes[child2].height);
+					Combine(index, child1, child2);
+
+					index = nodes[index].parent;
+				}
+			}
+
+			//Performs a left or right rotation if node A is imbalanced
+			int Balance(int iA) {
+				if (nodes[iA].IsLeaf() || nodes[iA].height < 2) {
+					return iA;
+				}
+
+				int iB = nodes[iA].child1;
+				int iC = nodes[iA].child2;
+
+				int balance = nodes[iC].height - nodes[iB].height;
+
+				if (balance > 1) {
+					return Rotate(iA, iC, iB, false);
+				}
+				if (balance < -1) {
+					return Rotate(iA, iB, iC, true);
+				}
+				return iA;
+			}
+
+			//Promotes 'up' (a child of A) to take A's place. 'other' is A's
+			//remaining child. upIsChild1 tells us which slot 'up' came from
+			int Rotate(int iA, int iUp, int iOther, bool upIsChild1) {
+				int iF = nodes[iUp].child1;
+				int iG = nodes[iUp].child2;
+
+				nodes[iUp].child1	= iA;
+				nodes[iUp].parent	= nodes[iA].parent;
+				nodes[iA].parent	= iUp;
+
+				int upParent = nodes[iUp].parent;
+				if (upParent != NullNode) {
+					if (nodes[upParent].child1 == iA) {
+						nodes[upParent].child1 = iUp;
+					}
+					else {
+						nodes[upParent].child2 = iUp;
+					}
+				}
+				else {
+					root = iUp;
+				}
+
+				//The taller grandchild stays with 'up', the shorter moves to A
+				int keep	= nodes[iF].height > nodes[iG].height ? iF : iG;
+				int move	= keep == iF ? iG : iF;
+
+				nodes[iUp].child2 = keep;
+				if (upIsChild1) {
+					nodes[iA].child1 = move;
+				}
+				else {
+					nodes[iA].child2 = move;
+				}
+				nodes[move].parent = iA;
+
+				Combine(iA, iOther, move);
+				Combine(iUp, iA, keep);
+
+				nodes[iA].height	= 1 + MaxHeight(nodes[iOther].height, nodes[move].height);
+				nodes[iUp].height	= 1 + MaxHeight(nodes[iA].height, nodes[keep].height);
+
+				return iUp;
+			}
+
+			std::vector<Node>	nodes;
+			int					root;
+			int					freeList;
+			int					proxyCount;
+			float				margin;
+
+			struct RayEntry {
+				int		index;
+				float	entry;
+			};
+
+			mutable std::vector<int> queryStack;
+		};
+	}
+}
@@ -0,0 +1,71 @@
+#include "FlowField.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+FlowField::FlowField(const NavigationGrid& grid, int goalCell) : grid(grid) {
+	this->goalCell	= goalCell;
+	refreshing		= false;
+	next.assign(grid.GetGridWidth() * grid.GetGridHeight(), -1);
+	Refresh();
+	Update(grid.GetGridWidth() * grid.GetGridHeight()); //the first one's wanted straight away
+}
+
+void FlowField::Refresh() {
+	search.Begin((int)next.size());
+	search.Open(goalCell, 0, 0, -1);
+	refreshing = true;
+}
+
+/*
+A Dijkstra search going backwards, from the goal out to every cell that
+can get to it, so each cell's parent in the search is the next cell
+along the cheapest way there.
+*/
+bool FlowField::Update(int cellBudget) {
+	if (!refreshing) {
+		return true;
+	}
+	const GridNode* nodes	= grid.GetNodes();
+	int width				= grid.GetGridWidth();
+	int height				= grid.GetGridHeight();
+
+	for (int i = 0; i < cellBudget && !search.Empty(); ++i) {
+		int current = search.PopBest();
+		int x = current % width;
+		int y = current / width;
+		const int around[4] = {
+			y > 0			? current - width	: -1,
+			y < height - 1	? current + width	: -1,
+			x > 0			? current - 1		: -1,
+			x < width - 1	? current + 1		: -1
+		};
+		for (int from : around) {
+			if (from < 0 || search.IsClosed(from)) {
+				continue;
+			}
+			//Connections only go one way, so it's whether from can step into current
+			const GridNode& n = nodes[from];
+			for (int j = 0; j < 4; ++j) {
+				if (n.connected[j] != &nodes[current]) {
+					continue;
+				}
+				int g = search.GetG(current) + n.costs[j];
+				if (!search.IsOpen(from) || g < search.GetG(from)) {
+					search.Open(from, g, g, current);
+				}
+			}
+		}
+	}
+	if (search.Empty()) {
+		Finish();
+	}
+	return !refreshing;
+}
+
+void FlowField::Finish() {
+	for (int i = 0; i < (int)next.size(); ++i) {
+		next[i] = search.Seen(i) ? search.GetParent(i) : -1;
+	}
+	refreshing = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "NavigationGrid.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Which way to go from every cell of a grid to get to one goal cell,
+		worked out all at once by searching outwards from the goal, so any
+		number of agents heading there just look up the cell they're in,
+		rather than each searching for and following a path of their own.
+
+		Refresh starts working it out again over however many Updates it
+		takes, a few cells at a time, and the old directions are still
+		given out until the new ones are all there.
+		*/
+		class FlowField {
+		public:
+			FlowField(const NavigationGrid& grid, int goalCell);
+
+			void	Refresh();
+			//Returns true once the field's up to date
+			bool	Update(int cellBudget);
+			bool	IsRefreshing() const {
+				return refreshing;
+			}
+
+			//-1 if there's no way to the goal from cell, or if it's the goal
+			int		GetNextCell(int cell) const {
+				return next[cell];
+			}
+			bool	Reaches(int cell) const {
+				return cell == goalCell || next[cell] >= 0;
+			}
+			int		GetGoalCell() const {
+				return goalCell;
+			}
+
+		protected:
+			void	Finish();
+
+			const NavigationGrid&	grid;
+			int						goalCell;
+			std::vector<int>		next;
+			NavigationGridSearch	search;
+			bool					refreshing;
+		};
+	}
+}
@@ -0,0 +1,237 @@
+#include "FrameProfiler.h"
+#include <fstream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+FrameProfiler::Frame				FrameProfiler::history[HistorySize];
+int									FrameProfiler::current		= 0;
+int									FrameProfiler::frameNumber	= 0;
+bool								FrameProfiler::recording	= false;
+bool								FrameProfiler::paused		= false;
+int									FrameProfiler::laneCount	= 0;
+FrameProfiler::Clock::time_point	FrameProfiler::frameStart;
+FrameProfiler::Clock::time_point	FrameProfiler::firstFrameStart;
+MemoryTracker::AllocationCounts		FrameProfiler::frameAllocated;
+bool								FrameProfiler::capturing	= false;
+int									FrameProfiler::captureFirst	= 0;
+std::vector<FrameProfiler::Frame>	FrameProfiler::captured;
+std::mutex							FrameProfiler::mutex;
+
+thread_local FrameProfiler::ThreadState FrameProfiler::threadState;
+
+//The thread frames are begun on is always lane 0, as it gets its lane first
+void FrameProfiler::BeginFrame() {
+	std::lock_guard<std::mutex> lock(mutex);
+	GetLane(threadState);
+	frameNumber++;
+	if (frameNumber == 1) {
+		firstFrameStart = Clock::now();
+	}
+	recording = !paused;
+	if (!recording) {
+		return;
+	}
+	current = (current + 1) % HistorySize;
+	Frame& f	= history[current];
+	if (capturing && f.number >= captureFirst && (int)captured.size() < MaxCaptureFrames) {
+		captured.emplace_back(f);
+	}
+	frameStart	= Clock::now();
+	f.number	= frameNumber;
+	f.startTime	= std::chrono::duration<double, std::milli>(frameStart - firstFrameStart).count();
+	f.cpuTime	= 0.0f;
+	f.gpuTime	= 0.0f;
+	f.markers.clear(); //keeps its capacity, so a steady frame doesn't allocate
+	frameAllocated = MemoryTracker::GetTotalAllocations(); //after the capture's copy, which isn't the frame's
+}
+
+void FrameProfiler::EndFrame() {
+	MemoryTracker::AllocationCounts allocated = MemoryTracker::GetTotalAllocations();
+	std::lock_guard<std::mutex> lock(mutex);
+	if (recording) {
+		Frame& f			= history[current];
+		f.cpuTime			= Now();
+		f.allocations		= (unsigned int)(allocated.allocations - frameAllocated.allocations);
+		f.allocatedBytes	= (unsigned int)(allocated.bytes - frameAllocated.bytes);
+		f.pooled			= (unsigned int)(allocated.pooled - frameAllocated.pooled);
+	}
+	recording = false;
+}
+
+void FrameProfiler::Push(const char* name) {
+	ThreadState& t = threadState;
+	std::lock_guard<std::mutex> lock(mutex);
+	int lane = GetLane(t);
+	if (!recording || lane < 0) {
+		t.open.emplace_back(-1, -1);
+		return;
+	}
+	Frame& f = history[current];
+	Marker m;
+	m.name		= name;
+	m.start		= Now();
+	m.duration	= -1.0f;
+	m.lane		= (short)lane;
+	m.depth		= (short)t.open.size();
+	t.open.emplace_back(f.number, (int)f.markers.size());
+	f.markers.emplace_back(m);
+	t.open.back().allocated = MemoryTracker::GetThreadAllocations(); //last, so the marker's own growth isn't counted
+}
+
+//Markers left open when their frame ends stay negative, rather than time into the next
+void FrameProfiler::Pop() {
+	MemoryTracker::AllocationCounts allocated = MemoryTracker::GetThreadAllocations();
+	ThreadState& t = threadState;
+	if (t.open.empty()) {
+		return;
+	}
+	OpenMarker o = t.open.back();
+	t.open.pop_back();
+	if (o.frame < 0) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	Frame& f = history[current];
+	if (!recording || f.number != o.frame) {
+		return;
+	}
+	Marker& m			= f.markers[o.index];
+	m.duration			= Now() - m.start;
+	m.allocations		= (unsigned int)(allocated.allocations - o.allocated.allocations);
+	m.allocatedBytes	= (unsigned int)(allocated.bytes - o.allocated.bytes);
+	m.pooled			= (unsigned int)(allocated.pooled - o.allocated.pooled);
+}
+
+void FrameProfiler::RecordGPU(int frame, const char* name, float start, float duration) {
+	std::lock_guard<std::mutex> lock(mutex);
+	//Pausing leaves gaps in the numbering, so it has to be looked for
+	Frame* found = nullptr;
+	for (int i = 0; i < HistorySize && !found; ++i) {
+		Frame& f = history[(current - i + HistorySize) % HistorySize];
+		found = f.number == frame ? &f : nullptr;
+	}
+	if (!found) {
+		return; //too old, or never recorded
+	}
+	Frame& f = *found;
+	Marker m;
+	m.name		= name;
+	m.start		= start;
+	m.duration	= duration;
+	m.lane		= GPULane;
+	m.depth		= 0;
+	f.markers.emplace_back(m);
+	f.gpuTime = start + duration > f.gpuTime ? start + duration : f.gpuTime;
+}
+
+const FrameProfiler::Frame* FrameProfiler::GetFrame(int age) {
+	if (age < 0 || age >= HistorySize) {
+		return nullptr;
+	}
+	//The frame being recorded isn't finished yet
+	int newest = recording ? current - 1 : current;
+	const Frame& f = history[(newest - age + HistorySize * 2) % HistorySize];
+	return f.number < 0 ? nullptr : &f;
+}
+
+int FrameProfiler::GetLane(ThreadState& t) {
+	if (t.lane == -2) {
+		t.lane = laneCount < MaxLanes ? laneCount++ : -1;
+	}
+	return t.lane;
+}
+
+float FrameProfiler::Now() {
+	return std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count();
+}
+
+bool FrameProfiler::ExportChromeTrace(const std::string& filename) {
+	std::vector<const Frame*> frames;
+	for (int age = HistorySize - 1; age >= 0; --age) {
+		const Frame* f = GetFrame(age);
+		if (f) {
+			frames.emplace_back(f);
+		}
+	}
+	return WriteChromeTrace(filename, frames);
+}
+
+void FrameProfiler::StartCapture() {
+	std::lock_guard<std::mutex> lock(mutex);
+	captured.clear();
+	capturing		= true;
+	captureFirst	= frameNumber + 1;
+}
+
+//Whatever's still in the history hasn't been captured yet
+bool FrameProfiler::StopCapture(const std::string& filename) {
+	if (!capturing) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		capturing = false;
+	}
+	int last = captured.empty() ? captureFirst - 1 : captured.back().number;
+	std::vector<const Frame*> frames;
+	for (const Frame& f : captured) {
+		frames.emplace_back(&f);
+	}
+	for (int age = HistorySize - 1; age >= 0; --age) {
+		const Frame* f = GetFrame(age);
+		if (f && f->number > last) {
+			frames.emplace_back(f);
+		}
+	}
+	bool written = WriteChromeTrace(filename, frames);
+	captured.clear();
+	captured.shrink_to_fit();
+	return written;
+}
+
+/*
+Every marker is a complete ("X") event, with times in microseconds. Lanes
+are the thread IDs, and the GPU gets a thread of its own after them. The
+GPU's clock isn't the CPU's, so its passes are placed from the start of
+the frame they were for, which is close enough to see what overlaps.
+Markers that never ended are left out. Anything that allocated has its
+counts as args, and each frame's totals are a counter track of their own.
+*/
+bool FrameProfiler::WriteChromeTrace(const std::string& filename, const std::vector<const Frame*>& frames) {
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+	int gpuThread = MaxLanes;
+	file << "{\"traceEvents\":[\n";
+	for (int i = 0; i < laneCount; ++i) {
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << (i == 0 ? "Main" : "Worker ") << (i == 0 ? "" : std::to_string(i)) << "\"}},\n";
+	}
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuThread << ",\"args\":{\"name\":\"GPU\"}}";
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (const Frame* f : frames) {
+		double frameStart = f->startTime * 1000.0;
+		file << ",\n{\"name\":\"Frame " << f->number << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << frameStart
+			<< ",\"dur\":" << f->cpuTime * 1000.0 << ",\"args\":{\"allocations\":" << f->allocations << ",\"bytes\":" << f->allocatedBytes
+			<< ",\"pooled\":" << f->pooled << "}}";
+		file << ",\n{\"name\":\"Allocations\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << frameStart
+			<< ",\"args\":{\"heap\":" << f->allocations << ",\"pooled\":" << f->pooled << "}}";
+		for (const Marker& m : f->markers) {
+			if (m.duration < 0.0f) {
+				continue;
+			}
+			file << ",\n{\"name\":\"" << m.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (m.lane == GPULane ? gpuThread : m.lane)
+				<< ",\"ts\":" << frameStart + m.start * 1000.0 << ",\"dur\":" << m.duration * 1000.0;
+			if (m.allocations || m.pooled) {
+				file << ",\"args\":{\"allocations\":" << m.allocations << ",\"bytes\":" << m.allocatedBytes << ",\"pooled\":" << m.pooled << "}";
+			}
+			file << "}";
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return true;
+}
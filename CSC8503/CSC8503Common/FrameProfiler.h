@@ -0,0 +1,157 @@
+#pragma once
+#include "../../Common/MemoryTracker.h"
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Records where each frame's time went, as a tree of named markers per
+		thread, so the debug UI can show it as a timeline rather than one
+		number per system. Markers are pushed and popped around the work,
+		usually by a ProfileScope, and may come from any thread - each thread
+		gets a lane of its own the first time it records anything, with lane
+		0 being the one frames are begun on.
+
+		The GPU's times come back a few frames after the CPU's, so they're
+		added to the frame they were for with RecordGPU, in a lane of their
+		own. The last HistorySize frames are kept, and the history can be
+		paused so a spike can be looked at.
+
+		Names aren't copied, so they should be string literals.
+
+		Each marker also counts the heap allocations its thread made while it
+		was open, nested markers' included, and how many pool slots it took,
+		and each frame counts every thread's, so whatever's still allocating
+		in a frame that should be steady can be found, and kept out.
+
+		Frames can be written out as a Chrome trace (the JSON that
+		chrome://tracing, Perfetto and Tracy's importer all read), either
+		just the history, or everything from StartCapture to StopCapture,
+		for longer sessions. Captured frames are kept as they fall out of
+		the history, by which point their GPU times are in too.
+		*/
+		class FrameProfiler {
+		public:
+			static const int HistorySize	= 240;
+			static const int MaxLanes		= 8;	//threads beyond this aren't recorded
+			static const int GPULane		= -1;
+
+			struct Marker {
+				const char*	name;
+				float		start;		//ms after the frame began
+				float		duration;	//ms, negative if it never ended
+				short		lane;
+				short		depth;
+				unsigned int	allocations		= 0;	//on its own thread, while it was open
+				unsigned int	allocatedBytes	= 0;
+				unsigned int	pooled			= 0;
+			};
+
+			struct Frame {
+				int					number	= -1;
+				double				startTime = 0.0; //ms since the first frame
+				float				cpuTime	= 0.0f;
+				float				gpuTime	= 0.0f;	//ms from the first GPU pass starting to the last one ending
+				unsigned int		allocations		= 0;	//every thread's, from the frame beginning to it ending
+				unsigned int		allocatedBytes	= 0;
+				unsigned int		pooled			= 0;
+				std::vector<Marker>	markers;
+			};
+
+			static void BeginFrame();
+			static void EndFrame();
+
+			static void Push(const char* name);
+			static void Pop();
+
+			static void RecordGPU(int frame, const char* name, float start, float duration);
+
+			//The frame being recorded, for GPU timers to tag their queries with
+			static int GetFrameNumber() {
+				return frameNumber;
+			}
+
+			static void SetPaused(bool p) {
+				paused = p;
+			}
+			static bool IsPaused() {
+				return paused;
+			}
+
+			//0 is the last finished frame, up to HistorySize - 1 frames ago, or
+			//null if there isn't one that old. Only to be read from lane 0
+			static const Frame* GetFrame(int age);
+
+			static int GetLaneCount() {
+				return laneCount;
+			}
+
+			static bool ExportChromeTrace(const std::string& filename);
+
+			static void StartCapture();
+			//Writes out everything since StartCapture, returning false if it couldn't
+			static bool StopCapture(const std::string& filename);
+			static bool IsCapturing() {
+				return capturing;
+			}
+			//Including any the history's still holding on to
+			static int GetCapturedFrameCount() {
+				return capturing ? frameNumber - captureFirst + 1 : 0;
+			}
+
+			static const int MaxCaptureFrames = 36000; //10 minutes at 60fps
+
+		protected:
+			typedef std::chrono::high_resolution_clock Clock;
+
+			//A marker pushed but not yet popped, with a frame of -1 if it wasn't recorded
+			struct OpenMarker {
+				OpenMarker(int frame, int index) : frame(frame), index(index) {}
+
+				int	frame;
+				int	index;
+				MemoryTracker::AllocationCounts allocated; //the thread's, when it was pushed
+			};
+
+			struct ThreadState {
+				int						lane = -2; //-2 until it's first asked for
+				std::vector<OpenMarker>	open;
+			};
+
+			static int	GetLane(ThreadState& t);
+			static float Now();
+			static bool WriteChromeTrace(const std::string& filename, const std::vector<const Frame*>& frames);
+
+			static Frame				history[HistorySize];
+			static int					current;
+			static int					frameNumber;
+			static bool					recording;
+			static bool					paused;
+			static int					laneCount;
+			static Clock::time_point	frameStart;
+			static Clock::time_point	firstFrameStart;
+			static MemoryTracker::AllocationCounts frameAllocated; //every thread's, at the start of the frame
+			static bool					capturing;
+			static int					captureFirst; //the first frame number captured
+			static std::vector<Frame>	captured;
+			static std::mutex			mutex;
+
+			static thread_local ThreadState threadState;
+		};
+
+		//Records a marker from here to the end of the scope
+		class ProfileScope {
+		public:
+			ProfileScope(const char* name) {
+				FrameProfiler::Push(name);
+			}
+			~ProfileScope() {
+				FrameProfiler::Pop();
+			}
+		};
+	}
+}
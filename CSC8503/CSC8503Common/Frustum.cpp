@@ -0,0 +1,39 @@
+#include "Frustum.h"
+#include "../../Common/Vector4.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace Maths;
+
+/*
+Each plane is the bottom row of the matrix added to or taken away from
+one of the others, which is where clip space x, y and z equal +/- w.
+*/
+void Frustum::FromMatrix(const Matrix4& viewProj) {
+	Vector4 w = viewProj.GetRow(3);
+	for (int i = 0; i < 3; ++i) {
+		Vector4 row = viewProj.GetRow(i);
+		Vector4 lower = w + row;
+		Vector4 upper = w - row;
+		planes[i * 2]		= Plane(Vector3(lower.x, lower.y, lower.z), lower.w, true);
+		planes[i * 2 + 1]	= Plane(Vector3(upper.x, upper.y, upper.z), upper.w, true);
+	}
+}
+
+//The box's extent along each plane's normal says how far it can reach towards it
+Frustum::Result Frustum::TestAABB(const Vector3& position, const Vector3& halfSize) const {
+	Result result = Result::Inside;
+	for (const Plane& p : planes) {
+		Vector3 n		= p.GetNormal();
+		float extent	= fabs(n.x) * halfSize.x + fabs(n.y) * halfSize.y + fabs(n.z) * halfSize.z;
+		float distance	= p.DistanceFromPlane(position);
+		if (distance < -extent) {
+			return Result::Outside;
+		}
+		if (distance < extent) {
+			result = Result::Intersects;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "../../Common/Plane.h"
+#include "../../Common/Matrix4.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		using Maths::Plane;
+		using Maths::Matrix4;
+		using Maths::Vector3;
+
+		/*
+		The six planes bounding what a view-projection matrix can see, all
+		facing inwards. Box tests are conservative - a box that's outside
+		the frustum but straddles two planes near a corner can still pass,
+		which only means something gets drawn that didn't need to be.
+		*/
+		class Frustum {
+		public:
+			enum class Result {
+				Outside,
+				Intersects,
+				Inside
+			};
+
+			Frustum() {}
+			Frustum(const Matrix4& viewProj) {
+				FromMatrix(viewProj);
+			}
+			~Frustum() {}
+
+			void FromMatrix(const Matrix4& viewProj);
+
+			//Boxes are given by their centre and half size, like the broadphase uses
+			Result TestAABB(const Vector3& position, const Vector3& halfSize) const;
+
+			bool AABBInside(const Vector3& position, const Vector3& halfSize) const {
+				return TestAABB(position, halfSize) != Result::Outside;
+			}
+
+			const Plane& GetPlane(int i) const {
+				return planes[i];
+			}
+
+		protected:
+			Plane planes[6];
+		};
+	}
+}
@@ -0,0 +1,457 @@
+#include "GJKAlgorithm.h"
+#include "../../Common/Maths.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+Vector3 GJKShape::Support(const Vector3& dir) const {
+	Vector3 p = centre;
+	for (int i = 0; i < 3; ++i) {
+		p += axes[i] * (Vector3::Dot(dir, axes[i]) >= 0.0f ? halfSize[i] : -halfSize[i]);
+	}
+	p += Vector3::Dot(dir, segmentHalf) >= 0.0f ? segmentHalf : -segmentHalf;
+	if (radius > 0.0f) {
+		float length = dir.Length();
+		if (length > 0.0f) {
+			p += dir * (radius / length);
+		}
+	}
+	return p;
+}
+
+GJKShape GJKShape::FromAABB(const AABBVolume& volume, const Transform& worldTransform) {
+	GJKShape s;
+	s.centre	= worldTransform.GetPosition() + volume.GetOffset();
+	s.halfSize	= volume.GetHalfDimensions();
+	return s;
+}
+
+GJKShape GJKShape::FromOBB(const OBBVolume& volume, const Transform& worldTransform) {
+	Quaternion orientation = worldTransform.GetOrientation();
+	GJKShape s;
+	s.centre	= worldTransform.GetPosition() + orientation * volume.GetOffset();
+	s.axes[0]	= orientation * Vector3(1, 0, 0);
+	s.axes[1]	= orientation * Vector3(0, 1, 0);
+	s.axes[2]	= orientation * Vector3(0, 0, 1);
+	s.halfSize	= volume.GetHalfDimensions();
+	return s;
+}
+
+//Matches SpherePosFromCapsule - the spheres at either end sit radius in from the tips
+GJKShape GJKShape::FromCapsule(const CapsuleVolume& volume, const Transform& worldTransform) {
+	GJKShape s;
+	s.centre		= worldTransform.GetPosition() + volume.GetOffset();
+	s.segmentHalf	= worldTransform.GetOrientation() * Vector3(0, 1, 0) * (volume.GetHalfHeight() - volume.GetRadius());
+	s.radius		= volume.GetRadius();
+	return s;
+}
+
+GJKShape GJKShape::FromSphere(const SphereVolume& volume, const Transform& worldTransform) {
+	GJKShape s;
+	s.centre	= worldTransform.GetPosition() + volume.GetOffset();
+	s.radius	= volume.GetRadius();
+	return s;
+}
+
+GJKShape GJKShape::FromVolume(const CollisionVolume& volume, const Transform& worldTransform) {
+	switch (volume.type) {
+		case VolumeType::AABB:		return FromAABB((const AABBVolume&)volume, worldTransform);
+		case VolumeType::OBB:		return FromOBB((const OBBVolume&)volume, worldTransform);
+		case VolumeType::Capsule:	return FromCapsule((const CapsuleVolume&)volume, worldTransform);
+		case VolumeType::Sphere:	return FromSphere((const SphereVolume&)volume, worldTransform);
+	}
+	return GJKShape();
+}
+
+GJKAlgorithm::SupportPoint GJKAlgorithm::Support(const GJKShape& a, const GJKShape& b, const Vector3& dir) {
+	SupportPoint s;
+	s.onA	= a.Support(dir);
+	s.onB	= b.Support(-dir);
+	s.point = s.onA - s.onB;
+	return s;
+}
+
+bool GJKAlgorithm::Intersection(const GJKShape& shapeA, const Transform& worldTransformA,
+	const GJKShape& shapeB, const Transform& worldTransformB,
+	Vector3& searchDir, CollisionDetection::CollisionInfo& collisionInfo) {
+
+	Simplex simplex;
+	if (!Overlap(shapeA, shapeB, searchDir, simplex)) {
+		return false;
+	}
+	if (simplex.count < 4 && !CompleteSimplex(shapeA, shapeB, simplex)) {
+		return false;
+	}
+	Vector3 normal;
+	float	depth;
+	Vector3 pointA;
+	Vector3 pointB;
+	if (!ExpandPolytope(shapeA, shapeB, simplex, normal, depth, pointA, pointB) || depth <= 0.0f) {
+		return false; //only just touching, with nothing to push apart
+	}
+	collisionInfo.AddContactPoint(pointA - worldTransformA.GetPosition(), pointB - worldTransformB.GetPosition(), normal, depth);
+	return true;
+}
+
+bool GJKAlgorithm::Overlaps(const GJKShape& shapeA, const GJKShape& shapeB, Vector3& searchDir) {
+	Simplex simplex;
+	return Overlap(shapeA, shapeB, searchDir, simplex);
+}
+
+/*
+The simplex always keeps its newest point first, and NextSimplex cuts it
+back down to whichever part of it is closest to the origin, pointing the
+search direction from there towards the origin.
+*/
+bool GJKAlgorithm::Overlap(const GJKShape& a, const GJKShape& b, Vector3& searchDir, Simplex& simplex) {
+	Vector3 dir = searchDir;
+	if (Vector3::Dot(dir, dir) < 1e-8f) {
+		dir = a.centre - b.centre;
+		if (Vector3::Dot(dir, dir) < 1e-8f) {
+			dir = Vector3(1, 0, 0);
+		}
+	}
+	simplex.points[0]	= Support(a, b, dir);
+	simplex.count		= 1;
+	dir = -simplex.points[0].point;
+
+	const int maxIterations = 64;
+	for (int i = 0; i < maxIterations; ++i) {
+		if (Vector3::Dot(dir, dir) < 1e-10f) {
+			return true; //the origin is right on the simplex
+		}
+		SupportPoint p = Support(a, b, dir);
+		if (Vector3::Dot(p.point, dir) <= 0.0f) {
+			searchDir = dir; //nothing gets past the origin this way, so they're apart
+			return false;
+		}
+		for (int j = simplex.count; j > 0; --j) {
+			simplex.points[j] = simplex.points[j - 1];
+		}
+		simplex.points[0] = p;
+		simplex.count++;
+
+		if (NextSimplex(simplex, dir)) {
+			searchDir = dir;
+			return true;
+		}
+	}
+	searchDir = dir;
+	return false;
+}
+
+bool GJKAlgorithm::NextSimplex(Simplex& simplex, Vector3& dir) {
+	switch (simplex.count) {
+		case 2: return Line(simplex, dir);
+		case 3: return Triangle(simplex, dir);
+		case 4: return Tetrahedron(simplex, dir);
+	}
+	return false;
+}
+
+bool GJKAlgorithm::Line(Simplex& simplex, Vector3& dir) {
+	Vector3 a = simplex.points[0].point;
+	Vector3 b = simplex.points[1].point;
+	Vector3 ab = b - a;
+	Vector3 ao = -a;
+
+	if (Vector3::Dot(ab, ao) > 0.0f) {
+		dir = Vector3::Cross(Vector3::Cross(ab, ao), ab);
+	}
+	else {
+		simplex.count = 1;
+		dir = ao;
+	}
+	return false;
+}
+
+bool GJKAlgorithm::Triangle(Simplex& simplex, Vector3& dir) {
+	SupportPoint a = simplex.points[0];
+	SupportPoint b = simplex.points[1];
+	SupportPoint c = simplex.points[2];
+
+	Vector3 ab = b.point - a.point;
+	Vector3 ac = c.point - a.point;
+	Vector3 ao = -a.point;
+	Vector3 abc = Vector3::Cross(ab, ac);
+
+	if (Vector3::Dot(Vector3::Cross(abc, ac), ao) > 0.0f) {
+		if (Vector3::Dot(ac, ao) > 0.0f) {
+			simplex.points[1]	= c;
+			simplex.count		= 2;
+			dir = Vector3::Cross(Vector3::Cross(ac, ao), ac);
+			return false;
+		}
+		simplex.count = 2;
+		return Line(simplex, dir);
+	}
+	if (Vector3::Dot(Vector3::Cross(ab, abc), ao) > 0.0f) {
+		simplex.count = 2;
+		return Line(simplex, dir);
+	}
+	if (Vector3::Dot(abc, ao) > 0.0f) {
+		dir = abc;
+	}
+	else { //origin is below the triangle, so flip it to keep the winding consistent
+		simplex.points[1] = c;
+		simplex.points[2] = b;
+		dir = -abc;
+	}
+	return false;
+}
+
+bool GJKAlgorithm::Tetrahedron(Simplex& simplex, Vector3& dir) {
+	SupportPoint a = simplex.points[0];
+	SupportPoint b = simplex.points[1];
+	SupportPoint c = simplex.points[2];
+	SupportPoint d = simplex.points[3];
+
+	Vector3 ab = b.point - a.point;
+	Vector3 ac = c.point - a.point;
+	Vector3 ad = d.point - a.point;
+	Vector3 ao = -a.point;
+
+	Vector3 abc = Vector3::Cross(ab, ac);
+	Vector3 acd = Vector3::Cross(ac, ad);
+	Vector3 adb = Vector3::Cross(ad, ab);
+
+	if (Vector3::Dot(abc, ao) > 0.0f) {
+		simplex.count = 3;
+		return Triangle(simplex, dir);
+	}
+	if (Vector3::Dot(acd, ao) > 0.0f) {
+		simplex.points[1]	= c;
+		simplex.points[2]	= d;
+		simplex.count		= 3;
+		return Triangle(simplex, dir);
+	}
+	if (Vector3::Dot(adb, ao) > 0.0f) {
+		simplex.points[1]	= d;
+		simplex.points[2]	= b;
+		simplex.count		= 3;
+		return Triangle(simplex, dir);
+	}
+	return true;
+}
+
+/*
+GJK stops as soon as the origin is on its simplex, which for boxes and
+capsules lined up with each other - a stack of crates, say - is often
+while it's still only a point, line or triangle, however deep they are.
+The missing points are found by searching out from it: along the axes
+from a point, around a line at right angles to it, and either side of a
+triangle. The origin's on the simplex already, so it's inside whatever
+tetrahedron that makes. If a triangle has nothing either side, the shapes'
+difference is flat, and there's no depth to find.
+*/
+bool GJKAlgorithm::CompleteSimplex(const GJKShape& a, const GJKShape& b, Simplex& simplex) {
+	const float epsilon = 1e-6f;
+
+	if (simplex.count == 1) {
+		static const Vector3 searchAxes[6] = {
+			Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+		};
+		for (int i = 0; i < 6 && simplex.count == 1; ++i) {
+			SupportPoint p = Support(a, b, searchAxes[i]);
+			if ((p.point - simplex.points[0].point).LengthSquared() > epsilon) {
+				simplex.points[1]	= p;
+				simplex.count		= 2;
+			}
+		}
+		if (simplex.count == 1) {
+			return false;
+		}
+	}
+	if (simplex.count == 2) {
+		Vector3 line = simplex.points[1].point - simplex.points[0].point;
+		//Crossed with whichever axis is furthest from it, to get something at right angles
+		Vector3 axis = fabs(line.x) <= fabs(line.y) && fabs(line.x) <= fabs(line.z) ? Vector3(1, 0, 0)
+			: (fabs(line.y) <= fabs(line.z) ? Vector3(0, 1, 0) : Vector3(0, 0, 1));
+		Vector3 side	= Vector3::Cross(line, axis).Normalised();
+		Vector3 up		= Vector3::Cross(line.Normalised(), side);
+		float minArea	= epsilon * line.LengthSquared();
+		for (int i = 0; i < 6 && simplex.count == 2; ++i) {
+			float angle		= (float)i * Maths::PI / 3.0f;
+			SupportPoint p	= Support(a, b, side * cos(angle) + up * sin(angle));
+			if (Vector3::Cross(p.point - simplex.points[0].point, line).LengthSquared() > minArea) {
+				simplex.points[2]	= p;
+				simplex.count		= 3;
+			}
+		}
+		if (simplex.count == 2) {
+			return false;
+		}
+	}
+	Vector3 origin	= simplex.points[0].point;
+	Vector3 n		= Vector3::Cross(simplex.points[1].point - origin, simplex.points[2].point - origin);
+	float minHeight = epsilon * n.Length();
+	SupportPoint p	= Support(a, b, n);
+	if (Vector3::Dot(p.point - origin, n) <= minHeight) {
+		p = Support(a, b, -n);
+		if (Vector3::Dot(p.point - origin, -n) <= minHeight) {
+			return false;
+		}
+	}
+	simplex.points[3]	= p;
+	simplex.count		= 4;
+	return true;
+}
+
+/*
+The polytope starts as GJK's final tetrahedron. Each iteration takes the
+face nearest the origin, and finds the furthest support point out past it.
+If that's no further out than the face, the face is on the surface of the
+Minkowski difference, and is our answer. Otherwise every face the new point
+can see is removed, and the hole is filled with faces fanning out from it.
+
+Everything lives in fixed size arrays, as this runs on the narrowphase's
+worker threads, and shouldn't be going to the allocator.
+*/
+bool GJKAlgorithm::ExpandPolytope(const GJKShape& a, const GJKShape& b, const Simplex& simplex,
+	Vector3& normal, float& depth, Vector3& pointA, Vector3& pointB) {
+
+	const int	maxIterations	= 32;
+	const int	maxVertices		= 4 + maxIterations;
+	const int	maxFaces		= 128;
+	const float tolerance		= 0.001f;
+
+	struct Face {
+		int		v[3];
+		Vector3 normal;
+		float	distance;
+	};
+	struct Edge {
+		int a;
+		int b;
+	};
+
+	SupportPoint	vertices[maxVertices];
+	Face			faces[maxFaces];
+	Edge			edges[maxFaces * 3];
+	int				numVertices = 4;
+	int				numFaces	= 0;
+
+	//Faces are wound away from this, rather than the origin, as the origin can be right on one
+	Vector3 inside;
+	for (int i = 0; i < 4; ++i) {
+		vertices[i] = simplex.points[i];
+		inside += simplex.points[i].point * 0.25f;
+	}
+
+	auto addFace = [&](int i0, int i1, int i2) {
+		if (numFaces >= maxFaces) {
+			return false;
+		}
+		Vector3 n = Vector3::Cross(vertices[i1].point - vertices[i0].point, vertices[i2].point - vertices[i0].point);
+		float length = n.Length();
+		if (length < 1e-8f) {
+			return true; //a sliver, which would give a meaningless normal
+		}
+		n = n / length;
+		float distance = Vector3::Dot(n, vertices[i0].point);
+		Face& f = faces[numFaces++];
+		if (Vector3::Dot(n, vertices[i0].point - inside) < 0.0f) { //always wind the face so its normal points outwards
+			f.v[0] = i0; f.v[1] = i2; f.v[2] = i1;
+			f.normal	= -n;
+			f.distance	= -distance;
+		}
+		else {
+			f.v[0] = i0; f.v[1] = i1; f.v[2] = i2;
+			f.normal	= n;
+			f.distance	= distance;
+		}
+		return true;
+	};
+
+	addFace(0, 1, 2);
+	addFace(0, 3, 1);
+	addFace(0, 2, 3);
+	addFace(1, 3, 2);
+	if (numFaces == 0) {
+		return false;
+	}
+
+	int closest = 0;
+	for (int iteration = 0; ; ++iteration) {
+		closest = 0;
+		for (int i = 1; i < numFaces; ++i) {
+			if (faces[i].distance < faces[closest].distance) {
+				closest = i;
+			}
+		}
+		if (iteration >= maxIterations || numVertices >= maxVertices) {
+			break;
+		}
+		SupportPoint p = Support(a, b, faces[closest].normal);
+		if (Vector3::Dot(p.point, faces[closest].normal) - faces[closest].distance < tolerance) {
+			break;
+		}
+
+		//Remove the faces the new point can see, keeping the edges of the hole
+		int numEdges = 0;
+		for (int i = 0; i < numFaces; ) {
+			if (Vector3::Dot(faces[i].normal, p.point - vertices[faces[i].v[0]].point) <= 0.0f) {
+				++i;
+				continue;
+			}
+			for (int e = 0; e < 3; ++e) {
+				Edge edge = { faces[i].v[e], faces[i].v[(e + 1) % 3] };
+				bool shared = false;
+				for (int j = 0; j < numEdges; ++j) {
+					if (edges[j].a == edge.b && edges[j].b == edge.a) { //the neighbouring face is going too
+						edges[j] = edges[--numEdges];
+						shared = true;
+						break;
+					}
+				}
+				if (!shared) {
+					edges[numEdges++] = edge;
+				}
+			}
+			faces[i] = faces[--numFaces];
+		}
+		if (numEdges == 0) {
+			break;
+		}
+		int newVertex = numVertices++;
+		vertices[newVertex] = p;
+		for (int j = 0; j < numEdges; ++j) {
+			if (!addFace(edges[j].a, edges[j].b, newVertex)) {
+				break;
+			}
+		}
+		if (numFaces == 0) {
+			return false;
+		}
+	}
+
+	const Face& f = faces[closest];
+	normal	= f.normal;
+	depth	= f.distance;
+
+	//Where the origin projects on to the face, as barycentric coordinates,
+	//gives the matching points on each of the original shapes
+	Vector3 p	= f.normal * f.distance;
+	Vector3 v0	= vertices[f.v[1]].point - vertices[f.v[0]].point;
+	Vector3 v1	= vertices[f.v[2]].point - vertices[f.v[0]].point;
+	Vector3 v2	= p - vertices[f.v[0]].point;
+
+	float d00 = Vector3::Dot(v0, v0);
+	float d01 = Vector3::Dot(v0, v1);
+	float d11 = Vector3::Dot(v1, v1);
+	float d20 = Vector3::Dot(v2, v0);
+	float d21 = Vector3::Dot(v2, v1);
+	float denom = d00 * d11 - d01 * d01;
+
+	float v = 0.0f;
+	float w = 0.0f;
+	if (fabs(denom) > 1e-12f) {
+		v = (d11 * d20 - d01 * d21) / denom;
+		w = (d00 * d21 - d01 * d20) / denom;
+	}
+	float u = 1.0f - v - w;
+
+	pointA = vertices[f.v[0]].onA * u + vertices[f.v[1]].onA * v + vertices[f.v[2]].onA * w;
+	pointB = pointA - normal * depth;
+	return true;
+}
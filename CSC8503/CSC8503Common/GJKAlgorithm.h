@@ -0,0 +1,55 @@
+#pragma once
+#include "CollisionDetection.h"
+#include "GJKShape.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		GJK walks a simplex through the Minkowski difference of the two shapes
+		until it either encloses the origin (the shapes overlap), or finds a
+		direction the origin lies beyond (they don't). EPA then grows that
+		simplex outwards to find the face closest to the origin, which gives
+		the contact normal and depth.
+
+		searchDir is used as the starting direction, and holds the last one
+		on return - passing back last substep's direction for the same pair
+		means separated pairs are usually rejected on the first iteration.
+		*/
+		class GJKAlgorithm {
+		public:
+			static bool Intersection(const GJKShape& shapeA, const Transform& worldTransformA,
+				const GJKShape& shapeB, const Transform& worldTransformB,
+				Vector3& searchDir, CollisionDetection::CollisionInfo& collisionInfo);
+
+			//Just the GJK half, for when there's no contact to find
+			static bool Overlaps(const GJKShape& shapeA, const GJKShape& shapeB, Vector3& searchDir);
+
+		protected:
+			struct SupportPoint {
+				Vector3 point;	//on the Minkowski difference
+				Vector3 onA;	//and the two points it came from
+				Vector3 onB;
+			};
+
+			struct Simplex {
+				SupportPoint points[4];
+				int			 count;
+			};
+
+			static SupportPoint Support(const GJKShape& a, const GJKShape& b, const Vector3& dir);
+
+			static bool Overlap(const GJKShape& a, const GJKShape& b, Vector3& searchDir, Simplex& simplex);
+			static bool NextSimplex(Simplex& simplex, Vector3& dir);
+			static bool Line(Simplex& simplex, Vector3& dir);
+			static bool Triangle(Simplex& simplex, Vector3& dir);
+			static bool Tetrahedron(Simplex& simplex, Vector3& dir);
+
+			//Grows a simplex GJK stopped short with, as the origin was right on it, into a
+			//tetrahedron for EPA to start from - false if the shapes are flat against each other
+			static bool CompleteSimplex(const GJKShape& a, const GJKShape& b, Simplex& simplex);
+
+			static bool ExpandPolytope(const GJKShape& a, const GJKShape& b, const Simplex& simplex,
+				Vector3& normal, float& depth, Vector3& pointA, Vector3& pointB);
+		};
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Transform.h"
+#include "AABBVolume.h"
+#include "OBBVolume.h"
+#include "SphereVolume.h"
+#include "CapsuleVolume.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Any convex shape we need to push through GJK - a box (possibly rotated),
+		swept along a line segment, and then inflated by a radius. A capsule is
+		a segment with a radius, and an OBB is just the box part, so one support
+		function covers every volume type. It's also a volume's world space
+		form for the other tests, so the physics system can work out each
+		body's once per substep, rather than every pair working it out again.
+		*/
+		struct GJKShape {
+			Vector3 centre;
+			Vector3 axes[3];
+			Vector3 halfSize;
+			Vector3 segmentHalf;
+			float	radius;
+
+			GJKShape() {
+				axes[0] = Vector3(1, 0, 0);
+				axes[1] = Vector3(0, 1, 0);
+				axes[2] = Vector3(0, 0, 1);
+				radius	= 0.0f;
+			}
+
+			//The point on the surface furthest along dir
+			Vector3 Support(const Vector3& dir) const;
+
+			static GJKShape FromAABB(const AABBVolume& volume, const Transform& worldTransform);
+			static GJKShape FromOBB(const OBBVolume& volume, const Transform& worldTransform);
+			static GJKShape FromCapsule(const CapsuleVolume& volume, const Transform& worldTransform);
+			static GJKShape FromSphere(const SphereVolume& volume, const Transform& worldTransform);
+			static GJKShape FromVolume(const CollisionVolume& volume, const Transform& worldTransform);
+		};
+	}
+}
@@ -6,13 +6,16 @@ using namespace NCL;
 using namespace CSC8503;
 
 GameClient::GameClient()	{
-	netHandle = enet_host_create(nullptr, 1, 1, 0, 0);
+	netPeer		= nullptr;
+	clientID	= -1;
+	netHandle = enet_host_create(nullptr, 1, ChannelCount, 0, 0);
+	SetCompression(defaultCompression);
 }
 
 GameClient::~GameClient()	{
-	//threadAlive = false;
-	//updateThread.join();
+	StopNetworkThread();
 	enet_host_destroy(netHandle);
+	netHandle = nullptr;
 }
 
 bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum) {
@@ -21,18 +24,16 @@ bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum
 
 	address.host = (d << 24) | (c << 16) | (b << 8) | (a);
 
-	netPeer = enet_host_connect(netHandle, &address, 2, 0);
+	netPeer = enet_host_connect(netHandle, &address, ChannelCount, 0);
 
-	if (netPeer != nullptr) {
-		//threadAlive = true;
-		//updateThread = std::thread(&GameClient::ThreadedUpdate, this);
-	}
 	return netPeer != nullptr;
 }
 
 void GameClient::Disconnect() {
+	StopNetworkThread();
 	enet_host_destroy(netHandle);
 	netHandle = nullptr;
+	netPeer = nullptr;
 }
 
 void GameClient::UpdateClient() {
@@ -41,31 +42,26 @@ void GameClient::UpdateClient() {
 		return;
 	}
 	//Handle all incoming packets & send any packets awaiting dispatch
-	ENetEvent event;
-	while (enet_host_service(netHandle, &event, 0) > 0)
+	NetworkEvent event;
+	while (PollEvent(event))
 	{
-
-		//std::cout<<"\nevent.peer :: "<<event.peer<<"\n";
-
 		if (event.type == ENET_EVENT_TYPE_CONNECT) {
 			std::cout << "Client: Connected to server!" << std::endl;
 		}
 		else if (event.type == ENET_EVENT_TYPE_RECEIVE) {
 			GamePacket* packet = (GamePacket*)event.packet->data;
+			statistics.RecordIncoming(event.peer, packet->type, (int)event.packet->dataLength);
 			ProcessPacket(packet);
 		}
-		enet_packet_destroy(event.packet);
+		if (event.packet) {
+			enet_packet_destroy(event.packet);
+		}
 	}
 }
 
 void GameClient::SendPacket(GamePacket&  payload) {
-	ENetPacket* dataPacket = enet_packet_create(&payload, payload.GetTotalSize(), 0);
-
-	int test = enet_peer_send(netPeer, 0, dataPacket);
+	if (netPeer == nullptr) {
+		return; //never connected
+	}
+	SendToPeer(netPeer, payload);
 }
-
-//void GameClient::ThreadedUpdate() {
-//	while (threadAlive) {
-//		UpdateClient();
-//	}
-//}
@@ -24,13 +24,9 @@ namespace NCL {
 			void SetClientID(int id) { clientID = id; }
 			int GetClientID() const { return clientID; }
 
-		protected:	
-			//void ThreadedUpdate();
-
+		protected:
 			ENetPeer*	netPeer;
 			int			clientID;
-			//std::atomic<bool>	threadAlive;
-			//std::thread			updateThread;
 		};
 	}
 }
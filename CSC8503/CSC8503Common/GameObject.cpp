@@ -1,5 +1,7 @@
 #include "GameObject.h"
 #include "CollisionDetection.h"
+#include "GameWorld.h"
+#include "NetworkObject.h"
 
 using namespace NCL::CSC8503;
 
@@ -7,10 +9,23 @@ GameObject::GameObject(string objectName) {
 	name = objectName;
 	layer = CollisionLayer::DEFAULT;
 	worldID = -1;
+	worldIndex = -1;
+	lateIndex = -1;
+	tickInterval = 1;
+	tickIndex = -1;
+	lastTickTime = 0.0;
+	ownerWorld = nullptr;
+	broadphaseID = -1;
+	shapeIndex = -1;
+	typeID = 0;
+	islandLink = nullptr;
 	flagForRemoval = false;
 	isTrigger = false;
+	triggerContacts = false;
 	isActive = true;
 	isSleeping = false;
+	inStaticTree = false;
+	parallelUpdate = false;
 	boundingVolume = nullptr;
 	physicsObject = nullptr;
 	renderObject = nullptr;
@@ -24,6 +39,15 @@ GameObject::~GameObject() {
 	delete networkObject;
 }
 
+void GameObject::SetTickInterval(int frames) {
+	if (ownerWorld) {
+		ownerWorld->SetTickInterval(this, frames);
+	}
+	else {
+		tickInterval = frames;
+	}
+}
+
 bool GameObject::GetBroadphaseAABB(Vector3& outSize) const {
 	if (!boundingVolume) {
 		return false;
@@ -15,8 +15,10 @@ using std::vector;
 namespace NCL {
 	namespace CSC8503 {
 		class NetworkObject;
+		class GameWorld;
 
-		class GameObject {
+		//Pooled, as levels are made of thousands of these, and projectiles come and go all the time
+		class GameObject : public PooledObject {
 		public:
 			GameObject(string name = "");
 			virtual ~GameObject();
@@ -33,6 +35,12 @@ namespace NCL {
 				return isActive;
 			}
 
+			//Inactive objects stay in the world, but aren't updated, simulated or drawn,
+			//so they can be brought back later without being added to it again
+			void SetActive(bool a) {
+				isActive = a;
+			}
+
 			bool IsSleeping() const {
 				return isSleeping;
 			}
@@ -87,6 +95,17 @@ namespace NCL {
 				layer = l;
 			}
 
+			//What kind of object this is, so gameplay code can tell what
+			//it's hit without comparing names. The IDs are up to the game,
+			//0 meaning nothing in particular
+			int GetTypeID() const {
+				return typeID;
+			}
+
+			void SetTypeID(int id) {
+				typeID = id;
+			}
+
 			virtual void OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
 				//std::cout << "OnCollisionBegin event occured!\n";
 			}
@@ -99,8 +118,22 @@ namespace NCL {
 				return isTrigger;
 			}
 
-			void SetTrigger(bool t) {
-				isTrigger = t;
+			//Triggers normally only find out whether they overlap something, with
+			//no contact point - ones that need the normal too go the long way round
+			void SetTrigger(bool t, bool wantsContacts = false) {
+				isTrigger		= t;
+				triggerContacts	= wantsContacts;
+			}
+
+			bool TriggerWantsContacts() const {
+				return triggerContacts;
+			}
+
+			//Trigger pairs that only need to know they're overlapping
+			static bool OverlapOnlyPair(const GameObject& a, const GameObject& b) {
+				bool triggerA = a.isTrigger && !a.triggerContacts;
+				bool triggerB = b.isTrigger && !b.triggerContacts;
+				return (triggerA || triggerB) && !(a.isTrigger && a.triggerContacts) && !(b.isTrigger && b.triggerContacts);
 			}
 
 			void Remove() {
@@ -113,6 +146,32 @@ namespace NCL {
 
 			virtual void Update(float dt) {};
 
+			//Gameplay state beyond the physics (health, ammo...) that needs to go
+			//back along with it when the world is rolled back
+			static const int GameStateSlots = 4;
+			virtual void SaveGameState(int (&state)[GameStateSlots]) const {}
+			virtual void RestoreGameState(const int (&state)[GameStateSlots]) {}
+
+			//Objects whose Update only changes their own state (reading others is
+			//fine, as long as nothing else changes them meanwhile) can be updated
+			//on the job system, after everything else has been updated as usual
+			void SetParallelUpdate(bool p) {
+				parallelUpdate = p;
+			}
+
+			bool HasParallelUpdate() const {
+				return parallelUpdate;
+			}
+
+			//How many frames go by between Updates, each of which is told how
+			//long it's been since the last. 0 means it isn't updated at all until
+			//this is set again, so objects with nothing to do aren't visited
+			void SetTickInterval(int frames);
+
+			int GetTickInterval() const {
+				return tickInterval;
+			}
+
 			bool GetBroadphaseAABB(Vector3& outsize) const;
 
 			void UpdateBroadphaseAABB();
@@ -125,13 +184,70 @@ namespace NCL {
 				return worldID;
 			}
 
+			//Where the world's keeping this in its object lists, so it can be
+			//taken out of them without searching
+			void SetWorldIndex(int index) {
+				worldIndex = index;
+			}
+
+			int GetWorldIndex() const {
+				return worldIndex;
+			}
+
+			void SetLateIndex(int index) {
+				lateIndex = index;
+			}
+
+			int GetLateIndex() const {
+				return lateIndex;
+			}
+
+			void SetBroadphaseID(int newID) {
+				broadphaseID = newID;
+			}
+
+			int GetBroadphaseID() const {
+				return broadphaseID;
+			}
+
+			//Where the physics system has put this substep's world space shape, or -1
+			void SetShapeIndex(int i) {
+				shapeIndex = i;
+			}
+
+			int GetShapeIndex() const {
+				return shapeIndex;
+			}
+
+			//Sleeping objects are linked into a ring with the rest of their
+			//island, so that waking one of them wakes them all
+			void SetIslandLink(GameObject* next) {
+				islandLink = next;
+			}
+
+			GameObject* GetIslandLink() const {
+				return islandLink;
+			}
+
 			bool IsStatic() const {
 				return physicsObject && physicsObject->GetInverseMass() == 0;
 			}
 
+			//Set by the world, so anything searching its static tree knows which
+			//objects it will find there, and which it has to check for itself
+			void SetInStaticTree(bool s) {
+				inStaticTree = s;
+			}
+
+			bool IsInStaticTree() const {
+				return inStaticTree;
+			}
+
 			
 
 		protected:
+			friend class GameWorld; //looks after the tick list details below
+
 			Transform			transform;
 
 			CollisionVolume*	boundingVolume;
@@ -141,9 +257,22 @@ namespace NCL {
 
 			bool			flagForRemoval;
 			bool			isTrigger;
+			bool			triggerContacts;
 			bool			isActive;
 			bool			isSleeping;
+			bool			inStaticTree;
+			bool			parallelUpdate;
 			int				worldID;
+			int				worldIndex;
+			int				lateIndex;
+			int				tickInterval;
+			int				tickIndex;
+			double			lastTickTime;
+			GameWorld*		ownerWorld;
+			int				broadphaseID;
+			int				shapeIndex;
+			int				typeID;
+			GameObject*		islandLink;
 			string			name;
 			CollisionLayer  layer;
 
@@ -10,7 +10,6 @@ GameServer::GameServer(int onPort, int maxClients)	{
 	clientMax	= maxClients;
 	clientCount = 0;
 	netHandle	= nullptr;
-	//threadAlive = false;
 
 	Initialise();
 }
@@ -21,9 +20,8 @@ GameServer::~GameServer()	{
 
 void GameServer::Shutdown() {
 	SendGlobalPacket(BasicNetworkMessages::Shutdown);
-
-	//threadAlive = false;
-	//updateThread.join();
+	StopNetworkThread();
+	enet_host_flush(netHandle); //or it'll never get sent
 
 	enet_host_destroy(netHandle);
 	netHandle = nullptr;
@@ -34,15 +32,13 @@ bool GameServer::Initialise() {
 	address.host = ENET_HOST_ANY;
 	address.port = port;
 
-	netHandle = enet_host_create(&address, clientMax, 1, 0, 0);
+	netHandle = enet_host_create(&address, clientMax, ChannelCount, 0, 0);
 
 	if (!netHandle) {
 		std::cout << __FUNCTION__ << " failed to create network handle!" << std::endl;
 		return false;
 	}
-	//threadAlive		= true;
-	//updateThread	= std::thread(&GameServer::ThreadedUpdate, this);
-
+	SetCompression(defaultCompression);
 	return true;
 }
 
@@ -54,16 +50,18 @@ bool GameServer::SendGlobalPacket(int msgID) {
 }
 
 bool GameServer::SendGlobalPacket(GamePacket& packet) {
-	ENetPacket* dataPacket = enet_packet_create(&packet, packet.GetTotalSize(), 0);
-	enet_host_broadcast(netHandle, 0, dataPacket);
+	SendToPeer(nullptr, packet);
 	return true;
 }
 
 bool GameServer::SendPacketToPeer(int client, const GamePacket& packet)
 {
-	ENetPeer* clientPeer = &netHandle->peers[client];
-	ENetPacket* dataPacket = enet_packet_create(&packet, packet.GetTotalSize(), 0);
-	enet_peer_send(clientPeer, 0, dataPacket);
+	SendToPeer(&netHandle->peers[client], packet);
+	return true;
+}
+
+bool GameServer::SendPreparedPacketToPeer(int client, ENetPacket* handle) {
+	SendPreparedPacket(&netHandle->peers[client], handle);
 	return true;
 }
 
@@ -72,41 +70,37 @@ void GameServer::UpdateServer() {
 		return;
 	}
 
-	ENetEvent event;
-	while (enet_host_service(netHandle, &event, 0) > 0)	{
-		int type	= event.type;
-		ENetPeer* p = event.peer;
-
-		int peer = p->incomingPeerID;
-
-		//std::cout << "\nevent.peer :: " << event.peer << "\tincomingPeerID :: " << peer<<"\n";
+	NetworkEvent event;
+	while (PollEvent(event))	{
+		int type = event.type;
+		int peer = event.peer;
 
 		if (type == ENetEventType::ENET_EVENT_TYPE_CONNECT) {
 			std::cout << "Server: New client connected" << std::endl;
+			clientCount++;
 			NewPlayerPacket player(peer);
 			SendGlobalPacket(player);
 			SendPacketToPeer(peer, PlayerIDPacket(peer, -1));
 		}
 		else if (type == ENetEventType::ENET_EVENT_TYPE_DISCONNECT) {
 			std::cout << "Server: A client has disconnected" << std::endl;
+			clientCount = clientCount > 0 ? clientCount - 1 : 0;
+			statistics.RemovePeer(peer);
 			PlayerDisconnectPacket player(peer);
 			SendGlobalPacket(player);
 			SendPacketToPeer(peer, DisconnectConfirmPacket(peer));
 		}
 		else if (type == ENetEventType::ENET_EVENT_TYPE_RECEIVE) {
 			GamePacket* packet = (GamePacket*)event.packet->data;
+			statistics.RecordIncoming(peer, packet->type, (int)event.packet->dataLength);
 			ProcessPacket(packet, peer);
 		}
-		enet_packet_destroy(event.packet);
+		if (event.packet) {
+			enet_packet_destroy(event.packet);
+		}
 	}
 }
 
-//void GameServer::ThreadedUpdate() {
-//	while (threadAlive) {
-//		UpdateServer();
-//	}
-//}
-
 //Second networking tutorial stuff
 
 void GameServer::SetGameWorld(GameWorld &g) {
@@ -17,29 +17,23 @@ namespace NCL {
 
 			void SetGameWorld(GameWorld &g);
 
-			//void ThreadedUpdate();
-
 			bool SendGlobalPacket(int msgID);
 			bool SendGlobalPacket(GamePacket& packet);
 
 			bool SendPacketToPeer(int client, const GamePacket& packet);
+			bool SendPreparedPacketToPeer(int client, ENetPacket* handle);
 
 			virtual void UpdateServer();
 
+			int GetClientCount() const {
+				return clientCount;
+			}
+
 		protected:
 			int			port;
 			int			clientMax;
 			int			clientCount;
 			GameWorld*	gameWorld;
-
-			//std::atomic<bool> threadAlive;
-
-			
-
-			//std::thread updateThread;
-
-			int incomingDataRate;
-			int outgoingDataRate;
 		};
 	}
 }
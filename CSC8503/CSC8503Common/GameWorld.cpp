@@ -3,8 +3,17 @@
 #include "Constraint.h"
 #include "SoundEmitter.h"
 #include "CollisionDetection.h"
+#include "JobSystem.h"
+#include "FrameProfiler.h"
 #include "../../Common/Camera.h"
+#include "../../Common/Assets.h"
+#include "../../Common/AssetFile.h"
+#include "../../Common/MemoryPool.h"
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <iostream>
 
 using namespace NCL;
 using namespace NCL::CSC8503;
@@ -12,9 +21,25 @@ using namespace NCL::CSC8503;
 GameWorld::GameWorld() {
 	mainCamera = new Camera();
 
+	ComponentPool<PhysicsObject>::Get().SetMemoryTag(MemoryTag::Physics);
+	ComponentPool<RenderObject>::Get().SetMemoryTag(MemoryTag::Rendering);
+
 	shuffleConstraints = false;
 	shuffleObjects = false;
 	worldIDCounter = 0;
+	constraintVersion = 0;
+	staticVersion = 0;
+	raycastBatchMinRays = 16;
+	raycastBatchSize = 8;
+	parallelUpdateMinObjects = 64;
+	parallelUpdateBatchSize = 32;
+	transformBatchMinObjects = 256;
+	transformBatchSize = 128;
+	updatingObjects = false;
+	tickFrame = 0;
+	worldTime = 0.0;
+	staticTree = nullptr;
+	dynamicTree = nullptr;
 }
 
 GameWorld::~GameWorld() {
@@ -22,11 +47,35 @@ GameWorld::~GameWorld() {
 }
 
 void GameWorld::Clear() {
+	for (GameObject* g : gameObjects) {
+		for (auto& l : objectListeners) {
+			l.onRemove(g);
+		}
+		g->SetInStaticTree(false);
+		g->SetWorldIndex(-1);
+		g->tickIndex	= -1;
+		g->ownerWorld	= nullptr;
+	}
+	tickLists.clear();
+	spatialGrid.Clear();
+	ClearLateObjects();
+	if (staticTree) { //it only points at the objects we're forgetting about
+		staticTree->Clear();
+		staticVersion++;
+	}
 	gameObjects.clear();
+	awakeObjects.clear();
+	deletionObjects.clear();
 	constraints.clear();
+	constraintVersion++;
 }
 
 void GameWorld::ClearAndErase() {
+	for (GameObject* g : gameObjects) {
+		for (auto& l : objectListeners) {
+			l.onRemove(g);
+		}
+	}
 	for (auto& i : gameObjects) {
 		delete i;
 		i = nullptr;
@@ -35,28 +84,102 @@ void GameWorld::ClearAndErase() {
 		delete i;
 		i = nullptr;
 	}
-	Clear();
+	if (staticTree) {
+		staticTree->Clear();
+		staticVersion++;
+	}
+	//Listeners have already been told, so don't go through Clear() again
+	gameObjects.clear();
+	awakeObjects.clear();
+	deletionObjects.clear();
+	lateObjects.clear();
+	tickLists.clear();
+	spatialGrid.Clear();
+	constraints.clear();
+	constraintVersion++;
+
+	//Everything the level was made of has gone, so its memory can be laid out again from
+	//the start - unless something outside of it still has a slot, which is worth knowing
+	if (!MemoryPool::Reset()) {
+		std::cout << __FUNCTION__ << ": MemoryPool not reset, " << MemoryPool::GetLiveCount() << " objects still live" << std::endl;
+	}
+	if (!ComponentPool<PhysicsObject>::Get().Reset()) {
+		std::cout << __FUNCTION__ << ": PhysicsObject pool not reset, " << ComponentPool<PhysicsObject>::Get().GetLiveCount() << " still live" << std::endl;
+	}
+	if (!ComponentPool<RenderObject>::Get().Reset()) {
+		std::cout << __FUNCTION__ << ": RenderObject pool not reset, " << ComponentPool<RenderObject>::Get().GetLiveCount() << " still live" << std::endl;
+	}
 }
 
 void GameWorld::AddGameObject(GameObject* o) {
+	o->SetWorldIndex((int)gameObjects.size());
 	gameObjects.emplace_back(o);
 	o->SetWorldID(worldIDCounter++);
+	if (staticTree) {
+		o->SetLateIndex((int)lateObjects.size());
+		lateObjects.emplace_back(o);
+	}
+	{
+		std::lock_guard<std::mutex> lock(tickMutex);
+		o->ownerWorld = this;
+		AddToTickList(o);
+	}
+	spatialGrid.Add(o);
+	for (auto& l : objectListeners) {
+		l.onAdd(o);
+	}
 }
 
 void GameWorld::RemoveGameObject(GameObject* o, bool andDelete) {
-	gameObjects.erase(std::remove(gameObjects.begin(), gameObjects.end(), o), gameObjects.end());
+	int index = o->GetWorldIndex();
+	if (index >= 0 && index < (int)gameObjects.size() && gameObjects[index] == o) {
+		gameObjects[index] = gameObjects.back();
+		gameObjects[index]->SetWorldIndex(index);
+		gameObjects.pop_back();
+	}
+	int lateIndex = o->GetLateIndex();
+	if (lateIndex >= 0 && lateIndex < (int)lateObjects.size() && lateObjects[lateIndex] == o) {
+		lateObjects[lateIndex] = lateObjects.back();
+		lateObjects[lateIndex]->SetLateIndex(lateIndex);
+		lateObjects.pop_back();
+	}
+	o->SetWorldIndex(-1);
+	o->SetLateIndex(-1);
+	{
+		std::lock_guard<std::mutex> lock(tickMutex);
+		RemoveFromTickList(o);
+		o->ownerWorld = nullptr;
+	}
+	spatialGrid.Remove(o);
+	for (auto& l : objectListeners) {
+		l.onRemove(o);
+	}
+	if (o->IsInStaticTree()) {
+		staticVersion++;
+	}
 	if (andDelete) {
 		delete o;
 		o = nullptr;
 	}
 }
 
+void GameWorld::AddObjectListener(void* owner, GameObjectFunc onAdd, GameObjectFunc onRemove) {
+	objectListeners.push_back({ owner, onAdd, onRemove });
+}
+
+void GameWorld::RemoveObjectListener(void* owner) {
+	objectListeners.erase(std::remove_if(objectListeners.begin(), objectListeners.end(),
+		[&](const ObjectListener& l) { return l.owner == owner; }), objectListeners.end());
+}
+
 void GameWorld::AddConstraint(Constraint* c) {
 	constraints.emplace_back(c);
+	constraintVersion++;
 }
 
 void GameWorld::RemoveConstraint(Constraint* c, bool andDelete) {
 	constraints.erase(std::remove(constraints.begin(), constraints.end(), c), constraints.end());
+	constraintVersion++;
 	if (andDelete) {
 		delete c;
 		c = nullptr;
@@ -101,23 +224,191 @@ void GameWorld::GetConstraintIterators(
 }
 
 
-void GameWorld::UpdateWorld(float dt) {
+/*
+Everything Prune found flagged for removal is taken out in one pass over
+each list, which keeps the rest of the objects in the order they were in,
+rather than searching the lists once per object.
+*/
+void GameWorld::RemoveDeletedObjects() {
+	if (deletionObjects.empty()) {
+		return;
+	}
 	for (GameObject* g : deletionObjects) {
-		RemoveGameObject(g, true);
+		for (auto& l : objectListeners) {
+			l.onRemove(g);
+		}
+		if (g->IsInStaticTree()) {
+			staticVersion++;
+		}
+		spatialGrid.Remove(g);
+		gameObjects[g->GetWorldIndex()] = nullptr;
+		if (g->GetLateIndex() >= 0) {
+			lateObjects[g->GetLateIndex()] = nullptr;
+		}
+		std::lock_guard<std::mutex> lock(tickMutex);
+		RemoveFromTickList(g);
 	}
+	int kept = 0;
+	for (GameObject* g : gameObjects) {
+		if (g) {
+			g->SetWorldIndex(kept);
+			gameObjects[kept++] = g;
+		}
+	}
+	gameObjects.resize(kept);
 
-	for (int i = 0; i < gameObjects.size(); ++i) {
-		GameObject* g = gameObjects[i];
+	kept = 0;
+	for (GameObject* g : lateObjects) {
 		if (g) {
-			g->Update(dt);
-			if (Debug::IsActive() && Debug::GetShowCollisionVolumes() && g != Debug::GetSelectedObject()) {
+			g->SetLateIndex(kept);
+			lateObjects[kept++] = g;
+		}
+	}
+	lateObjects.resize(kept);
+
+	for (GameObject* g : deletionObjects) {
+		delete g;
+	}
+	deletionObjects.clear();
+}
+
+void GameWorld::SetTickInterval(GameObject* o, int frames) {
+	std::lock_guard<std::mutex> lock(tickMutex);
+	if (updatingObjects) {
+		pendingTickChanges.emplace_back(o, frames);
+	}
+	else {
+		ChangeTickInterval(o, frames);
+	}
+}
+
+//These expect tickMutex to be held already
+void GameWorld::ChangeTickInterval(GameObject* o, int frames) {
+	if (o->tickInterval == frames) {
+		return;
+	}
+	RemoveFromTickList(o);
+	o->tickInterval = frames;
+	AddToTickList(o);
+}
+
+void GameWorld::AddToTickList(GameObject* o) {
+	if (o->tickInterval <= 0) {
+		return;
+	}
+	std::vector<GameObject*>& list = tickLists[o->tickInterval];
+	o->tickIndex	= (int)list.size();
+	o->lastTickTime = worldTime;
+	list.emplace_back(o);
+}
+
+void GameWorld::RemoveFromTickList(GameObject* o) {
+	if (o->tickIndex < 0) {
+		return;
+	}
+	std::vector<GameObject*>& list = tickLists[o->tickInterval];
+	list[o->tickIndex] = list.back();
+	list[o->tickIndex]->tickIndex = o->tickIndex;
+	list.pop_back();
+	o->tickIndex = -1;
+}
+
+void GameWorld::ClearLateObjects() {
+	for (GameObject* g : lateObjects) {
+		g->SetLateIndex(-1);
+	}
+	lateObjects.clear();
+}
+
+/*
+Only objects in the tick lists are visited, so anything idle (like a wall
+block that isn't fading) costs nothing. Objects that only want updating
+every few frames are spread across those frames, rather than all coming
+due at once, and are given the time that's gone by since their last one.
+
+Objects that have asked for it are left out of the usual update, and are
+updated together afterwards, spread across the job system, so they see
+everything else as it is at the end of the frame. Anything they'd need
+to do to the rest of the world (like Remove()) only sets their own flags.
+*/
+void GameWorld::UpdateWorld(float dt) {
+	ProfileScope scope("World Update");
+	RemoveDeletedObjects();
+
+	worldTime += dt;
+	tickFrame++;
+	{
+		std::lock_guard<std::mutex> lock(tickMutex);
+		updatingObjects = true;
+	}
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	parallelObjects.clear();
+	parallelDeltas.clear();
+	for (auto& t : tickLists) {
+		int interval = t.first;
+		std::vector<GameObject*>& objects = t.second;
+		//Objects added by an Update go on the end, and are updated this frame too
+		for (int i = tickFrame % interval; i < (int)objects.size(); i += interval) {
+			GameObject* g = objects[i];
+			if (!g->IsActive()) {
+				continue;
+			}
+			float tickDelta = (float)(worldTime - g->lastTickTime);
+			g->lastTickTime = worldTime;
+			if (jobs && g->HasParallelUpdate()) {
+				parallelObjects.emplace_back(g);
+				parallelDeltas.emplace_back(tickDelta);
+			}
+			else {
+				g->Update(tickDelta);
+			}
+		}
+	}
+
+	int parallelCount = (int)parallelObjects.size();
+	auto updateRange = [&](int first, int last, int worker) {
+		for (int i = first; i < last; ++i) {
+			parallelObjects[i]->Update(parallelDeltas[i]);
+		}
+	};
+	if (parallelCount >= parallelUpdateMinObjects) {
+		jobs->ParallelFor(parallelCount, parallelUpdateBatchSize, updateRange);
+	}
+	else {
+		updateRange(0, parallelCount, 0);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(tickMutex);
+		updatingObjects = false;
+		for (auto& c : pendingTickChanges) {
+			if (c.first->ownerWorld == this) {
+				ChangeTickInterval(c.first, c.second);
+			}
+		}
+		pendingTickChanges.clear();
+	}
+
+	if (Debug::IsActive() && (Debug::GetShowCollisionVolumes() || Debug::GetShowCollisionMeshes())) {
+		for (GameObject* g : gameObjects) {
+			if (g->IsActive() && g != Debug::GetSelectedObject()) {
 				Debug::DrawCollider(g);
 			}
 		}
 	}
+	if (Debug::IsActive() && Debug::GetShowStaticTree() && staticTree) {
+		staticTree->DebugDraw(Debug::GetStaticTreeDepth());
+	}
+
+	UpdateTransforms();
+	spatialGrid.Update();
 
 	if (shuffleObjects) {
 		std::random_shuffle(gameObjects.begin(), gameObjects.end());
+		for (int i = 0; i < (int)gameObjects.size(); ++i) {
+			gameObjects[i]->SetWorldIndex(i);
+		}
 	}
 
 	if (shuffleConstraints) {
@@ -127,6 +418,30 @@ void GameWorld::UpdateWorld(float dt) {
 	Debug::SetNumTotalObjects(gameObjects.size());
 }
 
+/*
+Setting a transform's position, orientation or scale only marks its matrix
+as out of date, so everything that's moved this frame has its matrix built
+here, just the once, however many times it was changed. An object following
+a parent only ever reads the parent's position and orientation, never its
+matrix, so it doesn't matter what order they're done in, and they can be
+spread across the job system.
+*/
+void GameWorld::UpdateTransforms() {
+	int count = (int)gameObjects.size();
+	auto updateRange = [&](int first, int last, int worker) {
+		for (int i = first; i < last; ++i) {
+			gameObjects[i]->GetTransform().UpdateMatrix();
+		}
+	};
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (jobs && count >= transformBatchMinObjects) {
+		jobs->ParallelFor(count, transformBatchSize, updateRange);
+	}
+	else {
+		updateRange(0, count, 0);
+	}
+}
+
 void NCL::CSC8503::GameWorld::Prune() {
 	awakeObjects.clear();
 	deletionObjects.clear();
@@ -134,62 +449,398 @@ void NCL::CSC8503::GameWorld::Prune() {
 		if (g->ToRemove()) {
 			deletionObjects.emplace_back(g);
 		}
-		else if (!g->IsSleeping()) {
+		else if (!g->IsSleeping() && g->IsActive()) {
 			awakeObjects.emplace_back(g);
 		}
 	}
 }
 
-bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject) const {
-	//The simplest raycast just goes through each object and sees if there's a collision
+void GameWorld::WakeObject(GameObject* o) {
+	if (!o->IsSleeping()) {
+		return;
+	}
+	o->SetSleeping(false);
+	if (!o->ToRemove() && o->IsActive()) {
+		awakeObjects.emplace_back(o);
+	}
+}
+
+/*
+Static geometry is walked through the Octree, and moving objects through the
+broadphase's tree, both front to back. Each hit shortens the ray, so anything
+further away than the closest hit so far is never tested. If we only want
+any hit, the ray is cut off completely as soon as we find one.
+*/
+bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject, CollisionLayer rayLayer) const {
+	uint32_t layerMask = layerMatrix.GetMask(rayLayer);
+	if (!staticTree || !dynamicTree) {
+		return LinearRaycast(r, closestCollision, closestObject, layerMask);
+	}
+	RayCollision collision;
+
+	auto testObject = [&](GameObject* o, float& maxDistance) {
+		if (maxDistance < 0.0f || !o->GetBoundingVolume() || !o->IsActive() || !(layerMask & LayerBit(o->GetLayer()))) {
+			return;
+		}
+		RayCollision thisCollision;
+		if (CollisionDetection::RayIntersection(r, *o, thisCollision) && thisCollision.rayDistance < collision.rayDistance) {
+			thisCollision.node = o;
+			collision = thisCollision;
+			maxDistance = closestObject ? thisCollision.rayDistance : -1.0f;
+		}
+	};
+
+	Vector3 dir = r.GetDirection();
+	Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	float maxDistance = FLT_MAX;
+	staticTree->RayCast(r, maxDistance,
+		[&](const OctreeEntry<GameObject*>& entry, float& distance) {
+			float entryDistance; //cheap check against the object's bounds first
+			if (CollisionDetection::RaySlabTest(r.GetPosition(), invDir, entry.pos - entry.size, entry.pos + entry.size, distance, entryDistance)) {
+				testObject(entry.object, distance);
+			}
+		}
+	);
+	if (collision.node) {
+		maxDistance = closestObject ? collision.rayDistance : -1.0f;
+	}
+	dynamicTree->RayCast(r, maxDistance, testObject);
+
+	for (GameObject* o : lateObjects) {
+		if (o->IsStatic() && (closestObject || !collision.node)) {
+			testObject(o, maxDistance);
+		}
+	}
+
+	if (collision.node) {
+		closestCollision = collision;
+		return true;
+	}
+	return false;
+}
+
+bool GameWorld::LineOfSight(const Vector3& from, const Vector3& to, CollisionLayer rayLayer) const {
+	Vector3 offset	= to - from;
+	float length	= offset.Length();
+	if (!staticTree || length < 0.0001f) {
+		return true;
+	}
+	uint32_t layerMask = layerMatrix.GetMask(rayLayer);
+
+	Ray r(from, offset / length);
+	Vector3 dir = r.GetDirection();
+	Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	bool blocked = false;
+	staticTree->RayCast(r, length,
+		[&](const OctreeEntry<GameObject*>& entry, float& distance) {
+			GameObject* o = entry.object;
+			if (distance < 0.0f || !o->GetBoundingVolume() || !(layerMask & LayerBit(o->GetLayer()))) {
+				return;
+			}
+			float entryDistance;
+			if (!CollisionDetection::RaySlabTest(r.GetPosition(), invDir, entry.pos - entry.size, entry.pos + entry.size, distance, entryDistance)) {
+				return;
+			}
+			RayCollision collision;
+			if (CollisionDetection::RayIntersection(r, *o, collision) && collision.rayDistance < length) {
+				blocked		= true;
+				distance	= -1.0f; //no need to look any further
+			}
+		}
+	);
+	return !blocked;
+}
+
+/*
+Rays heading into the same octant visit the trees' nodes in much the same
+order, so the batch is sorted by direction sign first, and each worker
+gets a run of similar rays. Workers only ever read from the world.
+*/
+void GameWorld::RaycastBatch(const std::vector<Ray>& rays, std::vector<RayCollision>& results, bool closestObject, CollisionLayer rayLayer) const {
+	int count = (int)rays.size();
+	results.clear();
+	results.resize(count);
+
+	int octantStart[9] = { 0 };
+	std::vector<int> rayOctants(count);
+	for (int i = 0; i < count; ++i) {
+		Vector3 dir = rays[i].GetDirection();
+		rayOctants[i] = (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) | (dir.z < 0.0f ? 4 : 0);
+		octantStart[rayOctants[i] + 1]++;
+	}
+	for (int i = 0; i < 8; ++i) {
+		octantStart[i + 1] += octantStart[i];
+	}
+	std::vector<int> order(count);
+	for (int i = 0; i < count; ++i) {
+		order[octantStart[rayOctants[i]]++] = i;
+	}
+
+	auto castRange = [&](int first, int last, int worker) {
+		for (int i = first; i < last; ++i) {
+			Ray ray = rays[order[i]];
+			Raycast(ray, results[order[i]], closestObject, rayLayer);
+		}
+	};
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (jobs && count >= raycastBatchMinRays) {
+		jobs->ParallelFor(count, raycastBatchSize, castRange);
+	}
+	else {
+		castRange(0, count, 0);
+	}
+}
+
+void GameWorld::LineOfSightBatch(const std::vector<Vector3>& from, const std::vector<Vector3>& to, std::vector<char>& visible, CollisionLayer rayLayer) const {
+	int count = (int)(from.size() < to.size() ? from.size() : to.size());
+	visible.resize(count);
+
+	auto castRange = [&](int first, int last, int worker) {
+		for (int i = first; i < last; ++i) {
+			visible[i] = LineOfSight(from[i], to[i], rayLayer) ? 1 : 0;
+		}
+	};
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (jobs && count >= raycastBatchMinRays) {
+		jobs->ParallelFor(count, raycastBatchSize, castRange);
+	}
+	else {
+		castRange(0, count, 0);
+	}
+}
+
+bool GameWorld::OverlapSphere(const Vector3& centre, float radius, std::vector<GameObject*>& results, CollisionLayer queryLayer) const {
+	GJKShape shape;
+	shape.centre	= centre;
+	shape.radius	= radius;
+	return Overlap(shape, results, layerMatrix.GetMask(queryLayer));
+}
+
+bool GameWorld::OverlapBox(const Vector3& centre, const Vector3& halfSize, const Quaternion& orientation, std::vector<GameObject*>& results, CollisionLayer queryLayer) const {
+	GJKShape shape;
+	shape.centre	= centre;
+	shape.axes[0]	= orientation * Vector3(1, 0, 0);
+	shape.axes[1]	= orientation * Vector3(0, 1, 0);
+	shape.axes[2]	= orientation * Vector3(0, 0, 1);
+	shape.halfSize	= halfSize;
+	return Overlap(shape, results, layerMatrix.GetMask(queryLayer));
+}
+
+bool GameWorld::OverlapCapsule(const Vector3& start, const Vector3& end, float radius, std::vector<GameObject*>& results, CollisionLayer queryLayer) const {
+	GJKShape shape;
+	shape.centre		= (start + end) * 0.5f;
+	shape.segmentHalf	= (end - start) * 0.5f;
+	shape.radius		= radius;
+	return Overlap(shape, results, layerMatrix.GetMask(queryLayer));
+}
+
+/*
+The shape's world space box finds the candidates, from the static tree's
+entries, the dynamic tree's proxies, and anything static that's come along
+since the tree was built. Each of them is then tested with the same overlap
+test as the triggers use. Volumes that can't go through that (meshes and
+compounds) are taken on their broadphase box overlapping the shape's.
+*/
+bool GameWorld::Overlap(const GJKShape& shape, std::vector<GameObject*>& results, uint32_t layerMask) const {
+	results.clear();
+
+	Vector3 extent(shape.radius, shape.radius, shape.radius);
+	for (int i = 0; i < 3; ++i) {
+		extent.x += abs(shape.axes[i].x) * shape.halfSize[i];
+		extent.y += abs(shape.axes[i].y) * shape.halfSize[i];
+		extent.z += abs(shape.axes[i].z) * shape.halfSize[i];
+	}
+	extent += Vector3(abs(shape.segmentHalf.x), abs(shape.segmentHalf.y), abs(shape.segmentHalf.z));
+
+	auto testObject = [&](GameObject* o) {
+		if (!o->GetBoundingVolume() || !o->IsActive() || !(layerMask & LayerBit(o->GetLayer()))) {
+			return;
+		}
+		VolumeType type = o->GetBoundingVolume()->type;
+		if (type == VolumeType::Mesh || type == VolumeType::Compound) {
+			Vector3 halfSize;
+			if (o->GetBroadphaseAABB(halfSize) && CollisionDetection::AABBTest(shape.centre, o->GetTransform().GetPosition(), extent, halfSize)) {
+				results.emplace_back(o);
+			}
+			return;
+		}
+		GJKShape objectShape = GJKShape::FromVolume(*o->GetBoundingVolume(), o->GetTransform());
+		Vector3 searchDir;
+		if (CollisionDetection::ShapesOverlap(shape, objectShape, searchDir)) {
+			results.emplace_back(o);
+		}
+	};
+
+	if (!staticTree || !dynamicTree) {
+		for (GameObject* o : gameObjects) {
+			testObject(o);
+		}
+		return !results.empty();
+	}
+	staticTree->Query(shape.centre, extent,
+		[&](const OctreeEntry<GameObject*>& entry) { testObject(entry.object); }
+	);
+
+	dynamicTree->Query(shape.centre, extent, testObject);
+
+	for (GameObject* o : lateObjects) {
+		if (o->IsStatic()) {
+			testObject(o);
+		}
+	}
+	return !results.empty();
+}
+
+//The simplest raycast just goes through each object and sees if there's a collision
+bool GameWorld::LinearRaycast(Ray& r, RayCollision& closestCollision, bool closestObject, uint32_t layerMask) const {
 	RayCollision collision;
-	CollisionLayer closestObjLayer = CollisionLayer::DEFAULT;
 
 	for (auto& i : gameObjects) {
-		if (!i->GetBoundingVolume()) { //objects might not be collideable etc...
+		if (!i->GetBoundingVolume() || !i->IsActive()) { //objects might not be collideable etc...
+			continue;
+		}
+		if (!(layerMask & LayerBit(i->GetLayer()))) { //filtered out before doing any intersection tests
 			continue;
 		}
 		RayCollision thisCollision;
 		if (CollisionDetection::RayIntersection(r, *i, thisCollision)) {
-			bool colAllowed = CollisionAllowed(CollisionLayer::RAY, i->GetLayer());
 			if (!closestObject) {
-				closestCollision = collision;
+				closestCollision = thisCollision;
 				closestCollision.node = i;
-				return colAllowed;
+				return true;
 			}
-			else {
-				if (colAllowed && thisCollision.rayDistance < collision.rayDistance) {
-					thisCollision.node = i;
-					collision = thisCollision;
-					closestObjLayer = i->GetLayer();
-				}
+			else if (thisCollision.rayDistance < collision.rayDistance) {
+				thisCollision.node = i;
+				collision = thisCollision;
 			}
 		}
 	}
 	if (collision.node) {
 		closestCollision = collision;
-		closestCollision.node = collision.node;
-		return CollisionAllowed(CollisionLayer::RAY, closestObjLayer);
+		return true;
 	}
 	return false;
 }
 
-void GameWorld::BuildStaticTree() {
-	if (staticTree) {
-		delete staticTree;
+/*
+If a cache file is given, the tree is loaded from it when it still matches
+the level, and written out again whenever it has to be rebuilt. World IDs
+keep counting up between rounds, so saved entries refer to objects by
+their position in the list of static objects instead, which is the same
+every time the same level file is loaded.
+*/
+void GameWorld::BuildStaticTree(const std::string& cacheFile) {
+	//The old tree's memory gets reused, rather than freeing every node
+	if (!staticTree) {
+		staticTree = new Octree<GameObject*>(staticTreeSettings); //fits itself around the level
+	}
+	staticTree->SetLimits(staticTreeSettings.maxDepth, staticTreeSettings.maxSize);
+	ClearLateObjects();
+	staticVersion++;
+
+	std::vector<GameObject*> statics;
+	for (GameObject* g : gameObjects) {
+		g->SetInStaticTree(false);
+		g->UpdateBroadphaseAABB();
+		Vector3 halfSizes;
+		if (g->GetBroadphaseAABB(halfSizes) && g->IsStatic()) {
+			statics.emplace_back(g);
+		}
+	}
+
+	if (!cacheFile.empty() && LoadStaticTree(cacheFile, statics)) {
+		MarkStaticTreeContents();
+		return;
 	}
 
-	staticTree = new Octree<GameObject*>(Vector3(1024, 1024, 1024), 7, 6);
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	GetObjectIterators(first, last);
-	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateBroadphaseAABB();
+	staticTree->Clear();
+	for (GameObject* g : statics) {
 		Vector3 halfSizes;
-		if (!(*i)->GetBroadphaseAABB(halfSizes) || !(*i)->IsStatic()) {
+		g->GetBroadphaseAABB(halfSizes);
+		staticTree->Insert(g, g->GetTransform().GetPosition(), halfSizes);
+	}
+	staticTree->Build(); //so that nothing builds it lazily from inside a RaycastBatch
+	MarkStaticTreeContents();
+
+	if (!cacheFile.empty()) {
+		std::ofstream file(cacheFile, std::ios::binary);
+		if (file) {
+			std::unordered_map<GameObject*, int> staticIndices;
+			for (int i = 0; i < (int)statics.size(); ++i) {
+				staticIndices[statics[i]] = i;
+			}
+			staticTree->Save(file, [&](GameObject* g) { return staticIndices[g]; });
+		}
+	}
+}
+
+bool GameWorld::LoadStaticTreeSettings(const std::string& filename) {
+	staticTreeSettings = OctreeSettings();
+	std::string text;
+	if (!AssetFile::Exists(filename) || !Assets::ReadTextFile(filename, text)) {
+		return false;
+	}
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line)) {
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string key;
+		int value;
+		if (!(words >> key >> value)) {
 			continue;
 		}
-		Vector3 pos = (*i)->GetTransform().GetPosition();
-		staticTree->Insert(*i, pos, halfSizes);
+		if (key == "maxDepth") {
+			staticTreeSettings.maxDepth = value < 0 ? 0 : value;
+		}
+		else if (key == "maxSize") {
+			staticTreeSettings.maxSize = value < 1 ? 1 : value;
+		}
+	}
+	return true;
+}
+
+bool GameWorld::SaveStaticTreeSettings(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+	file << "#Static octree settings, read when the level's loaded\n";
+	file << "maxDepth " << staticTreeSettings.maxDepth << "\n";
+	file << "maxSize " << staticTreeSettings.maxSize << "\n";
+	return true;
+}
+
+void GameWorld::MarkStaticTreeContents() {
+	staticTree->OperateOnContents([](const OctreeEntry<GameObject*>& e) {
+		e.object->SetInStaticTree(true);
+	});
+}
+
+//Any object that has moved, resized, or gone since the file was written means it's stale
+bool GameWorld::LoadStaticTree(const std::string& cacheFile, const std::vector<GameObject*>& statics) {
+	char*	data = nullptr;
+	size_t	dataSize = 0;
+	if (!Assets::ReadBinaryFile(cacheFile, &data, dataSize) || !data) {
+		return false;
+	}
+	bool loaded = staticTree->Load(data, dataSize,
+		[&](int id, const Vector3& pos, const Vector3& size, GameObject*& object) {
+			if (id < 0 || id >= (int)statics.size()) {
+				return false;
+			}
+			Vector3 halfSizes;
+			statics[id]->GetBroadphaseAABB(halfSizes);
+			object = statics[id];
+			return object->GetTransform().GetPosition() == pos && halfSizes == size;
+		}
+	);
+	delete[] data;
+
+	if (loaded && staticTree->GetEntryCount() != (int)statics.size()) {
+		staticTree->Clear(); //there are static objects the file doesn't know about
+		loaded = false;
 	}
+	return loaded;
 }
@@ -1,11 +1,15 @@
 #pragma once
 #include <vector>
+#include <string>
 #include "Ray.h"
 #include "CollisionDetection.h"
 #include "Octree.h"
+#include "DynamicAABBTree.h"
 #include "CollisionLayer.h"
+#include "SpatialGrid.h"
 #include <algorithm>
-#include <set>
+#include <map>
+#include <mutex>
 
 namespace NCL {
 	class Camera;
@@ -26,24 +30,86 @@ namespace NCL {
 			void ClearAndErase();
 
 			void AddGameObject(GameObject* o);
-			void RemoveGameObject(GameObject* o, bool andDelete = false);			
+			//Takes the last object's place, so it doesn't matter how many objects
+			//there are, but the order of the list changes - objects that want to
+			//go while the world's being updated should Remove() themselves instead
+			void RemoveGameObject(GameObject* o, bool andDelete = false);
+
+			//Lets other systems (such as the physics broadphase) keep their
+			//own structures in step with the world's object list
+			void AddObjectListener(void* owner, GameObjectFunc onAdd, GameObjectFunc onRemove);
+			void RemoveObjectListener(void* owner);
+
+			//Safe to call from inside an Update, even a parallel one - the
+			//change happens once every object has been updated
+			void SetTickInterval(GameObject* o, int frames);
+
+			//How long the world's been updated for, which timed colour fades start from
+			double GetWorldTime() const {
+				return worldTime;
+			}
 
 			void AddConstraint(Constraint* c);
 			void RemoveConstraint(Constraint* c, bool andDelete = false);
 
-			void BuildStaticTree();
+			//Changes whenever a constraint is added or removed, so that anything
+			//caching the constraint list knows to rebuild it
+			int GetConstraintVersion() const {
+				return constraintVersion;
+			}
+
+			//Passing a cache file lets the tree be loaded rather than rebuilt
+			//when the level hasn't changed since it was last saved
+			void BuildStaticTree(const std::string& cacheFile = "");
+
+			//Used from the next BuildStaticTree on. A cache saved with different
+			//settings doesn't match, so it's rebuilt with these instead
+			void SetStaticTreeSettings(const OctreeSettings& settings) {
+				staticTreeSettings = settings;
+			}
+			const OctreeSettings& GetStaticTreeSettings() const {
+				return staticTreeSettings;
+			}
+			//Lines of "maxDepth 7" or "maxSize 6", and # for comments. Anything
+			//the file doesn't give stays at its default, as does everything if
+			//there's no file, in which case it returns false
+			bool LoadStaticTreeSettings(const std::string& filename);
+			bool SaveStaticTreeSettings(const std::string& filename) const;
 
 			Octree<GameObject*>* GetStaticTree() const {
 				return staticTree;
 			}
 
+			//Changes whenever the static tree is rebuilt or has something taken out
+			//of it, so anything drawn from it once and kept knows to redo it
+			int GetStaticVersion() const {
+				return staticVersion;
+			}
+
+			//The physics broadphase shares its tree of moving objects, so that
+			//raycasts don't have to test every object in the world
+			void SetDynamicTree(const DynamicAABBTree<GameObject*>* tree) {
+				dynamicTree = tree;
+			}
+
+			//Nearby objects of whichever types it's been told to track
+			SpatialGrid& GetSpatialGrid() {
+				return spatialGrid;
+			}
+			const SpatialGrid& GetSpatialGrid() const {
+				return spatialGrid;
+			}
+
 			bool CollisionAllowed(CollisionLayer layerA, CollisionLayer layerB) const {
-				return std::find(ignoreCollisionMatrix.begin(), ignoreCollisionMatrix.end(), std::make_pair(layerA, layerB)) == ignoreCollisionMatrix.end();
+				return layerMatrix.Collides(layerA, layerB);
 			}
 
 			void AddCollisionIgnore(CollisionLayer a, CollisionLayer b) {
-				ignoreCollisionMatrix.insert(std::make_pair(a, b));
-				ignoreCollisionMatrix.insert(std::make_pair(b, a));
+				layerMatrix.SetCollides(a, b, false);
+			}
+
+			const CollisionLayerMatrix& GetLayerMatrix() const {
+				return layerMatrix;
 			}
 
 			Camera* GetMainCamera() const {
@@ -58,13 +124,46 @@ namespace NCL {
 				shuffleObjects = state;
 			}
 
-			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false) const;
+			//Objects on layers that rayLayer doesn't collide with are skipped. Once
+			//both the static and dynamic trees are available, only objects along
+			//the ray are tested
+			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false, CollisionLayer rayLayer = CollisionLayer::RAY) const;
+
+			//Casts a whole set of rays at once, spread across the job system if
+			//there are enough of them. results[i] gets the hit for rays[i], with
+			//a null node if it missed
+			void RaycastBatch(const std::vector<Ray>& rays, std::vector<RayCollision>& results, bool closestObject = true, CollisionLayer rayLayer = CollisionLayer::RAY) const;
+
+			//Only checks against static geometry, and stops at the first thing
+			//in the way, so it's cheap enough to ask about lots of objects
+			bool LineOfSight(const Vector3& from, const Vector3& to, CollisionLayer rayLayer = CollisionLayer::RAY) const;
+			//LineOfSight for a whole set of lines at once, spread across the job
+			//system the same way as RaycastBatch. visible[i] is for from[i] to to[i]
+			void LineOfSightBatch(const std::vector<Vector3>& from, const std::vector<Vector3>& to, std::vector<char>& visible, CollisionLayer rayLayer = CollisionLayer::RAY) const;
+
+			/*
+			Every object whose volume overlaps the shape, and is on a layer that
+			queryLayer collides with. Candidates come from the static and dynamic
+			trees, the same as Raycast, then each is tested against its actual
+			volume. results is cleared first, so the same buffer can be handed
+			in every time without allocating, once it's grown big enough
+			*/
+			bool OverlapSphere(const Vector3& centre, float radius, std::vector<GameObject*>& results, CollisionLayer queryLayer = CollisionLayer::RAY) const;
+			bool OverlapBox(const Vector3& centre, const Vector3& halfSize, const Quaternion& orientation, std::vector<GameObject*>& results, CollisionLayer queryLayer = CollisionLayer::RAY) const;
+			//The capsule's radius is around the segment from start to end
+			bool OverlapCapsule(const Vector3& start, const Vector3& end, float radius, std::vector<GameObject*>& results, CollisionLayer queryLayer = CollisionLayer::RAY) const;
 
 			virtual void UpdateWorld(float dt);
+			//Brings every object's matrix up to date, ready for rendering
+			void UpdateTransforms();
 			void Prune();
 
 			void OperateOnContents(GameObjectFunc f);
 
+			//Brings a sleeping object straight back into the awake list, rather
+			//than waiting for the next Prune
+			void WakeObject(GameObject* o);
+
 
 			void GetObjectIterators(
 				GameObjectIterator& first,
@@ -82,23 +181,70 @@ namespace NCL {
 				std::vector<Constraint*>::const_iterator& first,
 				std::vector<Constraint*>::const_iterator& last) const;
 
-			std::vector<GameObject*> GetGameObjects() { return gameObjects; }
+			//Adding objects can move the list, so don't hold on to iterators while doing so
+			const std::vector<GameObject*>& GetGameObjects() const { return gameObjects; }
 
 		protected:
+			bool LoadStaticTree(const std::string& cacheFile, const std::vector<GameObject*>& statics);
+			void MarkStaticTreeContents();
+			bool LinearRaycast(Ray& r, RayCollision& closestCollision, bool closestObject, uint32_t layerMask) const;
+			bool Overlap(const GJKShape& shape, std::vector<GameObject*>& results, uint32_t layerMask) const;
+			void RemoveDeletedObjects();
+			void ClearLateObjects();
+
+			void AddToTickList(GameObject* o);
+			void RemoveFromTickList(GameObject* o);
+			void ChangeTickInterval(GameObject* o, int frames);
+
+			struct ObjectListener {
+				void*			owner;
+				GameObjectFunc	onAdd;
+				GameObjectFunc	onRemove;
+			};
+
 			std::vector<GameObject*> gameObjects;
 			std::vector<GameObject*> deletionObjects;
 			std::vector<GameObject*> awakeObjects;
 			std::vector<Constraint*> constraints;
+			std::vector<ObjectListener> objectListeners;
 
 			Camera* mainCamera;
 
-			std::set<std::pair<CollisionLayer, CollisionLayer>> ignoreCollisionMatrix;
+			CollisionLayerMatrix layerMatrix;
 
 			bool	shuffleConstraints;
 			bool	shuffleObjects;
 			int		worldIDCounter;
+			int		constraintVersion;
+			int		staticVersion;
+
+			int		raycastBatchMinRays;
+			int		raycastBatchSize;
+
+			int		parallelUpdateMinObjects;
+			int		parallelUpdateBatchSize;
+			std::vector<GameObject*> parallelObjects;
+			std::vector<float>		 parallelDeltas;
+
+			int		transformBatchMinObjects;
+			int		transformBatchSize;
+
+			//Only objects with something to do are in here, by how often they want updating
+			std::map<int, std::vector<GameObject*>>	tickLists;
+			std::vector<std::pair<GameObject*, int>> pendingTickChanges;
+			std::mutex	tickMutex;
+			bool		updatingObjects;
+			int			tickFrame;
+			double		worldTime;
 
 			Octree<GameObject*>* staticTree;
+			OctreeSettings		staticTreeSettings;
+			const DynamicAABBTree<GameObject*>* dynamicTree;
+			SpatialGrid	spatialGrid;
+
+			//Anything added since the static tree was built, which
+			//might have been made static afterwards
+			std::vector<GameObject*> lateObjects;
 		};
 	}
 }
@@ -0,0 +1,155 @@
+#include "JobSystem.h"
+#include <memory>
+
+using namespace NCL;
+using namespace CSC8503;
+
+JobSystem* JobSystem::instance = nullptr;
+thread_local int JobSystem::workerIndex = 0;
+
+JobSystem::JobSystem(unsigned int threads) {
+	activeJobs		= 0;
+	shuttingDown	= false;
+
+	if (threads == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	for (unsigned int i = 0; i < threads; ++i) {
+		workers.emplace_back(&JobSystem::WorkerLoop, this, (int)i + 1);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::unique_lock<std::mutex> lock(jobMutex);
+		shuttingDown = true;
+	}
+	jobAvailable.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+void JobSystem::Submit(const JobFunc& job) {
+	{
+		std::unique_lock<std::mutex> lock(jobMutex);
+		jobs.push_back({ job, MemoryTracker::GetThreadTag() });
+		activeJobs++;
+	}
+	jobAvailable.notify_one();
+}
+
+//The calling thread helps empty the queue rather than just sleeping
+void JobSystem::WaitForAll() {
+	while (RunPendingJob()) {}
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobsFinished.wait(lock, [&] { return activeJobs == 0; });
+}
+
+void JobSystem::RunJob(Job& job) {
+	MemoryTagScope tag(job.tag);
+	job.func();
+}
+
+bool JobSystem::RunPendingJob() {
+	Job job;
+	{
+		std::unique_lock<std::mutex> lock(jobMutex);
+		if (jobs.empty()) {
+			return false;
+		}
+		job = std::move(jobs.front());
+		jobs.pop_front();
+	}
+	RunJob(job);
+	{
+		std::unique_lock<std::mutex> lock(jobMutex);
+		activeJobs--;
+		if (activeJobs == 0) {
+			jobsFinished.notify_all();
+		}
+	}
+	return true;
+}
+
+void JobSystem::WorkerLoop(int index) {
+	workerIndex = index;
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [&] { return shuttingDown || !jobs.empty(); });
+			if (shuttingDown && jobs.empty()) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		RunJob(job);
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			activeJobs--;
+			if (activeJobs == 0) {
+				jobsFinished.notify_all();
+			}
+		}
+	}
+}
+
+/*
+Batches are claimed from a shared atomic counter, so fast workers naturally
+take more of them. The caller also pulls batches, and only returns once
+every batch has been completed. The counters live in a shared block, as a
+helper job might not get to run until after the caller has returned.
+*/
+void JobSystem::ParallelFor(int count, int batchSize, const RangeFunc& func) {
+	if (count <= 0) {
+		return;
+	}
+	if (batchSize < 1) {
+		batchSize = 1;
+	}
+	int numBatches = (count + batchSize - 1) / batchSize;
+	if (numBatches == 1 || workers.empty()) {
+		func(0, count, workerIndex);
+		return;
+	}
+
+	struct RangeState {
+		std::atomic<int>	nextBatch;
+		std::atomic<int>	batchesLeft;
+		const RangeFunc*	func;
+		int					numBatches;
+		int					batchSize;
+		int					count;
+	};
+	std::shared_ptr<RangeState> state = std::make_shared<RangeState>();
+	state->nextBatch	= 0;
+	state->batchesLeft	= numBatches;
+	state->func			= &func;
+	state->numBatches	= numBatches;
+	state->batchSize	= batchSize;
+	state->count		= count;
+
+	auto runBatches = [state]() {
+		int batch;
+		while ((batch = state->nextBatch.fetch_add(1)) < state->numBatches) {
+			int first	= batch * state->batchSize;
+			int last	= first + state->batchSize < state->count ? first + state->batchSize : state->count;
+			(*state->func)(first, last, workerIndex);
+			state->batchesLeft.fetch_sub(1);
+		}
+	};
+
+	int helpers = (int)workers.size() < numBatches - 1 ? (int)workers.size() : numBatches - 1;
+	for (int i = 0; i < helpers; ++i) {
+		Submit(runBatches);
+	}
+	runBatches();
+
+	while (state->batchesLeft.load() > 0) {
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "../../Common/MemoryTracker.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A simple pool of worker threads. Work is either handed over as
+		individual jobs, or as a ParallelFor over a range of indices, which
+		is split into batches that the workers (and the calling thread) pull
+		from until the range is exhausted.
+
+		Every thread that runs work has a stable worker index, from 0 for
+		the main thread up to GetWorkerCount() - 1, so callers can give each
+		worker its own output buffer and avoid any locking.
+
+		Jobs run with the MemoryTag of the thread that submitted them, so
+		whatever they allocate is counted where it would have been if the
+		work hadn't been handed off.
+		*/
+		class JobSystem {
+		public:
+			typedef std::function<void()> JobFunc;
+			typedef std::function<void(int first, int last, int workerIndex)> RangeFunc;
+
+			//0 threads will use one fewer than the hardware supports, leaving
+			//a core for the main thread
+			static void Initialise(unsigned int threads = 0) {
+				if (!instance) {
+					instance = new JobSystem(threads);
+				}
+			}
+
+			static void Destroy() {
+				delete instance;
+				instance = nullptr;
+			}
+
+			static JobSystem* GetJobSystem() {
+				return instance;
+			}
+
+			static int GetWorkerIndex() {
+				return workerIndex;
+			}
+
+			int GetWorkerCount() const {
+				return (int)workers.size() + 1;
+			}
+
+			void Submit(const JobFunc& job);
+			void WaitForAll();
+
+			void ParallelFor(int count, int batchSize, const RangeFunc& func);
+
+		protected:
+			JobSystem(unsigned int threads);
+			~JobSystem();
+
+			struct Job {
+				JobFunc		func;
+				MemoryTag	tag = MemoryTag::General;
+			};
+
+			void WorkerLoop(int index);
+			bool RunPendingJob();
+			static void RunJob(Job& job);
+
+			std::vector<std::thread>	workers;
+			std::deque<Job>				jobs;
+
+			std::mutex					jobMutex;
+			std::condition_variable		jobAvailable;
+			std::condition_variable		jobsFinished;
+
+			int							activeJobs;
+			bool						shuttingDown;
+
+			static JobSystem*			instance;
+			static thread_local int		workerIndex;
+		};
+	}
+}
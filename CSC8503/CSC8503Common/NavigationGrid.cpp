@@ -1,9 +1,14 @@
 #include "NavigationGrid.h"
+#include "PathQueryService.h"
+#include "FlowField.h"
 #include "../../Common/Assets.h"
+#include "../../Common/AssetFile.h"
 
 #include <fstream>
+#include <iostream>
 #include <time.h>  
-#include <queue>
+#include <algorithm>
+#include <cstdlib>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -21,10 +26,14 @@ NavigationGrid::NavigationGrid()	{
 	gridWidth	= 0;
 	gridHeight	= 0;
 	allNodes	= nullptr;
+	clustersX	= 0;
+	clustersY	= 0;
+	useClusters	= true;
+	queries		= new PathQueryService(*this);
 }
 
 NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
-	std::ifstream infile(Assets::DATADIR + filename);
+	AssetStream infile(Assets::DATADIR + filename);
 
 	infile >> nodeSize;
 	infile >> gridWidth;
@@ -73,14 +82,26 @@ NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
 			}
 		}	
 	}
+	BuildClusters();
 }
 
 NavigationGrid::~NavigationGrid()	{
+	delete queries; //waits for any searches still using the nodes
+	for (auto& f : flowFields) {
+		delete f.second;
+	}
 	delete[] allNodes;
 }
 
 bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	thread_local NavigationGridSearch search;
+	return FindPath(from, to, outPath, search);
+}
 
+bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, NavigationGridSearch& search) const {
+	if (!allNodes) {
+		return false;
+	}
 	//need to work out which node 'from' sits in, and 'to' sits in
 	int fromX = ((int)from.x / nodeSize);
 	int fromZ = ((int)from.z / nodeSize);
@@ -98,69 +119,374 @@ bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, Navigation
 		return false; //outside of map region!
 	}
 
-	for (int i = 0; i < gridWidth * gridHeight; ++i) {
-		GridNode* node = &allNodes[i];
-		node->open = false;
-		node->closed = false;
+	int startNode	= (fromZ * gridWidth) + fromX;
+	int endNode		= (toZ * gridWidth) + toX;
+
+	if (useClusters && !clusterNodes.empty()) {
+		return FindClusterPath(startNode, endNode, search, outPath);
 	}
+	std::vector<int> cells;
+	if (!SearchCells(startNode, endNode, search, nullptr, &cells, nullptr)) {
+		return false;
+	}
+	for (auto i = cells.rbegin(); i != cells.rend(); ++i) {
+		outPath.PushWaypoint(allNodes[*i].position);
+	}
+	return true;
+}
 
-	GridNode* startNode = &allNodes[(fromZ * gridWidth) + fromX];
-	GridNode* endNode	= &allNodes[(toZ * gridWidth) + toX];
+bool NavigationGrid::SearchCells(int startNode, int endNode, NavigationGridSearch& search, const CellBounds* bounds,
+	std::vector<int>* outCells, int* outCost) const {
+	search.Begin(gridWidth * gridHeight);
+	search.Open(startNode, 0, Heuristic(startNode, endNode), -1);
 
-	// Priority queue + open/closed bools in GridNode struct for more efficient pathfinding
-	std::priority_queue<GridNode*, std::vector<GridNode*>, CompareMapNode> openList;
+	while (!search.Empty()) {
+		int current = search.PopBest();
 
-	openList.push(startNode);
+		if (current == endNode) {			//we've found the path!
+			if (outCost) {
+				*outCost = search.GetG(endNode);
+			}
+			if (outCells) {
+				outCells->clear();
+				for (int node = endNode; node >= 0; node = search.GetParent(node)) {
+					outCells->emplace_back(node);
+				}
+				std::reverse(outCells->begin(), outCells->end());
+			}
+			return true;
+		}
+		const GridNode& n = allNodes[current];
+		for (int i = 0; i < 4; ++i) {
+			if (!n.connected[i]) { //might not be connected...
+				continue;
+			}
+			int neighbour = (int)(n.connected[i] - allNodes);
+			if (search.IsClosed(neighbour)) {
+				continue;
+			}
+			if (bounds) {
+				int x = neighbour % gridWidth;
+				int y = neighbour / gridWidth;
+				if (x < bounds->minX || x > bounds->maxX || y < bounds->minY || y > bounds->maxY) {
+					continue;
+				}
+			}
+			int g = search.GetG(current) + n.costs[i];
+			if (search.IsOpen(neighbour) && g >= search.GetG(neighbour)) {
+				continue;
+			}
+			search.Open(neighbour, g, g + Heuristic(neighbour, endNode), current);
+		}
+	}
+	return false; //open list emptied out with no path!
+}
 
-	startNode->g = 0;
-	startNode->f = 0;
-	startNode->parent = nullptr;
-	startNode->open = true;
+/*
+The grid's cut into ClusterSize square clusters. Wherever two clusters
+touch, each unbroken run of open cells along the edge between them is an
+entrance - crossed in the middle if it's short, or at both ends if it's
+long, so paths don't have to detour to the middle of a wide opening.
+Routes between the nodes inside each cluster are found once, here, and
+kept, so a query never has to search the middle of a path again.
+*/
+void NavigationGrid::BuildClusters() {
+	clusterNodes.clear();
+	nodesInCluster.clear();
+	clusterPaths.clear();
+	clustersX = (gridWidth + ClusterSize - 1) / ClusterSize;
+	clustersY = (gridHeight + ClusterSize - 1) / ClusterSize;
+	if (clustersX * clustersY < HierarchyMinClusters) {
+		return;
+	}
+	cellClusterNode.assign(gridWidth * gridHeight, -1);
+	nodesInCluster.resize(clustersX * clustersY);
+
+	for (int cy = 0; cy < clustersY; ++cy) {
+		for (int cx = 0; cx < clustersX; ++cx) {
+			int cluster = cy * clustersX + cx;
+			if (cx < clustersX - 1) {
+				AddEntrances(cluster, cluster + 1, true);
+			}
+			if (cy < clustersY - 1) {
+				AddEntrances(cluster, cluster + clustersX, false);
+			}
+		}
+	}
 
-	GridNode* currentBestNode = nullptr;
+	NavigationGridSearch search;
+	std::vector<int> cells;
+	for (int c = 0; c < (int)nodesInCluster.size(); ++c) {
+		CellBounds bounds = GetClusterBounds(c);
+		const std::vector<int>& nodes = nodesInCluster[c];
+		for (size_t a = 0; a < nodes.size(); ++a) {
+			for (size_t b = a + 1; b < nodes.size(); ++b) {
+				int cost = 0;
+				if (!SearchCells(clusterNodes[nodes[a]].cell, clusterNodes[nodes[b]].cell, search, &bounds, &cells, &cost)) {
+					continue;
+				}
+				int path = (int)clusterPaths.size();
+				clusterPaths.emplace_back(cells);
+				clusterNodes[nodes[a]].edges.push_back({ nodes[b], cost, path, false });
+				clusterNodes[nodes[b]].edges.push_back({ nodes[a], cost, path, true });
+			}
+		}
+	}
+}
+
+void NavigationGrid::AddEntrances(int clusterA, int clusterB, bool horizontal) {
+	CellBounds a = GetClusterBounds(clusterA);
+	CellBounds b = GetClusterBounds(clusterB);
+	//B has to be straight after A, and lined up with it, for the cells either side of the border to pair up
+	bool neighbours = horizontal
+		? b.minX == a.maxX + 1 && b.minY == a.minY && b.maxY == a.maxY
+		: b.minY == a.maxY + 1 && b.minX == a.minX && b.maxX == a.maxX;
+	if (!neighbours) {
+		std::cout << __FUNCTION__ << " clusters " << clusterA << " and " << clusterB << " aren't next to each other" << std::endl;
+		return;
+	}
+	int length	= horizontal ? a.maxY - a.minY + 1 : a.maxX - a.minX + 1;
+	//connected is up, down, left, right - so this is right or down, and back again
+	int forward	= horizontal ? 3 : 1;
+	int back	= horizontal ? 2 : 0;
+
+	auto cellsAt = [&](int i, int& from, int& to) {
+		if (horizontal) {
+			from	= (a.minY + i) * gridWidth + a.maxX;
+			to		= from + 1;
+		}
+		else {
+			from	= a.maxY * gridWidth + a.minX + i;
+			to		= from + gridWidth;
+		}
+	};
+	auto open = [&](int i) {
+		int from, to;
+		cellsAt(i, from, to);
+		return allNodes[from].connected[forward] && allNodes[to].connected[back];
+	};
+	auto join = [&](int i) {
+		int from, to;
+		cellsAt(i, from, to);
+		int nodeA = AddClusterNode(from);
+		int nodeB = AddClusterNode(to);
+		clusterNodes[nodeA].edges.push_back({ nodeB, allNodes[from].costs[forward], -1, false });
+		clusterNodes[nodeB].edges.push_back({ nodeA, allNodes[to].costs[back], -1, false });
+	};
+
+	int runStart = -1;
+	for (int i = 0; i <= length; ++i) {
+		bool isOpen = i < length && open(i);
+		if (isOpen && runStart < 0) {
+			runStart = i;
+		}
+		else if (!isOpen && runStart >= 0) {
+			int runEnd = i - 1;
+			if (runEnd - runStart + 1 >= 6) {
+				join(runStart);
+				join(runEnd);
+			}
+			else {
+				join((runStart + runEnd) / 2);
+			}
+			runStart = -1;
+		}
+	}
+}
+
+int NavigationGrid::AddClusterNode(int cell) {
+	if (cellClusterNode[cell] >= 0) {
+		return cellClusterNode[cell];
+	}
+	ClusterNode n;
+	n.cell		= cell;
+	n.cluster	= GetCluster(cell);
+	int index	= (int)clusterNodes.size();
+	clusterNodes.emplace_back(n);
+	nodesInCluster[n.cluster].emplace_back(index);
+	cellClusterNode[cell] = index;
+	return index;
+}
+
+NavigationGrid::CellBounds NavigationGrid::GetClusterBounds(int cluster) const {
+	CellBounds b;
+	b.minX = (cluster % clustersX) * ClusterSize;
+	b.minY = (cluster / clustersX) * ClusterSize;
+	b.maxX = b.minX + ClusterSize - 1 < gridWidth - 1 ? b.minX + ClusterSize - 1 : gridWidth - 1;
+	b.maxY = b.minY + ClusterSize - 1 < gridHeight - 1 ? b.minY + ClusterSize - 1 : gridHeight - 1;
+	return b;
+}
 
-	while (!openList.empty()) {
-		currentBestNode = openList.top();
-		openList.pop();
+int NavigationGrid::GetCluster(int cell) const {
+	return ((cell / gridWidth) / ClusterSize) * clustersX + ((cell % gridWidth) / ClusterSize);
+}
 
-		if (currentBestNode == endNode) {			//we've found the path!
-			GridNode* node = endNode;
-			while (node != nullptr) {
-				outPath.PushWaypoint(node->position);
-				node = node->parent;
+/*
+Only the start and end clusters are searched cell by cell, to get from the
+start to each of its cluster's nodes, and from each of the end cluster's
+nodes to the end. The rest is an A* over the cluster graph, which is then
+turned back into cells from the cached routes. The path's close to, but
+not always quite, the shortest one.
+*/
+bool NavigationGrid::FindClusterPath(int startCell, int endCell, NavigationGridSearch& search, NavigationPath& outPath) const {
+	int startCluster	= GetCluster(startCell);
+	int endCluster		= GetCluster(endCell);
+
+	//Going to the same or a neighbouring cluster is just searched across
+	//both, as the route through their entrances could be a long way round
+	std::vector<int> cells;
+	int clusterDX = abs(startCluster % clustersX - endCluster % clustersX);
+	int clusterDY = abs(startCluster / clustersX - endCluster / clustersX);
+	if (clusterDX <= 1 && clusterDY <= 1) {
+		CellBounds a = GetClusterBounds(startCluster);
+		CellBounds b = GetClusterBounds(endCluster);
+		CellBounds bounds;
+		bounds.minX = a.minX < b.minX ? a.minX : b.minX;
+		bounds.minY = a.minY < b.minY ? a.minY : b.minY;
+		bounds.maxX = a.maxX > b.maxX ? a.maxX : b.maxX;
+		bounds.maxY = a.maxY > b.maxY ? a.maxY : b.maxY;
+		if (SearchCells(startCell, endCell, search, &bounds, &cells, nullptr)) {
+			for (auto i = cells.rbegin(); i != cells.rend(); ++i) {
+				outPath.PushWaypoint(allNodes[*i].position);
 			}
 			return true;
 		}
-		else {
-			for (int i = 0; i < 4; ++i) {
-				GridNode* neighbour = currentBestNode->connected[i];
-
-				if (!neighbour || neighbour->closed) { //might not be connected...
-					continue;
-				}	
+	}
+	struct EndEdge {
+		int					node;
+		int					cost;
+		std::vector<int>	cells;
+	};
+	std::vector<EndEdge> fromStart;
+	std::vector<EndEdge> toEnd;
+	CellBounds startBounds	= GetClusterBounds(startCluster);
+	CellBounds endBounds	= GetClusterBounds(endCluster);
+	for (int node : nodesInCluster[startCluster]) {
+		EndEdge e;
+		e.node = node;
+		if (SearchCells(startCell, clusterNodes[node].cell, search, &startBounds, &e.cells, &e.cost)) {
+			fromStart.emplace_back(e);
+		}
+	}
+	for (int node : nodesInCluster[endCluster]) {
+		EndEdge e;
+		e.node = node;
+		if (SearchCells(clusterNodes[node].cell, endCell, search, &endBounds, &e.cells, &e.cost)) {
+			toEnd.emplace_back(e);
+		}
+	}
+	if (fromStart.empty() || toEnd.empty()) {
+		return false;
+	}
 
-				float h = Heuristic(neighbour, endNode);			
-				float g = currentBestNode->g + currentBestNode->costs[i];
-				float f = h + g;
+	//The start and end go on the end of the cluster graph, just for this search
+	thread_local NavigationGridSearch graphSearch;
+	int startNode	= (int)clusterNodes.size();
+	int endNode		= startNode + 1;
+	auto cellOf = [&](int node) {
+		return node == startNode ? startCell : (node == endNode ? endCell : clusterNodes[node].cell);
+	};
+	auto endEdgeOf = [&](int node) -> const EndEdge* {
+		for (const EndEdge& e : toEnd) {
+			if (e.node == node) {
+				return &e;
+			}
+		}
+		return nullptr;
+	};
+
+	unsigned int graphExpanded = graphSearch.GetExpanded();
+	graphSearch.Begin(endNode + 1);
+	graphSearch.Open(startNode, 0, Heuristic(startCell, endCell), -1);
+	bool found = false;
+	while (!graphSearch.Empty()) {
+		int current = graphSearch.PopBest();
+		if (current == endNode) {
+			found = true;
+			break;
+		}
+		auto consider = [&](int next, int cost) {
+			if (graphSearch.IsClosed(next)) {
+				return;
+			}
+			int g = graphSearch.GetG(current) + cost;
+			if (graphSearch.IsOpen(next) && g >= graphSearch.GetG(next)) {
+				return;
+			}
+			graphSearch.Open(next, g, g + Heuristic(cellOf(next), endCell), current);
+		};
+		if (current == startNode) {
+			for (const EndEdge& e : fromStart) {
+				consider(e.node, e.cost);
+			}
+			continue;
+		}
+		for (const ClusterEdge& e : clusterNodes[current].edges) {
+			consider(e.to, e.cost);
+		}
+		if (clusterNodes[current].cluster == endCluster) {
+			if (const EndEdge* e = endEdgeOf(current)) {
+				consider(endNode, e->cost);
+			}
+		}
+	}
+	search.AddExpanded(graphSearch.GetExpanded() - graphExpanded); //so the caller sees the whole cost
+	if (!found) {
+		return false;
+	}
 
-				if (neighbour->open && f > neighbour->f) {
+	std::vector<int> route;
+	for (int node = endNode; node >= 0; node = graphSearch.GetParent(node)) {
+		route.emplace_back(node);
+	}
+	std::reverse(route.begin(), route.end());
+
+	cells.clear();
+	cells.emplace_back(startCell);
+	auto append = [&](const std::vector<int>& section, bool reversed) {
+		//Every section starts where the last one finished
+		if (reversed) {
+			for (int i = (int)section.size() - 2; i >= 0; --i) {
+				cells.emplace_back(section[i]);
+			}
+		}
+		else {
+			cells.insert(cells.end(), section.begin() + 1, section.end());
+		}
+	};
+	for (size_t i = 1; i < route.size(); ++i) {
+		int from	= route[i - 1];
+		int to		= route[i];
+		if (from == startNode) {
+			for (const EndEdge& e : fromStart) {
+				if (e.node == to) {
+					append(e.cells, false);
+					break;
+				}
+			}
+		}
+		else if (to == endNode) {
+			append(endEdgeOf(from)->cells, false);
+		}
+		else {
+			for (const ClusterEdge& e : clusterNodes[from].edges) {
+				if (e.to != to) {
 					continue;
 				}
-
-				neighbour->g = g;
-				neighbour->f = f;
-				neighbour->parent = currentBestNode;
-
-				if (!neighbour->open) { //might be a better route to this neighbour
-					openList.push(neighbour);
-					neighbour->open = true;
+				if (e.path < 0) {
+					cells.emplace_back(clusterNodes[to].cell);
 				}
+				else {
+					append(clusterPaths[e.path], e.reversed);
+				}
+				break;
 			}
-			currentBestNode->open = false;
-			currentBestNode->closed = true;
 		}
 	}
-	return false; //open list emptied out with no path!
+	for (auto i = cells.rbegin(); i != cells.rend(); ++i) {
+		outPath.PushWaypoint(allNodes[*i].position);
+	}
+	return true;
 }
 
 Vector3 NCL::CSC8503::NavigationGrid::GetRandomValidPosition() const
@@ -169,27 +495,146 @@ Vector3 NCL::CSC8503::NavigationGrid::GetRandomValidPosition() const
 	return validPositions[rand() % validPositions.size()];
 }
 
-bool NavigationGrid::NodeInList(GridNode* n, std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator i = std::find(list.begin(), list.end(), n);
-	return i == list.end() ? false : true;
+int NavigationGrid::GetCell(const Vector3& pos) const {
+	if (!allNodes || pos.x < 0 || pos.z < 0) {
+		return -1;
+	}
+	int x = (int)pos.x / nodeSize;
+	int z = (int)pos.z / nodeSize;
+	if (x > gridWidth - 1 || z > gridHeight - 1) {
+		return -1;
+	}
+	return (z * gridWidth) + x;
+}
+
+//Node positions are their corners, so this is half a node further on
+Vector3 NavigationGrid::GetCellCentre(int cell) const {
+	return allNodes[cell].position + Vector3(nodeSize * 0.5f, 0, nodeSize * 0.5f);
 }
 
-GridNode*  NavigationGrid::RemoveBestNode(std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator bestI = list.begin();
+FlowField* NavigationGrid::GetFlowField(const Vector3& goal) {
+	int cell = GetCell(goal);
+	if (cell < 0) {
+		return nullptr;
+	}
+	auto i = flowFields.find(cell);
+	if (i != flowFields.end()) {
+		return i->second;
+	}
+	FlowField* f = new FlowField(*this, cell);
+	flowFields.insert({ cell, f });
+	return f;
+}
 
-	GridNode* bestNode = *list.begin();
+void NavigationGrid::InvalidatePaths() {
+	queries->ClearCache();
+	for (auto& f : flowFields) {
+		f.second->Refresh();
+	}
+}
 
-	for (auto i = list.begin(); i != list.end(); ++i) {
-		if ((*i)->f < bestNode->f) {
-			bestNode	= (*i);
-			bestI		= i;
+//The budget's shared, so only one field refreshes at once
+void NavigationGrid::UpdateFlowFields() {
+	for (auto& f : flowFields) {
+		if (f.second->IsRefreshing()) {
+			f.second->Update(FlowFieldCellsPerFrame);
+			return;
 		}
 	}
-	list.erase(bestI);
+}
+
+//Nodes only ever connect up, down, left and right, each a step of 1, so this never overestimates
+int NavigationGrid::Heuristic(int node, int endNode) const {
+	int dx = (node % gridWidth) - (endNode % gridWidth);
+	int dz = (node / gridWidth) - (endNode / gridWidth);
+	return (dx < 0 ? -dx : dx) + (dz < 0 ? -dz : dz);
+}
+
+void NavigationGridSearch::Begin(int nodeCount) {
+	if ((int)stamp.size() != nodeCount) {
+		stamp.assign(nodeCount, 0);
+		g.resize(nodeCount);
+		f.resize(nodeCount);
+		parent.resize(nodeCount);
+		heapIndex.resize(nodeCount);
+		generation = 0;
+	}
+	generation++;
+	if (generation == 0) { //wrapped all the way round, so old stamps could match again
+		std::fill(stamp.begin(), stamp.end(), 0);
+		generation = 1;
+	}
+	heap.clear();
+}
+
+void NavigationGridSearch::Open(int n, int newG, int newF, int newParent) {
+	bool wasOpen = IsOpen(n);
+	stamp[n]	= generation;
+	g[n]		= newG;
+	f[n]		= newF;
+	parent[n]	= newParent;
+	if (wasOpen) {
+		SiftUp(heapIndex[n]); //a lower f can only move it up
+	}
+	else {
+		heap.push_back(n);
+		heapIndex[n] = (int)heap.size() - 1;
+		SiftUp(heapIndex[n]);
+	}
+}
+
+int NavigationGridSearch::PopBest() {
+	int best = heap[0];
+	int last = heap.back();
+	heap.pop_back();
+	if (!heap.empty()) {
+		Place(0, last);
+		SiftDown(0);
+	}
+	heapIndex[best] = -1;
+	expanded++;
+	return best;
+}
 
-	return bestNode;
+//Ties go to whichever is further along, as it's likely to be nearer the end
+bool NavigationGridSearch::Better(int a, int b) const {
+	return f[a] < f[b] || (f[a] == f[b] && g[a] > g[b]);
 }
 
-float NavigationGrid::Heuristic(GridNode* hNode, GridNode* endNode) const {
-	return (hNode->position - endNode->position).Length();
-}
\ No newline at end of file
+void NavigationGridSearch::Place(int i, int n) {
+	heap[i]			= n;
+	heapIndex[n]	= i;
+}
+
+void NavigationGridSearch::SiftUp(int i) {
+	int n = heap[i];
+	while (i > 0) {
+		int up = (i - 1) / 2;
+		if (!Better(n, heap[up])) {
+			break;
+		}
+		Place(i, heap[up]);
+		i = up;
+	}
+	Place(i, n);
+}
+
+void NavigationGridSearch::SiftDown(int i) {
+	int n		= heap[i];
+	int count	= (int)heap.size();
+	while (true) {
+		int child = i * 2 + 1;
+		if (child >= count) {
+			break;
+		}
+		if (child + 1 < count && Better(heap[child + 1], heap[child])) {
+			child++;
+		}
+		if (!Better(heap[child], n)) {
+			break;
+		}
+		Place(i, heap[child]);
+		i = child;
+	}
+	Place(i, n);
+}
@@ -2,23 +2,16 @@
 #include "NavigationMap.h"
 #include <string>
 #include <random>
+#include <unordered_map>
 
 namespace NCL {
 	namespace CSC8503 {
 		struct GridNode {
-			GridNode* parent;
-
 			GridNode* connected[4];
 			int		  costs[4];
 
 			Vector3		position;
 
-			float f;
-			float g;
-
-			bool closed = false;
-			bool open	= false;
-
 			int type;
 
 			GridNode() {
@@ -26,27 +19,74 @@ namespace NCL {
 					connected[i] = nullptr;
 					costs[i] = 0;
 				}
-				f = 0;
-				g = 0;
 				type = 0;
-				parent = nullptr;
 			}
 			~GridNode() {	}
 		};
 
-		struct CompareMapNode {
-			bool operator()(GridNode* const& n1, GridNode* const& n2) {
-				return n1->f > n2->f;
+		/*
+		Everything one A* search needs per node, kept apart from the grid so
+		more than one search can run at once, each with its own. Rather than
+		being cleared before every search, each node's entry is stamped with
+		the search that last touched it, and anything with an older stamp
+		counts as never having been seen. The open list is a binary heap that
+		knows where every node is in it, so a node that's found a better route
+		is moved up rather than pushed in a second time.
+		*/
+		class NavigationGridSearch {
+		public:
+			NavigationGridSearch() {
+				generation	= 0;
+				expanded	= 0;
 			}
+
+			void Begin(int nodeCount);
+
+			bool Seen(int n) const		{ return stamp[n] == generation; }
+			bool IsOpen(int n) const	{ return Seen(n) && heapIndex[n] >= 0; }
+			bool IsClosed(int n) const	{ return Seen(n) && heapIndex[n] < 0; }
+
+			//Opens n if it hasn't been seen, or moves it up the heap if it's got better
+			void	Open(int n, int g, int f, int parent);
+			int		PopBest();	//and closes it
+			bool	Empty() const { return heap.empty(); }
+
+			int		GetG(int n) const		{ return g[n]; }
+			int		GetParent(int n) const	{ return parent[n]; }
+
+			//How many nodes have been popped, over every search it's been used for
+			unsigned int	GetExpanded() const				{ return expanded; }
+			void			AddExpanded(unsigned int count)	{ expanded += count; }
+
+		protected:
+			bool	Better(int a, int b) const;
+			void	SiftUp(int i);
+			void	SiftDown(int i);
+			void	Place(int i, int n);
+
+			std::vector<unsigned int>	stamp;
+			std::vector<int>			g;
+			std::vector<int>			f;
+			std::vector<int>			parent;
+			std::vector<int>			heapIndex; //-1 once it's closed
+			std::vector<int>			heap;
+			unsigned int				generation;
+			unsigned int				expanded;
 		};
 
+		class PathQueryService;
+		class FlowField;
+
 		class NavigationGrid : public NavigationMap	{
 		public:
 			NavigationGrid();
 			NavigationGrid(const std::string&filename);
 			~NavigationGrid();
 
+			//Uses a search of the calling thread's own. Big enough grids are
+			//searched a cluster at a time, with the path refined afterwards
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, NavigationGridSearch& search) const;
 
 			int GetGridWidth() const {
 				return gridWidth;
@@ -61,11 +101,84 @@ namespace NCL {
 			}
 
 			Vector3 GetRandomValidPosition() const;
+
+			//For asking for paths without waiting for them
+			PathQueryService& GetQueries() {
+				return *queries;
+			}
+
+			const GridNode* GetNodes() const {
+				return allNodes;
+			}
+			//-1 if pos is off the grid
+			int		GetCell(const Vector3& pos) const;
+			Vector3	GetCellCentre(int cell) const;
+
+			//One for each goal cell, made the first time it's asked for, null if
+			//goal's off the grid. They're kept as long as the grid is
+			FlowField*	GetFlowField(const Vector3& goal);
+			//For after the grid's changed - forgets every cached path, and starts
+			//every flow field being worked out again
+			void		InvalidatePaths();
+			//Carries on with any refreshes, FlowFieldCellsPerFrame cells at a time
+			void		UpdateFlowFields();
+
+			//For comparing against, searches cell by cell even where there are clusters
+			void		SetUseClusters(bool use) {
+				useClusters = use;
+			}
+			bool		HasClusters() const {
+				return !clusterNodes.empty();
+			}
+
+			static const int FlowFieldCellsPerFrame = 1024;
 				
+			//Grids any smaller than this many clusters are just searched cell by cell
+			static const int ClusterSize			= 8;
+			static const int HierarchyMinClusters	= 9;
+
 		protected:
-			bool		NodeInList(GridNode* n, std::vector<GridNode*>& list) const;
-			GridNode*	RemoveBestNode(std::vector<GridNode*>& list) const;
-			float		Heuristic(GridNode* hNode, GridNode* endNode) const;
+			struct CellBounds {
+				int minX, minY, maxX, maxY;
+			};
+			//A* over the cells, never leaving bounds if there are any, and
+			//writing the cells it went through from start to end into outCells
+			bool		SearchCells(int start, int end, NavigationGridSearch& search, const CellBounds* bounds,
+							std::vector<int>* outCells, int* outCost) const;
+			int			Heuristic(int node, int endNode) const;
+
+			/*
+			The cluster graph: a node either side of every gap between two
+			clusters, joined across the gap, and to every other node in its
+			own cluster it can reach, with the cells of that route cached.
+			*/
+			struct ClusterEdge {
+				int		to;
+				int		cost;
+				int		path;		//into clusterPaths, or -1 if it's a single step between clusters
+				bool	reversed;	//the cached path runs the other way
+			};
+			struct ClusterNode {
+				int		cell;
+				int		cluster;
+				std::vector<ClusterEdge> edges;
+			};
+
+			void		BuildClusters();
+			void		AddEntrances(int clusterA, int clusterB, bool horizontal);
+			int			AddClusterNode(int cell);
+			CellBounds	GetClusterBounds(int cluster) const;
+			int			GetCluster(int cell) const;
+			bool		FindClusterPath(int startCell, int endCell, NavigationGridSearch& search, NavigationPath& outPath) const;
+
+			std::vector<ClusterNode>		clusterNodes;
+			std::vector<std::vector<int>>	nodesInCluster;
+			std::vector<std::vector<int>>	clusterPaths;
+			std::vector<int>				cellClusterNode; //-1 for cells that aren't one
+			int clustersX;
+			int clustersY;
+			bool useClusters;
+
 			int nodeSize;
 			int gridWidth;
 			int gridHeight;
@@ -73,6 +186,8 @@ namespace NCL {
 			std::vector<Vector3> validPositions;
 
 			GridNode* allNodes;
+			PathQueryService* queries;
+			std::unordered_map<int, FlowField*> flowFields;
 		};
 	}
 }
@@ -1,16 +1,85 @@
 #include "NavigationMesh.h"
 #include "../../Common/Assets.h"
+#include "../../Common/AssetFile.h"
 #include <fstream>
+#include <cstring>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
 using namespace NCL;
 using namespace CSC8503;
 using namespace std;
 
+/*
+Baked meshes are laid out like binary levels - a header, then each array
+16 byte aligned after it, in the order they're listed here, so each is a
+single copy out of the mapped file: the vertices, the indices, each
+triangle's three neighbours (-1 for none), then the triangle grid's cell
+starts and the triangles in each cell.
+*/
+namespace {
+	const unsigned int BakedMeshMagic	= 0x4D56414E; //"NAVM"
+	const unsigned int BakedMeshVersion	= 2;
+
+	struct BakedMeshHeader {
+		unsigned int	magic;
+		unsigned int	version;
+		unsigned int	vertexCount;
+		unsigned int	indexCount;
+		float			gridMinX;
+		float			gridMinZ;
+		float			gridCellSize;
+		int				gridWidth;
+		int				gridDepth;
+		unsigned int	gridTriCount;
+	};
+
+	uint64_t AlignSection(uint64_t offset) {
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	//Where each of the arrays starts and how big it is, and where the last ends
+	void GetSections(const BakedMeshHeader& header, uint64_t* offsets, uint64_t* sizes) {
+		const uint64_t s[5] = {
+			(uint64_t)header.vertexCount * sizeof(Vector3),
+			(uint64_t)header.indexCount * sizeof(int),
+			(uint64_t)header.indexCount * sizeof(int),
+			((uint64_t)header.gridWidth * header.gridDepth + 1) * sizeof(int),
+			(uint64_t)header.gridTriCount * sizeof(int)
+		};
+		offsets[0] = AlignSection(sizeof(BakedMeshHeader));
+		for (int i = 0; i < 5; ++i) {
+			sizes[i]		= s[i];
+			offsets[i + 1]	= AlignSection(offsets[i] + sizes[i]);
+		}
+	}
+
+	//Twice the signed area of abc looking down on it, which says which side of ab c is on
+	float TriArea2(const Vector3& a, const Vector3& b, const Vector3& c) {
+		float abx = b.x - a.x;
+		float abz = b.z - a.z;
+		float acx = c.x - a.x;
+		float acz = c.z - a.z;
+		return acx * abz - abx * acz;
+	}
+
+	bool SamePoint(const Vector3& a, const Vector3& b) {
+		return (a - b).LengthSquared() < 0.0001f;
+	}
+}
+
 NavigationMesh::NavigationMesh()
 {
+	gridCellSize	= 1.0f;
+	gridWidth		= 0;
+	gridDepth		= 0;
 }
 
-NavigationMesh::NavigationMesh(const std::string&filename)
+NavigationMesh::NavigationMesh(const std::string&filename) : NavigationMesh()
 {
+	if (LoadBaked(Assets::DATADIR + filename)) {
+		return;
+	}
 	ifstream file(Assets::DATADIR + filename);
 
 	int numVertices = 0;
@@ -33,12 +102,405 @@ NavigationMesh::NavigationMesh(const std::string&filename)
 		file >> x;
 		allIndices.emplace_back(x);
 	}
+	BuildTris();
+	BuildAdjacency();
+	BuildTriGrid();
+}
+
+NavigationMesh::NavigationMesh(const std::vector<Vector3>& vertices, const std::vector<int>& indices) : NavigationMesh()
+{
+	allVerts	= vertices;
+	allIndices	= indices;
+	BuildTris();
+	BuildAdjacency();
+	BuildTriGrid();
 }
 
 NavigationMesh::~NavigationMesh()
 {
 }
 
+bool NavigationMesh::LoadBaked(const std::string& filepath) {
+	AssetFile file;
+	if (!file.Open(filepath) || file.GetSize() < sizeof(BakedMeshHeader)) {
+		return false;
+	}
+	BakedMeshHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (header.magic != BakedMeshMagic || header.version != BakedMeshVersion || header.indexCount % 3 != 0 ||
+		header.gridWidth < 0 || header.gridDepth < 0) {
+		return false;
+	}
+	uint64_t offsets[6];
+	uint64_t sizes[5];
+	GetSections(header, offsets, sizes);
+	if (offsets[4] + sizes[4] > file.GetSize()) {
+		return false;
+	}
+	const char* data = file.GetData();
+	allVerts.resize(header.vertexCount);
+	allIndices.resize(header.indexCount);
+	memcpy(allVerts.data(), data + offsets[0], allVerts.size() * sizeof(Vector3));
+	memcpy(allIndices.data(), data + offsets[1], allIndices.size() * sizeof(int));
+	for (int i : allIndices) {
+		if (i < 0 || i >= (int)allVerts.size()) {
+			allVerts.clear();
+			allIndices.clear();
+			return false;
+		}
+	}
+	BuildTris();
+	const int* neighbours = (const int*)(data + offsets[2]);
+	for (size_t i = 0; i < allIndices.size(); ++i) {
+		int n = neighbours[i];
+		allTris[i / 3].neighbours[i % 3] = (n >= 0 && n < (int)allTris.size()) ? &allTris[n] : nullptr;
+	}
+
+	gridMin			= Vector3(header.gridMinX, 0.0f, header.gridMinZ);
+	gridCellSize	= header.gridCellSize;
+	gridWidth		= header.gridWidth;
+	gridDepth		= header.gridDepth;
+	triGridStart.resize((size_t)gridWidth * gridDepth + 1);
+	triGridTris.resize(header.gridTriCount);
+	memcpy(triGridStart.data(), data + offsets[3], triGridStart.size() * sizeof(int));
+	memcpy(triGridTris.data(), data + offsets[4], triGridTris.size() * sizeof(int));
+	bool gridValid = triGridStart.back() == (int)triGridTris.size();
+	for (int t : triGridTris) {
+		gridValid &= t >= 0 && t < (int)allTris.size();
+	}
+	if (!gridValid) {
+		BuildTriGrid(); //can't trust it, but the triangles themselves are fine
+	}
+	return true;
+}
+
+bool NavigationMesh::SaveBaked(const std::string& filename) const {
+	ofstream file(Assets::DATADIR + filename, ios::binary);
+	if (!file) {
+		return false;
+	}
+	BakedMeshHeader header;
+	header.magic		= BakedMeshMagic;
+	header.version		= BakedMeshVersion;
+	header.vertexCount	= (unsigned int)allVerts.size();
+	header.indexCount	= (unsigned int)allIndices.size();
+	header.gridMinX		= gridMin.x;
+	header.gridMinZ		= gridMin.z;
+	header.gridCellSize	= gridCellSize;
+	header.gridWidth	= gridWidth;
+	header.gridDepth	= gridDepth;
+	header.gridTriCount	= (unsigned int)triGridTris.size();
+
+	vector<int> neighbours;
+	neighbours.reserve(allIndices.size());
+	for (const NavTri& t : allTris) {
+		for (int i = 0; i < 3; ++i) {
+			neighbours.emplace_back(t.neighbours[i] ? (int)(t.neighbours[i] - allTris.data()) : -1);
+		}
+	}
+	//An empty mesh still has the one cell start
+	vector<int> gridStart = triGridStart.empty() ? vector<int>(1, 0) : triGridStart;
+
+	uint64_t offsets[6];
+	uint64_t sizes[5];
+	GetSections(header, offsets, sizes);
+	const char*	sections[5]	= { (const char*)allVerts.data(), (const char*)allIndices.data(), (const char*)neighbours.data(),
+		(const char*)gridStart.data(), (const char*)triGridTris.data() };
+
+	static const char padding[16] = {};
+	file.write((const char*)&header, sizeof(header));
+	for (int i = 0; i < 5; ++i) {
+		const uint64_t written = i == 0 ? sizeof(header) : offsets[i - 1] + sizes[i - 1];
+		file.write(padding, (std::streamsize)(offsets[i] - written));
+		file.write(sections[i], (std::streamsize)sizes[i]);
+	}
+	return (bool)file;
+}
+
+void NavigationMesh::BuildTris() {
+	allTris.clear();
+	allTris.resize(allIndices.size() / 3);
+	for (size_t t = 0; t < allTris.size(); ++t) {
+		NavTri& tri = allTris[t];
+		for (int i = 0; i < 3; ++i) {
+			tri.indices[i] = allIndices[t * 3 + i];
+		}
+		tri.centroid = (allVerts[tri.indices[0]] + allVerts[tri.indices[1]] + allVerts[tri.indices[2]]) / 3.0f;
+	}
+}
+
+/*
+Two triangles are neighbours if they've an edge with the same two vertex
+indices. Every edge is looked up by its indices, smallest first, so it
+doesn't matter which way around either triangle has it.
+*/
+void NavigationMesh::BuildAdjacency() {
+	unordered_map<unsigned long long, int> openEdges; //to the triangle * 3 + edge that first had it
+	for (int t = 0; t < (int)allTris.size(); ++t) {
+		NavTri& tri = allTris[t];
+		for (int i = 0; i < 3; ++i) {
+			unsigned int a = (unsigned int)tri.indices[i];
+			unsigned int b = (unsigned int)tri.indices[(i + 1) % 3];
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+
+			auto found = openEdges.find(key);
+			if (found == openEdges.end()) {
+				openEdges.insert({ key, t * 3 + i });
+				continue;
+			}
+			NavTri& other = allTris[found->second / 3];
+			tri.neighbours[i] = &other;
+			other.neighbours[found->second % 3] = &tri;
+			openEdges.erase(found); //anything sharing it after this pair is left unconnected
+		}
+	}
+}
+
+/*
+Every triangle goes in each cell its bounding box touches, so finding the
+triangle a point is in only has to test the few in that point's cell.
+Cells are sized so there's about one triangle for each of them.
+*/
+void NavigationMesh::BuildTriGrid() {
+	triGridStart.clear();
+	triGridTris.clear();
+	gridWidth = 0;
+	gridDepth = 0;
+	if (allTris.empty()) {
+		return;
+	}
+	gridMin = allVerts[allTris[0].indices[0]];
+	Vector3 gridMax = gridMin;
+	for (const Vector3& v : allVerts) {
+		gridMin.x = v.x < gridMin.x ? v.x : gridMin.x;
+		gridMin.z = v.z < gridMin.z ? v.z : gridMin.z;
+		gridMax.x = v.x > gridMax.x ? v.x : gridMax.x;
+		gridMax.z = v.z > gridMax.z ? v.z : gridMax.z;
+	}
+	float sizeX = gridMax.x - gridMin.x;
+	float sizeZ = gridMax.z - gridMin.z;
+	gridCellSize = sqrtf((sizeX * sizeZ) / allTris.size());
+	if (gridCellSize <= 0.0f) {
+		gridCellSize = (sizeX > sizeZ ? sizeX : sizeZ) + 1.0f;
+	}
+	gridWidth = (int)(sizeX / gridCellSize) + 1;
+	gridDepth = (int)(sizeZ / gridCellSize) + 1;
+
+	auto forEachCell = [&](const NavTri& t, auto func) {
+		Vector3 a = allVerts[t.indices[0]];
+		Vector3 b = allVerts[t.indices[1]];
+		Vector3 c = allVerts[t.indices[2]];
+		float minX = a.x < b.x ? (a.x < c.x ? a.x : c.x) : (b.x < c.x ? b.x : c.x);
+		float minZ = a.z < b.z ? (a.z < c.z ? a.z : c.z) : (b.z < c.z ? b.z : c.z);
+		float maxX = a.x > b.x ? (a.x > c.x ? a.x : c.x) : (b.x > c.x ? b.x : c.x);
+		float maxZ = a.z > b.z ? (a.z > c.z ? a.z : c.z) : (b.z > c.z ? b.z : c.z);
+		int x0 = (int)((minX - gridMin.x) / gridCellSize);
+		int z0 = (int)((minZ - gridMin.z) / gridCellSize);
+		int x1 = (int)((maxX - gridMin.x) / gridCellSize);
+		int z1 = (int)((maxZ - gridMin.z) / gridCellSize);
+		for (int z = z0; z <= z1 && z < gridDepth; ++z) {
+			for (int x = x0; x <= x1 && x < gridWidth; ++x) {
+				func(z * gridWidth + x);
+			}
+		}
+	};
+	//Counted first, so every cell's triangles can go straight into one array
+	triGridStart.assign(gridWidth * gridDepth + 1, 0);
+	for (const NavTri& t : allTris) {
+		forEachCell(t, [&](int cell) { triGridStart[cell + 1]++; });
+	}
+	for (size_t i = 1; i < triGridStart.size(); ++i) {
+		triGridStart[i] += triGridStart[i - 1];
+	}
+	triGridTris.resize(triGridStart.back());
+	vector<int> filled(triGridStart.begin(), triGridStart.end() - 1);
+	for (int i = 0; i < (int)allTris.size(); ++i) {
+		forEachCell(allTris[i], [&](int cell) { triGridTris[filled[cell]++] = i; });
+	}
+}
+
+bool NavigationMesh::TriContains(int tri, const Vector3& pos) const {
+	const NavTri& t = allTris[tri];
+	const Vector3& a = allVerts[t.indices[0]];
+	const Vector3& b = allVerts[t.indices[1]];
+	const Vector3& c = allVerts[t.indices[2]];
+	//Inside if it's on the same side of all three edges, whichever way around they go
+	float ab = TriArea2(a, b, pos);
+	float bc = TriArea2(b, c, pos);
+	float ca = TriArea2(c, a, pos);
+	const float e = 0.0001f;
+	return (ab >= -e && bc >= -e && ca >= -e) || (ab <= e && bc <= e && ca <= e);
+}
+
+//Where there's more than one triangle under a point, it's on whichever's closest in height
+int NavigationMesh::FindTri(const Vector3& pos) const {
+	if (gridWidth == 0) {
+		return -1;
+	}
+	int x = (int)floorf((pos.x - gridMin.x) / gridCellSize);
+	int z = (int)floorf((pos.z - gridMin.z) / gridCellSize);
+	if (x < 0 || z < 0 || x >= gridWidth || z >= gridDepth) {
+		return -1;
+	}
+	int cell	= z * gridWidth + x;
+	int best	= -1;
+	float bestHeight = 0.0f;
+	for (int i = triGridStart[cell]; i < triGridStart[cell + 1]; ++i) {
+		int tri = triGridTris[i];
+		if (!TriContains(tri, pos)) {
+			continue;
+		}
+		float height = fabsf(allTris[tri].centroid.y - pos.y);
+		if (best < 0 || height < bestHeight) {
+			best		= tri;
+			bestHeight	= height;
+		}
+	}
+	return best;
+}
+
+int NavigationMesh::Cost(const Vector3& a, const Vector3& b) const {
+	return (int)((a - b).Length() * CostScale);
+}
+
 bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	thread_local NavigationGridSearch search;
+	return FindPath(from, to, outPath, search);
+}
+
+bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, NavigationGridSearch& search) const {
+	int startTri	= FindTri(from);
+	int endTri		= FindTri(to);
+	if (startTri < 0 || endTri < 0) {
+		return false; //outside of the mesh!
+	}
+	//Costs are from the middle of one triangle to the next, other than leaving the start
+	auto position = [&](int tri) {
+		return tri == startTri ? from : allTris[tri].centroid;
+	};
+	search.Begin((int)allTris.size());
+	search.Open(startTri, 0, Cost(from, to), -1);
+
+	while (!search.Empty()) {
+		int current = search.PopBest();
+		if (current == endTri) {
+			vector<int> tris;
+			for (int t = endTri; t >= 0; t = search.GetParent(t)) {
+				tris.emplace_back(t);
+			}
+			std::reverse(tris.begin(), tris.end());
+			PullString(from, to, tris, outPath);
+			return true;
+		}
+		const NavTri& t = allTris[current];
+		for (int i = 0; i < 3; ++i) {
+			if (!t.neighbours[i]) {
+				continue;
+			}
+			int neighbour = (int)(t.neighbours[i] - allTris.data());
+			if (search.IsClosed(neighbour)) {
+				continue;
+			}
+			int g = search.GetG(current) + Cost(position(current), allTris[neighbour].centroid);
+			if (search.IsOpen(neighbour) && g >= search.GetG(neighbour)) {
+				continue;
+			}
+			search.Open(neighbour, g, g + Cost(allTris[neighbour].centroid, to), current);
+		}
+	}
 	return false;
 }
+
+/*
+The simple stupid funnel algorithm: the path is pulled through each edge
+shared by two triangles on the way, in turn, keeping the narrowest funnel
+it can from the last corner it turned at. When an edge would cross over
+the funnel's other side, that side's corner is where the path has to
+turn, and the funnel starts again from there.
+*/
+void NavigationMesh::PullString(const Vector3& from, const Vector3& to, const vector<int>& tris, NavigationPath& outPath) const {
+	vector<Vector3> lefts;
+	vector<Vector3> rights;
+	lefts.emplace_back(from);
+	rights.emplace_back(from);
+	for (size_t i = 0; i + 1 < tris.size(); ++i) {
+		const NavTri& t		= allTris[tris[i]];
+		const NavTri* next	= &allTris[tris[i + 1]];
+		for (int e = 0; e < 3; ++e) {
+			if (t.neighbours[e] != next) {
+				continue;
+			}
+			Vector3 a = allVerts[t.indices[e]];
+			Vector3 b = allVerts[t.indices[(e + 1) % 3]];
+			//Which way round the edge is depends on which way round the triangle was wound
+			if (TriArea2(t.centroid, a, b) > 0.0f) {
+				lefts.emplace_back(a);
+				rights.emplace_back(b);
+			}
+			else {
+				lefts.emplace_back(b);
+				rights.emplace_back(a);
+			}
+			break;
+		}
+	}
+	lefts.emplace_back(to);
+	rights.emplace_back(to);
+
+	vector<Vector3> points;
+	points.emplace_back(from);
+
+	Vector3 apex	= from;
+	Vector3 left	= from;
+	Vector3 right	= from;
+	int apexIndex	= 0;
+	int leftIndex	= 0;
+	int rightIndex	= 0;
+
+	for (int i = 1; i < (int)lefts.size(); ++i) {
+		const Vector3& l = lefts[i];
+		const Vector3& r = rights[i];
+
+		if (TriArea2(apex, right, r) <= 0.0f) { //the right side is tightening
+			if (SamePoint(apex, right) || TriArea2(apex, left, r) > 0.0f) {
+				right		= r;
+				rightIndex	= i;
+			}
+			else { //crossed over the left side, so turn at its corner
+				points.emplace_back(left);
+				apex		= left;
+				apexIndex	= leftIndex;
+				left		= apex;
+				right		= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex;
+				continue;
+			}
+		}
+		if (TriArea2(apex, left, l) >= 0.0f) { //the left side is tightening
+			if (SamePoint(apex, left) || TriArea2(apex, right, l) < 0.0f) {
+				left		= l;
+				leftIndex	= i;
+			}
+			else {
+				points.emplace_back(right);
+				apex		= right;
+				apexIndex	= rightIndex;
+				left		= apex;
+				right		= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex;
+				continue;
+			}
+		}
+	}
+	if (!SamePoint(points.back(), to)) {
+		points.emplace_back(to);
+	}
+	//Waypoints are popped from the back, so the end goes in first
+	for (auto i = points.rbegin(); i != points.rend(); ++i) {
+		outPath.PushWaypoint(*i);
+	}
+}
@@ -1,21 +1,53 @@
 #pragma once
 #include "NavigationMap.h"
+#include "NavigationGrid.h"
 #include <string>
 #include <vector>
 namespace NCL {
 	namespace CSC8503 {
+		/*
+		Paths over a triangle mesh of everywhere that can be walked on, loaded
+		either from the text format (vertex and index counts, then the
+		vertices, then the indices) or from a baked file written by SaveBaked,
+		which also keeps which triangles are next to which and the grid for
+		finding them, so none of that has to be worked out again - it's read
+		straight out of the mapped file. Paths are found as an A* from
+		triangle to triangle, then pulled tight through the edges between
+		them, so they only turn at the corners they have to go around.
+		*/
 		class NavigationMesh : public NavigationMap	{
 		public:
 			NavigationMesh();
 			NavigationMesh(const std::string&filename);
+			//Straight from a list of triangles, as a baker makes them
+			NavigationMesh(const std::vector<Vector3>& vertices, const std::vector<int>& indices);
 			~NavigationMesh();
 
+			//Uses a search of the calling thread's own
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
-		
+			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath, NavigationGridSearch& search) const;
+
+			bool SaveBaked(const std::string& filename) const;
+
+			int GetTriCount() const {
+				return (int)allTris.size();
+			}
+			const std::vector<Vector3>& GetVertices() const {
+				return allVerts;
+			}
+			const std::vector<int>& GetIndices() const {
+				return allIndices;
+			}
+
+			//A* costs are ints, so distances are kept to this fraction of a unit
+			static const int CostScale = 100;
+
 		protected:
 
 			struct NavTri {
-				NavTri* neighbours[3];
+				NavTri* neighbours[3];	//neighbours[i] shares the edge from corner i to corner i + 1
+				int		indices[3];
+				Vector3	centroid;
 
 				NavTri() {
 					neighbours[0] = nullptr;
@@ -24,9 +56,28 @@ namespace NCL {
 				}
 			};
 
+			bool	LoadBaked(const std::string& filepath);
+			void	BuildTris();
+			void	BuildAdjacency();
+			void	BuildTriGrid();
+
+			int		FindTri(const Vector3& pos) const;
+			bool	TriContains(int tri, const Vector3& pos) const;
+			int		Cost(const Vector3& a, const Vector3& b) const;
+			void	PullString(const Vector3& from, const Vector3& to, const std::vector<int>& tris, NavigationPath& outPath) const;
+
 			std::vector<NavTri>		allTris;
 			std::vector<Vector3>	allVerts;
 			std::vector<int>		allIndices;
+
+			//Which triangles overlap each cell of a grid over the mesh, looking down
+			//on it - the triangles for cell i run from triGridStart[i] to triGridStart[i + 1]
+			std::vector<int>		triGridStart;
+			std::vector<int>		triGridTris;
+			Vector3					gridMin;
+			float					gridCellSize;
+			int						gridWidth;
+			int						gridDepth;
 		};
 	}
-}
\ No newline at end of file
+}
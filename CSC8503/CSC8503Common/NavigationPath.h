@@ -33,6 +33,10 @@ namespace NCL {
 			Vector3 FinalWaypoint() const {
 				return waypoints.front();
 			}
+			//Counting from the end, as the first waypoint to go to is the last one in
+			const Vector3& GetWaypoint(int i) const {
+				return waypoints[i];
+			}
 
 		protected:
 
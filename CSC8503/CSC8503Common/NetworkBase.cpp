@@ -2,14 +2,43 @@
 #include <enet/enet.h>
 #include <iostream>
 
+bool NetworkBase::defaultCompression = true;
+
 NetworkBase::NetworkBase()	{
 	netHandle = nullptr;
+	threadRunning = false;
+
+	//Events that only happen once, and would leave the game out of step if lost
+	int reliable[] = {
+		Hello, Message, String_Message, Event_Batch, World_State,
+		New_Projectile, Destroy_Projectile, ColourBlockUpdate, RefillPointUpdate,
+		Player_ID, Player_Connected, Player_Disconnected, Disconnect_Confirmation,
+		Client_Start, Shutdown, Resync_Request
+	};
+	for (int msgID : reliable) {
+		SetMessageDelivery(msgID, Delivery::Reliable);
+	}
 }
 
 NetworkBase::~NetworkBase()	{
+	StopNetworkThread();
+
+	SimulatedSend send;
+	while (simulatedSend.PopAny(send)) {
+		DropReference(send.packet);
+	}
+	NetworkEvent received;
+	while (simulatedReceive.PopAny(received)) {
+		enet_packet_destroy(received.packet);
+	}
+
 	if (netHandle) {
 		enet_host_destroy(netHandle);
 	}
+	enet_uint8* buffer;
+	while (freeBuffers.Pop(buffer)) {
+		delete[] buffer;
+	}
 }
 
 void NetworkBase::Initialise() {
@@ -20,18 +49,305 @@ void NetworkBase::Destroy() {
 	enet_deinitialize();
 }
 
-bool NetworkBase::ProcessPacket(GamePacket* packet, int peerID) {
-	PacketHandlerIterator firstHandler;
-	PacketHandlerIterator lastHandler;
+bool NetworkBase::SetCompression(bool on) {
+	if (!netHandle || threadRunning) {
+		return false;
+	}
+	if (on) {
+		if (enet_host_compress_with_range_coder(netHandle) != 0) {
+			return false;
+		}
+	}
+	else {
+		enet_host_compress(netHandle, nullptr);
+	}
+	compressed = on;
+	return true;
+}
+
+/*
+Buffers come from the pool where possible, so sending doesn't have to
+allocate one every time. ENet is told it doesn't own them, and hands them
+back through OnPacketFreed once every peer has finished with the packet.
+*/
+ENetPacket* NetworkBase::CreatePooledPacket(int size) {
+	ENetPacket* packet;
+	if (size > MaxPacketSize) {
+		packet = enet_packet_create(nullptr, size, 0);
+	}
+	else {
+		enet_uint8* buffer;
+		if (!freeBuffers.Pop(buffer)) {
+			buffer = new enet_uint8[MaxPacketSize];
+		}
+		packet = enet_packet_create(buffer, size, ENET_PACKET_FLAG_NO_ALLOCATE);
+		packet->freeCallback	= &NetworkBase::OnPacketFreed;
+		packet->userData		= this;
+	}
+	packet->referenceCount = 1;
+	return packet;
+}
+
+void ENET_CALLBACK NetworkBase::OnPacketFreed(ENetPacket* packet) {
+	NetworkBase* owner = (NetworkBase*)packet->userData;
+	if (!owner->freeBuffers.Push(packet->data)) {
+		delete[] packet->data; //plenty spare already
+	}
+}
+
+void NetworkBase::DropReference(ENetPacket* packet) {
+	if (--packet->referenceCount == 0) {
+		enet_packet_destroy(packet);
+	}
+}
+
+//The length can only shrink, which ENet allows without reallocating
+void NetworkBase::FinishPacket(ENetPacket* handle) {
+	const GamePacket* p = (const GamePacket*)handle->data;
+	Delivery d = GetMessageDelivery(p->type);
+	enet_uint32 flags = 0; //ENet's default is unreliable but sequenced
+	if (d == Delivery::Reliable) {
+		flags = ENET_PACKET_FLAG_RELIABLE;
+	}
+	else if (d == Delivery::Unreliable) {
+		flags = ENET_PACKET_FLAG_UNSEQUENCED;
+	}
+	handle->flags		= (handle->flags & ENET_PACKET_FLAG_NO_ALLOCATE) | flags;
+	handle->dataLength	= p->GetTotalSize();
+}
+
+/*
+When the send side's being simulated, each send gets a copy of the packet,
+as the original can be shared with other peers, and belongs to the network
+thread as soon as it's been handed over.
+*/
+void NetworkBase::SendPreparedPacket(ENetPeer* peer, ENetPacket* handle) {
+	int type = ((const GamePacket*)handle->data)->type;
+	statistics.RecordOutgoing(peer ? (int)peer->incomingPeerID : NCL::CSC8503::NetworkStatistics::BroadcastPeer, type, (int)handle->dataLength);
+	if (recorder.IsRecording() && (!peer || (int)peer->incomingPeerID == recordingPeer)) {
+		recorder.Record(*(const GamePacket*)handle->data, (int)handle->dataLength);
+	}
+
+	if (!simulatedSend.IsActive()) {
+		DispatchPacket(peer, handle);
+		return;
+	}
+	int copies = simulatedSend.GetCopies(CanLose(handle));
+	for (int i = 0; i < copies; ++i) {
+		ENetPacket* copy = CreatePooledPacket((int)handle->dataLength);
+		memcpy(copy->data, handle->data, handle->dataLength);
+		copy->flags = (copy->flags & ENET_PACKET_FLAG_NO_ALLOCATE) | (handle->flags & ~ENET_PACKET_FLAG_NO_ALLOCATE);
+		simulatedSend.Push({ peer, copy }, (int)handle->dataLength);
+	}
+}
+
+void NetworkBase::SendSimulatedPackets() {
+	SimulatedSend send;
+	while (simulatedSend.Pop(send)) {
+		DispatchPacket(send.peer, send.packet);
+		ReleasePacket(send.packet);
+	}
+}
+
+bool NetworkBase::CanLose(const ENetPacket* packet) const {
+	return GetMessageDelivery(((const GamePacket*)packet->data)->type) != Delivery::Reliable;
+}
+
+void NetworkBase::DispatchPacket(ENetPeer* peer, ENetPacket* handle) {
+	int channel = (int)GetMessageDelivery(((const GamePacket*)handle->data)->type);
+	if (!threadRunning) {
+		SendOutgoing(peer, channel, handle);
+		return;
+	}
+	while (!outgoing.Push({ peer, channel, handle })) {
+		std::this_thread::yield(); //the network thread will empty it soon enough
+	}
+}
+
+void NetworkBase::ReleasePacket(ENetPacket* handle) {
+	if (!threadRunning) {
+		DropReference(handle);
+		return;
+	}
+	while (!outgoing.Push({ nullptr, ReleaseChannel, handle })) {
+		std::this_thread::yield();
+	}
+}
+
+void NetworkBase::StartNetworkThread() {
+	if (threadRunning || !netHandle) {
+		return;
+	}
+	threadRunning = true;
+	networkThread = std::thread(&NetworkBase::NetworkThreadLoop, this);
+}
+
+/*
+Anything still queued up to send goes out before the host can be destroyed,
+and anything received that the game never got round to is thrown away.
+*/
+void NetworkBase::StopNetworkThread() {
+	if (!threadRunning) {
+		return;
+	}
+	threadRunning = false;
+	networkThread.join();
 
-	bool canHandle = GetPacketHandlers(packet->type, firstHandler, lastHandler);
+	OutgoingPacket out;
+	while (outgoing.Pop(out)) {
+		SendOutgoing(out.peer, out.channel, out.packet);
+	}
+	enet_host_flush(netHandle);
 
-	if (canHandle) {
-		for (auto i = firstHandler; i != lastHandler; ++i) {
-			i->second->ReceivePacket(packet->type, packet, peerID);
+	NetworkEvent e;
+	while (incoming.Pop(e)) {
+		if (e.packet) {
+			enet_packet_destroy(e.packet);
 		}
+	}
+}
+
+void NetworkBase::NetworkThreadLoop() {
+	while (threadRunning) {
+		OutgoingPacket out;
+		while (outgoing.Pop(out)) {
+			SendOutgoing(out.peer, out.channel, out.packet);
+		}
+		//Waits a moment for traffic, rather than spinning
+		ENetEvent event;
+		int result = enet_host_service(netHandle, &event, 1);
+		while (result > 0) {
+			NetworkEvent e = { event.type, (int)event.peer->incomingPeerID, event.packet };
+			if (!incoming.Push(e) && e.packet) {
+				enet_packet_destroy(e.packet); //the game thread's fallen a long way behind
+			}
+			result = enet_host_check_events(netHandle, &event);
+		}
+		std::lock_guard<std::mutex> lock(connectionMutex);
+		ReadConnectionState(connectionState);
+	}
+}
+
+//Whatever ENet does with the packet, it's still holding our reference until it's released
+void NetworkBase::SendOutgoing(ENetPeer* peer, int channel, ENetPacket* packet) {
+	if (channel == ReleaseChannel) {
+		DropReference(packet);
+	}
+	else if (!peer) {
+		enet_host_broadcast(netHandle, channel, packet);
+	}
+	else {
+		enet_peer_send(peer, channel, packet);
+	}
+}
+
+void NetworkBase::SendToPeer(ENetPeer* peer, const GamePacket& p) {
+	ENetPacket* packet = CreatePooledPacket(p.GetTotalSize());
+	memcpy(packet->data, &p, p.GetTotalSize());
+	FinishPacket(packet);
+	SendPreparedPacket(peer, packet);
+	ReleasePacket(packet);
+}
+
+/*
+Sends that have been held back go out first. With the receive side
+simulated, everything that's just arrived is queued up, and it's only the
+packets whose time has come that get handed back.
+*/
+bool NetworkBase::PollEvent(NetworkEvent& e) {
+	SendSimulatedPackets();
+
+	while (PollENetEvent(e)) {
+		if (e.type != ENET_EVENT_TYPE_RECEIVE || !simulatedReceive.IsActive()) {
+			return true;
+		}
+		int copies = simulatedReceive.GetCopies(CanLose(e.packet));
+		if (copies == 2) {
+			NetworkEvent duplicate = e;
+			duplicate.packet = enet_packet_create(e.packet->data, e.packet->dataLength, 0);
+			simulatedReceive.Push(e, (int)e.packet->dataLength);
+			simulatedReceive.Push(duplicate, (int)e.packet->dataLength);
+		}
+		else if (copies == 1) {
+			simulatedReceive.Push(e, (int)e.packet->dataLength);
+		}
+		else {
+			enet_packet_destroy(e.packet);
+		}
+	}
+	return simulatedReceive.Pop(e); //still emptied out after the simulation's turned off
+}
+
+bool NetworkBase::PollENetEvent(NetworkEvent& e) {
+	if (threadRunning) {
+		return incoming.Pop(e);
+	}
+	ENetEvent event;
+	if (enet_host_service(netHandle, &event, 0) > 0) {
+		e = { event.type, (int)event.peer->incomingPeerID, event.packet };
 		return true;
 	}
+	return false;
+}
+
+//Only from whichever thread is servicing the host
+void NetworkBase::ReadConnectionState(ConnectionState& into) const {
+	into.totalSent		= netHandle->totalSentData;
+	into.totalReceived	= netHandle->totalReceivedData;
+	into.peers.clear();
+	for (size_t i = 0; i < netHandle->peerCount; ++i) {
+		const ENetPeer& p = netHandle->peers[i];
+		if (p.state == ENET_PEER_STATE_CONNECTED) {
+			into.peers.push_back({ (int)i, (float)p.roundTripTime, (float)p.packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE });
+		}
+	}
+}
+
+/*
+With the network thread running, ENet's numbers come from the copy it
+keeps - reading the host directly would be racing it. Without it, this
+is the thread that services the host, so they're read straight off.
+*/
+void NetworkBase::UpdateStatistics(float dt) {
+	if (netHandle) {
+		std::unique_lock<std::mutex> lock(connectionMutex, std::defer_lock);
+		if (threadRunning) {
+			lock.lock();
+		}
+		else {
+			ReadConnectionState(connectionState);
+		}
+		statistics.SetWireTotals(connectionState.totalSent, connectionState.totalReceived);
+		for (const PeerConnection& p : connectionState.peers) {
+			statistics.SetPeerConnection(p.peer, p.roundTripTime, p.packetLoss);
+		}
+	}
+	statistics.Update(dt);
+}
+
+void NetworkBase::AddPacketHandler(int msgID, const PacketHandler& handler) {
+	if (msgID < 0 || msgID >= MaxMessageTypes) {
+		std::cout << __FUNCTION__ << " invalid packet type " << msgID << std::endl;
+		return;
+	}
+	PacketHandlerList& list = packetHandlers[msgID];
+	if (list.count == MaxHandlersPerMessage) {
+		std::cout << __FUNCTION__ << " too many handlers for packet type " << msgID << std::endl;
+		return;
+	}
+	list.handlers[list.count++] = handler;
+}
+
+bool NetworkBase::ProcessPacket(GamePacket* packet, int peerID) {
+	if (packet->type >= 0 && packet->type < MaxMessageTypes) {
+		const PacketHandlerList& list = packetHandlers[packet->type];
+		for (int i = 0; i < list.count; ++i) {
+			list.handlers[i](packet, peerID);
+		}
+		if (list.count > 0) {
+			return true;
+		}
+	}
 	std::cout << __FUNCTION__ << " no handler for packet type " << packet->type << std::endl;
 	return false;
 }
\ No newline at end of file
@@ -3,6 +3,16 @@
 #include <enet/enet.h>
 #include <map>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <new>
+#include <atomic>
+#include "SPSCQueue.h"
+#include "NetworkStatistics.h"
+#include "NetworkSimulator.h"
+#include "PacketRecording.h"
 
 enum BasicNetworkMessages {
 	None,
@@ -11,7 +21,11 @@ enum BasicNetworkMessages {
 	String_Message,
 	Delta_State,	//1 byte per channel since the last state
 	Full_State,		//Full transform etc
+	Snapshot_State,	//a batch of the above, packed into one packet
+	Event_Batch,	//the gameplay events from one server tick, packed the same way
+	World_State,	//what's changed in the level so far, sent to a client as it joins
 	Received_State, //received from a client, informs that its received packet n
+	Player_State,	//where the server has a client's own player, after its inputs up to n
 	New_Projectile,
 	Destroy_Projectile,
 	ColourBlockUpdate,
@@ -22,8 +36,12 @@ enum BasicNetworkMessages {
 	Player_Disconnected,
 	Disconnect_Confirmation,
 	Client_Start,
-	Shutdown
+	Shutdown,
+	World_Hash,		//the server's hash of the level state, every so often in a snapshot
+	Resync_Request,	//from a client whose level state doesn't match, for the parts that don't
+	MaxMessageTypes //not a real message, just how many there are
 };
+static_assert(MaxMessageTypes <= NCL::CSC8503::NetworkStatistics::MessageSlots, "NetworkStatistics needs more message slots");
 
 enum OperationByte {
 	Nill,
@@ -118,6 +136,20 @@ public:
 	virtual void ReceivePacket(int type, GamePacket* payload, int source = -1) = 0;
 };
 
+/*
+How each message type gets sent. Every class has its own ENet channel, so a
+lost state update never holds up a gameplay event, and a resent event never
+holds up the newest state.
+Reliable	- always arrives, in order
+Sequenced	- may be lost, but never arrives after a newer one
+Unreliable	- may be lost, and may arrive in any order
+*/
+enum class Delivery {
+	Reliable,
+	Sequenced,
+	Unreliable
+};
+
 class NetworkBase	{
 public:
 	static void Initialise();
@@ -127,29 +159,225 @@ public:
 		return 1234;
 	}
 
+	static const int ChannelCount = 3; //one per Delivery
+
+	/*
+	Whether hosts run everything through ENet's range coder on the way out,
+	and back in. Both ends have to agree, as a host without it drops
+	anything that arrives compressed. It's on unless this says otherwise,
+	and applies to every host made after it's set.
+	*/
+	static void SetDefaultCompression(bool on) {
+		defaultCompression = on;
+	}
+
+	//Has to be done before the network thread's started, as it changes how the host sends
+	bool SetCompression(bool on);
+
+	bool IsCompressed() const {
+		return compressed;
+	}
+
+	typedef std::function<void(GamePacket*, int)> PacketHandler;
+
 	void RegisterPacketHandler(int msgID, PacketReceiver* receiver) {
-		packetHandlers.insert(std::make_pair(msgID, receiver));
+		AddPacketHandler(msgID, [receiver](GamePacket* p, int source) {
+			receiver->ReceivePacket(p->type, p, source);
+		});
+	}
+
+	//The handler gets the packet already cast to the type that message uses
+	template <typename T, typename F>
+	void RegisterPacketHandler(int msgID, F handler) {
+		AddPacketHandler(msgID, [handler](GamePacket* p, int source) {
+			handler(*(T*)p, source);
+		});
+	}
+
+	void AddPacketHandler(int msgID, const PacketHandler& handler);
+
+	//Hands a packet to everything registered for its type. Public so that
+	//packets unpacked from inside others can go back through it
+	bool ProcessPacket(GamePacket* p, int peerID = -1);
+
+	//Anything not set goes Sequenced
+	void SetMessageDelivery(int msgID, Delivery d) {
+		messageDelivery[msgID] = d;
+	}
+
+	Delivery GetMessageDelivery(int msgID) const {
+		auto i = messageDelivery.find(msgID);
+		return i == messageDelivery.end() ? Delivery::Sequenced : i->second;
+	}
+
+	/*
+	Moves servicing ENet onto its own thread, which sends and receives
+	continuously rather than once a frame. Packets are handed between it
+	and the game thread through a pair of queues, so nothing else about
+	sending or receiving changes.
+	*/
+	void StartNetworkThread();
+	void StopNetworkThread();
+
+	bool IsThreaded() const {
+		return threadRunning;
+	}
+
+	static const int MaxPacketSize	= 1280; //bigger packets get a buffer of their own
+	static const int PacketPoolSize = 256;
+
+	/*
+	For writing a packet straight into the buffer ENet sends from, rather
+	than building it somewhere else and having it copied in. Once it's been
+	written, FinishPacket sets its size and delivery from what's in it, and
+	then it can be sent to as many peers as need it. It has to be handed
+	back with ReleasePacket, but ENet keeps hold of it until it's done.
+	*/
+	template <typename T>
+	ENetPacket* BeginPacket(T*& packet) {
+		static_assert(sizeof(T) <= MaxPacketSize, "Packet type is bigger than the pooled buffers");
+		ENetPacket* handle = CreatePooledPacket(sizeof(T));
+		packet = new (handle->data) T();
+		return handle;
+	}
+	NCL::CSC8503::NetworkStatistics& GetStatistics() {
+		return statistics;
+	}
+
+	//Picks up each peer's round trip time and loss from ENet, and updates the rates
+	void UpdateStatistics(float dt);
+
+	/*
+	Makes the connection behave like a worse one, for testing. Latency and
+	bandwidth apply to everything, but only packets that aren't sent
+	reliably can be lost or duplicated, as ENet would resend the others.
+	*/
+	void SetSimulatedConditions(const NCL::CSC8503::NetworkConditions& send, const NCL::CSC8503::NetworkConditions& receive) {
+		simulatedSend.SetConditions(send);
+		simulatedReceive.SetConditions(receive);
+	}
+
+	const NCL::CSC8503::NetworkConditions& GetSimulatedSendConditions() const {
+		return simulatedSend.GetConditions();
+	}
+
+	const NCL::CSC8503::NetworkConditions& GetSimulatedReceiveConditions() const {
+		return simulatedReceive.GetConditions();
+	}
+
+	//Saves everything sent to the given peer, along with anything sent to
+	//everyone, so that peer's side of the game can be played back later
+	bool StartRecording(const std::string& filename, int peer) {
+		recordingPeer = peer;
+		return recorder.Start(filename);
+	}
+
+	void StopRecording() {
+		recorder.Stop();
 	}
+
+	void FinishPacket(ENetPacket* handle);
+	void SendPreparedPacket(ENetPeer* peer, ENetPacket* handle); //a null peer sends to everyone
+	void ReleasePacket(ENetPacket* handle);
 protected:
 	NetworkBase();
 	~NetworkBase();
 
-	bool ProcessPacket(GamePacket* p, int peerID = -1);
+	//The packet starts with a reference of its own, dropped by ReleasePacket
+	ENetPacket* CreatePooledPacket(int size);
+	static void ENET_CALLBACK OnPacketFreed(ENetPacket* packet);
+	static void DropReference(ENetPacket* packet);
+
+	//Copies the packet into a pooled buffer. A null peer sends to everyone
+	void SendToPeer(ENetPeer* peer, const GamePacket& p);
 
-	typedef std::multimap<int, PacketReceiver*>::const_iterator PacketHandlerIterator;
+	struct NetworkEvent {
+		ENetEventType	type;
+		int				peer;
+		ENetPacket*		packet;
+	};
+	//The caller owns any packet that comes with the event
+	bool PollEvent(NetworkEvent& e);
+	bool PollENetEvent(NetworkEvent& e);
 
-	bool GetPacketHandlers(int msgID, PacketHandlerIterator& first, PacketHandlerIterator& last) const {
-		auto range = packetHandlers.equal_range(msgID);
+	//Hands the packet to ENet, or the network thread, straight away
+	void DispatchPacket(ENetPeer* peer, ENetPacket* handle);
+	void SendSimulatedPackets();
+	bool CanLose(const ENetPacket* packet) const;
 
-		if (range.first == packetHandlers.end()) {
-			return false; //no handlers for this message type!
-		}
-		first	= range.first;
-		last	= range.second;
-		return true;
-	}
+	void NetworkThreadLoop();
+	void SendOutgoing(ENetPeer* peer, int channel, ENetPacket* packet);
+
+	//Queued after a packet's sends, so the network thread lets go of it once they're done
+	static const int ReleaseChannel = -1;
+
+	struct OutgoingPacket {
+		ENetPeer*	peer;
+		int			channel;
+		ENetPacket*	packet;
+	};
+	static const int QueueSize = 1024;
+
+	NCL::CSC8503::SPSCQueue<NetworkEvent, QueueSize>	incoming;
+	NCL::CSC8503::SPSCQueue<OutgoingPacket, QueueSize>	outgoing;
+
+	//Filled by whichever thread ENet frees packets on, and emptied by the game thread
+	NCL::CSC8503::SPSCQueue<enet_uint8*, PacketPoolSize> freeBuffers;
+
+	std::thread			networkThread;
+	std::atomic<bool>	threadRunning;
+
+	/*
+	What UpdateStatistics wants from ENet's host and peers. Those are only
+	safe to read from whichever thread is servicing the host, so with the
+	network thread running, it copies them here after every service, and
+	the game thread reads the copy under connectionMutex.
+	*/
+	struct PeerConnection {
+		int		peer;
+		float	roundTripTime;
+		float	packetLoss;
+	};
+	struct ConnectionState {
+		uint32_t					totalSent		= 0;
+		uint32_t					totalReceived	= 0;
+		std::vector<PeerConnection>	peers; //only the connected ones
+	};
+	void ReadConnectionState(ConnectionState& into) const;
+
+	std::mutex			connectionMutex;
+	ConnectionState		connectionState;
+
+	/*
+	Handlers are looked up by indexing straight in with the message type.
+	Hardly anything has more than one handler, so each type only has room
+	for a few, kept inline rather than in their own allocation.
+	*/
+	static const int MaxHandlersPerMessage = 4;
+
+	struct PacketHandlerList {
+		PacketHandler	handlers[MaxHandlersPerMessage];
+		int				count = 0;
+	};
 
 	ENetHost* netHandle;
+	bool compressed = false;
+	static bool defaultCompression;
+
+	NCL::CSC8503::NetworkStatistics statistics;
+
+	NCL::CSC8503::PacketRecorder	recorder;
+	int								recordingPeer = 0;
+
+	//Each delayed send has a copy of the packet of its own, and each
+	//delayed receive is an event waiting to come out of PollEvent
+	struct SimulatedSend {
+		ENetPeer*	peer;
+		ENetPacket* packet;
+	};
+	NCL::CSC8503::NetworkSimulator<SimulatedSend>	simulatedSend;
+	NCL::CSC8503::NetworkSimulator<NetworkEvent>	simulatedReceive;
 
-	std::multimap<int, PacketReceiver*> packetHandlers;
+	PacketHandlerList packetHandlers[MaxMessageTypes];
+	std::map<int, Delivery> messageDelivery;
 };
\ No newline at end of file
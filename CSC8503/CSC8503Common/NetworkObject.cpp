@@ -1,123 +1,352 @@
 #include "NetworkObject.h"
-#include "../GameTech/Agent.h"
+#include <cstring>
+#include <cmath>
 
 using namespace NCL;
 using namespace CSC8503;
 
+NetworkTypes::Type NetworkTypes::types[NetworkTypes::MaxTypes];
+
 NetworkObject::NetworkObject(GameObject& o, int id) : object(o)	{
 	deltaErrors = 0;
 	fullErrors  = 0;
 	networkID   = id;
+	hasPreviousState = false;
+	oldestStateID = 0;
 }
 
 NetworkObject::~NetworkObject()	{
 }
 
-bool NetworkObject::ReadPacket(GamePacket& p) {
+bool NetworkObject::ReadPacket(GamePacket& p, int snapshotID) {
 	if (p.type == Delta_State) {
-		return ReadDeltaPacket((DeltaPacket&)p);
+		return ReadDeltaPacket((DeltaPacket&)p, snapshotID);
 	}
 	if (p.type == Full_State) {
-		return ReadFullPacket((FullPacket&)p);
+		return ReadFullPacket((FullPacket&)p, snapshotID);
 	}
 	return false; //this isn't a packet we care about!
 }
 
-bool NetworkObject::WritePacket(GamePacket** p, bool deltaFrame, int stateID) {
-	if (deltaFrame) {
-		if (!WriteDeltaPacket(p, stateID)) {
-			return WriteFullPacket(p);
-		}
+void NetworkObject::ApplyState(const NetworkState& state, int snapshotID) {
+	if (snapshotID < 0) {
+		object.GetTransform()
+			.SetPosition(state.position)
+			.SetOrientation(state.orientation);
+		return;
 	}
-	return WriteFullPacket(p);
-}
+	//Unreliable packets can arrive out of order, so keep the buffer sorted
+	auto i = interpolationStates.end();
+	while (i != interpolationStates.begin() && (i - 1)->stateID >= snapshotID) {
+		--i;
+	}
+	if (i != interpolationStates.end() && i->stateID == snapshotID) {
+		return; //already got it
+	}
+	if (hasPreviousState && snapshotID <= previousState.stateID) {
+		return; //too late to be any use
+	}
+	i = interpolationStates.insert(i, state);
+	i->stateID = snapshotID;
 
-//Client objects recieve these packets
-bool NetworkObject::ReadDeltaPacket(DeltaPacket &p) {
-	if (p.fullID != lastFullState.stateID) {
-		deltaErrors++; //can't delta this frame
-		return false;
+	if ((int)interpolationStates.size() > MaxInterpolationStates) {
+		interpolationStates.pop_front();
 	}
+}
 
-	UpdateStateHistory(p.fullID);
+void NetworkObject::UpdateInterpolation(float renderSnapshot, float maxExtrapolation) {
+	if (interpolationStates.empty()) {
+		return;
+	}
+	//Keep the newest state that's at or before the render time
+	while (interpolationStates.size() > 1 && interpolationStates[1].stateID <= renderSnapshot) {
+		previousState		= interpolationStates.front();
+		hasPreviousState	= true;
+		interpolationStates.pop_front();
+	}
+	const NetworkState& from = interpolationStates.front();
 
-	Vector3		fullPos			= lastFullState.position;
-	Quaternion  fullOrientation = lastFullState.orientation;
+	Vector3		position	= from.position;
+	Quaternion	orientation = from.orientation;
 
-	fullPos.x += p.pos[0];
-	fullPos.y += p.pos[1];
-	fullPos.z += p.pos[2];
+	if (interpolationStates.size() > 1 && renderSnapshot > from.stateID) {
+		const NetworkState& to = interpolationStates[1];
+		float t = (renderSnapshot - from.stateID) / (float)(to.stateID - from.stateID);
 
-	fullOrientation.x += ((float)p.orientation[0]) / 127.0f;
-	fullOrientation.y += ((float)p.orientation[1]) / 127.0f;
-	fullOrientation.z += ((float)p.orientation[2]) / 127.0f;
-	fullOrientation.w += ((float)p.orientation[3]) / 127.0f;
+		position	= from.position + (to.position - from.position) * t;
+		orientation = Quaternion::Slerp(from.orientation, to.orientation, t);
+	}
+	else if (hasPreviousState && renderSnapshot > from.stateID) {
+		float ahead = renderSnapshot - from.stateID;
+		ahead = ahead > maxExtrapolation ? maxExtrapolation : ahead;
 
+		Vector3 velocity = (from.position - previousState.position) / (float)(from.stateID - previousState.stateID);
+		position = from.position + velocity * ahead;
+	}
 	object.GetTransform()
-		.SetPosition(fullPos)
-		.SetOrientation(fullOrientation);
+		.SetPosition(position)
+		.SetOrientation(orientation);
+}
 
-	return true;
+GamePacket* NetworkObject::WritePacket(FullPacket& full, DeltaPacket& delta, bool deltaFrame, int stateID) {
+	if (deltaFrame && WriteDeltaPacket(delta, stateID)) {
+		return &delta;
+	}
+	if (WriteFullPacket(full)) {
+		return &full;
+	}
+	return nullptr;
 }
 
-bool NetworkObject::ReadFullPacket(FullPacket &p) {
-	if (p.fullState.stateID < lastFullState.stateID) {
-		return false; // received an 'old' packet, ignore!
+void NetworkObject::SetSnapshot(int stateID) {
+	bool oriented = (NetworkTypes::Get(object.GetTypeID()).fields & ReplicatedFields::Orientation) != 0;
+	lastFullState.position		= object.GetTransform().GetPosition();
+	lastFullState.orientation	= oriented ? object.GetTransform().GetOrientation() : Quaternion(); //so deltas never send it either
+	lastFullState.stateID		= stateID;
+	lastFullState.Quantise(); //so deltas are against exactly what the clients have
+}
+
+void FullPacket::Write(int objectID, int typeID, int playerID, const NetworkState& state) {
+	BitWriter writer(data, MaxData);
+	int wireID = NetworkTypes::GetWireID(typeID);
+	writer.WriteVarInt((uint32_t)objectID);
+	writer.WriteBits((uint32_t)wireID, NetworkTypes::TypeBits);
+	NetworkTypes::Get(wireID).write(writer, playerID, state);
+	size = (short)writer.GetByteCount();
+}
+
+bool FullPacket::Read(int& objectID, int& playerID, NetworkState& state) const {
+	BitReader reader(data, size < MaxData ? size : MaxData);
+	objectID	= (int)reader.ReadVarInt();
+	int wireID	= (int)reader.ReadBits(NetworkTypes::TypeBits);
+	NetworkTypes::Get(wireID).read(reader, playerID, state);
+	return !reader.HasOverflowed();
+}
+
+bool DeltaPacket::Write(int objectID, const NetworkState& baseline, const NetworkState& state) {
+	BitWriter writer(data, MaxData);
+	writer.WriteVarInt((uint32_t)objectID);
+	writer.WriteVarInt((uint32_t)baseline.stateID);
+
+	bool moved = !(state.position == baseline.position);
+	writer.WriteBool(moved);
+	if (moved) {
+		state.WritePositionDelta(writer, baseline);
 	}
-	lastFullState = p.fullState;
 
-	object.GetTransform()
-		.SetPosition(lastFullState.position)
-		.SetOrientation(lastFullState.orientation);
+	//Compare what would actually be sent, so tiny changes don't count
+	uint8_t		before[8];
+	uint8_t		after[8];
+	BitWriter	beforeWriter(before, sizeof(before));
+	BitWriter	afterWriter(after, sizeof(after));
+	baseline.WriteOrientation(beforeWriter);
+	state.WriteOrientation(afterWriter);
+	bool rotated = memcmp(before, after, afterWriter.GetByteCount()) != 0;
+
+	writer.WriteBool(rotated);
+	if (rotated) {
+		state.WriteOrientation(writer);
+	}
+	size = (short)writer.GetByteCount();
+	return !writer.HasOverflowed();
+}
 
-	stateHistory.emplace_back(lastFullState);
+bool DeltaPacket::ReadHeader(int& objectID, int& fullID) const {
+	BitReader reader(data, size < MaxData ? size : MaxData);
+	objectID	= (int)reader.ReadVarInt();
+	fullID		= (int)reader.ReadVarInt();
+	return !reader.HasOverflowed();
+}
 
-	return true;
+bool DeltaPacket::Read(const NetworkState& baseline, NetworkState& state) const {
+	BitReader reader(data, size < MaxData ? size : MaxData);
+	reader.ReadVarInt(); //the header, which the caller has already looked at
+	reader.ReadVarInt();
+
+	state = baseline;
+	if (reader.ReadBool()) {
+		state.ReadPositionDelta(reader, baseline);
+	}
+	if (reader.ReadBool()) {
+		state.ReadOrientation(reader);
+	}
+	return !reader.HasOverflowed();
 }
 
-bool NetworkObject::WriteDeltaPacket(GamePacket**p, int stateID) {
-	DeltaPacket* dp = new DeltaPacket();
+namespace {
+	const int InputButtonBits	= 5;	//up to AgentInput::Jump
+	const int AngleBits			= 16;
+	const float ViewSteps		= 16.0f;	//per snapshot
 
-	dp->objectID = networkID;
+	uint32_t QuantiseAngle(float degrees) {
+		float turns = degrees / 360.0f;
+		turns -= floor(turns);
+		return (uint32_t)(turns * 65536.0f + 0.5f) & 0xFFFF;
+	}
 
-	NetworkState state;
-	if (!GetNetworkState(stateID, state)) {
-		return false; //can't delta!
+	//Pitch comes back as -180 to 180, so looking down stays negative
+	float DequantiseAngle(uint32_t q, bool isSigned) {
+		float degrees = q * (360.0f / 65536.0f);
+		return isSigned && degrees > 180.0f ? degrees - 360.0f : degrees;
+	}
+
+	//The shortest way round, so crossing 0 is a small change too
+	int32_t AngleDelta(uint32_t from, uint32_t to) {
+		return (int16_t)(uint16_t)(to - from);
+	}
+
+	void WriteFire(BitWriter& writer, const InputFrame& frame) {
+		bool firing = frame.firingInfo == 0 || frame.firingInfo == 1;
+		writer.WriteBits(firing ? frame.firingInfo + 1 : 0, 2);
+		if (firing) {
+			writer.WriteVarInt(frame.viewSnapshot < 0.0f ? 0 : (uint32_t)(frame.viewSnapshot * ViewSteps + 0.5f) + 1);
+		}
+	}
+
+	void ReadFire(BitReader& reader, InputFrame& frame) {
+		frame.firingInfo	= (int)reader.ReadBits(2) - 1;
+		frame.viewSnapshot	= -1.0f;
+		if (frame.firingInfo >= 0) {
+			uint32_t view = reader.ReadVarInt();
+			frame.viewSnapshot = view == 0 ? -1.0f : (view - 1) / ViewSteps;
+		}
 	}
+}
 
-	dp->fullID = stateID;
+void ClientPacket::Write(const ClientInput& input) {
+	BitWriter writer(data, MaxData);
+	int frameCount = input.frameCount > InputHistory ? InputHistory : input.frameCount;
+
+	writer.WriteVarInt((uint32_t)(input.playerID + 1));
+	writer.WriteVarInt((uint32_t)(input.acknowledged + 1));
+	writer.WriteVarInt((uint32_t)(input.inputSequence + 1));
+	writer.WriteBits((uint32_t)frameCount, 3);
+
+	uint32_t yaw	= 0;
+	uint32_t pitch	= 0;
+	for (int i = 0; i < frameCount; ++i) {
+		const InputFrame& frame = input.frames[i];
+		uint32_t newYaw		= QuantiseAngle(frame.yaw);
+		uint32_t newPitch	= QuantiseAngle(frame.pitch);
+
+		if (i == 0) {
+			writer.WriteBits((uint32_t)frame.buttons, InputButtonBits);
+			writer.WriteBits(newYaw, AngleBits);
+			writer.WriteBits(newPitch, AngleBits);
+		}
+		else {
+			bool buttonsChanged = frame.buttons != input.frames[i - 1].buttons;
+			writer.WriteBool(buttonsChanged);
+			if (buttonsChanged) {
+				writer.WriteBits((uint32_t)frame.buttons, InputButtonBits);
+			}
+			writer.WriteBool(newYaw != yaw);
+			if (newYaw != yaw) {
+				writer.WriteSignedVarInt(AngleDelta(yaw, newYaw));
+			}
+			writer.WriteBool(newPitch != pitch);
+			if (newPitch != pitch) {
+				writer.WriteSignedVarInt(AngleDelta(pitch, newPitch));
+			}
+		}
+		WriteFire(writer, frame);
+		yaw		= newYaw;
+		pitch	= newPitch;
+	}
+	size = (short)writer.GetByteCount();
+}
 
-	Vector3		currentPos			= object.GetTransform().GetPosition();
-	Quaternion  currentOrientation  = object.GetTransform().GetOrientation();
+bool ClientPacket::Read(ClientInput& input) const {
+	BitReader reader(data, size < MaxData ? size : MaxData);
+	input.playerID		= (int)reader.ReadVarInt() - 1;
+	input.acknowledged	= (int)reader.ReadVarInt() - 1;
+	input.inputSequence = (int)reader.ReadVarInt() - 1;
+	input.frameCount	= (int)reader.ReadBits(3);
+	input.frameCount	= input.frameCount > InputHistory ? InputHistory : input.frameCount;
+
+	uint32_t yaw	= 0;
+	uint32_t pitch	= 0;
+	for (int i = 0; i < input.frameCount; ++i) {
+		InputFrame& frame = input.frames[i];
+		if (i == 0) {
+			frame.buttons	= (short)reader.ReadBits(InputButtonBits);
+			yaw				= reader.ReadBits(AngleBits);
+			pitch			= reader.ReadBits(AngleBits);
+		}
+		else {
+			frame.buttons = reader.ReadBool() ? (short)reader.ReadBits(InputButtonBits) : input.frames[i - 1].buttons;
+			if (reader.ReadBool()) {
+				yaw = (yaw + reader.ReadSignedVarInt()) & 0xFFFF;
+			}
+			if (reader.ReadBool()) {
+				pitch = (pitch + reader.ReadSignedVarInt()) & 0xFFFF;
+			}
+		}
+		frame.yaw	= DequantiseAngle(yaw, false);
+		frame.pitch = DequantiseAngle(pitch, true);
+		ReadFire(reader, frame);
+	}
+	return !reader.HasOverflowed();
+}
 
-	currentPos			-= state.position;
-	currentOrientation  -= state.orientation;
+//Client objects recieve these packets
+bool NetworkObject::ReadDeltaPacket(DeltaPacket &p, int snapshotID) {
+	int objectID;
+	int fullID;
+	NetworkState fullState;
+	if (!p.ReadHeader(objectID, fullID) || !GetNetworkState(fullID, fullState)) {
+		deltaErrors++; //can't delta this frame
+		return false;
+	}
 
-	dp->pos[0] = (char)currentPos.x;
-	dp->pos[1] = (char)currentPos.y;
-	dp->pos[2] = (char)currentPos.z;
+	//The server won't send deltas against anything older from now on
+	UpdateStateHistory(fullID);
 
-	dp->orientation[0] = (char)(currentOrientation.x * 127.0f);
-	dp->orientation[1] = (char)(currentOrientation.y * 127.0f);
-	dp->orientation[2] = (char)(currentOrientation.z * 127.0f);
-	dp->orientation[3] = (char)(currentOrientation.w * 127.0f);
+	NetworkState state;
+	if (!p.Read(fullState, state)) {
+		deltaErrors++;
+		return false;
+	}
+	ApplyState(state, snapshotID);
 
-	*p = dp;
 	return true;
 }
 
-bool NetworkObject::WriteFullPacket(GamePacket**p) {
-	FullPacket* fp = new FullPacket();
+bool NetworkObject::ReadFullPacket(FullPacket &p, int snapshotID) {
+	int objectID;
+	int playerID;
+	NetworkState state;
+	if (!p.Read(objectID, playerID, state)) {
+		fullErrors++;
+		return false;
+	}
+	if (state.stateID < lastFullState.stateID) {
+		return false; // received an 'old' packet, ignore!
+	}
+	lastFullState = state;
+	ApplyState(lastFullState, snapshotID);
+
+	StoreNetworkState(lastFullState);
+
+	return true;
+}
+
+bool NetworkObject::WriteDeltaPacket(DeltaPacket& dp, int stateID) {
+	NetworkState state;
+	if (!GetNetworkState(stateID, state)) {
+		return false; //can't delta!
+	}
+	return dp.Write(networkID, state, lastFullState);
+}
 
-	Agent* a = dynamic_cast<Agent*>(&object);
+bool NetworkObject::WriteFullPacket(FullPacket& fp) {
+	int typeID = object.GetTypeID();
+	const NetworkTypes::Type& type = NetworkTypes::Get(typeID);
 
-	fp->playerID				= a ? a->GetID() : -1;
-	fp->objectID				= networkID;
-	fp->fullState.position		= object.GetTransform().GetPosition();
-	fp->fullState.orientation	= object.GetTransform().GetOrientation();
-	fp->fullState.stateID		= lastFullState.stateID++;
+	fp.Write(networkID, typeID, type.getPlayerID ? type.getPlayerID(object) : -1, lastFullState);
 
-	*p = fp;
+	//Keep hold of it, as clients that receive it will have deltas sent against it
+	StoreNetworkState(lastFullState);
 	return true;
 }
 
@@ -126,22 +355,30 @@ NetworkState& NetworkObject::GetLatestNetworkState() {
 }
 
 bool NetworkObject::GetNetworkState(int stateID, NetworkState& state) {
-	for (auto i = stateHistory.begin(); i < stateHistory.end(); ++i) {
-		if ((*i).stateID == stateID) {
-			state = (*i);
-			return true;
-		}
+	if (stateID < 0 || stateID < oldestStateID || stateHistory.empty()) {
+		return false;
+	}
+	const NetworkState& s = stateHistory[stateID % StateHistoryLength];
+	if (s.stateID != stateID) {
+		return false; //never had it, or it's been written over by a newer one
 	}
-	return false;
+	state = s;
+	return true;
 }
 
-void NetworkObject::UpdateStateHistory(int minID) {
-	for (auto i = stateHistory.begin(); i < stateHistory.end(); ) {
-		if ((*i).stateID < minID) {
-			i = stateHistory.erase(i);
-		}
-		else {
-			++i;
+void NetworkObject::StoreNetworkState(const NetworkState& state) {
+	if (state.stateID < 0) {
+		return;
+	}
+	if (stateHistory.empty()) {
+		stateHistory.resize(StateHistoryLength);
+		for (NetworkState& s : stateHistory) {
+			s.stateID = -1;
 		}
 	}
+	stateHistory[state.stateID % StateHistoryLength] = state;
+}
+
+void NetworkObject::UpdateStateHistory(int minID) {
+	oldestStateID = minID > oldestStateID ? minID : oldestStateID;
 }
\ No newline at end of file
@@ -2,44 +2,187 @@
 #include "GameObject.h"
 #include "NetworkBase.h"
 #include "NetworkState.h"
+#include "WorldHash.h"
+#include <deque>
 namespace NCL {
 	namespace CSC8503 {
 
+		//What a full state has in it besides the position, which is always there
+		namespace ReplicatedFields {
+			enum Field {
+				Orientation = 1 << 0,
+				PlayerID	= 1 << 1
+			};
+		}
+
+		//Writes and reads the fields after the object and type IDs, with
+		//the ones a type doesn't use compiled out
+		template <int Fields>
+		struct FullStateSerialiser {
+			static void Write(BitWriter& writer, int playerID, const NetworkState& state) {
+				if (Fields & ReplicatedFields::PlayerID) {
+					writer.WriteVarInt((uint32_t)(playerID + 1)); //-1 for anything that isn't a player yet
+				}
+				writer.WriteVarInt((uint32_t)state.stateID);
+				state.WritePosition(writer);
+				if (Fields & ReplicatedFields::Orientation) {
+					state.WriteOrientation(writer);
+				}
+			}
+
+			static void Read(BitReader& reader, int& playerID, NetworkState& state) {
+				playerID		= (Fields & ReplicatedFields::PlayerID) ? (int)reader.ReadVarInt() - 1 : -1;
+				state.stateID	= (int)reader.ReadVarInt();
+				state.ReadPosition(reader);
+				if (Fields & ReplicatedFields::Orientation) {
+					state.ReadOrientation(reader);
+				}
+				else {
+					state.orientation = Quaternion();
+				}
+			}
+		};
+
+		/*
+		What each kind of object sends, looked up by the type ID set with
+		GameObject::SetTypeID, so writing a snapshot never has to work out
+		what an object is. Types are registered once at startup by whatever
+		knows about them, and anything that isn't sends its orientation but
+		no player ID. The type goes in every full state, so the other end
+		can read it without knowing what the object is either.
+		*/
+		class NetworkTypes {
+		public:
+			static const int TypeBits = 4;
+			static const int MaxTypes = 1 << TypeBits; //anything past this is sent as type 0
+
+			typedef int		(*PlayerIDGetter)(const GameObject& o);
+			typedef void	(*FullWriter)(BitWriter& writer, int playerID, const NetworkState& state);
+			typedef void	(*FullReader)(BitReader& reader, int& playerID, NetworkState& state);
+
+			struct Type {
+				int				fields		= ReplicatedFields::Orientation;
+				PlayerIDGetter	getPlayerID = nullptr;
+				FullWriter		write		= &FullStateSerialiser<ReplicatedFields::Orientation>::Write;
+				FullReader		read		= &FullStateSerialiser<ReplicatedFields::Orientation>::Read;
+			};
+
+			template <int Fields>
+			static void Register(int typeID, PlayerIDGetter getPlayerID = nullptr) {
+				if (typeID <= 0 || typeID >= MaxTypes) {
+					return; //type 0 is what everything else falls back to, so stays as it is
+				}
+				Type& t			= types[typeID];
+				t.fields		= Fields;
+				t.getPlayerID	= (Fields & ReplicatedFields::PlayerID) ? getPlayerID : nullptr;
+				t.write			= &FullStateSerialiser<Fields>::Write;
+				t.read			= &FullStateSerialiser<Fields>::Read;
+			}
+
+			static int GetWireID(int typeID) {
+				return typeID > 0 && typeID < MaxTypes ? typeID : 0;
+			}
+
+			static const Type& Get(int typeID) {
+				return types[GetWireID(typeID)];
+			}
+
+		protected:
+			static Type types[MaxTypes];
+		};
+
+		/*
+		The state packets are bit packed - NetworkState covers how positions
+		and orientations are quantised. IDs are variable length, so the usual
+		small ones only take a byte each. size is however many bytes of data
+		were actually written.
+		*/
 		struct FullPacket : public GamePacket {
-			int		playerID = -1;
-			int		objectID = -1;
-			NetworkState fullState;
+			static const int MaxData = 24;
+
+			uint8_t data[MaxData];
 
 			FullPacket() {
 				type = Full_State;
-				size = sizeof(FullPacket) - sizeof(GamePacket);
+				size = 0;
 			}
+
+			//The player ID is only sent if the type has one
+			void Write(int objectID, int typeID, int playerID, const NetworkState& state);
+			bool Read(int& objectID, int& playerID, NetworkState& state) const;
 		};
 
+		//Position is sent relative to the baseline, and either part is left
+		//out entirely if it hasn't changed since then
 		struct DeltaPacket : public GamePacket {
-			int		fullID		= -1;
-			int		objectID	= -1;
-			char	pos[3];
-			char	orientation[4];
+			static const int MaxData = 24;
+
+			uint8_t data[MaxData];
 
 			DeltaPacket() {
 				type = Delta_State;
-				size = sizeof(DeltaPacket) - sizeof(GamePacket);
+				size = 0;
 			}
+
+			//Returns false if it won't fit, in which case send a full state
+			bool Write(int objectID, const NetworkState& baseline, const NetworkState& state);
+			bool ReadHeader(int& objectID, int& fullID) const;
+			bool Read(const NetworkState& baseline, NetworkState& state) const;
 		};
 
-		struct ClientPacket : public GamePacket {
-			int		playerID = -1;
-			int		prevPacketID = -1;
-			float	position[3];
-			float	orientation[4];
-			float	pitch;
-			float	yaw;
+		/*
+		Clients send their input rather than where they are, and the server
+		moves their player for them. This is one tick of it.
+		*/
+		struct InputFrame {
+			short	buttons = 0;
+			float	pitch = 0.0f;
+			float	yaw = 0.0f;
 			int		firingInfo = -1;
+			float	viewSnapshot = -1.0f;		//the snapshot being drawn, so shots can be checked against what the client saw
+		};
+
+		/*
+		Every client packet carries the last few input frames, newest first,
+		so the server can pick up whatever was in the ones that went missing
+		- shots included - without anything having to be sent reliably.
+		Each frame after the first is sent as what changed from the one
+		before it, which is usually nothing, so the older ones cost a few
+		bits each. Pitch and yaw go as 16 bit fractions of a turn.
+		*/
+		struct ClientInput {
+			static const int InputHistory = 4;
+
+			int			playerID = -1;
+			int			acknowledged = -1;		//the newest snapshot the client has
+			int			inputSequence = -1;		//of frames[0], each one after is the tick before
+			int			frameCount = 0;
+			InputFrame	frames[InputHistory];
+		};
+
+		struct ClientPacket : public GamePacket {
+			static const int InputHistory = ClientInput::InputHistory;
+			static const int MaxData = 64;
+
+			uint8_t data[MaxData];
 
 			ClientPacket() {
 				type = Received_State;
-				size = sizeof(ClientPacket);
+				size = 0;
+			}
+
+			void Write(const ClientInput& input);
+			bool Read(ClientInput& input) const;
+		};
+
+		struct PlayerStatePacket : public GamePacket {
+			int		inputSequence = -1; //the newest input the server has applied
+			float	position[3];
+			float	velocity[3];
+
+			PlayerStatePacket() {
+				type = Player_State;
+				size = sizeof(PlayerStatePacket) - sizeof(GamePacket);
 			}
 		};
 
@@ -90,28 +233,195 @@ namespace NCL {
 			}
 		};
 
+		//Sent last in every snapshot, so the client knows which one it's up to
 		struct GameTimerPacket : public GamePacket {
-			float gameTime;
+			float	gameTime;
+			int		snapshotID;
 
-			GameTimerPacket(float gt) {
+			GameTimerPacket(float gt, int snapshot = -1) {
 				type = Game_Timer;
 				gameTime = gt;
-				size = sizeof(GameTimerPacket);
+				snapshotID = snapshot;
+				size = sizeof(GameTimerPacket) - sizeof(GamePacket);
+			}
+		};
+
+		/*
+		Packs as many packets as will fit into one, so a whole snapshot goes
+		out as a single ENet packet (or a few, for a busy world), rather than
+		one per object. The payload is kept small enough that each one fits
+		in a single datagram without ENet having to fragment it.
+
+		Packets are placed on 8 byte boundaries, so they can be read straight
+		out of the buffer at the other end.
+		*/
+		struct SnapshotPacket : public GamePacket {
+			static const int MaxPayload = 1192;
+
+			int				packetCount;
+			int				snapshotID = -1; //so clients know which snapshot deltas arrived in
+			int				xorBaseID = -1;	//the snapshot the data's been XORed against, if any
+			alignas(8) char	data[MaxPayload];
+
+			SnapshotPacket() {
+				type = Snapshot_State;
+				Clear();
+			}
+
+			//Everything between the GamePacket header and the data, which is
+			//last and a multiple of 8 bytes, so there's no padding after it
+			static int HeaderSize() {
+				return (int)(sizeof(SnapshotPacket) - sizeof(GamePacket) - MaxPayload);
+			}
+
+			void Clear() {
+				packetCount = 0;
+				xorBaseID	= -1;
+				size		= (short)HeaderSize();
+			}
+
+			bool IsEmpty() const {
+				return packetCount == 0;
+			}
+
+			//The most room p can take up once appended, padding included
+			static int SpaceFor(const GamePacket& p) {
+				return (p.GetTotalSize() + 7) & ~7;
+			}
+
+			//Doing it twice with the same base gives back what was there before.
+			//Anything past the end of the shorter one is left as it is
+			void XorWith(const SnapshotPacket& base) {
+				int used		= size - HeaderSize();
+				int baseUsed	= base.size - HeaderSize();
+				int count		= used < baseUsed ? used : baseUsed;
+				for (int i = 0; i < count; ++i) {
+					data[i] ^= base.data[i];
+				}
+			}
+
+			//Returns false if there's no room left for the packet
+			bool Append(const GamePacket& p) {
+				int used	= size - HeaderSize();
+				int start	= (used + 7) & ~7;
+				int length	= p.GetTotalSize();
+				if (start + length > MaxPayload) {
+					return false;
+				}
+				memcpy(data + start, &p, length);
+				size = (short)(HeaderSize() + start + length);
+				packetCount++;
+				return true;
+			}
+
+			//Calls func for each packet inside, stopping at anything malformed
+			template <class F>
+			void ForEachPacket(F&& func) const {
+				int used	= size - HeaderSize();
+				int offset	= 0;
+				for (int i = 0; i < packetCount; ++i) {
+					offset = (offset + 7) & ~7;
+					if (offset + (int)sizeof(GamePacket) > used) {
+						return;
+					}
+					const GamePacket* p = (const GamePacket*)(data + offset);
+					int length = p->GetTotalSize();
+					if (p->size < 0 || offset + length > used) {
+						return;
+					}
+					func(*p);
+					offset += length;
+				}
 			}
 		};
 
-		class NetworkObject		{
+		//Packed like a snapshot, but as it's all events it goes reliably
+		struct EventBatchPacket : public SnapshotPacket {
+			EventBatchPacket() {
+				type = Event_Batch;
+			}
+		};
+
+		/*
+		Everything a client joining part way through a match needs to catch
+		up on, bit packed, as there can be hundreds of blocks to send. Each
+		packet stands on its own, so any number of them can be sent, and
+		records go until an End. IDs are sent as the gap from the one before,
+		so going through objects in ID order keeps them to a byte or so.
+		*/
+		struct WorldStatePacket : public GamePacket {
+			static const int MaxData		= SnapshotPacket::MaxPayload;
+			static const int MaxRecordBytes = 24; //the biggest record, a projectile, and then some
+
+			enum Record {
+				Block,		//ID, coloured, RGBA at 8 bits each
+				Refill,		//ID, available
+				Projectile, //ID, full position, RGBA at 8 bits each
+				End
+			};
+			static const int RecordBits = 2;
+
+			uint8_t data[MaxData];
+
+			WorldStatePacket() {
+				type = World_State;
+				size = 0;
+			}
+		};
+
+		//Only covers what a client wouldn't otherwise hear about again - the
+		//blocks and refill points - as everything that moves is in every snapshot
+		struct WorldHashPacket : public GamePacket {
+			uint32_t buckets[WorldHash::Buckets];
+
+			WorldHashPacket() {
+				type = World_Hash;
+				size = sizeof(WorldHashPacket) - sizeof(GamePacket);
+			}
+		};
+
+		struct ResyncRequestPacket : public GamePacket {
+			int			playerID = -1;
+			uint32_t	buckets = 0; //a bit for each WorldHash bucket that didn't match
+
+			ResyncRequestPacket() {
+				type = Resync_Request;
+				size = sizeof(ResyncRequestPacket) - sizeof(GamePacket);
+			}
+		};
+
+		class NetworkObject : public PooledObject {
 		public:
 			NetworkObject(GameObject& o, int id);
 			virtual ~NetworkObject();
 
-			//Called by clients
-			virtual bool ReadPacket(GamePacket& p);
-			//Called by servers
-			virtual bool WritePacket(GamePacket** p, bool deltaFrame, int stateID);
-
+			//Called by clients. States that arrive as part of a snapshot are
+			//buffered, to be applied by UpdateInterpolation, and anything else
+			//is applied straight away
+			virtual bool ReadPacket(GamePacket& p, int snapshotID = -1);
+
+			/*
+			Moves the object to where it was at renderSnapshot, which can fall
+			between snapshots. If nothing that new has arrived yet, it carries
+			on at its last known velocity for up to maxExtrapolation snapshots.
+			*/
+			void UpdateInterpolation(float renderSnapshot, float maxExtrapolation);
+			//Called by servers. Deltas are against the full state with the
+			//given ID, falling back to a full packet if that's not possible.
+			//Fills in whichever of the two packets was used, and returns it
+			virtual GamePacket* WritePacket(FullPacket& full, DeltaPacket& delta, bool deltaFrame, int stateID);
+
+			//Called by servers at the start of each snapshot, so that every
+			//client is sent the same state for it
+			void SetSnapshot(int stateID);
+
+			//Drops every state older than minID, so nothing's sent or read as a delta against them
 			void UpdateStateHistory(int minID);
 
+			//Enough for a state to still be here for as long as anything can be
+			//sent as a delta against it - a little over 4 seconds at 30Hz
+			static const int StateHistoryLength = 128;
+
 			void SetNetworkID(int id) {
 				networkID = id;
 			}
@@ -129,18 +439,30 @@ namespace NCL {
 			NetworkState& GetLatestNetworkState();
 
 			bool GetNetworkState(int frameID, NetworkState& state);
+			void StoreNetworkState(const NetworkState& state);
+
+			virtual bool ReadDeltaPacket(DeltaPacket &p, int snapshotID);
+			virtual bool ReadFullPacket(FullPacket &p, int snapshotID);
 
-			virtual bool ReadDeltaPacket(DeltaPacket &p);
-			virtual bool ReadFullPacket(FullPacket &p);
+			virtual bool WriteDeltaPacket(DeltaPacket& p, int stateID);
+			virtual bool WriteFullPacket(FullPacket& p);
 
-			virtual bool WriteDeltaPacket(GamePacket**p, int stateID);
-			virtual bool WriteFullPacket(GamePacket**p);
+			void ApplyState(const NetworkState& state, int snapshotID);
+
+			static const int MaxInterpolationStates = 32;
 
 			GameObject& object;
 
 			NetworkState lastFullState;
 
+			//Indexed by stateID % StateHistoryLength, and only made once there's
+			//something to put in it. A slot holding some other ID is empty
 			std::vector<NetworkState> stateHistory;
+			int oldestStateID; //anything older has been dropped, even if it's still in there
+
+			std::deque<NetworkState> interpolationStates; //oldest first, IDs are the snapshot they arrived in
+			NetworkState	previousState; //the last one dropped from the buffer, for extrapolating
+			bool			hasPreviousState;
 
 			int deltaErrors;
 			int fullErrors;
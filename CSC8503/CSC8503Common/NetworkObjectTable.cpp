@@ -0,0 +1,55 @@
+#include "NetworkObjectTable.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+int NetworkObjectTable::Allocate() {
+	if (!freeSlots.empty()) {
+		int index = freeSlots.front();
+		freeSlots.pop_front();
+		return MakeHandle(index, generations[index]);
+	}
+	int index = (int)objects.size();
+	if (index >= MaxObjects) {
+		return -1;
+	}
+	Grow(index);
+	return MakeHandle(index, 0);
+}
+
+void NetworkObjectTable::Insert(int handle, NetworkObject* o) {
+	if (handle < 0) {
+		return;
+	}
+	int index = handle & (MaxObjects - 1);
+	Grow(index);
+	objects[index]		= o;
+	generations[index]	= handle >> IndexBits;
+}
+
+/*
+Handles that were already released, or never handed out, are ignored, so
+it's safe to call this for a destroy message that arrives twice.
+*/
+void NetworkObjectTable::Release(int handle) {
+	int index = handle & (MaxObjects - 1);
+	if (handle < 0 || index >= (int)objects.size() || generations[index] != (handle >> IndexBits)) {
+		return;
+	}
+	objects[index]		= nullptr;
+	generations[index]	= (generations[index] + 1) & ((1 << GenerationBits) - 1);
+	freeSlots.push_back(index);
+}
+
+void NetworkObjectTable::Clear() {
+	objects.clear();
+	generations.clear();
+	freeSlots.clear();
+}
+
+void NetworkObjectTable::Grow(int index) {
+	if (index >= (int)objects.size()) {
+		objects.resize(index + 1, nullptr);
+		generations.resize(index + 1, 0);
+	}
+}
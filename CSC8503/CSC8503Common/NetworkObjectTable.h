@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <deque>
+
+namespace NCL {
+	namespace CSC8503 {
+		class NetworkObject;
+
+		/*
+		Network IDs are handles into a flat array of slots - the low bits are
+		the slot, and the rest count how many times that slot has been reused.
+		A packet for an object that's since been destroyed will have an old
+		generation, so it finds nothing, rather than whatever's in the slot now.
+
+		Freed slots go to the back of the queue, so a slot isn't handed out
+		again until every other free one has been, which keeps old handles
+		from wrapping round to match a new object.
+		*/
+		class NetworkObjectTable {
+		public:
+			static const int IndexBits		= 12;
+			static const int GenerationBits = 4;
+			static const int MaxObjects		= 1 << IndexBits;
+
+			NetworkObjectTable() {}
+			~NetworkObjectTable() {}
+
+			//Hands out an unused handle, or -1 if every slot is taken
+			int Allocate();
+
+			//Puts an object at a handle chosen elsewhere (by the server, for a client)
+			void Insert(int handle, NetworkObject* o);
+
+			//Empties the slot, and lets Allocate reuse it under a new generation
+			void Release(int handle);
+
+			NetworkObject* Get(int handle) const {
+				int index = handle & (MaxObjects - 1);
+				if (handle < 0 || index >= (int)objects.size()) {
+					return nullptr;
+				}
+				return generations[index] == (handle >> IndexBits) ? objects[index] : nullptr;
+			}
+
+			void Clear();
+
+			//Indexed by slot, so some of these will be null
+			const std::vector<NetworkObject*>& GetObjects() const {
+				return objects;
+			}
+
+		protected:
+			static int MakeHandle(int index, int generation) {
+				return index | (generation << IndexBits);
+			}
+
+			void Grow(int index);
+
+			std::vector<NetworkObject*> objects;
+			std::vector<int>			generations;
+			std::deque<int>				freeSlots;
+		};
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <deque>
+#include <random>
+#include <chrono>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		What a simulated connection should be like. Everything defaults to a
+		perfect link, which turns the simulation off altogether.
+		*/
+		struct NetworkConditions {
+			float latency		= 0.0f; //milliseconds, each way
+			float jitter		= 0.0f; //milliseconds, up to this much extra on top
+			float loss			= 0.0f; //chance of a packet going missing
+			float duplication	= 0.0f; //chance of a packet arriving twice
+			float bandwidth		= 0.0f; //bytes per second, or 0 for no limit
+
+			bool IsActive() const {
+				return latency > 0.0f || jitter > 0.0f || loss > 0.0f || duplication > 0.0f || bandwidth > 0.0f;
+			}
+		};
+
+		/*
+		Holds on to whatever's gone through one direction of a link until the
+		conditions say it would have arrived. Things come out in the order
+		they went in, as ENet wouldn't hand over sequenced packets out of
+		order anyway, so jitter shows up as packets bunching together.
+		Bandwidth is modelled as each item taking up the link for as long as
+		its bytes take to go through, with anything behind it waiting.
+		*/
+		template <typename T>
+		class NetworkSimulator {
+		public:
+			NetworkSimulator() : random(std::random_device()()) {
+			}
+
+			void SetConditions(const NetworkConditions& c) {
+				conditions = c;
+			}
+
+			const NetworkConditions& GetConditions() const {
+				return conditions;
+			}
+
+			bool IsActive() const {
+				return conditions.IsActive();
+			}
+
+			//How many copies of something should be pushed - 0 if it's lost,
+			//or 2 if it's duplicated. Anything that mustn't be lost always gets one
+			int GetCopies(bool canLose) {
+				if (!canLose) {
+					return 1;
+				}
+				if (Chance() < conditions.loss) {
+					return 0;
+				}
+				return Chance() < conditions.duplication ? 2 : 1;
+			}
+
+			void Push(const T& item, int bytes) {
+				double now		= Now();
+				double start	= now > linkFree ? now : linkFree;
+				linkFree = conditions.bandwidth > 0.0f ? start + (double)bytes / conditions.bandwidth : now;
+
+				double release = linkFree + (conditions.latency + Chance() * conditions.jitter) / 1000.0;
+				if (release < lastRelease) {
+					release = lastRelease;
+				}
+				lastRelease = release;
+				queue.push_back({ release, item });
+			}
+
+			//Only gives back things that would have arrived by now
+			bool Pop(T& item) {
+				if (queue.empty() || queue.front().releaseTime > Now()) {
+					return false;
+				}
+				item = queue.front().item;
+				queue.pop_front();
+				return true;
+			}
+
+			//Ignores the timing, for emptying it out when shutting down
+			bool PopAny(T& item) {
+				if (queue.empty()) {
+					return false;
+				}
+				item = queue.front().item;
+				queue.pop_front();
+				return true;
+			}
+
+		protected:
+			struct Entry {
+				double	releaseTime;
+				T		item;
+			};
+
+			static double Now() {
+				return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			float Chance() {
+				return std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+			}
+
+			NetworkConditions	conditions;
+			std::deque<Entry>	queue;
+			std::mt19937		random;
+			double				linkFree	= 0.0;
+			double				lastRelease = 0.0;
+		};
+	}
+}
@@ -1,11 +1,140 @@
 #include "NetworkState.h"
+#include <cmath>
 
 using namespace NCL;
 using namespace CSC8503;
 
+Vector3 NetworkState::boundsMin			= Vector3(-512, -512, -512);
+Vector3 NetworkState::boundsMax			= Vector3(512, 512, 512);
+int		NetworkState::positionBits		= 18;
+int		NetworkState::orientationBits	= 10;
+
+//The range of the three smallest components of a unit quaternion
+const float SmallestThreeRange = 0.70710678f;
+
 NetworkState::NetworkState()	{
 	stateID = 0;
 }
 
 NetworkState::~NetworkState()	{
-}
\ No newline at end of file
+}
+
+void NetworkState::SetQuantisation(const Vector3& minBounds, const Vector3& maxBounds, int posBits, int oriBits) {
+	boundsMin		= minBounds;
+	boundsMax		= maxBounds;
+	positionBits	= posBits;
+	orientationBits = oriBits;
+}
+
+void NetworkState::Quantise() {
+	uint32_t q[3];
+	QuantisePosition(position, q);
+	position = DequantisePosition(q);
+
+	uint8_t		buffer[8];
+	BitWriter	writer(buffer, sizeof(buffer));
+	WriteOrientation(writer);
+	BitReader	reader(buffer, sizeof(buffer));
+	ReadOrientation(reader);
+}
+
+void NetworkState::QuantisePosition(const Vector3& p, uint32_t q[3]) {
+	float steps = (float)((1u << positionBits) - 1);
+	for (int i = 0; i < 3; ++i) {
+		float t = (p[i] - boundsMin[i]) / (boundsMax[i] - boundsMin[i]);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t); //anything outside the level just sticks to the edge
+		q[i] = (uint32_t)(t * steps + 0.5f);
+	}
+}
+
+Vector3 NetworkState::DequantisePosition(const uint32_t q[3]) {
+	float steps = (float)((1u << positionBits) - 1);
+	Vector3 p;
+	for (int i = 0; i < 3; ++i) {
+		p[i] = boundsMin[i] + (boundsMax[i] - boundsMin[i]) * ((float)q[i] / steps);
+	}
+	return p;
+}
+
+void NetworkState::WritePosition(BitWriter& writer) const {
+	uint32_t q[3];
+	QuantisePosition(position, q);
+	for (int i = 0; i < 3; ++i) {
+		writer.WriteBits(q[i], positionBits);
+	}
+}
+
+void NetworkState::ReadPosition(BitReader& reader) {
+	uint32_t q[3];
+	for (int i = 0; i < 3; ++i) {
+		q[i] = reader.ReadBits(positionBits);
+	}
+	position = DequantisePosition(q);
+}
+
+void NetworkState::WritePositionDelta(BitWriter& writer, const NetworkState& baseline) const {
+	uint32_t q[3];
+	uint32_t b[3];
+	QuantisePosition(position, q);
+	QuantisePosition(baseline.position, b);
+	for (int i = 0; i < 3; ++i) {
+		writer.WriteSignedVarInt((int32_t)q[i] - (int32_t)b[i]);
+	}
+}
+
+void NetworkState::ReadPositionDelta(BitReader& reader, const NetworkState& baseline) {
+	uint32_t q[3];
+	QuantisePosition(baseline.position, q);
+	uint32_t maxValue = (1u << positionBits) - 1;
+	for (int i = 0; i < 3; ++i) {
+		int32_t value = (int32_t)q[i] + reader.ReadSignedVarInt();
+		q[i] = value < 0 ? 0 : ((uint32_t)value > maxValue ? maxValue : (uint32_t)value);
+	}
+	position = DequantisePosition(q);
+}
+
+/*
+q and -q are the same rotation, so the largest component can always be made
+positive, and then only needs its index sending.
+*/
+void NetworkState::WriteOrientation(BitWriter& writer) const {
+	float c[4] = { orientation.x, orientation.y, orientation.z, orientation.w };
+
+	int largest = 0;
+	for (int i = 1; i < 4; ++i) {
+		if (fabs(c[i]) > fabs(c[largest])) {
+			largest = i;
+		}
+	}
+	float sign	= c[largest] < 0.0f ? -1.0f : 1.0f;
+	float steps = (float)((1u << orientationBits) - 1);
+
+	writer.WriteBits(largest, 2);
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float t = (c[i] * sign + SmallestThreeRange) / (SmallestThreeRange * 2.0f);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		writer.WriteBits((uint32_t)(t * steps + 0.5f), orientationBits);
+	}
+}
+
+void NetworkState::ReadOrientation(BitReader& reader) {
+	float c[4];
+	float steps	= (float)((1u << orientationBits) - 1);
+	int largest	= (int)reader.ReadBits(2);
+	float sum	= 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float t = (float)reader.ReadBits(orientationBits) / steps;
+		c[i] = t * SmallestThreeRange * 2.0f - SmallestThreeRange;
+		sum += c[i] * c[i];
+	}
+	c[largest] = sum < 1.0f ? sqrt(1.0f - sum) : 0.0f;
+
+	orientation = Quaternion(c[0], c[1], c[2], c[3]);
+	orientation.Normalise();
+}
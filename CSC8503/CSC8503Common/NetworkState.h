@@ -1,6 +1,7 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Quaternion.h"
+#include "BitStream.h"
 
 namespace NCL {
 	using namespace Maths;
@@ -11,10 +12,41 @@ namespace NCL {
 			NetworkState();
 			virtual ~NetworkState();
 
+			/*
+			Positions go over the network as fixed point values within the
+			level's bounds, using positionBits per axis. Orientations send only
+			their three smallest components, as the largest can be rebuilt
+			from the fact that they're unit length.
+			*/
+			static void SetQuantisation(const Vector3& minBounds, const Vector3& maxBounds, int posBits = 18, int oriBits = 10);
+
+			//Snaps the state to exactly what will arrive at the other end, so
+			//the server and clients agree on it when it's used as a baseline
+			void Quantise();
+
+			void WritePosition(BitWriter& writer) const;
+			void ReadPosition(BitReader& reader);
+
+			//Only the difference in quantised units is sent, so objects that
+			//have barely moved since the baseline take a few bits per axis
+			void WritePositionDelta(BitWriter& writer, const NetworkState& baseline) const;
+			void ReadPositionDelta(BitReader& reader, const NetworkState& baseline);
+
+			void WriteOrientation(BitWriter& writer) const;
+			void ReadOrientation(BitReader& reader);
+
 			Vector3		position;
 			Quaternion	orientation;
 			int			stateID;
+
+		protected:
+			static void		QuantisePosition(const Vector3& p, uint32_t q[3]);
+			static Vector3	DequantisePosition(const uint32_t q[3]);
+
+			static Vector3	boundsMin;
+			static Vector3	boundsMax;
+			static int		positionBits;
+			static int		orientationBits;
 		};
 	}
 }
-
@@ -0,0 +1,91 @@
+#include "NetworkStatistics.h"
+#include <fstream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+void NetworkStatistics::RecordIncoming(int peer, int msgID, int bytes) {
+	Traffic* counters[] = { &total, &peers[peer].traffic, msgID >= 0 && msgID < MessageSlots ? &messages[msgID] : nullptr };
+	for (Traffic* t : counters) {
+		if (t) {
+			t->bytesIn += bytes;
+			t->packetsIn++;
+		}
+	}
+}
+
+void NetworkStatistics::RecordOutgoing(int peer, int msgID, int bytes) {
+	Traffic* counters[] = { &total, &peers[peer].traffic, msgID >= 0 && msgID < MessageSlots ? &messages[msgID] : nullptr };
+	for (Traffic* t : counters) {
+		if (t) {
+			t->bytesOut += bytes;
+			t->packetsOut++;
+		}
+	}
+}
+
+void NetworkStatistics::RecordSnapshot(int bytes) {
+	int bucket = bytes / SnapshotBucketSize;
+	snapshotSizes[bucket < SnapshotBuckets ? bucket : SnapshotBuckets - 1]++;
+	snapshotCount++;
+}
+
+//ENet's totals are only 32 bits, so it's the difference since last time that's added on
+void NetworkStatistics::SetWireTotals(uint32_t sent, uint32_t received) {
+	if (wireStarted) {
+		wireBytesOut	+= (uint32_t)(sent - lastWireSent);
+		wireBytesIn		+= (uint32_t)(received - lastWireReceived);
+	}
+	wireStarted			= true;
+	lastWireSent		= sent;
+	lastWireReceived	= received;
+}
+
+void NetworkStatistics::Update(float dt) {
+	rateTimer += dt;
+	if (rateTimer < 1.0f) {
+		return;
+	}
+	bytesInRate		= (float)(total.bytesIn - lastBytesIn) / rateTimer;
+	bytesOutRate	= (float)(total.bytesOut - lastBytesOut) / rateTimer;
+	lastBytesIn		= total.bytesIn;
+	lastBytesOut	= total.bytesOut;
+	wireInRate		= (float)(wireBytesIn - lastWireIn) / rateTimer;
+	wireOutRate		= (float)(wireBytesOut - lastWireOut) / rateTimer;
+	lastWireIn		= wireBytesIn;
+	lastWireOut		= wireBytesOut;
+	rateTimer		= 0.0f;
+}
+
+void NetworkStatistics::Reset() {
+	*this = NetworkStatistics();
+}
+
+bool NetworkStatistics::ExportCSV(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+	file << "category,id,bytes_in,bytes_out,packets_in,packets_out,rtt_ms,packet_loss\n";
+	for (int i = 0; i < MessageSlots; ++i) {
+		const Traffic& t = messages[i];
+		if (t.packetsIn || t.packetsOut) {
+			file << "message," << i << "," << t.bytesIn << "," << t.bytesOut << "," << t.packetsIn << "," << t.packetsOut << ",,\n";
+		}
+	}
+	for (const auto& p : peers) {
+		const Traffic& t = p.second.traffic;
+		file << "peer," << p.first << "," << t.bytesIn << "," << t.bytesOut << "," << t.packetsIn << "," << t.packetsOut
+			<< "," << p.second.roundTripTime << "," << p.second.packetLoss << "\n";
+	}
+	file << "total,," << total.bytesIn << "," << total.bytesOut << "," << total.packetsIn << "," << total.packetsOut << ",,\n";
+	file << "wire,," << wireBytesIn << "," << wireBytesOut << ",,,,\n";
+
+	file << "\nsnapshot_bytes,count\n";
+	for (int i = 0; i < SnapshotBuckets; ++i) {
+		file << i * SnapshotBucketSize << (i == SnapshotBuckets - 1 ? "+" : "") << "," << snapshotSizes[i] << "\n";
+	}
+	file << "\ndelta_states,full_states,delta_hit_rate\n";
+	file << deltaStates << "," << fullStates << "," << GetDeltaHitRate() << "\n";
+	return true;
+}
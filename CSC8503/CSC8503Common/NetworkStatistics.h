@@ -0,0 +1,112 @@
+#pragma once
+#include <map>
+#include <string>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Counts what goes over the network, by message type and by peer, so
+		the send rates and packing can be tuned against real numbers. Only
+		updated and read from the game thread. Rates are worked out once a
+		second from the totals, so they don't flicker about in the debug UI.
+		*/
+		class NetworkStatistics {
+		public:
+			static const int MessageSlots	= 32;
+			static const int SnapshotBuckets	= 10;
+			static const int SnapshotBucketSize = 128; //bytes, with the last bucket taking anything bigger
+			static const int BroadcastPeer		= -1;  //sends to everyone aren't split up by peer
+
+			struct Traffic {
+				uint64_t bytesIn	= 0;
+				uint64_t bytesOut	= 0;
+				uint64_t packetsIn	= 0;
+				uint64_t packetsOut = 0;
+			};
+
+			struct PeerStatistics {
+				Traffic traffic;
+				float	roundTripTime	= 0.0f; //milliseconds
+				float	packetLoss		= 0.0f; //fraction of packets ENet thinks were lost
+			};
+
+			NetworkStatistics() {}
+			~NetworkStatistics() {}
+
+			void RecordIncoming(int peer, int msgID, int bytes);
+			void RecordOutgoing(int peer, int msgID, int bytes);
+
+			void RecordSnapshot(int bytes);
+			void RecordObjectState(bool delta) {
+				delta ? deltaStates++ : fullStates++;
+			}
+
+			//ENet's own running totals, which are what actually went over the
+			//wire - after compression, and with its headers and acks included
+			void SetWireTotals(uint32_t sent, uint32_t received);
+
+			void SetPeerConnection(int peer, float roundTripTime, float packetLoss) {
+				PeerStatistics& p = peers[peer];
+				p.roundTripTime = roundTripTime;
+				p.packetLoss	= packetLoss;
+			}
+
+			//Once they've gone, so a long running server doesn't report everyone it's ever had
+			void RemovePeer(int peer) {
+				peers.erase(peer);
+			}
+
+			void Update(float dt);
+			void Reset();
+
+			//One row per message type and per peer, with every counter
+			bool ExportCSV(const std::string& filename) const;
+
+			const Traffic& GetTotal() const { return total; }
+			const Traffic& GetMessageTraffic(int msgID) const { return messages[msgID]; }
+			const std::map<int, PeerStatistics>& GetPeers() const { return peers; }
+
+			float GetBytesInPerSecond() const { return bytesInRate; }
+			float GetBytesOutPerSecond() const { return bytesOutRate; }
+
+			float GetWireBytesInPerSecond() const { return wireInRate; }
+			float GetWireBytesOutPerSecond() const { return wireOutRate; }
+
+			const int* GetSnapshotSizes() const { return snapshotSizes; }
+			int GetSnapshotCount() const { return snapshotCount; }
+
+			//How many of the object states sent went as deltas, rather than in full
+			float GetDeltaHitRate() const {
+				uint64_t states = deltaStates + fullStates;
+				return states ? (float)deltaStates / (float)states : 0.0f;
+			}
+
+		protected:
+			Traffic							total;
+			Traffic							messages[MessageSlots];
+			std::map<int, PeerStatistics>	peers;
+
+			int			snapshotSizes[SnapshotBuckets] = {};
+			int			snapshotCount	= 0;
+			uint64_t	deltaStates		= 0;
+			uint64_t	fullStates		= 0;
+
+			float		rateTimer		= 0.0f;
+			uint64_t	lastBytesIn		= 0;
+			uint64_t	lastBytesOut	= 0;
+			float		bytesInRate		= 0.0f;
+			float		bytesOutRate	= 0.0f;
+
+			bool		wireStarted		= false;
+			uint32_t	lastWireSent	= 0;
+			uint32_t	lastWireReceived = 0;
+			uint64_t	wireBytesIn		= 0;
+			uint64_t	wireBytesOut	= 0;
+			uint64_t	lastWireIn		= 0;
+			uint64_t	lastWireOut		= 0;
+			float		wireInRate		= 0.0f;
+			float		wireOutRate		= 0.0f;
+		};
+	}
+}
@@ -1,16 +1,18 @@
 #pragma once
 #include "../../Common/Vector2.h"
 #include "../CSC8503Common/CollisionDetection.h"
+#include "Frustum.h"
 #include "Debug.h"
-#include <list>
+#include <vector>
 #include <functional>
+#include <ostream>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
 
 namespace NCL {
 	using namespace NCL::Maths;
 	namespace CSC8503 {
-		template<class T>
-		class Octree;
-
 		template<class T>
 		struct OctreeEntry {
 			Vector3 pos;
@@ -24,145 +26,670 @@ namespace NCL {
 			}
 		};
 
+		/*
+		Nodes live in one flat array, and a split node's 8 children are always
+		next to each other in it, so only the index of the first is stored.
+		Nodes don't own their contents - they point at a range of indices into
+		the tree's entry array. The size kept is the node's loose bounds, which
+		is what everything inside it fits within, and what queries test.
+		*/
+		struct OctreeNode {
+			Vector3 position;
+			Vector3 size;
+
+			int firstChild; //-1 for leaves
+			int firstItem;	//split nodes have items too, for anything too big for a child
+			int itemCount;
+
+			OctreeNode(const Vector3& pos, const Vector3& size) {
+				position	= pos;
+				this->size	= size;
+				firstChild	= -1;
+				firstItem	= 0;
+				itemCount	= 0;
+			}
+		};
+
+		//How far a tree's allowed to split - a node with more than maxSize entries
+		//is split, unless it's already maxDepth levels down
+		struct OctreeSettings {
+			int maxDepth	= 7;
+			int maxSize		= 6;
+		};
+
+		/*
+		What a built tree looks like, for tuning its settings against a level.
+		Leaves are counted by how many entries they hold, with the last bucket
+		taking everything from OccupancyBuckets - 1 up. Split nodes only hold
+		what's too big for their children, so lots of those means the level's
+		objects are big next to the tree's cells, and lots of overfull leaves
+		means maxDepth is what stopped the splitting, not maxSize.
+		*/
+		struct OctreeStats {
+			static const int OccupancyBuckets = 16;
+
+			int nodes			= 0;
+			int leaves			= 0;
+			int emptyLeaves		= 0;
+			int entries			= 0;
+			int splitNodeItems	= 0;	//entries held by nodes that have children
+			int overfullLeaves	= 0;	//leaves past maxSize, as they're at maxDepth
+			int duplicates		= 0;	//entries held by more than one node, which a loose tree never should
+			int depthReached	= 0;
+			int occupancy[OccupancyBuckets] = {};
+		};
+
+		//Totals over every query since the last reset, of any kind
+		struct OctreeQueryStats {
+			uint64_t queries		= 0;
+			uint64_t nodesVisited	= 0;
+			uint64_t entriesTested	= 0;
+		};
+
+		/*
+		A loose octree - each node's bounds are twice the size of the space it
+		covers, so every entry can be kept in exactly one node, the deepest one
+		it's small enough for, rather than copied into every leaf it overlaps.
+		The root is fitted around whatever's been inserted when the tree is
+		built, so there's no fixed world size for objects to fall outside of.
+
+		Entries are collected by Insert, and the nodes are then built in one go,
+		either by calling Build, or by the first query afterwards. Clear resets
+		everything but keeps the memory, so rebuilding a level doesn't go back
+		to the allocator for every node.
+		*/
 		template<class T>
-		class OctreeNode {
+		class Octree
+		{
 		public:
-			typedef std::function<void(std::list<OctreeEntry<T>>&)> OctTreeFunc;
-		protected:
-			friend class Octree<T>;
+			typedef std::function<void(const OctreeEntry<T>&)> OctTreeFunc;
 
-			OctreeNode() {}
+			static constexpr float LooseFactor = 2.0f;
 
-			OctreeNode(Vector3 pos, Vector3 size) {
-				children		= nullptr;
-				this->position	= pos;
-				this->size		= size;
+			Octree(int maxDepth = 6, int maxSize = 5){
+				this->maxDepth	= maxDepth;
+				this->maxSize	= maxSize;
+				Clear();
+			}
+			Octree(const OctreeSettings& settings) : Octree(settings.maxDepth, settings.maxSize) {
+			}
+			~Octree() {
 			}
 
-			~OctreeNode() {
-				delete[] children;
+			//The nodes are rebuilt with the new limits at the next Build or query
+			void SetLimits(int maxDepth, int maxSize) {
+				if (maxDepth == this->maxDepth && maxSize == this->maxSize) {
+					return;
+				}
+				this->maxDepth	= maxDepth;
+				this->maxSize	= maxSize;
+				dirty			= true;
 			}
 
-			void Insert(T& object, const Vector3& objectPos, const Vector3& objectSize, int depthLeft, int maxSize) {
-				if (!CollisionDetection::AABBTest(objectPos, 
-					position, objectSize, size)) {
+			int GetMaxDepth() const {
+				return maxDepth;
+			}
+
+			int GetMaxSize() const {
+				return maxSize;
+			}
+
+			void Clear() {
+				entries.clear();
+				nodes.clear();
+				leafItems.clear();
+				buildItems.clear();
+				nodes.emplace_back(OctreeNode(Vector3(), Vector3()));
+				UpdateBoxArrays();
+				dirty = false;
+			}
+
+			void Insert(T object, const Vector3& pos, const Vector3& size) {
+				entries.emplace_back(OctreeEntry<T>(object, pos, size));
+				dirty = true;
+			}
+
+			void Build() {
+				if (!dirty) {
 					return;
 				}
-				if (children) {
-					for (int i = 0; i < 8; ++i) {
-						children[i].Insert(object, objectPos, objectSize, depthLeft - 1, maxSize);
-					}
-				}
-				else {
-					contents.push_back(OctreeEntry<T>(object, objectPos, objectSize));
-					if ((int)contents.size() > maxSize && depthLeft > 0) {
-						if (!children) {
-							Split();
-							for (const auto& i : contents) {
-								for (int j = 0; j < 8; ++j) {
-									auto entry = i;
-									children[j].Insert(entry.object, entry.pos, entry.size, depthLeft - 1, maxSize);
-								}
-							}
-							contents.clear();
-						}
-					}
+				nodes.clear();
+				leafItems.clear();
+				buildItems.clear();
+
+				Vector3 rootPos, rootSize;
+				FitRoot(rootPos, rootSize);
+				nodes.emplace_back(OctreeNode(rootPos, rootSize * LooseFactor));
+
+				for (int i = 0; i < (int)entries.size(); ++i) {
+					buildItems.emplace_back(i);
 				}
+				BuildNode(0, 0, (int)buildItems.size(), maxDepth);
+				UpdateBoxArrays();
+				dirty = false;
 			}
 
-			void GetCollidingNodes(T& object, const Vector3& objectPos, const Vector3& objectSize, std::list<OctreeEntry<T>>& collidingNodes) {
-				if (!CollisionDetection::AABBTest(objectPos, position, objectSize, size)) {
+			//Every entry is only in one node, so each is only added once
+			void GetCollidingNodes(T object, const Vector3& pos, const Vector3& size, std::vector<OctreeEntry<T>>& collidingNodes) {
+				if (!NextQuery(pos, size)) {
 					return;
 				}
-				if (children) {
-					for (int i = 0; i < 8; ++i) {
-						children[i].GetCollidingNodes(object, objectPos, objectSize, collidingNodes);
+				QueryCounts counts;
+				CollectNode(0, pos, size,
+					[&](const OctreeEntry<T>& e) { collidingNodes.emplace_back(e); }, counts
+				);
+				AddQuery(counts);
+			}
+
+			//As above, but only hands back the objects, for callers that don't
+			//need the stored bounds. The vector is appended to, not cleared
+			void GetCollidingObjects(const Vector3& pos, const Vector3& size, std::vector<T>& collidingObjects) {
+				if (!NextQuery(pos, size)) {
+					return;
+				}
+				QueryCounts counts;
+				CollectNode(0, pos, size,
+					[&](const OctreeEntry<T>& e) { collidingObjects.emplace_back(e.object); }, counts
+				);
+				AddQuery(counts);
+			}
+
+			//As above, but with the boxes the entries were inserted with too
+			void GetCollidingEntries(const Vector3& pos, const Vector3& size, std::vector<OctreeEntry<T>>& collidingEntries) {
+				if (!NextQuery(pos, size)) {
+					return;
+				}
+				QueryCounts counts;
+				CollectNode(0, pos, size,
+					[&](const OctreeEntry<T>& e) { collidingEntries.emplace_back(e); }, counts
+				);
+				AddQuery(counts);
+			}
+
+			//func(const OctreeEntry<T>&) is called for each entry the box overlaps, for
+			//callers that would rather test them as they go than collect them first
+			template<class F>
+			void Query(const Vector3& pos, const Vector3& size, F&& func) {
+				if (!NextQuery(pos, size)) {
+					return;
+				}
+				QueryCounts counts;
+				CollectNode(0, pos, size, func, counts);
+				AddQuery(counts);
+			}
+
+			//Every entry at least partly inside the frustum, appended to the vector.
+			//Nodes wholly inside have all their entries taken without testing them
+			void GetObjectsInFrustum(const Frustum& frustum, std::vector<T>& visibleObjects) {
+				Build();
+				QueryCounts counts;
+				CollectFrustumNode(0, frustum, false,
+					[&](const OctreeEntry<T>& e) { visibleObjects.emplace_back(e.object); }, counts
+				);
+				AddQuery(counts);
+			}
+
+			//func(const OctreeEntry<T>&, float& maxDistance) is called once for each
+			//entry in the nodes the ray passes through. Only reads from the tree once
+			//it has been built, so can be called from several threads at once
+			template<class F>
+			void RayCast(const Ray& r, float maxDistance, F&& func) {
+				Build();
+				Vector3 dir = r.GetDirection();
+				Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+				Vector3 rayPos = r.GetPosition();
+				float entry;
+				QueryCounts counts;
+				if (CollisionDetection::RaySlabTest(rayPos, invDir, nodes[0].position - nodes[0].size, nodes[0].position + nodes[0].size, maxDistance, entry)) {
+					RayCastNode(0, rayPos, invDir, maxDistance, func, counts);
+				}
+				AddQuery(counts);
+			}
+
+			/*
+			Draws the space each node covers, rather than its loose bounds, as
+			those overlap their neighbours' and end up a mess. Nodes are coloured
+			by depth, from red at the root to blue, and only those holding
+			something are drawn. A depth of -1 draws every level, and anything
+			else only that one.
+			*/
+			void DebugDraw(int onlyDepth = -1) {
+				Build();
+				DebugDrawNode(0, 0, onlyDepth);
+			}
+
+			OctreeStats GetStats() {
+				Build();
+				OctreeStats stats;
+				stats.nodes		= (int)nodes.size();
+				stats.entries	= (int)entries.size();
+				std::vector<char> held(entries.size(), 0);
+				for (int item : leafItems) {
+					stats.duplicates += held[item] ? 1 : 0;
+					held[item] = 1;
+				}
+				GatherStats(0, 0, stats);
+				return stats;
+			}
+
+			OctreeQueryStats GetQueryStats() const {
+				OctreeQueryStats q;
+				q.queries		= queryCount.load(std::memory_order_relaxed);
+				q.nodesVisited	= queryNodes.load(std::memory_order_relaxed);
+				q.entriesTested	= queryEntries.load(std::memory_order_relaxed);
+				return q;
+			}
+
+			void ResetQueryStats() {
+				queryCount		= 0;
+				queryNodes		= 0;
+				queryEntries	= 0;
+			}
+
+			void OperateOnContents(OctTreeFunc func) {
+				for (const OctreeEntry<T>& e : entries) {
+					func(e);
+				}
+			}
+
+			/*
+			Writes out the built tree, so that it can be loaded straight back in
+			rather than rebuilt. Objects can't be written as they are, so
+			getID(const T&) turns each one into an int that the loader can
+			resolve back into an object.
+			*/
+			template<class F>
+			void Save(std::ostream& out, F&& getID) {
+				Build();
+				SaveHeader header;
+				header.magic		= SaveMagic;
+				header.maxDepth		= maxDepth;
+				header.maxSize		= maxSize;
+				header.entryCount	= (int)entries.size();
+				header.nodeCount	= (int)nodes.size();
+				header.itemCount	= (int)leafItems.size();
+				out.write((const char*)&header, sizeof(SaveHeader));
+
+				for (const OctreeEntry<T>& e : entries) {
+					SavedEntry saved;
+					saved.id	= getID(e.object);
+					saved.pos	= e.pos;
+					saved.size	= e.size;
+					out.write((const char*)&saved, sizeof(SavedEntry));
+				}
+				out.write((const char*)nodes.data(), sizeof(OctreeNode) * nodes.size());
+				out.write((const char*)leafItems.data(), sizeof(int) * leafItems.size());
+			}
+
+			/*
+			Reads a tree written by Save, straight out of a block of memory.
+			resolve(int id, const Vector3& pos, const Vector3& size, T& object)
+			should return false if the id no longer matches the object that was
+			saved, in which case the tree is left empty, and false returned.
+			*/
+			template<class F>
+			bool Load(const char* data, size_t dataSize, F&& resolve) {
+				Clear();
+				SaveHeader header;
+				if (dataSize < sizeof(SaveHeader)) {
+					return false;
+				}
+				memcpy(&header, data, sizeof(SaveHeader));
+				size_t expected = sizeof(SaveHeader) + sizeof(SavedEntry) * header.entryCount +
+					sizeof(OctreeNode) * header.nodeCount + sizeof(int) * header.itemCount;
+
+				if (header.magic != SaveMagic || header.maxDepth != maxDepth || header.maxSize != maxSize ||
+					header.entryCount < 0 || header.nodeCount < 1 || header.itemCount < 0 ||
+					dataSize != expected) {
+					return false;
+				}
+				const char* read = data + sizeof(SaveHeader);
+				for (int i = 0; i < header.entryCount; ++i) {
+					SavedEntry saved;
+					memcpy(&saved, read, sizeof(SavedEntry));
+					read += sizeof(SavedEntry);
+					T object;
+					if (!resolve(saved.id, saved.pos, saved.size, object)) {
+						Clear();
+						return false;
+					}
+					entries.emplace_back(OctreeEntry<T>(object, saved.pos, saved.size));
+				}
+				nodes.resize(header.nodeCount, OctreeNode(Vector3(), Vector3()));
+				memcpy(nodes.data(), read, sizeof(OctreeNode) * header.nodeCount);
+				read += sizeof(OctreeNode) * header.nodeCount;
+
+				leafItems.resize(header.itemCount);
+				memcpy(leafItems.data(), read, sizeof(int) * header.itemCount);
+
+				//A damaged file shouldn't be able to send a query off the end of an array
+				bool valid = true;
+				for (const OctreeNode& n : nodes) {
+					if ((n.firstChild >= 0 && n.firstChild + 8 > header.nodeCount) ||
+						n.firstItem < 0 || n.itemCount < 0 || n.firstItem + n.itemCount > header.itemCount) {
+						valid = false;
 					}
 				}
-				else {
-					for (auto x : contents) {
-						collidingNodes.push_back(x);
+				for (int item : leafItems) {
+					if (item < 0 || item >= header.entryCount) {
+						valid = false;
 					}
 				}
+				if (!valid) {
+					Clear();
+					return false;
+				}
+				UpdateBoxArrays();
+				return true;
 			}
 
-			void Split() {
-				Vector3 halfSize = size / 2.0f;
-				children = new OctreeNode<T>[8];
-				children[0] = OctreeNode<T>(position + Vector3(-halfSize.x, halfSize.y, halfSize.z), halfSize);
-				children[1] = OctreeNode<T>(position + Vector3(halfSize.x, halfSize.y, halfSize.z), halfSize);
-				children[2] = OctreeNode<T>(position + Vector3(-halfSize.x, -halfSize.y, halfSize.z), halfSize);
-				children[3] = OctreeNode<T>(position + Vector3(halfSize.x, -halfSize.y, halfSize.z), halfSize);
-				children[4] = OctreeNode<T>(position + Vector3(-halfSize.x, halfSize.y, -halfSize.z), halfSize);
-				children[5] = OctreeNode<T>(position + Vector3(halfSize.x, halfSize.y, -halfSize.z), halfSize);
-				children[6] = OctreeNode<T>(position + Vector3(-halfSize.x, -halfSize.y, -halfSize.z), halfSize);
-				children[7] = OctreeNode<T>(position + Vector3(halfSize.x, -halfSize.y, -halfSize.z), halfSize);
+			int GetNodeCount() const {
+				return (int)nodes.size();
 			}
 
-			void DebugDraw() {
+			int GetEntryCount() const {
+				return (int)entries.size();
+			}
+
+		protected:
+			static const uint32_t SaveMagic = 0x3254434F; //'OCT2', as 'OCT1' trees weren't loose
+
+			struct SaveHeader {
+				uint32_t	magic;
+				int			maxDepth;
+				int			maxSize;
+				int			entryCount;
+				int			nodeCount;
+				int			itemCount;
+			};
+
+			struct SavedEntry {
+				int		id;
+				Vector3 pos;
+				Vector3 size;
+			};
+
+			//Counted locally through a query, then added in one go, as queries can come from several threads
+			struct QueryCounts {
+				int nodes	= 0;
+				int entries	= 0;
+			};
+
+			void AddQuery(const QueryCounts& counts) {
+				queryCount.fetch_add(1, std::memory_order_relaxed);
+				queryNodes.fetch_add(counts.nodes, std::memory_order_relaxed);
+				queryEntries.fetch_add(counts.entries, std::memory_order_relaxed);
+			}
 
+			void GatherStats(int node, int depth, OctreeStats& stats) const {
+				const OctreeNode& n = nodes[node];
+				stats.depthReached = depth > stats.depthReached ? depth : stats.depthReached;
+				if (n.firstChild >= 0) {
+					stats.splitNodeItems += n.itemCount;
+					for (int i = 0; i < 8; ++i) {
+						GatherStats(n.firstChild + i, depth + 1, stats);
+					}
+					return;
+				}
+				stats.leaves++;
+				stats.emptyLeaves		+= n.itemCount == 0 ? 1 : 0;
+				stats.overfullLeaves	+= n.itemCount > maxSize ? 1 : 0;
+				stats.occupancy[n.itemCount < OctreeStats::OccupancyBuckets ? n.itemCount : OctreeStats::OccupancyBuckets - 1]++;
 			}
 
-			void OperateOnContents(OctTreeFunc& func) {
-				if (children) {
+			void DebugDrawNode(int node, int depth, int onlyDepth) const {
+				const OctreeNode& n = nodes[node];
+				if (n.itemCount > 0 && (onlyDepth < 0 || onlyDepth == depth)) {
+					float t = maxDepth > 0 ? (float)depth / (float)maxDepth : 0.0f;
+					Vector4 colour(1.0f - t, 0.2f, t, 1.0f);
+					Vector3 half = n.size / LooseFactor;
+					Vector3 corners[8];
 					for (int i = 0; i < 8; ++i) {
-						children[i].OperateOnContents(func);
+						corners[i] = n.position + Vector3((i & 1) ? half.x : -half.x, (i & 2) ? half.y : -half.y, (i & 4) ? half.z : -half.z);
+					}
+					//Each edge joins two corners that differ in one bit
+					for (int i = 0; i < 8; ++i) {
+						for (int bit = 1; bit < 8; bit <<= 1) {
+							if (!(i & bit)) {
+								Debug::DrawLine(corners[i], corners[i | bit], colour);
+							}
+						}
 					}
 				}
-				else {
-					if (!contents.empty()) {
-						func(contents);
+				if (n.firstChild >= 0 && (onlyDepth < 0 || depth < onlyDepth)) {
+					for (int i = 0; i < 8; ++i) {
+						DebugDrawNode(n.firstChild + i, depth + 1, onlyDepth);
 					}
 				}
 			}
 
-		protected:
-			std::list< OctreeEntry<T> >	contents;
+			//Fits the root's (tight) bounds around every entry
+			void FitRoot(Vector3& pos, Vector3& size) const {
+				if (entries.empty()) {
+					pos		= Vector3();
+					size	= Vector3(1, 1, 1);
+					return;
+				}
+				Vector3 boxMin = entries[0].pos - entries[0].size;
+				Vector3 boxMax = entries[0].pos + entries[0].size;
+				for (const OctreeEntry<T>& e : entries) {
+					Vector3 eMin = e.pos - e.size;
+					Vector3 eMax = e.pos + e.size;
+					for (int i = 0; i < 3; ++i) {
+						boxMin[i] = eMin[i] < boxMin[i] ? eMin[i] : boxMin[i];
+						boxMax[i] = eMax[i] > boxMax[i] ? eMax[i] : boxMax[i];
+					}
+				}
+				pos		= (boxMin + boxMax) * 0.5f;
+				size	= (boxMax - boxMin) * 0.5f;
+				for (int i = 0; i < 3; ++i) {
+					size[i] = size[i] > 0.01f ? size[i] : 0.01f; //flat levels still need some depth to split
+				}
+			}
 
-			Vector3 position;
-			Vector3 size;
+			/*
+			The items for the node being built sit at buildItems[first, first + count).
+			Each item goes in the child whose octant its centre is in, as long as
+			it's no bigger than that child's tight bounds - then, wherever in the
+			octant it is, it's inside the child's loose bounds. Anything bigger
+			stays in this node. Each child's share is appended to the end of the
+			same array, and then trimmed off again once that child is done, so the
+			scratch space never needs more than one path's worth of items.
+			*/
+			void BuildNode(int node, int first, int count, int depthLeft) {
+				if (count <= maxSize || depthLeft <= 0) {
+					nodes[node].firstItem = (int)leafItems.size();
+					nodes[node].itemCount = count;
+					for (int i = 0; i < count; ++i) {
+						leafItems.emplace_back(buildItems[first + i]);
+					}
+					return;
+				}
+				Vector3 childSize	= nodes[node].size / (LooseFactor * 2.0f); //tight half size
+				Vector3 position	= nodes[node].position;
 
-			OctreeNode<T>* children;
-		};
-	}
-}
+				nodes[node].firstItem = (int)leafItems.size();
+				nodes[node].itemCount = 0;
+				for (int j = 0; j < count; ++j) {
+					int item = buildItems[first + j];
+					if (ChildFor(entries[item], position, childSize) < 0) {
+						leafItems.emplace_back(item);
+						nodes[node].itemCount++;
+					}
+				}
 
+				int firstChild = (int)nodes.size();
+				nodes[node].firstChild = firstChild;
 
-namespace NCL {
-	using namespace NCL::Maths;
-	namespace CSC8503 {
-		template<class T>
-		class Octree
-		{
-		public:
-			Octree(Vector3 size, int maxDepth = 6, int maxSize = 5){
-				root = OctreeNode<T>(Vector3(), size);
-				this->maxDepth	= maxDepth;
-				this->maxSize	= maxSize;
+				for (int i = 0; i < 8; ++i) {
+					Vector3 offset(
+						(i & 1) ? childSize.x : -childSize.x,
+						(i & 2) ? -childSize.y : childSize.y,
+						(i & 4) ? -childSize.z : childSize.z
+					);
+					nodes.emplace_back(OctreeNode(position + offset, childSize * LooseFactor));
+				}
+				for (int i = 0; i < 8; ++i) {
+					int childFirst = (int)buildItems.size();
+					for (int j = 0; j < count; ++j) {
+						int item = buildItems[first + j];
+						if (ChildFor(entries[item], position, childSize) == i) {
+							buildItems.emplace_back(item);
+						}
+					}
+					BuildNode(firstChild + i, childFirst, (int)buildItems.size() - childFirst, depthLeft - 1);
+					buildItems.resize(childFirst);
+				}
 			}
-			~Octree() {
+
+			//Which of a node's children an entry belongs in, or -1 if it's too big for them
+			static int ChildFor(const OctreeEntry<T>& e, const Vector3& nodePos, const Vector3& childSize) {
+				if (e.size.x > childSize.x || e.size.y > childSize.y || e.size.z > childSize.z) {
+					return -1;
+				}
+				return	(e.pos.x >= nodePos.x ? 1 : 0) |
+						(e.pos.y < nodePos.y ? 2 : 0) |
+						(e.pos.z < nodePos.z ? 4 : 0);
 			}
 
-			void Insert(T object, const Vector3& pos, const Vector3& size) {
-				root.Insert(object, pos, size, maxDepth, maxSize);
+			//Builds the tree if needed. Returns false if the query box misses the
+			//tree entirely
+			bool NextQuery(const Vector3& pos, const Vector3& size) {
+				Build();
+				return CollisionDetection::AABBTest(pos, nodes[0].position, size, nodes[0].size);
 			}
 
-			void GetCollidingNodes(T object, const Vector3& pos, const Vector3& size, std::list<OctreeEntry<T>>& collidingNodes) {
-				root.GetCollidingNodes(object, pos, size, collidingNodes);
+			/*
+			The query box is tested against 4 boxes at a time, so the node bounds
+			are also kept a component at a time, in node order (so that a node's
+			8 children are two loads), and the bounds of the nodes' entries in
+			the same order as leafItems.
+			*/
+			void UpdateBoxArrays() {
+				nodeBoxes.Clear();
+				for (const OctreeNode& n : nodes) {
+					nodeBoxes.Add(n.position, n.size);
+				}
+				itemBoxes.Clear();
+				for (int item : leafItems) {
+					itemBoxes.Add(entries[item].pos, entries[item].size);
+				}
 			}
 
-			void DebugDraw() {
-				root.DebugDraw();
+			template<class F>
+			void CollectNode(int node, const Vector3& pos, const Vector3& size, F&& func, QueryCounts& counts) {
+				const OctreeNode& n = nodes[node];
+				counts.nodes++;
+				counts.entries += n.itemCount;
+				int i = 0;
+				for (; i + 4 <= n.itemCount; i += 4) {
+					int hits = CollisionDetection::AABBTest4(pos, size, itemBoxes, n.firstItem + i);
+					for (int j = 0; hits; ++j, hits >>= 1) {
+						if (hits & 1) {
+							func(entries[leafItems[n.firstItem + i + j]]);
+						}
+					}
+				}
+				for (; i < n.itemCount; ++i) {
+					int item = leafItems[n.firstItem + i];
+					if (CollisionDetection::AABBTest(pos, entries[item].pos, size, entries[item].size)) {
+						func(entries[item]);
+					}
+				}
+				if (n.firstChild >= 0) {
+					int hits =	CollisionDetection::AABBTest4(pos, size, nodeBoxes, n.firstChild) |
+								(CollisionDetection::AABBTest4(pos, size, nodeBoxes, n.firstChild + 4) << 4);
+					for (int c = 0; c < 8; ++c) {
+						if (hits & (1 << c)) {
+							CollectNode(n.firstChild + c, pos, size, func, counts);
+						}
+					}
+				}
 			}
 
-			void OperateOnContents(typename OctreeNode<T>::OctTreeFunc  func) {
-				root.OperateOnContents(func);
+			template<class F>
+			void CollectFrustumNode(int node, const Frustum& frustum, bool inside, F&& func, QueryCounts& counts) {
+				const OctreeNode& n = nodes[node];
+				counts.nodes++;
+				if (!inside) {
+					Frustum::Result result = frustum.TestAABB(n.position, n.size);
+					if (result == Frustum::Result::Outside) {
+						return;
+					}
+					inside = result == Frustum::Result::Inside;
+				}
+				counts.entries += inside ? 0 : n.itemCount;
+				for (int i = 0; i < n.itemCount; ++i) {
+					int item = leafItems[n.firstItem + i];
+					if (inside || frustum.AABBInside(entries[item].pos, entries[item].size)) {
+						func(entries[item]);
+					}
+				}
+				if (n.firstChild >= 0) {
+					for (int i = 0; i < 8; ++i) {
+						CollectFrustumNode(n.firstChild + i, frustum, inside, func, counts);
+					}
+				}
 			}
 
-		protected:
-			OctreeNode<T> root;
-			int maxDepth;
-			int maxSize;
+			/*
+			Visits the nodes the ray passes through, roughly nearest first, as the
+			loose bounds overlap. The callback can shorten maxDistance when it
+			finds a hit, and any node that starts further away than that is
+			skipped.
+			*/
+			template<class F>
+			void RayCastNode(int node, const Vector3& rayPos, const Vector3& invDir, float& maxDistance, F& func, QueryCounts& counts) const {
+				const OctreeNode& n = nodes[node];
+				counts.nodes++;
+				counts.entries += n.itemCount;
+				for (int i = 0; i < n.itemCount; ++i) {
+					func(entries[leafItems[n.firstItem + i]], maxDistance);
+				}
+				if (n.firstChild < 0) {
+					return;
+				}
+				int		order[8];
+				float	distances[8];
+				int		count = 0;
+				for (int i = 0; i < 8; ++i) {
+					const OctreeNode& child = nodes[n.firstChild + i];
+					float entry;
+					if (!CollisionDetection::RaySlabTest(rayPos, invDir, child.position - child.size,
+						child.position + child.size, maxDistance, entry)) {
+						continue;
+					}
+					int j = count++;
+					for (; j > 0 && distances[j - 1] > entry; --j) {
+						distances[j]	= distances[j - 1];
+						order[j]		= order[j - 1];
+					}
+					distances[j]	= entry;
+					order[j]		= i;
+				}
+				for (int i = 0; i < count; ++i) {
+					if (distances[i] > maxDistance) {
+						break;
+					}
+					RayCastNode(n.firstChild + order[i], rayPos, invDir, maxDistance, func, counts);
+				}
+			}
+
+			std::vector<OctreeEntry<T>>	entries;
+			std::vector<OctreeNode>		nodes;
+			std::vector<int>			leafItems;
+			std::vector<int>			buildItems;
+
+			CollisionDetection::AABBArray nodeBoxes;
+			CollisionDetection::AABBArray itemBoxes;
+
+			int				maxDepth;
+			int				maxSize;
+			bool			dirty;
+
+			std::atomic<uint64_t> queryCount	{ 0 };
+			std::atomic<uint64_t> queryNodes	{ 0 };
+			std::atomic<uint64_t> queryEntries	{ 0 };
 		};
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,69 @@
+#include "PacketRecording.h"
+#include "NetworkBase.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+bool PacketRecorder::Start(const std::string& filename) {
+	Stop();
+	file.open(filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	file.write((const char*)&FileMagic, sizeof(FileMagic));
+	file.write((const char*)&FileVersion, sizeof(FileVersion));
+	startTime = std::chrono::steady_clock::now();
+	return true;
+}
+
+void PacketRecorder::Stop() {
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+void PacketRecorder::Record(const GamePacket& packet, int bytes) {
+	float time		= std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+	uint16_t size	= (uint16_t)bytes;
+	file.write((const char*)&time, sizeof(time));
+	file.write((const char*)&size, sizeof(size));
+	file.write((const char*)&packet, bytes);
+}
+
+/*
+Each packet is copied into its own run of whole 8 byte words, so they're
+all as aligned as if they'd come straight out of ENet. Anything cut short
+at the end of the file is left out.
+*/
+bool PacketPlayback::Open(const std::string& filename) {
+	Close();
+	std::ifstream file(filename, std::ios::binary);
+	uint32_t magic		= 0;
+	uint32_t version	= 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	if (!file || magic != PacketRecorder::FileMagic || version != PacketRecorder::FileVersion) {
+		return false;
+	}
+	float		packetTime;
+	uint16_t	size;
+	while (file.read((char*)&packetTime, sizeof(packetTime)) && file.read((char*)&size, sizeof(size))) {
+		if (size < sizeof(GamePacket)) {
+			break;
+		}
+		int offset = (int)data.size();
+		data.resize(data.size() + (size + 7) / 8);
+		if (!file.read((char*)&data[offset], size)) {
+			data.resize(offset);
+			break;
+		}
+		entries.push_back({ packetTime, offset });
+	}
+	return !entries.empty();
+}
+
+void PacketPlayback::Close() {
+	entries.clear();
+	data.clear();
+	Restart();
+}
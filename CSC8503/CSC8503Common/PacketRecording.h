@@ -0,0 +1,99 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+struct GamePacket;
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Writes packets to a file as they're sent, each one with how long
+		after the start it went. The file is just a small header, then for
+		each packet its time, its size, and the packet exactly as it was
+		sent, so playing it back goes through the same code as receiving.
+		*/
+		class PacketRecorder {
+		public:
+			static const uint32_t FileMagic		= 0x4C50524E; //"NRPL"
+			static const uint32_t FileVersion	= 1;
+
+			PacketRecorder() {}
+			~PacketRecorder() {
+				Stop();
+			}
+
+			bool Start(const std::string& filename);
+			void Stop();
+
+			bool IsRecording() const {
+				return file.is_open();
+			}
+
+			void Record(const GamePacket& packet, int bytes);
+
+		protected:
+			std::ofstream							file;
+			std::chrono::steady_clock::time_point	startTime;
+		};
+
+		/*
+		Reads a whole recording in up front, so the file doesn't get in the
+		way of timing anything, and then hands back packets as their time
+		comes round. The clock is however far Update has been moved on, so
+		it can be run at any speed.
+		*/
+		class PacketPlayback {
+		public:
+			PacketPlayback() {}
+			~PacketPlayback() {}
+
+			bool Open(const std::string& filename);
+			void Close();
+
+			bool IsOpen() const {
+				return !entries.empty();
+			}
+
+			bool IsFinished() const {
+				return nextEntry >= (int)entries.size();
+			}
+
+			float GetTime() const {
+				return time;
+			}
+
+			float GetDuration() const {
+				return entries.empty() ? 0.0f : entries.back().time;
+			}
+
+			//Calls func with each packet whose time has come
+			template <class F>
+			void Update(float dt, F&& func) {
+				time += dt;
+				while (nextEntry < (int)entries.size() && entries[nextEntry].time <= time) {
+					func((GamePacket*)&data[entries[nextEntry].offset]);
+					nextEntry++;
+				}
+			}
+
+			void Restart() {
+				time		= 0.0f;
+				nextEntry	= 0;
+			}
+
+		protected:
+			struct Entry {
+				float	time;
+				int		offset; //into data, where the packets are 8 byte aligned
+			};
+
+			std::vector<Entry>		entries;
+			std::vector<uint64_t>	data;
+			float					time		= 0.0f;
+			int						nextEntry	= 0;
+		};
+	}
+}
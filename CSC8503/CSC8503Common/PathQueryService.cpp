@@ -0,0 +1,172 @@
+#include "PathQueryService.h"
+#include "NavigationGrid.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PathQueryService::PathQueryService(const NavigationGrid& g) : grid(g) {
+	nextTicket	= 0;
+	running		= 0;
+}
+
+PathQueryService::~PathQueryService() {
+	std::unique_lock<std::mutex> lock(queryMutex);
+	queryFinished.wait(lock, [&] { return running == 0; });
+	for (auto& t : tickets) {
+		t.second->tickets--;
+		if (t.second->tickets == 0) {
+			delete t.second;
+		}
+	}
+	for (Query* q : orphans) {
+		delete q;
+	}
+}
+
+std::pair<int, int> PathQueryService::CellsOf(const Vector3& from, const Vector3& to) const {
+	int size	= grid.GetNodeSize() > 0 ? grid.GetNodeSize() : 1;
+	int width	= grid.GetGridWidth();
+	return { ((int)from.z / size) * width + ((int)from.x / size), ((int)to.z / size) * width + ((int)to.x / size) };
+}
+
+int PathQueryService::Request(const Vector3& from, const Vector3& to) {
+	std::pair<int, int> cells = CellsOf(from, to);
+	Query* q = nullptr;
+	auto shared = unfinished.find(cells);
+	auto cached = cache.find(cells);
+	if (shared != unfinished.end()) {
+		q = shared->second;
+	}
+	else if (cached != cache.end()) {
+		q = new Query(); //already done, so the next Poll has it
+		q->from		= from;
+		q->to		= to;
+		q->path		= cached->second.first;
+		q->found	= cached->second.second;
+		q->done		= true;
+	}
+	else {
+		q = new Query();
+		q->from	= from;
+		q->to	= to;
+		unfinished[cells] = q;
+		waiting.emplace_back(q);
+	}
+	q->tickets++;
+	int ticket = nextTicket++;
+	tickets[ticket] = q;
+	return ticket;
+}
+
+bool PathQueryService::Poll(int ticket, bool& found, std::shared_ptr<const NavigationPath>& outPath) {
+	auto i = tickets.find(ticket);
+	if (i == tickets.end()) {
+		found = false;
+		return true; //Nothing's going to happen to it now
+	}
+	Query* q = i->second;
+	{
+		std::lock_guard<std::mutex> lock(queryMutex);
+		if (!q->done) {
+			return false;
+		}
+	}
+	found	= q->found;
+	outPath	= q->path;
+	if (cache.size() >= MaxCachedPaths) {
+		cache.clear();
+	}
+	cache[CellsOf(q->from, q->to)] = { q->path, q->found };
+	Forget(q); //Anyone asking from now on might have moved on since it started
+	tickets.erase(i);
+	Release(q);
+	return true;
+}
+
+void PathQueryService::Cancel(int ticket) {
+	auto i = tickets.find(ticket);
+	if (i == tickets.end()) {
+		return;
+	}
+	Query* q = i->second;
+	tickets.erase(i);
+	Release(q);
+}
+
+//Once no tickets are waiting on a query, it goes, unless a worker's still searching for it
+void PathQueryService::Release(Query* q) {
+	q->tickets--;
+	if (q->tickets > 0) {
+		return;
+	}
+	Forget(q);
+	if (!q->submitted) {
+		waiting.erase(std::remove(waiting.begin(), waiting.end(), q), waiting.end());
+		delete q;
+		return;
+	}
+	std::lock_guard<std::mutex> lock(queryMutex);
+	if (q->done) {
+		delete q;
+	}
+	else {
+		orphans.emplace_back(q);
+	}
+}
+
+void PathQueryService::Forget(Query* q) {
+	auto i = unfinished.find(CellsOf(q->from, q->to));
+	if (i != unfinished.end() && i->second == q) {
+		unfinished.erase(i);
+	}
+}
+
+void PathQueryService::Update() {
+	{
+		std::lock_guard<std::mutex> lock(queryMutex);
+		for (size_t i = 0; i < orphans.size();) {
+			if (orphans[i]->done) {
+				delete orphans[i];
+				orphans[i] = orphans.back();
+				orphans.pop_back();
+			}
+			else {
+				++i;
+			}
+		}
+	}
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	int count = (int)waiting.size() < QueriesPerFrame ? (int)waiting.size() : QueriesPerFrame;
+	for (int i = 0; i < count; ++i) {
+		Query* q = waiting[i];
+		q->submitted = true;
+		if (jobs) {
+			{
+				std::lock_guard<std::mutex> lock(queryMutex);
+				running++;
+			}
+			jobs->Submit([this, q]() { Run(q, true); });
+		}
+		else {
+			Run(q, false);
+		}
+	}
+	waiting.erase(waiting.begin(), waiting.begin() + count);
+}
+
+void PathQueryService::Run(Query* q, bool onJob) {
+	thread_local NavigationGridSearch search;
+	std::shared_ptr<NavigationPath> path = std::make_shared<NavigationPath>();
+	bool found = grid.FindPath(q->from, q->to, *path, search);
+
+	std::lock_guard<std::mutex> lock(queryMutex);
+	q->path		= std::move(path);
+	q->found	= found;
+	q->done		= true;
+	if (onJob) {
+		running--;
+		queryFinished.notify_all();
+	}
+}
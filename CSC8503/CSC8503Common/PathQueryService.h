@@ -0,0 +1,84 @@
+#pragma once
+#include "NavigationPath.h"
+#include <unordered_map>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+namespace NCL {
+	namespace CSC8503 {
+		class NavigationGrid;
+
+		/*
+		Paths asked for as a ticket, which is checked on later with Poll,
+		rather than searched for there and then. Update hands up to
+		QueriesPerFrame waiting searches to the job system each frame, each
+		worker thread using a search context of its own, so a lot of agents
+		changing their minds at once spreads its cost out over a few frames,
+		and off the game thread, instead of spiking one. Tickets going from
+		and to the same grid cells as one that hasn't finished, such as
+		agents that spawned together heading for the same refill point, get
+		that one's result too rather than searching again. Finished paths are
+		kept by their start and end cells too, so asking for one again later
+		doesn't search at all. Paths are handed out shared rather than copied,
+		so they can't be changed once they're out.
+
+		Only the game thread should call anything here.
+		*/
+		class PathQueryService {
+		public:
+			PathQueryService(const NavigationGrid& grid);
+			~PathQueryService();
+
+			int		Request(const Vector3& from, const Vector3& to);
+			//Returns true once the ticket's search has finished, which also
+			//hands the ticket back. found is whether there was a path at all
+			bool	Poll(int ticket, bool& found, std::shared_ptr<const NavigationPath>& outPath);
+			void	Cancel(int ticket);
+
+			//For when the grid's changed, and none of them can be trusted any more
+			void	ClearCache() {
+				cache.clear();
+			}
+
+			void	Update();
+
+			int		GetWaitingCount() const {
+				return (int)waiting.size();
+			}
+
+			static const int QueriesPerFrame	= 8;
+			static const int MaxCachedPaths		= 512;
+
+		protected:
+			struct Query {
+				Vector3			from;
+				Vector3			to;
+				std::shared_ptr<const NavigationPath> path;
+				int				tickets		= 0;
+				bool			submitted	= false;
+				bool			done		= false;	//only changed under queryMutex once it's submitted
+				bool			found		= false;
+			};
+
+			void	Run(Query* q, bool onJob);
+			void	Release(Query* q);
+			void	Forget(Query* q);
+			std::pair<int, int> CellsOf(const Vector3& from, const Vector3& to) const;
+
+			const NavigationGrid&			grid;
+			std::unordered_map<int, Query*>	tickets;
+			std::map<std::pair<int, int>, Query*> unfinished;	//by start and end cell
+			std::map<std::pair<int, int>, std::pair<std::shared_ptr<const NavigationPath>, bool>> cache; //and whether it was found
+			std::vector<Query*>				waiting;
+			std::vector<Query*>				orphans;	//cancelled while searching
+			int								nextTicket;
+
+			std::mutex						queryMutex;
+			std::condition_variable			queryFinished;
+			int								running;
+		};
+	}
+}
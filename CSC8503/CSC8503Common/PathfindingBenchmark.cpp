@@ -0,0 +1,385 @@
+#include "PathfindingBenchmark.h"
+#include "FlowField.h"
+#include "AllocationCounter.h"
+#include "../../Common/Assets.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PathfindingBenchmark::PathfindingBenchmark(int queries, unsigned int seed) : random(seed) {
+	queryCount = queries > 0 ? queries : 1;
+}
+
+const char* PathfindingBenchmark::GetMethodName(Method m) {
+	switch (m) {
+		case Method::GridAStar:		return "GridAStar";
+		case Method::GridClusters:	return "GridClusters";
+		case Method::NavMesh:		return "NavMesh";
+		case Method::FlowField:		return "FlowField";
+	}
+	return "";
+}
+
+void PathfindingBenchmark::RunAll(const std::vector<int>& mazeSizes, const std::string& csvFile) {
+	results.clear();
+	RunMap("LevelLayout.txt");
+	for (int size : mazeSizes) {
+		RunMap(WriteMaze(size));
+	}
+
+	std::ofstream csv(csvFile);
+	if (!csv) {
+		return;
+	}
+	csv << "map,method,width,height,queries,found,setup_ms,mean_us,median_us,p99_us,max_us,expanded,allocations,path_length\n";
+	for (const Result& r : results) {
+		csv << r.map << "," << GetMethodName(r.method) << "," << r.width << "," << r.height << ","
+			<< r.queries << "," << r.found << "," << r.setupTime << "," << r.meanTime << "," << r.medianTime << ","
+			<< r.p99Time << "," << r.maxTime << "," << r.expanded << "," << r.allocations << "," << r.pathLength << "\n";
+	}
+}
+
+void PathfindingBenchmark::RunMap(const std::string& mapFile) {
+	typedef std::chrono::steady_clock Clock;
+	auto start = Clock::now();
+	NavigationGrid* grid = new NavigationGrid(mapFile);
+	float loadTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+	if (grid->GetGridWidth() <= 0 || grid->GetGridHeight() <= 0 || grid->GetNodeSize() <= 0) {
+		std::cout << "Couldn't load " << mapFile << ", skipping it" << std::endl;
+		delete grid;
+		return;
+	}
+	MakeQueries(*grid);
+	if (queries.empty()) {
+		std::cout << mapFile << " has no floor to find paths across, skipping it" << std::endl;
+		delete grid;
+		return;
+	}
+	std::cout << mapFile << " (" << grid->GetGridWidth() << "x" << grid->GetGridHeight() << ")" << std::endl;
+
+	std::vector<Result> mapResults;
+	grid->SetUseClusters(false);
+	mapResults.emplace_back(TestGrid(*grid, mapFile, Method::GridAStar, loadTime));
+	grid->SetUseClusters(true);
+	if (grid->HasClusters()) {
+		mapResults.emplace_back(TestGrid(*grid, mapFile, Method::GridClusters, loadTime));
+	}
+	mapResults.emplace_back(TestMesh(*grid, mapFile));
+	mapResults.emplace_back(TestFlowField(*grid, mapFile));
+	delete grid;
+
+	for (const Result& r : mapResults) {
+		std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(14) << GetMethodName(r.method) << std::right
+			<< std::setw(10) << r.meanTime << "us mean, " << r.p99Time << "us p99, " << r.maxTime << "us worst, "
+			<< r.expanded << " expanded, " << r.allocations << " allocations, "
+			<< r.found << "/" << r.queries << " found, " << r.pathLength << " long, " << r.setupTime << "ms setup" << std::endl;
+		results.emplace_back(r);
+	}
+}
+
+//Only plain floor is picked, the same as GetRandomValidPosition would
+void PathfindingBenchmark::MakeQueries(const NavigationGrid& grid) {
+	std::vector<int> floor;
+	const GridNode* nodes = grid.GetNodes();
+	for (int i = 0; i < grid.GetGridWidth() * grid.GetGridHeight(); ++i) {
+		if (nodes[i].type == '.') {
+			floor.emplace_back(i);
+		}
+	}
+	queries.clear();
+	if (floor.empty()) {
+		return;
+	}
+	std::uniform_int_distribution<int> pick(0, (int)floor.size() - 1);
+	for (int i = 0; i < queryCount; ++i) {
+		queries.push_back({ floor[pick(random)], floor[pick(random)] });
+	}
+}
+
+/*
+The first query's run once before any are timed, so the search's per node
+arrays are already the right size, as they would be in the game.
+*/
+PathfindingBenchmark::Result PathfindingBenchmark::TestGrid(NavigationGrid& grid, const std::string& map, Method method, float setupTime) {
+	typedef std::chrono::steady_clock Clock;
+	Result r;
+	r.map		= map;
+	r.method	= method;
+	r.width		= grid.GetGridWidth();
+	r.height	= grid.GetGridHeight();
+	r.setupTime	= setupTime;
+
+	NavigationGridSearch search;
+	NavigationPath path;
+	grid.FindPath(grid.GetCellCentre(queries[0].from), grid.GetCellCentre(queries[0].to), path, search);
+
+	std::vector<float> times;
+	times.reserve(queries.size());
+	double expanded		= 0.0;
+	double allocations	= 0.0;
+	double length		= 0.0;
+	for (const Query& q : queries) {
+		Vector3 from	= grid.GetCellCentre(q.from);
+		Vector3 to		= grid.GetCellCentre(q.to);
+		path.Clear();
+		unsigned int expandedBefore		= search.GetExpanded();
+		unsigned int allocationsBefore	= AllocationCounter::GetCount();
+
+		auto start = Clock::now();
+		bool found = grid.FindPath(from, to, path, search);
+		times.emplace_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+
+		allocations	+= AllocationCounter::GetCount() - allocationsBefore;
+		expanded	+= search.GetExpanded() - expandedBefore;
+		if (found) {
+			r.found++;
+			length += PathLength(from, path);
+		}
+	}
+	Summarise(r, times, expanded, allocations, length);
+	return r;
+}
+
+PathfindingBenchmark::Result PathfindingBenchmark::TestMesh(const NavigationGrid& grid, const std::string& map) {
+	typedef std::chrono::steady_clock Clock;
+	Result r;
+	r.map		= map;
+	r.method	= Method::NavMesh;
+	r.width		= grid.GetGridWidth();
+	r.height	= grid.GetGridHeight();
+
+	std::string meshFile = WriteMesh(grid, map);
+	auto start = Clock::now();
+	NavigationMesh* mesh = new NavigationMesh(meshFile);
+	r.setupTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+	NavigationGridSearch search;
+	NavigationPath path;
+	mesh->FindPath(grid.GetCellCentre(queries[0].from), grid.GetCellCentre(queries[0].to), path, search);
+
+	std::vector<float> times;
+	times.reserve(queries.size());
+	double expanded		= 0.0;
+	double allocations	= 0.0;
+	double length		= 0.0;
+	for (const Query& q : queries) {
+		Vector3 from	= grid.GetCellCentre(q.from);
+		Vector3 to		= grid.GetCellCentre(q.to);
+		path.Clear();
+		unsigned int expandedBefore		= search.GetExpanded();
+		unsigned int allocationsBefore	= AllocationCounter::GetCount();
+
+		auto start = Clock::now();
+		bool found = mesh->FindPath(from, to, path, search);
+		times.emplace_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+
+		allocations	+= AllocationCounter::GetCount() - allocationsBefore;
+		expanded	+= search.GetExpanded() - expandedBefore;
+		if (found) {
+			r.found++;
+			length += PathLength(from, path);
+		}
+	}
+	delete mesh;
+	Summarise(r, times, expanded, allocations, length);
+	return r;
+}
+
+/*
+Each query builds a field to its goal from nothing, as a new goal would in
+the game, then steps along it from the start. Every cell that can reach
+the goal is taken off the open list once, so that's what's expanded.
+*/
+PathfindingBenchmark::Result PathfindingBenchmark::TestFlowField(const NavigationGrid& grid, const std::string& map) {
+	typedef std::chrono::steady_clock Clock;
+	Result r;
+	r.map		= map;
+	r.method	= Method::FlowField;
+	r.width		= grid.GetGridWidth();
+	r.height	= grid.GetGridHeight();
+
+	int cellCount	= grid.GetGridWidth() * grid.GetGridHeight();
+	int fieldCount	= (int)queries.size() / FlowFieldQueryDivisor;
+	fieldCount		= fieldCount < 1 ? 1 : fieldCount;
+
+	std::vector<float> times;
+	times.reserve(fieldCount);
+	double expanded		= 0.0;
+	double allocations	= 0.0;
+	double length		= 0.0;
+	for (int i = 0; i < fieldCount; ++i) {
+		const Query& q = queries[i];
+		unsigned int allocationsBefore = AllocationCounter::GetCount();
+
+		auto start = Clock::now();
+		FlowField* field = new FlowField(grid, q.to);
+		int steps = 0;
+		bool found = field->Reaches(q.from);
+		for (int cell = q.from; found && cell != q.to; cell = field->GetNextCell(cell)) {
+			steps++;
+		}
+		times.emplace_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+
+		allocations += AllocationCounter::GetCount() - allocationsBefore;
+		for (int c = 0; c < cellCount; ++c) {
+			expanded += field->Reaches(c) ? 1.0 : 0.0;
+		}
+		if (found) {
+			r.found++;
+			length += (double)steps * grid.GetNodeSize();
+		}
+		delete field;
+	}
+	Summarise(r, times, expanded, allocations, length);
+	return r;
+}
+
+void PathfindingBenchmark::Summarise(Result& r, std::vector<float>& times, double expanded, double allocations, double length) {
+	r.queries = (int)times.size();
+	if (times.empty()) {
+		return;
+	}
+	double total = 0.0;
+	for (float t : times) {
+		total += t;
+	}
+	std::sort(times.begin(), times.end());
+	size_t p99		= (times.size() * 99) / 100;
+	r.meanTime		= (float)(total / times.size());
+	r.medianTime	= times[times.size() / 2];
+	r.p99Time		= times[p99 < times.size() ? p99 : times.size() - 1];
+	r.maxTime		= times.back();
+	r.expanded		= (float)(expanded / times.size());
+	r.allocations	= (float)(allocations / times.size());
+	r.pathLength	= r.found > 0 ? (float)(length / r.found) : 0.0f;
+}
+
+//Waypoints are popped from the back, so that's where the path starts
+float PathfindingBenchmark::PathLength(const Vector3& from, const NavigationPath& path) {
+	float length	= 0.0f;
+	Vector3 last	= from;
+	for (int i = path.Size() - 1; i >= 0; --i) {
+		length	+= (path.GetWaypoint(i) - last).Length();
+		last	= path.GetWaypoint(i);
+	}
+	return length;
+}
+
+/*
+A maze carved by a depth first walk between the odd cells, so there's
+exactly one way between any two of them, with one in ten of the walls
+left between two corridors knocked through afterwards, so there are loops
+and choices to be made, as in a real level.
+*/
+std::string PathfindingBenchmark::WriteMaze(int size) {
+	int width = (size < 5 ? 5 : size) | 1;
+	std::vector<char> cells(width * width, 'x');
+	auto at = [&](int x, int y) -> char& {
+		return cells[y * width + x];
+	};
+	const int dx[4] = { 0, 0, -2, 2 };
+	const int dy[4] = { -2, 2, 0, 0 };
+
+	std::vector<std::pair<int, int>> stack;
+	stack.push_back({ 1, 1 });
+	at(1, 1) = '.';
+	while (!stack.empty()) {
+		int x = stack.back().first;
+		int y = stack.back().second;
+		int options[4];
+		int optionCount = 0;
+		for (int i = 0; i < 4; ++i) {
+			int nx = x + dx[i];
+			int ny = y + dy[i];
+			if (nx > 0 && ny > 0 && nx < width - 1 && ny < width - 1 && at(nx, ny) == 'x') {
+				options[optionCount++] = i;
+			}
+		}
+		if (optionCount == 0) {
+			stack.pop_back();
+			continue;
+		}
+		int i = options[std::uniform_int_distribution<int>(0, optionCount - 1)(random)];
+		at(x + dx[i] / 2, y + dy[i] / 2)	= '.';
+		at(x + dx[i], y + dy[i])			= '.';
+		stack.push_back({ x + dx[i], y + dy[i] });
+	}
+
+	std::uniform_int_distribution<int> braid(0, 9);
+	for (int y = 1; y < width - 1; ++y) {
+		for (int x = 1; x < width - 1; ++x) {
+			if (at(x, y) != 'x') {
+				continue;
+			}
+			bool across	= at(x - 1, y) == '.' && at(x + 1, y) == '.';
+			bool down	= at(x, y - 1) == '.' && at(x, y + 1) == '.';
+			if ((across || down) && braid(random) == 0) {
+				at(x, y) = '.';
+			}
+		}
+	}
+
+	std::string filename = "PathBenchmarkMaze" + std::to_string(width) + ".txt";
+	std::ofstream file(Assets::DATADIR + filename);
+	file << MazeNodeSize << "\n" << width << "\n" << width << "\n";
+	for (int y = 0; y < width; ++y) {
+		file.write(&cells[y * width], width);
+		file << "\n";
+	}
+	return filename;
+}
+
+/*
+Two triangles for every cell that isn't a wall, sharing corners with the
+cells around them, so the mesh covers exactly what the grid does. It's in
+NavigationMesh's text format, so it's built the way any mesh would be.
+*/
+std::string PathfindingBenchmark::WriteMesh(const NavigationGrid& grid, const std::string& mapFile) {
+	int width		= grid.GetGridWidth();
+	int height		= grid.GetGridHeight();
+	float nodeSize	= (float)grid.GetNodeSize();
+	const GridNode* nodes = grid.GetNodes();
+
+	std::vector<int> cornerVertex((width + 1) * (height + 1), -1);
+	std::vector<Vector3> vertices;
+	std::vector<int> indices;
+	auto corner = [&](int x, int y) {
+		int& v = cornerVertex[y * (width + 1) + x];
+		if (v < 0) {
+			v = (int)vertices.size();
+			vertices.emplace_back(Vector3(x * nodeSize, 0, y * nodeSize));
+		}
+		return v;
+	};
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (nodes[y * width + x].type == 'x') {
+				continue;
+			}
+			int a = corner(x, y);
+			int b = corner(x + 1, y);
+			int c = corner(x + 1, y + 1);
+			int d = corner(x, y + 1);
+			int tris[6] = { a, b, c, a, c, d };
+			indices.insert(indices.end(), tris, tris + 6);
+		}
+	}
+
+	std::string filename = mapFile.substr(0, mapFile.find_last_of('.')) + ".navmesh";
+	std::ofstream file(Assets::DATADIR + filename);
+	file << vertices.size() << "\n" << indices.size() << "\n";
+	for (const Vector3& v : vertices) {
+		file << v.x << " " << v.y << " " << v.z << "\n";
+	}
+	for (int i : indices) {
+		file << i << "\n";
+	}
+	return filename;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "NavigationGrid.h"
+#include "NavigationMesh.h"
+#include <vector>
+#include <string>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Times every way there is of finding a path on the same random pairs
+		of floor cells, on LevelLayout.txt and on generated mazes of each size
+		asked for, so the one to use can be picked for how big the maps are.
+		Grids are searched cell by cell, and through their clusters when
+		they're big enough to have them. A navigation mesh of two triangles
+		for every floor cell is written out alongside each map and searched
+		too. Flow fields are built once for each goal, so they're charged
+		the whole build, plus following the field back from the start.
+
+		Every query's timed on its own, for the mean and the worst of them,
+		and counts the nodes its search took off the open list, and how many
+		times it allocated.
+		*/
+		class PathfindingBenchmark {
+		public:
+			enum class Method {
+				GridAStar,
+				GridClusters,
+				NavMesh,
+				FlowField
+			};
+
+			struct Result {
+				std::string	map;
+				Method		method;
+				int			width			= 0;
+				int			height			= 0;
+				int			queries			= 0;
+				int			found			= 0;
+				float		setupTime		= 0.0f; //ms, loading and building whatever the method needs
+				float		meanTime		= 0.0f; //us per query
+				float		medianTime		= 0.0f;
+				float		p99Time			= 0.0f;
+				float		maxTime			= 0.0f;
+				float		expanded		= 0.0f; //per query
+				float		allocations		= 0.0f;
+				float		pathLength		= 0.0f; //world units, over the paths found
+			};
+
+			PathfindingBenchmark(int queries = 2000, unsigned int seed = 1);
+
+			//Every method on LevelLayout.txt, then on a maze of each size, printed
+			//as they finish, and written out as CSV
+			void RunAll(const std::vector<int>& mazeSizes, const std::string& csvFile = "PathfindingBenchmark.csv");
+
+			const std::vector<Result>& GetResults() const {
+				return results;
+			}
+
+			static const char* GetMethodName(Method m);
+
+			//Flow fields cost a whole grid's search each, so get fewer goals than this
+			static const int FlowFieldQueryDivisor	= 10;
+			static const int MazeNodeSize			= 10;
+
+		protected:
+			struct Query {
+				int from;
+				int to;
+			};
+
+			void	RunMap(const std::string& mapFile);
+			void	MakeQueries(const NavigationGrid& grid);
+
+			Result	TestGrid(NavigationGrid& grid, const std::string& map, Method method, float setupTime);
+			Result	TestMesh(const NavigationGrid& grid, const std::string& map);
+			Result	TestFlowField(const NavigationGrid& grid, const std::string& map);
+			void	Summarise(Result& r, std::vector<float>& times, double expanded, double allocations, double length);
+
+			//Mazes and meshes go in the data directory, so they can be loaded like any other
+			std::string	WriteMaze(int size);
+			std::string	WriteMesh(const NavigationGrid& grid, const std::string& mapFile);
+
+			static float PathLength(const Vector3& from, const NavigationPath& path);
+
+			int					queryCount;
+			std::mt19937		random;
+			std::vector<Query>	queries;
+			std::vector<Result>	results;
+		};
+	}
+}
@@ -0,0 +1,55 @@
+#include "PerceptionSystem.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float PerceptionSystem::VisibilityLifetime	= 0.25f;
+const float PerceptionSystem::ForgetAfter			= 2.0f;
+const float PerceptionSystem::EyeHeight			= 2.0f;
+
+PerceptionSystem::PerceptionSystem(const GameWorld& world, CollisionLayer sightLayer) : world(world) {
+	this->sightLayer	= sightLayer;
+	time				= 0.0f;
+}
+
+bool PerceptionSystem::CanSee(GameObject* viewer, GameObject* target) {
+	Visibility& v = pairs[Pair(viewer, target)];
+	v.askedAt = time;
+	if (!v.queued && (v.checkedAt < 0.0f || time - v.checkedAt > VisibilityLifetime)) {
+		v.queued = true;
+		queue.push_back(Pair(viewer, target));
+	}
+	return v.visible;
+}
+
+void PerceptionSystem::Update(float dt) {
+	time += dt;
+	int rays = 0;
+	while (rays < RaysPerFrame && !queue.empty()) {
+		Pair p = queue.front();
+		queue.pop_front();
+
+		auto i = pairs.find(p);
+		if (i == pairs.end()) {
+			continue;
+		}
+		Visibility& v = i->second;
+		v.queued = false;
+		if (time - v.askedAt > ForgetAfter) {
+			pairs.erase(i); //nothing wants to know any more, and it might not even be there
+			continue;
+		}
+		Vector3 eye(0, EyeHeight, 0);
+		v.visible	= world.LineOfSight(p.first->GetTransform().GetPosition() + eye,
+						p.second->GetTransform().GetPosition() + eye, sightLayer);
+		v.checkedAt	= time;
+		rays++;
+	}
+}
+
+void PerceptionSystem::Clear() {
+	pairs.clear();
+	queue.clear();
+}
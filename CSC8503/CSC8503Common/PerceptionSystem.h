@@ -0,0 +1,56 @@
+#pragma once
+#include "CollisionLayer.h"
+#include <map>
+#include <deque>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameWorld;
+		class GameObject;
+
+		/*
+		Whether one object can see another, for the AI, without every agent
+		casting a ray at every other agent whenever it wants to know. Each
+		answer's kept for VisibilityLifetime seconds, and once it's too old
+		the pair goes on the back of a queue to be checked again, with
+		Update checking no more than RaysPerFrame of them a frame - so
+		however many agents there are, they take turns, and the cost of the
+		rays stays the same. Until a pair's first check, it can't see.
+
+		Sight's only blocked by the level itself, on whichever layers
+		sightLayer doesn't ignore. Pairs that haven't been asked about for a
+		while are dropped without being checked, so an object that's gone
+		won't be looked at again once nothing's still asking about it.
+		*/
+		class PerceptionSystem {
+		public:
+			PerceptionSystem(const GameWorld& world, CollisionLayer sightLayer = CollisionLayer::RAY);
+
+			bool	CanSee(GameObject* viewer, GameObject* target);
+
+			void	Update(float dt);
+			void	Clear();
+
+			static const int	RaysPerFrame = 8;
+			static const float	VisibilityLifetime;
+			static const float	ForgetAfter;
+			static const float	EyeHeight;
+
+		protected:
+			typedef std::pair<GameObject*, GameObject*> Pair;
+
+			struct Visibility {
+				bool	visible		= false;
+				bool	queued		= false;
+				float	checkedAt	= -1.0f; //never, if it's negative
+				float	askedAt		= 0.0f;
+			};
+
+			const GameWorld&			world;
+			CollisionLayer				sightLayer;
+			std::map<Pair, Visibility>	pairs;
+			std::deque<Pair>			queue;
+			float						time;
+		};
+	}
+}
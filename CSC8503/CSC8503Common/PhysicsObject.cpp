@@ -16,6 +16,19 @@ PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume*
 	resolveBySpring = false;
 	applyLinearFriction = false;
 	applyAngularFriction = true;
+
+	sleepTimer		= 0.0f;
+	canSleep		= true;
+	wakesOnContact	= false;
+	wakeRequested	= false;
+
+	continuousCollision = false;
+	smallObjectGrid = false;
+	kinematic			= false;
+	grounded			= false;
+
+	angularFactor	= Vector3(1, 1, 1);
+	inertiaDirty	= true;
 }
 
 PhysicsObject::~PhysicsObject()	{
@@ -24,14 +37,17 @@ PhysicsObject::~PhysicsObject()	{
 
 void PhysicsObject::ApplyAngularImpulse(const Vector3& force) {
 	angularVelocity += inverseInteriaTensor * force;
+	wakeRequested = true;
 }
 
 void PhysicsObject::ApplyLinearImpulse(const Vector3& force) {
 	linearVelocity += force * inverseMass;
+	wakeRequested = true;
 }
 
 void PhysicsObject::AddForce(const Vector3& addedForce) {
 	force += addedForce;
+	wakeRequested = true;
 }
 
 void PhysicsObject::AddForceAtPosition(const Vector3& addedForce, const Vector3& position) {
@@ -39,10 +55,12 @@ void PhysicsObject::AddForceAtPosition(const Vector3& addedForce, const Vector3&
 
 	force  += addedForce;
 	torque += Vector3::Cross(localPos, addedForce);
+	wakeRequested = true;
 }
 
 void PhysicsObject::AddTorque(const Vector3& addedTorque) {
 	torque += addedTorque;
+	wakeRequested = true;
 }
 
 void PhysicsObject::ClearForces() {
@@ -60,6 +78,7 @@ void PhysicsObject::InitCubeInertia() {
 	inverseInertia.x = (12.0f * inverseMass) / (dimsSqr.y + dimsSqr.z);
 	inverseInertia.y = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.z);
 	inverseInertia.z = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.y);
+	inertiaDirty = true;
 }
 
 void PhysicsObject::InitSphereInertia() {
@@ -67,6 +86,7 @@ void PhysicsObject::InitSphereInertia() {
 	float i			= 2.5f * inverseMass / (radius*radius);
 
 	inverseInertia	= Vector3(i, i, i);
+	inertiaDirty	= true;
 }
 
 void PhysicsObject::InitHollowSphereInertia() {
@@ -74,13 +94,30 @@ void PhysicsObject::InitHollowSphereInertia() {
 	float i			= 1.5 * inverseMass / (radius*radius);
 
 	inverseInertia = Vector3(i, i, i);
+	inertiaDirty = true;
 }
 
+/*
+Static objects (with no inverse inertia) and fully locked ones have a
+zero tensor whichever way they face, so they only ever need it working
+out the once. Locked axes are masked out on both sides, so nothing
+multiplied through the tensor can change their angular velocity.
+*/
 void PhysicsObject::UpdateInertiaTensor() {
 	Quaternion q = transform->GetOrientation();
-	
+	if (!inertiaDirty && (q == tensorOrientation || IsRotationLocked() || inverseInertia == Vector3())) {
+		return;
+	}
+	tensorOrientation	= q;
+	inertiaDirty		= false;
+
+	if (IsRotationLocked()) {
+		inverseInteriaTensor = Matrix3::Scale(Vector3());
+		return;
+	}
 	Matrix3 invOrientation	= Matrix3(q.Conjugate());
 	Matrix3 orientation		= Matrix3(q);
+	Matrix3 locks			= Matrix3::Scale(angularFactor);
 
-	inverseInteriaTensor = orientation * Matrix3::Scale(inverseInertia) *invOrientation;
+	inverseInteriaTensor = locks * (orientation * Matrix3::Scale(inverseInertia) *invOrientation) * locks;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Matrix3.h"
+#include "../../Common/Quaternion.h"
+#include "ComponentPool.h"
 
 using namespace NCL::Maths;
 
@@ -10,7 +12,7 @@ namespace NCL {
 	namespace CSC8503 {
 		class Transform;
 
-		class PhysicsObject	{
+		class PhysicsObject : public PooledComponent<PhysicsObject> {
 		public:
 			PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume);
 			~PhysicsObject();
@@ -87,6 +89,84 @@ namespace NCL {
 				return resolveBySpring;
 			}
 
+			void SetCanSleep(bool s) {
+				canSleep = s;
+			}
+
+			bool CanSleep() const {
+				return canSleep;
+			}
+
+			//Objects that should disturb anything they touch, even as a trigger
+			void SetWakesOnContact(bool w) {
+				wakesOnContact = w;
+			}
+
+			bool WakesOnContact() const {
+				return wakesOnContact;
+			}
+
+			//Fast movers are swept against the static world each step, so they
+			//can't tunnel through thin walls
+			void SetContinuousCollision(bool c) {
+				continuousCollision = c;
+			}
+
+			bool UsesContinuousCollision() const {
+				return continuousCollision;
+			}
+
+			//Lots of small, fast objects (like projectiles) go in the physics system's
+			//grid rather than its tree. Has to be set before the object's added to the world
+			void SetUseSmallObjectGrid(bool s) {
+				smallObjectGrid = s;
+			}
+
+			bool UsesSmallObjectGrid() const {
+				return smallObjectGrid;
+			}
+
+			//Kinematic bodies are moved through the world by the CharacterController,
+			//rather than by the solver. Forces and impulses still change their
+			//velocity, but contacts never push them - only what they walk into
+			void SetKinematic(bool k) {
+				kinematic = k;
+			}
+
+			bool IsKinematic() const {
+				return kinematic;
+			}
+
+			//Whether the controller left a kinematic body standing on something
+			bool IsGrounded() const {
+				return grounded;
+			}
+
+			void SetGrounded(bool g) {
+				grounded = g;
+			}
+
+			float GetSleepTimer() const {
+				return sleepTimer;
+			}
+
+			void SetSleepTimer(float t) {
+				sleepTimer = t;
+			}
+
+			//Set whenever a force or impulse is applied, so sleeping objects know to wake up
+			bool IsWakeRequested() const {
+				return wakeRequested;
+			}
+
+			void RequestWake() {
+				wakeRequested = true;
+			}
+
+			void ClearWakeRequest() {
+				wakeRequested = false;
+			}
+
 			void ApplyAngularImpulse(const Vector3& force);
 			void ApplyLinearImpulse(const Vector3& force);
 			
@@ -110,12 +190,29 @@ namespace NCL {
 			void InitSphereInertia();
 			void InitHollowSphereInertia();
 
+			//Only does any work if the object has turned, or its inertia has
+			//changed, since the last time
 			void UpdateInertiaTensor();
 
 			Matrix3 GetInertiaTensor() const {
 				return inverseInteriaTensor;
 			}
 
+			//Locked world axes can't be spun by any force, torque or impulse, for
+			//characters that have their facing set by gameplay code instead
+			void SetRotationLocks(bool x, bool y, bool z) {
+				angularFactor	= Vector3(x ? 0.0f : 1.0f, y ? 0.0f : 1.0f, z ? 0.0f : 1.0f);
+				inertiaDirty	= true;
+			}
+
+			Vector3 GetAngularFactor() const {
+				return angularFactor;
+			}
+
+			bool IsRotationLocked() const {
+				return angularFactor == Vector3();
+			}
+
 		protected:
 			const CollisionVolume* volume;
 			Transform*		transform;
@@ -133,11 +230,23 @@ namespace NCL {
 			Vector3 torque;
 			Vector3 inverseInertia;
 			Matrix3 inverseInteriaTensor;
+			Vector3 angularFactor;		//1 on free axes, 0 on locked ones
+			Quaternion tensorOrientation;	//what inverseInteriaTensor was last worked out for
+			bool	inertiaDirty;
 
 			bool affectedByGravity;
 			bool resolveBySpring;
 			bool applyLinearFriction;
 			bool applyAngularFriction;
+
+			float sleepTimer;
+			bool canSleep;
+			bool wakesOnContact;
+			bool wakeRequested;
+			bool continuousCollision;
+			bool smallObjectGrid;
+			bool kinematic;
+			bool grounded;
 		};
 	}
 }
@@ -8,8 +8,13 @@
 #include "Spring.h"
 
 #include "Debug.h"
+#include "JobSystem.h"
+#include "FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
 
 #include <functional>
+#include <cmath>
+#include <algorithm>
 using namespace NCL;
 using namespace CSC8503;
 
@@ -20,7 +25,32 @@ and the forces that are added to objects to change those positions
 
 */
 
-PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
+namespace {
+	//The character controller keeps kinematic bodies out of the static world,
+	//and two kinematic bodies can't push each other, so the solver has nothing to do
+	bool ControllerHandlesPair(const GameObject& a, const GameObject& b) {
+		bool lockedA = a.GetPhysicsObject()->IsKinematic() || a.IsStatic();
+		bool lockedB = b.GetPhysicsObject()->IsKinematic() || b.IsStatic();
+		return lockedA && lockedB;
+	}
+}
+
+/*
+Each kernel's a lambda, so everything it does to a batch of bodies is
+inlined into the one loop - the only indirect call is per batch.
+*/
+template<class F>
+void PhysicsSystem::ParallelBodies(int count, int minCount, F kernel) {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (useParallelIntegration && jobs && count >= minCount) {
+		jobs->ParallelFor(count, bodyBatchSize, kernel);
+	}
+	else {
+		kernel(0, count, 0);
+	}
+}
+
+PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g), characterController(g)	{
 	applyGravity	= true;
 	useBroadPhase	= true;	
 	warmStart		= true;
@@ -28,14 +58,32 @@ PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
 	globalDamping	= 0.995f;
 	linearDamping	= 0.5f;
 	SetGravity(Vector3(0.0f, -30.0f, 0.0f));
+
+	stepMode	= StepMode::Fixed;
+	fixedDT		= 1.0f / 120.0f;
+	stepDT		= fixedDT;
+	maxSubsteps	= 8;
+
+	gameWorld.AddObjectListener(this,
+		[&](GameObject* g) { AddToBroadphase(g); },
+		[&](GameObject* g) { RemoveFromBroadphase(g); RemoveSmallObject(g); RemoveFromIsland(g); }
+	);
 }
 
-PhysicsSystem::~PhysicsSystem()	{}
+PhysicsSystem::~PhysicsSystem()	{
+	gameWorld.RemoveObjectListener(this);
+	gameWorld.SetDynamicTree(nullptr);
+}
 
 void PhysicsSystem::SetGravity(const Vector3& g) {
 	gravity = g;
 }
 
+void PhysicsSystem::SetFixedRate(int hz, int maxSteps) {
+	fixedDT		= 1.0f / (float)hz;
+	maxSubsteps	= maxSteps;
+}
+
 /*
 
 If the 'game' is ever reset, the PhysicsSystem must be
@@ -47,10 +95,57 @@ any collisions they are in.
 
 */
 void PhysicsSystem::Clear() {
-	allCollisions.clear();
+	allCollisions.Clear();
+	triggerOverlaps.Clear();
+	contactSolver.Clear();
+	constraintSolver.Clear();
+	dynamicTree.Clear();
+	staticNeighbours.clear();
+	gameWorld.OperateOnContents(
+		[](GameObject* g) {
+			g->SetBroadphaseID(-1);
+			g->SetIslandLink(nullptr);
+		}
+	);
 	warmStart = true;
 }
 
+//Copying into a cache that's already grown to size doesn't allocate
+void PhysicsSystem::SaveState(SavedState& s) const {
+	s.collisions.CopyFrom(allCollisions);
+	s.triggers.CopyFrom(triggerOverlaps);
+	s.dTOffset = dTOffset;
+}
+
+/*
+The contact manifolds aren't saved, as copying their lookup would allocate
+every time - instead they're dropped, and the resimulated steps start
+from cold, as do GJK's separating axes. The dynamic tree's built again
+from the restored positions, in the world's order, as its shape is what
+decides the order the pairs are solved in - left as it was, resimulating
+the same ticks twice wouldn't come out the same.
+*/
+void PhysicsSystem::RestoreState(const SavedState& s) {
+	allCollisions.CopyFrom(s.collisions);
+	triggerOverlaps.CopyFrom(s.triggers);
+	dTOffset = s.dTOffset;
+	contactSolver.Clear();
+
+	previousBroadphase.Clear();
+	broadphaseCollisions.Clear();
+	dynamicTree.Clear();
+	for (int i = 0; i < (int)staticNeighbours.size(); ++i) {
+		ForgetStaticNeighbours(i);
+	}
+	gameWorld.OperateOnContents(
+		[&](GameObject* g) {
+			g->SetBroadphaseID(-1);
+			g->UpdateBroadphaseAABB();
+			UpdateBroadphaseProxy(g);
+		}
+	);
+}
+
 /*
 
 This is the core of the physics engine update
@@ -72,15 +167,19 @@ int realHZ		= idealHZ;
 float realDT	= idealDT;
 
 void PhysicsSystem::Update(float dt) {	
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
+	ProfileScope scope("Physics");
+	MemoryTagScope tag(MemoryTag::Physics);
+	//There's no keyboard when running headless
+	const Keyboard* keyboard = Window::GetKeyboard();
+	if (keyboard && keyboard->KeyPressed(KeyboardKeys::B)) {
 		useBroadPhase = !useBroadPhase;
 		std::cout << "Setting broadphase to " << useBroadPhase << std::endl;
 	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::I)) {
+	if (keyboard && keyboard->KeyPressed(KeyboardKeys::I)) {
 		constraintIterationCount--;
 		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
 	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::O)) {
+	if (keyboard && keyboard->KeyPressed(KeyboardKeys::O)) {
 		constraintIterationCount++;
 		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
 	}
@@ -92,39 +191,82 @@ void PhysicsSystem::Update(float dt) {
 	GameTimer t;
 	t.GetTimeDeltaSeconds();
 
+	WakeRequestedObjects(); //Anything pushed by the game since the last update
+	GatherBodies();
+	constraintSolver.Update(gameWorld);
+
 	if (useBroadPhase) {
 		UpdateObjectAABBs();
 	}
-
-	while(dTOffset >= realDT) {
+	//The tree only stays up to date while the broadphase is running
+	gameWorld.SetDynamicTree(useBroadPhase ? &dynamicTree : nullptr);
+
+	//In fixed mode the step never changes, so every machine runs exactly the
+	//same simulation, and a slow frame just runs more substeps (up to a limit)
+	stepDT			= stepMode == StepMode::Fixed ? fixedDT : realDT;
+	int substeps	= 0;
+
+	while(dTOffset >= stepDT) {
+		if (stepMode == StepMode::Fixed && substeps >= maxSubsteps) {
+			//Too far behind to catch up, so drop the time rather than spiral
+			dTOffset = fmodf(dTOffset, stepDT);
+			break;
+		}
+		ProfileScope substep("Substep");
+		contactSolver.BeginStep();
 		if (useBroadPhase) {
-			BroadPhase();
+			{
+				ProfileScope phase("Broadphase");
+				BroadPhase();
+			}
+			ProfileScope phase("Narrowphase");
 			NarrowPhase();
 		}
 		else {
+			ProfileScope phase("Collision Detection");
 			BasicCollisionDetection();
 		}
-		IntegrateAccel(realDT); //Update accelerations from external forces
+		IntegrateAccel(stepDT); //Update accelerations from external forces
+
+		{
+			ProfileScope solve("Solver");
+			//Contacts found by the narrowphase are solved together, starting
+			//from the impulses that held them apart last step
+			contactSolver.PreStep(stepDT);
+			for (int i = 0; i < contactSolver.GetIterationCount(); ++i) {
+				contactSolver.SolveVelocities();
+			}
 
-		//This is our simple iterative solver - 
-		//we just run things multiple times, slowly moving things forward
-		//and then rechecking that the constraints have been met		
-		float constraintDt = realDT /  (float)constraintIterationCount;
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
+			//This is our simple iterative solver - 
+			//we just run things multiple times, slowly moving things forward
+			//and then rechecking that the constraints have been met		
+			float constraintDt = stepDT /  (float)constraintIterationCount;
+			for (int i = 0; i < constraintIterationCount; ++i) {
+				UpdateConstraints(constraintDt);	
+			}
 		}
-		IntegrateVelocity(realDT); //update positions from new velocity changes
+		ProfileScope integrate("Integrate");
+		IntegrateVelocity(stepDT); //update positions from new velocity changes
 
-		dTOffset -= realDT;
+		dTOffset -= stepDT;
+		substeps++;
 	}
 
 	ClearForces();	//Once we've finished with the forces, reset them to zero
 
-	UpdateCollisionList(); //Remove any old collisions
+	UpdateCollisionList(substeps > 0); //Remove any old collisions
+
+	WakeRequestedObjects(); //Anything hit by an awake object this update
+	if (useSleeping) {
+		UpdateSleeping(dt);
+	}
 
 	t.Tick();
 	float updateTime = t.GetTimeDeltaSeconds();
-	if (!warmStart) {
+	if (stepMode == StepMode::Fixed) {
+		warmStart = false;
+	}
+	else if (!warmStart) {
 		//Uh oh, physics is taking too long...
 		if (updateTime > realDT) {
 			realHZ /= 2;
@@ -152,7 +294,7 @@ void PhysicsSystem::Update(float dt) {
 
 /*
 Later on we're going to need to keep track of collisions
-across multiple frames, so we store them in a set.
+across multiple frames, so we store them in a pair cache.
 
 The first time they are added, we tell the objects they are colliding.
 The frame they are to be removed, we tell them they're no longer colliding.
@@ -160,34 +302,82 @@ The frame they are to be removed, we tell them they're no longer colliding.
 From this simple mechanism, we we build up gameplay interactions inside the
 OnCollisionBegin / OnCollisionEnd functions (removing health when hit by a 
 rocket launcher, gaining a point when the player hits the gold coin, and so on).
+
+The list only records what happened as an event, so nothing gameplay does
+in response can change the pair cache while it's being walked. The events
+are handed out once the list is up to date.
 */
-void PhysicsSystem::UpdateCollisionList() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = allCollisions.begin(); i != allCollisions.end(); ) {
-		if (i->a->ToRemove() || i->b->ToRemove()) {
-			i = allCollisions.erase(i);
+void PhysicsSystem::UpdateCollisionList(bool stepped) {
+	collisionEvents.Clear();
+
+	allCollisions.RemoveIf(
+		[&](CollisionDetection::CollisionInfo& i) {
+			if (i.a->ToRemove() || i.b->ToRemove() || !i.a->IsActive() || !i.b->IsActive()) {
+				return true;
+			}
+			bool begun = i.framesLeft == numCollisionFrames;
+			i.framesLeft = i.framesLeft - 1;
+			if (i.framesLeft < 0) {
+				collisionEvents.Push(CollisionEvent::End, i.a, i.b, i.point);
+				return true;
+			}
+			collisionEvents.Push(begun ? CollisionEvent::Begin : CollisionEvent::Stay, i.a, i.b, i.point);
+			return false;
 		}
-		else {
-			if ((*i).framesLeft == numCollisionFrames) {
-				i->a->OnCollisionBegin(i->b, i->point);
-				i->b->OnCollisionBegin(i->a, i->point);
+	);
+	UpdateTriggerOverlaps(stepped);
+
+	DispatchCollisionEvents();
+}
+
+/*
+Trigger overlaps don't hang around for a few frames the way contacts do,
+as a boolean test doesn't flicker in and out like a contact can - a pair
+ends the first update it isn't seen in. An update that ran no substeps
+hasn't looked, though, so everything just carries on overlapping.
+*/
+void PhysicsSystem::UpdateTriggerOverlaps(bool stepped) {
+	triggerOverlaps.RemoveIf(
+		[&](CollisionDetection::CollisionInfo& i) {
+			if (i.a->ToRemove() || i.b->ToRemove() || !i.a->IsActive() || !i.b->IsActive()) {
+				return true;
 			}
-			(*i).framesLeft = (*i).framesLeft - 1;
-			if ((*i).framesLeft < 0) {
-				i->a->OnCollisionEnd(i->b);
-				i->b->OnCollisionEnd(i->a);
-				i = allCollisions.erase(i);
+			if (!stepped) {
+				collisionEvents.Push(CollisionEvent::Stay, i.a, i.b, i.point);
+				return false;
 			}
-			else {
-				++i;
+			if (i.framesLeft == TriggerLeft) {
+				collisionEvents.Push(CollisionEvent::End, i.a, i.b, i.point);
+				return true;
 			}
+			collisionEvents.Push(i.framesLeft == TriggerEntered ? CollisionEvent::Begin : CollisionEvent::Stay, i.a, i.b, i.point);
+			i.framesLeft = TriggerLeft;
+			return false;
+		}
+	);
+}
+
+void PhysicsSystem::DispatchCollisionEvents() {
+	for (const CollisionEvent& e : collisionEvents.GetEvents()) {
+		if (e.type == CollisionEvent::Begin) {
+			e.a->OnCollisionBegin(e.b, e.point);
+			e.b->OnCollisionBegin(e.a, e.point);
+		}
+		else if (e.type == CollisionEvent::End) {
+			e.a->OnCollisionEnd(e.b);
+			e.b->OnCollisionEnd(e.a);
 		}
 	}
+	collisionEvents.Dispatch();
 }
 
 void PhysicsSystem::UpdateObjectAABBs() {
-	gameWorld.OperateOnContents(
-		[](GameObject* g) {
-			g->UpdateBroadphaseAABB();
+	const std::vector<GameObject*>& objects = gameWorld.GetGameObjects();
+	ParallelBodies((int)objects.size(), parallelBodiesMinCount,
+		[&objects](int first, int last, int worker) {
+			for (int i = first; i < last; ++i) {
+				objects[i]->UpdateBroadphaseAABB();
+			}
 		}
 	);
 }
@@ -197,9 +387,9 @@ void PhysicsSystem::UpdateObjectAABBs() {
 This is how we'll be doing collision detection in tutorial 4.
 We step thorugh every pair of objects once (the inner for loop offset 
 ensures this), and determine whether they collide, and if so, add them
-to the collision set for later processing. The set will guarantee that
+to the collision cache for later processing. The cache will guarantee that
 a particular pair will only be added once, so objects colliding for
-multiple frames won't flood the set with duplicates.
+multiple frames won't flood the cache with duplicates.
 */
 void PhysicsSystem::BasicCollisionDetection() {
 	std::vector<GameObject*>::const_iterator first;
@@ -214,8 +404,22 @@ void PhysicsSystem::BasicCollisionDetection() {
 			if ((*j)->GetPhysicsObject() == nullptr) {
 				continue;
 			}
+			if ((*i)->IsStatic() && (*j)->IsStatic()) {
+				continue;
+			}
+			if (GameObject::OverlapOnlyPair(**i, **j)) {
+				if (CollisionDetection::GetPairTest((*i)->GetBoundingVolume(), (*j)->GetBoundingVolume())) {
+					GJKShape shapeA = GJKShape::FromVolume(*(*i)->GetBoundingVolume(), (*i)->GetTransform());
+					GJKShape shapeB = GJKShape::FromVolume(*(*j)->GetBoundingVolume(), (*j)->GetTransform());
+					Vector3 searchDir;
+					if (CollisionDetection::ShapesOverlap(shapeA, shapeB, searchDir)) {
+						AddTriggerOverlap(*i, shapeA, *j, shapeB);
+					}
+				}
+				continue;
+			}
 			CollisionDetection::CollisionInfo info;
-			if ((!(*i)->IsStatic() || !(*j)->IsStatic()) && CollisionDetection::ObjectIntersection(*i, *j, info)) {
+			if (CollisionDetection::ObjectIntersection(*i, *j, info)) {
 
 				bool triggerCollision = info.a->IsTrigger() || info.b->IsTrigger();
 				bool springCollision = info.a->GetPhysicsObject()->ResolveBySpring() || info.b->GetPhysicsObject()->ResolveBySpring();
@@ -223,11 +427,11 @@ void PhysicsSystem::BasicCollisionDetection() {
 				if (!triggerCollision && springCollision) {
 					ResolveSpringCollision(*info.a, *info.b, info.point);
 				}
-				else if (!triggerCollision) {
+				else if (!triggerCollision && !ControllerHandlesPair(*info.a, *info.b)) {
 					ImpulseResolveCollision(*info.a, *info.b, info.point);
 				}
 				info.framesLeft = numCollisionFrames;
-				allCollisions.insert(info);
+				allCollisions.Insert(info);
 			}
 		}
 	}
@@ -331,57 +535,236 @@ compare the collisions that we absolutely need to.
 */
 
 void PhysicsSystem::BroadPhase() {
-	broadphaseCollisions.clear();
-	Octree<GameObject*> tree(Vector3(1024, 1024, 1024), 7, 6);
+	//Last substep's pairs are kept around, so that each pair that survives
+	//can start GJK from the direction it finished on
+	broadphaseCollisions.Swap(previousBroadphase);
+	broadphaseCollisions.Clear();
 
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetAwakeObjectIterators(first, last);
+
+	//Objects have moved since the last substep, but most of them will still be
+	//inside their fat AABB, so this only touches the tree for the few that aren't
 	for (auto i = first; i != last; ++i) {
+		UpdateBroadphaseProxy(*i);
+	}
+	BuildSmallObjectGrid();
+
+	Octree<GameObject*>* staticTree = gameWorld.GetStaticTree();
+	const CollisionLayerMatrix& layers = gameWorld.GetLayerMatrix();
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* object = *i;
+		if (UsesSmallObjectGrid(object)) {
+			SmallObjectBroadPhase(object, staticTree);
+			continue;
+		}
+		if (object->GetBroadphaseID() < 0) {
+			continue;
+		}
+		//Pairs are filtered by layer here, so the narrowphase never sees them
+		uint32_t layerMask = layers.GetMask(object->GetLayer());
 		Vector3 halfSizes;
-		if ((*i)->IsStatic() || !(*i)->GetBroadphaseAABB(halfSizes)) {
+		object->GetBroadphaseAABB(halfSizes);
+		Vector3 pos = object->GetTransform().GetPosition();
+
+		CollisionDetection::CollisionInfo info;
+		dynamicTree.Query(pos, halfSizes,
+			[&](GameObject* other) {
+				if (other == object || other->ToRemove() || !other->IsActive() || !(layerMask & LayerBit(other->GetLayer()))) {
+					return;
+				}
+				//Two awake objects will find each other, so only keep one side of the pair
+				if (!other->IsSleeping() && other->GetWorldID() < object->GetWorldID()) {
+					return;
+				}
+				info.a = min(object, other);
+				info.b = max(object, other);
+				AddBroadphasePair(info);
+			}
+		);
+		//Small objects only look for sleeping objects in the tree, so awake ones
+		//always take their side of the pair from here
+		smallObjectGrid.Query(pos, halfSizes,
+			[&](GameObject* other) {
+				if (!(layerMask & LayerBit(other->GetLayer()))) {
+					return;
+				}
+				info.a = min(object, other);
+				info.b = max(object, other);
+				AddBroadphasePair(info);
+			}
+		);
+
+		if (!staticTree) {
 			continue;
 		}
-		Vector3 pos = (*i)->GetTransform().GetPosition();
-		tree.Insert(*i, pos, halfSizes);
+		//Each static object only comes back once, no matter how many leaves
+		//it spans, so large level pieces don't flood the pair cache. What
+		//comes back is only a candidate for the fat AABB, so each one is
+		//checked against the object's own box here
+		const StaticNeighbours& neighbours = GetStaticNeighbours(object, *staticTree);
+		for (const OctreeEntry<GameObject*>& e : neighbours.entries) {
+			GameObject* other = e.object;
+			if (!(layerMask & LayerBit(other->GetLayer())) || !CollisionDetection::AABBTest(pos, e.pos, halfSizes, e.size)) {
+				continue;
+			}
+			info.a = min(object, other);
+			info.b = max(object, other);
+			if (!info.a->IsStatic() || !info.b->IsStatic()) {
+				AddBroadphasePair(info);
+			}
+		}
 	}
 
-	tree.OperateOnContents(
-		[&](std::list<OctreeEntry<GameObject*>>& data) {
-			CollisionDetection::CollisionInfo info;
-			for (auto i = data.begin(); i != data.end(); ++i) {
-				for (auto j = std::next(i); j != data.end(); ++j) {
-					info.a = min((*i).object, (*j).object);
-					info.b = max((*i).object, (*j).object);
-					if (gameWorld.CollisionAllowed(info.a->GetLayer(), info.b->GetLayer()) &&  (!info.a->IsStatic() || !info.b->IsStatic())) {
-						broadphaseCollisions.insert(info);
-					}
-				}
+	Debug::SetNumBroadphaseCollisions(broadphaseCollisions.Size());
+}
+
+void PhysicsSystem::BuildSmallObjectGrid() {
+	smallObjectGrid.Clear();
+	for (GameObject* g : smallObjects) {
+		Vector3 halfSizes;
+		if (g->IsActive() && !g->ToRemove() && g->GetBroadphaseAABB(halfSizes)) {
+			smallObjectGrid.Add(g, g->GetTransform().GetPosition(), halfSizes);
+		}
+	}
+	smallObjectGrid.Build();
+}
+
+/*
+Small objects move far enough each substep that anything cached from the
+last one would be out of date, so the static tree is queried directly.
+*/
+void PhysicsSystem::SmallObjectBroadPhase(GameObject* object, Octree<GameObject*>* staticTree) {
+	Vector3 halfSizes;
+	if (object->IsStatic() || object->ToRemove() || !object->IsActive() || !object->GetBroadphaseAABB(halfSizes)) {
+		return;
+	}
+	uint32_t layerMask	= gameWorld.GetLayerMatrix().GetMask(object->GetLayer());
+	Vector3 pos			= object->GetTransform().GetPosition();
+
+	CollisionDetection::CollisionInfo info;
+	auto addPair = [&](GameObject* other) {
+		info.a = min(object, other);
+		info.b = max(object, other);
+		AddBroadphasePair(info);
+	};
+
+	dynamicTree.Query(pos, halfSizes,
+		[&](GameObject* other) {
+			if (other->IsSleeping() && !other->ToRemove() && other->IsActive() && (layerMask & LayerBit(other->GetLayer()))) {
+				addPair(other);
 			}
 		}
 	);
-
-	Octree<GameObject*>* staticTree = gameWorld.GetStaticTree();
-	std::list<OctreeEntry<GameObject*>> nodes;
-
-	tree.OperateOnContents(
-		[&](std::list<OctreeEntry<GameObject*>>& data) {
-			CollisionDetection::CollisionInfo info;
-			for (auto i = data.begin(); i != data.end(); ++i) {
-				nodes.clear();
-				staticTree->GetCollidingNodes(i->object, i->pos, i->size, nodes);
-				for (auto j = nodes.begin(); j != nodes.end(); ++j) {
-					info.a = min((*i).object, (*j).object);
-					info.b = max((*i).object, (*j).object);
-					if (gameWorld.CollisionAllowed(info.a->GetLayer(), info.b->GetLayer()) && (!info.a->IsStatic() || !info.b->IsStatic())) {
-						broadphaseCollisions.insert(info);
-					}
-				}
+	smallObjectGrid.Query(pos, halfSizes,
+		[&](GameObject* other) {
+			if (other == object || !(layerMask & LayerBit(other->GetLayer()))) {
+				return;
+			}
+			if (!other->IsSleeping() && other->GetWorldID() < object->GetWorldID()) {
+				return;
 			}
+			addPair(other);
 		}
 	);
 
-	Debug::SetNumBroadphaseCollisions(broadphaseCollisions.size());
+	if (!staticTree) {
+		return;
+	}
+	staticObjects.clear();
+	staticTree->GetCollidingObjects(pos, halfSizes, staticObjects);
+	for (GameObject* other : staticObjects) {
+		if (layerMask & LayerBit(other->GetLayer())) {
+			addPair(other);
+		}
+	}
+}
+
+/*
+Players only move a fraction of a unit each substep, so most substeps
+would find exactly the same static objects as the last one did. The
+static tree is only queried with the proxy's fat AABB, whenever the
+proxy has been reinserted into the dynamic tree, and every substep in
+between reuses what it found.
+*/
+const PhysicsSystem::StaticNeighbours& PhysicsSystem::GetStaticNeighbours(GameObject* g, Octree<GameObject*>& staticTree) {
+	int proxy = g->GetBroadphaseID();
+	if ((int)staticNeighbours.size() <= proxy) {
+		staticNeighbours.resize(proxy + 1);
+	}
+	StaticNeighbours& neighbours = staticNeighbours[proxy];
+	if (neighbours.staticVersion != gameWorld.GetStaticVersion()) {
+		Vector3 fatMin;
+		Vector3 fatMax;
+		dynamicTree.GetFatAABB(proxy, fatMin, fatMax);
+
+		neighbours.entries.clear();
+		staticTree.GetCollidingEntries((fatMin + fatMax) * 0.5f, (fatMax - fatMin) * 0.5f, neighbours.entries);
+		neighbours.staticVersion = gameWorld.GetStaticVersion();
+	}
+	return neighbours;
+}
+
+void PhysicsSystem::AddBroadphasePair(CollisionDetection::CollisionInfo& info) {
+	const CollisionDetection::CollisionInfo* previous = previousBroadphase.Find(info.a, info.b);
+	info.separatingAxis = previous ? previous->separatingAxis : Vector3();
+	broadphaseCollisions.Insert(info);
+}
+
+/*
+Dynamic objects are tracked in a persistent tree, rather than being thrown
+into a fresh Octree every substep. The world tells us whenever objects are
+added or removed, and anything whose static-ness or bounding volume changes
+afterwards is picked up the next time its proxy is updated.
+*/
+void PhysicsSystem::AddToBroadphase(GameObject* g) {
+	g->SetBroadphaseID(-1);
+	g->UpdateBroadphaseAABB();
+	if (UsesSmallObjectGrid(g)) {
+		smallObjects.emplace_back(g);
+		return;
+	}
+	UpdateBroadphaseProxy(g);
+}
+
+void PhysicsSystem::RemoveSmallObject(GameObject* g) {
+	auto i = std::find(smallObjects.begin(), smallObjects.end(), g);
+	if (i != smallObjects.end()) {
+		*i = smallObjects.back();
+		smallObjects.pop_back();
+	}
+}
+
+void PhysicsSystem::RemoveFromBroadphase(GameObject* g) {
+	if (g->GetBroadphaseID() >= 0) {
+		ForgetStaticNeighbours(g->GetBroadphaseID());
+		dynamicTree.Remove(g->GetBroadphaseID());
+		g->SetBroadphaseID(-1);
+	}
+}
+
+void PhysicsSystem::UpdateBroadphaseProxy(GameObject* g) {
+	Vector3 halfSizes;
+	if (g->IsStatic() || !g->IsActive() || UsesSmallObjectGrid(g) || !g->GetBroadphaseAABB(halfSizes)) {
+		RemoveFromBroadphase(g);
+		return;
+	}
+	Vector3 pos = g->GetTransform().GetPosition();
+	if (g->GetBroadphaseID() < 0) {
+		g->SetBroadphaseID(dynamicTree.Insert(g, pos, halfSizes));
+		ForgetStaticNeighbours(g->GetBroadphaseID());
+	}
+	else if (dynamicTree.Move(g->GetBroadphaseID(), pos, halfSizes)) {
+		ForgetStaticNeighbours(g->GetBroadphaseID());
+	}
+}
+
+void PhysicsSystem::ForgetStaticNeighbours(int proxy) {
+	if (proxy < (int)staticNeighbours.size()) {
+		staticNeighbours[proxy].staticVersion = -1;
+	}
 }
 
 /*
@@ -390,41 +773,386 @@ The broadphase will now only give us likely collisions, so we can now go through
 and work out if they are truly colliding, and if so, add them into the main collision list
 */
 void PhysicsSystem::NarrowPhase() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = broadphaseCollisions.begin(); i != broadphaseCollisions.end(); ++i) {
-		CollisionDetection::CollisionInfo info = *i;
+	GroupPairsByType();
+	CacheShapes();
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (useParallelNarrowPhase && jobs && (int)narrowPhaseOrder.size() >= parallelNarrowPhaseMinPairs) {
+		ParallelNarrowPhase();
+	}
+	else {
+		CollisionPairCache::iterator first = broadphaseCollisions.begin();
+		for (int i = 0; i < (int)narrowPhaseOrder.size(); ++i) {
+			CollisionPairCache::iterator pair = first + narrowPhaseOrder[i];
+			CollisionDetection::CollisionInfo info = *pair;
+
+			if (CollisionDetection::ObjectIntersection(narrowPhaseTests[i], info.a, shapeCache[info.a->GetShapeIndex()],
+				info.b, shapeCache[info.b->GetShapeIndex()], info)) {
+				ResolveCollision(info);
+			}
+			pair->separatingAxis = info.separatingAxis;
+		}
+	}
+	TriggerPhase();
+	ClearShapeCache();
+
+	Debug::SetNumNarrowphaseCollisions(allCollisions.Size() + triggerOverlaps.Size());
+}
+
+/*
+A counting sort of the pairs by which test they need, keeping the
+broadphase's order within each group, so the results only depend on the
+pairs themselves. Pairs that nothing can test are left out altogether,
+and trigger pairs that only need an overlap test are put to one side.
+*/
+void PhysicsSystem::GroupPairsByType() {
+	const int groupCount = CollisionDetection::VolumeSlots * CollisionDetection::VolumeSlots;
+	int groupStarts[groupCount + 1] = {};
+
+	narrowPhaseKeys.clear();
+	triggerPairs.clear();
+	for (const CollisionDetection::CollisionInfo& info : broadphaseCollisions) {
+		const CollisionVolume* volA = info.a->GetBoundingVolume();
+		const CollisionVolume* volB = info.b->GetBoundingVolume();
+		int key = -1;
+		if (CollisionDetection::GetPairTest(volA, volB)) {
+			if (GameObject::OverlapOnlyPair(*info.a, *info.b)) {
+				triggerPairs.emplace_back((int)narrowPhaseKeys.size());
+			}
+			else {
+				key = CollisionDetection::GetVolumeSlot(volA->type) * CollisionDetection::VolumeSlots + CollisionDetection::GetVolumeSlot(volB->type);
+				groupStarts[key + 1]++;
+			}
+		}
+		narrowPhaseKeys.emplace_back(key);
+	}
+	for (int i = 0; i < groupCount; ++i) {
+		groupStarts[i + 1] += groupStarts[i];
+	}
+
+	narrowPhaseOrder.resize(groupStarts[groupCount]);
+	narrowPhaseTests.resize(groupStarts[groupCount]);
+	for (int i = 0; i < (int)narrowPhaseKeys.size(); ++i) {
+		int key = narrowPhaseKeys[i];
+		if (key < 0) {
+			continue;
+		}
+		int slot = groupStarts[key]++;
+		const CollisionDetection::CollisionInfo& info = *(broadphaseCollisions.begin() + i);
+		narrowPhaseOrder[slot] = i;
+		narrowPhaseTests[slot] = CollisionDetection::GetPairTest(info.a->GetBoundingVolume(), info.b->GetBoundingVolume());
+	}
+}
+
+/*
+An object in several pairs would otherwise have its axes and capsule
+segment worked out from its orientation for every one of them. Objects
+don't move during the narrowphase, so each one's shape is worked out the
+first time it turns up, and every test after that reads it from here.
+*/
+void PhysicsSystem::CacheShapes() {
+	auto cachePair = [&](int index) {
+		const CollisionDetection::CollisionInfo& info = *(broadphaseCollisions.begin() + index);
+		GameObject* pair[2] = { info.a, info.b };
+		for (GameObject* g : pair) {
+			if (g->GetShapeIndex() < 0) {
+				g->SetShapeIndex((int)shapeCache.size());
+				shapeCache.emplace_back(GJKShape::FromVolume(*g->GetBoundingVolume(), g->GetTransform()));
+				shapeOwners.emplace_back(g);
+			}
+		}
+	};
+	for (int index : narrowPhaseOrder) {
+		cachePair(index);
+	}
+	for (int index : triggerPairs) {
+		cachePair(index);
+	}
+}
+
+//Keeps the memory, but no object should think it still has a shape in here
+void PhysicsSystem::ClearShapeCache() {
+	for (GameObject* g : shapeOwners) {
+		g->SetShapeIndex(-1);
+	}
+	shapeOwners.clear();
+	shapeCache.clear();
+}
+
+/*
+The intersection tests only read from the objects, so they can be spread
+across the job system, with each worker writing into its own buffer. The
+contacts are then sorted by the world IDs of the pair, so that the impulses
+are always applied in the same order, no matter how the work was split up
+between the threads.
+*/
+void PhysicsSystem::ParallelNarrowPhase() {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+
+	if ((int)workerContacts.size() < jobs->GetWorkerCount()) {
+		workerContacts.resize(jobs->GetWorkerCount());
+	}
+	for (auto& contacts : workerContacts) {
+		contacts.clear();
+	}
+
+	CollisionPairCache::iterator first = broadphaseCollisions.begin();
+	jobs->ParallelFor((int)narrowPhaseOrder.size(), narrowPhaseBatchSize,
+		[&](int start, int end, int worker) {
+			std::vector<CollisionDetection::CollisionInfo>& contacts = workerContacts[worker];
+			for (int i = start; i < end; ++i) {
+				CollisionPairCache::iterator pair = first + narrowPhaseOrder[i];
+				CollisionDetection::CollisionInfo info = *pair;
+
+				if (CollisionDetection::ObjectIntersection(narrowPhaseTests[i], info.a, shapeCache[info.a->GetShapeIndex()],
+					info.b, shapeCache[info.b->GetShapeIndex()], info)) {
+					contacts.emplace_back(info);
+				}
+				pair->separatingAxis = info.separatingAxis; //each pair is only touched by one job
+			}
+		}
+	);
+
+	sortedContacts.clear();
+	for (auto& contacts : workerContacts) {
+		sortedContacts.insert(sortedContacts.end(), contacts.begin(), contacts.end());
+	}
+	std::sort(sortedContacts.begin(), sortedContacts.end(),
+		[](const CollisionDetection::CollisionInfo& l, const CollisionDetection::CollisionInfo& r) {
+			int lLow	= l.a->GetWorldID() < l.b->GetWorldID() ? l.a->GetWorldID() : l.b->GetWorldID();
+			int lHigh	= l.a->GetWorldID() < l.b->GetWorldID() ? l.b->GetWorldID() : l.a->GetWorldID();
+			int rLow	= r.a->GetWorldID() < r.b->GetWorldID() ? r.a->GetWorldID() : r.b->GetWorldID();
+			int rHigh	= r.a->GetWorldID() < r.b->GetWorldID() ? r.b->GetWorldID() : r.a->GetWorldID();
+			return lLow != rLow ? lLow < rLow : lHigh < rHigh;
+		}
+	);
+
+	for (auto& info : sortedContacts) {
+		ResolveCollision(info);
+	}
+}
+
+/*
+Triggers like refill points only care whether something is inside them,
+so their pairs skip contact generation and the solver altogether. There
+are few enough of them that it isn't worth handing them to the job system.
+*/
+void PhysicsSystem::TriggerPhase() {
+	CollisionPairCache::iterator first = broadphaseCollisions.begin();
+	for (int index : triggerPairs) {
+		CollisionPairCache::iterator pair = first + index;
+		const GJKShape& shapeA = shapeCache[pair->a->GetShapeIndex()];
+		const GJKShape& shapeB = shapeCache[pair->b->GetShapeIndex()];
+		if (CollisionDetection::ShapesOverlap(shapeA, shapeB, pair->separatingAxis)) {
+			AddTriggerOverlap(pair->a, shapeA, pair->b, shapeB);
+		}
+	}
+}
 
-		bool performCollision = gameWorld.CollisionAllowed(info.a->GetLayer(), info.b->GetLayer())
-			&& CollisionDetection::ObjectIntersection(info.a, info.b, info);
+//The contact handed to OnCollisionBegin only has a normal, from one centre to the other
+void PhysicsSystem::AddTriggerOverlap(GameObject* a, const GJKShape& shapeA, GameObject* b, const GJKShape& shapeB) {
+	const CollisionDetection::CollisionInfo* existing = triggerOverlaps.Find(a, b);
+	if (existing) {
+		existing->framesLeft = existing->framesLeft == TriggerEntered ? TriggerEntered : TriggerOverlapping;
+		return;
+	}
+	CollisionDetection::CollisionInfo info;
+	info.a			= a;
+	info.b			= b;
+	info.framesLeft	= TriggerEntered;
+	info.AddContactPoint(Vector3(), Vector3(), (shapeB.centre - shapeA.centre).Normalised(), 0.0f);
+	triggerOverlaps.Insert(info);
+
+	if (a->IsSleeping() != b->IsSleeping()) {
+		GameObject* sleeper = a->IsSleeping() ? a : b;
+		GameObject* waker	= a->IsSleeping() ? b : a;
+		if (waker->GetPhysicsObject()->WakesOnContact()) {
+			sleeper->GetPhysicsObject()->RequestWake();
+		}
+	}
+}
 
-		if (performCollision) {
-			info.framesLeft = numCollisionFrames;
+void PhysicsSystem::ResolveCollision(CollisionDetection::CollisionInfo& info) {
+	info.framesLeft = numCollisionFrames;
 
-			bool triggerCollision = info.a->IsTrigger() || info.b->IsTrigger();
-			bool springCollision = info.a->GetPhysicsObject()->ResolveBySpring() || info.b->GetPhysicsObject()->ResolveBySpring();
+	bool triggerCollision = info.a->IsTrigger() || info.b->IsTrigger();
+	bool springCollision = info.a->GetPhysicsObject()->ResolveBySpring() || info.b->GetPhysicsObject()->ResolveBySpring();
+
+	if (!triggerCollision && springCollision) {
+		ResolveSpringCollision(*info.a, *info.b, info.point);
+	}
+	else if (!triggerCollision) {
+		if (!ControllerHandlesPair(*info.a, *info.b)) {
+			contactSolver.AddContact(info);
+		}
+	}
+	else if (info.a->IsSleeping() != info.b->IsSleeping()) {
+		//Triggers don't push anything, but some (like projectiles) should still disturb what they hit
+		GameObject* sleeper = info.a->IsSleeping() ? info.a : info.b;
+		GameObject* waker	= info.a->IsSleeping() ? info.b : info.a;
+		if (waker->GetPhysicsObject()->WakesOnContact()) {
+			sleeper->GetPhysicsObject()->RequestWake();
+		}
+	}
+	allCollisions.Insert(info);
+}
 
-			if (!triggerCollision && springCollision) {
-				ResolveSpringCollision(*info.a, *info.b, info.point);
+/*
+Sleeping objects aren't in the world's awake list, so they don't get
+integrated, and only turn up in the broadphase when an awake object
+runs into them. Any force or impulse applied to a sleeping object flags
+it, and then its whole island is woken back up.
+*/
+void PhysicsSystem::WakeRequestedObjects() {
+	gameWorld.OperateOnContents(
+		[&](GameObject* g) {
+			PhysicsObject* object = g->GetPhysicsObject();
+			if (!object) {
+				return;
 			}
-			else if (!triggerCollision) {
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
+			if (g->IsSleeping() && object->IsWakeRequested()) {
+				WakeIsland(g);
 			}
-			allCollisions.insert(info);
+			object->ClearWakeRequest();
 		}
+	);
+}
+
+void PhysicsSystem::WakeIsland(GameObject* g) {
+	GameObject* current = g;
+	do {
+		GameObject* next = current->GetIslandLink();
+		current->SetIslandLink(nullptr);
+		if (current->GetPhysicsObject()) {
+			current->GetPhysicsObject()->SetSleepTimer(0.0f);
+		}
+		gameWorld.WakeObject(current);
+		current = next;
+	} while (current && current != g);
+}
+
+void PhysicsSystem::RemoveFromIsland(GameObject* g) {
+	GameObject* next = g->GetIslandLink();
+	if (!next) {
+		return;
+	}
+	GameObject* previous = next;
+	while (previous->GetIslandLink() != g) {
+		previous = previous->GetIslandLink();
 	}
+	previous->SetIslandLink(next == g ? nullptr : next);
+	g->SetIslandLink(nullptr);
+}
 
-	Debug::SetNumNarrowphaseCollisions(allCollisions.size());
+int PhysicsSystem::FindIsland(int index) {
+	while (islandParents[index] != index) {
+		islandParents[index] = islandParents[islandParents[index]];
+		index = islandParents[index];
+	}
+	return index;
 }
 
 /*
-Integration of acceleration and velocity is split up, so that we can
-move objects multiple times during the course of a PhysicsUpdate,
-without worrying about repeated forces accumulating etc. 
+Objects that have been slow for long enough are candidates for sleeping,
+but an object can only go to sleep along with everything it's touching,
+otherwise a stack would fall asleep from the bottom up and leave the top
+box hanging in mid air. Touching objects are merged into islands using the
+persistent collision list, and an island only sleeps once all of its
+objects are ready to.
+*/
+void PhysicsSystem::UpdateSleeping(float dt) {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetAwakeObjectIterators(first, last);
 
-This function will update both linear and angular acceleration,
-based on any forces that have been accumulated in the objects during
-the course of the previous game frame.
+	islandIndices.clear();
+	islandObjects.clear();
+	islandParents.clear();
+
+	float linearThreshold	= sleepLinearThreshold * sleepLinearThreshold;
+	float angularThreshold	= sleepAngularThreshold * sleepAngularThreshold;
+
+	for (auto i = first; i != last; ++i) {
+		GameObject* g = *i;
+		PhysicsObject* object = g->GetPhysicsObject();
+		if (!object || g->IsStatic() || g->IsSleeping() || g->ToRemove()) {
+			continue;
+		}
+		bool slow = object->GetLinearVelocity().LengthSquared() < linearThreshold
+			&& object->GetAngularVelocity().LengthSquared() < angularThreshold;
+
+		object->SetSleepTimer(slow ? object->GetSleepTimer() + dt : 0.0f);
+
+		islandIndices[g] = (int)islandObjects.size();
+		islandParents.emplace_back((int)islandObjects.size());
+		islandObjects.emplace_back(g);
+	}
+
+	for (auto& info : allCollisions) {
+		if (info.a->IsTrigger() || info.b->IsTrigger()) {
+			continue;
+		}
+		auto a = islandIndices.find(info.a);
+		auto b = islandIndices.find(info.b);
+		if (a == islandIndices.end() || b == islandIndices.end()) {
+			continue;
+		}
+		int rootA = FindIsland(a->second);
+		int rootB = FindIsland(b->second);
+		if (rootA != rootB) {
+			islandParents[rootB] = rootA;
+		}
+	}
+
+	islandCanSleep.assign(islandObjects.size(), true);
+	for (int i = 0; i < (int)islandObjects.size(); ++i) {
+		PhysicsObject* object = islandObjects[i]->GetPhysicsObject();
+		if (!object->CanSleep() || object->GetSleepTimer() < timeToSleep) {
+			islandCanSleep[FindIsland(i)] = false;
+		}
+	}
+
+	islandFirst.assign(islandObjects.size(), nullptr);
+	islandLast.assign(islandObjects.size(), nullptr);
+	for (int i = 0; i < (int)islandObjects.size(); ++i) {
+		int root = FindIsland(i);
+		if (!islandCanSleep[root]) {
+			continue;
+		}
+		GameObject* g = islandObjects[i];
+		if (islandLast[root]) {
+			islandLast[root]->SetIslandLink(g);
+		}
+		else {
+			islandFirst[root] = g;
+		}
+		islandLast[root] = g;
+
+		g->SetSleeping(true);
+		g->GetTransform().ClearPreviousState();
+		g->GetPhysicsObject()->SetLinearVelocity(Vector3());
+		g->GetPhysicsObject()->SetAngularVelocity(Vector3());
+	}
+	for (int i = 0; i < (int)islandObjects.size(); ++i) {
+		if (islandLast[i]) {
+			islandLast[i]->SetIslandLink(islandFirst[i]);
+		}
+	}
+}
+
+/*
+The awake bodies, and everything about them that can't change during a
+physics update, are gathered into flat arrays once per update, rather
+than every integration step walking the awake list and re-deriving it.
+Forces aren't cleared until the end of the update, so each body's linear
+acceleration is the same for every substep.
+
+The transforms and physics objects still own the positions and velocities,
+as collision resolution and gameplay code change them between substeps.
 */
-void PhysicsSystem::IntegrateAccel(float dt) {
+void PhysicsSystem::GatherBodies() {
+	bodies.Clear();
+
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetAwakeObjectIterators(first, last);
@@ -436,80 +1164,213 @@ void PhysicsSystem::IntegrateAccel(float dt) {
 		}
 		float inverseMass = object->GetInverseMass();
 
-		Vector3 linearVel	= object->GetLinearVelocity();
-		Vector3 force		= object->GetForce();
-		Vector3 accel		= force * inverseMass;
-
+		Vector3 accel = object->GetForce() * inverseMass;
 		if (applyGravity && object->GetUseGravity() && inverseMass > 0) {
 			accel += gravity;
 		}
+		//Gameplay code may have rotated the object since the last update,
+		//though this is only a compare if it hasn't
+		object->UpdateInertiaTensor();
 
-		linearVel += accel * dt;
-		object->SetLinearVelocity(linearVel);
+		bodies.objects.emplace_back(object);
+		bodies.transforms.emplace_back(&(*i)->GetTransform());
+		bodies.linearAccels.emplace_back(accel);
+		bodies.torques.emplace_back(object->GetTorque());
+		bodies.owners.emplace_back(*i);
+
+		const CollisionVolume* volume = (*i)->GetBoundingVolume();
+		bool sweep = object->UsesContinuousCollision() && volume && volume->type == VolumeType::Sphere;
+		bodies.sweepRadii.emplace_back(sweep ? ((const SphereVolume*)volume)->GetRadius() : 0.0f);
+		if (object->IsKinematic()) {
+			bodies.kinematics.emplace_back((int)bodies.objects.size() - 1);
+		}
+	}
+}
 
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
+/*
+Integration of acceleration and velocity is split up, so that we can
+move objects multiple times during the course of a PhysicsUpdate,
+without worrying about repeated forces accumulating etc. 
 
-		object->UpdateInertiaTensor();
+This function will update both linear and angular acceleration,
+based on any forces that have been accumulated in the objects during
+the course of the previous game frame.
+*/
+void PhysicsSystem::IntegrateAccel(float dt) {
+	ParallelBodies((int)bodies.objects.size(), parallelBodiesMinCount,
+		[this, dt](int first, int last, int worker) {
+			IntegrateAccelRange(dt, first, last);
+		}
+	);
+}
 
-		Vector3 angAccel = object->GetInertiaTensor() * torque;
+void PhysicsSystem::IntegrateAccelRange(float dt, int first, int last) {
+	for (int i = first; i < last; ++i) {
+		PhysicsObject* object = bodies.objects[i];
+
+		object->SetLinearVelocity(object->GetLinearVelocity() + bodies.linearAccels[i] * dt);
 
-		angVel += angAccel * dt;
-		object->SetAngularVelocity(angVel);
+		const Vector3& torque = bodies.torques[i];
+		if ((torque.x == 0.0f && torque.y == 0.0f && torque.z == 0.0f) || object->IsRotationLocked()) {
+			continue;
+		}
+		Vector3 angAccel = object->GetInertiaTensor() * torque;
+		object->SetAngularVelocity(object->GetAngularVelocity() + angAccel * dt);
 	}
 }
+
 /*
 This function integrates linear and angular velocity into
 position and orientation. It may be called multiple times
 throughout a physics update, to slowly move the objects through
 the world, looking for collisions.
+
+Most bodies aren't spinning, so their orientation (and therefore their
+world space inertia tensor) is left alone. Bodies with every axis locked
+never spin, whatever gameplay code has set their angular velocity to.
+
+Every body only touches itself, and sweeps only read the static tree, so
+they're split up across the job system, each worker with its own list
+for the tree to fill. Kinematic bodies are left until after, one at a
+time, as the character controller moves them against everything else,
+and keeps its own scratch space while it does.
 */
 void PhysicsSystem::IntegrateVelocity(float dt) {
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetAwakeObjectIterators(first, last);
-	float frameLinearDamping = 1.0f - (linearDamping * dt);
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	int workers = jobs ? jobs->GetWorkerCount() : 1;
+	if ((int)workerStaticObjects.size() < workers) {
+		workerStaticObjects.resize(workers);
+	}
+	ParallelBodies((int)bodies.objects.size(), parallelBodiesMinCount,
+		[this, dt](int first, int last, int worker) {
+			IntegrateVelocityRange(dt, first, last, worker);
+		}
+	);
+	for (int i : bodies.kinematics) {
+		MoveKinematicBody(i, dt);
+	}
+}
 
-	for (auto i = first; i != last; ++i) {
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		if (object == nullptr) {
-			continue;
+void PhysicsSystem::MoveKinematicBody(int body, float dt) {
+	PhysicsObject* object	= bodies.objects[body];
+	Vector3 velocity		= object->GetLinearVelocity();
+	characterController.Move(*bodies.owners[body], velocity, dt);
+	object->SetLinearVelocity(velocity * (1.0f - (linearDamping * dt)));
+}
+
+void PhysicsSystem::IntegrateVelocityRange(float dt, int first, int last, int worker) {
+	float frameLinearDamping	= 1.0f - (linearDamping * dt);
+	float frameAngularDamping	= 1.0f - (linearDamping * dt);
+	std::vector<GameObject*>& nearby = workerStaticObjects[worker];
+
+	for (int i = first; i < last; ++i) {
+		PhysicsObject* object	= bodies.objects[i];
+		Transform& transform	= *bodies.transforms[i];
+
+		transform.StorePreviousState();
+
+		if (object->IsKinematic()) {
+			continue; //moved once everything else has been
 		}
-		Transform& transform = (*i)->GetTransform();
 
-		Vector3 position	= transform.GetPosition();
 		Vector3 linearVel	= object->GetLinearVelocity();
-		position += linearVel * dt;
-		transform.SetPosition(position);
-
-		linearVel = linearVel * frameLinearDamping;
-		object->SetLinearVelocity(linearVel);
+		Vector3 motion		= linearVel * dt;
+		if (bodies.sweepRadii[i] > 0.0f) {
+			motion = SweepAgainstStatic(bodies.owners[i], transform.GetPosition(), motion, bodies.sweepRadii[i], nearby);
+		}
+		transform.SetPosition(transform.GetPosition() + motion);
+		object->SetLinearVelocity(linearVel * frameLinearDamping);
 
+		if (object->IsRotationLocked()) {
+			continue;
+		}
+		Vector3 angVel = object->GetAngularVelocity() * object->GetAngularFactor();
+		if (angVel.x == 0.0f && angVel.y == 0.0f && angVel.z == 0.0f) {
+			continue;
+		}
 		Quaternion orientation = transform.GetOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
-
 		orientation = orientation + (Quaternion(angVel * dt * 0.5f, 0.0f) * orientation);
 		orientation.Normalise();
 
 		transform.SetOrientation(orientation);
+		object->UpdateInertiaTensor();
 
-		float frameAngularDamping = 1.0f - (linearDamping * dt);
-		angVel = angVel * frameAngularDamping;
-		object->SetAngularVelocity(angVel);
+		object->SetAngularVelocity(angVel * frameAngularDamping);
 	}
 }
 
+/*
+Swept sphere test against the static octree. If the sphere would hit
+something during this step, it is only moved far enough to just touch it,
+so that the narrowphase picks the collision up on the next substep rather
+than the sphere passing straight through.
+
+Boxes are grown by the sphere's radius and raycast against, which gives a
+proper time of impact. Other shapes just use a ray from the sphere's centre.
+*/
+Vector3 PhysicsSystem::SweepAgainstStatic(GameObject* g, const Vector3& start, const Vector3& motion, float radius, std::vector<GameObject*>& nearby) {
+	float length = motion.Length();
+	Octree<GameObject*>* staticTree = gameWorld.GetStaticTree();
+	if (length < radius || !staticTree) {
+		return motion; //can't skip over anything this step
+	}
+	Vector3 direction = motion / length;
+
+	Vector3 sweepCentre = start + (motion * 0.5f);
+	Vector3 sweepSize(
+		fabs(motion.x) * 0.5f + radius,
+		fabs(motion.y) * 0.5f + radius,
+		fabs(motion.z) * 0.5f + radius
+	);
+	nearby.clear();
+	staticTree->GetCollidingObjects(sweepCentre, sweepSize, nearby);
+
+	Ray ray(start, direction);
+	float travel = length;
+	for (GameObject* other : nearby) {
+		if (other == g || other->IsTrigger() || !gameWorld.CollisionAllowed(g->GetLayer(), other->GetLayer())) {
+			continue;
+		}
+		const CollisionVolume* volume = other->GetBoundingVolume();
+		RayCollision hit;
+		float hitTravel;
+		if (volume->type == VolumeType::AABB) {
+			const AABBVolume* box = (const AABBVolume*)volume;
+			Vector3 grownSize = box->GetHalfDimensions() + Vector3(radius, radius, radius);
+			if (!CollisionDetection::RayBoxIntersection(ray, other->GetTransform().GetPosition() + box->GetOffset(), grownSize, hit)) {
+				continue;
+			}
+			hitTravel = hit.rayDistance + radius * 0.1f;
+		}
+		else {
+			if (!CollisionDetection::RayIntersection(ray, *other, hit)) {
+				continue;
+			}
+			hitTravel = hit.rayDistance - radius * 0.5f;
+		}
+		if (hitTravel < travel) {
+			travel = hitTravel > 0.0f ? hitTravel : 0.0f;
+		}
+	}
+	return direction * travel;
+}
+
 /*
 Once we're finished with a physics update, we have to
 clear out any accumulated forces, ready to receive new
 ones in the next 'game' frame.
 */
+/*
+Only this system's own bodies - the pool is the whole process', and with a
+MatchHost, the other matches' bodies are in the middle of their own steps.
+Anything asleep hasn't been pushed since it went to sleep, as a force would
+have woken it, so there's nothing to clear on those.
+*/
 void PhysicsSystem::ClearForces() {
-	gameWorld.OperateOnContents(
-		[](GameObject* o) {
-			PhysicsObject* p = o->GetPhysicsObject();
-			if (p) {
-				p->ClearForces();
+	ParallelBodies((int)bodies.objects.size(), parallelBodiesMinCount,
+		[&](int first, int last, int worker) {
+			for (int i = first; i < last; ++i) {
+				bodies.objects[i]->ClearForces();
 			}
 		}
 	);
@@ -524,11 +1385,5 @@ us to model springs and ropes etc.
 
 */
 void PhysicsSystem::UpdateConstraints(float dt) {
-	std::vector<Constraint*>::const_iterator first;
-	std::vector<Constraint*>::const_iterator last;
-	gameWorld.GetConstraintIterators(first, last);
-
-	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateConstraint(dt);
-	}
+	constraintSolver.Solve(dt);
 }
\ No newline at end of file
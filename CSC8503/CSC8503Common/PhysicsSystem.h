@@ -1,12 +1,29 @@
 #pragma once
 #include "../CSC8503Common/GameWorld.h"
 #include "Octree.h"
-#include <set>
+#include "DynamicAABBTree.h"
+#include "CollisionPairCache.h"
+#include "CollisionEventQueue.h"
+#include "ContactSolver.h"
+#include "ConstraintSolver.h"
+#include "CharacterController.h"
+#include "SmallObjectGrid.h"
+#include <unordered_map>
 
 namespace NCL {
 	namespace CSC8503 {
 		class PhysicsSystem	{
 		public:
+			/*
+			Fixed mode always steps at the same rate, running extra substeps to
+			catch up after a slow frame, which keeps networked games in step.
+			Adaptive mode halves the rate whenever an update takes too long.
+			*/
+			enum class StepMode {
+				Fixed,
+				Adaptive
+			};
+
 			PhysicsSystem(GameWorld& g);
 			~PhysicsSystem();
 
@@ -28,21 +45,122 @@ namespace NCL {
 
 			void SetGravity(const Vector3& g);
 
+			void SetStepMode(StepMode m) {
+				stepMode = m;
+			}
+
+			StepMode GetStepMode() const {
+				return stepMode;
+			}
+
+			void SetFixedRate(int hz, int maxSteps = 8);
+
+			void SetSolverIterations(int count) {
+				contactSolver.SetIterationCount(count);
+			}
+
+			float GetStepDT() const {
+				return stepDT;
+			}
+
+			//How far through the next substep we are, for interpolating rendering
+			float GetInterpolationAlpha() const {
+				return stepDT > 0.0f ? dTOffset / stepDT : 0.0f;
+			}
+
+			//This update's collision begin / stay / end events, for any system
+			//that wants them, or to add a listener to
+			CollisionEventQueue& GetCollisionEvents() {
+				return collisionEvents;
+			}
+
+			void UseParallelNarrowPhase(bool state) {
+				useParallelNarrowPhase = state;
+			}
+
+			void UseParallelIntegration(bool state) {
+				useParallelIntegration = state;
+			}
+
+			void UseSleeping(bool state) {
+				useSleeping = state;
+			}
+
+			CharacterController& GetCharacterController() {
+				return characterController;
+			}
+
+			void SetSleepThresholds(float linear, float angular, float time) {
+				sleepLinearThreshold	= linear;
+				sleepAngularThreshold	= angular;
+				timeToSleep				= time;
+			}
+
+			//What the physics system carries over between updates, beyond the
+			//objects themselves, for rolling the world back a few ticks
+			struct SavedState {
+				CollisionPairCache	collisions;
+				CollisionPairCache	triggers;
+				float				dTOffset;
+			};
+			void SaveState(SavedState& s) const;
+			void RestoreState(const SavedState& s);
+
 		protected:
 			void BasicCollisionDetection();
 			void BroadPhase();
+			void AddBroadphasePair(CollisionDetection::CollisionInfo& info);
+			struct StaticNeighbours;
+			const StaticNeighbours& GetStaticNeighbours(GameObject* g, Octree<GameObject*>& staticTree);
+			void ForgetStaticNeighbours(int proxy);
+			void BuildSmallObjectGrid();
+			void SmallObjectBroadPhase(GameObject* object, Octree<GameObject*>* staticTree);
 			void NarrowPhase();
+			void GroupPairsByType();
+			void CacheShapes();
+			void ClearShapeCache();
+			void ParallelNarrowPhase();
+			void TriggerPhase();
+			void AddTriggerOverlap(GameObject* a, const GJKShape& shapeA, GameObject* b, const GJKShape& shapeB);
+			void ResolveCollision(CollisionDetection::CollisionInfo& info);
 
 			void ClearForces();
 
+			//Runs kernel(first, last, worker) over count items, split into batches
+			//across the job system if there are enough, or straight through if not
+			template<class F>
+			void ParallelBodies(int count, int minCount, F kernel);
+
+			void GatherBodies();
 			void IntegrateAccel(float dt);
+			void IntegrateAccelRange(float dt, int first, int last);
 			void IntegrateVelocity(float dt);
+			void IntegrateVelocityRange(float dt, int first, int last, int worker);
+			void MoveKinematicBody(int body, float dt);
+			Vector3 SweepAgainstStatic(GameObject* g, const Vector3& start, const Vector3& motion, float radius, std::vector<GameObject*>& nearby);
 
 			void UpdateConstraints(float dt);
 
-			void UpdateCollisionList();
+			void UpdateCollisionList(bool stepped);
+			void UpdateTriggerOverlaps(bool stepped);
+			void DispatchCollisionEvents();
 			void UpdateObjectAABBs();
 
+			void WakeRequestedObjects();
+			void WakeIsland(GameObject* g);
+			void RemoveFromIsland(GameObject* g);
+			void UpdateSleeping(float dt);
+			int FindIsland(int index);
+
+			void AddToBroadphase(GameObject* g);
+			void RemoveFromBroadphase(GameObject* g);
+			void UpdateBroadphaseProxy(GameObject* g);
+			void RemoveSmallObject(GameObject* g);
+
+			static bool UsesSmallObjectGrid(const GameObject* g) {
+				return g->GetPhysicsObject() && g->GetPhysicsObject()->UsesSmallObjectGrid();
+			}
+
 			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p) const;
 			void ResolveSpringCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
 
@@ -52,16 +170,114 @@ namespace NCL {
 
 			Vector3 gravity;
 			float	dTOffset;
+
+			StepMode	stepMode;
+			float		fixedDT;
+			float		stepDT;
+			int			maxSubsteps;
 			float	globalDamping;
 			float	linearDamping;
 
-			std::set<CollisionDetection::CollisionInfo> allCollisions;
-			std::set<CollisionDetection::CollisionInfo> broadphaseCollisions;
+			CollisionPairCache allCollisions;
+			CollisionPairCache triggerOverlaps; //framesLeft holds one of the TriggerState values
+			CollisionEventQueue collisionEvents;
+			CollisionPairCache broadphaseCollisions;
+			CollisionPairCache previousBroadphase; //last substep's pairs, for their GJK search directions
+
+			DynamicAABBTree<GameObject*> dynamicTree;
+
+			//Everything using the small object grid, active or not, which the
+			//grid is built from every substep
+			std::vector<GameObject*>	smallObjects;
+			SmallObjectGrid				smallObjectGrid;
+
+			std::vector<GameObject*> staticObjects; //reused by every static tree query in the broadphase
+			std::vector<std::vector<GameObject*>> workerStaticObjects; //and one per worker, for the integrator's sweeps
+
+			/*
+			The static objects each dynamic proxy's fat AABB overlapped, the last
+			time it was looked up. They only need finding again once the proxy
+			leaves its fat AABB, or the static tree changes underneath it.
+			*/
+			struct StaticNeighbours {
+				std::vector<OctreeEntry<GameObject*>>	entries;
+				int										staticVersion = -1; //-1 if they need finding again
+			};
+			std::vector<StaticNeighbours> staticNeighbours; //indexed by broadphase proxy
 
-			bool useBroadPhase		= true;
-			int numCollisionFrames	= 5;
+			ContactSolver		contactSolver;
+			ConstraintSolver	constraintSolver;
+			CharacterController	characterController;
+
+			//Awake bodies, laid out as parallel arrays for the integrator
+			struct BodyStore {
+				std::vector<PhysicsObject*>	objects;
+				std::vector<Transform*>		transforms;
+				std::vector<Vector3>		linearAccels;
+				std::vector<Vector3>		torques;
+				std::vector<GameObject*>	owners;
+				std::vector<float>			sweepRadii; //0 unless swept against the static world
+				std::vector<int>			kinematics; //which of them the character controller moves
+
+				void Clear() {
+					objects.clear();
+					transforms.clear();
+					linearAccels.clear();
+					torques.clear();
+					owners.clear();
+					sweepRadii.clear();
+					kinematics.clear();
+				}
+			};
+			BodyStore bodies;
+
+			//The broadphase pairs' indices, grouped by their pair of volume types,
+			//so that each test runs over all of its pairs in one go
+			std::vector<int>								narrowPhaseOrder;
+			std::vector<CollisionDetection::PairTestFunc>	narrowPhaseTests;
+			std::vector<int>								narrowPhaseKeys;
+			std::vector<int>								triggerPairs; //only needing an overlap test
+
+			//Each narrowphase object's world space shape, worked out once per substep
+			std::vector<GJKShape>	shapeCache;
+			std::vector<GameObject*> shapeOwners;
+
+			//One contact buffer per worker thread, merged after the parallel narrowphase
+			std::vector<std::vector<CollisionDetection::CollisionInfo>> workerContacts;
+			std::vector<CollisionDetection::CollisionInfo>				sortedContacts;
+
+			//Scratch space for building contact islands each frame
+			std::unordered_map<GameObject*, int>	islandIndices;
+			std::vector<GameObject*>				islandObjects;
+			std::vector<int>						islandParents;
+			std::vector<bool>						islandCanSleep;
+			std::vector<GameObject*>				islandFirst;
+			std::vector<GameObject*>				islandLast;
+
+			bool useBroadPhase			= true;
+			bool useParallelNarrowPhase	= true;
+			bool useParallelIntegration	= true;
+			bool useSleeping			= true;
+			int numCollisionFrames		= 5;
+
+			int parallelNarrowPhaseMinPairs	= 64;
+			int narrowPhaseBatchSize		= 16;
+
+			//Integrating a body is only a few multiplies, so it takes a lot of them to be worth the workers
+			int parallelBodiesMinCount		= 256;
+			int bodyBatchSize				= 64;
+
+			float sleepLinearThreshold	= 0.25f;
+			float sleepAngularThreshold	= 0.1f;
+			float timeToSleep			= 0.5f;
 
 			bool warmStart;
+
+			enum TriggerState {
+				TriggerLeft,		//not seen overlapping since the last update
+				TriggerOverlapping,
+				TriggerEntered		//new since the last update
+			};
 		};
 	}
 }
@@ -2,9 +2,13 @@
 #include "GameObject.h"
 
 void NCL::CSC8503::PositionConstraint::UpdateConstraint(float dt) {
-	Vector3 relativePos =
-		objectA->GetTransform().GetPosition() -
-		objectB->GetTransform().GetPosition();
+	Solve(objectA->GetPhysicsObject(), objectB->GetPhysicsObject(),
+		objectA->GetTransform().GetPosition(), objectB->GetTransform().GetPosition(), distance, dt);
+}
+
+void NCL::CSC8503::PositionConstraint::Solve(PhysicsObject* physA, PhysicsObject* physB,
+	const Vector3& posA, const Vector3& posB, float distance, float dt) {
+	Vector3 relativePos = posA - posB;
 
 	float currentDistance = relativePos.Length();
 
@@ -13,9 +17,6 @@ void NCL::CSC8503::PositionConstraint::UpdateConstraint(float dt) {
 	if (abs(offset) > 0.0f) {
 		Vector3 offsetDir = relativePos.Normalised();
 
-		PhysicsObject* physA = objectA->GetPhysicsObject();
-		PhysicsObject* physB = objectB->GetPhysicsObject();
-
 		Vector3 relativeVelocity =
 			physA->GetLinearVelocity() -
 			physB->GetLinearVelocity();
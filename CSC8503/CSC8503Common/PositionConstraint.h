@@ -1,10 +1,13 @@
 #pragma once
 
 #include "Constraint.h"
+#include "../../Common/Vector3.h"
 
 namespace NCL {
 	namespace CSC8503 {
+		using Maths::Vector3;
 		class GameObject;
+		class PhysicsObject;
 
 		class PositionConstraint : public Constraint {
 		public:
@@ -17,6 +20,23 @@ namespace NCL {
 
 			void UpdateConstraint(float dt) override;
 
+			GameObject* GetObjectA() const {
+				return objectA;
+			}
+
+			GameObject* GetObjectB() const {
+				return objectB;
+			}
+
+			float GetDistance() const {
+				return distance;
+			}
+
+			//The constraint maths on its own, so the batched solver can run it
+			//without going through the objects each time
+			static void Solve(PhysicsObject* physA, PhysicsObject* physB,
+				const Vector3& posA, const Vector3& posB, float distance, float dt);
+
 		protected:
 			GameObject* objectA;
 			GameObject* objectB;
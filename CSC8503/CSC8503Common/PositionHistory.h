@@ -0,0 +1,71 @@
+#pragma once
+#include "../../Common/Vector3.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		using Maths::Vector3;
+
+		/*
+		Where something was at each of the last few snapshots, so the server
+		can look back to what a client was seeing when it did something.
+		Snapshots are recorded in order, and anything asked for between two
+		of them is interpolated, the same as the client would have drawn it.
+		*/
+		class PositionHistory {
+		public:
+			static const int Length = 32; //about a second of snapshots, at 30Hz
+
+			PositionHistory() {}
+			~PositionHistory() {}
+
+			void Record(int snapshot, const Vector3& position) {
+				newest = (newest + 1) % Length;
+				entries[newest] = { snapshot, position };
+				count = count < Length ? count + 1 : Length;
+			}
+
+			bool IsEmpty() const {
+				return count == 0;
+			}
+
+			int GetNewestSnapshot() const {
+				return count ? entries[newest].snapshot : -1;
+			}
+
+			//Anything older than what's kept gets the oldest position, and anything newer the newest
+			Vector3 Sample(float snapshot) const {
+				if (count == 0) {
+					return Vector3(0, 0, 0);
+				}
+				const Entry* later = &entries[newest];
+				if (snapshot >= (float)later->snapshot) {
+					return later->position;
+				}
+				for (int i = 1; i < count; ++i) {
+					const Entry& earlier = entries[(newest - i + Length) % Length];
+					if (snapshot >= (float)earlier.snapshot) {
+						float t = (snapshot - (float)earlier.snapshot) / (float)(later->snapshot - earlier.snapshot);
+						return earlier.position + (later->position - earlier.position) * t;
+					}
+					later = &earlier;
+				}
+				return later->position;
+			}
+
+			void Clear() {
+				count	= 0;
+				newest	= -1;
+			}
+
+		protected:
+			struct Entry {
+				int		snapshot;
+				Vector3 position;
+			};
+
+			Entry	entries[Length];
+			int		count	= 0;
+			int		newest	= -1;
+		};
+	}
+}
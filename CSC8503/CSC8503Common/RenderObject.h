@@ -3,6 +3,7 @@
 #include "../../Common/TextureBase.h"
 #include "../../Common/ShaderBase.h"
 #include "../../Common/Vector4.h"
+#include "ComponentPool.h"
 #include<vector>
 //8508
 #include "../../Common/MeshAnimation.h"
@@ -15,7 +16,7 @@ namespace NCL {
 		class Transform;
 		using namespace Maths;
 
-		class RenderObject
+		class RenderObject : public PooledComponent<RenderObject>
 		{
 		public:
 			RenderObject(Transform* parentTransform, MeshGeometry* mesh, TextureBase* tex, ShaderBase* shader);
@@ -33,6 +34,11 @@ namespace NCL {
 				return mesh;
 			}
 
+			//For swapping in the real mesh once it's loaded
+			void SetMesh(MeshGeometry* m) {
+				mesh = m;
+			}
+
 			Transform*		GetTransform() const {
 				return transform;
 			}
@@ -41,28 +47,72 @@ namespace NCL {
 				return shader;
 			}
 
+			//Stops any fade that's still going
 			void SetColour(const Vector4& c) {
-				colour = c;
+				colour			= c;
+				fadeDuration	= 0.0f;
 			}
 
+			//The colour it's set to, or is fading towards
 			Vector4 GetColour() const {
 				return colour;
 			}
 
-			//8508
-			int GetFlag() const {
-				return objFlag;
+			/*
+			Fades from one colour to another over duration seconds, from startTime
+			in the world's time. The instanced shaders work out where it's got to
+			themselves, so nothing has to be updated while it's fading.
+			*/
+			void SetColourFade(const Vector4& from, const Vector4& to, float startTime, float duration) {
+				colour			= to;
+				fadeFrom		= from;
+				fadeStart		= startTime;
+				fadeDuration	= duration;
+			}
+
+			Vector4 GetColourAt(float time) const {
+				if (fadeDuration <= 0.0f || time >= fadeStart + fadeDuration) {
+					return colour;
+				}
+				float t = (time - fadeStart) / fadeDuration;
+				return Vector4::Lerp(fadeFrom, colour, t < 0.0f ? 0.0f : t);
+			}
+
+			bool IsFading(float time) const {
+				return fadeDuration > 0.0f && time < fadeStart + fadeDuration;
+			}
+
+			const Vector4& GetFadeFrom() const { return fadeFrom; }
+
+			float GetFadeStart() const { return fadeStart; }
+
+			float GetFadeDuration() const { return fadeDuration; }
+
+			//Anything the renderer has to draw it differently for, besides its
+			//shader, mesh and textures
+			enum Feature : unsigned int {
+				Skinned				= 1 << 0,	//posed by its animation
+				TexturePerSubMesh	= 1 << 1,	//from SetTextures, rather than the default texture
+				DebugOnly			= 1 << 2	//an overlay, like the colliders, which shouldn't hide anything
+			};
+
+			unsigned int GetFeatures() const {
+				return features;
+			}
+
+			void SetFeatures(unsigned int f) {
+				features = f;
 			}
 
-			void SetFlag(int flag) {
-				objFlag = flag;
+			bool HasFeature(Feature f) const {
+				return (features & f) != 0;
 			}
 
 			void SetTextures(std::vector<unsigned int> texs) {
 				textures = texs;
 			}
 
-			std::vector<unsigned int> GetTextures() const {
+			const std::vector<unsigned int>& GetTextures() const {
 				return textures;
 			}
 			
@@ -78,10 +128,20 @@ namespace NCL {
 				return animation;
 			}
 
+			//Which layer to use, when the texture's an array of them
+			void SetTextureLayer(int l) { textureLayer = l; }
+
+			int GetTextureLayer() const { return textureLayer; }
+
 			void SetRenderShadow(bool r) { renderShadow = r; }
 
 			bool RenderShadow() const { return renderShadow; }
 
+			//Level geometry that never moves once it's loaded, which the renderer can merge together
+			void SetStaticGeometry(bool s) { staticGeometry = s; }
+
+			bool IsStaticGeometry() const { return staticGeometry; }
+
 		protected:
 			std::vector<unsigned int> textures;
 
@@ -91,9 +151,13 @@ namespace NCL {
 			ShaderBase*		shader;
 			Transform*		transform;
 			Vector4			colour;
-			//8508
-			int				objFlag = 0;
+			Vector4			fadeFrom;
+			float			fadeStart		= 0.0f;
+			float			fadeDuration	= 0.0f;	//not fading when 0
+			unsigned int	features = 0;
 			bool			renderShadow;
+			int				textureLayer = 0;
+			bool			staticGeometry = false;
 		};
 	}
 }
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A fixed size ring buffer for passing items from exactly one producer
+		thread to exactly one consumer thread, without any locking. Each end
+		only ever writes its own index, and publishes it with release
+		ordering once the item it covers is in place.
+
+		One slot is always left empty, to tell a full queue from an empty one,
+		so it holds Capacity - 1 items at most.
+		*/
+		template <class T, int Capacity>
+		class SPSCQueue {
+		public:
+			SPSCQueue() : head(0), tail(0) {
+			}
+
+			//Producer only. Returns false if the queue is full
+			bool Push(const T& item) {
+				int t		= tail.load(std::memory_order_relaxed);
+				int next	= (t + 1) % Capacity;
+				if (next == head.load(std::memory_order_acquire)) {
+					return false;
+				}
+				items[t] = item;
+				tail.store(next, std::memory_order_release);
+				return true;
+			}
+
+			//Consumer only. Returns false if there's nothing waiting
+			bool Pop(T& item) {
+				int h = head.load(std::memory_order_relaxed);
+				if (h == tail.load(std::memory_order_acquire)) {
+					return false;
+				}
+				item = items[h];
+				head.store((h + 1) % Capacity, std::memory_order_release);
+				return true;
+			}
+
+		protected:
+			T items[Capacity];
+
+			//Kept on separate cache lines, so the two threads don't fight over them
+			alignas(64) std::atomic<int> head;
+			alignas(64) std::atomic<int> tail;
+		};
+	}
+}
@@ -0,0 +1,51 @@
+#include "SmallObjectGrid.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+SmallObjectGrid::SmallObjectGrid(float cellSize, int bucketCount) {
+	this->cellSize	= cellSize;
+	inverseCellSize	= 1.0f / cellSize;
+	bucketMask		= (uint32_t)bucketCount - 1;
+	bucketStarts.resize(bucketCount + 1);
+	bucketStamps.resize(bucketCount);
+	stamp			= 0;
+}
+
+void SmallObjectGrid::Clear() {
+	items.clear();
+	sortedItems.clear();
+	maxHalfSize = Vector3();
+}
+
+void SmallObjectGrid::Add(GameObject* o, const Vector3& pos, const Vector3& halfSize) {
+	items.push_back({ o, pos, halfSize, Bucket(CellCoord(pos.x), CellCoord(pos.y), CellCoord(pos.z)) });
+
+	maxHalfSize.x = halfSize.x > maxHalfSize.x ? halfSize.x : maxHalfSize.x;
+	maxHalfSize.y = halfSize.y > maxHalfSize.y ? halfSize.y : maxHalfSize.y;
+	maxHalfSize.z = halfSize.z > maxHalfSize.z ? halfSize.z : maxHalfSize.z;
+}
+
+/*
+Objects stay in the order they were added within each bucket, so queries
+hand them back in the same order every time the same objects are added.
+*/
+void SmallObjectGrid::Build() {
+	std::fill(bucketStarts.begin(), bucketStarts.end(), 0);
+	for (const Item& item : items) {
+		bucketStarts[item.bucket + 1]++;
+	}
+	for (size_t i = 1; i < bucketStarts.size(); ++i) {
+		bucketStarts[i] += bucketStarts[i - 1];
+	}
+	sortedItems.resize(items.size());
+	for (const Item& item : items) {
+		sortedItems[bucketStarts[item.bucket]++] = item;
+	}
+	//Each start has been pushed along to the next one's, so shuffle them back
+	for (size_t i = bucketStarts.size() - 1; i > 0; --i) {
+		bucketStarts[i] = bucketStarts[i - 1];
+	}
+	bucketStarts[0] = 0;
+}
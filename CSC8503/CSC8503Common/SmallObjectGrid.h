@@ -0,0 +1,114 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "CollisionDetection.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameObject;
+
+		/*
+		A uniform grid for lots of small objects of much the same size, like
+		paint projectiles, which move too far every substep to be worth
+		keeping in the DynamicAABBTree - they'd be leaving their fat AABBs
+		and being reinserted all the time. Instead the grid is thrown away
+		and built again every substep, which is just a counting sort of the
+		objects by cell.
+
+		Cells are hashed into a fixed number of buckets, so the grid never
+		needs to know how big the level is. Objects whose cells share a
+		bucket are told apart by the box test in Query. Each object goes in
+		the one cell its centre is in, so queries are grown by the biggest
+		object added, to catch the ones poking out of their cell.
+		*/
+		class SmallObjectGrid {
+		public:
+			//bucketCount has to be a power of two
+			SmallObjectGrid(float cellSize = 2.0f, int bucketCount = 4096);
+			~SmallObjectGrid() {}
+
+			void Clear();
+			void Add(GameObject* o, const Vector3& pos, const Vector3& halfSize);
+			//Has to be called after adding, before querying
+			void Build();
+
+			//Calls func(GameObject*) once for every object whose box overlaps the given one
+			template<class F>
+			void Query(const Vector3& pos, const Vector3& halfSize, F&& func) {
+				if (items.empty()) {
+					return;
+				}
+				Vector3 reach	= halfSize + maxHalfSize;
+				int minX = CellCoord(pos.x - reach.x), maxX = CellCoord(pos.x + reach.x);
+				int minY = CellCoord(pos.y - reach.y), maxY = CellCoord(pos.y + reach.y);
+				int minZ = CellCoord(pos.z - reach.z), maxZ = CellCoord(pos.z + reach.z);
+
+				auto testItem = [&](const Item& item) {
+					if (CollisionDetection::AABBTest(pos, item.pos, halfSize, item.halfSize)) {
+						func(item.object);
+					}
+				};
+
+				//A box covering more cells than there are buckets would visit every bucket anyway
+				long long cellCount = (long long)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+				if (cellCount >= (long long)bucketStamps.size()) {
+					for (const Item& item : sortedItems) {
+						testItem(item);
+					}
+					return;
+				}
+
+				stamp++; //so that two cells sharing a bucket don't report its objects twice
+				for (int x = minX; x <= maxX; ++x) {
+					for (int y = minY; y <= maxY; ++y) {
+						for (int z = minZ; z <= maxZ; ++z) {
+							int bucket = Bucket(x, y, z);
+							if (bucketStamps[bucket] == stamp) {
+								continue;
+							}
+							bucketStamps[bucket] = stamp;
+							for (int i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; ++i) {
+								testItem(sortedItems[i]);
+							}
+						}
+					}
+				}
+			}
+
+			int GetObjectCount() const {
+				return (int)items.size();
+			}
+
+		protected:
+			struct Item {
+				GameObject*	object;
+				Vector3		pos;
+				Vector3		halfSize;
+				int			bucket;
+			};
+
+			int CellCoord(float f) const {
+				return (int)floorf(f * inverseCellSize);
+			}
+
+			int Bucket(int x, int y, int z) const {
+				uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+				return (int)(h & bucketMask);
+			}
+
+			float		cellSize;
+			float		inverseCellSize;
+			uint32_t	bucketMask;
+			Vector3		maxHalfSize;
+
+			std::vector<Item>		items;			//in the order they were added
+			std::vector<Item>		sortedItems;	//grouped by bucket
+			std::vector<int>		bucketStarts;	//one more than there are buckets
+			std::vector<uint32_t>	bucketStamps;
+			uint32_t				stamp;
+		};
+	}
+}
@@ -0,0 +1,462 @@
+#include "SnapshotBenchmark.h"
+#include "AllocationCounter.h"
+#include "PacketRecording.h"
+#include <enet/enet.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <map>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+static_assert(SnapshotBenchmark::BaselineRefreshSnapshots * 2 <= NetworkObject::StateHistoryLength, "Baselines would be dropped from the state history while still in use");
+
+const float SnapshotBenchmark::SnapshotDT	= 1.0f / 30.0f;
+const float SnapshotBenchmark::WorldSize	= 256.0f;
+
+SnapshotBenchmark::SnapshotBenchmark(int snapshots, unsigned int seed) : random(seed) {
+	snapshotCount	= snapshots > 0 ? snapshots : 1;
+	motion			= Motion::Idle;
+	NetworkState::SetQuantisation(Vector3(-WorldSize, -64, -WorldSize), Vector3(WorldSize, 192, WorldSize));
+}
+
+SnapshotBenchmark::~SnapshotBenchmark() {
+	Clear();
+}
+
+const char* SnapshotBenchmark::GetMotionName(Motion m) {
+	switch (m) {
+		case Motion::Idle:			return "Idle";
+		case Motion::Drifting:		return "Drifting";
+		case Motion::Projectiles:	return "Projectiles";
+		case Motion::Mixed:			return "Mixed";
+		case Motion::Recorded:		return "Recorded";
+	}
+	return "";
+}
+
+void SnapshotBenchmark::RunAll(const std::vector<int>& objectCounts, int clientCount, const std::vector<std::string>& recordings, const std::string& csvFile) {
+	std::vector<Result> results;
+	auto print = [&](const Result& r) {
+		std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(24) << r.source << std::right
+			<< std::setw(6) << r.objects << " objects: " << r.snapshotBytes << " bytes (" << r.packetsPerSnapshot << " packets) a snapshot, "
+			<< r.compressedBytes << " compressed, " << r.xorCompressedBytes << " XORed and compressed, "
+			<< r.fullBytes << "/" << r.deltaBytes << " bytes full/delta, " << r.deltaFraction * 100.0f << "% deltas, "
+			<< r.encodeTime << "ns encode, " << r.decodeTime << "ns decode, "
+			<< r.encodeAllocations << "/" << r.decodeAllocations << " allocations, "
+			<< std::setprecision(4) << r.maxPositionError << " worst error";
+		if (r.readFailures > 0) {
+			std::cout << ", " << r.readFailures << " FAILED TO READ";
+		}
+		std::cout << std::endl;
+		results.emplace_back(r);
+	};
+	const Motion motions[] = { Motion::Idle, Motion::Drifting, Motion::Projectiles, Motion::Mixed };
+	for (int count : objectCounts) {
+		for (Motion m : motions) {
+			print(Run(m, count, clientCount));
+		}
+	}
+	for (const std::string& file : recordings) {
+		Result r = RunRecording(file, clientCount);
+		if (r.snapshots == 0) {
+			std::cout << "Couldn't find any object states in " << file << ", skipping it" << std::endl;
+			continue;
+		}
+		print(r);
+	}
+
+	std::ofstream csv(csvFile);
+	if (!csv) {
+		return;
+	}
+	csv << "source,objects,clients,snapshots,full_bytes,delta_bytes,delta_fraction,snapshot_bytes,packets_per_snapshot,"
+		"compressed_bytes,xor_compressed_bytes,encode_ns,decode_ns,encode_allocations,decode_allocations,read_failures,max_position_error\n";
+	for (const Result& r : results) {
+		csv << r.source << "," << r.objects << "," << r.clients << "," << r.snapshots << "," << r.fullBytes << ","
+			<< r.deltaBytes << "," << r.deltaFraction << "," << r.snapshotBytes << "," << r.packetsPerSnapshot << ","
+			<< r.compressedBytes << "," << r.xorCompressedBytes << ","
+			<< r.encodeTime << "," << r.decodeTime << "," << r.encodeAllocations << "," << r.decodeAllocations << ","
+			<< r.readFailures << "," << r.maxPositionError << "\n";
+	}
+}
+
+SnapshotBenchmark::Result SnapshotBenchmark::Run(Motion m, int objects, int clientCount) {
+	Build(m, objects, clientCount);
+	Result r = Simulate(GetMotionName(m), snapshotCount);
+	Clear();
+	return r;
+}
+
+SnapshotBenchmark::Result SnapshotBenchmark::RunRecording(const std::string& filename, int clientCount) {
+	if (!LoadRecording(filename)) {
+		return Result();
+	}
+	Build(Motion::Recorded, (int)recorded[0].size(), clientCount);
+	Result r = Simulate(filename, (int)recorded.size());
+	Clear();
+	recorded.clear();
+	return r;
+}
+
+void SnapshotBenchmark::Build(Motion m, int objects, int clientCount) {
+	Clear();
+	motion = m;
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> normal;
+	auto randomDirection = [&]() {
+		Vector3 d(normal(random), normal(random), normal(random));
+		return d.LengthSquared() > 0.0f ? d.Normalised() : Vector3(0, 0, 1);
+	};
+
+	for (int i = 0; i < objects; ++i) {
+		Body b;
+		b.object	= new GameObject();
+		b.network	= new NetworkObject(*b.object, i);
+		b.object->SetNetworkObject(b.network);
+
+		Quaternion orientation(normal(random), normal(random), normal(random), normal(random));
+		orientation.Normalise();
+		b.object->GetTransform()
+			.SetPosition(Vector3((unit(random) * 2.0f - 1.0f) * WorldSize, unit(random) * 64.0f, (unit(random) * 2.0f - 1.0f) * WorldSize))
+			.SetOrientation(orientation);
+
+		Motion kind = m;
+		if (m == Motion::Mixed) {
+			float pick = unit(random);
+			kind = pick < 0.7f ? Motion::Idle : (pick < 0.9f ? Motion::Drifting : Motion::Projectiles);
+		}
+		if (kind == Motion::Drifting) {
+			Vector3 heading = randomDirection();
+			heading.y		= 0.0f;
+			b.velocity		= heading * (1.0f + unit(random) * 3.0f);
+			b.spin			= Vector3(0, 1, 0) * (30.0f + unit(random) * 60.0f);
+		}
+		else if (kind == Motion::Projectiles) {
+			b.velocity	= randomDirection() * (30.0f + unit(random) * 30.0f);
+			b.spin		= randomDirection() * 360.0f;
+		}
+		bodies.emplace_back(b);
+	}
+
+	clients.resize(clientCount > 0 ? clientCount : 1);
+	for (Client& c : clients) {
+		for (int i = 0; i < objects; ++i) {
+			GameObject* replica		= new GameObject();
+			NetworkObject* network	= new NetworkObject(*replica, i);
+			replica->SetNetworkObject(network);
+			c.replicas.emplace_back(replica);
+			c.networks.emplace_back(network);
+		}
+		c.baselines.assign(objects, -1);
+		c.pendingFulls.assign(objects, -1);
+	}
+}
+
+void SnapshotBenchmark::Clear() {
+	for (Body& b : bodies) {
+		delete b.object;
+	}
+	bodies.clear();
+	for (Client& c : clients) {
+		for (GameObject* o : c.replicas) {
+			delete o;
+		}
+	}
+	clients.clear();
+}
+
+//Anything that goes out of the world comes back in on the other side
+void SnapshotBenchmark::Move(int snapshot) {
+	if (motion == Motion::Recorded) {
+		const std::vector<NetworkState>& states = recorded[snapshot];
+		for (size_t i = 0; i < bodies.size(); ++i) {
+			bodies[i].object->GetTransform()
+				.SetPosition(states[i].position)
+				.SetOrientation(states[i].orientation);
+		}
+		return;
+	}
+	for (Body& b : bodies) {
+		Transform& t = b.object->GetTransform();
+		Vector3 position = t.GetPosition() + b.velocity * SnapshotDT;
+		for (int i = 0; i < 3; ++i) {
+			float low	= i == 1 ? 0.0f : -WorldSize;
+			float high	= i == 1 ? 64.0f : WorldSize;
+			position[i] = position[i] > high ? position[i] - (high - low) : (position[i] < low ? position[i] + (high - low) : position[i]);
+		}
+		t.SetPosition(position);
+		float degrees = b.spin.Length();
+		if (degrees > 0.0f) {
+			Quaternion turned = t.GetOrientation() * Quaternion::AxisAngleToQuaterion(b.spin / degrees, degrees * SnapshotDT);
+			turned.Normalise();
+			t.SetOrientation(turned);
+		}
+	}
+}
+
+/*
+Each snapshot is written for each client the same way BroadcastSnapshot
+does it, then read back through its replicas the same way the client's
+handlers do, with the objects each packet is for looked up from their
+headers. Acknowledging it straight away turns any full states into
+baselines for the next one.
+*/
+SnapshotBenchmark::Result SnapshotBenchmark::Simulate(const std::string& source, int snapshots) {
+	typedef std::chrono::steady_clock Clock;
+	Result r;
+	r.source	= source;
+	r.objects	= (int)bodies.size();
+	r.clients	= (int)clients.size();
+	r.snapshots	= snapshots;
+
+	FullPacket	fullPacket;
+	DeltaPacket	deltaPacket;
+	std::vector<std::vector<SnapshotPacket>> packets(clients.size());
+	for (auto& p : packets) {
+		p.resize(1);
+	}
+	std::vector<int> packetsUsed(clients.size());
+
+	double encodeTime		= 0.0;
+	double decodeTime		= 0.0;
+	double encodeAllocs		= 0.0;
+	double decodeAllocs		= 0.0;
+	double fullBytes		= 0.0;
+	double deltaBytes		= 0.0;
+	double snapshotBytes	= 0.0;
+	double compressedBytes	= 0.0;
+	double xorBytes			= 0.0;
+	double packetCount		= 0.0;
+	int fulls	= 0;
+	int deltas	= 0;
+
+	//Compressed the way ENet does it, which sends the packet as it was if that's no smaller
+	void* rangeCoder = enet_range_coder_create();
+	enet_uint8 compressed[NetworkBase::MaxPacketSize];
+	auto compressedSize = [&](const SnapshotPacket& p) {
+		ENetBuffer buffer;
+		buffer.data			= (void*)&p;
+		buffer.dataLength	= p.GetTotalSize();
+		size_t size = rangeCoder ? enet_range_coder_compress(rangeCoder, &buffer, 1, buffer.dataLength, compressed, buffer.dataLength) : 0;
+		return size > 0 ? (double)size : (double)buffer.dataLength;
+	};
+
+	for (int s = 1; s <= snapshots; ++s) {
+		Move(s - 1);
+
+		unsigned int allocationsBefore = AllocationCounter::GetCount();
+		auto start = Clock::now();
+		for (Body& b : bodies) {
+			b.network->SetSnapshot(s);
+		}
+		for (size_t c = 0; c < clients.size(); ++c) {
+			Client& client		= clients[c];
+			int& used			= packetsUsed[c];
+			used				= 1;
+			packets[c][0].Clear();
+			packets[c][0].snapshotID = s;
+			for (size_t i = 0; i < bodies.size(); ++i) {
+				int baseline	= client.baselines[i];
+				bool pending	= client.pendingFulls[i] >= 0;
+				bool stale		= baseline >= 0 && s - baseline >= BaselineRefreshSnapshots;
+				bool useDelta	= baseline >= 0 && (!stale || pending);
+
+				GamePacket* p = bodies[i].network->WritePacket(fullPacket, deltaPacket, useDelta, baseline);
+				if (!p) {
+					continue;
+				}
+				if (p->type == Full_State) {
+					fullBytes += p->GetTotalSize();
+					fulls++;
+					if (!pending) {
+						client.pendingFulls[i] = s;
+					}
+				}
+				else {
+					deltaBytes += p->GetTotalSize();
+					deltas++;
+				}
+				if (!packets[c][used - 1].Append(*p)) {
+					if (used == (int)packets[c].size()) {
+						packets[c].emplace_back();
+					}
+					packets[c][used].Clear();
+					packets[c][used].snapshotID = s;
+					packets[c][used].Append(*p);
+					used++;
+				}
+			}
+		}
+		encodeTime		+= std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		encodeAllocs	+= AllocationCounter::GetCount() - allocationsBefore;
+
+		allocationsBefore	= AllocationCounter::GetCount();
+		start				= Clock::now();
+		for (size_t c = 0; c < clients.size(); ++c) {
+			Client& client = clients[c];
+			for (int i = 0; i < packetsUsed[c]; ++i) {
+				packets[c][i].ForEachPacket([&](const GamePacket& p) {
+					int objectID = -1;
+					if (p.type == Full_State) {
+						int playerID;
+						NetworkState state;
+						if (!((const FullPacket&)p).Read(objectID, playerID, state)) {
+							r.readFailures++;
+							return;
+						}
+					}
+					else if (p.type == Delta_State) {
+						int fullID;
+						if (!((const DeltaPacket&)p).ReadHeader(objectID, fullID)) {
+							r.readFailures++;
+							return;
+						}
+					}
+					if (objectID < 0 || objectID >= (int)client.networks.size() ||
+						!client.networks[objectID]->ReadPacket((GamePacket&)p, s)) {
+						r.readFailures++;
+					}
+				});
+			}
+		}
+		decodeTime		+= std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		decodeAllocs	+= AllocationCounter::GetCount() - allocationsBefore;
+
+		for (size_t c = 0; c < clients.size(); ++c) {
+			Client& client = clients[c];
+			for (int i = 0; i < packetsUsed[c]; ++i) {
+				snapshotBytes	+= packets[c][i].GetTotalSize();
+				compressedBytes += compressedSize(packets[c][i]);
+			}
+			//Only a snapshot that fits in one packet is XORed, the same as the game does
+			SnapshotPacket xored = packets[c][0];
+			client.sent.Encode(xored, packetsUsed[c] == 1 ? s - 1 : -1);
+			if (packetsUsed[c] > 1) {
+				client.sent.Forget(s);
+			}
+			xorBytes += compressedSize(xored);
+			for (int i = 1; i < packetsUsed[c]; ++i) {
+				xorBytes += compressedSize(packets[c][i]);
+			}
+			packetCount += packetsUsed[c];
+			for (size_t i = 0; i < bodies.size(); ++i) {
+				if (client.pendingFulls[i] >= 0) {
+					client.baselines[i]		= client.pendingFulls[i];
+					client.pendingFulls[i]	= -1;
+				}
+				client.networks[i]->UpdateInterpolation((float)s, 0.0f);
+				float error = (client.replicas[i]->GetTransform().GetPosition() - bodies[i].object->GetTransform().GetPosition()).Length();
+				r.maxPositionError = error > r.maxPositionError ? error : r.maxPositionError;
+			}
+		}
+		for (Body& b : bodies) {
+			b.network->UpdateStateHistory(s - BaselineRefreshSnapshots * 2);
+		}
+	}
+
+	double perObject	= (double)snapshots * bodies.size() * clients.size();
+	double perClient	= (double)snapshots * clients.size();
+	r.fullBytes			= fulls > 0 ? (float)(fullBytes / fulls) : 0.0f;
+	r.deltaBytes		= deltas > 0 ? (float)(deltaBytes / deltas) : 0.0f;
+	r.deltaFraction		= fulls + deltas > 0 ? (float)deltas / (float)(fulls + deltas) : 0.0f;
+	r.snapshotBytes		= perClient > 0.0 ? (float)(snapshotBytes / perClient) : 0.0f;
+	r.packetsPerSnapshot = perClient > 0.0 ? (float)(packetCount / perClient) : 0.0f;
+	r.compressedBytes	= perClient > 0.0 ? (float)(compressedBytes / perClient) : 0.0f;
+	r.xorCompressedBytes = perClient > 0.0 ? (float)(xorBytes / perClient) : 0.0f;
+	if (rangeCoder) {
+		enet_range_coder_destroy(rangeCoder);
+	}
+	r.encodeTime		= perObject > 0.0 ? (float)(encodeTime / perObject) : 0.0f;
+	r.decodeTime		= perObject > 0.0 ? (float)(decodeTime / perObject) : 0.0f;
+	r.encodeAllocations	= (float)(encodeAllocs / snapshots);
+	r.decodeAllocations	= (float)(decodeAllocs / snapshots);
+	return r;
+}
+
+/*
+Only the object states in the recording's snapshots are used. They're
+read back with the benchmark's quantisation rather than the level's, so
+they may not be where they were in the game, but they're exactly the
+same quantised values, so they're sent again in exactly as many bits.
+Objects missing from a snapshot stay where they last were, and are where
+they first turn up until then.
+*/
+bool SnapshotBenchmark::LoadRecording(const std::string& filename) {
+	recorded.clear();
+	PacketPlayback playback;
+	if (!playback.Open(filename)) {
+		return false;
+	}
+	std::map<int, std::map<int, NetworkState>> bySnapshot;	//snapshot, then object ID
+	std::map<int, std::map<int, NetworkState>> baselines;	//object ID, then state ID
+	std::map<int, int> objectIndices;
+	SnapshotHistory received; //for undoing the server's XOR
+
+	playback.Update(playback.GetDuration() + 1.0f, [&](GamePacket* packet) {
+		if (packet->type != Snapshot_State) {
+			return;
+		}
+		SnapshotPacket& snapshot = *(SnapshotPacket*)packet;
+		if (!received.Decode(snapshot)) {
+			return;
+		}
+		snapshot.ForEachPacket([&](const GamePacket& p) {
+			int objectID = -1;
+			NetworkState state;
+			if (p.type == Full_State) {
+				int playerID;
+				if (!((const FullPacket&)p).Read(objectID, playerID, state)) {
+					return;
+				}
+				baselines[objectID][state.stateID] = state;
+			}
+			else if (p.type == Delta_State) {
+				int fullID;
+				const DeltaPacket& delta = (const DeltaPacket&)p;
+				if (!delta.ReadHeader(objectID, fullID)) {
+					return;
+				}
+				auto object = baselines.find(objectID);
+				if (object == baselines.end()) {
+					return;
+				}
+				auto baseline = object->second.find(fullID);
+				if (baseline == object->second.end() || !delta.Read(baseline->second, state)) {
+					return;
+				}
+			}
+			else {
+				return;
+			}
+			objectIndices.insert({ objectID, (int)objectIndices.size() });
+			bySnapshot[snapshot.snapshotID][objectID] = state;
+		});
+	});
+	if (bySnapshot.empty()) {
+		return false;
+	}
+
+	std::vector<NetworkState> current(objectIndices.size());
+	std::vector<bool> seen(objectIndices.size(), false);
+	for (auto& s : bySnapshot) {
+		for (auto& o : s.second) {
+			int i = objectIndices[o.first];
+			if (!seen[i]) {
+				current[i]	= o.second;
+				seen[i]		= true;
+			}
+		}
+	}
+	for (auto& s : bySnapshot) {
+		for (auto& o : s.second) {
+			current[objectIndices[o.first]] = o.second;
+		}
+		recorded.emplace_back(current);
+	}
+	return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "NetworkObject.h"
+#include "SnapshotHistory.h"
+#include <vector>
+#include <string>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Sends world states through NetworkObject's full and delta packets,
+		the way the server's snapshots do, to however many clients, each with
+		copies of the objects of its own that decode them, so how many bytes
+		a snapshot takes, and how long it takes to write and read, can be
+		seen for any number of objects. Anything that overrides WritePacket
+		or ReadPacket is measured the same way.
+
+		Synthetic worlds move their objects one of a few ways. A recording
+		from -record is decoded into each object's states, which are then
+		sent again just as the synthetic ones are, so the game's own motion
+		can be measured. Every object goes in every snapshot, which is the
+		most the server would send, and clients acknowledge each snapshot
+		as soon as they've had it, so baselines are only as old as the
+		refresh makes them.
+
+		Each client's replicas are checked against the server's objects
+		after every snapshot, so an encoder that loses precision shows up.
+
+		Every packet is also put through ENet's range coder, as hosts do
+		before sending, both as it is and XORed against the client's last
+		snapshot, to see how much each of those saves.
+		*/
+		class SnapshotBenchmark {
+		public:
+			enum class Motion {
+				Idle,			//nothing moves, so deltas have nothing in them
+				Drifting,		//everything walks about slowly, turning as it goes
+				Projectiles,	//everything flies in straight lines, fast
+				Mixed,			//mostly idle, some drifting, a few projectiles
+				Recorded
+			};
+
+			struct Result {
+				std::string	source;
+				int			objects				= 0;
+				int			clients				= 0;
+				int			snapshots			= 0;
+				float		fullBytes			= 0.0f;	//per full state sent, packet header and all
+				float		deltaBytes			= 0.0f;
+				float		deltaFraction		= 0.0f;	//of the states sent
+				float		snapshotBytes		= 0.0f;	//per client per snapshot
+				float		packetsPerSnapshot	= 0.0f;	//per client
+				float		compressedBytes		= 0.0f;	//per client per snapshot, after the range coder
+				float		xorCompressedBytes	= 0.0f;	//the same, XORed against the snapshot before first
+				float		encodeTime			= 0.0f;	//ns per object per client
+				float		decodeTime			= 0.0f;
+				float		encodeAllocations	= 0.0f;	//per snapshot, over every client
+				float		decodeAllocations	= 0.0f;
+				int			readFailures		= 0;
+				float		maxPositionError	= 0.0f;
+			};
+
+			SnapshotBenchmark(int snapshots = 300, unsigned int seed = 1);
+			~SnapshotBenchmark();
+
+			Result Run(Motion motion, int objects, int clients);
+			//Returns a Result with no snapshots if the recording couldn't be used
+			Result RunRecording(const std::string& filename, int clients);
+
+			//Every motion at every object count, then every recording, printed as
+			//they finish, and written out as CSV
+			void RunAll(const std::vector<int>& objectCounts, int clients, const std::vector<std::string>& recordings,
+				const std::string& csvFile = "SnapshotBenchmark.csv");
+
+			static const char* GetMotionName(Motion m);
+
+			//The same as the game's
+			static const int	BaselineRefreshSnapshots = 60;
+			static const float	SnapshotDT;
+			static const float	WorldSize;
+
+		protected:
+			struct Body {
+				GameObject*		object;
+				NetworkObject*	network;
+				Vector3			velocity;
+				Vector3			spin;	//axis times degrees per second
+			};
+
+			struct Client {
+				std::vector<GameObject*>	replicas;
+				std::vector<NetworkObject*>	networks;
+				std::vector<int>			baselines;		//-1 for none yet
+				std::vector<int>			pendingFulls;	//sent, but not acknowledged yet
+				SnapshotHistory				sent;
+			};
+
+			void	Build(Motion motion, int objects, int clients);
+			void	Clear();
+			void	Move(int snapshot);
+			Result	Simulate(const std::string& source, int snapshots);
+
+			bool	LoadRecording(const std::string& filename);
+
+			std::mt19937			random;
+			int						snapshotCount;
+			Motion					motion;
+			std::vector<Body>		bodies;
+			std::vector<Client>		clients;
+
+			//A recording's states, for each snapshot, for each object in it
+			std::vector<std::vector<NetworkState>> recorded;
+		};
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "NetworkObject.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		The last few snapshot packets sent to (or received from) one peer,
+		as they were before being XORed, for the next ones to be XORed
+		against. Most of a snapshot lines up byte for byte with the one
+		before it - the same objects, in the same order, with deltas that
+		have barely changed - so what's left is mostly zeros, which ENet's
+		range coder squeezes down to very little.
+
+		The server only ever XORs against a snapshot the client has
+		acknowledged, so the client always has it, however many packets
+		went missing in between. Snapshots that took more than one packet
+		are never used, as there's no saying which of them the client got.
+		*/
+		class SnapshotHistory {
+		public:
+			static const int Length = 32; //about a second of snapshots, at 30Hz
+
+			SnapshotHistory() {
+				Clear();
+			}
+			~SnapshotHistory() {}
+
+			//Received packets are only as long as they need to be, so only that much is copied
+			void Store(const SnapshotPacket& p) {
+				memcpy(&entries[Slot(p.snapshotID)], &p, p.GetTotalSize());
+			}
+
+			//For a snapshot that turned out to need more packets than the one stored
+			void Forget(int snapshotID) {
+				SnapshotPacket& e = entries[Slot(snapshotID)];
+				if (e.snapshotID == snapshotID) {
+					e.snapshotID = -1;
+				}
+			}
+
+			const SnapshotPacket* Find(int snapshotID) const {
+				const SnapshotPacket& e = entries[Slot(snapshotID)];
+				return snapshotID >= 0 && e.snapshotID == snapshotID ? &e : nullptr;
+			}
+
+			//Stores p as it is, then XORs it against base, if that's still here
+			void Encode(SnapshotPacket& p, int baseID) {
+				Store(p);
+				const SnapshotPacket* base = Find(baseID);
+				if (base && baseID != p.snapshotID) {
+					p.XorWith(*base);
+					p.xorBaseID = baseID;
+				}
+			}
+
+			//Undoes Encode, returning false if whatever p was XORed against never arrived
+			bool Decode(SnapshotPacket& p) {
+				if (p.size < SnapshotPacket::HeaderSize() || p.GetTotalSize() > (int)sizeof(SnapshotPacket)) {
+					return false;
+				}
+				if (p.xorBaseID >= 0) {
+					const SnapshotPacket* base = Find(p.xorBaseID);
+					if (!base) {
+						return false;
+					}
+					p.XorWith(*base);
+					p.xorBaseID = -1;
+				}
+				Store(p);
+				return true;
+			}
+
+			void Clear() {
+				for (SnapshotPacket& e : entries) {
+					e.snapshotID = -1;
+				}
+			}
+
+		protected:
+			static int Slot(int snapshotID) {
+				return (snapshotID < 0 ? 0 : snapshotID) % Length;
+			}
+
+			SnapshotPacket entries[Length];
+		};
+	}
+}
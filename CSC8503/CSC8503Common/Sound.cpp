@@ -1,5 +1,7 @@
 #include "Sound.h"
+#include "StreamedSound.h"
 #include "..\..\Common\Assets.h"
+#include "../../Common/AssetFile.h"
 
 using namespace NCL::CSC8503;
 
@@ -26,7 +28,7 @@ double Sound::GetLength() {
 void Sound::LoadFromWAV(string filename) {
 	string realPath = Assets::SOUNDSDIR + filename;
 
-	ifstream	file(realPath.c_str(),ios::in|ios::binary);
+	AssetStream	file(realPath);
 
 	if(!file) {
 		cout << "Failed to load WAV file '" << filename << "'!" << endl; 
@@ -36,7 +38,7 @@ void Sound::LoadFromWAV(string filename) {
 	string		 chunkName;
 	unsigned int chunkSize;
 
-	while(!file.eof()) {
+	while(file.good()) { //a seek past the end fails rather than hitting eof
 		LoadWAVChunkInfo(file,chunkName, chunkSize);
 
 		if(chunkName == "RIFF") {
@@ -73,10 +75,9 @@ void Sound::LoadFromWAV(string filename) {
 
 	length = (float)size / (channels * freqRate * (bitRate / 8.0f)) * 1000.0f;
 
-	file.close();
 }
 
-void Sound::LoadWAVChunkInfo(ifstream &file, string &name, unsigned int &size) {
+void Sound::LoadWAVChunkInfo(istream &file, string &name, unsigned int &size) {
 	char chunk[4];
 	file.read((char*)&chunk,4);
 	file.read((char*)&size,4);
@@ -85,24 +86,43 @@ void Sound::LoadWAVChunkInfo(ifstream &file, string &name, unsigned int &size) {
 }
 
 void Sound::AddSound(string name) {
-	Sound *s = GetSound(name);
+	if(!GetSound(name)) {
+		AddSound(name, LoadSound(name));
+	}
+}
 
-	if(!s) {
-		string extension = name.substr(name.length()-3,3);
+Sound* Sound::LoadSound(string name) {
+	string extension = name.substr(name.length()-3,3);
 
-		if(extension == "wav") {
-			s = new Sound();
-			s->LoadFromWAV(name);
-			alGenBuffers(1,&s->buffer);
-			alBufferData(s->buffer,s->GetOALFormat(),s->GetData(),s->GetSize(),(ALsizei)s->GetFrequency());
-		}
-		else{
-			s = new Sound();
-			cout << "Incompatible file extension '" << extension << "'!" << endl;
+	if(extension == "wav") {
+		//Long sounds, like music, are left on disk and streamed from there
+		StreamedSound* streamed = new StreamedSound();
+		if(streamed->Open(name) && streamed->GetSize() >= StreamedSound::StreamThreshold) {
+			return streamed;
 		}
+		delete streamed;
+	}
+	Sound* s = new Sound();
 
-		sounds.insert(make_pair(name, s));
+	if(extension == "wav") {
+		s->LoadFromWAV(name);
+	}
+	else{
+		cout << "Incompatible file extension '" << extension << "'!" << endl;
+	}
+	return s;
+}
+
+void Sound::AddSound(string name, Sound* s) {
+	if(GetSound(name)) {
+		delete s;
+		return;
+	}
+	if(s->GetData()) {
+		alGenBuffers(1,&s->buffer);
+		alBufferData(s->buffer,s->GetOALFormat(),s->GetData(),s->GetSize(),(ALsizei)s->GetFrequency());
 	}
+	sounds.insert(make_pair(name, s));
 }
 
 Sound* NCL::CSC8503::Sound::GetSound(string name) {
@@ -39,6 +39,10 @@ namespace NCL {
 			double			GetLength();
 
 			static void		AddSound(string n);
+			//Loading can be split in two, so the file can be read on any thread,
+			//and only handing it to OpenAL has to be on the main one
+			static Sound*	LoadSound(string n);
+			static void		AddSound(string n, Sound* s);
 			static Sound*	GetSound(string name);
 
 			static void		DeleteSounds();
@@ -48,7 +52,7 @@ namespace NCL {
 			virtual ~Sound(void);
 
 			void			LoadFromWAV(string filename);
-			void			LoadWAVChunkInfo(ifstream& file, string& name, unsigned int& size);
+			void			LoadWAVChunkInfo(istream& file, string& name, unsigned int& size);
 
 			char* data;
 			ALuint			buffer;
@@ -1,44 +1,37 @@
 #pragma once
 
 #include "GameObject.h"
-#include "Sound.h"
+#include "SoundVoice.h"
 #include "SoundSystem.h"
 
-#define NUM_STREAM_BUFFERS 3
-
 namespace NCL {
 	namespace CSC8503 {
 
-		enum SoundPriority {
-			SOUNDPRIORTY_LOW,
-			SOUNDPRIORITY_MEDIUM,
-			SOUNDPRIORITY_HIGH,
-			SOUNDPRIORITY_ALWAYS
-		};	
-
-		struct OALSource;
-
+		/*
+		A sound in the world. All it has is how it's meant to sound - the
+		SoundSystem copies that out every frame it's updated, and it's the
+		mixer's own voice for it that's actually heard.
+		*/
 		class SoundEmitter : public GameObject {
+			friend class SoundSystem;
 		public:
 			SoundEmitter(void);
 			SoundEmitter(Sound* s);
 			~SoundEmitter(void);
 
-			void			Reset();
-
-			void			SetSound(Sound* s);
+			void			SetSound(Sound* s) { sound = s; }
 			Sound*			GetSound() { return sound; }
 
 			void			SetPriority(SoundPriority p) { priority = p; }
 			SoundPriority	GetPriority() { return priority; }
 
-			void			SetVolume(float value) { volume = min(1.0f, max(0.0f, value)); }
+			void			SetVolume(float value) { volume = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value); }
 			float			GetVolume() { return volume; }
 
 			void			SetLooping(bool state) { isLooping = state; }
 			bool			GetLooping() { return isLooping; }
 
-			void			SetRadius(float value) { radius = max(0.0f, value); }
+			void			SetRadius(float value) { radius = value < 0.0f ? 0.0f : value; }
 			float			GetRadius() { return radius; }
 
 			float			GetPitch() { return pitch; }
@@ -47,32 +40,20 @@ namespace NCL {
 			bool			GetIsGlobal() { return isGlobal; }
 			void			SetIsGlobal(bool value) { isGlobal = value; }
 
-			double			GetTimeLeft() { return timeLeft; }
-
-			OALSource* GetSource() { return oalSource; }
-
-			void			UpdateSoundState(float msec);
-
-			static bool		CompareNodesByPriority(SoundEmitter* a, SoundEmitter* b);
-
-			void			AttachSource(OALSource* s);
-			void			DetachSource();
-
 			void			Update(float dt) override;
 
 		protected:
-			Sound* sound;
-			OALSource* oalSource;
+			void			Reset();
+
+			Sound*			sound;
 			SoundPriority	priority;
 			float			volume;
 			float			radius;
 			float			pitch;
 			bool			isLooping;
 			bool			isGlobal;
-			double			timeLeft;
 
-			double			streamPos;						
-			ALuint			streamBuffers[NUM_STREAM_BUFFERS];
+			bool			registered;	//with the SoundSystem, which has to be told when it's deleted
 		};
 	}
 }
\ No newline at end of file
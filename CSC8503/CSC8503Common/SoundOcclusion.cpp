@@ -0,0 +1,115 @@
+#include "SoundOcclusion.h"
+#include "GameWorld.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float SoundOcclusion::OcclusionLifetime	= 0.2f;
+const float SoundOcclusion::ForgetAfter			= 2.0f;
+const float SoundOcclusion::SideOffset			= 1.5f;
+const float SoundOcclusion::EndSlack			= 0.5f;
+const float SoundOcclusion::TriggerCellSize		= 4.0f;
+
+namespace {
+	//How much each of a sound's lines counts towards it being occluded - the direct one, then either side
+	const float RayWeights[SoundOcclusion::RaysPerSound] = { 0.5f, 0.25f, 0.25f };
+}
+
+SoundOcclusion::SoundOcclusion(const GameWorld& world, CollisionLayer rayLayer) : world(world) {
+	this->rayLayer	= rayLayer;
+	time			= 0.0f;
+}
+
+float SoundOcclusion::GetOcclusion(const SoundEmitter* emitter, const Vector3& position) {
+	return GetOcclusion((uint64_t)(uintptr_t)emitter, position);
+}
+
+float SoundOcclusion::GetTriggerOcclusion(const Vector3& position) {
+	uint64_t x = (uint64_t)(int64_t)floorf(position.x / TriggerCellSize) & 0x1FFFFF;
+	uint64_t y = (uint64_t)(int64_t)floorf(position.y / TriggerCellSize) & 0x1FFFFF;
+	uint64_t z = (uint64_t)(int64_t)floorf(position.z / TriggerCellSize) & 0x1FFFFF;
+	return GetOcclusion((x << 43) | (y << 22) | (z << 1) | 1, position);
+}
+
+float SoundOcclusion::GetOcclusion(uint64_t key, const Vector3& position) {
+	Occlusion& o = sounds[key];
+	o.position	= position;
+	o.askedAt	= time;
+	if (!o.queued && o.checkedAt < 0.0f) {
+		o.queued = true;
+		queue.push_front(key); //no answer at all matters more than an old one
+	}
+	else if (!o.queued && time - o.checkedAt > OcclusionLifetime) {
+		o.queued = true;
+		queue.push_back(key);
+	}
+	return o.occlusion;
+}
+
+void SoundOcclusion::RemoveEmitter(const SoundEmitter* emitter) {
+	sounds.erase((uint64_t)(uintptr_t)emitter); //anything still queued for it is skipped
+}
+
+void SoundOcclusion::Update(float dt, const Vector3& listenerPosition) {
+	time += dt;
+	batchKeys.clear();
+	batchFrom.clear();
+	batchTo.clear();
+	while ((int)batchFrom.size() + RaysPerSound <= RaysPerFrame && !queue.empty()) {
+		uint64_t key = queue.front();
+		queue.pop_front();
+
+		auto i = sounds.find(key);
+		if (i == sounds.end() || !i->second.queued) {
+			continue;
+		}
+		Occlusion& o = i->second;
+		o.queued = false;
+		if (time - o.askedAt > ForgetAfter) {
+			sounds.erase(i);
+			continue;
+		}
+		Vector3 offset	= o.position - listenerPosition;
+		float length	= offset.Length();
+		if (length <= EndSlack) {
+			o.occlusion	= 0.0f;
+			o.checkedAt	= time;
+			continue;
+		}
+		Vector3 end		= listenerPosition + offset * ((length - EndSlack) / length);
+		Vector3 side	= Vector3::Cross(offset, Vector3(0, 1, 0));
+		float sideLength = side.Length();
+		side = sideLength > 0.0001f ? side * (SideOffset / sideLength) : Vector3(SideOffset, 0, 0);
+
+		batchKeys.emplace_back(key);
+		batchFrom.emplace_back(listenerPosition);
+		batchTo.emplace_back(end);
+		batchFrom.emplace_back(listenerPosition + side);
+		batchTo.emplace_back(end + side);
+		batchFrom.emplace_back(listenerPosition - side);
+		batchTo.emplace_back(end - side);
+	}
+	if (batchKeys.empty()) {
+		return;
+	}
+	world.LineOfSightBatch(batchFrom, batchTo, batchVisible, rayLayer);
+
+	for (size_t k = 0; k < batchKeys.size(); ++k) {
+		auto i = sounds.find(batchKeys[k]);
+		if (i == sounds.end()) {
+			continue;
+		}
+		float occlusion = 0.0f;
+		for (int r = 0; r < RaysPerSound; ++r) {
+			occlusion += batchVisible[k * RaysPerSound + r] ? 0.0f : RayWeights[r];
+		}
+		i->second.occlusion	= occlusion;
+		i->second.checkedAt	= time;
+	}
+}
+
+void SoundOcclusion::Clear() {
+	sounds.clear();
+	queue.clear();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "CollisionLayer.h"
+#include "../../Common/Vector3.h"
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameWorld;
+		class SoundEmitter;
+		using Maths::Vector3;
+
+		/*
+		How much of the level is between the listener and each sound, from
+		0 (none of it) to 1 (it's round a corner), so a fight down another
+		corridor doesn't sound as if it's next to you. Each sound's checked
+		with three lines through the static tree - one straight to it, and
+		one either side - so a sound just behind a pillar is obstructed,
+		rather than muffled as much as one behind a wall.
+
+		Works the same way as the PerceptionSystem: answers are kept for
+		OcclusionLifetime seconds, then queued to be checked again, and
+		Update checks no more than RaysPerFrame rays' worth of them, all in
+		one batch. Emitters are kept by which one they are, and trigger
+		sounds by which TriggerCellSize cell they're in, so a fight's splats
+		all share the one answer. Until a sound's first been checked, it
+		isn't occluded.
+		*/
+		class SoundOcclusion {
+		public:
+			SoundOcclusion(const GameWorld& world, CollisionLayer rayLayer = CollisionLayer::RAY);
+
+			float	GetOcclusion(const SoundEmitter* emitter, const Vector3& position);
+			float	GetTriggerOcclusion(const Vector3& position);
+			void	RemoveEmitter(const SoundEmitter* emitter);
+
+			void	Update(float dt, const Vector3& listenerPosition);
+			void	Clear();
+
+			static const int	RaysPerSound	= 3;
+			static const int	RaysPerFrame	= 48;
+			static const float	OcclusionLifetime;
+			static const float	ForgetAfter;
+			static const float	SideOffset;		//how far either side of the direct line the others go
+			static const float	EndSlack;		//short of the sound, so what it's stuck to doesn't block it
+			static const float	TriggerCellSize;
+
+		protected:
+			struct Occlusion {
+				Vector3	position;
+				float	occlusion	= 0.0f;
+				float	checkedAt	= -1.0f; //never, if it's negative
+				float	askedAt		= 0.0f;
+				bool	queued		= false;
+			};
+
+			//Emitters go in as their address, and trigger cells with the bottom bit set, which no emitter has
+			float	GetOcclusion(uint64_t key, const Vector3& position);
+
+			const GameWorld&						world;
+			CollisionLayer							rayLayer;
+			std::unordered_map<uint64_t, Occlusion>	sounds;
+			std::deque<uint64_t>					queue;
+			float									time;
+
+			std::vector<uint64_t>	batchKeys;
+			std::vector<Vector3>	batchFrom;
+			std::vector<Vector3>	batchTo;
+			std::vector<char>		batchVisible;
+		};
+	}
+}
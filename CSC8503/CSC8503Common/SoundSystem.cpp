@@ -1,12 +1,35 @@
 #include "SoundSystem.h"
+#include "SoundOcclusion.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Plugins/OpenAL/include/efx.h"
+#include <chrono>
+#include <tuple>
 
 using namespace NCL::CSC8503;
 
 SoundSystem* SoundSystem::instance = NULL;
 
+const float SoundSystem::TriggerMergeRadius		= 2.0f;
+const float SoundSystem::OcclusionVolumeLoss	= 0.6f;
+const float SoundSystem::OcclusionHighLoss		= 0.9f;
+const float SoundSystem::OcclusionFadeRate		= 4.0f;
+
+//Only there if the device has EFX, which is checked for as the sound system's made
+namespace {
+	LPALGENFILTERS		genFilters		= NULL;
+	LPALDELETEFILTERS	deleteFilters	= NULL;
+	LPALFILTERI			filteri			= NULL;
+	LPALFILTERF			filterf			= NULL;
+}
+
 SoundSystem::SoundSystem(unsigned int channels) {
 	listener		= NULL;
+	occlusion		= NULL;
 	masterVolume	= 1.0f;
+	mixerFrame		= 0;
+	mixing			= false;
+	listenerForward	= Vector3(0, 0, -1);
+	listenerUp		= Vector3(0, 1, 0);
 
 	cout << "Creating SoundSystem!" << endl;
 	cout << "Found the following devices: " << alcGetString(NULL,ALC_DEVICE_SPECIFIER) << endl;	//outputs all OAL devices
@@ -39,15 +62,29 @@ SoundSystem::SoundSystem(unsigned int channels) {
 	}
 
 	cout << "SoundSystem has " << sources.size() << " channels available!"  << endl;
+
+	InitFilters();
+
+	for(int i = 0; i < TriggerEmitterCount; ++i) {
+		temporaryEmitters.push_back(new SoundVoice());
+	}
 }
 
 SoundSystem::~SoundSystem(void)	{
-	for(vector<SoundEmitter*>::iterator i = temporaryEmitters.begin(); i != temporaryEmitters.end(); ++i) {
+	if(mixer.joinable()) {
+		mixing = false;
+		mixer.join();
+	}
+	mixerEmitters.clear(); //while there's still a context for their sources
+	for(vector<SoundVoice*>::iterator i = temporaryEmitters.begin(); i != temporaryEmitters.end(); ++i) {
 		delete (*i);
 	}
 
 	for(vector<OALSource*>::iterator i = sources.begin(); i != sources.end(); ++i) {
 		alDeleteSources(1, &(*i)->source);
+		if((*i)->filter) {
+			deleteFilters(1, &(*i)->filter);
+		}
 		delete (*i);
 	}
 
@@ -56,61 +93,284 @@ SoundSystem::~SoundSystem(void)	{
 	alcCloseDevice(device);
 }
 
+/*
+Each source gets a low pass filter of its own, which how occluded its
+sound is sets the high end of. Without EFX, occluded sounds are still
+turned down, just not muffled.
+*/
+void SoundSystem::InitFilters() {
+	if(!device || !alcIsExtensionPresent(device, ALC_EXT_EFX_NAME)) {
+		cout << "SoundSystem has no EFX, so occluded sounds won't be muffled" << endl;
+		return;
+	}
+	genFilters		= (LPALGENFILTERS)alGetProcAddress("alGenFilters");
+	deleteFilters	= (LPALDELETEFILTERS)alGetProcAddress("alDeleteFilters");
+	filteri			= (LPALFILTERI)alGetProcAddress("alFilteri");
+	filterf			= (LPALFILTERF)alGetProcAddress("alFilterf");
+	if(!genFilters || !deleteFilters || !filteri || !filterf) {
+		genFilters = NULL;
+		return;
+	}
+	for(OALSource* s : sources) {
+		genFilters(1, &s->filter);
+		if(alGetError() != AL_NO_ERROR) {
+			s->filter = 0;
+			continue;
+		}
+		filteri(s->filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+		filterf(s->filter, AL_LOWPASS_GAIN, 1.0f);
+		filterf(s->filter, AL_LOWPASS_GAINHF, 1.0f);
+	}
+}
+
+void SoundSystem::SetSourceOcclusion(OALSource* s, float occlusion) const {
+	if(!s || !s->filter) {
+		return;
+	}
+	filterf(s->filter, AL_LOWPASS_GAINHF, 1.0f - occlusion * OcclusionHighLoss);
+	alSourcei(s->source, AL_DIRECT_FILTER, (ALint)s->filter); //only takes the filter's settings as it's attached
+}
+
+void SoundSystem::StartMixer() {
+	mixing	= true;
+	mixer	= std::thread([this]() { MixerThread(); });
+}
+
+void SoundSystem::MixerThread() {
+	using namespace std::chrono;
+	const microseconds interval(1000000 / MixRate);
+	steady_clock::time_point last = steady_clock::now();
+	while(mixing) {
+		steady_clock::time_point now = steady_clock::now();
+		float dt = duration<float>(now - last).count();
+		last = now;
+		Mix(dt < 0.1f ? dt : 0.1f);
+		std::this_thread::sleep_until(now + interval);
+	}
+}
+
+/*
+All the game thread does is copy out where every emitter it was given this
+frame is, and what it's set to, along with where the listener is. Without
+a mixer thread, the mixing's then done straight away.
+*/
 void SoundSystem::Update(float msec) {
+	MemoryTagScope tag(MemoryTag::Audio);
+	Vector3 listenerAt = listener ? listener->GetTransform().GetPosition() : Vector3();
+	for(SoundEmitter* e : frameEmitters) {
+		SoundCommand c;
+		c.type		= SoundCommandType::EmitterState;
+		c.emitter	= e;
+		c.sound		= e->GetSound();
+		c.position	= e->GetTransform().GetPosition();
+		c.volume	= e->GetVolume();
+		c.pitch		= e->GetPitch();
+		c.radius	= e->GetRadius();
+		c.occlusion	= occlusion && !e->GetIsGlobal() ? occlusion->GetOcclusion(e, c.position) : 0.0f;
+		c.priority	= (int)e->GetPriority();
+		c.global	= e->GetIsGlobal();
+		c.looping	= e->GetLooping();
+		PushCommand(c, false);
+	}
+	frameEmitters.clear();
+	if(occlusion) {
+		occlusion->Update(msec, listenerAt); //for next frame's emitters, and the triggers from now till then
+	}
+
+	SoundCommand frame;
+	frame.type		= SoundCommandType::Frame;
+	frame.emitter	= NULL;
+	frame.sound		= NULL;
+	frame.forward	= Vector3(0, 0, -1);
+	frame.up		= Vector3(0, 1, 0);
+	if(listener) {
+		Matrix4 worldMat = listener->GetTransform().GetMatrix();
+		frame.position	= listenerAt;
+		frame.forward	= Vector3(-worldMat.array[2], -worldMat.array[6], -worldMat.array[10]);
+		frame.up		= Vector3(worldMat.array[1], worldMat.array[5], worldMat.array[9]);
+	}
+	PushCommand(frame, false);
+
+	if(!mixer.joinable()) {
+		Mix(msec);
+	}
+}
+
+void SoundSystem::AddSoundEmitter(SoundEmitter* s) {
+	s->registered = true;
+	frameEmitters.push_back(s);
+}
+
+void SoundSystem::RemoveSoundEmitter(SoundEmitter* s) {
+	vector<SoundEmitter*>::iterator i = std::find(frameEmitters.begin(), frameEmitters.end(), s);
+	if(i != frameEmitters.end()) {
+		frameEmitters.erase(i);
+	}
+	if(occlusion) {
+		occlusion->RemoveEmitter(s);
+	}
+	SoundCommand c;
+	c.type		= SoundCommandType::EmitterRemoved;
+	c.emitter	= s;
+	c.sound		= NULL;
+	PushCommand(c, true);
+}
+
+/*
+If the mixer's fallen so far behind that the queue's full, anything that
+will be sent again next frame anyway is dropped, rather than holding up
+the game - but an emitter going away, or the volume changing, has to wait
+for space.
+*/
+void SoundSystem::PushCommand(const SoundCommand& c, bool mustArrive) {
+	while(!commands.Push(c)) {
+		if(!mixer.joinable()) {
+			ProcessCommands();	//This is the mixer, so it can just catch up
+		}
+		else if(!mustArrive) {
+			return;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void SoundSystem::ProcessCommands() {
+	SoundCommand c;
+	while(commands.Pop(c)) {
+		ApplyCommand(c);
+	}
+}
+
+void SoundSystem::ApplyCommand(const SoundCommand& c) {
+	switch(c.type) {
+	case SoundCommandType::EmitterState: {
+		auto i = mixerEmitters.find(c.emitter);
+		if(i == mixerEmitters.end()) {
+			i = mixerEmitters.emplace(std::piecewise_construct, std::forward_as_tuple(c.emitter), std::forward_as_tuple()).first;
+			i->second.frame = mixerFrame - 1;
+		}
+		MixerEmitter& m = i->second;
+		SoundVoice* e = &m.voice;
+		if(e->GetSound() != c.sound) {
+			e->SetSound(c.sound);
+		}
+		e->SetVolume(c.volume);
+		e->SetPitch(c.pitch);
+		e->SetRadius(c.radius);
+		e->SetOcclusion(c.occlusion, !e->GetSource()); //there's nothing to fade from if it's not being heard
+		e->SetPriority((SoundPriority)c.priority);
+		e->SetIsGlobal(c.global);
+		e->SetLooping(c.looping);
+		e->SetPosition(c.position);
+		if(m.frame != mixerFrame) {
+			m.frame = mixerFrame;
+			nextActiveEmitters.push_back(&m);
+		}
+	}break;
+	case SoundCommandType::EmitterRemoved: {
+		auto i = mixerEmitters.find(c.emitter);
+		if(i == mixerEmitters.end()) {
+			break;
+		}
+		MixerEmitter* m = &i->second;
+		activeEmitters.erase(std::remove(activeEmitters.begin(), activeEmitters.end(), m), activeEmitters.end());
+		nextActiveEmitters.erase(std::remove(nextActiveEmitters.begin(), nextActiveEmitters.end(), m), nextActiveEmitters.end());
+		mixerEmitters.erase(i);
+	}break;
+	case SoundCommandType::PlayTrigger:
+		TriggerSound(c);
+		break;
+	case SoundCommandType::MasterVolume:
+		masterVolume = c.volume;
+		alListenerf(AL_GAIN, masterVolume);
+		break;
+	case SoundCommandType::Frame:
+		listenerPosition	= c.position;
+		listenerForward		= c.forward;
+		listenerUp			= c.up;
+		//Anything the game didn't send this time has stopped updating, so shouldn't be heard
+		for(MixerEmitter* m : activeEmitters) {
+			if(m->frame != mixerFrame) {
+				m->voice.DetachSource();
+			}
+		}
+		activeEmitters.swap(nextActiveEmitters);
+		nextActiveEmitters.clear();
+		mixerFrame++;
+		break;
+	}
+}
+
+/*
+Every emitter keeps track of how far through its sound it is, whether
+it has a source or not, so any that don't get one this frame are still
+in the right place when they do. Only the ones that are most worth
+hearing are picked out with nth_element, as which order the rest are
+in doesn't matter, and anything culled is compacted out of the list
+rather than erased one at a time.
+*/
+void SoundSystem::Mix(float dt) {
+	ProcessCommands();
 	UpdateListener();
-	UpdateTemporaryEmitters(msec);
+
+	for(MixerEmitter* m : activeEmitters) {
+		emitters.push_back(&m->voice);
+	}
+	UpdateTemporaryEmitters(dt);
 
 	//Update values for every node, whether in range or not
-	for(vector<SoundEmitter*>::iterator i = emitters.begin(); i != emitters.end(); ++i) {
-		if (*i) (*i)->UpdateSoundState(msec);
+	for(vector<SoundVoice*>::iterator i = emitters.begin(); i != emitters.end(); ++i) {
+		if (*i) (*i)->UpdateSoundState(dt);
 	}
 
 	CullNodes();	//First off, remove nodes that are too far away
 
 	if(emitters.size() > sources.size()) {
-		std::sort(emitters.begin(), emitters.end(), SoundEmitter::CompareNodesByPriority);	//Then sort by priority
+		vector<SoundVoice*>::iterator lastHeard = emitters.begin() + sources.size();
+		std::nth_element(emitters.begin(), lastHeard, emitters.end(), SoundVoice::CompareNodesByPriority);
 
-		DetachSources(emitters.begin() + (sources.size()+1), emitters.end());		//Detach sources from nodes that won't be covered this frame
-		AttachSources(emitters.begin(), emitters.begin() + (sources.size()));	//And attach sources to nodes that WILL be covered this frame
+		DetachSources(lastHeard, emitters.end());		//Detach sources from nodes that won't be covered this frame
+		AttachSources(emitters.begin(), lastHeard);		//And attach sources to nodes that WILL be covered this frame
 	}
 	else {
 		AttachSources(emitters.begin(), emitters.end());//And attach sources to nodes that WILL be covered this frame
 	}
 
 	emitters.clear();	//We're done for the frame! empty the emitters list
+	triggeredThisFrame.clear();
 }
 
 void SoundSystem::CullNodes() {
-	for(vector<SoundEmitter*>::iterator i = emitters.begin(); i != emitters.end();) {
-
-		float length;
-
-		if((*i)->GetIsGlobal()) {
-			length = 0.0f;
-		}
-		else{
-			length = (listener->GetTransform().GetPosition() - 
-				(*i)->GetTransform().GetPosition()).Length();
+	Vector3 listenerPos = listenerPosition;
+	size_t kept = 0;
+	for(size_t i = 0; i < emitters.size(); ++i) {
+		SoundVoice* e = emitters[i];
+		if(!e) {
+			continue;
 		}
-		
-		if(length > (*i)->GetRadius() || !(*i)->GetSound() || (*i)->GetTimeLeft() < 0) {
-			(*i)->DetachSource();	//Important!
-			i = emitters.erase(i);
+		float length = e->GetIsGlobal() ? 0.0f : (listenerPos - e->GetPosition()).Length();
+		e->SetListenerDistance(length);
+
+		if(length > e->GetRadius() || !e->GetSound() || e->GetTimeLeft() < 0) {
+			e->DetachSource();	//Important!
 		}
 		else{
-			++i;
+			emitters[kept++] = e;
 		}
 	}
+	emitters.resize(kept);
 }
 
-void SoundSystem::DetachSources(vector<SoundEmitter*>::iterator from, vector<SoundEmitter*>::iterator to) {
-	for(vector<SoundEmitter*>::iterator i = from; i != to; ++i) {
+void SoundSystem::DetachSources(vector<SoundVoice*>::iterator from, vector<SoundVoice*>::iterator to) {
+	for(vector<SoundVoice*>::iterator i = from; i != to; ++i) {
 		(*i)->DetachSource();
 	}
 }
 
-void SoundSystem::AttachSources(vector<SoundEmitter*>::iterator from, vector<SoundEmitter*>::iterator to) {
-	for(vector<SoundEmitter*>::iterator i = from; i != to; ++i) {
+void SoundSystem::AttachSources(vector<SoundVoice*>::iterator from, vector<SoundVoice*>::iterator to) {
+	for(vector<SoundVoice*>::iterator i = from; i != to; ++i) {
 		if(!(*i)->GetSource()) {	//Don't attach a new source if we already have one!
 			(*i)->AttachSource(GetSource());
 		}
@@ -128,62 +388,132 @@ OALSource* SoundSystem::GetSource() {
 }
 
 void SoundSystem::SetMasterVolume(float value)	{
-	value = max(0.0f, value);
-	value = min(1.0f, value);
-	masterVolume = value;
-	alListenerf(AL_GAIN,masterVolume);
+	SoundCommand c;
+	c.type		= SoundCommandType::MasterVolume;
+	c.emitter	= NULL;
+	c.sound		= NULL;
+	c.volume	= value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	PushCommand(c, true);
 }
 
 void SoundSystem::UpdateListener() {
-	if(listener)	{
-		Matrix4 worldMat = listener->GetTransform().GetMatrix();
-		Vector3 worldPos = listener->GetTransform().GetPosition();
+	Vector3 dirup[2] = { listenerForward, listenerUp };
 
-		Vector3 dirup[2];
-		//forward
-		dirup[0].x = -worldMat.array[2];
-		dirup[0].y = -worldMat.array[6];
-		dirup[0].z = -worldMat.array[10];
-		//Up
-		dirup[1].x = worldMat.array[1];
-		dirup[1].y = worldMat.array[5];
-		dirup[1].z = worldMat.array[9];
-
-		alListenerfv(AL_POSITION,(float*)&worldPos);
-		alListenerfv(AL_ORIENTATION,(float*)&dirup);
-	}
+	alListenerfv(AL_POSITION,(float*)&listenerPosition);
+	alListenerfv(AL_ORIENTATION,(float*)&dirup);
 }
 
+/*
+Trigger sounds play from a fixed pool of voices, so a fight full of paint
+splats doesn't allocate one for every one of them. The same sound
+triggered more than once in a frame, in about the same place, is only
+played once, as several copies on top of each other just sound louder.
+*/
 void SoundSystem::PlayTriggerSound(Sound* s, Vector3 position, float radius, float pitch) {
-	SoundEmitter* n = new SoundEmitter();
-	n->SetLooping(false);
-	n->GetTransform().SetPosition(position);
-	n->SetSound(s);
-	n->SetPitch(pitch);
-	n->SetRadius(radius);
-	temporaryEmitters.push_back(n);
+	if(!s) {
+		return;
+	}
+	SoundCommand c;
+	c.type		= SoundCommandType::PlayTrigger;
+	c.emitter	= NULL;
+	c.sound		= s;
+	c.position	= position;
+	c.radius	= radius;
+	c.pitch		= pitch;
+	c.occlusion	= occlusion ? occlusion->GetTriggerOcclusion(position) : 0.0f;
+	c.priority	= (int)SOUNDPRIORTY_LOW;
+	c.global	= false;
+	PushCommand(c, false);
 }
 
 void SoundSystem::PlayTriggerSound(Sound* s, SoundPriority p, float pitch) {
-	SoundEmitter* n = new SoundEmitter();
-	n->SetLooping(false);
-	n->SetSound(s);
-	n->SetIsGlobal(true);
-	n->SetPitch(pitch);
-	n->SetPriority(p);
-	temporaryEmitters.push_back(n);
+	if(!s) {
+		return;
+	}
+	SoundCommand c;
+	c.type		= SoundCommandType::PlayTrigger;
+	c.emitter	= NULL;
+	c.sound		= s;
+	c.pitch		= pitch;
+	c.occlusion	= 0.0f;
+	c.priority	= (int)p;
+	c.global	= true;
+	PushCommand(c, false);
 }
 
-void SoundSystem::UpdateTemporaryEmitters(float msec) {
-	for(vector<SoundEmitter*>::iterator i = temporaryEmitters.begin(); i != temporaryEmitters.end(); ) {
+void SoundSystem::TriggerSound(const SoundCommand& c) {
+	SoundPriority p = (SoundPriority)c.priority;
+	if(SoundVoice* merged = FindMergeableTrigger(c.sound, c.position, c.global)) {
+		if(p > merged->GetPriority()) {
+			merged->SetPriority(p);
+		}
+		if(c.occlusion < merged->GetOcclusion()) {
+			merged->SetOcclusion(c.occlusion, true); //heard as the clearest of them
+		}
+		return;
+	}
+	SoundVoice* n = GetTriggerEmitter(p);
+	if(!n) {
+		return;
+	}
+	n->SetPosition(c.position);
+	n->SetIsGlobal(c.global);
+	n->SetOcclusion(c.occlusion, true);
+	if(!c.global) {
+		n->SetRadius(c.radius);
+	}
+	StartTrigger(n, c.sound, p, c.pitch);
+}
+
+void SoundSystem::StartTrigger(SoundVoice* e, Sound* s, SoundPriority p, float pitch) {
+	e->SetLooping(false);
+	e->SetSound(s);
+	e->SetPitch(pitch);
+	e->SetPriority(p);
+	e->SetVolume(1.0f);
+	triggeredThisFrame.push_back(e);
+}
+
+SoundVoice* SoundSystem::FindMergeableTrigger(Sound* s, const Vector3& position, bool global) {
+	for(SoundVoice* e : triggeredThisFrame) {
+		if(e->GetSound() != s || e->GetIsGlobal() != global) {
+			continue;
+		}
+		if(global || (e->GetPosition() - position).Length() < TriggerMergeRadius) {
+			return e;
+		}
+	}
+	return NULL;
+}
 
-		if((*i)->GetTimeLeft() < 0.0f && !(*i)->GetLooping()) {
-			delete (*i);
-			i = temporaryEmitters.erase(i);	
+SoundVoice* SoundSystem::GetTriggerEmitter(SoundPriority p) {
+	SoundVoice* steal = NULL;
+	for(SoundVoice* e : temporaryEmitters) {
+		if(!e->GetSound()) {
+			return e;
+		}
+		//Of what's as unimportant, the one closest to finishing is missed least
+		if(e->GetPriority() <= p && (!steal || e->GetPriority() < steal->GetPriority() ||
+			(e->GetPriority() == steal->GetPriority() && e->GetTimeLeft() < steal->GetTimeLeft()))) {
+			steal = e;
+		}
+	}
+	if(steal) {
+		steal->DetachSource();
+	}
+	return steal;
+}
+
+void SoundSystem::UpdateTemporaryEmitters(float msec) {
+	for(SoundVoice* e : temporaryEmitters) {
+		if(!e->GetSound()) {
+			continue;
+		}
+		if(e->GetTimeLeft() < 0.0f && !e->GetLooping()) {
+			e->SetSound(NULL);	//Back in the pool
 		}
 		else{
-			emitters.push_back(*i);
-			++i;
+			emitters.push_back(e);
 		}
 	}
 }
\ No newline at end of file
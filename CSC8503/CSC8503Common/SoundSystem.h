@@ -2,9 +2,14 @@
 
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
 
 #include "Sound.h"
+#include "SoundVoice.h"
 #include "SoundEmitter.h"
+#include "SPSCQueue.h"
 
 #include "../../Plugins/OpenAL/include/alc.h"
 
@@ -14,26 +19,76 @@ namespace NCL {
 		using std::vector;
 
 		class SoundEmitter;
+		class SoundOcclusion;
 		enum SoundPriority;
 
 		struct OALSource {
 			ALuint	source;
+			ALuint	filter;	//a low pass for occlusion, if there's EFX
 			bool	inUse;
 
 			OALSource(ALuint src) {
 				source = src;
+				filter = 0;
 				inUse = false;
 			}
 		};
 
+		enum class SoundCommandType {
+			EmitterState,
+			EmitterRemoved,
+			PlayTrigger,
+			MasterVolume,
+			Frame
+		};
+
+		//Everything the game thread tells the mixer, copied, so it never has to read game objects
+		struct SoundCommand {
+			SoundCommandType	type;
+			SoundEmitter*		emitter;	//only ever used to tell emitters apart on the mixer
+			Sound*				sound;
+			Vector3				position;
+			Vector3				forward;
+			Vector3				up;
+			float				volume;
+			float				pitch;
+			float				radius;
+			float				occlusion;
+			int					priority;
+			bool				global;
+			bool				looping;
+		};
+
+		/*
+		The game thread never calls OpenAL itself. What it asks for, and
+		where every emitter and the listener are each frame, goes to the
+		sound system as commands through a lock free queue, and it's the
+		mixer that does everything with them - on a thread of its own, at
+		its own MixRate, unless it's been told not to have one, in which
+		case it mixes at the end of each Update instead.
+
+		The mixer keeps a voice for each SoundEmitter the game has, which is
+		what actually plays, so the game's ones can be moved and deleted
+		without waiting for it.
+
+		Given a SoundOcclusion, how much of the level is in the way of each
+		sound is worked out on the game thread and sent along with it. The
+		mixer turns occluded sounds down, and muffles them if the device has
+		EFX, and they're the first to give up their source when there
+		aren't enough to go round.
+		*/
 		class SoundSystem {
 		public:
-			static void Initialise(unsigned int channels = 32) {
+			static void Initialise(unsigned int channels = 32, bool ownThread = true) {
 				instance = new SoundSystem(channels);
+				if (ownThread) {
+					instance->StartMixer();
+				}
 			}
 
 			static void Destroy() {
 				delete instance;
+				instance = NULL;
 			}
 
 			static SoundSystem* GetSoundSystem() {
@@ -43,9 +98,17 @@ namespace NCL {
 			void		SetListener(GameObject* l) { listener = l; }
 			GameObject* GetListener() { return listener; }
 
-			void		AddSoundEmitter(SoundEmitter* s) { emitters.push_back(s); }
+			void		AddSoundEmitter(SoundEmitter* s);
+			//Called as one of the game's emitters is deleted, so its voice goes too
+			void		RemoveSoundEmitter(SoundEmitter* s);
 
-			void		ClearSoundEmitters() { emitters.clear(); }
+			void		ClearSoundEmitters() { frameEmitters.clear(); }
+
+			//Game thread only, and it has to outlive the sound system, or be set back to null first
+			void		SetOcclusion(SoundOcclusion* o) { occlusion = o; }
+
+			//Where the listener was as of the last frame the mixer was sent
+			const Vector3& GetListenerPosition() const { return listenerPosition; }
 
 			void		Update(float msec);
 
@@ -54,14 +117,30 @@ namespace NCL {
 			void		PlayTriggerSound(Sound* s, Vector3 position, float radius = 250, float pitch = 1);
 			void		PlayTriggerSound(Sound* s, SoundPriority p, float pitch = 1);
 
+			//Mixer only - sets how muffled a source is, if there's EFX to do it with
+			void		SetSourceOcclusion(OALSource* s, float occlusion) const;
+
+			static const float	OcclusionVolumeLoss;	//how much quieter a fully occluded sound is
+			static const float	OcclusionHighLoss;		//and how much of its high end it loses
+			static const float	OcclusionFadeRate;		//per second, so a sound going behind a wall doesn't jump
+
 		protected:
 			SoundSystem(unsigned int channels = 128);
 			~SoundSystem(void);
 
+			void		StartMixer();
+			void		MixerThread();
+			void		Mix(float dt);
+			void		PushCommand(const SoundCommand& c, bool mustArrive);
+			void		ProcessCommands();
+			void		ApplyCommand(const SoundCommand& c);
+			void		TriggerSound(const SoundCommand& c);
+
 			void		UpdateListener();
+			void		InitFilters();
 
-			void		DetachSources(vector<SoundEmitter*>::iterator from, vector<SoundEmitter*>::iterator to);
-			void		AttachSources(vector<SoundEmitter*>::iterator from, vector<SoundEmitter*>::iterator to);
+			void		DetachSources(vector<SoundVoice*>::iterator from, vector<SoundVoice*>::iterator to);
+			void		AttachSources(vector<SoundVoice*>::iterator from, vector<SoundVoice*>::iterator to);
 
 			void		CullNodes();
 
@@ -69,18 +148,49 @@ namespace NCL {
 
 			void		UpdateTemporaryEmitters(float msec);
 
-			vector<OALSource*>	sources;
-
-			vector<SoundEmitter*>	emitters;
-			vector<SoundEmitter*>	temporaryEmitters;
-
-			GameObject* listener;
+			//A free trigger emitter, or the least important one playing if there
+			//aren't any, as long as it's no more important than what's replacing it
+			SoundVoice*	GetTriggerEmitter(SoundPriority p);
+			//Another of the same sound, started this frame close enough to be heard as one
+			SoundVoice*	FindMergeableTrigger(Sound* s, const Vector3& position, bool global);
+			void		StartTrigger(SoundVoice* e, Sound* s, SoundPriority p, float pitch);
+
+			//Game thread only
+			vector<SoundEmitter*>	frameEmitters;
+			GameObject*				listener;
+			SoundOcclusion*			occlusion;
+
+			//Mixer only, from here on
+			struct MixerEmitter {
+				SoundVoice		voice;
+				unsigned int	frame;	//the last frame the game sent it in
+			};
+			vector<OALSource*>		sources;
+			vector<SoundVoice*>		emitters;	//what's worth hearing this mix
+			std::unordered_map<SoundEmitter*, MixerEmitter> mixerEmitters; //by the game's emitter
+			vector<MixerEmitter*>	activeEmitters;		//as of the last frame
+			vector<MixerEmitter*>	nextActiveEmitters;	//for the frame that's arriving
+			unsigned int			mixerFrame;
+			vector<SoundVoice*>		temporaryEmitters;	//a fixed pool, reused by PlayTriggerSound
+			vector<SoundVoice*>		triggeredThisFrame;
+
+			Vector3		listenerPosition;
+			Vector3		listenerForward;
+			Vector3		listenerUp;
 
 			ALCcontext* context;
 			ALCdevice* device;
 
 			float				masterVolume;
 
+			SPSCQueue<SoundCommand, 4096>	commands;
+			std::thread						mixer;
+			std::atomic<bool>				mixing;
+
+			static const int	TriggerEmitterCount	= 64;
+			static const int	MixRate				= 100;	//times a second
+			static const float	TriggerMergeRadius;
+
 			static SoundSystem* instance;
 		};
 	}
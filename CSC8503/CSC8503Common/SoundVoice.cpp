@@ -0,0 +1,194 @@
+#include "SoundVoice.h"
+#include "SoundSystem.h"
+
+using namespace NCL::CSC8503;
+
+SoundVoice::SoundVoice(void)	{
+	priority		= SOUNDPRIORTY_LOW;
+	pitch			= 1.0f;
+	volume			= 1.0f;
+	radius			= 250.0f;
+	timeLeft		= 0.0f;
+	listenerDistance = 0.0f;
+	occlusion		= 0.0f;
+	heardOcclusion	= 0.0f;
+	isLooping		= true;
+	oalSource		= NULL;
+	sound			= NULL;
+	streamPos		= 0;
+	isGlobal		= false;
+	for(unsigned int i = 0; i < NUM_STREAM_BUFFERS; ++i) {
+		streamBuffers[i] = 0;
+	}
+}
+
+SoundVoice::~SoundVoice(void)	{
+	DetachSource();
+	if(streamBuffers[0]) {
+		alDeleteBuffers(NUM_STREAM_BUFFERS, streamBuffers);
+	}
+}
+
+//Nearer sounds win between ones of the same priority, and occluded ones lose to anything as near that isn't
+bool SoundVoice::CompareNodesByPriority(SoundVoice *a, SoundVoice* b) {
+	if(a->priority != b->priority) {
+		return a->priority > b->priority;
+	}
+	return a->GetAudibleDistance() < b->GetAudibleDistance();
+}
+
+void SoundVoice::SetOcclusion(float value, bool immediate) {
+	occlusion = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	if(immediate) {
+		heardOcclusion = occlusion;
+	}
+}
+
+void SoundVoice::SetSound(Sound *s) {
+	DetachSource();	//With the old sound, so a streamed one's buffers are unqueued
+	sound = s;
+	if(sound)	{
+		timeLeft = sound->GetLength() / 1000.0;
+
+		if(!sound->IsStreaming() && streamBuffers[0]) {
+			alDeleteBuffers(NUM_STREAM_BUFFERS, streamBuffers);
+			for(unsigned int i = 0; i < NUM_STREAM_BUFFERS; ++i) {
+				streamBuffers[i] = 0;
+			}
+		}
+	}
+}
+
+void SoundVoice::AttachSource(OALSource* s) {
+	oalSource = s;
+
+	if(!oalSource) {
+		return;
+	}
+
+	oalSource->inUse = true;
+
+	alSourceStop(oalSource->source);	
+	alSourcef(oalSource->source, AL_MAX_DISTANCE, radius);
+	alSourcef(oalSource->source, AL_REFERENCE_DISTANCE, radius * 0.2f);
+
+	if(timeLeft > 0) {
+		if(sound->IsStreaming()) {
+			//Only made once it's heard, so a voice that never is never has any
+			if(!streamBuffers[0]) {
+				alGenBuffers(NUM_STREAM_BUFFERS, streamBuffers);
+			}
+			streamPos = timeLeft;
+			int numBuffered = 0;
+			while(numBuffered < NUM_STREAM_BUFFERS) {
+				double streamed = sound->StreamData(streamBuffers[numBuffered],streamPos);
+
+				if(streamed) {
+					streamPos -= streamed;
+					++numBuffered;
+				}
+				else{
+					break;
+				}
+			}
+			alSourceQueueBuffers(oalSource->source, numBuffered, &streamBuffers[0]);
+		}
+		else{
+			alSourcei(oalSource->source,AL_BUFFER,sound->GetBuffer());
+			alSourcef(oalSource->source,AL_SEC_OFFSET,(sound->GetLength()/ 1000.0) - (timeLeft / 1000.0));
+
+			alSourcePlay(oalSource->source);
+		}
+		alSourcePlay(oalSource->source);
+	}
+}
+
+void SoundVoice::DetachSource() {
+	if(!oalSource) {
+		return;
+	}
+
+	oalSource->inUse = false;
+
+	alSourcef(oalSource->source,AL_GAIN,0.0f);
+	alSourceStop(oalSource->source);
+	alSourcei(oalSource->source,AL_BUFFER,0);
+		
+	if(sound && sound->IsStreaming()) {
+		int numProcessed = 0;
+		ALuint tempBuffer;
+		alGetSourcei( oalSource->source, AL_BUFFERS_PROCESSED, &numProcessed );
+		while( numProcessed-- ) {
+			alSourceUnqueueBuffers( oalSource->source, 1, &tempBuffer );
+		} 
+	}
+
+	oalSource = NULL;
+}
+
+void SoundVoice::UpdateSoundState(float msec) {
+	if(sound) {
+		timeLeft -= (msec * pitch);
+
+		float fade = SoundSystem::OcclusionFadeRate * msec;
+		heardOcclusion = occlusion > heardOcclusion ?
+			(heardOcclusion + fade < occlusion ? heardOcclusion + fade : occlusion) :
+			(heardOcclusion - fade > occlusion ? heardOcclusion - fade : occlusion);
+		
+		if(isLooping && sound->GetLength() > 0) {
+			while(timeLeft < 0) {
+				timeLeft += sound->GetLength() / 1000.0;
+			}
+		}
+		if(oalSource) {
+			alSourcef(oalSource->source	,AL_GAIN	,volume * (1.0f - heardOcclusion * SoundSystem::OcclusionVolumeLoss));
+			SoundSystem::GetSoundSystem()->SetSourceOcclusion(oalSource, heardOcclusion);
+			alSourcef(oalSource->source	,AL_PITCH	,pitch);
+			alSourcef(oalSource->source, AL_MAX_DISTANCE, radius);
+			alSourcef(oalSource->source, AL_REFERENCE_DISTANCE, radius * 0.2f);
+			
+			Vector3 heardAt = isGlobal ? SoundSystem::GetSoundSystem()->GetListenerPosition() : position;
+
+			alSourcefv(oalSource->source,AL_POSITION,(float*)&heardAt);
+
+			if(sound->IsStreaming()) {
+				int numProcessed;
+				alGetSourcei(oalSource->source, AL_BUFFERS_PROCESSED, &numProcessed);
+				alSourcei(oalSource->source	,AL_LOOPING	,0);
+
+				while(numProcessed > 0) {
+					if(streamPos <= 0 && isLooping) {
+						streamPos += sound->GetLength() / 1000.0;	//Back to the start
+					}
+					if(streamPos <= 0) {
+						break;	//Leaves the last buffers to finish playing, rather than clipping them
+					}
+					ALuint freeBuffer;
+					alSourceUnqueueBuffers(oalSource->source, 1, &freeBuffer);
+
+					double streamed = sound->StreamData(freeBuffer,streamPos);
+					if(streamed <= 0 && isLooping) {
+						streamPos	= sound->GetLength() / 1000.0;
+						streamed	= sound->StreamData(freeBuffer,streamPos);
+					}
+					if(streamed <= 0) {
+						streamPos = 0;
+						break;	//Nothing left to put in it, so it stays out of the queue
+					}
+					streamPos -= streamed;
+					alSourceQueueBuffers(oalSource->source, 1, &freeBuffer);
+					--numProcessed;
+				}
+				//If the queue ran dry before it was topped up, the source will have stopped
+				int state;
+				alGetSourcei(oalSource->source, AL_SOURCE_STATE, &state);
+				if(state != AL_PLAYING && streamPos > 0) {
+					alSourcePlay(oalSource->source);
+				}
+			}
+			else{
+				alSourcei(oalSource->source	,AL_LOOPING	,isLooping ? 1 : 0);
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Sound.h"
+#include "../../Common/Vector3.h"
+
+#define NUM_STREAM_BUFFERS 3
+
+namespace NCL {
+	namespace CSC8503 {
+		using Maths::Vector3;
+
+		enum SoundPriority {
+			SOUNDPRIORTY_LOW,
+			SOUNDPRIORITY_MEDIUM,
+			SOUNDPRIORITY_HIGH,
+			SOUNDPRIORITY_ALWAYS
+		};
+
+		struct OALSource;
+
+		/*
+		Something the mixer's playing, or could be - a sound, how far through
+		it is, where it is and how it's set, and the source it's got, if any.
+		It's plain state, rather than a GameObject, so none of the mixer's
+		voices take a slot from the world's pools, and the mixer can make and
+		delete them without the game ever having to know.
+		*/
+		class SoundVoice {
+		public:
+			SoundVoice(void);
+			~SoundVoice(void);
+
+			SoundVoice(const SoundVoice&) = delete;
+			SoundVoice& operator=(const SoundVoice&) = delete;
+
+			void			SetSound(Sound* s);
+			Sound*			GetSound() { return sound; }
+
+			void			SetPriority(SoundPriority p) { priority = p; }
+			SoundPriority	GetPriority() { return priority; }
+
+			void			SetVolume(float value) { volume = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value); }
+			float			GetVolume() { return volume; }
+
+			void			SetLooping(bool state) { isLooping = state; }
+			bool			GetLooping() { return isLooping; }
+
+			void			SetRadius(float value) { radius = value < 0.0f ? 0.0f : value; }
+			float			GetRadius() { return radius; }
+
+			float			GetPitch() { return pitch; }
+			void			SetPitch(float value) { pitch = value; }
+
+			bool			GetIsGlobal() { return isGlobal; }
+			void			SetIsGlobal(bool value) { isGlobal = value; }
+
+			const Vector3&	GetPosition() const { return position; }
+			void			SetPosition(const Vector3& value) { position = value; }
+
+			double			GetTimeLeft() { return timeLeft; }
+
+			//How far from the listener it was when the SoundSystem last culled it
+			float			GetListenerDistance() { return listenerDistance; }
+			void			SetListenerDistance(float value) { listenerDistance = value; }
+
+			//How much of the level's between it and the listener, which it fades towards unless told otherwise
+			void			SetOcclusion(float value, bool immediate = false);
+			float			GetOcclusion() { return heardOcclusion; }
+			//What it's sorted by within its priority - occluded sounds count as up to a radius further away
+			float			GetAudibleDistance() { return listenerDistance + heardOcclusion * radius; }
+
+			OALSource*		GetSource() { return oalSource; }
+
+			void			UpdateSoundState(float msec);
+
+			static bool		CompareNodesByPriority(SoundVoice* a, SoundVoice* b);
+
+			void			AttachSource(OALSource* s);
+			void			DetachSource();
+
+		protected:
+			Sound*			sound;
+			OALSource*		oalSource;
+			SoundPriority	priority;
+			float			volume;
+			float			radius;
+			float			pitch;
+			bool			isLooping;
+			bool			isGlobal;
+			Vector3			position;
+			double			timeLeft;
+			float			listenerDistance;
+			float			occlusion;
+			float			heardOcclusion;
+
+			double			streamPos;
+			ALuint			streamBuffers[NUM_STREAM_BUFFERS];
+		};
+	}
+}
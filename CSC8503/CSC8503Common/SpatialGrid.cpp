@@ -0,0 +1,196 @@
+#include "SpatialGrid.h"
+#include "GameObject.h"
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float SpatialGrid::DefaultCellSize = 20.0f;
+
+SpatialGrid::SpatialGrid(float cellSize) {
+	this->cellSize = cellSize;
+	Clear();
+}
+
+void SpatialGrid::TrackType(int typeID, const std::vector<GameObject*>& existing) {
+	trackedTypes.insert(typeID);
+	for (GameObject* o : existing) {
+		if (o->GetTypeID() == typeID) {
+			Add(o);
+		}
+	}
+}
+
+void SpatialGrid::Add(GameObject* o) {
+	if (!IsTracked(o->GetTypeID()) || entries.count(o)) {
+		return;
+	}
+	const Vector3& pos = o->GetTransform().GetPosition();
+	Insert(o, CellCoord(pos.x), CellCoord(pos.z));
+}
+
+void SpatialGrid::Remove(GameObject* o) {
+	auto i = entries.find(o);
+	if (i == entries.end()) {
+		return;
+	}
+	Erase(o, i->second);
+	entries.erase(i);
+}
+
+void SpatialGrid::Clear() {
+	cells.clear();
+	entries.clear();
+	minX = minZ = INT_MAX;
+	maxX = maxZ = INT_MIN;
+}
+
+void SpatialGrid::Update() {
+	for (auto& e : entries) {
+		GameObject* o = e.first;
+		const Vector3& pos = o->GetTransform().GetPosition();
+		int x = CellCoord(pos.x);
+		int z = CellCoord(pos.z);
+		if (Key(x, z) == e.second.cell) {
+			continue;
+		}
+		Erase(o, e.second);
+		Insert(o, x, z);
+	}
+}
+
+int SpatialGrid::CellCoord(float f) const {
+	return (int)floor(f / cellSize);
+}
+
+//Entries can be overwritten, but not added, while the map's being walked by Update
+void SpatialGrid::Insert(GameObject* o, int x, int z) {
+	CellKey key = Key(x, z);
+	std::vector<GameObject*>& cell = cells[key];
+	entries[o] = Entry{ key, (int)cell.size() };
+	cell.emplace_back(o);
+
+	minX = x < minX ? x : minX;
+	maxX = x > maxX ? x : maxX;
+	minZ = z < minZ ? z : minZ;
+	maxZ = z > maxZ ? z : maxZ;
+}
+
+//Takes the place of the last object in the cell, so the rest don't have to move
+void SpatialGrid::Erase(GameObject* o, const Entry& e) {
+	std::vector<GameObject*>& cell = cells[e.cell];
+	GameObject* last = cell.back();
+	cell[e.index] = last;
+	entries[last].index = e.index;
+	cell.pop_back();
+	if (cell.empty()) {
+		cells.erase(e.cell);
+	}
+}
+
+bool SpatialGrid::Passes(GameObject* o, const SpatialFilter& filter) const {
+	if (filter.typeID >= 0 && o->GetTypeID() != filter.typeID) {
+		return false;
+	}
+	if (!(filter.layerMask & LayerBit(o->GetLayer()))) {
+		return false;
+	}
+	return !filter.accept || filter.accept(o);
+}
+
+void SpatialGrid::FindInRadius(const Vector3& position, float radius, std::vector<GameObject*>& out, const SpatialFilter& filter) const {
+	if (entries.empty()) {
+		return;
+	}
+	int x0 = CellCoord(position.x - radius);
+	int x1 = CellCoord(position.x + radius);
+	int z0 = CellCoord(position.z - radius);
+	int z1 = CellCoord(position.z + radius);
+	x0 = x0 < minX ? minX : x0;
+	x1 = x1 > maxX ? maxX : x1;
+	z0 = z0 < minZ ? minZ : z0;
+	z1 = z1 > maxZ ? maxZ : z1;
+
+	float radiusSq = radius * radius;
+	for (int z = z0; z <= z1; ++z) {
+		for (int x = x0; x <= x1; ++x) {
+			auto cell = cells.find(Key(x, z));
+			if (cell == cells.end()) {
+				continue;
+			}
+			for (GameObject* o : cell->second) {
+				if ((o->GetTransform().GetPosition() - position).LengthSquared() <= radiusSq && Passes(o, filter)) {
+					out.emplace_back(o);
+				}
+			}
+		}
+	}
+}
+
+/*
+Everything in ring r is at least (r - 1) cells away from the position, so
+once k objects have been found no further than that, the search is over.
+*/
+void SpatialGrid::FindNearest(const Vector3& position, int k, std::vector<GameObject*>& out, const SpatialFilter& filter, float maxDistance) const {
+	if (entries.empty() || k <= 0) {
+		return;
+	}
+	int cx = CellCoord(position.x);
+	int cz = CellCoord(position.z);
+
+	//No further than the furthest cell anything's been in
+	int maxRing = 0;
+	maxRing = abs(cx - minX) > maxRing ? abs(cx - minX) : maxRing;
+	maxRing = abs(cx - maxX) > maxRing ? abs(cx - maxX) : maxRing;
+	maxRing = abs(cz - minZ) > maxRing ? abs(cz - minZ) : maxRing;
+	maxRing = abs(cz - maxZ) > maxRing ? abs(cz - maxZ) : maxRing;
+
+	float maxDistanceSq = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	std::vector<std::pair<float, GameObject*>> found;
+
+	auto searchCell = [&](int x, int z) {
+		auto cell = cells.find(Key(x, z));
+		if (cell == cells.end()) {
+			return;
+		}
+		for (GameObject* o : cell->second) {
+			float distSq = (o->GetTransform().GetPosition() - position).LengthSquared();
+			if (distSq <= maxDistanceSq && Passes(o, filter)) {
+				found.emplace_back(distSq, o);
+			}
+		}
+	};
+
+	for (int ring = 0; ring <= maxRing; ++ring) {
+		float ringDistance = (ring - 1) * cellSize;
+		if (ring > 0 && ringDistance > maxDistance) {
+			break;
+		}
+		if ((int)found.size() >= k && ring > 0) {
+			std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+			if (found[k - 1].first <= ringDistance * ringDistance) {
+				break;
+			}
+		}
+		for (int z = cz - ring; z <= cz + ring; ++z) {
+			bool edgeRow = (z == cz - ring || z == cz + ring);
+			for (int x = cx - ring; x <= cx + ring; x += (edgeRow || ring == 0) ? 1 : ring * 2) {
+				searchCell(x, z);
+			}
+		}
+	}
+
+	int count = (int)found.size() < k ? (int)found.size() : k;
+	std::partial_sort(found.begin(), found.begin() + count, found.end());
+	for (int i = 0; i < count; ++i) {
+		out.emplace_back(found[i].second);
+	}
+}
+
+GameObject* SpatialGrid::FindNearest(const Vector3& position, const SpatialFilter& filter, float maxDistance) const {
+	std::vector<GameObject*> nearest;
+	FindNearest(position, 1, nearest, filter, maxDistance);
+	return nearest.empty() ? nullptr : nearest[0];
+}
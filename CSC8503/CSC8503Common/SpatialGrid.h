@@ -0,0 +1,88 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "CollisionLayer.h"
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <cfloat>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameObject;
+
+		//What an object has to be for a SpatialGrid query to return it
+		struct SpatialFilter {
+			int			typeID		= -1;	//any type, if it's negative
+			uint32_t	layerMask	= ~0u;	//a LayerBit for each layer that's wanted
+			std::function<bool(GameObject*)> accept; //anything else it has to pass, if set
+		};
+
+		/*
+		Finds the objects near a point, for gameplay code that would otherwise
+		loop over every object of a kind to find the closest. Only objects of
+		the types it's been told to track are kept, bucketed into square cells
+		across x and z, as the levels are flat. The world adds and removes
+		them as they come and go, and Update moves those that have crossed
+		into another cell since the last frame, so nothing is rebuilt.
+
+		FindNearest searches outwards a ring of cells at a time, stopping once
+		nothing further out could be closer than what it's already found.
+		*/
+		class SpatialGrid {
+		public:
+			SpatialGrid(float cellSize = DefaultCellSize);
+
+			//Objects of this type are tracked from now on, including any added already
+			void TrackType(int typeID, const std::vector<GameObject*>& existing = {});
+			bool IsTracked(int typeID) const {
+				return trackedTypes.count(typeID) > 0;
+			}
+
+			//Does nothing for objects of types that aren't tracked
+			void Add(GameObject* o);
+			void Remove(GameObject* o);
+			//Forgets the objects, but not which types to track
+			void Clear();
+
+			void Update();
+
+			void FindInRadius(const Vector3& position, float radius, std::vector<GameObject*>& out, const SpatialFilter& filter = SpatialFilter()) const;
+
+			//Up to k objects, closest first, no further away than maxDistance
+			void FindNearest(const Vector3& position, int k, std::vector<GameObject*>& out, const SpatialFilter& filter = SpatialFilter(), float maxDistance = FLT_MAX) const;
+			GameObject* FindNearest(const Vector3& position, const SpatialFilter& filter = SpatialFilter(), float maxDistance = FLT_MAX) const;
+
+			int GetObjectCount() const {
+				return (int)entries.size();
+			}
+
+			static const float DefaultCellSize;
+
+		protected:
+			typedef long long CellKey;
+
+			struct Entry {
+				CellKey	cell;
+				int		index; //where it is in its cell's list
+			};
+
+			int CellCoord(float f) const;
+			CellKey Key(int x, int z) const {
+				return (CellKey)(((unsigned long long)(unsigned int)x << 32) | (unsigned int)z);
+			}
+			void Insert(GameObject* o, int x, int z);
+			void Erase(GameObject* o, const Entry& e);
+			bool Passes(GameObject* o, const SpatialFilter& filter) const;
+
+			float	cellSize;
+			//The cells anything has ever been in, since the last Clear, so searches know where to stop
+			int		minX, maxX, minZ, maxZ;
+
+			std::set<int>									trackedTypes;
+			std::unordered_map<CellKey, std::vector<GameObject*>>	cells;
+			std::unordered_map<GameObject*, Entry>			entries;
+		};
+	}
+}
@@ -8,6 +8,7 @@ using namespace NCL::CSC8503;
 StateMachine::StateMachine()
 {
 	activeState = nullptr;
+	previousState = nullptr;
 }
 
 StateMachine::~StateMachine()
@@ -17,7 +18,9 @@ StateMachine::~StateMachine()
 	}
 
 	for (auto& i : allTransitions) {
-		delete i.second;
+		for (StateTransition* t : i.second) {
+			delete t;
+		}
 	}
 }
 
@@ -29,21 +32,22 @@ void StateMachine::AddState(State* s) {
 }
 
 void StateMachine::AddTransition(StateTransition* t) {
-	allTransitions.insert(std::make_pair(t->GetSourceState(), t));
+	allTransitions[t->GetSourceState()].emplace_back(t);
 }
 
 void StateMachine::Update(float dt) {
 	if (activeState) {
 		activeState->Update(dt);
 	
-		//Get the transition set starting from this state node;
-		std::pair<TransitionIterator, TransitionIterator> range = allTransitions.equal_range(activeState);
-
-		for (auto& i = range.first; i != range.second; ++i) {
-			if (i->second->CanTransition()) {
-				State* newState = i->second->GetDestinationState();
+		auto transitions = allTransitions.find(activeState);
+		if (transitions == allTransitions.end()) {
+			return;
+		}
+		for (StateTransition* t : transitions->second) {
+			if (t->CanTransition()) {
 				previousState = activeState;
-				activeState = newState;
+				activeState = t->GetDestinationState();
+				break;
 			}
 		}
 	}
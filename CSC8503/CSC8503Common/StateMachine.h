@@ -1,6 +1,6 @@
 #pragma once
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 namespace NCL {
 	namespace CSC8503 {
@@ -8,8 +8,8 @@ namespace NCL {
 		class State;
 		class StateTransition;
 
-		typedef std::multimap<State*, StateTransition*> TransitionContainer;
-		typedef TransitionContainer::iterator TransitionIterator;
+		//Every state's transitions side by side, in the order they were added
+		typedef std::unordered_map<State*, std::vector<StateTransition*>> TransitionContainer;
 
 		class StateMachine	{
 		public:
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		//All that each thing running a StateMachineDefinition needs of its own
+		struct StateMachineState {
+			short	activeState		= 0;
+			short	previousState	= 0;
+			float	sinceChecked	= 0.0f;
+		};
+
+		/*
+		The states and transitions of a state machine, made once and shared by
+		everything of type T that runs it, each with only a StateMachineState
+		of its own, rather than every one of them building its own machine of
+		lambdas. States and transitions are member functions of T, and every
+		state's transitions are kept next to each other, in the order they
+		were added, so checking them is a walk along part of one array.
+
+		Transitions are only checked every checkInterval seconds, rather than
+		every frame, and the first to pass is taken. The first state added is
+		the one everything starts in.
+		*/
+		template<class T>
+		class StateMachineDefinition {
+		public:
+			typedef void (T::*StateFunction)(float dt);
+			typedef bool (T::*TransitionFunction)();
+
+			StateMachineDefinition(float checkInterval = 0.0f) {
+				this->checkInterval = checkInterval;
+			}
+
+			int AddState(const std::string& name, StateFunction func) {
+				StateData s;
+				s.name				= name;
+				s.func				= func;
+				s.firstTransition	= (int)transitions.size();
+				s.transitionCount	= 0;
+				states.emplace_back(s);
+				return (int)states.size() - 1;
+			}
+
+			//Every state's transitions stay together, in the order of the states
+			void AddTransition(int from, int to, TransitionFunction func) {
+				int index = states[from].firstTransition + states[from].transitionCount;
+				transitions.insert(transitions.begin() + index, Transition{ to, func });
+				states[from].transitionCount++;
+				for (size_t i = from + 1; i < states.size(); ++i) {
+					states[i].firstTransition++;
+				}
+			}
+
+			//Returns whether the transitions were checked this time
+			bool Update(T& owner, StateMachineState& s, float dt) const {
+				const StateData& state = states[s.activeState];
+				if (state.func) {
+					(owner.*state.func)(dt);
+				}
+				s.sinceChecked += dt;
+				if (s.sinceChecked < checkInterval) {
+					return false;
+				}
+				s.sinceChecked = 0.0f;
+				for (int i = state.firstTransition; i < state.firstTransition + state.transitionCount; ++i) {
+					if ((owner.*transitions[i].func)()) {
+						s.previousState	= s.activeState;
+						s.activeState	= (short)transitions[i].to;
+						break;
+					}
+				}
+				return true;
+			}
+
+			const std::string& GetStateName(int state) const {
+				return states[state].name;
+			}
+
+			float GetCheckInterval() const {
+				return checkInterval;
+			}
+
+		protected:
+			struct StateData {
+				std::string		name;
+				StateFunction	func;
+				int				firstTransition;
+				int				transitionCount;
+			};
+
+			struct Transition {
+				int					to;
+				TransitionFunction	func;
+			};
+
+			std::vector<StateData>	states;
+			std::vector<Transition>	transitions;
+			float					checkInterval;
+		};
+	}
+}
@@ -0,0 +1,115 @@
+#include "StreamedSound.h"
+#include "JobSystem.h"
+#include "../../Common/Assets.h"
+#include <thread>
+#include <cstring>
+
+using namespace NCL::CSC8503;
+
+StreamedSound::StreamedSound() {
+	streaming		= true;
+	samples			= nullptr;
+	bytesPerSecond	= 0;
+	blockAlign		= 1;
+	size			= 0;
+	channels		= 0;
+	prefetching		= 0;
+}
+
+StreamedSound::~StreamedSound() {
+	//A prefetch reading the file as it's unmapped would fault
+	while (prefetching > 0) {
+		std::this_thread::yield();
+	}
+}
+
+/*
+Only the chunk headers are looked at here, the same way LoadFromWAV walks
+them, so finding out how long a piece of music is doesn't page any of it in.
+*/
+bool StreamedSound::Open(const string& filename) {
+	if (!file.Open(Assets::SOUNDSDIR + filename)) {
+		return false;
+	}
+	const char* data	= file.GetData();
+	size_t fileSize		= file.GetSize();
+	size_t offset		= 12; //"RIFF", its size, then "WAVE"
+	bool foundFormat	= false;
+
+	while (offset + 8 <= fileSize) {
+		string		 chunkName(data + offset, 4);
+		unsigned int chunkSize;
+		memcpy(&chunkSize, data + offset + 4, 4);
+		offset += 8;
+
+		if (chunkName == "fmt " && offset + sizeof(FMTCHUNK) <= fileSize) {
+			FMTCHUNK fmt;
+			memcpy(&fmt, data + offset, sizeof(FMTCHUNK));
+
+			bitRate		= fmt.samp;
+			freqRate	= (float)fmt.srate;
+			channels	= fmt.channels;
+			foundFormat	= true;
+		}
+		else if (chunkName == "data") {
+			samples	= data + offset;
+			size	= (unsigned int)(chunkSize < fileSize - offset ? chunkSize : fileSize - offset);
+			break;
+		}
+		offset += chunkSize + (chunkSize & 1); //chunks are padded to an even size
+	}
+	if (!foundFormat || !samples || channels == 0 || bitRate == 0) {
+		file.Close();
+		samples = nullptr;
+		return false;
+	}
+	blockAlign		= channels * (bitRate / 8);
+	bytesPerSecond	= (unsigned int)freqRate * blockAlign;
+	length			= (float)size / (channels * freqRate * (bitRate / 8.0f)) * 1000.0f;
+	return true;
+}
+
+/*
+timeLeft is how many seconds of the sound an emitter still has to queue up,
+so the chunk to send starts that far back from the end. What comes back is
+how many seconds of it were sent, or 0 once there's nothing left.
+*/
+double StreamedSound::StreamData(ALuint buffer, double timeLeft) {
+	if (!samples || bytesPerSecond == 0) {
+		return 0.0;
+	}
+	double played = GetLength() / 1000.0 - timeLeft;
+	if (played < 0.0) {
+		played = 0.0;
+	}
+	unsigned int offset = (unsigned int)(played * bytesPerSecond);
+	offset -= offset % blockAlign;
+	if (offset >= size) {
+		return 0.0;
+	}
+	unsigned int chunk = size - offset;
+	if (chunk > StreamChunkBytes) {
+		chunk = StreamChunkBytes - StreamChunkBytes % blockAlign;
+	}
+	alBufferData(buffer, GetOALFormat(), samples + offset, chunk, (ALsizei)freqRate);
+
+	Prefetch(offset + chunk);
+	return (double)chunk / bytesPerSecond;
+}
+
+void StreamedSound::Prefetch(unsigned int offset) {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (!jobs || offset >= size) {
+		return;
+	}
+	unsigned int end = offset + StreamChunkBytes < size ? offset + StreamChunkBytes : size;
+	prefetching++;
+	jobs->Submit([this, offset, end]() {
+		//One read per page is all it takes for the OS to bring it in
+		volatile char touch = 0;
+		for (unsigned int i = offset; i < end; i += 4096) {
+			touch += samples[i];
+		}
+		prefetching--;
+	});
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Sound.h"
+#include "../../Common/AssetFile.h"
+#include <atomic>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A WAV that's too long to be worth keeping in memory, such as music.
+		The file's mapped rather than read, and StreamData hands OpenAL just
+		the next StreamChunkBytes of it at a time, for an emitter to queue
+		up on its source. As nothing about where an emitter's got to is kept
+		here, any number of them can play the same one at once.
+
+		Once a chunk's been given to OpenAL, the one after it is read on the
+		job system, so the main thread isn't the one waiting for the disk
+		when it's next needed.
+		*/
+		class StreamedSound : public Sound {
+			friend class Sound;
+		public:
+			double	StreamData(ALuint buffer, double timeLeft) override;
+
+			//Anything with more sample data than this is streamed when it's loaded
+			static const unsigned int StreamThreshold	= 1024 * 1024;
+			static const unsigned int StreamChunkBytes	= 64 * 1024;
+
+		protected:
+			StreamedSound();
+			~StreamedSound();
+
+			bool	Open(const string& filename);
+			void	Prefetch(unsigned int offset);
+
+			AssetFile			file;
+			const char*			samples;
+			unsigned int		bytesPerSecond;
+			unsigned int		blockAlign;
+			std::atomic<int>	prefetching;
+		};
+	}
+}
@@ -0,0 +1,91 @@
+#include "TaskGraph.h"
+#include "JobSystem.h"
+#include "FrameProfiler.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+int TaskGraph::AddTask(const char* name, const TaskFunc& func, Affinity affinity) {
+	Task t;
+	t.name		= name;
+	t.func		= func;
+	t.affinity	= affinity;
+	tasks.emplace_back(t);
+	return (int)tasks.size() - 1;
+}
+
+void TaskGraph::AddDependency(int task, int dependsOn) {
+	if (task <= dependsOn || task >= (int)tasks.size() || dependsOn < 0) {
+		return;
+	}
+	tasks[dependsOn].dependents.emplace_back(task);
+	tasks[task].dependencyCount++;
+}
+
+/*
+The calling thread runs the main thread tasks as they come up, and sleeps
+in between. Without a job system everything's run by the caller, which
+still gets it all done, in an order that respects the dependencies.
+*/
+void TaskGraph::Run() {
+	{
+		std::unique_lock<std::mutex> lock(graphMutex);
+		unfinished = (int)tasks.size();
+		mainReady.clear();
+		for (Task& t : tasks) {
+			t.waitingOn = t.dependencyCount;
+		}
+	}
+	for (int i = 0; i < (int)tasks.size(); ++i) {
+		if (tasks[i].dependencyCount == 0) {
+			Launch(i);
+		}
+	}
+	std::unique_lock<std::mutex> lock(graphMutex);
+	while (unfinished > 0) {
+		if (mainReady.empty()) {
+			graphChanged.wait(lock, [&] { return unfinished == 0 || !mainReady.empty(); });
+			continue;
+		}
+		int task = mainReady.front();
+		mainReady.pop_front();
+		lock.unlock();
+		Execute(task);
+		lock.lock();
+	}
+}
+
+void TaskGraph::Launch(int task) {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	if (jobs && tasks[task].affinity == Affinity::AnyThread) {
+		jobs->Submit([this, task]() { Execute(task); });
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> lock(graphMutex);
+		mainReady.emplace_back(task);
+	}
+	graphChanged.notify_all();
+}
+
+//Whatever this one was holding up is launched once the lock's let go
+void TaskGraph::Execute(int task) {
+	{
+		ProfileScope scope(tasks[task].name);
+		tasks[task].func();
+	}
+	std::vector<int> ready;
+	{
+		std::unique_lock<std::mutex> lock(graphMutex);
+		for (int d : tasks[task].dependents) {
+			if (--tasks[d].waitingOn == 0) {
+				ready.emplace_back(d);
+			}
+		}
+		unfinished--;
+	}
+	for (int r : ready) {
+		Launch(r);
+	}
+	graphChanged.notify_all();
+}
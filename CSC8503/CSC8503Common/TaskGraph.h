@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A set of tasks, and which of them have to finish before each other one
+		can start, run on the JobSystem. Anything that doesn't depend on
+		something else that's still going runs alongside it, so the order only
+		has to be spelled out where it actually matters.
+
+		Tasks that have to be on the main thread (anything using GL, or the
+		window) are run by whichever thread calls Run, as they become ready,
+		and the rest go to the workers. Run only returns once every task has
+		finished - it waits on its own tasks rather than on the whole job
+		system, so path queries and the like carry on across frames as they
+		always have.
+
+		The graph's meant to be built once and run every frame, so the tasks
+		should read whatever changes from frame to frame (like dt) from
+		somewhere they can see, rather than having it captured. Each task is
+		recorded in the FrameProfiler under its name, which should be a string
+		literal.
+		*/
+		class TaskGraph {
+		public:
+			typedef std::function<void()> TaskFunc;
+
+			enum class Affinity {
+				AnyThread,
+				MainThread
+			};
+
+			int AddTask(const char* name, const TaskFunc& func, Affinity affinity = Affinity::AnyThread);
+			//The dependency has to have been added first, so there can't be any loops
+			void AddDependency(int task, int dependsOn);
+
+			void Run();
+
+			int GetTaskCount() const {
+				return (int)tasks.size();
+			}
+
+		protected:
+			struct Task {
+				const char*		name;
+				TaskFunc		func;
+				Affinity		affinity;
+				std::vector<int> dependents;
+				int				dependencyCount = 0;
+				int				waitingOn		= 0; //during a run
+			};
+
+			void Launch(int task);
+			void Execute(int task);
+
+			std::vector<Task>		tasks;
+			std::deque<int>			mainReady;
+			int						unfinished = 0;
+
+			std::mutex				graphMutex;
+			std::condition_variable	graphChanged;
+		};
+	}
+}
@@ -0,0 +1,142 @@
+#include "TelemetryServer.h"
+#include <iostream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float TelemetryServer::Timeout			= 2.0f;
+const char* TelemetryServer::DefaultAddress	= "127.0.0.1";
+
+TelemetryServer::TelemetryServer(int port, const std::string& bindAddress) {
+	this->port	= port;
+	listener	= enet_socket_create(ENET_SOCKET_TYPE_STREAM);
+	if (listener == ENET_SOCKET_NULL) {
+		std::cout << __FUNCTION__ << " couldn't create a socket" << std::endl;
+		return;
+	}
+	ENetAddress address;
+	address.port = (enet_uint16)port;
+	if (enet_address_set_host_ip(&address, bindAddress.c_str()) < 0) {
+		std::cout << __FUNCTION__ << " couldn't understand the address " << bindAddress << std::endl;
+		enet_socket_destroy(listener);
+		listener = ENET_SOCKET_NULL;
+		return;
+	}
+	enet_socket_set_option(listener, ENET_SOCKOPT_REUSEADDR, 1);
+	if (enet_socket_bind(listener, &address) < 0 || enet_socket_listen(listener, MaxConnections) < 0 ||
+		enet_socket_set_option(listener, ENET_SOCKOPT_NONBLOCK, 1) < 0) {
+		std::cout << __FUNCTION__ << " couldn't listen on " << bindAddress << ":" << port << std::endl;
+		enet_socket_destroy(listener);
+		listener = ENET_SOCKET_NULL;
+	}
+}
+
+TelemetryServer::~TelemetryServer() {
+	for (Connection& c : connections) {
+		enet_socket_destroy(c.socket);
+	}
+	if (listener != ENET_SOCKET_NULL) {
+		enet_socket_destroy(listener);
+	}
+}
+
+void TelemetryServer::Update(float dt, const PageWriter& writePage) {
+	if (!IsListening()) {
+		return;
+	}
+	Accept();
+	for (size_t i = 0; i < connections.size(); ) {
+		Connection& c = connections[i];
+		c.age += dt;
+		if (Service(c, writePage) || c.age > Timeout) {
+			enet_socket_destroy(c.socket);
+			connections[i] = std::move(connections.back());
+			connections.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+//Anyone past MaxConnections is hung up on straight away, rather than left queued
+void TelemetryServer::Accept() {
+	ENetSocket s;
+	while ((s = enet_socket_accept(listener, nullptr)) != ENET_SOCKET_NULL) {
+		if ((int)connections.size() >= MaxConnections) {
+			enet_socket_destroy(s);
+			continue;
+		}
+		enet_socket_set_option(s, ENET_SOCKOPT_NONBLOCK, 1);
+		Connection c;
+		c.socket = s;
+		connections.emplace_back(std::move(c));
+	}
+}
+
+/*
+Reads until the end of the request's headers - there's never a body to
+anything that's answered - then sends as much of the answer as the socket
+will take, picking up where it left off the next time round.
+*/
+bool TelemetryServer::Service(Connection& c, const PageWriter& writePage) {
+	if (c.response.empty()) {
+		char buffer[1024];
+		ENetBuffer b;
+		b.data			= buffer;
+		b.dataLength	= sizeof(buffer);
+		int received;
+		while ((received = enet_socket_receive(c.socket, nullptr, &b, 1)) > 0) {
+			c.request.append(buffer, received);
+			if (c.request.size() > MaxRequestSize) {
+				return true;
+			}
+		}
+		if (received < 0) {
+			return true;
+		}
+		if (c.request.find("\r\n\r\n") == std::string::npos) {
+			return false;
+		}
+		Respond(c, writePage);
+	}
+	while (c.sent < c.response.size()) {
+		ENetBuffer b;
+		b.data			= (void*)(c.response.data() + c.sent);
+		b.dataLength	= c.response.size() - c.sent;
+		int sent = enet_socket_send(c.socket, nullptr, &b, 1);
+		if (sent < 0) {
+			return true;
+		}
+		if (sent == 0) {
+			return false; //the socket's full, so it'll have to wait
+		}
+		c.sent += sent;
+	}
+	return true;
+}
+
+void TelemetryServer::Respond(Connection& c, const PageWriter& writePage) {
+	size_t lineEnd	= c.request.find("\r\n");
+	std::string line = c.request.substr(0, lineEnd);
+	bool isGet		= line.compare(0, 4, "GET ") == 0;
+	size_t pathEnd	= line.find(' ', 4);
+	std::string path = isGet ? line.substr(4, pathEnd == std::string::npos ? std::string::npos : pathEnd - 4) : "";
+
+	const char* status = "200 OK";
+	page.clear();
+	if (!isGet) {
+		status = "405 Method Not Allowed";
+	}
+	else if (path == "/metrics" || path == "/") {
+		writePage(page);
+	}
+	else {
+		status = "404 Not Found";
+	}
+	c.response = std::string("HTTP/1.0 ") + status + "\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: " + std::to_string(page.size()) + "\r\n"
+		"Connection: close\r\n\r\n" + page;
+	c.sent = 0;
+}
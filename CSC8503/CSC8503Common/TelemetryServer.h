@@ -0,0 +1,67 @@
+#pragma once
+#include <enet/enet.h>
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Just enough of an HTTP server for monitoring to scrape a server's
+		metrics from, at /metrics, as the plain text Prometheus reads. It's
+		on ENet's sockets, so there's nothing else to link, and they're all
+		non-blocking - Update is called from the server's own loop, and never
+		waits on anyone, so a slow or stuck scraper can't hold up a tick.
+
+		The page is only written when a request's come in for it, as that's
+		usually a few times a minute, against 60 ticks a second. Every answer
+		closes the connection, so there's no keeping track of anyone between
+		scrapes, and anything that hasn't finished within Timeout is dropped.
+
+		There's no authentication, so it only listens on the loopback unless
+		it's given another address to bind to - "0.0.0.0" for every interface
+		- which should only be somewhere the scraper's network is trusted.
+		*/
+		class TelemetryServer {
+		public:
+			typedef std::function<void(std::string& page)> PageWriter;
+
+			TelemetryServer(int port, const std::string& bindAddress = DefaultAddress);
+			~TelemetryServer();
+
+			bool IsListening() const {
+				return listener != ENET_SOCKET_NULL;
+			}
+
+			int GetPort() const {
+				return port;
+			}
+
+			void Update(float dt, const PageWriter& writePage);
+
+			static const char*	DefaultAddress;
+			static const int	MaxConnections	= 8;
+			static const int	MaxRequestSize	= 4096;
+			static const float	Timeout;
+
+		protected:
+			struct Connection {
+				ENetSocket	socket;
+				std::string	request;
+				std::string	response;
+				size_t		sent	= 0;
+				float		age		= 0.0f;
+			};
+
+			void Accept();
+			//True once the connection's done with, either way
+			bool Service(Connection& c, const PageWriter& writePage);
+			void Respond(Connection& c, const PageWriter& writePage);
+
+			int							port;
+			ENetSocket					listener;
+			std::vector<Connection>		connections;
+			std::string					page; //kept, so it isn't reallocated every scrape
+		};
+	}
+}
@@ -1,45 +1,203 @@
 #include "Transform.h"
+#include <cmath>
 
 using namespace NCL::CSC8503;
 
 Transform::Transform()
 {
 	scale	= Vector3(1, 1, 1);
+	previous = nullptr;
+	parent	= nullptr;
+	changeCount			= 1;
+	matrixChangeCount	= 0;
+}
+
+Transform::Transform(const Transform& other) {
+	previous = nullptr;
+	*this = other;
 }
 
 Transform::~Transform()
 {
+	delete previous;
+}
 
+//The copy gets its own previous state, if there is one, rather than sharing it
+Transform& Transform::operator=(const Transform& other) {
+	if (this == &other) {
+		return *this;
+	}
+	matrix				= other.matrix;
+	changeCount			= other.changeCount;
+	matrixChangeCount	= other.matrixChangeCount;
+	parent				= other.parent;
+	orientation			= other.orientation;
+	position			= other.position;
+	scale				= other.scale;
+	if (other.previous) {
+		if (!previous) {
+			previous = new PreviousState();
+		}
+		*previous = *other.previous;
+	}
+	else {
+		ClearPreviousState();
+	}
+	return *this;
+}
+
+uint32_t Transform::PackOrientation(const Quaternion& q) {
+	int largest = 0;
+	for (int i = 1; i < 4; ++i) {
+		largest = abs(q.array[i]) > abs(q.array[largest]) ? i : largest;
+	}
+	//q and -q are the same rotation, so flip it to make the missing one positive
+	float sign = q.array[largest] < 0.0f ? -1.0f : 1.0f;
+	uint32_t packed = (uint32_t)largest << 30;
+	int shift = 20;
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float v = q.array[i] * sign * 0.70710678f + 0.5f; //from -1/sqrt(2) to 1/sqrt(2), to 0 to 1
+		v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+		packed |= (uint32_t)(v * 1023.0f + 0.5f) << shift;
+		shift -= 10;
+	}
+	return packed;
+}
+
+Quaternion Transform::UnpackOrientation(uint32_t packed) {
+	Quaternion q;
+	int largest = (int)(packed >> 30);
+	int shift	= 20;
+	float sum	= 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float v = (float)((packed >> shift) & 0x3FF) / 1023.0f;
+		q.array[i] = (v - 0.5f) * 1.41421356f;
+		sum += q.array[i] * q.array[i];
+		shift -= 10;
+	}
+	q.array[largest] = sum < 1.0f ? sqrt(1.0f - sum) : 0.0f;
+	return q;
+}
+
+Matrix4 Transform::BuildMatrix(const Vector3& pos, const Quaternion& orient) const {
+	return	Matrix4::Translation(pos) *
+			Matrix4(orient) *
+			Matrix4::Scale(scale);
+}
+
+void Transform::GetWorldPose(Vector3& pos, Quaternion& orient) const {
+	pos		= position;
+	orient	= orientation;
+	if (parent) {
+		Vector3		parentPos;
+		Quaternion	parentOrient;
+		parent->GetWorldPose(parentPos, parentOrient);
+		pos		= parentPos + parentOrient * pos;
+		orient	= parentOrient * orient;
+	}
+}
+
+Vector3 Transform::GetWorldPosition() const {
+	Vector3		pos;
+	Quaternion	orient;
+	GetWorldPose(pos, orient);
+	return pos;
+}
+
+Quaternion Transform::GetWorldOrientation() const {
+	Vector3		pos;
+	Quaternion	orient;
+	GetWorldPose(pos, orient);
+	return orient;
+}
+
+Matrix4 Transform::GetMatrix() const {
+	if (matrixChangeCount == GetChangeCount()) {
+		return matrix;
+	}
+	Vector3		pos;
+	Quaternion	orient;
+	GetWorldPose(pos, orient);
+	return BuildMatrix(pos, orient);
 }
 
 void Transform::UpdateMatrix() {
-	matrix =
-		Matrix4::Translation(position) *
-		Matrix4(orientation) *
-		Matrix4::Scale(scale);
+	unsigned int count = GetChangeCount();
+	if (matrixChangeCount == count) {
+		return;
+	}
+	Vector3		pos;
+	Quaternion	orient;
+	GetWorldPose(pos, orient);
+	matrix				= BuildMatrix(pos, orient);
+	matrixChangeCount	= count;
+}
+
+void Transform::GetInterpolatedPose(float alpha, Vector3& pos, Quaternion& orient) const {
+	pos		= position;
+	orient	= orientation;
+	if (HasPreviousState() && alpha < 1.0f) {
+		pos		= previous->position + (position - previous->position) * alpha;
+		orient	= Quaternion::Lerp(UnpackOrientation(previous->orientation), orientation, alpha);
+		orient.Normalise();
+	}
+	if (parent) {
+		Vector3		parentPos;
+		Quaternion	parentOrient;
+		parent->GetInterpolatedPose(alpha, parentPos, parentOrient);
+		pos		= parentPos + parentOrient * pos;
+		orient	= parentOrient * orient;
+	}
+}
+
+/*
+Alpha is how far we are between the previous physics state and the current
+one. Objects that the physics system hasn't moved just use their matrix,
+unless they're following a parent that it has.
+*/
+Matrix4 Transform::GetInterpolatedMatrix(float alpha) const {
+	if (!parent && (!HasPreviousState() || alpha >= 1.0f)) {
+		return GetMatrix();
+	}
+	Vector3		pos;
+	Quaternion	orient;
+	GetInterpolatedPose(alpha, pos, orient);
+	return BuildMatrix(pos, orient);
 }
 
 Transform& Transform::SetPosition(const Vector3& worldPos) {
 	position = worldPos;
-	UpdateMatrix();
+	changeCount++;
 	return *this;
 }
 
 Transform& Transform::SetScale(const Vector3& worldScale) {
 	scale = worldScale;
-	UpdateMatrix();
+	changeCount++;
 	return *this;
 }
 
 Transform& Transform::SetOrientation(const Quaternion& worldOrientation) {
 	orientation = worldOrientation;
-	UpdateMatrix();
+	changeCount++;
 	return *this;
 }
 
+//The matrix is always rebuilt from position, orientation and scale
 Transform& NCL::CSC8503::Transform::SetMatrix(const Matrix4& mat)
 {
-	matrix = mat;
-	UpdateMatrix();
+	changeCount++;
+	return *this;
+}
+
+Transform& Transform::SetParent(const Transform* newParent) {
+	parent = newParent;
+	changeCount++;
 	return *this;
 }
@@ -3,8 +3,10 @@
 #include "../../Common/Matrix3.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/Quaternion.h"
+#include "../../Common/MemoryPool.h"
 
 #include <vector>
+#include <cstdint>
 
 using std::vector;
 
@@ -12,12 +14,24 @@ using namespace NCL::Maths;
 
 namespace NCL {
 	namespace CSC8503 {
+		/*
+		Static objects - most of a level - never have a previous state, so
+		that's kept out of the transform, and only the things the physics
+		system moves have one, taken from the MemoryPool the first time
+		they're moved. Its orientation is packed down to 32 bits, as it's only
+		ever blended towards the current one for drawing. Everything a static
+		object's drawn with is its cached matrix, which the indirect batch
+		copies into its own buffer when the level's loaded.
+		*/
 		class Transform
 		{
 		public:
 			Transform();
+			Transform(const Transform& other);
 			~Transform();
 
+			Transform& operator=(const Transform& other);
+
 			Transform& SetPosition(const Vector3& worldPos);
 			Transform& SetScale(const Vector3& worldScale);
 			Transform& SetOrientation(const Quaternion& newOr);
@@ -35,17 +49,82 @@ namespace NCL {
 				return orientation;
 			}
 
-			Matrix4 GetMatrix() const {
-				return matrix;
-			}	
+			//Once it has a parent, position and orientation are relative to the
+			//parent's, and it follows it around without being scaled by it - so
+			//anything wanting where it is in the world needs GetWorldPosition or
+			//the matrix, rather than GetPosition. The parent has to outlive it
+			Transform& SetParent(const Transform* newParent);
+
+			const Transform* GetParent() const {
+				return parent;
+			}
+
+			Vector3		GetWorldPosition() const;
+			Quaternion	GetWorldOrientation() const;
+
+			//Built on demand, rather than cached, if anything's changed since
+			//the last UpdateMatrix, so it's always safe to call from jobs
+			Matrix4 GetMatrix() const;
 
+			//Rebuilds the cached matrix, if it's out of date
 			void UpdateMatrix();
+
+			//The physics system stores the state before each substep, so that
+			//rendering can blend between the last two simulated states
+			void StorePreviousState() {
+				if (!previous) {
+					previous = new PreviousState();
+				}
+				previous->position		= position;
+				previous->orientation	= PackOrientation(orientation);
+				previous->valid			= true;
+			}
+
+			void ClearPreviousState() {
+				if (previous) {
+					previous->valid = false;
+				}
+			}
+
+			bool HasPreviousState() const {
+				return previous && previous->valid;
+			}
+
+			Matrix4 GetInterpolatedMatrix(float alpha) const;
+
+			//Smallest three - the largest component's left out, as it can be worked
+			//back out from the rest, which are then no bigger than 1/sqrt(2), so 10
+			//bits each is within about a thousandth. The top 2 bits say which it was
+			static uint32_t		PackOrientation(const Quaternion& q);
+			static Quaternion	UnpackOrientation(uint32_t packed);
 		protected:
+			struct PreviousState : public PooledObject {
+				Vector3		position;
+				uint32_t	orientation;
+				bool		valid;
+			};
+
+			void GetWorldPose(Vector3& pos, Quaternion& orient) const;
+			void GetInterpolatedPose(float alpha, Vector3& pos, Quaternion& orient) const;
+			Matrix4 BuildMatrix(const Vector3& pos, const Quaternion& orient) const;
+
+			//Goes up by one every time this or any of its parents is changed,
+			//so a matrix built at an older count is out of date
+			unsigned int GetChangeCount() const {
+				return changeCount + (parent ? parent->GetChangeCount() : 0);
+			}
+
 			Matrix4		matrix;
+			unsigned int changeCount;
+			unsigned int matrixChangeCount;	//what GetChangeCount was when matrix was built
+			const Transform* parent;
+
 			Quaternion	orientation;
 			Vector3		position;
 
 			Vector3		scale;
+
+			PreviousState* previous; //null until it's first moved by the physics
 		};
 	}
 }
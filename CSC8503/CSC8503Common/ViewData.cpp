@@ -0,0 +1,35 @@
+#include "ViewData.h"
+#include "CollisionDetection.h"
+#include "../../Common/Vector4.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+The inverses are built the same cheap way the mouse picking always has,
+from the camera's own angles, rather than by inverting the matrices -
+orthographic cameras are the exception, which don't happen often enough
+to matter.
+*/
+void ViewData::Build(const Camera& camera, float screenAspect) {
+	aspect		= screenAspect;
+	position	= camera.GetPosition();
+	nearPlane	= camera.GetNearPlane();
+	farPlane	= camera.GetFarPlane();
+
+	viewMatrix	= camera.BuildViewMatrix();
+	projMatrix	= camera.BuildProjectionMatrix(aspect);
+	viewProj	= projMatrix * viewMatrix;
+
+	invView		= CollisionDetection::GenerateInverseView(camera);
+	invProj		= camera.GetType() == CameraType::Orthographic ? projMatrix.Inverse() :
+		CollisionDetection::GenerateInverseProjection(aspect, camera.GetFieldOfVision(), nearPlane, farPlane);
+	invViewProj	= invView * invProj;
+
+	frustum.FromMatrix(viewProj);
+}
+
+Vector3 ViewData::Unproject(const Vector3& ndcPos) const {
+	Vector4 transformed = invViewProj * Vector4(ndcPos.x, ndcPos.y, ndcPos.z, 1.0f);
+	return Vector3(transformed.x / transformed.w, transformed.y / transformed.w, transformed.z / transformed.w);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "../../Common/Camera.h"
+#include "../../Common/Matrix4.h"
+#include "../../Common/Vector3.h"
+#include "Frustum.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+
+		/*
+		Everything about a camera's view that gets used more than once a frame,
+		worked out together when the frame's taken, so the passes, culling and
+		mouse picking all share the same matrices rather than each building
+		(or inverting) their own from the camera.
+		*/
+		struct ViewData {
+			Matrix4	viewMatrix;
+			Matrix4	projMatrix;
+			Matrix4	viewProj;
+			Matrix4	invView;
+			Matrix4	invProj;
+			Matrix4	invViewProj;
+			Frustum	frustum;
+			Vector3	position;
+			float	aspect		= 1.0f;
+			float	nearPlane	= 1.0f;
+			float	farPlane	= 1000.0f;
+
+			void Build(const Camera& camera, float aspect);
+
+			//From -1 to 1 screen coordinates and depth back into the world
+			Vector3 Unproject(const Vector3& ndcPos) const;
+		};
+	}
+}
@@ -0,0 +1,73 @@
+#include "WorldHash.h"
+#include <cstring>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const uint32_t Prime1 = 2654435761u;
+	const uint32_t Prime2 = 2246822519u;
+	const uint32_t Prime3 = 3266489917u;
+	const uint32_t Prime4 = 668265263u;
+	const uint32_t Prime5 = 374761393u;
+
+	uint32_t RotateLeft(uint32_t v, int bits) {
+		return (v << bits) | (v >> (32 - bits));
+	}
+
+	uint32_t Read32(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v)); //might not be aligned
+		return v;
+	}
+
+	uint32_t Round(uint32_t acc, uint32_t input) {
+		acc += input * Prime2;
+		acc = RotateLeft(acc, 13);
+		return acc * Prime1;
+	}
+}
+
+/*
+The states hashed here are only a few bytes each, so it's usually just
+the tail loops that run, but longer ones go through the four lanes the
+same as any other xxHash32.
+*/
+uint32_t WorldHash::XXHash32(const void* data, int bytes, uint32_t seed) {
+	const uint8_t* p	= (const uint8_t*)data;
+	const uint8_t* end	= p + bytes;
+	uint32_t h;
+
+	if (bytes >= 16) {
+		uint32_t v1 = seed + Prime1 + Prime2;
+		uint32_t v2 = seed + Prime2;
+		uint32_t v3 = seed;
+		uint32_t v4 = seed - Prime1;
+		for (; p + 16 <= end; p += 16) {
+			v1 = Round(v1, Read32(p));
+			v2 = Round(v2, Read32(p + 4));
+			v3 = Round(v3, Read32(p + 8));
+			v4 = Round(v4, Read32(p + 12));
+		}
+		h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+	}
+	else {
+		h = seed + Prime5;
+	}
+	h += (uint32_t)bytes;
+
+	for (; p + 4 <= end; p += 4) {
+		h += Read32(p) * Prime3;
+		h = RotateLeft(h, 17) * Prime4;
+	}
+	for (; p < end; ++p) {
+		h += (*p) * Prime5;
+		h = RotateLeft(h, 11) * Prime1;
+	}
+	h ^= h >> 15;
+	h *= Prime2;
+	h ^= h >> 13;
+	h *= Prime3;
+	h ^= h >> 16;
+	return h;
+}
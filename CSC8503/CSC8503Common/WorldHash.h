@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A hash of a set of objects' states, kept in buckets by object ID, for
+		the server and a client to check they agree without sending the
+		states themselves. Each object's state is hashed on its own (with
+		xxHash32), and the results summed into its bucket, so objects can be
+		added in any order, and one can be taken back out again by taking its
+		hash away. Comparing bucket by bucket narrows down which objects are
+		out, so only those need sending again.
+		*/
+		class WorldHash {
+		public:
+			static const int Buckets = 32; //one bit each in a mask
+
+			WorldHash() {
+				Clear();
+			}
+			~WorldHash() {}
+
+			void Clear() {
+				for (uint32_t& b : buckets) {
+					b = 0;
+				}
+			}
+
+			void Add(int objectID, const void* state, int bytes) {
+				buckets[GetBucket(objectID)] += HashObject(objectID, state, bytes);
+			}
+
+			void Remove(int objectID, const void* state, int bytes) {
+				buckets[GetBucket(objectID)] -= HashObject(objectID, state, bytes);
+			}
+
+			uint32_t GetBucketHash(int bucket) const {
+				return buckets[bucket];
+			}
+
+			//A bit set for each bucket that isn't the same in both
+			uint32_t Compare(const uint32_t* other) const {
+				uint32_t mismatched = 0;
+				for (int i = 0; i < Buckets; ++i) {
+					mismatched |= buckets[i] != other[i] ? (1u << i) : 0;
+				}
+				return mismatched;
+			}
+
+			static int GetBucket(int objectID) {
+				return (objectID < 0 ? -objectID : objectID) % Buckets;
+			}
+
+			static bool InBuckets(int objectID, uint32_t mask) {
+				return (mask & (1u << GetBucket(objectID))) != 0;
+			}
+
+			static uint32_t XXHash32(const void* data, int bytes, uint32_t seed = 0);
+
+		protected:
+			static uint32_t HashObject(int objectID, const void* state, int bytes) {
+				return XXHash32(state, bytes, (uint32_t)objectID);
+			}
+
+			uint32_t buckets[Buckets];
+		};
+	}
+}
@@ -0,0 +1,133 @@
+#include "WorldRollback.h"
+#include "PhysicsObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const int NoTick = -1;
+}
+
+WorldRollback::WorldRollback(GameWorld& world, PhysicsSystem& physics, int frameCount, int bodyCapacity) : world(world), physics(physics) {
+	frames.resize(frameCount > 0 ? frameCount : 1);
+	for (Frame& f : frames) {
+		f.tick = NoTick;
+		f.bodies.reserve(bodyCapacity);
+	}
+	nextFrame = 0;
+
+	world.AddObjectListener(this,
+		[](GameObject* o) {},
+		[this](GameObject* o) {
+			OnObjectRemoved(o);
+		}
+	);
+}
+
+WorldRollback::~WorldRollback() {
+	world.RemoveObjectListener(this);
+}
+
+void WorldRollback::Clear() {
+	for (Frame& f : frames) {
+		f.tick = NoTick;
+		f.bodies.clear();
+	}
+	nextFrame = 0;
+}
+
+void WorldRollback::Save(int tick) {
+	Frame& f = frames[nextFrame];
+	nextFrame = (nextFrame + 1) % (int)frames.size();
+
+	f.tick = tick;
+	f.bodies.clear();
+	world.OperateOnContents(
+		[&](GameObject* o) {
+			PhysicsObject* p = o->GetPhysicsObject();
+			if (!p || o->IsStatic()) {
+				return;
+			}
+			BodyState b;
+			b.object			= o;
+			b.position			= o->GetTransform().GetPosition();
+			b.orientation		= o->GetTransform().GetOrientation();
+			b.linearVelocity	= p->GetLinearVelocity();
+			b.angularVelocity	= p->GetAngularVelocity();
+			b.sleepTimer		= p->GetSleepTimer();
+			b.sleeping			= o->IsSleeping();
+			b.grounded			= p->IsGrounded();
+			o->SaveGameState(b.gameState);
+			f.bodies.push_back(b);
+		}
+	);
+	physics.SaveState(f.physics);
+}
+
+/*
+Anything that's asleep now but wasn't at the saved tick is woken back up
+through the world, so it's in the awake list for the resimulation. The
+other way round, the object's just left awake with its old sleep timer,
+and will drop back off to sleep by itself.
+*/
+bool WorldRollback::Restore(int tick) {
+	const Frame* f = FindFrame(tick);
+	if (!f) {
+		return false;
+	}
+	for (const BodyState& b : f->bodies) {
+		if (!b.object) {
+			continue; //removed since
+		}
+		GameObject*		o = b.object;
+		PhysicsObject*	p = o->GetPhysicsObject();
+
+		if (o->IsSleeping() && !b.sleeping) {
+			world.WakeObject(o);
+		}
+		o->GetTransform().SetPosition(b.position);
+		o->GetTransform().SetOrientation(b.orientation);
+		p->SetLinearVelocity(b.linearVelocity);
+		p->SetAngularVelocity(b.angularVelocity);
+		p->SetSleepTimer(b.sleepTimer);
+		p->SetGrounded(b.grounded);
+		o->RestoreGameState(b.gameState);
+	}
+	physics.RestoreState(f->physics);
+
+	for (Frame& other : frames) {
+		if (other.tick > tick) {
+			other.tick = NoTick;
+		}
+	}
+	nextFrame = (int)(f - frames.data() + 1) % (int)frames.size();
+	return true;
+}
+
+const WorldRollback::Frame* WorldRollback::FindFrame(int tick) const {
+	if (tick == NoTick) {
+		return nullptr;
+	}
+	for (const Frame& f : frames) {
+		if (f.tick == tick) {
+			return &f;
+		}
+	}
+	return nullptr;
+}
+
+//Saved frames can't be holding on to an object that's about to be deleted
+void WorldRollback::OnObjectRemoved(GameObject* o) {
+	for (Frame& f : frames) {
+		for (BodyState& b : f.bodies) {
+			if (b.object == o) {
+				b.object = nullptr;
+			}
+		}
+		auto involves = [o](const CollisionDetection::CollisionInfo& c) {
+			return c.a == o || c.b == o;
+		};
+		f.physics.collisions.RemoveIf(involves);
+		f.physics.triggers.RemoveIf(involves);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "GameWorld.h"
+#include "PhysicsSystem.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A ring of saved world states, one per tick, so the world can be put
+		back a few ticks and simulated forward again - for the server to
+		check hits against where things were, or a client to replay its
+		inputs after a correction.
+
+		Everything's allocated up front: each frame keeps enough room for
+		bodyCapacity objects, and its copy of the pair cache keeps whatever
+		it's grown to, so once the world's settled down saving costs a copy
+		and nothing more. Only objects that can move are saved; anything
+		added after a save is just left where it is on a restore, and
+		anything removed is dropped from every frame as it goes.
+		*/
+		class WorldRollback {
+		public:
+			WorldRollback(GameWorld& world, PhysicsSystem& physics, int frameCount = 16, int bodyCapacity = 1024);
+			~WorldRollback();
+
+			void Save(int tick);
+
+			//Puts the world back how it was at the given tick, and forgets
+			//every tick after it, as they're about to be simulated again
+			bool Restore(int tick);
+
+			bool Has(int tick) const {
+				return FindFrame(tick) != nullptr;
+			}
+
+			void Clear();
+
+		protected:
+			struct BodyState {
+				GameObject*	object;
+				Vector3		position;
+				Quaternion	orientation;
+				Vector3		linearVelocity;
+				Vector3		angularVelocity;
+				float		sleepTimer;
+				bool		sleeping;
+				bool		grounded;
+				int			gameState[GameObject::GameStateSlots];
+			};
+
+			struct Frame {
+				int						tick;
+				std::vector<BodyState>	bodies;
+				PhysicsSystem::SavedState physics;
+			};
+
+			const Frame* FindFrame(int tick) const;
+			void OnObjectRemoved(GameObject* o);
+
+			GameWorld&		world;
+			PhysicsSystem&	physics;
+
+			std::vector<Frame>	frames;
+			int					nextFrame;
+		};
+	}
+}
@@ -2,6 +2,7 @@
 #include "LevelManager.h"
 
 void NCL::CSC8503::Agent::Update(float dt) {
+	jumpCooldownTimer += dt;
 	UpdateGun(dt);
 	if (health <= 0 && respawnFlag) {
 		respawnFlag = false;
@@ -13,6 +14,8 @@ void NCL::CSC8503::Agent::Update(float dt) {
 		respawnTimer += dt;
 		if (respawnTimer >= respawnDuration) {
 			health = 100;
+			transform.SetPosition(spawnPos);
+			GetPhysicsObject()->SetLinearVelocity(Vector3(0, 0, 0));
 			isRespawning = false;
 			respawnTimer = 0;
 			respawnFlag = true;
@@ -20,28 +23,62 @@ void NCL::CSC8503::Agent::Update(float dt) {
 	}
 }
 
-int NCL::CSC8503::Agent::GetNumBlocksColoured() const {
-	int numBlocksColoured = 0;
-	for (ColourBlock* b : targetWall) {
-		numBlocksColoured += b->IsColoured() ? 1 : 0;
+void NCL::CSC8503::Agent::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
+	if (otherObject->GetLayer() == CollisionLayer::FLOOR && jumpCooldownTimer > jumpCooldownDuration) {
+		grounded = true;
 	}
-	return numBlocksColoured;
 }
 
-int NCL::CSC8503::Agent::GetNumBlocksRemaining() const {
-	int blocksRemaining = 0;
-	for (ColourBlock* block : targetWall) {
-		if (!block->IsColoured()) {
-			blocksRemaining++;
-		}
+void NCL::CSC8503::Agent::ApplyInput(const AgentInput& input) {
+	transform.SetOrientation(Quaternion::EulerAnglesToQuaternion(0, input.yaw, 0));
+
+	if (input.buttons & AgentInput::Forward) {
+		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(0, 0, -1) * speed);
+	}
+	if (input.buttons & AgentInput::Back) {
+		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(0, 0, 1) * speed);
 	}
-	return blocksRemaining;
+	if (input.buttons & AgentInput::Left) {
+		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(-1, 0, 0) * speed);
+	}
+	if (input.buttons & AgentInput::Right) {
+		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(1, 0, 0) * speed);
+	}
+
+	if (grounded && (input.buttons & AgentInput::Jump)) {
+		GetPhysicsObject()->SetLinearVelocity(GetPhysicsObject()->GetLinearVelocity() * Vector3(1, 0, 1));
+		GetPhysicsObject()->AddForce(Vector3(0, 1, 0) * jumpForce);
+		grounded = false;
+		jumpCooldownTimer = 0;
+	}
+}
+
+void NCL::CSC8503::Agent::Stabilise() {
+	transform.SetOrientation(Quaternion::EulerAnglesToQuaternion(0, transform.GetOrientation().ToEuler().y, 0));
+
+	GetPhysicsObject()->SetLinearVelocity(GetPhysicsObject()->GetLinearVelocity() * Vector3(damping, 1, damping));
+}
+
+int NCL::CSC8503::Agent::GetNumBlocksColoured() const {
+	return colourWall ? colourWall->coloured : 0;
+}
+
+int NCL::CSC8503::Agent::GetNumBlocksRemaining() const {
+	return colourWall ? colourWall->Remaining() : 0;
 }
 
 void NCL::CSC8503::Agent::Explode() {
 	level->AddPaintExplosion(transform.GetPosition() + Vector3(0, 3.5f, 0), 1.5);
 }
 
+void NCL::CSC8503::Agent::SetGunObj(GameObject* gun) {
+	paintGun = gun;
+	paintGun->GetTransform()
+		.SetParent(&transform)
+		.SetPosition(Vector3(0.5f, 1.5f, -0.5f))
+		.SetOrientation(Quaternion());
+}
+
 void NCL::CSC8503::Agent::UpdateGun(float dt) {
 	gunColourTimer += dt;
 	if (gunColourTimer >= gunColourDuration) {
@@ -49,7 +86,5 @@ void NCL::CSC8503::Agent::UpdateGun(float dt) {
 		targetGunColour = Vector4((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX, 1);
 		gunColourTimer = 0;
 	}
-	paintGun->GetTransform().SetPosition(transform.GetPosition() + Vector3(0, 1.5f, 0) + transform.GetOrientation() * Vector3(0.5, 0, -0.5));
-	paintGun->GetTransform().SetOrientation(transform.GetOrientation());
 	paintGun->GetRenderObject()->SetColour(Vector4::Lerp(prevGunColour, targetGunColour, gunColourTimer / gunColourDuration));
 }
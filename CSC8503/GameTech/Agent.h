@@ -1,28 +1,64 @@
 #pragma once
 
 #include "../CSC8503Common/GameObject.h"
+#include "ObjectType.h"
 #include "ColourBlock.h"
 
 namespace NCL {
 	namespace CSC8503 {
 		class LevelManager;
 
+		/*
+		What a player is doing with the controls. The same input moves a Player
+		locally and its Agent on the server, so that the client's predictions
+		match what the server works out.
+		*/
+		struct AgentInput {
+			enum Buttons {
+				Forward = 1,
+				Back	= 2,
+				Left	= 4,
+				Right	= 8,
+				Jump	= 16
+			};
+			int		buttons = 0;
+			float	yaw		= 0;
+		};
+
 		class Agent : public GameObject {
 		public:
 			Agent(int agentID, LevelManager* l, const Vector3& spawnPosition, vector<ColourBlock*>& wall) : agentID(agentID), level(l), isRespawning(false), paintAmmo(12), spawnPos(spawnPosition) {
 				targetWall = wall;
+				colourWall = wall.empty() ? nullptr : wall[0]->GetWall();
 				name = "Agent"; 
+				typeID = ObjectType::Agent;
 				gunColourDuration = 2;
 				gunColourTimer = 2;
 				respawnDuration = 3.0;
 				respawnTimer = 0;
 				respawnFlag = true;
+
+				speed = 20.0f;
+				jumpForce = 350.0f;
+				damping = 0.98f;
+				grounded = false;
+				jumpCooldownDuration = 0.15f;
+				jumpCooldownTimer = 0.15f;
 			}
 
 			~Agent() {};
 
 			virtual void Update(float dt) override;
 
+			void OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) override;
+
+			//Pushes the agent around for this frame, but doesn't move it - that's
+			//left to the physics system, along with everything else
+			void ApplyInput(const AgentInput& input);
+
+			//Keeps the agent upright, and damps its movement so it feels responsive
+			void Stabilise();
+
 			int GetID() const { return agentID; }
 
 			int GetAmmo() const { return paintAmmo; }
@@ -32,7 +68,9 @@ namespace NCL {
 			void SetRespawning(bool s) { isRespawning = s; }
 
 			Vector3 GetSpawnPosition() const { return spawnPos; }
-			vector<ColourBlock*> GetTargetWall() { return targetWall; }
+			const vector<ColourBlock*>& GetTargetWall() const { return targetWall; }
+
+			const ColourWall* GetColourWall() const { return colourWall; }
 
 			int GetNumBlocksColoured() const;
 
@@ -42,10 +80,23 @@ namespace NCL {
 
 			void SetHealth(int newHealth) { health = newHealth; }
 
-			void SetGunObj(GameObject* gun) { paintGun = gun; }
+			//The gun's attached to the agent, so it follows it around from then on
+			virtual void SetGunObj(GameObject* gun);
 
 			void Explode();
 
+			void SaveGameState(int (&state)[GameStateSlots]) const override {
+				state[0] = health;
+				state[1] = paintAmmo;
+				state[2] = isRespawning ? 1 : 0;
+			}
+
+			void RestoreGameState(const int (&state)[GameStateSlots]) override {
+				health			= state[0];
+				paintAmmo		= state[1];
+				isRespawning	= state[2] != 0;
+			}
+
 		protected:
 
 			int agentID;
@@ -53,6 +104,7 @@ namespace NCL {
 			LevelManager* level;
 
 			vector<ColourBlock*> targetWall;
+			const ColourWall* colourWall;
 			Vector3 spawnPos;
 
 			int health = 100;
@@ -64,6 +116,14 @@ namespace NCL {
 			float respawnTimer;
 			bool respawnFlag;
 
+			bool grounded;
+			float jumpCooldownDuration;
+			float jumpCooldownTimer;
+
+			float speed;
+			float jumpForce;
+			float damping;
+
 			virtual void UpdateGun(float dt);
 			GameObject* paintGun;
 			Vector4 targetGunColour;
@@ -1,30 +1,70 @@
 #include "ColourBlock.h"
 #include "Projectile.h"
+#include "../CSC8503Common/GameWorld.h"
 
 NCL::CSC8503::ColourBlock::ColourBlock() {
 	name = "Colour Block";
+	typeID = ObjectType::ColourBlock;
 	coloured = false;
+	wall = nullptr;
+	wallIndex = -1;
 	fadeDuration = 3;
-	fadeTimer = 3;
+	SetTickInterval(0); //fades are worked out by the renderer, so it never has anything to do
 }
 
-void NCL::CSC8503::ColourBlock::Update(float dt) {
-	if (fadeTimer < fadeDuration) {
-		fadeTimer += dt;
-		renderObject->SetColour(Vector4::Lerp(prevColour, targetColour, fadeTimer / fadeDuration));
+void NCL::CSC8503::ColourBlock::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
+	if (otherObject->GetTypeID() == ObjectType::Projectile) {
+		Projectile* p = static_cast<Projectile*>(otherObject);
+		Paint(p->IsColoured(), p->GetRenderObject()->GetColour());
 	}
 }
 
-void NCL::CSC8503::ColourBlock::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (otherObject->GetName() == "Projectile") {
-		Projectile* p = static_cast<Projectile*>(otherObject);
-		coloured = p->IsColoured();
-		StartFade(p->GetRenderObject()->GetColour());
+void NCL::CSC8503::ColourBlock::Paint(bool colourPaint, const Vector4& colour) {
+	SetColoured(colourPaint);
+	StartFade(colour);
+}
+
+void NCL::CSC8503::ColourBlock::SetColoured(bool c) {
+	if (c == coloured) {
+		return;
 	}
+	coloured = c;
+	if (wall) {
+		wall->BlockChanged(wallIndex, c);
+	}
+}
+
+void NCL::CSC8503::ColourBlock::SetWall(ColourWall* w) {
+	wall = w;
+	wallIndex = (int)w->blocks.size();
+	wall->Add(this);
 }
 
+//Starts from wherever the last fade had got to, if it hasn't finished
 void NCL::CSC8503::ColourBlock::StartFade(Vector4 targetCol) {
-	targetColour = targetCol;
-	prevColour = renderObject->GetColour();
-	fadeTimer = 0;
+	float now = ownerWorld ? (float)ownerWorld->GetWorldTime() : 0.0f;
+	renderObject->SetColourFade(renderObject->GetColourAt(now), targetCol, now, fadeDuration);
+}
+
+void NCL::CSC8503::ColourWall::Add(ColourBlock* b) {
+	int index = (int)blocks.size();
+	blocks.push_back(b);
+	if (b->IsColoured()) {
+		coloured++;
+		if (firstUncoloured == index) {
+			firstUncoloured++;
+		}
+	}
+}
+
+//Blocks tend to be coloured in the order they're targeted, so walking on from the first rarely goes far
+void NCL::CSC8503::ColourWall::BlockChanged(int index, bool nowColoured) {
+	coloured += nowColoured ? 1 : -1;
+	if (!nowColoured) {
+		firstUncoloured = index < firstUncoloured ? index : firstUncoloured;
+		return;
+	}
+	while (firstUncoloured < (int)blocks.size() && blocks[firstUncoloured]->IsColoured()) {
+		firstUncoloured++;
+	}
 }
@@ -1,29 +1,53 @@
 #pragma once
 
 #include "../CSC8503Common/GameObject.h"
+#include "ObjectType.h"
 
 namespace NCL {
 	namespace CSC8503 {
+		class ColourBlock;
+
+		//A wall's blocks, and how much of it's been coloured, kept up to date
+		//by the blocks as they change, rather than found by going through them all
+		struct ColourWall {
+			std::vector<ColourBlock*> blocks;
+			int coloured		= 0;
+			int firstUncoloured	= 0; //the number of blocks, once they're all coloured
+
+			void Add(ColourBlock* b);
+			void BlockChanged(int index, bool nowColoured);
+
+			int Remaining() const { return (int)blocks.size() - coloured; }
+			ColourBlock* FirstUncoloured() const {
+				return firstUncoloured < (int)blocks.size() ? blocks[firstUncoloured] : nullptr;
+			}
+		};
+
 		class ColourBlock : public GameObject {
 		public:
 			ColourBlock();
 			~ColourBlock() {};
 
-			void Update(float dt) override;
-
 			void OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) override;
 
 			bool IsColoured() const { return coloured; }
+			//Every change of colour has to come through here, so the wall's count stays right
+			void SetColoured(bool c);
+
+			void SetWall(ColourWall* w);
+			const ColourWall* GetWall() const { return wall; }
 
 			void StartFade(Vector4 targetColour);
 
+			//What a projectile does to the block, whether it hit it or splashed it
+			virtual void Paint(bool colourPaint, const Vector4& colour);
+
 		protected:
 
 			bool coloured;
+			ColourWall* wall;
+			int wallIndex;
 
-			Vector4 targetColour;
-			Vector4 prevColour;
-			float fadeTimer;
 			float fadeDuration;
 		};
 	}
@@ -0,0 +1,77 @@
+#include "DynamicLights.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+int DynamicLights::AddSteady(const Vector3& position, const Vector4& colour, float radius) {
+	Steady s = { { position, radius, colour }, true };
+	if (!freeSteady.empty()) {
+		int light = freeSteady.back();
+		freeSteady.pop_back();
+		steady[light] = s;
+		return light;
+	}
+	steady.emplace_back(s);
+	return (int)steady.size() - 1;
+}
+
+void DynamicLights::SetSteadyColour(int light, const Vector4& colour) {
+	if (light >= 0 && light < (int)steady.size()) {
+		steady[light].light.colour = colour;
+	}
+}
+
+void DynamicLights::RemoveSteady(int light) {
+	if (light >= 0 && light < (int)steady.size() && steady[light].used) {
+		steady[light].used = false;
+		freeSteady.emplace_back(light);
+	}
+}
+
+void DynamicLights::Flash(const Vector3& position, const Vector4& colour, float radius, float lifetime) {
+	FlashLight f = { { position, radius, colour }, 0.0f, lifetime > 0.0f ? lifetime : 0.001f };
+	if ((int)flashes.size() < MaxFlashes) {
+		flashes.emplace_back(f);
+		return;
+	}
+	flashes[nextFlash] = f;
+	nextFlash = (nextFlash + 1) % MaxFlashes;
+}
+
+//Burnt out flashes are swapped with the last one, which can reorder them, so nextFlash starts again
+void DynamicLights::Update(float dt) {
+	size_t before = flashes.size();
+	for (size_t i = 0; i < flashes.size();) {
+		flashes[i].age += dt;
+		if (flashes[i].age >= flashes[i].lifetime) {
+			flashes[i] = flashes.back();
+			flashes.pop_back();
+			continue;
+		}
+		++i;
+	}
+	if (flashes.size() != before) {
+		nextFlash = 0;
+	}
+}
+
+void DynamicLights::Clear() {
+	steady.clear();
+	freeSteady.clear();
+	flashes.clear();
+	nextFlash = 0;
+}
+
+void DynamicLights::Gather(std::vector<PointLight>& into) const {
+	for (const Steady& s : steady) {
+		if (s.used) {
+			into.emplace_back(s.light);
+		}
+	}
+	for (const FlashLight& f : flashes) {
+		float fade = 1.0f - f.age / f.lifetime;
+		PointLight l = f.light;
+		l.colour = l.colour * (fade * fade);
+		into.emplace_back(l);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Vector4.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+
+		struct PointLight {
+			Vector3	position;
+			float	radius;		//where it's faded out to nothing
+			Vector4	colour;		//already scaled by its brightness
+		};
+
+		/*
+		Every light besides the sun, which the renderer sorts into its light
+		grid once a frame. Steady ones stay where they are until they're
+		changed or removed, like the glow of a refill point. Flashes are
+		for shots and hits, and fade out on their own, so whatever makes
+		them can forget about them straight away. None of them cast shadows.
+		*/
+		class DynamicLights {
+		public:
+			static const int MaxFlashes = 128; //past which the oldest is replaced
+
+			int AddSteady(const Vector3& position, const Vector4& colour, float radius);
+			void SetSteadyColour(int light, const Vector4& colour);
+			void RemoveSteady(int light);
+
+			void Flash(const Vector3& position, const Vector4& colour, float radius, float lifetime);
+
+			void Update(float dt);
+
+			//Gets rid of the flashes and the steady lights
+			void Clear();
+
+			//Everything that's lit right now
+			void Gather(std::vector<PointLight>& into) const;
+
+		protected:
+			struct Steady {
+				PointLight	light;
+				bool		used;
+			};
+
+			struct FlashLight {
+				PointLight	light;
+				float		age;
+				float		lifetime;
+			};
+
+			std::vector<Steady>		steady;
+			std::vector<int>		freeSteady;
+			std::vector<FlashLight>	flashes;
+			int						nextFlash = 0; //the oldest, once they're all in use
+		};
+	}
+}
@@ -0,0 +1,227 @@
+#include "FrameGraph.h"
+#include "GPUTimer.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+FrameGraph::~FrameGraph() {
+	for (Target& t : targets) {
+		FreeTarget(t);
+	}
+}
+
+void FrameGraph::Reset() {
+	passes.clear();
+	resources.clear();
+	culledCount = 0;
+}
+
+FrameGraph::Resource FrameGraph::Import(const char* name, bool kept) {
+	ResourceInfo r;
+	r.name		= name;
+	r.imported	= true;
+	r.kept		= kept;
+	resources.emplace_back(r);
+	return (Resource)resources.size() - 1;
+}
+
+FrameGraph::Resource FrameGraph::CreateTarget(const char* name, const TargetDesc& desc) {
+	ResourceInfo r;
+	r.name	= name;
+	r.desc	= desc;
+	resources.emplace_back(r);
+	return (Resource)resources.size() - 1;
+}
+
+int FrameGraph::AddPass(const char* name, const std::function<void()>& execute) {
+	Pass p;
+	p.name		= name;
+	p.execute	= execute;
+	passes.emplace_back(p);
+	return (int)passes.size() - 1;
+}
+
+void FrameGraph::Reads(int pass, Resource r) {
+	passes[pass].reads.emplace_back(r);
+}
+
+void FrameGraph::Writes(int pass, Resource r) {
+	passes[pass].writes.emplace_back(r);
+}
+
+/*
+Going backwards, a pass lives if it writes something that's kept, or
+that a pass after it that lives reads - and then whatever it reads is
+needed too. A resource's lifetime is from the first live pass using it
+to the last, and targets are handed out in the order they're first
+used, each to the first pooled one of the same kind that's finished
+with by then. Targets nothing's used for a while are let go of, which
+is what happens to the scene's when the resolution goes back up.
+*/
+void FrameGraph::Compile() {
+	std::vector<bool> needed(resources.size());
+	for (size_t i = 0; i < resources.size(); ++i) {
+		needed[i] = resources[i].kept;
+	}
+	culledCount = 0;
+	for (int p = (int)passes.size() - 1; p >= 0; --p) {
+		Pass& pass = passes[p];
+		pass.alive = false;
+		for (Resource r : pass.writes) {
+			pass.alive |= needed[r];
+		}
+		if (!pass.alive) {
+			culledCount++;
+			continue;
+		}
+		for (Resource r : pass.reads) {
+			needed[r] = true;
+		}
+	}
+
+	for (ResourceInfo& r : resources) {
+		r.firstPass	= -1;
+		r.lastPass	= -1;
+		r.target	= -1;
+	}
+	for (int p = 0; p < (int)passes.size(); ++p) {
+		if (!passes[p].alive) {
+			continue;
+		}
+		for (const std::vector<Resource>* list : { &passes[p].reads, &passes[p].writes }) {
+			for (Resource r : *list) {
+				ResourceInfo& info = resources[r];
+				info.firstPass	= info.firstPass < 0 ? p : info.firstPass;
+				info.lastPass	= p;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < targets.size();) {
+		if (targets[i].idleFrames > TargetKeepFrames) {
+			FreeTarget(targets[i]);
+			targets.erase(targets.begin() + i);
+		}
+		else {
+			targets[i].busyUntil = -1;
+			targets[i].idleFrames++;
+			++i;
+		}
+	}
+
+	allocationOrder.clear();
+	for (Resource r = 0; r < (Resource)resources.size(); ++r) {
+		if (!resources[r].imported && resources[r].firstPass >= 0) {
+			allocationOrder.emplace_back(r);
+		}
+	}
+	std::sort(allocationOrder.begin(), allocationOrder.end(), [&](Resource a, Resource b) {
+		return resources[a].firstPass < resources[b].firstPass;
+	});
+	for (Resource r : allocationOrder) {
+		ResourceInfo& info = resources[r];
+		for (int t = 0; t < (int)targets.size() && info.target < 0; ++t) {
+			if (targets[t].desc == info.desc && targets[t].busyUntil < info.firstPass) {
+				info.target = t;
+			}
+		}
+		if (info.target < 0) {
+			Target t;
+			t.desc = info.desc;
+			MakeTarget(t);
+			targets.emplace_back(t);
+			info.target = (int)targets.size() - 1;
+		}
+		targets[info.target].busyUntil	= info.lastPass;
+		targets[info.target].idleFrames	= 0;
+	}
+}
+
+void FrameGraph::Execute(GPUTimer& timer) {
+	for (Pass& p : passes) {
+		if (!p.alive) {
+			continue;
+		}
+		ProfileScope cpu(p.name);
+		timer.Begin(p.name);
+		p.execute();
+		timer.End();
+	}
+}
+
+GLuint FrameGraph::GetFramebuffer(Resource r) const {
+	return resources[r].target < 0 ? 0 : targets[resources[r].target].fbo;
+}
+
+GLuint FrameGraph::GetColourTexture(Resource r) const {
+	return resources[r].target < 0 ? 0 : targets[resources[r].target].colour;
+}
+
+GLuint FrameGraph::GetDepthTexture(Resource r) const {
+	return resources[r].target < 0 ? 0 : targets[resources[r].target].depth;
+}
+
+//Only the formats the renderer asks for are sized properly, with anything else taken as 4 bytes
+int64_t FrameGraph::TargetBytes(const TargetDesc& desc) {
+	int64_t bytes = 0;
+	if (desc.colourFormat) {
+		bytes += desc.colourFormat == GL_RGBA16F ? 8 : 4;
+	}
+	if (desc.depthFormat) {
+		bytes += 4; //drivers tend to give 32 bits, for GL_DEPTH_COMPONENT
+	}
+	return bytes * desc.width * desc.height;
+}
+
+void FrameGraph::MakeTarget(Target& t) {
+	const TargetDesc& d = t.desc;
+	glGenFramebuffers(1, &t.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+
+	if (d.colourFormat) {
+		glGenTextures(1, &t.colour);
+		glBindTexture(GL_TEXTURE_2D, t.colour);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, d.colourFormat, d.width, d.height, 0, GL_RGBA, d.colourFormat == GL_RGBA16F ? GL_FLOAT : GL_UNSIGNED_BYTE, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t.colour, 0);
+	}
+	else {
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	if (d.depthFormat) {
+		const bool stencil = d.depthFormat == GL_DEPTH24_STENCIL8;
+		glGenTextures(1, &t.depth);
+		glBindTexture(GL_TEXTURE_2D, t.depth);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, d.comparison ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, d.comparison ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, d.depthFormat, d.width, d.height, 0,
+			stencil ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT, stencil ? GL_UNSIGNED_INT_24_8 : GL_FLOAT, NULL);
+		if (d.comparison) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, t.depth, 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, TargetBytes(d));
+}
+
+void FrameGraph::FreeTarget(Target& t) {
+	glDeleteFramebuffers(1, &t.fbo);
+	glDeleteTextures(1, &t.colour);
+	glDeleteTextures(1, &t.depth);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, -TargetBytes(t.desc));
+	t.fbo		= 0;
+	t.colour	= 0;
+	t.depth		= 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLRenderer.h"
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GPUTimer;
+
+		/*
+		A frame's passes, added in the order they run, each saying which
+		resources it reads and writes. Compile works back from the ones
+		that are kept - the screen, and anything the next frame needs - and
+		culls any pass whose writes nothing alive goes on to read. Render
+		targets that only last the frame come from a pool, handed out once
+		the culling's done, so targets with the same size and format whose
+		passes never overlap share one texture, and a culled pass's targets
+		aren't made at all.
+
+		Passes that only add to what's already in a resource (most of them,
+		drawing into the scene) just write it, so everything drawing into a
+		kept resource is kept, in order.
+		*/
+		class FrameGraph {
+		public:
+			typedef int Resource;
+
+			struct TargetDesc {
+				int		width			= 0;
+				int		height			= 0;
+				GLenum	colourFormat	= 0;		//none, if 0
+				GLenum	depthFormat		= 0;
+				bool	comparison		= false;	//for a shadow sampler to read the depth
+
+				bool operator==(const TargetDesc& o) const {
+					return width == o.width && height == o.height && colourFormat == o.colourFormat &&
+						depthFormat == o.depthFormat && comparison == o.comparison;
+				}
+			};
+
+			FrameGraph() {}
+			~FrameGraph();
+
+			//Throws away the last frame's passes, but not its targets
+			void Reset();
+
+			//Something made outside the graph, like the screen. If it's kept,
+			//whatever writes to it always runs
+			Resource Import(const char* name, bool kept = false);
+			//A target only for this frame, which isn't made until it's compiled
+			Resource CreateTarget(const char* name, const TargetDesc& desc);
+
+			int AddPass(const char* name, const std::function<void()>& execute);
+			void Reads(int pass, Resource r);
+			void Writes(int pass, Resource r);
+
+			void Compile();
+			//Every pass that survived, each timed under its name
+			void Execute(GPUTimer& timer);
+
+			//Only valid once compiled, and 0 for anything imported
+			GLuint GetFramebuffer(Resource r) const;
+			GLuint GetColourTexture(Resource r) const;
+			GLuint GetDepthTexture(Resource r) const;
+
+			bool IsCulled(int pass) const {
+				return !passes[pass].alive;
+			}
+			int GetCulledCount() const {
+				return culledCount;
+			}
+			int GetTargetCount() const {
+				return (int)targets.size();
+			}
+
+			static const int TargetKeepFrames = 120; //unused for this long before a target's deleted
+
+		protected:
+			FrameGraph(const FrameGraph&) = delete;
+			FrameGraph& operator=(const FrameGraph&) = delete;
+
+			struct Pass {
+				const char*				name;
+				std::function<void()>	execute;
+				std::vector<Resource>	reads;
+				std::vector<Resource>	writes;
+				bool					alive = false;
+			};
+
+			struct ResourceInfo {
+				const char*	name;
+				bool		imported	= false;
+				bool		kept		= false;
+				TargetDesc	desc;
+				int			firstPass	= -1;	//of the passes left alive
+				int			lastPass	= -1;
+				int			target		= -1;	//in the pool
+			};
+
+			struct Target {
+				TargetDesc	desc;
+				GLuint		fbo			= 0;
+				GLuint		colour		= 0;
+				GLuint		depth		= 0;
+				int			busyUntil	= -1;	//the last pass using it this frame
+				int			idleFrames	= 0;
+			};
+
+			void MakeTarget(Target& t);
+			void FreeTarget(Target& t);
+			static int64_t TargetBytes(const TargetDesc& desc);
+
+			std::vector<Pass>			passes;
+			std::vector<ResourceInfo>	resources;
+			std::vector<Target>			targets;
+			std::vector<Resource>		allocationOrder; //reused by Compile
+			int							culledCount = 0;
+		};
+	}
+}
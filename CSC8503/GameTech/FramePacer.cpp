@@ -0,0 +1,82 @@
+#include "FramePacer.h"
+#include <thread>
+#include <cmath>
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib,"winmm.lib")
+
+using namespace NCL;
+using namespace CSC8503;
+
+//Windows' sleeps are only as fine as its timer, which is usually 15.6ms unless asked otherwise
+FramePacer::FramePacer() {
+	timeBeginPeriod(1);
+
+	targetRates[(int)Game::State::PLAYING]		= 0.0f;
+	targetRates[(int)Game::State::PAUSED]		= 30.0f;
+	targetRates[(int)Game::State::WAITING]		= 30.0f;
+	targetRates[(int)Game::State::LOADING]		= 0.0f;
+	targetRates[(int)Game::State::MAIN_MENU]	= 30.0f;
+
+	nextFrame = Clock::now();
+}
+
+FramePacer::~FramePacer() {
+	timeEndPeriod(1);
+}
+
+void FramePacer::SetTargetRate(Game::State state, float framesPerSecond) {
+	targetRates[(int)state] = framesPerSecond > 0.0f ? framesPerSecond : 0.0f;
+}
+
+/*
+Frames are meant to start a fixed time apart, rather than a fixed time
+after the last one finished, so the rate holds even as the work in each
+one changes. Anything that's fallen well behind (a load, or a change to
+a faster rate) starts again from now, rather than rushing to catch up.
+*/
+void FramePacer::Wait(Game::State state) {
+	float rate = targetRates[(int)state];
+	Clock::time_point now = Clock::now();
+	if (rate <= 0.0f) {
+		nextFrame = now;
+		return;
+	}
+	Clock::duration frameLength = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+	nextFrame += frameLength;
+	if (nextFrame < now - frameLength || nextFrame > now + frameLength) {
+		nextFrame = now + frameLength;
+	}
+	SleepUntil(nextFrame);
+}
+
+/*
+It sleeps a millisecond at a time while there's more left than a sleep
+tends to take (the average, plus one deviation), and spins the rest.
+Each sleep updates the average with Welford's method.
+*/
+void FramePacer::SleepUntil(Clock::time_point until) {
+	while (true) {
+		Clock::time_point start = Clock::now();
+		double left = std::chrono::duration<double>(until - start).count();
+		double estimate = sleepMean + sqrt(sleepCount > 1 ? sleepVariance / (sleepCount - 1) : 0.0);
+		if (left <= estimate) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double slept = std::chrono::duration<double>(Clock::now() - start).count();
+
+		//Only a recent window of sleeps is kept, in case the system's timer changes
+		if (sleepCount == 1000) {
+			sleepCount		= 1;
+			sleepVariance	= 0.0;
+		}
+		sleepCount++;
+		double delta = slept - sleepMean;
+		sleepMean		+= delta / sleepCount;
+		sleepVariance	+= delta * (slept - sleepMean);
+	}
+	while (Clock::now() < until) {
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Game.h"
+#include <chrono>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Holds the main loop to a frame rate that depends on what the game's
+		doing, so menus and lobbies don't run flat out and cook laptops. A
+		rate of 0 leaves that state uncapped, which loading always is.
+
+		Wait is meant to be called straight after a frame's been presented,
+		so the window's polled for input as late as it can be before the next
+		frame's made. It sleeps for most of what's left, then spins for the
+		last little bit, as sleeps can overshoot by a millisecond or more -
+		how much they've been overshooting is kept track of, so it spins for
+		no longer than it has to.
+		*/
+		class FramePacer {
+		public:
+			FramePacer();
+			~FramePacer();
+
+			void SetTargetRate(Game::State state, float framesPerSecond);
+			float GetTargetRate(Game::State state) const {
+				return targetRates[(int)state];
+			}
+
+			void Wait(Game::State state);
+
+		protected:
+			typedef std::chrono::steady_clock Clock;
+
+			void SleepUntil(Clock::time_point until);
+
+			static const int StateCount = (int)Game::State::MAIN_MENU + 1;
+
+			float				targetRates[StateCount];
+			Clock::time_point	nextFrame;
+
+			//Of how long a 1ms sleep really takes, in seconds
+			double	sleepMean		= 0.002;
+			double	sleepVariance	= 0.0;
+			int		sleepCount		= 0;
+		};
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "../../Common/Matrix4.h"
+#include "../../Common/Vector3.h"
+#include "../../Common/Vector4.h"
+#include "../../Common/ShaderBase.h"
+#include "../../Common/TextureBase.h"
+#include "PaintParticles.h"
+#include "DynamicLights.h"
+#include "../CSC8503Common/ViewData.h"
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace NCL {
+	class MeshGeometry;
+	class MeshAnimation;
+	namespace CSC8503 {
+		using namespace Maths;
+		using namespace Rendering;
+
+		//A copy of what a RenderObject looked like when its frame was taken
+		struct FrameObject {
+			Matrix4					modelMatrix;	//already interpolated
+			Vector4					colour;			//where any fade had got to when it was taken
+			Vector4					fadeFrom;		//so the instanced shaders can carry on fading it themselves
+			Vector4					fadeTo;
+			float					fadeStart;
+			float					fadeDuration;	//0 when it isn't fading
+			MeshGeometry*			mesh;			//the LOD it's drawn with
+			ShaderBase*				shader;
+			TextureBase*			texture;
+			const MeshAnimation*	animation;
+			unsigned int			features;		//the RenderObject's
+			unsigned int			shaderFeatures;	//which of its shader's variants it's drawn with
+			int						textureLayer;
+			int						firstTexture;	//into the packet's textureIDs, for a texture per submesh
+			int						textureCount;
+			bool					castsShadow;
+			bool					layerPerSubMesh;	//texture's a material array, with a layer for each submesh
+		};
+
+		struct DrawItem {
+			uint64_t			key;
+			const FrameObject*	object;
+		};
+
+		struct PaletteEntry {
+			int offset	= 0;
+			int count	= 0;
+		};
+
+		/*
+		Everything the renderer needs to draw a frame, taken from the world
+		once it's been simulated. Nothing in here points back into the world,
+		only at meshes, textures, shaders and animations, which outlive any
+		one frame, so the world can carry on changing, or be cleared, while
+		the packet's being drawn.
+		*/
+		struct FramePacket {
+			int			curFrame = 0;
+			ViewData	view;			//the camera's, used by every pass
+			float		lodScale = 1.0f;
+			float		time = 0.0f;		//the world's, which colour fades are timed by
+			Matrix4		shadowViewProj;
+
+			std::vector<FrameObject>	cameraObjects;
+			std::vector<FrameObject>	shadowObjects;			//what the light can see that moves
+			std::vector<FrameObject>	staticShadowObjects;	//only filled in when the cached shadows need redrawing
+			bool						redrawStaticShadows = false;
+			std::vector<unsigned int>	textureIDs;
+
+			std::vector<DrawItem>		drawItems;				//the camera's objects, in the order they're drawn
+			std::vector<DrawItem>		depthItems;				//the solid ones again, nearest first, for the depth pre-pass
+
+			std::vector<PointLight>		lights;					//every dynamic light that could reach what the camera sees
+
+			std::vector<ParticleBurst>	particleBursts;			//made since the last frame
+			float						particleTime = 0.0f;	//how far they're moved on
+			bool						clearParticles = false;
+
+			std::vector<Matrix4>		jointPalette;			//every skinned mesh's joints, one after another
+			std::map<std::pair<const MeshGeometry*, const MeshAnimation*>, PaletteEntry> paletteOffsets;
+
+			void Clear() {
+				cameraObjects.clear();
+				shadowObjects.clear();
+				staticShadowObjects.clear();
+				redrawStaticShadows = false;
+				textureIDs.clear();
+				drawItems.clear();
+				depthItems.clear();
+				lights.clear();
+				particleBursts.clear();
+				particleTime = 0.0f;
+				clearParticles = false;
+				jointPalette.clear();
+				paletteOffsets.clear();
+			}
+		};
+	}
+}
@@ -0,0 +1,148 @@
+#include "GPUParticles.h"
+#include <cstddef>
+
+using namespace NCL;
+using namespace CSC8503;
+
+GPUParticles::GPUParticles() {
+	if (!glDispatchCompute || !glDispatchComputeIndirect || !glDrawArraysIndirect) {
+		return;
+	}
+	computeShader = new OGLComputeShader("ParticleCompute.glsl");
+	if (!computeShader->LoadSuccess()) {
+		delete computeShader;
+		computeShader = nullptr;
+		return;
+	}
+	int program = computeShader->GetProgramID();
+	uniforms[0] = glGetUniformLocation(program, "stage");
+	uniforms[1] = glGetUniformLocation(program, "dt");
+	uniforms[2] = glGetUniformLocation(program, "source");
+	uniforms[3] = glGetUniformLocation(program, "emitCount");
+	uniforms[4] = glGetUniformLocation(program, "burstCount");
+	uniforms[5] = glGetUniformLocation(program, "seed");
+
+	drawShader = new OGLShader("ParticleVert.glsl", "ParticleFrag.glsl");
+
+	//Position and life, velocity and size, colour, then lifetime and how much gravity pulls it
+	const GLsizeiptr particleSize = sizeof(float) * 16;
+	glGenBuffers(2, particleBuffers);
+	for (GLuint b : particleBuffers) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, particleSize * Capacity, nullptr, GL_DYNAMIC_COPY);
+	}
+	glGenBuffers(1, &stateBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(State), nullptr, GL_DYNAMIC_COPY);
+	glGenBuffers(1, &burstBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, burstBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ParticleBurst) * PaintParticles::MaxBursts, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenVertexArrays(1, &vao); //the quads are made from gl_VertexID, but something has to be bound
+	ResetState();
+}
+
+GPUParticles::~GPUParticles() {
+	delete computeShader;
+	delete drawShader;
+	glDeleteBuffers(2, particleBuffers);
+	glDeleteBuffers(1, &stateBuffer);
+	glDeleteBuffers(1, &burstBuffer);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void GPUParticles::ResetState() {
+	State s = {};
+	s.dispatch[1]	= 1;
+	s.dispatch[2]	= 1;
+	s.drawCount		= 4;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(State), &s);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/*
+Each burst is told where its particles start in the frame's run of new
+ones, so an emitting thread can find which burst it's from. The update
+is dispatched from the counts the last frame's finish wrote, so it's
+never more groups than there are particles to move.
+*/
+void GPUParticles::Simulate(const std::vector<ParticleBurst>& bursts, float dt, bool clear) {
+	if (!computeShader) {
+		return;
+	}
+	if (clear) {
+		ResetState();
+	}
+	uploads.clear();
+	int emitCount = 0;
+	for (const ParticleBurst& b : bursts) {
+		int count = (int)b.motion.w;
+		if (emitCount + count > MaxEmitted) {
+			break;
+		}
+		ParticleBurst u	= b;
+		u.position.w	= (float)emitCount;
+		uploads.emplace_back(u);
+		emitCount += count;
+	}
+	if (!uploads.empty()) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, burstBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleBurst) * uploads.size(), uploads.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	computeShader->Bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SourceBinding, particleBuffers[source]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StateBinding, stateBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DestBinding, particleBuffers[1 - source]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BurstBinding, burstBuffer);
+	glUniform1f(uniforms[1], dt);
+	glUniform1i(uniforms[2], source);
+	glUniform1i(uniforms[3], emitCount);
+	glUniform1i(uniforms[4], (int)uploads.size());
+	glUniform1ui(uniforms[5], (GLuint)seed++);
+
+	glUniform1i(uniforms[0], UpdateStage);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, stateBuffer);
+	glDispatchComputeIndirect(offsetof(State, dispatch));
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (emitCount > 0) {
+		int threads = computeShader->GetThreadXCount();
+		glUniform1i(uniforms[0], EmitStage);
+		computeShader->Execute((emitCount + threads - 1) / threads);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	glUniform1i(uniforms[0], FinishStage);
+	computeShader->Execute(1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	computeShader->Unbind();
+
+	source = 1 - source;
+}
+
+//Paint's mostly opaque, so they aren't sorted, and only test against the depth buffer
+void GPUParticles::Draw() const {
+	if (!computeShader) {
+		return;
+	}
+	glUseProgram(drawShader->GetProgramID());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SourceBinding, particleBuffers[source]);
+	glBindVertexArray(vao);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); //blending's already on for the camera pass
+	glDepthMask(GL_FALSE);
+	glDisable(GL_CULL_FACE);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stateBuffer);
+	glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)offsetof(State, drawCount));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glEnable(GL_CULL_FACE);
+	glDepthMask(GL_TRUE);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLShader.h"
+#include "../../Plugins/OpenGLRendering/OGLComputeShader.h"
+#include "PaintParticles.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Rendering;
+
+		/*
+		Particles that only ever exist on the GPU. There are two buffers of
+		them, and each frame a compute shader moves everything in one and
+		copies whatever's still alive into the other, so the live ones stay
+		packed together at the start, then adds the frame's new bursts on
+		the end. A last single thread writes how many there are into the
+		commands that run the next frame's update and draw them, so the CPU
+		never reads the count back. They're drawn as camera facing quads made
+		in the vertex shader, one instance per particle, from an empty VAO.
+		*/
+		class GPUParticles {
+		public:
+			GPUParticles();
+			~GPUParticles();
+
+			//Needs GL 4.3, for compute shaders and indirect dispatches
+			bool IsSupported() const {
+				return computeShader != nullptr;
+			}
+
+			void Simulate(const std::vector<ParticleBurst>& bursts, float dt, bool clear);
+			//Needs the FrameData block to be up to date
+			void Draw() const;
+
+			static const int Capacity		= 65536; //has to match the shader's
+			static const int MaxEmitted		= 8192;	 //in a frame, with any more left out
+
+			//Storage buffer bindings, past the indirect batch's
+			static const int SourceBinding	= 11;
+			static const int StateBinding	= 12;
+			static const int DestBinding	= 13;
+			static const int BurstBinding	= 14;
+
+		protected:
+			enum Stage {
+				UpdateStage,
+				EmitStage,
+				FinishStage
+			};
+
+			//Laid out to match the shader's std430 State block
+			struct State {
+				GLuint counts[2];		//how many are alive in each buffer
+				GLuint dispatch[3];		//the next update's groups
+				GLuint drawCount;		//the rest are a glDrawArraysIndirect command
+				GLuint drawInstances;
+				GLuint drawFirst;
+				GLuint drawBaseInstance;
+			};
+
+			void ResetState();
+
+			OGLComputeShader*	computeShader	= nullptr;
+			OGLShader*			drawShader		= nullptr;
+			int					uniforms[6]		= {}; //stage, dt, source, emitCount, burstCount, seed
+
+			GLuint	particleBuffers[2]	= {};
+			GLuint	stateBuffer			= 0;
+			GLuint	burstBuffer			= 0;
+			GLuint	vao					= 0;
+			int		source				= 0; //which buffer the live particles are in
+			int		seed				= 0;
+
+			std::vector<ParticleBurst> uploads;
+		};
+	}
+}
@@ -0,0 +1,102 @@
+#include "GPUTimer.h"
+#include "../CSC8503Common/FrameProfiler.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+GPUTimer::GPUTimer() {
+	if (!glQueryCounter || !glGetQueryObjectui64v) {
+		return;
+	}
+	supported = true;
+	for (FrameQueries& f : frames) {
+		for (Pass& p : f.passes) {
+			glGenQueries(2, p.queries);
+		}
+	}
+}
+
+GPUTimer::~GPUTimer() {
+	if (!supported) {
+		return;
+	}
+	for (FrameQueries& f : frames) {
+		for (Pass& p : f.passes) {
+			glDeleteQueries(2, p.queries);
+		}
+	}
+}
+
+/*
+The oldest frames are collected first, as the GPU finishes them in order,
+so once one isn't ready, none of the newer ones will be either.
+*/
+void GPUTimer::BeginFrame(int frame) {
+	if (!supported) {
+		return;
+	}
+	if (open) {
+		End();
+	}
+	for (int i = 1; i <= FramesInFlight; ++i) {
+		int slot = (current + i) % FramesInFlight;
+		if (frames[slot].frame < 0) {
+			continue;
+		}
+		FrameQueries& f = frames[slot];
+		if (f.passCount == 0) {
+			f.frame = -1;
+			continue;
+		}
+		GLint ready = 0;
+		glGetQueryObjectiv(f.passes[f.passCount - 1].queries[1], GL_QUERY_RESULT_AVAILABLE, &ready);
+		if (!ready) {
+			break;
+		}
+		Collect(slot);
+	}
+	current = (current + 1) % FramesInFlight;
+	frames[current].frame		= frame; //whatever was still here is too late now
+	frames[current].passCount	= 0;
+}
+
+void GPUTimer::Collect(int slot) {
+	FrameQueries& f = frames[slot];
+	GLuint64 first	= 0;
+	GLuint64 end	= 0;
+	glGetQueryObjectui64v(f.passes[0].queries[0], GL_QUERY_RESULT, &first);
+	for (int i = 0; i < f.passCount; ++i) {
+		GLuint64 start	= 0;
+		glGetQueryObjectui64v(f.passes[i].queries[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(f.passes[i].queries[1], GL_QUERY_RESULT, &end);
+		FrameProfiler::RecordGPU(f.frame, f.passes[i].name,
+			(float)(start - first) / 1000000.0f, (float)(end - start) / 1000000.0f);
+	}
+	lastFrameTime	= (float)(end - first) / 1000000.0f;
+	lastFrame		= f.frame;
+	f.frame = -1;
+}
+
+void GPUTimer::Begin(const char* name) {
+	FrameQueries& f = frames[current];
+	if (!supported || f.frame < 0 || f.passCount == MaxPasses) {
+		return;
+	}
+	if (open) {
+		End();
+	}
+	Pass& p = f.passes[f.passCount];
+	p.name	= name;
+	glQueryCounter(p.queries[0], GL_TIMESTAMP);
+	open	= true;
+}
+
+void GPUTimer::End() {
+	if (!open) {
+		return;
+	}
+	FrameQueries& f = frames[current];
+	glQueryCounter(f.passes[f.passCount].queries[1], GL_TIMESTAMP);
+	f.passCount++;
+	open = false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLRenderer.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Times each of the renderer's passes on the GPU, with a timestamp query
+		either side of it. The results are only collected once the GPU says
+		they're ready, a few frames later, so reading them never stalls, and
+		they're handed to the FrameProfiler with the frame they were for. A
+		frame whose results still aren't in by the time its queries are
+		needed again is dropped.
+
+		Passes are timed one after another, not nested.
+		*/
+		class GPUTimer {
+		public:
+			GPUTimer();
+			~GPUTimer();
+
+			//Needs GL 3.3, for timestamp queries
+			bool IsSupported() const {
+				return supported;
+			}
+
+			//Collects whatever's finished, and starts a new set of queries for this frame
+			void BeginFrame(int frame);
+
+			void Begin(const char* name);
+			void End();
+
+			//From the start of the first pass to the end of the last, for the
+			//newest frame collected so far
+			float GetLastFrameTime() const {
+				return lastFrameTime;
+			}
+			//Which frame that was, or -1 if none have been collected yet
+			int GetLastFrameNumber() const {
+				return lastFrame;
+			}
+
+			static const int FramesInFlight	= 4;
+			static const int MaxPasses		= 16;
+
+		protected:
+			void Collect(int slot);
+
+			struct Pass {
+				const char*	name;
+				GLuint		queries[2];	//start, end
+			};
+
+			struct FrameQueries {
+				int		frame		= -1;	//-1 once it's been collected
+				int		passCount	= 0;
+				Pass	passes[MaxPasses];
+			};
+
+			FrameQueries	frames[FramesInFlight];
+			int				current		= 0;
+			bool			open		= false;
+			float			lastFrameTime	= 0.0f;
+			int				lastFrame		= -1;
+			bool			supported	= false;
+		};
+	}
+}
@@ -1,11 +1,16 @@
 #include "Game.h"
 #include "../CSC8503Common/GameWorld.h"
+#include "LevelStreamer.h"
+#include "TextureStreamer.h"
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
 #include "../../Plugins/OpenGLRendering/OGLTexture.h"
 #include "../../Common/TextureLoader.h"
 #include "../../Common/Assets.h"
-#include "../GameTech/ColliderLineObj.h"
+#include "../CSC8503Common/JobSystem.h"
+#include "../CSC8503Common/PathQueryService.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
 
 #include "../../Common/Quaternion.h"
 #include <typeinfo>
@@ -13,33 +18,76 @@
 using namespace NCL;
 using namespace CSC8503;
 
-Game::Game() {
+Game::Game(bool headless) : headless(headless) {
 	world = new GameWorld();
-	renderer = new GameTechRenderer(*world);
+	renderer = headless ? nullptr : new GameTechRenderer(*world);
 	physics = new PhysicsSystem(*world);
+	perception = new PerceptionSystem(*world);
+	soundOcclusion = new SoundOcclusion(*world);
 	levelManager = new LevelManager(this, *world);	
+	if (renderer) {
+		renderer->SetPaintDecals(&levelManager->GetPaintDecals());
+		renderer->SetPaintParticles(&levelManager->GetPaintParticles());
+		renderer->SetDynamicLights(&levelManager->GetDynamicLights());
+		renderer->SetTargetFrameTime(15.0f); //a little under 60fps, leaving room for the swap
+	}
 
 	useGravity = true;
 	online = false;
+	gameUI = nullptr;
+
+	//It's the same level every match, so its grid - and every flow field found
+	//over it - is kept from one to the next, rather than made again each time
+	{
+		MemoryTagScope tag(MemoryTag::AI);
+		mapGrid = new NavigationGrid("LevelLayout.txt");
+	}
 
+	world->AddCollisionIgnore(CollisionLayer::RAY, CollisionLayer::IGNORE_RAYCAST);
+	world->AddCollisionIgnore(CollisionLayer::IGNORE_DEFAULT, CollisionLayer::DEFAULT);
+	//What the AI looks for the nearest of
+	world->GetSpatialGrid().TrackType(ObjectType::RefillPoint);
+	world->GetSpatialGrid().TrackType(ObjectType::Agent);
+	world->GetSpatialGrid().TrackType(ObjectType::Player);
+	world->GetSpatialGrid().TrackType(ObjectType::Opponent);
+
+	if (headless) {
+		activeState = State::MAIN_MENU; //there's nothing to load
+		return;
+	}
+	//Not for headless games, as the one Debug is shared by the whole process, and a
+	//MatchHost's matches would all be writing their counters to it at once
 	Debug::Initialise();
 	Debug::SetRenderer(renderer);
 
 	InitUI();
-
-	world->AddCollisionIgnore(CollisionLayer::RAY, CollisionLayer::IGNORE_RAYCAST);
-	world->AddCollisionIgnore(CollisionLayer::IGNORE_DEFAULT, CollisionLayer::DEFAULT);
+	BuildFrameGraphs();
 
 	levelManager->InitialiseAssets();
+	renderer->SetTextureStreamer(levelManager->GetTextureStreamer());
 	ChangeState(State::LOADING);
 }
 
 Game::~Game() {
-	Debug::Destroy();
+	if (!headless) {
+		Debug::Destroy();
+	}
 	delete physics;
 	delete renderer;
+	delete levelManager; //it's listening to the world, so has to go first
 	delete world;
-	delete levelManager;
+	delete mapGrid; //after the world, as opponents let go of their paths as they're deleted
+	delete perception;
+	if (SoundSystem::GetSoundSystem()) {
+		SoundSystem::GetSoundSystem()->SetOcclusion(nullptr);
+	}
+	delete soundOcclusion;
+}
+
+void Game::SetTextureBudget(size_t bytes) {
+	if (TextureStreamer* streamer = levelManager->GetTextureStreamer()) {
+		streamer->SetBudget(bytes);
+	}
 }
 
 void Game::UpdateGame(float dt) {
@@ -67,22 +115,105 @@ void Game::UpdateGame(float dt) {
 	}
 
 	if (!levelManager->IsLoadingAssets()) {
-		world->UpdateWorld(dt);
-
-		SoundSystem::GetSoundSystem()->Update(dt);
-		audioListener->GetTransform().SetPosition(world->GetMainCamera()->GetPosition());
-
-		renderer->Update(dt);
+		levelManager->UpdateAssets(); //anything asked for since, like the level's assets while the menu's up
+		frameDT = dt;
+		frameGraph.Run();
+	}
+}
 
-		Debug::GetInstance()->UpdateInfo(dt);
+/*
+Once the world's been updated, the AI, the effects and the sound only
+read it (and write their own state), so they go off to the workers
+together, while the main thread gets on with the UI once the sound's
+been sent off. Debug lines from
+the AI have to be in before they're flushed, and everything has to be
+done before the frame's extracted - which, while playing, is drawn
+alongside the next frame's physics.
+*/
+void Game::BuildFrameGraphs() {
+	int worldTask = frameGraph.AddTask("World", [this]() {
+		UpdateLevelStreaming();
+		if (rebuildStaticTree && world->GetStaticTree()) {
+			world->BuildStaticTree(); //not to the cache, which is the level file's settings
+			world->GetStaticTree()->ResetQueryStats();
+		}
+		rebuildStaticTree = false;
+		world->UpdateWorld(frameDT);
+	}, TaskGraph::Affinity::MainThread);
+
+	int aiTask = frameGraph.AddTask("AI", [this]() {
+		MemoryTagScope tag(MemoryTag::AI);
+		if (mapGrid) {
+			mapGrid->GetQueries().Update(); //starts the paths asked for by the AI
+			mapGrid->UpdateFlowFields();
+		}
+		perception->Update(frameDT);
+	});
 
-		gameUI->UpdateUI(dt);
+	int effectsTask = frameGraph.AddTask("Effects", [this]() {
+		levelManager->GetPaintDecals().Update(frameDT);
+		levelManager->GetPaintParticles().Update(frameDT);
+		levelManager->GetDynamicLights().Update(frameDT);
+	});
 
-		Debug::FlushRenderables(dt);
+	int soundTask = frameGraph.AddTask("Sound", [this]() {
+		SoundSystem::GetSoundSystem()->Update(frameDT);
+		audioListener->GetTransform().SetPosition(world->GetMainCamera()->GetPosition());
+	});
+
+	int uiTask = frameGraph.AddTask("UI", [this]() {
+		renderer->Update(frameDT);
+		Debug::GetInstance()->UpdateInfo(frameDT);
+		gameUI->UpdateUI(frameDT);
+	}, TaskGraph::Affinity::MainThread);
+
+	int presentTask = frameGraph.AddTask("Present", [this]() {
+		Debug::FlushRenderables(frameDT);
+		renderer->SetInterpolationAlpha(physics->GetInterpolationAlpha());
+		if (renderer->HasPendingFrame()) {
+			renderer->Render(currentFrame);
+		}
+		renderer->ExtractFrame(currentFrame);
+		//While playing, this is drawn alongside the next frame's physics
+		if (activeState != State::PLAYING) {
+			renderer->Render(currentFrame);
+		}
+		world->Prune();
+	}, TaskGraph::Affinity::MainThread);
+
+	frameGraph.AddDependency(aiTask, worldTask);
+	frameGraph.AddDependency(effectsTask, worldTask);
+	frameGraph.AddDependency(soundTask, worldTask);
+	frameGraph.AddDependency(uiTask, worldTask);
+	frameGraph.AddDependency(uiTask, soundTask); //the menus play sounds of their own
+	frameGraph.AddDependency(presentTask, aiTask);
+	frameGraph.AddDependency(presentTask, effectsTask);
+	frameGraph.AddDependency(presentTask, soundTask);
+	frameGraph.AddDependency(presentTask, uiTask);
+
+	//Last frame's packet doesn't point into the world, so it can be drawn while physics moves on
+	simulationGraph.AddTask("Physics", [this]() {
+		physics->Update(frameDT);
+	});
+	simulationGraph.AddTask("Draw last frame", [this]() {
 		renderer->Render(currentFrame);
+	}, TaskGraph::Affinity::MainThread);
+}
 
-		world->Prune();
+void Game::UpdateLevelStreaming() {
+	if (activeState == State::MAIN_MENU || activeState == State::LOADING || !levelManager->GetStreamer().IsActive()) {
+		return; //no level to be streamed around
 	}
+	streamingCentres.clear();
+	GatherStreamingCentres(streamingCentres);
+	levelManager->UpdateStreaming(streamingCentres);
+}
+
+void Game::GatherStreamingCentres(vector<Vector3>& around) {
+	for (Agent* a : agents) {
+		around.emplace_back(a->GetTransform().GetPosition());
+	}
+	around.emplace_back(world->GetMainCamera()->GetPosition());
 }
 
 void NCL::CSC8503::Game::ChangeState(State newState) {
@@ -91,6 +222,11 @@ void NCL::CSC8503::Game::ChangeState(State newState) {
 
 	if (newState == State::MAIN_MENU) {
 		world->ClearAndErase();
+		perception->Clear(); //nothing it knows about is there any more
+		soundOcclusion->Clear();
+		levelManager->GetPaintDecals().Clear();
+		levelManager->GetPaintParticles().Clear();
+		levelManager->GetDynamicLights().Clear();
 		physics->Clear();
 		world->GetMainCamera()->SetYaw(105.0f);
 		world->GetMainCamera()->SetPitch(5.0f);
@@ -137,7 +273,13 @@ void NCL::CSC8503::Game::UpdatePlayingState(float dt) {
 	if (Debug::IsActive() && Window::GetMouse()->ButtonPressed(NCL::MouseButtons::LEFT)) {
 		Debug::SetSelectedObject(SelectDebugObject());
 	}
-	physics->Update(dt);
+	if (renderer->HasPendingFrame()) {
+		frameDT = dt;
+		simulationGraph.Run();
+	}
+	else {
+		physics->Update(dt);
+	}
 
 	if (!player || !player->GetCameraAttached() || Debug::GetFreeCam()) {
 		world->GetMainCamera()->UpdateCamera(dt);
@@ -150,6 +292,9 @@ void NCL::CSC8503::Game::UpdatePlayingState(float dt) {
 		currentFrame = (currentFrame + 1) % levelManager->GetAnimation("StepForward")->GetFrameCount();
 		frameTime += 1.0f / levelManager->GetAnimation("StepForward")->GetFrameRate();
 	}
+	if (renderer) {
+		renderer->SetAnimationBlend(1.0f - frameTime * levelManager->GetAnimation("StepForward")->GetFrameRate());
+	}
 
 	if (gameTimer <= 0) {
 		gameOver = true;
@@ -168,7 +313,13 @@ void NCL::CSC8503::Game::UpdatePausedState(float dt) {
 }
 
 void NCL::CSC8503::Game::UpdateLoadingState(float dt) {
-	int percentComplete = levelManager->LoadNextAsset();
+	int percentComplete = levelManager->LoadAssets();
+	if (!levelManager->IsLoadingAssets()) {
+		renderer->SetInstancedShader(levelManager->GetShader("default"), levelManager->GetShader("defaultInstanced"), levelManager->GetShader("defaultInstancedArray"));
+		renderer->SetPreSkinnedShader(levelManager->GetShader("guard"), levelManager->GetShader("default"));
+		renderer->SetIndirectShader(levelManager->GetShader("default"), levelManager->GetShader("defaultIndirect"));
+		renderer->SetIndirectShader(levelManager->GetShader("box"), levelManager->GetShader("boxIndirect"));
+	}
 	//renderer->DrawString(to_string(percentComplete) + "% Complete", Vector2(50, 50), Debug::CYAN, 30);
 	renderer->Update(dt);
 	gameUI->SetAmountLoaded(percentComplete);
@@ -238,17 +389,12 @@ void NCL::CSC8503::Game::InitUI() {
 }
 
 int NCL::CSC8503::Game::GetBlocksRemaining(int agentID) {
-	vector<ColourBlock*> wall = colourWallMap[agentID];
-	int blocksRemaining = 0;
-	for (ColourBlock* block : wall) {
-		if (!block->IsColoured()) {
-			blocksRemaining++;
-		}
-	}
-	return blocksRemaining;
+	const vector<ColourBlock*>& wall = colourWallMap[agentID];
+	return (wall.empty() || !wall[0]->GetWall()) ? 0 : wall[0]->GetWall()->Remaining();
 }
 
 void NCL::CSC8503::Game::DetermineWinners() {
+	winners.clear(); //a draw at nothing would otherwise add to the last match's
 	int bestScore = 0;
 	for (Agent* o : agents) {
 		int numBlocksColoured = o->GetNumBlocksColoured();
@@ -273,12 +419,18 @@ void Game::InitCamera() {
 
 void NCL::CSC8503::Game::InitListener() {
 	audioListener = new GameObject("Listener");
-	SoundSystem::GetSoundSystem()->SetListener(audioListener);
+	if (SoundSystem::GetSoundSystem()) {
+		SoundSystem::GetSoundSystem()->SetListener(audioListener);
+		SoundSystem::GetSoundSystem()->SetOcclusion(soundOcclusion);
+	}
 	world->AddGameObject(audioListener);
 }
 
 void Game::InitWorld() {
+	levelManager->FinishLevelAssets();
 	world->ClearAndErase();
+	perception->Clear(); //nothing it knows about is there any more
+	soundOcclusion->Clear();
 	physics->Clear();
 
 	InitListener();
@@ -286,7 +438,7 @@ void Game::InitWorld() {
 	vector<ColourBlock*> colourWalls[4];
 
 	levelManager->LoadEnvironment("LevelData.txt", colourWalls);
-	mapGrid = new NavigationGrid("LevelLayout.txt");
+	refillPoints.clear(); //the last match's went with its world
 	refillPoints.push_back(levelManager->AddRefillPoint(levelManager->GetEnvironmentCentre() - Vector3(0, 2, 0), 2.5f));
 	refillPoints.push_back(levelManager->AddRefillPoint(levelManager->GetEnvironmentCentre() + Vector3(50, -2, 0), 2.5f));
 	refillPoints.push_back(levelManager->AddRefillPoint(levelManager->GetEnvironmentCentre() + Vector3(0, -2, 50), 2.5f));
@@ -330,15 +482,14 @@ void Game::InitWorld() {
 	gameUI->SetPlayer(2, agents[2]);
 	gameUI->SetPlayer(3, agents[3]);
 
-	//for debug mode
-	AddCollisionLines();
-
-	world->BuildStaticTree();
+	world->LoadStaticTreeSettings(Assets::DATADIR + "LevelData.tree");
+	world->BuildStaticTree(Assets::DATADIR + "LevelData.octree");
 }
 
 GameObject* NCL::CSC8503::Game::SelectDebugObject() {
 	GameObject* selectedObject = nullptr;
-	Ray ray = CollisionDetection::BuildRayFromMouse(*world->GetMainCamera());
+	Ray ray = renderer ? CollisionDetection::BuildRayFromMouse(renderer->GetViewData()) :
+		CollisionDetection::BuildRayFromMouse(*world->GetMainCamera());
 
 	RayCollision closestCollision;
 	if (world->Raycast(ray, closestCollision, true)) {
@@ -363,14 +514,17 @@ Player* NCL::CSC8503::Game::AddPlayerToWorld(int agentID, const Vector3& positio
 		.SetPosition(position);
 
 	player->SetRenderObject(new RenderObject(&player->GetTransform(), levelManager->GetMesh("Male_Guard"), levelManager->GetDefaultTexture(), levelManager->GetShader("guard")));
-	player->GetRenderObject()->SetFlag(1);
+	player->GetRenderObject()->SetFeatures(RenderObject::Skinned | RenderObject::TexturePerSubMesh);
 	player->GetRenderObject()->SetTextures(levelManager->GuardTextures);
 	player->GetRenderObject()->SetAnimation(levelManager->GetAnimation("StepForward"));
 
 	player->SetPhysicsObject(new PhysicsObject(&player->GetTransform(), player->GetBoundingVolume()));
 	player->GetPhysicsObject()->SetInverseMass(inverseMass);
 	player->GetPhysicsObject()->InitCubeInertia();
+	player->GetPhysicsObject()->SetRotationLocks(true, true, true); //turned by its input, not by collisions
+	player->GetPhysicsObject()->SetKinematic(true);
 	player->GetPhysicsObject()->SetElasticity(0.1f);
+	player->GetPhysicsObject()->SetCanSleep(false);
 
 	GameObject* gun = new GameObject();
 	gun->GetTransform()
@@ -392,7 +546,7 @@ Opponent* NCL::CSC8503::Game::AddOpponentToWorld(int agentID, const Vector3& pos
 	float radius = 1;
 	float inverseMass = 5;
 
-	Opponent* opponent = new Opponent(agentID, world, mapGrid, levelManager, wall, position, refillPoints);
+	Opponent* opponent = new Opponent(agentID, world, mapGrid, perception, levelManager, wall, position, refillPoints);
 
 	CapsuleVolume* volume = new CapsuleVolume(halfHeight, radius, Vector3(0, 2, 0));
 	opponent->SetBoundingVolume((CollisionVolume*)volume);
@@ -401,14 +555,17 @@ Opponent* NCL::CSC8503::Game::AddOpponentToWorld(int agentID, const Vector3& pos
 		.SetScale(Vector3(radius * -2, halfHeight, radius * 2));
 
 	opponent->SetRenderObject(new RenderObject(&opponent->GetTransform(), levelManager->GetMesh("Male_Guard"), levelManager->GetDefaultTexture(), levelManager->GetShader("guard")));
-	opponent->GetRenderObject()->SetFlag(1);
+	opponent->GetRenderObject()->SetFeatures(RenderObject::Skinned | RenderObject::TexturePerSubMesh);
 	opponent->GetRenderObject()->SetTextures(levelManager->GuardTextures);
 	opponent->GetRenderObject()->SetAnimation(levelManager->GetAnimation("StepForward"));
 	
 	opponent->SetPhysicsObject(new PhysicsObject(&opponent->GetTransform(), opponent->GetBoundingVolume()));
 	opponent->GetPhysicsObject()->SetInverseMass(inverseMass);
 	opponent->GetPhysicsObject()->InitCubeInertia();
+	opponent->GetPhysicsObject()->SetRotationLocks(true, true, true); //turned by its AI, not by collisions
+	opponent->GetPhysicsObject()->SetKinematic(true);
 	opponent->GetPhysicsObject()->SetElasticity(0.1f);
+	opponent->GetPhysicsObject()->SetCanSleep(false);
 
 	GameObject* gun = new GameObject();
 	gun->GetTransform()
@@ -423,15 +580,3 @@ Opponent* NCL::CSC8503::Game::AddOpponentToWorld(int agentID, const Vector3& pos
 
 	return opponent;
 }
-
-void NCL::CSC8503::Game::AddCollisionLines() {
-	for (auto obj : world->GetGameObjects()) {
-		if (obj->GetBoundingVolume()) {
-			ColliderLine* collisionLineObj = new ColliderLine(obj, levelManager);
-			collisionLineObj->GetRenderObject()->SetFlag(4);
-			collisionLineObj->GetRenderObject()->SetColour(Vector4(0, 1, 0, 1));
-			collisionLineObj->SetName(obj->GetName() + " collider");
-			world->AddGameObject(collisionLineObj);
-		}
-	}
-}
\ No newline at end of file
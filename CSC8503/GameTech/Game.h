@@ -9,6 +9,9 @@
 #include "../CSC8503Common/PhysicsSystem.h"
 #include "../CSC8503Common/SoundSystem.h"
 #include "../CSC8503Common/NavigationGrid.h"
+#include "../CSC8503Common/PerceptionSystem.h"
+#include "../CSC8503Common/SoundOcclusion.h"
+#include "../CSC8503Common/TaskGraph.h"
 #include "GameUI.h"
 
 #include <map>
@@ -17,7 +20,9 @@ namespace NCL {
 	namespace CSC8503 {
 		class Game {
 		public:
-			Game();
+			//A headless game has no renderer, UI or assets, for running a
+			//dedicated server without a window
+			Game(bool headless = false);
 			~Game();
 
 			enum class State {
@@ -34,6 +39,9 @@ namespace NCL {
 
 			bool IsPlaying() const { return isPlaying; }
 
+			//For the streamed textures' mips, which is all that's ever let go of
+			void SetTextureBudget(size_t bytes);
+
 		protected:
 			State activeState;
 			State nextState;
@@ -58,12 +66,29 @@ namespace NCL {
 
 			GameObject* SelectDebugObject();
 
+			/*
+			What's left of a frame once the state's had its update, and the
+			physics step alongside the last frame's draw, as tasks that run on
+			the job system wherever they don't depend on each other. Both read
+			the frame's dt from frameDT.
+			*/
+			void BuildFrameGraphs();
+			TaskGraph frameGraph;
+			TaskGraph simulationGraph;
+			float frameDT = 0.0f;
+
+			//Big levels are only kept in around these, which are wherever
+			//the agents and the camera are, unless overridden
+			void UpdateLevelStreaming();
+			virtual void GatherStreamingCentres(vector<Vector3>& around);
+			vector<Vector3> streamingCentres;
+
 			virtual Player* AddPlayerToWorld(int agentID, const Vector3& position, vector<ColourBlock*>& wall);
 			Opponent* AddOpponentToWorld(int agentID, const Vector3& position, vector<RefillPoint*> refillPoints, vector<ColourBlock*>& wall);
 
-			void AddCollisionLines();
-
 			NavigationGrid* mapGrid;
+			PerceptionSystem* perception;
+			SoundOcclusion* soundOcclusion;
 
 			GameTechRenderer* renderer;
 			PhysicsSystem* physics;
@@ -88,12 +113,17 @@ namespace NCL {
 			float frameTime;
 
 			bool online;
+			bool headless;
 
 			GameUI* gameUI;
 			friend class GameUI;
 
 			bool isPlaying = true;
 
+			//Asked for by the UI, which runs while the AI and the sound are
+			//querying the tree, so it's only done by the next frame's World task
+			bool rebuildStaticTree = false;
+
 		};
 	}
 }
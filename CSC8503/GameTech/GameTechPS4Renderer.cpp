@@ -0,0 +1,353 @@
+#ifdef _ORBIS
+#include "GameTechPS4Renderer.h"
+#include "PaintDecals.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/Frustum.h"
+#include "../CSC8503Common/CollisionVolume.h"
+#include "../../Common/Camera.h"
+#include "../../Common/Maths.h"
+#include "../../Common/MeshAnimation.h"
+#include "../../Plugins/PlayStation4/PS4Texture.h"
+#include "../../Plugins/PlayStation4/PS4Window.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace CSC8503;
+using namespace PS4;
+
+GameTechPS4Renderer::GameTechPS4Renderer(GameWorld& world) : PS4RendererBase((PS4Window*)Window::GetWindow()), gameWorld(world) {
+	lightColour		= Vector4(0.8f, 0.8f, 0.5f, 1.0f);
+	lightRadius		= 1000.0f;
+	lightPosition	= Vector3(-200.0f, 60.0f, -200.0f);
+
+	objectShader = PS4Shader::GenerateShader(
+		"/app0/Assets/Shaders/PS4/GameTechVertex.sb",
+		"/app0/Assets/Shaders/PS4/GameTechPixel.sb"
+	);
+
+	skinningShader = new PS4ComputeShader("/app0/Assets/Shaders/PS4/SkinningCompute.sb");
+	if (!skinningShader->LoadSuccess()) {
+		delete skinningShader;
+		skinningShader = nullptr;
+	}
+}
+
+//The shaders and skinned vertices are in the stack allocators, which go with the base
+GameTechPS4Renderer::~GameTechPS4Renderer() {
+	delete objectShader;
+	delete skinningShader;
+}
+
+void GameTechPS4Renderer::ExtractFrame(int curFrame) {
+	packet.Clear();
+
+	float screenAspect		= (float)currentWidth / (float)currentHeight;
+	Camera* camera			= gameWorld.GetMainCamera();
+	packet.curFrame			= curFrame;
+	packet.view.Build(*camera, screenAspect);
+	packet.lodScale			= packet.view.projMatrix.array[5];
+
+	BuildObjectList();
+	for (const RenderObject* o : activeObjects) {
+		FrameObject f;
+		f.modelMatrix	= o->GetTransform()->GetInterpolatedMatrix(interpolationAlpha);
+		f.colour		= o->GetColourAt((float)gameWorld.GetWorldTime());
+		f.mesh			= o->GetMesh();
+		f.shader		= o->GetShader();
+		f.texture		= o->GetDefaultTexture();
+		f.animation		= o->GetAnimation();
+		f.features		= o->GetFeatures();
+		f.shaderFeatures	= 0; //the one shader does everything
+		f.textureLayer	= o->GetTextureLayer();
+		f.firstTexture	= 0;
+		f.textureCount	= 0;
+		f.castsShadow	= o->RenderShadow();
+		f.layerPerSubMesh = false;
+		f.fadeDuration	= 0.0f;
+		packet.cameraObjects.emplace_back(f);
+	}
+	SortObjectList();
+	BuildSkinningPalettes(curFrame);
+	packetPending = true;
+}
+
+//Everything the camera can see, and whichever paint decals are in view
+void GameTechPS4Renderer::BuildObjectList() {
+	activeObjects.clear();
+	const Frustum& cameraFrustum = packet.view.frustum;
+
+	if (paintDecals) {
+		paintDecals->GetVisible(cameraFrustum, activeObjects);
+	}
+
+	gameWorld.OperateOnContents(
+		[&](GameObject* o) {
+			const RenderObject* g = o->GetRenderObject();
+			if (!o->IsActive() || !g || !g->GetMesh()) {
+				return;
+			}
+			Vector3 halfSize;
+			if (!o->GetBroadphaseAABB(halfSize)) {
+				activeObjects.emplace_back(g);
+				return;
+			}
+			Vector3 position = o->GetTransform().GetPosition() + o->GetBoundingVolume()->GetOffset();
+			if (cameraFrustum.AABBInside(position, halfSize)) {
+				activeObjects.emplace_back(g);
+			}
+		}
+	);
+}
+
+/*
+The same order as the other renderers: opaque before transparent, then by
+texture and mesh, which is also what puts each run of instances together,
+then front to back, or back to front for transparent objects.
+*/
+void GameTechPS4Renderer::SortObjectList() {
+	std::vector<DrawItem>& drawItems = packet.drawItems;
+	drawItems.clear();
+
+	float farPlane = packet.view.farPlane;
+	const uint64_t maxDepth = (1ull << 24) - 1;
+
+	for (const FrameObject& o : packet.cameraObjects) {
+		bool transparent	= o.colour.w < 1.0f;
+		float distance		= (o.modelMatrix.GetPositionVector() - packet.view.position).Length() / farPlane;
+		uint64_t depth		= (uint64_t)((distance < 0.0f ? 0.0f : (distance > 1.0f ? 1.0f : distance)) * (float)maxDepth);
+		if (transparent) {
+			depth = maxDepth - depth;
+		}
+		uint64_t key = (uint64_t)(transparent ? 1 : 0) << 63;
+		key |= ((uint64_t)(uintptr_t)o.texture & 0x7FFF)	<< 39;
+		key |= ((uint64_t)(uintptr_t)o.mesh & 0x7FFF)		<< 24;
+		key |= depth;
+		drawItems.push_back({ key, &o });
+	}
+	std::sort(drawItems.begin(), drawItems.end(),
+		[](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+}
+
+//One pose for each mesh and animation pair that's being drawn, sampled the same way as on GL
+void GameTechPS4Renderer::BuildSkinningPalettes(int curFrame) {
+	std::vector<Matrix4>& jointPalette = packet.jointPalette;
+	for (const DrawItem& item : packet.drawItems) {
+		const FrameObject& o = *item.object;
+		const MeshAnimation* anim = o.animation;
+		if (!(o.features & RenderObject::Skinned) || !anim || anim->GetFrameCount() == 0) {
+			continue;
+		}
+		auto inserted = packet.paletteOffsets.insert({ { o.mesh, anim }, PaletteEntry() });
+		if (!inserted.second) {
+			continue;
+		}
+		const std::vector<Matrix4>& invBindPose = o.mesh->GetInverseBindPose();
+		unsigned int jointCount = o.mesh->GetJointCount();
+		jointCount = jointCount < anim->GetJointCount() ? jointCount : anim->GetJointCount();
+
+		sampledPose.resize(anim->GetJointCount());
+		anim->SamplePose((float)(curFrame % anim->GetFrameCount()) + animationBlend, sampledPose.data());
+
+		PaletteEntry& p = inserted.first->second;
+		p.offset	= (int)jointPalette.size();
+		p.count		= (int)jointCount;
+		jointPalette.resize(jointPalette.size() + jointCount);
+		Maths::MatrixArrayMultiply(sampledPose.data(), invBindPose.data(), jointPalette.data() + p.offset, jointCount);
+	}
+}
+
+/*
+Each pair's skinned into the next of its copies, so the one a frame still
+in flight is drawing from isn't written over - by the time a copy comes
+round again, the base has waited for the frame that last read it. The
+palette's only needed this frame, so it goes in the frame's memory. The
+stack allocators can't free anything, but a mesh's vertex count never
+changes once it's up, so each pair's copies are only allocated once.
+*/
+void GameTechPS4Renderer::RunSkinning() {
+	skinningFrame++;
+	if (!skinningShader || packet.jointPalette.empty()) {
+		return;
+	}
+	Matrix4* palette = AllocateFrame<Matrix4>(packet.jointPalette.size());
+	if (!palette) {
+		return;
+	}
+	memcpy(palette, packet.jointPalette.data(), packet.jointPalette.size() * sizeof(Matrix4));
+
+	Gnm::Buffer inputs[4]; //its vertices, weights and joint indices, then the palette
+	inputs[3].initAsRegularBuffer(palette, sizeof(Matrix4), (uint32_t)packet.jointPalette.size());
+	inputs[3].setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+
+	skinningShader->SubmitShaderSwitch(*currentGFXContext);
+	const int threads = skinningShader->GetThreadXCount();
+
+	for (const auto& p : packet.paletteOffsets) {
+		PS4Mesh* mesh = (PS4Mesh*)p.first.first;
+		if (p.second.count == 0 || !mesh->CanSkin()) {
+			continue;
+		}
+		SkinConstants* constants = AllocateFrame<SkinConstants>(1);
+		if (!constants) {
+			break;
+		}
+		const int vertexCount = (int)mesh->GetVertexCount();
+		SkinnedVertices& out = skinnedVertices[p.first];
+		if (!out.vertices[0]) {
+			for (void*& v : out.vertices) {
+				v = garlicAllocator->allocate(mesh->GetVertexDataSize(), Gnm::kAlignmentOfBufferInBytes);
+			}
+			out.vertexCount = vertexCount;
+		}
+		out.copy = (out.copy + 1) % SkinnedCopies;
+
+		constants->vertexCount	= vertexCount;
+		constants->jointOffset	= p.second.offset;
+		Gnm::Buffer constantBuffer;
+		constantBuffer.initAsConstantBuffer(constants, sizeof(SkinConstants));
+		constantBuffer.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+
+		mesh->GetSkinningBuffers(inputs[0], inputs[1], inputs[2]);
+
+		Gnm::Buffer skinned;
+		skinned.initAsRegularBuffer(out.vertices[out.copy], PS4Mesh::GetVertexStride(), vertexCount);
+		skinned.setResourceMemoryType(Gnm::kResourceMemoryTypeGC);
+
+		currentGFXContext->setConstantBuffers(Gnm::kShaderStageCs, 0, 1, &constantBuffer);
+		currentGFXContext->setBuffers(Gnm::kShaderStageCs, 0, 4, inputs);
+		currentGFXContext->setRwBuffers(Gnm::kShaderStageCs, 0, 1, &skinned);
+		skinningShader->Dispatch(*currentGFXContext, (vertexCount + threads - 1) / threads);
+		out.skinnedFrame = skinningFrame;
+	}
+	//Everything skinned has to be out of the caches before it's read back as vertices
+	currentGFXContext->flushShaderCachesAndWait(Gnm::kCacheActionWriteBackAndInvalidateL1andL2, 0, Gnm::kStallCommandBufferParserDisable);
+}
+
+//Only if it was skinned this frame, otherwise it's drawn in its bind pose
+void* GameTechPS4Renderer::GetSkinnedVertices(const FrameObject& o) const {
+	if (!(o.features & RenderObject::Skinned)) {
+		return nullptr;
+	}
+	auto i = skinnedVertices.find({ o.mesh, o.animation });
+	if (i == skinnedVertices.end() || i->second.skinnedFrame != skinningFrame) {
+		return nullptr;
+	}
+	return i->second.vertices[i->second.copy];
+}
+
+//Only objects that would look the same drawn one at a time share a draw - none skinned, and all solid or all not
+size_t GameTechPS4Renderer::GetInstanceRunEnd(size_t first) const {
+	const FrameObject& a = *packet.drawItems[first].object;
+	size_t last = first + 1;
+	if (a.features & RenderObject::Skinned) {
+		return last;
+	}
+	while (last < packet.drawItems.size()) {
+		const FrameObject& b = *packet.drawItems[last].object;
+		if (b.mesh != a.mesh || b.texture != a.texture || (b.features & RenderObject::Skinned) || (b.colour.w < 1.0f) != (a.colour.w < 1.0f)) {
+			break;
+		}
+		++last;
+	}
+	return last;
+}
+
+void GameTechPS4Renderer::SetBlendState(bool transparent) {
+	Gnm::BlendControl blend;
+	blend.init();
+	blend.setBlendEnable(transparent);
+	blend.setColorEquation(Gnm::kBlendMultiplierSrcAlpha, Gnm::kBlendFuncAdd, Gnm::kBlendMultiplierOneMinusSrcAlpha);
+	currentGFXContext->setBlendControl(0, blend);
+
+	Gnm::DepthStencilControl dsc;
+	dsc.init();
+	dsc.setDepthControl(transparent ? Gnm::kDepthControlZWriteDisable : Gnm::kDepthControlZWriteEnable, Gnm::kCompareFuncLessEqual);
+	dsc.setDepthEnable(true);
+	currentGFXContext->setDepthStencilControl(dsc);
+}
+
+/*
+Each run's instances are written into the frame's memory and read by the
+vertex shader by instance ID, so a run is one draw however long it is. If
+the frame's memory runs out, whatever's left isn't drawn this frame.
+*/
+void GameTechPS4Renderer::DrawObjects() {
+	bool transparent = false;
+	SetBlendState(transparent);
+
+	for (size_t n = 0; n < packet.drawItems.size();) {
+		const FrameObject& first	= *packet.drawItems[n].object;
+		const size_t runEnd			= GetInstanceRunEnd(n);
+		const int count				= (int)(runEnd - n);
+
+		InstanceData* instances = AllocateFrame<InstanceData>(count);
+		if (!instances) {
+			break;
+		}
+		for (int i = 0; i < count; ++i) {
+			const FrameObject& o = *packet.drawItems[n + i].object;
+			instances[i].modelMatrix	= o.modelMatrix;
+			instances[i].colour			= o.colour;
+			instances[i].hasTexture		= o.texture ? 1 : 0;
+		}
+		if ((first.colour.w < 1.0f) != transparent) {
+			transparent = !transparent;
+			SetBlendState(transparent);
+		}
+		Gnm::Buffer instanceBuffer;
+		instanceBuffer.initAsRegularBuffer(instances, sizeof(InstanceData), count);
+		instanceBuffer.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+		currentGFXContext->setBuffers(Gnm::kShaderStageVs, 0, 1, &instanceBuffer);
+
+		if (first.texture) {
+			currentGFXContext->setTextures(Gnm::kShaderStagePs, 0, 1, &((PS4Texture*)first.texture)->GetAPITexture());
+		}
+		((PS4Mesh*)first.mesh)->SubmitInstancedDraw(*currentGFXContext, Gnm::kShaderStageVs, count, GetSkinnedVertices(first));
+		n = runEnd;
+	}
+}
+
+/*
+The base has already started the frame and cleared the screen. Skinning
+goes first, as it switches the context over to the compute shader, and
+then everything's drawn with the one shader, with the frame's constants
+in a buffer of their own rather than set per draw.
+*/
+void GameTechPS4Renderer::RenderActiveScene(int curFrame) {
+	if (!packetPending) {
+		ExtractFrame(curFrame);
+	}
+	packetPending = false;
+
+	RunSkinning();
+
+	FrameConstants* constants = AllocateFrame<FrameConstants>(1);
+	if (!constants) {
+		return;
+	}
+	constants->viewProjMatrix	= packet.view.viewProj;
+	constants->cameraPos		= Vector4(packet.view.position, 1.0f);
+	constants->lightPos			= Vector4(lightPosition, lightRadius);
+	constants->lightColour		= lightColour;
+
+	Gnm::Buffer constantBuffer;
+	constantBuffer.initAsConstantBuffer(constants, sizeof(FrameConstants));
+	constantBuffer.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+
+	objectShader->SubmitShaderSwitch(*currentGFXContext);
+	currentGFXContext->setConstantBuffers(Gnm::kShaderStageVs, 0, 1, &constantBuffer);
+	currentGFXContext->setConstantBuffers(Gnm::kShaderStagePs, 0, 1, &constantBuffer);
+
+	Gnm::PrimitiveSetup primitiveSetup;
+	primitiveSetup.init();
+	primitiveSetup.setCullFace(Gnm::kPrimitiveSetupCullFaceBack);
+	primitiveSetup.setFrontFace(Gnm::kPrimitiveSetupFrontFaceCcw);
+	currentGFXContext->setPrimitiveSetup(primitiveSetup);
+
+	DrawObjects();
+
+	lastFrameMemory = currentFrame->GetFrameMemoryUsed();
+}
+#endif
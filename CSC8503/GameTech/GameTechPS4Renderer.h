@@ -0,0 +1,124 @@
+#pragma once
+#ifdef _ORBIS
+#include "../../Plugins/PlayStation4/PS4RendererBase.h"
+#include "../../Plugins/PlayStation4/PS4Shader.h"
+#include "../../Plugins/PlayStation4/PS4ComputeShader.h"
+#include "../../Plugins/PlayStation4/PS4Mesh.h"
+#include "../CSC8503Common/GameWorld.h"
+#include "FramePacket.h"
+#include <map>
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class PaintDecals;
+
+		/*
+		Draws the same FramePacket as the GL renderer, on the PS4's Gnm
+		backend. Nothing's written to a buffer the GPU might still be
+		reading: the frame's constants, instance data and joint palette all
+		come out of the current PS4Frame's own memory, which is only handed
+		out again once that frame's been drawn. Every draw is instanced, so
+		runs of the same mesh and texture - walls and paint splats, mostly -
+		go in one draw, with each object's matrix and colour read from the
+		instance buffer. Skinned meshes are skinned once a frame by a compute
+		shader, into a copy of their vertices for each frame in flight.
+
+		Only the camera pass is drawn so far - there's no shadow map, LODs,
+		occlusion culling or UI here yet, and objects with a texture per
+		submesh are drawn with their default texture.
+		*/
+		class GameTechPS4Renderer : public PS4::PS4RendererBase {
+		public:
+			GameTechPS4Renderer(GameWorld& world);
+			~GameTechPS4Renderer();
+
+			void SetInterpolationAlpha(float alpha) {
+				interpolationAlpha = alpha;
+			}
+			void SetAnimationBlend(float b) { animationBlend = b < 0.0f ? 0.0f : (b > 1.0f ? 1.0f : b); }
+			void SetPaintDecals(const PaintDecals* d) { paintDecals = d; }
+
+			//Takes everything needed to draw the world as it is now
+			void ExtractFrame(int curFrame);
+
+			bool HasPendingFrame() const {
+				return packetPending;
+			}
+
+			//How much of its frame memory the last frame drawn needed
+			size_t GetFrameMemoryUsed() const {
+				return lastFrameMemory;
+			}
+
+		protected:
+			void RenderActiveScene(int curFrame) override;
+
+			void BuildObjectList();
+			void SortObjectList();
+			void BuildSkinningPalettes(int curFrame);
+			void RunSkinning();
+			void* GetSkinnedVertices(const FrameObject& o) const;
+			size_t GetInstanceRunEnd(size_t first) const;
+			void DrawObjects();
+			void SetBlendState(bool transparent);
+
+			template<typename T>
+			T* AllocateFrame(size_t count) {
+				return (T*)currentFrame->AllocateFrameMemory(sizeof(T) * count);
+			}
+
+			//Laid out the way the shaders' constant buffers read them
+			struct FrameConstants {
+				Matrix4 viewProjMatrix;
+				Vector4 cameraPos;
+				Vector4 lightPos;		//radius in w
+				Vector4 lightColour;
+			};
+
+			struct InstanceData {
+				Matrix4 modelMatrix;
+				Vector4 colour;
+				int		hasTexture;
+				int		padding[3];
+			};
+
+			struct SkinConstants {
+				unsigned int vertexCount;
+				unsigned int jointOffset;
+				unsigned int padding[2];
+			};
+
+			static const int SkinnedCopies = 3; //one for each of the base's command buffers
+
+			struct SkinnedVertices {
+				void*	vertices[SkinnedCopies] = {};
+				int		vertexCount		= 0;
+				int		skinnedFrame	= -1;
+				int		copy			= 0;	//which was written last
+			};
+
+			GameWorld&	gameWorld;
+			float		interpolationAlpha	= 1.0f;
+			float		animationBlend		= 0.0f;
+			const PaintDecals* paintDecals	= nullptr;
+
+			FramePacket packet;
+			bool		packetPending = false;
+			std::vector<const RenderObject*> activeObjects;
+
+			PS4::PS4Shader*			objectShader	= nullptr;
+			PS4::PS4ComputeShader*	skinningShader	= nullptr;	//null if it couldn't be loaded
+
+			std::map<std::pair<const MeshGeometry*, const MeshAnimation*>, SkinnedVertices> skinnedVertices;
+			std::vector<Matrix4>	sampledPose;
+			int						skinningFrame	= 0;
+			size_t					lastFrameMemory	= 0;
+
+			Vector4 lightColour;
+			float	lightRadius;
+			Vector3	lightPosition;
+		};
+	}
+}
+#endif
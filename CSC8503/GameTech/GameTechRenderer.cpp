@@ -1,10 +1,22 @@
 #include "GameTechRenderer.h"
 #include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/CollisionVolume.h"
+#include "../CSC8503Common/Frustum.h"
+#include "PaintDecals.h"
+#include "PaintParticles.h"
+#include "TextureStreamer.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Common/Maths.h"
 #include "../../Common/Camera.h"
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/TextureLoader.h"
 #include<vector>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
 using namespace NCL;
 using namespace Rendering;
 using namespace CSC8503;
@@ -13,49 +25,254 @@ using namespace CSC8503;
 
 Matrix4 biasMatrix = Matrix4::Translation(Vector3(0.5, 0.5, 0.5)) * Matrix4::Scale(Vector3(0.5, 0.5, 0.5));
 
+static const int mvpMatrixID	= OGLShader::GetUniformID("mvpMatrix");
+static const int projMatrixID	= OGLShader::GetUniformID("projMatrix");
+static const int viewMatrixID	= OGLShader::GetUniformID("viewMatrix");
+static const int cubeTexID		= OGLShader::GetUniformID("cubeTex");
+static const int mainTexID		= OGLShader::GetUniformID("mainTex");
+
+//Resolution scales are kept to multiples of this, so they don't change on every frame
+static const float resolutionStep		= 0.1f;
+static const int scaleDownFrameCount	= 4;	//GPU frame times needed before going down a step
+static const int scaleUpFrameCount		= 60;	//and before trying to go back up one
+
 GameTechRenderer::GameTechRenderer(GameWorld& world) : OGLRenderer(*Window::GetWindow()), gameWorld(world) {
 	glEnable(GL_DEPTH_TEST);
 
 	shadowShader = new OGLShader("GameTechShadowVert.glsl", "GameTechShadowFrag.glsl");
 
-	glGenTextures(1, &shadowTex);
-	glBindTexture(GL_TEXTURE_2D, shadowTex);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-		SHADOWSIZE, SHADOWSIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	glGenFramebuffers(1, &shadowFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowTex, 0);
-	glDrawBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	CreateShadowTarget(staticShadowTex, staticShadowFBO);
 
 	glClearColor(1, 1, 1, 1);
 
 	//Set up the light properties
 	lightColour = Vector4(0.8f, 0.8f, 0.5f, 1.0f);
 	lightRadius = 1000.0f;
+	interpolationAlpha = 1.0f;
 	lightPosition = Vector3(-200.0f, 60.0f, -200.0f);
 
 	//Skybox!
 	skyboxShader = new OGLShader("skyboxVertex.glsl", "skyboxFragment.glsl");
 	skyboxMesh = new OGLMesh();
-	skyboxMesh->SetVertexPositions({ Vector3(-1, 1,-1), Vector3(-1,-1,-1) , Vector3(1,-1,-1) , Vector3(1,1,-1) });
+	//On the far plane, so it's only drawn where nothing else has been
+	skyboxMesh->SetVertexPositions({ Vector3(-1, 1, 1), Vector3(-1,-1, 1) , Vector3(1,-1, 1) , Vector3(1,1, 1) });
 	skyboxMesh->SetVertexIndices({ 0,1,2,2,3,0 });
 	skyboxMesh->UploadToGPU();
 
 	LoadSkybox();
+	CreateInstanceBuffer();
+
+	glGenBuffers(1, &frameDataBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameDataBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, OGLShader::GetBlockBinding("FrameData"), frameDataBuffer);
+
+	if (indirectBatch.IsSupported()) {
+		indirectShadowShader = new OGLShader("GameTechIndirectShadowVert.glsl", "GameTechShadowFrag.glsl");
+	}
+	shadowInstancedShader = new OGLShader("GameTechShadowInstancedVert.glsl", "GameTechShadowFrag.glsl");
+	if (!shadowInstancedShader->LoadSuccess()) {
+		delete shadowInstancedShader;
+		shadowInstancedShader = nullptr;
+	}
+
+	//Compute shaders need GL 4.3, so skinning stays in the vertex shaders without them
+	if (glDispatchCompute) {
+		skinningShader = new OGLComputeShader("SkinningCompute.glsl");
+		if (!skinningShader->LoadSuccess()) {
+			delete skinningShader;
+			skinningShader = nullptr;
+		}
+		else {
+			int program = skinningShader->GetProgramID();
+			skinningUniforms[0] = glGetUniformLocation(program, "vertexCount");
+			skinningUniforms[1] = glGetUniformLocation(program, "jointOffset");
+			skinningUniforms[2] = glGetUniformLocation(program, "hasNormals");
+		}
+		glGenBuffers(1, &paletteBuffer);
+	}
 }
 
 GameTechRenderer::~GameTechRenderer() {
-	glDeleteTextures(1, &shadowTex);
-	glDeleteFramebuffers(1, &shadowFBO);
+	glDeleteTextures(1, &staticShadowTex);
+	glDeleteFramebuffers(1, &staticShadowFBO);
+
+	for (GLsync& f : instanceFences) {
+		if (f) {
+			glDeleteSync(f);
+		}
+	}
+	if (instanceMemory) {
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteBuffers(1, &frameDataBuffer);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, -(int64_t)(SHADOWSIZE * SHADOWSIZE * 4 + sizeof(InstanceData) * MaxInstances * InstanceFrames));
+
+	delete skinningShader;
+	delete indirectShadowShader;
+	delete shadowInstancedShader;
+	glDeleteBuffers(1, &paletteBuffer);
+	for (auto& s : skinnedVertices) {
+		glDeleteBuffers(1, &s.second.positions);
+		glDeleteBuffers(1, &s.second.normals);
+	}
+	for (auto& m : materialArrays) {
+		delete m.second;
+	}
+}
+
+void GameTechRenderer::CreateShadowTarget(GLuint& tex, GLuint& fbo) {
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
+		SHADOWSIZE, SHADOWSIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, SHADOWSIZE * SHADOWSIZE * 4); //drivers tend to give 32 bits, for GL_DEPTH_COMPONENT
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex, 0);
+	glDrawBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/*
+Takes one step down as soon as the GPU's been over its target for a few
+frames, or further if it's well over, as a frame's cost goes mostly with
+its pixel count, the square of the scale. Going back up waits much longer,
+and only happens if the next step up should still be comfortably under
+the target, so the scale doesn't flicker between two steps. Only frames
+drawn since the last change are looked at, the GPU's times being a few
+frames behind.
+*/
+void GameTechRenderer::UpdateResolutionScale() {
+	if (targetFrameTime <= 0.0f || !gpuTimer.IsSupported()) {
+		resolutionScale = 1.0f;
+	}
+	else {
+		int frame = gpuTimer.GetLastFrameNumber();
+		if (frame > resolutionTimedFrame && frame >= resolutionChangeFrame) {
+			resolutionTimedFrame = frame;
+			float time = gpuTimer.GetLastFrameTime();
+			smoothedFrameTime = smoothedFrameTime < 0.0f ? time : smoothedFrameTime * 0.9f + time * 0.1f;
+			resolutionTimedCount++;
+
+			float scale = resolutionScale;
+			if (smoothedFrameTime > targetFrameTime && resolutionTimedCount >= scaleDownFrameCount) {
+				float ideal = scale * sqrtf(targetFrameTime / smoothedFrameTime);
+				float lower = floorf(ideal / resolutionStep + 0.001f) * resolutionStep;
+				scale = lower < scale - resolutionStep ? lower : scale - resolutionStep;
+			}
+			else if (resolutionTimedCount >= scaleUpFrameCount && scale < 1.0f) {
+				float higher	= scale + resolutionStep;
+				float predicted	= smoothedFrameTime * (higher * higher) / (scale * scale);
+				if (predicted < targetFrameTime * 0.9f) {
+					scale = higher;
+				}
+			}
+			scale = scale < minResolutionScale ? minResolutionScale : scale;
+			scale = scale > 0.999f ? 1.0f : scale;
+
+			if (scale != resolutionScale) {
+				resolutionScale			= scale;
+				resolutionChangeFrame	= FrameProfiler::GetFrameNumber();
+				smoothedFrameTime		= -1.0f;
+				resolutionTimedCount	= 0;
+			}
+		}
+	}
+	if (resolutionScale < 1.0f) {
+		sceneWidth	= (int)(currentWidth * resolutionScale);
+		sceneHeight	= (int)(currentHeight * resolutionScale);
+		sceneWidth	= sceneWidth > 0 ? sceneWidth : 1;
+		sceneHeight	= sceneHeight > 0 ? sceneHeight : 1;
+	}
+	else {
+		sceneWidth	= currentWidth;
+		sceneHeight	= currentHeight;
+	}
+}
+
+//Every pass drawing the scene binds it, as the shadow pass leaves the screen bound
+void GameTechRenderer::BindSceneTarget() {
+	glBindFramebuffer(GL_FRAMEBUFFER, frameGraph.GetFramebuffer(sceneTarget));
+	glViewport(0, 0, sceneWidth, sceneHeight);
+}
+
+//Stretches the scene over the whole screen, ready for the UI
+void GameTechRenderer::ResolveScene() {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameGraph.GetFramebuffer(sceneTarget));
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, currentWidth, currentHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, currentWidth, currentHeight);
+}
+
+/*
+One buffer holds InstanceFrames frames' worth of instance data, each
+frame writing to its own part of it, so nothing the GPU might still be
+reading gets written over. Where the driver can keep the buffer mapped,
+instances are written straight into it, with a fence per frame to wait
+on before its part is reused. Otherwise they're copied in with
+glBufferSubData, which is slower but works on any GL 4 driver.
+*/
+void GameTechRenderer::CreateInstanceBuffer() {
+	const GLsizeiptr size = sizeof(InstanceData) * MaxInstances * InstanceFrames;
+
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	if (glBufferStorage && glMapBufferRange) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		instanceMemory = (InstanceData*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+	if (!instanceMemory) {
+		instanceStaging.resize(MaxInstances);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, size);
+}
+
+void GameTechRenderer::BeginInstanceFrame() {
+	GLsync& fence = instanceFences[instanceFrame];
+	if (fence) {
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); //a second, which it should never get near
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	instanceCount = 0;
+}
+
+void GameTechRenderer::EndInstanceFrame() {
+	if (instanceMemory && instanceCount > 0) {
+		instanceFences[instanceFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	instanceFrame = (instanceFrame + 1) % InstanceFrames;
+}
+
+void GameTechRenderer::SetInstancedShader(const ShaderBase* shader, OGLShader* instanced, OGLShader* instancedArray) {
+	InstancedShaders variants;
+	variants.plain = (instanced && instanced->LoadSuccess()) ? instanced : nullptr;
+	variants.array = (instancedArray && instancedArray->LoadSuccess()) ? instancedArray : nullptr;
+	if (variants.plain || variants.array) {
+		instancedShaders[shader] = variants;
+	}
+	else {
+		instancedShaders.erase(shader);
+	}
 }
 
 void GameTechRenderer::LoadSkybox() {
@@ -98,74 +315,828 @@ void GameTechRenderer::LoadSkybox() {
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
+/*
+The culling, LOD picking and sorting all happen here, along with anything
+else that reads the world, leaving Render with only the GL calls to make.
+The indirect batch is rebuilt here too when the level changes, as that
+needs the world's objects. If the last packet was never drawn, its static
+shadows still need to be, so they're carried over.
+*/
+void GameTechRenderer::ExtractFrame(int curFrame) {
+	ProfileScope scope("Extract Frame");
+	MemoryTagScope tag(MemoryTag::Rendering);
+	bool redrawStatics = packetPending && packet.redrawStaticShadows;
+	packet.Clear();
+
+	float screenAspect		= (float)currentWidth / (float)currentHeight;
+	Camera* camera			= gameWorld.GetMainCamera();
+	packet.curFrame			= curFrame;
+	packet.view.Build(*camera, screenAspect);
+	packet.lodScale			= packet.view.projMatrix.array[5];
+	packet.time				= (float)gameWorld.GetWorldTime();
+	packet.shadowViewProj	= BuildShadowViewProjection();
+
+	BuildObjectList();
+	RequestTextureCoverage();
+	BuildStaticShadowList(redrawStatics);
+	CopyToPacket(activeObjects, packet.cameraObjects, true);
+	CopyToPacket(shadowObjects, packet.shadowObjects, true, true);
+	SortObjectList();
+	BuildSkinningPalettes(curFrame);
+	if (paintParticles) {
+		paintParticles->Take(packet.particleBursts, packet.particleTime, packet.clearParticles);
+	}
+	GatherLights();
+	packetPending = true;
+}
+
+//Only the lights whose spheres reach into the camera's frustum go in the packet
+void GameTechRenderer::GatherLights() {
+	packet.lights.clear();
+	if (!dynamicLights || !lightGrid.IsSupported()) {
+		return;
+	}
+	dynamicLights->Gather(packet.lights);
+	const Frustum& cameraFrustum = packet.view.frustum;
+	size_t kept = 0;
+	for (size_t i = 0; i < packet.lights.size(); ++i) {
+		const PointLight& l = packet.lights[i];
+		if (cameraFrustum.AABBInside(l.position, Vector3(l.radius, l.radius, l.radius))) {
+			packet.lights[kept++] = l;
+		}
+	}
+	packet.lights.resize(kept);
+}
+
+void GameTechRenderer::SetPaintParticles(PaintParticles* p) {
+	paintParticles = p;
+	if (paintParticles) {
+		paintParticles->SetEnabled(particles.IsSupported());
+	}
+}
+
+//Everything's interpolated once here, rather than every time it's drawn
+void GameTechRenderer::CopyToPacket(const vector<const RenderObject*>& objects, vector<FrameObject>& into, bool useLODs, bool forShadows) {
+	for (const RenderObject* o : objects) {
+		const std::vector<unsigned int>& textures = o->GetTextures();
+
+		FrameObject f;
+		f.modelMatrix	= o->GetTransform()->GetInterpolatedMatrix(interpolationAlpha);
+		f.colour		= o->GetColourAt(packet.time);
+		f.fadeFrom		= o->GetFadeFrom();
+		f.fadeTo		= o->GetColour();
+		f.fadeStart		= o->GetFadeStart();
+		f.fadeDuration	= o->IsFading(packet.time) ? o->GetFadeDuration() : 0.0f;
+		f.mesh			= useLODs ? SelectMesh(o, f.modelMatrix.GetPositionVector()) : o->GetMesh();
+		//Whichever's cheaper, of its shadow proxy and the LOD it'd be drawn with
+		if (forShadows && f.mesh) {
+			MeshGeometry* proxy = o->GetMesh()->GetShadowProxy();
+			f.mesh = proxy && proxy->GetIndexCount() < f.mesh->GetIndexCount() ? proxy : f.mesh;
+		}
+		f.shader		= o->GetShader();
+		f.texture		= o->GetDefaultTexture();
+		f.animation		= o->GetAnimation();
+		f.features		= o->GetFeatures();
+		f.textureLayer	= o->GetTextureLayer();
+		f.firstTexture	= (int)packet.textureIDs.size();
+		f.textureCount	= (int)textures.size();
+		f.castsShadow	= o->RenderShadow();
+		f.layerPerSubMesh = false;
+		//Skinned meshes' shaders can't read arrays, so they keep binding their own
+		if (f.textureCount > 0 && !(f.features & RenderObject::Skinned)) {
+			if (const TextureBase* array = GetMaterialArray(f.shader, textures)) {
+				f.texture			= (TextureBase*)array;
+				f.textureLayer		= 0;
+				f.textureCount		= 0;
+				f.layerPerSubMesh	= true;
+			}
+		}
+		//Picked here, once, so the shader never has to branch on them
+		f.shaderFeatures = (f.mesh && f.mesh->HasVertexAttribute(VertexAttribute::Colours) ? OGLShader::VertexColours : 0) |
+			(f.texture ? OGLShader::Texture : 0);
+		packet.textureIDs.insert(packet.textureIDs.end(), textures.begin(), textures.begin() + f.textureCount);
+		into.emplace_back(f);
+	}
+}
+
+/*
+Only worth it for shaders with an instanced array version, as that's the
+only one that can pick a layer per submesh.
+*/
+const TextureBase* GameTechRenderer::GetMaterialArray(const ShaderBase* shader, const std::vector<unsigned int>& textures) {
+	auto instanced = instancedShaders.find(shader);
+	if (instanced == instancedShaders.end() || !instanced->second.array) {
+		return nullptr;
+	}
+	auto i = materialArrays.find(textures);
+	if (i != materialArrays.end()) {
+		return i->second;
+	}
+	std::vector<GLuint> ids(textures.begin(), textures.end());
+	return materialArrays.emplace(textures, OGLTexture::ArrayFromTextures(ids)).first->second;
+}
+
+//Whatever has a texture per submesh, and binds them itself as it's drawn
+static bool BindsOwnTextures(const FrameObject& o) {
+	return (o.features & RenderObject::TexturePerSubMesh) && !o.layerPerSubMesh;
+}
+
+/*
+Only ever draws from the packet, so whatever happens to the world since
+it was taken doesn't matter.
+*/
 void GameTechRenderer::RenderFrame(int curFrame) {
+	ProfileScope scope("Render");
+	MemoryTagScope tag(MemoryTag::Rendering);
+	if (!packetPending) {
+		ExtractFrame(curFrame);
+	}
+	packetPending = false;
+	gpuTimer.BeginFrame(FrameProfiler::GetFrameNumber());
+	if (textureStreamer) {
+		textureStreamer->Update();
+	}
+	UpdateResolutionScale();
+
 	glEnable(GL_CULL_FACE);
 	glClearColor(1, 1, 1, 1);
-	BuildObjectList();
-	SortObjectList();
-	RenderShadowMap();
-	RenderSkybox();
-	RenderCamera(curFrame);
+
+	BuildFrameGraph();
+	frameGraph.Compile();
+	BeginInstanceFrame(); //shared by the shadow and camera passes
+	frameGraph.Execute(gpuTimer);
+	EndInstanceFrame();
+
 	glDisable(GL_CULL_FACE); //Todo - text indices are going the wrong way...
+}
 
-	if (gameui)
-	{
-		gameui->DrawUI();
+/*
+The resources are only what the passes pass between each other on the
+GPU - the shadow map, the scene, and the buffers the compute passes fill
+- so the order they have to go in, and whether anything's left to use
+what they've drawn, can be worked out from them. The screen, the Hi-Z
+pyramid and the particles are all read after the frame's done, so
+they're kept. Below full resolution the scene is a target of its own,
+always the window's size with the scene in its bottom left corner, so
+changing scale doesn't change the target.
+*/
+void GameTechRenderer::BuildFrameGraph() {
+	FrameGraph& graph = frameGraph;
+	graph.Reset();
+
+	FrameGraph::Resource screen			= graph.Import("Screen", true);
+	FrameGraph::Resource particleState	= graph.Import("Particles", true);
+	FrameGraph::Resource hiZPyramid		= graph.Import("Hi-Z", hiZ.IsSupported());
+	FrameGraph::Resource staticShadows	= graph.Import("Static Shadows");
+	FrameGraph::Resource skinned		= graph.Import("Skinned Vertices");
+	FrameGraph::Resource indirectDraws	= graph.Import("Indirect Draws");
+
+	FrameGraph::TargetDesc shadowDesc;
+	shadowDesc.width		= SHADOWSIZE;
+	shadowDesc.height		= SHADOWSIZE;
+	shadowDesc.depthFormat	= GL_DEPTH_COMPONENT; //the same as the static one, so it can be blitted over
+	shadowDesc.comparison	= true;
+	shadowMapTarget = graph.CreateTarget("Shadow Map", shadowDesc);
+
+	const bool scaled = resolutionScale < 1.0f;
+	if (scaled) {
+		FrameGraph::TargetDesc sceneDesc;
+		sceneDesc.width			= currentWidth;
+		sceneDesc.height		= currentHeight;
+		sceneDesc.colourFormat	= GL_RGBA8;
+		sceneDesc.depthFormat	= GL_DEPTH24_STENCIL8; //the same as the screen's, so the Hi-Z buffer can copy from either
+		sceneTarget = graph.CreateTarget("Scene", sceneDesc);
+	}
+	else {
+		sceneTarget = screen; //which the frame's already cleared
+	}
+
+	int pass = graph.AddPass("Skinning", [this]() { RunSkinning(); });
+	graph.Writes(pass, skinned);
+
+	pass = graph.AddPass("Particles", [this]() {
+		particles.Simulate(packet.particleBursts, packet.particleTime, packet.clearParticles);
+	});
+	graph.Writes(pass, particleState);
+
+	pass = graph.AddPass("Shadows", [this]() {
+		RenderShadowMap();
+		UpdateFrameData(packet.view); //once the shadow matrix is known
+	});
+	graph.Reads(pass, skinned);
+	graph.Reads(pass, staticShadows);
+	graph.Writes(pass, staticShadows);
+	graph.Writes(pass, shadowMapTarget);
+
+	if (!indirectBatch.IsEmpty()) {
+		pass = graph.AddPass("Cull", [this]() { CullIndirectBatch(); });
+		graph.Reads(pass, hiZPyramid); //last frame's
+		graph.Writes(pass, indirectDraws);
+	}
+
+	if (scaled) {
+		pass = graph.AddPass("Clear", [this]() {
+			BindSceneTarget();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		});
+		graph.Writes(pass, sceneTarget);
+	}
 
+	if (useDepthPrepass) {
+		pass = graph.AddPass("Depth", [this]() {
+			BindSceneTarget();
+			RenderDepthPrepass();
+		});
+		graph.Reads(pass, skinned);
+		graph.Reads(pass, indirectDraws);
+		graph.Writes(pass, sceneTarget);
 	}
 
+	pass = graph.AddPass("Camera", [this]() {
+		BindSceneTarget();
+		RenderOpaque();
+	});
+	graph.Reads(pass, skinned);
+	graph.Reads(pass, indirectDraws);
+	graph.Reads(pass, shadowMapTarget);
+	graph.Writes(pass, sceneTarget);
+
+	pass = graph.AddPass("Skybox", [this]() {
+		BindSceneTarget();
+		RenderSkybox();
+	});
+	graph.Writes(pass, sceneTarget);
+
+	pass = graph.AddPass("Transparent", [this]() {
+		BindSceneTarget();
+		RenderTransparent();
+	});
+	graph.Reads(pass, skinned);
+	graph.Reads(pass, shadowMapTarget);
+	graph.Reads(pass, particleState);
+	graph.Writes(pass, sceneTarget);
+
+	pass = graph.AddPass("Hi-Z", [this]() { CaptureHiZ(); });
+	graph.Reads(pass, sceneTarget);
+	graph.Writes(pass, hiZPyramid);
+
+	if (scaled) {
+		pass = graph.AddPass("Upscale", [this]() { ResolveScene(); });
+		graph.Reads(pass, sceneTarget);
+		graph.Writes(pass, screen);
+	}
+
+	if (gameui) {
+		pass = graph.AddPass("UI", [this]() {
+			glDisable(GL_CULL_FACE);
+			gameui->DrawUI();
+		});
+		graph.Reads(pass, screen);
+		graph.Writes(pass, screen);
+	}
 }
 
+/*
+Only what each view can see goes in its list - the camera's for the main
+pass, and the light's for the shadow map. Static objects in the world's
+octree are culled a node at a time, and everything else is tested on its
+own, using its broadphase box padded by cullMargin, as meshes can poke out
+of their collision volumes. Anything without a volume is always drawn.
+The light's list only has the moving things in it, as the static ones
+are in their own cached shadow map. Paint decals only go in the camera's
+list, as they don't cast shadows. Level geometry in the indirect batch
+isn't in either, as it's culled on the GPU. The camera's list also leaves
+out whatever was hidden behind last frame's depth. The light's doesn't,
+as something the camera can't see can still cast a shadow it can.
+*/
 void GameTechRenderer::BuildObjectList() {
 	activeObjects.clear();
+	shadowObjects.clear();
+
+	const Frustum& cameraFrustum = packet.view.frustum;
+	Frustum lightFrustum(packet.shadowViewProj);
+
+	if (indirectVersion != gameWorld.GetStaticVersion()) {
+		RebuildIndirectBatch();
+	}
+
+	if (Octree<GameObject*>* staticTree = gameWorld.GetStaticTree()) {
+		visibleStatics.clear();
+		staticTree->GetObjectsInFrustum(cameraFrustum, visibleStatics);
+		for (GameObject* o : visibleStatics) {
+			const RenderObject* g = o->GetRenderObject();
+			if (!o->IsActive() || !g || (g->IsStaticGeometry() && indirectBatch.Contains(g))) {
+				continue;
+			}
+			Vector3 halfSize;
+			o->GetBroadphaseAABB(halfSize);
+			if (hiZ.IsVisible(o->GetTransform().GetWorldPosition() + o->GetBoundingVolume()->GetOffset(), halfSize + Vector3(cullMargin, cullMargin, cullMargin))) {
+				activeObjects.emplace_back(g);
+			}
+		}
+	}
+
+	if (paintDecals) {
+		size_t firstDecal = activeObjects.size();
+		paintDecals->GetVisible(cameraFrustum, activeObjects);
+		size_t kept = firstDecal;
+		for (size_t i = firstDecal; i < activeObjects.size(); ++i) {
+			const Transform* t = activeObjects[i]->GetTransform();
+			if (hiZ.IsVisible(t->GetPosition(), t->GetScale() * 0.5f)) {
+				activeObjects[kept++] = activeObjects[i];
+			}
+		}
+		activeObjects.resize(kept);
+	}
 
 	gameWorld.OperateOnContents(
 		[&](GameObject* o) {
-			if (o->IsActive()) {
-				const RenderObject* g = o->GetRenderObject();
-				if (g) {
-					activeObjects.emplace_back(g);
+			const RenderObject* g = o->GetRenderObject();
+			if (!o->IsActive() || !g || o->IsInStaticTree() || (g->IsStaticGeometry() && indirectBatch.Contains(g))) {
+				return;
+			}
+			Vector3 halfSize;
+			if (!o->GetBroadphaseAABB(halfSize)) {
+				activeObjects.emplace_back(g);
+				if (g->RenderShadow()) {
+					shadowObjects.emplace_back(g);
 				}
+				return;
+			}
+			//World position, as anything with a parent only has its offset from it in GetPosition
+			Vector3 position = o->GetTransform().GetWorldPosition() + o->GetBoundingVolume()->GetOffset();
+			halfSize += Vector3(cullMargin, cullMargin, cullMargin);
+			if (cameraFrustum.AABBInside(position, halfSize) && hiZ.IsVisible(position, halfSize)) {
+				activeObjects.emplace_back(g);
+			}
+			if (g->RenderShadow() && lightFrustum.AABBInside(position, halfSize)) {
+				shadowObjects.emplace_back(g);
 			}
 		}
 	);
 }
 
+Matrix4 GameTechRenderer::BuildShadowViewProjection() const {
+	Matrix4 shadowViewMatrix = Matrix4::BuildViewMatrix(lightPosition, Vector3(0, 0, 0), Vector3(0, 1, 0));
+	Matrix4 shadowProjMatrix = Matrix4::Perspective(100.0f, 500.0f, 1, 45.0f);
+	return shadowProjMatrix * shadowViewMatrix;
+}
+
+/*
+Everything in the static tree the light can see, which only needs
+finding again when the tree's changed or the light's moved, as its
+shadows are kept in their own map until then. They're drawn at full
+detail, as that map's kept however the camera moves.
+*/
+void GameTechRenderer::BuildStaticShadowList(bool force) {
+	bool lightMoved = memcmp(packet.shadowViewProj.array, staticShadowViewProj.array, sizeof(staticShadowViewProj.array)) != 0;
+	if (!force && !lightMoved && staticShadowVersion == gameWorld.GetStaticVersion()) {
+		return;
+	}
+	staticShadowObjects.clear();
+	if (Octree<GameObject*>* staticTree = gameWorld.GetStaticTree()) {
+		visibleStatics.clear();
+		staticTree->GetObjectsInFrustum(Frustum(packet.shadowViewProj), visibleStatics);
+		for (GameObject* o : visibleStatics) {
+			const RenderObject* g = o->GetRenderObject();
+			if (o->IsActive() && g && g->RenderShadow() && !(g->IsStaticGeometry() && indirectBatch.Contains(g))) {
+				staticShadowObjects.emplace_back(g);
+			}
+		}
+	}
+	CopyToPacket(staticShadowObjects, packet.staticShadowObjects, false, true);
+	packet.redrawStaticShadows	= true;
+	staticShadowViewProj		= packet.shadowViewProj;
+	staticShadowVersion			= gameWorld.GetStaticVersion();
+}
+
+void GameTechRenderer::SetIndirectShader(const ShaderBase* shader, OGLShader* indirect) {
+	if (indirect && indirect->LoadSuccess()) {
+		indirectShaders[shader] = indirect;
+	}
+	else {
+		indirectShaders.erase(shader);
+	}
+	indirectVersion = -1;
+}
+
+/*
+The world's static version changes whenever it's cleared or its static
+tree is rebuilt, which is after a level's loaded, so that's when the
+level geometry gets merged again. It's only static geometry that's
+active at that point that goes in, and it's not expected to be hidden
+or moved until the next rebuild.
+*/
+void GameTechRenderer::RebuildIndirectBatch() {
+	indirectObjects.clear();
+	if (indirectBatch.IsSupported() && !indirectShaders.empty()) {
+		gameWorld.OperateOnContents(
+			[&](GameObject* o) {
+				const RenderObject* g = o->GetRenderObject();
+				if (o->IsActive() && g && g->IsStaticGeometry()) {
+					indirectObjects.emplace_back(g);
+				}
+			}
+		);
+	}
+	indirectBatch.Build(indirectObjects, indirectShaders);
+	indirectVersion = gameWorld.GetStaticVersion();
+}
+
+//Taken once the camera pass is done, so next frame can cull against it
+void GameTechRenderer::CaptureHiZ() {
+	hiZ.Capture(sceneWidth, sceneHeight, packet.view.viewProj, frameGraph.GetFramebuffer(sceneTarget));
+}
+
+/*
+Sorts the camera's objects with an LSD radix sort on their draw keys, a
+byte at a time. Any byte that's the same in every key is skipped, which
+with only a handful of shaders and meshes is most of the top ones.
+*/
+static void RadixSort(vector<DrawItem>& items, vector<DrawItem>& scratch) {
+	if (items.empty()) {
+		return;
+	}
+	scratch.resize(items.size());
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[256] = { 0 };
+		for (const auto& i : items) {
+			counts[(i.key >> shift) & 0xFF]++;
+		}
+		if (counts[(items[0].key >> shift) & 0xFF] == items.size()) {
+			continue;
+		}
+		size_t offset = 0;
+		for (size_t& c : counts) {
+			size_t count = c;
+			c = offset;
+			offset += count;
+		}
+		for (const auto& i : items) {
+			scratch[counts[(i.key >> shift) & 0xFF]++] = i;
+		}
+		items.swap(scratch);
+	}
+}
+
+//Each shader, texture and mesh keeps the same small ID from frame to frame
+uint64_t GameTechRenderer::GetStateID(std::unordered_map<const void*, uint64_t>& ids, const void* state, int bits) {
+	if (!state) {
+		return 0;
+	}
+	auto i = ids.find(state);
+	if (i != ids.end()) {
+		return i->second;
+	}
+	uint64_t id = (ids.size() + 1) & ((1ull << bits) - 1); //past the limit, some just share an ID
+	ids.emplace(state, id);
+	return id;
+}
+
+/*
+Keys are, from the top bit down, the pass, shader, its variant, texture, mesh and then
+distance from the camera, so everything sharing a shader is drawn together,
+and then everything sharing a texture and mesh within that. Opaque objects
+go front to back within their state, so the depth test throws away as much
+as it can, and anything see-through goes in a later pass, back to front.
+Each object's LOD is picked here, and sorted by, so far away objects
+sharing a LOD can still be instanced together.
+*/
 void GameTechRenderer::SortObjectList() {
-	//Who cares!
+	vector<DrawItem>& drawItems = packet.drawItems;
+	drawItems.clear();
+	packet.depthItems.clear();
+
+	float farPlane		= packet.view.farPlane;
+	const uint64_t maxDepth = (1ull << DepthBits) - 1;
+
+	for (const FrameObject& o : packet.cameraObjects) {
+		bool transparent = o.colour.w < 1.0f;
+
+		float distance	= (o.modelMatrix.GetPositionVector() - packet.view.position).Length() / farPlane;
+		uint64_t depth	= (uint64_t)((distance < 0.0f ? 0.0f : (distance > 1.0f ? 1.0f : distance)) * (float)maxDepth);
+		if (transparent) {
+			depth = maxDepth - depth;
+		}
+		//Objects with a texture per submesh bind their own, so don't sort by the default one
+		const void* texture = BindsOwnTextures(o) ? nullptr : o.texture;
+
+		uint64_t key = (uint64_t)(transparent ? 1 : 0) << (64 - PassBits);
+		key |= GetStateID(shaderIDs, o.shader, ShaderBits)			<< (DepthBits + MeshBits + TextureBits + FeatureBits);
+		key |= (uint64_t)o.shaderFeatures							<< (DepthBits + MeshBits + TextureBits);
+		key |= GetStateID(textureIDs, texture, TextureBits)			<< (DepthBits + MeshBits);
+		key |= GetStateID(meshIDs, o.mesh, MeshBits)				<< DepthBits;
+		key |= depth;
+		drawItems.push_back({ key, &o });
+
+		//Colliders are only a debug overlay, and shouldn't hide anything
+		if (useDepthPrepass && !transparent && !(o.features & RenderObject::DebugOnly)) {
+			packet.depthItems.push_back({ depth, &o });
+		}
+	}
+	RadixSort(drawItems, sortScratch);
+	RadixSort(packet.depthItems, sortScratch);
+}
+
+/*
+The mesh's bounding sphere, scaled by the object's largest axis, is
+projected to get how much of the screen's height it covers. That's only
+an estimate, as it's from the camera's position rather than its view
+direction, but it changes smoothly as things move about.
+*/
+MeshGeometry* GameTechRenderer::SelectMesh(const RenderObject* o, const Vector3& position) const {
+	MeshGeometry* mesh = o->GetMesh();
+	if (!mesh || mesh->GetLODCount() == 0) {
+		return mesh;
+	}
+	float size = ScreenSize(o, position);
+	return size == FLT_MAX ? mesh : mesh->SelectLOD(size);
+}
+
+float GameTechRenderer::ScreenSize(const RenderObject* o, const Vector3& position) const {
+	const MeshGeometry* mesh = o->GetMesh();
+	if (!mesh) {
+		return 0.0f;
+	}
+	Vector3 scale	= o->GetTransform()->GetScale();
+	float largest	= scale.x > scale.y ? scale.x : scale.y;
+	largest			= scale.z > largest ? scale.z : largest;
+
+	float distance = (position - packet.view.position).Length();
+	if (distance < 0.0001f) {
+		return FLT_MAX;
+	}
+	return mesh->GetBoundingRadius() * largest * packet.lodScale / distance;
+}
+
+/*
+Each texture's taken as being stretched once across whatever it's on, so
+it needs about as many texels as the object covers pixels. The indirect
+batch's statics aren't in the active list, as the GPU culls them, but
+they're still in the CPU's frustum check, which is near enough.
+*/
+void GameTechRenderer::RequestTextureCoverage() {
+	if (!textureStreamer) {
+		return;
+	}
+	float height = (float)currentHeight;
+	for (const RenderObject* o : activeObjects) {
+		if (o->GetDefaultTexture()) {
+			textureStreamer->RequestCoverage(o->GetDefaultTexture(), ScreenSize(o, o->GetTransform()->GetMatrix().GetPositionVector()) * height);
+		}
+	}
+	if (gameWorld.GetStaticTree()) {
+		for (GameObject* o : visibleStatics) {
+			const RenderObject* g = o->GetRenderObject();
+			if (g && g->GetDefaultTexture() && g->IsStaticGeometry() && indirectBatch.Contains(g)) {
+				textureStreamer->RequestCoverage(g->GetDefaultTexture(), ScreenSize(g, g->GetTransform()->GetMatrix().GetPositionVector()) * height);
+			}
+		}
+	}
+}
+
+const GameTechRenderer::ShaderUniforms& GameTechRenderer::GetShaderUniforms(const OGLShader* shader) {
+	auto i = shaderUniforms.find(shader);
+	if (i != shaderUniforms.end()) {
+		return i->second;
+	}
+	ShaderUniforms u;
+	u.proj			= shader->GetUniformLocation("projMatrix");
+	u.view			= shader->GetUniformLocation("viewMatrix");
+	u.model			= shader->GetUniformLocation("modelMatrix");
+	u.shadow		= shader->GetUniformLocation("shadowMatrix");
+	u.colour		= shader->GetUniformLocation("objectColour");
+	u.lightPos		= shader->GetUniformLocation("lightPos");
+	u.lightColour	= shader->GetUniformLocation("lightColour");
+	u.lightRadius	= shader->GetUniformLocation("lightRadius");
+	u.cameraPos		= shader->GetUniformLocation("cameraPos");
+	u.shadowTex		= shader->GetUniformLocation("shadowTex");
+	u.mainTex		= shader->GetUniformLocation("mainTex");
+	u.joints		= shader->GetUniformLocation("joints");
+	u.lightData		= shader->GetUniformLocation("lightData");
+	u.lightClusters	= shader->GetUniformLocation("lightClusters");
+	u.lightIndices	= shader->GetUniformLocation("lightIndices");
+	u.lightCount	= shader->GetUniformLocation("lightCount");
+	u.clusterTileSize	= shader->GetUniformLocation("clusterTileSize");
+	u.clusterSlices		= shader->GetUniformLocation("clusterSlices");
+	u.clusterDepth		= shader->GetUniformLocation("clusterDepth");
+	u.submeshLayer		= shader->GetUniformLocation("submeshLayer");
+	return shaderUniforms.emplace(shader, u).first->second;
 }
 
+/*
+Works out the joints for every skinned mesh either pass can see, before
+anything's drawn, so each one is built once a frame however many submeshes
+it has. Objects sharing a mesh LOD and animation all play it in step, so
+they share a palette too. The pose is sampled between the current and next
+frame of the animation, so it doesn't step along at the animation's rate,
+and the animation keeps the last few it's sampled, for every other mesh
+(or LOD of one) playing it in step. Only what's in the packet is looked
+at, so nothing that's been culled gets a pose, and neither does a low LOD
+whose vertices are being kept from the last time it was skinned.
+*/
+void GameTechRenderer::BuildSkinningPalettes(int curFrame) {
+	for (const DrawItem& item : packet.drawItems) {
+		AddSkinningPalette(*item.object, curFrame);
+	}
+	for (const FrameObject& o : packet.shadowObjects) {
+		AddSkinningPalette(o, curFrame);
+	}
+}
+
+void GameTechRenderer::AddSkinningPalette(const FrameObject& o, int curFrame) {
+	const MeshAnimation* anim = o.animation;
+	if (!(o.features & RenderObject::Skinned) || !anim || anim->GetFrameCount() == 0) {
+		return;
+	}
+	auto inserted = packet.paletteOffsets.insert({ { o.mesh, anim }, PaletteEntry() });
+	if (!inserted.second) {
+		return;
+	}
+	if (ReusesSkinnedVertices(o.mesh, anim)) {
+		return; //Left with no joints, which RunSkinning skips, and the last vertices are drawn
+	}
+	vector<Matrix4>& jointPalette = packet.jointPalette;
+	const vector<Matrix4>& invBindPose = o.mesh->GetInverseBindPose();
+	unsigned int jointCount = o.mesh->GetJointCount();
+	jointCount = jointCount < anim->GetJointCount() ? jointCount : anim->GetJointCount();
+
+	sampledPose.resize(anim->GetJointCount());
+	anim->SamplePose((float)(curFrame % anim->GetFrameCount()) + animationBlend, sampledPose.data());
+
+	PaletteEntry& p = inserted.first->second;
+	p.offset	= (int)jointPalette.size();
+	p.count		= (int)jointCount;
+	jointPalette.resize(jointPalette.size() + jointCount);
+	Maths::MatrixArrayMultiply(sampledPose.data(), invBindPose.data(), jointPalette.data() + p.offset, jointCount);
+}
+
+void GameTechRenderer::SetPreSkinnedShader(const ShaderBase* skinning, OGLShader* preSkinned) {
+	if (preSkinned && preSkinned->LoadSuccess()) {
+		preSkinnedShaders[skinning] = preSkinned;
+	}
+	else {
+		preSkinnedShaders.erase(skinning);
+	}
+}
+
+/*
+Skins every palette built this frame on the GPU, into vertex buffers kept
+for each mesh and animation pair, which both the shadow and camera passes
+then draw from instead of skinning again in their vertex shaders. The
+mesh's own vertex buffers are read as storage buffers, so nothing needs
+copying, and the palette goes up in one go for all of them. A mesh's
+lowest LOD is only that far away, so it's skinned every few frames, and
+drawn from the last lot in between.
+*/
+void GameTechRenderer::RunSkinning() {
+	skinningFrame++;
+	if (!skinningShader || packet.paletteOffsets.empty()) {
+		return;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, paletteBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, packet.jointPalette.size() * sizeof(Matrix4), packet.jointPalette.data(), GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, paletteBuffer);
+
+	skinningShader->Bind();
+	int threads = skinningShader->GetThreadXCount();
+
+	for (const auto& p : packet.paletteOffsets) {
+		OGLMesh* mesh = (OGLMesh*)p.first.first;
+		//Packed meshes have nothing to read as storage buffers, so they're skinned in their vertex shaders
+		if (p.second.count == 0 || !mesh->HasVertexAttribute(VertexAttribute::JointWeights) || !mesh->HasVertexAttribute(VertexAttribute::JointIndices) || mesh->HasPackedVertices()) {
+			continue;
+		}
+		int vertexCount = (int)mesh->GetVertexCount();
+		bool hasNormals = mesh->HasVertexAttribute(VertexAttribute::Normals);
+
+		SkinnedVertices& out = skinnedVertices[p.first];
+		int interval = GetSkinningInterval(mesh);
+		if (interval > 1 && out.vertexCount == vertexCount && skinningFrame - out.skinnedFrame < interval) {
+			continue;
+		}
+		if (out.vertexCount != vertexCount) {
+			if (!out.positions) {
+				glGenBuffers(1, &out.positions);
+				glGenBuffers(1, &out.normals);
+			}
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, out.positions);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, vertexCount * sizeof(Vector3), nullptr, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, out.normals);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (hasNormals ? vertexCount : 1) * sizeof(Vector3), nullptr, GL_DYNAMIC_COPY);
+			out.vertexCount = vertexCount;
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh->GetAttributeBuffer(VertexAttribute::Positions));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, hasNormals ? mesh->GetAttributeBuffer(VertexAttribute::Normals) : out.normals);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mesh->GetAttributeBuffer(VertexAttribute::JointWeights));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mesh->GetAttributeBuffer(VertexAttribute::JointIndices));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, out.positions);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, out.normals);
+
+		glUniform1i(skinningUniforms[0], vertexCount);
+		glUniform1i(skinningUniforms[1], p.second.offset);
+		glUniform1i(skinningUniforms[2], hasNormals);
+
+		skinningShader->Execute((vertexCount + threads - 1) / threads);
+		out.skinnedFrame = skinningFrame;
+	}
+	skinningShader->Unbind();
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+int GameTechRenderer::GetSkinningInterval(const MeshGeometry* mesh) const {
+	const MeshGeometry* parent = mesh->GetLODParent();
+	if (parent && parent->GetLOD(parent->GetLODCount() - 1) == mesh) {
+		return LowDetailSkinInterval;
+	}
+	return 1;
+}
+
+/*
+Whether the next RunSkinning will leave this pair's vertices as they were
+last skinned, in which case there's no point working out its pose.
+*/
+bool GameTechRenderer::ReusesSkinnedVertices(const MeshGeometry* mesh, const MeshAnimation* anim) const {
+	int interval = GetSkinningInterval(mesh);
+	if (interval <= 1 || !skinningShader || ((const OGLMesh*)mesh)->HasPackedVertices()) {
+		return false;
+	}
+	auto i = skinnedVertices.find({ mesh, anim });
+	if (i == skinnedVertices.end() || i->second.skinnedFrame < 0 || i->second.vertexCount != (int)mesh->GetVertexCount()) {
+		return false;
+	}
+	return (skinningFrame + 1) - i->second.skinnedFrame < interval;
+}
+
+const GameTechRenderer::SkinnedVertices* GameTechRenderer::GetSkinnedVertices(const FrameObject& o) const {
+	if (!(o.features & RenderObject::Skinned)) {
+		return nullptr;
+	}
+	auto i = skinnedVertices.find({ o.mesh, o.animation });
+	if (i == skinnedVertices.end() || i->second.skinnedFrame < 0) {
+		return nullptr;
+	}
+	return skinningFrame - i->second.skinnedFrame < GetSkinningInterval(o.mesh) ? &i->second : nullptr;
+}
+
+//Points the bound mesh's positions and normals at its skinned copies, or back at its own
+void GameTechRenderer::BindSkinnedVertices(const MeshGeometry* mesh, const SkinnedVertices* skinned) {
+	const OGLMesh* glMesh = (const OGLMesh*)mesh;
+	if (glMesh->HasPackedVertices()) {
+		return; //never skinned here, and its attributes all share one buffer
+	}
+	glBindVertexBuffer(VertexAttribute::Positions, skinned ? skinned->positions : glMesh->GetAttributeBuffer(VertexAttribute::Positions), 0, sizeof(Vector3));
+	if (mesh->HasVertexAttribute(VertexAttribute::Normals)) {
+		glBindVertexBuffer(VertexAttribute::Normals, skinned ? skinned->normals : glMesh->GetAttributeBuffer(VertexAttribute::Normals), 0, sizeof(Vector3));
+	}
+}
+
+/*
+Everything in the static tree is drawn into its own shadow map, which is
+only redrawn when the packet says so - when the tree's changed or the
+light's moved. Each frame starts by copying that into the real shadow
+map, and then only the things that move get drawn on top. Static objects
+aren't expected to be hidden or shown again without the tree being
+rebuilt. The indirect batch's level geometry goes in the cached map too,
+all in one indirect draw.
+*/
 void GameTechRenderer::RenderShadowMap() {
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
 	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 	glViewport(0, 0, SHADOWSIZE, SHADOWSIZE);
 
 	glCullFace(GL_FRONT);
 
 	BindShader(shadowShader);
-	int mvpLocation = glGetUniformLocation(shadowShader->GetProgramID(), "mvpMatrix");
-
-	Matrix4 shadowViewMatrix = Matrix4::BuildViewMatrix(lightPosition, Vector3(0, 0, 0), Vector3(0, 1, 0));
-	Matrix4 shadowProjMatrix = Matrix4::Perspective(100.0f, 500.0f, 1, 45.0f);
+	int mvpLocation = shadowShader->GetUniformLocation(mvpMatrixID);
 
-	Matrix4 mvMatrix = shadowProjMatrix * shadowViewMatrix;
+	Matrix4 mvMatrix = packet.shadowViewProj;
 
 	shadowMatrix = biasMatrix * mvMatrix; //we'll use this one later on
 
-	for (const auto& i : activeObjects) {
-		if (i->RenderShadow()) {
-			Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-			Matrix4 mvpMatrix = mvMatrix * modelMatrix;
-			glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
-			BindMesh((*i).GetMesh());
-			int layerCount = (*i).GetMesh()->GetSubMeshCount();
-			for (int i = 0; i < layerCount; ++i) {
-				DrawBoundMesh(i);
-			}
+	if (packet.redrawStaticShadows) {
+		glBindFramebuffer(GL_FRAMEBUFFER, staticShadowFBO);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		DrawShadowCasters(packet.staticShadowObjects, mvMatrix, mvpLocation);
+
+		if (!indirectBatch.IsEmpty() && indirectShadowShader && indirectShadowShader->LoadSuccess()) {
+			BindShader(indirectShadowShader);
+			glUniformMatrix4fv(indirectShadowShader->GetUniformLocation(mvpMatrixID), 1, false, (float*)&mvMatrix);
+			indirectBatch.DrawShadows();
+			frameStats.drawCalls++;
+			frameStats.meshBinds++;
+			BindShader(shadowShader);
 		}
 	}
 
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, staticShadowFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameGraph.GetFramebuffer(shadowMapTarget));
+	glBlitFramebuffer(0, 0, SHADOWSIZE, SHADOWSIZE, 0, 0, SHADOWSIZE, SHADOWSIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frameGraph.GetFramebuffer(shadowMapTarget));
+	DrawShadowCasters(packet.shadowObjects, mvMatrix, mvpLocation);
+
 	glViewport(0, 0, currentWidth, currentHeight);
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -173,20 +1144,92 @@ void GameTechRenderer::RenderShadowMap() {
 	glCullFace(GL_BACK);
 }
 
+/*
+Runs of casters using the same mesh are drawn instanced, with each one's
+whole MVP in the instance's matrix, so the shadow pass is a draw per mesh
+rather than per object. Skinned casters, short runs, and anything past
+what the instance buffer's got room for are drawn one at a time after.
+*/
+void GameTechRenderer::DrawShadowCasters(const vector<FrameObject>& objects, const Matrix4& mvMatrix, int mvpLocation) {
+	shadowCasters.clear();
+	for (const FrameObject& o : objects) {
+		if (o.castsShadow) {
+			shadowCasters.emplace_back(&o);
+		}
+	}
+	if (shadowInstancedShader) {
+		std::sort(shadowCasters.begin(), shadowCasters.end(), [](const FrameObject* a, const FrameObject* b) { return a->mesh < b->mesh; });
+		BindShader(shadowInstancedShader);
+		size_t singles = 0;
+		for (size_t n = 0; n < shadowCasters.size();) {
+			size_t runEnd = n + 1;
+			while (runEnd < shadowCasters.size() && shadowCasters[runEnd]->mesh == shadowCasters[n]->mesh) {
+				runEnd++;
+			}
+			const int room	= MaxInstances - instanceCount;
+			size_t drawEnd	= (int)(runEnd - n) > room ? n + room : runEnd;
+			if (!(shadowCasters[n]->features & RenderObject::Skinned) && (int)(drawEnd - n) >= MinInstanceBatch) {
+				const int count = (int)(drawEnd - n);
+				int offset;
+				InstanceData* instances = AllocateInstances(count, offset);
+				for (int i = 0; i < count; ++i) {
+					instances[i].modelMatrix = mvMatrix * shadowCasters[n + i]->modelMatrix;
+				}
+				CommitInstances(instances, offset, count);
+				BindInstancedMesh(shadowCasters[n]->mesh, offset);
+				int layerCount = shadowCasters[n]->mesh->GetSubMeshCount();
+				for (int j = 0; j < layerCount; ++j) {
+					DrawBoundMesh(j, count);
+				}
+				n = drawEnd;
+			}
+			//Whatever's left of the run goes to the single draws
+			for (; n < runEnd; ++n) {
+				shadowCasters[singles++] = shadowCasters[n];
+			}
+		}
+		shadowCasters.resize(singles);
+		BindShader(shadowShader);
+	}
+
+	for (const FrameObject* c : shadowCasters) {
+		const FrameObject& o = *c;
+		Matrix4 mvpMatrix = mvMatrix * o.modelMatrix;
+		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
+		BindMesh(o.mesh);
+		const SkinnedVertices* skinned = GetSkinnedVertices(o);
+		if (skinned) {
+			BindSkinnedVertices(o.mesh, skinned);
+		}
+		int layerCount = o.mesh->GetSubMeshCount();
+		for (int i = 0; i < layerCount; ++i) {
+			DrawBoundMesh(i);
+		}
+		if (skinned) {
+			BindSkinnedVertices(o.mesh, nullptr);
+		}
+	}
+}
+
+/*
+Drawn after everything solid, on the far plane, so the depth test leaves
+it only the pixels nothing else covered, without writing any depth of its
+own.
+*/
 void GameTechRenderer::RenderSkybox() {
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_BLEND);
-	glDisable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
 
-	float screenAspect = (float)currentWidth / (float)currentHeight;
-	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
-	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
+	const Matrix4& viewMatrix = packet.view.viewMatrix;
+	const Matrix4& projMatrix = packet.view.projMatrix;
 
 	BindShader(skyboxShader);
 
-	int projLocation = glGetUniformLocation(skyboxShader->GetProgramID(), "projMatrix");
-	int viewLocation = glGetUniformLocation(skyboxShader->GetProgramID(), "viewMatrix");
-	int texLocation = glGetUniformLocation(skyboxShader->GetProgramID(), "cubeTex");
+	int projLocation = skyboxShader->GetUniformLocation(projMatrixID);
+	int viewLocation = skyboxShader->GetUniformLocation(viewMatrixID);
+	int texLocation = skyboxShader->GetUniformLocation(cubeTexID);
 
 	glUniformMatrix4fv(projLocation, 1, false, (float*)&projMatrix);
 	glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMatrix);
@@ -194,148 +1237,426 @@ void GameTechRenderer::RenderSkybox() {
 	glUniform1i(texLocation, 0);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
+	frameStats.textureBinds++;
 
 	BindMesh(skyboxMesh);
 	DrawBoundMesh();
 
 	glEnable(GL_CULL_FACE);
 	glEnable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
 }
 
-void GameTechRenderer::RenderCamera(int curFrame) {
-	float screenAspect = (float)currentWidth / (float)currentHeight;
-	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
-	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
+/*
+Everything that's the same for every shader this frame, in one uniform
+buffer. Shaders with a FrameData block read it from there, and the rest
+still get the same values as uniforms when they're bound.
+*/
+void GameTechRenderer::UpdateFrameData(const ViewData& view) {
+	FrameData data;
+	data.projMatrix		= view.projMatrix;
+	data.viewMatrix		= view.viewMatrix;
+	data.shadowMatrix	= shadowMatrix;
+	data.cameraPos		= Vector4(view.position, 1.0f);
+	data.lightPos		= Vector4(lightPosition, 1.0f);
+	data.lightColour	= lightColour;
+	data.lightRadius	= lightRadius;
+	data.time			= packet.time;
+	data.viewProjMatrix		= view.viewProj;
+	data.invViewProjMatrix	= view.invViewProj;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, frameDataBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
 
-	OGLShader* activeShader = nullptr;
-	int projLocation = 0;
-	int viewLocation = 0;
-	int modelLocation = 0;
-	int colourLocation = 0;
-	int hasVColLocation = 0;
-	int hasTexLocation = 0;
-	int shadowLocation = 0;
+const GameTechRenderer::ShaderUniforms& GameTechRenderer::BindCameraShader(OGLShader* shader, const Matrix4& viewMatrix, const Matrix4& projMatrix, const Vector3& cameraPos) {
+	BindShader(shader);
+	const ShaderUniforms& uniforms = GetShaderUniforms(shader);
 
-	int lightPosLocation = 0;
-	int lightColourLocation = 0;
-	int lightRadiusLocation = 0;
+	glUniform3fv(uniforms.cameraPos, 1, (float*)&cameraPos);
 
-	int cameraLocation = 0;
+	glUniformMatrix4fv(uniforms.proj, 1, false, (float*)&projMatrix);
+	glUniformMatrix4fv(uniforms.view, 1, false, (float*)&viewMatrix);
 
-	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, shadowTex);
+	glUniform3fv(uniforms.lightPos, 1, (float*)&lightPosition);
+	glUniform4fv(uniforms.lightColour, 1, (float*)&lightColour);
+	glUniform1f(uniforms.lightRadius, lightRadius);
 
-	for (const auto& i : activeObjects) {
-		if ((*i).GetFlag() == 4) {
-			auto k = 0;
-		}
-		OGLShader* shader = (OGLShader*)(*i).GetShader();
-		BindShader(shader);
+	glUniform1i(uniforms.shadowTex, 1);
+	glUniform1i(uniforms.mainTex, 0);
 
-		BindTextureToShader((OGLTexture*)(*i).GetDefaultTexture(), "mainTex", 0);
+	//Tiles are a fraction of whatever resolution the scene's being drawn at
+	glUniform1i(uniforms.lightData, LightGridUnit);
+	glUniform1i(uniforms.lightClusters, LightGridUnit + 1);
+	glUniform1i(uniforms.lightIndices, LightGridUnit + 2);
+	glUniform1i(uniforms.lightCount, lightGrid.GetLightCount());
+	glUniform2f(uniforms.clusterTileSize, (float)sceneWidth / LightGrid::TilesX, (float)sceneHeight / LightGrid::TilesY);
+	glUniform2f(uniforms.clusterSlices, lightGrid.GetSliceScale(), lightGrid.GetSliceBias());
+	glUniform2f(uniforms.clusterDepth, packet.view.nearPlane, packet.view.farPlane);
+	return uniforms;
+}
 
-		if (activeShader != shader) {
+/*
+How far on from first the draws can all go in one instanced batch - they
+have to share a shader, texture, mesh and pass, which the sort has put
+next to each other, and can't be anything that binds its own textures.
+*/
+size_t GameTechRenderer::GetInstanceRunEnd(size_t first) const {
+	const vector<DrawItem>& drawItems = packet.drawItems;
+	const uint64_t state = drawItems[first].key >> DepthBits;
+	size_t last = first;
+	while (last < drawItems.size() && (drawItems[last].key >> DepthBits) == state) {
+		if (BindsOwnTextures(*drawItems[last].object)) {
+			break;
+		}
+		++last;
+	}
+	return last;
+}
 
-			projLocation = glGetUniformLocation(shader->GetProgramID(), "projMatrix");
-			viewLocation = glGetUniformLocation(shader->GetProgramID(), "viewMatrix");
-			modelLocation = glGetUniformLocation(shader->GetProgramID(), "modelMatrix");
-			shadowLocation = glGetUniformLocation(shader->GetProgramID(), "shadowMatrix");
-			colourLocation = glGetUniformLocation(shader->GetProgramID(), "objectColour");
-			hasVColLocation = glGetUniformLocation(shader->GetProgramID(), "hasVertexColours");
-			hasTexLocation = glGetUniformLocation(shader->GetProgramID(), "hasTexture");
+/*
+Draws [first, last) with a single glDrawElementsInstanced per submesh,
+with each object's matrix and colour written into this frame's part of
+the instance buffer. The instance attributes are set up on each mesh's
+VAO the first time it's drawn this way. The camera, light and shadow
+matrix all come from the FrameData block, so only per-batch things are set.
+*/
+void GameTechRenderer::RenderInstanced(size_t first, size_t last, OGLShader* instanced, const OGLTexture* texture) {
+	MeshGeometry* mesh	= packet.drawItems[first].object->mesh;
+	const int count		= (int)(last - first);
+
+	int offset;
+	InstanceData* instances = AllocateInstances(count, offset);
+	for (int n = 0; n < count; ++n) {
+		const FrameObject* i = packet.drawItems[first + n].object;
+		instances[n].modelMatrix	= i->modelMatrix;
+		instances[n].layer			= (float)i->textureLayer;
+		if (i->fadeDuration > 0.0f) {
+			instances[n].colour			= i->fadeTo;
+			instances[n].fadeFrom		= i->fadeFrom;
+			instances[n].fadeStart		= i->fadeStart;
+			instances[n].fadeDuration	= i->fadeDuration;
+		}
+		else {
+			instances[n].colour			= i->colour;
+			instances[n].fadeFrom		= i->colour;
+			instances[n].fadeStart		= 0.0f;
+			instances[n].fadeDuration	= 0.0f;
+		}
+	}
+	CommitInstances(instances, offset, count);
+	BindInstancedMesh(mesh, offset);
 
-			lightPosLocation = glGetUniformLocation(shader->GetProgramID(), "lightPos");
-			lightColourLocation = glGetUniformLocation(shader->GetProgramID(), "lightColour");
-			lightRadiusLocation = glGetUniformLocation(shader->GetProgramID(), "lightRadius");
+	int layerCount = mesh->GetSubMeshCount();
+	if (!packet.drawItems[first].object->layerPerSubMesh) {
+		for (int j = 0; j < layerCount; ++j) {
+			DrawBoundMesh(j, count);
+		}
+		return;
+	}
+	//Each submesh reads its own layer of the material array, on top of the instance's
+	layerCount = texture && texture->GetLayerCount() < layerCount ? texture->GetLayerCount() : layerCount;
+	for (int j = 0; j < layerCount; ++j) {
+		glUniform1i(uniforms.submeshLayer, j);
+		DrawBoundMesh(j, count);
+	}
+	glUniform1i(uniforms.submeshLayer, 0);
+}
 
-			cameraLocation = glGetUniformLocation(shader->GetProgramID(), "cameraPos");
-			glUniform3fv(cameraLocation, 1, (float*)&gameWorld.GetMainCamera()->GetPosition());
+//Where this frame's next count instances are to be written, which is straight into the buffer if it's mapped
+GameTechRenderer::InstanceData* GameTechRenderer::AllocateInstances(int count, int& offset) {
+	offset = instanceFrame * MaxInstances + instanceCount;
+	instanceCount += count;
+	return instanceMemory ? instanceMemory + offset : instanceStaging.data();
+}
 
-			glUniformMatrix4fv(projLocation, 1, false, (float*)&projMatrix);
-			glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMatrix);
+void GameTechRenderer::CommitInstances(const InstanceData* instances, int offset, int count) {
+	if (!instanceMemory) {
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(InstanceData), count * sizeof(InstanceData), instances);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
 
-			glUniform3fv(lightPosLocation, 1, (float*)&lightPosition);
-			glUniform4fv(lightColourLocation, 1, (float*)&lightColour);
-			glUniform1f(lightRadiusLocation, lightRadius);
+void GameTechRenderer::BindInstancedMesh(MeshGeometry* mesh, int offset) {
+	BindMesh(mesh);
+	if (instancedMeshes.insert(mesh).second) {
+		//Four columns of the matrix, the colour, the layer, what it's fading from, and when
+		const GLint sizes[8]	= { 4, 4, 4, 4, 4, 1, 4, 2 };
+		const GLuint offsets[8]	= { 0, 16, 32, 48, 64, 80, 96, 84 };
+		for (int c = 0; c < 8; ++c) {
+			glEnableVertexAttribArray(InstanceSlot + c);
+			glVertexAttribFormat(InstanceSlot + c, sizes[c], GL_FLOAT, false, offsets[c]);
+			glVertexAttribBinding(InstanceSlot + c, InstanceSlot);
+		}
+		glVertexBindingDivisor(InstanceSlot, 1);
+	}
+	glBindVertexBuffer(InstanceSlot, instanceBuffer, offset * sizeof(InstanceData), sizeof(InstanceData));
+}
 
-			int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
-			glUniform1i(shadowTexLocation, 1);
+//Done once for both the depth pre-pass and the camera pass, so they draw the same LODs
+void GameTechRenderer::CullIndirectBatch() {
+	if (!indirectBatch.IsEmpty()) {
+		indirectBatch.Cull(packet.view.frustum, packet.view.position, packet.lodScale, &hiZ);
+	}
+}
 
-			activeShader = shader;
+/*
+Draws the depth of everything solid the camera can see, nearest first,
+with the shadow pass's shaders, so the camera pass's expensive fragment
+shaders only run for the surfaces that end up on screen. Skinned meshes
+are only drawn if they were skinned by the compute pass, as the shadow
+shader can't skin them itself. Everything's pushed back a touch, so the
+camera pass's own depth, worked out by different shaders, can't land
+just behind it and get thrown away.
+*/
+void GameTechRenderer::RenderDepthPrepass() {
+	if (!useDepthPrepass) {
+		return;
+	}
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.0f, 1.0f);
+
+	const Matrix4& viewProj = packet.view.viewProj;
+
+	if (!indirectBatch.IsEmpty() && indirectShadowShader && indirectShadowShader->LoadSuccess()) {
+		BindShader(indirectShadowShader);
+		glUniformMatrix4fv(indirectShadowShader->GetUniformLocation(mvpMatrixID), 1, false, (float*)&viewProj);
+		for (const IndirectBatch::Group& g : indirectBatch.GetGroups()) {
+			indirectBatch.DrawGroup(g);
+			frameStats.drawCalls++;
+			frameStats.meshBinds++;
 		}
+	}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-		glUniformMatrix4fv(modelLocation, 1, false, (float*)&modelMatrix);
+	BindShader(shadowShader);
+	int mvpLocation = shadowShader->GetUniformLocation(mvpMatrixID);
+	for (const DrawItem& d : packet.depthItems) {
+		const FrameObject& o = *d.object;
+		const SkinnedVertices* skinned = GetSkinnedVertices(o);
+		if ((o.features & RenderObject::Skinned) && (!skinned || preSkinnedShaders.find(o.shader) == preSkinnedShaders.end())) {
+			continue;
+		}
+		Matrix4 mvpMatrix = viewProj * o.modelMatrix;
+		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
+		BindMesh(o.mesh);
+		if (skinned) {
+			BindSkinnedVertices(o.mesh, skinned);
+		}
+		int layerCount = o.mesh->GetSubMeshCount();
+		for (int i = 0; i < layerCount; ++i) {
+			DrawBoundMesh(i);
+		}
+		if (skinned) {
+			BindSkinnedVertices(o.mesh, nullptr);
+		}
+	}
+	BindMesh(nullptr);
 
-		Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
-		glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
 
-		glUniform4fv(colourLocation, 1, (float*)&i->GetColour());
+/*
+The opaque half of the camera's draw items, with the lights and shadow
+map bound for both halves. The indirect batch, already culled, is drawn
+before any of them, a call per group.
+*/
+void GameTechRenderer::RenderOpaque() {
+	const Matrix4& viewMatrix	= packet.view.viewMatrix;
+	const Matrix4& projMatrix	= packet.view.projMatrix;
+	const Vector3& cameraPos	= packet.view.position;
 
-		glUniform1i(hasVColLocation, !(*i).GetMesh()->GetColourData().empty());
+	lightGrid.Build(packet.lights, viewMatrix, projMatrix, packet.view.nearPlane, packet.view.farPlane);
+	lightGrid.Bind(LightGridUnit);
 
-		glUniform1i(hasTexLocation, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D, frameGraph.GetDepthTexture(shadowMapTarget));
+	frameStats.textureBinds++;
 
-		BindMesh((*i).GetMesh());
-		int layerCount = (*i).GetMesh()->GetSubMeshCount();
-		// 8508
-		if ((*i).GetFlag() == 1)	// Player	todo:improve code style, so ugly.
-		{
+	//With the depth already laid down, only the nearest surface passes
+	if (useDepthPrepass) {
+		glDepthFunc(GL_LEQUAL);
+	}
 
-			auto tmpList = (*i).GetTextures();
-			for (int j = 0; j < layerCount; ++j) {
-				BindTexturesToShader(tmpList[j],"mainTex",0);
+	//The level geometry goes first, as it hides most of everything else
+	if (!indirectBatch.IsEmpty()) {
+		const OGLShader* activeShader = nullptr;
+		for (const IndirectBatch::Group& g : indirectBatch.GetGroups()) {
+			//Merged meshes don't keep their vertex colours
+			OGLShader* variant = g.shader->GetVariant(g.texture ? OGLShader::Texture : 0);
+			if (activeShader != variant) {
+				BindCameraShader(variant, viewMatrix, projMatrix, cameraPos);
+				activeShader = variant;
+			}
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(g.textureTarget, g.texture);
+			frameStats.textureBinds++;
+			indirectBatch.DrawGroup(g);
+			frameStats.drawCalls++; //one multi-draw, of however many the culling left
+			frameStats.meshBinds++;
+		}
+		BindMesh(nullptr);
+	}
 
-				vector<Matrix4> frameMatrices;
+	const vector<DrawItem>& drawItems = packet.drawItems;
+	//Everything's shadow matrix in one go, rather than one at a time as it's drawn
+	shadowModelMatrices.resize(drawItems.size());
+	for (size_t n = 0; n < drawItems.size(); ++n) {
+		shadowModelMatrices[n] = drawItems[n].object->modelMatrix;
+	}
+	Maths::MatrixArrayMultiply(shadowMatrix, shadowModelMatrices.data(), shadowModelMatrices.data(), shadowModelMatrices.size());
 
-				const vector<Matrix4> invBindPose = (*i).GetMesh()->GetInverseBindPose();
-				const Matrix4* frameData = (*i).GetAnimation()->GetJointData(curFrame); 
+	//Transparent items have the top bit of their keys set, so they're all at the end
+	firstTransparent = std::partition_point(drawItems.begin(), drawItems.end(),
+		[](const DrawItem& d) { return (d.key >> (64 - PassBits)) == 0; }) - drawItems.begin();
+	DrawItems(0, firstTransparent);
 
-				for (unsigned int j = 0; j < (*i).GetMesh()->GetJointCount(); ++j) {
-					frameMatrices.emplace_back(frameData[j] * invBindPose[j]);
-				}
+	glDepthFunc(GL_LESS);
+}
 
-				int k = glGetUniformLocation(boundShader->GetProgramID(), "joints");
-				glUniformMatrix4fv(k, frameMatrices.size(), false, (float*)frameMatrices.data());
+//Blended over everything solid, the sky included
+void GameTechRenderer::RenderTransparent() {
+	DrawItems(firstTransparent, packet.drawItems.size());
 
-				DrawBoundMesh(j);
-				glBindTexture(GL_TEXTURE_2D, 0);
+	BindMesh(nullptr);
+	particles.Draw();
+	if (particles.IsSupported()) {
+		frameStats.drawCalls++;
+		frameStats.shaderBinds++;
+		frameStats.meshBinds++;
+	}
+	BindShader(nullptr);
+}
+
+/*
+Objects come in sorted by state, so the shader, texture and mesh are only
+rebound when they change, and each shader's uniform locations are looked
+up once, the first time it's used. Runs of objects sharing all three are
+drawn instanced instead, where the shader has an instanced version.
+*/
+void GameTechRenderer::DrawItems(size_t first, size_t last) {
+	const Matrix4& viewMatrix	= packet.view.viewMatrix;
+	const Matrix4& projMatrix	= packet.view.projMatrix;
+	const Vector3& cameraPos	= packet.view.position;
+	const vector<DrawItem>& drawItems = packet.drawItems;
+
+	const OGLShader* activeShader = nullptr;
+	const ShaderUniforms* uniforms = nullptr;
+	const TextureBase* activeTexture = nullptr;
+	bool textureBound = false;	//a null texture is a valid one to have bound
+	const MeshGeometry* activeMesh = nullptr;
+
+	for (size_t n = first; n < last; ++n) {
+		const FrameObject& o = *drawItems[n].object;
+		MeshGeometry* mesh = o.mesh;
+		OGLShader* shader = (OGLShader*)o.shader;
+
+		auto instanced = instancedShaders.find(shader);
+		if (instanced != instancedShaders.end()) {
+			const OGLTexture* texture = (OGLTexture*)o.texture;
+			//Array textures can only be read by the array version, so even one goes through it
+			bool isArray = texture && texture->GetTarget() == GL_TEXTURE_2D_ARRAY;
+			OGLShader* variant = isArray ? instanced->second.array : instanced->second.plain;
+			if (variant) {
+				variant = variant->GetVariant(o.shaderFeatures);
+			}
+
+			size_t runEnd = GetInstanceRunEnd(n);
+			if ((int)(runEnd - n) > MaxInstances - instanceCount) {
+				runEnd = n + (MaxInstances - instanceCount);
+			}
+			if (variant && (int)(runEnd - n) >= (isArray ? 1 : MinInstanceBatch)) {
+				if (activeShader != variant) {
+					uniforms = &BindCameraShader(variant, viewMatrix, projMatrix, cameraPos);
+					activeShader = variant;
+				}
+				if (!textureBound || texture != activeTexture) {
+					glActiveTexture(GL_TEXTURE0);
+					glBindTexture(texture ? texture->GetTarget() : GL_TEXTURE_2D, texture ? texture->GetObjectID() : 0);
+					frameStats.textureBinds++;
+					activeTexture = texture;
+					textureBound = true;
+				}
+				RenderInstanced(n, runEnd, variant, texture);
+				activeMesh = mesh;
+				n = runEnd - 1;
+				continue;
 			}
 		}
-		else if ((*i).GetFlag() == 3) // Wall
-		{
-			auto tmpList = (*i).GetTextures();
-			for (int j = 0; j < layerCount; ++j) {
-				BindTexturesToShader(tmpList[j], "mainTex", 0); 
-				DrawBoundMesh(j);
-				glBindTexture(GL_TEXTURE_2D, 0);
+
+		const SkinnedVertices* skinned = GetSkinnedVertices(o);
+		if (skinned) {
+			auto preSkinned = preSkinnedShaders.find(shader);
+			if (preSkinned != preSkinnedShaders.end()) {
+				shader = preSkinned->second;
+			}
+			else {
+				skinned = nullptr; //the shader would skin it again
 			}
 		}
-		else if ((*i).GetFlag() == 4) // Collider
-		{
-			if (Debug::GetShowCollisionMeshes()) {
-				for (int j = 0; j < layerCount; ++j) {
-					DrawBoundMesh(j);
-					glBindTexture(GL_TEXTURE_2D, 0);
-				}
+		shader = shader->GetVariant(o.shaderFeatures);
+
+		if (activeShader != shader) {
+			uniforms = &BindCameraShader(shader, viewMatrix, projMatrix, cameraPos);
+			activeShader = shader;
+		}
+
+		const OGLTexture* texture = (OGLTexture*)o.texture;
+		if (!textureBound || texture != activeTexture) {
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(texture ? texture->GetTarget() : GL_TEXTURE_2D, texture ? texture->GetObjectID() : 0);
+			frameStats.textureBinds++;
+			activeTexture = texture;
+			textureBound = true;
+		}
+
+		glUniformMatrix4fv(uniforms->model, 1, false, (float*)&o.modelMatrix);
+
+		glUniformMatrix4fv(uniforms->shadow, 1, false, (float*)&shadowModelMatrices[n]);
+
+		glUniform4fv(uniforms->colour, 1, (float*)&o.colour);
+
+		if (activeMesh != mesh) {
+			BindMesh(mesh);
+			activeMesh = mesh;
+		}
+		int layerCount = mesh->GetSubMeshCount();
+		if (o.features & RenderObject::Skinned) {
+			auto palette = packet.paletteOffsets.find({ mesh, o.animation });
+			if (skinned) {
+				BindSkinnedVertices(mesh, skinned);
+			}
+			else if (palette != packet.paletteOffsets.end() && palette->second.count > 0) {
+				const PaletteEntry& p = palette->second;
+				glUniformMatrix4fv(uniforms->joints, p.count, false, (float*)&packet.jointPalette[p.offset]);
 			}
 		}
+		if (BindsOwnTextures(o)) {
+			const unsigned int* tmpList = packet.textureIDs.data() + o.firstTexture;
+			for (int j = 0; j < layerCount && j < o.textureCount; ++j) {
+				BindTexturesToShader(tmpList[j], mainTexID, 0);
+				DrawBoundMesh(j);
+			}
+			textureBound = false;
+		}
 		else {
+			//Colliders are only in the list when they're being shown
 			for (int j = 0; j < layerCount; ++j) {
 				DrawBoundMesh(j);
-				glBindTexture(GL_TEXTURE_2D, 0);
 			}
 		}
+		if (skinned) {
+			BindSkinnedVertices(mesh, nullptr);
+		}
 	}
 }
 
 Matrix4 GameTechRenderer::SetupDebugLineMatrix()	const {
-	float screenAspect = (float)currentWidth / (float)currentHeight;
-	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
-	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
-
-	return projMatrix * viewMatrix;
+	return packet.view.viewProj;
 }
 
 Matrix4 GameTechRenderer::SetupDebugStringMatrix()	const {
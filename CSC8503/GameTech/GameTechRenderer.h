@@ -3,12 +3,23 @@
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
 #include "../../Plugins/OpenGLRendering/OGLTexture.h"
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
+#include "../../Plugins/OpenGLRendering/OGLComputeShader.h"
 #include "../CSC8503Common/GameWorld.h"
 #include "gameui.h"
+#include "IndirectBatch.h"
+#include "HiZBuffer.h"
+#include "GPUParticles.h"
+#include "GPUTimer.h"
+#include "LightGrid.h"
+#include "FramePacket.h"
+#include "FrameGraph.h"
 class GameUI;
 // 8508 added
 #include "../../Common/Assets.h"
 #include "../../Common/MeshMaterial.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
 //#include "../../Plugins/SOIL/SOIL.h"
 
 namespace NCL {
@@ -16,6 +27,9 @@ namespace NCL {
 	class Maths::Vector4;
 	namespace CSC8503 {
 		class RenderObject;
+		class PaintDecals;
+		class PaintParticles;
+		class TextureStreamer;
 
 		class GameTechRenderer : public OGLRenderer	{
 		public:
@@ -23,6 +37,72 @@ namespace NCL {
 			~GameTechRenderer();
 
 			void SetUI(const GameUI* ui) { gameui = ui; };//imgui here
+
+			//How far physics is into its next step, used to smooth out object movement
+			void SetInterpolationAlpha(float a) { interpolationAlpha = a; }
+
+			//Paint on surfaces isn't in the world, so it's handed over separately
+			void SetPaintDecals(const PaintDecals* d) { paintDecals = d; }
+
+			//The renderer takes each frame's bursts from here, and makes the particles itself
+			void SetPaintParticles(PaintParticles* p);
+
+			//Every light besides the sun, which is the only one casting shadows
+			void SetDynamicLights(const DynamicLights* l) { dynamicLights = l; }
+
+			//Told how much of the screen its textures cover each frame, and updated
+			//before each is drawn
+			void SetTextureStreamer(TextureStreamer* s) { textureStreamer = s; }
+
+			//How far the animations are between their current frame and the next
+			void SetAnimationBlend(float b) { animationBlend = b < 0.0f ? 0.0f : (b > 1.0f ? 1.0f : b); }
+
+			//Objects using shader get drawn in batches with instanced, which takes
+			//its model matrix and colour per instance instead of as uniforms. Ones
+			//with an array texture use instancedArray, which picks a layer too
+			void SetInstancedShader(const ShaderBase* shader, OGLShader* instanced, OGLShader* instancedArray = nullptr);
+
+			//Objects using skinning get skinned once a frame by a compute shader, and
+			//drawn from the result with preSkinned, which mustn't skin them again
+			void SetPreSkinnedShader(const ShaderBase* skinning, OGLShader* preSkinned);
+
+			//Static level geometry using shader gets merged into the indirect batch,
+			//and drawn with indirect, which reads its matrix and colour from there
+			void SetIndirectShader(const ShaderBase* shader, OGLShader* indirect);
+
+			/*
+			Copies what's needed from the world into the frame packet, which
+			Render then draws from without looking at the world again, so the
+			next frame can be simulated while it's being drawn. Rendering
+			without a packet taken takes one first.
+			*/
+			void ExtractFrame(int curFrame);
+
+			bool HasPendingFrame() const {
+				return packetPending;
+			}
+
+			//The camera's view as it was when the last frame was taken
+			const ViewData& GetViewData() const {
+				return packet.view;
+			}
+
+			/*
+			With a target set, the scene is drawn at whatever fraction of the
+			window's resolution keeps the GPU's frame time under it, and scaled
+			back up before the UI goes on top at full resolution. 0 turns it off,
+			always drawing at full resolution.
+			*/
+			void SetTargetFrameTime(float ms) { targetFrameTime = ms; }
+
+			void SetMinResolutionScale(float s) { minResolutionScale = s; }
+
+			float GetResolutionScale() const {
+				return resolutionScale;
+			}
+
+			//Lays down the scene's depth before shading it, so each pixel is only shaded once
+			void UseDepthPrepass(bool state) { useDepthPrepass = state; }
 			
 		protected:
 			void RenderFrame(int curFrame)	override;
@@ -35,14 +115,203 @@ namespace NCL {
 			GameWorld&	gameWorld;
 
 			void BuildObjectList();
+			Matrix4 BuildShadowViewProjection() const;
+			void BuildStaticShadowList(bool force);
+			void CopyToPacket(const vector<const RenderObject*>& objects, vector<FrameObject>& into, bool useLODs, bool forShadows = false);
+			const TextureBase* GetMaterialArray(const ShaderBase* shader, const std::vector<unsigned int>& textures);
 			void SortObjectList();
 			void RenderShadowMap();
-			void RenderCamera(int curFrame); 
+			void DrawShadowCasters(const vector<FrameObject>& objects, const Matrix4& mvMatrix, int mvpLocation);
+			void CreateShadowTarget(GLuint& tex, GLuint& fbo);
+			void CullIndirectBatch();
+			void RenderDepthPrepass();
+			void RenderOpaque();
 			void RenderSkybox();
+			void RenderTransparent();
+			void DrawItems(size_t first, size_t last);
 			
 			void LoadSkybox();
 
-			vector<const RenderObject*> activeObjects;
+			FramePacket	packet;
+			bool		packetPending = false; //taken, but not drawn yet
+
+			vector<const RenderObject*> activeObjects;	//what the camera can see
+			vector<const RenderObject*> shadowObjects;	//what the light can see that moves
+			vector<const RenderObject*> staticShadowObjects;
+			vector<GameObject*>			visibleStatics; //kept between frames so it doesn't reallocate
+			float						cullMargin = 1.0f;
+
+			//How many bits of the draw key each part gets, from the top down
+			static const int PassBits		= 2;
+			static const int ShaderBits		= 8;
+			static const int FeatureBits	= OGLShader::FeatureCount;	//which variant of the shader
+			static const int TextureBits	= 14;
+			static const int MeshBits		= 14;
+			static const int DepthBits		= 64 - PassBits - ShaderBits - FeatureBits - TextureBits - MeshBits;
+
+			//Which of o's mesh's LODs suits its size on screen, at position - in
+			//world space, which a parented transform's GetPosition isn't
+			MeshGeometry* SelectMesh(const RenderObject* o, const Vector3& position) const;
+			//Of the screen's height, or FLT_MAX if the camera's right on top of it
+			float ScreenSize(const RenderObject* o, const Vector3& position) const;
+			//For everything the camera can see, batched statics included
+			void RequestTextureCoverage();
+
+			static uint64_t GetStateID(std::unordered_map<const void*, uint64_t>& ids, const void* state, int bits);
+
+			vector<DrawItem> sortScratch;
+			bool			 useDepthPrepass = true;
+			std::unordered_map<const void*, uint64_t> shaderIDs;
+			std::unordered_map<const void*, uint64_t> textureIDs;
+			std::unordered_map<const void*, uint64_t> meshIDs;
+
+			struct ShaderUniforms {
+				int proj;
+				int view;
+				int model;
+				int shadow;
+				int colour;
+				int lightPos;
+				int lightColour;
+				int lightRadius;
+				int cameraPos;
+				int shadowTex;
+				int mainTex;
+				int joints;
+			};
+			const ShaderUniforms& GetShaderUniforms(const OGLShader* shader);
+			const ShaderUniforms& BindCameraShader(OGLShader* shader, const Matrix4& viewMatrix, const Matrix4& projMatrix, const Vector3& cameraPos);
+			std::unordered_map<const OGLShader*, ShaderUniforms> shaderUniforms;
+
+			void BuildSkinningPalettes(int curFrame);
+
+			float			animationBlend = 0.0f;
+
+			void AddSkinningPalette(const FrameObject& o, int curFrame);
+			vector<Matrix4>	sampledPose;
+
+			struct SkinnedVertices {
+				GLuint	positions		= 0;
+				GLuint	normals			= 0;
+				int		vertexCount		= 0;
+				int		skinnedFrame	= -1; //only used if it was skinned this frame
+			};
+			void RunSkinning();
+			const SkinnedVertices* GetSkinnedVertices(const FrameObject& o) const;
+			void BindSkinnedVertices(const MeshGeometry* mesh, const SkinnedVertices* skinned);
+			int GetSkinningInterval(const MeshGeometry* mesh) const;
+			bool ReusesSkinnedVertices(const MeshGeometry* mesh, const MeshAnimation* anim) const;
+
+			static const int LowDetailSkinInterval = 2; //frames between skinning a mesh's lowest LOD
+
+			OGLComputeShader*	skinningShader	= nullptr;
+			GLuint				paletteBuffer	= 0;
+			int					skinningUniforms[3] = {}; //vertexCount, jointOffset, hasNormals
+			int					skinningFrame	= 0;
+			std::map<std::pair<const MeshGeometry*, const MeshAnimation*>, SkinnedVertices> skinnedVertices;
+			std::unordered_map<const ShaderBase*, OGLShader*> preSkinnedShaders;
+
+			//Laid out to match the FrameData block's std140 layout
+			struct FrameData {
+				Matrix4 projMatrix;
+				Matrix4 viewMatrix;
+				Matrix4 shadowMatrix;
+				Vector4 cameraPos;
+				Vector4 lightPos;
+				Vector4 lightColour;
+				float	lightRadius;
+				float	time;
+				float	padding[2];
+				Matrix4 viewProjMatrix;
+				Matrix4 invViewProjMatrix;
+			};
+			void UpdateFrameData(const ViewData& view);
+			GLuint frameDataBuffer = 0;
+
+			//What each instance gets, in the vertex attributes from InstanceSlot up.
+			//colour is what it fades to from fadeFrom, which it's already at if fadeDuration is 0
+			struct InstanceData {
+				Matrix4 modelMatrix;
+				Vector4 colour;
+				float	layer;
+				float	fadeStart;
+				float	fadeDuration;
+				float	padding;
+				Vector4 fadeFrom;
+			};
+			static const int InstanceSlot		= 8;	//past all of the mesh's own attributes
+			static const int MaxInstances		= 8192; //per frame, with anything past that drawn one at a time
+			static const int InstanceFrames		= 3;	//how far behind the GPU can be before we wait for it
+			static const int MinInstanceBatch	= 2;
+
+			void CreateInstanceBuffer();
+			void BeginInstanceFrame();
+			void EndInstanceFrame();
+			size_t GetInstanceRunEnd(size_t first) const;
+			void RenderInstanced(size_t first, size_t last, OGLShader* instanced, const OGLTexture* texture);
+			InstanceData* AllocateInstances(int count, int& offset);
+			void CommitInstances(const InstanceData* instances, int offset, int count);
+			void BindInstancedMesh(MeshGeometry* mesh, int offset);
+
+			struct InstancedShaders {
+				OGLShader* plain = nullptr;
+				OGLShader* array = nullptr;
+			};
+			std::unordered_map<const ShaderBase*, InstancedShaders> instancedShaders;
+
+			//Each list of per-submesh textures copied into one array, so objects using
+			//them can be drawn instanced, picking each submesh's layer by index.
+			//nullptr for lists that couldn't be, which are bound one at a time instead
+			std::map<std::vector<unsigned int>, TextureBase*> materialArrays;
+			std::unordered_set<const MeshGeometry*> instancedMeshes; //which VAOs have the instance attributes set up
+
+			GLuint					instanceBuffer	= 0;
+			InstanceData*			instanceMemory	= nullptr; //persistently mapped, if the driver can
+			vector<InstanceData>	instanceStaging;		   //otherwise they're built here and copied over
+			GLsync					instanceFences[InstanceFrames] = {};
+			int						instanceFrame	= 0;
+			int						instanceCount	= 0;	   //used so far this frame
+
+			void RebuildIndirectBatch();
+			void CaptureHiZ();
+
+			void GatherLights();
+
+			LightGrid	lightGrid;
+			static const int LightGridUnit = 2; //and the two after it, past the main and shadow textures
+
+			void BuildFrameGraph();
+			void UpdateResolutionScale();
+			void BindSceneTarget();
+			void ResolveScene();
+
+			FrameGraph				frameGraph;
+			FrameGraph::Resource	sceneTarget		= -1; //the screen, at full resolution
+			FrameGraph::Resource	shadowMapTarget	= -1;
+			size_t					firstTransparent = 0; //of this frame's draw items
+
+			int			sceneWidth		= 0; //what this frame's scene is drawn at
+			int			sceneHeight		= 0;
+
+			float		targetFrameTime		= 0.0f;
+			float		minResolutionScale	= 0.5f;
+			float		resolutionScale		= 1.0f;
+			float		smoothedFrameTime	= -1.0f;
+			int			resolutionChangeFrame	= -1; //GPU times from before this are for the old scale
+			int			resolutionTimedFrame	= -1; //the last GPU time looked at
+			int			resolutionTimedCount	= 0;  //how many have been since the scale changed
+
+			HiZBuffer		hiZ; //last frame's depth, for occlusion culling
+
+			GPUParticles	particles;
+
+			GPUTimer		gpuTimer; //each pass, for the profiler
+
+			IndirectBatch	indirectBatch;
+			OGLShader*		indirectShadowShader = nullptr;
+			int				indirectVersion = -1; //the world's static version the batch was built from
+			std::unordered_map<const ShaderBase*, OGLShader*> indirectShaders;
+			vector<const RenderObject*> indirectObjects;
 
 			OGLShader*  skyboxShader;
 			OGLMesh*	skyboxMesh;
@@ -50,14 +319,28 @@ namespace NCL {
 
 			//shadow mapping things
 			OGLShader*	shadowShader;
-			GLuint		shadowTex;
-			GLuint		shadowFBO;
+			OGLShader*	shadowInstancedShader;				//null if it couldn't be loaded
+			vector<const FrameObject*>	shadowCasters;		//reused by DrawShadowCasters
 			Matrix4     shadowMatrix;
+			vector<Matrix4>	shadowModelMatrices;	//shadowMatrix * each draw item's model matrix
+
+			//the static tree's shadows, kept until it changes or the light moves
+			GLuint		staticShadowTex;
+			GLuint		staticShadowFBO;
+			Matrix4		staticShadowViewProj;
+			int			staticShadowVersion = -1;
 
 			Vector4		lightColour;
 			float		lightRadius;
 			Vector3		lightPosition;
 
+			float		interpolationAlpha;
+
+			const PaintDecals* paintDecals = nullptr;
+			PaintParticles*	paintParticles = nullptr;
+			const DynamicLights* dynamicLights = nullptr;
+			TextureStreamer* textureStreamer = nullptr;
+
 			const GameUI* gameui = nullptr;//imgui here
 
 		};
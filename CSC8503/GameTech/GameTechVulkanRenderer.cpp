@@ -0,0 +1,347 @@
+#ifdef USEVULKAN
+#include "GameTechVulkanRenderer.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/JobSystem.h"
+#include "../../Common/Camera.h"
+#include "../CSC8503Common/Frustum.h"
+#include "../CSC8503Common/CollisionVolume.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace CSC8503;
+
+GameTechVulkanRenderer::GameTechVulkanRenderer(GameWorld& world) : VulkanRenderer(*Window::GetWindow()), gameWorld(world) {
+	lightColour		= Vector4(0.8f, 0.8f, 0.5f, 1.0f);
+	lightRadius		= 1000.0f;
+	lightPosition	= Vector3(-200.0f, 60.0f, -200.0f);
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	InitThreadCommandPools(jobs ? jobs->GetWorkerCount() : 1);
+
+	objectShader = VulkanShaderBuilder()
+		.WithVertexBinary("GameTechVK.vert.spv")
+		.WithFragmentBinary("GameTechVK.frag.spv")
+		.WithDebugName("GameTech Objects")
+		.Build(*this);
+
+	frameLayout = VulkanDescriptorSetLayoutBuilder()
+		.WithDynamicUniformBuffers(1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
+		.WithDebugName("Frame Data")
+		.Build(*this);
+
+	materialLayout = VulkanDescriptorSetLayoutBuilder()
+		.WithSamplers(1, vk::ShaderStageFlagBits::eFragment)
+		.WithDebugName("Material")
+		.Build(*this);
+
+	FrameUniforms blank;
+	InitUniformBuffer(frameUniforms, &blank, sizeof(FrameUniforms));
+	frameDescriptor = BuildDescriptorSet(frameLayout);
+	vk::WriteDescriptorSet uniformWrite = vk::WriteDescriptorSet()
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setDstSet(frameDescriptor)
+		.setDstBinding(0)
+		.setDescriptorCount(1)
+		.setPBufferInfo(&frameUniforms.descriptorInfo);
+	device.updateDescriptorSets(1, &uniformWrite, 0, nullptr);
+
+	defaultSampler = device.createSampler(vk::SamplerCreateInfo()
+		.setMagFilter(vk::Filter::eLinear)
+		.setMinFilter(vk::Filter::eLinear)
+		.setMipmapMode(vk::SamplerMipmapMode::eLinear)
+		.setAddressModeU(vk::SamplerAddressMode::eRepeat)
+		.setAddressModeV(vk::SamplerAddressMode::eRepeat)
+		.setAddressModeW(vk::SamplerAddressMode::eRepeat)
+		.setMaxLod(16.0f));
+
+	blankTexture = VulkanTexture::GenerateColourTexture(1, 1, "Blank");
+}
+
+GameTechVulkanRenderer::~GameTechVulkanRenderer() {
+	if (!PipelinesReady()) {
+		JobSystem::GetJobSystem()->WaitForAll(); //those jobs write into this
+	}
+	device.waitIdle();
+	for (auto& i : pipelines) {
+		device.destroyPipeline(i.second.pipeline);
+		device.destroyPipelineLayout(i.second.layout);
+	}
+	device.destroySampler(defaultSampler);
+	DestroyUniformBuffer(frameUniforms);
+	device.destroyDescriptorSetLayout(frameLayout);
+	device.destroyDescriptorSetLayout(materialLayout);
+	delete blankTexture;
+	delete objectShader;
+}
+
+void GameTechVulkanRenderer::ExtractFrame(int curFrame) {
+	packet.Clear();
+
+	float screenAspect		= (float)currentWidth / (float)currentHeight;
+	Camera* camera			= gameWorld.GetMainCamera();
+	packet.curFrame			= curFrame;
+	packet.view.Build(*camera, screenAspect);
+	packet.lodScale			= packet.view.projMatrix.array[5];
+
+	BuildObjectList();
+	for (const RenderObject* o : activeObjects) {
+		FrameObject f;
+		f.modelMatrix	= o->GetTransform()->GetInterpolatedMatrix(interpolationAlpha);
+		f.colour		= o->GetColourAt((float)gameWorld.GetWorldTime());
+		f.mesh			= o->GetMesh();
+		f.shader		= o->GetShader();
+		f.texture		= o->GetDefaultTexture();
+		f.animation		= o->GetAnimation();
+		f.features		= o->GetFeatures();
+		f.shaderFeatures	= 0; //its pipelines aren't specialised
+		f.textureLayer	= o->GetTextureLayer();
+		f.firstTexture	= 0;
+		f.textureCount	= 0;
+		f.castsShadow	= o->RenderShadow();
+		f.layerPerSubMesh = false;
+		f.fadeDuration	= 0.0f;
+		packet.cameraObjects.emplace_back(f);
+	}
+	SortObjectList();
+	packetPending = true;
+}
+
+//Everything the camera can see, without the GL path's occlusion culling
+void GameTechVulkanRenderer::BuildObjectList() {
+	activeObjects.clear();
+	const Frustum& cameraFrustum = packet.view.frustum;
+
+	gameWorld.OperateOnContents(
+		[&](GameObject* o) {
+			const RenderObject* g = o->GetRenderObject();
+			if (!o->IsActive() || !g || !g->GetMesh()) {
+				return;
+			}
+			Vector3 halfSize;
+			if (!o->GetBroadphaseAABB(halfSize)) {
+				activeObjects.emplace_back(g);
+				return;
+			}
+			Vector3 position = o->GetTransform().GetPosition() + o->GetBoundingVolume()->GetOffset();
+			if (cameraFrustum.AABBInside(position, halfSize)) {
+				activeObjects.emplace_back(g);
+			}
+		}
+	);
+}
+
+/*
+The same order as the GL path: opaque before transparent, then by
+texture and mesh so binds are skipped, then front to back, or back to
+front for transparent objects.
+*/
+void GameTechVulkanRenderer::SortObjectList() {
+	std::vector<DrawItem>& drawItems = packet.drawItems;
+	drawItems.clear();
+
+	float farPlane = packet.view.farPlane;
+	const uint64_t maxDepth = (1ull << 24) - 1;
+
+	for (const FrameObject& o : packet.cameraObjects) {
+		bool transparent	= o.colour.w < 1.0f;
+		float distance		= (o.modelMatrix.GetPositionVector() - packet.view.position).Length() / farPlane;
+		uint64_t depth		= (uint64_t)((distance < 0.0f ? 0.0f : (distance > 1.0f ? 1.0f : distance)) * (float)maxDepth);
+		if (transparent) {
+			depth = maxDepth - depth;
+		}
+		uint64_t key = (uint64_t)(transparent ? 1 : 0) << 63;
+		key |= ((uint64_t)(uintptr_t)o.texture & 0x7FFF)	<< 39;
+		key |= ((uint64_t)(uintptr_t)o.mesh & 0x7FFF)		<< 24;
+		key |= depth;
+		drawItems.push_back({ key, &o });
+	}
+	std::sort(drawItems.begin(), drawItems.end(),
+		[](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+}
+
+/*
+Shader modules are shared, but a pipeline's vertex input isn't, so each
+vertex layout gets its own. A mesh's attributes always take the same
+locations, so which it has is enough to tell layouts apart.
+*/
+uint32_t GameTechVulkanRenderer::GetPipelineKey(VulkanMesh* mesh, bool transparent) {
+	uint32_t key = transparent ? 0x80000000 : 0;
+	for (const auto& a : mesh->GetVertexSpecification()->attributes) {
+		key |= 1u << a.location;
+	}
+	return key;
+}
+
+VulkanPipelineBuilder GameTechVulkanRenderer::GetPipelineBuilder(VulkanMesh* mesh, bool transparent) {
+	return VulkanPipelineBuilder()
+		.WithVertexSpecification(mesh->GetVertexSpecification())
+		.WithShaderState(objectShader)
+		.WithDepthState(vk::CompareOp::eLessOrEqual, true, !transparent)
+		.WithBlendState(vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, transparent)
+		.WithRaster(vk::CullModeFlagBits::eBack)
+		.WithPushConstant(vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(ObjectConstants)))
+		.WithDescriptorSetLayout(frameLayout)
+		.WithDescriptorSetLayout(materialLayout)
+		.WithPass(defaultRenderPass)
+		.WithDebugName(transparent ? "GameTech Transparent" : "GameTech Opaque");
+}
+
+/*
+Meant to be called while loading, once the meshes are uploaded. Each
+pipeline the level will need is built by a job, and what's been built
+before comes out of the pipeline cache, so none of it's left for the
+first frame of a match to do.
+*/
+void GameTechVulkanRenderer::PrecompilePipelines(const std::vector<MeshGeometry*>& meshes) {
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	for (MeshGeometry* m : meshes) {
+		VulkanMesh* mesh = (VulkanMesh*)m;
+		if (!mesh || !mesh->GetVertexBuffer()) {
+			continue;
+		}
+		for (int transparent = 0; transparent < 2; ++transparent) {
+			uint32_t key = GetPipelineKey(mesh, transparent == 1);
+			{
+				std::lock_guard<std::mutex> lock(pipelineMutex);
+				if (pipelines.count(key) || !queuedPipelines.insert(key).second) {
+					continue;
+				}
+			}
+			VulkanPipelineBuilder builder = GetPipelineBuilder(mesh, transparent == 1);
+			JobSystem::JobFunc build = [this, builder, key]() mutable {
+				VulkanPipeline pipeline = builder.Build(*this);
+				std::lock_guard<std::mutex> lock(pipelineMutex);
+				pipelines.insert({ key, pipeline });
+				queuedPipelines.erase(key);
+			};
+			if (jobs) {
+				jobs->Submit(build);
+			}
+			else {
+				build();
+			}
+		}
+	}
+}
+
+bool GameTechVulkanRenderer::PipelinesReady() {
+	std::lock_guard<std::mutex> lock(pipelineMutex);
+	return queuedPipelines.empty();
+}
+
+//Pipelines aren't ever removed, so what's returned stays put while others are added
+VulkanPipeline& GameTechVulkanRenderer::GetPipeline(VulkanMesh* mesh, bool transparent) {
+	uint32_t key = GetPipelineKey(mesh, transparent);
+	std::unique_lock<std::mutex> lock(pipelineMutex);
+	auto found = pipelines.find(key);
+	if (found != pipelines.end()) {
+		return found->second;
+	}
+	if (queuedPipelines.count(key)) {
+		lock.unlock();
+		JobSystem::GetJobSystem()->WaitForAll(); //it's already on its way, so it's quicker to wait than build another
+		lock.lock();
+		return pipelines.find(key)->second;
+	}
+	lock.unlock();
+	VulkanPipeline pipeline = GetPipelineBuilder(mesh, transparent).Build(*this);
+	lock.lock();
+	return pipelines.insert({ key, pipeline }).first->second;
+}
+
+vk::DescriptorSet GameTechVulkanRenderer::GetMaterial(const FrameObject& o) {
+	VulkanTexture* t = (VulkanTexture*)o.texture;
+	return GetTextureDescriptorSet(t ? t : blankTexture, materialLayout, defaultSampler);
+}
+
+//Anything that could create Vulkan objects is done here, before the jobs start
+void GameTechVulkanRenderer::PrepareDraws() {
+	drawPipelines.clear();
+	drawMaterials.clear();
+	for (const DrawItem& d : packet.drawItems) {
+		VulkanMesh* mesh = (VulkanMesh*)d.object->mesh;
+		if (!mesh->GetVertexBuffer()) {
+			drawPipelines.emplace_back(nullptr);
+			drawMaterials.emplace_back(vk::DescriptorSet());
+			continue;
+		}
+		drawPipelines.emplace_back(&GetPipeline(mesh, d.object->colour.w < 1.0f));
+		drawMaterials.emplace_back(GetMaterial(*d.object));
+	}
+}
+
+void GameTechVulkanRenderer::RecordDraws(vk::CommandBuffer& buffer, int first, int last) {
+	VulkanPipeline*		boundPipeline = nullptr;
+	vk::DescriptorSet	boundMaterial;
+	uint32_t			frameOffset = GetUniformOffset(frameUniforms);
+	for (int i = first; i < last; ++i) {
+		VulkanPipeline* pipeline = drawPipelines[i];
+		if (!pipeline) {
+			continue;
+		}
+		const FrameObject& o = *packet.drawItems[i].object;
+		if (pipeline != boundPipeline) {
+			buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->pipeline);
+			buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->layout, 0, 1, &frameDescriptor, 1, &frameOffset);
+			boundPipeline = pipeline;
+			boundMaterial = vk::DescriptorSet();
+		}
+		if (drawMaterials[i] != boundMaterial) {
+			buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->layout, 1, 1, &drawMaterials[i], 0, nullptr);
+			boundMaterial = drawMaterials[i];
+		}
+		ObjectConstants constants;
+		constants.modelMatrix	= o.modelMatrix;
+		constants.colour		= o.colour;
+		constants.hasTexture	= o.texture ? 1 : 0;
+		buffer.pushConstants(pipeline->layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(ObjectConstants), &constants);
+
+		SubmitDrawCall((VulkanMesh*)o.mesh, buffer);
+	}
+}
+
+/*
+Each run of draws is recorded by whichever worker picks it up, from that
+worker's own pool, and put back in its place in the list so they're
+executed in the order they were sorted.
+*/
+void GameTechVulkanRenderer::RenderFrame(int curFrame) {
+	if (!packetPending) {
+		ExtractFrame(curFrame);
+	}
+	packetPending = false;
+
+	FrameUniforms uniforms;
+	uniforms.viewProjMatrix = packet.view.viewProj;
+	uniforms.cameraPos		= Vector4(packet.view.position, 1.0f);
+	uniforms.lightPos		= Vector4(lightPosition, lightRadius);
+	uniforms.lightColour	= lightColour;
+	UpdateUniformBuffer(frameUniforms, &uniforms, sizeof(FrameUniforms));
+
+	PrepareDraws();
+
+	int drawCount	= (int)packet.drawItems.size();
+	int runCount	= (drawCount + DrawsPerCommandBuffer - 1) / DrawsPerCommandBuffer;
+	recordedBuffers.resize(runCount);
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	auto recordRuns = [&](int first, int last, int worker) {
+		for (int run = first; run < last; ++run) {
+			int firstDraw	= run * DrawsPerCommandBuffer;
+			int lastDraw	= firstDraw + DrawsPerCommandBuffer < drawCount ? firstDraw + DrawsPerCommandBuffer : drawCount;
+			vk::CommandBuffer buffer = BeginSecondaryCmdBuffer(worker);
+			RecordDraws(buffer, firstDraw, lastDraw);
+			buffer.end();
+			recordedBuffers[run] = buffer;
+		}
+	};
+	if (jobs && GetThreadPoolCount() >= jobs->GetWorkerCount()) {
+		jobs->ParallelFor(runCount, 1, recordRuns);
+	}
+	else {
+		recordRuns(0, runCount, 0);
+	}
+	ExecuteSecondaryCmdBuffers(recordedBuffers);
+}
+#endif
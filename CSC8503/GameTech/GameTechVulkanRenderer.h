@@ -0,0 +1,111 @@
+#pragma once
+#ifdef USEVULKAN
+#include "../../Plugins/VulkanRendering/VulkanRenderer.h"
+#include "../../Plugins/VulkanRendering/VulkanPipelineBuilder.h"
+#include "../../Plugins/VulkanRendering/VulkanDescriptorSetLayoutBuilder.h"
+#include "../../Plugins/VulkanRendering/VulkanShaderBuilder.h"
+#include "../CSC8503Common/GameWorld.h"
+#include "FramePacket.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Draws the same FramePacket as the GL renderer, so the world's
+		extracted into the same format whichever is in use. The sorted draw
+		list is cut into runs, and each run is recorded into its own
+		secondary command buffer by a job, so recording is spread over every
+		core instead of being bound by the driver the way GL's draw calls
+		are. The primary buffer only has to execute them, in order. Every
+		texture gets a descriptor set the first time it's drawn with, which
+		is kept, so nothing's written to a descriptor once it's in use.
+
+		Only the camera pass is drawn so far - there's no skinning, shadow
+		map or UI here yet, and objects with a texture per submesh are drawn
+		with their default texture.
+		*/
+		class GameTechVulkanRenderer : public VulkanRenderer {
+		public:
+			GameTechVulkanRenderer(GameWorld& world);
+			~GameTechVulkanRenderer();
+
+			void SetInterpolationAlpha(float alpha) {
+				interpolationAlpha = alpha;
+			}
+
+			//Takes everything needed to draw the world as it is now
+			void ExtractFrame(int curFrame);
+
+			bool HasPendingFrame() const {
+				return packetPending;
+			}
+
+			//Builds every pipeline these meshes need on the job system, without waiting
+			void PrecompilePipelines(const std::vector<MeshGeometry*>& meshes);
+			bool PipelinesReady();
+
+		protected:
+			void RenderFrame(int curFrame)	override;
+
+			void BuildObjectList();
+			void SortObjectList();
+			void PrepareDraws();
+			void RecordDraws(vk::CommandBuffer& buffer, int first, int last);
+
+			static uint32_t			GetPipelineKey(VulkanMesh* mesh, bool transparent);
+			VulkanPipelineBuilder	GetPipelineBuilder(VulkanMesh* mesh, bool transparent);
+			VulkanPipeline&			GetPipeline(VulkanMesh* mesh, bool transparent);
+			vk::DescriptorSet		GetMaterial(const FrameObject& o);
+
+			//Laid out the way the shader's push constant block reads them
+			struct ObjectConstants {
+				Matrix4 modelMatrix;
+				Vector4 colour;
+				int		hasTexture;
+				int		padding[3];
+			};
+
+			struct FrameUniforms {
+				Matrix4 viewProjMatrix;
+				Vector4 cameraPos;
+				Vector4 lightPos;		//radius in w
+				Vector4 lightColour;
+			};
+
+			static const int DrawsPerCommandBuffer = 256;
+
+			GameWorld&	gameWorld;
+			float		interpolationAlpha = 1.0f;
+
+			FramePacket packet;
+			bool		packetPending = false;
+			std::vector<const RenderObject*> activeObjects;
+
+			//Filled in on the main thread before recording, so the jobs only read them
+			std::vector<VulkanPipeline*>	drawPipelines;
+			std::vector<vk::DescriptorSet>	drawMaterials;
+			std::vector<vk::CommandBuffer>	recordedBuffers;
+
+			VulkanShader*				objectShader = nullptr;
+			vk::DescriptorSetLayout		frameLayout;
+			vk::DescriptorSetLayout		materialLayout;
+			vk::DescriptorSet			frameDescriptor;
+			UniformData					frameUniforms;
+			vk::Sampler					defaultSampler;
+			VulkanTexture*				blankTexture = nullptr; //bound for untextured objects, but never read
+
+			//One per vertex layout, as that's part of a pipeline, and another for transparent objects
+			std::unordered_map<uint32_t, VulkanPipeline> pipelines;
+			std::unordered_set<uint32_t>	queuedPipelines;	//being built by a job
+			std::mutex						pipelineMutex;
+
+			Vector4 lightColour;
+			float	lightRadius;
+			Vector3	lightPosition;
+		};
+	}
+}
+#endif
@@ -6,10 +6,14 @@
 #include "../../Common/imgui_impl_opengl3.h"
 #include "../../Common/Assets.h"
 #include "../CSC8503Common/Debug.h"
+#include "../CSC8503Common/NetworkStatistics.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
 
 
 #include "Game.h"
 #include "NetworkedGame.h"
+#include "HUDBatch.h"
 
 NCL::CSC8503::GameUI* NCL::CSC8503::GameUI::p_self = nullptr;
 NCL::Win32Code::ExInputResult ImguiProcessInput(void* data);
@@ -57,10 +61,12 @@ NCL::CSC8503::GameUI::GameUI(Game* g)
 	ImGui_ImplWin32_Init(win32_w->GetHandle());
 	ImGui_ImplOpenGL3_Init("#version 400");
 
+	hud = new HUDBatch();
 }
 
 NCL::CSC8503::GameUI::~GameUI()
 {
+	delete hud;
 	if (!isValid) return;
 
 	ImGui_ImplOpenGL3_Shutdown();
@@ -86,6 +92,7 @@ void NCL::CSC8503::GameUI::ResetPlayers() {
 void NCL::CSC8503::GameUI::UpdateUI(float dt)
 {
 	frameCommand = Command::NO_CHANGE;
+	drawHUD = false;
 	if (!isValid) return;
 
 	titleColourTimer += dt;
@@ -133,6 +140,10 @@ void NCL::CSC8503::GameUI::DrawUI() const
 {
 	if (!isValid) return;
 
+	if (drawHUD) {
+		hud->Draw();
+		return;
+	}
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -617,6 +628,243 @@ void NCL::CSC8503::GameUI::DrawHowToPlay() {
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+/*
+What each part of the game has allocated now, and the most it's had at
+once, with what it's uploaded to the GPU alongside. Peaks can be reset,
+such as once a level's loaded, to see what playing it costs on top.
+*/
+void NCL::CSC8503::GameUI::DrawMemory() {
+	if (ImGui::Button("Reset Peaks")) {
+		MemoryTracker::ResetPeaks();
+	}
+	if (!ImGui::BeginTable("Memory", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+		return;
+	}
+	ImGui::TableSetupColumn("Tag");
+	ImGui::TableSetupColumn("MB");
+	ImGui::TableSetupColumn("Peak");
+	ImGui::TableSetupColumn("Allocs");
+	ImGui::TableSetupColumn("GPU MB");
+	ImGui::TableSetupColumn("GPU Peak");
+	ImGui::TableHeadersRow();
+
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	MemoryTracker::Usage total;
+	for (int i = 0; i < (int)MemoryTag::Count; ++i) {
+		MemoryTracker::Usage u = MemoryTracker::GetUsage((MemoryTag)i);
+		total.bytes			+= u.bytes;
+		total.allocations	+= u.allocations;
+		total.gpuBytes		+= u.gpuBytes;
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn(); ImGui::Text("%s", MemoryTracker::GetTagName((MemoryTag)i));
+		ImGui::TableNextColumn(); ImGui::Text("%.2f", u.bytes * mb);
+		ImGui::TableNextColumn(); ImGui::Text("%.2f", u.peakBytes * mb);
+		ImGui::TableNextColumn(); ImGui::Text("%lld", (long long)u.allocations);
+		ImGui::TableNextColumn(); ImGui::Text("%.2f", u.gpuBytes * mb);
+		ImGui::TableNextColumn(); ImGui::Text("%.2f", u.gpuPeakBytes * mb);
+	}
+	//Peaks of different tags needn't have been at the same time, so there's no total of them
+	ImGui::TableNextRow();
+	ImGui::TableNextColumn(); ImGui::Text("Total");
+	ImGui::TableNextColumn(); ImGui::Text("%.2f", total.bytes * mb);
+	ImGui::TableNextColumn();
+	ImGui::TableNextColumn(); ImGui::Text("%lld", (long long)total.allocations);
+	ImGui::TableNextColumn(); ImGui::Text("%.2f", total.gpuBytes * mb);
+	ImGui::EndTable();
+}
+
+/*
+The last few seconds of frame times, any one of which can be picked, by
+clicking on it or with the slider, to see its markers on a timeline. Each
+thread is a lane, with nested markers in rows beneath their parents, and
+the GPU's passes below them all. Pausing the profiler keeps a spike there
+to be looked at. Each frame's heap allocations are plotted under its time,
+and the markers that allocated are listed, so a steady frame can be kept
+at none.
+*/
+void NCL::CSC8503::GameUI::DrawProfiler() {
+	static int selected = 0; //frames ago
+
+	bool paused = FrameProfiler::IsPaused();
+	if (ImGui::Checkbox("Pause", &paused)) {
+		FrameProfiler::SetPaused(paused);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export Trace")) {
+		FrameProfiler::ExportChromeTrace("ProfilerTrace.json");
+	}
+	ImGui::SameLine();
+	if (!FrameProfiler::IsCapturing()) {
+		if (ImGui::Button("Start Capture")) {
+			FrameProfiler::StartCapture();
+		}
+	}
+	else if (ImGui::Button("Stop Capture")) {
+		FrameProfiler::StopCapture("ProfilerCapture.json");
+	}
+	if (FrameProfiler::IsCapturing()) {
+		ImGui::Text("Capturing: %d frames", FrameProfiler::GetCapturedFrameCount());
+	}
+
+	float times[FrameProfiler::HistorySize];
+	float allocations[FrameProfiler::HistorySize];
+	int count = 0;
+	for (int age = FrameProfiler::HistorySize - 1; age >= 0; --age) {
+		const FrameProfiler::Frame* f = FrameProfiler::GetFrame(age);
+		if (f) {
+			allocations[count]	= (float)f->allocations;
+			times[count++]		= f->cpuTime;
+		}
+	}
+	if (count == 0) {
+		ImGui::Text("No frames recorded yet");
+		return;
+	}
+	float plotWidth = ImGui::CalcItemWidth();
+	ImGui::PlotHistogram("Frame Times", times, count, 0, "ms", 0.0f, FLT_MAX, ImVec2(plotWidth, 60));
+	if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(0)) {
+		float t = (ImGui::GetMousePos().x - ImGui::GetItemRectMin().x) / plotWidth;
+		selected = count - 1 - (int)(t * count);
+	}
+	selected = selected < 0 ? 0 : (selected >= count ? count - 1 : selected);
+	ImGui::PlotLines("Allocations", allocations, count, 0, nullptr, 0.0f, FLT_MAX, ImVec2(plotWidth, 40));
+	ImGui::SliderInt("Frames Ago", &selected, 0, count - 1);
+
+	const FrameProfiler::Frame* frame = FrameProfiler::GetFrame(selected);
+	if (!frame) {
+		return;
+	}
+	ImGui::Text("Frame %d  CPU: %.2fms  GPU: %.2fms", frame->number, frame->cpuTime, frame->gpuTime);
+	ImGui::Text("Allocations: %u (%.1f KB), %u pool slots", frame->allocations, frame->allocatedBytes / 1024.0f, frame->pooled);
+
+	//Each lane is as tall as its deepest marker, with the GPU's after the threads'
+	int lanes = FrameProfiler::GetLaneCount();
+	int rows[FrameProfiler::MaxLanes + 1] = {};
+	for (const FrameProfiler::Marker& m : frame->markers) {
+		int lane = m.lane == FrameProfiler::GPULane ? lanes : m.lane;
+		rows[lane] = m.depth + 1 > rows[lane] ? m.depth + 1 : rows[lane];
+	}
+	float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+	float laneTop[FrameProfiler::MaxLanes + 2];
+	laneTop[0] = 0.0f;
+	for (int i = 0; i <= lanes; ++i) {
+		laneTop[i + 1] = laneTop[i] + (rows[i] > 0 ? rows[i] : 1) * rowHeight + 4.0f;
+	}
+
+	float span		= frame->cpuTime > frame->gpuTime ? frame->cpuTime : frame->gpuTime;
+	span			= span > 1.0f ? span : 1.0f;
+	ImDrawList* draw	= ImGui::GetWindowDrawList();
+	ImVec2 origin		= ImGui::GetCursorScreenPos();
+	float width			= ImGui::GetContentRegionAvail().x;
+	ImVec2 mouse		= ImGui::GetMousePos();
+	const FrameProfiler::Marker* hovered = nullptr;
+
+	for (int i = 1; i <= lanes; ++i) {
+		draw->AddLine(ImVec2(origin.x, origin.y + laneTop[i] - 2.0f), ImVec2(origin.x + width, origin.y + laneTop[i] - 2.0f), IM_COL32(128, 128, 128, 255));
+	}
+	for (const FrameProfiler::Marker& m : frame->markers) {
+		int lane		= m.lane == FrameProfiler::GPULane ? lanes : m.lane;
+		float duration	= m.duration < 0.0f ? frame->cpuTime - m.start : m.duration;
+		float x0		= origin.x + (m.start / span) * width;
+		float x1		= origin.x + ((m.start + duration) / span) * width;
+		x1				= x1 - x0 < 1.0f ? x0 + 1.0f : x1;
+		float y0		= origin.y + laneTop[lane] + m.depth * rowHeight;
+		float y1		= y0 + rowHeight - 1.0f;
+
+		//Coloured by name, so the same work is the same colour from frame to frame
+		unsigned int hash = 2166136261u;
+		for (const char* c = m.name; *c; ++c) {
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		}
+		draw->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.85f));
+		if (x1 - x0 > ImGui::CalcTextSize(m.name).x + 4.0f) {
+			draw->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), m.name);
+		}
+		if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+			hovered = &m;
+		}
+	}
+	ImGui::Dummy(ImVec2(width, laneTop[lanes + 1]));
+	if (hovered && ImGui::IsWindowHovered() && hovered->lane == FrameProfiler::GPULane) {
+		ImGui::SetTooltip("%s\n%.3fms, from %.3fms\nGPU", hovered->name, hovered->duration, hovered->start);
+	}
+	else if (hovered && ImGui::IsWindowHovered()) {
+		ImGui::SetTooltip("%s\n%.3fms, from %.3fms\n%s\n%u allocations (%u bytes), %u pool slots", hovered->name, hovered->duration, hovered->start,
+			hovered->lane == 0 ? "Main thread" : "Worker thread", hovered->allocations, hovered->allocatedBytes, hovered->pooled);
+	}
+
+	//Nested markers count their parents' too, so the deepest one listed is usually the culprit
+	if (frame->allocations > 0 && ImGui::TreeNode("Allocating Markers")) {
+		for (const FrameProfiler::Marker& m : frame->markers) {
+			if (m.lane != FrameProfiler::GPULane && m.allocations > 0) {
+				ImGui::Text("%*s%-16s %5u allocs %8u bytes", m.depth * 2, "", m.name, m.allocations, m.allocatedBytes);
+			}
+		}
+		ImGui::TreePop();
+	}
+
+	if (frame->gpuTime > 0.0f && ImGui::TreeNode("GPU Passes")) {
+		for (const FrameProfiler::Marker& m : frame->markers) {
+			if (m.lane == FrameProfiler::GPULane) {
+				ImGui::Text("%-12s %.3fms", m.name, m.duration);
+			}
+		}
+		ImGui::TreePop();
+	}
+}
+
+/*
+How the level's static tree has come out, and how its queries are doing,
+with its settings there to change and rebuild it with. Once they're right
+for the level, they can be saved next to it, to be used from then on.
+*/
+void NCL::CSC8503::GameUI::DrawStaticTree() {
+	Octree<GameObject*>* tree = game->world->GetStaticTree();
+	if (!tree) {
+		ImGui::Text("No static tree built yet");
+		return;
+	}
+	static bool show	= Debug::GetShowStaticTree();
+	static int depth	= Debug::GetStaticTreeDepth();
+	bool changed = ImGui::Checkbox("Draw Tree", &show);
+	changed |= ImGui::SliderInt("Draw Depth", &depth, -1, tree->GetMaxDepth(), depth < 0 ? "All" : "%d");
+	if (changed) {
+		Debug::SetShowStaticTree(show, depth);
+	}
+
+	OctreeStats stats = tree->GetStats();
+	ImGui::Text("%d entries in %d nodes, %d deep", stats.entries, stats.nodes, stats.depthReached);
+	ImGui::Text("%d leaves, %d empty, %d overfull", stats.leaves, stats.emptyLeaves, stats.overfullLeaves);
+	ImGui::Text("%d held by split nodes, %d duplicates", stats.splitNodeItems, stats.duplicates);
+	float occupancy[OctreeStats::OccupancyBuckets];
+	for (int i = 0; i < OctreeStats::OccupancyBuckets; ++i) {
+		occupancy[i] = (float)stats.occupancy[i];
+	}
+	ImGui::PlotHistogram("Leaf Occupancy", occupancy, OctreeStats::OccupancyBuckets, 0, "entries per leaf", 0.0f, FLT_MAX, ImVec2(0, 60));
+
+	OctreeQueryStats queries = tree->GetQueryStats();
+	double perQuery = queries.queries ? 1.0 / (double)queries.queries : 0.0;
+	ImGui::Text("%llu queries, %.1f nodes and %.1f entries each", (unsigned long long)queries.queries,
+		queries.nodesVisited * perQuery, queries.entriesTested * perQuery);
+	if (ImGui::Button("Reset Queries")) {
+		tree->ResetQueryStats();
+	}
+
+	static OctreeSettings settings = game->world->GetStaticTreeSettings();
+	ImGui::SliderInt("Max Depth", &settings.maxDepth, 1, 12);
+	ImGui::SliderInt("Max Size", &settings.maxSize, 1, 32);
+	if (ImGui::Button("Rebuild")) {
+		game->world->SetStaticTreeSettings(settings);
+		game->rebuildStaticTree = true;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Save Settings")) {
+		game->world->SetStaticTreeSettings(settings);
+		game->world->SaveStaticTreeSettings(Assets::DATADIR + "LevelData.tree");
+	}
+}
+
 void NCL::CSC8503::GameUI::DrawDebug() {
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplWin32_NewFrame();
@@ -640,6 +888,60 @@ void NCL::CSC8503::GameUI::DrawDebug() {
 		text = "Num Narrowphase Collisions: " + (to_string(Debug::GetNumNarrowphaseCollisions()));
 		ImGui::Text(text.c_str());
 	}
+	if (!ImGui::CollapsingHeader("Memory")) {
+		DrawMemory();
+	}
+	if (!ImGui::CollapsingHeader("Profiler")) {
+		DrawProfiler();
+	}
+	if (!ImGui::CollapsingHeader("Static Tree")) {
+		DrawStaticTree();
+	}
+	NetworkStatistics* netStats = Debug::GetNetworkStatistics();
+	if (netStats && !ImGui::CollapsingHeader("Network")) {
+		ImGui::Text("In: %.1f KB/s  Out: %.1f KB/s", netStats->GetBytesInPerSecond() / 1024.0f, netStats->GetBytesOutPerSecond() / 1024.0f);
+		ImGui::Text("On the wire: %.1f KB/s in, %.1f KB/s out", netStats->GetWireBytesInPerSecond() / 1024.0f, netStats->GetWireBytesOutPerSecond() / 1024.0f);
+		ImGui::Text("Delta Hit Rate: %.1f%%", netStats->GetDeltaHitRate() * 100.0f);
+		for (const auto& p : netStats->GetPeers()) {
+			if (p.first == NetworkStatistics::BroadcastPeer) {
+				continue;
+			}
+			ImGui::Text("Peer %d - RTT: %.0fms  Loss: %.1f%%", p.first, p.second.roundTripTime, p.second.packetLoss * 100.0f);
+		}
+		if (netStats->GetSnapshotCount() > 0) {
+			float sizes[NetworkStatistics::SnapshotBuckets];
+			for (int i = 0; i < NetworkStatistics::SnapshotBuckets; ++i) {
+				sizes[i] = (float)netStats->GetSnapshotSizes()[i];
+			}
+			ImGui::PlotHistogram("Snapshot Sizes", sizes, NetworkStatistics::SnapshotBuckets, 0, "128 byte buckets", 0.0f, FLT_MAX, ImVec2(0, 60));
+		}
+		if (ImGui::TreeNode("By Message Type")) {
+			for (int i = 0; i < MaxMessageTypes; ++i) {
+				const NetworkStatistics::Traffic& t = netStats->GetMessageTraffic(i);
+				if (t.packetsIn || t.packetsOut) {
+					ImGui::Text("%2d  in: %llu (%llu B)  out: %llu (%llu B)", i, t.packetsIn, t.bytesIn, t.packetsOut, t.bytesOut);
+				}
+			}
+			ImGui::TreePop();
+		}
+		NetworkedGame* netGame = dynamic_cast<NetworkedGame*>(game);
+		NetworkBase* net = netGame ? netGame->GetNetworkBase() : nullptr;
+		if (net && ImGui::TreeNode("Simulated Conditions")) {
+			static NetworkConditions conditions; //used for sending and receiving alike
+			bool changed = ImGui::SliderFloat("Latency (ms)", &conditions.latency, 0.0f, 500.0f, "%.0f");
+			changed |= ImGui::SliderFloat("Jitter (ms)", &conditions.jitter, 0.0f, 200.0f, "%.0f");
+			changed |= ImGui::SliderFloat("Loss", &conditions.loss, 0.0f, 0.5f, "%.2f");
+			changed |= ImGui::SliderFloat("Duplication", &conditions.duplication, 0.0f, 0.2f, "%.2f");
+			changed |= ImGui::SliderFloat("Bandwidth (B/s)", &conditions.bandwidth, 0.0f, 256000.0f, "%.0f");
+			if (changed) {
+				net->SetSimulatedConditions(conditions, conditions);
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::Button("Export CSV")) {
+			netStats->ExportCSV("NetworkStatistics.csv");
+		}
+	}
 	if (!ImGui::CollapsingHeader("Toggles")) {
 		
 		static bool fullscreen = Debug::GetFullScreen();
@@ -708,64 +1010,69 @@ void NCL::CSC8503::GameUI::DrawDebug() {
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-void NCL::CSC8503::GameUI::DrawPlayingUI() {
-	ImGui_ImplOpenGL3_NewFrame();
-	ImGui_ImplWin32_NewFrame();
-	ImGui::NewFrame();
-
-	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings;
-	const ImGuiViewport* main_viewport = ImGui::GetMainViewport();
+bool NCL::CSC8503::GameUI::HUDValues::operator==(const HUDValues& o) const {
+	for (int i = 0; i < 4; ++i) {
+		if (blocks[i] != o.blocks[i] || ids[i] != o.ids[i]) {
+			return false;
+		}
+	}
+	return timeRemaining == o.timeRemaining && ammo == o.ammo && health == o.health &&
+		respawning == o.respawning && screenSize == o.screenSize;
+}
 
-	//Draw background begin
-	ImGui::SetNextWindowPos(ImVec2(main_viewport->WorkPos.x, main_viewport->WorkPos.y), ImGuiCond_Always);
-	ImGui::SetNextWindowSize(ImVec2(main_viewport->Size.x, main_viewport->Size.y), ImGuiCond_Always);
-	if (!ImGui::Begin("Pause Background", NULL, ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings))
-	{
-		ImGui::End();
-		return;
+/*
+The HUD's on screen for the whole match, so rather than building an ImGui
+frame for it every frame, it's kept in a HUDBatch that's only built again
+when something on it changes - which is mostly just the timer ticking over.
+*/
+void NCL::CSC8503::GameUI::DrawPlayingUI() {
+	HUDValues v;
+	v.timeRemaining = (int)game->gameTimer;
+	v.ammo			= players[0] ? players[0]->GetAmmo() : 0;
+	v.health		= players[0] ? players[0]->GetHealth() : 100;
+	v.respawning	= players[0] && players[0]->IsRespawning();
+	v.screenSize	= Window::GetWindow()->GetScreenSize();
+	for (int i = 0; i < 4; ++i) {
+		v.blocks[i] = players[i] ? players[i]->GetNumBlocksRemaining() : 0;
+		v.ids[i]	= players[i] ? players[i]->GetID() : -1;
 	}
+	if (!(v == hudValues)) {
+		hudValues = v;
+		BuildPlayingHUD();
+	}
+	drawHUD = true;
+}
 
-	ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0, 119, 255, 255));
-	ImGui::PushFont(headerFont);
-	string timeRemaningString = "Time Remaining: " + std::to_string((int)game->gameTimer);
-	ImGui::SetCursorPos(ImVec2(main_viewport->GetCenter().x - ImGui::CalcTextSize(timeRemaningString.c_str()).x * 0.5, 15));
-	ImGui::Text(timeRemaningString.c_str());
-	ImGui::PopStyleColor();
-	ImGui::PopFont();
+void NCL::CSC8503::GameUI::BuildPlayingHUD() {
+	const HUDValues& v	= hudValues;
+	const float width	= v.screenSize.x;
+	const float height	= v.screenSize.y;
+	const Vector4 white	= Vector4(1, 1, 1, 1);
+
+	hud->Begin(width, height);
 
-	string paintBallString = "Paint Balls: " + std::to_string(players[0] ? players[0]->GetAmmo() : 0);
-	ImGui::SetCursorPos(ImVec2(25, main_viewport->WorkSize.y - 50));
-	ImGui::Text(paintBallString.c_str());
+	string timeRemaningString = "Time Remaining: " + std::to_string(v.timeRemaining);
+	hud->AddText(headerFont, timeRemaningString, ImVec2(width * 0.5f - HUDBatch::TextSize(headerFont, timeRemaningString).x * 0.5f, 15), Vector4(0, 119 / 255.0f, 1, 1));
 
-	string healthString = "Health: " + std::to_string(players[0] ? players[0]->GetHealth() : 100);
-	ImGui::SetCursorPos(ImVec2(25, main_viewport->WorkSize.y - 100));
-	ImGui::Text(healthString.c_str());
+	hud->AddText(defaultFont, "Paint Balls: " + std::to_string(v.ammo), ImVec2(25, height - 50), white);
+	hud->AddText(defaultFont, "Health: " + std::to_string(v.health), ImVec2(25, height - 100), white);
 
-	string playerWallString = "Your Blocks Remaining: " + std::to_string(players[0] ? players[0]->GetNumBlocksRemaining() : 0);
-	ImGui::SetCursorPos(ImVec2(main_viewport->WorkSize.x - ImGui::CalcTextSize(playerWallString.c_str()).x - 50, main_viewport->WorkSize.y - 200));
-	ImGui::Text(playerWallString.c_str());
+	string playerWallString = "Your Blocks Remaining: " + std::to_string(v.blocks[0]);
+	hud->AddText(defaultFont, playerWallString, ImVec2(width - HUDBatch::TextSize(defaultFont, playerWallString).x - 50, height - 200), white);
 
 	for (int i = 1; i < 4; ++i) {
-		if (players[i]) {
-			string opponentWallString = "P" + std::to_string(players[i]->GetID() + 1) + " Blocks Remaining: " + std::to_string(players[i] ? players[i]->GetNumBlocksRemaining() : 0);
-			ImGui::SetCursorPos(ImVec2(main_viewport->WorkSize.x - ImGui::CalcTextSize(opponentWallString.c_str()).x - 50, main_viewport->WorkSize.y - 200 + (i * 50)));
-			ImGui::Text(opponentWallString.c_str());
+		if (v.ids[i] >= 0) {
+			string opponentWallString = "P" + std::to_string(v.ids[i] + 1) + " Blocks Remaining: " + std::to_string(v.blocks[i]);
+			hud->AddText(defaultFont, opponentWallString, ImVec2(width - HUDBatch::TextSize(defaultFont, opponentWallString).x - 50, height - 200 + (i * 50)), white);
 		}
 	}
 
-	if (players[0] && players[0]->IsRespawning()) {
-		ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 18, 0, 255));
-		ImGui::PushFont(headerFont);
-		string timeRemaningString = "Respawning...";
-		ImGui::SetCursorPos(ImVec2(main_viewport->GetCenter().x - ImGui::CalcTextSize(timeRemaningString.c_str()).x * 0.5, main_viewport->GetCenter().y));
-		ImGui::Text(timeRemaningString.c_str());
-		ImGui::PopStyleColor();
-		ImGui::PopFont();
+	if (v.respawning) {
+		string respawnString = "Respawning...";
+		hud->AddText(headerFont, respawnString, ImVec2(width * 0.5f - HUDBatch::TextSize(headerFont, respawnString).x * 0.5f, height * 0.5f), Vector4(1, 18 / 255.0f, 0, 1));
 	}
 
-	ImGui::End();
-	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	hud->End();
 }
 
 void NCL::CSC8503::GameUI::DrawWinOrLose() {
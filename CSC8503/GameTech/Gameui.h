@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include "Agent.h"
+#include "../../Common/Vector2.h"
 
 #include <iostream>
 #include <iomanip>
@@ -17,6 +18,7 @@ class ImFont;
 namespace NCL {
 	namespace CSC8503 {
 		class Game;
+		class HUDBatch;
 
 		class GameUI {
 		public:
@@ -63,11 +65,15 @@ namespace NCL {
 			void DrawMultiplayerLobbyScreen();
 			void DrawHowToPlay();
 			void DrawDebug();
+			void DrawProfiler();
+			void DrawStaticTree();
+			void DrawMemory();
 			void DrawPlayingUI();
 			void Demo();
 			void DrawWinOrLose();
 			void DrawNothing();
 			void DrawSmallPauseBt();
+			void BuildPlayingHUD();
 
 			Game* game;
 			static GameUI* p_self;
@@ -83,6 +89,22 @@ namespace NCL {
 
 			Agent* players[4];
 
+			//Everything the playing HUD shows, so it's only built again when one of them changes
+			struct HUDValues {
+				int		timeRemaining	= -1;
+				int		ammo			= 0;
+				int		health			= 0;
+				int		blocks[4]		= {};
+				int		ids[4]			= {};	//-1 if there's no one there
+				bool	respawning		= false;
+				Vector2	screenSize;
+
+				bool operator==(const HUDValues& o) const;
+			};
+			HUDBatch*	hud		= nullptr;
+			HUDValues	hudValues;
+			bool		drawHUD	= false; //rather than ImGui's draw data, this frame
+
 			Vector4 titleColour;
 			Vector4 targetTitleColour;
 			Vector4 prevTitleColour;
@@ -0,0 +1,99 @@
+#include "HUDBatch.h"
+#include "../../Common/Matrix4.h"
+#include "../../Common/MeshGeometry.h"
+#include <cstddef>
+
+using namespace NCL;
+using namespace CSC8503;
+
+HUDBatch::HUDBatch() {
+	drawList	= new ImDrawList(ImGui::GetDrawListSharedData());
+	shader		= new OGLShader("hudVert.glsl", "hudFrag.glsl");
+	projLocation = glGetUniformLocation(shader->GetProgramID(), "projMatrix");
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribPointer(VertexAttribute::Positions, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (void*)offsetof(ImDrawVert, pos));
+	glEnableVertexAttribArray(VertexAttribute::Colours);
+	glVertexAttribPointer(VertexAttribute::Colours, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (void*)offsetof(ImDrawVert, col));
+	glEnableVertexAttribArray(VertexAttribute::TextureCoords);
+	glVertexAttribPointer(VertexAttribute::TextureCoords, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (void*)offsetof(ImDrawVert, uv));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+HUDBatch::~HUDBatch() {
+	delete drawList;
+	delete shader;
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteVertexArrays(1, &vao);
+}
+
+//The clip rect's given rather than taken from ImGui, whose might be from a frame long gone
+void HUDBatch::Begin(float screenWidth, float screenHeight) {
+	width	= screenWidth;
+	height	= screenHeight;
+	drawList->_ResetForNewFrame();
+	drawList->PushClipRect(ImVec2(0, 0), ImVec2(width, height));
+	drawList->PushTextureID(ImGui::GetIO().Fonts->TexID);
+}
+
+void HUDBatch::AddText(ImFont* font, const std::string& text, const ImVec2& position, const Vector4& colour) {
+	ImU32 col = ImGui::ColorConvertFloat4ToU32(ImVec4(colour.x, colour.y, colour.z, colour.w));
+	drawList->AddText(font, font->FontSize, position, col, text.c_str(), text.c_str() + text.size());
+}
+
+void HUDBatch::End() {
+	drawList->PopTextureID();
+	drawList->PopClipRect();
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawList->VtxBuffer.Size * sizeof(ImDrawVert), drawList->VtxBuffer.Data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, drawList->IdxBuffer.Size * sizeof(ImDrawIdx), drawList->IdxBuffer.Data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+//It's all one font atlas, so there's usually just the one command
+void HUDBatch::Draw() const {
+	if (drawList->IdxBuffer.Size == 0) {
+		return;
+	}
+	Matrix4 proj = Matrix4::Orthographic(-1.0f, 1.0f, width, 0.0f, 0.0f, height);
+
+	glUseProgram(shader->GetProgramID());
+	glUniformMatrix4fv(projLocation, 1, false, proj.array);
+	glUniform1i(glGetUniformLocation(shader->GetProgramID(), "mainTex"), 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	glBindVertexArray(vao);
+	for (const ImDrawCmd& cmd : drawList->CmdBuffer) {
+		if (cmd.ElemCount == 0) {
+			continue;
+		}
+		glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)cmd.GetTexID());
+		glDrawElementsBaseVertex(GL_TRIANGLES, cmd.ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+			(void*)(intptr_t)(cmd.IdxOffset * sizeof(ImDrawIdx)), cmd.VtxOffset);
+	}
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glEnable(GL_DEPTH_TEST);
+}
+
+ImVec2 HUDBatch::TextSize(ImFont* font, const std::string& text) {
+	return font->CalcTextSizeA(font->FontSize, FLT_MAX, 0.0f, text.c_str(), text.c_str() + text.size());
+}
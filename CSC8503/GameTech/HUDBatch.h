@@ -0,0 +1,48 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLShader.h"
+#include "../../Common/imgui.h"
+#include "../../Common/Vector4.h"
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Rendering;
+		using namespace Maths;
+
+		/*
+		Text that stays on screen, drawn from vertices that are only made again
+		when it changes. The glyphs are laid out by an ImDrawList of its own,
+		out of ImGui's font atlas, so it looks just like the menus, but none
+		of ImGui's frame has to be built to draw it - between changes it's one
+		draw of buffers already on the GPU.
+
+		Call Begin, add the text, then End to send it off; Draw can be called
+		as often as it's wanted in between.
+		*/
+		class HUDBatch {
+		public:
+			HUDBatch();
+			~HUDBatch();
+
+			void Begin(float screenWidth, float screenHeight);
+			void AddText(ImFont* font, const std::string& text, const ImVec2& position, const Vector4& colour);
+			void End();
+
+			void Draw() const;
+
+			//How much room text would take, without needing an ImGui frame
+			static ImVec2 TextSize(ImFont* font, const std::string& text);
+
+		protected:
+			ImDrawList*	drawList	= nullptr;
+			OGLShader*	shader		= nullptr;
+			int			projLocation = -1;
+
+			GLuint	vao				= 0;
+			GLuint	vertexBuffer	= 0;
+			GLuint	indexBuffer		= 0;
+			float	width			= 1.0f;
+			float	height			= 1.0f;
+		};
+	}
+}
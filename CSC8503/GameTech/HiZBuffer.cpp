@@ -0,0 +1,231 @@
+#include "HiZBuffer.h"
+#include "../../Common/Vector4.h"
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+HiZBuffer::HiZBuffer() {
+	if (!glDispatchCompute || !glBindImageTexture) {
+		return;
+	}
+	buildShader = new OGLComputeShader("HiZBuildCompute.glsl");
+	if (!buildShader->LoadSuccess()) {
+		delete buildShader;
+		buildShader = nullptr;
+		return;
+	}
+	int program = buildShader->GetProgramID();
+	buildUniforms[0] = glGetUniformLocation(program, "fromDepth");
+	buildUniforms[1] = glGetUniformLocation(program, "sourceSize");
+	glGenBuffers(1, &readbackBuffer);
+}
+
+HiZBuffer::~HiZBuffer() {
+	if (!buildShader) {
+		return;
+	}
+	Destroy();
+	glDeleteBuffers(1, &readbackBuffer);
+	delete buildShader;
+}
+
+void HiZBuffer::Destroy() {
+	if (readbackFence) {
+		glDeleteSync(readbackFence);
+		readbackFence = nullptr;
+	}
+	glDeleteTextures(1, &depthTex);
+	glDeleteFramebuffers(1, &depthFBO);
+	glDeleteTextures(1, &pyramidTex);
+	depthTex		= 0;
+	depthFBO		= 0;
+	pyramidTex		= 0;
+	pyramidValid	= false;
+	cpuDepth.clear();
+}
+
+/*
+The depth copy matches the screen's own depth and stencil format, which
+glBlitFramebuffer needs. The pyramid starts at half the screen's size,
+down to a single texel.
+*/
+void HiZBuffer::Resize(int width, int height) {
+	Destroy();
+	screenWidth		= width;
+	screenHeight	= height;
+
+	glGenTextures(1, &depthTex);
+	glBindTexture(GL_TEXTURE_2D, depthTex);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenFramebuffers(1, &depthFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+	glDrawBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	pyramidWidth	= width > 1 ? width / 2 : 1;
+	pyramidHeight	= height > 1 ? height / 2 : 1;
+	int largest		= pyramidWidth > pyramidHeight ? pyramidWidth : pyramidHeight;
+	levelCount		= 1;
+	while ((largest >> levelCount) > 0) {
+		levelCount++;
+	}
+	glGenTextures(1, &pyramidTex);
+	glBindTexture(GL_TEXTURE_2D, pyramidTex);
+	glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_R32F, pyramidWidth, pyramidHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	readbackLevel = 0;
+	while (readbackLevel < levelCount - 1 && (pyramidWidth >> readbackLevel) > ReadbackWidth) {
+		readbackLevel++;
+	}
+	readbackWidth	= (pyramidWidth >> readbackLevel) > 0 ? (pyramidWidth >> readbackLevel) : 1;
+	readbackHeight	= (pyramidHeight >> readbackLevel) > 0 ? (pyramidHeight >> readbackLevel) : 1;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, readbackWidth * readbackHeight * sizeof(float), nullptr, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+//Only takes the last readback once the GPU says it's done, so this never waits
+void HiZBuffer::FinishReadback() {
+	if (!readbackFence) {
+		return;
+	}
+	GLenum state = glClientWaitSync(readbackFence, 0, 0);
+	if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) {
+		return;
+	}
+	glDeleteSync(readbackFence);
+	readbackFence = nullptr;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+	const float* data = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackWidth * readbackHeight * sizeof(float), GL_MAP_READ_BIT);
+	if (data) {
+		cpuDepth.assign(data, data + readbackWidth * readbackHeight);
+		cpuWidth	= readbackWidth;
+		cpuHeight	= readbackHeight;
+		cpuViewProj = readbackViewProj;
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/*
+Each level is built from the one before it by a compute pass, apart from
+the first, which reads the depth copy. Every texel takes the furthest of
+the 3x3 under it, clamped at the edges, which is more than it needs to,
+but means levels with an odd size never miss a row or column.
+*/
+void HiZBuffer::Capture(int width, int height, const Matrix4& viewProj, GLuint source) {
+	if (!buildShader || width <= 0 || height <= 0) {
+		return;
+	}
+	if (width != screenWidth || height != screenHeight) {
+		Resize(width, height);
+	}
+	FinishReadback();
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFBO);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	buildShader->Bind();
+	int threadsX = buildShader->GetThreadXCount();
+	int threadsY = buildShader->GetThreadYCount();
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depthTex);
+	int sourceWidth		= width;
+	int sourceHeight	= height;
+	for (int level = 0; level < levelCount; ++level) {
+		int levelWidth	= (pyramidWidth >> level) > 0 ? (pyramidWidth >> level) : 1;
+		int levelHeight = (pyramidHeight >> level) > 0 ? (pyramidHeight >> level) : 1;
+
+		glUniform1i(buildUniforms[0], level == 0);
+		glUniform2i(buildUniforms[1], sourceWidth, sourceHeight);
+		glBindImageTexture(0, pyramidTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glBindImageTexture(1, pyramidTex, level > 0 ? level - 1 : 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+		buildShader->Execute((levelWidth + threadsX - 1) / threadsX, (levelHeight + threadsY - 1) / threadsY);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		sourceWidth		= levelWidth;
+		sourceHeight	= levelHeight;
+	}
+	buildShader->Unbind();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+	pyramidValid	= true;
+	pyramidViewProj = viewProj;
+
+	//Only one readback's in flight at a time, and it's skipped while the last is still going
+	if (!readbackFence) {
+		glBindTexture(GL_TEXTURE_2D, pyramidTex);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+		glGetTexImage(GL_TEXTURE_2D, readbackLevel, GL_RED, GL_FLOAT, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		readbackFence		= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readbackViewProj	= viewProj;
+	}
+}
+
+/*
+The box's corners are projected with the matrix its depth was drawn with,
+giving the area of the copy it covers and the nearest it gets. If any
+texel there is further away than that, something of it could be seen.
+*/
+bool HiZBuffer::IsVisible(const Vector3& position, const Vector3& halfSize) const {
+	if (cpuDepth.empty()) {
+		return true;
+	}
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for (int i = 0; i < 8; ++i) {
+		Vector3 corner = position + Vector3(i & 1 ? halfSize.x : -halfSize.x, i & 2 ? halfSize.y : -halfSize.y, i & 4 ? halfSize.z : -halfSize.z);
+		Vector4 clip = cpuViewProj * Vector4(corner, 1.0f);
+		if (clip.w <= 0.0001f) {
+			return true; //it was partly behind the camera, so there's no depth to test against
+		}
+		float x = clip.x / clip.w;
+		float y = clip.y / clip.w;
+		float z = clip.z / clip.w;
+		minX = x < minX ? x : minX;
+		maxX = x > maxX ? x : maxX;
+		minY = y < minY ? y : minY;
+		maxY = y > maxY ? y : maxY;
+		minZ = z < minZ ? z : minZ;
+	}
+	if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f || minZ < -1.0f) {
+		return true; //off screen back then, so nothing's known about it
+	}
+	int x0 = (int)((minX * 0.5f + 0.5f) * cpuWidth);
+	int x1 = (int)((maxX * 0.5f + 0.5f) * cpuWidth);
+	int y0 = (int)((minY * 0.5f + 0.5f) * cpuHeight);
+	int y1 = (int)((maxY * 0.5f + 0.5f) * cpuHeight);
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 >= cpuWidth ? cpuWidth - 1 : x1;
+	y1 = y1 >= cpuHeight ? cpuHeight - 1 : y1;
+	if ((x1 - x0 + 1) * (y1 - y0 + 1) > MaxTestTexels) {
+		return true;
+	}
+	float nearest = minZ * 0.5f + 0.5f;
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			if (nearest <= cpuDepth[y * cpuWidth + x]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLComputeShader.h"
+#include "../../Common/Matrix4.h"
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+
+		/*
+		A depth pyramid built from the end of the last frame's camera pass,
+		each level holding the furthest depth of the 2x2 below it, so one
+		lookup says whether anything in that area could be nearer than what
+		was drawn there. A box whose nearest point is behind that is hidden.
+		The GPU reads the whole pyramid when culling the indirect batch. The
+		CPU gets a small copy of one of its levels, read back without
+		stalling, so it's another frame or so behind. That's only latency,
+		and anything the old depth didn't cover (off screen or behind the
+		camera back then) is always treated as visible.
+		*/
+		class HiZBuffer {
+		public:
+			HiZBuffer();
+			~HiZBuffer();
+
+			//Needs GL 4.3, for the compute shader that builds it
+			bool IsSupported() const {
+				return buildShader != nullptr;
+			}
+
+			//Copies the bottom left of source's depth buffer and builds the pyramid from it
+			void Capture(int width, int height, const Matrix4& viewProj, GLuint source = 0);
+
+			//Tests against the copy on the CPU, which is true until one's arrived
+			bool IsVisible(const Vector3& position, const Vector3& halfSize) const;
+
+			bool HasPyramid() const {
+				return pyramidValid;
+			}
+			GLuint GetTexture() const {
+				return pyramidTex;
+			}
+			int GetWidth() const {
+				return pyramidWidth;
+			}
+			int GetHeight() const {
+				return pyramidHeight;
+			}
+			int GetLevelCount() const {
+				return levelCount;
+			}
+			//What the pyramid's depth was drawn with
+			const Matrix4& GetViewProjection() const {
+				return pyramidViewProj;
+			}
+
+		protected:
+			void Resize(int width, int height);
+			void Destroy();
+			void FinishReadback();
+
+			static const int ReadbackWidth = 160;	//the first level this narrow is copied back
+			static const int MaxTestTexels = 256;	//boxes covering more than this aren't tested
+
+			OGLComputeShader* buildShader = nullptr;
+			int buildUniforms[2] = {}; //fromDepth, sourceSize
+
+			int		screenWidth		= 0;
+			int		screenHeight	= 0;
+			GLuint	depthTex		= 0; //a copy of the screen's depth, as that can't be read directly
+			GLuint	depthFBO		= 0;
+			GLuint	pyramidTex		= 0;
+			int		pyramidWidth	= 0;
+			int		pyramidHeight	= 0;
+			int		levelCount		= 0;
+			bool	pyramidValid	= false;
+			Matrix4 pyramidViewProj;
+
+			GLuint	readbackBuffer	= 0;
+			GLsync	readbackFence	= nullptr;
+			int		readbackLevel	= 0;
+			int		readbackWidth	= 0;
+			int		readbackHeight	= 0;
+			Matrix4 readbackViewProj;
+
+			std::vector<float> cpuDepth;
+			int		cpuWidth		= 0;
+			int		cpuHeight		= 0;
+			Matrix4 cpuViewProj;
+		};
+	}
+}
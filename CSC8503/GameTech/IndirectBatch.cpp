@@ -0,0 +1,359 @@
+#include "IndirectBatch.h"
+#include "../CSC8503Common/RenderObject.h"
+#include "../CSC8503Common/Transform.h"
+#include "../CSC8503Common/Frustum.h"
+#include "HiZBuffer.h"
+#include "../../Plugins/OpenGLRendering/OGLTexture.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+IndirectBatch::IndirectBatch() {
+	if (!glDispatchCompute || !glMultiDrawElementsIndirect) {
+		return;
+	}
+	cullShader = new OGLComputeShader("IndirectCullCompute.glsl");
+	if (!cullShader->LoadSuccess()) {
+		delete cullShader;
+		cullShader = nullptr;
+		return;
+	}
+	int program = cullShader->GetProgramID();
+	cullUniforms[0] = glGetUniformLocation(program, "frustumPlanes");
+	cullUniforms[1] = glGetUniformLocation(program, "commandCount");
+	cullUniforms[2] = glGetUniformLocation(program, "hiZ");
+	cullUniforms[3] = glGetUniformLocation(program, "useHiZ");
+	cullUniforms[4] = glGetUniformLocation(program, "hiZViewProj");
+	cullUniforms[5] = glGetUniformLocation(program, "hiZSize");
+	cullUniforms[6] = glGetUniformLocation(program, "hiZLevels");
+	cullUniforms[7] = glGetUniformLocation(program, "cameraPos");
+	cullUniforms[8] = glGetUniformLocation(program, "lodScale");
+
+	GLuint* buffers[] = { &positionBuffer, &texCoordBuffer, &normalBuffer, &indexBuffer, &objectIndexBuffer,
+		&objectBuffer, &sourceCommands, &commandLODBuffer, &culledCommands, &shadowCommands };
+	for (GLuint* b : buffers) {
+		glGenBuffers(1, b);
+	}
+	glGenVertexArrays(1, &vao);
+}
+
+IndirectBatch::~IndirectBatch() {
+	if (!cullShader) {
+		return;
+	}
+	delete cullShader;
+	GLuint buffers[] = { positionBuffer, texCoordBuffer, normalBuffer, indexBuffer, objectIndexBuffer,
+		objectBuffer, sourceCommands, commandLODBuffer, culledCommands, shadowCommands };
+	glDeleteBuffers(sizeof(buffers) / sizeof(GLuint), buffers);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void IndirectBatch::Clear() {
+	meshRanges.clear();
+	positions.clear();
+	texCoords.clear();
+	normals.clear();
+	indices.clear();
+	objects.clear();
+	commands.clear();
+	commandLODs.clear();
+	shadowCasters.clear();
+	groups.clear();
+	contents.clear();
+}
+
+bool IndirectBatch::HasCPUData(const MeshGeometry* mesh) {
+	for (unsigned int i = 0; i < mesh->GetLODCount(); ++i) {
+		if (!mesh->GetLOD(i)->HasCPUData()) {
+			return false;
+		}
+	}
+	return mesh->HasCPUData();
+}
+
+/*
+Each mesh goes into the merged buffers once, however many objects use it.
+Missing texture coordinates and normals are filled in with zeroes, and
+meshes drawn without indices get a list of their own, so every draw can
+be an indexed one.
+*/
+const IndirectBatch::MeshRange& IndirectBatch::AddMesh(const MeshGeometry* mesh) {
+	auto existing = meshRanges.find(mesh);
+	if (existing != meshRanges.end()) {
+		return existing->second;
+	}
+	MeshRange& range = meshRanges[mesh];
+	range.baseVertex = (int)positions.size();
+
+	const std::vector<Vector3>& meshPositions = mesh->GetPositionData();
+	const std::vector<Vector2>& meshTexCoords = mesh->GetTextureCoordData();
+	const std::vector<Vector3>& meshNormals	  = mesh->GetNormalData();
+	unsigned int vertexCount = mesh->GetVertexCount();
+
+	Vector3 boundsMin = meshPositions.empty() ? Vector3() : meshPositions[0];
+	Vector3 boundsMax = boundsMin;
+	for (unsigned int v = 0; v < vertexCount; ++v) {
+		const Vector3& p = meshPositions[v];
+		positions.emplace_back(p);
+		texCoords.emplace_back(meshTexCoords.empty() ? Vector2() : meshTexCoords[v]);
+		normals.emplace_back(meshNormals.empty() ? Vector3() : meshNormals[v]);
+
+		boundsMin = Vector3(p.x < boundsMin.x ? p.x : boundsMin.x, p.y < boundsMin.y ? p.y : boundsMin.y, p.z < boundsMin.z ? p.z : boundsMin.z);
+		boundsMax = Vector3(p.x > boundsMax.x ? p.x : boundsMax.x, p.y > boundsMax.y ? p.y : boundsMax.y, p.z > boundsMax.z ? p.z : boundsMax.z);
+	}
+	range.centre	= (boundsMin + boundsMax) * 0.5f;
+	range.halfSize	= (boundsMax - boundsMin) * 0.5f;
+
+	int firstIndex = (int)indices.size();
+	if (mesh->GetIndexCount() > 0) {
+		indices.insert(indices.end(), mesh->GetIndexData().begin(), mesh->GetIndexData().end());
+	}
+	else {
+		for (unsigned int v = 0; v < vertexCount; ++v) {
+			indices.emplace_back(v);
+		}
+	}
+	int meshIndexCount = (int)indices.size() - firstIndex;
+
+	if (mesh->GetSubMeshCount() == 0) {
+		range.subMeshes.push_back({ firstIndex, meshIndexCount });
+	}
+	for (unsigned int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+		const SubMesh* m = mesh->GetSubMesh(i);
+		range.subMeshes.push_back({ firstIndex + m->start, m->count });
+	}
+	return range;
+}
+
+/*
+Commands are built in one go, then sorted so all of a group's are next to
+each other, which is what lets each group be a single draw call. Objects
+with a texture per submesh (the wall pieces) get a command per submesh in
+each texture's group, everything else has all its submeshes in one.
+Each LOD of an object's mesh adds the same commands again, drawn from
+their own meshes, and only the full detail ones cast shadows, as the
+shadow map's kept for as long as the light doesn't move - unless the mesh
+has a shadow proxy, which is merged in just for the shadow commands.
+*/
+void IndirectBatch::Build(const std::vector<const RenderObject*>& renderObjects, const std::unordered_map<const ShaderBase*, OGLShader*>& shaders) {
+	Clear();
+	if (!cullShader) {
+		return;
+	}
+	struct Entry {
+		int			group;
+		DrawCommand command;
+		Vector2		lodRange;
+	};
+	std::vector<Entry> entries;
+
+	for (const RenderObject* o : renderObjects) {
+		auto s = shaders.find(o->GetShader());
+		if (s == shaders.end() || !o->GetMesh() || o->GetMesh()->GetPrimitiveType() != GeometryPrimitive::Triangles || o->GetColour().w < 1.0f) {
+			continue;
+		}
+		if (!HasCPUData(o->GetMesh())) {
+			continue; //it can't be merged in, so it's just drawn like everything else
+		}
+		const bool perSubMesh = o->HasFeature(RenderObject::TexturePerSubMesh) && !o->GetTextures().empty();
+		const MeshRange& range = AddMesh(o->GetMesh());
+		const GLuint objectIndex = (GLuint)objects.size();
+
+		ObjectData data;
+		data.modelMatrix	= o->GetTransform()->GetMatrix();
+		data.colour			= o->GetColour();
+		//The bounding sphere goes round the mesh's box, stretched by the largest scale on any axis
+		Vector3 centre = data.modelMatrix * range.centre;
+		float scale = 0.0f;
+		for (int c = 0; c < 3; ++c) {
+			Vector4 column = data.modelMatrix.GetColumn(c);
+			float length = Vector3(column.x, column.y, column.z).Length();
+			scale = length > scale ? length : scale;
+		}
+		data.bounds = Vector4(centre, range.halfSize.Length() * scale);
+		objects.emplace_back(data);
+		contents.insert(o);
+
+		const OGLTexture* texture = (const OGLTexture*)o->GetDefaultTexture();
+		const MeshGeometry* baseMesh = o->GetMesh();
+		//Only if it can be merged in too, or it's left casting the full mesh's shadow
+		const MeshGeometry* shadowProxy = baseMesh->GetShadowProxy() && baseMesh->GetShadowProxy()->HasCPUData() ? baseMesh->GetShadowProxy() : nullptr;
+		for (unsigned int level = 0; level <= baseMesh->GetLODCount(); ++level) {
+			const MeshGeometry* mesh	= level == 0 ? baseMesh : baseMesh->GetLOD(level - 1);
+			const MeshRange& levelRange	= AddMesh(mesh);
+			Vector2 screenSizes(level < baseMesh->GetLODCount() ? baseMesh->GetLODScreenSize(level) : 0.0f,
+				level == 0 ? FLT_MAX : baseMesh->GetLODScreenSize(level - 1));
+
+			for (size_t i = 0; i < levelRange.subMeshes.size(); ++i) {
+				GLuint textureID		= texture ? texture->GetObjectID() : 0;
+				GLenum textureTarget	= texture ? texture->GetTarget() : GL_TEXTURE_2D;
+				if (perSubMesh) {
+					textureID		= i < o->GetTextures().size() ? o->GetTextures()[i] : 0;
+					textureTarget	= GL_TEXTURE_2D;
+				}
+				int group = 0;
+				while (group < (int)groups.size() && (groups[group].shader != s->second || groups[group].texture != textureID || groups[group].textureTarget != textureTarget)) {
+					++group;
+				}
+				if (group == (int)groups.size()) {
+					groups.push_back({ s->second, textureID, textureTarget, 0, 0 });
+				}
+				DrawCommand command = { (GLuint)levelRange.subMeshes[i].count, 1, (GLuint)levelRange.subMeshes[i].start, levelRange.baseVertex, objectIndex };
+				entries.push_back({ group, command, screenSizes });
+				if (level == 0 && o->RenderShadow() && !shadowProxy) {
+					shadowCasters.emplace_back(command);
+				}
+			}
+		}
+		if (shadowProxy && o->RenderShadow()) {
+			const MeshRange& proxyRange = AddMesh(shadowProxy);
+			for (const SubMesh& m : proxyRange.subMeshes) {
+				shadowCasters.push_back({ (GLuint)m.count, 1, (GLuint)m.start, proxyRange.baseVertex, objectIndex });
+			}
+		}
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.group < b.group; });
+
+	for (const Entry& e : entries) {
+		Group& g = groups[e.group];
+		if (g.commandCount == 0) {
+			g.firstCommand = (int)commands.size();
+		}
+		g.commandCount++;
+		commands.emplace_back(e.command);
+		commandLODs.emplace_back(e.lodRange);
+	}
+	if (!objects.empty()) {
+		Upload();
+	}
+}
+
+void IndirectBatch::Upload() {
+	glBindVertexArray(vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(Vector3), positions.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, 0);
+	glVertexAttribBinding(VertexAttribute::Positions, VertexAttribute::Positions);
+	glBindVertexBuffer(VertexAttribute::Positions, positionBuffer, 0, sizeof(Vector3));
+
+	glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+	glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(Vector2), texCoords.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(VertexAttribute::TextureCoords);
+	glVertexAttribFormat(VertexAttribute::TextureCoords, 2, GL_FLOAT, false, 0);
+	glVertexAttribBinding(VertexAttribute::TextureCoords, VertexAttribute::TextureCoords);
+	glBindVertexBuffer(VertexAttribute::TextureCoords, texCoordBuffer, 0, sizeof(Vector2));
+
+	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(Vector3), normals.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(VertexAttribute::Normals);
+	glVertexAttribFormat(VertexAttribute::Normals, 3, GL_FLOAT, false, 0);
+	glVertexAttribBinding(VertexAttribute::Normals, VertexAttribute::Normals);
+	glBindVertexBuffer(VertexAttribute::Normals, normalBuffer, 0, sizeof(Vector3));
+
+	//Read once per instance, so that with one instance per draw it's just the base instance
+	std::vector<GLuint> objectIndices(objects.size());
+	for (size_t i = 0; i < objectIndices.size(); ++i) {
+		objectIndices[i] = (GLuint)i;
+	}
+	const int objectSlot = 8;
+	glBindBuffer(GL_ARRAY_BUFFER, objectIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, objectIndices.size() * sizeof(GLuint), objectIndices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(objectSlot);
+	glVertexAttribIFormat(objectSlot, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribBinding(objectSlot, objectSlot);
+	glBindVertexBuffer(objectSlot, objectIndexBuffer, 0, sizeof(GLuint));
+	glVertexBindingDivisor(objectSlot, 1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(ObjectData), objects.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceCommands);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandLODBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commandLODs.size() * sizeof(Vector2), commandLODs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, culledCommands);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DrawCommand), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, shadowCommands);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, shadowCasters.size() * sizeof(DrawCommand), shadowCasters.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	//The vertex data's on the GPU now, and only the counts are needed from here on
+	positions.clear();
+	texCoords.clear();
+	normals.clear();
+	indices.clear();
+}
+
+void IndirectBatch::Cull(const Frustum& frustum, const Vector3& cameraPos, float lodScale, const HiZBuffer* hiZ) {
+	if (commands.empty()) {
+		return;
+	}
+	Vector4 planes[6];
+	for (int i = 0; i < 6; ++i) {
+		const Plane& p = frustum.GetPlane(i);
+		planes[i] = Vector4(p.GetNormal(), p.GetDistance());
+	}
+	cullShader->Bind();
+	glUniform4fv(cullUniforms[0], 6, (float*)planes);
+	glUniform1i(cullUniforms[1], (int)commands.size());
+	glUniform3fv(cullUniforms[7], 1, (float*)&cameraPos);
+	glUniform1f(cullUniforms[8], lodScale);
+
+	const bool useHiZ = hiZ && hiZ->HasPyramid();
+	glUniform1i(cullUniforms[3], useHiZ);
+	if (useHiZ) {
+		glActiveTexture(GL_TEXTURE0 + HiZTextureUnit);
+		glBindTexture(GL_TEXTURE_2D, hiZ->GetTexture());
+		glUniform1i(cullUniforms[2], HiZTextureUnit);
+		glUniformMatrix4fv(cullUniforms[4], 1, false, hiZ->GetViewProjection().array);
+		glUniform2i(cullUniforms[5], hiZ->GetWidth(), hiZ->GetHeight());
+		glUniform1i(cullUniforms[6], hiZ->GetLevelCount());
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding + 1, sourceCommands);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding + 2, culledCommands);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding + 3, commandLODBuffer);
+
+	int threads = cullShader->GetThreadXCount();
+	cullShader->Execute(((int)commands.size() + threads - 1) / threads);
+	cullShader->Unbind();
+	if (useHiZ) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void IndirectBatch::DrawGroup(const Group& g) const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, objectBuffer);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culledCommands);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(g.firstCommand * sizeof(DrawCommand)), g.commandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void IndirectBatch::DrawShadows() const {
+	if (shadowCasters.empty()) {
+		return;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, objectBuffer);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, shadowCommands);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)shadowCasters.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
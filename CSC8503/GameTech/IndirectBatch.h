@@ -0,0 +1,135 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLShader.h"
+#include "../../Plugins/OpenGLRendering/OGLComputeShader.h"
+#include "../../Common/MeshGeometry.h"
+#include "../../Common/Matrix4.h"
+#include "../../Common/Vector2.h"
+#include "../../Common/Vector3.h"
+#include "../../Common/Vector4.h"
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace NCL {
+	namespace CSC8503 {
+		class RenderObject;
+		class Frustum;
+		class HiZBuffer;
+		using namespace Maths;
+		using namespace Rendering;
+
+		/*
+		Level geometry that never moves, merged into one set of vertex and
+		index buffers so all of it can be drawn with a few
+		glMultiDrawElementsIndirect calls. There's a draw command for each
+		submesh of each object, grouped by shader and texture, with one
+		group per draw call. Each frame a compute shader copies the commands
+		over and sets the instance count of any whose object's bounding
+		sphere is outside the camera's frustum, or was hidden behind last
+		frame's depth, to 0, so no draws are culled on the CPU. Which object a draw is for is passed in as its base
+		instance, which picks its matrix and colour out of a storage buffer.
+		Meshes with LODs get commands for every level, each with the range of
+		screen sizes it's for, and the cull only keeps the one that fits.
+		*/
+		class IndirectBatch {
+		public:
+			struct Group {
+				OGLShader*	shader;
+				GLuint		texture;
+				GLenum		textureTarget;
+				int			firstCommand;
+				int			commandCount;
+			};
+
+			IndirectBatch();
+			~IndirectBatch();
+
+			//Needs GL 4.3, for compute shaders and indirect draws
+			bool IsSupported() const {
+				return cullShader != nullptr;
+			}
+
+			//Anything without an indirect version of its shader, or that isn't opaque, is left out
+			void Build(const std::vector<const RenderObject*>& objects, const std::unordered_map<const ShaderBase*, OGLShader*>& shaders);
+			void Clear();
+
+			bool Contains(const RenderObject* o) const {
+				return contents.find(o) != contents.end();
+			}
+
+			bool IsEmpty() const {
+				return groups.empty();
+			}
+
+			const std::vector<Group>& GetGroups() const {
+				return groups;
+			}
+
+			//Occlusion is tested against hiZ's pyramid too, if there is one. lodScale is
+			//how much of the screen's height a sphere of radius 1 covers 1 unit away
+			void Cull(const Frustum& frustum, const Vector3& cameraPos, float lodScale, const HiZBuffer* hiZ = nullptr);
+			void DrawGroup(const Group& g) const;
+			void DrawShadows() const; //every shadow caster, from its proxy if it has one, without culling
+
+			static const int ObjectBinding	= 7; //storage buffer binding the draw shaders read objects from
+			static const int HiZTextureUnit	= 3; //past the main and shadow textures
+
+		protected:
+			struct ObjectData {
+				Matrix4 modelMatrix;
+				Vector4 colour;
+				Vector4 bounds;	//centre, then radius
+			};
+
+			//Laid out the way glMultiDrawElementsIndirect reads them
+			struct DrawCommand {
+				GLuint count;
+				GLuint instanceCount;
+				GLuint firstIndex;
+				GLint  baseVertex;
+				GLuint baseInstance;
+			};
+
+			//Where a mesh ended up in the merged buffers, with its submeshes' index ranges
+			struct MeshRange {
+				int						baseVertex;
+				std::vector<SubMesh>	subMeshes;
+				Vector3					centre;	//of its vertices' bounding box
+				Vector3					halfSize;
+			};
+
+			const MeshRange& AddMesh(const MeshGeometry* mesh);
+			//Along with all of its LODs, as they're all merged in
+			static bool HasCPUData(const MeshGeometry* mesh);
+			void Upload();
+
+			OGLComputeShader* cullShader = nullptr;
+			int cullUniforms[9] = {}; //planes, commandCount, the Hi-Z ones, then the LOD ones
+
+			GLuint vao				= 0;
+			GLuint positionBuffer	= 0;
+			GLuint texCoordBuffer	= 0;
+			GLuint normalBuffer		= 0;
+			GLuint indexBuffer		= 0;
+			GLuint objectIndexBuffer= 0; //0 to n, read per instance, so the base instance picks the object
+			GLuint objectBuffer		= 0;
+			GLuint sourceCommands	= 0;
+			GLuint commandLODBuffer	= 0; //the screen sizes each command's drawn between
+			GLuint culledCommands	= 0;
+			GLuint shadowCommands	= 0;
+
+			std::unordered_map<const MeshGeometry*, MeshRange> meshRanges;
+			std::vector<Vector3>		positions;
+			std::vector<Vector2>		texCoords;
+			std::vector<Vector3>		normals;
+			std::vector<unsigned int>	indices;
+
+			std::vector<ObjectData>		objects;
+			std::vector<DrawCommand>	commands;
+			std::vector<Vector2>		commandLODs;
+			std::vector<DrawCommand>	shadowCasters;
+			std::vector<Group>			groups;
+			std::unordered_set<const RenderObject*> contents;
+		};
+	}
+}
@@ -0,0 +1,158 @@
+#include "LevelData.h"
+#include "../../Common/Assets.h"
+#include "../../Common/AssetFile.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Binary levels are laid out like binary meshes - a header, then a table
+saying where each group of cells is, with each group's cell numbers 16
+byte aligned after it, so each is a single copy out of the mapped file.
+*/
+namespace {
+	const char		BinaryLevelMagic[4]	= { 'N', 'L', 'V', 'L' };
+	const uint32_t	BinaryLevelVersion	= 1;
+
+	struct BinaryLevelHeader {
+		char		magic[4];
+		uint32_t	version;
+		int32_t		unitSize;
+		int32_t		width;
+		int32_t		height;
+		uint32_t	numGroups;
+	};
+
+	struct BinaryLevelGroup {
+		uint32_t	type;
+		uint32_t	count;
+		uint64_t	offset;
+	};
+
+	std::string BinaryFilename(const std::string& filename) {
+		size_t dot = filename.find_last_of('.');
+		return (dot == std::string::npos ? filename : filename.substr(0, dot)) + ".blvl";
+	}
+
+	uint64_t AlignGroup(uint64_t offset) {
+		return (offset + 15) & ~(uint64_t)15;
+	}
+}
+
+bool LevelData::Load(const std::string& filename) {
+	return LoadBinary(filename) || LoadText(filename);
+}
+
+const LevelData::CellGroup* LevelData::GetGroup(char type) const {
+	for (const CellGroup& g : groups) {
+		if (g.type == type) {
+			return &g;
+		}
+	}
+	return nullptr;
+}
+
+//The size of a cell, the grid's width and height, then a character per cell
+bool LevelData::LoadText(const std::string& filename) {
+	AssetStream infile(Assets::DATADIR + filename);
+	if (!(infile >> unitSize >> width >> height) || width <= 0 || height <= 0) {
+		std::cout << __FUNCTION__ << " couldn't read " << filename << std::endl;
+		return false;
+	}
+	groups.clear();
+	int groupOf[256];
+	for (int& g : groupOf) {
+		g = -1;
+	}
+	for (int cell = 0; cell < width * height; ++cell) {
+		char type = 0;
+		if (!(infile >> type)) {
+			break;
+		}
+		unsigned char t = (unsigned char)type;
+		if (groupOf[t] < 0) {
+			groupOf[t] = (int)groups.size();
+			groups.push_back({ type, {} });
+		}
+		groups[groupOf[t]].cells.emplace_back((uint32_t)cell);
+	}
+	return true;
+}
+
+bool LevelData::LoadBinary(const std::string& filename) {
+	AssetFile file;
+	if (!file.Open(Assets::DATADIR + BinaryFilename(filename))) {
+		return false;
+	}
+	BinaryLevelHeader header;
+	if (file.GetSize() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.magic, BinaryLevelMagic, 4) != 0 || header.version != BinaryLevelVersion ||
+		sizeof(header) + (uint64_t)header.numGroups * sizeof(BinaryLevelGroup) > file.GetSize()) {
+		std::cout << __FUNCTION__ << " binary level for " << filename << " isn't one this version can read, using the text one" << std::endl;
+		return false;
+	}
+	unitSize	= header.unitSize;
+	width		= header.width;
+	height		= header.height;
+	groups.resize(header.numGroups);
+	for (uint32_t i = 0; i < header.numGroups; ++i) {
+		BinaryLevelGroup g;
+		memcpy(&g, file.GetData() + sizeof(header) + i * sizeof(g), sizeof(g));
+		if (g.offset + (uint64_t)g.count * sizeof(uint32_t) > file.GetSize()) {
+			std::cout << __FUNCTION__ << " binary level for " << filename << " is cut short, using the text one" << std::endl;
+			groups.clear();
+			return false;
+		}
+		groups[i].type = (char)g.type;
+		groups[i].cells.resize(g.count);
+		memcpy(groups[i].cells.data(), file.GetData() + g.offset, g.count * sizeof(uint32_t));
+	}
+	return true;
+}
+
+bool LevelData::SaveBinary(const std::string& filename) const {
+	std::ofstream out(Assets::DATADIR + BinaryFilename(filename), std::ios::binary);
+	if (!out) {
+		return false;
+	}
+	BinaryLevelHeader header;
+	memcpy(header.magic, BinaryLevelMagic, 4);
+	header.version		= BinaryLevelVersion;
+	header.unitSize		= unitSize;
+	header.width		= width;
+	header.height		= height;
+	header.numGroups	= (uint32_t)groups.size();
+
+	std::vector<BinaryLevelGroup> table(groups.size());
+	uint64_t offset = AlignGroup(sizeof(header) + table.size() * sizeof(BinaryLevelGroup));
+	for (size_t i = 0; i < groups.size(); ++i) {
+		table[i].type	= (uint32_t)(unsigned char)groups[i].type;
+		table[i].count	= (uint32_t)groups[i].cells.size();
+		table[i].offset	= offset;
+		offset = AlignGroup(offset + groups[i].cells.size() * sizeof(uint32_t));
+	}
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)table.data(), table.size() * sizeof(BinaryLevelGroup));
+	for (size_t i = 0; i < groups.size(); ++i) {
+		uint64_t written = (uint64_t)out.tellp();
+		static const char padding[16] = {};
+		out.write(padding, (std::streamsize)(table[i].offset - written));
+		out.write((const char*)groups[i].cells.data(), groups[i].cells.size() * sizeof(uint32_t));
+	}
+	return (bool)out;
+}
+
+bool LevelData::ConvertToBinary(const std::string& filename) {
+	LevelData level;
+	if (!level.LoadText(filename) || !level.SaveBinary(filename)) {
+		std::cout << __FUNCTION__ << " couldn't convert " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A level's grid, as lists of which cells hold each kind of thing,
+		rather than as the grid itself - so everything of one kind can be
+		built together, and the empty cells (most of them) cost nothing.
+		Cells are numbered y * width + x, and each kind's are kept in the
+		order they come in the grid.
+
+		It's read from a baked binary copy, made with ConvertToBinary, if
+		there is one, and from the text grid if not. As with meshes, nothing
+		checks the binary's newer, so it has to be baked again whenever the
+		level changes.
+		*/
+		class LevelData {
+		public:
+			struct CellGroup {
+				char					type;
+				std::vector<uint32_t>	cells;
+			};
+
+			bool Load(const std::string& filename);
+
+			//Writes a binary copy of a text level next to it, used instead of it from then on
+			static bool ConvertToBinary(const std::string& filename);
+
+			int GetUnitSize() const { return unitSize; }
+			int GetWidth() const { return width; }
+			int GetHeight() const { return height; }
+
+			const std::vector<CellGroup>& GetGroups() const { return groups; }
+			//Null if there are none of that kind
+			const CellGroup* GetGroup(char type) const;
+
+		protected:
+			bool LoadText(const std::string& filename);
+			bool LoadBinary(const std::string& filename);
+			bool SaveBinary(const std::string& filename) const;
+
+			int unitSize	= 1;
+			int width		= 0;
+			int height		= 0;
+			std::vector<CellGroup> groups;
+		};
+	}
+}
@@ -5,11 +5,15 @@
 #include "ColourBlock.h"
 #include "NetworkColourBlock.h"
 #include "NetworkRefillPoint.h"
-#include "PaintSplat.h"
+#include "LevelData.h"
+#include "LevelStreamer.h"
+#include "TextureStreamer.h"
 
 #include "../CSC8503Common/GameWorld.h"
 #include "../CSC8503Common/CollisionDetection.h"
 #include "../CSC8503Common/NavigationGrid.h"
+#include "../CSC8503Common/JobSystem.h"
+#include "../CSC8503Common/FrameProfiler.h"
 
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
@@ -17,8 +21,14 @@
 #include "../../Common/TextureLoader.h"
 
 #include "../../Common/Assets.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Common/AssetFile.h"
 
 #include <fstream>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <cfloat>
 #include <OGLMesh.cpp>
 
 const Vector4 COLOUR_RED = Vector4(1, 0, 0, 1);
@@ -37,9 +47,49 @@ const Vector4 COLOUR_CYAN = Vector4(0, 1, 1, 1);
 
 NCL::CSC8503::LevelManager::LevelManager(Game* g, GameWorld& gw) : game(g), world(gw) {
 	//InitialiseAssets();
+	streamer = new LevelStreamer(*this, world);
+
+	//Whatever takes a pooled projectile out of the world, such as clearing it, takes it out of the pool too
+	world.AddObjectListener(this,
+		[](GameObject* o) {},
+		[&](GameObject* o) {
+			for (auto& waiting : meshWaiters) {
+				waiting.second.erase(std::remove(waiting.second.begin(), waiting.second.end(), o), waiting.second.end());
+			}
+			if (o->GetTypeID() != ObjectType::Projectile) {
+				return;
+			}
+			auto i = std::find(projectilePool.begin(), projectilePool.end(), (Projectile*)o);
+			if (i == projectilePool.end()) {
+				return;
+			}
+			projectilePool.erase(i);
+			if (nextProjectile >= (int)projectilePool.size()) {
+				nextProjectile = 0;
+			}
+		}
+	);
 }
 
 NCL::CSC8503::LevelManager::~LevelManager() {
+	delete streamer; //anything it's still building has to be finished first
+	delete textureStreamer; //before the textures it's streaming into
+	world.RemoveObjectListener(this);
+	if (parsingOnJobs) {
+		//Still reading assets in, if the game was closed while they were loading
+		JobSystem::GetJobSystem()->WaitForAll();
+	}
+	for (int i = 0; i < (int)assetInfo.size(); ++i) {
+		if (!assetFinished.empty() && !assetFinished[i]) {
+			AssetLoadInfo& info = assetInfo[i];
+			delete info.mesh;
+			delete info.material;
+			delete info.animation;
+			delete info.compressedTex;
+			free(info.texData);
+		}
+	}
+	delete textureUploader;
 
 	for (map<string, OGLMesh*>::iterator it = meshMap.begin(); it != meshMap.end(); it++) {
 		delete it->second;
@@ -69,98 +119,238 @@ NCL::CSC8503::LevelManager::~LevelManager() {
 
 void NCL::CSC8503::LevelManager::InitialiseAssets() {
 	assetsLoading = true;
+	textureStreamer = new TextureStreamer();
+	const AssetResidency Eager		= AssetResidency::Eager;
+	const AssetResidency PerLevel	= AssetResidency::PerLevel;
+	const AssetResidency OnFirstUse	= AssetResidency::OnFirstUse;
 
 	// Meshes
-	assetInfo.push_back(AssetLoadInfo('m', "cube", "cube.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "sphere", "sphere.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "Male1", "Male1.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "courier", "courier.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "security", "security.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "coin", "coin.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "capsule", "capsule.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "Male_Guard", "Male_Guard.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "WoodenBox", "WoodenBox.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "OHW_Ranged_PistolLethal", "OHW_Ranged_PistolLethal.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "THW_Ranged_SMGSoldier", "THW_Ranged_SMGSoldier.msh"));
-	assetInfo.push_back(AssetLoadInfo('m', "corridor_Wall_Straight_Mid_end_R", "corridor_Wall_Straight_Mid_end_R.msh"));
+	DeclareAsset(Eager, AssetLoadInfo('m', "cube", "cube.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "sphere", "sphere.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "Male1", "Male1.msh"));
+	DeclareAsset(OnFirstUse, AssetLoadInfo('m', "courier", "courier.msh"));
+	DeclareAsset(OnFirstUse, AssetLoadInfo('m', "security", "security.msh"));
+	DeclareAsset(OnFirstUse, AssetLoadInfo('m', "coin", "coin.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "capsule", "capsule.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "Male_Guard", "Male_Guard.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "WoodenBox", "WoodenBox.msh"));
+	DeclareAsset(OnFirstUse, AssetLoadInfo('m', "OHW_Ranged_PistolLethal", "OHW_Ranged_PistolLethal.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "THW_Ranged_SMGSoldier", "THW_Ranged_SMGSoldier.msh"));
+	DeclareAsset(PerLevel, AssetLoadInfo('m', "corridor_Wall_Straight_Mid_end_R", "corridor_Wall_Straight_Mid_end_R.msh"));
 
 	// Textures
-	assetInfo.push_back(AssetLoadInfo('t', "WhiteTex", "WhiteTex.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "yellowTex", "yellowTex.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "stoneTex", "stoneTex.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "playerTex", "playerTex.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "colourTex", "colourTex.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "gun", "gun.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "corridor_wall_c", "corridor_wall_c.tga"));
-	assetInfo.push_back(AssetLoadInfo('t', "p1", "p1.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "p2", "p2.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "p3", "p3.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "p4", "p4.png"));
-	assetInfo.push_back(AssetLoadInfo('t', "default", "checkerboard.png"));
-	for (int i = 0; i < 35; ++i) {
-		assetInfo.push_back(AssetLoadInfo('t', "splat" + to_string(i), "splat" + (i < 10 ? "0" + to_string(i) : to_string(i)) + ".png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "WhiteTex", "WhiteTex.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "yellowTex", "yellowTex.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "stoneTex", "stoneTex.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "playerTex", "playerTex.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "colourTex", "colourTex.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "gun", "gun.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "corridor_wall_c", "corridor_wall_c.tga"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "p1", "p1.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "p2", "p2.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "p3", "p3.png"));
+	DeclareAsset(PerLevel, AssetLoadInfo('t', "p4", "p4.png"));
+	DeclareAsset(Eager, AssetLoadInfo('t', "default", "checkerboard.png"));
+	//Only drawn with on their own if there's no texture array for them
+	for (int i = 0; i < SplatTextureCount; ++i) {
+		DeclareAsset(OnFirstUse, AssetLoadInfo('t', "splat" + to_string(i), SplatFilename(i)));
 	}
 
 	// Materials
-	assetInfo.push_back(AssetLoadInfo('e', "wall", "corridor_Wall_Straight_Mid_end_R.mat"));
-	assetInfo.push_back(AssetLoadInfo('e', "Male_Guard", "Male_Guard.mat"));
+	DeclareAsset(PerLevel, AssetLoadInfo('e', "wall", "corridor_Wall_Straight_Mid_end_R.mat"));
+	DeclareAsset(PerLevel, AssetLoadInfo('e', "Male_Guard", "Male_Guard.mat"));
 
 	// Animations
-	assetInfo.push_back(AssetLoadInfo('a', "StepForward", "StepForwardRifle.anm"));
-
-	// Shaders
-	assetInfo.push_back(AssetLoadInfo('s', "default", "GameTechVert.glsl", "GameTechFrag.glsl"));
-	assetInfo.push_back(AssetLoadInfo('s', "box", "GameTechVert.glsl", "BoxFrag.glsl"));
-	assetInfo.push_back(AssetLoadInfo('s', "guard", "guardVertex.glsl", "GameTechFrag.glsl"));
-	assetInfo.push_back(AssetLoadInfo('s', "line", "lineVertex.glsl", "lineFrag.glsl", "lineGeometry.glsl"));
+	DeclareAsset(PerLevel, AssetLoadInfo('a', "StepForward", "StepForwardRifle.anm"));
+
+	// Shaders - the renderer's given all of these once loading's finished
+	DeclareAsset(Eager, AssetLoadInfo('s', "default", "GameTechVert.glsl", "GameTechFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "defaultInstanced", "GameTechInstancedVert.glsl", "GameTechFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "defaultInstancedArray", "GameTechInstancedVert.glsl", "GameTechArrayFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "defaultIndirect", "GameTechIndirectVert.glsl", "GameTechFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "box", "GameTechVert.glsl", "BoxFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "boxIndirect", "GameTechIndirectVert.glsl", "BoxFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "guard", "guardVertex.glsl", "GameTechFrag.glsl"));
+	DeclareAsset(Eager, AssetLoadInfo('s', "line", "lineVertex.glsl", "lineFrag.glsl", "lineGeometry.glsl"));
 	// Audio
-	assetInfo.push_back(AssetLoadInfo('l', "lol", "lol.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "gunshot", "gunshot.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "paintshot", "paintshot.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "paintsplat", "paintsplat.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "powerup", "powerup.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "hurt", "hurt.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "death", "death.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "emptygun", "emptygun.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "menumusic", "menumusic.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "menuclick", "menuclick.wav"));
-	assetInfo.push_back(AssetLoadInfo('l', "end", "end.wav"));
-}
-
-float NCL::CSC8503::LevelManager::LoadNextAsset() {
-	AssetLoadInfo info = assetInfo[numAssetsLoaded];
-	switch (info.type) {
-	case 'm':
-		LoadMesh(info.identifier, info.filenameOne);
-		break;
-	case 't':
-		LoadTexture(info.identifier, info.filenameOne);
-		break;
-	case 'e':
-		LoadMaterial(info.identifier, info.filenameOne);
-		break;
-	case 'a':
-		LoadAnimation(info.identifier, info.filenameOne);
-		break;
-	case 's':
-		LoadShader(info.identifier, info.filenameOne, info.filenameTwo,info.filenameThree);
-		break;
-	case 'l':
-		LoadSound(info.identifier, info.filenameOne);
-		break;
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "lol", "lol.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "gunshot", "gunshot.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "paintshot", "paintshot.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "paintsplat", "paintsplat.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "powerup", "powerup.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "hurt", "hurt.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "death", "death.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "emptygun", "emptygun.wav"));
+	DeclareAsset(Eager, AssetLoadInfo('l', "menumusic", "menumusic.wav"));
+	DeclareAsset(Eager, AssetLoadInfo('l', "menuclick", "menuclick.wav"));
+	DeclareAsset(PerLevel, AssetLoadInfo('l', "end", "end.wav"));
+
+	assetParsed.assign(assetInfo.size(), false);
+	assetFinished.assign(assetInfo.size(), false);
+	parsingOnJobs = JobSystem::GetJobSystem() != nullptr;
+	RequestAssets(AssetResidency::Eager);
+}
+
+void NCL::CSC8503::LevelManager::DeclareAsset(AssetResidency residency, const AssetLoadInfo& info) {
+	assetIndices[string(1, info.type) + info.identifier] = (int)assetInfo.size();
+	assetInfo.push_back(info);
+	assetInfo.back().residency = residency;
+}
+
+/*
+Textures are there from as soon as they're asked for, showing a
+placeholder until they've been sent up, so anything can be given them
+straight away. The uploader only sticks around for as long as there's
+something for it to do.
+*/
+void NCL::CSC8503::LevelManager::RequestAsset(int index) {
+	AssetLoadInfo& info = assetInfo[index];
+	if (info.requested) {
+		return;
+	}
+	info.requested = true;
+	numAssetsRequested++;
+	if (info.type == 't') {
+		if (!textureUploader) {
+			textureUploader = new OGLTextureUploader();
+		}
+		info.texture = textureUploader->CreateTexture();
+		texMap[info.identifier] = info.texture;
+	}
+	if (parsingOnJobs) {
+		JobSystem::GetJobSystem()->Submit([this, index]() { ParseAsset(index); });
+	}
+}
+
+void NCL::CSC8503::LevelManager::RequestAsset(char type, const string& identifier) {
+	auto i = assetIndices.find(string(1, type) + identifier);
+	if (i != assetIndices.end()) {
+		RequestAsset(i->second);
+	}
+}
+
+void NCL::CSC8503::LevelManager::RequestAssets(AssetResidency residency) {
+	for (int i = 0; i < (int)assetInfo.size(); ++i) {
+		if (assetInfo[i].residency == residency) {
+			RequestAsset(i);
+		}
 	}
+}
 
-	numAssetsLoaded++;
-	float percentComplete = (float)numAssetsLoaded / (float)assetInfo.size() * 100;
+/*
+Files are read in and parsed on the job system, all at once, so the time
+that takes mostly overlaps. Only the parts that need the GL (or AL)
+context are done here, in whatever order the workers finish things, for
+as long as the budget allows each frame, so the loading screen keeps
+drawing. Without a job system it all gets done here, as each asset's
+reached.
+*/
+bool NCL::CSC8503::LevelManager::FinishRequestedAssets(float budget) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < (int)assetInfo.size() && numAssetsLoaded < numAssetsRequested; ++i) {
+		if (!assetInfo[i].requested || assetFinished[i]) {
+			continue;
+		}
+		if (parsingOnJobs) {
+			std::lock_guard<std::mutex> lock(assetMutex);
+			if (!assetParsed[i]) {
+				continue;
+			}
+		}
+		else {
+			ParseAsset(i);
+		}
+		FinishAsset(i);
+		assetFinished[i] = true;
+		numAssetsLoaded++;
+		if (std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >= budget) {
+			break;
+		}
+	}
+	if (textureUploader) {
+		textureUploader->Update();
+	}
+	if (numAssetsLoaded < numAssetsRequested) {
+		return false;
+	}
+	//The upload buffer can't go until the GPU's finished reading from it
+	if (textureUploader && textureUploader->GetPendingCount() == 0) {
+		delete textureUploader;
+		textureUploader = nullptr;
+	}
+	return !textureUploader;
+}
 
-	if ((int)percentComplete == 100) {
-		InitMaterials();
+float NCL::CSC8503::LevelManager::LoadAssets() {
+	ProfileScope scope("Load Assets");
+	bool finished = FinishRequestedAssets(assetUploadBudget);
+	float percentComplete = (float)numAssetsLoaded / (float)numAssetsRequested * 100;
+	if (finished) {
+		RequestAssets(AssetResidency::PerLevel); //while the menu's up
+		ResolveAssetHandles();
+		paintDecals.SetAppearance(assets.cubeMesh, assets.defaultShader);
 		assetsLoading = false;
 		game->ChangeState(Game::State::MAIN_MENU);
 	}
 	return percentComplete;
 }
 
+void NCL::CSC8503::LevelManager::UpdateAssets() {
+	if (assetsLoading || (numAssetsLoaded == numAssetsRequested && !textureUploader)) {
+		return;
+	}
+	ProfileScope scope("Load Assets");
+	FinishRequestedAssets(assetUploadBudget);
+	InitLevelAssets();
+}
+
+//Whatever the workers haven't got to yet is waited for, then everything's finished in one go
+void NCL::CSC8503::LevelManager::FinishLevelAssets() {
+	if (assetInfo.empty() || levelAssetsReady) {
+		return; //headless, or they're already there
+	}
+	ProfileScope scope("Load Assets");
+	RequestAssets(AssetResidency::PerLevel);
+	while (!FinishRequestedAssets(FLT_MAX) && numAssetsLoaded < numAssetsRequested) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	InitLevelAssets();
+}
+
+/*
+Only once every level asset's been finished, as the materials, arrays
+and LODs are made from them. Textures might still be showing their
+placeholders, but they're there.
+*/
+void NCL::CSC8503::LevelManager::InitLevelAssets() {
+	if (levelAssetsReady) {
+		return;
+	}
+	for (int i = 0; i < (int)assetInfo.size(); ++i) {
+		if (assetInfo[i].residency == AssetResidency::PerLevel && !assetFinished[i]) {
+			return;
+		}
+	}
+	levelAssetsReady = true;
+	InitMaterials();
+	InitTextureArrays();
+	InitMeshLODs();
+	ResolveAssetHandles();
+}
+
+OGLMesh* NCL::CSC8503::LevelManager::MeshOnFirstUse(GameObject* o, const string& identifier) {
+	auto i = assetIndices.find("m" + identifier);
+	if (i == assetIndices.end()) {
+		return nullptr;
+	}
+	if (assetFinished[i->second]) {
+		return meshMap[identifier];
+	}
+	RequestAsset(i->second);
+	meshWaiters[i->second].emplace_back(o);
+	return assets.cubeMesh;
+}
+
 GameObject* NCL::CSC8503::LevelManager::AddFloorToWorld(const Vector3& position, const Vector3& dimensions) {
 	GameObject* floor = new GameObject("Floor");
 	floor->SetLayer(CollisionLayer::FLOOR);
@@ -171,7 +361,7 @@ GameObject* NCL::CSC8503::LevelManager::AddFloorToWorld(const Vector3& position,
 		.SetScale(dimensions * 2)
 		.SetPosition(position);
 
-	floor->SetRenderObject(new RenderObject(&floor->GetTransform(), meshMap["cube"], texMap["stoneTex"], shaderMap["default"]));
+	floor->SetRenderObject(new RenderObject(&floor->GetTransform(), assets.cubeMesh, assets.stoneTex, assets.defaultShader));
 	floor->SetPhysicsObject(new PhysicsObject(&floor->GetTransform(), floor->GetBoundingVolume()));
 
 	floor->GetPhysicsObject()->SetInverseMass(0);
@@ -193,7 +383,7 @@ GameObject* NCL::CSC8503::LevelManager::AddSphereToWorld(const Vector3& position
 		.SetScale(sphereSize)
 		.SetPosition(position);
 
-	sphere->SetRenderObject(new RenderObject(&sphere->GetTransform(), meshMap["sphere"], texMap["default"], shaderMap["default"]));
+	sphere->SetRenderObject(new RenderObject(&sphere->GetTransform(), assets.sphereMesh, assets.defaultTex, assets.defaultShader));
 	sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
 
 	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -215,7 +405,7 @@ GameObject* NCL::CSC8503::LevelManager::AddAABBCubeToWorld(const Vector3& positi
 		.SetPosition(position)
 		.SetScale(dimensions * 2);
 
-	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), meshMap["cube"], texMap["default"], shaderMap["default"]));
+	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), assets.cubeMesh, assets.defaultTex, assets.defaultShader));
 	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
 
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -237,7 +427,7 @@ GameObject* NCL::CSC8503::LevelManager::AddOBBCubeToWorld(const Vector3& positio
 		.SetPosition(position)
 		.SetScale(dimensions * 2);
 
-	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), meshMap["cube"], texMap["default"], shaderMap["default"]));
+	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), assets.cubeMesh, assets.defaultTex, assets.defaultShader));
 	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
 
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -258,7 +448,7 @@ GameObject* NCL::CSC8503::LevelManager::AddCapsuleToWorld(const Vector3& positio
 		.SetScale(Vector3(radius * 2, halfHeight, radius * 2))
 		.SetPosition(position);
 
-	capsule->SetRenderObject(new RenderObject(&capsule->GetTransform(), meshMap["capsule"], texMap["default"], shaderMap["default"]));
+	capsule->SetRenderObject(new RenderObject(&capsule->GetTransform(), assets.capsuleMesh, assets.defaultTex, assets.defaultShader));
 	capsule->SetPhysicsObject(new PhysicsObject(&capsule->GetTransform(), capsule->GetBoundingVolume()));
 
 	capsule->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -283,7 +473,7 @@ GameObject* NCL::CSC8503::LevelManager::AddCharacterToWorld(const Vector3& posit
 		.SetScale(Vector3(meshSize, meshSize, meshSize))
 		.SetPosition(position);
 
-	character->SetRenderObject(new RenderObject(&character->GetTransform(), useMeshA ? meshMap["Male1"] : meshMap["courier"], nullptr, shaderMap["default"]));
+	character->SetRenderObject(new RenderObject(&character->GetTransform(), useMeshA ? assets.maleMesh : MeshOnFirstUse(character, "courier"), nullptr, assets.defaultShader));
 	character->SetPhysicsObject(new PhysicsObject(&character->GetTransform(), character->GetBoundingVolume()));
 
 	character->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -307,7 +497,7 @@ GameObject* NCL::CSC8503::LevelManager::AddEnemyToWorld(const Vector3& position)
 		.SetScale(Vector3(meshSize, meshSize, meshSize))
 		.SetPosition(position);
 
-	character->SetRenderObject(new RenderObject(&character->GetTransform(), meshMap["security"], nullptr, shaderMap["default"]));
+	character->SetRenderObject(new RenderObject(&character->GetTransform(), MeshOnFirstUse(character, "security"), nullptr, assets.defaultShader));
 	character->SetPhysicsObject(new PhysicsObject(&character->GetTransform(), character->GetBoundingVolume()));
 
 	character->GetPhysicsObject()->SetInverseMass(inverseMass);
@@ -327,7 +517,7 @@ GameObject* NCL::CSC8503::LevelManager::AddBonusToWorld(const Vector3& position)
 		.SetScale(Vector3(0.25, 0.25, 0.25))
 		.SetPosition(position);
 
-	bonus->SetRenderObject(new RenderObject(&bonus->GetTransform(), meshMap["coin"], nullptr, shaderMap["default"]));
+	bonus->SetRenderObject(new RenderObject(&bonus->GetTransform(), MeshOnFirstUse(bonus, "coin"), nullptr, assets.defaultShader));
 	bonus->SetPhysicsObject(new PhysicsObject(&bonus->GetTransform(), bonus->GetBoundingVolume()));
 
 	bonus->GetPhysicsObject()->SetInverseMass(1.0f);
@@ -349,9 +539,11 @@ SoundEmitter* NCL::CSC8503::LevelManager::AddExampleSoundToWorld(const Vector3&
 		.SetPosition(position)
 		.SetScale(dimensions * 2);
 
-	e->SetRenderObject(new RenderObject(&e->GetTransform(), meshMap["cube"], texMap["default"], shaderMap["default"]));
+	e->SetRenderObject(new RenderObject(&e->GetTransform(), assets.cubeMesh, assets.defaultTex, assets.defaultShader));
 	e->GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
-	SoundSystem::GetSoundSystem()->AddSoundEmitter(e);
+	if (SoundSystem::GetSoundSystem()) {
+		SoundSystem::GetSoundSystem()->AddSoundEmitter(e);
+	}
 
 	world.AddGameObject(e);
 
@@ -368,7 +560,9 @@ SoundEmitter* NCL::CSC8503::LevelManager::AddSoundEmitterToWorld(const Vector3&
 
 	e->GetTransform().SetPosition(position);
 
-	SoundSystem::GetSoundSystem()->AddSoundEmitter(e);
+	if (SoundSystem::GetSoundSystem()) { //there isn't one on a headless server
+		SoundSystem::GetSoundSystem()->AddSoundEmitter(e);
+	}
 
 	world.AddGameObject(e);
 
@@ -387,13 +581,15 @@ RefillPoint* NCL::CSC8503::LevelManager::AddRefillPoint(const Vector3& position,
 		.SetScale(sphereSize * 3)
 		.SetPosition(position);
 
-	r->SetRenderObject(new RenderObject(&r->GetTransform(), meshMap["THW_Ranged_SMGSoldier"], texMap["gun"], shaderMap["default"]));
+	r->SetRenderObject(new RenderObject(&r->GetTransform(), assets.gunMesh, assets.gunTex, assets.defaultShader));
 	r->GetRenderObject()->SetColour(COLOUR_GREEN);
 
 	r->SetPhysicsObject(new PhysicsObject(&r->GetTransform(), r->GetBoundingVolume()));
 	r->GetPhysicsObject()->SetInverseMass(0);
 	r->GetPhysicsObject()->InitSphereInertia();
 
+	r->SetLight(&dynamicLights, dynamicLights.AddSteady(position, Vector4(), radius * 8.0f));
+
 	world.AddGameObject(r);
 
 	return r;
@@ -411,7 +607,7 @@ NetworkRefillPoint* NCL::CSC8503::LevelManager::AddRefillPoint(int networkID, Ne
 		.SetScale(sphereSize * 3)
 		.SetPosition(position);
 
-	r->SetRenderObject(new RenderObject(&r->GetTransform(), meshMap["THW_Ranged_SMGSoldier"], texMap["gun"], shaderMap["default"]));
+	r->SetRenderObject(new RenderObject(&r->GetTransform(), assets.gunMesh, assets.gunTex, assets.defaultShader));
 	r->GetRenderObject()->SetColour(COLOUR_GREEN);
 	r->SetNetworkObject(new NetworkObject(*r, networkID));
 	game->AddNetworkObject(r->GetNetworkObject(), networkID);
@@ -420,12 +616,35 @@ NetworkRefillPoint* NCL::CSC8503::LevelManager::AddRefillPoint(int networkID, Ne
 	r->GetPhysicsObject()->SetInverseMass(0);
 	r->GetPhysicsObject()->InitSphereInertia();
 
+	r->SetLight(&dynamicLights, dynamicLights.AddSteady(position, Vector4(), radius * 8.0f));
+
 	world.AddGameObject(r);
 
 	return r;
 }
 
 Projectile* NCL::CSC8503::LevelManager::AddProjectile(const Vector3& position, bool colourProjectile) {
+	int poolSize = (int)projectilePool.size();
+	for (int i = 0; i < poolSize; ++i) {
+		int index = (nextProjectile + i) % poolSize;
+		if (!projectilePool[index]->IsActive()) {
+			nextProjectile = index;
+			break;
+		}
+	}
+	if (poolSize > 0 && (poolSize == ProjectilePoolSize || !projectilePool[nextProjectile]->IsActive())) {
+		Projectile* projectile = projectilePool[nextProjectile];
+		nextProjectile = (nextProjectile + 1) % poolSize;
+		projectile->Reactivate(position, colourProjectile);
+		return projectile;
+	}
+	Projectile* projectile = BuildProjectile(position, colourProjectile);
+	projectile->SetPooled(true);
+	projectilePool.emplace_back(projectile);
+	return projectile;
+}
+
+Projectile* NCL::CSC8503::LevelManager::BuildProjectile(const Vector3& position, bool colourProjectile) {
 	float radius = 0.25f;
 	float inverseMass = 10;
 
@@ -439,11 +658,14 @@ Projectile* NCL::CSC8503::LevelManager::AddProjectile(const Vector3& position, b
 		.SetScale(sphereSize)
 		.SetPosition(position);
 
-	projectile->SetRenderObject(new RenderObject(&projectile->GetTransform(), meshMap["sphere"], nullptr, shaderMap["default"]));
+	projectile->SetRenderObject(new RenderObject(&projectile->GetTransform(), assets.sphereMesh, nullptr, assets.defaultShader));
 	projectile->SetPhysicsObject(new PhysicsObject(&projectile->GetTransform(), projectile->GetBoundingVolume()));
 
 	projectile->GetPhysicsObject()->SetInverseMass(inverseMass);
 	projectile->GetPhysicsObject()->InitSphereInertia();
+	projectile->GetPhysicsObject()->SetWakesOnContact(true);
+	projectile->GetPhysicsObject()->SetContinuousCollision(true);
+	projectile->GetPhysicsObject()->SetUseSmallObjectGrid(true);
 
 	world.AddGameObject(projectile);
 
@@ -464,12 +686,15 @@ NetworkProjectile* NCL::CSC8503::LevelManager::AddProjectile(int networkID, Netw
 		.SetScale(sphereSize)
 		.SetPosition(position);
 
-	projectile->SetRenderObject(new RenderObject(&projectile->GetTransform(), meshMap["sphere"], nullptr, shaderMap["default"]));
+	projectile->SetRenderObject(new RenderObject(&projectile->GetTransform(), assets.sphereMesh, nullptr, assets.defaultShader));
 	projectile->SetPhysicsObject(new PhysicsObject(&projectile->GetTransform(), projectile->GetBoundingVolume()));
 	projectile->SetNetworkObject(new NetworkObject(*projectile, networkID));
 
 	projectile->GetPhysicsObject()->SetInverseMass(inverseMass);
 	projectile->GetPhysicsObject()->InitSphereInertia();
+	projectile->GetPhysicsObject()->SetWakesOnContact(true);
+	projectile->GetPhysicsObject()->SetContinuousCollision(true);
+	projectile->GetPhysicsObject()->SetUseSmallObjectGrid(true);
 
 	world.AddGameObject(projectile);
 
@@ -477,6 +702,30 @@ NetworkProjectile* NCL::CSC8503::LevelManager::AddProjectile(int networkID, Netw
 }
 
 ColourBlock* NCL::CSC8503::LevelManager::AddColourBlock(const Vector3& position, const Vector3& dimensions) {
+	ColourBlock* cBlock = MakeColourBlock(position, dimensions);
+	world.AddGameObject(cBlock);
+	return cBlock;
+}
+
+NetworkColourBlock* NCL::CSC8503::LevelManager::AddColourBlock(int networkID, NetworkedGame* game, const Vector3& position, const Vector3& dimensions) {
+	NetworkColourBlock* cBlock = MakeColourBlock(networkID, game, position, dimensions);
+	world.AddGameObject(cBlock);
+	return cBlock;
+}
+
+GameObject* NCL::CSC8503::LevelManager::AddObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass, bool addCollider) {
+	GameObject* cube = MakeObstacleBox(position, dimensions, inverseMass, addCollider);
+	world.AddGameObject(cube);
+	return cube;
+}
+
+GameObject* NCL::CSC8503::LevelManager::AddEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& direction, const Quaternion& orientation, float inverseMass, bool addCollider) {
+	GameObject* cube = MakeEdgeWall(position, dimensions, direction, orientation, inverseMass, addCollider);
+	world.AddGameObject(cube);
+	return cube;
+}
+
+ColourBlock* NCL::CSC8503::LevelManager::MakeColourBlock(const Vector3& position, const Vector3& dimensions) {
 	ColourBlock* cBlock = new ColourBlock();
 
 	AABBVolume* volume = new AABBVolume(dimensions);
@@ -487,18 +736,16 @@ ColourBlock* NCL::CSC8503::LevelManager::AddColourBlock(const Vector3& position,
 		.SetPosition(position)
 		.SetScale(dimensions * 2);
 
-	cBlock->SetRenderObject(new RenderObject(&cBlock->GetTransform(), meshMap["cube"], texMap["WhiteTex"], shaderMap["default"]));
+	cBlock->SetRenderObject(new RenderObject(&cBlock->GetTransform(), assets.cubeMesh, assets.whiteTex, assets.defaultShader));
 	cBlock->SetPhysicsObject(new PhysicsObject(&cBlock->GetTransform(), cBlock->GetBoundingVolume()));
 
 	cBlock->GetPhysicsObject()->SetInverseMass(0);
 	cBlock->GetPhysicsObject()->InitCubeInertia();
 
-	world.AddGameObject(cBlock);
-
 	return cBlock;
 }
 
-NetworkColourBlock* NCL::CSC8503::LevelManager::AddColourBlock(int networkID, NetworkedGame* game, const Vector3& position, const Vector3& dimensions) {
+NetworkColourBlock* NCL::CSC8503::LevelManager::MakeColourBlock(int networkID, NetworkedGame* game, const Vector3& position, const Vector3& dimensions) {
 	NetworkColourBlock* cBlock = new NetworkColourBlock(networkID, game);
 
 	AABBVolume* volume = new AABBVolume(dimensions);
@@ -509,99 +756,136 @@ NetworkColourBlock* NCL::CSC8503::LevelManager::AddColourBlock(int networkID, Ne
 		.SetPosition(position)
 		.SetScale(dimensions * 2);
 
-	cBlock->SetRenderObject(new RenderObject(&cBlock->GetTransform(), meshMap["cube"], texMap["WhiteTex"], shaderMap["default"]));
+	cBlock->SetRenderObject(new RenderObject(&cBlock->GetTransform(), assets.cubeMesh, assets.whiteTex, assets.defaultShader));
 	cBlock->SetPhysicsObject(new PhysicsObject(&cBlock->GetTransform(), cBlock->GetBoundingVolume()));
 	cBlock->SetNetworkObject(new NetworkObject(*cBlock, networkID));
 
 	cBlock->GetPhysicsObject()->SetInverseMass(0);
 	cBlock->GetPhysicsObject()->InitCubeInertia();
 
-	world.AddGameObject(cBlock);
-
 	return cBlock;
 }
 
-GameObject* NCL::CSC8503::LevelManager::AddObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass) {
+GameObject* NCL::CSC8503::LevelManager::MakeObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass, bool addCollider) {
 	GameObject* cube = new GameObject("Obstacle Box");
 
-	AABBVolume* volume = new AABBVolume(dimensions);
-
-	cube->SetBoundingVolume((CollisionVolume*)volume);
-
 	cube->GetTransform()
 		.SetPosition(position)
 		.SetScale(dimensions * 2.45);
 
-	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), meshMap["WoodenBox"], texMap["yellowTex"], shaderMap["box"]));
+	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), assets.boxMesh, assets.yellowTex, assets.boxShader));
+	cube->GetRenderObject()->SetStaticGeometry(inverseMass == 0);
 
-	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+	if (addCollider) {
+		AABBVolume* volume = new AABBVolume(dimensions);
 
-	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
-	cube->GetPhysicsObject()->InitCubeInertia();
+		cube->SetBoundingVolume((CollisionVolume*)volume);
 
-	world.AddGameObject(cube);
+		cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+
+		cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+		cube->GetPhysicsObject()->InitCubeInertia();
+	}
 
 	return cube;
 }
 
-GameObject* NCL::CSC8503::LevelManager::AddEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& direction, const Quaternion& orientation, float inverseMass) {
+GameObject* NCL::CSC8503::LevelManager::MakeEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& direction, const Quaternion& orientation, float inverseMass, bool addCollider) {
 	GameObject* cube = new GameObject("Edge Wall");
 
-	AABBVolume* volume = new AABBVolume(dimensions * Vector3(1, 3, 1), Vector3(-direction.x * dimensions.x, dimensions.y * 3, -direction.z * dimensions.z));
-
-	cube->SetBoundingVolume((CollisionVolume*)volume);
-
 	cube->GetTransform()
 		.SetPosition(position + dimensions * direction)
 		.SetScale(dimensions * 2)
 		.SetOrientation(orientation);
 
-	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), meshMap["corridor_Wall_Straight_Mid_end_R"], texMap["corridor_wall_c"], shaderMap["default"]));
-	cube->GetRenderObject()->SetFlag(3);
+	cube->SetRenderObject(new RenderObject(&cube->GetTransform(), assets.wallMesh, assets.wallTex, assets.defaultShader));
+	cube->GetRenderObject()->SetFeatures(RenderObject::TexturePerSubMesh);
 
 	cube->GetRenderObject()->SetTextures(WallTextures);
+	cube->GetRenderObject()->SetStaticGeometry(inverseMass == 0);
 
-	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+	if (addCollider) {
+		AABBVolume* volume = new AABBVolume(dimensions * Vector3(1, 3, 1), Vector3(-direction.x * dimensions.x, dimensions.y * 3, -direction.z * dimensions.z));
 
-	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
-	cube->GetPhysicsObject()->InitCubeInertia();
+		cube->SetBoundingVolume((CollisionVolume*)volume);
 
-	world.AddGameObject(cube);
+		cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+
+		cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+		cube->GetPhysicsObject()->InitCubeInertia();
+	}
 
 	return cube;
 }
 
-GameObject* NCL::CSC8503::LevelManager::AddPaintSplat(const Vector3& position, float penetrationDist, const Vector3& normal) {
+//A collision box with nothing to draw, for level geometry that's been merged together
+GameObject* NCL::CSC8503::LevelManager::AddStaticCollider(const Vector3& position, const Vector3& halfSize) {
+	GameObject* box = MakeStaticCollider(position, halfSize);
+	world.AddGameObject(box);
+	return box;
+}
+
+GameObject* NCL::CSC8503::LevelManager::MakeStaticCollider(const Vector3& position, const Vector3& halfSize) {
+	GameObject* box = new GameObject("Level Collider");
+
+	AABBVolume* volume = new AABBVolume(halfSize);
 
-	PaintSplat* splat = new PaintSplat();
+	box->SetBoundingVolume((CollisionVolume*)volume);
 
-	AABBVolume* volume = new AABBVolume(Vector3(0.005f, 0.005f, 0.005f));
+	box->GetTransform()
+		.SetPosition(position)
+		.SetScale(halfSize * 2);
 
-	splat->SetBoundingVolume((CollisionVolume*)volume);
+	box->SetPhysicsObject(new PhysicsObject(&box->GetTransform(), box->GetBoundingVolume()));
 
-	splat->GetTransform()
-		.SetPosition(position + normal * 0.25f)
-		.SetScale(Vector3(0.005f, 0.005f, 0.005f));
+	box->GetPhysicsObject()->SetInverseMass(0);
+	box->GetPhysicsObject()->InitCubeInertia();
 
-	string splatShape = to_string(rand() % 35);
-	splat->SetRenderObject(new RenderObject(&splat->GetTransform(), meshMap["cube"], texMap["splat" + splatShape], shaderMap["default"]));
-	splat->GetRenderObject()->SetRenderShadow(false);
+	return box;
+}
 
-	splat->SetPhysicsObject(new PhysicsObject(&splat->GetTransform(), splat->GetBoundingVolume()));
+//Obstacles and edge walls are only drawn per cell, as their colliders are merged together
+GameObject* NCL::CSC8503::LevelManager::MakeLevelCell(char type, int x, int y, int size) {
+	//Where each edge wall's drawn from, and which way it faces, for 'a' to 'd'
+	static const Vector3 edgeDirections[4] = { Vector3(0, -1, -1), Vector3(-1, -1, 0), Vector3(1, -1, 0), Vector3(0, -1, 1) };
+	static const Quaternion edgeOrientations[4] = {
+		Quaternion(0, 0, 0, 0),
+		Quaternion::EulerAnglesToQuaternion(0, 90, 0),
+		Quaternion::EulerAnglesToQuaternion(0, -90, 0),
+		Quaternion::EulerAnglesToQuaternion(0, 180, 0)
+	};
+	Vector3 centre		= Vector3(x + 0.5f, 0, y + 0.5f) * size;
+	Vector3 halfSize	= Vector3(size, size, size) * 0.5f;
+	if (type >= 'a' && type <= 'd') {
+		return MakeEdgeWall(centre, halfSize, edgeDirections[type - 'a'], edgeOrientations[type - 'a'], 0, false);
+	}
+	return MakeObstacleBox(centre, halfSize, 0, false);
+}
 
-	if (penetrationDist < 0.1f) {
-		splat->GetPhysicsObject()->SetUseGravity(true);
+void NCL::CSC8503::LevelManager::AddPaintSplat(const Vector3& position, const Vector3& normal, const Vector4& colour) {
+	int splatShape = rand() % SplatTextureCount;
+	if (assets.splatArray) {
+		paintDecals.Add(position, normal, colour, assets.splatArray, splatShape);
 	}
 	else {
-		splat->GetPhysicsObject()->SetUseGravity(false);
+		paintDecals.Add(position, normal, colour, assets.splatTex[splatShape], 0);
 	}
+	paintParticles.Emit(position, normal, colour, 48, 12.0f, 0.6f);
+	dynamicLights.Flash(position + normal * 0.5f, colour * 1.5f, 6.0f, 0.3f);
+}
 
-	world.AddGameObject(splat);
-
-	return splat;
+void NCL::CSC8503::LevelManager::AddPaintSpray(const Vector3& position, const Vector3& direction, const Vector4& colour) {
+	paintParticles.Emit(position, direction, colour, 16, 20.0f, 0.15f, 0.15f, 0.4f);
+	dynamicLights.Flash(position, colour * 2.0f, 4.0f, 0.08f);
 }
 
 GameObject* NCL::CSC8503::LevelManager::AddPlayerWallIndicator(int playerID, const Vector3& position, const Vector3& dimensions) {
+	GameObject* PInd = MakePlayerWallIndicator(playerID, position, dimensions);
+	world.AddGameObject(PInd);
+	return PInd;
+}
+
+GameObject* NCL::CSC8503::LevelManager::MakePlayerWallIndicator(int playerID, const Vector3& position, const Vector3& dimensions) {
 	GameObject* PInd = new GameObject();
 
 	PInd->GetTransform()
@@ -609,11 +893,15 @@ GameObject* NCL::CSC8503::LevelManager::AddPlayerWallIndicator(int playerID, con
 		.SetScale(dimensions * Vector3(0, 1, 1))
 		.SetOrientation(Quaternion::EulerAnglesToQuaternion(180, playerID == 1 || playerID == 4 ? -45 : 45, 0));
 	
-	PInd->SetRenderObject(new RenderObject(&PInd->GetTransform(), meshMap["cube"], texMap["p" + to_string(playerID)], shaderMap["default"]));
+	if (assets.playerArray) {
+		PInd->SetRenderObject(new RenderObject(&PInd->GetTransform(), assets.cubeMesh, assets.playerArray, assets.defaultShader));
+		PInd->GetRenderObject()->SetTextureLayer(playerID - 1);
+	}
+	else {
+		PInd->SetRenderObject(new RenderObject(&PInd->GetTransform(), assets.cubeMesh, assets.playerTex[playerID], assets.defaultShader));
+	}
 	PInd->GetRenderObject()->SetRenderShadow(false);
 
-	world.AddGameObject(PInd);
-
 	return PInd;
 }
 
@@ -688,63 +976,108 @@ void NCL::CSC8503::LevelManager::InitGameExamples() {
 	AddBonusToWorld(Vector3(10, 5, 0));
 }
 
-void NCL::CSC8503::LevelManager::LoadEnvironment(const string& levelFile, vector<ColourBlock*> colourWalls[]) {
-	int gridHeight;
-	int gridWidth;
-	int size;
-	std::ifstream infile(Assets::DATADIR + levelFile);
+/*
+Each kind of cell's objects are all made at once, spread over the job
+system, as nothing's shared between them until they go in the world -
+which they do afterwards, one kind at a time, in the order the cells were
+read. Online, walls' network IDs are handed out before any are made, so
+they come out the same on every machine that loads the same level.
+*/
+void NCL::CSC8503::LevelManager::LoadEnvironment(const string& levelFile, vector<ColourBlock*> colourWalls[], NetworkedGame* game) {
+	ProfileScope scope("Load Environment");
+	LevelData level;
+	if (!level.Load(levelFile)) {
+		return;
+	}
+	const int size			= level.GetUnitSize();
+	const int gridWidth		= level.GetWidth();
+	const int gridHeight	= level.GetHeight();
+	const Vector3 cellSize	= Vector3(size, size, size);
+	const float indicatorHeight = game ? 4.0f : 5.0f; //online ones have always sat a little lower
+	const int wallHeight	= 3;
+
+	//Obstacles and edge walls are only rendered per cell, their colliders
+	//are merged together once the whole grid has been read
+	vector<char> colliderCells(gridWidth * gridHeight, EmptyCell);
+
+	//Big levels only have the parts near the players built, as they move around
+	const bool streamLevel = gridWidth * gridHeight >= LevelStreamer::StreamedLevelCells;
+	streamer->Stop();
+
+	JobSystem* jobs = JobSystem::GetJobSystem();
+	vector<GameObject*> objects;
+	vector<int> networkIDs;
+	for (const LevelData::CellGroup& group : level.GetGroups()) {
+		const char type	= group.type;
+		const int count	= (int)group.cells.size();
+		int team		= type >= 'w' && type <= 'z' ? (type == 'w' ? 3 : type - 'x') : -1;
+		int player		= type >= '1' && type <= '4' ? type - '0' : 0;
+		int edge		= type >= 'a' && type <= 'd' ? type - 'a' : -1;
+		if (team < 0 && player == 0 && edge < 0 && type != 'i') {
+			continue;
+		}
+		if ((type == 'i' || edge >= 0) && streamLevel) {
+			continue; //left to the streamer
+		}
+		const int perCell = team >= 0 ? wallHeight : 1;
+		objects.assign(count * perCell, nullptr);
+		networkIDs.resize(game && team >= 0 ? count * perCell : 0);
+		for (int& id : networkIDs) {
+			id = game->GetNextObjectIDAndIncrement();
+		}
 
-	infile >> size;
-	infile >> gridWidth;
-	infile >> gridHeight;
+		auto makeCells = [&](int first, int last, int worker) {
+			for (int i = first; i < last; ++i) {
+				int x = group.cells[i] % gridWidth;
+				int y = group.cells[i] / gridWidth;
+				if (team >= 0) {
+					for (int h = 0; h < wallHeight; ++h) {
+						Vector3 blockPos = Vector3(x + 0.5f, h, y + 0.5f) * size;
+						ColourBlock* block = game ?
+							(ColourBlock*)MakeColourBlock(networkIDs[i * perCell + h], game, blockPos, cellSize * 0.5f) :
+							MakeColourBlock(blockPos, cellSize * 0.5f);
+						block->GetRenderObject()->SetColour(COLOUR_WHITE);
+						objects[i * perCell + h] = block;
+					}
+				}
+				else if (player > 0) {
+					objects[i] = MakePlayerWallIndicator(player, Vector3(x + 0.5f, indicatorHeight, y + 0.5f) * size, cellSize * 2);
+				}
+				else {
+					objects[i] = MakeLevelCell(type, x, y, size);
+				}
+			}
+		};
+		if (jobs) {
+			jobs->ParallelFor(count, 64, makeCells);
+		}
+		else {
+			makeCells(0, count, 0);
+		}
 
-	for (int y = 0; y < gridHeight; ++y) {
-		for (int x = 0; x < gridWidth; ++x) {
-			char type = 0;
-			infile >> type;
-			switch (type) {
-			case '1':
-				AddPlayerWallIndicator(1, Vector3(x + 0.5f, 5, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '2':
-				AddPlayerWallIndicator(2, Vector3(x + 0.5f, 5, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '3':
-				AddPlayerWallIndicator(3, Vector3(x + 0.5f, 5, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '4':
-				AddPlayerWallIndicator(4, Vector3(x + 0.5f, 5, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case 'i':
-				AddObstacleBox(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, 0);
-				break;
-			case 'x':
-				CreateWallOfHeight(3, Vector3(x, 0, y), size, colourWalls[0], COLOUR_WHITE);
-				break;
-			case 'y':
-				CreateWallOfHeight(3, Vector3(x, 0, y), size, colourWalls[1], COLOUR_WHITE);
-				break;
-			case 'z':
-				CreateWallOfHeight(3, Vector3(x, 0, y), size, colourWalls[2], COLOUR_WHITE);
-				break;
-			case 'w':
-				CreateWallOfHeight(3, Vector3(x, 0, y), size, colourWalls[3], COLOUR_WHITE);
-				break;
-			case 'a':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(0, -1, -1), Quaternion(0, 0, 0, 0), 0);
-				break;
-			case 'b':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(-1, -1, 0), Quaternion::EulerAnglesToQuaternion(0, 90, 0), 0);
-				break;
-			case 'c':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(1, -1, 0), Quaternion::EulerAnglesToQuaternion(0, -90, 0), 0);
-				break;
-			case 'd':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(0, -1, 1), Quaternion::EulerAnglesToQuaternion(0, 180, 0), 0);
-				break;
+		for (int i = 0; i < (int)objects.size(); ++i) {
+			world.AddGameObject(objects[i]);
+			if (team >= 0) {
+				ColourBlock* block = (ColourBlock*)objects[i];
+				if (game) {
+					game->AddNetworkObject(block->GetNetworkObject(), networkIDs[i]);
+				}
+				colourWalls[team].push_back(block);
+			}
+		}
+		if (type == 'i' || edge >= 0) {
+			for (uint32_t cell : group.cells) {
+				colliderCells[cell] = type == 'i' ? ObstacleCell : EdgeWallCell;
 			}
 		}
 	}
+	if (streamLevel) {
+		streamer->Start(level);
+	}
+	else {
+		AddMergedColliders(colliderCells, gridWidth, gridHeight, size);
+	}
+	CountColourWalls(colourWalls);
 	AddFloorToWorld(Vector3((gridWidth / 2.0f), -0.6f, (gridHeight / 2.0f)) * size, Vector3(gridWidth / 2.0f, 0.1f, gridHeight / 2.0f) * size);
 
 	environmentExtents = Vector2(gridWidth, gridHeight);
@@ -752,84 +1085,73 @@ void NCL::CSC8503::LevelManager::LoadEnvironment(const string& levelFile, vector
 	environmentActive = true;
 }
 
-void NCL::CSC8503::LevelManager::LoadEnvironment(NetworkedGame* game, const string& levelFile, vector<ColourBlock*> colourWalls[]) {
-	int gridHeight;
-	int gridWidth;
-	int size;
-	std::ifstream infile(Assets::DATADIR + levelFile);
-
-	infile >> size;
-	infile >> gridWidth;
-	infile >> gridHeight;
+/*
+Greedy meshing - each unclaimed cell grows as far as it can along the row,
+then that whole strip grows down the grid for as long as every cell under it
+is the same kind. A straight run of edge wall ends up as a single box, rather
+than one per cell. Edge wall colliders stand 3 blocks tall, sitting on the
+same base as the obstacles.
+*/
+void NCL::CSC8503::LevelManager::AddMergedColliders(vector<char>& cells, int gridWidth, int gridHeight, int size) {
+	vector<GameObject*> colliders;
+	MakeMergedColliders(cells, gridWidth, gridHeight, size, colliders);
+	for (GameObject* c : colliders) {
+		world.AddGameObject(c);
+	}
+}
 
+void NCL::CSC8503::LevelManager::MakeMergedColliders(vector<char>& cells, int gridWidth, int gridHeight, int size, vector<GameObject*>& into, int originX, int originY) {
+	float blockHalf = size * 0.5f;
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			char type = 0;
-			infile >> type;
-			switch (type) {
-			case '1':
-				AddPlayerWallIndicator(1, Vector3(x + 0.5f, 4, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '2':
-				AddPlayerWallIndicator(2, Vector3(x + 0.5f, 4, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '3':
-				AddPlayerWallIndicator(3, Vector3(x + 0.5f, 4, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case '4':
-				AddPlayerWallIndicator(4, Vector3(x + 0.5f, 4, y + 0.5f) * size, Vector3(size, size, size) * 2);
-				break;
-			case 'i':
-				AddObstacleBox(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, 0);
-				break;
-			case 'x':
-				CreateWallOfHeight(game, 3, Vector3(x, 0, y), size, colourWalls[0], COLOUR_WHITE);
-				break;
-			case 'y':
-				CreateWallOfHeight(game, 3, Vector3(x, 0, y), size, colourWalls[1], COLOUR_WHITE);
-				break;
-			case 'z':
-				CreateWallOfHeight(game, 3, Vector3(x, 0, y), size, colourWalls[2], COLOUR_WHITE);
-				break;
-			case 'w':
-				CreateWallOfHeight(game, 3, Vector3(x, 0, y), size, colourWalls[3], COLOUR_WHITE);
-				break;
-			case 'a':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(0, -1, -1), Quaternion(0, 0, 0, 0), 0);
-				break;
-			case 'b':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(-1, -1, 0), Quaternion::EulerAnglesToQuaternion(0, 90, 0), 0);
-				break;
-			case 'c':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(1, -1, 0), Quaternion::EulerAnglesToQuaternion(0, -90, 0), 0);
-				break;
-			case 'd':
-				AddEdgeWall(Vector3(x + 0.5f, 0, y + 0.5f) * size, Vector3(size, size, size) * 0.5f, Vector3(0, -1, 1), Quaternion::EulerAnglesToQuaternion(0, 180, 0), 0);
-				break;
+			char type = cells[y * gridWidth + x];
+			if (type == EmptyCell) {
+				continue;
+			}
+			int width = 1;
+			while (x + width < gridWidth && cells[y * gridWidth + x + width] == type) {
+				width++;
+			}
+			int depth = 1;
+			while (y + depth < gridHeight) {
+				bool rowMatches = true;
+				for (int i = 0; i < width && rowMatches; ++i) {
+					rowMatches = cells[(y + depth) * gridWidth + x + i] == type;
+				}
+				if (!rowMatches) {
+					break;
+				}
+				depth++;
+			}
+			for (int j = 0; j < depth; ++j) {
+				for (int i = 0; i < width; ++i) {
+					cells[(y + j) * gridWidth + x + i] = EmptyCell;
+				}
+			}
+
+			Vector3 centre((originX + x + width * 0.5f) * size, 0, (originY + y + depth * 0.5f) * size);
+			Vector3 halfSize(width * blockHalf, blockHalf, depth * blockHalf);
+			if (type == EdgeWallCell) {
+				centre.y	= blockHalf * 2;
+				halfSize.y	= blockHalf * 3;
 			}
+			into.emplace_back(MakeStaticCollider(centre, halfSize));
 		}
 	}
-	AddFloorToWorld(Vector3((gridWidth / 2.0f), -0.6f, (gridHeight / 2.0f)) * size, Vector3(gridWidth / 2.0f, 0.1f, gridHeight / 2.0f) * size);
-
-	environmentExtents = Vector2(gridWidth, gridHeight);
-	environmentUnitSize = size;
-	environmentActive = true;
 }
 
-void NCL::CSC8503::LevelManager::CreateWallOfHeight(int height, const Vector3& position, float blockSize, vector<ColourBlock*> &colourWall, Vector4 wallColour) {
-	for (int i = 0; i < height; ++i) {
-		ColourBlock* wall = AddColourBlock(Vector3(position.x + 0.5f, i, position.z + 0.5f) * blockSize, Vector3(blockSize, blockSize, blockSize) * 0.5f);
-		wall->GetRenderObject()->SetColour(wallColour);
-		colourWall.push_back(wall);
+void NCL::CSC8503::LevelManager::UpdateStreaming(const vector<Vector3>& around) {
+	if (streamer->IsActive()) {
+		streamer->Update(around);
 	}
 }
 
-void NCL::CSC8503::LevelManager::CreateWallOfHeight(NetworkedGame* game, int height, const Vector3& position, float blockSize, vector<ColourBlock*>& colourWall, Vector4 wallColour) {
-	for (int i = 0; i < height; ++i) {
-		NetworkColourBlock* wall = AddColourBlock(game->GetNextObjectIDAndIncrement(), game, Vector3(position.x + 0.5f, i, position.z + 0.5f) * blockSize, Vector3(blockSize, blockSize, blockSize) * 0.5f);
-		game->AddNetworkObject(wall->GetNetworkObject(), wall->GetNetworkID());
-		wall->GetRenderObject()->SetColour(wallColour);
-		colourWall.push_back(wall);
+void NCL::CSC8503::LevelManager::CountColourWalls(vector<ColourBlock*> colourWalls[]) {
+	for (int i = 0; i < 4; ++i) {
+		walls[i] = ColourWall();
+		for (ColourBlock* b : colourWalls[i]) {
+			b->SetWall(&walls[i]);
+		}
 	}
 }
 
@@ -837,32 +1159,287 @@ Vector3& NCL::CSC8503::LevelManager::GetEnvironmentCentre() const {
 	return Vector3(0, 0, 0) + (environmentActive ? Vector3(environmentExtents.x * 0.5f * environmentUnitSize, 0, environmentExtents.y * 0.5f * environmentUnitSize) : Vector3(0, 0, 0));
 }
 
-void NCL::CSC8503::LevelManager::LoadMesh(const string& identifier, const string& filename) {
-	OGLMesh* mesh = new OGLMesh(filename);
-	(mesh)->SetPrimitiveType(GeometryPrimitive::Triangles);
-	(mesh)->UploadToGPU();
-	meshMap[identifier] = mesh;
+//What each kind of asset's memory is counted as
+static MemoryTag AssetMemoryTag(char type) {
+	switch (type) {
+	case 'm':
+	case 'e':
+	case 'a':
+		return MemoryTag::Meshes;
+	case 't':
+		return MemoryTag::Textures;
+	case 'l':
+		return MemoryTag::Audio;
+	}
+	return MemoryTag::Rendering;
+}
+
+void NCL::CSC8503::LevelManager::ParseAsset(int index) {
+	ProfileScope scope("Parse Asset");
+	AssetLoadInfo& info = assetInfo[index];
+	MemoryTagScope tag(AssetMemoryTag(info.type));
+	switch (info.type) {
+	case 'm':
+		info.mesh = new OGLMesh(info.filenameOne);
+		info.mesh->SetPrimitiveType(GeometryPrimitive::Triangles);
+		break;
+	case 't': {
+		info.compressedTex = new CompressedTexture();
+		if (TextureLoader::LoadCompressedTexture(info.filenameOne, *info.compressedTex, StreamsMips(info.identifier) ? TextureStreamer::ResidentSize : 0)) {
+			break;
+		}
+		delete info.compressedTex;
+		info.compressedTex = nullptr;
+		int flags = 0;
+		TextureLoader::LoadTexture(info.filenameOne, info.texData, info.texWidth, info.texHeight, info.texChannels, flags);
+		if (!info.texData) {
+			break;
+		}
+		//Straight into the upload buffer if there's room, rather than waiting for the main thread
+		if (char* pixels = textureUploader->Reserve(info.texture, info.texWidth, info.texHeight, info.texChannels, info.uploadTicket)) {
+			memcpy(pixels, info.texData, (size_t)info.texWidth * info.texHeight * info.texChannels);
+			free(info.texData);
+			info.texData	= nullptr;
+			info.uploading	= true;
+			textureUploader->Submit(info.uploadTicket);
+		}
+	}	break;
+	case 'e':
+		info.material = new MeshMaterial(info.filenameOne);
+		break;
+	case 'a':
+		info.animation = new MeshAnimation(info.filenameOne);
+		break;
+	case 'l':
+		info.sound = Sound::LoadSound(info.filenameOne);
+		break;
+	}
+	if (parsingOnJobs) {
+		std::lock_guard<std::mutex> lock(assetMutex);
+		assetParsed[index] = true;
+	}
+}
+
+void NCL::CSC8503::LevelManager::FinishAsset(int index) {
+	AssetLoadInfo& info = assetInfo[index];
+	MemoryTagScope tag(AssetMemoryTag(info.type));
+	switch (info.type) {
+	case 'm':
+		//Skinned meshes keep separate buffers, for the renderer to skin them in a compute shader
+		info.mesh->SetPackedVertices(info.mesh->GetSkinWeightData().empty());
+		info.mesh->SetRetainCPUData(KeepsCPUMeshData(info.identifier, true));
+		info.mesh->UploadToGPU();
+		meshMap[info.identifier] = info.mesh;
+		for (GameObject* o : meshWaiters[index]) {
+			o->GetRenderObject()->SetMesh(info.mesh);
+		}
+		meshWaiters.erase(index);
+		break;
+	case 't':
+		if (info.compressedTex) {
+			info.texture->SetCompressedData(*info.compressedTex);
+			textureStreamer->Add(info.texture, info.filenameOne, *info.compressedTex);
+			delete info.compressedTex;
+		}
+		else if (info.texData) {
+			info.texture->SetRGBAData(info.texData, info.texWidth, info.texHeight, info.texChannels);
+			free(info.texData);
+		}
+		break; //otherwise it's already been handed to the uploader
+	case 'e':
+		materialMap[info.identifier] = info.material;
+		break;
+	case 'a':
+		animMap[info.identifier] = info.animation;
+		break;
+	case 's':
+		shaderMap[info.identifier] = new OGLShader(info.filenameOne, info.filenameTwo, info.filenameThree);
+		break;
+	case 'l':
+		Sound::AddSound(info.filenameOne, info.sound);
+		break;
+	}
+	//Everything's owned by the maps now
+	info.mesh		= nullptr;
+	info.material	= nullptr;
+	info.animation	= nullptr;
+	info.sound		= nullptr;
+	info.texData	= nullptr;
+	info.compressedTex = nullptr;
 }
 
-void NCL::CSC8503::LevelManager::LoadTexture(const string& identifier, const string& filename) {
-	OGLTexture* tex = (OGLTexture*)TextureLoader::LoadAPITexture(filename);
-	texMap[identifier] = tex;
+string NCL::CSC8503::LevelManager::SplatFilename(int i) {
+	return "splat" + (i < 10 ? "0" + to_string(i) : to_string(i)) + ".png";
 }
 
-void NCL::CSC8503::LevelManager::LoadMaterial(const string& identifier, const string& filename) {
-	materialMap[identifier] = new MeshMaterial(filename);
+/*
+The splats and player markers are put into texture arrays as well, so
+they can all share one texture and be drawn instanced, picking their
+layer per instance. That needs the array version of the instanced shader,
+so without it they just keep using their own textures - which for the
+splats means they have to be loaded after all.
+*/
+void NCL::CSC8503::LevelManager::InitTextureArrays() {
+	OGLShader* arrayShader = shaderMap["defaultInstancedArray"];
+	TextureBase* splatArray = nullptr;
+	if (arrayShader && arrayShader->LoadSuccess()) {
+		vector<string> splats;
+		for (int i = 0; i < SplatTextureCount; ++i) {
+			splats.emplace_back(SplatFilename(i));
+		}
+		splatArray = OGLTexture::RGBAArrayFromFilenames(splats);
+	}
+	if (!splatArray) {
+		for (int i = 0; i < SplatTextureCount; ++i) {
+			RequestAsset('t', "splat" + to_string(i));
+		}
+		return;
+	}
+	texMap["splatArray"] = (OGLTexture*)splatArray;
+	if (TextureBase* playerArray = OGLTexture::RGBAArrayFromFilenames({ "p1.png", "p2.png", "p3.png", "p4.png" })) {
+		texMap["playerArray"] = (OGLTexture*)playerArray;
+	}
+}
+
+const float NCL::CSC8503::LevelManager::LODScreenSizes[MeshLODCount]	= { 0.25f, 0.08f };
+const int NCL::CSC8503::LevelManager::LODGridCells[MeshLODCount]		= { 24, 10 };
+
+/*
+The guards, guns and walls are the meshes there's most of, so they get
+cheaper versions for when they're far away. An artist-made LOD can be
+put next to the mesh, as Name_LOD1.msh and so on, otherwise it's made
+here by simplifying the full mesh.
+*/
+const string NCL::CSC8503::LevelManager::LODMeshes[] = { "Male_Guard", "THW_Ranged_SMGSoldier", "corridor_Wall_Straight_Mid_end_R" };
+
+//Only these are read back once they're uploaded, as they're the ones drawn as
+//static geometry, which is merged into the indirect batch whenever a level's built
+const string NCL::CSC8503::LevelManager::StaticGeometryMeshes[] = { "WoodenBox", "corridor_Wall_Straight_Mid_end_R" };
+
+bool NCL::CSC8503::LevelManager::KeepsCPUMeshData(const string& identifier, bool forLODs) {
+	for (const string& s : StaticGeometryMeshes) {
+		if (s == identifier) {
+			return true;
+		}
+	}
+	if (forLODs) {
+		for (const string& s : LODMeshes) {
+			if (s == identifier) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//The walls and floor, which cover the most of the screen, and so are worth the most detail up close
+const string NCL::CSC8503::LevelManager::StreamedTextures[] = { "stoneTex", "corridor_wall_c" };
+
+bool NCL::CSC8503::LevelManager::StreamsMips(const string& identifier) {
+	for (const string& s : StreamedTextures) {
+		if (s == identifier) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void NCL::CSC8503::LevelManager::InitMeshLODs() {
+	for (const string& s : LODMeshes) {
+		AddMeshLODs(s, s);
+	}
 }
 
-void NCL::CSC8503::LevelManager::LoadAnimation(const string& identifier, const string& filename) {
-	animMap[identifier] = new MeshAnimation(filename);
+//The full mesh only kept its CPU copy for making them, if it's not needed after
+void NCL::CSC8503::LevelManager::AddMeshLODs(const string& identifier, const string& filename) {
+	OGLMesh* mesh = meshMap[identifier];
+	if (!mesh) {
+		return;
+	}
+	bool retain = KeepsCPUMeshData(identifier, false);
+	for (int i = 0; i < MeshLODCount; ++i) {
+		string lodFile = filename + "_LOD" + to_string(i + 1) + ".msh";
+		OGLMesh* lod = nullptr;
+		if (AssetFile::Exists(Assets::MESHDIR + lodFile)) {
+			lod = new OGLMesh(lodFile);
+		}
+		else {
+			lod = new OGLMesh();
+			if (!mesh->Simplify(*lod, LODGridCells[i])) {
+				delete lod;
+				break;
+			}
+			lod->SetPrimitiveType(GeometryPrimitive::Triangles);
+			lod->OptimiseForGPU(); //baked ones were done when they were converted
+		}
+		lod->SetPrimitiveType(GeometryPrimitive::Triangles);
+		lod->SetPackedVertices(mesh->HasPackedVertices());
+		lod->SetRetainCPUData(retain);
+		lod->UploadToGPU();
+		mesh->AddLOD(lod, LODScreenSizes[i]);
+	}
+	AddShadowProxy(mesh, filename, retain);
+	if (!retain) {
+		mesh->ReleaseCPUData();
+	}
 }
 
-void NCL::CSC8503::LevelManager::LoadShader(const string& identifier, const string& vertName, const string& fragName,const string&geoName) {
-	shaderMap[identifier] = new OGLShader(vertName, fragName,geoName);
+//Coarser than any of its LODs, as the shadow map's only looked at through the light's blur
+void NCL::CSC8503::LevelManager::AddShadowProxy(OGLMesh* mesh, const string& filename, bool retain) {
+	string proxyFile = filename + "_Shadow.msh";
+	OGLMesh* proxy = nullptr;
+	if (AssetFile::Exists(Assets::MESHDIR + proxyFile)) {
+		proxy = new OGLMesh(proxyFile);
+	}
+	else {
+		proxy = new OGLMesh();
+		if (!mesh->MakeShadowProxy(*proxy, ShadowProxyCells)) {
+			delete proxy;
+			return;
+		}
+		proxy->SetPrimitiveType(GeometryPrimitive::Triangles);
+		proxy->OptimiseForGPU();
+	}
+	proxy->SetPrimitiveType(GeometryPrimitive::Triangles);
+	proxy->SetPackedVertices(mesh->HasPackedVertices());
+	proxy->SetRetainCPUData(retain);
+	proxy->UploadToGPU();
+	mesh->SetShadowProxy(proxy);
 }
 
-void NCL::CSC8503::LevelManager::LoadSound(const string& identifier, const string& filename) {
-	Sound::AddSound(filename);
+void NCL::CSC8503::LevelManager::ResolveAssetHandles() {
+	auto mesh		= [&](const string& name) { auto i = meshMap.find(name); return i == meshMap.end() ? nullptr : i->second; };
+	auto texture	= [&](const string& name) { auto i = texMap.find(name); return i == texMap.end() ? nullptr : i->second; };
+	auto shader		= [&](const string& name) { auto i = shaderMap.find(name); return i == shaderMap.end() ? nullptr : i->second; };
+
+	assets.cubeMesh		= mesh("cube");
+	assets.sphereMesh	= mesh("sphere");
+	assets.capsuleMesh	= mesh("capsule");
+	assets.maleMesh		= mesh("Male1");
+	assets.gunMesh		= mesh("THW_Ranged_SMGSoldier");
+	assets.boxMesh		= mesh("WoodenBox");
+	assets.wallMesh		= mesh("corridor_Wall_Straight_Mid_end_R");
+
+	assets.defaultTex	= texture("default");
+	assets.stoneTex		= texture("stoneTex");
+	assets.whiteTex		= texture("WhiteTex");
+	assets.yellowTex	= texture("yellowTex");
+	assets.gunTex		= texture("gun");
+	assets.wallTex		= texture("corridor_wall_c");
+	assets.splatArray	= texture("splatArray");
+	assets.playerArray	= texture("playerArray");
+	assets.splatTex.clear();
+	for (int i = 0; i < SplatTextureCount; ++i) {
+		assets.splatTex.emplace_back(texture("splat" + to_string(i)));
+	}
+	assets.playerTex.assign(1, nullptr);
+	for (int i = 1; i <= 4; ++i) {
+		assets.playerTex.emplace_back(texture("p" + to_string(i)));
+	}
+
+	assets.defaultShader	= shader("default");
+	assets.boxShader		= shader("box");
+	assets.lineShader		= shader("line");
 }
 
 void NCL::CSC8503::LevelManager::InitMaterials() {
@@ -3,7 +3,13 @@
 #include "GameTechRenderer.h"
 #include "../CSC8503Common/GameObject.h"
 #include "../CSC8503Common/SoundSystem.h"
+#include "PaintDecals.h"
+#include "PaintParticles.h"
+#include "DynamicLights.h"
+#include "ColourBlock.h"
+#include "../../Plugins/OpenGLRendering/OGLTextureUploader.h"
 #include <map>
+#include <mutex>
 
 #ifndef LEVELMANAGER_H
 #define LEVELMANAGER_H
@@ -11,7 +17,6 @@ namespace NCL {
 	namespace CSC8503 {
 		class GameWorld;
 		class Agent;
-		class ColourBlock;
 		class NetworkColourBlock;
 		class RefillPoint;
 		class Projectile;
@@ -19,28 +24,80 @@ namespace NCL {
 		class NetworkProjectile;
 		class NetworkRefillPoint;
 		class NetworkedGame;
+		class LevelStreamer;
+		class TextureStreamer;
 
 		class LevelManager {
 		public:
 			LevelManager(Game* g, GameWorld& gw);
 			~LevelManager();
 
+			/*
+			When each asset's loaded. Eager ones are all the menu needs, and
+			are loaded before it's shown. Level ones are started in the
+			background as soon as the menu's up, and finished off before a
+			level's built if they're still not done by then. The rest aren't
+			loaded until something first asks for them, and show a placeholder
+			until they're ready.
+			*/
+			enum class AssetResidency {
+				Eager,
+				PerLevel,
+				OnFirstUse
+			};
+
+			//Starts reading the eager assets in on the job system, for LoadAssets
+			//to hand to the GPU (and OpenAL) as each one is ready
 			void InitialiseAssets();
-			float LoadNextAsset();
+			//Finishes off whatever's been read in so far, for up to
+			//assetUploadBudget seconds, and returns how far through it is
+			float LoadAssets();
+			//The same for anything asked for since, once the eager ones are done
+			void UpdateAssets();
+			//Waits for the level assets, for when a level's about to be built
+			void FinishLevelAssets();
 
 			bool IsLoadingAssets() const { return assetsLoading; }
 
-			OGLMesh*		GetMesh(const string& name)			{ return meshMap[name]; }
-			OGLTexture*		GetTexture(const string& name)		{ return texMap[name]; }
+			OGLMesh*		GetMesh(const string& name)			{ RequestAsset('m', name); return meshMap[name]; }
+			OGLTexture*		GetTexture(const string& name)		{ RequestAsset('t', name); return texMap[name]; }
 			MeshAnimation* GetAnimation(const string& name)		{ return animMap[name]; }
 			OGLShader*		GetShader(const string& name)		{ return shaderMap[name]; }
 			MeshMaterial*	GetMaterial(const string& name)		{ return materialMap[name]; }
 
 			OGLTexture*	GetDefaultTexture()						{ return texMap["default"]; }
 			OGLShader* GetDefaultShader()						{ return shaderMap["default"]; }
-			map<string, OGLMesh*> GetMeshMap()					{ return meshMap; }
-			map<string, OGLShader*> GetShaderMap()				{ return shaderMap; }
-			map<string, OGLTexture*> GetTexMap()				{ return texMap; }
+			const map<string, OGLMesh*>& GetMeshMap() const		{ return meshMap; }
+			const map<string, OGLShader*>& GetShaderMap() const	{ return shaderMap; }
+			const map<string, OGLTexture*>& GetTexMap() const	{ return texMap; }
+
+			//Everything objects are spawned with, looked up once loading's
+			//finished, rather than by name every time one's added
+			struct AssetHandles {
+				OGLMesh*	cubeMesh		= nullptr;
+				OGLMesh*	sphereMesh		= nullptr;
+				OGLMesh*	capsuleMesh		= nullptr;
+				OGLMesh*	maleMesh		= nullptr;
+				OGLMesh*	gunMesh			= nullptr;
+				OGLMesh*	boxMesh			= nullptr;
+				OGLMesh*	wallMesh		= nullptr;
+
+				OGLTexture*	defaultTex		= nullptr;
+				OGLTexture*	stoneTex		= nullptr;
+				OGLTexture*	whiteTex		= nullptr;
+				OGLTexture*	yellowTex		= nullptr;
+				OGLTexture*	gunTex			= nullptr;
+				OGLTexture*	wallTex			= nullptr;
+				OGLTexture*	splatArray		= nullptr;
+				OGLTexture*	playerArray		= nullptr;
+				vector<OGLTexture*> splatTex;
+				vector<OGLTexture*> playerTex; //by player ID, from 1
+
+				OGLShader*	defaultShader	= nullptr;
+				OGLShader*	boxShader		= nullptr;
+				OGLShader*	lineShader		= nullptr;
+			};
+			const AssetHandles& GetAssets() const { return assets; }
 
 			// Generic
 			GameObject* AddFloorToWorld(const Vector3& position, const Vector3& dimensions = Vector3(100, 2, 100));
@@ -63,9 +120,16 @@ namespace NCL {
 			NetworkProjectile* AddProjectile(int networkID, NetworkedGame* game, const Vector3& position, bool colourProjectile = false);
 			ColourBlock* AddColourBlock(const Vector3& position, const Vector3& dimensions);
 			NetworkColourBlock* AddColourBlock(int networkID, NetworkedGame* game, const Vector3& position, const Vector3& dimensions);
-			GameObject* AddObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass);
-			GameObject* AddEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& renderDir, const Quaternion& orientation, float inverseMass);
-			GameObject* AddPaintSplat(const Vector3& position, float penetrationDist, const Vector3& normal);
+			//Without a collider, these are just for show, and something else has to stop objects going through them
+			GameObject* AddObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass, bool addCollider = true);
+			GameObject* AddEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& renderDir, const Quaternion& orientation, float inverseMass, bool addCollider = true);
+			GameObject* AddStaticCollider(const Vector3& position, const Vector3& halfSize);
+			void AddPaintSplat(const Vector3& position, const Vector3& normal, const Vector4& colour);
+			PaintDecals& GetPaintDecals() { return paintDecals; }
+			//A puff of paint leaving a gun
+			void AddPaintSpray(const Vector3& position, const Vector3& direction, const Vector4& colour);
+			PaintParticles& GetPaintParticles() { return paintParticles; }
+			DynamicLights& GetDynamicLights() { return dynamicLights; }
 			GameObject* AddPlayerWallIndicator(int playerID, const Vector3& position, const Vector3& dimensions);
 			void AddPaintExplosion(const Vector3& position, float explosionForce = 10);
 
@@ -74,18 +138,50 @@ namespace NCL {
 			void InitCubeGridWorld(int numRows, int numCols, float rowSpacing, float colSpacing, const Vector3& cubeDims, bool useOBB = true);
 			void InitGameExamples();
 
-			void LoadEnvironment(const string& levelFile, vector<ColourBlock*> colourWalls[]);
-			void LoadEnvironment(NetworkedGame* game, const string& levelFile, vector<ColourBlock*> colourWalls[]);
-			void CreateWallOfHeight(int height, const Vector3& position, float blockSize, vector<ColourBlock*>& colourWall, Vector4 wallColour = Vector4(1, 1, 1, 1));
-			void CreateWallOfHeight(NetworkedGame* game, int height, const Vector3& position, float blockSize, vector<ColourBlock*>& colourWall, Vector4 wallColour = Vector4(1, 1, 1, 1));
+			//Given the game, the walls are made as networked objects
+			void LoadEnvironment(const string& levelFile, vector<ColourBlock*> colourWalls[], NetworkedGame* game = nullptr);
 			Vector3& GetEnvironmentCentre() const;
 
+			//Merges neighbouring cells of the same kind into as few boxes as possible
+			void AddMergedColliders(vector<char>& cells, int gridWidth, int gridHeight, int size);
+
+			//Brings in the parts of a streamed level near any of these, and lets go of
+			//the ones that have been left far enough behind
+			void UpdateStreaming(const vector<Vector3>& around);
+			const LevelStreamer& GetStreamer() const { return *streamer; }
+
+			//Only there once the assets have started loading, so never when headless
+			TextureStreamer* GetTextureStreamer() { return textureStreamer; }
+
+			//Hands each of the walls just loaded its blocks, so it can keep count of them
+			void CountColourWalls(vector<ColourBlock*> colourWalls[]);
+			const ColourWall& GetColourWall(int wall) const { return walls[wall]; }
+
 			//8508
 			vector<GLuint> GuardTextures;
 			vector<GLuint> WallTextures;
 
 
 		protected:
+			friend class LevelStreamer;
+
+			//Made ready for the world, but not added to it, so they can be made on any thread
+			ColourBlock* MakeColourBlock(const Vector3& position, const Vector3& dimensions);
+			NetworkColourBlock* MakeColourBlock(int networkID, NetworkedGame* game, const Vector3& position, const Vector3& dimensions);
+			GameObject* MakeObstacleBox(const Vector3& position, const Vector3& dimensions, float inverseMass, bool addCollider);
+			GameObject* MakeEdgeWall(const Vector3& position, const Vector3& dimensions, const Vector3& renderDir, const Quaternion& orientation, float inverseMass, bool addCollider);
+			GameObject* MakePlayerWallIndicator(int playerID, const Vector3& position, const Vector3& dimensions);
+			GameObject* MakeStaticCollider(const Vector3& position, const Vector3& halfSize);
+			//An obstacle ('i') or edge wall ('a' to 'd'), without its collider
+			GameObject* MakeLevelCell(char type, int x, int y, int size);
+			//Cells are of a region starting at origin, and are left empty
+			void MakeMergedColliders(vector<char>& cells, int gridWidth, int gridHeight, int size, vector<GameObject*>& into, int originX = 0, int originY = 0);
+
+			enum MergedCell {
+				EmptyCell,
+				ObstacleCell,
+				EdgeWallCell
+			};
 
 			struct AssetLoadInfo {
 				AssetLoadInfo(char t, string i, string f1, string f2 = "", string f3 = "") {
@@ -101,6 +197,22 @@ namespace NCL {
 				string filenameOne;
 				string filenameTwo;
 				string filenameThree;
+				AssetResidency residency = AssetResidency::Eager;
+				bool requested = false;
+
+				//Whatever's been read in, waiting to be finished on the main thread
+				OGLMesh*		mesh		= nullptr;
+				MeshMaterial*	material	= nullptr;
+				MeshAnimation*	animation	= nullptr;
+				Sound*			sound		= nullptr;
+				CompressedTexture* compressedTex = nullptr;
+				OGLTexture*		texture		= nullptr;	//made up front, with a placeholder in it
+				uint64_t		uploadTicket	= 0;
+				bool			uploading	= false;	//if the uploader has the pixels, rather than texData
+				char*			texData		= nullptr;
+				int				texWidth	= 0;
+				int				texHeight	= 0;
+				int				texChannels	= 0;
 			};
 
 
@@ -110,20 +222,82 @@ namespace NCL {
 			Vector2 environmentExtents = Vector2(1, 1);
 			float environmentUnitSize = 1;
 			bool environmentActive = false;
+			LevelStreamer* streamer = nullptr;
+			TextureStreamer* textureStreamer = nullptr;
 
 			bool assetsLoading = false;
+
+			PaintDecals paintDecals;
+			PaintParticles paintParticles;
+			DynamicLights dynamicLights;
+			ColourWall walls[4];
+
+			//Shots are fired too often to build a new object for each - these
+			//stay in the world, and are switched back on in the order they were
+			//handed out, so once they're all in use the oldest gets taken
+			static const int ProjectilePoolSize = 128;
+			vector<Projectile*> projectilePool;
+			int nextProjectile = 0;
+			Projectile* BuildProjectile(const Vector3& position, bool colourProjectile);
+
 			float progress = 0;
 			int numAssetsToLoad = 12;
 			int numAssetsLoaded = 0;
 
-			void LoadMesh(const string& identifier, const string& filename);
-			void LoadTexture(const string& identifier, const string& filename);
-			void LoadMaterial(const string& identifier, const string& filename);
-			void LoadAnimation(const string& identifier, const string& filename);
-			void LoadShader(const string& identifier, const string& vertName, const string& fragName,const string& geoName);
-			void LoadSound(const string& identifier, const string& filename);
+			void DeclareAsset(AssetResidency residency, const AssetLoadInfo& info);
+			//Starts loading it, if it hasn't been already
+			void RequestAsset(int index);
+			void RequestAsset(char type, const string& identifier);
+			void RequestAssets(AssetResidency residency);
+			//Finishes whatever's been requested and read in, for up to budget
+			//seconds, and is true once it's all been finished and uploaded
+			bool FinishRequestedAssets(float budget);
+			//Everything made from the level assets, once they're all there
+			void InitLevelAssets();
+			//The mesh if it's loaded, otherwise the cube, with o given the real
+			//one once it is
+			OGLMesh* MeshOnFirstUse(GameObject* o, const string& identifier);
+
+			//Reads an asset in without touching OpenGL or OpenAL, so it can be on any thread
+			void ParseAsset(int index);
+			//Everything that has to be on the main thread, like uploading to the GPU
+			void FinishAsset(int index);
+
+			vector<bool>	assetParsed;	//guarded by assetMutex, as the workers set these
+			vector<bool>	assetFinished;
+			int				numAssetsRequested = 0;
+			bool			levelAssetsReady = false;
+			map<string, int> assetIndices;	//by type, then identifier, as they can share those
+			map<int, vector<GameObject*>> meshWaiters;	//on the placeholder until their mesh is loaded
+			std::mutex		assetMutex;
+			bool			parsingOnJobs = false;
+			OGLTextureUploader* textureUploader = nullptr;	//only while assets are loading
+			float			assetUploadBudget = 0.008f;
+
+			void ResolveAssetHandles();
+			AssetHandles assets;
 
 			void InitMaterials();
+			void InitTextureArrays();
+			void InitMeshLODs();
+			void AddMeshLODs(const string& identifier, const string& filename);
+			//From filename's _Shadow file if there is one, or simplified from mesh if not
+			void AddShadowProxy(OGLMesh* mesh, const string& filename, bool retain);
+			//Whether it's read back on the CPU once it's uploaded, or until its LODs have been made
+			static bool KeepsCPUMeshData(const string& identifier, bool forLODs);
+			//Whether only its smaller levels are loaded, with the rest streamed in as they're needed
+			static bool StreamsMips(const string& identifier);
+
+			static const string LODMeshes[3];
+			static const string StaticGeometryMeshes[2];
+			static const string StreamedTextures[2];
+
+			static const int SplatTextureCount = 35;
+			static const int MeshLODCount = 2;
+			static const float LODScreenSizes[MeshLODCount];	//of the screen's height, below which each LOD's used
+			static const int LODGridCells[MeshLODCount];		//across the mesh, for the ones that aren't in files
+			static const int ShadowProxyCells = 6;				//likewise, for the shadow proxies
+			static string SplatFilename(int i);
 
 			vector<AssetLoadInfo> assetInfo;
 
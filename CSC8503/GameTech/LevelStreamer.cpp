@@ -0,0 +1,311 @@
+#include "LevelStreamer.h"
+#include "LevelManager.h"
+#include "ObjectType.h"
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float LevelStreamer::LoadChunks	= 1.5f;
+const float LevelStreamer::UnloadChunks	= 2.5f;
+
+LevelStreamer::LevelStreamer(LevelManager& levels, GameWorld& world) : levels(levels), world(world) {
+	//Clearing the world deletes the resident chunks along with everything else,
+	//and means the level's gone, so there's nothing left to stream
+	world.AddObjectListener(this,
+		[](GameObject* o) {},
+		[&](GameObject* o) {
+			if (!unloading && o->GetTypeID() == ObjectType::StreamedLevel) {
+				worldCleared = true;
+			}
+		}
+	);
+}
+
+LevelStreamer::~LevelStreamer() {
+	world.RemoveObjectListener(this);
+	{
+		std::lock_guard<std::mutex> lock(chunkMutex);
+		running = false;
+	}
+	workAvailable.notify_all();
+	if (streamer.joinable()) {
+		streamer.join();
+	}
+	for (Chunk& c : chunks) {
+		if (c.state == ChunkState::Built) {
+			for (GameObject* o : c.objects) {
+				delete o;
+			}
+		}
+	}
+	for (GameObject* o : deleteQueue) {
+		delete o;
+	}
+}
+
+void LevelStreamer::Start(const LevelData& level) {
+	Stop();
+	gridWidth	= level.GetWidth();
+	gridHeight	= level.GetHeight();
+	unitSize	= level.GetUnitSize();
+
+	const int chunksX = (gridWidth + ChunkCells - 1) / ChunkCells;
+	const int chunksY = (gridHeight + ChunkCells - 1) / ChunkCells;
+	chunks.resize(chunksX * chunksY);
+	for (int y = 0; y < chunksY; ++y) {
+		for (int x = 0; x < chunksX; ++x) {
+			Chunk& c = chunks[y * chunksX + x];
+			c.x0 = x * ChunkCells;
+			c.y0 = y * ChunkCells;
+			c.x1 = c.x0 + ChunkCells < gridWidth ? c.x0 + ChunkCells : gridWidth;
+			c.y1 = c.y0 + ChunkCells < gridHeight ? c.y0 + ChunkCells : gridHeight;
+		}
+	}
+	for (const LevelData::CellGroup& group : level.GetGroups()) {
+		if (group.type != 'i' && (group.type < 'a' || group.type > 'd')) {
+			continue;
+		}
+		for (uint32_t cell : group.cells) {
+			int x = cell % gridWidth;
+			int y = cell / gridWidth;
+			chunks[(y / ChunkCells) * chunksX + x / ChunkCells].cells.emplace_back(group.type, cell);
+		}
+	}
+	active			= true;
+	worldCleared	= false;
+	if (!streamer.joinable()) {
+		streamer = std::thread([this]() { StreamingThread(); });
+	}
+}
+
+void LevelStreamer::Stop() {
+	std::unique_lock<std::mutex> lock(chunkMutex);
+	buildQueue.clear();
+	chunkBuilt.wait(lock, [&]() { return building == 0; });
+	for (Chunk& c : chunks) {
+		if (c.state == ChunkState::Built) {
+			deleteQueue.insert(deleteQueue.end(), c.objects.begin(), c.objects.end());
+		}
+	}
+	chunks.clear();
+	residentCount	= 0;
+	active			= false;
+	lock.unlock();
+	workAvailable.notify_one();
+}
+
+/*
+Merged colliders don't reach over the edge of a chunk, so a long wall ends
+up as a box per chunk it crosses, rather than just the one.
+*/
+void LevelStreamer::BuildChunk(const Chunk& c, std::vector<GameObject*>& into) {
+	const int width		= c.x1 - c.x0;
+	const int height	= c.y1 - c.y0;
+	std::vector<char> colliderCells(width * height, LevelManager::EmptyCell);
+	for (const auto& cell : c.cells) {
+		int x = cell.second % gridWidth;
+		int y = cell.second / gridWidth;
+		into.emplace_back(levels.MakeLevelCell(cell.first, x, y, unitSize));
+		colliderCells[(y - c.y0) * width + (x - c.x0)] = cell.first == 'i' ? LevelManager::ObstacleCell : LevelManager::EdgeWallCell;
+	}
+	levels.MakeMergedColliders(colliderCells, width, height, unitSize, into, c.x0, c.y0);
+	for (GameObject* o : into) {
+		o->SetTypeID(ObjectType::StreamedLevel);
+	}
+}
+
+void LevelStreamer::StreamingThread() {
+	std::unique_lock<std::mutex> lock(chunkMutex);
+	while (running) {
+		if (!deleteQueue.empty()) {
+			std::vector<GameObject*> dead;
+			dead.swap(deleteQueue);
+			lock.unlock();
+			for (GameObject* o : dead) {
+				delete o;
+			}
+			lock.lock();
+			continue;
+		}
+		if (buildQueue.empty()) {
+			workAvailable.wait(lock);
+			continue;
+		}
+		Chunk& c = chunks[buildQueue.front()];
+		buildQueue.pop_front();
+		if (c.state != ChunkState::Queued) {
+			continue; //either given up on, or built on the main thread while it waited
+		}
+		c.state = ChunkState::Building;
+		building++;
+		lock.unlock();
+
+		std::vector<GameObject*> built;
+		BuildChunk(c, built);
+
+		lock.lock();
+		c.objects.swap(built);
+		c.state = ChunkState::Built;
+		building--;
+		chunkBuilt.notify_all();
+	}
+}
+
+float LevelStreamer::DistanceTo(const Chunk& c, const std::vector<Vector3>& around) const {
+	float minX = (float)(c.x0 * unitSize), maxX = (float)(c.x1 * unitSize);
+	float minZ = (float)(c.y0 * unitSize), maxZ = (float)(c.y1 * unitSize);
+	float nearest = FLT_MAX;
+	for (const Vector3& p : around) {
+		float dx = p.x < minX ? minX - p.x : (p.x > maxX ? p.x - maxX : 0.0f);
+		float dz = p.z < minZ ? minZ - p.z : (p.z > maxZ ? p.z - maxZ : 0.0f);
+		float d = dx * dx + dz * dz;
+		nearest = d < nearest ? d : nearest;
+	}
+	return nearest;
+}
+
+/*
+Everything about the chunks is decided under the one lock, but the world
+is only touched once it's been let go of, so the streaming thread can get
+on with the next chunk meanwhile. Nearby chunks go to the front of the
+queue, so they're built first.
+*/
+void LevelStreamer::Update(const std::vector<Vector3>& around) {
+	if (!active) {
+		return;
+	}
+	if (worldCleared) { //and the level with it
+		for (Chunk& c : chunks) {
+			if (c.state == ChunkState::Resident) {
+				c.objects.clear(); //already deleted
+				c.state = ChunkState::Unloaded;
+			}
+		}
+		Stop();
+		return;
+	}
+	ProfileScope scope("Level Streaming");
+	const float chunkSize	= (float)(ChunkCells * unitSize);
+	const float loadDist	= LoadChunks * chunkSize * LoadChunks * chunkSize;
+	const float unloadDist	= UnloadChunks * chunkSize * UnloadChunks * chunkSize;
+	const float nearDist	= 0.25f * chunkSize * chunkSize; //within half a chunk
+
+	readyChunks.clear();
+	neededChunks.clear();
+	leaving.clear();
+	bool changed = false;
+
+	std::unique_lock<std::mutex> lock(chunkMutex);
+	for (int i = 0; i < (int)chunks.size(); ++i) {
+		Chunk& c = chunks[i];
+		float d = DistanceTo(c, around);
+		switch (c.state) {
+		case ChunkState::Unloaded:
+			if (d < loadDist) {
+				c.state = ChunkState::Queued;
+				if (d < nearDist) {
+					buildQueue.push_front(i);
+					neededChunks.emplace_back(i);
+				}
+				else {
+					buildQueue.push_back(i);
+				}
+			}
+			break;
+		case ChunkState::Queued:
+			if (d > unloadDist) {
+				c.state = ChunkState::Unloaded; //skipped when it comes up
+			}
+			else if (d < nearDist) {
+				neededChunks.emplace_back(i);
+			}
+			break;
+		case ChunkState::Building:
+			if (d < nearDist) {
+				neededChunks.emplace_back(i);
+			}
+			break;
+		case ChunkState::Built:
+			if (d > unloadDist) {
+				deleteQueue.insert(deleteQueue.end(), c.objects.begin(), c.objects.end());
+				c.objects.clear();
+				c.state = ChunkState::Unloaded;
+			}
+			else {
+				readyChunks.emplace_back(i);
+			}
+			break;
+		case ChunkState::Resident:
+			if (d > unloadDist) {
+				leaving.insert(leaving.end(), c.objects.begin(), c.objects.end());
+				c.objects.clear();
+				c.state = ChunkState::Unloaded;
+				residentCount--;
+				changed = true;
+			}
+			break;
+		}
+	}
+	workAvailable.notify_one();
+
+	//Rather than letting anyone walk through a wall that isn't there yet
+	for (int i : neededChunks) {
+		Chunk& c = chunks[i];
+		if (c.state == ChunkState::Queued) {
+			c.state = ChunkState::Building;
+			building++;
+			lock.unlock();
+			std::vector<GameObject*> built;
+			BuildChunk(c, built);
+			lock.lock();
+			c.objects.swap(built);
+			c.state = ChunkState::Built;
+			building--;
+			chunkBuilt.notify_all();
+		}
+		else {
+			chunkBuilt.wait(lock, [&]() { return c.state != ChunkState::Building; });
+		}
+		if (c.state == ChunkState::Built) {
+			readyChunks.emplace_back(i);
+		}
+	}
+	//Nothing else moves a chunk on from Built, so they're all the main thread's from here
+	for (int i : readyChunks) {
+		chunks[i].state = ChunkState::Resident;
+	}
+	lock.unlock();
+
+	for (int i : readyChunks) {
+		for (GameObject* o : chunks[i].objects) {
+			world.AddGameObject(o);
+		}
+		residentCount++;
+		changed = true;
+	}
+	if (!leaving.empty()) {
+		unloading = true;
+		for (GameObject* o : leaving) {
+			world.RemoveGameObject(o, false);
+		}
+		unloading = false;
+		lock.lock();
+		deleteQueue.insert(deleteQueue.end(), leaving.begin(), leaving.end());
+		lock.unlock();
+		workAvailable.notify_one();
+	}
+	if (changed) {
+		RebuildStaticTree();
+	}
+}
+
+//Only needed once the world's had its first tree, which the game builds after loading the level
+void LevelStreamer::RebuildStaticTree() {
+	if (world.GetStaticTree()) {
+		ProfileScope scope("Static Tree");
+		world.BuildStaticTree();
+	}
+}
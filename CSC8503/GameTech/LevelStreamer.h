@@ -0,0 +1,115 @@
+#pragma once
+#include "LevelData.h"
+#include "../../Common/Vector3.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+		class GameObject;
+		class GameWorld;
+		class LevelManager;
+
+		/*
+		Splits a big level's obstacles and edge walls into square chunks of
+		cells, and only keeps the chunks near the players in the world. The
+		chunks are built - render objects, merged colliders and all - on a
+		thread of its own, so it never holds up the job system, and handed
+		back for the main thread to add to the world in Update. Chunks that
+		have been left far enough behind are taken out of the world there
+		too, and deleted back on the streaming thread.
+
+		Every time the resident chunks change, the static tree is rebuilt,
+		so it only ever holds the part of the level that's in play. A chunk
+		has to be left a little further behind than it was brought in at,
+		so walking back and forth over the edge doesn't keep swapping it.
+
+		Anything right next to a player that isn't in yet is built there
+		and then, rather than letting them walk through it - which is what
+		happens the first time Update's called on a new level.
+		*/
+		class LevelStreamer {
+		public:
+			LevelStreamer(LevelManager& levels, GameWorld& world);
+			~LevelStreamer();
+
+			//Takes the obstacles and edge walls from the level, to be streamed in
+			//around whatever Update's given, rather than them being built now
+			void Start(const LevelData& level);
+			//Deletes anything built but not in the world yet, and forgets the level -
+			//whatever's in the world stays there, for the world to delete
+			void Stop();
+
+			bool IsActive() const {
+				return active;
+			}
+
+			void Update(const std::vector<Vector3>& around);
+
+			int GetChunkCount() const {
+				return (int)chunks.size();
+			}
+			int GetResidentCount() const {
+				return residentCount;
+			}
+
+			static const int ChunkCells			= 16;			//along each side
+			static const int StreamedLevelCells	= 256 * 256;	//levels smaller than this are just loaded whole
+			static const float LoadChunks;		//how close a chunk has to be to be brought in, in chunks
+			static const float UnloadChunks;	//and how far away before it's let go of
+
+		protected:
+			enum class ChunkState {
+				Unloaded,
+				Queued,
+				Building,
+				Built,		//waiting for the main thread
+				Resident
+			};
+
+			struct Chunk {
+				int		x0, y0, x1, y1;	//the cells it covers, from x0 and y0 up to x1 and y1
+				std::vector<std::pair<char, uint32_t>>	cells;	//what's in each, in grid order
+				std::vector<GameObject*>				objects;
+				ChunkState								state = ChunkState::Unloaded;
+			};
+
+			//On the streaming thread, or the main one if it's needed straight away
+			void BuildChunk(const Chunk& c, std::vector<GameObject*>& into);
+			void StreamingThread();
+			//Squared, along the ground, to the nearest of them
+			float DistanceTo(const Chunk& c, const std::vector<Vector3>& around) const;
+			void RebuildStaticTree();
+
+			LevelManager&	levels;
+			GameWorld&		world;
+
+			std::vector<Chunk>	chunks;
+			int		gridWidth		= 0;
+			int		gridHeight		= 0;
+			int		unitSize		= 1;
+			int		residentCount	= 0;
+			bool	active			= false;
+
+			bool	unloading		= false;	//so it can tell its own removals from the world being cleared
+			bool	worldCleared	= false;
+
+			std::thread					streamer;
+			std::mutex					chunkMutex;	//guards the queues, and each chunk's state and objects
+			std::condition_variable		workAvailable;
+			std::condition_variable		chunkBuilt;
+			std::deque<int>				buildQueue;
+			std::vector<GameObject*>	deleteQueue;
+			int							building	= 0;
+			bool						running		= true;
+
+			std::vector<int>			readyChunks;	//reused by Update
+			std::vector<int>			neededChunks;
+			std::vector<GameObject*>	leaving;
+		};
+	}
+}
@@ -0,0 +1,203 @@
+#include "LightGrid.h"
+#include "../../Common/MemoryTracker.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+static const GLsizeiptr lightBufferSize		= sizeof(Vector4) * 2 * LightGrid::MaxLights;
+static const GLsizeiptr clusterBufferSize	= sizeof(uint32_t) * 2 * LightGrid::ClusterCount;
+static const GLsizeiptr indexBufferSize		= sizeof(uint32_t) * LightGrid::MaxIndices;
+
+static void CreateTextureBuffer(GLuint& buffer, GLuint& tex, GLsizeiptr size, GLenum format) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_BUFFER, tex);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+LightGrid::LightGrid() {
+	if (!glTexBuffer) {
+		return;
+	}
+	supported = true;
+	CreateTextureBuffer(lightBuffer, lightTex, lightBufferSize, GL_RGBA32F);
+	CreateTextureBuffer(clusterBuffer, clusterTex, clusterBufferSize, GL_RG32UI);
+	CreateTextureBuffer(indexBuffer, indexTex, indexBufferSize, GL_R32UI);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, lightBufferSize + clusterBufferSize + indexBufferSize);
+
+	clusterData.resize(ClusterCount * 2);
+}
+
+LightGrid::~LightGrid() {
+	if (!supported) {
+		return;
+	}
+	glDeleteTextures(1, &lightTex);
+	glDeleteTextures(1, &clusterTex);
+	glDeleteTextures(1, &indexTex);
+	glDeleteBuffers(1, &lightBuffer);
+	glDeleteBuffers(1, &clusterBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	MemoryTracker::RecordGPU(MemoryTag::Rendering, -(int64_t)(lightBufferSize + clusterBufferSize + indexBufferSize));
+}
+
+int LightGrid::SliceOf(float depth) const {
+	int slice = (int)floorf(logf(depth) * sliceScale + sliceBias);
+	return slice < 0 ? 0 : (slice >= Slices ? Slices - 1 : slice);
+}
+
+/*
+Everything's worked out in view space, looking down -z, with depths made
+positive. A cluster's box is the widest its tile gets across its slice,
+so the sphere test is a little generous towards the edges of the screen,
+but never misses anything. Lights are added to their clusters in the
+order they came in, so the shaders always add them up in the same order.
+*/
+void LightGrid::Build(const std::vector<PointLight>& lights, const Matrix4& viewMatrix, const Matrix4& projMatrix, float nearPlane, float farPlane) {
+	if (!supported) {
+		return;
+	}
+	float depthRatio	= logf(farPlane / nearPlane);
+	sliceScale			= (float)Slices / depthRatio;
+	sliceBias			= -(float)Slices * logf(nearPlane) / depthRatio;
+	for (int s = 0; s <= Slices; ++s) {
+		sliceDepths[s] = nearPlane * expf(depthRatio * (float)s / (float)Slices);
+	}
+	const float scaleX = projMatrix.array[0];
+	const float scaleY = projMatrix.array[5];
+
+	lightCount = 0;
+	lightData.clear();
+	pairs.clear();
+	for (const PointLight& l : lights) {
+		if (lightCount == MaxLights) {
+			break;
+		}
+		Vector3 viewPos	= viewMatrix * l.position;
+		float depth		= -viewPos.z;
+		float r			= l.radius;
+		if (depth + r < nearPlane || depth - r > farPlane || r <= 0.0f) {
+			continue;
+		}
+		int minTileX = 0, maxTileX = TilesX - 1;
+		int minTileY = 0, maxTileY = TilesY - 1;
+		//Anything reaching the near plane could cover the whole screen
+		if (depth - r > nearPlane) {
+			float nearZ = depth - r;
+			float farZ	= depth + r;
+			float x0 = viewPos.x - r, x1 = viewPos.x + r;
+			float y0 = viewPos.y - r, y1 = viewPos.y + r;
+			float ndcX0 = scaleX * x0 / (x0 < 0.0f ? nearZ : farZ);
+			float ndcX1 = scaleX * x1 / (x1 > 0.0f ? nearZ : farZ);
+			float ndcY0 = scaleY * y0 / (y0 < 0.0f ? nearZ : farZ);
+			float ndcY1 = scaleY * y1 / (y1 > 0.0f ? nearZ : farZ);
+			if (ndcX1 < -1.0f || ndcX0 > 1.0f || ndcY1 < -1.0f || ndcY0 > 1.0f) {
+				continue;
+			}
+			minTileX = (int)floorf((ndcX0 * 0.5f + 0.5f) * TilesX);
+			maxTileX = (int)floorf((ndcX1 * 0.5f + 0.5f) * TilesX);
+			minTileY = (int)floorf((ndcY0 * 0.5f + 0.5f) * TilesY);
+			maxTileY = (int)floorf((ndcY1 * 0.5f + 0.5f) * TilesY);
+			minTileX = minTileX < 0 ? 0 : minTileX;
+			minTileY = minTileY < 0 ? 0 : minTileY;
+			maxTileX = maxTileX >= TilesX ? TilesX - 1 : maxTileX;
+			maxTileY = maxTileY >= TilesY ? TilesY - 1 : maxTileY;
+		}
+		int minSlice = SliceOf(depth - r > nearPlane ? depth - r : nearPlane);
+		int maxSlice = SliceOf(depth + r < farPlane ? depth + r : farPlane);
+
+		bool used = false;
+		for (int s = minSlice; s <= maxSlice; ++s) {
+			float z0 = sliceDepths[s];
+			float z1 = sliceDepths[s + 1];
+			float dz = depth < z0 ? z0 - depth : (depth > z1 ? depth - z1 : 0.0f);
+			for (int y = minTileY; y <= maxTileY; ++y) {
+				float ndcY0 = -1.0f + 2.0f * (float)y / TilesY;
+				float ndcY1 = -1.0f + 2.0f * (float)(y + 1) / TilesY;
+				float boxY0 = (ndcY0 < 0.0f ? ndcY0 * z1 : ndcY0 * z0) / scaleY;
+				float boxY1 = (ndcY1 > 0.0f ? ndcY1 * z1 : ndcY1 * z0) / scaleY;
+				float dy = viewPos.y < boxY0 ? boxY0 - viewPos.y : (viewPos.y > boxY1 ? viewPos.y - boxY1 : 0.0f);
+				for (int x = minTileX; x <= maxTileX; ++x) {
+					float ndcX0 = -1.0f + 2.0f * (float)x / TilesX;
+					float ndcX1 = -1.0f + 2.0f * (float)(x + 1) / TilesX;
+					float boxX0 = (ndcX0 < 0.0f ? ndcX0 * z1 : ndcX0 * z0) / scaleX;
+					float boxX1 = (ndcX1 > 0.0f ? ndcX1 * z1 : ndcX1 * z0) / scaleX;
+					float dx = viewPos.x < boxX0 ? boxX0 - viewPos.x : (viewPos.x > boxX1 ? viewPos.x - boxX1 : 0.0f);
+					if (dx * dx + dy * dy + dz * dz > r * r) {
+						continue;
+					}
+					uint32_t cluster = (uint32_t)((s * TilesY + y) * TilesX + x);
+					pairs.emplace_back(cluster << 16 | (uint32_t)lightCount);
+					used = true;
+				}
+			}
+		}
+		if (used) {
+			lightData.emplace_back(Vector4(l.position.x, l.position.y, l.position.z, r));
+			lightData.emplace_back(l.colour);
+			lightCount++;
+		}
+	}
+	if ((int)pairs.size() > MaxIndices) {
+		pairs.resize(MaxIndices);
+	}
+
+	//A counting sort of the pairs into each cluster's list
+	std::fill(clusterData.begin(), clusterData.end(), 0);
+	for (uint32_t p : pairs) {
+		clusterData[(p >> 16) * 2 + 1]++;
+	}
+	uint32_t offset = 0;
+	for (int c = 0; c < ClusterCount; ++c) {
+		clusterData[c * 2] = offset;
+		offset += clusterData[c * 2 + 1];
+	}
+	indexData.resize(pairs.size());
+	for (int c = 0; c < ClusterCount; ++c) {
+		clusterData[c * 2 + 1] = 0; //counted again as they're filled in
+	}
+	for (uint32_t p : pairs) {
+		uint32_t cluster = p >> 16;
+		indexData[clusterData[cluster * 2] + clusterData[cluster * 2 + 1]++] = p & 0xffff;
+	}
+	Upload();
+}
+
+//Each buffer's orphaned first, so last frame's copy can still be read while this one's written
+void LightGrid::Upload() {
+	glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, lightBufferSize, nullptr, GL_STREAM_DRAW);
+	if (!lightData.empty()) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, lightData.size() * sizeof(Vector4), lightData.data());
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, clusterBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, clusterBufferSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, clusterData.size() * sizeof(uint32_t), clusterData.data());
+
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, indexBufferSize, nullptr, GL_STREAM_DRAW);
+	if (!indexData.empty()) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, indexData.size() * sizeof(uint32_t), indexData.data());
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightGrid::Bind(int firstUnit) const {
+	if (!supported) {
+		return;
+	}
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, lightTex);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, clusterTex);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+	glBindTexture(GL_TEXTURE_BUFFER, indexTex);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "../../Plugins/OpenGLRendering/OGLRenderer.h"
+#include "../../Common/Matrix4.h"
+#include "DynamicLights.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+
+		/*
+		Splits the camera's frustum into clusters - a grid of tiles across the
+		screen, each cut into slices of depth that get thicker further away -
+		and lists which lights reach each one. It's built on the CPU once a
+		frame, and handed to the forward shaders as texture buffers, so each
+		pixel only loops over the handful of lights in its own cluster, however
+		many there are in the level.
+
+		A light's found a box of clusters from the box around its sphere, and
+		is then only added to the ones its sphere actually touches.
+		*/
+		class LightGrid {
+		public:
+			LightGrid();
+			~LightGrid();
+
+			//Needs GL 3.1, for texture buffers
+			bool IsSupported() const {
+				return supported;
+			}
+
+			void Build(const std::vector<PointLight>& lights, const Matrix4& viewMatrix, const Matrix4& projMatrix, float nearPlane, float farPlane);
+
+			//The lights, clusters and light indices, on three units from firstUnit
+			void Bind(int firstUnit) const;
+
+			int GetLightCount() const {
+				return lightCount;
+			}
+			//log(view depth) * scale + bias is a pixel's slice
+			float GetSliceScale() const {
+				return sliceScale;
+			}
+			float GetSliceBias() const {
+				return sliceBias;
+			}
+
+			//These have to match the shaders'
+			static const int TilesX		= 16;
+			static const int TilesY		= 9;
+			static const int Slices		= 24;
+			static const int ClusterCount	= TilesX * TilesY * Slices;
+			static const int MaxLights		= 512;	//in view, with any past that left out
+			static const int MaxIndices		= 65536;
+
+		protected:
+			int SliceOf(float depth) const;
+			void Upload();
+
+			GLuint	lightBuffer		= 0;
+			GLuint	lightTex		= 0;
+			GLuint	clusterBuffer	= 0;
+			GLuint	clusterTex		= 0;
+			GLuint	indexBuffer		= 0;
+			GLuint	indexTex		= 0;
+			bool	supported		= false;
+
+			int		lightCount	= 0;
+			float	sliceScale	= 0.0f;
+			float	sliceBias	= 0.0f;
+
+			std::vector<Vector4>	lightData;		//two per light: position and radius, then colour
+			std::vector<uint32_t>	clusterData;	//two per cluster: first index, then how many
+			std::vector<uint32_t>	indexData;
+			std::vector<uint32_t>	pairs;			//cluster and light, before they're sorted by cluster
+			float					sliceDepths[Slices + 1];
+		};
+	}
+}
@@ -0,0 +1,150 @@
+#include "LoadTestClient.h"
+#include "Agent.h"
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+LoadTestClient::LoadTestClient(int botNum) : random(botNum * 7919 + 1) {
+	client = new GameClient();
+
+	//Everything the server sends has to be accepted, even if a bot has no use for it
+	for (int i = 0; i < MaxMessageTypes; ++i) {
+		client->AddPacketHandler(i, [](GamePacket*, int) {});
+	}
+	client->RegisterPacketHandler<SnapshotPacket>(Snapshot_State, [this](SnapshotPacket& p, int source) {
+		if (!snapshots.Decode(p)) {
+			return;
+		}
+		p.ForEachPacket([&](const GamePacket& inner) {
+			client->ProcessPacket((GamePacket*)&inner, source);
+		});
+	});
+	client->RegisterPacketHandler<PlayerIDPacket>(Player_ID, [this](PlayerIDPacket& p, int) { ReceivePlayerID(p); });
+	client->RegisterPacketHandler<PlayerStatePacket>(Player_State, [this](PlayerStatePacket& p, int) { ReceivePlayerState(p); });
+	client->RegisterPacketHandler<GameTimerPacket>(Game_Timer, [this](GameTimerPacket& p, int) {
+		if (p.snapshotID > lastSnapshotID) {
+			lastSnapshotID = p.snapshotID;
+		}
+	});
+}
+
+LoadTestClient::~LoadTestClient() {
+	delete client;
+}
+
+bool LoadTestClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int port) {
+	return client->Connect(a, b, c, d, port);
+}
+
+void LoadTestClient::Update(float dt) {
+	client->UpdateClient();
+	client->UpdateStatistics(dt);
+	if (!HasJoined()) {
+		return;
+	}
+	ChooseInput(dt);
+
+	sendTimer += dt;
+	if (sendTimer >= sendDT) {
+		sendTimer -= sendDT;
+		if (sendTimer > sendDT) {
+			sendTimer = 0.0f;
+		}
+		SendInput();
+	}
+}
+
+//The first ID just says which player we'll be, and the second that the server's made us one
+void LoadTestClient::ReceivePlayerID(const PlayerIDPacket& packet) {
+	if (playerID == -1) {
+		playerID = packet.playerID;
+		ClientInput input;
+		input.playerID = playerID;
+		ClientPacket join;
+		join.Write(input);
+		client->SendPacket(join);
+	}
+	else if (packet.playerID == playerID && packet.objectID != -1) {
+		joined = true;
+	}
+}
+
+void LoadTestClient::ReceivePlayerState(const PlayerStatePacket& packet) {
+	double now = Now();
+	while (!sentInputs.empty() && sentInputs.front().sequence <= packet.inputSequence) {
+		if (sentInputs.front().sequence == packet.inputSequence) {
+			float latency = (float)((now - sentInputs.front().time) * 1000.0);
+			latencyTotal += latency;
+			latencyMax = latency > latencyMax ? latency : latencyMax;
+			latencySamples++;
+		}
+		sentInputs.pop_front();
+	}
+}
+
+/*
+Much like an Opponent wandering between targets - it picks a direction and
+a rate to turn at, and holds them for a second or two before picking again.
+*/
+void LoadTestClient::ChooseInput(float dt) {
+	std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+	decisionTimer -= dt;
+	if (decisionTimer <= 0.0f) {
+		decisionTimer	= 1.0f + chance(random) * 2.0f;
+		turnRate		= (chance(random) - 0.5f) * 180.0f;
+		buttons			= chance(random) < 0.8f ? AgentInput::Forward : 0;
+		if (chance(random) < 0.3f) {
+			buttons |= chance(random) < 0.5f ? AgentInput::Left : AgentInput::Right;
+		}
+		if (chance(random) < 0.2f) {
+			buttons |= AgentInput::Jump;
+		}
+	}
+	yaw += turnRate * dt;
+	if (yaw < 0.0f) {
+		yaw += 360.0f;
+	}
+	else if (yaw > 360.0f) {
+		yaw -= 360.0f;
+	}
+}
+
+void LoadTestClient::SendInput() {
+	ClientInput input;
+	input.playerID		= playerID;
+	input.acknowledged	= lastSnapshotID;
+	input.inputSequence = ++inputSequence;
+
+	for (int i = ClientPacket::InputHistory - 1; i > 0; --i) {
+		recentInputs[i] = recentInputs[i - 1];
+	}
+	InputFrame& frame	= recentInputs[0];
+	frame				= InputFrame();
+	frame.buttons		= (short)buttons;
+	frame.yaw			= yaw;
+	buttons &= ~AgentInput::Jump; //only jump once per decision
+
+	fireTimer -= sendDT;
+	if (fireTimer <= 0.0f) {
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+		fireTimer = 0.5f + chance(random) * 1.5f;
+		frame.firingInfo = 0;
+	}
+	input.frameCount = inputSequence + 1 < ClientPacket::InputHistory ? inputSequence + 1 : ClientPacket::InputHistory;
+	for (int i = 0; i < input.frameCount; ++i) {
+		input.frames[i] = recentInputs[i];
+	}
+	sentInputs.push_back({ input.inputSequence, Now() });
+	if (sentInputs.size() > 600) {
+		sentInputs.pop_front(); //the server's stopped answering, so don't keep them forever
+	}
+	ClientPacket packet;
+	packet.Write(input);
+	client->SendPacket(packet);
+}
+
+double LoadTestClient::Now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "../CSC8503Common/GameClient.h"
+#include "../CSC8503Common/NetworkObject.h"
+#include "../CSC8503Common/SnapshotHistory.h"
+#include <deque>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A client with no world of its own, for load testing a server. It
+		joins like a real player would, then wanders about, turning and
+		shooting every so often, so the server has to do the same work as
+		for a real player. It times how long each input takes to come back
+		in a snapshot, which is the lag a player would actually feel.
+		*/
+		class LoadTestClient {
+		public:
+			LoadTestClient(int botNum);
+			~LoadTestClient();
+
+			bool Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int port = NetworkBase::GetDefaultPort());
+			void Update(float dt);
+
+			bool HasJoined() const {
+				return playerID != -1 && joined;
+			}
+
+			//The average and worst input latency since the last reset, in milliseconds
+			float GetAverageLatency() const {
+				return latencySamples ? latencyTotal / (float)latencySamples : 0.0f;
+			}
+			float GetMaxLatency() const {
+				return latencyMax;
+			}
+			void ResetLatency() {
+				latencyTotal	= 0.0f;
+				latencyMax		= 0.0f;
+				latencySamples	= 0;
+			}
+
+			NetworkStatistics& GetStatistics() {
+				return client->GetStatistics();
+			}
+
+		protected:
+			void ReceivePlayerID(const PlayerIDPacket& packet);
+			void ReceivePlayerState(const PlayerStatePacket& packet);
+			void ChooseInput(float dt);
+			void SendInput();
+
+			static double Now();
+
+			GameClient* client;
+			std::mt19937 random;
+			SnapshotHistory snapshots;
+
+			int		playerID		= -1;
+			bool	joined			= false;
+			int		lastSnapshotID	= -1;
+			int		inputSequence	= -1;
+			InputFrame recentInputs[ClientPacket::InputHistory];
+
+			int		buttons			= 0;
+			float	yaw				= 0.0f;
+			float	turnRate		= 0.0f;
+			float	decisionTimer	= 0.0f;	//until the next change of direction
+			float	fireTimer		= 0.0f;
+			float	sendTimer		= 0.0f;
+			float	sendDT			= 1.0f / 60.0f;
+
+			struct SentInput {
+				int		sequence;
+				double	time;
+			};
+			std::deque<SentInput> sentInputs;
+
+			float	latencyTotal	= 0.0f;
+			float	latencyMax		= 0.0f;
+			int		latencySamples	= 0;
+		};
+	}
+}
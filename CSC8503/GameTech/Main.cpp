@@ -1,4 +1,5 @@
 #include "../../Common/Window.h"
+#include "../../Common/TextureLoader.h"
 
 #include "../CSC8503Common/StateMachine.h"
 #include "../CSC8503Common/StateTransition.h"
@@ -17,16 +18,35 @@
 #include "../CSC8503Common/PushdownMachine.h"
 
 #include "../CSC8503Common/SoundSystem.h"
+#include "../CSC8503Common/JobSystem.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../CSC8503Common/TelemetryServer.h"
 
 #include "TutorialGame.h"
 #include "Game.h"
 #include "NetworkedGame.h"
+#include "LoadTestClient.h"
+#include "MatchHost.h"
+#include "MatchTelemetry.h"
+#include "PhysicsBenchmark.h"
+#include "RenderBenchmark.h"
+#include "SoakTest.h"
+#include "FramePacer.h"
+#include "LevelData.h"
+#include "../../Common/Assets.h"
+#include "../../Common/AssetArchive.h"
+#include "../CSC8503Common/CollisionBenchmark.h"
+#include "../CSC8503Common/PathfindingBenchmark.h"
+#include "../CSC8503Common/SnapshotBenchmark.h"
 
 using namespace NCL;
 using namespace CSC8503;
 
 #include <chrono>
 #include <thread>
+#include <fstream>
+#include <sstream>
+#include <cctype>
 
 /*
 
@@ -41,9 +61,498 @@ hide or show the
 
 */
 
-int main() {
+/*
+Started with -server, there's no window, renderer or sound - just the
+simulation and the network, ticked at a fixed rate. -players sets how
+many need to join before the match begins, and -latency, -jitter and
+-loss make the server's connection to everyone worse, for testing.
+-record saves everything sent to the first player to join, which can be
+played back later with -playback (and -speed) instead of connecting.
+-noxor sends snapshots as they are, rather than XORed against the last
+one each client acknowledged.
+How long each tick takes is printed every few seconds, along with the
+bandwidth, so it's obvious when the server's falling behind.
+-port chooses the port to listen on, and with -matches N, that many
+matches are run at once instead, on that port and the ones after it -
+see MatchHost.
+-telemetry PORT serves the tick times, connections, bandwidth, object
+counts and allocations over HTTP on PORT, at /metrics, for Prometheus
+or anything else that can read its text format to scrape. It's only on
+the loopback, unless -telemetrybind gives another address to listen on.
+*/
+int RunHeadlessServer(int port, int startPlayers, int maxPlayers, const NetworkConditions& conditions, const string& recordFile, bool xorSnapshots, int telemetryPort, const string& telemetryAddress) {
+	JobSystem::Initialise();
+	srand(time(0));
+
+	NetworkedGame* g = new NetworkedGame(true);
+	g->SetMaxPlayers(maxPlayers);
+	g->SetServerPort(port);
+	g->SetSnapshotXor(xorSnapshots);
+	g->StartHeadlessServer(startPlayers);
+	g->GetNetworkBase()->SetSimulatedConditions(conditions, conditions);
+	if (!recordFile.empty() && !g->GetNetworkBase()->StartRecording(recordFile, 0)) {
+		std::cout << "Couldn't record to " << recordFile << std::endl;
+	}
+
+	const float tickDT = 1.0f / 60.0f;
+	const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(tickDT));
+	auto nextTick = std::chrono::steady_clock::now();
+
+	//The jobs' allocations are the match's too, as it's the only one
+	MatchTelemetry telemetry(true);
+	std::vector<MatchTelemetry*> telemetryPages = { &telemetry };
+	TelemetryServer* telemetryServer = telemetryPort > 0 ? new TelemetryServer(telemetryPort, telemetryAddress) : nullptr;
+	auto writePage = [&](std::string& page) {
+		MatchTelemetry::WritePage(telemetryPages, page, tickDT * 1000.0f);
+	};
+
+	const int reportTicks = 300;
+	int ticks			= 0;
+	double tickTotal	= 0.0;
+	double tickMax		= 0.0;
+
+	while (g->IsPlaying()) {
+		auto tickStart = std::chrono::steady_clock::now();
+		telemetry.BeginTick();
+		g->UpdateGame(tickDT);
+		telemetry.EndTick(*g);
+		double tickTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
+		if (telemetryServer) {
+			telemetryServer->Update(tickDT, writePage); //after the tick's timed, so answering a scrape doesn't count against it
+		}
+
+		tickTotal	+= tickTime;
+		tickMax		= tickTime > tickMax ? tickTime : tickMax;
+		if (++ticks == reportTicks) {
+			NetworkStatistics& stats = g->GetNetworkBase()->GetStatistics();
+			std::cout << std::fixed << std::setprecision(2) << "Tick avg " << tickTotal / ticks << "ms, max " << tickMax
+				<< "ms, in " << stats.GetBytesInPerSecond() / 1024.0f << "KB/s, out " << stats.GetBytesOutPerSecond() / 1024.0f
+				<< "KB/s (" << stats.GetWireBytesOutPerSecond() / 1024.0f << "KB/s on the wire)" << std::endl;
+			ticks		= 0;
+			tickTotal	= 0.0;
+			tickMax		= 0.0;
+		}
+
+		nextTick += tickLength;
+		auto now = std::chrono::steady_clock::now();
+		if (now - nextTick > std::chrono::milliseconds(250)) {
+			std::cout << "Server running behind, skipping ticks" << std::endl;
+			nextTick = now; //don't try to catch up on everything we've missed
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+	delete telemetryServer;
+	delete g;
+	JobSystem::Destroy();
+	return 0;
+}
+
+int RunMatchHost(int matchCount, int firstPort, int startPlayers, int maxPlayers, const NetworkConditions& conditions, bool xorSnapshots, int telemetryPort, const string& telemetryAddress) {
+	srand(time(0));
+
+	MatchHost host;
+	host.SetTelemetryPort(telemetryPort, telemetryAddress);
+	for (int i = 0; i < matchCount; ++i) {
+		host.AddMatch(firstPort + i, startPlayers, maxPlayers, xorSnapshots, conditions);
+	}
+	std::cout << "Running " << host.GetMatchCount() << " matches on ports " << firstPort << " to " << firstPort + matchCount - 1 << std::endl;
+	host.Run(1.0f / 60.0f);
+	return 0;
+}
+
+/*
+Started with -loadtest N, it connects N bot clients to the server given by
+-connect, and runs them for -duration seconds (or until closed, if that's
+0). With -matches, the bots are shared out between that many ports from
+-port, to load up a MatchHost. Once a second, the average and worst input latency across the bots is
+written out, along with their total bandwidth, to the console and to
+LoadTest.csv.
+*/
+int RunLoadTest(int botCount, const string& address, int firstPort, int matchCount, float duration) {
+	int ip[4] = { 127, 0, 0, 1 };
+	std::stringstream parts(address);
+	string part;
+	for (int i = 0; i < 4 && std::getline(parts, part, '.'); ++i) {
+		ip[i] = atoi(part.c_str());
+	}
+	NetworkBase::Initialise();
+
+	std::vector<LoadTestClient*> bots;
+	for (int i = 0; i < botCount; ++i) {
+		LoadTestClient* bot = new LoadTestClient(i);
+		if (!bot->Connect(ip[0], ip[1], ip[2], ip[3], firstPort + i % matchCount)) {
+			std::cout << "Bot " << i << " couldn't start connecting" << std::endl;
+		}
+		bots.push_back(bot);
+	}
+
+	std::ofstream csv("LoadTest.csv");
+	csv << "time,joined,avg_latency_ms,max_latency_ms,bytes_in_per_s,bytes_out_per_s\n";
+
+	const float tickDT = 1.0f / 60.0f;
+	const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(tickDT));
+	auto nextTick = std::chrono::steady_clock::now();
+
+	float time			= 0.0f;
+	float reportTimer	= 0.0f;
+	while (duration <= 0.0f || time < duration) {
+		for (LoadTestClient* bot : bots) {
+			bot->Update(tickDT);
+		}
+		time		+= tickDT;
+		reportTimer += tickDT;
+
+		if (reportTimer >= 1.0f) {
+			reportTimer = 0.0f;
+			int joined			= 0;
+			float latencyTotal	= 0.0f;
+			float latencyMax	= 0.0f;
+			float bytesIn		= 0.0f;
+			float bytesOut		= 0.0f;
+			for (LoadTestClient* bot : bots) {
+				if (bot->HasJoined()) {
+					joined++;
+					latencyTotal += bot->GetAverageLatency();
+				}
+				latencyMax	= bot->GetMaxLatency() > latencyMax ? bot->GetMaxLatency() : latencyMax;
+				bytesIn		+= bot->GetStatistics().GetBytesInPerSecond();
+				bytesOut	+= bot->GetStatistics().GetBytesOutPerSecond();
+				bot->ResetLatency();
+			}
+			float latencyAverage = joined ? latencyTotal / joined : 0.0f;
+			std::cout << std::fixed << std::setprecision(1) << (int)time << "s: " << joined << "/" << botCount << " joined, latency avg "
+				<< latencyAverage << "ms, max " << latencyMax << "ms, in " << bytesIn / 1024.0f << "KB/s, out " << bytesOut / 1024.0f << "KB/s" << std::endl;
+			csv << time << "," << joined << "," << latencyAverage << "," << latencyMax << "," << bytesIn << "," << bytesOut << "\n";
+		}
+
+		nextTick += tickLength;
+		auto now = std::chrono::steady_clock::now();
+		if (now - nextTick > std::chrono::milliseconds(250)) {
+			nextTick = now;
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+	for (LoadTestClient* bot : bots) {
+		delete bot;
+	}
+	NetworkBase::Destroy();
+	return 0;
+}
+
+/*
+Started with -physicsbench, it times the physics on synthetic scenes of
+each of the object counts given after it (or 100 up to 50000 if none are),
+for -frames frames each, writing the results to the console and to
+PhysicsBenchmark.csv, then quits. Nothing needs a window or any assets.
+*/
+int RunPhysicsBenchmark(const vector<int>& counts, int frames) {
+	JobSystem::Initialise();
+	PhysicsBenchmark* bench = new PhysicsBenchmark(frames);
+	bench->RunAll(counts.empty() ? vector<int>{ 100, 500, 1000, 5000, 10000, 50000 } : counts);
+	delete bench;
+	JobSystem::Destroy();
+	return 0;
+}
+
+/*
+Started with -rollbackcheck, it saves, steps, restores and steps again
+each of the physics benchmark's scenes at the object counts given after
+it (or 100 up to 5000 if none are), checking the WorldRollback puts them
+back well enough that both runs end up the same, and that saving the
+same ticks again doesn't allocate. It returns how many didn't, so it can
+be run as a check.
+*/
+int RunRollbackCheck(const vector<int>& counts) {
+	JobSystem::Initialise();
+	PhysicsBenchmark* bench = new PhysicsBenchmark();
+	int failed = bench->CheckAllRollbacks(counts.empty() ? vector<int>{ 100, 1000, 5000 } : counts);
+	delete bench;
+	JobSystem::Destroy();
+	return failed;
+}
+
+/*
+Started with -collisionbench, it times every collision routine on random
+pairs of shapes (100000 of them, or however many are given after it), and
+checks each against a slow reference, writing the results out to the
+console and to CollisionBenchmark.csv. It returns how many routines got
+anything wrong, so it can be run as a check.
+*/
+int RunCollisionBenchmark(int cases, unsigned int seed) {
+	CollisionBenchmark bench(cases > 0 ? cases : 100000, seed);
+	return bench.RunAll();
+}
+
+/*
+Started with -pathbench, it times every kind of path finding on
+LevelLayout.txt, and on generated mazes of each size given after it (or
+64 up to 512 cells across if none are), for -queries random pairs of
+floor cells each, writing the results out to the console and to
+PathfindingBenchmark.csv.
+*/
+int RunPathfindingBenchmark(const vector<int>& sizes, int queries, unsigned int seed) {
+	PathfindingBenchmark bench(queries > 0 ? queries : 2000, seed);
+	bench.RunAll(sizes.empty() ? vector<int>{ 64, 128, 256, 512 } : sizes);
+	return 0;
+}
+
+/*
+Started with -netbench, it sends synthetic worlds of each of the object
+counts given after it (or 100 up to 5000 if none are), and any -record
+recordings named along with them, through the snapshot encoding to
+-clients clients, for -frames snapshots each, writing the results out
+to the console and to SnapshotBenchmark.csv.
+*/
+int RunSnapshotBenchmark(const vector<int>& counts, const vector<string>& recordings, int clients, int snapshots) {
+	NetworkedGame::RegisterNetworkTypes(); //for reading the recordings
+	SnapshotBenchmark bench(snapshots, 1);
+	bench.RunAll(counts.empty() && recordings.empty() ? vector<int>{ 100, 500, 1000, 5000 } : counts, clients, recordings);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	bool server			= false;
+	int startPlayers	= 1;
+	int maxPlayers		= NetworkedGame::Teams;
+	int loadTestBots	= 0;
+	string connectAddress = "127.0.0.1";
+	float loadTestDuration = 0.0f;
+	string recordFile;
+	string playbackFile;
+	float playbackSpeed	= 1.0f;
+	NetworkConditions conditions;
+	vector<string> meshesToConvert;
+	vector<string> texturesToConvert;
+	vector<string> levelsToConvert;
+	bool packAssets		= false;
+	bool physicsBench	= false;
+	bool rollbackCheck	= false;
+	vector<int> benchCounts;
+	int benchFrames		= 300;
+	bool collisionBench	= false;
+	int collisionCases	= 0;
+	unsigned int benchSeed = 1;
+	bool pathBench		= false;
+	vector<int> mazeSizes;
+	int pathQueries		= 0;
+	bool netBench		= false;
+	vector<string> benchRecordings;
+	int benchClients	= 4;
+	bool renderBench	= false;
+	int renderBlocks	= 4096;
+	bool soakTest		= false;
+	int soakMatches		= 10;
+	int soakBots		= 0;
+	float matchLength	= 90.0f;
+	bool xorSnapshots	= true;
+	int port			= NetworkBase::GetDefaultPort();
+	int matchCount		= 1;
+	int telemetryPort	= 0;
+	string telemetryAddress = TelemetryServer::DefaultAddress;
+	float playingRate	= -1.0f; //left as FramePacer has them, unless they're given
+	float menuRate		= -1.0f;
+	int textureBudget	= -1;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-server") {
+			server = true;
+		}
+		else if (arg == "-players" && i + 1 < argc) {
+			startPlayers = atoi(argv[++i]);
+		}
+		else if (arg == "-maxplayers" && i + 1 < argc) {
+			maxPlayers = atoi(argv[++i]);
+		}
+		else if (arg == "-port" && i + 1 < argc) {
+			port = atoi(argv[++i]);
+		}
+		else if (arg == "-matches" && i + 1 < argc) {
+			matchCount = atoi(argv[++i]);
+			matchCount = matchCount < 1 ? 1 : matchCount;
+		}
+		else if (arg == "-telemetry" && i + 1 < argc) {
+			telemetryPort = atoi(argv[++i]);
+		}
+		else if (arg == "-telemetrybind" && i + 1 < argc) {
+			telemetryAddress = argv[++i];
+		}
+		else if (arg == "-loadtest" && i + 1 < argc) {
+			loadTestBots = atoi(argv[++i]);
+		}
+		else if (arg == "-connect" && i + 1 < argc) {
+			connectAddress = argv[++i];
+		}
+		else if (arg == "-duration" && i + 1 < argc) {
+			loadTestDuration = (float)atof(argv[++i]);
+		}
+		else if (arg == "-record" && i + 1 < argc) {
+			recordFile = argv[++i];
+		}
+		else if (arg == "-playback" && i + 1 < argc) {
+			playbackFile = argv[++i];
+		}
+		else if (arg == "-speed" && i + 1 < argc) {
+			playbackSpeed = (float)atof(argv[++i]);
+		}
+		else if (arg == "-latency" && i + 1 < argc) {
+			conditions.latency = (float)atof(argv[++i]);
+		}
+		else if (arg == "-jitter" && i + 1 < argc) {
+			conditions.jitter = (float)atof(argv[++i]);
+		}
+		else if (arg == "-loss" && i + 1 < argc) {
+			conditions.loss = (float)atof(argv[++i]);
+		}
+		else if (arg == "-nocompress") {
+			NetworkBase::SetDefaultCompression(false); //has to match at both ends
+		}
+		else if (arg == "-noxor") {
+			xorSnapshots = false;
+		}
+		else if (arg == "-physicsbench") {
+			physicsBench = true;
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				benchCounts.emplace_back(atoi(argv[++i]));
+			}
+		}
+		else if (arg == "-rollbackcheck") {
+			rollbackCheck = true;
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				benchCounts.emplace_back(atoi(argv[++i]));
+			}
+		}
+		else if (arg == "-collisionbench") {
+			collisionBench = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				collisionCases = atoi(argv[++i]);
+			}
+		}
+		else if (arg == "-pathbench") {
+			pathBench = true;
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				mazeSizes.emplace_back(atoi(argv[++i]));
+			}
+		}
+		else if (arg == "-netbench") {
+			netBench = true;
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				string next = argv[++i];
+				if (isdigit((unsigned char)next[0])) {
+					benchCounts.emplace_back(atoi(next.c_str()));
+				}
+				else {
+					benchRecordings.emplace_back(next);
+				}
+			}
+		}
+		else if (arg == "-renderbench") {
+			renderBench = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				renderBlocks = atoi(argv[++i]);
+			}
+		}
+		else if (arg == "-soak") {
+			soakTest = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				soakMatches = atoi(argv[++i]);
+			}
+		}
+		else if (arg == "-soakbots" && i + 1 < argc) {
+			soakBots = atoi(argv[++i]);
+		}
+		else if (arg == "-matchlength" && i + 1 < argc) {
+			matchLength = (float)atof(argv[++i]);
+		}
+		else if (arg == "-clients" && i + 1 < argc) {
+			benchClients = atoi(argv[++i]);
+		}
+		else if (arg == "-queries" && i + 1 < argc) {
+			pathQueries = atoi(argv[++i]);
+		}
+		else if (arg == "-seed" && i + 1 < argc) {
+			benchSeed = (unsigned int)atoi(argv[++i]);
+		}
+		else if (arg == "-frames" && i + 1 < argc) {
+			benchFrames = atoi(argv[++i]);
+		}
+		else if (arg == "-fps" && i + 1 < argc) {
+			playingRate = (float)atof(argv[++i]);
+		}
+		else if (arg == "-menufps" && i + 1 < argc) {
+			menuRate = (float)atof(argv[++i]);
+		}
+		else if (arg == "-texturebudget" && i + 1 < argc) {
+			textureBudget = atoi(argv[++i]);
+		}
+		else if (arg == "-convertmeshes") {
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				meshesToConvert.emplace_back(argv[++i]);
+			}
+		}
+		else if (arg == "-converttextures") {
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				texturesToConvert.emplace_back(argv[++i]);
+			}
+		}
+		else if (arg == "-convertlevels") {
+			while (i + 1 < argc && argv[i + 1][0] != '-') {
+				levelsToConvert.emplace_back(argv[++i]);
+			}
+		}
+		else if (arg == "-packassets") {
+			packAssets = true;
+		}
+	}
+	//-convertmeshes a.msh b.msh ... writes a binary copy of each, and
+	//-converttextures a.png b.tga ... a compressed one, and -convertlevels
+	//LevelData.txt ... a baked one, and -packassets packs everything into
+	//Assets.pak, after anything else has been converted, then quits
+	if (!meshesToConvert.empty() || !texturesToConvert.empty() || !levelsToConvert.empty() || packAssets) {
+		int failed = 0;
+		for (const string& m : meshesToConvert) {
+			failed += MeshGeometry::ConvertToBinary(m) ? 0 : 1;
+		}
+		for (const string& t : texturesToConvert) {
+			failed += TextureLoader::ConvertToCompressed(t) ? 0 : 1;
+		}
+		for (const string& l : levelsToConvert) {
+			failed += LevelData::ConvertToBinary(l) ? 0 : 1;
+		}
+		if (packAssets) {
+			failed += AssetArchive::Pack(Assets::ASSETROOT + "Assets.pak", { "Meshes", "Textures", "Audio", "Shaders", "Fonts", "Data" }) ? 0 : 1;
+		}
+		return failed;
+	}
+	//Anything that isn't packed is still loaded loose, so it's fine if there's no archive
+	AssetArchive::Mount(Assets::ASSETROOT + "Assets.pak");
+	if (collisionBench) {
+		return RunCollisionBenchmark(collisionCases, benchSeed);
+	}
+	if (netBench) {
+		return RunSnapshotBenchmark(benchCounts, benchRecordings, benchClients, benchFrames);
+	}
+	if (pathBench) {
+		return RunPathfindingBenchmark(mazeSizes, pathQueries, benchSeed);
+	}
+	if (physicsBench) {
+		return RunPhysicsBenchmark(benchCounts, benchFrames);
+	}
+	if (rollbackCheck) {
+		return RunRollbackCheck(benchCounts);
+	}
+	if (server && matchCount > 1) {
+		return RunMatchHost(matchCount, port, startPlayers, maxPlayers, conditions, xorSnapshots, telemetryPort, telemetryAddress);
+	}
+	if (server) {
+		return RunHeadlessServer(port, startPlayers, maxPlayers, conditions, recordFile, xorSnapshots, telemetryPort, telemetryAddress);
+	}
+	if (loadTestBots > 0) {
+		return RunLoadTest(loadTestBots, connectAddress, port, matchCount, loadTestDuration);
+	}
+
 	Window*w = Window::CreateGameWindow("CSC8503 Game technology!", 1920, 1080);
 	SoundSystem::Initialise();
+	JobSystem::Initialise();
 	
 	//Testing Network Integration with new functions added
 	//TestNetworking();
@@ -58,7 +567,45 @@ int main() {
 	w->LockMouseToWindow(true);
 	w->SetFullScreen(true);
 	
-	NetworkedGame* g = new NetworkedGame();
+	//-renderbench [blocks] flies a camera through a stress scene instead,
+	//writing each frame's times and draw counts to RenderBenchmark.csv.
+	//-soak [matches] plays that many matches back to back (0 for as many
+	//as it'll go), every other one hosted for -soakbots bots if there are
+	//any, each -matchlength seconds long, writing a row a match of frame
+	//times, peak memory and what's left afterwards to SoakTest.csv
+	Game* g = nullptr;
+	if (renderBench) {
+		g = new RenderBenchmark(renderBlocks);
+	}
+	else if (soakTest) {
+		SoakTest* soak = new SoakTest(soakMatches, soakBots, matchLength);
+		soak->SetSnapshotXor(xorSnapshots);
+		soak->SetServerPort(port);
+		g = soak;
+	}
+	else {
+		NetworkedGame* game = new NetworkedGame();
+		game->SetSnapshotXor(xorSnapshots);
+		if (!playbackFile.empty()) {
+			game->StartPlayback(playbackFile, playbackSpeed);
+		}
+		g = game;
+	}
+	//-texturebudget is in MB, for the streamed textures' mips, on GPUs with less to spare
+	if (textureBudget >= 0) {
+		g->SetTextureBudget((size_t)textureBudget * 1024 * 1024);
+	}
+	//-fps caps the frame rate while playing (0, the default, leaves it as fast as it'll
+	//go), and -menufps in the menus, lobby and pause screen, which otherwise run at 30
+	FramePacer pacer;
+	if (playingRate >= 0.0f) {
+		pacer.SetTargetRate(Game::State::PLAYING, playingRate);
+	}
+	if (menuRate >= 0.0f) {
+		pacer.SetTargetRate(Game::State::MAIN_MENU, menuRate);
+		pacer.SetTargetRate(Game::State::PAUSED, menuRate);
+		pacer.SetTargetRate(Game::State::WAITING, menuRate);
+	}
 	w->GetTimer()->GetTimeDeltaSeconds(); //Clear the timer so we don't get a large first dt!
 	while (g->IsPlaying() && w->UpdateWindow() && !Window::GetKeyboard()->KeyDown(KeyboardKeys::DELETEKEY)) {
 		float dt = w->GetTimer()->GetTimeDeltaSeconds();
@@ -77,15 +624,21 @@ int main() {
 			w->SetWindowPosition(0, 0);
 		}
 	
+		FrameProfiler::BeginFrame();
 		g->UpdateGame(dt);
+		FrameProfiler::EndFrame();
 	
 		w->SetTitle("Gametech frame time:" + std::to_string(1000.0f * dt));
 	
 		//DisplayPathfinding();
+
+		//Waiting here, after the frame's gone up, means the input's read just before the next one
+		pacer.Wait(g->GetState());
 	
 	}
+	SoundSystem::Destroy(); //stops the mixer before the sounds it's playing go
 	Sound::DeleteSounds();
-	SoundSystem::Destroy();
+	JobSystem::Destroy();
 	
 	Window::DestroyGameWindow();
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "MatchHost.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace NCL;
+using namespace CSC8503;
+
+MatchHost::MatchHost(int workerCount) {
+	if (workerCount <= 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 0 ? (int)hardwareThreads : 1;
+	}
+	this->workerCount	= workerCount;
+	telemetryPort		= 0;
+	runningWorkers		= 0;
+}
+
+MatchHost::~MatchHost() {
+	for (Match& m : matches) {
+		delete m.game;
+	}
+	for (MatchTelemetry* t : telemetry) {
+		delete t;
+	}
+}
+
+void MatchHost::AddMatch(int port, int startPlayers, int maxPlayers, bool xorSnapshots, const NetworkConditions& conditions) {
+	NetworkedGame* g = new NetworkedGame(true);
+	g->SetMaxPlayers(maxPlayers);
+	g->SetServerPort(port);
+	g->SetSnapshotXor(xorSnapshots);
+	g->StartHeadlessServer(startPlayers);
+	g->GetNetworkBase()->SetSimulatedConditions(conditions, conditions);
+	MatchTelemetry* t = new MatchTelemetry();
+	telemetry.emplace_back(t);
+	matches.push_back({ g, t, port });
+}
+
+void MatchHost::Run(float tickDT) {
+	int workers = workerCount < (int)matches.size() ? workerCount : (int)matches.size();
+
+	std::vector<std::vector<Match>> dealt(workers);
+	for (int i = 0; i < (int)matches.size(); ++i) {
+		dealt[i % workers].push_back(matches[i]);
+	}
+	matches.clear(); //the workers delete them as they finish
+
+	runningWorkers = workers;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < workers; ++i) {
+		threads.emplace_back(&MatchHost::RunWorker, this, i, std::move(dealt[i]), tickDT);
+	}
+	if (telemetryPort > 0) {
+		ServeTelemetry(tickDT);
+	}
+	for (std::thread& t : threads) {
+		t.join();
+	}
+}
+
+/*
+The same fixed tick as a single server, but for every match the worker
+has. The tick times reported are for all of them together, as that's
+what decides whether the worker can keep up.
+*/
+void MatchHost::RunWorker(int index, std::vector<Match> workerMatches, float tickDT) {
+	PinToCore(index);
+
+	const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(tickDT));
+	auto nextTick = std::chrono::steady_clock::now();
+
+	const int reportTicks = 300;
+	int ticks			= 0;
+	double tickTotal	= 0.0;
+	double tickMax		= 0.0;
+
+	while (!workerMatches.empty()) {
+		auto tickStart = std::chrono::steady_clock::now();
+		for (auto i = workerMatches.begin(); i != workerMatches.end(); ) {
+			i->telemetry->BeginTick();
+			i->game->UpdateGame(tickDT);
+			i->telemetry->EndTick(*i->game);
+			if (!i->game->IsPlaying()) {
+				{
+					std::lock_guard<std::mutex> lock(reportMutex);
+					std::cout << "Match on port " << i->port << " has finished" << std::endl;
+				}
+				i->telemetry->SetFinished();
+				delete i->game;
+				i = workerMatches.erase(i);
+			}
+			else {
+				++i;
+			}
+		}
+		double tickTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
+
+		tickTotal	+= tickTime;
+		tickMax		= tickTime > tickMax ? tickTime : tickMax;
+		if (++ticks == reportTicks) {
+			float bytesOut = 0.0f;
+			for (Match& m : workerMatches) {
+				bytesOut += m.game->GetNetworkBase()->GetStatistics().GetWireBytesOutPerSecond();
+			}
+			std::lock_guard<std::mutex> lock(reportMutex);
+			std::cout << std::fixed << std::setprecision(2) << "Worker " << index << ", " << workerMatches.size()
+				<< " matches: tick avg " << tickTotal / ticks << "ms, max " << tickMax << "ms, out "
+				<< bytesOut / 1024.0f << "KB/s on the wire" << std::endl;
+			ticks		= 0;
+			tickTotal	= 0.0;
+			tickMax		= 0.0;
+		}
+
+		nextTick += tickLength;
+		auto now = std::chrono::steady_clock::now();
+		if (now - nextTick > std::chrono::milliseconds(250)) {
+			std::lock_guard<std::mutex> lock(reportMutex);
+			std::cout << "Worker " << index << " running behind, skipping ticks" << std::endl;
+			nextTick = now;
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+	runningWorkers--;
+}
+
+//Scrapes are a few times a minute at most, so there's no hurry getting to them
+void MatchHost::ServeTelemetry(float tickDT) {
+	TelemetryServer server(telemetryPort, telemetryAddress);
+	if (!server.IsListening()) {
+		return;
+	}
+	std::cout << "Serving telemetry on " << telemetryAddress << ":" << telemetryPort << std::endl;
+	const float budget = tickDT * 1000.0f;
+	const auto wait = std::chrono::milliseconds(50);
+	while (runningWorkers > 0) {
+		server.Update(0.05f, [&](std::string& page) {
+			MatchTelemetry::WritePage(telemetry, page, budget);
+		});
+		std::this_thread::sleep_for(wait);
+	}
+}
+
+//Keeps each match's data in the one core's cache, rather than following the thread about
+void MatchHost::PinToCore(int index) {
+#ifdef _WIN32
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (cores > 0 && cores <= sizeof(DWORD_PTR) * 8) {
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (index % cores));
+	}
+#endif
+}
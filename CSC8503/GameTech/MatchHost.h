@@ -0,0 +1,78 @@
+#pragma once
+#include "NetworkedGame.h"
+#include "MatchTelemetry.h"
+#include "../CSC8503Common/TelemetryServer.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Runs lots of headless matches in the one process, rather than one
+		process per match. Each match is a NetworkedGame of its own - its
+		own GameWorld, PhysicsSystem and ENet host, bound to its own port -
+		so they share very little but the process.
+
+		Matches are dealt out between the worker threads when Run starts,
+		and then never move, so a match is only ever touched by the one
+		thread. What's shared by the whole process is either locked (the
+		component and memory pools, and the profiler), only written before
+		Run (the network types), or not there at all for headless games
+		(Debug) - systems have to keep to their own match's objects, and
+		never walk a pool's every component. Each worker ticks all of
+		its matches in turn at the fixed tick rate, and is kept to a core
+		of its own where the OS lets us. The JobSystem isn't started, as
+		the matches already keep every core busy - everything that would
+		use it just does the work on the match's own thread instead.
+
+		With a telemetry port, every match's numbers are served from the one
+		TelemetryServer, by the thread that called Run, which has nothing
+		else to do while the workers are busy. Each match's MatchTelemetry
+		is only ticked by its own worker, and outlives it, so a match that's
+		finished still shows up as finished until everything has.
+		*/
+		class MatchHost {
+		public:
+			//0 workers will use one for each core
+			MatchHost(int workerCount = 0);
+			~MatchHost();
+
+			//Only before Run, as the matches are all set up on the calling thread
+			void AddMatch(int port, int startPlayers, int maxPlayers, bool xorSnapshots, const NetworkConditions& conditions);
+
+			//Doesn't return until every match has finished
+			void Run(float tickDT);
+
+			//Only before Run, and 0 for none
+			void SetTelemetryPort(int port, const std::string& bindAddress = TelemetryServer::DefaultAddress) {
+				telemetryPort		= port;
+				telemetryAddress	= bindAddress;
+			}
+
+			int GetMatchCount() const {
+				return (int)matches.size();
+			}
+
+		protected:
+			struct Match {
+				NetworkedGame*	game;
+				MatchTelemetry*	telemetry;
+				int				port;
+			};
+
+			void RunWorker(int index, std::vector<Match> workerMatches, float tickDT);
+			static void PinToCore(int index);
+
+			void ServeTelemetry(float tickDT);
+
+			std::vector<Match>	matches;
+			std::vector<MatchTelemetry*> telemetry;
+			int					workerCount;
+			int					telemetryPort;
+			std::string			telemetryAddress;
+			std::atomic<int>	runningWorkers;
+			std::mutex			reportMutex; //so the workers' reports don't end up mixed together
+		};
+	}
+}
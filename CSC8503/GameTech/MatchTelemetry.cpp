@@ -0,0 +1,240 @@
+#include "MatchTelemetry.h"
+#include "NetworkedGame.h"
+#include "../CSC8503Common/NetworkBase.h"
+#include "../../Common/MemoryTracker.h"
+
+#include <sstream>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//In the same order as Game::State
+	const char* StateNames[] = { "playing", "paused", "waiting", "loading", "main_menu" };
+	const int StateCount = sizeof(StateNames) / sizeof(StateNames[0]);
+}
+
+MatchTelemetry::MatchTelemetry(bool wholeProcess) {
+	this->wholeProcess	= wholeProcess;
+	startAllocations	= 0;
+	startBytes			= 0;
+	nextTick			= 0;
+	ticks				= 0;
+	sectionTicks		= 0;
+	network				= 0.0;
+	physics				= 0.0;
+	world				= 0.0;
+	ai					= 0.0;
+	allocations			= 0;
+	allocatedBytes		= 0;
+	tickTimes.reserve(TickHistory);
+	sorted.reserve(TickHistory);
+}
+
+void MatchTelemetry::BeginTick() {
+	MemoryTracker::AllocationCounts counts = wholeProcess ? MemoryTracker::GetTotalAllocations() : MemoryTracker::GetThreadAllocations();
+	startAllocations	= counts.allocations;
+	startBytes			= counts.bytes;
+	tickStart			= std::chrono::steady_clock::now();
+}
+
+void MatchTelemetry::EndTick(const NetworkedGame& game) {
+	float tickTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
+	MemoryTracker::AllocationCounts counts = wholeProcess ? MemoryTracker::GetTotalAllocations() : MemoryTracker::GetThreadAllocations();
+
+	if ((int)tickTimes.size() < TickHistory) {
+		tickTimes.emplace_back(tickTime);
+	}
+	else {
+		tickTimes[nextTick] = tickTime;
+	}
+	nextTick = (nextTick + 1) % TickHistory;
+	ticks++;
+
+	const NetworkedGame::TickTimes& sections = game.GetTickTimes();
+	network			+= sections.network;
+	physics			+= sections.physics;
+	world			+= sections.world;
+	ai				+= sections.ai;
+	allocations		+= counts.allocations - startAllocations;
+	allocatedBytes	+= counts.bytes - startBytes;
+	if (++sectionTicks >= PublishTicks) {
+		Publish(game);
+	}
+}
+
+void MatchTelemetry::SetFinished() {
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	snapshot.finished = true;
+}
+
+float MatchTelemetry::Percentile(float p) {
+	if (sorted.empty()) {
+		return 0.0f;
+	}
+	auto i = sorted.begin() + (size_t)((sorted.size() - 1) * p);
+	std::nth_element(sorted.begin(), i, sorted.end());
+	return *i;
+}
+
+/*
+Everything's worked out before the lock's taken, so all the match has to
+wait on is the copy - and a page being written is only ever a copy too.
+*/
+void MatchTelemetry::Publish(const NetworkedGame& game) {
+	Snapshot s;
+	s.published	= true;
+	s.port		= game.GetServerPort();
+	s.state		= (int)game.GetState();
+	s.timeLeft	= game.GetTimeLeft();
+	s.ticks		= ticks;
+
+	sorted.assign(tickTimes.begin(), tickTimes.end());
+	s.tickP50	= Percentile(0.5f);
+	s.tickP95	= Percentile(0.95f);
+	s.tickP99	= Percentile(0.99f);
+	s.tickMax	= Percentile(1.0f);
+
+	float perTick		= 1.0f / (float)sectionTicks;
+	s.network			= (float)network * perTick;
+	s.physics			= (float)physics * perTick;
+	s.world				= (float)world * perTick;
+	s.ai				= (float)ai * perTick;
+	s.allocations		= (float)allocations * perTick;
+	s.allocatedBytes	= (float)allocatedBytes * perTick;
+
+	s.clients	= game.GetClientCount();
+	s.players	= game.GetPlayerCount();
+	s.objects	= game.GetObjectCount();
+	if (NetworkBase* base = game.GetNetworkBase()) {
+		const NetworkStatistics& stats = base->GetStatistics();
+		s.wireIn	= stats.GetWireBytesInPerSecond();
+		s.wireOut	= stats.GetWireBytesOutPerSecond();
+		for (const auto& p : stats.GetPeers()) {
+			s.peers.push_back({ p.first, p.second.roundTripTime, p.second.packetLoss, p.second.traffic.bytesIn, p.second.traffic.bytesOut });
+		}
+	}
+
+	sectionTicks	= 0;
+	network			= 0.0;
+	physics			= 0.0;
+	world			= 0.0;
+	ai				= 0.0;
+	allocations		= 0;
+	allocatedBytes	= 0;
+
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	s.finished	= snapshot.finished;
+	snapshot	= std::move(s);
+}
+
+/*
+Each metric's samples have to be together, under the one HELP and TYPE,
+so the snapshots are all copied out first, and then gone through once
+for each. A match that hasn't published yet is left out altogether, and
+a finished one only says that it's finished - its last numbers would
+just look like a server that's stopped dead.
+*/
+void MatchTelemetry::WritePage(const std::vector<MatchTelemetry*>& matches, std::string& page, float tickBudgetMs) {
+	std::vector<Snapshot> snapshots;
+	snapshots.reserve(matches.size());
+	for (MatchTelemetry* m : matches) {
+		std::lock_guard<std::mutex> lock(m->snapshotMutex);
+		if (m->snapshot.published) {
+			snapshots.emplace_back(m->snapshot);
+		}
+	}
+
+	std::ostringstream out;
+	auto header = [&](const char* name, const char* type, const char* help) {
+		out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+	};
+	auto live = [&](const std::string& name, float(*value)(const Snapshot&)) {
+		for (const Snapshot& s : snapshots) {
+			if (!s.finished) {
+				out << name << "{port=\"" << s.port << "\"} " << value(s) << "\n";
+			}
+		}
+	};
+
+	header("server_tick_budget_ms", "gauge", "How long a tick has, at the fixed tick rate");
+	out << "server_tick_budget_ms " << tickBudgetMs << "\n";
+
+	header("server_ticks_total", "counter", "Ticks since the match started");
+	for (const Snapshot& s : snapshots) {
+		out << "server_ticks_total{port=\"" << s.port << "\"} " << s.ticks << "\n";
+	}
+
+	header("server_tick_ms", "gauge", "Tick time percentiles over the last ten seconds");
+	for (const Snapshot& s : snapshots) {
+		if (s.finished) {
+			continue;
+		}
+		out << "server_tick_ms{port=\"" << s.port << "\",quantile=\"0.5\"} " << s.tickP50 << "\n";
+		out << "server_tick_ms{port=\"" << s.port << "\",quantile=\"0.95\"} " << s.tickP95 << "\n";
+		out << "server_tick_ms{port=\"" << s.port << "\",quantile=\"0.99\"} " << s.tickP99 << "\n";
+		out << "server_tick_ms{port=\"" << s.port << "\",quantile=\"1\"} " << s.tickMax << "\n";
+	}
+
+	header("server_tick_section_ms", "gauge", "Mean time per tick spent on each part of it, over the last second");
+	for (const Snapshot& s : snapshots) {
+		if (s.finished) {
+			continue;
+		}
+		out << "server_tick_section_ms{port=\"" << s.port << "\",section=\"network\"} " << s.network << "\n";
+		out << "server_tick_section_ms{port=\"" << s.port << "\",section=\"physics\"} " << s.physics << "\n";
+		out << "server_tick_section_ms{port=\"" << s.port << "\",section=\"world\"} " << s.world << "\n";
+		out << "server_tick_section_ms{port=\"" << s.port << "\",section=\"ai\"} " << s.ai << "\n";
+	}
+
+	header("server_clients", "gauge", "Connected clients");
+	live("server_clients", [](const Snapshot& s) { return (float)s.clients; });
+	header("server_players", "gauge", "Clients that have a player in the match");
+	live("server_players", [](const Snapshot& s) { return (float)s.players; });
+	header("server_objects", "gauge", "Objects in the world");
+	live("server_objects", [](const Snapshot& s) { return (float)s.objects; });
+
+	header("server_wire_bytes_in_per_second", "gauge", "Received, as ENet sent it");
+	live("server_wire_bytes_in_per_second", [](const Snapshot& s) { return s.wireIn; });
+	header("server_wire_bytes_out_per_second", "gauge", "Sent, after compression and with ENet's own headers");
+	live("server_wire_bytes_out_per_second", [](const Snapshot& s) { return s.wireOut; });
+
+	header("server_allocations_per_tick", "gauge", "Heap allocations per tick, over the last second");
+	live("server_allocations_per_tick", [](const Snapshot& s) { return s.allocations; });
+	header("server_allocated_bytes_per_tick", "gauge", "Bytes allocated per tick, over the last second");
+	live("server_allocated_bytes_per_tick", [](const Snapshot& s) { return s.allocatedBytes; });
+
+	auto peers = [&](const char* name, double(*value)(const PeerSnapshot&)) {
+		for (const Snapshot& s : snapshots) {
+			if (s.finished) {
+				continue;
+			}
+			for (const PeerSnapshot& p : s.peers) {
+				if (p.peer >= 0) { //the broadcasts aren't anyone's
+					out << name << "{port=\"" << s.port << "\",peer=\"" << p.peer << "\"} " << value(p) << "\n";
+				}
+			}
+		}
+	};
+	header("server_peer_rtt_ms", "gauge", "Each client's round trip time, as ENet measures it");
+	peers("server_peer_rtt_ms", [](const PeerSnapshot& p) { return (double)p.roundTripTime; });
+	header("server_peer_packet_loss", "gauge", "Fraction of each client's packets ENet thinks were lost");
+	peers("server_peer_packet_loss", [](const PeerSnapshot& p) { return (double)p.packetLoss; });
+	header("server_peer_bytes_in_total", "counter", "Game bytes received from each client");
+	peers("server_peer_bytes_in_total", [](const PeerSnapshot& p) { return (double)p.bytesIn; });
+	header("server_peer_bytes_out_total", "counter", "Game bytes sent to each client");
+	peers("server_peer_bytes_out_total", [](const PeerSnapshot& p) { return (double)p.bytesOut; });
+
+	header("server_match_state", "gauge", "1 for the state each match is in");
+	for (const Snapshot& s : snapshots) {
+		for (int i = 0; i < StateCount; ++i) {
+			out << "server_match_state{port=\"" << s.port << "\",state=\"" << StateNames[i] << "\"} " << (!s.finished && s.state == i ? 1 : 0) << "\n";
+		}
+		out << "server_match_state{port=\"" << s.port << "\",state=\"finished\"} " << (s.finished ? 1 : 0) << "\n";
+	}
+	header("server_match_time_left_seconds", "gauge", "Time left in the match");
+	live("server_match_time_left_seconds", [](const Snapshot& s) { return s.timeLeft; });
+
+	page = out.str();
+}
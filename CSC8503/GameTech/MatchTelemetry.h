@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class NetworkedGame;
+
+		/*
+		Keeps a headless match's numbers for the TelemetryServer to hand out:
+		how long its ticks have been taking, and on what, who's connected and
+		how well, how big the world is, and how much it's allocating. It's
+		only ever ticked by the thread running the match, with BeginTick and
+		EndTick either side of its UpdateGame, and every PublishTicks it
+		copies what it's got into a snapshot behind a lock - so pages can be
+		written from another thread, without the match waiting on anyone but
+		for that copy, once a second.
+
+		The tick percentiles are over the last TickHistory ticks, rather than
+		since the match began, so a server that's only just started falling
+		behind shows up straight away. With wholeProcess, the allocations are
+		everyone's, jobs included, which is right when there's only the one
+		match - otherwise they're only the match's own thread.
+		*/
+		class MatchTelemetry {
+		public:
+			MatchTelemetry(bool wholeProcess = false);
+			~MatchTelemetry() {}
+
+			void BeginTick();
+			void EndTick(const NetworkedGame& game);
+
+			//Once the match has been deleted - it keeps its last numbers, and says it's over
+			void SetFinished();
+
+			//Prometheus' plain text, for every match, with a port label to tell them apart
+			static void WritePage(const std::vector<MatchTelemetry*>& matches, std::string& page, float tickBudgetMs);
+
+			static const int TickHistory	= 600;	//10 seconds
+			static const int PublishTicks	= 60;
+
+		protected:
+			struct PeerSnapshot {
+				int			peer;
+				float		roundTripTime;	//ms
+				float		packetLoss;
+				uint64_t	bytesIn;
+				uint64_t	bytesOut;
+			};
+
+			struct Snapshot {
+				bool		published		= false;
+				bool		finished		= false;
+				int			port			= 0;
+				int			state			= 0;
+				float		timeLeft		= 0.0f;
+				uint64_t	ticks			= 0;
+
+				float		tickP50			= 0.0f;
+				float		tickP95			= 0.0f;
+				float		tickP99			= 0.0f;
+				float		tickMax			= 0.0f;
+				float		network			= 0.0f; //the sections' means, since the last snapshot
+				float		physics			= 0.0f;
+				float		world			= 0.0f;
+				float		ai				= 0.0f;
+
+				int			clients			= 0;
+				int			players			= 0;
+				int			objects			= 0;
+				float		wireIn			= 0.0f; //bytes a second
+				float		wireOut			= 0.0f;
+				float		allocations		= 0.0f; //per tick
+				float		allocatedBytes	= 0.0f;
+				std::vector<PeerSnapshot> peers;
+			};
+
+			void Publish(const NetworkedGame& game);
+			float Percentile(float p);
+
+			bool		wholeProcess;
+			std::chrono::steady_clock::time_point tickStart;
+			uint64_t	startAllocations;
+			uint64_t	startBytes;
+
+			std::vector<float>	tickTimes;	//a ring of the last TickHistory
+			std::vector<float>	sorted;		//kept, so it isn't reallocated every snapshot
+			int			nextTick;
+			uint64_t	ticks;
+
+			//Since the last snapshot
+			int			sectionTicks;
+			double		network;
+			double		physics;
+			double		world;
+			double		ai;
+			uint64_t	allocations;
+			uint64_t	allocatedBytes;
+
+			mutable std::mutex	snapshotMutex;
+			Snapshot			snapshot;
+		};
+	}
+}
@@ -12,19 +12,12 @@ namespace NCL {
 			NetworkColourBlock(int id, NetworkedGame* g) : networkID(id), game(g) {};
 			~NetworkColourBlock() {};
 
-			void OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) override {
-				cout << "Worked" << endl;
-				if (otherObject->GetName() == "Projectile") {
-					NetworkProjectile* p = static_cast<NetworkProjectile*>(otherObject);
-					coloured = p->IsColoured();
-					game->OnWallBlockColoured(networkID, p->GetRenderObject()->GetColour(), coloured);
-				}
+			//The server sends the change out, and only fades it once it's been told
+			void Paint(bool colourPaint, const Vector4& colour) override {
+				SetColoured(colourPaint);
+				game->OnWallBlockColoured(networkID, colour, coloured);
 			};
 
-			void SetColoured(bool c) {
-				coloured = c;
-			}
-
 			int GetNetworkID() const { return networkID; }
 
 		protected:
@@ -7,6 +7,7 @@ using namespace CSC8503;
 NetworkPlayer::NetworkPlayer(NetworkedGame* game, int num) {
 	this->game = game;
 	playerNum = num;
+	typeID = ObjectType::NetworkPlayer;
 }
 
 NetworkPlayer::~NetworkPlayer() {
@@ -15,7 +16,7 @@ NetworkPlayer::~NetworkPlayer() {
 
 void NetworkPlayer::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
 	if (game) {
-		if (dynamic_cast<NetworkPlayer*>(otherObject))
+		if (otherObject->GetTypeID() == ObjectType::NetworkPlayer)
 		{
 			game->OnPlayerCollision(this, (NetworkPlayer*)otherObject);
 		}
@@ -1,6 +1,7 @@
 #pragma once
 #include "..\CSC8503Common\GameObject.h"
 #include "..\CSC8503Common\GameClient.h"
+#include "ObjectType.h"
 
 namespace NCL {
 	namespace CSC8503 {
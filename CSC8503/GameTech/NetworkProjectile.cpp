@@ -11,19 +11,22 @@ void NCL::CSC8503::NetworkProjectile::Update(float dt) {
 
 void NCL::CSC8503::NetworkProjectile::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
 	int hitPlayerID = -1;
-	if (otherObject->GetName() == "Player" || otherObject->GetName() == "Opponent" || otherObject->GetName() == "Agent") {
+	if (ObjectType::IsAgent(otherObject->GetTypeID())) {
 		hitPlayerID = ((Agent*)otherObject)->GetID();
 	}
-	else if (otherObject->GetName() == "Colour Block") {
+	else if (otherObject->GetTypeID() == ObjectType::ColourBlock) {
 		((ColourBlock*)otherObject)->StartFade(renderObject->GetColour());
 	}
 
-	bool paintSplat = otherObject->GetName() != "Player" && otherObject->GetName() != "Opponent" && otherObject->GetName() != "Agent" && otherObject->GetName() != "Refill Point";
+	bool paintSplat = !ObjectType::IsAgent(otherObject->GetTypeID()) && otherObject->GetTypeID() != ObjectType::RefillPoint;
 	if (paintSplat) {
-		level->AddPaintSplat(transform.GetPosition(), point.penetration, point.normal)->GetRenderObject()->SetColour(renderObject->GetColour());
+		level->AddPaintSplat(transform.GetPosition(), point.normal, renderObject->GetColour());
+		PaintSplash(otherObject);
 	}
 
-	SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("paintsplat.wav"), transform.GetPosition(), 150);
+	if (SoundSystem::GetSoundSystem()) {
+		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("paintsplat.wav"), transform.GetPosition(), 150);
+	}
 	game->OnProjectileDestroyed(networkID, transform.GetPosition(), point.normal, point.penetration, paintSplat, hitPlayerID);
 	Remove();
 }
@@ -8,7 +8,9 @@ namespace NCL {
 
 		class NetworkProjectile : public Projectile {
 		public:
-			NetworkProjectile(int id, NetworkedGame* g, LevelManager* level, GameWorld* gw, bool colourProjectile) : networkID(id), game(g), Projectile(gw, level, colourProjectile) {};
+			NetworkProjectile(int id, NetworkedGame* g, LevelManager* level, GameWorld* gw, bool colourProjectile) : networkID(id), game(g), Projectile(gw, level, colourProjectile) {
+				parallelUpdate = false; //it tells the game when it runs out of time, which has to be on the main thread
+			};
 			~NetworkProjectile() {};
 
 			void Update(float dt) override;
@@ -17,9 +19,33 @@ namespace NCL {
 
 			int GetNetworkID() const { return networkID; }
 
+			//On the server, hits on players are found by the game, against where
+			//they were when the shot was fired, rather than by the physics - so
+			//it's put on a layer that doesn't collide with them at all
+			void SetShooter(int playerID, float rewind) {
+				shooterID		= playerID;
+				rewindSnapshots = rewind;
+				lastPosition	= transform.GetPosition();
+				SetLayer(CollisionLayer::PROJECTILE);
+			}
+
+			int GetShooterID() const { return shooterID; }
+			float GetRewind() const { return rewindSnapshots; }
+
+			//Where it was the last time it was checked for hits, so the whole path in between can be tested
+			Vector3 SweepFrom() {
+				Vector3 from = lastPosition;
+				lastPosition = transform.GetPosition();
+				return from;
+			}
+
 		protected:
 			NetworkedGame* game;
 			int networkID;
+
+			int shooterID = -1;
+			float rewindSnapshots = 0.0f;
+			Vector3 lastPosition;
 		};
 	}
 }
\ No newline at end of file
@@ -11,10 +11,12 @@ void NCL::CSC8503::NetworkRefillPoint::Update(float dt) {
 }
 
 void NCL::CSC8503::NetworkRefillPoint::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (serverSide && otherObject->GetName() == "Agent") {
+	if (serverSide && otherObject->GetTypeID() == ObjectType::Agent) {
 		Deactivate(((Agent*) otherObject)->GetID());
 		cooldownTimer = 0;
-		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("powerup.wav"), transform.GetPosition(), 100);
+		if (SoundSystem::GetSoundSystem()) {
+			SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("powerup.wav"), transform.GetPosition(), 100);
+		}
 	}
 }
 
@@ -22,6 +24,7 @@ void NCL::CSC8503::NetworkRefillPoint::Activate() {
 	GetRenderObject()->SetColour(Vector4(0, 1, 0, 1));
 	SetLayer(CollisionLayer::DEFAULT);
 	isActive = true;
+	UpdateLight();
 	if (serverSide) game->OnRefillPointStateChanged(networkID, true);
 }
 
@@ -29,5 +32,6 @@ void NCL::CSC8503::NetworkRefillPoint::Deactivate(int collectedPlayerID) {
 	GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
 	SetLayer(CollisionLayer::IGNORE_DEFAULT);
 	isActive = false;
+	UpdateLight();
 	if (serverSide) game->OnRefillPointStateChanged(networkID, false, collectedPlayerID);
 }
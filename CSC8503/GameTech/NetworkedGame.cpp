@@ -5,6 +5,13 @@
 #include "NetworkRefillPoint.h"
 #include "../CSC8503Common/GameServer.h"
 #include "../CSC8503Common/GameClient.h"
+#include "../CSC8503Common/BitStream.h"
+#include "../CSC8503Common/PathQueryService.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Common/Assets.h"
+#include <algorithm>
+#include <chrono>
 
 #define COLLISION_MSG 30
 
@@ -18,13 +25,39 @@ struct MessagePacket : public GamePacket {
 	}
 };
 
-NetworkedGame::NetworkedGame() {
+NetworkedGame::NetworkedGame(bool headless) : Game(headless) {
 	thisServer = nullptr;
 	thisClient = nullptr;
 	online = true;
-	playerPacketID = 0;
+	lastSnapshotID = -1;
+	baselineLost = false;
+	receivingSnapshotID = -1;
+	renderSnapshot = -1.0f;
+
+	//The server's projectiles hit players by where they were when they were
+	//fired at, not by the physics, so they go straight through them
+	world->AddCollisionIgnore(CollisionLayer::PROJECTILE, CollisionLayer::PLAYER);
+	world->AddCollisionIgnore(CollisionLayer::IGNORE_DEFAULT, CollisionLayer::PLAYER); //so used refill points let them through
 
 	NetworkBase::Initialise();
+	RegisterNetworkTypes();
+}
+
+/*
+Agents are the only things with a player ID to send. Projectiles are
+spheres, so their orientation isn't worth sending, and blocks and refill
+points never move - what changes about them goes in their own events, and
+the world state, rather than the snapshots.
+*/
+void NetworkedGame::RegisterNetworkTypes() {
+	using namespace ReplicatedFields;
+	auto agentID = [](const GameObject& o) { return static_cast<const Agent&>(o).GetID(); };
+	NetworkTypes::Register<Orientation | PlayerID>(ObjectType::Agent, agentID);
+	NetworkTypes::Register<Orientation | PlayerID>(ObjectType::Player, agentID);
+	NetworkTypes::Register<Orientation | PlayerID>(ObjectType::Opponent, agentID);
+	NetworkTypes::Register<0>(ObjectType::Projectile);
+	NetworkTypes::Register<0>(ObjectType::ColourBlock);
+	NetworkTypes::Register<0>(ObjectType::RefillPoint);
 }
 
 NetworkedGame::~NetworkedGame() {
@@ -33,30 +66,100 @@ NetworkedGame::~NetworkedGame() {
 }
 
 void NetworkedGame::StartAsServer() {
-	thisServer = new GameServer(NetworkBase::GetDefaultPort(), 4);
+	thisServer = new GameServer(serverPort, maxPlayers);
 
-	thisServer->RegisterPacketHandler(Received_State, this);
+	thisServer->RegisterPacketHandler<ClientPacket>(Received_State, [this](ClientPacket& p, int) { ReceiveClientPacket(p); });
+	thisServer->RegisterPacketHandler<ResyncRequestPacket>(Resync_Request, [this](ResyncRequestPacket& p, int) { ReceiveResyncRequest(p); });
+	thisServer->StartNetworkThread();
+	Debug::SetNetworkStatistics(&thisServer->GetStatistics());
 }
 
 void NetworkedGame::StartAsClient(char a, char b, char c, char d) {
 	thisClient = new GameClient();
 	thisClient->Connect(a, b, c, d, NetworkBase::GetDefaultPort());
+	RegisterClientHandlers();
+	thisClient->StartNetworkThread();
+	Debug::SetNetworkStatistics(&thisClient->GetStatistics());
+}
 
-	thisClient->RegisterPacketHandler(Delta_State, this);
-	thisClient->RegisterPacketHandler(Full_State, this);
-	thisClient->RegisterPacketHandler(Player_Connected, this);
-	thisClient->RegisterPacketHandler(Player_Disconnected, this);
-	thisClient->RegisterPacketHandler(Player_ID, this);
-	thisClient->RegisterPacketHandler(Client_Start, this);
-	thisClient->RegisterPacketHandler(Disconnect_Confirmation, this);
-	thisClient->RegisterPacketHandler(New_Projectile, this);
-	thisClient->RegisterPacketHandler(Destroy_Projectile, this);
-	thisClient->RegisterPacketHandler(ColourBlockUpdate, this);
-	thisClient->RegisterPacketHandler(RefillPointUpdate, this);
-	thisClient->RegisterPacketHandler(Game_Timer, this);
+void NetworkedGame::RegisterClientHandlers() {
+	thisClient->RegisterPacketHandler<FullPacket>(Full_State, [this](FullPacket& p, int) { UpdateObjectState(&p); });
+	thisClient->RegisterPacketHandler<DeltaPacket>(Delta_State, [this](DeltaPacket& p, int) { UpdateObjectState(&p); });
+	thisClient->RegisterPacketHandler<SnapshotPacket>(Snapshot_State, [this](SnapshotPacket& p, int source) { ReceiveSnapshot(p, source); });
+	thisClient->RegisterPacketHandler<EventBatchPacket>(Event_Batch, [this](EventBatchPacket& p, int source) {
+		p.ForEachPacket([&](const GamePacket& e) {
+			thisClient->ProcessPacket((GamePacket*)&e, source);
+		});
+	});
+	thisClient->RegisterPacketHandler<WorldStatePacket>(World_State, [this](WorldStatePacket& p, int) { ReceiveWorldState(p); });
+	thisClient->RegisterPacketHandler<WorldHashPacket>(World_Hash, [this](WorldHashPacket& p, int) { ReceiveWorldHash(p); });
+	thisClient->RegisterPacketHandler<PlayerStatePacket>(Player_State, [this](PlayerStatePacket& p, int) { ReconcilePlayer(&p); });
+	//Other players turn up in the snapshots, so there's nothing to do for these yet
+	thisClient->RegisterPacketHandler<NewPlayerPacket>(Player_Connected, [](NewPlayerPacket&, int) {});
+	thisClient->RegisterPacketHandler<PlayerDisconnectPacket>(Player_Disconnected, [](PlayerDisconnectPacket&, int) {});
+	thisClient->RegisterPacketHandler<PlayerIDPacket>(Player_ID, [this](PlayerIDPacket& p, int) { ReceivePlayerID(p); });
+	thisClient->RegisterPacketHandler<ClientStartPacket>(Client_Start, [this](ClientStartPacket&, int) { ChangeState(State::PLAYING); });
+	//Only noted here, as this is running inside the client - it's deleted once UpdateClient's done with it
+	thisClient->RegisterPacketHandler<DisconnectConfirmPacket>(Disconnect_Confirmation, [this](DisconnectConfirmPacket& p, int) {
+		if (localPlayer && p.playerID == localPlayer->GetID()) {
+			disconnectConfirmed = true;
+		}
+	});
+	thisClient->RegisterPacketHandler<ProjectilePacket>(New_Projectile, [this](ProjectilePacket& p, int) { FireProjectile(&p); });
+	thisClient->RegisterPacketHandler<DestroyProjectilePacket>(Destroy_Projectile, [this](DestroyProjectilePacket& p, int) {
+		OnProjectileDestroyed(p.objectID,
+			Vector3(p.position[0], p.position[1], p.position[2]),
+			Vector3(p.normal[0], p.normal[1], p.normal[2]),
+			p.penetration,
+			p.paintSplat,
+			p.hitPlayerID
+		);
+	});
+	thisClient->RegisterPacketHandler<ColourBlockPacket>(ColourBlockUpdate, [this](ColourBlockPacket& p, int) {
+		OnWallBlockColoured(p.objectID, Vector4(p.colour[0], p.colour[1], p.colour[2], p.colour[3]), p.coloured);
+	});
+	thisClient->RegisterPacketHandler<RefillPointPacket>(RefillPointUpdate, [this](RefillPointPacket& p, int) {
+		OnRefillPointStateChanged(p.objectID, p.available, p.collectPlayerID);
+	});
+	thisClient->RegisterPacketHandler<GameTimerPacket>(Game_Timer, [this](GameTimerPacket& p, int) { ReceiveGameTimer(p); });
+}
+
+/*
+The client is never connected to anything - it's only there for its
+packet handlers, which the recording's packets are fed through as if
+they'd just arrived.
+*/
+void NetworkedGame::BeginPlayback() {
+	string filename = playbackFile;
+	playbackFile.clear();
+	if (!playback.Open(filename)) {
+		std::cout << "Couldn't open recording " << filename << std::endl;
+		return;
+	}
+	std::cout << "Playing back " << filename << ", " << playback.GetDuration() << "s long" << std::endl;
+	online = true;
+	thisClient = new GameClient();
+	RegisterClientHandlers();
+	Debug::SetNetworkStatistics(&thisClient->GetStatistics());
+	ChangeState(State::WAITING);
+}
+
+void NetworkedGame::StartHeadlessServer(int startPlayers) {
+	online = true;
+	headlessStartPlayers = startPlayers;
+	StartAsServer();
+	ChangeState(State::WAITING);
 }
 
 void NetworkedGame::UpdateGame(float dt) {
+	if (headless) {
+		UpdateHeadlessServer(dt);
+		return;
+	}
+
+	if (!playbackFile.empty() && activeState == State::MAIN_MENU) {
+		BeginPlayback();
+	}
 
 	if (thisServer) {
 		UpdateAsServer(dt);
@@ -69,12 +172,21 @@ void NetworkedGame::UpdateGame(float dt) {
 }
 
 void NCL::CSC8503::NetworkedGame::ChangeState(State newState) {
+	if (headless) { //no camera, UI or sound to sort out
+		if (newState == State::WAITING) {
+			InitWorld();
+		}
+		activeState = newState;
+		return;
+	}
 
 	SoundSystem::GetSoundSystem()->SetMasterVolume(1);
 
 	if (newState == State::MAIN_MENU) {
 		Reset();
 		world->ClearAndErase();
+		perception->Clear(); //nothing it knows about is there any more
+		soundOcclusion->Clear();
 		physics->Clear();
 		world->GetMainCamera()->SetYaw(105.0f);
 		world->GetMainCamera()->SetPitch(5.0f);
@@ -118,45 +230,207 @@ void NCL::CSC8503::NetworkedGame::ChangeState(State newState) {
 	activeState = newState;
 }
 
+/*
+Just the simulation and networking parts of a frame - nothing is drawn,
+and there's no UI to wait on, so the match starts as soon as there are
+enough players.
+*/
+void NetworkedGame::UpdateHeadlessServer(float dt) {
+	typedef std::chrono::steady_clock Clock;
+	auto since = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+	Clock::time_point start = Clock::now();
+	UpdateAsServer(dt);
+	tickTimes.network = since(start);
+
+	if (activeState == State::WAITING && nextPlayerID >= headlessStartPlayers) {
+		ChangeState(State::PLAYING);
+		thisServer->SendGlobalPacket(ClientStartPacket());
+	}
+	UpdateLevelStreaming();
+	tickTimes.physics = 0.0f;
+	if (activeState == State::PLAYING) {
+		gameTimer -= dt;
+		start = Clock::now();
+		physics->Update(dt);
+		tickTimes.physics = since(start);
+		if (gameTimer <= 0) {
+			gameOver = true;
+			DetermineWinners();
+			ChangeState(State::PAUSED);
+			isPlaying = false;
+		}
+	}
+	start = Clock::now();
+	world->UpdateWorld(dt);
+	tickTimes.world = since(start);
+
+	start = Clock::now();
+	if (mapGrid) {
+		mapGrid->GetQueries().Update();
+		mapGrid->UpdateFlowFields();
+	}
+	perception->Update(dt);
+	tickTimes.ai = since(start);
+	world->Prune();
+}
+
+int NetworkedGame::GetObjectCount() const {
+	return (int)world->GetGameObjects().size();
+}
+
+int NetworkedGame::GetClientCount() const {
+	return thisServer ? thisServer->GetClientCount() : 0;
+}
+
+int NetworkedGame::GetPlayerCount() const {
+	int count = 0;
+	for (Agent* a : serverPlayers) {
+		count += a ? 1 : 0;
+	}
+	return count;
+}
+
 void NCL::CSC8503::NetworkedGame::UpdateWaitingState(float dt) {
 	world->GetMainCamera()->SetYaw(world->GetMainCamera()->GetYaw() + 0.025f);
 	HandleUICommand();
 }
 
+/*
+Incoming packets are handled every frame, but the server's snapshots and
+the client's input only go out at their send rates. If a long frame puts
+us more than a whole send behind, the extra is dropped, rather than sending
+a burst of packets to catch up.
+*/
+bool NetworkedGame::NetworkTick(float dt, float sendDT) {
+	sendTimer += dt;
+	if (sendTimer < sendDT) {
+		return false;
+	}
+	sendTimer -= sendDT;
+	if (sendTimer > sendDT) {
+		sendTimer = 0.0f;
+	}
+	return true;
+}
+
 void NetworkedGame::UpdateAsServer(float dt) {
-	thisServer->UpdateServer();
-	BroadcastSnapshot(false);
+	ProfileScope scope("Network");
+	MemoryTagScope tag(MemoryTag::Network);
+	{
+		ProfileScope receive("Receive");
+		thisServer->UpdateServer();
+	}
+	thisServer->UpdateStatistics(dt);
+	UpdatePlayerInputs();
+	CheckRewoundHits();
+	if (NetworkTick(dt, serverSendDT)) {
+		ProfileScope send("Send");
+		FlushEvents();
+		BroadcastSnapshot(true);
+	}
 }
 
 void NetworkedGame::UpdateAsClient(float dt) {
+	ProfileScope scope("Network");
+	MemoryTagScope tag(MemoryTag::Network);
+	if (playback.IsOpen()) {
+		playback.Update(dt * playbackSpeed, [&](GamePacket* p) {
+			thisClient->GetStatistics().RecordIncoming(0, p->type, p->GetTotalSize());
+			thisClient->ProcessPacket(p);
+		});
+	}
+	else {
+		ProfileScope receive("Receive");
+		thisClient->UpdateClient();
+	}
+	if (disconnectConfirmed) {
+		disconnectConfirmed = false;
+		Debug::SetNetworkStatistics(nullptr);
+		delete thisClient;
+		thisClient = nullptr;
+		return;
+	}
+	thisClient->UpdateStatistics(dt);
 
-	thisClient->UpdateClient();
-
-	if (localPlayer) {
-		ClientPacket newPacket;
-		newPacket.playerID = localPlayer->GetID();
-		newPacket.prevPacketID = playerPacketID;
-		playerPacketID++;
-
-		Vector3 playerPos = localPlayer->GetTransform().GetPosition();
-		newPacket.position[0] = playerPos.x;
-		newPacket.position[1] = playerPos.y;
-		newPacket.position[2] = playerPos.z;
+	if (!localPlayer) {
+		return;
+	}
+	//The snapshots come in faster when sped up, so the render clock has to keep up with them
+	UpdateInterpolation(playback.IsOpen() ? dt * playbackSpeed : dt);
+	if (playback.IsOpen()) {
+		return; //there's no server to send input to
+	}
 
-		Quaternion playerOri = localPlayer->GetTransform().GetOrientation();
-		newPacket.orientation[0] = playerOri.x;
-		newPacket.orientation[1] = playerOri.y;
-		newPacket.orientation[2] = playerOri.z;
-		newPacket.orientation[3] = playerOri.w;
+	//Shots only last a frame, so keep hold of them until they can be sent
+	if (localPlayer->GetFiringInfo() != -1) {
+		pendingFiringInfo = localPlayer->GetFiringInfo();
+	}
+	if (NetworkTick(dt, clientSendDT)) {
+		ProfileScope send("Send");
+		ClientInput clientInput;
+		clientInput.playerID = localPlayer->GetID();
+		//Acknowledges the latest snapshot, or asks for full states again
+		clientInput.acknowledged = baselineLost ? -1 : lastSnapshotID;
+		baselineLost = false;
+
+		AgentInput input = localPlayer->ConsumeInput();
+		for (int i = ClientPacket::InputHistory - 1; i > 0; --i) {
+			recentInputs[i] = recentInputs[i - 1];
+		}
+		InputFrame& frame	= recentInputs[0];
+		frame.buttons		= (short)input.buttons;
+		frame.pitch			= localPlayer->GetPitch();
+		frame.yaw			= localPlayer->GetYaw();
+		frame.firingInfo	= pendingFiringInfo;
+		frame.viewSnapshot	= renderSnapshot;
+		pendingFiringInfo	= -1;
+
+		clientInput.inputSequence = ++inputSequence;
+		clientInput.frameCount = inputSequence + 1 < ClientPacket::InputHistory ? inputSequence + 1 : ClientPacket::InputHistory;
+		for (int i = 0; i < clientInput.frameCount; ++i) {
+			clientInput.frames[i] = recentInputs[i];
+		}
 
-		newPacket.pitch = localPlayer->GetPitch();
-		newPacket.yaw = localPlayer->GetYaw();
-		newPacket.firingInfo = localPlayer->GetFiringInfo();
+		//The input's already been applied locally, so this is what the server should end up with
+		PhysicsObject* physics = localPlayer->GetPhysicsObject();
+		predictions.push_back({ inputSequence, localPlayer->GetTransform().GetPosition(), physics->GetLinearVelocity() });
+		if (predictions.size() > 128) {
+			predictions.pop_front(); //the server's stopped answering
+		}
 
+		ClientPacket newPacket;
+		newPacket.Write(clientInput);
 		thisClient->SendPacket(newPacket);
 	}
 }
 
+/*
+The render clock runs at the snapshot rate, a little behind the newest
+snapshot, and is nudged back towards its target each frame rather than
+jumping, so that jitter in when snapshots arrive doesn't show. It only
+snaps if it's drifted a long way, such as after a stall.
+*/
+void NetworkedGame::UpdateInterpolation(float dt) {
+	if (lastSnapshotID < 0) {
+		return;
+	}
+	float target = (float)lastSnapshotID - interpolationDelay / serverSendDT;
+	float drift = target - renderSnapshot;
+	if (renderSnapshot < 0.0f || fabs(drift) * serverSendDT > 0.25f) {
+		renderSnapshot = target;
+	}
+	else {
+		renderSnapshot += dt / serverSendDT + drift * 0.1f;
+	}
+	float extrapolation = maxExtrapolation / serverSendDT;
+	for (NetworkObject* o : networkObjects.GetObjects()) {
+		if (o && o != localPlayer->GetNetworkObject()) {
+			o->UpdateInterpolation(renderSnapshot, extrapolation);
+		}
+	}
+}
+
 bool NCL::CSC8503::NetworkedGame::ConnectClient(string& fullIP) {
 	string delimiter = ".";
 	size_t pos = 0;
@@ -179,56 +453,176 @@ bool NCL::CSC8503::NetworkedGame::ConnectClient(string& fullIP) {
 }
 
 void NCL::CSC8503::NetworkedGame::ConnectPlayer() {
-	if (nextPlayerID < 4 && !serverPlayers[nextPlayerID]) {
-		serverPlayers[nextPlayerID] = AddAgentToWorld(nextPlayerID, nextObjectID, spawnPoints[nextPlayerID], colourWallMap[nextPlayerID]);
-		networkObjects[nextObjectID] = serverPlayers[nextPlayerID]->GetNetworkObject();
-		gameUI->SetPlayer(nextPlayerID, serverPlayers[nextPlayerID]);
-		thisServer->SendPacketToPeer(nextPlayerID, PlayerIDPacket(nextPlayerID, nextObjectID));
+	if (nextPlayerID < maxPlayers && !serverPlayers[nextPlayerID]) {
+		int objectID = networkObjects.Allocate();
+		int team = nextPlayerID % Teams;
+		serverPlayers[nextPlayerID] = AddAgentToWorld(nextPlayerID, objectID, spawnPoints[team], colourWallMap[team]);
+		networkObjects.Insert(objectID, serverPlayers[nextPlayerID]->GetNetworkObject());
+		if (gameUI && nextPlayerID < Teams) {
+			gameUI->SetPlayer(nextPlayerID, serverPlayers[nextPlayerID]);
+		}
+		thisServer->SendPacketToPeer(nextPlayerID, PlayerIDPacket(nextPlayerID, objectID));
+		SendWorldState(nextPlayerID);
 		nextPlayerID++;
-		nextObjectID++;
 	}
 }
 
-void NCL::CSC8503::NetworkedGame::UpdatePlayer(ClientPacket* packet) {
-	Agent* player = serverPlayers[packet->playerID];
-	player->GetTransform().SetPosition(Vector3(packet->position[0], packet->position[1], packet->position[2]));
-	player->GetTransform().SetOrientation(Quaternion(packet->orientation[0], packet->orientation[1], packet->orientation[2], packet->orientation[3]));
-	if (packet->firingInfo == 0 || packet->firingInfo == 1) {
-		FireProjectile(packet);
+/*
+Only inputs newer than the last one we used are looked at. Buttons are held
+until the next input arrives, but a jump in any of the ones we missed still
+counts, and is kept until the agent's actually had chance to use it. Every
+packet repeats the last few frames, so shots in frames whose own packet
+went missing are picked up here too, oldest first, and only the once.
+Nothing's done to the player here - the shots are queued, and everything
+that's arrived is used at the next UpdatePlayerInputs, however many packets
+came in at once.
+*/
+void NCL::CSC8503::NetworkedGame::UpdatePlayer(const ClientInput& input) {
+	ClientInputState& state = clientInputs[input.playerID];
+	int newInputs = input.inputSequence - state.sequence;
+	if (input.inputSequence < 0 || newInputs <= 0 || input.frameCount < 1) {
+		return;
+	}
+	newInputs = newInputs > input.frameCount ? input.frameCount : newInputs;
+
+	int buttons = input.frames[0].buttons | (state.input.buttons & AgentInput::Jump);
+	for (int i = newInputs - 1; i >= 0; --i) {
+		const InputFrame& frame = input.frames[i];
+		buttons |= frame.buttons & AgentInput::Jump;
+		if (frame.firingInfo == 0 || frame.firingInfo == 1) {
+			state.shots.emplace_back(frame);
+		}
+	}
+	state.input.buttons = buttons;
+	state.input.yaw		= input.frames[0].yaw;
+	state.sequence		= input.inputSequence;
+}
+
+//Pushes every client's player around before the physics update, which then moves them all at once
+void NCL::CSC8503::NetworkedGame::UpdatePlayerInputs() {
+	for (auto& i : clientInputs) {
+		Agent* agent = GetServerPlayer(i.first);
+		if (!agent) {
+			i.second.shots.clear();
+			continue;
+		}
+		for (const InputFrame& frame : i.second.shots) {
+			FireProjectile(i.first, frame);
+		}
+		i.second.shots.clear();
+		if (agent->GetTransform().GetPosition().y < -50) {
+			agent->GetTransform().SetPosition(agent->GetSpawnPosition());
+			agent->GetPhysicsObject()->SetLinearVelocity(Vector3(0, 0, 0));
+		}
+		if (!agent->IsRespawning()) {
+			agent->ApplyInput(i.second.input);
+			i.second.input.buttons &= ~AgentInput::Jump; //one jump per press
+		}
+		agent->Stabilise();
+	}
+}
+
+/*
+Everything the player's done since the input the server's answering is
+already in its current state, so moving that by the error gives the same
+result as replaying those inputs again from where the server had it. The
+predictions still waiting for an answer are moved by the same amount.
+*/
+void NCL::CSC8503::NetworkedGame::ReconcilePlayer(PlayerStatePacket* packet) {
+	while (!predictions.empty() && predictions.front().sequence < packet->inputSequence) {
+		predictions.pop_front();
+	}
+	if (!localPlayer || predictions.empty() || predictions.front().sequence != packet->inputSequence) {
+		return;
+	}
+	PredictedState predicted = predictions.front();
+	predictions.pop_front();
+
+	Vector3 error			= Vector3(packet->position[0], packet->position[1], packet->position[2]) - predicted.position;
+	Vector3 velocityError	= Vector3(packet->velocity[0], packet->velocity[1], packet->velocity[2]) - predicted.velocity;
+	float errorLength		= error.Length();
+	if (errorLength < correctionThreshold) {
+		return;
+	}
+	//Small errors are taken out over a few updates, so there's no visible pop
+	float amount	= errorLength > snapThreshold ? 1.0f : correctionRate;
+	error			= error * amount;
+	velocityError	= velocityError * amount;
+
+	Transform& transform	= localPlayer->GetTransform();
+	PhysicsObject* physics	= localPlayer->GetPhysicsObject();
+	transform.SetPosition(transform.GetPosition() + error);
+	physics->SetLinearVelocity(physics->GetLinearVelocity() + velocityError);
+
+	for (PredictedState& p : predictions) {
+		p.position += error;
+		p.velocity += velocityError;
 	}
 }
 
 void NCL::CSC8503::NetworkedGame::InitialiseLocalPlayer(int playerID) {
-	localPlayer = AddPlayerToWorld(playerID, -1, spawnPoints[playerID], colourWallMap[playerID]);
+	localPlayer = AddPlayerToWorld(playerID, -1, spawnPoints[playerID % Teams], colourWallMap[playerID % Teams]);
 	serverPlayers[playerID] = localPlayer;
-	thisClient->SendPacket(ClientPacket());
+	if (!playback.IsOpen()) { //a recording has no server to join
+		ClientPacket join;
+		join.Write(ClientInput());
+		thisClient->SendPacket(join);
+	}
 	gameUI->SetPlayer(0, localPlayer);
 	localPlayer->SetCameraAttached(false, false);
 }
 
 void NCL::CSC8503::NetworkedGame::InitialiseNetworkPlayer(int playerID, int objectID) {
-	serverPlayers[playerID] = AddAgentToWorld(playerID, objectID, spawnPoints[playerID], colourWallMap[playerID]);
-	networkObjects[objectID] = serverPlayers[playerID]->GetNetworkObject();
-	gameUI->SetPlayer(gameUI->GetNumPlayers(), serverPlayers[playerID]);
+	serverPlayers[playerID] = AddAgentToWorld(playerID, objectID, spawnPoints[playerID % Teams], colourWallMap[playerID % Teams]);
+	networkObjects.Insert(objectID, serverPlayers[playerID]->GetNetworkObject());
+	if (gameUI->GetNumPlayers() < Teams) {
+		gameUI->SetPlayer(gameUI->GetNumPlayers(), serverPlayers[playerID]);
+	}
 }
 
-void NCL::CSC8503::NetworkedGame::UpdateNetworkPlayer(FullPacket* packet) {
-	Agent* player = serverPlayers[packet->playerID];
-	player->GetTransform().SetPosition(packet->fullState.position);
-	player->GetTransform().SetOrientation(packet->fullState.orientation);
+//Goes through the network object, so that later deltas have the state to work from
+void NCL::CSC8503::NetworkedGame::UpdateNetworkPlayer(int playerID, FullPacket* packet) {
+	Agent* player = serverPlayers[playerID];
+	player->GetNetworkObject()->ReadPacket(*packet, receivingSnapshotID);
 }
 
 void NCL::CSC8503::NetworkedGame::UpdateObjectState(FullPacket* packet) {
-	if (packet->playerID != -1 && packet->playerID != localPlayer->GetID()) {
-		if (!serverPlayers[packet->playerID]) {
-			InitialiseNetworkPlayer(packet->playerID, packet->objectID);
+	int objectID;
+	int playerID;
+	NetworkState state;
+	if (!packet->Read(objectID, playerID, state)) {
+		return;
+	}
+	if (playerID >= MaxPlayers) {
+		return;
+	}
+	if (playerID != -1 && playerID != localPlayer->GetID()) {
+		if (!serverPlayers[playerID]) {
+			InitialiseNetworkPlayer(playerID, objectID);
 		}
 		else {
-			UpdateNetworkPlayer(packet);
+			UpdateNetworkPlayer(playerID, packet);
 		}
 	}
-	else if (packet->objectID != -1 && packet->playerID != localPlayer->GetID() && networkObjects[packet->objectID]) {
-		networkObjects[packet->objectID]->ReadPacket(*packet);
+	else if (playerID != localPlayer->GetID()) {
+		if (NetworkObject* o = networkObjects.Get(objectID)) {
+			o->ReadPacket(*packet, receivingSnapshotID);
+		}
+	}
+}
+
+void NCL::CSC8503::NetworkedGame::UpdateObjectState(DeltaPacket* packet) {
+	int objectID;
+	int fullID;
+	if (!packet->ReadHeader(objectID, fullID)) {
+		return;
+	}
+	NetworkObject* o = networkObjects.Get(objectID);
+	if (!localPlayer || !o || o == localPlayer->GetNetworkObject()) {
+		return;
+	}
+	if (!o->ReadPacket(*packet, receivingSnapshotID)) {
+		baselineLost = true;
 	}
 }
 
@@ -275,20 +669,28 @@ void NCL::CSC8503::NetworkedGame::HandleUICommand() {
 }
 
 void NCL::CSC8503::NetworkedGame::InitWorld() {
+	levelManager->FinishLevelAssets();
 	world->ClearAndErase();
+	perception->Clear(); //nothing it knows about is there any more
+	soundOcclusion->Clear();
 	physics->Clear();
 
 	InitListener();
 
 	vector<ColourBlock*> colourWalls[4];
 
-	levelManager->LoadEnvironment(this, "LevelData.txt", colourWalls);
-	mapGrid = new NavigationGrid("LevelLayout.txt");
-	refillPoints.push_back(levelManager->AddRefillPoint(nextObjectID++, this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(0, 2, 0), 2.5f));
-	refillPoints.push_back(levelManager->AddRefillPoint(nextObjectID++, this, thisServer, levelManager->GetEnvironmentCentre() + Vector3(50, -2, 0), 2.5f));
-	refillPoints.push_back(levelManager->AddRefillPoint(nextObjectID++, this, thisServer, levelManager->GetEnvironmentCentre() + Vector3(0, -2, 50), 2.5f));
-	refillPoints.push_back(levelManager->AddRefillPoint(nextObjectID++, this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(50, 2, 0), 2.5f));
-	refillPoints.push_back(levelManager->AddRefillPoint(nextObjectID++, this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(0, 2, 50), 2.5f));
+	levelManager->LoadEnvironment("LevelData.txt", colourWalls, this);
+
+	//Everything that moves stays within the level, give or take a bit of slack
+	//for projectiles, so that's all the range positions need over the network
+	Vector3 levelSize = levelManager->GetEnvironmentCentre() * 2.0f;
+	NetworkState::SetQuantisation(Vector3(-32, -64, -32), levelSize + Vector3(32, 128, 32));
+	refillPoints.clear(); //the last match's went with its world
+	refillPoints.push_back(levelManager->AddRefillPoint(networkObjects.Allocate(), this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(0, 2, 0), 2.5f));
+	refillPoints.push_back(levelManager->AddRefillPoint(networkObjects.Allocate(), this, thisServer, levelManager->GetEnvironmentCentre() + Vector3(50, -2, 0), 2.5f));
+	refillPoints.push_back(levelManager->AddRefillPoint(networkObjects.Allocate(), this, thisServer, levelManager->GetEnvironmentCentre() + Vector3(0, -2, 50), 2.5f));
+	refillPoints.push_back(levelManager->AddRefillPoint(networkObjects.Allocate(), this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(50, 2, 0), 2.5f));
+	refillPoints.push_back(levelManager->AddRefillPoint(networkObjects.Allocate(), this, thisServer, levelManager->GetEnvironmentCentre() - Vector3(0, 2, 50), 2.5f));
 
 	spawnPoints[0] = Vector3(40, 0, 40);
 	spawnPoints[1] = Vector3(160, 0, 40);
@@ -300,7 +702,29 @@ void NCL::CSC8503::NetworkedGame::InitWorld() {
 	colourWallMap[2] = colourWalls[2];
 	colourWallMap[3] = colourWalls[3];
 
-	world->BuildStaticTree();
+	world->LoadStaticTreeSettings(Assets::DATADIR + "LevelData.tree"); //the same level as offline
+	world->BuildStaticTree(Assets::DATADIR + "NetworkLevelData.octree");
+}
+
+//The server keeps the level in around every player, as it's simulating all of them
+void NCL::CSC8503::NetworkedGame::GatherStreamingCentres(vector<Vector3>& around) {
+	if (!online) {
+		Game::GatherStreamingCentres(around);
+		return;
+	}
+	if (thisServer) {
+		for (Agent* a : serverPlayers) {
+			if (a) {
+				around.emplace_back(a->GetTransform().GetPosition());
+			}
+		}
+	}
+	else if (localPlayer) {
+		around.emplace_back(localPlayer->GetTransform().GetPosition());
+	}
+	if (!headless) {
+		around.emplace_back(world->GetMainCamera()->GetPosition());
+	}
 }
 
 void NCL::CSC8503::NetworkedGame::DetermineWinners() {
@@ -308,8 +732,9 @@ void NCL::CSC8503::NetworkedGame::DetermineWinners() {
 		Game::DetermineWinners();
 		return;
 	}
+	winners.clear();
 	int bestScore = 0;
-	for (int i = 0; i < 4; ++i) {
+	for (int i = 0; i < MaxPlayers; ++i) {
 		int numBlocksColoured = serverPlayers[i] ? serverPlayers[i]->GetNumBlocksColoured() : 0;
 		if (numBlocksColoured > bestScore) {
 			bestScore = numBlocksColoured;
@@ -323,6 +748,9 @@ void NCL::CSC8503::NetworkedGame::DetermineWinners() {
 }
 
 void NCL::CSC8503::NetworkedGame::Reset() {
+	Debug::SetNetworkStatistics(nullptr);
+	playback.Close();
+	disconnectConfirmed = false;
 	if (thisClient) {
 		thisClient->Disconnect();
 		delete thisClient;
@@ -334,11 +762,31 @@ void NCL::CSC8503::NetworkedGame::Reset() {
 		delete thisServer;
 		thisServer = nullptr;
 	}
-	networkObjects.clear();
-	serverPlayers.clear();
-	nextObjectID = 0;
+	networkObjects.Clear();
+	for (int i = 0; i < MaxPlayers; ++i) {
+		serverPlayers[i] = nullptr;
+		playerHistories[i].Clear();
+	}
 	nextPlayerID = 0;
-	playerPacketID = 0;
+	clientSnapshots.clear();
+	receivedSnapshots.Clear();
+	eventBatch.Clear();
+	pendingBlockUpdates.clear();
+	blockStates.clear();
+	suspectBuckets = 0;
+	snapshotID = 0;
+	lastSnapshotID = -1;
+	baselineLost = false;
+	receivingSnapshotID = -1;
+	renderSnapshot = -1.0f;
+	sendTimer = 0.0f;
+	pendingFiringInfo = -1;
+	clientInputs.clear();
+	predictions.clear();
+	inputSequence = -1;
+	for (InputFrame& f : recentInputs) {
+		f = InputFrame();
+	}
 }
 
 Player* NCL::CSC8503::NetworkedGame::AddPlayerToWorld(int agentID, int objectID, const Vector3& position, vector<ColourBlock*>& wall) {
@@ -350,6 +798,7 @@ Player* NCL::CSC8503::NetworkedGame::AddPlayerToWorld(int agentID, int objectID,
 
 	CapsuleVolume* volume = new CapsuleVolume(halfHeight, radius, Vector3(0, 2, 0));
 	player->SetBoundingVolume((CollisionVolume*)volume);
+	player->SetLayer(CollisionLayer::PLAYER);
 
 	player->GetTransform()
 		.SetScale(Vector3(radius * -2, halfHeight, radius * 1.5))
@@ -362,6 +811,7 @@ Player* NCL::CSC8503::NetworkedGame::AddPlayerToWorld(int agentID, int objectID,
 	player->GetPhysicsObject()->SetInverseMass(inverseMass);
 	player->GetPhysicsObject()->InitCubeInertia();
 	player->GetPhysicsObject()->SetElasticity(0.1f);
+	player->GetPhysicsObject()->SetCanSleep(false);
 
 	GameObject* gun = new GameObject();
 	gun->GetTransform()
@@ -386,6 +836,7 @@ Agent* NCL::CSC8503::NetworkedGame::AddAgentToWorld(int agentID, int objectID, c
 
 	CapsuleVolume* volume = new CapsuleVolume(halfHeight, radius, Vector3(0, 2, 0));
 	agent->SetBoundingVolume((CollisionVolume*)volume);
+	agent->SetLayer(CollisionLayer::PLAYER);
 
 	agent->GetTransform()
 		.SetScale(Vector3(radius * -2, halfHeight, radius * 2))
@@ -395,13 +846,16 @@ Agent* NCL::CSC8503::NetworkedGame::AddAgentToWorld(int agentID, int objectID, c
 	agent->SetPhysicsObject(new PhysicsObject(&agent->GetTransform(), agent->GetBoundingVolume()));
 	agent->SetNetworkObject(new NetworkObject(*agent, objectID));
 
-	agent->GetRenderObject()->SetFlag(1);
+	agent->GetRenderObject()->SetFeatures(RenderObject::Skinned | RenderObject::TexturePerSubMesh);
 	agent->GetRenderObject()->SetTextures(levelManager->GuardTextures);
 	agent->GetRenderObject()->SetAnimation(levelManager->GetAnimation("StepForward"));
 
 	agent->GetPhysicsObject()->SetInverseMass(inverseMass);
 	agent->GetPhysicsObject()->InitCubeInertia();
+	agent->GetPhysicsObject()->SetRotationLocks(true, true, true); //turned by its input, not by collisions
+	agent->GetPhysicsObject()->SetKinematic(true);
 	agent->GetPhysicsObject()->SetElasticity(0.1f);
+	agent->GetPhysicsObject()->SetCanSleep(false);
 
 	GameObject* gun = new GameObject();
 	gun->GetTransform()
@@ -417,18 +871,29 @@ Agent* NCL::CSC8503::NetworkedGame::AddAgentToWorld(int agentID, int objectID, c
 	return agent;
 }
 
-void NCL::CSC8503::NetworkedGame::FireProjectile(ClientPacket* packet) {
-	Quaternion camRot = Quaternion::EulerAnglesToQuaternion(packet->pitch, packet->yaw, 0);
-	Vector3 camPos = Vector3(packet->position[0], packet->position[1], packet->position[2]) + Vector3(0, 3.5f, 0);
-	GameObject* projectile = (GameObject*) levelManager->AddProjectile(nextObjectID, this, camPos + camRot * Vector3(0, 0, -4), packet->firingInfo == 0);
-	projectile->GetTransform().SetOrientation(Quaternion::EulerAnglesToQuaternion(packet->pitch + 90, packet->yaw, 90));
-	projectile->GetRenderObject()->SetColour(packet->firingInfo == 0 ? Vector4((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX, 1) : Vector4(1, 1, 1, 1));
+void NCL::CSC8503::NetworkedGame::FireProjectile(int playerID, const InputFrame& frame) {
+	Quaternion camRot = Quaternion::EulerAnglesToQuaternion(frame.pitch, frame.yaw, 0);
+	Agent* shooter = GetServerPlayer(playerID);
+	int objectID = networkObjects.Allocate();
+	if (!shooter || objectID < 0) {
+		return;
+	}
+	Vector3 camPos = shooter->GetTransform().GetPosition() + Vector3(0, 3.5f, 0);
+	NetworkProjectile* projectile = levelManager->AddProjectile(objectID, this, camPos + camRot * Vector3(0, 0, -4), frame.firingInfo == 0);
+
+	//The client sees everyone else a little in the past, so that's where they're hit
+	float rewind = frame.viewSnapshot < 0.0f ? 0.0f : GetServerSnapshotTime() - frame.viewSnapshot;
+	float rewindLimit = maxRewind / serverSendDT;
+	projectile->SetShooter(playerID, rewind < 0.0f ? 0.0f : (rewind > rewindLimit ? rewindLimit : rewind));
+	projectile->SetSplashRadius(paintSplashRadius);
+	projectile->GetTransform().SetOrientation(Quaternion::EulerAnglesToQuaternion(frame.pitch + 90, frame.yaw, 90));
+	projectile->GetRenderObject()->SetColour(frame.firingInfo == 0 ? Vector4((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX, 1) : Vector4(1, 1, 1, 1));
 	projectile->GetPhysicsObject()->ApplyLinearImpulse(camRot * Vector3(0, 0, -1) * paintShotForce);
-	networkObjects[nextObjectID] = projectile->GetNetworkObject();
+	levelManager->AddPaintSpray(projectile->GetTransform().GetPosition(), camRot * Vector3(0, 0, -1), projectile->GetRenderObject()->GetColour());
+	networkObjects.Insert(objectID, projectile->GetNetworkObject());
 
 	ProjectilePacket newPacket;
-	newPacket.objectID = nextObjectID;
-	nextObjectID++;
+	newPacket.objectID = objectID;
 
 	Vector3 projectilePos = projectile->GetTransform().GetPosition();
 	newPacket.position[0] = projectilePos.x;
@@ -441,108 +906,603 @@ void NCL::CSC8503::NetworkedGame::FireProjectile(ClientPacket* packet) {
 	newPacket.colour[2] = colour.z;
 	newPacket.colour[3] = colour.w;
 
-	thisServer->SendGlobalPacket(newPacket);
+	QueueEvent(newPacket);
+}
+
+/*
+Closest distance between two line segments, found the same way as the
+capsule tests do - the end of one nearest the other is projected onto it,
+and back again.
+*/
+static float SegmentDistance(const Vector3& a0, const Vector3& a1, const Vector3& b0, const Vector3& b1) {
+	auto closest = [](const Vector3& start, const Vector3& end, const Vector3& point) {
+		Vector3 dir = end - start;
+		float length = Vector3::Dot(dir, dir);
+		float t = length > 0.0f ? Vector3::Dot(point - start, dir) / length : 0.0f;
+		return start + dir * (t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t));
+	};
+	Vector3 fromA0 = closest(b0, b1, a0);
+	Vector3 fromA1 = closest(b0, b1, a1);
+	Vector3 bestA = (fromA0 - a0).Length() < (fromA1 - a1).Length() ? a0 : a1;
+	Vector3 bestB = closest(b0, b1, bestA);
+	bestA = closest(a0, a1, bestB);
+	return (bestA - bestB).Length();
+}
+
+/*
+Projectiles don't hit players through the physics on the server. Instead,
+the path each one has taken since the last check is tested against every
+other player's capsule, where that player was when the shooter fired, as
+everyone else is drawn behind on the shooter's screen. A shot that looked
+like a hit to the shooter is then a hit, within maxRewind.
+*/
+void NetworkedGame::CheckRewoundHits() {
+	float now = GetServerSnapshotTime();
+	for (NetworkObject* o : networkObjects.GetObjects()) {
+		if (!o || o->GetGameObject()->GetTypeID() != ObjectType::Projectile || o->GetGameObject()->ToRemove()) {
+			continue;
+		}
+		NetworkProjectile* projectile = (NetworkProjectile*)o->GetGameObject();
+		Vector3 from = projectile->SweepFrom();
+		Vector3 to = projectile->GetTransform().GetPosition();
+		float projectileRadius = ((const SphereVolume*)projectile->GetBoundingVolume())->GetRadius();
+
+		for (int i = 0; i < MaxPlayers; ++i) {
+			if (!serverPlayers[i] || i == projectile->GetShooterID()) {
+				continue;
+			}
+			const CapsuleVolume* capsule = (const CapsuleVolume*)serverPlayers[i]->GetBoundingVolume();
+			Vector3 centre = GetRewoundPosition(i, now - projectile->GetRewind()) + capsule->GetOffset();
+			Vector3 extent = Vector3(0, capsule->GetHalfHeight() - capsule->GetRadius(), 0); //players are kept upright
+
+			if (SegmentDistance(from, to, centre - extent, centre + extent) < capsule->GetRadius() + projectileRadius) {
+				OnProjectileDestroyed(projectile->GetNetworkID(), to, Vector3(0, 0, 0), 0, false, i);
+				projectile->Remove();
+				break;
+			}
+		}
+	}
+}
+
+/*
+Between the newest snapshot and now, the player's current position is
+used as the next state, as the client hasn't been sent anything newer.
+*/
+Vector3 NetworkedGame::GetRewoundPosition(int playerID, float snapshot) const {
+	const PositionHistory& history = playerHistories[playerID];
+	Vector3 current = serverPlayers[playerID]->GetTransform().GetPosition();
+	int newest = history.GetNewestSnapshot();
+	if (newest < 0) {
+		return current;
+	}
+	if (snapshot <= (float)newest) {
+		return history.Sample(snapshot);
+	}
+	float span = GetServerSnapshotTime() - (float)newest;
+	float t = span > 0.0f ? (snapshot - (float)newest) / span : 1.0f;
+	Vector3 last = history.Sample((float)newest);
+	return last + (current - last) * (t > 1.0f ? 1.0f : t);
 }
 
 void NCL::CSC8503::NetworkedGame::FireProjectile(ProjectilePacket* packet) {
+	if (networkObjects.Get(packet->objectID)) {
+		return; //already had it in the world state, before this event went out
+	}
 	GameObject* projectile = levelManager->AddSphereToWorld(Vector3(packet->position[0], packet->position[1], packet->position[2]) , 0.25f, 10);
 	projectile->SetNetworkObject(new NetworkObject(*projectile, packet->objectID));
 	projectile->GetRenderObject()->SetDefaultTexture(nullptr);
 	projectile->GetRenderObject()->SetColour(Vector4(packet->colour[0], packet->colour[1], packet->colour[2], packet->colour[3]));
-	networkObjects[packet->objectID] = projectile->GetNetworkObject();
+	networkObjects.Insert(packet->objectID, projectile->GetNetworkObject());
+}
+
+static void WriteColour(BitWriter& writer, const Vector4& colour) {
+	for (int i = 0; i < 4; ++i) {
+		float c = colour[i] < 0.0f ? 0.0f : (colour[i] > 1.0f ? 1.0f : colour[i]);
+		writer.WriteBits((uint32_t)(c * 255.0f + 0.5f), 8);
+	}
+}
+
+static Vector4 ReadColour(BitReader& reader) {
+	Vector4 colour;
+	for (int i = 0; i < 4; ++i) {
+		colour[i] = (float)reader.ReadBits(8) / 255.0f;
+	}
+	return colour;
+}
+
+/*
+Only what's changed since the level was loaded needs sending - blocks
+that have been hit, and refill points that are waiting to come back -
+along with every projectile that's in flight. It's split over as many
+reliable packets as it takes, each one filled until there's no room
+for another record.
+
+A resync can't assume the client has the level as it was loaded, so
+every block and refill point in the buckets asked for is sent, hit or
+not. Projectiles aren't in the hash, so they're left out.
+*/
+void NetworkedGame::SendWorldState(int peer, uint32_t resyncBuckets) {
+	WorldStatePacket packet;
+	BitWriter writer(packet.data, WorldStatePacket::MaxData);
+	bool empty = true;
+	int lastID = 0;
+
+	auto send = [&]() {
+		writer.WriteBits(WorldStatePacket::End, WorldStatePacket::RecordBits);
+		packet.size = (short)writer.GetByteCount();
+		thisServer->SendPacketToPeer(peer, packet);
+		writer	= BitWriter(packet.data, WorldStatePacket::MaxData);
+		empty	= true;
+		lastID	= 0;
+	};
+	auto beginRecord = [&](WorldStatePacket::Record record, int objectID) {
+		if (writer.GetByteCount() + WorldStatePacket::MaxRecordBytes > WorldStatePacket::MaxData) {
+			send();
+		}
+		writer.WriteBits(record, WorldStatePacket::RecordBits);
+		writer.WriteSignedVarInt(objectID - lastID);
+		lastID	= objectID;
+		empty	= false;
+	};
+
+	if (resyncBuckets) {
+		for (NetworkObject* o : networkObjects.GetObjects()) {
+			if (!o || !WorldHash::InBuckets(o->GetNetworkID(), resyncBuckets)) {
+				continue;
+			}
+			GameObject* g = o->GetGameObject();
+			if (g->GetTypeID() == ObjectType::ColourBlock) {
+				auto hit = blockStates.find(o->GetNetworkID());
+				beginRecord(WorldStatePacket::Block, o->GetNetworkID());
+				writer.WriteBool(static_cast<ColourBlock*>(g)->IsColoured());
+				WriteColour(writer, hit != blockStates.end() ?
+					Vector4(hit->second.colour[0], hit->second.colour[1], hit->second.colour[2], hit->second.colour[3]) : g->GetRenderObject()->GetColour());
+			}
+			else if (g->GetTypeID() == ObjectType::RefillPoint) {
+				beginRecord(WorldStatePacket::Refill, o->GetNetworkID());
+				writer.WriteBool(static_cast<RefillPoint*>(g)->IsActive());
+			}
+		}
+		if (!empty) {
+			send();
+		}
+		return;
+	}
+	for (auto& b : blockStates) {
+		beginRecord(WorldStatePacket::Block, b.first);
+		writer.WriteBool(b.second.coloured);
+		WriteColour(writer, Vector4(b.second.colour[0], b.second.colour[1], b.second.colour[2], b.second.colour[3]));
+	}
+	for (RefillPoint* r : refillPoints) {
+		NetworkRefillPoint* refillPoint = (NetworkRefillPoint*)r;
+		if (!refillPoint->IsActive()) {
+			beginRecord(WorldStatePacket::Refill, refillPoint->GetNetworkID());
+			writer.WriteBool(false);
+		}
+	}
+	for (NetworkObject* o : networkObjects.GetObjects()) {
+		if (!o || o->GetGameObject()->GetTypeID() != ObjectType::Projectile || o->GetGameObject()->ToRemove()) {
+			continue;
+		}
+		GameObject* projectile = o->GetGameObject();
+		beginRecord(WorldStatePacket::Projectile, o->GetNetworkID());
+		Vector3 position = projectile->GetTransform().GetPosition();
+		for (int i = 0; i < 3; ++i) {
+			uint32_t bits;
+			memcpy(&bits, &position[i], sizeof(bits));
+			writer.WriteBits(bits, 32);
+		}
+		WriteColour(writer, projectile->GetRenderObject()->GetColour());
+	}
+	if (!empty) {
+		send();
+	}
+}
+
+void NetworkedGame::ReceiveWorldState(WorldStatePacket& packet) {
+	BitReader reader(packet.data, packet.size < WorldStatePacket::MaxData ? packet.size : WorldStatePacket::MaxData);
+	int objectID = 0;
+	while (true) {
+		uint32_t record = reader.ReadBits(WorldStatePacket::RecordBits);
+		if (record == WorldStatePacket::End || reader.HasOverflowed()) {
+			return;
+		}
+		objectID += reader.ReadSignedVarInt();
+
+		switch (record) {
+			case WorldStatePacket::Block: {
+				bool coloured = reader.ReadBool();
+				Vector4 colour = ReadColour(reader);
+				if (!reader.HasOverflowed()) {
+					OnWallBlockColoured(objectID, colour, coloured);
+				}
+			}break;
+			case WorldStatePacket::Refill: {
+				bool available = reader.ReadBool();
+				NetworkObject* o = networkObjects.Get(objectID);
+				if (o && !reader.HasOverflowed()) {
+					static_cast<NetworkRefillPoint*>(o->GetGameObject())->SetActive(available);
+				}
+			}break;
+			case WorldStatePacket::Projectile: {
+				ProjectilePacket projectile;
+				projectile.objectID = objectID;
+				for (int i = 0; i < 3; ++i) {
+					uint32_t bits = reader.ReadBits(32);
+					memcpy(&projectile.position[i], &bits, sizeof(bits));
+				}
+				Vector4 colour = ReadColour(reader);
+				for (int i = 0; i < 4; ++i) {
+					projectile.colour[i] = colour[i];
+				}
+				if (!reader.HasOverflowed()) {
+					FireProjectile(&projectile);
+				}
+			}break;
+		}
+	}
+}
+
+/*
+A block only hashes whether it's coloured, as that's what the score comes
+from, and a refill point whether it's available. Neither end has to go
+through them in the same order, as WorldHash doesn't care.
+*/
+void NetworkedGame::HashLevelState(WorldHash& hash) const {
+	hash.Clear();
+	for (NetworkObject* o : networkObjects.GetObjects()) {
+		if (!o) {
+			continue;
+		}
+		GameObject* g = o->GetGameObject();
+		uint8_t state;
+		if (g->GetTypeID() == ObjectType::ColourBlock) {
+			state = static_cast<ColourBlock*>(g)->IsColoured() ? 1 : 0;
+		}
+		else if (g->GetTypeID() == ObjectType::RefillPoint) {
+			state = static_cast<RefillPoint*>(g)->IsActive() ? 1 : 0;
+		}
+		else {
+			continue; //everything else is in the snapshots anyway
+		}
+		hash.Add(o->GetNetworkID(), &state, sizeof(state));
+	}
+}
+
+/*
+The hash goes in a snapshot, but block and refill point changes go as
+reliable events, which can turn up a little after it. So a bucket only
+counts as out once it's been wrong twice in a row, and then only that
+bucket's blocks and refill points are asked for again.
+*/
+void NetworkedGame::ReceiveWorldHash(WorldHashPacket& packet) {
+	if (!localPlayer || playback.IsOpen()) {
+		return; //nothing to compare yet, or no server to ask
+	}
+	WorldHash ours;
+	HashLevelState(ours);
+	uint32_t mismatched = ours.Compare(packet.buckets);
+	uint32_t confirmed	= mismatched & suspectBuckets;
+	suspectBuckets		= mismatched & ~confirmed;
+	if (confirmed) {
+		ResyncRequestPacket request;
+		request.playerID	= localPlayer->GetID();
+		request.buckets		= confirmed;
+		thisClient->SendPacket(request);
+	}
+}
+
+void NetworkedGame::ReceiveResyncRequest(ResyncRequestPacket& packet) {
+	if (GetServerPlayer(packet.playerID) && packet.buckets) {
+		SendWorldState(packet.playerID, packet.buckets);
+	}
 }
 
+//Under a tight budget, the objects the client would miss most go first
+static float GetClassPriority(int typeID) {
+	if (ObjectType::IsAgent(typeID)) {
+		return 3.0f;
+	}
+	return typeID == ObjectType::Projectile ? 2.0f : 1.0f;
+}
+
+/*
+Each client is sent its own version of the snapshot. Anything it has an
+acknowledged baseline for goes as a delta against it, and everything else
+as a full state, which becomes the baseline once the client acknowledges
+a snapshot at least that new. Baselines are refreshed every so often, so
+the deltas stay within range, and the server doesn't have to keep hold of
+old states for long.
+
+Everything that's due is then sent in priority order until the client's
+budget runs out, with objects it has no baseline for first of all. What
+doesn't fit keeps the priority it's built up, so it goes all the sooner
+next time, and a burst of new projectiles can only delay the rest rather
+than blow up the snapshot. The client's own player state, the timer and
+the hash aren't part of the budget, as they always go.
+*/
 void NetworkedGame::BroadcastSnapshot(bool deltaFrame) {
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 
 	world->GetObjectIterators(first, last);
 
+	snapshotID++;
+	for (int i = 0; i < MaxPlayers; ++i) {
+		if (serverPlayers[i]) {
+			playerHistories[i].Record(snapshotID, serverPlayers[i]->GetTransform().GetPosition());
+		}
+	}
 	for (auto i = first; i != last; ++i) {
 		NetworkObject* o = (*i)->GetNetworkObject();
-		if (!o) {
-			continue;
+		if (o) {
+			o->SetSnapshot(snapshotID);
 		}
+	}
 
-		GamePacket* newPacket = nullptr;
-		if (o->WritePacket(&newPacket, deltaFrame, 0)) {
-			thisServer->SendGlobalPacket(*newPacket);
-			delete newPacket;
+	FullPacket	fullPacket;
+	DeltaPacket deltaPacket;
+
+	bool sendHash = snapshotID % worldHashFrames == 0;
+	WorldHashPacket hashPacket;
+	if (sendHash) {
+		WorldHash hash;
+		HashLevelState(hash);
+		for (int i = 0; i < WorldHash::Buckets; ++i) {
+			hashPacket.buckets[i] = hash.GetBucketHash(i);
 		}
 	}
 
-	thisServer->SendGlobalPacket(GameTimerPacket(gameTimer));
-}
+	for (int peer = 0; peer < MaxPlayers; ++peer) {
+		Agent* agent = serverPlayers[peer];
+		if (!agent) {
+			continue;
+		}
+		ClientSnapshotState& client = clientSnapshots[peer];
+		snapshotPart = 0;
+
+		PlayerStatePacket playerState;
+		playerState.inputSequence = clientInputs[peer].sequence;
+		Vector3 position = agent->GetTransform().GetPosition();
+		Vector3 velocity = agent->GetPhysicsObject()->GetLinearVelocity();
+		for (int j = 0; j < 3; ++j) {
+			playerState.position[j] = position[j];
+			playerState.velocity[j] = velocity[j];
+		}
+		GameTimerPacket timerPacket(gameTimer, snapshotID);
+
+		int budget = snapshotBudget - SnapshotPacket::SpaceFor(playerState) - SnapshotPacket::SpaceFor(timerPacket)
+			- (sendHash ? SnapshotPacket::SpaceFor(hashPacket) : 0);
 
-void NetworkedGame::ReceivePacket(int type, GamePacket* payload, int source) {
-	if (type == Received_State) {
-		ClientPacket* realPacket = (ClientPacket*)payload;
-		if (!serverPlayers[realPacket->playerID]) {
-			ConnectPlayer();
+		snapshotCandidates.clear();
+		for (auto i = first; i != last; ++i) {
+			NetworkObject* o = (*i)->GetNetworkObject();
+			if (!o || *i == agent) {
+				continue; //clients are in charge of their own player
+			}
+			if ((*i)->IsStatic()) {
+				continue; //blocks and refill points never move, and their state goes in the world state
+			}
+			int id = o->GetNetworkID();
+			auto baseline = client.baselines.find(id);
+			bool pending = client.pendingFulls.find(id) != client.pendingFulls.end();
+			bool hasBaseline = baseline != client.baselines.end();
+			bool stale = hasBaseline && snapshotID - baseline->second >= baselineRefreshFrames;
+
+			//Less relevant objects build up to being sent over several snapshots,
+			//but anything the client hasn't got yet, or needs refreshing, is always due
+			float& priority = client.priorities[id];
+			priority += GetRelevance(agent, *i);
+			bool urgent = !hasBaseline || stale;
+			if (priority < 1.0f && !urgent) {
+				continue;
+			}
+			//A stale baseline can still be used while its replacement is on the way
+			bool useDelta = deltaFrame && hasBaseline && (!stale || pending);
+
+			float order = priority * GetClassPriority((*i)->GetTypeID()) + (urgent ? 1000.0f : 0.0f);
+			snapshotCandidates.push_back({ order, o, useDelta, hasBaseline ? baseline->second : -1 });
 		}
-		else {
-			UpdatePlayer(realPacket);
+		std::sort(snapshotCandidates.begin(), snapshotCandidates.end(),
+			[](const SnapshotCandidate& a, const SnapshotCandidate& b) { return a.priority > b.priority; });
+
+		for (const SnapshotCandidate& c : snapshotCandidates) {
+			GamePacket* newPacket = c.object->WritePacket(fullPacket, deltaPacket, c.useDelta, c.baselineID);
+			if (!newPacket) {
+				continue;
+			}
+			int space = SnapshotPacket::SpaceFor(*newPacket);
+			if (snapshotBudget > 0 && space > budget) {
+				continue; //something smaller further down might still fit
+			}
+			budget -= space;
+			int id = c.object->GetNetworkID();
+			client.priorities[id] = 0.0f;
+			if (newPacket->type == Full_State) {
+				client.pendingFulls.emplace(id, snapshotID);
+			}
+			thisServer->GetStatistics().RecordObjectState(newPacket->type == Delta_State);
+			AddToSnapshot(peer, *newPacket);
 		}
+		AddToSnapshot(peer, playerState);
+		if (sendHash) {
+			AddToSnapshot(peer, hashPacket);
+		}
+
+		AddToSnapshot(peer, timerPacket);
+		SendSnapshot(peer);
 	}
 
-	if (type == Player_ID) {
-		PlayerIDPacket* realPacket = (PlayerIDPacket*)payload;
-		if (!localPlayer) {
-			InitialiseLocalPlayer(realPacket->playerID);
-		}
-		else if (localPlayer->GetID() == realPacket->playerID) {
-			localPlayer->GetNetworkObject()->SetNetworkID(realPacket->objectID);
-			networkObjects[realPacket->objectID] = localPlayer->GetNetworkObject();
+	//Nothing will be sent as a delta against a state older than this
+	for (auto i = first; i != last; ++i) {
+		NetworkObject* o = (*i)->GetNetworkObject();
+		if (o) {
+			o->UpdateStateHistory(snapshotID - baselineRefreshFrames * 2);
 		}
 	}
+}
 
-	if (type == Client_Start) {
-		ChangeState(State::PLAYING);
+/*
+How often a client needs to hear about an object, from 1 (every snapshot)
+down to minRelevance. Other players never drop below half rate, as they're
+what the client is most likely to notice lagging behind.
+*/
+float NetworkedGame::GetRelevance(Agent* viewer, GameObject* object) const {
+	Vector3 eye		= viewer->GetTransform().GetPosition() + Vector3(0, 1, 0);
+	Vector3 target	= object->GetTransform().GetPosition();
+	float distance	= (target - eye).Length();
+
+	float t = (distance - relevanceNear) / (relevanceFar - relevanceNear);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	float relevance = 1.0f - t * (1.0f - minRelevance);
+
+	if (relevance < 1.0f && !world->LineOfSight(eye, target)) {
+		relevance *= occludedRelevance;
+	}
+	if (ObjectType::IsAgent(object->GetTypeID()) && relevance < 0.5f) {
+		relevance = 0.5f;
 	}
+	return relevance < minRelevance ? minRelevance : relevance;
+}
 
-	if (type == Disconnect_Confirmation) {
-		DisconnectConfirmPacket* realPacket = (DisconnectConfirmPacket*)payload;
-		cout << realPacket->playerID << endl;
-		if (realPacket->playerID == localPlayer->GetID()) {
-			delete thisClient;
-			thisClient = nullptr;
-		}
+void NetworkedGame::QueueEvent(const GamePacket& packet) {
+	if (!eventBatch.Append(packet)) {
+		thisServer->SendGlobalPacket(eventBatch); //too many for one batch this tick
+		eventBatch.Clear();
+		eventBatch.Append(packet);
 	}
+}
 
-	if (type == Full_State) {
-		FullPacket* realPacket = (FullPacket*)payload;
-		UpdateObjectState(realPacket);
+/*
+Sent just before the snapshot, so clients hear about new projectiles
+around the same time as they start getting their states. Block changes
+are added last, as nothing else in the batch depends on them.
+*/
+void NetworkedGame::FlushEvents() {
+	for (auto& b : pendingBlockUpdates) {
+		QueueEvent(b.second);
+	}
+	pendingBlockUpdates.clear();
+	if (!eventBatch.IsEmpty()) {
+		thisServer->SendGlobalPacket(eventBatch);
 	}
+	eventBatch.Clear();
+}
+
+//Built in place in an ENet packet, so it goes out without being copied again
+void NetworkedGame::BeginSnapshot() {
+	snapshotHandle = thisServer->BeginPacket(snapshotPacket);
+	snapshotPacket->snapshotID = snapshotID;
+}
 
-	if (type == New_Projectile) {
-		ProjectilePacket* realPacket = (ProjectilePacket*)payload;
-		FireProjectile(realPacket);
+void NetworkedGame::AddToSnapshot(int peer, const GamePacket& packet) {
+	if (!snapshotPacket) {
+		BeginSnapshot();
 	}
+	if (!snapshotPacket->Append(packet)) {
+		SendSnapshot(peer); //full up, so this snapshot will take more than one packet
+		BeginSnapshot();
+		snapshotPacket->Append(packet);
+	}
+}
 
-	if (type == Destroy_Projectile) {
-		DestroyProjectilePacket* realPacket = (DestroyProjectilePacket*)payload;
-		OnProjectileDestroyed(realPacket->objectID, 
-			Vector3(realPacket->position[0], realPacket->position[1], realPacket->position[2]), 
-			Vector3(realPacket->normal[0], realPacket->normal[1], realPacket->normal[2]),
-			realPacket->penetration,
-			realPacket->paintSplat,
-			realPacket->hitPlayerID
-		);
+void NetworkedGame::SendSnapshot(int peer) {
+	if (!snapshotPacket) {
+		return;
 	}
+	if (!snapshotPacket->IsEmpty()) {
+		thisServer->GetStatistics().RecordSnapshot(snapshotPacket->GetTotalSize());
+		//Only the first packet of a snapshot is XORed, and then only if it's the only one
+		SnapshotHistory& sent = clientSnapshots[peer].sent;
+		if (snapshotPart == 0 && xorSnapshots) {
+			sent.Encode(*snapshotPacket, clientSnapshots[peer].acknowledged);
+		}
+		else if (snapshotPart == 1) {
+			sent.Forget(snapshotID);
+		}
+		snapshotPart++;
+		thisServer->FinishPacket(snapshotHandle);
+		thisServer->SendPreparedPacketToPeer(peer, snapshotHandle);
+	}
+	thisServer->ReleasePacket(snapshotHandle);
+	snapshotPacket = nullptr;
+	snapshotHandle = nullptr;
+}
 
-	if (type == ColourBlockUpdate) {
-		ColourBlockPacket* realPacket = (ColourBlockPacket*)payload;
-		OnWallBlockColoured(realPacket->objectID, Vector4(realPacket->colour[0], realPacket->colour[1], realPacket->colour[2], realPacket->colour[3]), realPacket->coloured);
+void NetworkedGame::AcknowledgeSnapshot(int playerID, int snapshot) {
+	ClientSnapshotState& client = clientSnapshots[playerID];
+	if (snapshot < 0) { //the client's lost track of something, so start again
+		client.acknowledged = -1;
+		client.baselines.clear();
+		client.pendingFulls.clear();
+		return;
+	}
+	if (snapshot <= client.acknowledged) {
+		return;
 	}
+	client.acknowledged = snapshot;
+	for (auto i = client.pendingFulls.begin(); i != client.pendingFulls.end(); ) {
+		if (i->second <= snapshot) {
+			client.baselines[i->first] = i->second;
+			i = client.pendingFulls.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
 
-	if (type == RefillPointUpdate) {
-		RefillPointPacket* realPacket = (RefillPointPacket*)payload;
-		OnRefillPointStateChanged(realPacket->objectID, realPacket->available, realPacket->collectPlayerID);
+void NetworkedGame::ReceiveClientPacket(ClientPacket& packet) {
+	ClientInput input;
+	if (!packet.Read(input)) {
+		return;
 	}
+	if (!GetServerPlayer(input.playerID)) {
+		ConnectPlayer();
+	}
+	else {
+		UpdatePlayer(input);
+		AcknowledgeSnapshot(input.playerID, input.acknowledged);
+	}
+}
 
-	if (type == Game_Timer) {
-		GameTimerPacket* realPacket = (GameTimerPacket*)payload;
-		gameTimer = realPacket->gameTime;
+void NetworkedGame::ReceivePlayerID(PlayerIDPacket& packet) {
+	if (packet.playerID < 0 || packet.playerID >= MaxPlayers) {
+		return;
+	}
+	if (!localPlayer) {
+		InitialiseLocalPlayer(packet.playerID);
+	}
+	else if (localPlayer->GetID() == packet.playerID) {
+		localPlayer->GetNetworkObject()->SetNetworkID(packet.objectID);
+		networkObjects.Insert(packet.objectID, localPlayer->GetNetworkObject());
+	}
+}
+
+/*
+Everything inside goes through the client's handlers as if it had arrived
+on its own. The server only XORs against snapshots we've acknowledged, so
+the base should always be here. If it isn't, as at the start of a
+recording, the snapshot can't be read, and the next ones will be XORed
+against something newer anyway.
+*/
+void NetworkedGame::ReceiveSnapshot(SnapshotPacket& packet, int source) {
+	if (!receivedSnapshots.Decode(packet)) {
+		return;
+	}
+	receivingSnapshotID = packet.snapshotID;
+	packet.ForEachPacket(
+		[&](const GamePacket& p) {
+			thisClient->ProcessPacket((GamePacket*)&p, source);
+		}
+	);
+	receivingSnapshotID = -1;
+}
+
+void NetworkedGame::ReceiveGameTimer(GameTimerPacket& packet) {
+	gameTimer = packet.gameTime;
+	if (packet.snapshotID > lastSnapshotID) {
+		lastSnapshotID = packet.snapshotID;
 	}
 }
 
@@ -561,7 +1521,9 @@ void NetworkedGame::OnPlayerCollision(NetworkPlayer* a, NetworkPlayer* b) {
 
 void NCL::CSC8503::NetworkedGame::OnProjectileDestroyed(int objectID, Vector3 position, Vector3 normal, float penetration, bool paintSplat, int playerID) {
 	if (thisServer) {
-		if (playerID != -1) serverPlayers[playerID]->SetHealth(serverPlayers[playerID]->GetHealth() - 20);
+		if (Agent* a = GetServerPlayer(playerID)) {
+			a->SetHealth(a->GetHealth() - 20);
+		}
 		DestroyProjectilePacket newPacket;
 		newPacket.objectID = objectID;
 		newPacket.position[0] = position.x;
@@ -573,18 +1535,28 @@ void NCL::CSC8503::NetworkedGame::OnProjectileDestroyed(int objectID, Vector3 po
 		newPacket.penetration = penetration;
 		newPacket.paintSplat = paintSplat;
 		newPacket.hitPlayerID = playerID;
-		thisServer->SendGlobalPacket(newPacket);
+		QueueEvent(newPacket);
+
+		for (auto& c : clientSnapshots) { //it won't be in any more snapshots
+			c.second.baselines.erase(objectID);
+			c.second.priorities.erase(objectID);
+			c.second.pendingFulls.erase(objectID);
+		}
+		networkObjects.Release(objectID); //the slot can go to the next projectile
 	}
 	else if (thisClient) {
-		Vector4 col = networkObjects[objectID]->GetGameObject()->GetRenderObject()->GetColour();
-		networkObjects[objectID]->GetGameObject()->Remove();
-		networkObjects[objectID] = nullptr;
+		NetworkObject* o = networkObjects.Get(objectID);
+		if (!o) {
+			return;
+		}
+		Vector4 col = o->GetGameObject()->GetRenderObject()->GetColour();
+		o->GetGameObject()->Remove();
+		networkObjects.Release(objectID);
 		if (paintSplat) {
-			levelManager->AddPaintSplat(position, penetration, normal)->GetRenderObject()->SetColour(col);
+			levelManager->AddPaintSplat(position, normal, col);
 		}
 		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("paintsplat.wav"), position, 150);
-		if (playerID != -1) {
-			Agent* a = serverPlayers[playerID];
+		if (Agent* a = GetServerPlayer(playerID)) {
 			a->SetHealth(a->GetHealth() - 20);
 			if (a->GetHealth() == 0) {
 				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), a->GetTransform().GetPosition(), 150);
@@ -607,10 +1579,15 @@ void NCL::CSC8503::NetworkedGame::OnWallBlockColoured(int objectID, Vector4 colo
 		newPacket.colour[2] = colour.z;
 		newPacket.colour[3] = colour.w;
 
-		thisServer->SendGlobalPacket(newPacket);
+		pendingBlockUpdates[objectID] = newPacket;
+		blockStates[objectID] = newPacket;
 	}
 	else if (thisClient) {
-		NetworkColourBlock* block = static_cast<NetworkColourBlock*>(networkObjects[objectID]->GetGameObject());
+		NetworkObject* o = networkObjects.Get(objectID);
+		if (!o) {
+			return;
+		}
+		NetworkColourBlock* block = static_cast<NetworkColourBlock*>(o->GetGameObject());
 		block->SetColoured(coloured);
 		block->StartFade(colour);
 	}
@@ -623,24 +1600,35 @@ void NCL::CSC8503::NetworkedGame::OnRefillPointStateChanged(int objectID, bool a
 		newPacket.available = available;
 		newPacket.collectPlayerID = playerID;
 
-		thisServer->SendGlobalPacket(newPacket);
+		QueueEvent(newPacket);
 	}
 	else if (thisClient) {
-		NetworkRefillPoint* refillPoint = static_cast<NetworkRefillPoint*>(networkObjects[objectID]->GetGameObject());
+		NetworkObject* o = networkObjects.Get(objectID);
+		if (!o) {
+			return;
+		}
+		NetworkRefillPoint* refillPoint = static_cast<NetworkRefillPoint*>(o->GetGameObject());
 		refillPoint->SetActive(available);
 		if (!available) {
 			SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("powerup.wav"), refillPoint->GetTransform().GetPosition(), 100);
 		}
-		if (playerID != -1) {
-			serverPlayers[playerID]->SetAmmo(12);
+		if (Agent* a = GetServerPlayer(playerID)) {
+			a->SetAmmo(12);
 		}
 	}
 }
 
+NetworkBase* NCL::CSC8503::NetworkedGame::GetNetworkBase() const {
+	if (thisServer) {
+		return thisServer;
+	}
+	return thisClient;
+}
+
 int NCL::CSC8503::NetworkedGame::GetNextObjectIDAndIncrement() {
-	return nextObjectID++;
+	return networkObjects.Allocate();
 }
 
 void NCL::CSC8503::NetworkedGame::AddNetworkObject(NetworkObject* o, int networkID) {
-	networkObjects[networkID] = o;
+	networkObjects.Insert(networkID, o);
 }
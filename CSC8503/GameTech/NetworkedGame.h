@@ -1,6 +1,9 @@
 #pragma once
 #include "Game.h"
 #include "../CSC8503Common/NetworkObject.h"
+#include "../CSC8503Common/NetworkObjectTable.h"
+#include "../CSC8503Common/PositionHistory.h"
+#include "../CSC8503Common/SnapshotHistory.h"
 
 namespace NCL {
 	namespace CSC8503 {
@@ -10,46 +13,144 @@ namespace NCL {
 		class NetworkProjectile;
 		class NetworkLevelManager;
 
-		class NetworkedGame : public Game, public PacketReceiver {
+		class NetworkedGame : public Game {
 		public:
-			NetworkedGame();
+			NetworkedGame(bool headless = false);
 			~NetworkedGame();
 
 			void StartAsServer();
+
+			//Hosts straight away, and starts the match once enough players
+			//have joined. Only one match is played, then IsPlaying goes false
+			void StartHeadlessServer(int startPlayers);
 			void StartAsClient(char a, char b, char c, char d);
 
+			//Once the menu's up, plays a recording from the server instead of
+			//connecting to one, with its clock run speed times as fast
+			void StartPlayback(const string& filename, float speed = 1.0f) {
+				playbackFile	= filename;
+				playbackSpeed	= speed;
+			}
+
 			void UpdateGame(float dt) override;
 			void ChangeState(State newState) override;
 
-			void ReceivePacket(int type, GamePacket* payload, int source) override;
-
 			void OnPlayerCollision(NetworkPlayer* a, NetworkPlayer* b);
 			void OnProjectileDestroyed(int objectID, Vector3 position = Vector3(0, 0, 0), Vector3 normal = Vector3(0, 0, 0), float penetration = 0, bool paintSplat = false, int playerID = -1);
 			void OnWallBlockColoured(int objectID, Vector4 colour, bool coloured);
 			void OnRefillPointStateChanged(int objectID, bool available, int playerID = -1);
 
+			//How often the server sends snapshots, and clients send their input,
+			//no matter how fast either of them is rendering
+			void SetNetworkRates(int serverHz, int clientHz) {
+				serverSendDT = 1.0f / (float)serverHz;
+				clientSendDT = 1.0f / (float)clientHz;
+			}
+
+			//XORs each snapshot against the last one its client acknowledged, so
+			//compression has less to send. Clients undo it whether it's on or not
+			void SetSnapshotXor(bool on) {
+				xorSnapshots = on;
+			}
+
+			//The most each client's snapshot can hold, in bytes, with the objects
+			//that need it most going first. 0 sends everything that's due
+			void SetSnapshotBudget(int bytes) {
+				snapshotBudget = bytes;
+			}
+
+			//Should be a couple of snapshots at least, to ride out lost packets
+			void SetInterpolationDelay(float seconds) {
+				interpolationDelay = seconds;
+			}
+
+			static const int Teams		= 4;	//one spawn point and wall each
+			static const int MaxPlayers = 16;	//past Teams, players share with an earlier team
+
+			//Has to be set before StartAsServer, and normally stays at Teams
+			void SetMaxPlayers(int count) {
+				maxPlayers = count < 1 ? 1 : (count > MaxPlayers ? MaxPlayers : count);
+			}
+
+			//Also has to be set before StartAsServer, so more than one can run at once
+			void SetServerPort(int port) {
+				serverPort = port;
+			}
+
+			int GetServerPort() const {
+				return serverPort;
+			}
+
+			//What each type of object sends in its full states. Both ends have to
+			//agree, so anything reading the game's packets needs to call this
+			static void RegisterNetworkTypes();
+
+			//Whichever of the server or client is running
+			NetworkBase* GetNetworkBase() const;
+
 			int GetNextObjectIDAndIncrement();
 			void AddNetworkObject(NetworkObject* o, int networkID);
 
+			//Null for an ID that's out of range, or has no player yet
+			Agent* GetServerPlayer(int playerID) const {
+				return playerID >= 0 && playerID < MaxPlayers ? serverPlayers[playerID] : nullptr;
+			}
+
+			//How long each part of the last headless tick took, in milliseconds
+			struct TickTimes {
+				float network	= 0.0f;
+				float physics	= 0.0f;
+				float world		= 0.0f; //every object's own update, the Opponents' thinking included
+				float ai		= 0.0f; //the path queries, flow fields and perception
+			};
+			const TickTimes& GetTickTimes() const {
+				return tickTimes;
+			}
+
+			int GetObjectCount() const;
+			int GetPlayerCount() const;
+			int GetClientCount() const; //connections to the server, which can be ahead of the players while they join
+
+			float GetTimeLeft() const {
+				return gameTimer;
+			}
+
 		protected:
 			void UpdateWaitingState(float dt) override;
 
+			bool NetworkTick(float dt, float sendDT);
 			void UpdateAsServer(float dt);
 			void UpdateAsClient(float dt);
+			void UpdateHeadlessServer(float dt);
+			void UpdateInterpolation(float dt);
+
+			void RegisterClientHandlers();
+			void BeginPlayback();
 
 			bool ConnectClient(string& fullIP);
 			void ConnectPlayer();
-			void UpdatePlayer(ClientPacket* packet);
+			void UpdatePlayer(const ClientInput& input);
+			void UpdatePlayerInputs();
+			void ReconcilePlayer(PlayerStatePacket* packet);
 
 			void InitialiseLocalPlayer(int playerID);
 			void InitialiseNetworkPlayer(int playerID, int objectID);
-			void UpdateNetworkPlayer(FullPacket* packet);
+			void UpdateNetworkPlayer(int playerID, FullPacket* packet);
 
 			void UpdateObjectState(FullPacket* packet);
+			void UpdateObjectState(DeltaPacket* packet);
+
+			void AcknowledgeSnapshot(int playerID, int snapshot);
+
+			void ReceiveClientPacket(ClientPacket& packet);
+			void ReceivePlayerID(PlayerIDPacket& packet);
+			void ReceiveSnapshot(SnapshotPacket& packet, int source);
+			void ReceiveGameTimer(GameTimerPacket& packet);
 
 			void HandleUICommand() override;
 
 			void InitWorld() override;
+			void GatherStreamingCentres(vector<Vector3>& around) override;
 			void DetermineWinners() override;
 
 			void Reset();
@@ -57,24 +158,147 @@ namespace NCL {
 			Player* AddPlayerToWorld(int agentID, int objectID, const Vector3& position, vector<ColourBlock*>& wall);
 			Agent* AddAgentToWorld(int agentID, int objectID, const Vector3& position, vector<ColourBlock*>& wall);
 
-			void FireProjectile(ClientPacket* packet);
+			void FireProjectile(int playerID, const InputFrame& frame);
 			void FireProjectile(ProjectilePacket* packet);
 
+			//Tests each projectile's path since the last check against the players where its shooter saw them
+			void CheckRewoundHits();
+			Vector3 GetRewoundPosition(int playerID, float snapshot) const;
+
+			//The newest snapshot sent, plus however far we are towards the next one
+			float GetServerSnapshotTime() const {
+				return (float)snapshotID + sendTimer / serverSendDT;
+			}
+
+			//Catches a new client up on the blocks, refill points and projectiles,
+			//or, given some WorldHash buckets, resends every block and refill point in them
+			void SendWorldState(int peer, uint32_t resyncBuckets = 0);
+			void ReceiveWorldState(WorldStatePacket& packet);
+
+			//The blocks and refill points, which both ends hash the same way
+			void HashLevelState(WorldHash& hash) const;
+			void ReceiveWorldHash(WorldHashPacket& packet);
+			void ReceiveResyncRequest(ResyncRequestPacket& packet);
+
 			void BroadcastSnapshot(bool deltaFrame);
+			//Events go out together at the next network tick, rather than one packet each
+			void QueueEvent(const GamePacket& packet);
+			void FlushEvents();
+
+			void BeginSnapshot();
+			void AddToSnapshot(int peer, const GamePacket& packet);
+			void SendSnapshot(int peer);
+
+			float GetRelevance(Agent* viewer, GameObject* object) const;
+
+			//An object that's due to go in a client's snapshot, if there's room
+			struct SnapshotCandidate {
+				float			priority;
+				NetworkObject*	object;
+				bool			useDelta;
+				int				baselineID;
+			};
+			std::vector<SnapshotCandidate> snapshotCandidates; //kept between clients and snapshots, so it isn't reallocated
+
+			/*
+			What the server knows each client has. A full state only becomes a
+			client's baseline once it's acknowledged a snapshot at least as new,
+			after which that object is sent as deltas against it.
+			*/
+			struct ClientSnapshotState {
+				int acknowledged = -1;
+				std::map<int, int> baselines;		//network ID -> full state ID
+				std::map<int, int> pendingFulls;	//network ID -> oldest unacknowledged full state ID
+				std::map<int, float> priorities;	//network ID -> relevance built up since it was last sent
+				SnapshotHistory sent;				//for XORing the next ones against
+			};
 
 			GameServer* thisServer;
 			GameClient* thisClient;
+			bool		disconnectConfirmed = false; //by the server, so the client can go once it's finished its update
 
-			std::map<int, NetworkObject*> networkObjects;
-			int nextObjectID = 0;
+			std::map<int, ClientSnapshotState> clientSnapshots;
+			SnapshotPacket* snapshotPacket = nullptr;	//written straight into snapshotHandle's buffer
+			ENetPacket* snapshotHandle = nullptr;
+			int snapshotID = 0;
+			int snapshotPart = 0;	//how many packets this client's snapshot has taken so far
+			bool xorSnapshots = true;
+			int baselineRefreshFrames = 60; //resend full states every this many snapshots, to keep deltas small. Twice this has to fit in NetworkObject::StateHistoryLength
+			int worldHashFrames = 30; //how many snapshots between level state hashes
+			int snapshotBudget = SnapshotPacket::MaxPayload; //so a snapshot fits in one packet, which is also all that can be XORed
+			uint32_t suspectBuckets = 0; //the client's mismatches at the last hash, as it takes two in a row to ask for a resync
 
-			std::map<int, Agent*> serverPlayers;
+			EventBatchPacket eventBatch;
+			std::map<int, ColourBlockPacket> pendingBlockUpdates; //only a block's latest change needs sending
+			std::map<int, ColourBlockPacket> blockStates;	//every block that's been hit, for clients that join later
+
+			//Objects within relevanceNear of a client go in every snapshot, falling
+			//off to minRelevance (every 10th snapshot) by relevanceFar
+			float relevanceNear = 40.0f;
+			float relevanceFar = 160.0f;
+			float minRelevance = 0.1f;
+			float occludedRelevance = 0.5f; //scales anything the client can't see
+
+			float serverSendDT = 1.0f / 30.0f;
+			float clientSendDT = 1.0f / 60.0f;
+			float sendTimer = 0.0f;
+			int pendingFiringInfo = -1; //held on to until the next client packet goes out
+
+			//Everything a client's sent since the last update, however many packets it came in
+			struct ClientInputState {
+				int sequence = -1;
+				AgentInput input;
+				std::vector<InputFrame> shots; //oldest first
+			};
+			std::map<int, ClientInputState> clientInputs;
+
+			/*
+			Where the client's own player was when each input was sent. Once
+			the server says where it really was after that input, any error is
+			corrected, along with all the predictions since.
+			*/
+			struct PredictedState {
+				int		sequence;
+				Vector3 position;
+				Vector3 velocity;
+			};
+			std::deque<PredictedState> predictions;
+			int inputSequence = -1;
+			InputFrame recentInputs[ClientPacket::InputHistory];
+
+			float correctionThreshold = 0.5f;	//errors smaller than this are left alone
+			float correctionRate = 0.3f;		//how much of the error is taken out per update
+			float snapThreshold = 4.0f;			//errors bigger than this are corrected immediately
+
+			NetworkObjectTable networkObjects;
+
+			Agent* serverPlayers[MaxPlayers] = {};
+			PositionHistory playerHistories[MaxPlayers];	//where each player was at every recent snapshot
+			float maxRewind = 0.25f;	//seconds, so a laggy shooter can't hit players from long ago
 			int nextPlayerID = 0;
+			int maxPlayers = Teams;
+			int serverPort = NetworkBase::GetDefaultPort();
 
 			Player* localPlayer;
-			int playerPacketID;
+			int lastSnapshotID;		//the newest snapshot the client has seen
+			bool baselineLost;		//a delta arrived for a full state we never got
+			int receivingSnapshotID;	//the snapshot whose packets are being read
+			SnapshotHistory receivedSnapshots; //the plain versions, for undoing the server's XOR
+
+			//Remote objects are drawn this far behind the newest snapshot, so
+			//there's usually a later state to interpolate towards
+			float interpolationDelay = 0.1f;
+			float maxExtrapolation = 0.25f;	//seconds to carry on past the last state
+			float renderSnapshot;			//fractional snapshot being drawn
+
+			string playbackFile;		//waiting to be played, once the world can be loaded
+			PacketPlayback playback;
+			float playbackSpeed = 1.0f;
 
 			float paintShotForce = 10;
+			float paintSplashRadius = 1.5f; //only the server's projectiles splash, and send the blocks out
+			int headlessStartPlayers = 1;
+			TickTimes tickTimes;
 
 			friend class GameUI;
 		};
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		The type IDs set with GameObject::SetTypeID, so that collision
+		handlers can check what they've hit with an integer compare, rather
+		than by name. Derived types get their own ID, so anything that cares
+		about every kind of agent should use IsAgent.
+		*/
+		namespace ObjectType {
+			enum Type {
+				Default = 0,
+				Agent,
+				Player,
+				Opponent,
+				NetworkPlayer,
+				Projectile,
+				RefillPoint,
+				ColourBlock,
+				StreamedLevel	//obstacles, edge walls and their colliders, from a LevelStreamer
+			};
+
+			inline bool IsAgent(int typeID) {
+				return typeID == Agent || typeID == Player || typeID == Opponent;
+			}
+		}
+	}
+}
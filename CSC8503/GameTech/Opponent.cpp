@@ -7,20 +7,34 @@
 #include "../CSC8503Common/GameWorld.h"
 
 #include "../CSC8503Common/NavigationGrid.h"
+#include "../CSC8503Common/PathQueryService.h"
+#include "../CSC8503Common/FlowField.h"
+#include "../CSC8503Common/PerceptionSystem.h"
+#include "../../Common/MemoryTracker.h"
 
 #include <algorithm>
 
-NCL::CSC8503::Opponent::Opponent(int agentID, GameWorld* g, NavigationGrid* n, LevelManager* l, vector<ColourBlock*>& wall, const Vector3& startPoint, vector<RefillPoint*> fillPoints) : Agent(agentID, l, startPoint, wall) {
+const float NCL::CSC8503::Opponent::BehaviourCheckInterval = 0.1f;
+
+NCL::CSC8503::Opponent::Opponent(int agentID, GameWorld* g, NavigationGrid* n, PerceptionSystem* p, LevelManager* l, vector<ColourBlock*>& wall, const Vector3& startPoint, vector<RefillPoint*> fillPoints) : Agent(agentID, l, startPoint, wall) {
 	name = "Opponent";
+	typeID = ObjectType::Opponent;
 
 	world = g;
 	navGrid = n;
+	perception = p;
+	pathTicket = -1;
+	targetField = nullptr;
+	shownPathUntil = 0.0f;
+	pathIndex = -1;
 	level = l;
 	refillPoints = fillPoints;
 	attackTarget = nullptr;
 
 	transform.SetPosition(startPoint);
-	transform.SetOrientation(Quaternion::LookRotation(l->GetEnvironmentCentre() - transform.GetPosition(), Vector3(0, 1, 0)));
+	Vector3 toCentre = l->GetEnvironmentCentre() - transform.GetPosition();
+	toCentre.y = 0.0f; //upright, as nothing straightens it out afterwards
+	transform.SetOrientation(Quaternion::LookRotation(toCentre, Vector3(0, 1, 0)));
 
 	speed = 20.0f;
 	turnSpeed = 0.08f;
@@ -44,348 +58,232 @@ NCL::CSC8503::Opponent::Opponent(int agentID, GameWorld* g, NavigationGrid* n, L
 	isRespawning = false;
 	respawnFlag = true;
 
-	stateMachine = new StateMachine();
-
-	State* walkToWall = new State("Walk to Wall", [&](float dt)->void
-		{
-			this->TravelToObjective();
-		}
-	);
+	//Spread out over the check interval, so they don't all decide on the same frame
+	behaviour.sinceChecked = BehaviourCheckInterval * (agentID % 4) * 0.25f;
 
-	State* walkToRefill = new State("Walk to Refill", [&](float dt)->void
-		{
-			this->FindAmmo();
-		}
-	);
+	targetRefill = FindNearestRefillPoint();
+	currentPathTarget = targetRefill->GetTransform().GetPosition();
+	FindPath(currentPathTarget);
+}
 
-	State* shootAtWall = new State("Shoot at Wall", [&](float dt)->void
-		{
-			this->ShootAtWall(dt);
-		}
-	);
+/*
+Every opponent shares the one state machine, with only which state it's
+in being its own.
+*/
+const StateMachineDefinition<Opponent>& NCL::CSC8503::Opponent::GetBehaviour() {
+	static StateMachineDefinition<Opponent>* behaviour = nullptr;
+	if (behaviour) {
+		return *behaviour;
+	}
+	behaviour = new StateMachineDefinition<Opponent>(BehaviourCheckInterval);
+	StateMachineDefinition<Opponent>& b = *behaviour;
+
+	//In the same order as the BehaviourState values
+	b.AddState("Walk to Wall",			&Opponent::TravelToObjective);
+	b.AddState("Walk to Refill",		&Opponent::FindAmmo);
+	b.AddState("Shoot at Wall",			&Opponent::ShootAtWall);
+	b.AddState("Attack Agent",			&Opponent::AttackOpponent);
+	b.AddState("Walk to Opponent Wall",	&Opponent::TravelToObjective);
+	b.AddState("Colour Opponent Wall",	&Opponent::ShootAtOpponentWall);
+	b.AddState("Respawning",			&Opponent::Respawning);
+
+	b.AddTransition(WALK_TO_REFILL, WALK_TO_WALL,				&Opponent::ReturnToOwnWall);
+	b.AddTransition(WALK_TO_REFILL, WALK_TO_OPPONENT_WALL,		&Opponent::GoToOpponentWall);
+	b.AddTransition(WALK_TO_WALL, SHOOT_AT_WALL,				&Opponent::ArrivedAtOwnWall);
+	b.AddTransition(SHOOT_AT_WALL, WALK_TO_REFILL,				&Opponent::OutOfAmmo);
+	b.AddTransition(SHOOT_AT_WALL, WALK_TO_OPPONENT_WALL,		&Opponent::FinishedOwnWall);
+	b.AddTransition(COLOUR_OPPONENT_WALL, WALK_TO_REFILL,		&Opponent::OutOfAmmo);
+	b.AddTransition(WALK_TO_OPPONENT_WALL, COLOUR_OPPONENT_WALL, &Opponent::ArrivedAtOpponentWall);
+	b.AddTransition(COLOUR_OPPONENT_WALL, WALK_TO_OPPONENT_WALL, &Opponent::ChangeOpponentWall);
+	b.AddTransition(WALK_TO_OPPONENT_WALL, WALK_TO_WALL,		&Opponent::DefendOwnWall);
+	b.AddTransition(COLOUR_OPPONENT_WALL, WALK_TO_WALL,			&Opponent::DefendOwnWall);
+
+	b.AddTransition(WALK_TO_WALL, ATTACK_AGENT,					&Opponent::StartAttack);
+	b.AddTransition(SHOOT_AT_WALL, ATTACK_AGENT,				&Opponent::StartAttack);
+	b.AddTransition(WALK_TO_OPPONENT_WALL, ATTACK_AGENT,		&Opponent::StartAttack);
+	b.AddTransition(COLOUR_OPPONENT_WALL, ATTACK_AGENT,			&Opponent::StartAttack);
+	b.AddTransition(ATTACK_AGENT, WALK_TO_WALL,					&Opponent::StopAttackForOwnWall);
+	b.AddTransition(ATTACK_AGENT, WALK_TO_OPPONENT_WALL,		&Opponent::StopAttackForOpponentWall);
+
+	b.AddTransition(WALK_TO_REFILL, RESPAWNING,					&Opponent::StartRespawn);
+	b.AddTransition(WALK_TO_WALL, RESPAWNING,					&Opponent::StartRespawn);
+	b.AddTransition(SHOOT_AT_WALL, RESPAWNING,					&Opponent::StartRespawn);
+	b.AddTransition(ATTACK_AGENT, RESPAWNING,					&Opponent::StartRespawn);
+	b.AddTransition(WALK_TO_OPPONENT_WALL, RESPAWNING,			&Opponent::StartRespawn);
+	b.AddTransition(COLOUR_OPPONENT_WALL, RESPAWNING,			&Opponent::StartRespawn);
+	b.AddTransition(RESPAWNING, WALK_TO_REFILL,					&Opponent::RespawnForRefill);
+	b.AddTransition(RESPAWNING, WALK_TO_WALL,					&Opponent::RespawnForOwnWall);
+	b.AddTransition(RESPAWNING, WALK_TO_OPPONENT_WALL,			&Opponent::RespawnForOpponentWall);
+	return b;
+}
 
-	State* attackAgent = new State("Attack Agent", [&](float dt)->void
-		{
-			this->AttackOpponent(dt);
-		}
-	);
+bool NCL::CSC8503::Opponent::WasIn(BehaviourState a, BehaviourState b) const {
+	return behaviour.previousState == a || behaviour.previousState == b;
+}
 
-	State* respawning = new State("Respawning", [&](float dt)->void
-		{
-			this->Respawning(dt);
-		}
-	);
+// Ammo collected, return to paint wall
+bool NCL::CSC8503::Opponent::ReturnToOwnWall() {
+	if (paintAmmo > 0 && !WallIsPainted()) {
+		currentPathTarget = spawnPos;
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	State* walkToOpponentWall = new State("Walk to Opponent Wall", [&](float dt)->void
-		{
-			this->TravelToObjective();
-		}
-	);
+// Ammo collected, find highest scoring opponent and go to paint their wall
+bool NCL::CSC8503::Opponent::GoToOpponentWall() {
+	if (paintAmmo > 0 && WallIsPainted()) {
+		wallTarget = FindHighestScoringPlayer();
+		currentPathTarget = wallTarget->GetSpawnPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	State* colourOpponentWall = new State("Colour Opponent Wall", [&](float dt)->void
-		{
-			this->ShootAtOpponentWall(dt);
-		}
-	);
-
-	stateMachine->AddState(walkToWall);
-	stateMachine->AddState(walkToRefill);
-	stateMachine->AddState(shootAtWall);
-	stateMachine->AddState(attackAgent);
-	stateMachine->AddState(walkToOpponentWall);
-	stateMachine->AddState(colourOpponentWall);
-	stateMachine->AddState(respawning);
-
-	// Ammo collected, return to paint wall
-	stateMachine->AddTransition(new StateTransition(walkToRefill, walkToWall, [&]()->bool
-		{
-			if (paintAmmo > 0 && !WallIsPainted()) {
-				currentPathTarget = spawnPos;
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Ammo collected, find highest scoring opponent and go to paint their wall
-	stateMachine->AddTransition(new StateTransition(walkToRefill, walkToOpponentWall, [&]()->bool
-		{
-			if (paintAmmo > 0 && WallIsPainted()) {
-				wallTarget = FindHighestScoringPlayer();
-				currentPathTarget = wallTarget->GetSpawnPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
+// Arrived at wall, begin shooting colour blocks
+bool NCL::CSC8503::Opponent::ArrivedAtOwnWall() {
+	return (transform.GetPosition() - spawnPos).LengthSquared() < distTolerance;
+}
 
-	// Arrived at wall, begin shooting colour blocks
-	stateMachine->AddTransition(new StateTransition(walkToWall, shootAtWall, [&]()->bool
-		{
-			if ((transform.GetPosition() - spawnPos).LengthSquared() < distTolerance) {
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Ran out of ammo, find a refill point and travel to it
-	stateMachine->AddTransition(new StateTransition(shootAtWall, walkToRefill, [&]()->bool
-		{
-			if (paintAmmo <= 0) {
-				currentPathTarget = FindNearestRefillPoint()->GetTransform().GetPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Finished painting own wall, seek out another player's wall to de-colour
-	stateMachine->AddTransition(new StateTransition(shootAtWall, walkToOpponentWall, [&]()->bool
-		{
-			if (WallIsPainted()) {
-				wallTarget = FindHighestScoringPlayer();
-				currentPathTarget = wallTarget->GetSpawnPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Ran out of ammo, find a refill point and travel to it
-	stateMachine->AddTransition(new StateTransition(colourOpponentWall, walkToRefill, [&]()->bool
-		{
-			if (paintAmmo <= 0) {
-				currentPathTarget = FindNearestRefillPoint()->GetTransform().GetPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
+// Ran out of ammo, find a refill point and travel to it
+bool NCL::CSC8503::Opponent::OutOfAmmo() {
+	if (paintAmmo <= 0) {
+		currentPathTarget = FindNearestRefillPoint()->GetTransform().GetPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Arrived at opponent wall, begin shooting opponent colour blocks
-	stateMachine->AddTransition(new StateTransition(walkToOpponentWall, colourOpponentWall, [&]()->bool
-		{
-			if ((transform.GetPosition() - wallTarget->GetSpawnPosition()).LengthSquared() < distTolerance) {
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Entirely de-coloured opponent wall or other wall needs targeting, find new opponent wall to de-colour
-	stateMachine->AddTransition(new StateTransition(colourOpponentWall, walkToOpponentWall, [&]()->bool
-		{
-			if (decisionWaitTimer >= decisionWaitDuration && (rand() % targetWall.size()) * 0.5f > wallTarget->GetNumBlocksColoured()) {
-				decisionWaitTimer = 0;
-				wallTarget = FindHighestScoringPlayer();
-				currentPathTarget = wallTarget->GetSpawnPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Own wall is being de-coloured, begin walking back to own wall
-	stateMachine->AddTransition(new StateTransition(walkToOpponentWall, walkToWall, [&]()->bool
-		{
-			if (decisionWaitTimer >= decisionWaitDuration && !WallIsPainted() && (rand() % targetWall.size()) > GetNumBlocksColoured()) {
-				decisionWaitTimer = 0;
-				currentPathTarget = spawnPos;
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Own wall is being de-coloured, begin walking back to own wall
-	stateMachine->AddTransition(new StateTransition(colourOpponentWall, walkToWall, [&]()->bool
-		{
-			if (decisionWaitTimer >= decisionWaitDuration && !WallIsPainted() && (rand() % targetWall.size()) > GetNumBlocksColoured()) {
-				decisionWaitTimer = 0;
-				currentPathTarget = spawnPos;
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
+// Finished painting own wall, seek out another player's wall to de-colour
+bool NCL::CSC8503::Opponent::FinishedOwnWall() {
+	if (WallIsPainted()) {
+		wallTarget = FindHighestScoringPlayer();
+		currentPathTarget = wallTarget->GetSpawnPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Determine if any agent is a threat and begin attacking
-	stateMachine->AddTransition(new StateTransition(walkToWall, attackAgent, [&]()->bool
-		{
-			attackTarget = ShouldAttack();
-			return attackTarget;
-		}
-	));
+// Arrived at opponent wall, begin shooting opponent colour blocks
+bool NCL::CSC8503::Opponent::ArrivedAtOpponentWall() {
+	return (transform.GetPosition() - wallTarget->GetSpawnPosition()).LengthSquared() < distTolerance;
+}
 
-	// Determine if any agent is a threat and begin attacking
-	stateMachine->AddTransition(new StateTransition(shootAtWall, attackAgent, [&]()->bool
-		{
-			attackTarget = ShouldAttack();
-			return attackTarget;
-		}
-	));
+// Entirely de-coloured opponent wall or other wall needs targeting, find new opponent wall to de-colour
+bool NCL::CSC8503::Opponent::ChangeOpponentWall() {
+	if (decisionWaitTimer >= decisionWaitDuration && (rand() % targetWall.size()) * 0.5f > wallTarget->GetNumBlocksColoured()) {
+		decisionWaitTimer = 0;
+		wallTarget = FindHighestScoringPlayer();
+		currentPathTarget = wallTarget->GetSpawnPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Determine if any agent is a threat and begin attacking
-	stateMachine->AddTransition(new StateTransition(walkToOpponentWall, attackAgent, [&]()->bool
-		{
-			attackTarget = ShouldAttack();
-			return attackTarget;
-		}
-	));
+// Own wall is being de-coloured, begin walking back to own wall
+bool NCL::CSC8503::Opponent::DefendOwnWall() {
+	if (decisionWaitTimer >= decisionWaitDuration && !WallIsPainted() && (rand() % targetWall.size()) > GetNumBlocksColoured()) {
+		decisionWaitTimer = 0;
+		currentPathTarget = spawnPos;
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Determine if any agent is a threat and begin attacking
-	stateMachine->AddTransition(new StateTransition(colourOpponentWall, attackAgent, [&]()->bool
-		{
-			attackTarget = ShouldAttack();
-			return attackTarget;
-		}
-	));
-
-	// Player is no longer a threat, return to previous activity
-	stateMachine->AddTransition(new StateTransition(attackAgent, walkToWall, [&]()->bool
-		{
-			if (ShouldStopAttack() && (stateMachine->GetPreviousState()->GetName() == "Walk to Wall" || stateMachine->GetPreviousState()->GetName() == "Shoot at Wall")) {
-				currentPathTarget = spawnPos;
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Player is no longer a threat, return to previous activity
-	stateMachine->AddTransition(new StateTransition(attackAgent, walkToOpponentWall, [&]()->bool
-		{
-			if (ShouldStopAttack() && (stateMachine->GetPreviousState()->GetName() == "Walk to Opponent Wall" || stateMachine->GetPreviousState()->GetName() == "Colour Opponent Wall")) {
-				wallTarget = FindHighestScoringPlayer();
-				currentPathTarget = wallTarget->GetSpawnPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
+// Determine if any agent is a threat and begin attacking
+bool NCL::CSC8503::Opponent::StartAttack() {
+	attackTarget = ShouldAttack();
+	return attackTarget;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(walkToRefill, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
+// Player is no longer a threat, return to previous activity
+bool NCL::CSC8503::Opponent::StopAttackForOwnWall() {
+	if (ShouldStopAttack() && WasIn(WALK_TO_WALL, SHOOT_AT_WALL)) {
+		currentPathTarget = spawnPos;
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(walkToWall, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
+bool NCL::CSC8503::Opponent::StopAttackForOpponentWall() {
+	if (ShouldStopAttack() && WasIn(WALK_TO_OPPONENT_WALL, COLOUR_OPPONENT_WALL)) {
+		wallTarget = FindHighestScoringPlayer();
+		currentPathTarget = wallTarget->GetSpawnPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(shootAtWall, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
+// Health below zero, begin respawning
+bool NCL::CSC8503::Opponent::StartRespawn() {
+	if (isRespawning) {
+		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
+	}
+	return isRespawning;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(attackAgent, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
+// Respawned, return to previous activity
+bool NCL::CSC8503::Opponent::RespawnForRefill() {
+	if (!isRespawning && WasIn(WALK_TO_REFILL, ATTACK_AGENT)) {
+		targetRefill = FindNearestRefillPoint();
+		currentPathTarget = targetRefill->GetTransform().GetPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(walkToOpponentWall, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
+bool NCL::CSC8503::Opponent::RespawnForOwnWall() {
+	if (!isRespawning && WasIn(WALK_TO_WALL, SHOOT_AT_WALL)) {
+		currentPathTarget = spawnPos;
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	// Health below zero, begin respawning
-	stateMachine->AddTransition(new StateTransition(colourOpponentWall, respawning, [&]()->bool
-		{
-			if (isRespawning) {
-				SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("death.wav"), transform.GetPosition(), 150);
-			}
-			return isRespawning;
-		}
-	));
-
-	// Respawned, return to previous activity
-	stateMachine->AddTransition(new StateTransition(respawning, walkToRefill, [&]()->bool
-		{
-			if (!isRespawning && (stateMachine->GetPreviousState()->GetName() == "Walk to Refill" || stateMachine->GetPreviousState()->GetName() == "Attack Agent")) {
-				targetRefill = FindNearestRefillPoint();
-				currentPathTarget = targetRefill->GetTransform().GetPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Respawned, return to previous activity
-	stateMachine->AddTransition(new StateTransition(respawning, walkToWall, [&]()->bool
-		{
-			if (!isRespawning && (stateMachine->GetPreviousState()->GetName() == "Walk to Wall" || stateMachine->GetPreviousState()->GetName() == "Shoot at Wall")) {
-				currentPathTarget = spawnPos;
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
-
-	// Respawned, return to previous activity
-	stateMachine->AddTransition(new StateTransition(respawning, walkToOpponentWall, [&]()->bool
-		{
-			if (!isRespawning && (stateMachine->GetPreviousState()->GetName() == "Walk to Opponent Wall" || stateMachine->GetPreviousState()->GetName() == "Colour Opponent Wall")) {
-				wallTarget = FindHighestScoringPlayer();
-				currentPathTarget = wallTarget->GetSpawnPosition();
-				FindPath(currentPathTarget);
-				return true;
-			}
-			return false;
-		}
-	));
+bool NCL::CSC8503::Opponent::RespawnForOpponentWall() {
+	if (!isRespawning && WasIn(WALK_TO_OPPONENT_WALL, COLOUR_OPPONENT_WALL)) {
+		wallTarget = FindHighestScoringPlayer();
+		currentPathTarget = wallTarget->GetSpawnPosition();
+		FindPath(currentPathTarget);
+		return true;
+	}
+	return false;
+}
 
-	targetRefill = FindNearestRefillPoint();
-	currentPathTarget = targetRefill->GetTransform().GetPosition();
-	FindPath(currentPathTarget);
+NCL::CSC8503::Opponent::~Opponent() {
+	if (pathTicket >= 0) {
+		navGrid->GetQueries().Cancel(pathTicket);
+	}
 }
 
 void NCL::CSC8503::Opponent::Update(float dt) {
+	MemoryTagScope tag(MemoryTag::AI);
+	if (pathTicket >= 0) {
+		std::shared_ptr<const NavigationPath> pathToTarget;
+		bool pathFound = false;
+		if (navGrid->GetQueries().Poll(pathTicket, pathFound, pathToTarget)) {
+			pathTicket = -1;
+			SetPath(std::move(pathToTarget), pathFound);
+		}
+	}
 
 	if (Debug::GetAIActive()) {
 		decisionWaitTimer += dt;
 
-		stateMachine->Update(dt);
+		//Decisions only get a chance when the transitions are checked
+		bool decided = GetBehaviour().Update(*this, behaviour, dt);
 
-		if (decisionWaitTimer > decisionWaitDuration) {
+		if (decided && decisionWaitTimer > decisionWaitDuration) {
 			decisionWaitTimer = 0;
 		}
 
@@ -401,22 +299,16 @@ void NCL::CSC8503::Opponent::Update(float dt) {
 	// Dampen opponent movement
 	GetPhysicsObject()->SetLinearVelocity(GetPhysicsObject()->GetLinearVelocity() * Vector3(damping, 1, damping));
 
-	// Avoid rotating opponent
-	if (!isRespawning) {
-		GetPhysicsObject()->SetAngularVelocity(Vector3(0, 0, 0));
-		transform.SetOrientation(Quaternion::EulerAnglesToQuaternion(0, transform.GetOrientation().ToEuler().y, 0));
-	}
-
 	if (Debug::IsActive())
 		Debug::DrawLine(transform.GetPosition() + Vector3(0, 3, 0), transform.GetPosition() + transform.GetOrientation() * Vector3(0, 3, -3), Debug::CYAN);
 }
 
 void NCL::CSC8503::Opponent::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (otherObject->GetName() == "Refill Point") {
+	if (otherObject->GetTypeID() == ObjectType::RefillPoint) {
 		paintAmmo = 12;
 	}
 
-	if (otherObject->GetName() == "Projectile") {
+	if (otherObject->GetTypeID() == ObjectType::Projectile) {
 		health -= 20.0f;
 		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("hurt.wav"), SoundPriority::SOUNDPRIORITY_HIGH, (((float)rand() / RAND_MAX) * 0.6f) + 0.7f);
 		if (health <= 0) {
@@ -425,18 +317,18 @@ void NCL::CSC8503::Opponent::OnCollisionBegin(GameObject* otherObject, Collision
 	}
 }
 
-void NCL::CSC8503::Opponent::TravelToObjective() {
+void NCL::CSC8503::Opponent::TravelToObjective(float dt) {
 	FollowPath();
 	LookAt(currentPathNode);
 }
 
-void NCL::CSC8503::Opponent::FindAmmo() {
+void NCL::CSC8503::Opponent::FindAmmo(float dt) {
 	if (!targetRefill->IsActive()) {
 		targetRefill = FindNearestRefillPoint();
 		currentPathTarget = targetRefill->GetTransform().GetPosition();
 		FindPath(currentPathTarget);
 	}
-	TravelToObjective();
+	TravelToObjective(dt);
 }
 
 void NCL::CSC8503::Opponent::ShootAtWall(float dt) {
@@ -508,23 +400,61 @@ void NCL::CSC8503::Opponent::Respawn() {
 	paintAmmo = 0;
 }
 
+/*
+Everywhere the AI heads for is fixed - spawn points and refill points - so
+there's nearly always a flow field to follow there, shared with every
+other opponent going the same way. Otherwise the path's searched for on
+the job system, and picked up by Update a frame or so later, carrying on
+along the old one until then. Asking again before it's arrived means the
+old one's not wanted any more.
+*/
 void NCL::CSC8503::Opponent::FindPath(const Vector3& targetPosition) {
-	NavigationPath pathToTarget;
-	bool pathFound = navGrid->FindPath(transform.GetPosition(), targetPosition, pathToTarget);
+	PathQueryService& queries = navGrid->GetQueries();
+	if (pathTicket >= 0) {
+		queries.Cancel(pathTicket);
+		pathTicket = -1;
+	}
+	FlowField* field = navGrid->GetFlowField(targetPosition);
+	int cell = navGrid->GetCell(transform.GetPosition());
+	if (field && cell >= 0 && field->Reaches(cell)) {
+		targetField = field;
+		currentPath.reset();
+		return;
+	}
+	pathTicket = queries.Request(transform.GetPosition(), targetPosition);
+}
 
+void NCL::CSC8503::Opponent::SetPath(std::shared_ptr<const NavigationPath> pathToTarget, bool pathFound) {
 	currentPathNode = Vector3(0, 0, 0);
 
 	if (pathFound) {
-		currentPath.Clear();
-		currentPath = pathToTarget;
-		currentPath.PopWaypoint(currentPathNode);
+		targetField = nullptr;
+		currentPath = std::move(pathToTarget);
+		pathIndex = currentPath->Size() - 1;
+		NextPathNode();
+	}
+}
+
+//Waypoints are the corners of their nodes, other than the last, which is
+//the one being gone to
+bool NCL::CSC8503::Opponent::NextPathNode() {
+	if (!currentPath || pathIndex < 0) {
+		return false;
+	}
+	currentPathNode = currentPath->GetWaypoint(pathIndex--);
+	if (pathIndex >= 0) {
 		currentPathNode.x += navGrid->GetNodeSize() * 0.5f;
 		currentPathNode.z += navGrid->GetNodeSize() * 0.5f;
-		currentPathNode.y = transform.GetPosition().y;
 	}
+	currentPathNode.y = transform.GetPosition().y;
+	return true;
 }
 
 void NCL::CSC8503::Opponent::FollowPath() {
+	if (targetField) {
+		FollowField();
+		return;
+	}
 	Vector3 lineToNode = currentPathNode - transform.GetPosition();
 
 	float squaredDist = abs(lineToNode.LengthSquared());
@@ -534,13 +464,7 @@ void NCL::CSC8503::Opponent::FollowPath() {
 	}
 
 	if (squaredDist < distTolerance) {
-		bool pathFinished = !currentPath.PopWaypoint(currentPathNode);
-		if (!pathFinished) {
-			if (currentPath.Size() > 0) {
-				currentPathNode.x += navGrid->GetNodeSize() * 0.5f;
-				currentPathNode.z += navGrid->GetNodeSize() * 0.5f;
-			}
-			currentPathNode.y = transform.GetPosition().y;
+		if (NextPathNode()) {
 			lineToNode = currentPathNode - transform.GetPosition();
 			squaredDist = abs(lineToNode.LengthSquared());
 		}
@@ -549,39 +473,66 @@ void NCL::CSC8503::Opponent::FollowPath() {
 	GetPhysicsObject()->AddForce(lineToNode.Normalised() * speed);
 }
 
+//Heads for the middle of the next cell along from the one it's in, or
+//straight for the target once it's there
+void NCL::CSC8503::Opponent::FollowField() {
+	if (Debug::IsActive()) {
+		ShowPath();
+	}
+	int cell = navGrid->GetCell(transform.GetPosition());
+	int next = cell >= 0 ? targetField->GetNextCell(cell) : -1;
+
+	currentPathNode = next >= 0 ? navGrid->GetCellCentre(next) : currentPathTarget;
+	currentPathNode.y = transform.GetPosition().y;
+
+	Vector3 lineToNode = currentPathNode - transform.GetPosition();
+	GetPhysicsObject()->AddForce(lineToNode.Normalised() * speed);
+}
+
 void NCL::CSC8503::Opponent::ShowPath() {
 	path.clear();
-	NavigationPath p = currentPath;
-	Vector3 pos;
-	while (p.PopWaypoint(pos)) {
-		if (p.Size() > 0) {
-			pos.x += navGrid->GetNodeSize() * 0.5f;
-			pos.z += navGrid->GetNodeSize() * 0.5f;
+	if (targetField) {
+		path.push_back(transform.GetPosition() + Vector3(0, 0.5f, 0));
+		int cell = navGrid->GetCell(transform.GetPosition());
+		for (int i = 0; i < 256 && cell >= 0; ++i) {
+			cell = targetField->GetNextCell(cell);
+			Vector3 pos = cell >= 0 ? navGrid->GetCellCentre(cell) : currentPathTarget;
+			pos.y = transform.GetPosition().y + 0.5f;
+			path.push_back(pos);
 		}
-		pos.y = transform.GetPosition().y + 0.5f;
-		path.push_back(pos);
 	}
-
-	for (int i = 1; i < path.size(); ++i) {
-		Vector3 a = path[i - 1];
-		Vector3 b = path[i];
-
-		Debug::DrawLine(a, b, Debug::BLUE);
+	else if (currentPath) {
+		for (int i = pathIndex; i >= 0; --i) {
+			Vector3 pos = currentPath->GetWaypoint(i);
+			if (i > 0) {
+				pos.x += navGrid->GetNodeSize() * 0.5f;
+				pos.z += navGrid->GetNodeSize() * 0.5f;
+			}
+			pos.y = transform.GetPosition().y + 0.5f;
+			path.push_back(pos);
+		}
 	}
-}
 
-GameObject* NCL::CSC8503::Opponent::ShootRayAt(const Vector3& target) {
-	Vector3 dir = (target - transform.GetPosition()).Normalised();
-	Vector3 startPos = transform.GetPosition() + Vector3(0, 2, 0) + dir * 1.5f;
-	Ray ray = Ray(startPos, dir);
+	if (path.size() < 2) {
+		return;
+	}
+	//The first leg moves with it, but the rest only changes when the path does, so it's
+	//drawn to last a while, and again when it changes or is about to run out
+	Debug::DrawLine(path[0], path[1], Debug::BLUE);
 
-	GameObject* closestObject;
-	RayCollision closestCollision;
-	if (world->Raycast(ray, closestCollision, true)) {
-		closestObject = (GameObject*)closestCollision.node;
-		return closestObject;
+	bool changed = path.size() != shownPath.size() || Debug::GetTime() + 0.05f > shownPathUntil;
+	for (int i = 1; i < path.size() && !changed; ++i) {
+		changed = path[i].x != shownPath[i].x || path[i].z != shownPath[i].z;
 	}
-	return nullptr;
+	if (!changed) {
+		return;
+	}
+	const float pathLineTime = 0.25f;
+	for (int i = 2; i < path.size(); ++i) {
+		Debug::DrawLine(path[i - 1], path[i], Debug::BLUE, pathLineTime);
+	}
+	shownPath		= path;
+	shownPathUntil	= Debug::GetTime() + pathLineTime;
 }
 
 void NCL::CSC8503::Opponent::ShootPaintAt(const Vector3& target, bool coloured) {
@@ -593,16 +544,28 @@ void NCL::CSC8503::Opponent::ShootPaintAt(const Vector3& target, bool coloured)
 	GameObject* projectile = (GameObject*)level->AddProjectile(spawnPos, coloured);
 	projectile->GetRenderObject()->SetColour(coloured ? Vector4((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX, 1) : Vector4(1, 1, 1, 1));
 	projectile->GetPhysicsObject()->ApplyLinearImpulse(dir * paintShotForce);
+	level->AddPaintSpray(spawnPos, dir, projectile->GetRenderObject()->GetColour());
 }
 
+//Only the agents close enough to attack are looked at, rather than every opponent
 Agent* NCL::CSC8503::Opponent::ShouldAttack() {
-	float shortestDist = FLT_MAX;
+	if (paintAmmo <= 0) {
+		return nullptr;
+	}
+	SpatialFilter filter;
+	filter.accept = [&](GameObject* o) {
+		Agent* a = (Agent*)o;
+		return a != this && a->GetAmmo() > 0 && !a->IsRespawning()
+			&& std::find(opponents.begin(), opponents.end(), a) != opponents.end();
+	};
+	nearbyAgents.clear();
+	world->GetSpatialGrid().FindNearest(transform.GetPosition(), (int)opponents.size(), nearbyAgents, filter, sqrt(attackDist));
+	//Every one in range is still asked about, so that what's known of them stays fresh
 	Agent* attackCandidate = nullptr;
-	for (Agent* o : opponents) {
-		float distToOpponent = (transform.GetPosition() - o->GetTransform().GetPosition()).LengthSquared();
-		if (distToOpponent < attackDist && paintAmmo > 0 && o->GetAmmo() > 0 && !o->IsRespawning() && CanSeeAgent(o) && distToOpponent < shortestDist) {
-			shortestDist = distToOpponent;
-			attackCandidate = o;
+	for (GameObject* o : nearbyAgents) {
+		Agent* a = (Agent*)o;
+		if ((transform.GetPosition() - a->GetTransform().GetPosition()).LengthSquared() < attackDist && CanSeeAgent(a) && !attackCandidate) {
+			attackCandidate = a;
 		}
 	}
 	return attackCandidate;
@@ -625,23 +588,16 @@ bool NCL::CSC8503::Opponent::ShouldStopAttack() {
 }
 
 RefillPoint* NCL::CSC8503::Opponent::FindNearestRefillPoint() {
-	float shortestDist = FLT_MAX;
-	RefillPoint* currentClosest = refillPoints[0];
-	for (RefillPoint* p : refillPoints) {
-		float distToPoint = (transform.GetPosition() - p->GetTransform().GetPosition()).LengthSquared();
-		if (distToPoint < shortestDist && p->IsActive()) {
-			shortestDist = distToPoint;
-			currentClosest = p;
-		}
-	}
-	return currentClosest;
+	SpatialFilter filter;
+	filter.typeID = ObjectType::RefillPoint;
+	filter.accept = [](GameObject* o) { return ((RefillPoint*)o)->IsActive(); };
+	GameObject* nearest = world->GetSpatialGrid().FindNearest(transform.GetPosition(), filter);
+	return nearest ? (RefillPoint*)nearest : refillPoints[0];
 }
 
 bool NCL::CSC8503::Opponent::WallIsPainted() {
-	for (ColourBlock* block : targetWall) {
-		if (!block->IsColoured()) {
-			return false;
-		}
+	if (GetNumBlocksRemaining() > 0) {
+		return false;
 	}
 	targetBlock = nullptr;
 	return true;
@@ -664,20 +620,19 @@ Agent* NCL::CSC8503::Opponent::FindHighestScoringPlayer() {
 	return highScoreCandidate;
 }
 
+//What it last knew, which might be a few frames old, as the rays are shared out between all of the AI
 bool NCL::CSC8503::Opponent::CanSeeAgent(Agent* opponent) {
-	GameObject* hit = ShootRayAt(opponent->GetTransform().GetPosition());
-	return hit && (hit->GetName() == "Player" || hit->GetName() == "Opponent");
+	return perception->CanSee(this, opponent);
 }
 
 ColourBlock* NCL::CSC8503::Opponent::TargetNextBlock() {
-	for (ColourBlock* block : targetWall) {
-		if (!block->IsColoured()) {
-			return block;
-		}
-	}
+	return colourWall ? colourWall->FirstUncoloured() : nullptr;
 }
 
 ColourBlock* NCL::CSC8503::Opponent::TargetOpponentBlock(Agent* o) {
+	if (o->GetNumBlocksColoured() == 0) {
+		return nullptr;
+	}
 	for (ColourBlock* block : o->GetTargetWall()) {
 		if (block->IsColoured()) {
 			return block;
@@ -687,7 +642,13 @@ ColourBlock* NCL::CSC8503::Opponent::TargetOpponentBlock(Agent* o) {
 }
 
 void NCL::CSC8503::Opponent::LookAt(const Vector3& target) {
-	Vector3 viewVector = (transform.GetPosition() - target).Normalised();
+	//Only ever turns about the vertical, so the opponent stays upright
+	Vector3 viewVector = transform.GetPosition() - target;
+	viewVector.y = 0.0f;
+	if (viewVector.LengthSquared() < 0.0001f) {
+		return;
+	}
+	viewVector.Normalise();
 	Quaternion targetRot = Quaternion::LookRotation(viewVector, Vector3(0, 1, 0));
 	transform.SetOrientation(Quaternion::Lerp(transform.GetOrientation(), targetRot, turnSpeed));
 }
\ No newline at end of file
@@ -2,22 +2,23 @@
 
 #include "Agent.h"
 #include "../CSC8503Common/NavigationPath.h"
-#include "../CSC8503Common/StateMachine.h"
-#include "../CSC8503Common/StateTransition.h"
-#include "../CSC8503Common/State.h"
+#include "../CSC8503Common/StateMachineDefinition.h"
+#include <memory>
 
 namespace NCL {
 	namespace CSC8503 {
 		class GameWorld;
 		class NavigationGrid;
+		class FlowField;
+		class PerceptionSystem;
 		class LevelManager;
 		class ColourBlock;
 		class RefillPoint;
 
 		class Opponent : public Agent {
 		public:
-			Opponent(int agentID, GameWorld* gameWorld, NavigationGrid* grid, LevelManager* level, vector<ColourBlock*> &wall, const Vector3& startPoint, vector<RefillPoint*> refillPoints);
-			~Opponent() {};
+			Opponent(int agentID, GameWorld* gameWorld, NavigationGrid* grid, PerceptionSystem* perception, LevelManager* level, vector<ColourBlock*> &wall, const Vector3& startPoint, vector<RefillPoint*> refillPoints);
+			~Opponent();
 
 			void Update(float dt) override;
 
@@ -25,13 +26,25 @@ namespace NCL {
 
 			void SetOpponents(vector<Agent*>& o) { opponents = o; }
 
-			string GetActiveStateName() const { return stateMachine->GetActiveState()->GetName(); }
-			string GetPrevStateName() const { return stateMachine->GetPreviousState()->GetName(); }
+			string GetActiveStateName() const { return GetBehaviour().GetStateName(behaviour.activeState); }
+			string GetPrevStateName() const { return GetBehaviour().GetStateName(behaviour.previousState); }
 
-		protected:
+			static const StateMachineDefinition<Opponent>& GetBehaviour();
 
-			void TravelToObjective();
-			void FindAmmo();
+		protected:
+			enum BehaviourState {
+				WALK_TO_WALL,
+				WALK_TO_REFILL,
+				SHOOT_AT_WALL,
+				ATTACK_AGENT,
+				WALK_TO_OPPONENT_WALL,
+				COLOUR_OPPONENT_WALL,
+				RESPAWNING
+			};
+			static const float BehaviourCheckInterval;
+
+			void TravelToObjective(float dt);
+			void FindAmmo(float dt);
 			void ShootAtWall(float dt);
 			void AttackOpponent(float dt);
 			void Respawning(float dt);
@@ -61,15 +74,23 @@ namespace NCL {
 			float decisionWaitTimer;
 
 			NavigationGrid* navGrid;
-			NavigationPath currentPath;
+			std::shared_ptr<const NavigationPath> currentPath; //shared with anyone else given the same one
+			int pathIndex; //of the waypoint after currentPathNode, counting down
 			Vector3 currentPathNode;
 			vector<Vector3> path;
+			vector<Vector3> shownPath; //as it was last sent off to be drawn
+			float shownPathUntil; //in Debug time, when those lines run out
+
+			int pathTicket; //for the path that's on its way, or -1
+			FlowField* targetField; //followed instead of currentPath if there is one
 
 			void FindPath(const Vector3& targetPosition);
+			void SetPath(std::shared_ptr<const NavigationPath> pathToTarget, bool pathFound);
+			bool NextPathNode();
 			void FollowPath();
+			void FollowField();
 			void ShowPath();
 			void LookAt(const Vector3& target);
-			GameObject* ShootRayAt(const Vector3& target);
 			void ShootPaintAt(const Vector3& target, bool coloured);
 			bool CanSeeAgent(Agent* opponent);
 			Agent* ShouldAttack();
@@ -81,17 +102,34 @@ namespace NCL {
 			ColourBlock* TargetNextBlock();
 			ColourBlock* TargetOpponentBlock(Agent* o);
 
-			StateMachine* stateMachine;
+			StateMachineState behaviour;
+
+			bool WasIn(BehaviourState a, BehaviourState b) const;
+			bool ReturnToOwnWall();
+			bool GoToOpponentWall();
+			bool ArrivedAtOwnWall();
+			bool OutOfAmmo();
+			bool FinishedOwnWall();
+			bool ArrivedAtOpponentWall();
+			bool ChangeOpponentWall();
+			bool DefendOwnWall();
+			bool StartAttack();
+			bool StopAttackForOwnWall();
+			bool StopAttackForOpponentWall();
+			bool StartRespawn();
+			bool RespawnForRefill();
+			bool RespawnForOwnWall();
+			bool RespawnForOpponentWall();
 
-			float speed;
-			float damping;
 			float turnSpeed;
 
 			vector<Agent*> opponents;
+			vector<GameObject*> nearbyAgents; //kept, so ShouldAttack doesn't allocate
 			Agent* attackTarget;
 			Agent* wallTarget;
 
 			GameWorld* world;
+			PerceptionSystem* perception;
 		};
 	}
 }
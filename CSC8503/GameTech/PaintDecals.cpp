@@ -0,0 +1,98 @@
+#include "PaintDecals.h"
+#include "../../Common/MemoryTracker.h"
+#include <cmath>
+#include <new>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PaintDecals::~PaintDecals() {
+	for (Decal& d : decals) {
+		if (d.renderObject) {
+			d.renderObject->~RenderObject();
+			::operator delete(d.renderObject);
+		}
+	}
+}
+
+/*
+The level is all boxes lined up with the axes, so a decal is a box that's
+flat along whichever axis the surface faces most, the same as the old
+splats settled into. Once the ring is full the oldest decal is reused.
+*/
+void PaintDecals::Add(const Vector3& position, const Vector3& normal, const Vector4& colour, TextureBase* texture, int layer) {
+	if (!mesh) {
+		return; //nothing's been loaded to draw them with, as on a headless server
+	}
+	Decal& d = decals[next];
+	next = (next + 1) % Capacity;
+
+	if (!d.renderObject) {
+		//Not from RenderObject's pool, as decals outlive every level, and
+		//the pool can only be reset once nothing in it is left
+		MemoryTagScope tag(MemoryTag::Rendering);
+		d.renderObject = ::new (::operator new(sizeof(RenderObject))) RenderObject(&d.transform, mesh, texture, shader);
+		d.renderObject->SetRenderShadow(false);
+	}
+	d.renderObject->SetDefaultTexture(texture);
+	d.renderObject->SetTextureLayer(layer);
+	d.renderObject->SetColour(colour);
+
+	float x = std::abs(normal.x);
+	float y = std::abs(normal.y);
+	float z = std::abs(normal.z);
+	if (x >= y && x >= z) {
+		d.fullScale = Vector3(thickness, size, size);
+	}
+	else if (y >= x && y >= z) {
+		d.fullScale = Vector3(size, thickness, size);
+	}
+	else {
+		d.fullScale = Vector3(size, size, thickness);
+	}
+	d.transform.SetPosition(position + normal * 0.25f);
+	d.transform.SetScale(Vector3(0, 0, 0));
+
+	if (!d.active) {
+		activeCount++;
+	}
+	d.active	= true;
+	d.age		= 0.0f;
+}
+
+void PaintDecals::Update(float dt) {
+	for (Decal& d : decals) {
+		if (!d.active) {
+			continue;
+		}
+		float wasAge = d.age;
+		d.age += dt;
+		if (d.age > lifetime) {
+			d.active = false;
+			activeCount--;
+		}
+		else if (wasAge < growDuration) {
+			float t = d.age < growDuration ? d.age / growDuration : 1.0f;
+			d.transform.SetScale(d.fullScale * t);
+		}
+	}
+}
+
+void PaintDecals::Clear() {
+	for (Decal& d : decals) {
+		d.active = false;
+	}
+	activeCount = 0;
+	next		= 0;
+}
+
+void PaintDecals::GetVisible(const Frustum& frustum, std::vector<const RenderObject*>& visible) const {
+	if (activeCount == 0) {
+		return;
+	}
+	for (const Decal& d : decals) {
+		if (d.active && frustum.AABBInside(d.transform.GetPosition(), d.fullScale)) {
+			visible.emplace_back(d.renderObject);
+		}
+	}
+}
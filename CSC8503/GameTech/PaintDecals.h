@@ -0,0 +1,65 @@
+#pragma once
+#include "../CSC8503Common/Transform.h"
+#include "../CSC8503Common/RenderObject.h"
+#include "../CSC8503Common/Frustum.h"
+#include "../../Common/Vector4.h"
+#include <vector>
+
+namespace NCL {
+	class MeshGeometry;
+	namespace CSC8503 {
+		/*
+		The paint left behind wherever a projectile hits. Splats used to be
+		objects in the world, each with a physics body just to find which
+		way the surface faced, which is already known from the hit. Now
+		they're a fixed ring of decals that never go near the physics, with
+		the oldest being reused once it's full. The renderer takes whichever
+		ones the camera can see straight from here, and as they all share a
+		mesh, shader and texture they end up in one instanced draw.
+		*/
+		class PaintDecals {
+		public:
+			static const int Capacity = 512;
+
+			PaintDecals() {}
+			~PaintDecals();
+
+			//Decals all use the same mesh and shader, and only pick their texture
+			void SetAppearance(MeshGeometry* m, ShaderBase* s) {
+				mesh	= m;
+				shader	= s;
+			}
+
+			void Add(const Vector3& position, const Vector3& normal, const Vector4& colour, TextureBase* texture, int layer);
+			void Update(float dt);
+			void Clear();
+
+			void GetVisible(const Frustum& frustum, std::vector<const RenderObject*>& visible) const;
+
+			int GetActiveCount() const {
+				return activeCount;
+			}
+
+		protected:
+			struct Decal {
+				Transform		transform;
+				RenderObject*	renderObject	= nullptr;
+				Vector3			fullScale;
+				float			age				= 0.0f;
+				bool			active			= false;
+			};
+
+			Decal			decals[Capacity];
+			int				next		= 0;
+			int				activeCount = 0;
+
+			MeshGeometry*	mesh		= nullptr;
+			ShaderBase*		shader		= nullptr;
+
+			float			size			= 6.0f;
+			float			thickness		= 0.01f; //flat, but not so flat its normals break
+			float			growDuration	= 0.3f;
+			float			lifetime		= 10.0f;
+		};
+	}
+}
@@ -0,0 +1,31 @@
+#include "PaintParticles.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+void PaintParticles::Emit(const Vector3& position, const Vector3& direction, const Vector4& colour, int count,
+	float speed, float spread, float size, float lifetime) {
+	if (!enabled || count <= 0 || (int)bursts.size() >= MaxBursts) {
+		return;
+	}
+	ParticleBurst b;
+	b.position	= Vector4(position.x, position.y, position.z, 0.0f);
+	b.direction	= Vector4(direction.x, direction.y, direction.z, spread);
+	b.colour	= colour;
+	b.motion	= Vector4(speed, size, lifetime, (float)count);
+	bursts.emplace_back(b);
+}
+
+void PaintParticles::Clear() {
+	bursts.clear();
+	clearing = true;
+}
+
+void PaintParticles::Take(std::vector<ParticleBurst>& into, float& dt, bool& cleared) {
+	into.swap(bursts);
+	bursts.clear();
+	dt			= pendingTime;
+	cleared		= clearing;
+	pendingTime	= 0.0f;
+	clearing	= false;
+}
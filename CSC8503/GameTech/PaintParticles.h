@@ -0,0 +1,55 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Vector4.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		using namespace Maths;
+
+		//Laid out to match the shader's std430 Burst, so a frame's worth are copied straight over
+		struct ParticleBurst {
+			Vector4 position;	//w is the first particle it's emitting, filled in by the renderer
+			Vector4 direction;	//w is how far they spread out from it, from 0 to 1
+			Vector4 colour;
+			Vector4 motion;		//speed, size, lifetime, then how many
+		};
+
+		/*
+		Sprays of paint for shots and hits. Only whole bursts are kept here,
+		never particles - the renderer takes them once a frame, and its
+		compute shader makes, moves and kills the particles themselves, so
+		however many there are, the CPU does the same small amount of work.
+		Nothing goes near the world or physics, and until a renderer's taken
+		charge of them bursts aren't even kept, so a server pays nothing.
+		*/
+		class PaintParticles {
+		public:
+			static const int MaxBursts = 128; //a frame's worth, past which new ones are dropped
+
+			void SetEnabled(bool e) {
+				enabled = e;
+			}
+
+			void Emit(const Vector3& position, const Vector3& direction, const Vector4& colour, int count,
+				float speed, float spread, float size = 0.25f, float lifetime = 0.8f);
+
+			void Update(float dt) {
+				pendingTime += dt;
+			}
+
+			//Gets rid of every particle, as well as any bursts still waiting
+			void Clear();
+
+			//Everything since they were last taken. cleared says whether the
+			//particles already made should go
+			void Take(std::vector<ParticleBurst>& into, float& dt, bool& cleared);
+
+		protected:
+			std::vector<ParticleBurst>	bursts;
+			float						pendingTime	= 0.0f;
+			bool						clearing	= false;
+			bool						enabled		= false;
+		};
+	}
+}
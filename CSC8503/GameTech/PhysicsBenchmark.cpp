@@ -0,0 +1,402 @@
+#include "PhysicsBenchmark.h"
+#include "ColourBlock.h"
+#include "../CSC8503Common/PhysicsObject.h"
+#include "../CSC8503Common/SphereVolume.h"
+#include "../CSC8503Common/OBBVolume.h"
+#include "../CSC8503Common/AABBVolume.h"
+#include "../CSC8503Common/CapsuleVolume.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../CSC8503Common/Debug.h"
+#include "../CSC8503Common/WorldRollback.h"
+#include "../../Common/MemoryTracker.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib,"psapi.lib")
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float PhysicsBenchmark::FrameDT			= 1.0f / 60.0f;
+const float PhysicsBenchmark::ProjectileSpeed	= 40.0f;
+const float PhysicsBenchmark::RollbackTolerance	= 0.001f;
+
+PhysicsBenchmark::PhysicsBenchmark(int frames, int warmupFrames) : random(1234) {
+	this->frames		= frames;
+	this->warmupFrames	= warmupFrames;
+	wallZ			= 0.0f;
+	wallHalfWidth	= 0.0f;
+	wallHeight		= 0.0f;
+	world	= new GameWorld();
+	physics	= new PhysicsSystem(*world);
+	physics->SetStepMode(PhysicsSystem::StepMode::Fixed);
+	Debug::Initialise(); //for the physics' collision counts
+}
+
+PhysicsBenchmark::~PhysicsBenchmark() {
+	delete physics;
+	delete world;
+}
+
+const char* PhysicsBenchmark::GetSceneName(Scene s) {
+	switch (s) {
+		case Scene::Scatter:			return "Scatter";
+		case Scene::Stacks:				return "Stacks";
+		case Scene::ProjectileStorm:	return "ProjectileStorm";
+	}
+	return "";
+}
+
+/*
+The first few frames aren't counted, as everything's still falling into
+place, and the trees are filling up.
+*/
+PhysicsBenchmark::Result PhysicsBenchmark::Run(Scene scene, int objects) {
+	Result r = {};
+	r.scene		= scene;
+	r.objects	= objects;
+	r.frames	= frames;
+
+	float memoryBefore	= WorkingSetMB();
+	auto buildStart		= std::chrono::steady_clock::now();
+	BuildScene(scene, objects);
+	r.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+	FrameProfiler::SetPaused(false);
+	int substeps = 0;
+	for (int i = 0; i < warmupFrames + frames; ++i) {
+		FrameProfiler::BeginFrame();
+		physics->Update(FrameDT);
+		FrameProfiler::EndFrame();
+		RecycleProjectiles();
+		world->Prune();
+		if (i < warmupFrames) {
+			continue;
+		}
+		const FrameProfiler::Frame* f = FrameProfiler::GetFrame(0);
+		for (const FrameProfiler::Marker& m : f->markers) {
+			if (m.duration < 0.0f || m.lane != 0) {
+				continue;
+			}
+			if (strcmp(m.name, "Physics") == 0) {
+				r.physicsTime	+= m.duration;
+				r.physicsMax	= m.duration > r.physicsMax ? m.duration : r.physicsMax;
+			}
+			else if (strcmp(m.name, "Substep") == 0) {
+				r.substepTime += m.duration;
+				substeps++;
+			}
+			else if (strcmp(m.name, "Broadphase") == 0) {
+				r.broadphaseTime += m.duration;
+			}
+			else if (strcmp(m.name, "Narrowphase") == 0 || strcmp(m.name, "Collision Detection") == 0) {
+				r.narrowphaseTime += m.duration;
+			}
+			else if (strcmp(m.name, "Solver") == 0) {
+				r.solverTime += m.duration;
+			}
+		}
+		//The counts are only of the last substep, which is as good as any
+		r.broadphasePairs		+= (float)Debug::GetNumBroadphaseCollisions();
+		r.narrowphaseContacts	+= (float)Debug::GetNumNarrowphaseCollisions();
+	}
+	r.memory = WorkingSetMB() - memoryBefore;
+
+	float perFrame			= 1.0f / (float)frames;
+	r.physicsTime			*= perFrame;
+	r.substepTime			= substeps ? r.substepTime / (float)substeps : 0.0f;
+	r.broadphaseTime		*= perFrame;
+	r.narrowphaseTime		*= perFrame;
+	r.solverTime			*= perFrame;
+	r.broadphasePairs		*= perFrame;
+	r.narrowphaseContacts	*= perFrame;
+
+	ClearScene();
+	return r;
+}
+
+void PhysicsBenchmark::BuildScene(Scene scene, int objects) {
+	switch (scene) {
+		case Scene::Scatter:			BuildScatter(objects);			break;
+		case Scene::Stacks:				BuildStacks(objects);			break;
+		case Scene::ProjectileStorm:	BuildProjectileStorm(objects);	break;
+	}
+	world->BuildStaticTree();
+	world->Prune(); //which is what finds the awake objects for the physics, as the game does at the end of each frame
+}
+
+void PhysicsBenchmark::ClearScene() {
+	physics->Clear();
+	world->ClearAndErase();
+	projectiles.clear();
+}
+
+void PhysicsBenchmark::Step() {
+	physics->Update(FrameDT);
+	RecycleProjectiles();
+	world->Prune();
+}
+
+/*
+Both runs start from a restore, rather than the first carrying straight
+on from the save, as a restore starts the contacts from cold - so the
+only thing that can tell them apart is something the ring didn't put
+back. The projectiles' random numbers are put back too, as they're the
+benchmark's, not the world's. A little drift's allowed for all the
+same, in case the jobs ever sum something up in a different order.
+*/
+PhysicsBenchmark::RollbackResult PhysicsBenchmark::CheckRollback(Scene scene, int objects, int ticks) {
+	RollbackResult r = {};
+	r.scene		= scene;
+	r.objects	= objects;
+
+	BuildScene(scene, objects);
+	for (int i = 0; i < warmupFrames; ++i) {
+		Step();
+	}
+	std::vector<GameObject*> bodies;
+	world->OperateOnContents(
+		[&](GameObject* o) {
+			if (o->GetPhysicsObject() && !o->IsStatic()) {
+				bodies.emplace_back(o);
+			}
+		}
+	);
+	{
+		WorldRollback rollback(*world, *physics, RollbackFrames, (int)bodies.size());
+		for (int tick = 0; tick < RollbackFrames; ++tick) {
+			if (tick > 0) {
+				Step();
+			}
+			rollback.Save(tick);
+		}
+
+		/*
+		Both runs save the ticks they resimulate, as a rollback would, until
+		they'd be about to overwrite the one they started from. The second
+		run's saves go into the same frames the first run's did, holding the
+		same states, so they're what's counted - a rollback that's done the
+		same thing before shouldn't be allocating to do it again.
+		*/
+		const int savedTick = RollbackFrames - 1;
+		std::mt19937 savedRandom = random;
+		std::vector<Vector3> positions;
+		std::vector<Vector3> velocities;
+		uint64_t allocations = 0;
+		r.restored = true;
+		for (int run = 0; run < 2 && r.restored; ++run) {
+			r.restored	= rollback.Restore(savedTick);
+			random		= savedRandom;
+			for (int i = 0; i < ticks; ++i) {
+				Step();
+				if (i < RollbackFrames - 1) {
+					uint64_t before = MemoryTracker::GetThreadAllocations().allocations;
+					rollback.Save(savedTick + i + 1);
+					allocations += run == 1 ? MemoryTracker::GetThreadAllocations().allocations - before : 0;
+				}
+			}
+			for (size_t i = 0; i < bodies.size(); ++i) {
+				Vector3 position = bodies[i]->GetTransform().GetPosition();
+				Vector3 velocity = bodies[i]->GetPhysicsObject()->GetLinearVelocity();
+				if (run == 0) {
+					positions.emplace_back(position);
+					velocities.emplace_back(velocity);
+					continue;
+				}
+				float positionError = (position - positions[i]).Length();
+				float velocityError = (velocity - velocities[i]).Length();
+				r.positionError = positionError > r.positionError ? positionError : r.positionError;
+				r.velocityError = velocityError > r.velocityError ? velocityError : r.velocityError;
+			}
+		}
+		r.saveAllocations = (float)allocations / (float)(RollbackFrames - 1);
+	}
+	//A velocity's allowed to be as far out as would move a body that far in a frame
+	r.passed = r.restored && r.positionError <= RollbackTolerance && r.velocityError <= RollbackTolerance / FrameDT && r.saveAllocations == 0.0f;
+
+	ClearScene();
+	return r;
+}
+
+int PhysicsBenchmark::CheckAllRollbacks(const std::vector<int>& counts) {
+	int failed = 0;
+	const Scene scenes[] = { Scene::Scatter, Scene::Stacks, Scene::ProjectileStorm };
+	for (Scene s : scenes) {
+		for (int n : counts) {
+			RollbackResult r = CheckRollback(s, n);
+			std::cout << std::fixed << std::setprecision(6) << GetSceneName(s) << " x" << n
+				<< ": " << (r.passed ? "passed" : "FAILED") << (r.restored ? "" : " (couldn't restore)")
+				<< ", position error " << r.positionError << ", velocity error " << r.velocityError
+				<< ", " << r.saveAllocations << " allocations per save" << std::endl;
+			failed += r.passed ? 0 : 1;
+		}
+	}
+	return failed;
+}
+
+void PhysicsBenchmark::RunAll(const std::vector<int>& counts, const std::string& csvFile) {
+	std::ofstream csv(csvFile);
+	csv << "scene,objects,frames,build_ms,physics_ms,physics_max_ms,substep_ms,broadphase_ms,narrowphase_ms,solver_ms,broadphase_pairs,narrowphase_contacts,memory_mb\n";
+
+	const Scene scenes[] = { Scene::Scatter, Scene::Stacks, Scene::ProjectileStorm };
+	for (Scene s : scenes) {
+		for (int n : counts) {
+			Result r = Run(s, n);
+			std::cout << std::fixed << std::setprecision(3) << GetSceneName(s) << " x" << n
+				<< ": physics " << r.physicsTime << "ms (max " << r.physicsMax << "), substep " << r.substepTime
+				<< "ms, broadphase " << r.broadphaseTime << "ms, narrowphase " << r.narrowphaseTime
+				<< "ms, solver " << r.solverTime << "ms, " << r.broadphasePairs << " pairs, "
+				<< r.narrowphaseContacts << " contacts, " << r.memory << "MB" << std::endl;
+			if (csv) {
+				csv << GetSceneName(s) << "," << r.objects << "," << r.frames << "," << r.buildTime << ","
+					<< r.physicsTime << "," << r.physicsMax << "," << r.substepTime << "," << r.broadphaseTime << ","
+					<< r.narrowphaseTime << "," << r.solverTime << "," << r.broadphasePairs << ","
+					<< r.narrowphaseContacts << "," << r.memory << "\n";
+			}
+		}
+	}
+}
+
+//About one object to every 3x3x3 space, whatever the count, so only the scale changes
+void PhysicsBenchmark::BuildScatter(int objects) {
+	const float spacing = 3.0f;
+	int perSide		= (int)ceil(cbrt((float)objects));
+	float halfWidth	= perSide * spacing * 0.5f + 2.0f;
+	AddBox(halfWidth, perSide * spacing + 4.0f);
+
+	std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+	for (int i = 0; i < objects; ++i) {
+		Vector3 position(
+			(i % perSide) * spacing - halfWidth + spacing,
+			((i / perSide) % perSide) * spacing + 2.0f,
+			(i / (perSide * perSide)) * spacing - halfWidth + spacing);
+		position += Vector3(jitter(random), jitter(random), jitter(random));
+
+		switch (i % 3) {
+			case 0: {
+				AddBody(new SphereVolume(0.5f), position, Vector3(0.5f, 0.5f, 0.5f), 1.0f)->GetPhysicsObject()->InitSphereInertia();
+			}break;
+			case 1: {
+				AddBody(new OBBVolume(Vector3(0.5f, 0.5f, 0.5f)), position, Vector3(1, 1, 1), 1.0f)->GetPhysicsObject()->InitCubeInertia();
+			}break;
+			case 2: {
+				AddBody(new CapsuleVolume(0.75f, 0.4f), position, Vector3(0.8f, 0.75f, 0.8f), 1.0f)->GetPhysicsObject()->InitCubeInertia();
+			}break;
+		}
+	}
+}
+
+void PhysicsBenchmark::BuildStacks(int objects) {
+	const int height		= 10;
+	const float spacing		= 2.5f;
+	int columns				= (objects + height - 1) / height;
+	int perSide				= (int)ceil(sqrt((float)columns));
+	float halfWidth			= perSide * spacing * 0.5f + 2.0f;
+	AddBox(halfWidth, 2.0f);
+
+	for (int i = 0; i < objects; ++i) {
+		int column = i / height;
+		Vector3 position(
+			(column % perSide) * spacing - halfWidth + spacing,
+			(i % height) * 1.01f + 0.505f,
+			(column / perSide) * spacing - halfWidth + spacing);
+		AddBody(new OBBVolume(Vector3(0.5f, 0.5f, 0.5f)), position, Vector3(1, 1, 1), 1.0f)->GetPhysicsObject()->InitCubeInertia();
+	}
+}
+
+//A wall of ColourBlocks, with the projectiles strung out in front of it
+void PhysicsBenchmark::BuildProjectileStorm(int objects) {
+	const int blocksWide	= 40;
+	const int blocksHigh	= 15;
+	wallZ			= 0.0f;
+	wallHalfWidth	= (float)blocksWide;
+	wallHeight		= blocksHigh * 2.0f;
+	AddBox(wallHalfWidth + 20.0f, 0.0f);
+
+	for (int y = 0; y < blocksHigh; ++y) {
+		for (int x = 0; x < blocksWide; ++x) {
+			ColourBlock* block = new ColourBlock();
+			Vector3 dimensions(1, 1, 0.5f);
+			block->SetBoundingVolume((CollisionVolume*)new AABBVolume(dimensions));
+			block->GetTransform()
+				.SetPosition(Vector3(x * 2.0f - wallHalfWidth + 1.0f, y * 2.0f + 1.0f, wallZ))
+				.SetScale(dimensions * 2);
+			block->SetPhysicsObject(new PhysicsObject(&block->GetTransform(), block->GetBoundingVolume()));
+			block->GetPhysicsObject()->SetInverseMass(0);
+			block->GetPhysicsObject()->InitCubeInertia();
+			world->AddGameObject(block);
+		}
+	}
+
+	std::uniform_real_distribution<float> depth(0.0f, 80.0f);
+	for (int i = 0; i < objects; ++i) {
+		GameObject* o = AddBody(new SphereVolume(0.3f), Vector3(), Vector3(0.3f, 0.3f, 0.3f), 10.0f);
+		o->GetPhysicsObject()->InitSphereInertia();
+		o->GetPhysicsObject()->SetUseGravity(false);
+		o->GetPhysicsObject()->SetCanSleep(false);
+		LaunchProjectile(o);
+		o->GetTransform().SetPosition(o->GetTransform().GetPosition() - Vector3(0, 0, depth(random)));
+		projectiles.emplace_back(o);
+	}
+}
+
+void PhysicsBenchmark::LaunchProjectile(GameObject* o) {
+	std::uniform_real_distribution<float> across(-wallHalfWidth, wallHalfWidth);
+	std::uniform_real_distribution<float> up(0.5f, wallHeight);
+	o->GetTransform().SetPosition(Vector3(across(random), up(random), wallZ - 20.0f));
+	o->GetPhysicsObject()->SetLinearVelocity(Vector3(0, 0, ProjectileSpeed));
+	o->GetPhysicsObject()->SetAngularVelocity(Vector3());
+	o->GetPhysicsObject()->RequestWake();
+}
+
+//Anything that's hit the wall, or got past it, goes back to the start
+void PhysicsBenchmark::RecycleProjectiles() {
+	for (GameObject* o : projectiles) {
+		float z		= o->GetTransform().GetPosition().z;
+		float speed	= o->GetPhysicsObject()->GetLinearVelocity().z;
+		if (z > wallZ + 1.0f || speed < ProjectileSpeed * 0.5f) {
+			LaunchProjectile(o);
+		}
+	}
+}
+
+//A floor, and walls around it to keep things in, if they're given a height
+void PhysicsBenchmark::AddBox(float halfWidth, float wallHeight) {
+	AddBody(new AABBVolume(Vector3(halfWidth, 1, halfWidth)), Vector3(0, -1, 0), Vector3(halfWidth, 1, halfWidth) * 2, 0.0f)->SetLayer(CollisionLayer::FLOOR);
+	if (wallHeight <= 0.0f) {
+		return;
+	}
+	Vector3 sides(1, wallHeight * 0.5f, halfWidth);
+	Vector3 ends(halfWidth, wallHeight * 0.5f, 1);
+	AddBody(new AABBVolume(sides), Vector3(-halfWidth - 1, wallHeight * 0.5f, 0), sides * 2, 0.0f);
+	AddBody(new AABBVolume(sides), Vector3(halfWidth + 1, wallHeight * 0.5f, 0), sides * 2, 0.0f);
+	AddBody(new AABBVolume(ends), Vector3(0, wallHeight * 0.5f, -halfWidth - 1), ends * 2, 0.0f);
+	AddBody(new AABBVolume(ends), Vector3(0, wallHeight * 0.5f, halfWidth + 1), ends * 2, 0.0f);
+}
+
+GameObject* PhysicsBenchmark::AddBody(CollisionVolume* volume, const Vector3& position, const Vector3& scale, float inverseMass) {
+	GameObject* o = new GameObject("Benchmark Body");
+	o->SetBoundingVolume(volume);
+	o->GetTransform()
+		.SetScale(scale)
+		.SetPosition(position);
+	o->SetPhysicsObject(new PhysicsObject(&o->GetTransform(), o->GetBoundingVolume()));
+	o->GetPhysicsObject()->SetInverseMass(inverseMass);
+	if (inverseMass == 0) {
+		o->GetPhysicsObject()->InitCubeInertia();
+	}
+	world->AddGameObject(o);
+	return o;
+}
+
+float PhysicsBenchmark::WorkingSetMB() {
+	PROCESS_MEMORY_COUNTERS pmc;
+	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+	return pmc.WorkingSetSize / (1024.0f * 1024.0f);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/PhysicsSystem.h"
+#include <vector>
+#include <string>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Builds synthetic scenes with no window, renderer or assets, and times
+		the physics on them, so a broadphase or solver change can be checked
+		without playing the game. Each scene is run for every object count
+		asked for, with the physics in its fixed step mode so every run does
+		the same work, and the frames are timed by the FrameProfiler's
+		markers, so the split between broadphase, narrowphase and solving
+		comes from the same places the in-game profiler shows.
+
+		Scatter is a mix of spheres, OBBs and capsules dropped into a walled
+		box. Stacks is columns of cubes resting on each other, which is the
+		solver's worst case. ProjectileStorm fires spheres at a wall of
+		ColourBlocks, recycling each once it's hit or gone past.
+
+		The same scenes check the WorldRollback too: a tick's saved, stepped
+		on from, put back and stepped on from again, and both runs have to
+		end up in the same place - without saving the resimulated ticks a
+		second time having allocated.
+		*/
+		class PhysicsBenchmark {
+		public:
+			enum class Scene {
+				Scatter,
+				Stacks,
+				ProjectileStorm
+			};
+
+			struct Result {
+				Scene	scene;
+				int		objects;
+				int		frames;
+				float	buildTime;		//ms
+				float	physicsTime;	//ms per frame, on average
+				float	physicsMax;
+				float	substepTime;	//ms per substep
+				float	broadphaseTime;	//ms per frame
+				float	narrowphaseTime;
+				float	solverTime;
+				float	broadphasePairs;	//per substep
+				float	narrowphaseContacts;
+				float	memory;			//MB more than before the scene was built
+			};
+
+			struct RollbackResult {
+				Scene	scene;
+				int		objects;
+				bool	restored;
+				float	positionError;	//the furthest any body ended up from where it did the first time
+				float	velocityError;
+				float	saveAllocations;	//per save, saving the same ticks again
+				bool	passed;
+			};
+
+			PhysicsBenchmark(int frames = 300, int warmupFrames = 60);
+			~PhysicsBenchmark();
+
+			Result Run(Scene scene, int objects);
+			//Every scene at every count, printed as they finish, and written out as CSV
+			void RunAll(const std::vector<int>& counts, const std::string& csvFile = "PhysicsBenchmark.csv");
+
+			RollbackResult CheckRollback(Scene scene, int objects, int ticks = 60);
+			//Every scene at every count, printed as they finish, returning how many failed
+			int CheckAllRollbacks(const std::vector<int>& counts);
+
+			static const char* GetSceneName(Scene s);
+
+		protected:
+			void BuildScene(Scene scene, int objects);
+			void ClearScene();
+			void Step();
+
+			void BuildScatter(int objects);
+			void BuildStacks(int objects);
+			void BuildProjectileStorm(int objects);
+			void RecycleProjectiles();
+			void LaunchProjectile(GameObject* o);
+
+			void AddBox(float halfWidth, float wallHeight);
+			GameObject* AddBody(CollisionVolume* volume, const Vector3& position, const Vector3& scale, float inverseMass);
+
+			static float WorkingSetMB();
+
+			GameWorld*		world;
+			PhysicsSystem*	physics;
+			std::mt19937	random;
+
+			int		frames;
+			int		warmupFrames;
+
+			std::vector<GameObject*> projectiles;
+			float	wallZ;
+			float	wallHalfWidth;
+			float	wallHeight;
+
+			static const float FrameDT;
+			static const float ProjectileSpeed;
+			static const float RollbackTolerance;
+			static const int RollbackFrames = 16;
+		};
+	}
+}
@@ -1,27 +1,22 @@
 #include "Player.h"
 #include "Opponent.h"
 #include "LevelManager.h"
+#include "Projectile.h"
 
 #include "../CSC8503Common/GameWorld.h"
 #include "../../Common/Window.h"
 
 NCL::CSC8503::Player::Player(int agentID, Camera* cam, Vector3 offset, GameWorld* gameWorld, LevelManager* l, vector<ColourBlock*>& wall, const Vector3& startPoint) : Agent(agentID, l, startPoint, wall) {
 	name = "Player";
+	typeID = ObjectType::Player;
 
 	camera = cam;
 	world = gameWorld;
 
-	speed = 20.0f;
-	jumpForce = 350.0f;
-	damping = 0.98f;
-
-	grounded = false;
-	jumpCooldownDuration = 0.15f;
-	jumpCooldownTimer = 0.15f;
-
 	paintShotRate = 0.3f;
 	paintShotTimer = 0.3f;
 	paintShotForce = 10;
+	paintSplashRadius = 1.5f;
 
 	thirdPerson = false;
 	controlling = true;
@@ -65,7 +60,9 @@ void NCL::CSC8503::Player::Update(float dt) {
 
 	if (controlling) {
 		UpdateMouse();
-		UpdateKeys();
+		AgentInput input = SampleInput();
+		pendingButtons |= input.buttons;
+		ApplyInput(input);
 	}
 
 	if (cameraAttached) {
@@ -80,25 +77,17 @@ void NCL::CSC8503::Player::Update(float dt) {
 	}
 
 	UpdateGun(dt);
-
-	// Avoid rotating player
-	GetPhysicsObject()->SetAngularVelocity(Vector3(0, 0, 0));
-	transform.SetOrientation(Quaternion::EulerAnglesToQuaternion(0, transform.GetOrientation().ToEuler().y, 0));
-
-	// Dampen the player movement to feel more responsive
-	GetPhysicsObject()->SetLinearVelocity(GetPhysicsObject()->GetLinearVelocity() * Vector3(damping, 1, damping));
+	Stabilise();
 }
 
 void NCL::CSC8503::Player::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (otherObject->GetLayer() == CollisionLayer::FLOOR && jumpCooldownTimer > jumpCooldownDuration) {
-		grounded = true;
-	}
+	Agent::OnCollisionBegin(otherObject, point);
 
-	if (otherObject->GetName() == "Refill Point") {
+	if (otherObject->GetTypeID() == ObjectType::RefillPoint) {
 		paintAmmo = 12;
 	}
 
-	if (otherObject->GetName() == "Projectile") {
+	if (otherObject->GetTypeID() == ObjectType::Projectile) {
 		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("hurt.wav"), SoundPriority::SOUNDPRIORITY_HIGH, (((float)rand() / RAND_MAX) * 0.6f) + 0.7f);
 		health -= 20.0f;
 		if (health <= 0) {
@@ -152,29 +141,29 @@ void NCL::CSC8503::Player::UpdateMouse() {
 	}
 }
 
-void NCL::CSC8503::Player::UpdateKeys() {
+AgentInput NCL::CSC8503::Player::SampleInput() const {
+	AgentInput input;
+	input.yaw = yaw;
 
 	// WASD
 	if (Window::GetKeyboard()->KeyDown(KeyboardKeys::W)) {
-		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(0, 0, -1) * speed);
+		input.buttons |= AgentInput::Forward;
 	}
 	if (Window::GetKeyboard()->KeyDown(KeyboardKeys::S)) {
-		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(0, 0, 1) * speed);
+		input.buttons |= AgentInput::Back;
 	}
 	if (Window::GetKeyboard()->KeyDown(KeyboardKeys::A)) {
-		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(-1, 0, 0) * speed);
+		input.buttons |= AgentInput::Left;
 	}
 	if (Window::GetKeyboard()->KeyDown(KeyboardKeys::D)) {
-		GetPhysicsObject()->AddForce(transform.GetOrientation() * Vector3(1, 0, 0) * speed);
+		input.buttons |= AgentInput::Right;
 	}
 
 	// Jump
-	if (grounded && Window::GetKeyboard()->KeyPressed(KeyboardKeys::SPACE)) {
-		GetPhysicsObject()->SetLinearVelocity(GetPhysicsObject()->GetLinearVelocity() * Vector3(1, 0, 1));
-		GetPhysicsObject()->AddForce(Vector3(0, 1, 0) * jumpForce);
-		grounded = false;
-		jumpCooldownTimer = 0;
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::SPACE)) {
+		input.buttons |= AgentInput::Jump;
 	}
+	return input;
 }
 
 void NCL::CSC8503::Player::UpdateGun(float dt) {
@@ -209,10 +198,12 @@ void NCL::CSC8503::Player::ShootPaint(bool coloured) {
 	}
 	else {
 		Quaternion camRot = Quaternion::EulerAnglesToQuaternion(camera->GetPitch(), camera->GetYaw(), 0);
-		GameObject* projectile = (GameObject*)level->AddProjectile(camera->GetPosition() + camRot * Vector3(0, 0, -4), coloured);
+		Projectile* projectile = level->AddProjectile(camera->GetPosition() + camRot * Vector3(0, 0, -4), coloured);
+		projectile->SetSplashRadius(paintSplashRadius);
 		projectile->GetTransform().SetOrientation(Quaternion::EulerAnglesToQuaternion(camera->GetPitch() + 90, camera->GetYaw(), 90));
 		projectile->GetRenderObject()->SetColour(coloured ? Vector4((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX, 1) : Vector4(1, 1, 1, 1));
 		projectile->GetPhysicsObject()->ApplyLinearImpulse(camRot * Vector3(0, 0, -1) * paintShotForce);
+		level->AddPaintSpray(projectile->GetTransform().GetPosition(), camRot * Vector3(0, 0, -1), projectile->GetRenderObject()->GetColour());
 	}
 }
 
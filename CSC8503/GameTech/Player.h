@@ -66,10 +66,23 @@ namespace NCL {
 				return firingInfo;
 			}
 
+			//Everything pressed since the last call, so that a jump that only
+			//lasted a frame still gets sent to the server
+			AgentInput ConsumeInput() {
+				AgentInput input;
+				input.buttons	= pendingButtons;
+				input.yaw		= yaw;
+				pendingButtons	= 0;
+				return input;
+			}
+
+			//Follows the camera rather than the player, so isn't attached
+			void SetGunObj(GameObject* gun) override { paintGun = gun; }
+
 		protected:
 
 			void UpdateMouse();
-			void UpdateKeys();
+			AgentInput SampleInput() const;
 			void UpdateGun(float dt) override;
 
 			GameObject* ShootRay();
@@ -83,19 +96,13 @@ namespace NCL {
 			float paintShotRate;
 			float paintShotTimer;
 			float paintShotForce;
-
-			bool grounded;
-			float jumpCooldownDuration;
-			float jumpCooldownTimer;
-
-			float speed;
-			float jumpForce;
-			float damping;
+			float paintSplashRadius;
 
 			bool controlling;
 			bool cameraActive;
 
 			int firingInfo = -1; // -1 no fire, 0 is left fire, 1 is right fire
+			int pendingButtons = 0;
 
 			// Camera properties
 			bool cameraAttached = false;
@@ -1,5 +1,6 @@
 #include "Projectile.h"
 #include "LevelManager.h"
+#include "ColourBlock.h"
 
 #include "../CSC8503Common/GameWorld.h"
 #include "../CSC8503Common/SoundSystem.h"
@@ -10,22 +11,80 @@ NCL::CSC8503::Projectile::Projectile(GameWorld* g, LevelManager* l, bool c) {
 	colourProjectile = c;
 
 	name = "Projectile";
+	typeID = ObjectType::Projectile;
 	lifetime = 10.0f;
 	timeAlive = 0;
+	splashRadius = 0.0f;
 	isTrigger = true;
+	triggerContacts = true; //the paint splats need the surface normal
+	pooled = false;
+	parallelUpdate = true; //it only counts down its own lifetime
 }
 
 void NCL::CSC8503::Projectile::Update(float dt) {
 	timeAlive += dt;
 	if (timeAlive >= lifetime) {
+		Expire();
+	}
+}
+
+//Sleeping as well, so the world leaves it out of its awake list until it's woken again
+void NCL::CSC8503::Projectile::Expire() {
+	if (!pooled) {
 		Remove();
+		return;
 	}
+	isActive	= false;
+	isSleeping	= true;
+	SetTickInterval(0);
+}
+
+void NCL::CSC8503::Projectile::Reactivate(const Vector3& position, bool c) {
+	colourProjectile	= c;
+	timeAlive			= 0;
+	splashRadius		= 0.0f; //it's up to whoever fired it this time
+	isActive			= true;
+	SetTickInterval(1);
+
+	transform.SetPosition(position);
+	transform.SetOrientation(Quaternion());
+	transform.ClearPreviousState(); //so it isn't drawn sliding over from where it was last used
+
+	physicsObject->SetLinearVelocity(Vector3());
+	physicsObject->SetAngularVelocity(Vector3());
+	physicsObject->ClearForces();
+	physicsObject->SetSleepTimer(0.0f);
+	physicsObject->ClearWakeRequest();
+	UpdateBroadphaseAABB();
+
+	world->WakeObject(this);
 }
 
 void NCL::CSC8503::Projectile::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (otherObject->GetName() != "Agent" && otherObject->GetName() != "Player" && otherObject->GetName() != "Opponent" && otherObject->GetName() != "Refill Point") {
-		level->AddPaintSplat(transform.GetPosition(), point.penetration, point.normal)->GetRenderObject()->SetColour(renderObject->GetColour());
+	if (!isActive) {
+		return; //it's already hit something else this frame
+	}
+	if (!ObjectType::IsAgent(otherObject->GetTypeID()) && otherObject->GetTypeID() != ObjectType::RefillPoint) {
+		level->AddPaintSplat(transform.GetPosition(), point.normal, renderObject->GetColour());
+		PaintSplash(otherObject);
 	}
 	SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("paintsplat.wav"), transform.GetPosition(), 150);
-	Remove();
+	Expire();
+}
+
+namespace {
+	//Only ever used from collision callbacks, so one buffer does for every projectile
+	std::vector<NCL::CSC8503::GameObject*> splashHits;
+}
+
+//The block it hit paints itself, from its own collision callback
+void NCL::CSC8503::Projectile::PaintSplash(GameObject* hitObject) {
+	if (splashRadius <= 0.0f || !world->OverlapSphere(transform.GetPosition(), splashRadius, splashHits)) {
+		return;
+	}
+	for (GameObject* o : splashHits) {
+		if (o != hitObject && o->GetTypeID() == ObjectType::ColourBlock) {
+			static_cast<ColourBlock*>(o)->Paint(colourProjectile, renderObject->GetColour());
+		}
+	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../CSC8503Common/GameObject.h"
+#include "ObjectType.h"
 
 namespace NCL {
 	namespace CSC8503 {
@@ -18,15 +19,30 @@ namespace NCL {
 
 			bool IsColoured() const { return colourProjectile; }
 
+			//Pooled projectiles are switched off when they hit something or run
+			//out of time, rather than being removed from the world
+			void SetPooled(bool p) { pooled = p; }
+			bool IsPooled() const { return pooled; }
+
+			void Reactivate(const Vector3& position, bool colourProjectile);
+
+			//Every colour block this close to where it lands is painted too, not just the one it hits
+			void SetSplashRadius(float radius) { splashRadius = radius; }
+			float GetSplashRadius() const { return splashRadius; }
 
 		protected:
+			void Expire();
+			void PaintSplash(GameObject* hitObject);
+
 			GameWorld* world;
 			LevelManager* level;
 
 			float lifetime;
 			float timeAlive;
+			float splashRadius;
 
 			bool colourProjectile;
+			bool pooled;
 		};
 	}
 }
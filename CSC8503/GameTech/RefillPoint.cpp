@@ -3,6 +3,7 @@
 
 NCL::CSC8503::RefillPoint::RefillPoint() {
 	name = "Refill Point";
+	typeID = ObjectType::RefillPoint;
 
 	cooldownDuration = 15.0f;
 	cooldownTimer = 0;
@@ -11,6 +12,12 @@ NCL::CSC8503::RefillPoint::RefillPoint() {
 	rotationSpeed = 0.5f;
 }
 
+NCL::CSC8503::RefillPoint::~RefillPoint() {
+	if (lights) {
+		lights->RemoveSteady(lightID);
+	}
+}
+
 void NCL::CSC8503::RefillPoint::Update(float dt) {
 	cooldownTimer += dt;
 	if (cooldownTimer > cooldownDuration && !isActive) {
@@ -21,7 +28,7 @@ void NCL::CSC8503::RefillPoint::Update(float dt) {
 }
 
 void NCL::CSC8503::RefillPoint::OnCollisionBegin(GameObject* otherObject, CollisionDetection::ContactPoint point) {
-	if (otherObject->GetName() == "Player" || otherObject->GetName() == "Opponent") {
+	if (otherObject->GetTypeID() == ObjectType::Player || otherObject->GetTypeID() == ObjectType::Opponent) {
 		Deactivate();
 		cooldownTimer = 0;
 		SoundSystem::GetSoundSystem()->PlayTriggerSound(Sound::GetSound("powerup.wav"), transform.GetPosition(), 100);
@@ -32,10 +39,18 @@ void NCL::CSC8503::RefillPoint::Activate() {
 	GetRenderObject()->SetColour(Vector4(0, 1, 0, 1));
 	SetLayer(CollisionLayer::DEFAULT);
 	isActive = true;
+	UpdateLight();
 }
 
 void NCL::CSC8503::RefillPoint::Deactivate() {
 	GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
 	SetLayer(CollisionLayer::IGNORE_DEFAULT);
 	isActive = false;
+	UpdateLight();
+}
+
+void NCL::CSC8503::RefillPoint::UpdateLight() {
+	if (lights) {
+		lights->SetSteadyColour(lightID, isActive ? Vector4(0.3f, 1.5f, 0.3f, 1.0f) : Vector4(0.4f, 0.05f, 0.05f, 1.0f));
+	}
 }
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "../CSC8503Common/GameObject.h"
+#include "ObjectType.h"
+#include "DynamicLights.h"
 
 namespace NCL {
 	namespace CSC8503 {
 		class RefillPoint : public GameObject {
 		public:
 			RefillPoint();
-			~RefillPoint() {};
+			~RefillPoint();
 
 			void Update(float dt) override;
 
@@ -15,12 +17,23 @@ namespace NCL {
 
 			bool IsActive() const { return isActive; }
 
+			//The glow it gives off, which is dimmed while it's recharging
+			void SetLight(DynamicLights* l, int light) {
+				lights	= l;
+				lightID	= light;
+				UpdateLight();
+			}
+
 		protected:
 			virtual void Activate();
 			void Deactivate();
+			void UpdateLight();
 
 			bool isActive;
 
+			DynamicLights*	lights	= nullptr;
+			int				lightID	= -1;
+
 			float cooldownTimer;
 			float cooldownDuration;
 
@@ -0,0 +1,420 @@
+#include "RenderBenchmark.h"
+#include "GPUTimer.h"
+#include "../CSC8503Common/CapsuleVolume.h"
+#include "../CSC8503Common/Debug.h"
+#include "../../Common/Maths.h"
+#include "../../Common/Quaternion.h"
+#include "../../Common/Window.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float RenderBenchmark::FrameDT		= 1.0f / 60.0f;
+const float RenderBenchmark::WallSpacing	= 12.0f;
+const float RenderBenchmark::GuardRadius	= 3.0f;
+const float RenderBenchmark::GuardSpeed		= 60.0f;
+
+//Far enough back that the GPU timer's either handed a frame's times over, or dropped them
+static const int CollectAge = GPUTimer::FramesInFlight + 1;
+
+RenderBenchmark::RenderBenchmark(int blocks, const std::string& csvFile) : Game(false), random(1234) {
+	blockCount		= blocks > 0 ? blocks : 1;
+	this->csvFile	= csvFile;
+	frame			= 0;
+	nextSplat		= 0;
+	collected		= 0;
+}
+
+/*
+Loading finishing sends the game to the menu, which is where the scene
+gets built instead. It stays in the menu state, as that's the one the UI
+is happy to be in with no players, though it's not drawn.
+*/
+void RenderBenchmark::ChangeState(State newState) {
+	if (newState == State::MAIN_MENU) {
+		BuildScene();
+	}
+	activeState = newState;
+}
+
+void RenderBenchmark::UpdateGame(float dt) {
+	if (activeState == State::LOADING) {
+		UpdateLoadingState(dt);
+		return;
+	}
+	if (frame < WarmupFrames + PathFrames + CollectAge) {
+		StepFrame();
+	}
+	Collect(false);
+	if (frame == WarmupFrames + PathFrames + CollectAge) {
+		Collect(true);
+		Finish();
+		isPlaying = false;
+	}
+}
+
+/*
+Walls run along x, one behind the other, with lanes between them wide
+enough for the guards to walk round in. Blocks fill the walls from the
+bottom up, so a count that isn't a whole number of walls just leaves the
+last one short.
+*/
+void RenderBenchmark::BuildScene() {
+	levelManager->FinishLevelAssets();
+	world->ClearAndErase();
+	perception->Clear();
+	physics->Clear();
+	levelManager->GetPaintDecals().Clear();
+	levelManager->GetPaintParticles().Clear();
+	levelManager->GetDynamicLights().Clear();
+	InitListener();
+	guards.clear();
+	splatSpots.clear();
+
+	renderer->SetUI(nullptr); //it'd only be drawing the loading screen again
+	renderer->SetVerticalSync(VerticalSyncState::VSync_OFF);
+	renderer->SetTargetFrameTime(0.0f); //timings are only comparable at full resolution
+	world->GetMainCamera()->SetNearPlane(0.1f);
+	world->GetMainCamera()->SetFarPlane(500.0f);
+	srand(1234); //the splats pick their shapes with rand
+
+	const int perWall	= WallLength * WallHeight;
+	const int walls		= (blockCount + perWall - 1) / perWall;
+	sceneSize = Vector3(WallLength * 2.0f, WallHeight * 2.0f, walls * WallSpacing);
+
+	Vector3 centre(sceneSize.x * 0.5f, 0, sceneSize.z * 0.5f);
+	levelManager->AddFloorToWorld(centre - Vector3(0, 2, 0), Vector3(sceneSize.x * 0.5f + 40.0f, 2, sceneSize.z * 0.5f + 40.0f));
+
+	const Vector4 colours[] = { Debug::RED, Debug::GREEN, Debug::BLUE, Debug::YELLOW };
+	std::uniform_int_distribution<int> colour(0, 3);
+	std::vector<Vector3> blockPositions;
+	for (int b = 0; b < blockCount; ++b) {
+		int wall	= b / perWall;
+		int index	= b % perWall;
+		Vector3 position((index % WallLength) * 2.0f + 1.0f, (index / WallLength) * 2.0f + 1.0f, (wall + 0.5f) * WallSpacing);
+		ColourBlock* block = levelManager->AddColourBlock(position, Vector3(1, 1, 1));
+		if (b % 2) {
+			block->GetRenderObject()->SetColour(colours[colour(random)]);
+		}
+		blockPositions.emplace_back(position);
+	}
+
+	//Lanes are between the walls, and either side of them
+	const int lanes		= walls + 1;
+	const int perLane	= (GuardCount + lanes - 1) / lanes;
+	for (int g = 0; g < GuardCount; ++g) {
+		Vector3 guardCentre(((g / lanes) + 0.5f) * sceneSize.x / perLane, 0, (g % lanes) * WallSpacing);
+		AddGuard(guardCentre, g * 37.0f);
+	}
+
+	//Three in four splats go on the walls' faces, the rest on the floor in the lanes
+	std::uniform_int_distribution<int> anyBlock(0, blockCount - 1);
+	std::uniform_real_distribution<float> along(0.0f, sceneSize.x);
+	std::uniform_int_distribution<int> anyLane(0, lanes - 1);
+	for (int s = 0; s < SplatCount; ++s) {
+		SplatSpot spot;
+		if (s % 4) {
+			spot.normal		= Vector3(0, 0, (s % 2) ? 1.0f : -1.0f);
+			spot.position	= blockPositions[anyBlock(random)] + spot.normal;
+		}
+		else {
+			spot.normal		= Vector3(0, 1, 0);
+			spot.position	= Vector3(along(random), 0, anyLane(random) * WallSpacing);
+		}
+		splatSpots.emplace_back(spot);
+	}
+
+	BuildCameraPath();
+
+	world->BuildStaticTree(""); //nothing worth caching
+	currentFrame	= 0;
+	frameTime		= 0.0f;
+	frame			= 0;
+	results.clear();
+	results.reserve(PathFrames);
+	collected		= 0;
+	passNames.clear();
+}
+
+//Just what's drawn of an opponent, with a volume so it's culled like one
+void RenderBenchmark::AddGuard(const Vector3& centre, float phase) {
+	GameObject* guard = new GameObject("Guard");
+	guard->SetBoundingVolume((CollisionVolume*)new CapsuleVolume(2, 1, Vector3(0, 2, 0)));
+	guard->GetTransform().SetScale(Vector3(-2, 2, 2));
+
+	guard->SetRenderObject(new RenderObject(&guard->GetTransform(), levelManager->GetMesh("Male_Guard"), levelManager->GetDefaultTexture(), levelManager->GetShader("guard")));
+	guard->GetRenderObject()->SetFeatures(RenderObject::Skinned | RenderObject::TexturePerSubMesh);
+	guard->GetRenderObject()->SetTextures(levelManager->GuardTextures);
+	guard->GetRenderObject()->SetAnimation(levelManager->GetAnimation("StepForward"));
+	world->AddGameObject(guard);
+
+	Guard g;
+	g.object	= guard;
+	g.centre	= centre;
+	g.phase		= phase;
+	guards.emplace_back(g);
+}
+
+/*
+Each key's an absolute position and the point to look at from it, over
+the scene as it was built. The flight goes round the outside, down the
+middle lane and back up again, and ends where it started.
+*/
+void RenderBenchmark::BuildCameraPath() {
+	const float length	= PathFrames * FrameDT;
+	const float w		= sceneSize.x;
+	const float d		= sceneSize.z;
+	const float lane	= floor(d / WallSpacing * 0.5f + 0.5f) * WallSpacing;
+	Vector3 centre(w * 0.5f, 0, d * 0.5f);
+
+	cameraPath = {
+		{ 0.0f,				Vector3(-40, 60, -40),			centre },
+		{ length * 0.2f,	Vector3(w + 40, 60, -40),		centre },
+		{ length * 0.333f,	Vector3(w + 20, 4, lane),		Vector3(w - 20, 3, lane) },
+		{ length * 0.6f,	Vector3(-20, 4, lane),			Vector3(-60, 3, lane) },
+		{ length * 0.733f,	Vector3(-20, 25, lane),			Vector3(w * 0.5f, 0, lane) },
+		{ length * 0.866f,	Vector3(w * 0.5f, 150, d * 0.5f - 1.0f), centre },
+		{ length,			Vector3(-40, 60, -40),			centre }
+	};
+}
+
+/*
+One frame at the fixed step, drawn straight away rather than alongside
+the physics, as there isn't any. The warmup frames sit at the start of
+the path, filling the splats and getting every shader and buffer used
+once, and the ones after it hold the end of it, while the last of the
+GPU's times come in.
+*/
+void RenderBenchmark::StepFrame() {
+	const float time		= frame * FrameDT;
+	const int pathFrame		= frame < WarmupFrames ? 0 : (frame - WarmupFrames < PathFrames ? frame - WarmupFrames : PathFrames);
+	const float pathTime	= pathFrame * FrameDT;
+
+	MoveGuards(time);
+	PlaceCamera(pathTime);
+	TopUpSplats();
+
+	MeshAnimation* animation = levelManager->GetAnimation("StepForward");
+	frameTime -= FrameDT;
+	while (frameTime < 0.0f) {
+		currentFrame = (currentFrame + 1) % animation->GetFrameCount();
+		frameTime += 1.0f / animation->GetFrameRate();
+	}
+	renderer->SetAnimationBlend(1.0f - frameTime * animation->GetFrameRate());
+
+	world->UpdateWorld(FrameDT);
+	levelManager->GetPaintDecals().Update(FrameDT);
+	levelManager->GetPaintParticles().Update(FrameDT);
+	renderer->Update(FrameDT);
+
+	renderer->SetInterpolationAlpha(1.0f);
+	renderer->ExtractFrame(currentFrame);
+	renderer->Render(currentFrame);
+
+	if (frame >= WarmupFrames && pathFrame < PathFrames) {
+		FrameResult r;
+		r.frame		= FrameProfiler::GetFrameNumber();
+		r.pathTime	= pathTime;
+		r.stats		= renderer->GetFrameStats();
+		results.emplace_back(r);
+	}
+	world->Prune();
+	frame++;
+}
+
+void RenderBenchmark::MoveGuards(float time) {
+	for (Guard& g : guards) {
+		float angle = g.phase + time * GuardSpeed;
+		float rads	= Maths::DegreesToRadians(angle);
+		g.object->GetTransform()
+			.SetPosition(g.centre + Vector3(sin(rads), 0, cos(rads)) * GuardRadius)
+			.SetOrientation(Quaternion::EulerAnglesToQuaternion(0, angle + 90.0f, 0));
+		g.object->UpdateBroadphaseAABB();
+	}
+}
+
+//Eased between keys, looking at wherever the keys' targets have got to
+void RenderBenchmark::PlaceCamera(float pathTime) {
+	size_t key = 0;
+	while (key + 2 < cameraPath.size() && cameraPath[key + 1].time <= pathTime) {
+		++key;
+	}
+	const CameraKey& a = cameraPath[key];
+	const CameraKey& b = cameraPath[key + 1];
+	float t = (pathTime - a.time) / (b.time - a.time);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	t = t * t * (3.0f - 2.0f * t);
+
+	Vector3 position	= a.position + (b.position - a.position) * t;
+	Vector3 target		= a.target + (b.target - a.target) * t;
+	Vector3 direction	= target - position;
+	float flat			= sqrt(direction.x * direction.x + direction.z * direction.z);
+
+	Camera* camera = world->GetMainCamera();
+	camera->SetPosition(position);
+	camera->SetYaw(Maths::RadiansToDegrees(atan2(-direction.x, -direction.z)));
+	camera->SetPitch(Maths::RadiansToDegrees(atan2(direction.y, flat)));
+}
+
+//New splats replace faded ones a few at a time, so the count stays about the same
+void RenderBenchmark::TopUpSplats() {
+	const Vector4 colours[] = { Debug::RED, Debug::GREEN, Debug::BLUE, Debug::YELLOW };
+	PaintDecals& decals = levelManager->GetPaintDecals();
+	for (int added = 0; added < MaxSplatsPerFrame && decals.GetActiveCount() < SplatCount; ++added) {
+		const SplatSpot& spot = splatSpots[nextSplat % splatSpots.size()];
+		levelManager->AddPaintSplat(spot.position, spot.normal, colours[nextSplat % 4]);
+		nextSplat++;
+	}
+}
+
+/*
+Reads every recorded frame that's old enough for its GPU times to be in,
+or all of them once the path's done. Anything that's fallen out of the
+profiler's history by then is left without times.
+*/
+void RenderBenchmark::Collect(bool all) {
+	const FrameProfiler::Frame* newest = FrameProfiler::GetFrame(0);
+	if (!newest) {
+		return;
+	}
+	while (collected < results.size()) {
+		FrameResult& r = results[collected];
+		int age = newest->number - r.frame;
+		if (!all && age < CollectAge) {
+			break;
+		}
+		const FrameProfiler::Frame* f = FrameProfiler::GetFrame(age);
+		if (f && f->number == r.frame) {
+			ReadFrame(*f, r);
+		}
+		collected++;
+	}
+}
+
+void RenderBenchmark::ReadFrame(const FrameProfiler::Frame& f, FrameResult& r) {
+	r.cpuTime = f.cpuTime;
+	for (const FrameProfiler::Marker& m : f.markers) {
+		if (m.lane == 0 && m.duration >= 0.0f) {
+			if (strcmp(m.name, "Extract Frame") == 0) {
+				r.extractTime += m.duration;
+			}
+			else if (strcmp(m.name, "Render") == 0) {
+				r.renderTime += m.duration;
+			}
+			continue;
+		}
+		if (m.lane != FrameProfiler::GPULane) {
+			continue;
+		}
+		size_t pass = 0;
+		while (pass < passNames.size() && strcmp(passNames[pass], m.name) != 0) {
+			++pass;
+		}
+		if (pass == passNames.size()) {
+			passNames.emplace_back(m.name);
+		}
+		if (r.passTimes.size() <= pass) {
+			r.passTimes.resize(pass + 1, -1.0f);
+		}
+		r.passTimes[pass] = m.duration;
+		r.gpuTime = f.gpuTime;
+	}
+}
+
+float RenderBenchmark::Percentile(std::vector<float> values, float p) {
+	if (values.empty()) {
+		return 0.0f;
+	}
+	std::sort(values.begin(), values.end());
+	return values[(size_t)((values.size() - 1) * p)];
+}
+
+void RenderBenchmark::Finish() {
+	std::ofstream csv(csvFile);
+	if (csv) {
+		csv << "frame,time,cpu_ms,extract_ms,render_ms,gpu_ms";
+		for (const char* name : passNames) {
+			csv << "," << name << "_gpu_ms";
+		}
+		csv << ",draw_calls,instances,triangles,shader_binds,mesh_binds,texture_binds\n";
+	}
+
+	std::vector<float> cpuTimes;
+	std::vector<float> gpuTimes;
+	std::vector<double> passTotals(passNames.size(), 0.0);
+	std::vector<int> passCounts(passNames.size(), 0);
+	double drawCalls	= 0.0;
+	double stateChanges	= 0.0;
+	double triangles	= 0.0;
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const FrameResult& r = results[i];
+		const OGLRenderer::FrameStats& s = r.stats;
+		if (r.cpuTime >= 0.0f) {
+			cpuTimes.emplace_back(r.cpuTime);
+		}
+		if (r.gpuTime >= 0.0f) {
+			gpuTimes.emplace_back(r.gpuTime);
+		}
+		drawCalls		+= s.drawCalls;
+		stateChanges	+= s.shaderBinds + s.meshBinds + s.textureBinds;
+		triangles		+= s.triangles;
+		if (!csv) {
+			continue;
+		}
+		//Times that never came back are left empty, rather than looking like zero
+		csv << std::fixed << std::setprecision(3) << i << "," << r.pathTime << ",";
+		if (r.cpuTime >= 0.0f) {
+			csv << r.cpuTime << "," << r.extractTime << "," << r.renderTime;
+		}
+		else {
+			csv << ",,";
+		}
+		csv << ",";
+		if (r.gpuTime >= 0.0f) {
+			csv << r.gpuTime;
+		}
+		for (size_t p = 0; p < passNames.size(); ++p) {
+			csv << ",";
+			if (p < r.passTimes.size() && r.passTimes[p] >= 0.0f) {
+				csv << r.passTimes[p];
+				passTotals[p] += r.passTimes[p];
+				passCounts[p]++;
+			}
+		}
+		csv << "," << s.drawCalls << "," << s.instances << "," << s.triangles << ","
+			<< s.shaderBinds << "," << s.meshBinds << "," << s.textureBinds << "\n";
+	}
+
+	float frames = results.empty() ? 1.0f : (float)results.size();
+	float cpuMean = 0.0f;
+	for (float t : cpuTimes) {
+		cpuMean += t;
+	}
+	cpuMean = cpuTimes.empty() ? 0.0f : cpuMean / cpuTimes.size();
+	float gpuMean = 0.0f;
+	for (float t : gpuTimes) {
+		gpuMean += t;
+	}
+	gpuMean = gpuTimes.empty() ? 0.0f : gpuMean / gpuTimes.size();
+
+	std::cout << std::fixed << std::setprecision(3) << "Render benchmark: " << blockCount << " blocks, "
+		<< guards.size() << " guards, " << SplatCount << " splats, " << results.size() << " frames" << std::endl;
+	std::cout << "CPU frame " << cpuMean << "ms (p95 " << Percentile(cpuTimes, 0.95f) << ", p99 "
+		<< Percentile(cpuTimes, 0.99f) << ", max " << Percentile(cpuTimes, 1.0f) << ")" << std::endl;
+	std::cout << "GPU frame " << gpuMean << "ms (p95 " << Percentile(gpuTimes, 0.95f) << ", p99 "
+		<< Percentile(gpuTimes, 0.99f) << ", max " << Percentile(gpuTimes, 1.0f) << "), "
+		<< gpuTimes.size() << " frames timed" << std::endl;
+	for (size_t p = 0; p < passNames.size(); ++p) {
+		std::cout << "  " << passNames[p] << " " << (passCounts[p] ? passTotals[p] / passCounts[p] : 0.0) << "ms" << std::endl;
+	}
+	std::cout << std::setprecision(1) << drawCalls / frames << " draw calls, " << stateChanges / frames
+		<< " state changes, " << triangles / frames << " triangles a frame" << std::endl;
+}
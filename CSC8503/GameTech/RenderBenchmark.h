@@ -0,0 +1,110 @@
+#pragma once
+#include "Game.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include <vector>
+#include <string>
+#include <random>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A game that loads the assets like any other, but instead of the menu
+		builds a stress scene - rows of walls made of thousands of
+		ColourBlocks, half of them painted, 64 animated guards walking round
+		in circles between them, and a few hundred paint splats, topped back
+		up as they fade - and flies a scripted camera through it at a fixed
+		step, so every run draws the same frames.
+
+		The camera swings round the whole scene, drops down a lane between
+		the walls, where most of it is hidden, climbs to look back at the
+		guards, and finishes looking straight down on everything at once.
+
+		Each frame's CPU time, the CPU time spent extracting and rendering,
+		and the GPU time of each pass all come from the FrameProfiler, the
+		GPU's a few frames late, with the renderer's draw calls, state
+		changes and triangles alongside. It's all written out a frame to a
+		row, so runs before and after a change to the renderer can be lined
+		up against each other, with a summary on the console. The game quits
+		once the path's done.
+		*/
+		class RenderBenchmark : public Game {
+		public:
+			RenderBenchmark(int blocks = 4096, const std::string& csvFile = "RenderBenchmark.csv");
+
+			void ChangeState(State newState) override;
+			void UpdateGame(float dt) override;
+
+			static const int	GuardCount			= 64;
+			static const int	SplatCount			= 400;
+			static const int	MaxSplatsPerFrame	= 8;	//so they don't all fade on the same frame
+			static const int	WarmupFrames		= 120;	//at the start of the path, not recorded
+			static const int	PathFrames			= 1800;
+			static const int	WallLength			= 32;	//blocks
+			static const int	WallHeight			= 8;
+
+			static const float	FrameDT;
+			static const float	WallSpacing;
+			static const float	GuardRadius;	//of the circles they walk round
+			static const float	GuardSpeed;		//degrees per second
+
+		protected:
+			struct FrameResult {
+				int		frame;			//the profiler's
+				float	pathTime;
+				float	cpuTime		= -1.0f;
+				float	extractTime	= 0.0f;
+				float	renderTime	= 0.0f;
+				float	gpuTime		= -1.0f;	//-1 if the GPU's times never came back
+				std::vector<float>		passTimes;	//by passNames, -1 for any that weren't timed
+				OGLRenderer::FrameStats	stats;
+			};
+
+			struct Guard {
+				GameObject*	object;
+				Vector3		centre;
+				float		phase;	//degrees
+			};
+
+			struct CameraKey {
+				float	time;
+				Vector3	position;
+				Vector3	target;
+			};
+
+			struct SplatSpot {
+				Vector3 position;
+				Vector3 normal;
+			};
+
+			void BuildScene();
+			void AddGuard(const Vector3& centre, float phase);
+			void BuildCameraPath();
+
+			void StepFrame();
+			void MoveGuards(float time);
+			void PlaceCamera(float pathTime);
+			void TopUpSplats();
+
+			void Collect(bool all);
+			void ReadFrame(const FrameProfiler::Frame& f, FrameResult& r);
+			void Finish();
+
+			static float Percentile(std::vector<float> values, float p);
+
+			int			blockCount;
+			std::string	csvFile;
+			Vector3		sceneSize;
+			int			frame;
+
+			std::mt19937				random;
+			std::vector<Guard>			guards;
+			std::vector<CameraKey>		cameraPath;
+			std::vector<SplatSpot>		splatSpots;
+			int							nextSplat;
+
+			std::vector<FrameResult>	results;
+			size_t						collected;	//the results before this have been read
+			std::vector<const char*>	passNames;	//as the GPU's markers name them, in the order they're first seen
+		};
+	}
+}
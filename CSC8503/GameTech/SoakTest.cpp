@@ -0,0 +1,202 @@
+#include "SoakTest.h"
+#include "LoadTestClient.h"
+#include "GameTechRenderer.h"
+#include "../CSC8503Common/GameServer.h"
+#include "../../Common/MemoryTracker.h"
+#include "../../Common/MemoryPool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+
+using namespace NCL;
+using namespace CSC8503;
+
+const float SoakTest::JoinTimeout = 10.0f;
+
+static const double BytesPerMB = 1024.0 * 1024.0;
+
+SoakTest::SoakTest(int matches, int onlineBots, float matchLength, const std::string& csvFile) : NetworkedGame(false) {
+	matchCount			= matches < 0 ? 0 : matches;
+	botCount			= onlineBots < 0 ? 0 : (onlineBots > Teams ? Teams : onlineBots);
+	this->matchLength	= matchLength > 1.0f ? matchLength : 1.0f;
+	this->csvFile		= csvFile;
+	matchesPlayed		= 0;
+	joinTimer			= 0.0f;
+	wroteHeader			= false;
+	firstMenuBytes		= -1;
+}
+
+SoakTest::~SoakTest() {
+	DeleteBots();
+}
+
+/*
+Only the playing frames are timed, and all of each one - the simulation,
+the networking, and drawing it. The menu's only ever up for the frame
+it takes to start the next match, and the lobby for as long as the bots
+take to join, neither of which a player would notice stutter in.
+*/
+void SoakTest::UpdateGame(float dt) {
+	if (activeState == State::MAIN_MENU) {
+		StartMatch();
+	}
+	else if (activeState == State::WAITING) {
+		UpdateBots(dt);
+		joinTimer += dt;
+		if (nextPlayerID >= (int)bots.size() || joinTimer > JoinTimeout) {
+			current.players = nextPlayerID;
+			ChangeState(State::PLAYING);
+			thisServer->SendGlobalPacket(ClientStartPacket());
+			gameTimer = matchLength;
+		}
+	}
+	else if (activeState == State::PLAYING) {
+		UpdateBots(dt);
+	}
+
+	if (activeState == State::PLAYING) {
+		auto start = std::chrono::high_resolution_clock::now();
+		NetworkedGame::UpdateGame(dt);
+		auto end = std::chrono::high_resolution_clock::now();
+		current.frameTimes.emplace_back(std::chrono::duration<float, std::milli>(end - start).count());
+		size_t objects = world->GetGameObjects().size();
+		current.peakObjects = objects > current.peakObjects ? objects : current.peakObjects;
+	}
+	else {
+		NetworkedGame::UpdateGame(dt);
+	}
+
+	if (activeState == State::PAUSED && gameOver) {
+		FinishMatch();
+	}
+}
+
+/*
+Every other match is hosted, if there are bots to join it, starting with
+an offline one. The peaks are reset first, so each match's include the
+building of its own level, and nothing from the one before.
+*/
+void SoakTest::StartMatch() {
+	renderer->SetVerticalSync(VerticalSyncState::VSync_OFF); //or every frame's a refresh long
+
+	MemoryTracker::ResetPeaks();
+	current				= MatchResult();
+	current.match		= matchesPlayed + 1;
+	current.online		= botCount > 0 && (matchesPlayed % 2) == 1;
+	current.players		= 1;
+	current.frameTimes.reserve((size_t)(matchLength * 200.0f));
+
+	if (!current.online) {
+		online = false;
+		ChangeState(State::PLAYING);
+		gameTimer = matchLength;
+		return;
+	}
+	online = true;
+	StartAsServer();
+	ChangeState(State::WAITING);
+	joinTimer = 0.0f;
+	for (int i = 0; i < botCount; ++i) {
+		LoadTestClient* bot = new LoadTestClient(i);
+		if (bot->Connect(127, 0, 0, 1, serverPort)) {
+			bots.emplace_back(bot);
+		}
+		else {
+			std::cout << "Soak test bot " << i << " couldn't connect" << std::endl;
+			delete bot;
+		}
+	}
+}
+
+void SoakTest::UpdateBots(float dt) {
+	for (LoadTestClient* bot : bots) {
+		bot->Update(dt);
+	}
+}
+
+void SoakTest::DeleteBots() {
+	for (LoadTestClient* bot : bots) {
+		delete bot;
+	}
+	bots.clear();
+}
+
+/*
+The peaks are read while the match's world is still there, then it's
+all torn down the way going back to the menu always does, and what's
+left is what the next match starts from - anything that grows here from
+one match to the next is a leak.
+*/
+void SoakTest::FinishMatch() {
+	for (int t = 0; t < (int)MemoryTag::Count; ++t) {
+		MemoryTracker::Usage usage = MemoryTracker::GetUsage((MemoryTag)t);
+		current.peakBytes		+= usage.peakBytes;
+		current.gpuPeakBytes	+= usage.gpuPeakBytes;
+	}
+	DeleteBots();
+	ChangeState(State::MAIN_MENU);
+	WriteResult(current);
+
+	matchesPlayed++;
+	if (matchCount > 0 && matchesPlayed >= matchCount) {
+		isPlaying = false;
+	}
+}
+
+void SoakTest::WriteResult(const MatchResult& r) {
+	MemoryTracker::Usage usage[(int)MemoryTag::Count];
+	int64_t menuBytes	= 0;
+	int64_t allocations	= 0;
+	for (int t = 0; t < (int)MemoryTag::Count; ++t) {
+		usage[t]	= MemoryTracker::GetUsage((MemoryTag)t);
+		menuBytes	+= usage[t].bytes;
+		allocations	+= usage[t].allocations;
+	}
+	firstMenuBytes = firstMenuBytes < 0 ? menuBytes : firstMenuBytes;
+
+	double total = 0.0;
+	for (float f : r.frameTimes) {
+		total += f;
+	}
+	float mean = r.frameTimes.empty() ? 0.0f : (float)(total / r.frameTimes.size());
+
+	std::ofstream csv(csvFile, wroteHeader ? std::ios::app : std::ios::trunc);
+	if (csv) {
+		if (!wroteHeader) {
+			csv << "match,online,players,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,peak_mb,gpu_peak_mb,peak_objects,menu_mb,menu_allocations,pooled_objects";
+			for (int t = 0; t < (int)MemoryTag::Count; ++t) {
+				csv << "," << MemoryTracker::GetTagName((MemoryTag)t) << "_menu_mb";
+			}
+			csv << "\n";
+			wroteHeader = true;
+		}
+		csv << r.match << "," << (r.online ? 1 : 0) << "," << r.players << "," << r.frameTimes.size() << "," << mean << ","
+			<< Percentile(r.frameTimes, 0.5f) << "," << Percentile(r.frameTimes, 0.95f) << "," << Percentile(r.frameTimes, 0.99f) << ","
+			<< Percentile(r.frameTimes, 1.0f) << "," << r.peakBytes / BytesPerMB << "," << r.gpuPeakBytes / BytesPerMB << ","
+			<< r.peakObjects << "," << menuBytes / BytesPerMB << "," << allocations << "," << MemoryPool::GetLiveCount();
+		for (int t = 0; t < (int)MemoryTag::Count; ++t) {
+			csv << "," << usage[t].bytes / BytesPerMB;
+		}
+		csv << "\n";
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Match " << r.match << (r.online ? " (hosted, " : " (offline, ") << r.players << " players): "
+		<< r.frameTimes.size() << " frames, " << mean << "ms mean (p50 " << Percentile(r.frameTimes, 0.5f) << ", p95 "
+		<< Percentile(r.frameTimes, 0.95f) << ", p99 " << Percentile(r.frameTimes, 0.99f) << ", max " << Percentile(r.frameTimes, 1.0f) << ")" << std::endl;
+	std::cout << "  peak " << r.peakBytes / BytesPerMB << "MB, " << r.gpuPeakBytes / BytesPerMB << "MB on the GPU, " << r.peakObjects
+		<< " objects at most. Back in the menu, " << menuBytes / BytesPerMB << "MB in " << allocations << " allocations, "
+		<< MemoryPool::GetLiveCount() << " pooled objects, " << std::showpos << (menuBytes - firstMenuBytes) / BytesPerMB
+		<< std::noshowpos << "MB on the first match" << std::endl;
+}
+
+float SoakTest::Percentile(std::vector<float> values, float p) {
+	if (values.empty()) {
+		return 0.0f;
+	}
+	std::sort(values.begin(), values.end());
+	return values[(size_t)((values.size() - 1) * p)];
+}
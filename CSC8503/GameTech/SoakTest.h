@@ -0,0 +1,70 @@
+#pragma once
+#include "NetworkedGame.h"
+#include <vector>
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		class LoadTestClient;
+
+		/*
+		Plays match after match on its own, with nobody at the controls, to
+		find what only goes wrong after a long session - memory that isn't
+		given back between matches, and frames that get slower as it goes.
+		Offline matches are the usual player and three Opponents, and if
+		there are any bots, every other match is hosted instead, with that
+		many LoadTestClients joining over the loopback, so the server's side
+		of things gets soaked too. Each match is cut down to matchLength
+		seconds, and goes back to the menu as soon as it's over, the same
+		way the pause screen's exit would.
+
+		For each match, the frame times' percentiles, the high-water mark of
+		every memory tag added together, and the most objects the world had
+		at once are written out, along with what's still allocated once it's
+		back in the menu, by tag - which is what should stay the same from
+		one match to the next. It's all on the console and in a row each of
+		csvFile. A match count of 0 keeps going until it's closed.
+		*/
+		class SoakTest : public NetworkedGame {
+		public:
+			SoakTest(int matches = 10, int onlineBots = 0, float matchLength = 90.0f, const std::string& csvFile = "SoakTest.csv");
+			~SoakTest();
+
+			void UpdateGame(float dt) override;
+
+			static const float JoinTimeout; //seconds to wait for the bots, before starting with whoever's joined
+
+		protected:
+			struct MatchResult {
+				int			match;
+				bool		online;
+				int			players;
+				std::vector<float> frameTimes; //ms
+				int64_t		peakBytes		= 0;
+				int64_t		gpuPeakBytes	= 0;
+				size_t		peakObjects		= 0;
+			};
+
+			void StartMatch();
+			void UpdateBots(float dt);
+			void DeleteBots();
+			void FinishMatch();
+			void WriteResult(const MatchResult& r);
+
+			static float Percentile(std::vector<float> values, float p);
+
+			int			matchCount;
+			int			botCount;
+			float		matchLength;
+			std::string	csvFile;
+
+			int			matchesPlayed;
+			float		joinTimer;
+			bool		wroteHeader;
+			int64_t		firstMenuBytes; //once the first match is over, -1 until then
+
+			std::vector<LoadTestClient*>	bots;
+			MatchResult						current;
+		};
+	}
+}
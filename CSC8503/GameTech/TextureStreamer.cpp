@@ -0,0 +1,237 @@
+#include "TextureStreamer.h"
+#include "../../Plugins/OpenGLRendering/OGLTexture.h"
+#include "../../Plugins/OpenGLRendering/OGLTextureUploader.h"
+#include "../../Common/TextureLoader.h"
+#include "../CSC8503Common/FrameProfiler.h"
+#include "../../Common/MemoryTracker.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace NCL;
+using namespace CSC8503;
+
+TextureStreamer::TextureStreamer(size_t budget) : budget(budget) {
+	uploader = new OGLTextureUploader(UploadBufferSize);
+	if (!uploader->IsSupported()) {
+		delete uploader;
+		uploader = nullptr;
+	}
+	streamer = std::thread([this]() { StreamingThread(); });
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		running = false;
+	}
+	workAvailable.notify_all();
+	streamer.join();
+	//Whatever it's still sending up has to be read out of the buffer before it goes
+	while (uploader && uploader->GetPendingCount() > 0) {
+		uploader->Update();
+	}
+	delete uploader;
+}
+
+void TextureStreamer::Add(OGLTexture* texture, const std::string& filename, const CompressedTexture& loaded) {
+	if (!texture || loaded.GetFirstLoadedMip() == 0 || byTexture.count(texture)) {
+		return; //nothing left to stream
+	}
+	Streamed s;
+	s.texture		= texture;
+	s.filename		= filename;
+	s.format		= loaded.GetFormat();
+	s.tailLevel		= loaded.GetFirstLoadedMip();
+	s.wantedLevel	= s.tailLevel;
+	s.keptLevel		= s.tailLevel;
+	for (int i = 0; i < loaded.GetMipCount(); ++i) {
+		s.mips.emplace_back(loaded.GetMip(i));
+	}
+	textures.emplace_back(s);
+	byTexture[texture] = &textures.back();
+	residentBytes += BytesFrom(textures.back(), s.tailLevel);
+}
+
+void TextureStreamer::RequestCoverage(const TextureBase* texture, float pixels) {
+	auto i = byTexture.find(texture);
+	if (i != byTexture.end() && pixels > i->second->coverage) {
+		i->second->coverage = pixels;
+	}
+}
+
+size_t TextureStreamer::BytesFrom(const Streamed& s, int level) const {
+	size_t bytes = 0;
+	for (int i = level; i < (int)s.mips.size(); ++i) {
+		bytes += s.mips[i].size;
+	}
+	return bytes;
+}
+
+//How many screen pixels each of its texels is being stretched over
+float TextureStreamer::Priority(const Streamed& s) const {
+	const CompressedTexture::MipLevel& base = s.mips[s.texture->GetBaseLevel()];
+	int size = base.width > base.height ? base.width : base.height;
+	return s.coverage / (float)size;
+}
+
+void TextureStreamer::Drop(Streamed& s, int level) {
+	int base = s.texture->GetBaseLevel();
+	residentBytes -= BytesFrom(s, base) - BytesFrom(s, level);
+	s.texture->DropMipsAbove(level);
+}
+
+/*
+A level's wanted if it's the smallest that's still got at least a texel
+for every pixel the texture's covering. Textures are only ever read in a
+level at a time, and only when they're idle, so anything being read can't
+be dropped out from under it. One that couldn't be read is left with
+whatever it had.
+*/
+void TextureStreamer::Update() {
+	if (textures.empty()) {
+		return;
+	}
+	ProfileScope scope("Texture Streaming");
+	MemoryTagScope tag(MemoryTag::Textures);
+	if (uploader) {
+		uploader->Update();
+	}
+	candidates.clear();
+	victims.clear();
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		for (Streamed& s : textures) {
+			int before = s.texture->GetBaseLevel();
+			if (s.state == MipState::Read) {
+				const CompressedTexture::MipLevel& mip = s.mips[s.loadingLevel];
+				s.texture->SetCompressedMip(s.format, s.loadingLevel, mip.width, mip.height, s.read.GetMipData(s.loadingLevel), mip.size);
+				s.read = CompressedTexture();
+			}
+			if ((s.state == MipState::Read || s.state == MipState::Uploading) && s.texture->GetBaseLevel() <= s.loadingLevel) {
+				s.state = MipState::Idle;
+				inFlight--;
+				inFlightBytes -= s.mips[s.loadingLevel].size;
+				residentBytes += BytesFrom(s, s.texture->GetBaseLevel()) - BytesFrom(s, before);
+			}
+			else if (s.state == MipState::Failed && s.loadingLevel >= 0) {
+				inFlight--;
+				inFlightBytes -= s.mips[s.loadingLevel].size;
+				s.loadingLevel = -1; //so it's only let go of once
+			}
+		}
+	}
+
+	for (Streamed& s : textures) {
+		s.wantedLevel = s.tailLevel;
+		for (int i = s.tailLevel; i >= 0 && s.coverage > 0.0f; --i) {
+			s.wantedLevel = i;
+			if (s.mips[i].width >= s.coverage || s.mips[i].height >= s.coverage) {
+				break;
+			}
+		}
+		if (s.wantedLevel <= s.keptLevel) {
+			s.keptLevel		= s.wantedLevel;
+			s.keptFrames	= 0;
+		}
+		else if (++s.keptFrames > EvictFrames) {
+			s.keptLevel		= s.wantedLevel;
+			s.keptFrames	= 0;
+		}
+		if (s.state != MipState::Idle) {
+			continue;
+		}
+		int base = s.texture->GetBaseLevel();
+		if (base < s.keptLevel) {
+			Drop(s, s.keptLevel);
+			base = s.keptLevel;
+		}
+		//Anything short of what it wants isn't made to give up what it has
+		if (base > s.wantedLevel) {
+			candidates.emplace_back(&s);
+		}
+		else if (base < s.tailLevel) {
+			victims.emplace_back(&s);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [&](const Streamed* a, const Streamed* b) { return Priority(*a) > Priority(*b); });
+	std::sort(victims.begin(), victims.end(), [&](const Streamed* a, const Streamed* b) { return Priority(*a) < Priority(*b); });
+	size_t nextVictim = 0;
+	for (Streamed* s : candidates) {
+		if (inFlight >= MaxInFlight) {
+			break;
+		}
+		int level		= s->texture->GetBaseLevel() - 1;
+		size_t bytes	= s->mips[level].size;
+		float priority	= Priority(*s);
+		//Only something needed less than this gives up a level for it
+		while (residentBytes + inFlightBytes + bytes > budget && nextVictim < victims.size() && Priority(*victims[nextVictim]) < priority) {
+			Streamed* v = victims[nextVictim];
+			Drop(*v, v->texture->GetBaseLevel() + 1);
+			if (v->texture->GetBaseLevel() >= v->tailLevel) {
+				nextVictim++;
+			}
+		}
+		if (residentBytes + inFlightBytes + bytes > budget) {
+			break;
+		}
+		inFlight++;
+		inFlightBytes += bytes;
+		std::lock_guard<std::mutex> lock(streamMutex);
+		s->state		= MipState::Queued;
+		s->loadingLevel	= level;
+		readQueue.emplace_back(s);
+		workAvailable.notify_one();
+	}
+
+	for (Streamed& s : textures) {
+		s.coverage = 0.0f;
+	}
+}
+
+/*
+Only the one level's read in, which comes straight out of the asset
+archive's mapping if it's packed. It's copied into the upload buffer if
+there's room, and sent up from there without the main thread having to
+touch it.
+*/
+void TextureStreamer::StreamingThread() {
+	while (true) {
+		Streamed* s = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(streamMutex);
+			workAvailable.wait(lock, [&]() { return !running || !readQueue.empty(); });
+			if (!running) {
+				return;
+			}
+			s = readQueue.front();
+			readQueue.pop_front();
+			s->state = MipState::Reading;
+		}
+		MemoryTagScope tag(MemoryTag::Textures);
+		const int level = s->loadingLevel;
+		const CompressedTexture::MipLevel& mip = s->mips[level];
+		CompressedTexture read;
+		bool loaded = TextureLoader::LoadCompressedTexture(s->filename, read, mip.width > mip.height ? mip.width : mip.height, 1) &&
+			read.GetFirstLoadedMip() == level && read.GetFormat() == s->format && read.GetMipCount() == (int)s->mips.size();
+
+		uint64_t ticket = 0;
+		char* room = loaded && uploader ? uploader->ReserveMip(s->texture, s->format, level, mip.width, mip.height, mip.size, ticket) : nullptr;
+		if (room) {
+			memcpy(room, read.GetMipData(level), mip.size);
+			uploader->Submit(ticket);
+		}
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (!loaded) {
+			s->state = MipState::Failed;
+		}
+		else if (room) {
+			s->state = MipState::Uploading;
+		}
+		else {
+			s->read		= std::move(read);
+			s->state	= MipState::Read;
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "../../Common/CompressedTexture.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+namespace NCL {
+	namespace Rendering {
+		class TextureBase;
+		class OGLTexture;
+		class OGLTextureUploader;
+	}
+	namespace CSC8503 {
+		using namespace Rendering;
+
+		/*
+		Keeps only the mip levels of a compressed texture that are big
+		enough for how much of the screen it's covering. Each one starts
+		with just its smaller levels (ResidentSize and down), which always
+		stay, and the renderer says how many pixels across anything drawn
+		with it has covered each frame. Whatever's too blurry for that has
+		its next level read in on a thread of its own, straight into the
+		upload buffer, a level at a time from the smallest up, so it
+		sharpens as it goes.
+
+		Everything streamed shares one budget. What's needed most - the
+		textures stretched the furthest over their pixels - is read in
+		first, and if the budget's full, the least needed ones give up a
+		level to make room. Levels nothing's asked for in a while are let go
+		of anyway, a little later than they stop being needed, so turning
+		round doesn't keep swapping them out.
+
+		Only textures with a compressed copy can be streamed, as that's
+		where the mips are stored - anything else is loaded whole.
+		*/
+		class TextureStreamer {
+		public:
+			TextureStreamer(size_t budget = DefaultBudget);
+			~TextureStreamer();
+
+			//Takes over the rest of a texture that's been given only some of its
+			//levels, from filename's compressed copy
+			void Add(OGLTexture* texture, const std::string& filename, const CompressedTexture& loaded);
+
+			//From anything drawn with it this frame, the largest of which is streamed towards
+			void RequestCoverage(const TextureBase* texture, float pixels);
+
+			//Main thread only - sends up what's been read in, lets go of what isn't
+			//needed, and asks for whatever's needed next
+			void Update();
+
+			void SetBudget(size_t bytes) {
+				budget = bytes;
+			}
+			size_t GetBudget() const {
+				return budget;
+			}
+			//Of the streamed textures, counting the levels that always stay
+			size_t GetResidentBytes() const {
+				return residentBytes;
+			}
+			int GetStreamedCount() const {
+				return (int)textures.size();
+			}
+
+			static const int	ResidentSize	= 64;		//along either side, for the levels that always stay
+			static const size_t	DefaultBudget	= 128 * 1024 * 1024;
+			static const size_t	UploadBufferSize = 16 * 1024 * 1024;
+			static const int	EvictFrames		= 120;		//unwanted for this long before a level goes
+			static const int	MaxInFlight		= 4;		//levels being read or sent up at once
+
+		protected:
+			enum class MipState {
+				Idle,
+				Queued,
+				Reading,
+				Read,		//waiting for the main thread, as there wasn't room in the upload buffer
+				Uploading,	//the uploader has it
+				Failed		//couldn't be read, so it's left as it is
+			};
+
+			struct Streamed {
+				OGLTexture*			texture		= nullptr;
+				std::string			filename;
+				CompressedTexture::Format format = CompressedTexture::Format::BC1;
+				std::vector<CompressedTexture::MipLevel> mips;
+				int					tailLevel	= 0;	//the largest that always stays
+
+				float				coverage	= 0.0f;	//this frame's, in pixels
+				int					wantedLevel	= 0;	//for this frame's coverage
+				int					keptLevel	= 0;	//the largest wanted lately
+				int					keptFrames	= 0;	//since it was last wanted
+
+				//Guarded by streamMutex, as the streaming thread moves these on
+				MipState			state		= MipState::Idle;
+				int					loadingLevel = 0;
+				CompressedTexture	read;
+			};
+
+			void StreamingThread();
+			//How stretched the texture is over its pixels, with what it has now
+			float Priority(const Streamed& s) const;
+			size_t BytesFrom(const Streamed& s, int level) const;
+			void Drop(Streamed& s, int level);
+
+			std::deque<Streamed>	textures;	//so the streaming thread's pointers into it stay put
+			std::unordered_map<const TextureBase*, Streamed*> byTexture;
+			OGLTextureUploader*		uploader	= nullptr;	//without GL 4.4, read levels go up on the main thread
+
+			size_t	budget			= DefaultBudget;
+			size_t	residentBytes	= 0;
+			size_t	inFlightBytes	= 0;
+			int		inFlight		= 0;
+
+			std::thread					streamer;
+			std::mutex					streamMutex;
+			std::condition_variable		workAvailable;
+			std::deque<Streamed*>		readQueue;
+			bool						running = true;
+
+			std::vector<Streamed*>		candidates;	//reused by Update
+			std::vector<Streamed*>		victims;
+		};
+	}
+}
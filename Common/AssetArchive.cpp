@@ -0,0 +1,237 @@
+#include "AssetArchive.h"
+#include "Assets.h"
+#include "./stb/stb_image.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef WIN32
+#include <filesystem>
+namespace fs = std::experimental::filesystem::v1;
+#endif
+
+using namespace NCL;
+
+//From stb_image_write, whose implementation is in TextureWriter.cpp
+unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+namespace {
+	const char		ArchiveMagic[4]	= { 'N', 'P', 'A', 'K' };
+	const uint32_t	ArchiveVersion	= 1;
+	const uint64_t	EntryAlignment	= 64;
+
+	uint64_t AlignEntry(uint64_t offset) {
+		return (offset + EntryAlignment - 1) & ~(EntryAlignment - 1);
+	}
+}
+
+MappedFile					AssetArchive::file;
+const AssetArchive::Entry*	AssetArchive::entries		= nullptr;
+const char*					AssetArchive::names			= nullptr;
+uint32_t					AssetArchive::numEntries	= 0;
+
+bool AssetArchive::Mount(const std::string& filepath) {
+	Unmount();
+	if (!file.Open(filepath)) {
+		return false; //there just isn't one, which is fine
+	}
+	Header header;
+	bool valid = file.GetSize() >= sizeof(Header);
+	if (valid) {
+		memcpy(&header, file.GetData(), sizeof(header));
+		valid = memcmp(header.magic, ArchiveMagic, 4) == 0 && header.version == ArchiveVersion &&
+			header.indexOffset + (uint64_t)header.numEntries * sizeof(Entry) <= file.GetSize() &&
+			header.namesOffset + header.nameBytes <= file.GetSize();
+	}
+	if (!valid) {
+		std::cout << __FUNCTION__ << " " << filepath << " isn't an archive this version can read, using loose files" << std::endl;
+		file.Close();
+		return false;
+	}
+	entries		= (const Entry*)(file.GetData() + header.indexOffset);
+	names		= file.GetData() + header.namesOffset;
+	numEntries	= header.numEntries;
+	return true;
+}
+
+void AssetArchive::Unmount() {
+	file.Close();
+	entries		= nullptr;
+	names		= nullptr;
+	numEntries	= 0;
+}
+
+std::string AssetArchive::EntryName(const std::string& filepath) {
+	std::string name = filepath;
+	std::replace(name.begin(), name.end(), '\\', '/');
+	if (name.compare(0, Assets::ASSETROOT.size(), Assets::ASSETROOT) == 0) {
+		name.erase(0, Assets::ASSETROOT.size());
+	}
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	return name;
+}
+
+//FNV-1a
+uint64_t AssetArchive::HashName(const std::string& name) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+//Names are checked as well, in case two ever share a hash
+const AssetArchive::Entry* AssetArchive::Find(const std::string& filepath) {
+	if (!entries) {
+		return nullptr;
+	}
+	std::string name	= EntryName(filepath);
+	uint64_t hash		= HashName(name);
+	const Entry* end	= entries + numEntries;
+	const Entry* e		= std::lower_bound(entries, end, hash, [](const Entry& a, uint64_t h) { return a.hash < h; });
+	for (; e != end && e->hash == hash; ++e) {
+		if (strcmp(names + e->nameOffset, name.c_str()) == 0) {
+			return e;
+		}
+	}
+	return nullptr;
+}
+
+bool AssetArchive::Contains(const std::string& filepath) {
+	return Find(filepath) != nullptr;
+}
+
+bool AssetArchive::Read(const std::string& filepath, const char*& data, size_t& size, char*& owned) {
+	owned = nullptr;
+	const Entry* e = Find(filepath);
+	if (!e || e->offset + e->storedSize > file.GetSize()) {
+		return false;
+	}
+	const char* stored = file.GetData() + e->offset;
+	if (!(e->flags & Compressed)) {
+		data = stored;
+		size = (size_t)e->size;
+		return true;
+	}
+	int decompressedSize = 0;
+	owned = stbi_zlib_decode_malloc_guesssize_headerflag(stored, (int)e->storedSize, (int)e->size, &decompressedSize, 1);
+	if (!owned || decompressedSize != (int)e->size) {
+		std::cout << __FUNCTION__ << " couldn't decompress " << filepath << std::endl;
+		free(owned);
+		owned = nullptr;
+		return false;
+	}
+	data = owned;
+	size = (size_t)decompressedSize;
+	return true;
+}
+
+/*
+Images that are already compressed aren't tried again, and anything else
+only stays compressed if it's at least an eighth smaller. Files are
+written in the order they're found, so each directory's assets end up
+next to each other, and are read through in order as they're loaded.
+*/
+bool AssetArchive::Pack(const std::string& filepath, const std::vector<std::string>& directories) {
+#ifdef WIN32
+	struct Source {
+		std::string	path;
+		std::string	name;
+	};
+	std::vector<Source> sources;
+	for (const std::string& d : directories) {
+		std::error_code error;
+		for (fs::recursive_directory_iterator i(Assets::ASSETROOT + d, error), end; !error && i != end; i.increment(error)) {
+			if (!fs::is_regular_file(i->path())) {
+				continue;
+			}
+			std::string path		= i->path().string();
+			std::string extension	= EntryName(i->path().extension().string());
+			if (extension == ".octree") {
+				continue; //caches, which are rewritten whenever they're stale
+			}
+			sources.push_back({ path, EntryName(path) });
+		}
+	}
+
+	std::ofstream out(filepath, std::ios::binary);
+	if (!out) {
+		std::cout << __FUNCTION__ << " couldn't write " << filepath << std::endl;
+		return false;
+	}
+	std::vector<Entry> index;
+	std::string nameBlock;
+	Header header = {};
+	out.write((const char*)&header, sizeof(header));
+	uint64_t offset = sizeof(header);
+
+	for (const Source& s : sources) {
+		MappedFile in;
+		if (!in.Open(s.path)) {
+			continue; //empty, or can't be opened
+		}
+		std::string extension = s.name.substr(s.name.find_last_of('.') == std::string::npos ? s.name.size() : s.name.find_last_of('.'));
+		//DDS files are left as they are too, so their mips can be streamed straight from the mapping
+		bool tryCompressing = extension != ".png" && extension != ".jpg" && extension != ".dds";
+
+		const char* data		= in.GetData();
+		uint64_t storedSize		= in.GetSize();
+		unsigned char* packed	= nullptr;
+		if (tryCompressing) {
+			int packedSize = 0;
+			packed = stbi_zlib_compress((unsigned char*)in.GetData(), (int)in.GetSize(), &packedSize, 8);
+			if (packed && (uint64_t)packedSize < in.GetSize() - in.GetSize() / 8) {
+				data		= (const char*)packed;
+				storedSize	= (uint64_t)packedSize;
+			}
+		}
+		uint64_t start = AlignEntry(offset);
+		for (; offset < start; ++offset) {
+			out.put(0);
+		}
+		out.write(data, storedSize);
+		offset += storedSize;
+
+		Entry e;
+		e.hash			= HashName(s.name);
+		e.offset		= start;
+		e.storedSize	= storedSize;
+		e.size			= in.GetSize();
+		e.nameOffset	= (uint32_t)nameBlock.size();
+		e.flags			= data == (const char*)packed ? Compressed : 0;
+		index.emplace_back(e);
+		nameBlock.append(s.name.c_str(), s.name.size() + 1);
+		free(packed);
+	}
+	std::sort(index.begin(), index.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+
+	uint64_t indexStart = AlignEntry(offset);
+	for (; offset < indexStart; ++offset) {
+		out.put(0);
+	}
+	out.write((const char*)index.data(), index.size() * sizeof(Entry));
+	out.write(nameBlock.data(), nameBlock.size());
+
+	memcpy(header.magic, ArchiveMagic, 4);
+	header.version		= ArchiveVersion;
+	header.numEntries	= (uint32_t)index.size();
+	header.nameBytes	= (uint32_t)nameBlock.size();
+	header.indexOffset	= indexStart;
+	header.namesOffset	= indexStart + index.size() * sizeof(Entry);
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	if (!out) {
+		std::cout << __FUNCTION__ << " couldn't write " << filepath << std::endl;
+		return false;
+	}
+	std::cout << __FUNCTION__ << " packed " << index.size() << " assets into " << filepath << std::endl;
+	return true;
+#else
+	std::cout << __FUNCTION__ << " can only find the files to pack on Windows" << std::endl;
+	return false;
+#endif
+}
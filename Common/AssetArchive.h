@@ -0,0 +1,77 @@
+#pragma once
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	/*
+	Every asset packed into one file, which is mapped once when it's mounted,
+	and read from in place from then on - the index is sorted by a hash of
+	each asset's path, so finding one is a binary search of the mapping, with
+	nothing parsed up front. Entries start on 64 byte boundaries, so binary
+	formats can be read straight out of it.
+
+	Paths are the same ones the loose files are opened with, such as
+	Assets::MESHDIR + "cube.msh", and are stored relative to Assets::ASSETROOT.
+	Anything the archive doesn't have is left for the caller to open loose,
+	so a stale or partial archive still works. As with the other baked
+	formats, nothing checks it's newer than the loose files, so it has to be
+	packed again (with -packassets) whenever they change.
+
+	It's mounted before anything loads, and never changes after, so any
+	thread can read from it without locking.
+	*/
+	class AssetArchive {
+	public:
+		static bool Mount(const std::string& filepath);
+		static void Unmount();
+
+		static bool IsMounted() {
+			return file.IsOpen();
+		}
+
+		//Stored entries point straight into the mapping. Compressed ones are
+		//decompressed into a malloc'd buffer, put in owned for the caller to free
+		static bool Read(const std::string& filepath, const char*& data, size_t& size, char*& owned);
+		static bool Contains(const std::string& filepath);
+
+		//Everything under each of the directories, which are relative to
+		//Assets::ASSETROOT. Entries are compressed if it saves enough to be
+		//worth decompressing them
+		static bool Pack(const std::string& filepath, const std::vector<std::string>& directories);
+
+	protected:
+		struct Header {
+			char		magic[4];
+			uint32_t	version;
+			uint32_t	numEntries;
+			uint32_t	nameBytes;
+			uint64_t	indexOffset;
+			uint64_t	namesOffset;
+		};
+
+		struct Entry {
+			uint64_t	hash;
+			uint64_t	offset;
+			uint64_t	storedSize;
+			uint64_t	size;		//once it's decompressed
+			uint32_t	nameOffset;
+			uint32_t	flags;
+		};
+
+		enum EntryFlags {
+			Compressed = 1
+		};
+
+		//Lower case, with forward slashes, from ASSETROOT down
+		static std::string EntryName(const std::string& filepath);
+		static uint64_t HashName(const std::string& name);
+		static const Entry* Find(const std::string& filepath);
+
+		static MappedFile	file;
+		static const Entry*	entries;
+		static const char*	names;
+		static uint32_t		numEntries;
+	};
+}
@@ -0,0 +1,64 @@
+#include "AssetFile.h"
+#include "AssetArchive.h"
+#include <fstream>
+#include <cstdlib>
+
+using namespace NCL;
+
+AssetFile::~AssetFile() {
+	Close();
+}
+
+bool AssetFile::Open(const std::string& filepath) {
+	Close();
+	if (AssetArchive::Read(filepath, data, size, decompressed)) {
+		return true;
+	}
+	if (!loose.Open(filepath)) {
+		return false;
+	}
+	data = loose.GetData();
+	size = loose.GetSize();
+	return true;
+}
+
+void AssetFile::Close() {
+	loose.Close();
+	free(decompressed);
+	decompressed	= nullptr;
+	data			= nullptr;
+	size			= 0;
+}
+
+bool AssetFile::Exists(const std::string& filepath) {
+	return AssetArchive::Contains(filepath) || std::ifstream(filepath).good();
+}
+
+AssetStream::AssetStream(const std::string& filepath) : std::istream(nullptr) {
+	rdbuf(&buffer);
+	if (file.Open(filepath)) {
+		buffer.Set(file.GetData(), file.GetSize());
+	}
+	else {
+		setstate(std::ios::failbit);
+	}
+}
+
+//The streambuf only ever reads, so it's safe to hand it the mapping without its const
+void AssetStream::MemoryBuffer::Set(const char* data, size_t size) {
+	char* start = const_cast<char*>(data);
+	setg(start, start, start + size);
+}
+
+AssetStream::MemoryBuffer::pos_type AssetStream::MemoryBuffer::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+	char* target = dir == std::ios_base::beg ? eback() + offset : (dir == std::ios_base::cur ? gptr() + offset : egptr() + offset);
+	if (!(which & std::ios_base::in) || target < eback() || target > egptr()) {
+		return pos_type(off_type(-1));
+	}
+	setg(eback(), target, egptr());
+	return pos_type(target - eback());
+}
+
+AssetStream::MemoryBuffer::pos_type AssetStream::MemoryBuffer::seekpos(pos_type pos, std::ios_base::openmode which) {
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "MappedFile.h"
+#include <string>
+#include <istream>
+#include <streambuf>
+
+namespace NCL {
+	/*
+	An asset's whole contents, read from the AssetArchive if it has it, and
+	mapped from the loose file if it doesn't - so it can be used anywhere a
+	MappedFile was, without the caller caring which it came from.
+	*/
+	class AssetFile {
+	public:
+		AssetFile() {}
+		~AssetFile();
+
+		bool Open(const std::string& filepath);
+		void Close();
+
+		const char* GetData() const {
+			return data;
+		}
+		size_t GetSize() const {
+			return size;
+		}
+		bool IsOpen() const {
+			return data != nullptr;
+		}
+
+		//Without reading anything in
+		static bool Exists(const std::string& filepath);
+
+	protected:
+		AssetFile(const AssetFile&) = delete;
+		AssetFile& operator=(const AssetFile&) = delete;
+
+		MappedFile	loose;
+		char*		decompressed	= nullptr;
+		const char*	data			= nullptr;
+		size_t		size			= 0;
+	};
+
+	/*
+	An istream over an AssetFile, for everything that was parsing its file
+	through an ifstream - it reads straight from the mapping, so nothing's
+	copied. As with an ifstream, it's failed if the file couldn't be opened.
+	*/
+	class AssetStream : public std::istream {
+	public:
+		AssetStream(const std::string& filepath);
+
+		bool IsOpen() const {
+			return file.IsOpen();
+		}
+
+	protected:
+		class MemoryBuffer : public std::streambuf {
+		public:
+			void Set(const char* data, size_t size);
+		protected:
+			pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+			pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+		};
+
+		AssetFile		file;
+		MemoryBuffer	buffer;
+	};
+}
@@ -1,11 +1,22 @@
 #include "Assets.h"
+#include "AssetArchive.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 using namespace NCL;
 
 bool Assets::ReadTextFile(const std::string &filepath, std::string& result) {
+	const char* data	= nullptr;
+	size_t size			= 0;
+	char* owned			= nullptr;
+	if (AssetArchive::Read(filepath, data, size, owned)) {
+		result.assign(data, size);
+		free(owned);
+		return true;
+	}
 	std::ifstream file(filepath, std::ios::in);
 	if (file) {
 		std::ostringstream stream;
@@ -23,6 +34,14 @@ bool Assets::ReadTextFile(const std::string &filepath, std::string& result) {
 }
 
 bool	Assets::ReadBinaryFile(const std::string& filename, char** into, size_t& size) {
+	const char* archived	= nullptr;
+	char* owned				= nullptr;
+	if (AssetArchive::Read(filename, archived, size, owned)) {
+		*into = new char[size];
+		memcpy(*into, archived, size);
+		free(owned);
+		return true;
+	}
 	std::ifstream file(filename, std::ios::binary);
 
 	if (!file) {
@@ -44,5 +63,5 @@ bool	Assets::ReadBinaryFile(const std::string& filename, char** into, size_t& si
 	*into = data;
 	size = filesize;
 
-	return data == NULL ? true : false;
+	return data == NULL ? false : true;
 }
\ No newline at end of file
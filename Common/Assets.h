@@ -11,12 +11,14 @@ https://research.ncl.ac.uk/game/
 
 namespace NCL {
 	namespace Assets {
+		const std::string ASSETROOT("../../Assets/");
 		const std::string SHADERDIR("../../Assets/Shaders/");
 		const std::string MESHDIR("../../Assets/Meshes/");
 		const std::string TEXTUREDIR("../../Assets/Textures/");
 		const std::string SOUNDSDIR("../../Assets/Audio/");
 		const std::string FONTSDIR("../../Assets/Fonts/");
 		const std::string DATADIR("../../Assets/Data/");
+		//Both look in the AssetArchive first, if there's one mounted
 		extern bool ReadTextFile(const std::string &filepath, std::string& result);
 		extern bool ReadBinaryFile(const std::string &filepath, char** into, size_t& size);
 	}
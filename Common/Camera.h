@@ -87,6 +87,8 @@ namespace NCL {
 
 		Matrix4 BuildProjectionMatrix(float currentAspect = 1.0f) const;
 
+		CameraType GetType() const { return camType; }
+
 		//Gets position in world space
 		Vector3 GetPosition() const { return position; }
 		//Sets position in world space
@@ -0,0 +1,367 @@
+#include "CompressedTexture.h"
+#include "AssetFile.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+using namespace NCL;
+
+namespace {
+	const uint32_t DDSMagic = 0x20534444; //"DDS "
+
+	uint32_t FourCC(char a, char b, char c, char d) {
+		return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+	}
+
+	struct DDSPixelFormat {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t bitCount;
+		uint32_t masks[4];
+	};
+
+	struct DDSHeader {
+		uint32_t		size;
+		uint32_t		flags;
+		uint32_t		height;
+		uint32_t		width;
+		uint32_t		linearSize;
+		uint32_t		depth;
+		uint32_t		mipCount;
+		uint32_t		reserved[11];
+		DDSPixelFormat	pixelFormat;
+		uint32_t		caps[4];
+		uint32_t		reserved2;
+	};
+
+	//Follows the header when its FourCC is DX10, which is the only way to say a file's BC7
+	struct DDSHeaderDX10 {
+		uint32_t dxgiFormat;
+		uint32_t dimension;
+		uint32_t miscFlags;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20, "DDS headers have a fixed size");
+
+	const uint32_t DDPFFourCC		= 0x4;
+	const uint32_t DDSDFlags		= 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; //caps, size, pixel format, mips, linear size
+	const uint32_t DDSCaps			= 0x8 | 0x1000 | 0x400000; //complex, texture, mipmap
+
+	const uint32_t DXGIBC1			= 71;
+	const uint32_t DXGIBC1SRGB		= 72;
+	const uint32_t DXGIBC3			= 77;
+	const uint32_t DXGIBC3SRGB		= 78;
+	const uint32_t DXGIBC7			= 98;
+	const uint32_t DXGIBC7SRGB		= 99;
+	const uint32_t DimensionTexture2D = 3;
+
+	struct Colour {
+		int r, g, b, a;
+	};
+
+	uint16_t To565(const Colour& c) {
+		return (uint16_t)(((c.r * 31 + 127) / 255) << 11 | ((c.g * 63 + 127) / 255) << 5 | ((c.b * 31 + 127) / 255));
+	}
+
+	Colour From565(uint16_t c) {
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255 };
+	}
+
+	int ColourDistance(const Colour& a, const Colour& b) {
+		int r = a.r - b.r;
+		int g = a.g - b.g;
+		int bl = a.b - b.b;
+		return r * r + g * g + bl * bl;
+	}
+
+	/*
+	The ends of the colour line are the corners of the block's bounding
+	box, pulled in a little so that outliers don't waste its precision.
+	It's always written in four colour mode, as BC3 ignores the other one.
+	*/
+	void CompressColourBlock(const Colour* block, unsigned char* into) {
+		Colour minC = { 255, 255, 255, 255 };
+		Colour maxC = { 0, 0, 0, 255 };
+		for (int i = 0; i < 16; ++i) {
+			minC.r = block[i].r < minC.r ? block[i].r : minC.r;
+			minC.g = block[i].g < minC.g ? block[i].g : minC.g;
+			minC.b = block[i].b < minC.b ? block[i].b : minC.b;
+			maxC.r = block[i].r > maxC.r ? block[i].r : maxC.r;
+			maxC.g = block[i].g > maxC.g ? block[i].g : maxC.g;
+			maxC.b = block[i].b > maxC.b ? block[i].b : maxC.b;
+		}
+		Colour inset = { (maxC.r - minC.r) / 16, (maxC.g - minC.g) / 16, (maxC.b - minC.b) / 16, 0 };
+		minC = { minC.r + inset.r, minC.g + inset.g, minC.b + inset.b, 255 };
+		maxC = { maxC.r - inset.r, maxC.g - inset.g, maxC.b - inset.b, 255 };
+
+		uint16_t c0 = To565(maxC);
+		uint16_t c1 = To565(minC);
+		if (c0 < c1) {
+			uint16_t t = c0;
+			c0 = c1;
+			c1 = t;
+		}
+		uint32_t indices = 0;
+		if (c0 != c1) {
+			Colour palette[4];
+			palette[0] = From565(c0);
+			palette[1] = From565(c1);
+			palette[2] = { (2 * palette[0].r + palette[1].r) / 3, (2 * palette[0].g + palette[1].g) / 3, (2 * palette[0].b + palette[1].b) / 3, 255 };
+			palette[3] = { (palette[0].r + 2 * palette[1].r) / 3, (palette[0].g + 2 * palette[1].g) / 3, (palette[0].b + 2 * palette[1].b) / 3, 255 };
+			for (int i = 0; i < 16; ++i) {
+				int best		= 0;
+				int bestDist	= ColourDistance(block[i], palette[0]);
+				for (int p = 1; p < 4; ++p) {
+					int dist = ColourDistance(block[i], palette[p]);
+					if (dist < bestDist) {
+						best		= p;
+						bestDist	= dist;
+					}
+				}
+				indices |= (uint32_t)best << (i * 2);
+			}
+		}
+		memcpy(into, &c0, 2);
+		memcpy(into + 2, &c1, 2);
+		memcpy(into + 4, &indices, 4);
+	}
+
+	//Eight alpha values evenly spread between the block's lowest and highest
+	void CompressAlphaBlock(const Colour* block, unsigned char* into) {
+		int a0 = 0;
+		int a1 = 255;
+		for (int i = 0; i < 16; ++i) {
+			a0 = block[i].a > a0 ? block[i].a : a0;
+			a1 = block[i].a < a1 ? block[i].a : a1;
+		}
+		uint64_t indices = 0;
+		if (a0 != a1) {
+			int palette[8];
+			palette[0] = a0;
+			palette[1] = a1;
+			for (int p = 1; p < 7; ++p) {
+				palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+			}
+			for (int i = 0; i < 16; ++i) {
+				int best		= 0;
+				int bestDist	= 256;
+				for (int p = 0; p < 8; ++p) {
+					int dist = block[i].a > palette[p] ? block[i].a - palette[p] : palette[p] - block[i].a;
+					if (dist < bestDist) {
+						best		= p;
+						bestDist	= dist;
+					}
+				}
+				indices |= (uint64_t)best << (i * 3);
+			}
+		}
+		into[0] = (unsigned char)a0;
+		into[1] = (unsigned char)a1;
+		for (int i = 0; i < 6; ++i) {
+			into[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	//Halves each side (but never below 1), averaging each 2x2 square
+	void Downsample(const std::vector<unsigned char>& from, int width, int height, std::vector<unsigned char>& into) {
+		int newWidth	= width > 1 ? width / 2 : 1;
+		int newHeight	= height > 1 ? height / 2 : 1;
+		into.resize(newWidth * newHeight * 4);
+		for (int y = 0; y < newHeight; ++y) {
+			for (int x = 0; x < newWidth; ++x) {
+				int x0 = x * 2;
+				int y0 = y * 2;
+				int x1 = x0 + 1 < width ? x0 + 1 : x0;
+				int y1 = y0 + 1 < height ? y0 + 1 : y0;
+				for (int c = 0; c < 4; ++c) {
+					int sum =	from[(y0 * width + x0) * 4 + c] + from[(y0 * width + x1) * 4 + c] +
+								from[(y1 * width + x0) * 4 + c] + from[(y1 * width + x1) * 4 + c];
+					into[(y * newWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+CompressedTexture::CompressedTexture() {
+	format = Format::BC1;
+}
+
+void CompressedTexture::AddMipLevel(int width, int height) {
+	MipLevel level;
+	level.width		= width;
+	level.height	= height;
+	level.offset	= mips.empty() ? 0 : mips.back().offset + mips.back().size;
+	level.size		= ((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+	mips.emplace_back(level);
+}
+
+bool CompressedTexture::Compress(const char* rgba, int width, int height, Format newFormat) {
+	if (newFormat == Format::BC7 || !rgba || width < 1 || height < 1) {
+		return false;
+	}
+	format = newFormat;
+	mips.clear();
+	data.clear();
+	firstLoaded = 0;
+
+	std::vector<unsigned char> level((const unsigned char*)rgba, (const unsigned char*)rgba + width * height * 4);
+	std::vector<unsigned char> nextLevel;
+	while (true) {
+		AddMipLevel(width, height);
+		data.resize(mips.back().offset + mips.back().size);
+		unsigned char* out = (unsigned char*)data.data() + mips.back().offset;
+
+		for (int by = 0; by < height; by += 4) {
+			for (int bx = 0; bx < width; bx += 4) {
+				Colour block[16];
+				for (int i = 0; i < 16; ++i) { //edges repeat the last row or column
+					int x = bx + (i % 4) < width ? bx + (i % 4) : width - 1;
+					int y = by + (i / 4) < height ? by + (i / 4) : height - 1;
+					const unsigned char* p = &level[(y * width + x) * 4];
+					block[i] = { p[0], p[1], p[2], p[3] };
+				}
+				if (format == Format::BC3) {
+					CompressAlphaBlock(block, out);
+					out += 8;
+				}
+				CompressColourBlock(block, out);
+				out += 8;
+			}
+		}
+		if (width == 1 && height == 1) {
+			break;
+		}
+		Downsample(level, width, height, nextLevel);
+		level.swap(nextLevel);
+		width	= width > 1 ? width / 2 : 1;
+		height	= height > 1 ? height / 2 : 1;
+	}
+	loadedCount = (int)mips.size();
+	return true;
+}
+
+/*
+Levels are stored largest first, so any too big to be wanted are skipped
+over without being read, and reading stops once there's enough.
+*/
+bool CompressedTexture::LoadDDS(const std::string& filepath, int maxSize, int maxLevels) {
+	AssetStream file(filepath);
+	if (!file) {
+		return false;
+	}
+	uint32_t	magic = 0;
+	DDSHeader	header;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&header, sizeof(header));
+	if (!file || magic != DDSMagic || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPFFourCC)) {
+		std::cout << __FUNCTION__ << " " << filepath << " isn't a compressed DDS file" << std::endl;
+		return false;
+	}
+	uint32_t fourCC = header.pixelFormat.fourCC;
+	if (fourCC == FourCC('D', 'X', 'T', '1')) {
+		format = Format::BC1;
+	}
+	else if (fourCC == FourCC('D', 'X', 'T', '5')) {
+		format = Format::BC3;
+	}
+	else if (fourCC == FourCC('D', 'X', '1', '0')) {
+		DDSHeaderDX10 dx10;
+		file.read((char*)&dx10, sizeof(dx10));
+		if (dx10.dxgiFormat == DXGIBC1 || dx10.dxgiFormat == DXGIBC1SRGB) {
+			format = Format::BC1;
+		}
+		else if (dx10.dxgiFormat == DXGIBC3 || dx10.dxgiFormat == DXGIBC3SRGB) {
+			format = Format::BC3;
+		}
+		else if (dx10.dxgiFormat == DXGIBC7 || dx10.dxgiFormat == DXGIBC7SRGB) {
+			format = Format::BC7;
+		}
+		else {
+			std::cout << __FUNCTION__ << " " << filepath << " is in a format that can't be loaded" << std::endl;
+			return false;
+		}
+		if (dx10.dimension != DimensionTexture2D || dx10.arraySize > 1) {
+			std::cout << __FUNCTION__ << " " << filepath << " isn't a single 2D texture" << std::endl;
+			return false;
+		}
+	}
+	else {
+		std::cout << __FUNCTION__ << " " << filepath << " is in a format that can't be loaded" << std::endl;
+		return false;
+	}
+	mips.clear();
+	int width		= (int)header.width;
+	int height		= (int)header.height;
+	int mipCount	= header.mipCount > 0 ? (int)header.mipCount : 1;
+	firstLoaded		= 0;
+	for (int i = 0; i < mipCount; ++i) {
+		AddMipLevel(width, height);
+		if (maxSize > 0 && (width > maxSize || height > maxSize)) {
+			firstLoaded = i + 1;
+		}
+		width	= width > 1 ? width / 2 : 1;
+		height	= height > 1 ? height / 2 : 1;
+	}
+	firstLoaded = firstLoaded < mipCount ? firstLoaded : mipCount - 1;
+	loadedCount = mipCount - firstLoaded;
+	if (maxLevels > 0 && maxLevels < loadedCount) {
+		loadedCount = maxLevels;
+	}
+	const MipLevel& last = mips[firstLoaded + loadedCount - 1];
+	file.seekg(mips[firstLoaded].offset, std::ios::cur);
+	data.resize(last.offset + last.size - mips[firstLoaded].offset);
+	file.read(data.data(), data.size());
+	if (!file) {
+		std::cout << __FUNCTION__ << " " << filepath << " is missing some of its mip levels" << std::endl;
+		mips.clear();
+		data.clear();
+		firstLoaded = 0;
+		loadedCount = 0;
+		return false;
+	}
+	return true;
+}
+
+//BC1 and BC3 are written with the old FourCC headers, which everything can read
+bool CompressedTexture::SaveDDS(const std::string& filepath) const {
+	if (mips.empty() || firstLoaded != 0 || loadedCount != (int)mips.size()) {
+		return false;
+	}
+	std::ofstream file(filepath, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size			= sizeof(DDSHeader);
+	header.flags		= DDSDFlags;
+	header.width		= (uint32_t)mips[0].width;
+	header.height		= (uint32_t)mips[0].height;
+	header.linearSize	= (uint32_t)mips[0].size;
+	header.mipCount		= (uint32_t)mips.size();
+	header.pixelFormat.size		= sizeof(DDSPixelFormat);
+	header.pixelFormat.flags	= DDPFFourCC;
+	header.caps[0]		= DDSCaps;
+
+	DDSHeaderDX10 dx10 = { DXGIBC7, DimensionTexture2D, 0, 1, 0 };
+	switch (format) {
+		case Format::BC1: header.pixelFormat.fourCC = FourCC('D', 'X', 'T', '1'); break;
+		case Format::BC3: header.pixelFormat.fourCC = FourCC('D', 'X', 'T', '5'); break;
+		case Format::BC7: header.pixelFormat.fourCC = FourCC('D', 'X', '1', '0'); break;
+	}
+	file.write((const char*)&DDSMagic, sizeof(DDSMagic));
+	file.write((const char*)&header, sizeof(header));
+	if (format == Format::BC7) {
+		file.write((const char*)&dx10, sizeof(dx10));
+	}
+	file.write(data.data(), data.size());
+	return (bool)file;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace NCL {
+	/*
+	Block compressed pixels, with a whole mip chain, kept in the layout the
+	GPU samples from, so they can be uploaded as they are. They're stored
+	on disk as DDS files. BC1 has no alpha, and BC3 and BC7 do. Only BC1
+	and BC3 can be made here - BC7 files have to come from another tool,
+	and are only loaded.
+	*/
+	class CompressedTexture {
+	public:
+		enum class Format {
+			BC1,
+			BC3,
+			BC7
+		};
+
+		struct MipLevel {
+			int		width;
+			int		height;
+			size_t	offset;
+			size_t	size;
+		};
+
+		CompressedTexture();
+
+		//Only the levels no bigger than maxSize along either side are read in,
+		//and no more than maxLevels of those, if either's given - every level's
+		//size is still known, but only the ones read in have their data
+		bool LoadDDS(const std::string& filepath, int maxSize = 0, int maxLevels = 0);
+		bool SaveDDS(const std::string& filepath) const;
+
+		//Builds the full mip chain from RGBA pixels, then compresses every
+		//level of it. Only BC1 and BC3 can be compressed to
+		bool Compress(const char* rgba, int width, int height, Format format);
+
+		Format	GetFormat() const	{ return format; }
+		int		GetWidth() const	{ return mips.empty() ? 0 : mips[0].width; }
+		int		GetHeight() const	{ return mips.empty() ? 0 : mips[0].height; }
+		int		GetMipCount() const	{ return (int)mips.size(); }
+
+		//The levels that have their data, which is all of them unless LoadDDS was told otherwise
+		int		GetFirstLoadedMip() const	{ return firstLoaded; }
+		int		GetLoadedMipCount() const	{ return loadedCount; }
+
+		const MipLevel& GetMip(int level) const {
+			return mips[level];
+		}
+		const char* GetMipData(int level) const {
+			return data.data() + (mips[level].offset - mips[firstLoaded].offset);
+		}
+
+		//Every 4x4 block of pixels is the same size, whatever's in it
+		static size_t GetBlockBytes(Format f) {
+			return f == Format::BC1 ? 8 : 16;
+		}
+
+	protected:
+		void AddMipLevel(int width, int height);
+
+		Format				format;
+		std::vector<MipLevel>	mips;
+		std::vector<char>		data;
+		int					firstLoaded		= 0;
+		int					loadedCount		= 0;
+	};
+}
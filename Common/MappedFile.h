@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace NCL {
+	/*
+	A whole file, mapped read only into memory, so it can be read straight
+	from the OS's page cache rather than copied through a stream first.
+	Unmapped again when it goes out of scope.
+	*/
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const std::string& filepath);
+		void Close();
+
+		const char* GetData() const {
+			return data;
+		}
+		size_t GetSize() const {
+			return size;
+		}
+		bool IsOpen() const {
+			return data != nullptr;
+		}
+
+	protected:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data;
+		size_t		size;
+#ifdef _WIN32
+		void*		fileHandle;
+		void*		mappingHandle;
+#endif
+	};
+}
@@ -9,6 +9,9 @@ https://research.ncl.ac.uk/game/
 #include "Maths.h"
 #include "../Common/Vector2.h"
 #include "../Common/Vector3.h"
+#include "../Common/Matrix4.h"
+#include "../Common/Quaternion.h"
+#include "../Common/SIMD.h"
 
 namespace NCL {
 	namespace Maths {
@@ -45,5 +48,122 @@ namespace NCL {
 				Clamp(a.z, mins.z, maxs.z)
 			);
 		}
+
+		void MatrixArrayMultiply(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				SIMD::Float4 c0 = SIMD::Load(a[i].array);
+				SIMD::Float4 c1 = SIMD::Load(a[i].array + 4);
+				SIMD::Float4 c2 = SIMD::Load(a[i].array + 8);
+				SIMD::Float4 c3 = SIMD::Load(a[i].array + 12);
+				for (int r = 0; r < 4; ++r) {
+					const float* col = &b[i].array[r * 4];
+					SIMD::Float4 o = SIMD::Mul(c0, SIMD::Splat(col[0]));
+					o = SIMD::MulAdd(c1, SIMD::Splat(col[1]), o);
+					o = SIMD::MulAdd(c2, SIMD::Splat(col[2]), o);
+					o = SIMD::MulAdd(c3, SIMD::Splat(col[3]), o);
+					SIMD::Store(&out[i].array[r * 4], o);
+				}
+			}
+		}
+
+		//Column r of each result only needs column r of b[i], so it's fine to write over b
+		void MatrixArrayMultiply(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+			SIMD::Float4 c0 = SIMD::Load(a.array);
+			SIMD::Float4 c1 = SIMD::Load(a.array + 4);
+			SIMD::Float4 c2 = SIMD::Load(a.array + 8);
+			SIMD::Float4 c3 = SIMD::Load(a.array + 12);
+			for (size_t i = 0; i < count; ++i) {
+				for (int r = 0; r < 4; ++r) {
+					const float* col = &b[i].array[r * 4];
+					SIMD::Float4 o = SIMD::Mul(c0, SIMD::Splat(col[0]));
+					o = SIMD::MulAdd(c1, SIMD::Splat(col[1]), o);
+					o = SIMD::MulAdd(c2, SIMD::Splat(col[2]), o);
+					o = SIMD::MulAdd(c3, SIMD::Splat(col[3]), o);
+					SIMD::Store(&out[i].array[r * 4], o);
+				}
+			}
+		}
+
+		void TransformPoints(const Matrix4& m, const Vector3* in, Vector3* out, size_t count) {
+			SIMD::Float4 c0 = SIMD::Load(m.array);
+			SIMD::Float4 c1 = SIMD::Load(m.array + 4);
+			SIMD::Float4 c2 = SIMD::Load(m.array + 8);
+			SIMD::Float4 c3 = SIMD::Load(m.array + 12);
+			float o[4];
+			for (size_t i = 0; i < count; ++i) {
+				SIMD::Float4 p = SIMD::MulAdd(c0, SIMD::Splat(in[i].x), c3);
+				p = SIMD::MulAdd(c1, SIMD::Splat(in[i].y), p);
+				p = SIMD::MulAdd(c2, SIMD::Splat(in[i].z), p);
+				SIMD::Store(o, p);	//Vector3s are only 12 bytes apart, so can't be stored into directly
+				out[i] = Vector3(o[0], o[1], o[2]);
+			}
+		}
+
+		/*
+		Four quaternions are loaded and transposed, so each lane has one of
+		them, and every sum is then done four at a time. Transposing each of
+		the result's columns back gives that column of all four matrices.
+		*/
+		void QuaternionToMatrixBatch(const Quaternion* in, Matrix4* out, size_t count) {
+			const SIMD::Float4 zero	= SIMD::Splat(0.0f);
+			const SIMD::Float4 one	= SIMD::Splat(1.0f);
+			const SIMD::Float4 two	= SIMD::Splat(2.0f);
+			const SIMD::Float4 lastColumn = SIMD::Set(0.0f, 0.0f, 0.0f, 1.0f);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				SIMD::Float4 x = SIMD::Load(in[i].array);
+				SIMD::Float4 y = SIMD::Load(in[i + 1].array);
+				SIMD::Float4 z = SIMD::Load(in[i + 2].array);
+				SIMD::Float4 w = SIMD::Load(in[i + 3].array);
+				SIMD::Transpose(x, y, z, w);
+
+				SIMD::Float4 yy2 = SIMD::Mul(two, SIMD::Mul(y, y));
+				SIMD::Float4 zz2 = SIMD::Mul(two, SIMD::Mul(z, z));
+				SIMD::Float4 xx2 = SIMD::Mul(two, SIMD::Mul(x, x));
+				SIMD::Float4 xy2 = SIMD::Mul(two, SIMD::Mul(x, y));
+				SIMD::Float4 zw2 = SIMD::Mul(two, SIMD::Mul(z, w));
+				SIMD::Float4 xz2 = SIMD::Mul(two, SIMD::Mul(x, z));
+				SIMD::Float4 yw2 = SIMD::Mul(two, SIMD::Mul(y, w));
+				SIMD::Float4 yz2 = SIMD::Mul(two, SIMD::Mul(y, z));
+				SIMD::Float4 xw2 = SIMD::Mul(two, SIMD::Mul(x, w));
+
+				SIMD::Float4 m0		= SIMD::Sub(SIMD::Sub(one, yy2), zz2);
+				SIMD::Float4 m1		= SIMD::Add(xy2, zw2);
+				SIMD::Float4 m2		= SIMD::Sub(xz2, yw2);
+				SIMD::Float4 m3		= zero;
+
+				SIMD::Float4 m4		= SIMD::Sub(xy2, zw2);
+				SIMD::Float4 m5		= SIMD::Sub(SIMD::Sub(one, xx2), zz2);
+				SIMD::Float4 m6		= SIMD::Add(yz2, xw2);
+				SIMD::Float4 m7		= zero;
+
+				SIMD::Float4 m8		= SIMD::Add(xz2, yw2);
+				SIMD::Float4 m9		= SIMD::Sub(yz2, xw2);
+				SIMD::Float4 m10	= SIMD::Sub(SIMD::Sub(one, xx2), yy2);
+				SIMD::Float4 m11	= zero;
+
+				SIMD::Transpose(m0, m1, m2, m3);
+				SIMD::Transpose(m4, m5, m6, m7);
+				SIMD::Transpose(m8, m9, m10, m11);
+
+				SIMD::Float4 columns[4][3] = {
+					{ m0, m4, m8 },
+					{ m1, m5, m9 },
+					{ m2, m6, m10 },
+					{ m3, m7, m11 }
+				};
+				for (int q = 0; q < 4; ++q) {
+					float* a = out[i + q].array;
+					SIMD::Store(a,		columns[q][0]);
+					SIMD::Store(a + 4,	columns[q][1]);
+					SIMD::Store(a + 8,	columns[q][2]);
+					SIMD::Store(a + 12, lastColumn);
+				}
+			}
+			for (; i < count; ++i) {
+				out[i] = Matrix4(in[i]);
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -8,30 +8,33 @@ https://research.ncl.ac.uk/game/
 */
 #pragma once
 #include <algorithm>
+#include <cstddef>
 
 namespace NCL {
 	namespace Maths {
 		class Vector2;
 		class Vector3;
+		class Matrix4;
+		class Quaternion;
 
 		//It's pi(ish)...
-		static const float		PI = 3.14159265358979323846f;
+		static constexpr float	PI = 3.14159265358979323846f;
 
 		//It's pi...divided by 360.0f!
-		static const float		PI_OVER_360 = PI / 360.0f;
+		static constexpr float	PI_OVER_360 = PI / 360.0f;
 
 		//Radians to degrees
-		inline float RadiansToDegrees(float rads) {
+		inline constexpr float RadiansToDegrees(float rads) {
 			return rads * 180.0f / PI;
 		};
 
 		//Degrees to radians
-		inline float DegreesToRadians(float degs) {
+		inline constexpr float DegreesToRadians(float degs) {
 			return degs * PI / 180.0f;
 		};
 
 		template<class T>
-		inline T Clamp(T value, T min, T max) {
+		inline constexpr T Clamp(T value, T min, T max) {
 			if (value < min) {
 				return min;
 			}
@@ -44,7 +47,7 @@ namespace NCL {
 		Vector3 Clamp(const Vector3& a, const Vector3&mins, const Vector3& maxs);
 
 		template<class T>
-		inline T Lerp(const T& a, const T&b, float by) {
+		inline constexpr T Lerp(const T& a, const T&b, float by) {
 			return (a * (1.0f - by) + b*by);
 		}
 
@@ -54,5 +57,19 @@ namespace NCL {
 		float FloatAreaOfTri(const Vector3 &a, const Vector3 &b, const Vector3 & c);
 
 		float CrossAreaOfTri(const Vector3 &a, const Vector3 &b, const Vector3 & c);
+
+		/*
+		The same sums as the Matrix4 and Quaternion operators, over whole
+		arrays at once, so whatever's shared stays in registers between
+		them. Each out can be the same array as an input.
+		*/
+		//out[i] = a[i] * b[i]
+		void MatrixArrayMultiply(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count);
+		//out[i] = a * b[i]
+		void MatrixArrayMultiply(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count);
+		//For affine matrices, so unlike Matrix4 * Vector3 there's no divide by w
+		void TransformPoints(const Matrix4& m, const Vector3* in, Vector3* out, size_t count);
+		//out[i] = Matrix4(in[i]), four at a time
+		void QuaternionToMatrixBatch(const Quaternion* in, Matrix4* out, size_t count);
 	}
 }
\ No newline at end of file
@@ -17,15 +17,6 @@ https://research.ncl.ac.uk/game/
 using namespace NCL;
 using namespace NCL::Maths;
 
-Matrix3::Matrix3(void)	{
-	for (int i = 0; i < 9; ++i) {
-		array[i] = 0.0f;
-	}
-	array[0] = 1.0f;
-	array[4] = 1.0f;
-	array[8] = 1.0f;
-}
-
 Matrix3::Matrix3(float elements[9]) {
 	array[0] = elements[0];
 	array[1] = elements[1];
@@ -68,35 +59,6 @@ Matrix3::Matrix3(const Matrix2 &m2) {
 	array[8] = 1.0f;
 }
 
-Matrix3::Matrix3(const Quaternion &quat) {
-	float yy = quat.y * quat.y;
-	float zz = quat.z * quat.z;
-	float xy = quat.x * quat.y;
-	float zw = quat.z * quat.w;
-	float xz = quat.x * quat.z;
-	float yw = quat.y * quat.w;
-	float xx = quat.x * quat.x;
-	float yz = quat.y * quat.z;
-	float xw = quat.x * quat.w;
-
-	array[0] = 1 - 2 * yy - 2 * zz;
-	array[1] = 2 * xy + 2 * zw;
-	array[2] = 2 * xz - 2 * yw;
-
-	array[3] = 2 * xy - 2 * zw;
-	array[4] = 1 - 2 * xx - 2 * zz;
-	array[5] = 2 * yz + 2 * xw;
-
-	array[6] = 2 * xz + 2 * yw;
-	array[7] = 2 * yz - 2 * xw;
-	array[8] = 1 - 2 * xx - 2 * yy;
-}
-
-
-Matrix3::~Matrix3(void)	{
-
-}
-
 Matrix3 Matrix3::Rotation(float degrees, const Vector3 &inaxis)	 {
 	Matrix3 m;
 
@@ -122,22 +84,6 @@ Matrix3 Matrix3::Rotation(float degrees, const Vector3 &inaxis)	 {
 	return m;
 }
 
-Matrix3 Matrix3::Scale( const Vector3 &scale )	{
-	Matrix3 m;
-
-	m.array[0]  = scale.x;
-	m.array[4]  = scale.y;
-	m.array[8]  = scale.z;	
-
-	return m;
-}
-
-void	Matrix3::ToZero()	{
-	for(int i = 0; i < 9; ++i) {
-		array[0] = 0.0f;
-	}
-}
-
 //http://staff.city.ac.uk/~sbbh653/publications/euler.pdf
 Vector3 Matrix3::ToEuler() const {
 	//float h = (float)RadiansToDegrees(atan2(-values[6], values[0]));
@@ -248,61 +194,3 @@ Matrix3 Matrix3::FromEuler(const Vector3 &euler) {
 
 	return m;
 }
-
-Vector3 Matrix3::GetRow(unsigned int row) const {
-	assert(row < 3);
-	int start = row;
-	return Vector3(
-		array[start],
-		array[start + 3],
-		array[start + 6]
-	);
-}
-
-void Matrix3::SetRow(unsigned int row, const Vector3 &val) {
-	assert(row < 3);
-
-	int start = 3 * row;
-
-	array[start] = val.x;
-	array[start + 3] = val.y;
-	array[start + 6] = val.z;
-}
-
-Vector3 Matrix3::GetColumn(unsigned int column) const {
-	assert(column < 3);
-	int start = 3 * column;
-	return Vector3(
-		array[start],
-		array[start + 1],
-		array[start + 2]
-	);
-}
-
-void Matrix3::SetColumn(unsigned int column, const Vector3 &val) {
-	assert(column < 3);
-	int start = 3 * column;
-	array[start] = val.x;
-	array[start + 1] = val.y;
-	array[start + 2] = val.z;
-}
-
-Vector3 Matrix3::GetDiagonal() const {
-	return Vector3(array[0], array[4], array[8]);
-}
-
-void	Matrix3::SetDiagonal(const Vector3 &in) {
-	array[0] = in.x;
-	array[4] = in.y;
-	array[8] = in.z;
-}
-
-Vector3 Matrix3::operator*(const Vector3 &v) const {
-	Vector3 vec;
-
-	vec.x = v.x*array[0] + v.y*array[3] + v.z*array[6];
-	vec.y = v.x*array[1] + v.y*array[4] + v.z*array[7];
-	vec.z = v.x*array[2] + v.y*array[5] + v.z*array[8];
-
-	return vec;
-};
\ No newline at end of file
@@ -7,6 +7,8 @@ Comments and queries to: richard-gordon.davison AT ncl.ac.uk
 https://research.ncl.ac.uk/game/
 */
 #pragma once
+#include "Vector3.h"
+#include "Quaternion.h"
 #include <assert.h>
 #include <algorithm>
 #include <iostream>
@@ -15,31 +17,79 @@ namespace NCL {
 	namespace Maths {
 		class Matrix2;
 		class Matrix4;
-		class Vector3;
-		class Quaternion;
 
 		class Matrix3
 		{
 		public:
-			Matrix3(void);
+			constexpr Matrix3(void) : array{ 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f } {}
 			Matrix3(float elements[9]);
 			Matrix3(const Matrix2 &m4);
 			Matrix3(const Matrix4 &m4);
-			Matrix3(const Quaternion& quat);
 
-			~Matrix3(void);
+			constexpr Matrix3(const Quaternion& quat) : array{} {
+				float yy = quat.y * quat.y;
+				float zz = quat.z * quat.z;
+				float xy = quat.x * quat.y;
+				float zw = quat.z * quat.w;
+				float xz = quat.x * quat.z;
+				float yw = quat.y * quat.w;
+				float xx = quat.x * quat.x;
+				float yz = quat.y * quat.z;
+				float xw = quat.x * quat.w;
+
+				array[0] = 1 - 2 * yy - 2 * zz;
+				array[1] = 2 * xy + 2 * zw;
+				array[2] = 2 * xz - 2 * yw;
+
+				array[3] = 2 * xy - 2 * zw;
+				array[4] = 1 - 2 * xx - 2 * zz;
+				array[5] = 2 * yz + 2 * xw;
+
+				array[6] = 2 * xz + 2 * yw;
+				array[7] = 2 * yz - 2 * xw;
+				array[8] = 1 - 2 * xx - 2 * yy;
+			}
 
 			//Set all matrix values to zero
-			void	ToZero();
+			constexpr void	ToZero() {
+				for (int i = 0; i < 9; ++i) {
+					array[i] = 0.0f;
+				}
+			}
 
-			Vector3 GetRow(unsigned int row) const;
-			void	SetRow(unsigned int row, const Vector3 &val);
+			Vector3 GetRow(unsigned int row) const {
+				assert(row < 3);
+				return Vector3(array[row], array[row + 3], array[row + 6]);
+			}
+			void	SetRow(unsigned int row, const Vector3 &val) {
+				assert(row < 3);
+				int start = 3 * row;
+				array[start]		= val.x;
+				array[start + 3]	= val.y;
+				array[start + 6]	= val.z;
+			}
 
-			Vector3 GetColumn(unsigned int column) const;
-			void	SetColumn(unsigned int column, const Vector3 &val);
+			Vector3 GetColumn(unsigned int column) const {
+				assert(column < 3);
+				int start = 3 * column;
+				return Vector3(array[start], array[start + 1], array[start + 2]);
+			}
+			void	SetColumn(unsigned int column, const Vector3 &val) {
+				assert(column < 3);
+				int start = 3 * column;
+				array[start]		= val.x;
+				array[start + 1]	= val.y;
+				array[start + 2]	= val.z;
+			}
 
-			Vector3 GetDiagonal() const;
-			void	SetDiagonal(const Vector3 &in);
+			constexpr Vector3 GetDiagonal() const {
+				return Vector3(array[0], array[4], array[8]);
+			}
+			constexpr void	SetDiagonal(const Vector3 &in) {
+				array[0] = in.x;
+				array[4] = in.y;
+				array[8] = in.z;
+			}
 
 			Vector3 ToEuler() const;
 
@@ -53,14 +103,14 @@ namespace NCL {
 				return m;
 			}
 
-			inline Matrix3 Transposed() const {
+			inline constexpr Matrix3 Transposed() const {
 				Matrix3 temp = *this;
 				temp.Transpose();
 				return temp;
 			}
 
-			inline void Transpose() {
-				float tempValues[3];
+			inline constexpr void Transpose() {
+				float tempValues[3] = {};
 
 				tempValues[0] = array[3];
 				tempValues[1] = array[6];
@@ -75,9 +125,15 @@ namespace NCL {
 				array[5] = tempValues[2];
 			}
 
-			Vector3 operator*(const Vector3 &v) const;
+			constexpr Vector3 operator*(const Vector3 &v) const {
+				return Vector3(
+					v.x*array[0] + v.y*array[3] + v.z*array[6],
+					v.x*array[1] + v.y*array[4] + v.z*array[7],
+					v.x*array[2] + v.y*array[5] + v.z*array[8]
+				);
+			}
 
-			inline Matrix3 operator*(const Matrix3 &a) const {
+			inline constexpr Matrix3 operator*(const Matrix3 &a) const {
 				Matrix3 out;
 				//Students! You should be able to think up a really easy way of speeding this up...
 				for (unsigned int r = 0; r < 3; ++r) {
@@ -97,7 +153,13 @@ namespace NCL {
 
 			//Creates a scaling matrix (puts the 'scale' vector down the diagonal)
 			//Analogous to glScalef
-			static Matrix3 Scale(const Vector3 &scale);
+			static constexpr Matrix3 Scale(const Vector3 &scale) {
+				Matrix3 m;
+				m.array[0] = scale.x;
+				m.array[4] = scale.y;
+				m.array[8] = scale.z;
+				return m;
+			}
 
 			static Matrix3 FromEuler(const Vector3 &euler);
 		public:
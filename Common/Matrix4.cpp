@@ -15,14 +15,6 @@ https://research.ncl.ac.uk/game/
 
 using namespace NCL;
 using namespace NCL::Maths;
-Matrix4::Matrix4(void)	{
-	ToZero();
-	array[0]  = 1.0f;
-	array[5]  = 1.0f;
-	array[10] = 1.0f;
-	array[15] = 1.0f;
-}
-
 Matrix4::Matrix4( float elements[16] )	{
 	memcpy(this->array,elements,16*sizeof(float));
 }
@@ -44,59 +36,6 @@ Matrix4::Matrix4(const Matrix3& m3) {
 	array[15] = 1.0f;
 }
 
-Matrix4::Matrix4(const Quaternion& quat) : Matrix4() {
-	float yy = quat.y * quat.y;
-	float zz = quat.z * quat.z;
-	float xy = quat.x * quat.y;
-	float zw = quat.z * quat.w;
-	float xz = quat.x * quat.z;
-	float yw = quat.y * quat.w;
-	float xx = quat.x * quat.x;
-	float yz = quat.y * quat.z;
-	float xw = quat.x * quat.w;
-
-	array[0] = 1 - 2 * yy - 2 * zz;
-	array[1] = 2 * xy + 2 * zw;
-	array[2] = 2 * xz - 2 * yw;
-
-	array[4] = 2 * xy - 2 * zw;
-	array[5] = 1 - 2 * xx - 2 * zz;
-	array[6] = 2 * yz + 2 * xw;
-
-	array[8] = 2 * xz + 2 * yw;
-	array[9] = 2 * yz - 2 * xw;
-	array[10] = 1 - 2 * xx - 2 * yy;
-}
-
-Matrix4::~Matrix4(void)	{
-}
-
-void Matrix4::ToZero()	{
-	for(int i = 0; i < 16; i++)	{
-		array[i] = 0.0f;
-	}
-}
-
-Vector3 Matrix4::GetPositionVector() const{
-	return Vector3(array[12],array[13],array[14]);
-}
-
-void	Matrix4::SetPositionVector(const Vector3& in) {
-	array[12] = in.x;
-	array[13] = in.y;
-	array[14] = in.z;		
-}
-
-Vector3 Matrix4::GetDiagonal() const{
-	return Vector3(array[0],array[5],array[10]);
-}
-
-void	Matrix4::SetDiagonal(const Vector3 &in) {
-	array[0]  = in.x;
-	array[5]  = in.y;
-	array[10] = in.z;		
-}
-
 Matrix4 Matrix4::Perspective(float znear, float zfar, float aspect, float fov) {
 	Matrix4 m;
 
@@ -181,26 +120,6 @@ Matrix4 Matrix4::Rotation(float degrees, const Vector3 &inaxis)	 {
 	return m;
 }
 
-Matrix4 Matrix4::Scale( const Vector3 &scale )	{
-	Matrix4 m;
-
-	m.array[0]  = scale.x;
-	m.array[5]  = scale.y;
-	m.array[10] = scale.z;	
-
-	return m;
-}
-
-Matrix4 Matrix4::Translation( const Vector3 &translation )	{
-	Matrix4 m;
-
-	m.array[12] = translation.x;
-	m.array[13] = translation.y;
-	m.array[14] = translation.z;	
-
-	return m;
-}
-
 //Yoinked from the Open Source Doom 3 release - all credit goes to id software!
 void    Matrix4::Invert() {
 	float det, invDet;
@@ -304,29 +223,25 @@ Vector4 Matrix4::GetColumn(unsigned int column) const {
 	return out;
 }
 
+//Vector3 stays 12 bytes, as that's how vertices and packets have it, so it's
+//only padded out to 4 floats (with a w of 1) once it's in a register
 Vector3 Matrix4::operator*(const Vector3 &v) const {
-	Vector3 vec;
-
-	float temp;
-
-	vec.x = v.x*array[0] + v.y*array[4] + v.z*array[8] + array[12];
-	vec.y = v.x*array[1] + v.y*array[5] + v.z*array[9] + array[13];
-	vec.z = v.x*array[2] + v.y*array[6] + v.z*array[10] + array[14];
-
-	temp = v.x*array[3] + v.y*array[7] + v.z*array[11] + array[15];
+	SIMD::Float4 o = SIMD::Load(array + 12);
+	o = SIMD::MulAdd(SIMD::Load(array), SIMD::Splat(v.x), o);
+	o = SIMD::MulAdd(SIMD::Load(array + 4), SIMD::Splat(v.y), o);
+	o = SIMD::MulAdd(SIMD::Load(array + 8), SIMD::Splat(v.z), o);
 
-	vec.x = vec.x / temp;
-	vec.y = vec.y / temp;
-	vec.z = vec.z / temp;
+	float out[4];
+	SIMD::Store(out, o);
+	float temp = out[3];
 
-	return vec;
+	return Vector3(out[0] / temp, out[1] / temp, out[2] / temp);
 }
 
 Vector4 Matrix4::operator*(const Vector4 &v) const {
-	return Vector4(
-		v.x*array[0] + v.y*array[4] + v.z*array[8] + v.w * array[12],
-		v.x*array[1] + v.y*array[5] + v.z*array[9] + v.w * array[13],
-		v.x*array[2] + v.y*array[6] + v.z*array[10] + v.w * array[14],
-		v.x*array[3] + v.y*array[7] + v.z*array[11] + v.w * array[15]
-	);
+	SIMD::Float4 o = SIMD::Mul(SIMD::Load(array), SIMD::Splat(v.x));
+	o = SIMD::MulAdd(SIMD::Load(array + 4), SIMD::Splat(v.y), o);
+	o = SIMD::MulAdd(SIMD::Load(array + 8), SIMD::Splat(v.z), o);
+	o = SIMD::MulAdd(SIMD::Load(array + 12), SIMD::Splat(v.w), o);
+	return Vector4::FromSIMD(o);
 }
@@ -8,37 +8,76 @@ https://research.ncl.ac.uk/game/
 */
 #pragma once
 
+#include "SIMD.h"
+#include "Vector3.h"
+#include "Quaternion.h"
 #include <iostream>
 
 namespace NCL {
 	namespace Maths {
-		class Vector3;
 		class Vector4;
 		class Matrix3;
-		class Quaternion;
 
 		class Matrix4 {
 		public:
-			Matrix4(void);
+			constexpr Matrix4(void) : array{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } {}
 			Matrix4(float elements[16]);
 			Matrix4(const Matrix3& m3);
-			Matrix4(const Quaternion& quat);
-			~Matrix4(void);
+
+			constexpr Matrix4(const Quaternion& quat) : Matrix4() {
+				float yy = quat.y * quat.y;
+				float zz = quat.z * quat.z;
+				float xy = quat.x * quat.y;
+				float zw = quat.z * quat.w;
+				float xz = quat.x * quat.z;
+				float yw = quat.y * quat.w;
+				float xx = quat.x * quat.x;
+				float yz = quat.y * quat.z;
+				float xw = quat.x * quat.w;
+
+				array[0] = 1 - 2 * yy - 2 * zz;
+				array[1] = 2 * xy + 2 * zw;
+				array[2] = 2 * xz - 2 * yw;
+
+				array[4] = 2 * xy - 2 * zw;
+				array[5] = 1 - 2 * xx - 2 * zz;
+				array[6] = 2 * yz + 2 * xw;
+
+				array[8] = 2 * xz + 2 * yw;
+				array[9] = 2 * yz - 2 * xw;
+				array[10] = 1 - 2 * xx - 2 * yy;
+			}
 
 			float	array[16];
 
 			//Set all matrix values to zero
-			void	ToZero();
+			constexpr void	ToZero() {
+				for (int i = 0; i < 16; i++) {
+					array[i] = 0.0f;
+				}
+			}
 
 			//Gets the OpenGL position vector (floats 12,13, and 14)
-			Vector3 GetPositionVector() const;
+			constexpr Vector3 GetPositionVector() const {
+				return Vector3(array[12], array[13], array[14]);
+			}
 			//Sets the OpenGL position vector (floats 12,13, and 14)
-			void	SetPositionVector(const Vector3 &in);
+			constexpr void	SetPositionVector(const Vector3 &in) {
+				array[12] = in.x;
+				array[13] = in.y;
+				array[14] = in.z;
+			}
 
 			//Gets the scale vector (floats 1,5, and 10)
-			Vector3 GetDiagonal() const;
+			constexpr Vector3 GetDiagonal() const {
+				return Vector3(array[0], array[5], array[10]);
+			}
 			//Sets the scale vector (floats 1,5, and 10)
-			void	SetDiagonal(const Vector3& in);
+			constexpr void	SetDiagonal(const Vector3& in) {
+				array[0]  = in.x;
+				array[5]  = in.y;
+				array[10] = in.z;
+			}
 
 			//Creates a rotation matrix that rotates by 'degrees' around the 'axis'
 			//Analogous to glRotatef
@@ -46,11 +85,19 @@ namespace NCL {
 
 			//Creates a scaling matrix (puts the 'scale' vector down the diagonal)
 			//Analogous to glScalef
-			static Matrix4 Scale(const Vector3& scale);
+			static constexpr Matrix4 Scale(const Vector3& scale) {
+				Matrix4 m;
+				m.SetDiagonal(scale);
+				return m;
+			}
 
 			//Creates a translation matrix (identity, with 'translation' vector at
 			//floats 12, 13, and 14. Analogous to glTranslatef
-			static Matrix4 Translation(const Vector3& translation);
+			static constexpr Matrix4 Translation(const Vector3& translation) {
+				Matrix4 m;
+				m.SetPositionVector(translation);
+				return m;
+			}
 
 			//Creates a perspective matrix, with 'znear' and 'zfar' as the near and 
 			//far planes, using 'aspect' and 'fov' as the aspect ratio and vertical
@@ -74,16 +121,20 @@ namespace NCL {
 			Vector4 GetColumn(unsigned int column) const;
 
 			//Multiplies 'this' matrix by matrix 'a'. Performs the multiplication in 'OpenGL' order (ie, backwards)
+			//Each column of the result is this matrix's columns, weighted by that column of 'a'
 			inline Matrix4 operator*(const Matrix4& a) const {
 				Matrix4 out;
-				//Students! You should be able to think up a really easy way of speeding this up...
+				SIMD::Float4 c0 = SIMD::Load(array);
+				SIMD::Float4 c1 = SIMD::Load(array + 4);
+				SIMD::Float4 c2 = SIMD::Load(array + 8);
+				SIMD::Float4 c3 = SIMD::Load(array + 12);
 				for (unsigned int r = 0; r < 4; ++r) {
-					for (unsigned int c = 0; c < 4; ++c) {
-						out.array[c + (r * 4)] = 0.0f;
-						for (unsigned int i = 0; i < 4; ++i) {
-							out.array[c + (r * 4)] += this->array[c + (i * 4)] * a.array[(r * 4) + i];
-						}
-					}
+					const float* col = &a.array[r * 4];
+					SIMD::Float4 o = SIMD::Mul(c0, SIMD::Splat(col[0]));
+					o = SIMD::MulAdd(c1, SIMD::Splat(col[1]), o);
+					o = SIMD::MulAdd(c2, SIMD::Splat(col[2]), o);
+					o = SIMD::MulAdd(c3, SIMD::Splat(col[3]), o);
+					SIMD::Store(&out.array[r * 4], o);
 				}
 				return out;
 			}
@@ -0,0 +1,150 @@
+#include "MemoryPool.h"
+#include "MemoryTracker.h"
+#include <mutex>
+#include <new>
+
+using namespace NCL;
+
+MemoryArena::MemoryArena(size_t chunkSize) {
+	this->chunkSize	= chunkSize;
+	chunkUsed		= 0;
+	currentChunk	= -1;
+}
+
+MemoryArena::~MemoryArena() {
+	for (char* c : chunks) {
+		::operator delete(c);
+	}
+}
+
+void* MemoryArena::Allocate(size_t size) {
+	size = (size + 15) & ~(size_t)15;
+	if (size > chunkSize) {
+		return nullptr;
+	}
+	if (currentChunk < 0 || chunkUsed + size > chunkSize) {
+		currentChunk++;
+		chunkUsed = 0;
+		if (currentChunk == (int)chunks.size()) {
+			MemoryTagScope tag(MemoryTag::Pools);
+			chunks.emplace_back((char*)::operator new(chunkSize));
+		}
+	}
+	void* p = chunks[currentChunk] + chunkUsed;
+	chunkUsed += size;
+	return p;
+}
+
+void MemoryArena::Reset() {
+	currentChunk	= -1;
+	chunkUsed		= 0;
+}
+
+size_t MemoryArena::GetBytesUsed() const {
+	if (currentChunk < 0) {
+		return 0;
+	}
+	return currentChunk * chunkSize + chunkUsed;
+}
+
+namespace {
+	//Sits in front of every slot, padded out so the object itself stays 16 byte aligned
+	struct SlotHeader {
+		union {
+			int			pool;	//HeapPool if it didn't come from one
+			SlotHeader* next;	//while it's in a free list
+		};
+		int				tag;	//what it's counted as while it's handed out
+		int				padding;
+	};
+	static_assert(sizeof(SlotHeader) == 16, "Slot headers must keep objects 16 byte aligned");
+
+	const int HeapPool	= -1;
+	const int PoolCount	= (int)(MemoryPool::MaxSlotSize / MemoryPool::SlotGranularity);
+
+	struct PoolState {
+		MemoryArena		arena;
+		SlotHeader*		freeSlots[PoolCount] = { nullptr };
+		int				liveCount = 0;
+		std::mutex		poolMutex;
+	};
+
+	//Never destroyed, as objects might still be deleted while statics are being torn down
+	PoolState& GetState() {
+		static PoolState* state = new PoolState();
+		return *state;
+	}
+}
+
+void* MemoryPool::Allocate(size_t size) {
+	size_t slotSize = (size + sizeof(SlotHeader) + SlotGranularity - 1) / SlotGranularity * SlotGranularity;
+	if (slotSize > MaxSlotSize) {
+		SlotHeader* h = (SlotHeader*)::operator new(size + sizeof(SlotHeader));
+		h->pool = HeapPool;
+		return h + 1;
+	}
+	int pool = (int)(slotSize / SlotGranularity) - 1;
+
+	PoolState& s = GetState();
+	std::lock_guard<std::mutex> lock(s.poolMutex);
+	SlotHeader* h = s.freeSlots[pool];
+	if (h) {
+		s.freeSlots[pool] = h->next;
+	}
+	else {
+		h = (SlotHeader*)s.arena.Allocate(slotSize);
+	}
+	if (!h) {
+		throw std::bad_alloc();
+	}
+	h->pool	= pool;
+	h->tag	= (int)MemoryTracker::GetThreadTag();
+	MemoryTracker::Move(MemoryTag::Pools, (MemoryTag)h->tag, slotSize);
+	MemoryTracker::Record((MemoryTag)h->tag, 0, 1);
+	s.liveCount++;
+	return h + 1;
+}
+
+void MemoryPool::Free(void* p) {
+	if (!p) {
+		return;
+	}
+	SlotHeader* h = (SlotHeader*)p - 1;
+	if (h->pool == HeapPool) {
+		::operator delete(h);
+		return;
+	}
+	PoolState& s = GetState();
+	std::lock_guard<std::mutex> lock(s.poolMutex);
+	int pool = h->pool;
+	MemoryTracker::Move((MemoryTag)h->tag, MemoryTag::Pools, (pool + 1) * SlotGranularity);
+	MemoryTracker::Record((MemoryTag)h->tag, 0, -1);
+	h->next = s.freeSlots[pool];
+	s.freeSlots[pool] = h;
+	s.liveCount--;
+}
+
+bool MemoryPool::Reset() {
+	PoolState& s = GetState();
+	std::lock_guard<std::mutex> lock(s.poolMutex);
+	if (s.liveCount > 0) {
+		return false;
+	}
+	for (int i = 0; i < PoolCount; ++i) {
+		s.freeSlots[i] = nullptr;
+	}
+	s.arena.Reset();
+	return true;
+}
+
+int MemoryPool::GetLiveCount() {
+	PoolState& s = GetState();
+	std::lock_guard<std::mutex> lock(s.poolMutex);
+	return s.liveCount;
+}
+
+size_t MemoryPool::GetBytesReserved() {
+	PoolState& s = GetState();
+	std::lock_guard<std::mutex> lock(s.poolMutex);
+	return s.arena.GetBytesReserved();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace NCL {
+	/*
+	Hands out memory from a few large chunks, one allocation after the
+	next, with no way of giving any single allocation back. Reset
+	rewinds to the start of the first chunk without freeing any of them,
+	so the same memory is used again, for however long it takes to fill.
+	*/
+	class MemoryArena {
+	public:
+		MemoryArena(size_t chunkSize = 256 * 1024);
+		~MemoryArena();
+
+		//Always 16 byte aligned, and never more than a chunk
+		void*	Allocate(size_t size);
+		void	Reset();
+
+		size_t	GetBytesUsed() const;
+		size_t	GetBytesReserved() const {
+			return chunks.size() * chunkSize;
+		}
+
+	protected:
+		std::vector<char*>	chunks;
+		size_t				chunkSize;
+		size_t				chunkUsed;
+		int					currentChunk;
+	};
+
+	/*
+	Fixed size slots, taken from an arena, for the objects a level is made
+	of. Sizes are rounded up to the next SlotGranularity bytes, and every
+	size has its own free list, so each type gets a pool of its own, which
+	it only shares with types of the same size. Anything bigger than
+	MaxSlotSize goes to the heap as usual. Every slot starts with which
+	pool it came from, so it can go back there without being told its
+	size - a CollisionVolume doesn't have a virtual destructor, so the
+	size delete would get for one can't be trusted.
+
+	Once nothing from the pools is in use any more, such as when a level's
+	been cleared away, Reset rewinds the arena and empties the free lists,
+	so the next level is laid out in memory from the start again.
+
+	The MemoryTracker counts each slot under whichever tag the thread
+	taking it has, and the rest of the arena as Pools.
+	*/
+	class MemoryPool {
+	public:
+		static void*	Allocate(size_t size);
+		static void		Free(void* p);
+
+		//Does nothing, and returns false, if anything from the pools is still alive
+		static bool		Reset();
+
+		static int		GetLiveCount();
+		static size_t	GetBytesReserved();
+
+		static const size_t SlotGranularity	= 16;
+		static const size_t MaxSlotSize		= 1024;
+	};
+
+	//Anything deriving from this gets its new and delete from the MemoryPool
+	class PooledObject {
+	public:
+		static void* operator new(size_t size) {
+			return MemoryPool::Allocate(size);
+		}
+		static void operator delete(void* p) {
+			MemoryPool::Free(p);
+		}
+	};
+}
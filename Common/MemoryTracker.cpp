@@ -0,0 +1,172 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace NCL;
+
+namespace {
+	struct Counters {
+		std::atomic<int64_t> bytes			{ 0 };
+		std::atomic<int64_t> peakBytes		{ 0 };
+		std::atomic<int64_t> allocations	{ 0 };
+		std::atomic<int64_t> gpuBytes		{ 0 };
+		std::atomic<int64_t> gpuPeakBytes	{ 0 };
+	};
+
+	//Constant initialised, as there'll be allocations before any constructors have run
+	Counters counters[(int)MemoryTag::Count];
+
+	std::atomic<uint64_t> totalAllocations	{ 0 };
+	std::atomic<uint64_t> totalBytes		{ 0 };
+	std::atomic<uint64_t> totalPooled		{ 0 };
+
+	thread_local MemoryTag		threadTag		= MemoryTag::General;
+	thread_local uint64_t		allocationCount	= 0;
+	thread_local uint64_t		allocatedBytes	= 0;
+	thread_local uint64_t		pooledCount		= 0;
+
+	//Kept 16 bytes, so whatever comes after it is as aligned as malloc made it
+	struct alignas(16) AllocationHeader {
+		uint64_t	size;
+		int32_t		tag;
+		int32_t		padding;
+	};
+	static_assert(sizeof(AllocationHeader) == 16, "Allocation headers must keep allocations 16 byte aligned");
+
+	void RaisePeak(std::atomic<int64_t>& peak, int64_t value) {
+		int64_t current = peak.load(std::memory_order_relaxed);
+		while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	void Add(MemoryTag tag, int64_t bytes, int allocations) {
+		Counters& c = counters[(int)tag];
+		int64_t now = c.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		c.allocations.fetch_add(allocations, std::memory_order_relaxed);
+		if (bytes > 0) {
+			RaisePeak(c.peakBytes, now);
+		}
+	}
+}
+
+//The array, sized and nothrow versions all come through these two
+void* operator new(size_t size) {
+	void* p = MemoryTracker::Allocate(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	MemoryTracker::Free(p);
+}
+
+void* MemoryTracker::Allocate(size_t size) {
+	allocationCount++;
+	allocatedBytes += size;
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	AllocationHeader* h = (AllocationHeader*)malloc(sizeof(AllocationHeader) + (size ? size : 1));
+	if (!h) {
+		return nullptr;
+	}
+	h->size	= size;
+	h->tag	= (int32_t)threadTag;
+	Add(threadTag, (int64_t)size, 1);
+	return h + 1;
+}
+
+void MemoryTracker::Free(void* p) {
+	if (!p) {
+		return;
+	}
+	AllocationHeader* h = (AllocationHeader*)p - 1;
+	Add((MemoryTag)h->tag, -(int64_t)h->size, -1);
+	free(h);
+}
+
+void MemoryTracker::Record(MemoryTag tag, int64_t bytes, int allocations) {
+	Add(tag, bytes, allocations);
+	if (allocations > 0) {
+		pooledCount += allocations;
+		totalPooled.fetch_add(allocations, std::memory_order_relaxed);
+	}
+}
+
+void MemoryTracker::Move(MemoryTag from, MemoryTag to, int64_t bytes) {
+	if (from == to) {
+		return;
+	}
+	Add(from, -bytes, 0);
+	Add(to, bytes, 0);
+}
+
+void MemoryTracker::RecordGPU(MemoryTag tag, int64_t bytes) {
+	Counters& c = counters[(int)tag];
+	int64_t now = c.gpuBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	if (bytes > 0) {
+		RaisePeak(c.gpuPeakBytes, now);
+	}
+}
+
+MemoryTracker::Usage MemoryTracker::GetUsage(MemoryTag tag) {
+	const Counters& c = counters[(int)tag];
+	Usage u;
+	u.bytes			= c.bytes.load(std::memory_order_relaxed);
+	u.peakBytes		= c.peakBytes.load(std::memory_order_relaxed);
+	u.allocations	= c.allocations.load(std::memory_order_relaxed);
+	u.gpuBytes		= c.gpuBytes.load(std::memory_order_relaxed);
+	u.gpuPeakBytes	= c.gpuPeakBytes.load(std::memory_order_relaxed);
+	return u;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTag tag) {
+	switch (tag) {
+		case MemoryTag::General:	return "General";
+		case MemoryTag::Physics:	return "Physics";
+		case MemoryTag::Rendering:	return "Rendering";
+		case MemoryTag::Meshes:		return "Meshes";
+		case MemoryTag::Textures:	return "Textures";
+		case MemoryTag::Network:	return "Network";
+		case MemoryTag::Audio:		return "Audio";
+		case MemoryTag::AI:			return "AI";
+		case MemoryTag::Pools:		return "Pools (unused)";
+	}
+	return "Unknown";
+}
+
+void MemoryTracker::ResetPeaks() {
+	for (Counters& c : counters) {
+		c.peakBytes.store(c.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		c.gpuPeakBytes.store(c.gpuBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+MemoryTag MemoryTracker::GetThreadTag() {
+	return threadTag;
+}
+
+void MemoryTracker::SetThreadTag(MemoryTag tag) {
+	threadTag = tag;
+}
+
+unsigned int MemoryTracker::GetThreadAllocationCount() {
+	return (unsigned int)allocationCount;
+}
+
+MemoryTracker::AllocationCounts MemoryTracker::GetThreadAllocations() {
+	AllocationCounts c;
+	c.allocations	= allocationCount;
+	c.bytes			= allocatedBytes;
+	c.pooled		= pooledCount;
+	return c;
+}
+
+MemoryTracker::AllocationCounts MemoryTracker::GetTotalAllocations() {
+	AllocationCounts c;
+	c.allocations	= totalAllocations.load(std::memory_order_relaxed);
+	c.bytes			= totalBytes.load(std::memory_order_relaxed);
+	c.pooled		= totalPooled.load(std::memory_order_relaxed);
+	return c;
+}
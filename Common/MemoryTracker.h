@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace NCL {
+	//What memory's being used for, so each part of the game's use can be seen on its own
+	enum class MemoryTag : int {
+		General,
+		Physics,
+		Rendering,	//render objects, and what the renderer keeps for each frame
+		Meshes,
+		Textures,
+		Network,
+		Audio,
+		AI,
+		Pools,		//taken from the heap by the object pools, but not handed out yet
+		Count
+	};
+
+	/*
+	Live totals and high-water marks of memory, by what it's for. The global
+	operator new is replaced to put a small header in front of everything
+	it hands out, with the size, and the tag the allocating thread had, so
+	it's taken back off the same tag whichever thread frees it. A thread's
+	tag is General unless a MemoryTagScope says otherwise, and jobs get the
+	tag of whoever submitted them.
+
+	The object pools count their slots under the tag in use when each slot
+	is handed out, taking it from Pools, which is what they've reserved but
+	aren't using, so nothing's counted twice.
+
+	The GPU's memory can't be seen from here, so the renderer's buffers and
+	textures say what they've uploaded, and give it back as they go.
+
+	Every allocation's also counted as it's made, per thread and over all
+	of them, so the FrameProfiler can say how many each frame and marker
+	made - in a steady frame, that should be none.
+	*/
+	class MemoryTracker {
+	public:
+		struct Usage {
+			int64_t	bytes			= 0;
+			int64_t	peakBytes		= 0;
+			int64_t	allocations		= 0;	//live ones
+			int64_t	gpuBytes		= 0;
+			int64_t	gpuPeakBytes	= 0;
+		};
+
+		//Running totals that only ever go up, for taking either side of something
+		struct AllocationCounts {
+			uint64_t	allocations	= 0;	//from the heap
+			uint64_t	bytes		= 0;
+			uint64_t	pooled		= 0;	//slots handed out by the pools, which don't touch the heap once they've warmed up
+		};
+
+		static Usage		GetUsage(MemoryTag tag);
+		static const char*	GetTagName(MemoryTag tag);
+		//Peaks start again from whatever's in use now, such as after a level's loaded
+		static void			ResetPeaks();
+
+		static MemoryTag	GetThreadTag();
+		static void			SetThreadTag(MemoryTag tag);
+
+		//Every allocation this thread's made, for the benchmarks to take either side of something
+		static unsigned int	GetThreadAllocationCount();
+		static AllocationCounts	GetThreadAllocations();
+		//Every thread's, jobs included, so a frame can be taken as a whole
+		static AllocationCounts	GetTotalAllocations();
+
+		//Only the replaced operator new and delete should need these two
+		static void*		Allocate(size_t size);
+		static void			Free(void* p);
+
+		//For memory that's handed out some other way, such as from a pool, which
+		//also counts any allocations as pooled ones
+		static void			Record(MemoryTag tag, int64_t bytes, int allocations);
+		static void			Move(MemoryTag from, MemoryTag to, int64_t bytes);
+
+		//Negative as it's released
+		static void			RecordGPU(MemoryTag tag, int64_t bytes);
+	};
+
+	//Whatever's allocated from here to the end of the scope is counted under tag
+	class MemoryTagScope {
+	public:
+		MemoryTagScope(MemoryTag tag) {
+			previous = MemoryTracker::GetThreadTag();
+			MemoryTracker::SetThreadTag(tag);
+		}
+		~MemoryTagScope() {
+			MemoryTracker::SetThreadTag(previous);
+		}
+	protected:
+		MemoryTag previous;
+	};
+}
@@ -1,20 +1,26 @@
 #include "MeshAnimation.h"
 #include "Matrix4.h"
+#include "Quaternion.h"
+#include "Maths.h"
 #include "Assets.h"
+#include "AssetFile.h"
 
-#include <fstream>
 #include <string>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 using namespace NCL;
 
 MeshAnimation::MeshAnimation() {
-	jointCount	= 0;
-	frameCount	= 0;
-	frameRate	= 0.0f;
+	jointCount		= 0;
+	frameCount		= 0;
+	frameRate		= 0.0f;
+	nextCachedPose	= 0;
 }
 
 MeshAnimation::MeshAnimation(const std::string& filename) : MeshAnimation() {
-	std::ifstream file(Assets::MESHDIR + filename);
+	AssetStream file(Assets::MESHDIR + filename);
 
 	std::string filetype;
 	int fileVersion;
@@ -30,7 +36,7 @@ MeshAnimation::MeshAnimation(const std::string& filename) : MeshAnimation() {
 	file >> jointCount;
 	file >> frameRate;
 
-	allJoints.reserve((size_t)frameCount * jointCount);
+	keys.reserve((size_t)frameCount * jointCount);
 
 	for (unsigned int f = 0; f < frameCount; ++f) {
 		for (unsigned int j = 0; j < jointCount; ++j) {
@@ -38,22 +44,170 @@ MeshAnimation::MeshAnimation(const std::string& filename) : MeshAnimation() {
 			for (int i = 0; i < 16; ++i) {
 				file >> mat.array[i];
 			}
-			allJoints.emplace_back(mat);
+			AddKey(mat);
 		}
 	}
+	if (!file) {
+		std::cout << "MeshAnim file " << filename << " ended early!" << std::endl;
+		frameCount = 0;
+		keys.clear();
+	}
 }
 
 MeshAnimation::~MeshAnimation() {
 
 }
 
-const Matrix4* MeshAnimation::GetJointData(unsigned int frame) const {
-	if (frame >= frameCount) {
-		return nullptr;
+namespace {
+	short QuantiseUnit(float f) {
+		f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+		return (short)std::lround(f * 32767.0f);
+	}
+}
+
+/*
+The scale is how long each axis of the matrix is, and what's left once
+that's divided out is the rotation, which is turned into a quaternion
+whichever way loses the least precision for it. A mirrored joint gets a
+negative x scale, so the rotation's still a proper one.
+*/
+void MeshAnimation::AddKey(const Matrix4& m) {
+	JointKey k;
+	k.translation = m.GetPositionVector();
+
+	Vector3 axes[3];
+	for (int c = 0; c < 3; ++c) {
+		axes[c] = Vector3(m.array[c * 4], m.array[c * 4 + 1], m.array[c * 4 + 2]);
+	}
+	k.scale = Vector3(axes[0].Length(), axes[1].Length(), axes[2].Length());
+	if (Vector3::Dot(Vector3::Cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+		k.scale.x = -k.scale.x;
+	}
+	float r[3][3]; //r[column][row]
+	for (int c = 0; c < 3; ++c) {
+		float s = k.scale[c] != 0.0f ? 1.0f / k.scale[c] : 0.0f;
+		r[c][0] = axes[c].x * s;
+		r[c][1] = axes[c].y * s;
+		r[c][2] = axes[c].z * s;
+	}
+	float q[4];
+	float trace = r[0][0] + r[1][1] + r[2][2];
+	if (trace > 0.0f) {
+		float s = sqrt(trace + 1.0f) * 2.0f;
+		q[3] = 0.25f * s;
+		q[0] = (r[1][2] - r[2][1]) / s;
+		q[1] = (r[2][0] - r[0][2]) / s;
+		q[2] = (r[0][1] - r[1][0]) / s;
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+		float s = sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		q[3] = (r[1][2] - r[2][1]) / s;
+		q[0] = 0.25f * s;
+		q[1] = (r[1][0] + r[0][1]) / s;
+		q[2] = (r[2][0] + r[0][2]) / s;
 	}
-	int matStart = frame * jointCount;
+	else if (r[1][1] > r[2][2]) {
+		float s = sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		q[3] = (r[2][0] - r[0][2]) / s;
+		q[0] = (r[1][0] + r[0][1]) / s;
+		q[1] = 0.25f * s;
+		q[2] = (r[2][1] + r[1][2]) / s;
+	}
+	else {
+		float s = sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+		q[3] = (r[0][1] - r[1][0]) / s;
+		q[0] = (r[2][0] + r[0][2]) / s;
+		q[1] = (r[2][1] + r[1][2]) / s;
+		q[2] = 0.25f * s;
+	}
+	float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	for (int i = 0; i < 4; ++i) {
+		k.rotation[i] = QuantiseUnit(length > 0.0f ? q[i] / length : (i == 3 ? 1.0f : 0.0f));
+	}
+	keys.emplace_back(k);
+}
 
-	Matrix4* dataStart = (Matrix4*)allJoints.data();
+void MeshAnimation::SamplePose(float frame, Matrix4* out) const {
+	if (frameCount == 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		for (const CachedPose& p : poseCache) {
+			if (p.frame == frame && p.joints.size() == jointCount) {
+				memcpy(out, p.joints.data(), jointCount * sizeof(Matrix4));
+				return;
+			}
+		}
+	}
+	BuildPose(frame, out);
 
-	return dataStart + matStart;
-}
\ No newline at end of file
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	CachedPose& p = poseCache[nextCachedPose];
+	nextCachedPose = (nextCachedPose + 1) % PoseCacheSize;
+	p.frame = frame;
+	p.joints.assign(out, out + jointCount);
+}
+
+/*
+Rotations are blended with a normalised lerp, going whichever way
+round is shorter, which is close enough to a slerp over a frame's worth
+of movement. The joints are done a batch at a time, so every rotation in
+the batch is turned into a matrix together.
+*/
+void MeshAnimation::BuildPose(float frame, Matrix4* out) const {
+	float wrapped = fmod(frame, (float)frameCount);
+	if (wrapped < 0.0f) {
+		wrapped += frameCount;
+	}
+	unsigned int fromFrame	= (unsigned int)wrapped % frameCount;
+	unsigned int toFrame	= (fromFrame + 1) % frameCount;
+	float t = wrapped - (float)(unsigned int)wrapped;
+
+	const JointKey* from	= &keys[(size_t)fromFrame * jointCount];
+	const JointKey* to		= &keys[(size_t)toFrame * jointCount];
+
+	const unsigned int batchSize = 32;
+	Quaternion rotations[batchSize];
+	for (unsigned int first = 0; first < jointCount; first += batchSize) {
+		unsigned int last = first + batchSize < jointCount ? first + batchSize : jointCount;
+		for (unsigned int j = first; j < last; ++j) {
+			rotations[j - first] = BlendRotation(from[j], to[j], t);
+		}
+		QuaternionToMatrixBatch(rotations, out + first, last - first);
+
+		for (unsigned int j = first; j < last; ++j) {
+			Vector3 translation	= from[j].translation + (to[j].translation - from[j].translation) * t;
+			Vector3 scale		= from[j].scale + (to[j].scale - from[j].scale) * t;
+
+			Matrix4& m = out[j];
+			for (int c = 0; c < 3; ++c) {
+				m.array[c * 4]		*= scale[c];
+				m.array[c * 4 + 1]	*= scale[c];
+				m.array[c * 4 + 2]	*= scale[c];
+			}
+			m.SetPositionVector(translation);
+		}
+	}
+}
+
+Quaternion MeshAnimation::BlendRotation(const JointKey& from, const JointKey& to, float t) {
+	float qa[4];
+	float qb[4];
+	float dot = 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		qa[i] = from.rotation[i] / 32767.0f;
+		qb[i] = to.rotation[i] / 32767.0f;
+		dot += qa[i] * qb[i];
+	}
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+	float q[4];
+	float length = 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		q[i] = qa[i] + (qb[i] * sign - qa[i]) * t;
+		length += q[i] * q[i];
+	}
+	length = length > 0.0f ? 1.0f / sqrt(length) : 0.0f;
+
+	return Quaternion(q[0] * length, q[1] * length, q[2] * length, q[3] * length);
+}
@@ -1,15 +1,24 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <mutex>
+#include "Vector3.h"
+#include "Matrix4.h"
+#include "Quaternion.h"
 #ifndef _MESHANIMATION_H_
 #define _MESHANIMATION_H_
 namespace NCL {
 
-namespace Maths {
-	class Matrix4;
-}
 using namespace Maths;
 
+/*
+Each joint's pose is kept as a translation, a scale and a rotation
+quantised to four shorts, rather than the whole matrix the file has,
+which halves what an animation takes up. Poses are sampled at any point
+between two frames, interpolating each part of them separately, and the
+last few are cached, as everything playing a clip in step asks for the
+same pose.
+*/
 class MeshAnimation
 {
 public:
@@ -29,14 +38,36 @@ public:
 		return frameRate;
 	}
 
-	const Matrix4* GetJointData(unsigned int frame) const;
+	//frame can be anywhere between two, and wraps around past the last one.
+	//Writes GetJointCount() matrices to out
+	void SamplePose(float frame, Matrix4* out) const;
+
+	static const int PoseCacheSize = 8;
 
 protected:
+	struct JointKey {
+		Vector3	translation;
+		Vector3	scale;
+		short	rotation[4];	//x, y, z, w, from -1 to 1
+	};
+
+	void		AddKey(const Matrix4& m);
+	void		BuildPose(float frame, Matrix4* out) const;
+	static Quaternion BlendRotation(const JointKey& from, const JointKey& to, float t);
+
 	unsigned int	jointCount;
 	unsigned int	frameCount;
 	float			frameRate;
 
-	std::vector<Matrix4>		allJoints;
+	std::vector<JointKey>		keys;	//every joint of the first frame, then the next...
+
+	struct CachedPose {
+		float					frame = -1.0f;
+		std::vector<Matrix4>	joints;
+	};
+	mutable CachedPose	poseCache[PoseCacheSize];
+	mutable int			nextCachedPose;
+	mutable std::mutex	cacheMutex;
 };
 }
 #endif // !_MESHANIMATION_H_
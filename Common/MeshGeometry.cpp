@@ -4,9 +4,15 @@
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Matrix4.h"
+#include "AssetFile.h"
 
 #include <fstream>
 #include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <iostream>
 
 using namespace NCL;
 using namespace Maths;
@@ -32,7 +38,8 @@ enum class GeometryChunkTypes {
 	BindPoseInv		= 1 << 12,
 	Material		= 1 << 13,
 	SubMeshes		= 1 << 14,
-	SubMeshNames	= 1 << 15
+	SubMeshNames	= 1 << 15,
+	Indices16		= 1 << 16	//instead of Indices, for meshes with few enough vertices
 };
 
 enum class GeometryChunkData {
@@ -66,7 +73,7 @@ void* ReadVertexData(GeometryChunkData dataType, GeometryChunkTypes chunkType, i
 	return data;
 }
 
-void ReadTextFloats(std::ifstream& file, vector<Vector2>& element, int numVertices) {
+void ReadTextFloats(std::istream& file, vector<Vector2>& element, int numVertices) {
 	for (int i = 0; i < numVertices; ++i) {
 		Vector2 temp;
 		file >> temp.x;
@@ -75,7 +82,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector2>& element, int numVertic
 	}
 }
 
-void ReadTextFloats(std::ifstream& file, vector<Vector3>& element, int numVertices) {
+void ReadTextFloats(std::istream& file, vector<Vector3>& element, int numVertices) {
 	for (int i = 0; i < numVertices; ++i) {
 		Vector3 temp;
 		file >> temp.x;
@@ -85,7 +92,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector3>& element, int numVertic
 	}
 }
 
-void ReadTextFloats(std::ifstream& file, vector<Vector4>& element, int numVertices) {
+void ReadTextFloats(std::istream& file, vector<Vector4>& element, int numVertices) {
 	for (int i = 0; i < numVertices; ++i) {
 		Vector4 temp;
 		file >> temp.x;
@@ -96,7 +103,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector4>& element, int numVertic
 	}
 }
 
-void ReadIndices(std::ifstream& file, vector<unsigned int>& elements, int numIndices) {
+void ReadIndices(std::istream& file, vector<unsigned int>& elements, int numIndices) {
 	for (int i = 0; i < numIndices; ++i) {
 		unsigned int temp;
 		file >> temp;
@@ -104,9 +111,20 @@ void ReadIndices(std::ifstream& file, vector<unsigned int>& elements, int numInd
 	}
 }
 
+/*
+A binary copy of the mesh, made with ConvertToBinary, is used instead of
+the text file if there is one. Nothing checks it's newer than the text
+file, so it needs converting again whenever the mesh changes.
+*/
 MeshGeometry::MeshGeometry(const std::string&filename) {
 	primType = GeometryPrimitive::Triangles;
-	std::ifstream file(Assets::MESHDIR + filename);
+	if (!LoadBinary(filename)) {
+		LoadText(filename);
+	}
+}
+
+bool MeshGeometry::LoadText(const std::string& filename) {
+	AssetStream file(Assets::MESHDIR + filename);
 
 	std::string filetype;
 	int fileVersion;
@@ -115,14 +133,14 @@ MeshGeometry::MeshGeometry(const std::string&filename) {
 
 	if (filetype != "MeshGeometry") {
 		std::cout << "File is not a MeshGeometry file!" << std::endl;
-		return;
+		return false;
 	}
 
 	file >> fileVersion;
 
 	if (fileVersion != 1) {
 		std::cout << "MeshGeometry file has incompatible version!" << std::endl;
-		return;
+		return false;
 	}
 
 	int numMeshes	= 0; //read
@@ -158,13 +176,547 @@ MeshGeometry::MeshGeometry(const std::string&filename) {
 			case GeometryChunkTypes::SubMeshNames: 		ReadSubMeshNames(file, numMeshes); break;
 		}
 	}
+	return true;
+}
+
+/*
+Binary meshes start with a header, then a table saying where each chunk
+is, with the data for each chunk 16 byte aligned after it. Chunks are in
+the same layout as the arrays they're loaded into, so each is a single
+copy out of the mapped file. Names are packed one after another, each
+ending in a null. Version 2 added 16 bit indices, and can still read
+version 1 files.
+*/
+namespace {
+	const char		BinaryMeshMagic[4]	= { 'N', 'M', 'S', 'H' };
+	const uint32_t	BinaryMeshVersion	= 2;
+
+	struct BinaryMeshHeader {
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	numMeshes;
+		uint32_t	numChunks;
+	};
+
+	struct BinaryMeshChunk {
+		uint32_t	type;
+		uint32_t	count;
+		uint64_t	offset;
+		uint64_t	bytes;
+	};
+
+	static_assert(sizeof(Vector2) == 8 && sizeof(Vector3) == 12 && sizeof(Vector4) == 16 && sizeof(Matrix4) == 64,
+		"Binary meshes copy vectors and matrices in as plain floats");
+
+	std::string BinaryFilename(const std::string& filename) {
+		size_t dot = filename.find_last_of('.');
+		return (dot == std::string::npos ? filename : filename.substr(0, dot)) + ".bmsh";
+	}
+
+	template<class T>
+	bool ReadBinaryArray(const AssetFile& file, const BinaryMeshChunk& chunk, vector<T>& into) {
+		if (chunk.offset + chunk.bytes > file.GetSize() || chunk.bytes != (uint64_t)chunk.count * sizeof(T)) {
+			return false;
+		}
+		into.resize(chunk.count);
+		memcpy(into.data(), file.GetData() + chunk.offset, (size_t)chunk.bytes);
+		return true;
+	}
+
+	bool ReadBinaryIndices16(const AssetFile& file, const BinaryMeshChunk& chunk, vector<unsigned int>& into) {
+		vector<uint16_t> shortIndices;
+		if (!ReadBinaryArray(file, chunk, shortIndices)) {
+			return false;
+		}
+		into.assign(shortIndices.begin(), shortIndices.end());
+		return true;
+	}
+
+	bool ReadBinaryNames(const AssetFile& file, const BinaryMeshChunk& chunk, vector<std::string>& into) {
+		if (chunk.offset + chunk.bytes > file.GetSize()) {
+			return false;
+		}
+		const char* next	= file.GetData() + chunk.offset;
+		const char* end		= next + chunk.bytes;
+		into.clear();
+		for (uint32_t i = 0; i < chunk.count; ++i) {
+			const char* nameEnd = (const char*)memchr(next, 0, end - next);
+			if (!nameEnd) {
+				return false;
+			}
+			into.emplace_back(next, nameEnd);
+			next = nameEnd + 1;
+		}
+		return true;
+	}
+
+	uint64_t AlignChunk(uint64_t offset) {
+		return (offset + 15) & ~(uint64_t)15;
+	}
+}
+
+bool MeshGeometry::LoadBinary(const std::string& filename) {
+	AssetFile file;
+	if (!file.Open(Assets::MESHDIR + BinaryFilename(filename))) {
+		return false;
+	}
+	if (file.GetSize() < sizeof(BinaryMeshHeader)) {
+		return false;
+	}
+	BinaryMeshHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.magic, BinaryMeshMagic, 4) != 0 || header.version < 1 || header.version > BinaryMeshVersion ||
+		sizeof(BinaryMeshHeader) + (uint64_t)header.numChunks * sizeof(BinaryMeshChunk) > file.GetSize()) {
+		std::cout << __FUNCTION__ << " binary mesh for " << filename << " isn't one this version can read, using the text one" << std::endl;
+		return false;
+	}
+	bool valid = true;
+	for (uint32_t i = 0; i < header.numChunks && valid; ++i) {
+		BinaryMeshChunk chunk;
+		memcpy(&chunk, file.GetData() + sizeof(BinaryMeshHeader) + i * sizeof(BinaryMeshChunk), sizeof(chunk));
+
+		switch ((GeometryChunkTypes)chunk.type) {
+			case GeometryChunkTypes::VPositions:		valid = ReadBinaryArray(file, chunk, positions);		break;
+			case GeometryChunkTypes::VColors:			valid = ReadBinaryArray(file, chunk, colours);			break;
+			case GeometryChunkTypes::VNormals:			valid = ReadBinaryArray(file, chunk, normals);			break;
+			case GeometryChunkTypes::VTangents:			valid = ReadBinaryArray(file, chunk, tangents);			break;
+			case GeometryChunkTypes::VTex0:				valid = ReadBinaryArray(file, chunk, texCoords);		break;
+			case GeometryChunkTypes::Indices:			valid = ReadBinaryArray(file, chunk, indices);			break;
+			case GeometryChunkTypes::Indices16:			valid = ReadBinaryIndices16(file, chunk, indices);		break;
+			case GeometryChunkTypes::VWeightValues:		valid = ReadBinaryArray(file, chunk, skinWeights);		break;
+			case GeometryChunkTypes::VWeightIndices:	valid = ReadBinaryArray(file, chunk, skinIndices);		break;
+			case GeometryChunkTypes::JointNames:		valid = ReadBinaryNames(file, chunk, jointNames);		break;
+			case GeometryChunkTypes::JointParents:		valid = ReadBinaryArray(file, chunk, jointParents);		break;
+			case GeometryChunkTypes::BindPose:			valid = ReadBinaryArray(file, chunk, bindPose);			break;
+			case GeometryChunkTypes::BindPoseInv:		valid = ReadBinaryArray(file, chunk, inverseBindPose);	break;
+			case GeometryChunkTypes::SubMeshes:			valid = ReadBinaryArray(file, chunk, subMeshes);		break;
+			case GeometryChunkTypes::SubMeshNames:		valid = ReadBinaryNames(file, chunk, subMeshNames);		break;
+		}
+	}
+	if (!valid) {
+		std::cout << __FUNCTION__ << " binary mesh for " << filename << " is damaged, using the text one" << std::endl;
+		positions.clear();		colours.clear();		normals.clear();
+		tangents.clear();		texCoords.clear();		indices.clear();
+		skinWeights.clear();	skinIndices.clear();	jointNames.clear();
+		jointParents.clear();	bindPose.clear();		inverseBindPose.clear();
+		subMeshes.clear();		subMeshNames.clear();
+	}
+	return valid;
+}
+
+bool MeshGeometry::SaveBinary(const std::string& filename) const {
+	struct ChunkSource {
+		GeometryChunkTypes	type;
+		uint32_t			count;
+		const void*			data;
+		uint64_t			bytes;
+	};
+	vector<ChunkSource> sources;
+	auto addArray = [&](GeometryChunkTypes type, const auto& v) {
+		if (!v.empty()) {
+			sources.push_back({ type, (uint32_t)v.size(), v.data(), (uint64_t)(v.size() * sizeof(v[0])) });
+		}
+	};
+	std::string jointNameBlock;
+	std::string subMeshNameBlock;
+	for (const std::string& n : jointNames) {
+		jointNameBlock.append(n.c_str(), n.size() + 1);
+	}
+	for (const std::string& n : subMeshNames) {
+		subMeshNameBlock.append(n.c_str(), n.size() + 1);
+	}
+	addArray(GeometryChunkTypes::VPositions,	positions);
+	addArray(GeometryChunkTypes::VColors,		colours);
+	addArray(GeometryChunkTypes::VNormals,		normals);
+	addArray(GeometryChunkTypes::VTangents,		tangents);
+	addArray(GeometryChunkTypes::VTex0,			texCoords);
+	vector<uint16_t> shortIndices;
+	if (positions.size() <= MaxShortIndexVertices) {
+		shortIndices.assign(indices.begin(), indices.end());
+		addArray(GeometryChunkTypes::Indices16,	shortIndices);
+	}
+	else {
+		addArray(GeometryChunkTypes::Indices,	indices);
+	}
+	addArray(GeometryChunkTypes::VWeightValues,	skinWeights);
+	addArray(GeometryChunkTypes::VWeightIndices,	skinIndices);
+	addArray(GeometryChunkTypes::JointParents,	jointParents);
+	addArray(GeometryChunkTypes::BindPose,		bindPose);
+	addArray(GeometryChunkTypes::BindPoseInv,	inverseBindPose);
+	addArray(GeometryChunkTypes::SubMeshes,		subMeshes);
+	if (!jointNames.empty()) {
+		sources.push_back({ GeometryChunkTypes::JointNames, (uint32_t)jointNames.size(), jointNameBlock.data(), jointNameBlock.size() });
+	}
+	if (!subMeshNames.empty()) {
+		sources.push_back({ GeometryChunkTypes::SubMeshNames, (uint32_t)subMeshNames.size(), subMeshNameBlock.data(), subMeshNameBlock.size() });
+	}
+
+	std::ofstream file(Assets::MESHDIR + BinaryFilename(filename), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	BinaryMeshHeader header;
+	memcpy(header.magic, BinaryMeshMagic, 4);
+	header.version		= BinaryMeshVersion;
+	header.numMeshes	= (uint32_t)subMeshes.size();
+	header.numChunks	= (uint32_t)sources.size();
+	file.write((const char*)&header, sizeof(header));
+
+	uint64_t offset = AlignChunk(sizeof(BinaryMeshHeader) + sources.size() * sizeof(BinaryMeshChunk));
+	for (const ChunkSource& c : sources) {
+		BinaryMeshChunk chunk = { (uint32_t)c.type, c.count, offset, c.bytes };
+		file.write((const char*)&chunk, sizeof(chunk));
+		offset = AlignChunk(offset + c.bytes);
+	}
+	const char padding[16] = { 0 };
+	for (const ChunkSource& c : sources) {
+		file.write(padding, AlignChunk(file.tellp()) - (uint64_t)file.tellp());
+		file.write((const char*)c.data, c.bytes);
+	}
+	return (bool)file;
+}
+
+bool MeshGeometry::ConvertToBinary(const std::string& filename) {
+	//Only needs to be read in and written back out, never drawn
+	class TextMesh : public MeshGeometry {
+	public:
+		TextMesh(const std::string& filename) {
+			loaded = LoadText(filename);
+		}
+		void UploadToGPU(Rendering::RendererBase* renderer) override {}
+		bool loaded;
+	};
+	TextMesh mesh(filename);
+	if (mesh.loaded) {
+		mesh.OptimiseForGPU();
+	}
+	if (!mesh.loaded || !mesh.SaveBinary(filename)) {
+		std::cout << __FUNCTION__ << " couldn't convert " << filename << std::endl;
+		return false;
+	}
+	return true;
 }
 
 MeshGeometry::~MeshGeometry()
 {
+	for (auto& l : lods) {
+		delete l.mesh;
+	}
+	delete shadowProxy;
+}
+
+void MeshGeometry::SetShadowProxy(MeshGeometry* proxy) {
+	if (proxy != shadowProxy) {
+		delete shadowProxy;
+	}
+	shadowProxy = proxy;
+}
+
+void MeshGeometry::AddLOD(MeshGeometry* lod, float maxScreenSize) {
+	if (lods.empty()) {
+		for (const Vector3& p : positions) {
+			float length = p.Length();
+			boundingRadius = length > boundingRadius ? length : boundingRadius;
+		}
+	}
+	lod->lodParent = this;
+	lods.push_back({ lod, maxScreenSize });
+}
+
+MeshGeometry* MeshGeometry::SelectLOD(float screenSize) {
+	MeshGeometry* selected = this;
+	for (const LODLevel& l : lods) {
+		if (screenSize >= l.maxScreenSize) {
+			break;
+		}
+		selected = l.mesh;
+	}
+	return selected;
+}
+
+/*
+Each cell keeps the first vertex that fell into it, rather than an
+average, so its skin weights still match where it is. Triangles with two
+corners in the same cell have collapsed, and are dropped.
+*/
+bool MeshGeometry::Simplify(MeshGeometry& into, int cellsAcross) const {
+	if (primType != GeometryPrimitive::Triangles || indices.empty() || positions.empty() || cellsAcross < 1) {
+		return false;
+	}
+	Vector3 minPos = positions[0];
+	Vector3 maxPos = positions[0];
+	for (const Vector3& p : positions) {
+		for (int i = 0; i < 3; ++i) {
+			minPos[i] = p[i] < minPos[i] ? p[i] : minPos[i];
+			maxPos[i] = p[i] > maxPos[i] ? p[i] : maxPos[i];
+		}
+	}
+	Vector3 size	= maxPos - minPos;
+	float longest	= size.x > size.y ? size.x : size.y;
+	longest			= size.z > longest ? size.z : longest;
+	if (longest <= 0.0f) {
+		return false;
+	}
+	float cellSize = longest / cellsAcross;
+
+	vector<SubMesh> ranges = subMeshes;
+	if (ranges.empty()) {
+		ranges.push_back({ 0, (int)indices.size() });
+	}
+
+	std::unordered_map<uint64_t, unsigned int> cells;
+	for (const SubMesh& range : ranges) {
+		cells.clear();
+		SubMesh out;
+		out.start = (int)into.indices.size();
+		for (int i = range.start; i + 2 < range.start + range.count; i += 3) {
+			unsigned int tri[3];
+			for (int j = 0; j < 3; ++j) {
+				unsigned int v	= indices[i + j];
+				Vector3 cell	= (positions[v] - minPos) / cellSize;
+				uint64_t key	= ((uint64_t)cell.x << 42) | ((uint64_t)cell.y << 21) | (uint64_t)cell.z;
+
+				auto found = cells.find(key);
+				if (found != cells.end()) {
+					tri[j] = found->second;
+					continue;
+				}
+				tri[j] = (unsigned int)into.positions.size();
+				cells.insert({ key, tri[j] });
+
+				into.positions.push_back(positions[v]);
+				if (!texCoords.empty())		{ into.texCoords.push_back(texCoords[v]); }
+				if (!colours.empty())		{ into.colours.push_back(colours[v]); }
+				if (!normals.empty())		{ into.normals.push_back(normals[v]); }
+				if (!tangents.empty())		{ into.tangents.push_back(tangents[v]); }
+				if (!skinWeights.empty())	{ into.skinWeights.push_back(skinWeights[v]); }
+				if (!skinIndices.empty())	{ into.skinIndices.push_back(skinIndices[v]); }
+			}
+			if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+				continue;
+			}
+			into.indices.push_back(tri[0]);
+			into.indices.push_back(tri[1]);
+			into.indices.push_back(tri[2]);
+		}
+		out.count = (int)into.indices.size() - out.start;
+		into.subMeshes.push_back(out);
+	}
+	if (subMeshes.empty()) {
+		into.subMeshes.clear();
+	}
+	into.primType			= primType;
+	into.subMeshNames		= subMeshNames;
+	into.jointNames			= jointNames;
+	into.jointParents		= jointParents;
+	into.bindPose			= bindPose;
+	into.inverseBindPose	= inverseBindPose;
+	into.debugName			= debugName + " LOD";
+	return true;
+}
+
+bool MeshGeometry::MakeShadowProxy(MeshGeometry& into, int cellsAcross) const {
+	if (!Simplify(into, cellsAcross) || into.indices.empty()) {
+		return false;
+	}
+	vector<Vector2>().swap(into.texCoords);
+	vector<Vector4>().swap(into.colours);
+	vector<Vector3>().swap(into.normals);
+	vector<Vector4>().swap(into.tangents);
+	into.subMeshes		= { { 0, (int)into.indices.size() } };
+	into.subMeshNames.clear();
+	into.debugName		= debugName + " Shadow";
+	return true;
+}
+
+/*
+Tom Forsyth's linear-speed vertex cache optimisation. Each vertex is
+scored by how recently it was used, and by how few triangles it has left,
+so stragglers get finished off rather than left for later, and the next
+triangle is always the best scoring one that uses something in the cache.
+Only when none of them have anything left is everything else searched.
+*/
+namespace {
+	const int	ModelledCacheSize	= 32;
+
+	float VertexCacheScore(int cachePosition, int trianglesLeft) {
+		if (trianglesLeft == 0) {
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			//The last triangle's own vertices score a little lower, so it doesn't just spin round one vertex
+			score = cachePosition < 3 ? 0.75f : powf(1.0f - (cachePosition - 3) / (float)(ModelledCacheSize - 3), 1.5f);
+		}
+		return score + 2.0f / sqrtf((float)trianglesLeft);
+	}
+
+	void OptimiseTriangleOrder(unsigned int* triIndices, size_t indexCount, size_t vertexCount) {
+		const int triCount = (int)(indexCount / 3);
+		if (triCount < 2) {
+			return;
+		}
+		vector<int> firstTri(vertexCount + 1, 0);	//into vertexTris, for each vertex
+		vector<int> trisLeft(vertexCount, 0);
+		for (size_t i = 0; i < (size_t)triCount * 3; ++i) {
+			trisLeft[triIndices[i]]++;
+		}
+		for (size_t v = 0; v < vertexCount; ++v) {
+			firstTri[v + 1] = firstTri[v] + trisLeft[v];
+		}
+		vector<int> vertexTris(firstTri[vertexCount]);
+		vector<int> filled(firstTri.begin(), firstTri.end() - 1);
+		for (int t = 0; t < triCount; ++t) {
+			for (int c = 0; c < 3; ++c) {
+				vertexTris[filled[triIndices[t * 3 + c]]++] = t;
+			}
+		}
+
+		vector<int>		cachePosition(vertexCount, -1);
+		vector<float>	vertexScore(vertexCount, 0.0f);
+		for (size_t v = 0; v < vertexCount; ++v) {
+			vertexScore[v] = VertexCacheScore(-1, trisLeft[v]);
+		}
+		vector<float>	triScore(triCount, 0.0f);
+		vector<bool>	triDone(triCount, false);
+		for (int t = 0; t < triCount; ++t) {
+			for (int c = 0; c < 3; ++c) {
+				triScore[t] += vertexScore[triIndices[t * 3 + c]];
+			}
+		}
+
+		vector<unsigned int> ordered;
+		ordered.reserve((size_t)triCount * 3);
+		vector<unsigned int> cache;
+		int best = 0;
+		for (int t = 1; t < triCount; ++t) {
+			best = triScore[t] > triScore[best] ? t : best;
+		}
+		for (int emitted = 0; emitted < triCount; ++emitted) {
+			if (best < 0) {
+				for (int t = 0; t < triCount; ++t) {
+					if (!triDone[t] && (best < 0 || triScore[t] > triScore[best])) {
+						best = t;
+					}
+				}
+			}
+			triDone[best] = true;
+			//Its vertices go to the front of the cache, and it's taken out of their lists
+			vector<unsigned int> newCache;
+			newCache.reserve(ModelledCacheSize + 3);
+			for (int c = 0; c < 3; ++c) {
+				unsigned int v = triIndices[best * 3 + c];
+				ordered.emplace_back(v);
+				newCache.emplace_back(v);
+				int* tris	= &vertexTris[firstTri[v]];
+				int left	= trisLeft[v];
+				for (int i = 0; i < left; ++i) {
+					if (tris[i] == best) {
+						tris[i] = tris[left - 1];
+						break;
+					}
+				}
+				trisLeft[v]--;
+			}
+			for (unsigned int v : cache) {
+				if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+					newCache.emplace_back(v);
+				}
+			}
+			for (size_t i = ModelledCacheSize; i < newCache.size(); ++i) {
+				cachePosition[newCache[i]] = -1;
+				vertexScore[newCache[i]] = VertexCacheScore(-1, trisLeft[newCache[i]]);
+			}
+			if (newCache.size() > (size_t)ModelledCacheSize) {
+				newCache.resize(ModelledCacheSize);
+			}
+			cache.swap(newCache);
+
+			//Only the triangles using something in the cache can have changed enough to be next
+			for (size_t i = 0; i < cache.size(); ++i) {
+				cachePosition[cache[i]] = (int)i;
+				vertexScore[cache[i]] = VertexCacheScore((int)i, trisLeft[cache[i]]);
+			}
+			best = -1;
+			for (unsigned int v : cache) {
+				for (int i = 0; i < trisLeft[v]; ++i) {
+					int t = vertexTris[firstTri[v] + i];
+					triScore[t] = vertexScore[triIndices[t * 3]] + vertexScore[triIndices[t * 3 + 1]] + vertexScore[triIndices[t * 3 + 2]];
+					if (best < 0 || triScore[t] > triScore[best]) {
+						best = t;
+					}
+				}
+			}
+		}
+		memcpy(triIndices, ordered.data(), ordered.size() * sizeof(unsigned int));
+	}
+
+	template<class T>
+	void RemapVertices(vector<T>& attribute, const vector<unsigned int>& oldVertexFor) {
+		if (attribute.empty()) {
+			return;
+		}
+		vector<T> remapped(oldVertexFor.size());
+		for (size_t i = 0; i < oldVertexFor.size(); ++i) {
+			remapped[i] = attribute[oldVertexFor[i]];
+		}
+		attribute.swap(remapped);
+	}
+}
+
+void MeshGeometry::OptimiseForGPU() {
+	tangents.clear();
+	bool allWhite = true;
+	for (size_t i = 0; i < colours.size() && allWhite; ++i) {
+		allWhite = colours[i] == Vector4(1, 1, 1, 1);
+	}
+	if (allWhite) {
+		colours.clear();
+	}
+	if (jointNames.empty() && bindPose.empty()) {
+		skinWeights.clear();
+		skinIndices.clear();
+	}
+
+	if (primType != GeometryPrimitive::Triangles || indices.empty() || positions.empty()) {
+		return;
+	}
+	for (unsigned int i : indices) {
+		if (i >= positions.size()) {
+			return; //something's wrong with it, so it's left as it is
+		}
+	}
+	if (subMeshes.empty()) {
+		OptimiseTriangleOrder(indices.data(), indices.size(), positions.size());
+	}
+	for (const SubMesh& m : subMeshes) {
+		if (m.start >= 0 && m.count > 0 && (size_t)(m.start + m.count) <= indices.size()) {
+			OptimiseTriangleOrder(&indices[m.start], (size_t)m.count, positions.size());
+		}
+	}
+
+	const unsigned int unused = ~0u;
+	vector<unsigned int> newVertexFor(positions.size(), unused);
+	vector<unsigned int> oldVertexFor;
+	for (unsigned int& i : indices) {
+		if (newVertexFor[i] == unused) {
+			newVertexFor[i] = (unsigned int)oldVertexFor.size();
+			oldVertexFor.emplace_back(i);
+		}
+		i = newVertexFor[i];
+	}
+	RemapVertices(positions,	oldVertexFor);
+	RemapVertices(colours,		oldVertexFor);
+	RemapVertices(texCoords,	oldVertexFor);
+	RemapVertices(normals,		oldVertexFor);
+	RemapVertices(skinWeights,	oldVertexFor);
+	RemapVertices(skinIndices,	oldVertexFor);
 }
 
 bool MeshGeometry::HasTriangle(unsigned int i) const {
+	if (cpuDataReleased) {
+		return false;
+	}
 	int triCount = 0;
 	if (GetIndexCount() > 0) {
 		triCount = GetIndexCount() / 3;
@@ -234,6 +786,45 @@ void	MeshGeometry::RecalculateTangents() {
 
 }
 
+bool MeshGeometry::HasVertexAttribute(VertexAttribute attribute) const {
+	if (cpuDataReleased) {
+		return (releasedAttributes & (1 << attribute)) != 0;
+	}
+	switch (attribute) {
+	case VertexAttribute::Positions:		return !positions.empty();
+	case VertexAttribute::Colours:			return !colours.empty();
+	case VertexAttribute::TextureCoords:	return !texCoords.empty();
+	case VertexAttribute::Normals:			return !normals.empty();
+	case VertexAttribute::Tangents:			return !tangents.empty();
+	case VertexAttribute::JointWeights:		return !skinWeights.empty();
+	case VertexAttribute::JointIndices:		return !skinIndices.empty();
+	}
+	return false;
+}
+
+//Swapped with empty vectors, as clearing them would keep their capacity
+void MeshGeometry::ReleaseCPUData() {
+	if (cpuDataReleased) {
+		return;
+	}
+	releasedVertexCount	= GetVertexCount();
+	releasedIndexCount	= GetIndexCount();
+	releasedAttributes	= 0;
+	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
+		releasedAttributes |= HasVertexAttribute((VertexAttribute)i) ? (1 << i) : 0;
+	}
+	cpuDataReleased = true;
+
+	vector<Vector3>().swap(positions);
+	vector<Vector2>().swap(texCoords);
+	vector<Vector4>().swap(colours);
+	vector<Vector3>().swap(normals);
+	vector<Vector4>().swap(tangents);
+	vector<unsigned int>().swap(indices);
+	vector<Vector4>().swap(skinWeights);
+	vector<Vector4>().swap(skinIndices);
+}
+
 void MeshGeometry::SetVertexPositions(const vector<Vector3>& newVerts) {
 	positions = newVerts;
 }
@@ -292,7 +883,7 @@ void MeshGeometry::SetJointNames(std::vector < std::string >& newNames) {
 	jointNames = newNames;
 }
 
-void MeshGeometry::ReadRigPose(std::ifstream& file, vector<Matrix4>& into) {
+void MeshGeometry::ReadRigPose(std::istream& file, vector<Matrix4>& into) {
 	int matCount = 0;
 	file >> matCount;
 
@@ -305,7 +896,7 @@ void MeshGeometry::ReadRigPose(std::ifstream& file, vector<Matrix4>& into) {
 	}
 }
 
-void MeshGeometry::ReadJointParents(std::ifstream& file) {
+void MeshGeometry::ReadJointParents(std::istream& file) {
 	int jointCount = 0;
 	file >> jointCount;
 
@@ -316,7 +907,7 @@ void MeshGeometry::ReadJointParents(std::ifstream& file) {
 	}
 }
 
-void MeshGeometry::ReadJointNames(std::ifstream& file) {
+void MeshGeometry::ReadJointNames(std::istream& file) {
 	int jointCount = 0;
 	file >> jointCount;
 	std::string jointName;
@@ -329,7 +920,7 @@ void MeshGeometry::ReadJointNames(std::ifstream& file) {
 	}
 }
 
-void MeshGeometry::ReadSubMeshes(std::ifstream& file, int count) {
+void MeshGeometry::ReadSubMeshes(std::istream& file, int count) {
 	for (int i = 0; i < count; ++i) {
 		SubMesh m;
 		file >> m.start;
@@ -338,7 +929,7 @@ void MeshGeometry::ReadSubMeshes(std::ifstream& file, int count) {
 	}
 }
 
-void MeshGeometry::ReadSubMeshNames(std::ifstream& file, int count) {
+void MeshGeometry::ReadSubMeshNames(std::istream& file, int count) {
 	std::string scrap;
 	std::getline(file, scrap);
 
@@ -56,13 +56,36 @@ namespace NCL {
 		}
 
 		unsigned int GetVertexCount() const {
-			return (unsigned int)positions.size();
+			return cpuDataReleased ? releasedVertexCount : (unsigned int)positions.size();
 		}
 
 		unsigned int GetIndexCount()  const {
-			return (unsigned int)indices.size();
+			return cpuDataReleased ? releasedIndexCount : (unsigned int)indices.size();
 		}
 
+		//Still right once the CPU copy's been released, unlike checking the data
+		bool HasVertexAttribute(VertexAttribute attribute) const;
+
+		/*
+		Whether the vertex and index data's kept once it's been uploaded.
+		Anything that reads it back on the CPU - collision, merging into
+		an indirect batch, simplifying into LODs, or UpdateGPUBuffers -
+		needs it, but for a mesh that's only ever drawn it's a second copy
+		of what's on the GPU already. It's kept unless told otherwise.
+		*/
+		void SetRetainCPUData(bool retain) {
+			retainCPUData = retain;
+		}
+		bool RetainsCPUData() const {
+			return retainCPUData;
+		}
+		bool HasCPUData() const {
+			return !cpuDataReleased;
+		}
+		//Frees it now, whatever the flag says, keeping the counts and which
+		//attributes there were. The submeshes and the rig are kept
+		void ReleaseCPUData();
+
 		unsigned int GetJointCount() const {
 			return (unsigned int)jointNames.size();
 		}
@@ -134,15 +157,81 @@ namespace NCL {
 
 		static MeshGeometry* GenerateTriangle(MeshGeometry* input);
 
+		/*
+		Simpler versions of this mesh, for when it's small on screen. Each is
+		used once the mesh's bounding sphere covers less than maxScreenSize of
+		the screen's height, and they need adding largest first. This mesh
+		owns them, and deletes them with itself.
+		*/
+		void AddLOD(MeshGeometry* lod, float maxScreenSize);
+		MeshGeometry* SelectLOD(float screenSize);
+
+		unsigned int GetLODCount() const {
+			return (unsigned int)lods.size();
+		}
+		MeshGeometry* GetLOD(unsigned int i) const {
+			return lods[i].mesh;
+		}
+		float GetLODScreenSize(unsigned int i) const {
+			return lods[i].maxScreenSize;
+		}
+		//The full detail mesh, if this is one of its LODs
+		const MeshGeometry* GetLODParent() const {
+			return lodParent;
+		}
+		//Around the origin, taken when the first LOD is added
+		float GetBoundingRadius() const {
+			return boundingRadius;
+		}
+
+		/*
+		Fills an empty mesh with a cheaper version of this one, made by
+		merging every vertex in the same cell of a grid cellsAcross cells
+		along its longest side. Submeshes stay separate, so their textures
+		still line up, and the rig is copied over.
+		*/
+		bool Simplify(MeshGeometry& into, int cellsAcross) const;
+
+		//As Simplify, but with only the positions and the rig kept, all in one
+		//submesh, as a shadow map only needs the outline
+		bool MakeShadowProxy(MeshGeometry& into, int cellsAcross) const;
+
+		//Drawn into the shadow map instead of this mesh. This mesh owns it, as with its LODs
+		void SetShadowProxy(MeshGeometry* proxy);
+		MeshGeometry* GetShadowProxy() const {
+			return shadowProxy;
+		}
+
+		//Writes an optimised binary copy of a text mesh next to it, which is
+		//loaded in much faster, and is used instead of the text one from then on
+		static bool ConvertToBinary(const std::string& filename);
+
+		/*
+		Reorders each submesh's triangles so the GPU's post-transform cache
+		gets reused as much as possible, then renumbers the vertices in the
+		order they're first drawn, so they're fetched in order too. Any that
+		aren't drawn at all are dropped. So are attributes that don't change
+		anything: white vertex colours, skin weights without a rig, and
+		tangents, which none of the shaders read.
+		*/
+		void OptimiseForGPU();
+
+		//Up to this many vertices, indices are 16 bit in binary files and on the GPU
+		static const unsigned int MaxShortIndexVertices = 65536;
+
 	protected:
 		MeshGeometry();
 		MeshGeometry(const std::string&filename);
 
-		void ReadRigPose(std::ifstream& file, vector<Matrix4>& into);
-		void ReadJointParents(std::ifstream& file);
-		void ReadJointNames(std::ifstream& file);
-		void ReadSubMeshes(std::ifstream& file, int count);
-		void ReadSubMeshNames(std::ifstream& file, int count);
+		bool LoadText(const std::string& filename);
+		bool LoadBinary(const std::string& filename);
+		bool SaveBinary(const std::string& filename) const;
+
+		void ReadRigPose(std::istream& file, vector<Matrix4>& into);
+		void ReadJointParents(std::istream& file);
+		void ReadJointNames(std::istream& file);
+		void ReadSubMeshes(std::istream& file, int count);
+		void ReadSubMeshNames(std::istream& file, int count);
 
 		bool	GetVertexIndicesForTri(unsigned int i, unsigned int& a, unsigned int& b, unsigned int& c) const;
 
@@ -169,5 +258,20 @@ namespace NCL {
 
 		vector<Matrix4>		bindPose;
 		vector<Matrix4>		inverseBindPose;
+
+		struct LODLevel {
+			MeshGeometry*	mesh;
+			float			maxScreenSize;
+		};
+		vector<LODLevel>	lods;
+		const MeshGeometry*	lodParent		= nullptr;
+		MeshGeometry*		shadowProxy		= nullptr;
+		float				boundingRadius	= 0.0f;
+
+		bool			retainCPUData		= true;
+		bool			cpuDataReleased		= false;
+		unsigned int	releasedVertexCount	= 0;
+		unsigned int	releasedIndexCount	= 0;
+		unsigned int	releasedAttributes	= 0;	//a bit per VertexAttribute
 	};
 }
\ No newline at end of file
@@ -1,16 +1,15 @@
 #include "MeshMaterial.h"
 #include "Assets.h"
 #include "TextureLoader.h"
+#include "AssetFile.h"
 
-#include <fstream>
 #include <iostream>
 
 using namespace NCL;
 using namespace NCL::Rendering;
-using std::ifstream;
 
 MeshMaterial::MeshMaterial(const std::string& filename) {
-	ifstream file(Assets::MESHDIR + filename);
+	AssetStream file(Assets::MESHDIR + filename);
 
 	string dataType;
 	file >> dataType;
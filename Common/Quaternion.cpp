@@ -17,27 +17,6 @@ https://research.ncl.ac.uk/game/
 using namespace NCL;
 using namespace NCL::Maths;
 
-Quaternion::Quaternion(void)
-{
-	x = y = z = 0.0f;
-	w = 1.0f;
-}
-
-Quaternion::Quaternion(float x, float y, float z, float w)
-{
-	this->x = x;
-	this->y = y;
-	this->z = z;
-	this->w = w;
-}
-
-Quaternion::Quaternion(const Vector3& vector, float w) {
-	this->x = vector.x;
-	this->y = vector.y;
-	this->z = vector.z;
-	this->w = w;
-}
-
 Quaternion::Quaternion(const Matrix4 &m) {
 	w = sqrt(std::max(0.0f, (1.0f + m.array[0] + m.array[5] + m.array[10])))  * 0.5f;
 
@@ -71,27 +50,6 @@ Quaternion::Quaternion(const Matrix3 &m) {
 	z = (m.array[1] - m.array[3]) * qrFourRecip;
 }
 
-Quaternion::~Quaternion(void)
-{
-}
-
-float Quaternion::Dot(const Quaternion &a,const Quaternion &b){
-	return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
-}
-
-void Quaternion::Normalise(){
-	float magnitude = sqrt(x*x + y*y + z*z + w*w);
-
-	if(magnitude > 0.0f){
-		float t = 1.0f / magnitude;
-
-		x *= t;
-		y *= t;
-		z *= t;
-		w *= t;
-	}
-}
-
 void Quaternion::CalculateW()	{
 	w = 1.0f - (x*x)-(y*y)-(z*z);
 	if(w < 0.0f) {
@@ -102,23 +60,6 @@ void Quaternion::CalculateW()	{
 	}
 }
 
-Quaternion Quaternion::Conjugate() const
-{
-	return Quaternion(-x,-y,-z,w);
-}
-
-Quaternion Quaternion::Lerp(const Quaternion &from, const Quaternion &to, float by) {
-	Quaternion temp = to;
-
-	float dot = Quaternion::Dot(from,to);
-
-	if(dot < 0.0f) {
-		temp = -to;
-	}
-
-	return (from * (1.0f - by)) + (temp * by);
-}
-
 Quaternion Quaternion::Slerp(const Quaternion &from, const Quaternion &to, float by) {
 	Quaternion temp = to;
 
@@ -249,9 +190,3 @@ Quaternion NCL::Maths::Quaternion::LookRotation(Vector3& forward, Vector3& up) {
 	quaternion.w = (m01 - m10) * num2;
 	return quaternion;
 }
-
-
-Vector3		Quaternion::operator *(const Vector3 &a)	const {
-	Quaternion newVec = *this * Quaternion(a.x, a.y, a.z, 0.0f) * Conjugate();
-	return Vector3(newVec.x, newVec.y, newVec.z);
-}
\ No newline at end of file
@@ -7,13 +7,15 @@ Comments and queries to: richard-gordon.davison AT ncl.ac.uk
 https://research.ncl.ac.uk/game/
 */
 #pragma once
+#include "SIMD.h"
+#include "Vector3.h"
+#include <cmath>
 #include <iostream>
 
 namespace NCL {
 	namespace Maths {
 		class Matrix3;
 		class Matrix4;
-		class Vector3;
 
 		class Quaternion {
 		public:
@@ -27,56 +29,77 @@ namespace NCL {
 				float array[4];
 			};
 		public:
-			Quaternion(void);
-			Quaternion(float x, float y, float z, float w);
-			Quaternion(const Vector3& vector, float w);
+			constexpr Quaternion(void) : x(0.0f), y(0.0f), z(0.0f), w(1.0f) {}
+			constexpr Quaternion(float xVal, float yVal, float zVal, float wVal) : x(xVal), y(yVal), z(zVal), w(wVal) {}
+			constexpr Quaternion(const Vector3& vector, float wVal) : x(vector.x), y(vector.y), z(vector.z), w(wVal) {}
 
 			Quaternion(const Matrix3 &m);
 			Quaternion(const Matrix4 &m);
 
-			~Quaternion(void);
+			void	Normalise() {
+				float magnitude = sqrt(x*x + y*y + z*z + w*w);
 
-			void	Normalise();
-			
-			static float Dot(const Quaternion &a, const Quaternion &b);
+				if (magnitude > 0.0f) {
+					float t = 1.0f / magnitude;
 
-			static Quaternion	Lerp(const Quaternion &from, const Quaternion &to, float by);
+					x *= t;
+					y *= t;
+					z *= t;
+					w *= t;
+				}
+			}
+
+			static constexpr float Dot(const Quaternion &a, const Quaternion &b) {
+				return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+			}
+
+			static constexpr Quaternion	Lerp(const Quaternion &from, const Quaternion &to, float by) {
+				Quaternion temp = Dot(from, to) < 0.0f ? -to : to;
+				return (from * (1.0f - by)) + (temp * by);
+			}
 			static Quaternion	Slerp(const Quaternion &from, const Quaternion &to, float by);
 
 			Vector3		ToEuler() const;
-			Quaternion	Conjugate() const;
+			constexpr Quaternion	Conjugate() const {
+				return Quaternion(-x, -y, -z, w);
+			}
 			void		CalculateW();	//builds 4th component when loading in shortened, 3 component quaternions
 
 			static Quaternion EulerAnglesToQuaternion(float pitch, float yaw, float roll);
 			static Quaternion AxisAngleToQuaterion(const Vector3& vector, float degrees);
 			static Quaternion LookRotation(Vector3& forward, Vector3& up);
 
-			inline bool  operator ==(const Quaternion &from)	const {
+			inline constexpr bool  operator ==(const Quaternion &from)	const {
 				if (x != from.x || y != from.y || z != from.z || w != from.w) {
 					return false;
 				}
 				return true;
 			}
 
-			inline bool  operator !=(const Quaternion &from)	const {
+			inline constexpr bool  operator !=(const Quaternion &from)	const {
 				if (x != from.x || y != from.y || z != from.z || w != from.w) {
 					return true;
 				}
 				return false;
 			}
 
+			//The same sums as ever, just four at a time
 			inline Quaternion  operator *(const Quaternion &b)	const {
-				return Quaternion(
-					(x * b.w) + (w * b.x) + (y * b.z) - (z * b.y),
-					(y * b.w) + (w * b.y) + (z * b.x) - (x * b.z),
-					(z * b.w) + (w * b.z) + (x * b.y) - (y * b.x),
-					(w * b.w) - (x * b.x) - (y * b.y) - (z * b.z)
-				);
+				SIMD::Float4 o = SIMD::Mul(SIMD::Splat(w), SIMD::Load(b.array));
+				o = SIMD::MulAdd(SIMD::Set(x, y, z, -x), SIMD::Set(b.w, b.w, b.w, b.x), o);
+				o = SIMD::MulAdd(SIMD::Set(y, z, x, -y), SIMD::Set(b.z, b.x, b.y, b.y), o);
+				o = SIMD::Sub(o, SIMD::Mul(SIMD::Set(z, x, y, z), SIMD::Set(b.y, b.z, b.x, b.z)));
+				Quaternion out;
+				SIMD::Store(out.array, o);
+				return out;
 			}
 
-			Vector3		operator *(const Vector3 &a)	const;
+			inline Vector3		operator *(const Vector3 &a)	const {
+				Quaternion newVec = *this * Quaternion(a.x, a.y, a.z, 0.0f) * Conjugate();
+				return Vector3(newVec.x, newVec.y, newVec.z);
+			}
 
-			inline Quaternion  operator *(const float &a)		const {
+			inline constexpr Quaternion  operator *(const float &a)		const {
 				return Quaternion(x*a, y*a, z*a, w*a);
 			}
 
@@ -85,11 +108,11 @@ namespace NCL {
 				return *this;
 			}
 
-			inline Quaternion  operator -()	const {
+			inline constexpr Quaternion  operator -()	const {
 				return Quaternion(-x, -y, -z, -w);
 			}
 
-			inline Quaternion  operator -(const Quaternion &a)	const {
+			inline constexpr Quaternion  operator -(const Quaternion &a)	const {
 				return Quaternion(x - a.x, y - a.y, z - a.z, w - a.w);
 			}
 
@@ -98,7 +121,7 @@ namespace NCL {
 				return *this;
 			}
 
-			inline Quaternion  operator +(const Quaternion &a)	const {
+			inline constexpr Quaternion  operator +(const Quaternion &a)	const {
 				return Quaternion(x + a.x, y + a.y, z + a.z, w + a.w);
 			}
 
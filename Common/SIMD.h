@@ -0,0 +1,117 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+
+/*
+Which instructions the maths classes are built with. SSE2 is always there
+on x64 (and the PS4), and MSVC uses it for 32 bit builds too, while NEON
+is always there on 64 bit ARM, so those are picked up without asking.
+Defining NCL_MATHS_SCALAR for a project keeps the plain float versions,
+to check results against, or for anything with neither.
+*/
+#if !defined(NCL_MATHS_SCALAR) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NCL_MATHS_SSE
+#include <xmmintrin.h>
+#elif !defined(NCL_MATHS_SCALAR) && (defined(__aarch64__) || defined(_M_ARM64))
+#define NCL_MATHS_NEON
+#include <arm_neon.h>
+#elif !defined(NCL_MATHS_SCALAR)
+#define NCL_MATHS_SCALAR
+#endif
+
+namespace NCL {
+	namespace Maths {
+		/*
+		Just enough of a 4 float register for Vector4, Matrix4 and
+		Quaternion to share, whichever instructions they're built with.
+		Loads and stores are unaligned ones, so Vector4 and Matrix4 don't
+		need to be over-aligned - 32 bit builds only get 8 byte aligned
+		memory from new, which alignas wouldn't change, and on anything
+		recent unaligned loads of aligned memory cost no more anyway.
+		*/
+		namespace SIMD {
+#if defined(NCL_MATHS_SSE)
+			typedef __m128 Float4;
+
+			inline Float4	Load(const float* p)				{ return _mm_loadu_ps(p); }
+			inline void		Store(float* p, Float4 v)			{ _mm_storeu_ps(p, v); }
+			inline Float4	Splat(float f)						{ return _mm_set1_ps(f); }
+			inline Float4	Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+
+			inline Float4	Add(Float4 a, Float4 b)				{ return _mm_add_ps(a, b); }
+			inline Float4	Sub(Float4 a, Float4 b)				{ return _mm_sub_ps(a, b); }
+			inline Float4	Mul(Float4 a, Float4 b)				{ return _mm_mul_ps(a, b); }
+			inline Float4	Div(Float4 a, Float4 b)				{ return _mm_div_ps(a, b); }
+			inline Float4	MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+			inline float	Dot(Float4 a, Float4 b) {
+				Float4 m = _mm_mul_ps(a, b);
+				m = _mm_add_ps(m, _mm_movehl_ps(m, m));						//x+z, y+w
+				m = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+				return _mm_cvtss_f32(m);
+			}
+
+			//Rows become columns, so four of something can be worked on a lane each
+			inline void		Transpose(Float4& a, Float4& b, Float4& c, Float4& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+#elif defined(NCL_MATHS_NEON)
+			typedef float32x4_t Float4;
+
+			inline Float4	Load(const float* p)				{ return vld1q_f32(p); }
+			inline void		Store(float* p, Float4 v)			{ vst1q_f32(p, v); }
+			inline Float4	Splat(float f)						{ return vdupq_n_f32(f); }
+			inline Float4	Set(float x, float y, float z, float w) {
+				float f[4] = { x, y, z, w };
+				return vld1q_f32(f);
+			}
+
+			inline Float4	Add(Float4 a, Float4 b)				{ return vaddq_f32(a, b); }
+			inline Float4	Sub(Float4 a, Float4 b)				{ return vsubq_f32(a, b); }
+			inline Float4	Mul(Float4 a, Float4 b)				{ return vmulq_f32(a, b); }
+			inline Float4	Div(Float4 a, Float4 b)				{ return vdivq_f32(a, b); }
+			inline Float4	MulAdd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+
+			inline float	Dot(Float4 a, Float4 b)				{ return vaddvq_f32(vmulq_f32(a, b)); }
+
+			inline void		Transpose(Float4& a, Float4& b, Float4& c, Float4& d) {
+				float32x4x2_t ab = vtrnq_f32(a, b);	//a0 b0 a2 b2, a1 b1 a3 b3
+				float32x4x2_t cd = vtrnq_f32(c, d);
+				a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+				b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+				c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+				d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+			}
+#else
+			struct Float4 {
+				float v[4];
+			};
+
+			inline Float4	Load(const float* p)				{ return Float4{ { p[0], p[1], p[2], p[3] } }; }
+			inline void		Store(float* p, Float4 a)			{ p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+			inline Float4	Splat(float f)						{ return Float4{ { f, f, f, f } }; }
+			inline Float4	Set(float x, float y, float z, float w) { return Float4{ { x, y, z, w } }; }
+
+			inline Float4	Add(Float4 a, Float4 b)				{ return Float4{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+			inline Float4	Sub(Float4 a, Float4 b)				{ return Float4{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+			inline Float4	Mul(Float4 a, Float4 b)				{ return Float4{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+			inline Float4	Div(Float4 a, Float4 b)				{ return Float4{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+			inline Float4	MulAdd(Float4 a, Float4 b, Float4 c) { return Add(Mul(a, b), c); }
+
+			inline float	Dot(Float4 a, Float4 b)				{ return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]; }
+
+			inline void		Transpose(Float4& a, Float4& b, Float4& c, Float4& d) {
+				Float4 r[4] = { a, b, c, d };
+				a = Float4{ { r[0].v[0], r[1].v[0], r[2].v[0], r[3].v[0] } };
+				b = Float4{ { r[0].v[1], r[1].v[1], r[2].v[1], r[3].v[1] } };
+				c = Float4{ { r[0].v[2], r[1].v[2], r[2].v[2], r[3].v[2] } };
+				d = Float4{ { r[0].v[3], r[1].v[3], r[2].v[3], r[3].v[3] } };
+			}
+#endif
+		}
+	}
+}
@@ -14,6 +14,8 @@ https://research.ncl.ac.uk/game/
 #include "../Common/Vector2.h"
 #include "../Common/Vector3.h"
 #include "../Common/Vector4.h"
+#include "../Common/Matrix4.h"
+#include "../Common/Maths.h"
 
 using namespace NCL;
 using namespace Rendering;
@@ -48,6 +50,19 @@ SimpleFont::SimpleFont(const std::string&filename, const std::string&texName)
 	}
 	texWidthRecip	= 1.0f / texWidth;
 	texHeightRecip	= 1.0f / texHeight;
+
+	//FontBuilder's distance field fonts have an extra line on the end
+	distanceField	= false;
+	edgeValue		= 0.5f;
+	layoutScale		= 1.0f;
+	std::string tag;
+	if (fontFile >> tag && tag == "sdf") {
+		int edge = 128;
+		fontFile >> edge;
+		fontFile >> layoutScale;
+		distanceField	= true;
+		edgeValue		= edge / 255.0f;
+	}
 }
 
 
@@ -58,14 +73,25 @@ SimpleFont::~SimpleFont()
 }
 
 int SimpleFont::BuildVerticesForString(std::string &text, Vector2&startPos, Vector4&colour, float size, std::vector<Vector3>&positions, std::vector<Vector2>&texCoords, std::vector<Vector4>&colours) {
-	int vertsWritten = 0;
+	std::vector<Vector2> runPositions;
+	size_t firstTexCoord = texCoords.size();
+	BuildGlyphRun(text, runPositions, texCoords);
+
+	positions.reserve(positions.size() + runPositions.size());
+	for (const Vector2& p : runPositions) {
+		positions.emplace_back(Vector3(startPos.x + p.x * size, startPos.y + p.y * size, 0));
+	}
+	colours.resize(colours.size() + (texCoords.size() - firstTexCoord), colour);
+
+	return (int)runPositions.size();
+}
 
+void SimpleFont::BuildGlyphRun(const std::string& text, std::vector<Vector2>& positions, std::vector<Vector2>& texCoords) const {
 	int endChar = startChar + numChars;
 
 	float currentX = 0.0f;
 
 	positions.reserve(positions.size() + (text.length() * 6));
-	colours.reserve(colours.size() + (text.length() * 6));
 	texCoords.reserve(texCoords.size() + (text.length() * 6));
 
 	for (size_t i = 0; i < text.length(); ++i) {
@@ -74,37 +100,27 @@ int SimpleFont::BuildVerticesForString(std::string &text, Vector2&startPos, Vect
 		if (charIndex < startChar) {
 			continue;
 		}
-		if (charIndex > endChar) {
+		if (charIndex >= endChar) {
 			continue;
 		}
-		FontChar& charData = allCharData[charIndex - startChar];
+		const FontChar& charData = allCharData[charIndex - startChar];
 
-		float scale = size;
 		//For basic vertex buffers, we're assuming we should add 6 vertices
 
-		float charWidth  = (float)((charData.x1 - charData.x0)/ texWidth) * scale;
+		float charWidth  = (float)(charData.x1 - charData.x0) * texWidthRecip * layoutScale;
 		float charHeight = (float)(charData.y1 - charData.y0);
 
-		float xStart	= ((charData.xOff + currentX) * texWidthRecip) * scale;
-		float yStart	= startPos.y;
-		float yHeight	= (charHeight * texHeightRecip) * scale;
-		float yOff		= ((charHeight + charData.yOff) * texHeightRecip) * scale;
-
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff - yHeight, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff - yHeight, 0));
-
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff - yHeight, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff, 0));
+		float xStart	= (charData.xOff + currentX) * texWidthRecip * layoutScale;
+		float yHeight	= charHeight * texHeightRecip * layoutScale;
+		float yOff		= (charHeight + charData.yOff) * texHeightRecip * layoutScale;
 
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
+		positions.emplace_back(Vector2(xStart, yOff));
+		positions.emplace_back(Vector2(xStart, yOff - yHeight));
+		positions.emplace_back(Vector2(xStart + charWidth, yOff - yHeight));
 
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
+		positions.emplace_back(Vector2(xStart + charWidth, yOff - yHeight));
+		positions.emplace_back(Vector2(xStart + charWidth, yOff));
+		positions.emplace_back(Vector2(xStart, yOff));
 
 		texCoords.emplace_back(Vector2(charData.x0 * texWidthRecip, charData.y1 * texHeightRecip));
 		texCoords.emplace_back(Vector2(charData.x0 * texWidthRecip, charData.y0 * texHeightRecip));
@@ -116,6 +132,4 @@ int SimpleFont::BuildVerticesForString(std::string &text, Vector2&startPos, Vect
 
 		currentX += charData.xAdvance;
 	}
-
-	return vertsWritten;
-}
\ No newline at end of file
+}
@@ -26,10 +26,25 @@ namespace NCL {
 
 			int BuildVerticesForString(std::string &text, Maths::Vector2&startPos, Maths::Vector4&colour, float size, std::vector<Maths::Vector3>&positions, std::vector<Maths::Vector2>&texCoords, std::vector<Maths::Vector4>&colours);
 
+			//Six corners per character, at a size of 1 from the origin, for
+			//anything that wants to keep them and place them itself
+			void BuildGlyphRun(const std::string& text, std::vector<Maths::Vector2>& positions, std::vector<Maths::Vector2>& texCoords) const;
+
 			const TextureBase* GetTexture() const {
 				return texture;
 			}
 
+			//Signed distance field fonts store how far each texel is from the
+			//glyph's edge, so they can be drawn sharply at any size
+			bool IsDistanceField() const {
+				return distanceField;
+			}
+
+			//The texture's value right on a glyph's edge, from 0 to 1
+			float GetEdgeValue() const {
+				return edgeValue;
+			}
+
 		protected:
 			//matches stbtt_bakedchar
 			struct FontChar {
@@ -52,6 +67,10 @@ namespace NCL {
 			float texHeight;
 			float texWidthRecip;
 			float texHeightRecip;
+
+			bool	distanceField;
+			float	edgeValue;
+			float	layoutScale; //distance fields are baked smaller, so are scaled up to match
 		};
 	}
 }
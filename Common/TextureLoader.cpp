@@ -8,11 +8,13 @@ https://research.ncl.ac.uk/game/
 */
 #include "TextureLoader.h"
 #include <iostream>
+#include <fstream>
 #define STB_IMAGE_IMPLEMENTATION
 
 #include "./stb/stb_image.h"
 
 #include "Assets.h"
+#include "AssetFile.h"
 
 #ifdef WIN32
 #include <filesystem>
@@ -39,8 +41,12 @@ bool TextureLoader::LoadTexture(const std::string& filename, char*& outData, int
 		//There's a custom handler function for this, just use that
 		return it->second(realPath, outData, width, height, channels, flags);
 	}
-	//By default, attempt to use stb image to get this texture
-	stbi_uc *texData = stbi_load(realPath.c_str(), &width, &height, &channels, 4); //4 forces this to always be rgba!
+	//By default, attempt to use stb image to get this texture, from the archive if it's packed
+	AssetFile file;
+	if (!file.Open(realPath)) {
+		return false;
+	}
+	stbi_uc *texData = stbi_load_from_memory((const stbi_uc*)file.GetData(), (int)file.GetSize(), &width, &height, &channels, 4); //4 forces this to always be rgba!
 
 	if (texData) {
 		outData = (char*)texData;
@@ -50,6 +56,46 @@ bool TextureLoader::LoadTexture(const std::string& filename, char*& outData, int
 	return false;
 }
 
+std::string TextureLoader::CompressedFilename(const std::string& filename) {
+	size_t dot = filename.find_last_of('.');
+	return (dot == std::string::npos ? filename : filename.substr(0, dot)) + ".dds";
+}
+
+bool TextureLoader::LoadCompressedTexture(const std::string& filename, CompressedTexture& into, int maxSize, int maxLevels) {
+	if (filename.empty()) {
+		return false;
+	}
+	std::string path = Assets::TEXTUREDIR + CompressedFilename(filename);
+	if (!AssetFile::Exists(path)) {
+		return false;
+	}
+	return into.LoadDDS(path, maxSize, maxLevels);
+}
+
+bool TextureLoader::ConvertToCompressed(const std::string& filename) {
+	char* texData	= nullptr;
+	int width		= 0;
+	int height		= 0;
+	int channels	= 0;
+	int flags		= 0;
+	if (!LoadTexture(filename, texData, width, height, channels, flags)) {
+		std::cout << __FUNCTION__ << " couldn't load " << filename << std::endl;
+		return false;
+	}
+	bool opaque = true;
+	for (int i = 0; i < width * height && opaque; ++i) { //always RGBA, whatever the file had
+		opaque = (unsigned char)texData[i * 4 + 3] == 255;
+	}
+	CompressedTexture compressed;
+	bool saved =	compressed.Compress(texData, width, height, opaque ? CompressedTexture::Format::BC1 : CompressedTexture::Format::BC3) &&
+					compressed.SaveDDS(Assets::TEXTUREDIR + CompressedFilename(filename));
+	free(texData);
+	if (!saved) {
+		std::cout << __FUNCTION__ << " couldn't convert " << filename << std::endl;
+	}
+	return saved;
+}
+
 void TextureLoader::RegisterTextureLoadFunction(TextureLoadFunction f, const std::string&fileExtension) {
 	fileHandlers.insert(std::make_pair(fileExtension, f));
 }
@@ -13,6 +13,7 @@ https://research.ncl.ac.uk/game/
 using std::map;
 
 #include "TextureBase.h"
+#include "CompressedTexture.h"
 
 namespace NCL {
 
@@ -29,7 +30,17 @@ namespace NCL {
 		static void RegisterAPILoadFunction(APILoadFunction f);
 
 		static Rendering::TextureBase* LoadAPITexture(const std::string&filename);
+
+		//Loads the DDS copy of a texture made by ConvertToCompressed, if it has one,
+		//or just some of its levels, as CompressedTexture::LoadDDS does
+		static bool LoadCompressedTexture(const std::string& filename, CompressedTexture& into, int maxSize = 0, int maxLevels = 0);
+
+		//Writes a compressed copy of a texture next to it, with its mips,
+		//which is used instead of it from then on. Anything with transparency
+		//is BC3, and everything else BC1
+		static bool ConvertToCompressed(const std::string& filename);
 	protected:
+		static std::string CompressedFilename(const std::string& filename);
 
 		static std::string GetFileExtension(const std::string& fileExtension);
 
@@ -31,7 +31,6 @@ namespace NCL {
 			Vector2(const Vector3& v3);
 			Vector2(const Vector4& v4);
 
-			~Vector2(void) {}
 
 			Vector2 Normalised() const {
 				Vector2 temp(x, y);
@@ -34,7 +34,6 @@ namespace NCL {
 			Vector3(const Vector2& v2, float z = 0.0f);
 			Vector3(const Vector4& v4);
 
-			~Vector3(void) {}
 
 			Vector3 Normalised() const {
 				Vector3 temp(x, y, z);
@@ -87,35 +86,35 @@ namespace NCL {
 				return (a.x*b.x) + (a.y*b.y) + (a.z*b.z);
 			}
 
-			static Vector3	Cross(const Vector3 &a, const Vector3 &b) {
+			static constexpr Vector3	Cross(const Vector3 &a, const Vector3 &b) {
 				return Vector3((a.y*b.z) - (a.z*b.y), (a.z*b.x) - (a.x*b.z), (a.x*b.y) - (a.y*b.x));
 			}
 
-			inline Vector3  operator+(const Vector3  &a) const {
+			inline constexpr Vector3  operator+(const Vector3  &a) const {
 				return Vector3(x + a.x, y + a.y, z + a.z);
 			}
 
-			inline Vector3  operator-(const Vector3  &a) const {
+			inline constexpr Vector3  operator-(const Vector3  &a) const {
 				return Vector3(x - a.x, y - a.y, z - a.z);
 			}
 
-			inline Vector3  operator-() const {
+			inline constexpr Vector3  operator-() const {
 				return Vector3(-x, -y, -z);
 			}
 
-			inline Vector3  operator*(float a)	const {
+			inline constexpr Vector3  operator*(float a)	const {
 				return Vector3(x * a, y * a, z * a);
 			}
 
-			inline Vector3  operator*(const Vector3  &a) const {
+			inline constexpr Vector3  operator*(const Vector3  &a) const {
 				return Vector3(x * a.x, y * a.y, z * a.z);
 			}
 
-			inline Vector3  operator/(const Vector3  &a) const {
+			inline constexpr Vector3  operator/(const Vector3  &a) const {
 				return Vector3(x / a.x, y / a.y, z / a.z);
 			};
 
-			inline Vector3  operator/(float v) const {
+			inline constexpr Vector3  operator/(float v) const {
 				return Vector3(x / v, y / v, z / v);
 			};
 
@@ -125,32 +124,32 @@ namespace NCL {
 				z += a.z;
 			}
 
-			inline void operator-=(const Vector3  &a) {
+			inline constexpr void operator-=(const Vector3  &a) {
 				x -= a.x;
 				y -= a.y;
 				z -= a.z;
 			}
 
 
-			inline void operator*=(const Vector3  &a) {
+			inline constexpr void operator*=(const Vector3  &a) {
 				x *= a.x;
 				y *= a.y;
 				z *= a.z;
 			}
 
-			inline void operator/=(const Vector3  &a) {
+			inline constexpr void operator/=(const Vector3  &a) {
 				x /= a.x;
 				y /= a.y;
 				z /= a.z;
 			}
 
-			inline void operator*=(float f) {
+			inline constexpr void operator*=(float f) {
 				x *= f;
 				y *= f;
 				z *= f;
 			}
 
-			inline void operator/=(float f) {
+			inline constexpr void operator/=(float f) {
 				x /= f;
 				y /= f;
 				z /= f;
@@ -164,8 +163,8 @@ namespace NCL {
 				return array[i];
 			}
 
-			inline bool	operator==(const Vector3 &A)const { return (A.x == x && A.y == y && A.z == z) ? true : false; };
-			inline bool	operator!=(const Vector3 &A)const { return (A.x == x && A.y == y && A.z == z) ? false : true; };
+			inline constexpr bool	operator==(const Vector3 &A)const { return (A.x == x && A.y == y && A.z == z) ? true : false; };
+			inline constexpr bool	operator!=(const Vector3 &A)const { return (A.x == x && A.y == y && A.z == z) ? false : true; };
 
 			inline friend std::ostream& operator<<(std::ostream& o, const Vector3& v) {
 				o << "Vector3(" << v.x << "," << v.y << "," << v.z << ")" << std::endl;
@@ -7,6 +7,7 @@ Comments and queries to: richard-gordon.davison AT ncl.ac.uk
 https://research.ncl.ac.uk/game/
 */
 #pragma once
+#include "SIMD.h"
 #include <iostream>
 
 namespace NCL {
@@ -35,7 +36,6 @@ namespace NCL {
 			Vector4(const Vector3& v3, float w = 0.0f);
 			Vector4(const Vector2& v2, float z = 0.0f, float w = 0.0f);
 
-			~Vector4(void) {}
 
 			Vector4 Normalised() const {
 				Vector4 temp(x, y, z, w);
@@ -92,24 +92,26 @@ namespace NCL {
 			}
 
 			static float	Dot(const Vector4 &a, const Vector4 &b) {
-				return (a.x*b.x) + (a.y*b.y) + (a.z*b.z) + (a.w*b.w);
+				return SIMD::Dot(SIMD::Load(a.array), SIMD::Load(b.array));
 			}
 
 			static Vector4 Lerp(Vector4 start, Vector4 end, float t) {
-				return Vector4(
-					start.x + (end.x - start.x) * t,
-					start.y + (end.y - start.y) * t,
-					start.z + (end.z - start.z) * t,
-					start.w + (end.w - start.w) * t
-				);
+				SIMD::Float4 s = SIMD::Load(start.array);
+				return FromSIMD(SIMD::MulAdd(SIMD::Sub(SIMD::Load(end.array), s), SIMD::Splat(t), s));
+			}
+
+			static Vector4 FromSIMD(SIMD::Float4 v) {
+				Vector4 out;
+				SIMD::Store(out.array, v);
+				return out;
 			}
 
 			inline Vector4  operator+(const Vector4  &a) const {
-				return Vector4(x + a.x, y + a.y, z + a.z, w + a.w);
+				return FromSIMD(SIMD::Add(SIMD::Load(array), SIMD::Load(a.array)));
 			}
 
 			inline Vector4  operator-(const Vector4  &a) const {
-				return Vector4(x - a.x, y - a.y, z - a.z, w - a.w);
+				return FromSIMD(SIMD::Sub(SIMD::Load(array), SIMD::Load(a.array)));
 			}
 
 			inline Vector4  operator-() const {
@@ -117,19 +119,19 @@ namespace NCL {
 			}
 
 			inline Vector4  operator*(float a)	const {
-				return Vector4(x * a, y * a, z * a, w * a);
+				return FromSIMD(SIMD::Mul(SIMD::Load(array), SIMD::Splat(a)));
 			}
 
 			inline Vector4  operator*(const Vector4  &a) const {
-				return Vector4(x * a.x, y * a.y, z * a.z, w * a.w);
+				return FromSIMD(SIMD::Mul(SIMD::Load(array), SIMD::Load(a.array)));
 			}
 
 			inline Vector4  operator/(const Vector4  &a) const {
-				return Vector4(x / a.x, y / a.y, z / a.z, w / a.w);
+				return FromSIMD(SIMD::Div(SIMD::Load(array), SIMD::Load(a.array)));
 			};
 
 			inline Vector4  operator/(float v) const {
-				return Vector4(x / v, y / v, z / v, w / v);
+				return FromSIMD(SIMD::Div(SIMD::Load(array), SIMD::Splat(v)));
 			};
 
 			inline constexpr void operator+=(const Vector4  &a) {
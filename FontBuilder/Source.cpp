@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstring>
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "../Common/stb/stb_truetype.h"
 
@@ -9,11 +10,63 @@
 
 using std::string;
 
-int main(void) {
+/*
+With -sdf, the atlas is a signed distance field instead, so one texture
+looks sharp at any size. It's baked at half the size, with room around
+each glyph for the distance to fall away, and the .fnt file gets an extra
+line saying so, and how much to scale the smaller glyphs back up by.
+*/
+static const float	bitmapHeight	= 48.0f;
+static const float	sdfHeight		= 24.0f;
+static const int	sdfPadding		= 4;
+static const int	sdfEdge			= 128;
+
+static void BakeDistanceField(const unsigned char* fontData, unsigned char* bitmapData, int xSize, int ySize, int startChar, int numChars, stbtt_bakedchar* cdata) {
+	stbtt_fontinfo info;
+	stbtt_InitFont(&info, fontData, stbtt_GetFontOffsetForIndex(fontData, 0));
+	float scale = stbtt_ScaleForPixelHeight(&info, sdfHeight);
+
+	memset(bitmapData, 0, xSize * ySize);
+	int x = 1, y = 1, rowHeight = 0;
+	for (int i = 0; i < numChars; ++i) {
+		int w = 0, h = 0, xOff = 0, yOff = 0;
+		unsigned char* glyph = stbtt_GetCodepointSDF(&info, scale, startChar + i, sdfPadding, sdfEdge, (float)sdfEdge / sdfPadding, &w, &h, &xOff, &yOff);
+
+		if (x + w + 1 >= xSize) { //on to the next row
+			x = 1;
+			y += rowHeight + 1;
+			rowHeight = 0;
+		}
+		if (y + h + 1 >= ySize) {
+			std::cout << "Ran out of room for the glyphs!" << std::endl;
+			w = h = 0;
+		}
+		for (int row = 0; row < h; ++row) {
+			memcpy(bitmapData + (y + row) * xSize + x, glyph + row * w, w);
+		}
+		int advance, leftBearing;
+		stbtt_GetCodepointHMetrics(&info, startChar + i, &advance, &leftBearing);
+
+		cdata[i].x0			= (unsigned short)x;
+		cdata[i].y0			= (unsigned short)y;
+		cdata[i].x1			= (unsigned short)(x + w);
+		cdata[i].y1			= (unsigned short)(y + h);
+		cdata[i].xoff		= (float)xOff;
+		cdata[i].yoff		= (float)yOff;
+		cdata[i].xadvance	= advance * scale;
+
+		x += w + 1;
+		rowHeight = h > rowHeight ? h : rowHeight;
+		stbtt_FreeSDF(glyph, nullptr);
+	}
+}
+
+int main(int argc, char** argv) {
+	bool sdf = argc > 1 && string(argv[1]) == "-sdf";
 
 	string inFont	= "PressStart2P.ttf";
-	string outTex	= "PressStart2P.png";
-	string outData	= "PressStart2P.fnt";
+	string outTex	= sdf ? "PressStart2PSDF.png" : "PressStart2P.png";
+	string outData	= sdf ? "PressStart2PSDF.fnt" : "PressStart2P.fnt";
 
 	int xSize = 512;
 	int ySize = 512;
@@ -28,7 +81,12 @@ int main(void) {
 
 	stbtt_bakedchar cdata[96];
 
-	stbtt_BakeFontBitmap(fontData, 0, 48.0, bitmapData, xSize, ySize, startChar, numChars, cdata);
+	if (sdf) {
+		BakeDistanceField(fontData, bitmapData, xSize, ySize, startChar, numChars, cdata);
+	}
+	else {
+		stbtt_BakeFontBitmap(fontData, 0, bitmapHeight, bitmapData, xSize, ySize, startChar, numChars, cdata);
+	}
 
 	stbi_write_png(outTex.c_str(), xSize, ySize, 1, bitmapData, xSize * 1);
 
@@ -53,6 +111,9 @@ int main(void) {
 				<< cdata[i].xadvance
 				<< std::endl;
 	}
+	if (sdf) {
+		fntFile << "sdf " << sdfEdge << " " << (bitmapHeight / sdfHeight) << std::endl;
+	}
 
 	return 0;
 }
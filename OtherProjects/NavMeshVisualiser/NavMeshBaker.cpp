@@ -0,0 +1,199 @@
+#include "NavMeshBaker.h"
+#include "../../CSC8503/CSC8503Common/NavigationMesh.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+CSC8503::NavigationMesh* NavMeshBaker::Bake(const std::string& levelFile) {
+	LevelData level;
+	if (!level.Load(levelFile)) {
+		return nullptr;
+	}
+	return Bake(level);
+}
+
+CSC8503::NavigationMesh* NavMeshBaker::Bake(const LevelData& level) {
+	stats = Stats();
+	const int perCell = settings.voxelsPerCell < 1 ? 1 : settings.voxelsPerCell;
+	settings.voxelsPerCell = perCell;
+
+	const float voxelSize = level.GetUnitSize() / (float)perCell;
+	Voxelise(level);
+	Erode((int)ceilf(settings.agentRadius / voxelSize));
+	MergeRects();
+	if (rects.empty()) {
+		return nullptr;
+	}
+
+	std::vector<Vector3>	vertices;
+	std::vector<int>		indices;
+	Triangulate(voxelSize, vertices, indices);
+
+	stats.rectangles	= (int)rects.size();
+	stats.vertices		= (int)vertices.size();
+	stats.triangles		= (int)indices.size() / 3;
+	return new NavigationMesh(vertices, indices);
+}
+
+std::string NavMeshBaker::GetBakedFilename(const std::string& levelFile) {
+	return levelFile.substr(0, levelFile.find_last_of('.')) + ".navmesh";
+}
+
+//The same cells the level's colliders are made from, plus the colour walls
+bool NavMeshBaker::IsSolid(char type) {
+	return type == 'i' || (type >= 'a' && type <= 'd') || (type >= 'w' && type <= 'z');
+}
+
+void NavMeshBaker::Voxelise(const LevelData& level) {
+	const int perCell = settings.voxelsPerCell;
+	voxelWidth	= level.GetWidth() * perCell;
+	voxelDepth	= level.GetHeight() * perCell;
+	walkable.assign(voxelWidth * voxelDepth, 1);
+
+	for (const LevelData::CellGroup& group : level.GetGroups()) {
+		if (!IsSolid(group.type)) {
+			continue;
+		}
+		for (uint32_t cell : group.cells) {
+			int cx = (cell % level.GetWidth()) * perCell;
+			int cy = (cell / level.GetWidth()) * perCell;
+			for (int y = 0; y < perCell; ++y) {
+				for (int x = 0; x < perCell; ++x) {
+					walkable[(cy + y) * voxelWidth + cx + x] = 0;
+				}
+			}
+		}
+	}
+}
+
+/*
+A voxel's only kept if there's nothing solid within radius voxels of it
+in either direction, which is done a row at a time and then a column at
+a time. Outside the grid counts as solid, so the mesh keeps away from
+the level's edge too.
+*/
+void NavMeshBaker::Erode(int radius) {
+	if (radius > 0) {
+		std::vector<char> rows(walkable.size());
+		for (int y = 0; y < voxelDepth; ++y) {
+			for (int x = 0; x < voxelWidth; ++x) {
+				char keep = x >= radius && x + radius < voxelWidth;
+				for (int i = -radius; i <= radius && keep; ++i) {
+					keep = walkable[y * voxelWidth + x + i];
+				}
+				rows[y * voxelWidth + x] = keep;
+			}
+		}
+		for (int y = 0; y < voxelDepth; ++y) {
+			for (int x = 0; x < voxelWidth; ++x) {
+				char keep = y >= radius && y + radius < voxelDepth;
+				for (int i = -radius; i <= radius && keep; ++i) {
+					keep = rows[(y + i) * voxelWidth + x];
+				}
+				walkable[y * voxelWidth + x] = keep;
+			}
+		}
+	}
+	stats.walkableVoxels = 0;
+	for (char w : walkable) {
+		stats.walkableVoxels += w;
+	}
+}
+
+//Each rectangle's grown along its row as far as it'll go, then down for as many rows as are all free
+void NavMeshBaker::MergeRects() {
+	rects.clear();
+	std::vector<char> used(walkable.size(), 0);
+	auto isFree = [&](int x, int y) {
+		int i = y * voxelWidth + x;
+		return walkable[i] && !used[i];
+	};
+	for (int y = 0; y < voxelDepth; ++y) {
+		for (int x = 0; x < voxelWidth; ++x) {
+			if (!isFree(x, y)) {
+				continue;
+			}
+			Rect r = { x, y, 1, 1 };
+			while (r.x + r.width < voxelWidth && isFree(r.x + r.width, y)) {
+				r.width++;
+			}
+			for (bool grow = true; grow && r.y + r.height < voxelDepth;) {
+				for (int i = 0; i < r.width && grow; ++i) {
+					grow = isFree(r.x + i, r.y + r.height);
+				}
+				r.height += grow ? 1 : 0;
+			}
+			for (int j = 0; j < r.height; ++j) {
+				for (int i = 0; i < r.width; ++i) {
+					used[(r.y + j) * voxelWidth + r.x + i] = 1;
+				}
+			}
+			rects.emplace_back(r);
+		}
+	}
+}
+
+/*
+Corners are shared between every rectangle that has them, and each
+rectangle goes around its edges picking up every corner on them in
+order, so two rectangles that meet have exactly the same edges along
+where they meet. Fanning from a vertex in the middle means none of the
+triangles are slivers, even when there's a run of corners in a line.
+*/
+void NavMeshBaker::Triangulate(float voxelSize, std::vector<Vector3>& vertices, std::vector<int>& indices) const {
+	const int cornerWidth = voxelWidth + 1;
+	std::vector<char>	isCorner(cornerWidth * (voxelDepth + 1), 0);
+	std::vector<int>	cornerVertex(isCorner.size(), -1);
+	for (const Rect& r : rects) {
+		isCorner[r.y * cornerWidth + r.x]							= 1;
+		isCorner[r.y * cornerWidth + r.x + r.width]					= 1;
+		isCorner[(r.y + r.height) * cornerWidth + r.x]				= 1;
+		isCorner[(r.y + r.height) * cornerWidth + r.x + r.width]	= 1;
+	}
+	auto getVertex = [&](int x, int y) {
+		int& v = cornerVertex[y * cornerWidth + x];
+		if (v < 0) {
+			v = (int)vertices.size();
+			vertices.emplace_back(Vector3(x * voxelSize, 0.0f, y * voxelSize));
+		}
+		return v;
+	};
+
+	std::vector<int> edge;
+	for (const Rect& r : rects) {
+		const int x0 = r.x;
+		const int y0 = r.y;
+		const int x1 = r.x + r.width;
+		const int y1 = r.y + r.height;
+		edge.clear();
+		for (int x = x0; x < x1; ++x) {
+			if (isCorner[y0 * cornerWidth + x]) {
+				edge.emplace_back(getVertex(x, y0));
+			}
+		}
+		for (int y = y0; y < y1; ++y) {
+			if (isCorner[y * cornerWidth + x1]) {
+				edge.emplace_back(getVertex(x1, y));
+			}
+		}
+		for (int x = x1; x > x0; --x) {
+			if (isCorner[y1 * cornerWidth + x]) {
+				edge.emplace_back(getVertex(x, y1));
+			}
+		}
+		for (int y = y1; y > y0; --y) {
+			if (isCorner[y * cornerWidth + x0]) {
+				edge.emplace_back(getVertex(x0, y));
+			}
+		}
+
+		const int centre = (int)vertices.size();
+		vertices.emplace_back(Vector3((x0 + x1) * 0.5f * voxelSize, 0.0f, (y0 + y1) * 0.5f * voxelSize));
+		for (size_t i = 0; i < edge.size(); ++i) {
+			indices.emplace_back(centre);
+			indices.emplace_back(edge[i]);
+			indices.emplace_back(edge[(i + 1) % edge.size()]);
+		}
+	}
+}
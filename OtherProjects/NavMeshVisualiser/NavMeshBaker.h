@@ -0,0 +1,75 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../CSC8503/GameTech/LevelData.h"
+#include <vector>
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		class NavigationMesh;
+	}
+	using namespace Maths;
+
+	/*
+	Makes a level's navigation mesh ahead of time, so the game only has to
+	map it in. The level's grid is split into voxels, a few to a cell, and
+	anything solid - obstacles, edge walls and colour walls, and everything
+	outside the grid - is grown by the agent's radius, so the mesh is only
+	where something that size can stand. What's left is merged into as
+	few rectangles as it'll go into, and each rectangle is fanned out from
+	its middle, through every corner on its edges - including the corners
+	of the rectangles next to it - so rectangles meeting along an edge
+	always split it at the same vertices, and are found as neighbours.
+	*/
+	class NavMeshBaker {
+	public:
+		struct Settings {
+			int		voxelsPerCell	= 2;
+			float	agentRadius		= 1.0f;
+		};
+
+		struct Stats {
+			int walkableVoxels	= 0;
+			int rectangles		= 0;
+			int vertices		= 0;
+			int triangles		= 0;
+		};
+
+		NavMeshBaker() {}
+		NavMeshBaker(const Settings& settings) : settings(settings) {}
+
+		//Null if the level couldn't be loaded, or has nowhere to walk
+		CSC8503::NavigationMesh* Bake(const std::string& levelFile);
+		CSC8503::NavigationMesh* Bake(const CSC8503::LevelData& level);
+
+		const Stats& GetStats() const {
+			return stats;
+		}
+
+		//Where a level's baked mesh goes, next to it
+		static std::string GetBakedFilename(const std::string& levelFile);
+
+	protected:
+		struct Rect {
+			int x;
+			int y;
+			int width;
+			int height;
+		};
+
+		static bool IsSolid(char type);
+
+		void Voxelise(const CSC8503::LevelData& level);
+		void Erode(int radius);
+		void MergeRects();
+		void Triangulate(float voxelSize, std::vector<Vector3>& vertices, std::vector<int>& indices) const;
+
+		Settings			settings;
+		Stats				stats;
+
+		int					voxelWidth	= 0;
+		int					voxelDepth	= 0;
+		std::vector<char>	walkable;
+		std::vector<Rect>	rects;
+	};
+}
@@ -1,34 +1,33 @@
 #pragma once
 #include "../../Plugins/OpenGLRendering/OGLRenderer.h"
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
-#include "../../Plugins/OpenGLRendering/OGLTexture.h"
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
 
 namespace NCL {
 	class Camera;
-	class MeshAnimation;
+	namespace CSC8503 {
+		class NavigationMesh;
+	}
 
+	/*
+	Shows a baked navigation mesh from above, with its triangles filled in
+	and their edges drawn over them, so anywhere the baker's left a gap or
+	a sliver stands out. The camera can be flown around as usual.
+	*/
 	class NavMeshRenderer : public OGLRenderer
 	{
 	public:
-		NavMeshRenderer();
+		NavMeshRenderer(const CSC8503::NavigationMesh& mesh);
 		virtual ~NavMeshRenderer();
 		void Update(float dt) override;
 
-		void DebugDrawSkeleton(const OGLMesh* mesh, const Matrix4* matrices);
-
 	protected:
 		void RenderFrame(int curFrame)	override;
-		MeshAnimation* testAnim;
-		OGLMesh*	navMesh;
-		OGLShader*	navShader;
-		OGLTexture* testTex;
-		Camera*		camera;
-		OGLShader* debugShader;
-		int frame;
+		void DrawMesh(OGLMesh* mesh, const Matrix4& viewProj);
 
-		float frameTime;
-		float allTime;
+		OGLMesh*	triMesh;
+		OGLMesh*	edgeMesh;
+		OGLShader*	meshShader;
+		Camera*		camera;
 	};
 }
-
@@ -1,26 +1,69 @@
 #include "../../Common/Window.h"
+#include "../../CSC8503/CSC8503Common/NavigationMesh.h"
 #include "NavMeshRenderer.h"
+#include "NavMeshBaker.h"
+#include <iostream>
+#include <cstring>
 using namespace NCL;
+using namespace CSC8503;
 
-int main() {
-	Window* w = Window::CreateGameWindow("NavMesh Tester", 1120, 768);
-	w->SetConsolePosition(100, 0);
-	if (!w->HasInitialised()) {
+/*
+Bakes a level's navigation mesh, next to it in the data folder, then
+shows it. Takes the level's file name (LevelData.txt if it's not given),
+and -nowindow to just bake it and go, as a build step would.
+*/
+int main(int argc, char** argv) {
+	std::string levelFile	= "LevelData.txt";
+	bool		showMesh	= true;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-nowindow") == 0) {
+			showMesh = false;
+		}
+		else {
+			levelFile = argv[i];
+		}
+	}
+
+	NavMeshBaker baker;
+	NavigationMesh* mesh = baker.Bake(levelFile);
+	if (!mesh) {
+		std::cout << "Couldn't bake a navigation mesh from " << levelFile << "\n";
+		return -1;
+	}
+	const NavMeshBaker::Stats& stats = baker.GetStats();
+	std::string bakedFile = NavMeshBaker::GetBakedFilename(levelFile);
+	std::cout << levelFile << ": " << stats.walkableVoxels << " walkable voxels, merged into " << stats.rectangles << " rectangles, "
+		<< stats.triangles << " triangles over " << stats.vertices << " vertices\n";
+	if (!mesh->SaveBaked(bakedFile)) {
+		std::cout << "Couldn't write " << bakedFile << "\n";
+		delete mesh;
 		return -1;
 	}
+	std::cout << "Written to " << bakedFile << "\n";
 
-	NavMeshRenderer* renderer = new NavMeshRenderer();
+	if (showMesh) {
+		Window* w = Window::CreateGameWindow("NavMesh Baker", 1120, 768);
+		w->SetConsolePosition(100, 0);
+		if (!w->HasInitialised()) {
+			delete mesh;
+			return -1;
+		}
 
-	w->LockMouseToWindow(true);
-	w->ShowOSPointer(false);
+		NavMeshRenderer* renderer = new NavMeshRenderer(*mesh);
 
-	while (w->UpdateWindow() && !Window::GetKeyboard()->KeyDown(KeyboardKeys::ESCAPE)) {
-		float time = w->GetTimer()->GetTimeDeltaSeconds();
-		renderer->Update(time);
-		renderer->Render(0);
-	}
+		w->LockMouseToWindow(true);
+		w->ShowOSPointer(false);
+
+		while (w->UpdateWindow() && !Window::GetKeyboard()->KeyDown(KeyboardKeys::ESCAPE)) {
+			float time = w->GetTimer()->GetTimeDeltaSeconds();
+			renderer->Update(time);
+			renderer->Render(0);
+		}
 
-	delete renderer;
+		delete renderer;
 
-	Window::DestroyGameWindow();
-}
\ No newline at end of file
+		Window::DestroyGameWindow();
+	}
+	delete mesh;
+	return 0;
+}
@@ -21,6 +21,10 @@ namespace NCL {
 			return programID;
 		}
 
+		bool LoadSuccess() const {
+			return programValid == GL_TRUE;
+		}
+
 		void Bind() const;
 
 		//how many thread groups should be launched?
@@ -10,6 +10,10 @@ https://research.ncl.ac.uk/game/
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/Vector4.h"
+#include "../../Common/MemoryTracker.h"
+#include <vector>
+#include <cstring>
+#include <iostream>
 
 using namespace NCL;
 using namespace NCL::Rendering;
@@ -23,6 +27,13 @@ OGLMesh::OGLMesh() {
 		attributeBuffers[i] = 0;
 	}
 	indexBuffer = 0;
+	indexType	= GL_UNSIGNED_INT;
+	indexSize	= sizeof(GLuint);
+
+	packedVertices	= false;
+	packedBuffer	= 0;
+	packedStride	= 0;
+	gpuBytes		= 0;
 }
 
 OGLMesh::OGLMesh(const std::string&filename) : MeshGeometry(filename){
@@ -33,18 +44,28 @@ OGLMesh::OGLMesh(const std::string&filename) : MeshGeometry(filename){
 		attributeBuffers[i] = 0;
 	}
 	indexBuffer = 0;
+	indexType	= GL_UNSIGNED_INT;
+	indexSize	= sizeof(GLuint);
+
+	packedVertices	= false;
+	packedBuffer	= 0;
+	packedStride	= 0;
+	gpuBytes		= 0;
 }
 
 OGLMesh::~OGLMesh()	{
 	glDeleteVertexArrays(1, &vao);			//Delete our VAO
 	glDeleteBuffers(VertexAttribute::MAX_ATTRIBUTES, attributeBuffers);	//Delete our VBOs
 	glDeleteBuffers(1, &indexBuffer);	//Delete our indices
+	glDeleteBuffers(1, &packedBuffer);
+	MemoryTracker::RecordGPU(MemoryTag::Meshes, -(int64_t)gpuBytes);
 }
 
-void CreateVertexBuffer(GLuint& buffer, int byteCount, char* data) {
+size_t CreateVertexBuffer(GLuint& buffer, int byteCount, char* data) {
 	glGenBuffers(1, &buffer);
 	glBindBuffer(GL_ARRAY_BUFFER, buffer);
 	glBufferData(GL_ARRAY_BUFFER, byteCount, data, GL_STATIC_DRAW);
+	return byteCount;
 }
 
 void OGLMesh::BindVertexAttribute(int attribSlot, int buffer, int bindingID, int elementCount, int elementSize, int elementOffset) {
@@ -59,56 +80,229 @@ void OGLMesh::UploadToGPU(Rendering::RendererBase* renderer) {
 	if (!ValidateMeshData()) {
 		return;
 	}
+	if (packedVertices) {
+		for (const Vector4& i : GetSkinIndexData()) {
+			if (i.x > 255 || i.y > 255 || i.z > 255 || i.w > 255) {
+				packedVertices = false;
+				break;
+			}
+		}
+	}
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	int numVertices = GetVertexCount();
 	int numIndices	= GetIndexCount();
 
+	if (packedVertices) {
+		UploadPackedBuffer();
+	}
+	else {
+		UploadAttributeBuffers();
+	}
+
+	if (!GetIndexData().empty()) {		//buffer index data, in 16 bits if they'll fit
+		glGenBuffers(1, &indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		if (GetVertexCount() <= MaxShortIndexVertices) {
+			std::vector<GLushort> shortIndices(GetIndexData().begin(), GetIndexData().end());
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+			indexType = GL_UNSIGNED_SHORT;
+			indexSize = sizeof(GLushort);
+		}
+		else {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), (int*)GetIndexData().data(), GL_STATIC_DRAW);
+			indexType = GL_UNSIGNED_INT;
+			indexSize = sizeof(GLuint);
+		}
+		gpuBytes += numIndices * indexSize;
+	}
+
+	glBindVertexArray(0);
+	MemoryTracker::RecordGPU(MemoryTag::Meshes, (int64_t)gpuBytes);
+	if (!RetainsCPUData()) {
+		ReleaseCPUData();
+	}
+}
+
+void OGLMesh::UploadAttributeBuffers() {
+	int numVertices = GetVertexCount();
+
 	if (!GetPositionData().empty()) {
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::Positions], numVertices * sizeof(Vector3), (char*)GetPositionData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::Positions], numVertices * sizeof(Vector3), (char*)GetPositionData().data());
 		BindVertexAttribute(VertexAttribute::Positions, attributeBuffers[VertexAttribute::Positions], VertexAttribute::Positions, 3, sizeof(Vector3), 0);
 	}
 
 	if (!GetColourData().empty()) {	//buffer colour data
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::Colours], numVertices * sizeof(Vector4), (char*)GetColourData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::Colours], numVertices * sizeof(Vector4), (char*)GetColourData().data());
 		BindVertexAttribute(VertexAttribute::Colours, attributeBuffers[VertexAttribute::Colours], VertexAttribute::Colours, 4, sizeof(Vector4), 0);
 	}
 	if (!GetTextureCoordData().empty()) {	//Buffer texture data
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::TextureCoords], numVertices * sizeof(Vector2), (char*)GetTextureCoordData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::TextureCoords], numVertices * sizeof(Vector2), (char*)GetTextureCoordData().data());
 		BindVertexAttribute(VertexAttribute::TextureCoords, attributeBuffers[VertexAttribute::TextureCoords], VertexAttribute::TextureCoords, 2, sizeof(Vector2), 0);
 	}
 
 	if (!GetNormalData().empty()) {	//Buffer normal data
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::Normals], numVertices * sizeof(Vector3), (char*)GetNormalData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::Normals], numVertices * sizeof(Vector3), (char*)GetNormalData().data());
 		BindVertexAttribute(VertexAttribute::Normals, attributeBuffers[VertexAttribute::Normals], VertexAttribute::Normals, 3, sizeof(Vector3), 0);
 	}
 
 	if (!GetTangentData().empty()) {	//Buffer tangent data
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::Tangents], numVertices * sizeof(Vector4), (char*)GetTangentData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::Tangents], numVertices * sizeof(Vector4), (char*)GetTangentData().data());
 		BindVertexAttribute(VertexAttribute::Tangents, attributeBuffers[VertexAttribute::Tangents], VertexAttribute::Tangents, 4, sizeof(Vector4), 0);
 	}
 
 	if (!GetSkinWeightData().empty()) {	//Skeleton weights
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::JointWeights], numVertices * sizeof(Vector4), (char*)GetSkinWeightData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::JointWeights], numVertices * sizeof(Vector4), (char*)GetSkinWeightData().data());
 		BindVertexAttribute(VertexAttribute::JointWeights, attributeBuffers[VertexAttribute::JointWeights], VertexAttribute::JointWeights, 4, sizeof(Vector4), 0);
 	}
 
 	if (!GetSkinIndexData().empty()) {	//Skeleton joint indices
-		CreateVertexBuffer(attributeBuffers[VertexAttribute::JointIndices], numVertices * sizeof(Vector4), (char*)GetSkinIndexData().data());
+		gpuBytes += CreateVertexBuffer(attributeBuffers[VertexAttribute::JointIndices], numVertices * sizeof(Vector4), (char*)GetSkinIndexData().data());
 		BindVertexAttribute(VertexAttribute::JointIndices, attributeBuffers[VertexAttribute::JointIndices], VertexAttribute::JointIndices, 4, sizeof(Vector4), 0);
 	}
+}
 
-	if (!GetIndexData().empty()) {		//buffer index data
-		glGenBuffers(1, &attributeBuffers[VertexAttribute::MAX_ATTRIBUTES]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, attributeBuffers[VertexAttribute::MAX_ATTRIBUTES]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), (int*)GetIndexData().data(), GL_STATIC_DRAW);
+namespace {
+	//Rounds to the nearest, and doesn't bother with NaNs
+	GLushort FloatToHalf(float f) {
+		GLuint bits;
+		memcpy(&bits, &f, sizeof(bits));
+		GLuint	sign		= (bits >> 16) & 0x8000;
+		int		exponent	= (int)((bits >> 23) & 0xff) - 127 + 15;
+		GLuint	mantissa	= bits & 0x7fffff;
+		if (exponent >= 31) {
+			return (GLushort)(sign | 0x7c00);
+		}
+		if (exponent <= 0) { //too small to be normalised
+			if (exponent < -10) {
+				return (GLushort)sign;
+			}
+			mantissa |= 0x800000;
+			GLuint shift = 14 - exponent;
+			GLuint half = mantissa >> shift;
+			if (mantissa & (1 << (shift - 1))) {
+				half++;
+			}
+			return (GLushort)(sign | half);
+		}
+		GLuint half = ((GLuint)exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000) {
+			half++; //can carry into the exponent, which is still right
+		}
+		return (GLushort)(sign | half);
 	}
 
-	glBindVertexArray(0);
+	//For GL_INT_2_10_10_10_REV, with x in the lowest bits
+	GLuint PackSigned1010102(const Vector4& v) {
+		auto pack = [](float f, int bits) {
+			f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+			int maxValue = (1 << (bits - 1)) - 1;
+			int packed = (int)(f * maxValue + (f < 0 ? -0.5f : 0.5f));
+			return (GLuint)packed & ((1u << bits) - 1);
+		};
+		return pack(v.x, 10) | (pack(v.y, 10) << 10) | (pack(v.z, 10) << 20) | (pack(v.w, 2) << 30);
+	}
+
+	void PackBytes(const Vector4& v, float scale, char* into) {
+		for (int i = 0; i < 4; ++i) {
+			float f = v.array[i] * scale;
+			f = f < 0.0f ? 0.0f : (f > 255.0f ? 255.0f : f);
+			into[i] = (char)(unsigned char)(f + 0.5f);
+		}
+	}
+}
+
+/*
+Each vertex is its position, followed by 4 bytes for each other attribute
+the mesh has, in the order of VertexAttribute.
+*/
+void OGLMesh::PackVertices(unsigned int startVertex, unsigned int vertexCount, char* into) const {
+	for (unsigned int i = startVertex; i < startVertex + vertexCount; ++i) {
+		memcpy(into, &positions[i], sizeof(Vector3));
+		char* next = into + sizeof(Vector3);
+		if (!colours.empty()) {
+			PackBytes(colours[i], 255.0f, next);
+			next += 4;
+		}
+		if (!texCoords.empty()) {
+			GLushort uv[2] = { FloatToHalf(texCoords[i].x), FloatToHalf(texCoords[i].y) };
+			memcpy(next, uv, sizeof(uv));
+			next += 4;
+		}
+		if (!normals.empty()) {
+			GLuint n = PackSigned1010102(Vector4(normals[i], 0.0f));
+			memcpy(next, &n, sizeof(n));
+			next += 4;
+		}
+		if (!tangents.empty()) {
+			GLuint t = PackSigned1010102(tangents[i]);
+			memcpy(next, &t, sizeof(t));
+			next += 4;
+		}
+		if (!skinWeights.empty()) {
+			PackBytes(skinWeights[i], 255.0f, next);
+			next += 4;
+		}
+		if (!skinIndices.empty()) {
+			PackBytes(skinIndices[i], 1.0f, next);
+			next += 4;
+		}
+		into += packedStride;
+	}
+}
+
+void OGLMesh::UploadPackedBuffer() {
+	struct PackedAttribute {
+		VertexAttribute	attribute;
+		bool			present;
+		int				elements;
+		GLenum			type;
+		bool			normalised;
+	};
+	const PackedAttribute packed[] = {
+		{ VertexAttribute::Colours,			!colours.empty(),		4, GL_UNSIGNED_BYTE,			true },
+		{ VertexAttribute::TextureCoords,	!texCoords.empty(),		2, GL_HALF_FLOAT,				false },
+		{ VertexAttribute::Normals,			!normals.empty(),		4, GL_INT_2_10_10_10_REV,		true },
+		{ VertexAttribute::Tangents,		!tangents.empty(),		4, GL_INT_2_10_10_10_REV,		true },
+		{ VertexAttribute::JointWeights,	!skinWeights.empty(),	4, GL_UNSIGNED_BYTE,			true },
+		{ VertexAttribute::JointIndices,	!skinIndices.empty(),	4, GL_UNSIGNED_BYTE,			false },
+	};
+	const int binding = 0;
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, 0);
+	glVertexAttribBinding(VertexAttribute::Positions, binding);
+
+	packedStride = sizeof(Vector3);
+	for (const PackedAttribute& a : packed) {
+		if (!a.present) {
+			continue;
+		}
+		glEnableVertexAttribArray(a.attribute);
+		glVertexAttribFormat(a.attribute, a.elements, a.type, a.normalised, packedStride);
+		glVertexAttribBinding(a.attribute, binding);
+		packedStride += 4;
+	}
+
+	int numVertices = GetVertexCount();
+	std::vector<char> vertexData(numVertices * packedStride);
+	PackVertices(0, numVertices, vertexData.data());
+	gpuBytes += CreateVertexBuffer(packedBuffer, (int)vertexData.size(), vertexData.data());
+	glBindVertexBuffer(binding, packedBuffer, 0, packedStride);
 }
 
 void OGLMesh::UpdateGPUBuffers(unsigned int startVertex, unsigned int vertexCount) {
+	if (!HasCPUData()) {
+		std::cout << __FUNCTION__ << " " << debugName << " has nothing to update from, as it didn't keep its CPU data" << std::endl;
+		return;
+	}
+	if (packedVertices) {
+		std::vector<char> vertexData(vertexCount * packedStride);
+		PackVertices(startVertex, vertexCount, vertexData.data());
+		glBindBuffer(GL_ARRAY_BUFFER, packedBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, startVertex * packedStride, vertexData.size(), vertexData.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
 	if (!GetPositionData().empty()) {
 		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffers[VertexAttribute::Positions]);
 		glBufferSubData(GL_ARRAY_BUFFER, startVertex * sizeof(Vector3), vertexCount * sizeof(Vector3), (char*)&GetPositionData()[startVertex]);
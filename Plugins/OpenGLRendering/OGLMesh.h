@@ -27,16 +27,45 @@ namespace NCL {
 			void UploadToGPU(Rendering::RendererBase* renderer = nullptr) override;
 			void UpdateGPUBuffers(unsigned int startVertex, unsigned int vertexCount);
 
+			GLuint	GetAttributeBuffer(VertexAttribute attribute) const { return attributeBuffers[attribute]; }
+
+			//Chosen when it's uploaded, as 16 bits if there are few enough vertices
+			GLenum	GetIndexType()	const { return indexType; }
+			int		GetIndexSize()	const { return indexSize; }
+
+			/*
+			Has to be set before UploadToGPU. Every attribute then goes into
+			one interleaved buffer, with everything but the positions packed
+			down - half float texture coordinates, 10 bit normals and tangents,
+			and 8 bit colours and skin weights - so there are no separate
+			attribute buffers for anything else (like compute skinning) to use.
+			Meshes with more than 256 joints can't be packed, and aren't.
+			*/
+			void SetPackedVertices(bool packed) { packedVertices = packed; }
+			bool HasPackedVertices() const { return packedVertices; }
+
 		protected:
 			GLuint	GetVAO()			const { return vao;			}
 			void BindVertexAttribute(int attribSlot, int bufferID, int bindingID, int elementCount, int elementSize, int elementOffset);
 
+			void UploadAttributeBuffers();
+			void UploadPackedBuffer();
+			void PackVertices(unsigned int startVertex, unsigned int vertexCount, char* into) const;
+
 			int		subCount;
 
 			GLuint vao;
 			GLuint oglType;
 			GLuint attributeBuffers[VertexAttribute::MAX_ATTRIBUTES];
 			GLuint indexBuffer;
+			GLenum indexType;
+			int    indexSize;
+
+			bool	packedVertices;
+			GLuint	packedBuffer;
+			int		packedStride;
+
+			size_t	gpuBytes;	//uploaded, for the MemoryTracker
 		};
 	}
 }
\ No newline at end of file
@@ -20,6 +20,11 @@ https://research.ncl.ac.uk/game/
 #include "../../Common/Matrix4.h"
 
 #include "../../Common/MeshGeometry.h"
+#include "../../Common/Assets.h"
+
+#include <cstddef>
+#include <cmath>
+#include <fstream>
 
 #ifdef _WIN32
 #include "../../Common/Win32Window.h"
@@ -47,6 +52,7 @@ OGLRenderer::OGLRenderer(Window& w) : RendererBase(w)	{
 #endif
 	boundMesh	= nullptr;
 	boundShader = nullptr;
+	debugTextShader = nullptr;
 
 	currentWidth	= (int)w.GetScreenSize().x;
 	currentHeight	= (int)w.GetScreenSize().y;
@@ -54,43 +60,53 @@ OGLRenderer::OGLRenderer(Window& w) : RendererBase(w)	{
 	if (initState) {
 		TextureLoader::RegisterAPILoadFunction(OGLTexture::RGBATextureFromFilename);
 
-		font = new SimpleFont("PressStart2P.fnt", "PressStart2P.png");
+		//FontBuilder's distance field version, if it's been made, looks right at any size
+		if (std::ifstream(Assets::FONTSDIR + "PressStart2PSDF.fnt")) {
+			font = new SimpleFont("PressStart2PSDF.fnt", "PressStart2PSDF.png");
+		}
+		else {
+			font = new SimpleFont("PressStart2P.fnt", "PressStart2P.png");
+		}
 
 		OGLTexture* t = (OGLTexture*)font->GetTexture();
 
 		if (t) {
+			//Distance fields have to be filtered, or they're as blocky as any other texture
+			GLint filter = font->IsDistanceField() ? GL_LINEAR : GL_NEAREST;
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, t->GetObjectID());
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
 			glBindTexture(GL_TEXTURE_2D, 0);
 		}
 		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 		debugShader = new OGLShader("debugVert.glsl", "debugFrag.glsl");
+		debugTextShader = debugShader;
+		if (font->IsDistanceField()) {
+			debugTextShader = new OGLShader("debugVert.glsl", "debugSDFFrag.glsl");
+		}
 	}
 
 	forceValidDebugState = false;
 
-	debugLinesMesh		= new OGLMesh();
-	debugTextMesh		= new OGLMesh();
-
-
-	debugLinesMesh->SetVertexPositions(std::vector<Vector3>(10000, Vector3()));
-	debugLinesMesh->SetVertexColours(std::vector<Vector4>(10000, Vector3()));
-
-	debugTextMesh->SetVertexPositions(std::vector<Vector3>(5000, Vector3()));
-	debugTextMesh->SetVertexColours(std::vector<Vector4>(5000, Vector3()));
-	debugTextMesh->SetVertexTextureCoords(std::vector<Vector2>(5000, Vector3()));
-
-	debugTextMesh->UploadToGPU();
-	debugLinesMesh->UploadToGPU();
-
-	debugLinesMesh->SetPrimitiveType(GeometryPrimitive::Lines);
+	if (initState) {
+		CreateDebugStream(debugLineStream, DebugLineVertices);
+		CreateDebugStream(debugTextStream, DebugTextVertices);
+		CreateWireShapes();
+		CreateTimedLines();
+	}
 }
 
 OGLRenderer::~OGLRenderer()	{
 	delete font;
+	if (debugTextShader != debugShader) {
+		delete debugTextShader;
+	}
 	delete debugShader;
+	DestroyDebugStream(debugLineStream);
+	DestroyDebugStream(debugTextStream);
+	DestroyWireShapes();
+	DestroyTimedLines();
 
 #ifdef _WIN32
 	DestroyWithWin32();
@@ -119,10 +135,13 @@ void OGLRenderer::EndFrame()		{
 }
 
 void OGLRenderer::SwapBuffers()   {
+	lastFrameStats	= frameStats;
+	frameStats		= FrameStats();
 	::SwapBuffers(deviceContext);
 }
 
 void OGLRenderer::BindShader(ShaderBase*s) {
+	frameStats.shaderBinds++;
 	if (!s) {
 		glUseProgram(0);
 		boundShader = nullptr;
@@ -138,6 +157,7 @@ void OGLRenderer::BindShader(ShaderBase*s) {
 }
 
 void OGLRenderer::BindMesh(MeshGeometry*m) {
+	frameStats.meshBinds++;
 	if (!m) {
 		glBindVertexArray(0);
 		boundMesh = nullptr;
@@ -191,11 +211,31 @@ void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances) {
 		case GeometryPrimitive::Patches:		mode = GL_PATCHES;			break;
 	}
 
+	int instances = numInstances > 1 ? numInstances : 1;
+	frameStats.drawCalls++;
+	frameStats.instances += instances;
+	if (mode == GL_TRIANGLES) {
+		frameStats.triangles += (count / 3) * instances;
+	}
+	else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2) {
+		frameStats.triangles += (count - 2) * instances;
+	}
+
 	if (boundMesh->GetIndexCount() > 0) {
-		glDrawElements(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)));
+		if (numInstances > 1) {
+			glDrawElementsInstanced(mode, count, boundMesh->GetIndexType(), (const GLvoid*)(size_t)(offset * boundMesh->GetIndexSize()), numInstances);
+		}
+		else {
+			glDrawElements(mode, count, boundMesh->GetIndexType(), (const GLvoid*)(size_t)(offset * boundMesh->GetIndexSize()));
+		}
 	}
 	else {
-		glDrawArrays(mode, 0, count);
+		if (numInstances > 1) {
+			glDrawArraysInstanced(mode, 0, count, numInstances);
+		}
+		else {
+			glDrawArrays(mode, 0, count);
+		}
 	}
 }
 
@@ -207,36 +247,44 @@ void OGLRenderer::BindTextureToShader(const TextureBase*t, const std::string& un
 		return;//Debug message time!
 	}
 	
-	GLuint slot = glGetUniformLocation(boundShader->programID, uniform.c_str());
+	int slot = boundShader->GetUniformLocation(uniform);
 
 	if (slot < 0) {
 		return;
 	}
 
+	GLenum target = GL_TEXTURE_2D;
 	if (const OGLTexture* oglTexture = dynamic_cast<const OGLTexture*>(t)) {
-		texID = oglTexture->GetObjectID();
+		texID	= oglTexture->GetObjectID();
+		target	= oglTexture->GetTarget();
 	}
 
 	glActiveTexture(GL_TEXTURE0 + texUnit);
-	glBindTexture(GL_TEXTURE_2D, texID);
+	glBindTexture(target, texID);
+	frameStats.textureBinds++;
 
 	glUniform1i(slot, texUnit);
 	
 }
 // 8508
 void OGLRenderer::BindTexturesToShader(unsigned int t, const std::string& uniform, int texUnit){
+	BindTexturesToShader(t, OGLShader::GetUniformID(uniform), texUnit);
+}
+
+void OGLRenderer::BindTexturesToShader(unsigned int t, int uniformID, int texUnit) {
 	if (!boundShader) {
 		std::cout << __FUNCTION__ << " has been called without a bound shader!" << std::endl;
 		return;//Debug message time!
 	}
 
-	GLuint slot = glGetUniformLocation(boundShader->programID, uniform.c_str());
+	int slot = boundShader->GetUniformLocation(uniformID);
 
 	if (slot < 0) {
 		return ;
 	}
 	glActiveTexture(GL_TEXTURE0 + texUnit);
 	glBindTexture(GL_TEXTURE_2D, t);
+	frameStats.textureBinds++;
 
 	glUniform1i(slot, texUnit);
 	
@@ -250,12 +298,269 @@ void OGLRenderer::DrawString(const std::string& text, const Vector2&pos, const V
 	debugStrings.emplace_back(s);
 }
 
+void OGLRenderer::DrawWireShape(WireShape shape, const Matrix4& transform, const Vector4& colour) {
+	if (wireVAO) {
+		wireInstances[(int)shape].push_back({ transform, colour });
+	}
+}
+
+void OGLRenderer::DrawTimedLine(const Vector3& start, const Vector3& end, const Vector4& colour, float expiresAt) {
+	if (!timedLineVAO) {
+		return;
+	}
+	newTimedLines.push_back({ start, expiresAt, colour });
+	newTimedLines.push_back({ end, expiresAt, colour });
+	timedLineLatest = expiresAt > timedLineLatest ? expiresAt : timedLineLatest;
+}
+
 void OGLRenderer::DrawLine(const Vector3& start, const Vector3& end, const Vector4& colour) {
-	DebugLine l;
-	l.start		= start;
-	l.end		= end;
-	l.colour	= colour;
-	debugLines.emplace_back(l);
+	DebugVertex* v = GetDebugVertices(debugLineStream, 2);
+	if (!v) {
+		return;
+	}
+	v[0].position	= start;
+	v[0].colour		= colour;
+	v[1].position	= end;
+	v[1].colour		= colour;
+}
+
+/*
+Each stream gets space for DebugFrames frames of vertices in one buffer,
+interleaved so a line or a character is one contiguous write. If the
+driver can keep it mapped, DrawLine writes straight into the GPU's copy,
+otherwise the frame's vertices are built up in staging and copied over
+in one glBufferSubData when they're drawn.
+*/
+void OGLRenderer::CreateDebugStream(DebugStream& stream, int capacity) {
+	const GLsizeiptr size = sizeof(DebugVertex) * capacity * DebugFrames;
+	stream.capacity = capacity;
+
+	glGenVertexArrays(1, &stream.vao);
+	glBindVertexArray(stream.vao);
+
+	glGenBuffers(1, &stream.buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+	if (glBufferStorage && glMapBufferRange) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		stream.memory = (DebugVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+	if (!stream.memory) {
+		stream.staging.resize(capacity);
+	}
+
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, offsetof(DebugVertex, position));
+	glVertexAttribBinding(VertexAttribute::Positions, 0);
+
+	glEnableVertexAttribArray(VertexAttribute::Colours);
+	glVertexAttribFormat(VertexAttribute::Colours, 4, GL_FLOAT, false, offsetof(DebugVertex, colour));
+	glVertexAttribBinding(VertexAttribute::Colours, 0);
+
+	glEnableVertexAttribArray(VertexAttribute::TextureCoords);
+	glVertexAttribFormat(VertexAttribute::TextureCoords, 2, GL_FLOAT, false, offsetof(DebugVertex, texCoord));
+	glVertexAttribBinding(VertexAttribute::TextureCoords, 0);
+
+	glBindVertexBuffer(0, stream.buffer, 0, sizeof(DebugVertex));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OGLRenderer::DestroyDebugStream(DebugStream& stream) {
+	if (!stream.vao) {
+		return;
+	}
+	for (GLsync& f : stream.fences) {
+		if (f) {
+			glDeleteSync(f);
+		}
+	}
+	if (stream.memory) {
+		glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &stream.buffer);
+	glDeleteVertexArrays(1, &stream.vao);
+}
+
+//Space for count more vertices this frame, or null if it's full up
+OGLRenderer::DebugVertex* OGLRenderer::GetDebugVertices(DebugStream& stream, int count) {
+	if (stream.count + count > stream.capacity) {
+		return nullptr;
+	}
+	DebugVertex* frameStart = stream.memory ? stream.memory + (debugFrame * stream.capacity) : stream.staging.data();
+	DebugVertex* v = frameStart + stream.count;
+	stream.count += count;
+	return v;
+}
+
+void OGLRenderer::DrawDebugStream(DebugStream& stream, GLenum mode) {
+	const int first = debugFrame * stream.capacity;
+	if (!stream.memory) {
+		glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(DebugVertex), stream.count * sizeof(DebugVertex), stream.staging.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	BindMesh(nullptr);
+	glBindVertexArray(stream.vao);
+	glDrawArrays(mode, first, stream.count);
+	glBindVertexArray(0);
+
+	if (stream.memory) {
+		stream.fences[debugFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	stream.count = 0;
+}
+
+//Line segments around a unit circle, in whichever two axes it's given
+static void AddWireArc(std::vector<Vector3>& lines, int axisA, int axisB, float fromAngle, float toAngle, int segments) {
+	for (int i = 0; i < segments; ++i) {
+		for (int end = 0; end < 2; ++end) {
+			float a = fromAngle + (toAngle - fromAngle) * (float)(i + end) / (float)segments;
+			Vector3 p;
+			p[axisA] = cos(a);
+			p[axisB] = sin(a);
+			lines.emplace_back(p);
+		}
+	}
+}
+
+/*
+All of the shapes share one vertex buffer of line segments, and an
+instance buffer that's refilled every frame, whose matrix and colour go
+in the same attribute slots the instanced scene shaders use.
+*/
+void OGLRenderer::CreateWireShapes() {
+	debugWireShader = new OGLShader("debugWireVert.glsl", "debugFrag.glsl");
+	if (!debugWireShader->LoadSuccess()) {
+		return;
+	}
+	const float pi = 3.14159265f;
+	std::vector<Vector3> lines;
+
+	wireFirstVertex[(int)WireShape::Box] = (int)lines.size();
+	for (int axis = 0; axis < 3; ++axis) { //four edges along each axis
+		int a = (axis + 1) % 3;
+		int b = (axis + 2) % 3;
+		for (int corner = 0; corner < 4; ++corner) {
+			Vector3 p;
+			p[a] = (corner & 1) ? 1.0f : -1.0f;
+			p[b] = (corner & 2) ? 1.0f : -1.0f;
+			p[axis] = -1.0f;
+			lines.emplace_back(p);
+			p[axis] = 1.0f;
+			lines.emplace_back(p);
+		}
+	}
+	wireVertexCount[(int)WireShape::Box] = (int)lines.size() - wireFirstVertex[(int)WireShape::Box];
+
+	wireFirstVertex[(int)WireShape::Hemisphere] = (int)lines.size();
+	AddWireArc(lines, 0, 2, 0.0f, pi * 2.0f, 24);	//round the bottom
+	AddWireArc(lines, 0, 1, 0.0f, pi, 12);			//and over the top both ways
+	AddWireArc(lines, 2, 1, 0.0f, pi, 12);
+	wireVertexCount[(int)WireShape::Hemisphere] = (int)lines.size() - wireFirstVertex[(int)WireShape::Hemisphere];
+
+	wireFirstVertex[(int)WireShape::CapsuleSides] = (int)lines.size();
+	for (int side = 0; side < 4; ++side) {
+		float a = pi * 0.5f * side;
+		lines.emplace_back(Vector3(cos(a), -1.0f, sin(a)));
+		lines.emplace_back(Vector3(cos(a), 1.0f, sin(a)));
+	}
+	wireVertexCount[(int)WireShape::CapsuleSides] = (int)lines.size() - wireFirstVertex[(int)WireShape::CapsuleSides];
+
+	glGenVertexArrays(1, &wireVAO);
+	glBindVertexArray(wireVAO);
+
+	glGenBuffers(1, &wireVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, wireVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, lines.size() * sizeof(Vector3), lines.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, 0);
+	glVertexAttribBinding(VertexAttribute::Positions, 0);
+	glBindVertexBuffer(0, wireVertexBuffer, 0, sizeof(Vector3));
+
+	glGenBuffers(1, &wireInstanceBuffer);
+	for (int c = 0; c < 5; ++c) { //four columns of the matrix, then the colour
+		glEnableVertexAttribArray(WireInstanceSlot + c);
+		glVertexAttribFormat(WireInstanceSlot + c, 4, GL_FLOAT, false, c * sizeof(Vector4));
+		glVertexAttribBinding(WireInstanceSlot + c, 1);
+	}
+	glVertexBindingDivisor(1, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OGLRenderer::DestroyWireShapes() {
+	delete debugWireShader;
+	if (!wireVAO) {
+		return;
+	}
+	glDeleteBuffers(1, &wireVertexBuffer);
+	glDeleteBuffers(1, &wireInstanceBuffer);
+	glDeleteVertexArrays(1, &wireVAO);
+}
+
+void OGLRenderer::CreateTimedLines() {
+	debugTimedShader = new OGLShader("debugTimedVert.glsl", "debugFrag.glsl");
+	if (!debugTimedShader->LoadSuccess()) {
+		return;
+	}
+	glGenVertexArrays(1, &timedLineVAO);
+	glBindVertexArray(timedLineVAO);
+
+	glGenBuffers(1, &timedLineBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, timedLineBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(TimedLineVertex) * TimedLineVertices, nullptr, GL_DYNAMIC_DRAW);
+
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, offsetof(TimedLineVertex, position));
+	glVertexAttribBinding(VertexAttribute::Positions, 0);
+
+	glEnableVertexAttribArray(VertexAttribute::Colours);
+	glVertexAttribFormat(VertexAttribute::Colours, 4, GL_FLOAT, false, offsetof(TimedLineVertex, colour));
+	glVertexAttribBinding(VertexAttribute::Colours, 0);
+
+	glEnableVertexAttribArray(WireInstanceSlot); //the expiry, past the mesh attributes like the wire shapes' instances
+	glVertexAttribFormat(WireInstanceSlot, 1, GL_FLOAT, false, offsetof(TimedLineVertex, expiresAt));
+	glVertexAttribBinding(WireInstanceSlot, 0);
+
+	glBindVertexBuffer(0, timedLineBuffer, 0, sizeof(TimedLineVertex));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OGLRenderer::DestroyTimedLines() {
+	delete debugTimedShader;
+	if (!timedLineVAO) {
+		return;
+	}
+	glDeleteBuffers(1, &timedLineBuffer);
+	glDeleteVertexArrays(1, &timedLineVAO);
+}
+
+/*
+Moves both streams on to their next part, waiting until the GPU's done
+with whatever was drawn from it DebugFrames frames ago. That should have
+long finished, so this hardly ever actually waits.
+*/
+void OGLRenderer::NextDebugFrame() {
+	debugFrame = (debugFrame + 1) % DebugFrames;
+	for (DebugStream* stream : { &debugLineStream, &debugTextStream }) {
+		GLsync& fence = stream->fences[debugFrame];
+		if (fence) {
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); //a second, which it should never get near
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
 }
 
 Matrix4 OGLRenderer::SetupDebugLineMatrix() const {
@@ -265,26 +570,42 @@ Matrix4 OGLRenderer::SetupDebugStringMatrix()const {
 	return Matrix4();
 }
 
+static const int viewProjMatrixID	= OGLShader::GetUniformID("viewProjMatrix");
+static const int useTextureID		= OGLShader::GetUniformID("useTexture");
+static const int edgeValueID		= OGLShader::GetUniformID("edgeValue");
+static const int currentTimeID		= OGLShader::GetUniformID("currentTime");
+
 void OGLRenderer::DrawDebugData() {
-	if (debugStrings.empty() && debugLines.empty()) {
+	int wireCount = 0;
+	for (const std::vector<WireInstance>& w : wireInstances) {
+		wireCount += (int)w.size();
+	}
+	bool timedLines = showTimedLines && (!newTimedLines.empty() || timedLineCount > 0);
+	showTimedLines	= false; //until it's given the time again
+	if (debugStrings.empty() && debugLineStream.count == 0 && wireCount == 0 && !timedLines) {
 		return; //don't mess with OGL state if there's no point!
 	}
-	BindShader(debugShader);
-
 	if (forceValidDebugState) {
 		glEnable(GL_BLEND);
 		glDisable(GL_DEPTH_TEST);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
+	if (wireCount > 0) {
+		DrawDebugWireShapes();
+	}
+	if (timedLines) {
+		DrawTimedLines();
+	}
+	BindShader(debugShader);
 
-	int matLocation		= glGetUniformLocation(debugShader->GetProgramID(), "viewProjMatrix");
+	int matLocation		= debugShader->GetUniformLocation(viewProjMatrixID);
 	Matrix4 pMat;
 
 	BindTextureToShader(font->GetTexture(), "mainTex", 0);
 
-	GLuint texSlot = glGetUniformLocation(boundShader->programID, "useTexture");
+	int texSlot			= debugShader->GetUniformLocation(useTextureID);
 
-	if (debugLines.size() > 0) {
+	if (debugLineStream.count > 0) {
 		pMat = SetupDebugLineMatrix();
 		glUniformMatrix4fv(matLocation, 1, false, pMat.array);
 		glUniform1i(texSlot, 0);
@@ -292,6 +613,13 @@ void OGLRenderer::DrawDebugData() {
 	}
 
 	if (debugStrings.size() > 0) {
+		if (debugTextShader != debugShader) {
+			BindShader(debugTextShader);
+			BindTextureToShader(font->GetTexture(), "mainTex", 0);
+			matLocation = debugTextShader->GetUniformLocation(viewProjMatrixID);
+			texSlot		= debugTextShader->GetUniformLocation(useTextureID);
+			glUniform1f(debugTextShader->GetUniformLocation(edgeValueID), font->GetEdgeValue());
+		}
 		pMat = SetupDebugStringMatrix();
 		glUniformMatrix4fv(matLocation, 1, false, pMat.array);
 		glUniform1i(texSlot, 1);
@@ -303,48 +631,136 @@ void OGLRenderer::DrawDebugData() {
 		glEnable(GL_DEPTH_TEST);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
+	NextDebugFrame();
 }
 
+//Strings that don't fit in the stream's space are left out, whole
 void OGLRenderer::DrawDebugStrings() {
-	vector<Vector3> vertPos;
-	vector<Vector2> vertTex;
-	vector<Vector4> vertColours;
-
 	for (DebugString&s : debugStrings) {
-		font->BuildVerticesForString(s.text, s.pos, s.colour, s.size, vertPos, vertTex, vertColours);
+		const TextRun& run = GetTextRun(s.text);
+		int count = (int)run.positions.size();
+		DebugVertex* v = count > 0 ? GetDebugVertices(debugTextStream, count) : nullptr;
+		if (!v) {
+			continue;
+		}
+		for (int i = 0; i < count; ++i) {
+			v[i].position	= Vector3(s.pos.x + run.positions[i].x * s.size, s.pos.y + run.positions[i].y * s.size, 0.0f);
+			v[i].texCoord	= run.texCoords[i];
+			v[i].colour		= s.colour;
+		}
 	}
+	debugStrings.clear();
 
-	debugTextMesh->SetVertexPositions(vertPos);
-	debugTextMesh->SetVertexTextureCoords(vertTex);
-	debugTextMesh->SetVertexColours(vertColours);
-	debugTextMesh->UpdateGPUBuffers(0, vertPos.size());
+	if (debugTextStream.count > 0) {
+		DrawDebugStream(debugTextStream, GL_TRIANGLES);
+	}
+	ExpireTextRuns();
+}
 
-	BindMesh(debugTextMesh);
-	DrawBoundMesh();
+const OGLRenderer::TextRun& OGLRenderer::GetTextRun(const std::string& text) {
+	auto i = textRuns.find(text);
+	if (i == textRuns.end()) {
+		i = textRuns.emplace(text, TextRun()).first;
+		font->BuildGlyphRun(text, i->second.positions, i->second.texCoords);
+	}
+	i->second.lastUsed = textFrame;
+	return i->second;
+}
 
-	debugStrings.clear();
+//Only looked through every so often, as most frames nothing's old enough to go
+void OGLRenderer::ExpireTextRuns() {
+	textFrame++;
+	if (textFrame % TextRunLifetime != 0) {
+		return;
+	}
+	for (auto i = textRuns.begin(); i != textRuns.end();) {
+		if (textFrame - i->second.lastUsed > TextRunLifetime) {
+			i = textRuns.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
 }
 
 void OGLRenderer::DrawDebugLines() {
-	vector<Vector3> vertPos;
-	vector<Vector4> vertCol;
-
-	for (DebugLine&s : debugLines) {
-		vertPos.emplace_back(s.start);
-		vertPos.emplace_back(s.end);
+	DrawDebugStream(debugLineStream, GL_LINES);
+}
 
-		vertCol.emplace_back(s.colour);
-		vertCol.emplace_back(s.colour);
+/*
+New lines are copied in where the ring's got to, in two parts if they
+wrap round. Lines always go in pairs, and the ring's an even size, so a
+line's never split across the end. Once every line in it has expired
+it's emptied, and nothing's drawn until there's more.
+*/
+void OGLRenderer::DrawTimedLines() {
+	if (timedLineTime > timedLineLatest && newTimedLines.empty()) {
+		timedLineHead	= 0;
+		timedLineCount	= 0;
+		return;
 	}
+	int count = (int)newTimedLines.size();
+	const TimedLineVertex* lines = newTimedLines.data();
+	if (count > TimedLineVertices) { //only the newest would survive anyway
+		lines += count - TimedLineVertices;
+		count = TimedLineVertices;
+	}
+	if (count > 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, timedLineBuffer);
+		int first = count < TimedLineVertices - timedLineHead ? count : TimedLineVertices - timedLineHead;
+		glBufferSubData(GL_ARRAY_BUFFER, timedLineHead * sizeof(TimedLineVertex), first * sizeof(TimedLineVertex), lines);
+		if (first < count) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, (count - first) * sizeof(TimedLineVertex), lines + first);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		timedLineHead	= (timedLineHead + count) % TimedLineVertices;
+		timedLineCount	= timedLineCount + count > TimedLineVertices ? TimedLineVertices : timedLineCount + count;
+		newTimedLines.clear();
+	}
+	BindShader(debugTimedShader);
+	Matrix4 pMat = SetupDebugLineMatrix();
+	glUniformMatrix4fv(debugTimedShader->GetUniformLocation(viewProjMatrixID), 1, false, pMat.array);
+	glUniform1i(debugTimedShader->GetUniformLocation(useTextureID), 0);
+	glUniform1f(debugTimedShader->GetUniformLocation(currentTimeID), timedLineTime);
+
+	BindMesh(nullptr);
+	glBindVertexArray(timedLineVAO);
+	glDrawArrays(GL_LINES, 0, timedLineCount);
+	glBindVertexArray(0);
+	frameStats.drawCalls++;
+}
 
-	debugLinesMesh->SetVertexPositions(vertPos);
-	debugLinesMesh->SetVertexColours(vertCol);
-	debugLinesMesh->UpdateGPUBuffers(0, vertPos.size());
+//Each shape's instances go up in one buffer, then it's a draw per shape
+void OGLRenderer::DrawDebugWireShapes() {
+	wireUpload.clear();
+	for (const std::vector<WireInstance>& w : wireInstances) {
+		wireUpload.insert(wireUpload.end(), w.begin(), w.end());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, wireInstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, wireUpload.size() * sizeof(WireInstance), wireUpload.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	BindMesh(debugLinesMesh);
-	DrawBoundMesh();
+	BindShader(debugWireShader);
+	Matrix4 pMat = SetupDebugLineMatrix();
+	glUniformMatrix4fv(debugWireShader->GetUniformLocation(viewProjMatrixID), 1, false, pMat.array);
+	glUniform1i(debugWireShader->GetUniformLocation(useTextureID), 0);
 
-	debugLines.clear();
+	BindMesh(nullptr);
+	glBindVertexArray(wireVAO);
+	size_t first = 0;
+	for (int s = 0; s < WireShapeCount; ++s) {
+		int count = (int)wireInstances[s].size();
+		if (count == 0) {
+			continue;
+		}
+		glBindVertexBuffer(1, wireInstanceBuffer, first * sizeof(WireInstance), sizeof(WireInstance));
+		glDrawArraysInstanced(GL_LINES, wireFirstVertex[s], wireVertexCount[s], count);
+		frameStats.drawCalls++;
+		frameStats.instances += count;
+		first += count;
+		wireInstances[s].clear();
+	}
+	glBindVertexArray(0);
 }
 
 #ifdef _WIN32
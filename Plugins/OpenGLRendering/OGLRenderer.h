@@ -9,9 +9,12 @@ https://research.ncl.ac.uk/game/
 #pragma once
 #include "../../Common/RendererBase.h"
 
+#include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/Vector4.h"
+#include "../../Common/Matrix4.h"
 
+#include "glad\glad.h"
 
 #ifdef _WIN32
 #include "windows.h"
@@ -24,6 +27,7 @@ https://research.ncl.ac.uk/game/
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 
 namespace NCL {
@@ -64,11 +68,59 @@ namespace NCL {
 			void DrawString(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(0.75f, 0.75f, 0.75f,1), float size = 20.0f );
 			void DrawLine(const Vector3& start, const Vector3& end, const Vector4& colour);
 
+			/*
+			Unit wireframes, drawn instanced with the debug lines, so outlining
+			every collider in a level is a few draws rather than tens of lines
+			each. Boxes go from -1 to 1, hemispheres are the top half of a unit
+			sphere (flipped over for the bottom), and a capsule's sides are four
+			lines from -1 to 1 up the y axis, a unit out from it.
+			*/
+			enum class WireShape {
+				Box,
+				Hemisphere,
+				CapsuleSides,
+				Count
+			};
+			void DrawWireShape(WireShape shape, const Matrix4& transform, const Vector4& colour);
+
+			/*
+			Lines that last a while, like paths and shots, are written once into
+			a ring on the GPU along with when they run out, and the shader drops
+			the ones that have. Nothing's done for them per frame after that,
+			besides the one draw. The time is whatever the caller's counting in,
+			and is passed in every frame they're to be shown.
+			*/
+			void DrawTimedLine(const Vector3& start, const Vector3& end, const Vector4& colour, float expiresAt);
+			void SetTimedLineTime(float time) {
+				timedLineTime	= time;
+				showTimedLines	= true;
+			}
+
 			virtual Matrix4 SetupDebugLineMatrix()	const;
 			virtual Matrix4 SetupDebugStringMatrix()const;
 			//8508
 			void BindTexturesToShader(unsigned int t, const std::string& uniform, int texUnit);
+			void BindTexturesToShader(unsigned int t, int uniformID, int texUnit);
 			OGLShader* boundShader;
+
+			/*
+			What the last frame handed to the driver, counted as it went, so a
+			benchmark can see what a change to the renderer did to it. Indirect
+			draws count as a call each, but as the GPU decides what's in them,
+			their triangles and instances aren't counted.
+			*/
+			struct FrameStats {
+				int drawCalls		= 0;
+				int instances		= 0;
+				int triangles		= 0;
+				int shaderBinds		= 0;
+				int meshBinds		= 0;
+				int textureBinds	= 0;
+			};
+
+			const FrameStats& GetFrameStats() const {
+				return lastFrameStats;
+			}
 		protected:			
 			void BeginFrame()	override;
 			void RenderFrame(int curFrame)	override;
@@ -78,11 +130,17 @@ namespace NCL {
 			void DrawDebugData();
 			void DrawDebugStrings();
 			void DrawDebugLines();
+			void DrawDebugWireShapes();
+			void DrawTimedLines();
+			void NextDebugFrame();
 
 			void BindShader(ShaderBase*s);
 			void BindTextureToShader(const TextureBase*t, const std::string& uniform, int texUnit) const;
 			void BindMesh(MeshGeometry*m);
 			void DrawBoundMesh(int subLayer = 0, int numInstances = 1);
+
+			mutable FrameStats	frameStats;	//so far this frame
+			FrameStats			lastFrameStats;
 #ifdef _WIN32
 			void InitWithWin32(Window& w);
 			void DestroyWithWin32();
@@ -97,22 +155,107 @@ namespace NCL {
 				std::string		text;
 			};
 
-			struct DebugLine {
-				Maths::Vector3 start;
-				Maths::Vector3 end;
+			static const int DebugFrames		= 3;
+			static const int DebugLineVertices	= 20000;	//per frame
+			static const int DebugTextVertices	= 6000;
+			static const int WireInstanceSlot	= 8;		//where the wire shapes' matrix and colour start
+			static const int TimedLineVertices	= 65536;	//in the ring, past which the oldest are written over
+
+			struct DebugVertex {
+				Maths::Vector3 position;
 				Maths::Vector4 colour;
+				Maths::Vector2 texCoord;
 			};
 
-			OGLMesh* debugLinesMesh;
-			OGLMesh* debugTextMesh;
+			/*
+			Vertices written straight into a buffer the GPU draws from. It's
+			split into DebugFrames parts, one per frame, so a frame can be
+			written while the last couple are still being drawn, with a
+			fence for each part to wait on before it's used again.
+			*/
+			struct DebugStream {
+				GLuint				vao			= 0;
+				GLuint				buffer		= 0;
+				DebugVertex*		memory		= nullptr; //persistently mapped, if the driver can
+				std::vector<DebugVertex> staging;		   //otherwise written here and copied over
+				GLsync				fences[DebugFrames] = {};
+				int					capacity	= 0;	   //vertices per frame
+				int					count		= 0;	   //written so far this frame
+			};
+
+			void CreateDebugStream(DebugStream& stream, int capacity);
+			void DestroyDebugStream(DebugStream& stream);
+			DebugVertex* GetDebugVertices(DebugStream& stream, int count);
+			void DrawDebugStream(DebugStream& stream, GLenum mode);
+
+			DebugStream debugLineStream;
+			DebugStream debugTextStream;
+			int			debugFrame = 0;
+
+			struct WireInstance {
+				Matrix4 transform;
+				Vector4 colour;
+			};
+			static const int WireShapeCount = (int)WireShape::Count;
+
+			void CreateWireShapes();
+			void DestroyWireShapes();
+
+			GLuint	wireVAO				= 0;
+			GLuint	wireVertexBuffer	= 0;
+			GLuint	wireInstanceBuffer	= 0;
+			int		wireFirstVertex[WireShapeCount]		= {};
+			int		wireVertexCount[WireShapeCount]		= {};
+			std::vector<WireInstance> wireInstances[WireShapeCount];	//this frame's, by shape
+			std::vector<WireInstance> wireUpload;						//all of them, one shape after another
+			OGLShader*	debugWireShader = nullptr;
+
+			struct TimedLineVertex {
+				Maths::Vector3	position;
+				float			expiresAt;
+				Maths::Vector4	colour;
+			};
+
+			void CreateTimedLines();
+			void DestroyTimedLines();
+
+			GLuint	timedLineVAO		= 0;
+			GLuint	timedLineBuffer		= 0;
+			int		timedLineHead		= 0;	//where the next ones go
+			int		timedLineCount		= 0;	//written and not yet written over, up to TimedLineVertices
+			float	timedLineLatest		= 0.0f;	//once it's past this, every line in the ring has expired
+			float	timedLineTime		= 0.0f;
+			bool	showTimedLines		= false;
+			std::vector<TimedLineVertex> newTimedLines; //waiting to go in the ring
+			OGLShader*	debugTimedShader = nullptr;
+
+			/*
+			Each string's characters, laid out once and kept while it's still
+			being drawn, so text that doesn't change from frame to frame (most
+			of it) is only moved into place and coloured, rather than looked
+			up in the font again. Strings that haven't been drawn for a while
+			are let go, so timers and counters don't fill it up.
+			*/
+			struct TextRun {
+				std::vector<Vector2> positions; //at a size of 1, from the origin
+				std::vector<Vector2> texCoords;
+				int lastUsed = 0;
+			};
+			const TextRun& GetTextRun(const std::string& text);
+			void ExpireTextRuns();
+
+			static const int TextRunLifetime = 120; //frames without being drawn
+
+			std::unordered_map<std::string, TextRun> textRuns;
+			int textFrame = 0;
 
 			OGLMesh*	boundMesh;
 			
 
 			OGLShader*  debugShader;
+			OGLShader*  debugTextShader; //the same, unless the font's a distance field
 			SimpleFont* font;
 			std::vector<DebugString>	debugStrings;
-			std::vector<DebugLine>		debugLines;
 
 			bool initState;
 			bool forceValidDebugState;
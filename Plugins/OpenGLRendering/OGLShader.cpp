@@ -9,6 +9,8 @@ https://research.ncl.ac.uk/game/
 #include "OGLShader.h"
 #include "../../Common/Assets.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 
 using namespace NCL;
 using namespace NCL::Rendering;
@@ -29,6 +31,77 @@ string ShaderNames[(int)ShaderStages::SHADER_MAX] = {
 	"Tess. Eval"
 };
 
+//In the same order as OGLShader::Feature's bits
+string FeatureDefines[OGLShader::FeatureCount] = {
+	"VERTEX_COLOURS",
+	"HAS_TEXTURE"
+};
+
+//What the shaders used to branch on, for any that haven't been given the defines yet
+string FeatureUniforms[OGLShader::FeatureCount] = {
+	"hasVertexColours",
+	"hasTexture"
+};
+
+bool OGLShader::useProgramCache = true;
+
+namespace {
+	const unsigned int ProgramCacheMagic	= 0x4E505247; //"GRPN"
+	const unsigned int ProgramCacheVersion	= 1;
+
+	struct ProgramCacheHeader {
+		unsigned int		magic;
+		unsigned int		version;
+		unsigned long long	sourceHash;
+		unsigned int		binaryFormat;
+		unsigned int		binaryLength;
+	};
+
+	//FNV-1a, which is plenty to tell whether a few shader files have changed
+	unsigned long long HashString(const string& s, unsigned long long hash = 14695981039346656037ull) {
+		for (unsigned char c : s) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//A binary from one driver can't be given to another, or even a newer version of the same one
+	const string& DriverString() {
+		static string driver;
+		if (driver.empty()) {
+			const char* vendor		= (const char*)glGetString(GL_VENDOR);
+			const char* renderer	= (const char*)glGetString(GL_RENDERER);
+			const char* version		= (const char*)glGetString(GL_VERSION);
+			driver = string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+		}
+		return driver;
+	}
+
+	/*
+	The defines have to come after #version, which must be the first thing
+	in the file, and a #line puts the line numbers back to what they are in
+	the file, so the compile log still points at the right place.
+	*/
+	void InsertDefines(string& source, const string& defines) {
+		size_t version = source.find("#version");
+		if (version == string::npos) {
+			source = defines + "#line 1\n" + source;
+			return;
+		}
+		size_t lineEnd = source.find('\n', version);
+		if (lineEnd == string::npos) {
+			source += '\n';
+			lineEnd = source.size() - 1;
+		}
+		int nextLine = 2;
+		for (size_t i = 0; i < version; ++i) {
+			nextLine += source[i] == '\n' ? 1 : 0;
+		}
+		source.insert(lineEnd + 1, defines + "#line " + std::to_string(nextLine) + "\n");
+	}
+}
+
 OGLShader::OGLShader(const string& vertex, const string& fragment, const string& geometry, const string& domain, const string& hull) :
 	ShaderBase(vertex, fragment, geometry, domain, hull) {
 
@@ -41,38 +114,110 @@ OGLShader::OGLShader(const string& vertex, const string& fragment, const string&
 	ReloadShader();
 }
 
+OGLShader::OGLShader(const OGLShader& base, unsigned int features) : features(features) {
+	for (int i = 0; i < (int)ShaderStages::SHADER_MAX; ++i) {
+		shaderFiles[i]	= base.shaderFiles[i];
+		shaderIDs[i]	= 0;
+		shaderValid[i]	= 0;
+	}
+	programID = 0;
+
+	ReloadShader();
+}
+
 OGLShader::~OGLShader()	{
+	for (auto& v : variants) {
+		delete v.second;
+	}
 	DeleteIDs();
 }
 
+OGLShader* OGLShader::GetVariant(unsigned int features) {
+	if (features == this->features) {
+		return this;
+	}
+	auto i = variants.find(features);
+	if (i == variants.end()) {
+		i = variants.emplace(features, new OGLShader(*this, features)).first;
+	}
+	return i->second->LoadSuccess() ? i->second : this;
+}
+
+/*
+Every stage's source is read first, so a hash of all of them (and of the
+driver) can be checked against the cached binary for this combination of
+files. Only if that's missing, stale, or refused by the driver are the
+stages compiled as usual - and then the newly linked program is saved
+over the old cache file, ready for next time. Each variant has a cache
+file of its own, and is reloaded along with the shader it came from.
+*/
 void OGLShader::ReloadShader() {
 	DeleteIDs();
 	programID = glCreateProgram();
-	string fileContents = "";
+
+	string defines;
+	for (int i = 0; i < FeatureCount; ++i) {
+		if (features & (1u << i)) {
+			defines += "#define " + FeatureDefines[i] + "\n";
+		}
+	}
+	string sources[(int)ShaderStages::SHADER_MAX];
+	unsigned long long sourceHash = HashString(DriverString());
 	for (int i = 0; i < (int)ShaderStages::SHADER_MAX; ++i) {
 		if (!shaderFiles[i].empty()) {
-			if (Assets::ReadTextFile(Assets::SHADERDIR + shaderFiles[i], fileContents)) {
-				shaderIDs[i] = glCreateShader(shaderTypes[i]);
-
-				std::cout << "Reading " << ShaderNames[i] << " shader " << shaderFiles[i] << std::endl;
-
-				const char* stringData	 = fileContents.c_str();
-				int			stringLength = (int)fileContents.length();
-				glShaderSource(shaderIDs[i], 1, &stringData, &stringLength);
-				glCompileShader(shaderIDs[i]);
-
-				glGetShaderiv(shaderIDs[i], GL_COMPILE_STATUS, &shaderValid[i]);
-		
-				if (shaderValid[i] != GL_TRUE) {
-					std::cout << ShaderNames[i] << " shader " << " has failed!" << std::endl;
-				}
-				else {
-					glAttachShader(programID, shaderIDs[i]);
-				}
-				PrintCompileLog(shaderIDs[i]);
+			if (!Assets::ReadTextFile(Assets::SHADERDIR + shaderFiles[i], sources[i])) {
+				sources[i].clear();
+			}
+			else if (!defines.empty()) {
+				InsertDefines(sources[i], defines);
+			}
+			sourceHash = HashString(std::to_string(i) + ":" + sources[i], sourceHash);
+		}
+	}
+	//Named after which files it's made from, so an edited shader overwrites its old binary
+	unsigned long long nameHash = HashString(defines);
+	for (int i = 0; i < (int)ShaderStages::SHADER_MAX; ++i) {
+		nameHash = HashString(std::to_string(i) + ":" + shaderFiles[i] + "|", nameHash);
+	}
+	std::ostringstream cacheFile;
+	cacheFile << Assets::SHADERDIR << "Cache_" << std::hex << nameHash << ".progbin";
+
+	for (auto& v : variants) {
+		v.second->ReloadShader();
+	}
+
+	if (useProgramCache && LoadProgramBinary(cacheFile.str(), sourceHash)) {
+		std::cout << "Shader loaded from " << cacheFile.str() << std::endl;
+		ReflectUniforms();
+		SetFeatureUniforms();
+		return;
+	}
+
+	for (int i = 0; i < (int)ShaderStages::SHADER_MAX; ++i) {
+		if (!sources[i].empty()) {
+			shaderIDs[i] = glCreateShader(shaderTypes[i]);
+
+			std::cout << "Reading " << ShaderNames[i] << " shader " << shaderFiles[i] << std::endl;
+
+			const char* stringData	 = sources[i].c_str();
+			int			stringLength = (int)sources[i].length();
+			glShaderSource(shaderIDs[i], 1, &stringData, &stringLength);
+			glCompileShader(shaderIDs[i]);
+
+			glGetShaderiv(shaderIDs[i], GL_COMPILE_STATUS, &shaderValid[i]);
+	
+			if (shaderValid[i] != GL_TRUE) {
+				std::cout << ShaderNames[i] << " shader " << " has failed!" << std::endl;
 			}
+			else {
+				glAttachShader(programID, shaderIDs[i]);
+			}
+			PrintCompileLog(shaderIDs[i]);
 		}
-	}	
+	}
+	if (useProgramCache) {
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(programID);
 	glGetProgramiv(programID, GL_LINK_STATUS, &programValid);
 
@@ -83,6 +228,156 @@ void OGLShader::ReloadShader() {
 	}
 	else {
 		std::cout << "Shader loaded!" << std::endl;
+		if (useProgramCache) {
+			SaveProgramBinary(cacheFile.str(), sourceHash);
+		}
+	}
+	ReflectUniforms();
+	SetFeatureUniforms();
+}
+
+//Only ever set here, as a variant's features never change
+void OGLShader::SetFeatureUniforms() {
+	for (int i = 0; i < FeatureCount; ++i) {
+		int location = GetUniformLocation(FeatureUniforms[i]);
+		if (location >= 0) {
+			glProgramUniform1i(programID, location, (features & (1u << i)) ? 1 : 0);
+		}
+	}
+}
+
+bool OGLShader::LoadProgramBinary(const string& filename, unsigned long long sourceHash) {
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount < 1) {
+		return false;
+	}
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	ProgramCacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) ||
+		header.magic != ProgramCacheMagic || header.version != ProgramCacheVersion ||
+		header.sourceHash != sourceHash || header.binaryLength == 0) {
+		return false;
+	}
+	std::vector<char> binary(header.binaryLength);
+	if (!file.read(binary.data(), binary.size())) {
+		return false;
+	}
+	glProgramBinary(programID, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+	glGetProgramiv(programID, GL_LINK_STATUS, &programValid);
+	if (programValid != GL_TRUE) {
+		//The driver can still turn a binary down, even when everything matched
+		std::cout << "Cached shader " << filename << " was rejected, recompiling" << std::endl;
+		glDeleteProgram(programID);
+		programID = glCreateProgram();
+		return false;
+	}
+	return true;
+}
+
+void OGLShader::SaveProgramBinary(const string& filename, unsigned long long sourceHash) const {
+	GLint length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(programID, length, &length, &format, binary.data());
+
+	ProgramCacheHeader header;
+	header.magic		= ProgramCacheMagic;
+	header.version		= ProgramCacheVersion;
+	header.sourceHash	= sourceHash;
+	header.binaryFormat	= (unsigned int)format;
+	header.binaryLength	= (unsigned int)length;
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+}
+
+static std::vector<string>& UniformNames() {
+	static std::vector<string> names;
+	return names;
+}
+
+int OGLShader::GetUniformID(const string& name) {
+	static std::unordered_map<string, int> ids;
+	auto i = ids.find(name);
+	if (i != ids.end()) {
+		return i->second;
+	}
+	int id = (int)UniformNames().size();
+	UniformNames().push_back(name);
+	ids[name] = id;
+	return id;
+}
+
+GLuint OGLShader::GetBlockBinding(const string& blockName) {
+	static std::unordered_map<string, GLuint> bindings;
+	auto i = bindings.find(blockName);
+	if (i != bindings.end()) {
+		return i->second;
+	}
+	GLuint binding = (GLuint)bindings.size();
+	bindings[blockName] = binding;
+	return binding;
+}
+
+/*
+Everything the linker kept is looked up here, once, rather than asking
+the driver by name every frame. Arrays come back as "name[0]", so they
+go in under just their name, as that's what they're asked for by.
+*/
+void OGLShader::ReflectUniforms() {
+	uniformLocations.clear();
+	locationsByID.clear();
+	if (programValid != GL_TRUE) {
+		return;
+	}
+	int count		= 0;
+	int maxLength	= 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(maxLength + 1);
+	for (int i = 0; i < count; ++i) {
+		GLint	size = 0;
+		GLenum	type = 0;
+		glGetActiveUniform(programID, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+
+		int location = glGetUniformLocation(programID, name.data());
+		if (location < 0) {
+			continue; //it's in a uniform block
+		}
+		string uniform = name.data();
+		size_t bracket = uniform.find('[');
+		if (bracket != string::npos) {
+			uniform = uniform.substr(0, bracket);
+		}
+		uniformLocations[uniform] = location;
+	}
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+	for (int i = 0; i < count; ++i) {
+		glGetActiveUniformBlockName(programID, i, (GLsizei)name.size(), nullptr, name.data());
+		glUniformBlockBinding(programID, i, GetBlockBinding(name.data()));
+	}
+}
+
+void OGLShader::CacheUniformIDs() const {
+	const std::vector<string>& names = UniformNames();
+	for (size_t i = locationsByID.size(); i < names.size(); ++i) {
+		locationsByID.push_back(GetUniformLocation(names[i]));
 	}
 }
 
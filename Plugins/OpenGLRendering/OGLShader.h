@@ -9,6 +9,8 @@ https://research.ncl.ac.uk/game/
 #pragma once
 #include "../../Common/ShaderBase.h"
 #include "glad\glad.h"
+#include <unordered_map>
+#include <vector>
 
 namespace NCL {
 	namespace Rendering {
@@ -21,6 +23,23 @@ namespace NCL {
 
 			void ReloadShader() override;
 
+			//What a variant's compiled with, each as a #define at the top of
+			//every stage, so the shaders can leave out what isn't used
+			enum Feature : unsigned int {
+				VertexColours	= 1 << 0,	//VERTEX_COLOURS
+				Texture			= 1 << 1,	//HAS_TEXTURE
+				FeatureCount	= 2
+			};
+
+			//The same files compiled with just these features, made the first
+			//time they're asked for and kept by the shader they came from. No
+			//features is the shader itself, as is any variant that won't compile.
+			OGLShader* GetVariant(unsigned int features);
+
+			unsigned int GetFeatures() const {
+				return features;
+			}
+
 			bool LoadSuccess() const {
 				return programValid == GL_TRUE;
 			}
@@ -28,17 +47,57 @@ namespace NCL {
 			int GetProgramID() const {
 				return programID;
 			}	
+
+			//Where a uniform is, from what was found when the shader was linked,
+			//or -1 if it isn't there (or has been optimised out)
+			int GetUniformLocation(const string& name) const {
+				auto i = uniformLocations.find(name);
+				return i == uniformLocations.end() ? -1 : i->second;
+			}
+
+			//The same as above, but with an ID from GetUniformID, so it's just an index
+			int GetUniformLocation(int uniformID) const {
+				if (uniformID >= (int)locationsByID.size()) {
+					CacheUniformIDs();
+				}
+				return locationsByID[uniformID];
+			}
+
+			//Every uniform name gets one ID, shared by all shaders, to look
+			//up per frame without hashing the name each time
+			static int GetUniformID(const string& name);
+
+			//Uniform blocks are bound to the same binding point in every shader
+			//that has them, so one buffer can be bound once for all of them
+			static GLuint GetBlockBinding(const string& blockName);
 			
+			//Linked programs are kept in a file beside the shaders, and used
+			//instead of compiling again while the sources and driver match
+			static bool useProgramCache;
+
 			static void	PrintCompileLog(GLuint object);
 			static void	PrintLinkLog(GLuint program);
 
 		protected:
+			OGLShader(const OGLShader& base, unsigned int features);
+
 			void	DeleteIDs();
+			bool	LoadProgramBinary(const string& filename, unsigned long long sourceHash);
+			void	SaveProgramBinary(const string& filename, unsigned long long sourceHash) const;
+			void	ReflectUniforms();
+			void	SetFeatureUniforms();
+			void	CacheUniformIDs() const;
+
+			std::unordered_map<string, int> uniformLocations;
+			mutable std::vector<int>		locationsByID;
 
 			GLuint	programID;
 			GLuint	shaderIDs[(int)ShaderStages::SHADER_MAX];
 			int		shaderValid[(int)ShaderStages::SHADER_MAX];
 			int		programValid;
+
+			unsigned int features	= 0;
+			std::unordered_map<unsigned int, OGLShader*> variants;
 		};
 	}
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ https://research.ncl.ac.uk/game/
 #include "OGLRenderer.h"
 
 #include "../../Common/TextureLoader.h"
+#include "../../Common/MemoryTracker.h"
 
 using namespace NCL;
 using namespace NCL::Rendering;
@@ -26,13 +27,32 @@ OGLTexture::OGLTexture(GLuint texToOwn) {
 OGLTexture::~OGLTexture()
 {
 	glDeleteTextures(1, &texID);
+	MemoryTracker::RecordGPU(MemoryTag::Textures, -(int64_t)gpuBytes);
+}
+
+void OGLTexture::AddGPUBytes(size_t bytes) {
+	gpuBytes += bytes;
+	MemoryTracker::RecordGPU(MemoryTag::Textures, (int64_t)bytes);
+}
+
+//For when whatever it held before has been replaced
+void OGLTexture::ReplaceGPUBytes(size_t bytes) {
+	MemoryTracker::RecordGPU(MemoryTag::Textures, (int64_t)bytes - (int64_t)gpuBytes);
+	gpuBytes = bytes;
 }
 
 TextureBase* OGLTexture::RGBATextureFromData(char* data, int width, int height, int channels) {
 	OGLTexture* tex = new OGLTexture();
+	tex->SetRGBAData(data, width, height, channels);
+	return tex;
+}
 
-	int dataSize = width * height * channels; //This always assumes data is 1 byte per channel
-
+/*
+With a buffer bound to GL_PIXEL_UNPACK_BUFFER, data is an offset into it,
+which is how the OGLTextureUploader hands its textures over. Rows are
+taken as tightly packed, whatever the width.
+*/
+void OGLTexture::SetRGBAData(const char* data, int width, int height, int channels) {
 	int sourceType = GL_RGB;
 
 	switch (channels) {
@@ -44,21 +64,30 @@ TextureBase* OGLTexture::RGBATextureFromData(char* data, int width, int height,
 		//default:
 	}
 
-	glBindTexture(GL_TEXTURE_2D, tex->texID);
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, sourceType, GL_UNSIGNED_BYTE, data);
 
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 	glGenerateMipmap(GL_TEXTURE_2D);
+	baseLevel = 0;
+	//16 bytes a texel, whatever the file had, and another third for the mips
+	ReplaceGPUBytes((size_t)width * height * 16 * 4 / 3);
 
 	glBindTexture(GL_TEXTURE_2D, 0);
-
-	return tex;
 }
 
 TextureBase* OGLTexture::RGBATextureFromFilename(const std::string&name) {
+	CompressedTexture compressed;
+	if (TextureLoader::LoadCompressedTexture(name, compressed)) {
+		return CompressedTextureFromData(compressed);
+	}
 	char* texData	= nullptr;
 	int width		= 0;
 	int height		= 0;
@@ -71,4 +100,253 @@ TextureBase* OGLTexture::RGBATextureFromFilename(const std::string&name) {
 	free(texData);
 
 	return glTex;
-}
\ No newline at end of file
+}
+GLenum OGLTexture::GetCompressedFormat(CompressedTexture::Format format) {
+	switch (format) {
+		case CompressedTexture::Format::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		case CompressedTexture::Format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case CompressedTexture::Format::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+}
+
+/*
+Sampled the same way as uncompressed textures, but the mip levels are the
+ones that were built along with the compressed file, rather than generated.
+*/
+TextureBase* OGLTexture::CompressedTextureFromData(const CompressedTexture& compressed) {
+	if (compressed.GetMipCount() == 0) {
+		return nullptr;
+	}
+	OGLTexture* tex = new OGLTexture();
+	tex->SetCompressedData(compressed);
+	return tex;
+}
+
+/*
+Any levels above the ones that were loaded are emptied, so whatever was
+in them before (such as the placeholder) doesn't hang about.
+*/
+void OGLTexture::SetCompressedData(const CompressedTexture& compressed) {
+	if (compressed.GetMipCount() == 0) {
+		return;
+	}
+	GLenum format	= GetCompressedFormat(compressed.GetFormat());
+	int first		= compressed.GetFirstLoadedMip();
+	int last		= first + compressed.GetLoadedMipCount() - 1;
+	size_t bytes	= 0;
+
+	glBindTexture(GL_TEXTURE_2D, texID);
+	for (int i = 0; i < first; ++i) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, format, 0, 0, 0, 0, nullptr);
+	}
+	for (int i = first; i <= last; ++i) {
+		const CompressedTexture::MipLevel& mip = compressed.GetMip(i);
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, format, mip.width, mip.height, 0, (GLsizei)mip.size, compressed.GetMipData(i));
+		bytes += mip.size;
+	}
+	ReplaceGPUBytes(bytes);
+	baseLevel = first;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/*
+With a buffer bound to GL_PIXEL_UNPACK_BUFFER, data is an offset into it,
+as it is for SetRGBAData.
+*/
+void OGLTexture::SetCompressedMip(CompressedTexture::Format format, int level, int width, int height, const char* data, size_t size) {
+	if (level != baseLevel - 1) {
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glCompressedTexImage2D(GL_TEXTURE_2D, level, GetCompressedFormat(format), width, height, 0, (GLsizei)size, data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	baseLevel = level;
+	AddGPUBytes(size);
+}
+
+//Levels are emptied rather than the texture being made again, so its object stays the same
+void OGLTexture::DropMipsAbove(int level) {
+	if (level <= baseLevel) {
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	GLint format = 0;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	size_t freed = 0;
+	for (int i = baseLevel; i < level; ++i) {
+		GLint levelSize = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, format, 0, 0, 0, 0, nullptr);
+		freed += (size_t)levelSize;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	baseLevel = level;
+	ReplaceGPUBytes(gpuBytes > freed ? gpuBytes - freed : 0);
+}
+
+TextureBase* OGLTexture::CompressedArrayFromFilenames(const std::vector<std::string>& names) {
+	std::vector<CompressedTexture> layers(names.size());
+	for (int i = 0; i < (int)names.size(); ++i) {
+		if (!TextureLoader::LoadCompressedTexture(names[i], layers[i])) {
+			return nullptr;
+		}
+		if (layers[i].GetFormat() != layers[0].GetFormat() || layers[i].GetWidth() != layers[0].GetWidth() ||
+			layers[i].GetHeight() != layers[0].GetHeight() || layers[i].GetMipCount() != layers[0].GetMipCount()) {
+			return nullptr;
+		}
+	}
+	OGLTexture* tex = new OGLTexture();
+	tex->target = GL_TEXTURE_2D_ARRAY;
+	tex->layers = (int)names.size();
+	GLenum format = GetCompressedFormat(layers[0].GetFormat());
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex->texID);
+	for (int m = 0; m < layers[0].GetMipCount(); ++m) {
+		const CompressedTexture::MipLevel& mip = layers[0].GetMip(m);
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, m, format, mip.width, mip.height, tex->layers, 0, (GLsizei)(mip.size * tex->layers), nullptr);
+		tex->AddGPUBytes(mip.size * tex->layers);
+		for (int i = 0; i < tex->layers; ++i) {
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, m, 0, 0, i, mip.width, mip.height, 1, format, (GLsizei)mip.size, layers[i].GetMipData(m));
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, layers[0].GetMipCount() - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return tex;
+}
+
+TextureBase* OGLTexture::RGBAArrayFromFilenames(const std::vector<std::string>& names) {
+	if (names.empty()) {
+		return nullptr;
+	}
+	if (TextureBase* compressed = CompressedArrayFromFilenames(names)) {
+		return compressed;
+	}
+	OGLTexture* tex = new OGLTexture();
+	tex->target = GL_TEXTURE_2D_ARRAY;
+	tex->layers = (int)names.size();
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex->texID);
+
+	int arrayWidth	= 0;
+	int arrayHeight = 0;
+	for (int i = 0; i < (int)names.size(); ++i) {
+		char* texData	= nullptr;
+		int width		= 0;
+		int height		= 0;
+		int channels	= 0;
+		int flags		= 0;
+		if (!TextureLoader::LoadTexture(names[i], texData, width, height, channels, flags)) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			delete tex;
+			return nullptr;
+		}
+		if (i == 0) {
+			arrayWidth	= width;
+			arrayHeight = height;
+			//8 bits per channel is all the files have anyway
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, tex->layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		if (width != arrayWidth || height != arrayHeight) {
+			free(texData);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			delete tex;
+			return nullptr;
+		}
+		//stb always gives back RGBA, whatever the file had
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, texData);
+		free(texData);
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	tex->AddGPUBytes((size_t)arrayWidth * arrayHeight * 4 * tex->layers * 4 / 3);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return tex;
+}
+
+/*
+Nothing goes through the CPU - each level of each texture is copied
+straight into its layer. Compressed textures stay compressed, as the
+array's made in the same format.
+*/
+TextureBase* OGLTexture::ArrayFromTextures(const std::vector<GLuint>& textures) {
+	if (textures.empty() || !glCopyImageSubData || !glTexStorage3D) {
+		return nullptr;
+	}
+	GLint width		= 0;
+	GLint height	= 0;
+	GLint format	= 0;
+	int levels		= 0;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		GLint w = 0, h = 0, f = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &f);
+		int l = 0;
+		for (GLint levelWidth = w; levelWidth > 0; ++l) {
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, l + 1, GL_TEXTURE_WIDTH, &levelWidth);
+		}
+		if (i == 0) {
+			width	= w;
+			height	= h;
+			format	= f;
+			levels	= l;
+		}
+		else if (w != width || h != height || f != format) {
+			glBindTexture(GL_TEXTURE_2D, 0);
+			return nullptr;
+		}
+		levels = l < levels ? l : levels;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if (width <= 0 || height <= 0 || levels <= 0) {
+		return nullptr;
+	}
+
+	OGLTexture* tex = new OGLTexture();
+	tex->target = GL_TEXTURE_2D_ARRAY;
+	tex->layers = (int)textures.size();
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex->texID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format, width, height, tex->layers);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	size_t bytes = 0;
+	for (int l = 0; l < levels; ++l) {
+		int levelWidth	= (width >> l) > 0 ? (width >> l) : 1;
+		int levelHeight = (height >> l) > 0 ? (height >> l) : 1;
+		for (int i = 0; i < tex->layers; ++i) {
+			glCopyImageSubData(textures[i], GL_TEXTURE_2D, l, 0, 0, 0,
+				tex->texID, GL_TEXTURE_2D_ARRAY, l, 0, 0, i, levelWidth, levelHeight, 1);
+		}
+		GLint compressed = 0;
+		GLint levelSize = 0;
+		glBindTexture(GL_TEXTURE_2D, textures[0]);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+		}
+		bytes += (compressed ? (size_t)levelSize : (size_t)levelWidth * levelHeight * 4) * tex->layers;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	tex->AddGPUBytes(bytes);
+	return tex;
+}
@@ -8,9 +8,11 @@ https://research.ncl.ac.uk/game/
 */
 #pragma once
 #include "../../Common/TextureBase.h"
+#include "../../Common/CompressedTexture.h"
 #include "glad\glad.h"
 
 #include <string>
+#include <vector>
 
 namespace NCL {
 	namespace Rendering {
@@ -24,13 +26,64 @@ namespace NCL {
 
 			static TextureBase* RGBATextureFromData(char* data, int width, int height, int channels);
 
+			//Uses the compressed copy of the file instead, if it has one
 			static TextureBase* RGBATextureFromFilename(const std::string&name);
 
+			//Every mip level goes up as it is, without being decompressed
+			static TextureBase* CompressedTextureFromData(const CompressedTexture& compressed);
+
+			//Each file becomes one layer of a GL_TEXTURE_2D_ARRAY, so they all
+			//have to be the same size - if they aren't, this gives back nullptr.
+			//If every file has a compressed copy, all in the same format and
+			//size, the array is made from those instead
+			static TextureBase* RGBAArrayFromFilenames(const std::vector<std::string>& names);
+
+			//Copies textures already on the GPU into the layers of a new array, every
+			//mip level they all have, so they have to share a size and format. Gives
+			//back nullptr if they don't, or without GL 4.3's glCopyImageSubData
+			static TextureBase* ArrayFromTextures(const std::vector<GLuint>& textures);
+
+			//Both replace whatever the texture held before, keeping the same object.
+			//Only the compressed levels that were loaded go up, and the largest
+			//of them is the one that's sampled from
+			void SetRGBAData(const char* data, int width, int height, int channels);
+			void SetCompressedData(const CompressedTexture& compressed);
+
+			//For streaming mips in and out of a compressed texture. A level only
+			//goes up if it's the one just above the current base level, which it
+			//then becomes. Dropping them lets go of every level above the given one
+			void SetCompressedMip(CompressedTexture::Format format, int level, int width, int height, const char* data, size_t size);
+			void DropMipsAbove(int level);
+
+			//The largest level there is to sample from
+			int GetBaseLevel() const {
+				return baseLevel;
+			}
+
 			GLuint GetObjectID() const	{
 				return texID;
 			}
+
+			GLenum GetTarget() const {
+				return target;
+			}
+
+			int GetLayerCount() const {
+				return layers;
+			}
 		protected:						
+			static GLenum GetCompressedFormat(CompressedTexture::Format format);
+			static TextureBase* CompressedArrayFromFilenames(const std::vector<std::string>& names);
+
+			//For the MemoryTracker, given back when the texture's deleted
+			void AddGPUBytes(size_t bytes);
+			void ReplaceGPUBytes(size_t bytes);
+
 			GLuint texID;
+			GLenum target	= GL_TEXTURE_2D;
+			int		layers	= 1;
+			int		baseLevel = 0;
+			size_t	gpuBytes = 0;
 		};
 	}
 }
@@ -0,0 +1,192 @@
+#include "OGLTextureUploader.h"
+#include "OGLTexture.h"
+#include "../../Common/TextureLoader.h"
+#include "../../Common/MemoryTracker.h"
+#include <cstdlib>
+
+using namespace NCL;
+using namespace NCL::Rendering;
+
+//Keeps every texture's pixels starting on a nicely aligned address
+static const size_t UploadAlignment = 64;
+
+OGLTextureUploader::OGLTextureUploader(size_t bufferSize) {
+	if (glBufferStorage && glMapBufferRange) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, flags);
+		memory = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, flags);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (memory) {
+			capacity = bufferSize;
+			MemoryTracker::RecordGPU(MemoryTag::Textures, (int64_t)capacity);
+		}
+	}
+
+	char* data	= nullptr;
+	int flags	= 0;
+	if (TextureLoader::LoadTexture("checkerboard.png", data, placeholderWidth, placeholderHeight, placeholderChannels, flags) && data) {
+		placeholder.assign(data, data + placeholderWidth * placeholderHeight * placeholderChannels);
+		free(data);
+		return;
+	}
+	//Magenta and black, so there's no mistaking it for anything real
+	placeholderWidth	= 8;
+	placeholderHeight	= 8;
+	placeholderChannels	= 4;
+	placeholder.resize(8 * 8 * 4);
+	for (int y = 0; y < 8; ++y) {
+		for (int x = 0; x < 8; ++x) {
+			char* texel = &placeholder[(y * 8 + x) * 4];
+			bool lit = ((x >> 1) + (y >> 1)) & 1;
+			texel[0] = lit ? (char)255 : 0;
+			texel[1] = 0;
+			texel[2] = lit ? (char)255 : 0;
+			texel[3] = (char)255;
+		}
+	}
+}
+
+OGLTextureUploader::~OGLTextureUploader() {
+	for (Upload& u : uploads) {
+		if (u.fence) {
+			glDeleteSync(u.fence);
+		}
+	}
+	if (memory) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		MemoryTracker::RecordGPU(MemoryTag::Textures, -(int64_t)capacity);
+	}
+	if (buffer) {
+		glDeleteBuffers(1, &buffer);
+	}
+}
+
+OGLTexture* OGLTextureUploader::CreateTexture() {
+	OGLTexture* tex = new OGLTexture();
+	tex->SetRGBAData(placeholder.data(), placeholderWidth, placeholderHeight, placeholderChannels);
+	return tex;
+}
+
+/*
+Free room is from head up to the end of the buffer and then from the start
+up to tail, or just from head up to tail once it's wrapped round. Anything
+that won't fit before the end starts again at the beginning, and the bit
+left at the end is skipped until tail's passed it. Head never quite
+catches up with tail, so they're only the same when the ring's empty.
+*/
+char* OGLTextureUploader::Reserve(OGLTexture* texture, int width, int height, int channels, uint64_t& ticket) {
+	if (!memory || width <= 0 || height <= 0) {
+		return nullptr;
+	}
+	Upload u;
+	u.texture	= texture;
+	u.width		= width;
+	u.height	= height;
+	u.channels	= channels;
+	return Reserve(u, (size_t)width * height * channels, ticket);
+}
+
+char* OGLTextureUploader::ReserveMip(OGLTexture* texture, CompressedTexture::Format format, int level, int width, int height, size_t size, uint64_t& ticket) {
+	if (!memory || size == 0) {
+		return nullptr;
+	}
+	Upload u;
+	u.texture	= texture;
+	u.width		= width;
+	u.height	= height;
+	u.level		= level;
+	u.format	= format;
+	u.dataSize	= size;
+	return Reserve(u, size, ticket);
+}
+
+char* OGLTextureUploader::Reserve(Upload& u, size_t size, uint64_t& ticket) {
+	size_t aligned = (size + UploadAlignment - 1) & ~(UploadAlignment - 1);
+
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	if (uploads.empty()) {
+		head = tail = 0;
+	}
+	size_t offset = 0;
+	if (head >= tail) {
+		if (head + aligned <= capacity) {
+			offset = head;
+		}
+		else if (aligned < tail) {
+			offset = 0;
+		}
+		else {
+			return nullptr;
+		}
+	}
+	else if (head + aligned < tail) {
+		offset = head;
+	}
+	else {
+		return nullptr;
+	}
+	head = offset + aligned;
+
+	u.offset	= offset;
+	u.size		= aligned;
+	ticket = firstTicket + uploads.size();
+	uploads.emplace_back(u);
+	return memory + offset;
+}
+
+void OGLTextureUploader::Submit(uint64_t ticket) {
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	if (ticket >= firstTicket && ticket < firstTicket + uploads.size()) {
+		uploads[(size_t)(ticket - firstTicket)].submitted = true;
+	}
+}
+
+/*
+The buffer's coherent, so whatever the loader threads wrote is already
+visible to the GPU by the time they've submitted it. Textures are done in
+the order they were reserved in, but only the ones at the front that have
+finished can have their room taken back.
+*/
+void OGLTextureUploader::Update() {
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	bool bound = false;
+	for (Upload& u : uploads) {
+		if (!u.submitted || u.fence) {
+			continue;
+		}
+		if (!bound) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+			bound = true;
+		}
+		if (u.level < 0) {
+			u.texture->SetRGBAData((const char*)u.offset, u.width, u.height, u.channels);
+		}
+		else {
+			u.texture->SetCompressedMip(u.format, u.level, u.width, u.height, (const char*)u.offset, u.dataSize);
+		}
+		u.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	if (bound) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	while (!uploads.empty() && uploads.front().fence) {
+		GLenum state = glClientWaitSync(uploads.front().fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(uploads.front().fence);
+		tail = uploads.front().offset + uploads.front().size;
+		uploads.pop_front();
+		firstTicket++;
+	}
+}
+
+int OGLTextureUploader::GetPendingCount() {
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	return (int)uploads.size();
+}
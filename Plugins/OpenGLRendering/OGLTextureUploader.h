@@ -0,0 +1,92 @@
+#pragma once
+#include "glad\glad.h"
+#include "../../Common/CompressedTexture.h"
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+namespace NCL {
+	namespace Rendering {
+		class OGLTexture;
+
+		/*
+		Gets decoded pixels to the GPU without the main thread having to copy
+		them. It's one big pixel buffer, mapped once and kept that way, that
+		loader threads reserve room in and write their pixels straight into.
+		Update then has each texture read from its part of the buffer, which
+		the driver can do in its own time, and puts a fence after it - once
+		that's passed, the texture's ready, and its room can be reused.
+
+		Room's handed out in a ring, and taken back in the same order, so a
+		texture whose upload is taking a while holds up whatever was reserved
+		after it. If there isn't room, Reserve says so, and the pixels will
+		have to go up the old way.
+
+		Textures are made with a placeholder in them - checkerboard.png, or
+		a checkerboard of its own if that can't be found - so they can be
+		handed out and bound before the real pixels arrive.
+		*/
+		class OGLTextureUploader {
+		public:
+			OGLTextureUploader(size_t bufferSize = 64 * 1024 * 1024);
+			~OGLTextureUploader();
+
+			//Needs GL 4.4, for glBufferStorage
+			bool IsSupported() const {
+				return memory != nullptr;
+			}
+
+			//Main thread only, as it's a GL call
+			OGLTexture* CreateTexture();
+
+			//Room for a texture's pixels, for any thread to write into, or null if
+			//there isn't enough free. The ticket's what Submit needs to know it by
+			char* Reserve(OGLTexture* texture, int width, int height, int channels, uint64_t& ticket);
+			//The same for one level of a compressed texture, sent up with SetCompressedMip
+			char* ReserveMip(OGLTexture* texture, CompressedTexture::Format format, int level, int width, int height, size_t size, uint64_t& ticket);
+			//Once its pixels are all written, the texture's sent up in the next Update
+			void Submit(uint64_t ticket);
+
+			//Main thread only - sends up everything submitted, and takes back the room
+			//of anything the GPU's done with
+			void Update();
+
+			//Reserved and not ready yet, whether or not they've been submitted
+			int GetPendingCount();
+
+		protected:
+			struct Upload {
+				OGLTexture*	texture		= nullptr;
+				size_t		offset		= 0;
+				size_t		size		= 0;
+				int			width		= 0;
+				int			height		= 0;
+				int			channels	= 0;
+				int			level		= -1;	//the whole texture, as RGBA, unless it's a compressed mip
+				CompressedTexture::Format format = CompressedTexture::Format::BC1;
+				size_t		dataSize	= 0;	//of the mip, without the padding
+				bool		submitted	= false;
+				GLsync		fence		= 0;
+			};
+
+			//Finds room for it, and hands out its ticket
+			char* Reserve(Upload& u, size_t size, uint64_t& ticket);
+
+			GLuint	buffer		= 0;
+			char*	memory		= nullptr;
+			size_t	capacity	= 0;
+			size_t	head		= 0;	//where the next reservation starts looking
+			size_t	tail		= 0;	//the end of the last one taken back
+
+			std::mutex			uploadMutex;
+			std::deque<Upload>	uploads;	//in the order they were reserved
+			uint64_t			firstTicket	= 0;	//the front of uploads'
+
+			std::vector<char>	placeholder;
+			int					placeholderWidth	= 0;
+			int					placeholderHeight	= 0;
+			int					placeholderChannels	= 0;
+		};
+	}
+}
@@ -1,13 +1,85 @@
 #ifdef _ORBIS
 #include "PS4ComputeShader.h"
+
+#include <iostream>
+#include <fstream>
+#include <gnmx\shader_parser.h>
+#include <.\graphics\api_gnm\toolkit\allocators.h>
+#include <.\graphics\api_gnm\toolkit\stack_allocator.h>
+
+using namespace sce;
 using namespace NCL::PS4;
 
-PS4ComputeShader::PS4ComputeShader()
+//Loaded the same way as PS4Shader's vertex and pixel shaders, from a compiled .sb
+PS4ComputeShader::PS4ComputeShader(const std::string& filename)
 {
-}
+	computeShader	= NULL;
+	threadXCount	= 1;
+
+	char*	binData = NULL;
+	int		binSize = 0;
+	if (!LoadShaderBinary(filename, binData, binSize)) {
+		std::cout << "Failed to generate compute shader: " << filename << " from binary. " << std::endl;
+		return;
+	}
+	computeBinary.loadFromMemory(binData, binSize);
+
+	Gnmx::ShaderInfo shaderInfo;
+	Gnmx::parseShader(&shaderInfo, binData);
+
+	void* shaderBinary = garlicAllocator->allocate(shaderInfo.m_gpuShaderCodeSize, Gnm::kAlignmentOfShaderInBytes);
+	void* shaderHeader = onionAllocator->allocate(shaderInfo.m_csShader->computeSize(), Gnm::kAlignmentOfBufferInBytes);
 
+	memcpy(shaderBinary, shaderInfo.m_gpuShaderCode, shaderInfo.m_gpuShaderCodeSize);
+	memcpy(shaderHeader, shaderInfo.m_csShader, shaderInfo.m_csShader->computeSize());
+
+	computeShader = (Gnmx::CsShader*)shaderHeader;
+	computeShader->patchShaderGpuAddress(shaderBinary);
+
+	Gnm::registerResource(nullptr, ownerHandle, computeShader->getBaseAddress(),
+		shaderInfo.m_gpuShaderCodeSize, filename.c_str(), Gnm::kResourceTypeShaderBaseAddress, 0);
+
+	Gnmx::generateInputOffsetsCache(&computeCache, Gnm::kShaderStageCs, computeShader);
+
+	threadXCount = computeShader->m_csStageRegisters.m_computeNumThreadX;
+}
 
 PS4ComputeShader::~PS4ComputeShader()
 {
 }
-#endif
\ No newline at end of file
+
+bool PS4ComputeShader::LoadShaderBinary(const std::string& name, char*& into, int& dataSize) {
+	std::ifstream binFile(name, std::ios::binary);
+
+	if (!binFile) {
+		return false;
+	}
+	binFile.seekg(0, std::ios::end);
+	int size = (int)binFile.tellg();
+
+	into = new char[size];
+
+	binFile.seekg(0, std::ios::beg);
+	binFile.read(into, size);
+
+	dataSize = size;
+
+	return true;
+}
+
+int PS4ComputeShader::GetBufferSlot(const std::string& name) {
+	sce::Shader::Binary::Buffer* buffer = computeBinary.getBufferResourceByName(name.c_str());
+	if (!buffer) {
+		return -1;
+	}
+	return buffer->m_resourceIndex;
+}
+
+void PS4ComputeShader::SubmitShaderSwitch(Gnmx::GnmxGfxContext& cmdList) {
+	cmdList.setCsShader(computeShader, &computeCache);
+}
+
+void PS4ComputeShader::Dispatch(Gnmx::GnmxGfxContext& cmdList, int groupsX, int groupsY, int groupsZ) {
+	cmdList.dispatch(groupsX, groupsY, groupsZ);
+}
+#endif
@@ -1,12 +1,42 @@
 #pragma once
 #ifdef _ORBIS
+#include "PS4MemoryAware.h"
+
+#include <gnm.h>
+#include <gnmx\shaderbinary.h>
+#include <gnmx\context.h>
+#include <shader\binary.h>
+#include <string>
+
 namespace NCL {
 	namespace PS4 {
-		class PS4ComputeShader
+		class PS4ComputeShader : public PS4MemoryAware
 		{
 		public:
-			PS4ComputeShader();
+			PS4ComputeShader(const std::string& filename);
 			~PS4ComputeShader();
+
+			bool LoadSuccess() const {
+				return computeShader != nullptr;
+			}
+
+			int GetThreadXCount() const {
+				return threadXCount;
+			}
+
+			//Which slot a buffer of this name's read from, or -1 if it isn't used
+			int		GetBufferSlot(const std::string& name);
+
+			void	SubmitShaderSwitch(sce::Gnmx::GnmxGfxContext& cmdList);
+			void	Dispatch(sce::Gnmx::GnmxGfxContext& cmdList, int groupsX, int groupsY = 1, int groupsZ = 1);
+
+		protected:
+			bool LoadShaderBinary(const std::string& name, char*& into, int& dataSize);
+
+			sce::Shader::Binary::Program	computeBinary;
+			sce::Gnmx::CsShader*			computeShader;
+			sce::Gnmx::InputOffsetsCache	computeCache;
+			int								threadXCount;
 		};
 	}
 }
@@ -33,12 +33,17 @@ PS4Frame::PS4Frame()
 
 	commandBuffer.init(constantUpdateEngine, kNumRingEntries, drawCommandBuffer, bufferBytes, constantCommandBuffer, bufferBytes);
 
+	frameMemory		= (char*)onionAllocator->allocate(FrameMemoryBytes, Gnm::kAlignmentOfBufferInBytes);
+	frameMemoryUsed	= 0;
+
 	Gnm::registerResource(nullptr, ownerHandle, drawCommandBuffer	  , bufferBytes,
 		"FrameDrawCommandBuffer", Gnm::kResourceTypeDrawCommandBufferBaseAddress, 0);
 	Gnm::registerResource(nullptr, ownerHandle, constantUpdateEngine , bufferBytes,
 		"FrameConstantUpdateEngine", Gnm::kResourceTypeDrawCommandBufferBaseAddress, 0);
 	Gnm::registerResource(nullptr, ownerHandle, constantCommandBuffer, bufferBytes,
 		"FrameConstantCommandBuffer", Gnm::kResourceTypeDrawCommandBufferBaseAddress, 0);
+	Gnm::registerResource(nullptr, ownerHandle, frameMemory, FrameMemoryBytes,
+		"FrameMemory", Gnm::kResourceTypeBufferBaseAddress, 0);
 }
 
 PS4Frame::~PS4Frame()
@@ -49,6 +54,7 @@ PS4Frame::~PS4Frame()
 void PS4Frame::StartFrame() {
 	BlockUntilReady();
 	*newFrameTag = FRAME_WAITING;
+	frameMemoryUsed = 0;
 
 	commandBuffer.reset();
 	commandBuffer.initializeDefaultHardwareState();
@@ -82,6 +88,15 @@ void PS4Frame::BlockUntilReady() {
 	}
 }
 
+void* PS4Frame::AllocateFrameMemory(size_t bytes, size_t alignment) {
+	size_t start = (frameMemoryUsed + alignment - 1) & ~(alignment - 1);
+	if (start + bytes > FrameMemoryBytes) {
+		return nullptr;
+	}
+	frameMemoryUsed = start + bytes;
+	return frameMemory + start;
+}
+
 void  PS4Frame::EndFrame() {
 	commandBuffer.writeImmediateAtEndOfPipeWithInterrupt(Gnm::kEopFlushCbDbCaches, newFrameTag, FRAME_DONE, Gnm::kCacheActionNone);
 }
@@ -21,10 +21,24 @@ namespace NCL {
 			void StartFrame();
 			void EndFrame();
 
+			//Handed out from the start again each frame, once the GPU's done with
+			//the last one - so it's only for things only this frame reads, like
+			//constants and instance data. nullptr if it's all been used
+			void* AllocateFrameMemory(size_t bytes, size_t alignment = sce::Gnm::kAlignmentOfBufferInBytes);
+
+			size_t GetFrameMemoryUsed() const {
+				return frameMemoryUsed;
+			}
+
+			static const size_t FrameMemoryBytes = 4 * 1024 * 1024;
+
 		protected:
 			sce::Gnmx::GnmxGfxContext commandBuffer;
 
 			uint64_t* newFrameTag;
+
+			char*	frameMemory;
+			size_t	frameMemoryUsed;
 		};
 	}
 }
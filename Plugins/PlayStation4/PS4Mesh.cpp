@@ -12,7 +12,12 @@ using namespace NCL::PS4;
 PS4Mesh::PS4Mesh()	{
 	indexBuffer		= 0;
 	vertexBuffer	= 0;
+	skinWeightBuffer	= 0;
+	skinIndexBuffer		= 0;
+	attributeBuffers	= 0;
 	attributeCount	= 0;
+	indexType		= sce::Gnm::IndexSize::kIndexSize32;
+	primitiveType	= sce::Gnm::PrimitiveType::kPrimitiveTypeTriList;
 }
 
 PS4Mesh::~PS4Mesh()	{
@@ -87,11 +92,27 @@ void	PS4Mesh::UploadToGPU() {
 	Gnm::registerResource(nullptr, ownerHandle, indexBuffer , indexDataSize , "IndexData" , Gnm::kResourceTypeIndexBufferBaseAddress, 0);
 	Gnm::registerResource(nullptr, ownerHandle, vertexBuffer, vertexDataSize, "VertexData", Gnm::kResourceTypeIndexBufferBaseAddress, 0);
 
+	//Anything the mesh doesn't have is left as zeroes, rather than read past the end of
+	memset(vertexBuffer, 0, vertexDataSize);
 	for (int i = 0; i < GetVertexCount(); ++i) {
 		memcpy(&vertexBuffer[i].position,	  &positions[i], sizeof(float) * 3);
-		memcpy(&vertexBuffer[i].textureCoord, &texCoords[i], sizeof(float) * 2);
-		memcpy(&vertexBuffer[i].normal,		  &normals[i],   sizeof(float) * 3);
-		memcpy(&vertexBuffer[i].tangent,	  &tangents[i],  sizeof(float) * 3);
+		if (!texCoords.empty()) {
+			memcpy(&vertexBuffer[i].textureCoord, &texCoords[i], sizeof(float) * 2);
+		}
+		if (!normals.empty()) {
+			memcpy(&vertexBuffer[i].normal,	  &normals[i],   sizeof(float) * 3);
+		}
+		if (!tangents.empty()) {
+			memcpy(&vertexBuffer[i].tangent, &tangents[i],  sizeof(float) * 3);
+		}
+	}
+
+	if (!skinWeights.empty() && !skinIndices.empty()) {
+		const int skinDataSize = GetVertexCount() * sizeof(float) * 4;
+		skinWeightBuffer	= static_cast<float*>(garlicAllocator->allocate(skinDataSize, Gnm::kAlignmentOfBufferInBytes));
+		skinIndexBuffer		= static_cast<float*>(garlicAllocator->allocate(skinDataSize, Gnm::kAlignmentOfBufferInBytes));
+		memcpy(skinWeightBuffer, skinWeights.data(), skinDataSize);
+		memcpy(skinIndexBuffer, skinIndices.data(), skinDataSize);
 	}
 
 	for (int i = 0; i < GetIndexCount(); ++i) { //Our index buffer might not have the same data size as the source indices?
@@ -101,10 +122,24 @@ void	PS4Mesh::UploadToGPU() {
 	attributeCount		= 4;
 	attributeBuffers	= new sce::Gnm::Buffer[4];
 
-	InitAttributeBuffer(attributeBuffers[0], Gnm::kDataFormatR32G32B32Float, &(vertexBuffer[0].position));
-	InitAttributeBuffer(attributeBuffers[1], Gnm::kDataFormatR32G32Float	, &(vertexBuffer[0].textureCoord));
-	InitAttributeBuffer(attributeBuffers[2], Gnm::kDataFormatR32G32B32Float, &(vertexBuffer[0].normal));
-	InitAttributeBuffer(attributeBuffers[3], Gnm::kDataFormatR32G32B32Float, &(vertexBuffer[0].tangent));
+	InitAttributeBuffers(attributeBuffers, vertexBuffer);
+}
+
+void	PS4Mesh::InitAttributeBuffers(sce::Gnm::Buffer* buffers, void* vertices) {
+	MeshVertex* v = (MeshVertex*)vertices;
+	InitAttributeBuffer(buffers[0], Gnm::kDataFormatR32G32B32Float, &(v[0].position));
+	InitAttributeBuffer(buffers[1], Gnm::kDataFormatR32G32Float	, &(v[0].textureCoord));
+	InitAttributeBuffer(buffers[2], Gnm::kDataFormatR32G32B32Float, &(v[0].normal));
+	InitAttributeBuffer(buffers[3], Gnm::kDataFormatR32G32B32Float, &(v[0].tangent));
+}
+
+void	PS4Mesh::GetSkinningBuffers(Gnm::Buffer& vertices, Gnm::Buffer& weights, Gnm::Buffer& indices) const {
+	vertices.initAsRegularBuffer(vertexBuffer, sizeof(MeshVertex), GetVertexCount());
+	weights.initAsRegularBuffer(skinWeightBuffer, sizeof(float) * 4, GetVertexCount());
+	indices.initAsRegularBuffer(skinIndexBuffer, sizeof(float) * 4, GetVertexCount());
+	vertices.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+	weights.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
+	indices.setResourceMemoryType(Gnm::kResourceMemoryTypeRO);
 }
 
 void	PS4Mesh::InitAttributeBuffer(sce::Gnm::Buffer &buffer, Gnm::DataFormat format, void*offset) {
@@ -113,9 +148,22 @@ void	PS4Mesh::InitAttributeBuffer(sce::Gnm::Buffer &buffer, Gnm::DataFormat form
 }
 
 void PS4Mesh::SubmitDraw(Gnmx::GnmxGfxContext& cmdList, Gnm::ShaderStage stage) {
-	cmdList.setVertexBuffers(stage, 0, attributeCount, attributeBuffers);
+	SubmitInstancedDraw(cmdList, stage, 1);
+}
+
+void PS4Mesh::SubmitInstancedDraw(Gnmx::GnmxGfxContext& cmdList, Gnm::ShaderStage stage, int instances, void* vertices) {
+	if (vertices) {
+		sce::Gnm::Buffer skinned[4]; //the command buffer takes a copy of these
+		InitAttributeBuffers(skinned, vertices);
+		cmdList.setVertexBuffers(stage, 0, 4, skinned);
+	}
+	else {
+		cmdList.setVertexBuffers(stage, 0, attributeCount, attributeBuffers);
+	}
+	cmdList.setNumInstances(instances);
 	cmdList.setPrimitiveType(primitiveType);
 	cmdList.setIndexSize(indexType);
 	cmdList.drawIndex(GetIndexCount(), indexBuffer);
+	cmdList.setNumInstances(1);
 } 
 #endif
\ No newline at end of file
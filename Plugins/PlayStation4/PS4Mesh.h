@@ -23,11 +23,28 @@ namespace NCL {
 			static PS4Mesh* GenerateQuad();
 			static PS4Mesh* GenerateSinglePoint();
 
+			//Draws every instance of it at once, from the skinned copy of its vertices if there is one
+			void	SubmitInstancedDraw(Gnmx::GnmxGfxContext& cmdList, Gnm::ShaderStage stage, int instances, void* vertices = nullptr);
+
+			//Its interleaved vertices, joint weights and indices, read by the skinning compute shader
+			bool	CanSkin() const {
+				return skinWeightBuffer != nullptr;
+			}
+			void	GetSkinningBuffers(Gnm::Buffer& vertices, Gnm::Buffer& weights, Gnm::Buffer& indices) const;
+
+			int		GetVertexDataSize() const {
+				return vertexDataSize;
+			}
+			static int GetVertexStride() {
+				return sizeof(MeshVertex);
+			}
+
 		protected:
 			void	SubmitPreDraw(Gnmx::GnmxGfxContext& cmdList, Gnm::ShaderStage stage);
 			void	SubmitDraw(Gnmx::GnmxGfxContext& cmdList, Gnm::ShaderStage stage);
 
 			void	InitAttributeBuffer(sce::Gnm::Buffer &buffer, Gnm::DataFormat format, void*offset);
+			void	InitAttributeBuffers(sce::Gnm::Buffer* buffers, void* vertices);
 
 		protected:
 			PS4Mesh();
@@ -53,6 +70,8 @@ namespace NCL {
 
 			int*		indexBuffer;
 			MeshVertex*	vertexBuffer;
+			float*		skinWeightBuffer;	//4 a vertex, for both
+			float*		skinIndexBuffer;
 
 			int	vertexDataSize;
 			int indexDataSize;
@@ -58,7 +58,7 @@ PS4RendererBase::PS4RendererBase(PS4Window*window)
 	cameraBuffer.initAsConstantBuffer(viewProjMat, sizeof(Matrix4));
 	cameraBuffer.setResourceMemoryType(Gnm::kResourceMemoryTypeRO); // it's a constant buffer, so read-only is OK
 
-	EndFrame(); //always swap at least once...
+	SwapBuffers(); //always swap at least once...
 }
 
 PS4RendererBase::~PS4RendererBase()	{
@@ -210,7 +210,7 @@ void	PS4RendererBase::DestroyVideoSystem() {
 	sceVideoOutClose(videoHandle);
 }
 
-void PS4RendererBase::RenderFrame()			{
+void PS4RendererBase::RenderFrame(int curFrame)	{
 	currentFrame->StartFrame();	
 
 	currentGFXContext->waitUntilSafeForRendering(videoHandle, currentGPUBuffer);
@@ -243,7 +243,7 @@ void PS4RendererBase::RenderFrame()			{
 
 	*viewProjMat = Matrix4();
 
-	RenderActiveScene();
+	RenderActiveScene(curFrame);
 
 	currentFrame->EndFrame();
 
@@ -259,6 +259,10 @@ void	PS4RendererBase::BeginFrame()   {
 }
 
 void PS4RendererBase::EndFrame()			{
+
+}
+
+void PS4RendererBase::SwapBuffers()		{
 	SwapScreenBuffer();
 	SwapCommandBuffer();
 }
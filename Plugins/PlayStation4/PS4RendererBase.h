@@ -46,12 +46,13 @@ namespace NCL {
 			~PS4RendererBase();
 
 		protected:
-			virtual void RenderActiveScene() = 0;
+			virtual void RenderActiveScene(int curFrame) = 0;
 
 			void	OnWindowResize(int w, int h) override;
 			void	BeginFrame()    override;
-			void	RenderFrame()	override;
+			void	RenderFrame(int curFrame)	override;
 			void	EndFrame()		override;
+			void	SwapBuffers()	override;
 
 			void	SwapScreenBuffer();
 			void	SwapCommandBuffer();
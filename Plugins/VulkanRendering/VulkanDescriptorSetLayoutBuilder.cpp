@@ -28,6 +28,17 @@ VulkanDescriptorSetLayoutBuilder& VulkanDescriptorSetLayoutBuilder::WithUniformB
 	return *this;
 }
 
+VulkanDescriptorSetLayoutBuilder& VulkanDescriptorSetLayoutBuilder::WithDynamicUniformBuffers(unsigned int count, vk::ShaderStageFlags inShaders) {
+	vk::DescriptorSetLayoutBinding binding = vk::DescriptorSetLayoutBinding()
+		.setBinding((uint32_t)addedBindings.size())
+		.setDescriptorCount(count)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setStageFlags(inShaders);
+
+	addedBindings.emplace_back(binding);
+	return *this;
+}
+
 VulkanDescriptorSetLayoutBuilder& VulkanDescriptorSetLayoutBuilder::WithDebugName(const string& name) {
 	debugName = name;
 	return *this;
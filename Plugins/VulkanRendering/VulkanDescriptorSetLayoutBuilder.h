@@ -11,6 +11,8 @@ namespace NCL {
 
 			VulkanDescriptorSetLayoutBuilder& WithSamplers(unsigned int count, vk::ShaderStageFlags inShaders);
 			VulkanDescriptorSetLayoutBuilder& WithUniformBuffers(unsigned int count, vk::ShaderStageFlags inShaders);
+			//For the renderer's uniform buffers, which have a copy per frame in flight to pick between when bound
+			VulkanDescriptorSetLayoutBuilder& WithDynamicUniformBuffers(unsigned int count, vk::ShaderStageFlags inShaders);
 
 			VulkanDescriptorSetLayoutBuilder& WithDebugName(const string& name);
 
@@ -0,0 +1,169 @@
+#include "VulkanMemoryAllocator.h"
+#include <iostream>
+#include <iterator>
+
+using namespace NCL;
+using namespace Rendering;
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties& properties) {
+	this->device		= device;
+	memoryProperties	= properties;
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator() {
+	for (Block* b : blocks) {
+		if (!b) {
+			continue;
+		}
+		if (b->mapped) {
+			device.unmapMemory(b->memory);
+		}
+		device.freeMemory(b->memory);
+		delete b;
+	}
+}
+
+bool VulkanMemoryAllocator::FindMemoryType(vk::MemoryPropertyFlags flags, uint32_t typeBits, uint32_t& index) const {
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+		if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags) {
+			index = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int VulkanMemoryAllocator::CreateBlock(vk::DeviceSize size, uint32_t memoryType, bool forImages, bool dedicated) {
+	Block* b		= new Block();
+	b->memory		= device.allocateMemory(vk::MemoryAllocateInfo(size, memoryType));
+	b->size			= size;
+	b->memoryType	= memoryType;
+	b->forImages	= forImages;
+	b->dedicated	= dedicated;
+	b->freeRanges[0] = size;
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		b->mapped = (char*)device.mapMemory(b->memory, 0, VK_WHOLE_SIZE);
+	}
+	for (int i = 0; i < (int)blocks.size(); ++i) {
+		if (!blocks[i]) {
+			blocks[i] = b;
+			return i;
+		}
+	}
+	blocks.emplace_back(b);
+	return (int)blocks.size() - 1;
+}
+
+//First fit, with whatever's skipped to align the start left as its own free range
+bool VulkanMemoryAllocator::AllocateFromBlock(Block& b, const vk::MemoryRequirements& reqs, vk::DeviceSize& offset) {
+	vk::DeviceSize alignment = reqs.alignment > 0 ? reqs.alignment : 1;
+	for (auto i = b.freeRanges.begin(); i != b.freeRanges.end(); ++i) {
+		vk::DeviceSize start	= i->first;
+		vk::DeviceSize end		= i->first + i->second;
+		vk::DeviceSize aligned	= (start + alignment - 1) / alignment * alignment;
+		if (aligned + reqs.size > end) {
+			continue;
+		}
+		b.freeRanges.erase(i);
+		if (aligned > start) {
+			b.freeRanges[start] = aligned - start;
+		}
+		if (aligned + reqs.size < end) {
+			b.freeRanges[aligned + reqs.size] = end - (aligned + reqs.size);
+		}
+		b.used += reqs.size;
+		offset = aligned;
+		return true;
+	}
+	return false;
+}
+
+VulkanAllocation VulkanMemoryAllocator::Allocate(const vk::MemoryRequirements& reqs, vk::MemoryPropertyFlags flags, bool forImage) {
+	VulkanAllocation result;
+	uint32_t memoryType = 0;
+	if (!FindMemoryType(flags, reqs.memoryTypeBits, memoryType)) {
+		std::cout << __FUNCTION__ << " no memory type fits this resource!\n";
+		return result;
+	}
+	std::lock_guard<std::mutex> lock(blockMutex);
+
+	int blockIndex = -1;
+	vk::DeviceSize offset = 0;
+	if (reqs.size > BlockSize / 2) {
+		blockIndex = CreateBlock(reqs.size, memoryType, forImage, true);
+		AllocateFromBlock(*blocks[blockIndex], reqs, offset);
+	}
+	else {
+		for (int i = 0; i < (int)blocks.size(); ++i) {
+			Block* b = blocks[i];
+			if (b && !b->dedicated && b->memoryType == memoryType && b->forImages == forImage && AllocateFromBlock(*b, reqs, offset)) {
+				blockIndex = i;
+				break;
+			}
+		}
+		if (blockIndex < 0) {
+			blockIndex = CreateBlock(BlockSize, memoryType, forImage, false);
+			AllocateFromBlock(*blocks[blockIndex], reqs, offset);
+		}
+	}
+	Block* b = blocks[blockIndex];
+	result.memory	= b->memory;
+	result.offset	= offset;
+	result.size		= reqs.size;
+	result.mapped	= b->mapped ? b->mapped + offset : nullptr;
+	result.block	= blockIndex;
+	return result;
+}
+
+//The range goes back into its block's free list, merged with whatever's free either side of it
+void VulkanMemoryAllocator::Free(VulkanAllocation& allocation) {
+	if (allocation.block < 0) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(blockMutex);
+	Block* b = blocks[allocation.block];
+
+	vk::DeviceSize start	= allocation.offset;
+	vk::DeviceSize size		= allocation.size;
+	auto next = b->freeRanges.lower_bound(start);
+	if (next != b->freeRanges.end() && start + size == next->first) {
+		size += next->second;
+		next = b->freeRanges.erase(next);
+	}
+	if (next != b->freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == start) {
+			start = prev->first;
+			size += prev->second;
+			b->freeRanges.erase(prev);
+		}
+	}
+	b->freeRanges[start] = size;
+	b->used -= allocation.size;
+
+	if (b->dedicated && b->used == 0) {
+		if (b->mapped) {
+			device.unmapMemory(b->memory);
+		}
+		device.freeMemory(b->memory);
+		delete b;
+		blocks[allocation.block] = nullptr;
+	}
+	allocation = VulkanAllocation();
+}
+
+VulkanAllocation VulkanMemoryAllocator::AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags flags) {
+	VulkanAllocation a = Allocate(device.getBufferMemoryRequirements(buffer), flags, false);
+	if (a.memory) {
+		device.bindBufferMemory(buffer, a.memory, a.offset);
+	}
+	return a;
+}
+
+VulkanAllocation VulkanMemoryAllocator::AllocateImage(vk::Image image, vk::MemoryPropertyFlags flags) {
+	VulkanAllocation a = Allocate(device.getImageMemoryRequirements(image), flags, true);
+	if (a.memory) {
+		device.bindImageMemory(image, a.memory, a.offset);
+	}
+	return a;
+}
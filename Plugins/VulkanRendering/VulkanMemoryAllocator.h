@@ -0,0 +1,76 @@
+#pragma once
+
+#ifdef _WIN32
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <Windows.h> //vulkan hpp needs this included beforehand!
+#include <minwindef.h>
+#endif
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace NCL {
+	namespace Rendering {
+		//A range of one of the allocator's blocks, mapped already if it's host visible
+		struct VulkanAllocation {
+			vk::DeviceMemory	memory;
+			vk::DeviceSize		offset	= 0;
+			vk::DeviceSize		size	= 0;
+			char*				mapped	= nullptr;
+			int					block	= -1;
+		};
+
+		/*
+		Drivers only allow so many allocations, and each one costs, so
+		resources are placed in large blocks instead of getting their own.
+		Each block keeps its free ranges sorted by offset, and freed ranges
+		are merged with their neighbours, so blocks don't fragment away as
+		meshes and textures come and go. Buffers and images never share a
+		block, so there's no need to worry about bufferImageGranularity.
+		Anything too big to share a block gets one to itself, which is given
+		back as soon as it's freed. Host visible blocks are mapped once, for
+		as long as they exist, as memory can only be mapped once at a time.
+		*/
+		class VulkanMemoryAllocator {
+		public:
+			VulkanMemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties& properties);
+			~VulkanMemoryAllocator();
+
+			VulkanAllocation Allocate(const vk::MemoryRequirements& reqs, vk::MemoryPropertyFlags flags, bool forImage);
+			void Free(VulkanAllocation& allocation);
+
+			//Allocates and binds in one go
+			VulkanAllocation AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags flags);
+			VulkanAllocation AllocateImage(vk::Image image, vk::MemoryPropertyFlags flags);
+
+			int GetBlockCount() const {
+				return (int)blocks.size();
+			}
+
+		protected:
+			struct Block {
+				vk::DeviceMemory	memory;
+				vk::DeviceSize		size		= 0;
+				uint32_t			memoryType	= 0;
+				bool				forImages	= false;
+				bool				dedicated	= false;
+				char*				mapped		= nullptr;
+				vk::DeviceSize		used		= 0;
+				std::map<vk::DeviceSize, vk::DeviceSize> freeRanges; //offset to size
+			};
+
+			bool FindMemoryType(vk::MemoryPropertyFlags flags, uint32_t typeBits, uint32_t& index) const;
+			int  CreateBlock(vk::DeviceSize size, uint32_t memoryType, bool forImages, bool dedicated);
+			bool AllocateFromBlock(Block& b, const vk::MemoryRequirements& reqs, vk::DeviceSize& offset);
+
+			static const vk::DeviceSize BlockSize = 64 * 1024 * 1024;
+
+			vk::Device							device;
+			vk::PhysicalDeviceMemoryProperties	memoryProperties;
+			std::vector<Block*>					blocks; //freed dedicated blocks leave a gap, so indices stay put
+			std::mutex							blockMutex;
+		};
+	}
+}
@@ -35,11 +35,11 @@ VulkanMesh::VulkanMesh(const std::string& filename) : MeshGeometry(filename) {
 VulkanMesh::~VulkanMesh()	{
 	if (indexBuffer) {
 		sourceDevice.destroyBuffer(indexBuffer);
-		sourceDevice.freeMemory(indexMemory);
+		allocator->Free(indexMemory);
 	}
 	if (vertexBuffer) {
 		sourceDevice.destroyBuffer(vertexBuffer);
-		sourceDevice.freeMemory(vertexMemory);
+		allocator->Free(vertexMemory);
 	}
 }
 
@@ -49,7 +49,8 @@ void VulkanMesh::UploadToGPU(RendererBase* r)  {
 	}
 	VulkanRenderer* renderer = (VulkanRenderer*)r;
 
-	sourceDevice = renderer->GetDevice();
+	sourceDevice	= renderer->GetDevice();
+	allocator		= &renderer->GetMemoryAllocator();
 
 	vector< int >			attributeTypes;
 	vector< const void*>	attributePtrs;
@@ -75,21 +76,13 @@ void VulkanMesh::UploadToGPU(RendererBase* r)  {
 	attributeSpec.numAttributes = (int)attributeTypes.size();
 
 	vertexBuffer = sourceDevice.createBuffer(
-		vk::BufferCreateInfo({}, strideSize * GetVertexCount(), vk::BufferUsageFlagBits::eVertexBuffer)
+		vk::BufferCreateInfo({}, strideSize * GetVertexCount(), vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst)
 	);
+	vertexMemory = allocator->AllocateBuffer(vertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-	vk::MemoryRequirements memReqs = sourceDevice.getBufferMemoryRequirements(vertexBuffer);
-
-	vk::MemoryAllocateInfo memInfo = vk::MemoryAllocateInfo(memReqs.size);
-	if (!renderer->MemoryTypeFromPhysicalDeviceProps(
-		vk::MemoryPropertyFlagBits::eHostVisible, memReqs.memoryTypeBits, memInfo.memoryTypeIndex)) {
-		return; //Oh no - Turns out we don't have the memory requirement for this!
-	}
-
-	vertexMemory = sourceDevice.allocateMemory(memInfo);
-	sourceDevice.bindBufferMemory(vertexBuffer, vertexMemory, 0);
-	//need to now copy vertex data to device memory
-	char* dataPtr = (char*)sourceDevice.mapMemory(vertexMemory, 0, memInfo.allocationSize);
+	//Interleaved straight into the staging buffer, which is copied over with the next batch of uploads
+	vk::DeviceSize stagingOffset = 0;
+	char* dataPtr = renderer->StageUpload(strideSize * GetVertexCount(), stagingOffset);
 	for (unsigned int v = 0; v < GetVertexCount(); ++v) { //for every vertex
 		for (int i = 0; i < attributeSpec.numAttributes; ++i) { //copy its next attribute to the GPU
 			size_t copySize = attributeSizes[attributeTypes[i]];
@@ -97,7 +90,7 @@ void VulkanMesh::UploadToGPU(RendererBase* r)  {
 			dataPtr += copySize;
 		}
 	}
-	sourceDevice.unmapMemory(vertexMemory);
+	renderer->GetUploadCmdBuffer().copyBuffer(renderer->GetStagingBuffer(), vertexBuffer, vk::BufferCopy(stagingOffset, 0, strideSize * GetVertexCount()));
 
 	int currentOffset = 0;
 	for (int i = 0; i < attributeSpec.numAttributes; ++i) {
@@ -125,25 +118,10 @@ void VulkanMesh::UploadToGPU(RendererBase* r)  {
 	//Make the index buffer if there are any!
 	if (GetIndexCount() > 0) {
 		indexBuffer = sourceDevice.createBuffer(
-			vk::BufferCreateInfo({}, sizeof(int) * GetIndexCount(), vk::BufferUsageFlagBits::eIndexBuffer)
+			vk::BufferCreateInfo({}, sizeof(int) * GetIndexCount(), vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst)
 		);
-
-		vk::MemoryRequirements memReqs = sourceDevice.getBufferMemoryRequirements(indexBuffer);
-
-		vk::MemoryAllocateInfo memInfo = vk::MemoryAllocateInfo(memReqs.size);
-		if (!renderer->MemoryTypeFromPhysicalDeviceProps(
-			vk::MemoryPropertyFlagBits::eHostVisible, memReqs.memoryTypeBits, memInfo.memoryTypeIndex)) {
-			return; //Oh no - Turns out we don't have the memory requirement for this!
-		}
-
-		indexMemory = sourceDevice.allocateMemory(memInfo);
-		char* dataPtr = (char*)sourceDevice.mapMemory(indexMemory, 0, memInfo.allocationSize);
-
-		memcpy(dataPtr, GetIndexData().data(), sizeof(int) * GetIndexCount());
-
-		sourceDevice.unmapMemory(indexMemory);
-
-		sourceDevice.bindBufferMemory(indexBuffer, indexMemory, 0);
+		indexMemory = allocator->AllocateBuffer(indexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		renderer->UploadBufferData(indexBuffer, GetIndexData().data(), sizeof(int) * GetIndexCount());
 	}
 
 	if (!debugName.empty()) {
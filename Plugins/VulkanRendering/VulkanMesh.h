@@ -35,13 +35,14 @@ namespace NCL {
 		protected:
 			VulkanVertexSpecification attributeSpec;			
 			
-			vk::DeviceMemory	vertexMemory;		
+			VulkanAllocation	vertexMemory;
 			vk::Buffer			vertexBuffer;
 
-			vk::DeviceMemory	indexMemory;
+			VulkanAllocation	indexMemory;
 			vk::Buffer			indexBuffer;
 
-			vk::Device			sourceDevice;
+			vk::Device				sourceDevice;
+			VulkanMemoryAllocator*	allocator = nullptr;
 		};
 	}
 }
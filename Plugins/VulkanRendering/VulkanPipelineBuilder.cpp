@@ -119,7 +119,16 @@ VulkanPipelineBuilder& VulkanPipelineBuilder::WithDebugName(const string& name)
 	return *this;
 }
 
+/*
+Everything here only touches this builder and the device's thread safe
+calls (the pipeline cache is synchronised by the driver), so pipelines
+can be built on any thread, as long as each has its own builder.
+*/
 VulkanPipeline	VulkanPipelineBuilder::Build(VulkanRenderer& renderer) {	
+	//Set again here, as a copied builder would still point into the one it came from
+	dynamicCreate.setPDynamicStates(dynamicStateEnables);
+	pipelineCreate.setPViewportState(&viewportCreate);
+
 	vk::PipelineLayoutCreateInfo pipeLayoutCreate = vk::PipelineLayoutCreateInfo()
 		.setSetLayoutCount((uint32_t)allLayouts.size())
 		.setPSetLayouts(allLayouts.data())
@@ -3,6 +3,8 @@
 #include "VulkanTexture.h"
 
 #include "../../Common/TextureLoader.h"
+#include "../../Common/Assets.h"
+#include <fstream>
 
 #ifdef WIN32
 #include "../../Common/Win32Window.h"
@@ -18,6 +20,7 @@ VulkanRenderer::VulkanRenderer(Window& window) : RendererBase(window) {
 
 	InitInstance();
 	InitGPUDevice();
+	memoryAllocator = new VulkanMemoryAllocator(device, deviceMemoryProperties);
 	dispatcher = new vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr, device);
 
 	InitCommandPool();
@@ -30,15 +33,16 @@ VulkanRenderer::VulkanRenderer(Window& window) : RendererBase(window) {
 
 	window.SetRenderer(this);	
 	
-	pipelineCache = device.createPipelineCache(vk::PipelineCacheCreateInfo());
+	LoadPipelineCache(Assets::DATADIR + "VulkanPipelines.cache");
 
-	vk::Semaphore	presentSempaphore = device.createSemaphore(vk::SemaphoreCreateInfo());
-	vk::Fence		fence = device.createFence(vk::FenceCreateInfo());
-
-	currentSwap = device.acquireNextImageKHR(swapChain, UINT64_MAX, presentSempaphore, fence).value;	//Get swap image
+	currentSwap = device.acquireNextImageKHR(swapChain, UINT64_MAX, frames[currentFrame].imageAcquired, nullptr).value;	//Get swap image
+	defaultBeginInfo.setFramebuffer(frameBuffers[currentSwap]);
 }
 
 VulkanRenderer::~VulkanRenderer() {
+	device.waitIdle();
+	SavePipelineCache();
+	FlushUploads();
 	delete depthBuffer;
 
 	for (auto& i : swapChainList) {
@@ -52,8 +56,21 @@ VulkanRenderer::~VulkanRenderer() {
 	device.destroyDescriptorPool(defaultDescriptorPool);
 	device.destroySwapchainKHR(swapChain);
 	device.destroyCommandPool(commandPool);
+	for (auto& f : frames) {
+		for (auto& p : f.threadPools) {
+			device.destroyCommandPool(p.pool);
+		}
+		device.destroyFence(f.fence);
+		device.destroySemaphore(f.imageAcquired);
+		device.destroySemaphore(f.renderFinished);
+	}
 	device.destroyRenderPass(defaultRenderPass);
 	device.destroyPipelineCache(pipelineCache);
+	if (stagingBuffer) {
+		device.destroyBuffer(stagingBuffer);
+		memoryAllocator->Free(stagingMemory);
+	}
+	delete memoryAllocator;
 	device.destroy(); //Destroy everything except instance before this gets destroyed!
 
 	delete dispatcher;
@@ -64,6 +81,47 @@ VulkanRenderer::~VulkanRenderer() {
 	delete[] frameBuffers;
 }
 
+/*
+The driver should ignore a cache from another GPU or driver version, but
+the header's checked anyway, and a mismatched one starts a new cache.
+*/
+void VulkanRenderer::LoadPipelineCache(const string& filename) {
+	pipelineCacheFile = filename;
+
+	char*	data		= nullptr;
+	size_t	dataSize	= 0;
+	Assets::ReadBinaryFile(filename, &data, dataSize);
+
+	const size_t headerSize = 16 + VK_UUID_SIZE; //length, version, vendor and device, then the cache's UUID
+	bool valid = data && dataSize > headerSize;
+	if (valid) {
+		uint32_t header[4];
+		memcpy(header, data, sizeof(header));
+		valid = header[1] == (uint32_t)vk::PipelineCacheHeaderVersion::eOne
+			&& header[2] == deviceProperties.vendorID
+			&& header[3] == deviceProperties.deviceID
+			&& memcmp(data + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	vk::PipelineCacheCreateInfo createInfo;
+	if (valid) {
+		createInfo.setInitialDataSize(dataSize).setPInitialData(data);
+	}
+	pipelineCache = device.createPipelineCache(createInfo);
+	delete[] data;
+}
+
+void VulkanRenderer::SavePipelineCache() {
+	if (!pipelineCache || pipelineCacheFile.empty()) {
+		return;
+	}
+	std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+	std::ofstream file(pipelineCacheFile, std::ios::binary);
+	if (file && !data.empty()) {
+		file.write((const char*)data.data(), data.size());
+	}
+}
+
 bool VulkanRenderer::InitInstance() {
 	vk::ApplicationInfo appInfo = vk::ApplicationInfo(this->hostWindow.GetTitle().c_str());
 
@@ -136,7 +194,8 @@ bool VulkanRenderer::InitGPUDevice() {
 
 	device		= gpu.createDevice(createInfo);
 	deviceQueue = device.getQueue(gfxQueueIndex, 0);
-	deviceMemoryProperties = gpu.getMemoryProperties();
+	deviceProperties		= gpu.getProperties();
+	deviceMemoryProperties	= gpu.getMemoryProperties();
 
 	return true;
 }
@@ -296,9 +355,70 @@ void	VulkanRenderer::InitCommandPool() {
 		vk::CommandPoolCreateFlagBits::eResetCommandBuffer, gfxQueueIndex));
 
 	auto buffers = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(
-		commandPool, vk::CommandBufferLevel::ePrimary, 1));
+		commandPool, vk::CommandBufferLevel::ePrimary, FramesInFlight));
+
+	//Fences start signalled, as there's nothing to wait for the first time round
+	for (int i = 0; i < FramesInFlight; ++i) {
+		frames[i].cmdBuffer			= buffers[i];
+		frames[i].fence				= device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+		frames[i].imageAcquired		= device.createSemaphore(vk::SemaphoreCreateInfo());
+		frames[i].renderFinished	= device.createSemaphore(vk::SemaphoreCreateInfo());
+	}
+	frameCmdBuffer = frames[currentFrame].cmdBuffer;
+}
+
+//Every frame in flight has its own set, as one frame's can't be reset while the GPU's still using them
+void	VulkanRenderer::InitThreadCommandPools(int threadCount) {
+	device.waitIdle();
+	for (auto& f : frames) {
+		for (auto& p : f.threadPools) {
+			device.destroyCommandPool(p.pool);
+		}
+		f.threadPools.clear();
+		f.threadPools.resize(threadCount);
+		for (auto& p : f.threadPools) {
+			p.pool = device.createCommandPool(vk::CommandPoolCreateInfo(
+				vk::CommandPoolCreateFlagBits::eTransient, gfxQueueIndex));
+		}
+	}
+}
+
+//Only safe once this frame's fence says the GPU's done with it
+void	VulkanRenderer::ResetThreadCommandPools() {
+	for (auto& p : frames[currentFrame].threadPools) {
+		device.resetCommandPool(p.pool, vk::CommandPoolResetFlags());
+		p.used = 0;
+	}
+}
+
+vk::CommandBuffer VulkanRenderer::BeginSecondaryCmdBuffer(int thread) {
+	ThreadCommandPool& p = frames[currentFrame].threadPools[thread];
+	if (p.used == (int)p.buffers.size()) {
+		auto buffers = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(
+			p.pool, vk::CommandBufferLevel::eSecondary, 1));
+		p.buffers.emplace_back(buffers[0]);
+	}
+	vk::CommandBuffer buffer = p.buffers[p.used++];
+
+	vk::CommandBufferInheritanceInfo inheritance = vk::CommandBufferInheritanceInfo()
+		.setRenderPass(defaultRenderPass)
+		.setSubpass(0)
+		.setFramebuffer(frameBuffers[currentSwap]);
+
+	buffer.begin(vk::CommandBufferBeginInfo(
+		vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit, &inheritance));
+	buffer.setViewport(0, 1, &defaultViewport);
+	buffer.setScissor(0, 1, &defaultScissor);
+	return buffer;
+}
 
-	frameCmdBuffer = buffers[0];
+//They're run in the order given, so anything sorted across them stays sorted
+void	VulkanRenderer::ExecuteSecondaryCmdBuffers(const vector<vk::CommandBuffer>& buffers) {
+	frameCmdBuffer.beginRenderPass(defaultBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+	if (!buffers.empty()) {
+		frameCmdBuffer.executeCommands((uint32_t)buffers.size(), buffers.data());
+	}
+	frameCmdBuffer.endRenderPass();
 }
 
 vk::CommandBuffer VulkanRenderer::BeginCmdBuffer() {
@@ -413,6 +533,7 @@ void VulkanRenderer::OnWindowResize(int width, int height) {
 	std::cout << "calling resize! new dimensions: " << currentWidth << " , " << currentHeight << std::endl;
 	vkDeviceWaitIdle(device);
 
+	FlushUploads(); //the old depth buffer's transition might not have been sent yet
 	delete depthBuffer;
 	depthBuffer = VulkanTexture::GenerateDepthTexture((int)hostWindow.GetScreenSize().x, (int)hostWindow.GetScreenSize().y);
 	
@@ -432,7 +553,18 @@ void VulkanRenderer::CompleteResize() {
 
 }
 
+/*
+The fence for this frame's resources was waited on before its swap image
+was acquired, so everything here can be reused straight away, while the
+GPU might still be drawing the frame before.
+*/
 void	VulkanRenderer::BeginFrame() {
+	FlushUploads();
+	FrameResources& f = frames[currentFrame];
+	device.resetFences(f.fence);
+	ResetThreadCommandPools();
+	frameCmdBuffer = f.cmdBuffer;
+
 	vk::CommandBufferInheritanceInfo inheritance;
 	vk::CommandBufferBeginInfo bufferBegin = vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlags(), &inheritance);
 	frameCmdBuffer.begin(bufferBegin);
@@ -444,26 +576,27 @@ void	VulkanRenderer::BeginFrame() {
 	//frameCmdBuffer.beginRenderPass(defaultBeginInfo, vk::SubpassContents::eInline);
 }
 
+//Nothing waits for the GPU here - the fence is only waited on once this frame's resources come round again
 void	VulkanRenderer::EndFrame() {
 	//frameCmdBuffer.endRenderPass();
+	PresentScreenImage();
 	frameCmdBuffer.end();
-	vk::SubmitInfo submitInfo = vk::SubmitInfo(0, nullptr, nullptr, 1, &frameCmdBuffer, 0, nullptr);
-	vk::Fence fence = device.createFence(vk::FenceCreateInfo());
 
-	vk::Result result = deviceQueue.submit(1, &submitInfo, fence);
-	device.waitForFences(fence, true, ~0);
-	device.destroyFence(fence);
+	FrameResources& f = frames[currentFrame];
+	vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	vk::SubmitInfo submitInfo = vk::SubmitInfo(1, &f.imageAcquired, &waitStage, 1, &frameCmdBuffer, 1, &f.renderFinished);
+
+	deviceQueue.submit(1, &submitInfo, f.fence);
 }
 
 void VulkanRenderer::SwapBuffers() {
-	PresentScreenImage();
-
-	deviceQueue.presentKHR(vk::PresentInfoKHR(0, nullptr, 1, &swapChain, &currentSwap, nullptr));
+	deviceQueue.presentKHR(vk::PresentInfoKHR(1, &frames[currentFrame].renderFinished, 1, &swapChain, &currentSwap, nullptr));
 
-	vk::Semaphore	presentSempaphore = device.createSemaphore(vk::SemaphoreCreateInfo());
-	vk::Fence		fence = device.createFence(vk::FenceCreateInfo());
+	currentFrame = (currentFrame + 1) % FramesInFlight;
+	//The GPU only ever gets this far ahead, and the semaphore's free again once this has passed
+	device.waitForFences(frames[currentFrame].fence, true, UINT64_MAX);
 
-	currentSwap = device.acquireNextImageKHR(swapChain, UINT64_MAX, presentSempaphore, fence).value;	//Get swap image
+	currentSwap = device.acquireNextImageKHR(swapChain, UINT64_MAX, frames[currentFrame].imageAcquired, nullptr).value;	//Get swap image
 
 	defaultBeginInfo = vk::RenderPassBeginInfo()
 		.setRenderPass(defaultRenderPass)
@@ -471,11 +604,6 @@ void VulkanRenderer::SwapBuffers() {
 		.setRenderArea(defaultScissor)
 		.setClearValueCount(sizeof(defaultClearValues) / sizeof(vk::ClearValue))
 		.setPClearValues(defaultClearValues);
-
-	device.waitForFences(fence, true, ~0);	
-	
-	device.destroySemaphore(presentSempaphore);
-	device.destroyFence(fence);
 }
 
 void	VulkanRenderer::InitDefaultRenderPass() {
@@ -520,8 +648,8 @@ void	VulkanRenderer::InitDefaultRenderPass() {
 	defaultRenderPass = device.createRenderPass(renderPassInfo);
 }
 
+//Recorded at the end of the frame's own command buffer, rather than submitted and waited for
 void	VulkanRenderer::PresentScreenImage() {
-	BeginSetupCmdBuffer();
 
 	vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
 		.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
@@ -532,9 +660,7 @@ void	VulkanRenderer::PresentScreenImage() {
 
 	barrier.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
 
-	setupCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
-
-	EndSetupCmdBuffer();
+	frameCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 bool VulkanRenderer::CreateDefaultFrameBuffers() {
@@ -587,10 +713,11 @@ bool	VulkanRenderer::MemoryTypeFromPhysicalDeviceProps(vk::MemoryPropertyFlags r
 }
 
 void	VulkanRenderer::InitDefaultDescriptorPool() {
-	int maxSets = 128; //how many times can we ask the pool for a descriptor set?
+	int maxSets = 512; //how many times can we ask the pool for a descriptor set? Every texture keeps one
 	vk::DescriptorPoolSize poolSizes[] = {
 		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 128),
-		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 128)
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 128),
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 512)
 	};
 
 	vk::DescriptorPoolCreateInfo poolCreate;
@@ -647,28 +774,83 @@ void	VulkanRenderer::UpdateImageDescriptor(vk::DescriptorSet& set, VulkanTexture
 	device.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
 }
 
+/*
+There's a copy for every frame in flight, one after another, so a frame
+can be updated while the GPU's still reading the last one's. They're
+meant to be bound as dynamic uniform buffers, offset by GetUniformOffset.
+*/
 void VulkanRenderer::InitUniformBuffer(UniformData& uniform, void* data, int dataSize) {
-	uniform.buffer = device.createBuffer(vk::BufferCreateInfo(vk::BufferCreateFlags(), dataSize, vk::BufferUsageFlagBits::eUniformBuffer));
+	vk::DeviceSize alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+	alignment = alignment > 0 ? alignment : 1;
+	uniform.frameStride = (dataSize + alignment - 1) / alignment * alignment;
+
+	uniform.buffer = device.createBuffer(vk::BufferCreateInfo(vk::BufferCreateFlags(), uniform.frameStride * FramesInFlight, vk::BufferUsageFlagBits::eUniformBuffer));
 
 	uniform.descriptorInfo.buffer = uniform.buffer;
-	uniform.descriptorInfo.range = dataSize;//reqs.size;
+	uniform.descriptorInfo.range = dataSize;
 
-	vk::MemoryRequirements reqs = device.getBufferMemoryRequirements(uniform.buffer);
-	uniform.allocInfo = vk::MemoryAllocateInfo(reqs.size);
+	uniform.memory = memoryAllocator->AllocateBuffer(uniform.buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-	bool found = MemoryTypeFromPhysicalDeviceProps(vk::MemoryPropertyFlagBits::eHostVisible, reqs.memoryTypeBits, uniform.allocInfo.memoryTypeIndex);
+	for (int i = 0; i < FramesInFlight; ++i) {
+		memcpy(uniform.memory.mapped + uniform.frameStride * i, data, dataSize);
+	}
+}
 
-	uniform.deviceMem = device.allocateMemory(uniform.allocInfo);
+//Its memory stays mapped, so this is just a copy, into the current frame's part of it
+void VulkanRenderer::UpdateUniformBuffer(UniformData& uniform, void* data, int dataSize) {
+	memcpy(uniform.memory.mapped + GetUniformOffset(uniform), data, dataSize);
+}
+
+void VulkanRenderer::DestroyUniformBuffer(UniformData& uniform) {
+	device.destroyBuffer(uniform.buffer);
+	memoryAllocator->Free(uniform.memory);
+}
+
+/*
+Anything bigger than what's left waits for what's already been staged
+to be sent first, and the staging buffer's made bigger if even an empty
+one wouldn't fit it.
+*/
+char* VulkanRenderer::StageUpload(size_t size, vk::DeviceSize& stagingOffset) {
+	const vk::DeviceSize alignment = 16; //enough for any texel format's copy offset
+	vk::DeviceSize start = (stagingUsed + alignment - 1) / alignment * alignment;
+	if (start + size > stagingSize) {
+		FlushUploads();
+		start = 0;
+	}
+	if (size > stagingSize) {
+		if (stagingBuffer) {
+			device.destroyBuffer(stagingBuffer);
+			memoryAllocator->Free(stagingMemory);
+		}
+		stagingSize		= size > 16 * 1024 * 1024 ? size : 16 * 1024 * 1024;
+		stagingBuffer	= device.createBuffer(vk::BufferCreateInfo({}, stagingSize, vk::BufferUsageFlagBits::eTransferSrc));
+		stagingMemory	= memoryAllocator->AllocateBuffer(stagingBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+	}
+	stagingUsed		= start + size;
+	stagingOffset	= start;
+	return stagingMemory.mapped + start;
+}
 
-	device.bindBufferMemory(uniform.buffer, uniform.deviceMem, 0);
+vk::CommandBuffer& VulkanRenderer::GetUploadCmdBuffer() {
+	if (!uploadCmdBuffer) {
+		uploadCmdBuffer = BeginCmdBuffer();
+	}
+	return uploadCmdBuffer;
+}
 
-	UpdateUniformBuffer(uniform, data, dataSize);
+void VulkanRenderer::UploadBufferData(vk::Buffer to, const void* data, size_t size) {
+	vk::DeviceSize offset = 0;
+	memcpy(StageUpload(size, offset), data, size);
+	GetUploadCmdBuffer().copyBuffer(stagingBuffer, to, vk::BufferCopy(offset, 0, size));
 }
 
-void VulkanRenderer::UpdateUniformBuffer(UniformData& uniform, void* data, int dataSize) {
-	void* mappedData = device.mapMemory(uniform.deviceMem, 0, uniform.allocInfo.allocationSize);
-	memcpy(mappedData, data, dataSize);
-	device.unmapMemory(uniform.deviceMem);
+void VulkanRenderer::FlushUploads() {
+	if (uploadCmdBuffer) {
+		EndCmdBufferWait(uploadCmdBuffer);
+		uploadCmdBuffer = vk::CommandBuffer();
+	}
+	stagingUsed = 0;
 }
 
 vk::DescriptorSet	VulkanRenderer::BuildDescriptorSet(vk::DescriptorSetLayout& layout) {
@@ -682,6 +864,17 @@ vk::DescriptorSet	VulkanRenderer::BuildDescriptorSet(vk::DescriptorSetLayout& la
 	return newSet;
 }
 
+vk::DescriptorSet	VulkanRenderer::GetTextureDescriptorSet(VulkanTexture* t, vk::DescriptorSetLayout& layout, vk::Sampler sampler) {
+	auto found = textureDescriptors.find(t);
+	if (found != textureDescriptors.end()) {
+		return found->second;
+	}
+	vk::DescriptorSet set = BuildDescriptorSet(layout);
+	UpdateImageDescriptor(set, t, sampler);
+	textureDescriptors.insert({ t, set });
+	return set;
+}
+
 void VulkanRenderer::SubmitDrawCall(VulkanMesh* m, vk::CommandBuffer& to) {
 	VkDeviceSize baseOffset = 0;
 	int instanceCount = 1;
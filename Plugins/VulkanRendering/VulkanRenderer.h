@@ -25,9 +25,11 @@ _-_-_-_-_-_-_-""  ""
 #include "VulkanMesh.h"
 #include "VulkanShader.h"
 #include "VulkanTexture.h"
+#include "VulkanMemoryAllocator.h"
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 using std::string;
 
@@ -35,8 +37,8 @@ namespace NCL {
 	namespace Rendering {
 		struct UniformData {
 			vk::Buffer					buffer;
-			vk::MemoryAllocateInfo		allocInfo;
-			vk::DeviceMemory			deviceMem;
+			VulkanAllocation			memory;
+			vk::DeviceSize				frameStride = 0;  //from one frame in flight's copy to the next
 			vk::DescriptorBufferInfo	descriptorInfo;
 		};
 
@@ -70,6 +72,10 @@ namespace NCL {
 
 			vk::DescriptorSet	BuildDescriptorSet(vk::DescriptorSetLayout& layout);
 
+			//Pipelines built last time are in here, so they're quick to build again
+			void	LoadPipelineCache(const string& filename);
+			void	SavePipelineCache();
+
 			bool	InitInstance();
 			bool	InitGPUDevice();
 
@@ -97,10 +103,48 @@ namespace NCL {
 
 			void	InitCommandPool();
 
+			//Each recording thread gets its own pool, as a pool can only be used by one thread at a time
+			void	InitThreadCommandPools(int threadCount);
+			void	ResetThreadCommandPools();
+			//Ready to draw inside the default render pass, into the current swap image
+			vk::CommandBuffer	BeginSecondaryCmdBuffer(int thread);
+			void	ExecuteSecondaryCmdBuffers(const vector<vk::CommandBuffer>& buffers);
+
+			//Made the first time a texture's asked for, then kept for as long as the renderer is
+			vk::DescriptorSet	GetTextureDescriptorSet(VulkanTexture* t, vk::DescriptorSetLayout& layout, vk::Sampler sampler);
+
 			void	PresentScreenImage();
 
 			void InitUniformBuffer(UniformData& uniform, void* data, int dataSize);
 			void UpdateUniformBuffer(UniformData& uniform, void* data, int dataSize);
+			void DestroyUniformBuffer(UniformData& uniform);
+
+			uint32_t GetUniformOffset(const UniformData& uniform) const {
+				return (uint32_t)(uniform.frameStride * currentFrame);
+			}
+
+			int GetThreadPoolCount() const {
+				return (int)frames[0].threadPools.size();
+			}
+
+			VulkanMemoryAllocator& GetMemoryAllocator() {
+				return *memoryAllocator;
+			}
+
+			/*
+			Uploads are copied into one staging buffer, from one command
+			buffer, and all sent at once by FlushUploads, which BeginFrame
+			calls, so loading doesn't wait on the GPU for every resource.
+			Stage first, then record the copy, as staging can flush what's
+			been recorded so far. Only for the main thread.
+			*/
+			char*				StageUpload(size_t size, vk::DeviceSize& stagingOffset);
+			vk::CommandBuffer&	GetUploadCmdBuffer();
+			vk::Buffer			GetStagingBuffer() const {
+				return stagingBuffer;
+			}
+			void				UploadBufferData(vk::Buffer to, const void* data, size_t size);
+			void				FlushUploads();
 
 			void	UpdateImageDescriptor(vk::DescriptorSet& set, VulkanTexture* t, vk::Sampler sampler, int bindingNum = 0);
 			void	UpdateImageDescriptor(vk::DescriptorSet& set, VulkanTexture* t, vk::Sampler sampler, vk::ImageView, vk::ImageLayout forceLayout, int bindingNum = 0);
@@ -139,12 +183,42 @@ namespace NCL {
 			vk::PhysicalDeviceProperties		deviceProperties;
 			vk::PhysicalDeviceMemoryProperties	deviceMemoryProperties;
 
+			VulkanMemoryAllocator*	memoryAllocator;
+
+			vk::Buffer			stagingBuffer;
+			VulkanAllocation	stagingMemory;
+			vk::DeviceSize		stagingSize	= 0;
+			vk::DeviceSize		stagingUsed	= 0;	//linear, as it's all free again once the uploads are done
+			vk::CommandBuffer	uploadCmdBuffer;
+
 			vk::PipelineCache	pipelineCache;
+			string				pipelineCacheFile;
 			vk::DescriptorPool	defaultDescriptorPool;	//descriptor sets come from here!
 			vk::CommandPool		commandPool;			//Source Command Buffers from here
 
 			vk::CommandBuffer	setupCmdBuffer;
-			vk::CommandBuffer	frameCmdBuffer;
+			vk::CommandBuffer	frameCmdBuffer;		//the current frame's
+
+			struct ThreadCommandPool {
+				vk::CommandPool				pool;
+				vector<vk::CommandBuffer>	buffers;	//reused every frame once they've been allocated
+				int							used = 0;
+			};
+
+			//The CPU can be this many frames ahead of the GPU
+			static const int FramesInFlight = 2;
+
+			struct FrameResources {
+				vk::CommandBuffer			cmdBuffer;
+				vk::Fence					fence;			//signalled once the GPU's finished with this frame
+				vk::Semaphore				imageAcquired;
+				vk::Semaphore				renderFinished;
+				vector<ThreadCommandPool>	threadPools;
+			};
+			FrameResources	frames[FramesInFlight];
+			int				currentFrame = 0;
+
+			std::unordered_map<const VulkanTexture*, vk::DescriptorSet> textureDescriptors;
 
 			vk::RenderPass			defaultRenderPass;
 			vk::RenderPassBeginInfo defaultBeginInfo;
@@ -20,7 +20,7 @@ VulkanTexture::~VulkanTexture() {
 	vk::Device sourceDevice = vkRenderer->GetDevice();
 	sourceDevice.destroyImageView(defaultView);
 	sourceDevice.destroyImage(image);
-	sourceDevice.freeMemory(deviceMem);
+	vkRenderer->GetMemoryAllocator().Free(memory);
 }
 
 int VulkanTexture::CalculateMipCount(int width, int height) {
@@ -41,42 +41,26 @@ int VulkanTexture::CalculateMipCount(int width, int height) {
 	 int faceSize = width * height * channelCount;
 	 int allocationSize = faceSize * (int)dataSrcs.size();
 
-	 vk::Device device = vkRenderer->GetDevice();
+	 //Staged first, as that might flush what's been recorded so far
+	 vk::DeviceSize stagingOffset = 0;
+	 char* gpuPtr = vkRenderer->StageUpload(allocationSize, stagingOffset);
 
-	 vk::Buffer	stagingBuffer = device.createBuffer(
-		 vk::BufferCreateInfo({}, allocationSize, vk::BufferUsageFlagBits::eTransferSrc)
-	 );
-	 vk::MemoryRequirements	stagingReqs = {};
-	 vk::MemoryAllocateInfo	stagingInfo = {};
-	 vk::DeviceMemory		stagingMemory;
+	 vk::CommandBuffer& cmdBuffer = vkRenderer->GetUploadCmdBuffer();
 
-	 device.getBufferMemoryRequirements(stagingBuffer, &stagingReqs);
-
-	 stagingInfo.setAllocationSize(allocationSize);
-	 vkRenderer->MemoryTypeFromPhysicalDeviceProps(vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingReqs.memoryTypeBits, stagingInfo.memoryTypeIndex);
-
-	 vk::CommandBuffer cmdBuffer = vkRenderer->BeginCmdBuffer();
-
-	 stagingMemory = device.allocateMemory(stagingInfo);
-	 device.bindBufferMemory(stagingBuffer, stagingMemory, 0);
-
-	 //our buffer now has memory! Copy some texture date to it...
-	 char* gpuPtr = (char*)device.mapMemory(stagingMemory, 0, allocationSize);
 	 for (int i = 0; i < dataSrcs.size(); ++i) {
 		 memcpy(gpuPtr, dataSrcs[i], faceSize);
 		 gpuPtr += faceSize;
 
 		 vkRenderer->ImageTransitionBarrier(&cmdBuffer, outTex, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, outTex->aspectType, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer, 0, i);
 	 }
-	 device.unmapMemory(stagingMemory);
 
 	 vk::BufferImageCopy copyInfo;
 	 copyInfo.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor).setMipLevel(0).setLayerCount((uint32_t)dataSrcs.size());
 	 copyInfo.imageExtent = vk::Extent3D(width, height, 1);
-	 copyInfo.bufferOffset = 0;
+	 copyInfo.bufferOffset = stagingOffset;
 
 	 //Copy from staging buffer to image memory...
-	 cmdBuffer.copyBufferToImage(stagingBuffer, outTex->image, vk::ImageLayout::eTransferDstOptimal, copyInfo);
+	 cmdBuffer.copyBufferToImage(vkRenderer->GetStagingBuffer(), outTex->image, vk::ImageLayout::eTransferDstOptimal, copyInfo);
 
 	 if (outTex->mipCount > 1) {
 		 outTex->GenerateMipMaps(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader);
@@ -86,12 +70,7 @@ int VulkanTexture::CalculateMipCount(int width, int height) {
 		 outTex->defaultView = outTex->GenerateDefaultView(outTex->aspectType);
 	 }
 
-	 vkRenderer->EndCmdBufferWait(cmdBuffer);
-
-	 device.destroyBuffer(stagingBuffer); //These can't be destroyed until the cmd buffer has definately completed...
-	 device.freeMemory(stagingMemory);
-
-	 return outTex;
+	 return outTex; //sent along with everything else staged, by the next FlushUploads
 }
 
 TextureBase* VulkanTexture::VulkanTextureFromFilename(const std::string& name) {
@@ -140,15 +119,7 @@ VulkanTexture* VulkanTexture::VulkanCubemapFromFilename(
 }
 
 void	VulkanTexture::InitTextureDeviceMemory(VulkanTexture& img) {
-	vk::MemoryRequirements memReqs = vkRenderer->GetDevice().getImageMemoryRequirements(img.image);
-
-	img.allocInfo = vk::MemoryAllocateInfo(memReqs.size);
-
-	bool found = vkRenderer->MemoryTypeFromPhysicalDeviceProps({}, memReqs.memoryTypeBits, img.allocInfo.memoryTypeIndex);
-
-	img.deviceMem = vkRenderer->GetDevice().allocateMemory(img.allocInfo);
-
-	vkRenderer->GetDevice().bindImageMemory(img.image, img.deviceMem, 0);
+	img.memory = vkRenderer->GetMemoryAllocator().AllocateImage(img.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
 }
 
 VulkanTexture* VulkanTexture::GenerateTextureInternal(int width, int height, int mipcount, bool isCubemap, std::string debugName, vk::Format format, vk::ImageAspectFlags aspect, vk::ImageUsageFlags usage, vk::ImageLayout outLayout, vk::PipelineStageFlags pipeType) {
@@ -183,10 +154,8 @@ VulkanTexture* VulkanTexture::GenerateTextureInternal(int width, int height, int
 	vkRenderer->SetDebugName(vk::ObjectType::eImage, (uint64_t)tex->image.operator VkImage(), debugName);
 	vkRenderer->SetDebugName(vk::ObjectType::eImageView, (uint64_t)tex->defaultView.operator VkImageView(), debugName);
 
-	tex->layout = outLayout; //not strictly true until queue submit
-	vk::CommandBuffer tempBuffer = vkRenderer->BeginCmdBuffer();
-	vkRenderer->ImageTransitionBarrier(&tempBuffer, tex, vk::ImageLayout::eUndefined, outLayout, tex->aspectType, vk::PipelineStageFlagBits::eTopOfPipe, pipeType);
-	vkRenderer->EndCmdBufferWait(tempBuffer);
+	tex->layout = outLayout; //not strictly true until the uploads are flushed
+	vkRenderer->ImageTransitionBarrier(&vkRenderer->GetUploadCmdBuffer(), tex, vk::ImageLayout::eUndefined, outLayout, tex->aspectType, vk::PipelineStageFlagBits::eTopOfPipe, pipeType);
 	return tex;
 }
 
@@ -2,6 +2,7 @@
 #include "../../Common/TextureBase.h"
 #include <string>
 #include <vulkan\vulkan.hpp> //
+#include "VulkanMemoryAllocator.h"
 
 namespace NCL {
 	namespace Rendering {
@@ -56,10 +57,9 @@ namespace NCL {
 			vk::Format				format;
 			vk::ImageView			defaultView;
 			vk::Image				image;
-			vk::DeviceMemory		deviceMem;
+			VulkanAllocation		memory;
 			vk::ImageLayout			layout;
-	
-			vk::MemoryAllocateInfo	allocInfo;
+
 			vk::ImageCreateInfo		createInfo;
 			vk::ImageAspectFlags	aspectType;
 